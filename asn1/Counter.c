@@ -0,0 +1,62 @@
+/*
+ * Written by hand, not generated: asn1c was not available when the
+ * Counter type was added to ASN.1 module "TcpkaliOrchestration"
+ * 	found in "TcpkaliOrchestration.asn1".
+ * The tables follow what asn1c-0.9.29 emits for such a type, and
+ * 	`asn1c -gen-OER -gen-PER -pdu=TcpkaliMessage`
+ * should replace this file when it is run next.
+ */
+
+#include "Counter.h"
+
+int
+Counter_constraint(const asn_TYPE_descriptor_t *td, const void *sptr,
+			asn_app_constraint_failed_f *ctfailcb, void *app_key) {
+	
+	if(!sptr) {
+		ASN__CTFAIL(app_key, td, sptr,
+			"%s: value not given (%s:%d)",
+			td->name, __FILE__, __LINE__);
+		return -1;
+	}
+	
+	
+	/* Constraint check succeeded */
+	return 0;
+}
+
+/*
+ * This type is implemented using NativeInteger,
+ * so here we adjust the DEF accordingly.
+ */
+static asn_oer_constraints_t asn_OER_type_Counter_constr_1 CC_NOTUSED = {
+	{ 0, 1 }	/* (0..MAX) */,
+	-1};
+asn_per_constraints_t asn_PER_type_Counter_constr_1 CC_NOTUSED = {
+	{ APC_SEMI_CONSTRAINED,	-1, -1,  0,  0 }	/* (0..MAX) */,
+	{ APC_UNCONSTRAINED,	-1, -1,  0,  0 },
+	0, 0	/* No PER value map */
+};
+const asn_INTEGER_specifics_t asn_SPC_Counter_specs_1 = {
+	0,	0,	0,	0,	0,
+	0,	/* Native long size */
+	1	/* Unsigned representation */
+};
+static const ber_tlv_tag_t asn_DEF_Counter_tags_1[] = {
+	(ASN_TAG_CLASS_UNIVERSAL | (2 << 2))
+};
+asn_TYPE_descriptor_t asn_DEF_Counter = {
+	"Counter",
+	"Counter",
+	&asn_OP_NativeInteger,
+	asn_DEF_Counter_tags_1,
+	sizeof(asn_DEF_Counter_tags_1)
+		/sizeof(asn_DEF_Counter_tags_1[0]), /* 1 */
+	asn_DEF_Counter_tags_1,	/* Same as above */
+	sizeof(asn_DEF_Counter_tags_1)
+		/sizeof(asn_DEF_Counter_tags_1[0]), /* 1 */
+	{ &asn_OER_type_Counter_constr_1, &asn_PER_type_Counter_constr_1, Counter_constraint },
+	0, 0,	/* No members */
+	&asn_SPC_Counter_specs_1	/* Additional specs */
+};
+
@@ -0,0 +1,47 @@
+/*
+ * Written by hand, not generated: asn1c was not available when the
+ * Counter type was added to ASN.1 module "TcpkaliOrchestration"
+ * 	found in "TcpkaliOrchestration.asn1".
+ * The tables follow what asn1c-0.9.29 emits for such a type, and
+ * 	`asn1c -gen-OER -gen-PER -pdu=TcpkaliMessage`
+ * should replace this file when it is run next.
+ */
+
+#ifndef	_Counter_H_
+#define	_Counter_H_
+
+
+#include <asn_application.h>
+
+/* Including external dependencies */
+#include <NativeInteger.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Counter */
+typedef unsigned long	 Counter_t;
+
+/* Implementation */
+extern asn_per_constraints_t asn_PER_type_Counter_constr_1;
+extern asn_TYPE_descriptor_t asn_DEF_Counter;
+extern const asn_INTEGER_specifics_t asn_SPC_Counter_specs_1;
+asn_struct_free_f Counter_free;
+asn_struct_print_f Counter_print;
+asn_constr_check_f Counter_constraint;
+ber_type_decoder_f Counter_decode_ber;
+der_type_encoder_f Counter_encode_der;
+xer_type_decoder_f Counter_decode_xer;
+xer_type_encoder_f Counter_encode_xer;
+oer_type_decoder_f Counter_decode_oer;
+oer_type_encoder_f Counter_encode_oer;
+per_type_decoder_f Counter_decode_uper;
+per_type_encoder_f Counter_encode_uper;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _Counter_H_ */
+#include <asn_internal.h>
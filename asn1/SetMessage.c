@@ -0,0 +1,33 @@
+/*
+ * Written by hand, not generated: asn1c was not available when the
+ * SetMessage type was added to ASN.1 module "TcpkaliOrchestration"
+ * 	found in "TcpkaliOrchestration.asn1".
+ * The tables follow what asn1c-0.9.29 emits for such a type, and
+ * 	`asn1c -gen-OER -gen-PER -pdu=TcpkaliMessage`
+ * should replace this file when it is run next.
+ */
+
+#include "SetMessage.h"
+
+/*
+ * This type is implemented using OCTET_STRING,
+ * so here we adjust the DEF accordingly.
+ */
+static const ber_tlv_tag_t asn_DEF_SetMessage_tags_1[] = {
+	(ASN_TAG_CLASS_UNIVERSAL | (4 << 2))
+};
+asn_TYPE_descriptor_t asn_DEF_SetMessage = {
+	"SetMessage",
+	"SetMessage",
+	&asn_OP_OCTET_STRING,
+	asn_DEF_SetMessage_tags_1,
+	sizeof(asn_DEF_SetMessage_tags_1)
+		/sizeof(asn_DEF_SetMessage_tags_1[0]), /* 1 */
+	asn_DEF_SetMessage_tags_1,	/* Same as above */
+	sizeof(asn_DEF_SetMessage_tags_1)
+		/sizeof(asn_DEF_SetMessage_tags_1[0]), /* 1 */
+	{ 0, 0, OCTET_STRING_constraint },
+	0, 0,	/* No members */
+	&asn_SPC_OCTET_STRING_specs
+};
+
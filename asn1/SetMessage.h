@@ -0,0 +1,45 @@
+/*
+ * Written by hand, not generated: asn1c was not available when the
+ * SetMessage type was added to ASN.1 module "TcpkaliOrchestration"
+ * 	found in "TcpkaliOrchestration.asn1".
+ * The tables follow what asn1c-0.9.29 emits for such a type, and
+ * 	`asn1c -gen-OER -gen-PER -pdu=TcpkaliMessage`
+ * should replace this file when it is run next.
+ */
+
+#ifndef	_SetMessage_H_
+#define	_SetMessage_H_
+
+
+#include <asn_application.h>
+
+/* Including external dependencies */
+#include <OCTET_STRING.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SetMessage */
+typedef OCTET_STRING_t	 SetMessage_t;
+
+/* Implementation */
+extern asn_TYPE_descriptor_t asn_DEF_SetMessage;
+asn_struct_free_f SetMessage_free;
+asn_struct_print_f SetMessage_print;
+asn_constr_check_f SetMessage_constraint;
+ber_type_decoder_f SetMessage_decode_ber;
+der_type_encoder_f SetMessage_encode_der;
+xer_type_decoder_f SetMessage_decode_xer;
+xer_type_encoder_f SetMessage_encode_xer;
+oer_type_decoder_f SetMessage_decode_oer;
+oer_type_encoder_f SetMessage_encode_oer;
+per_type_decoder_f SetMessage_decode_uper;
+per_type_encoder_f SetMessage_encode_uper;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _SetMessage_H_ */
+#include <asn_internal.h>
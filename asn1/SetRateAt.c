@@ -0,0 +1,63 @@
+/*
+ * Written by hand, not generated: asn1c was not available when the
+ * SetRateAt type was added to ASN.1 module "TcpkaliOrchestration"
+ * 	found in "TcpkaliOrchestration.asn1".
+ * The tables follow what asn1c-0.9.29 emits for such a type, and
+ * 	`asn1c -gen-OER -gen-PER -pdu=TcpkaliMessage`
+ * should replace this file when it is run next.
+ */
+
+#include <asn_internal.h>
+
+#include "SetRateAt.h"
+
+asn_TYPE_member_t asn_MBR_SetRateAt_1[] = {
+	{ ATF_NOFLAGS, 0, offsetof(struct SetRateAt, rate),
+		(ASN_TAG_CLASS_CONTEXT | (0 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_PositiveReal,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"rate"
+		},
+	{ ATF_NOFLAGS, 0, offsetof(struct SetRateAt, at),
+		(ASN_TAG_CLASS_CONTEXT | (1 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_Timestamp,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"at"
+		},
+};
+static const ber_tlv_tag_t asn_DEF_SetRateAt_tags_1[] = {
+	(ASN_TAG_CLASS_UNIVERSAL | (16 << 2))
+};
+static const asn_TYPE_tag2member_t asn_MAP_SetRateAt_tag2el_1[] = {
+    { (ASN_TAG_CLASS_CONTEXT | (0 << 2)), 0, 0, 0 }, /* rate */
+    { (ASN_TAG_CLASS_CONTEXT | (1 << 2)), 1, 0, 0 } /* at */
+};
+asn_SEQUENCE_specifics_t asn_SPC_SetRateAt_specs_1 = {
+	sizeof(struct SetRateAt),
+	offsetof(struct SetRateAt, _asn_ctx),
+	asn_MAP_SetRateAt_tag2el_1,
+	2,	/* Count of tags in the map */
+	0, 0, 0,	/* Optional elements (not needed) */
+	2,	/* First extension addition */
+};
+asn_TYPE_descriptor_t asn_DEF_SetRateAt = {
+	"SetRateAt",
+	"SetRateAt",
+	&asn_OP_SEQUENCE,
+	asn_DEF_SetRateAt_tags_1,
+	sizeof(asn_DEF_SetRateAt_tags_1)
+		/sizeof(asn_DEF_SetRateAt_tags_1[0]), /* 1 */
+	asn_DEF_SetRateAt_tags_1,	/* Same as above */
+	sizeof(asn_DEF_SetRateAt_tags_1)
+		/sizeof(asn_DEF_SetRateAt_tags_1[0]), /* 1 */
+	{ 0, 0, SEQUENCE_constraint },
+	asn_MBR_SetRateAt_1,
+	2,	/* Elements count */
+	&asn_SPC_SetRateAt_specs_1	/* Additional specs */
+};
@@ -0,0 +1,47 @@
+/*
+ * Written by hand, not generated: asn1c was not available when the
+ * SetRateAt type was added to ASN.1 module "TcpkaliOrchestration"
+ * 	found in "TcpkaliOrchestration.asn1".
+ * The tables follow what asn1c-0.9.29 emits for such a type, and
+ * 	`asn1c -gen-OER -gen-PER -pdu=TcpkaliMessage`
+ * should replace this file when it is run next.
+ */
+
+#ifndef	_SetRateAt_H_
+#define	_SetRateAt_H_
+
+
+#include <asn_application.h>
+
+/* Including external dependencies */
+#include "PositiveReal.h"
+#include "Timestamp.h"
+#include <constr_SEQUENCE.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SetRateAt */
+typedef struct SetRateAt {
+	PositiveReal_t	 rate;
+	Timestamp_t	 at;
+	/*
+	 * This type is extensible,
+	 * possible extensions are below.
+	 */
+	
+	/* Context for parsing across buffer boundaries */
+	asn_struct_ctx_t _asn_ctx;
+} SetRateAt_t;
+
+/* Implementation */
+extern asn_TYPE_descriptor_t asn_DEF_SetRateAt;
+extern asn_SEQUENCE_specifics_t asn_SPC_SetRateAt_specs_1;
+extern asn_TYPE_member_t asn_MBR_SetRateAt_1[2];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _SetRateAt_H_ */
@@ -0,0 +1,47 @@
+/*
+ * Written by hand, not generated: asn1c was not available when the
+ * SetWorkers type was added to ASN.1 module "TcpkaliOrchestration"
+ * 	found in "TcpkaliOrchestration.asn1".
+ * The tables follow what asn1c-0.9.29 emits for such a type, and
+ * 	`asn1c -gen-OER -gen-PER -pdu=TcpkaliMessage`
+ * should replace this file when it is run next.
+ */
+
+#ifndef	_SetWorkers_H_
+#define	_SetWorkers_H_
+
+
+#include <asn_application.h>
+
+/* Including external dependencies */
+#include "PositiveInteger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SetWorkers */
+typedef PositiveInteger_t	 SetWorkers_t;
+
+/* Implementation */
+extern asn_per_constraints_t asn_PER_type_SetWorkers_constr_1;
+extern asn_TYPE_descriptor_t asn_DEF_SetWorkers;
+extern const asn_INTEGER_specifics_t asn_SPC_SetWorkers_specs_1;
+asn_struct_free_f SetWorkers_free;
+asn_struct_print_f SetWorkers_print;
+asn_constr_check_f SetWorkers_constraint;
+ber_type_decoder_f SetWorkers_decode_ber;
+der_type_encoder_f SetWorkers_encode_der;
+xer_type_decoder_f SetWorkers_decode_xer;
+xer_type_encoder_f SetWorkers_encode_xer;
+oer_type_decoder_f SetWorkers_decode_oer;
+oer_type_encoder_f SetWorkers_encode_oer;
+per_type_decoder_f SetWorkers_decode_uper;
+per_type_encoder_f SetWorkers_encode_uper;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _SetWorkers_H_ */
+#include <asn_internal.h>
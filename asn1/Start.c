@@ -3,6 +3,9 @@
  * From ASN.1 module "TcpkaliOrchestration"
  * 	found in "TcpkaliOrchestration.asn1"
  * 	`asn1c -gen-OER -gen-PER -pdu=TcpkaliMessage`
+ *
+ * Edited by hand since, for the startAt member;
+ * asn1c was not rerun.
  */
 
 #include "Start.h"
@@ -489,7 +492,7 @@ asn_TYPE_descriptor_t asn_DEF_messageRate_28 = {
 };
 
 asn_TYPE_member_t asn_MBR_Start_1[] = {
-	{ ATF_POINTER, 37, offsetof(struct Start, target),
+	{ ATF_POINTER, 38, offsetof(struct Start, target),
 		(ASN_TAG_CLASS_CONTEXT | (0 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_URL,
@@ -498,7 +501,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"target"
 		},
-	{ ATF_POINTER, 36, offsetof(struct Start, nagle),
+	{ ATF_POINTER, 37, offsetof(struct Start, nagle),
 		(ASN_TAG_CLASS_CONTEXT | (1 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_BOOLEAN,
@@ -507,7 +510,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"nagle"
 		},
-	{ ATF_POINTER, 35, offsetof(struct Start, rcvbuf),
+	{ ATF_POINTER, 36, offsetof(struct Start, rcvbuf),
 		(ASN_TAG_CLASS_CONTEXT | (2 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveInteger,
@@ -516,7 +519,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"rcvbuf"
 		},
-	{ ATF_POINTER, 34, offsetof(struct Start, sndbuf),
+	{ ATF_POINTER, 35, offsetof(struct Start, sndbuf),
 		(ASN_TAG_CLASS_CONTEXT | (3 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveInteger,
@@ -525,7 +528,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"sndbuf"
 		},
-	{ ATF_POINTER, 33, offsetof(struct Start, writeCombine),
+	{ ATF_POINTER, 34, offsetof(struct Start, writeCombine),
 		(ASN_TAG_CLASS_CONTEXT | (4 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_BOOLEAN,
@@ -534,7 +537,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"writeCombine"
 		},
-	{ ATF_POINTER, 32, offsetof(struct Start, workers),
+	{ ATF_POINTER, 33, offsetof(struct Start, workers),
 		(ASN_TAG_CLASS_CONTEXT | (5 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveInteger,
@@ -543,7 +546,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"workers"
 		},
-	{ ATF_POINTER, 31, offsetof(struct Start, ws),
+	{ ATF_POINTER, 32, offsetof(struct Start, ws),
 		(ASN_TAG_CLASS_CONTEXT | (6 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_BOOLEAN,
@@ -552,7 +555,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"ws"
 		},
-	{ ATF_POINTER, 30, offsetof(struct Start, ssl),
+	{ ATF_POINTER, 31, offsetof(struct Start, ssl),
 		(ASN_TAG_CLASS_CONTEXT | (7 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_BOOLEAN,
@@ -561,7 +564,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"ssl"
 		},
-	{ ATF_POINTER, 29, offsetof(struct Start, sslCert),
+	{ ATF_POINTER, 30, offsetof(struct Start, sslCert),
 		(ASN_TAG_CLASS_CONTEXT | (8 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PrintableString,
@@ -570,7 +573,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"sslCert"
 		},
-	{ ATF_POINTER, 28, offsetof(struct Start, sslKey),
+	{ ATF_POINTER, 29, offsetof(struct Start, sslKey),
 		(ASN_TAG_CLASS_CONTEXT | (9 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PrintableString,
@@ -579,7 +582,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"sslKey"
 		},
-	{ ATF_POINTER, 27, offsetof(struct Start, header),
+	{ ATF_POINTER, 28, offsetof(struct Start, header),
 		(ASN_TAG_CLASS_CONTEXT | (10 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PrintableString,
@@ -588,7 +591,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"header"
 		},
-	{ ATF_POINTER, 26, offsetof(struct Start, connections),
+	{ ATF_POINTER, 27, offsetof(struct Start, connections),
 		(ASN_TAG_CLASS_CONTEXT | (11 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveInteger,
@@ -597,7 +600,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"connections"
 		},
-	{ ATF_POINTER, 25, offsetof(struct Start, connectRate),
+	{ ATF_POINTER, 26, offsetof(struct Start, connectRate),
 		(ASN_TAG_CLASS_CONTEXT | (12 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveReal,
@@ -606,7 +609,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"connectRate"
 		},
-	{ ATF_POINTER, 24, offsetof(struct Start, connectTimeout),
+	{ ATF_POINTER, 25, offsetof(struct Start, connectTimeout),
 		(ASN_TAG_CLASS_CONTEXT | (13 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveReal,
@@ -615,7 +618,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"connectTimeout"
 		},
-	{ ATF_POINTER, 23, offsetof(struct Start, channelLifetime),
+	{ ATF_POINTER, 24, offsetof(struct Start, channelLifetime),
 		(ASN_TAG_CLASS_CONTEXT | (14 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveReal,
@@ -624,7 +627,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"channelLifetime"
 		},
-	{ ATF_POINTER, 22, offsetof(struct Start, channelBandwidthUpstream),
+	{ ATF_POINTER, 23, offsetof(struct Start, channelBandwidthUpstream),
 		(ASN_TAG_CLASS_CONTEXT | (15 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveReal,
@@ -633,7 +636,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"channelBandwidthUpstream"
 		},
-	{ ATF_POINTER, 21, offsetof(struct Start, channelBandwidthDownstream),
+	{ ATF_POINTER, 22, offsetof(struct Start, channelBandwidthDownstream),
 		(ASN_TAG_CLASS_CONTEXT | (16 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveReal,
@@ -642,7 +645,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"channelBandwidthDownstream"
 		},
-	{ ATF_POINTER, 20, offsetof(struct Start, listenPort),
+	{ ATF_POINTER, 21, offsetof(struct Start, listenPort),
 		(ASN_TAG_CLASS_CONTEXT | (17 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_TcpPort,
@@ -651,7 +654,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"listenPort"
 		},
-	{ ATF_POINTER, 19, offsetof(struct Start, listenMode),
+	{ ATF_POINTER, 20, offsetof(struct Start, listenMode),
 		(ASN_TAG_CLASS_CONTEXT | (18 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_listenMode_20,
@@ -660,7 +663,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"listenMode"
 		},
-	{ ATF_POINTER, 18, offsetof(struct Start, duration),
+	{ ATF_POINTER, 19, offsetof(struct Start, duration),
 		(ASN_TAG_CLASS_CONTEXT | (19 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveReal,
@@ -669,7 +672,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"duration"
 		},
-	{ ATF_POINTER, 17, offsetof(struct Start, delaySend),
+	{ ATF_POINTER, 18, offsetof(struct Start, delaySend),
 		(ASN_TAG_CLASS_CONTEXT | (20 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveReal,
@@ -678,7 +681,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"delaySend"
 		},
-	{ ATF_POINTER, 16, offsetof(struct Start, firstMessage),
+	{ ATF_POINTER, 17, offsetof(struct Start, firstMessage),
 		(ASN_TAG_CLASS_CONTEXT | (21 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_OCTET_STRING,
@@ -687,7 +690,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"firstMessage"
 		},
-	{ ATF_POINTER, 15, offsetof(struct Start, message),
+	{ ATF_POINTER, 16, offsetof(struct Start, message),
 		(ASN_TAG_CLASS_CONTEXT | (22 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_OCTET_STRING,
@@ -696,7 +699,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"message"
 		},
-	{ ATF_POINTER, 14, offsetof(struct Start, messageFile),
+	{ ATF_POINTER, 15, offsetof(struct Start, messageFile),
 		(ASN_TAG_CLASS_CONTEXT | (23 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PrintableString,
@@ -705,7 +708,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"messageFile"
 		},
-	{ ATF_POINTER, 13, offsetof(struct Start, messageRate),
+	{ ATF_POINTER, 14, offsetof(struct Start, messageRate),
 		(ASN_TAG_CLASS_CONTEXT | (24 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveReal,
@@ -714,7 +717,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"messageRate"
 		},
-	{ ATF_POINTER, 12, offsetof(struct Start, messageStop),
+	{ ATF_POINTER, 13, offsetof(struct Start, messageStop),
 		(ASN_TAG_CLASS_CONTEXT | (25 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_OCTET_STRING,
@@ -723,7 +726,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"messageStop"
 		},
-	{ ATF_POINTER, 11, offsetof(struct Start, latencyConnect),
+	{ ATF_POINTER, 12, offsetof(struct Start, latencyConnect),
 		(ASN_TAG_CLASS_CONTEXT | (26 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_BOOLEAN,
@@ -732,7 +735,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"latencyConnect"
 		},
-	{ ATF_POINTER, 10, offsetof(struct Start, latencyFirstByte),
+	{ ATF_POINTER, 11, offsetof(struct Start, latencyFirstByte),
 		(ASN_TAG_CLASS_CONTEXT | (27 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_BOOLEAN,
@@ -741,7 +744,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"latencyFirstByte"
 		},
-	{ ATF_POINTER, 9, offsetof(struct Start, latencyMarker),
+	{ ATF_POINTER, 10, offsetof(struct Start, latencyMarker),
 		(ASN_TAG_CLASS_CONTEXT | (28 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PrintableString,
@@ -750,7 +753,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"latencyMarker"
 		},
-	{ ATF_POINTER, 8, offsetof(struct Start, latencyMarkerSkip),
+	{ ATF_POINTER, 9, offsetof(struct Start, latencyMarkerSkip),
 		(ASN_TAG_CLASS_CONTEXT | (29 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveInteger,
@@ -759,7 +762,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"latencyMarkerSkip"
 		},
-	{ ATF_POINTER, 7, offsetof(struct Start, latencyPercentiles),
+	{ ATF_POINTER, 8, offsetof(struct Start, latencyPercentiles),
 		(ASN_TAG_CLASS_CONTEXT | (30 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PrintableString,
@@ -768,7 +771,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"latencyPercentiles"
 		},
-	{ ATF_POINTER, 6, offsetof(struct Start, messageMarker),
+	{ ATF_POINTER, 7, offsetof(struct Start, messageMarker),
 		(ASN_TAG_CLASS_CONTEXT | (31 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_BOOLEAN,
@@ -777,7 +780,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"messageMarker"
 		},
-	{ ATF_POINTER, 5, offsetof(struct Start, statsd),
+	{ ATF_POINTER, 6, offsetof(struct Start, statsd),
 		(ASN_TAG_CLASS_CONTEXT | (32 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_BOOLEAN,
@@ -786,7 +789,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"statsd"
 		},
-	{ ATF_POINTER, 4, offsetof(struct Start, statsdHost),
+	{ ATF_POINTER, 5, offsetof(struct Start, statsdHost),
 		(ASN_TAG_CLASS_CONTEXT | (33 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PrintableString,
@@ -795,7 +798,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"statsdHost"
 		},
-	{ ATF_POINTER, 3, offsetof(struct Start, statsdPort),
+	{ ATF_POINTER, 4, offsetof(struct Start, statsdPort),
 		(ASN_TAG_CLASS_CONTEXT | (34 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_TcpPort,
@@ -804,7 +807,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"statsdPort"
 		},
-	{ ATF_POINTER, 2, offsetof(struct Start, statsdNamespace),
+	{ ATF_POINTER, 3, offsetof(struct Start, statsdNamespace),
 		(ASN_TAG_CLASS_CONTEXT | (35 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PrintableString,
@@ -813,7 +816,7 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"statsdNamespace"
 		},
-	{ ATF_POINTER, 1, offsetof(struct Start, statsdLatencyWindow),
+	{ ATF_POINTER, 2, offsetof(struct Start, statsdLatencyWindow),
 		(ASN_TAG_CLASS_CONTEXT | (36 << 2)),
 		-1,	/* IMPLICIT tag at current level */
 		&asn_DEF_PositiveInteger,
@@ -822,8 +825,17 @@ asn_TYPE_member_t asn_MBR_Start_1[] = {
 		0, 0, /* No default value */
 		"statsdLatencyWindow"
 		},
+	{ ATF_POINTER, 1, offsetof(struct Start, startAt),
+		(ASN_TAG_CLASS_CONTEXT | (37 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_Timestamp,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"startAt"
+		},
 };
-static const int asn_MAP_Start_oms_1[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36 };
+static const int asn_MAP_Start_oms_1[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37 };
 static const ber_tlv_tag_t asn_DEF_Start_tags_1[] = {
 	(ASN_TAG_CLASS_UNIVERSAL | (16 << 2))
 };
@@ -864,16 +876,17 @@ static const asn_TYPE_tag2member_t asn_MAP_Start_tag2el_1[] = {
     { (ASN_TAG_CLASS_CONTEXT | (33 << 2)), 33, 0, 0 }, /* statsdHost */
     { (ASN_TAG_CLASS_CONTEXT | (34 << 2)), 34, 0, 0 }, /* statsdPort */
     { (ASN_TAG_CLASS_CONTEXT | (35 << 2)), 35, 0, 0 }, /* statsdNamespace */
-    { (ASN_TAG_CLASS_CONTEXT | (36 << 2)), 36, 0, 0 } /* statsdLatencyWindow */
+    { (ASN_TAG_CLASS_CONTEXT | (36 << 2)), 36, 0, 0 }, /* statsdLatencyWindow */
+    { (ASN_TAG_CLASS_CONTEXT | (37 << 2)), 37, 0, 0 } /* startAt */
 };
 asn_SEQUENCE_specifics_t asn_SPC_Start_specs_1 = {
 	sizeof(struct Start),
 	offsetof(struct Start, _asn_ctx),
 	asn_MAP_Start_tag2el_1,
-	37,	/* Count of tags in the map */
+	38,	/* Count of tags in the map */
 	asn_MAP_Start_oms_1,	/* Optional members */
-	37, 0,	/* Root/Additions */
-	37,	/* First extension addition */
+	38, 0,	/* Root/Additions */
+	38,	/* First extension addition */
 };
 asn_TYPE_descriptor_t asn_DEF_Start = {
 	"Start",
@@ -887,7 +900,7 @@ asn_TYPE_descriptor_t asn_DEF_Start = {
 		/sizeof(asn_DEF_Start_tags_1[0]), /* 1 */
 	{ 0, 0, SEQUENCE_constraint },
 	asn_MBR_Start_1,
-	37,	/* Elements count */
+	38,	/* Elements count */
 	&asn_SPC_Start_specs_1	/* Additional specs */
 };
 
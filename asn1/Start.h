@@ -3,6 +3,9 @@
  * From ASN.1 module "TcpkaliOrchestration"
  * 	found in "TcpkaliOrchestration.asn1"
  * 	`asn1c -gen-OER -gen-PER -pdu=TcpkaliMessage`
+ *
+ * Edited by hand since, for the startAt member;
+ * asn1c was not rerun.
  */
 
 #ifndef	_Start_H_
@@ -20,6 +23,7 @@
 #include "TcpPort.h"
 #include <NativeEnumerated.h>
 #include <OCTET_STRING.h>
+#include "Timestamp.h"
 #include <constr_SEQUENCE.h>
 
 #ifdef __cplusplus
@@ -71,6 +75,7 @@ typedef struct Start {
 	TcpPort_t	*statsdPort	/* OPTIONAL */;
 	PrintableString_t	*statsdNamespace	/* OPTIONAL */;
 	PositiveInteger_t	*statsdLatencyWindow	/* OPTIONAL */;
+	Timestamp_t	*startAt	/* OPTIONAL */;
 	/*
 	 * This type is extensible,
 	 * possible extensions are below.
@@ -92,7 +97,7 @@ typedef struct Start {
 /* extern asn_TYPE_descriptor_t asn_DEF_messageRate_28;	// (Use -fall-defs-global to expose) */
 extern asn_TYPE_descriptor_t asn_DEF_Start;
 extern asn_SEQUENCE_specifics_t asn_SPC_Start_specs_1;
-extern asn_TYPE_member_t asn_MBR_Start_1[37];
+extern asn_TYPE_member_t asn_MBR_Start_1[38];
 
 #ifdef __cplusplus
 }
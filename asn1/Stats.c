@@ -0,0 +1,175 @@
+/*
+ * Written by hand, not generated: asn1c was not available when the
+ * Stats type was added to ASN.1 module "TcpkaliOrchestration"
+ * 	found in "TcpkaliOrchestration.asn1".
+ * The tables follow what asn1c-0.9.29 emits for such a type, and
+ * 	`asn1c -gen-OER -gen-PER -pdu=TcpkaliMessage`
+ * should replace this file when it is run next.
+ */
+
+#include <asn_internal.h>
+
+#include "Stats.h"
+
+asn_TYPE_member_t asn_MBR_Stats_1[] = {
+	{ ATF_NOFLAGS, 0, offsetof(struct Stats, interval),
+		(ASN_TAG_CLASS_CONTEXT | (0 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_NonNegativeReal,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"interval"
+		},
+	{ ATF_NOFLAGS, 0, offsetof(struct Stats, bytesSent),
+		(ASN_TAG_CLASS_CONTEXT | (1 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_Counter,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"bytesSent"
+		},
+	{ ATF_NOFLAGS, 0, offsetof(struct Stats, bytesReceived),
+		(ASN_TAG_CLASS_CONTEXT | (2 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_Counter,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"bytesReceived"
+		},
+	{ ATF_NOFLAGS, 0, offsetof(struct Stats, messagesSent),
+		(ASN_TAG_CLASS_CONTEXT | (3 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_Counter,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"messagesSent"
+		},
+	{ ATF_NOFLAGS, 0, offsetof(struct Stats, messagesReceived),
+		(ASN_TAG_CLASS_CONTEXT | (4 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_Counter,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"messagesReceived"
+		},
+	{ ATF_NOFLAGS, 0, offsetof(struct Stats, connectionsOpened),
+		(ASN_TAG_CLASS_CONTEXT | (5 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_Counter,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"connectionsOpened"
+		},
+	{ ATF_NOFLAGS, 0, offsetof(struct Stats, connectionsActive),
+		(ASN_TAG_CLASS_CONTEXT | (6 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_Counter,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"connectionsActive"
+		},
+	{ ATF_POINTER, 6, offsetof(struct Stats, latencyConnect),
+		(ASN_TAG_CLASS_CONTEXT | (7 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_PrintableString,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"latencyConnect"
+		},
+	{ ATF_POINTER, 5, offsetof(struct Stats, latencyFirstByte),
+		(ASN_TAG_CLASS_CONTEXT | (8 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_PrintableString,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"latencyFirstByte"
+		},
+	{ ATF_POINTER, 4, offsetof(struct Stats, latencyMarker),
+		(ASN_TAG_CLASS_CONTEXT | (9 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_PrintableString,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"latencyMarker"
+		},
+	{ ATF_POINTER, 3, offsetof(struct Stats, connectionsClosed),
+		(ASN_TAG_CLASS_CONTEXT | (10 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_Counter,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"connectionsClosed"
+		},
+	{ ATF_POINTER, 2, offsetof(struct Stats, connectionsFailed),
+		(ASN_TAG_CLASS_CONTEXT | (11 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_Counter,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"connectionsFailed"
+		},
+	{ ATF_POINTER, 1, offsetof(struct Stats, messagesLost),
+		(ASN_TAG_CLASS_CONTEXT | (12 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_Counter,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"messagesLost"
+		},
+};
+static const int asn_MAP_Stats_oms_1[] = { 7, 8, 9, 10, 11, 12 };
+static const ber_tlv_tag_t asn_DEF_Stats_tags_1[] = {
+	(ASN_TAG_CLASS_UNIVERSAL | (16 << 2))
+};
+static const asn_TYPE_tag2member_t asn_MAP_Stats_tag2el_1[] = {
+    { (ASN_TAG_CLASS_CONTEXT | (0 << 2)), 0, 0, 0 }, /* interval */
+    { (ASN_TAG_CLASS_CONTEXT | (1 << 2)), 1, 0, 0 }, /* bytesSent */
+    { (ASN_TAG_CLASS_CONTEXT | (2 << 2)), 2, 0, 0 }, /* bytesReceived */
+    { (ASN_TAG_CLASS_CONTEXT | (3 << 2)), 3, 0, 0 }, /* messagesSent */
+    { (ASN_TAG_CLASS_CONTEXT | (4 << 2)), 4, 0, 0 }, /* messagesReceived */
+    { (ASN_TAG_CLASS_CONTEXT | (5 << 2)), 5, 0, 0 }, /* connectionsOpened */
+    { (ASN_TAG_CLASS_CONTEXT | (6 << 2)), 6, 0, 0 }, /* connectionsActive */
+    { (ASN_TAG_CLASS_CONTEXT | (7 << 2)), 7, 0, 0 }, /* latencyConnect */
+    { (ASN_TAG_CLASS_CONTEXT | (8 << 2)), 8, 0, 0 }, /* latencyFirstByte */
+    { (ASN_TAG_CLASS_CONTEXT | (9 << 2)), 9, 0, 0 }, /* latencyMarker */
+    { (ASN_TAG_CLASS_CONTEXT | (10 << 2)), 10, 0, 0 }, /* connectionsClosed */
+    { (ASN_TAG_CLASS_CONTEXT | (11 << 2)), 11, 0, 0 }, /* connectionsFailed */
+    { (ASN_TAG_CLASS_CONTEXT | (12 << 2)), 12, 0, 0 } /* messagesLost */
+};
+asn_SEQUENCE_specifics_t asn_SPC_Stats_specs_1 = {
+	sizeof(struct Stats),
+	offsetof(struct Stats, _asn_ctx),
+	asn_MAP_Stats_tag2el_1,
+	13,	/* Count of tags in the map */
+	asn_MAP_Stats_oms_1,	/* Optional members */
+	6, 0,	/* Root/Additions */
+	13,	/* First extension addition */
+};
+asn_TYPE_descriptor_t asn_DEF_Stats = {
+	"Stats",
+	"Stats",
+	&asn_OP_SEQUENCE,
+	asn_DEF_Stats_tags_1,
+	sizeof(asn_DEF_Stats_tags_1)
+		/sizeof(asn_DEF_Stats_tags_1[0]), /* 1 */
+	asn_DEF_Stats_tags_1,	/* Same as above */
+	sizeof(asn_DEF_Stats_tags_1)
+		/sizeof(asn_DEF_Stats_tags_1[0]), /* 1 */
+	{ 0, 0, SEQUENCE_constraint },
+	asn_MBR_Stats_1,
+	13,	/* Elements count */
+	&asn_SPC_Stats_specs_1	/* Additional specs */
+};
@@ -0,0 +1,59 @@
+/*
+ * Written by hand, not generated: asn1c was not available when the
+ * Stats type was added to ASN.1 module "TcpkaliOrchestration"
+ * 	found in "TcpkaliOrchestration.asn1".
+ * The tables follow what asn1c-0.9.29 emits for such a type, and
+ * 	`asn1c -gen-OER -gen-PER -pdu=TcpkaliMessage`
+ * should replace this file when it is run next.
+ */
+
+#ifndef	_Stats_H_
+#define	_Stats_H_
+
+
+#include <asn_application.h>
+
+/* Including external dependencies */
+#include "NonNegativeReal.h"
+#include "Counter.h"
+#include <PrintableString.h>
+#include <constr_SEQUENCE.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Stats */
+typedef struct Stats {
+	NonNegativeReal_t	 interval;
+	Counter_t	 bytesSent;
+	Counter_t	 bytesReceived;
+	Counter_t	 messagesSent;
+	Counter_t	 messagesReceived;
+	Counter_t	 connectionsOpened;
+	Counter_t	 connectionsActive;
+	PrintableString_t	*latencyConnect	/* OPTIONAL */;
+	PrintableString_t	*latencyFirstByte	/* OPTIONAL */;
+	PrintableString_t	*latencyMarker	/* OPTIONAL */;
+	Counter_t	*connectionsClosed	/* OPTIONAL */;
+	Counter_t	*connectionsFailed	/* OPTIONAL */;
+	Counter_t	*messagesLost	/* OPTIONAL */;
+	/*
+	 * This type is extensible,
+	 * possible extensions are below.
+	 */
+	
+	/* Context for parsing across buffer boundaries */
+	asn_struct_ctx_t _asn_ctx;
+} Stats_t;
+
+/* Implementation */
+extern asn_TYPE_descriptor_t asn_DEF_Stats;
+extern asn_SEQUENCE_specifics_t asn_SPC_Stats_specs_1;
+extern asn_TYPE_member_t asn_MBR_Stats_1[13];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _Stats_H_ */
@@ -3,6 +3,9 @@
  * From ASN.1 module "TcpkaliOrchestration"
  * 	found in "TcpkaliOrchestration.asn1"
  * 	`asn1c -gen-OER -gen-PER -pdu=TcpkaliMessage`
+ *
+ * Edited by hand since, for the stats, setRateAt, setWorkers and
+ * setMessage alternatives; asn1c was not rerun.
  */
 
 #include "TcpkaliMessage.h"
@@ -42,7 +45,7 @@ static asn_oer_constraints_t asn_OER_type_TcpkaliMessage_constr_1 CC_NOTUSED = {
 	{ 0, 0 },
 	-1};
 static asn_per_constraints_t asn_PER_type_TcpkaliMessage_constr_1 CC_NOTUSED = {
-	{ APC_CONSTRAINED | APC_EXTENSIBLE,  3,  3,  0,  5 }	/* (0..5,...) */,
+	{ APC_CONSTRAINED | APC_EXTENSIBLE,  4,  4,  0,  9 }	/* (0..9,...) */,
 	{ APC_UNCONSTRAINED,	-1, -1,  0,  0 },
 	0, 0	/* No PER value map */
 };
@@ -124,6 +127,42 @@ static asn_TYPE_member_t asn_MBR_TcpkaliMessage_1[] = {
 		0, 0, /* No default value */
 		"currentRate"
 		},
+	{ ATF_NOFLAGS, 0, offsetof(struct TcpkaliMessage, choice.stats),
+		(ASN_TAG_CLASS_CONTEXT | (6 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_Stats,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"stats"
+		},
+	{ ATF_NOFLAGS, 0, offsetof(struct TcpkaliMessage, choice.setRateAt),
+		(ASN_TAG_CLASS_CONTEXT | (7 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_SetRateAt,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"setRateAt"
+		},
+	{ ATF_NOFLAGS, 0, offsetof(struct TcpkaliMessage, choice.setWorkers),
+		(ASN_TAG_CLASS_CONTEXT | (8 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_SetWorkers,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"setWorkers"
+		},
+	{ ATF_NOFLAGS, 0, offsetof(struct TcpkaliMessage, choice.setMessage),
+		(ASN_TAG_CLASS_CONTEXT | (9 << 2)),
+		-1,	/* IMPLICIT tag at current level */
+		&asn_DEF_SetMessage,
+		0,
+		{ 0, 0, 0 },
+		0, 0, /* No default value */
+		"setMessage"
+		},
 };
 static const asn_TYPE_tag2member_t asn_MAP_TcpkaliMessage_tag2el_1[] = {
     { (ASN_TAG_CLASS_CONTEXT | (0 << 2)), 0, 0, 0 }, /* start */
@@ -131,7 +170,11 @@ static const asn_TYPE_tag2member_t asn_MAP_TcpkaliMessage_tag2el_1[] = {
     { (ASN_TAG_CLASS_CONTEXT | (2 << 2)), 2, 0, 0 }, /* increaseRatePercent */
     { (ASN_TAG_CLASS_CONTEXT | (3 << 2)), 3, 0, 0 }, /* decreaseRatePercent */
     { (ASN_TAG_CLASS_CONTEXT | (4 << 2)), 4, 0, 0 }, /* setRate */
-    { (ASN_TAG_CLASS_CONTEXT | (5 << 2)), 5, 0, 0 } /* currentRate */
+    { (ASN_TAG_CLASS_CONTEXT | (5 << 2)), 5, 0, 0 }, /* currentRate */
+    { (ASN_TAG_CLASS_CONTEXT | (6 << 2)), 6, 0, 0 }, /* stats */
+    { (ASN_TAG_CLASS_CONTEXT | (7 << 2)), 7, 0, 0 }, /* setRateAt */
+    { (ASN_TAG_CLASS_CONTEXT | (8 << 2)), 8, 0, 0 }, /* setWorkers */
+    { (ASN_TAG_CLASS_CONTEXT | (9 << 2)), 9, 0, 0 } /* setMessage */
 };
 static asn_CHOICE_specifics_t asn_SPC_TcpkaliMessage_specs_1 = {
 	sizeof(struct TcpkaliMessage),
@@ -139,9 +182,9 @@ static asn_CHOICE_specifics_t asn_SPC_TcpkaliMessage_specs_1 = {
 	offsetof(struct TcpkaliMessage, present),
 	sizeof(((struct TcpkaliMessage *)0)->present),
 	asn_MAP_TcpkaliMessage_tag2el_1,
-	6,	/* Count of tags in the map */
+	10,	/* Count of tags in the map */
 	0, 0,
-	6	/* Extensions start */
+	10	/* Extensions start */
 };
 asn_TYPE_descriptor_t asn_DEF_TcpkaliMessage = {
 	"TcpkaliMessage",
@@ -153,7 +196,7 @@ asn_TYPE_descriptor_t asn_DEF_TcpkaliMessage = {
 	0,	/* No tags (count) */
 	{ &asn_OER_type_TcpkaliMessage_constr_1, &asn_PER_type_TcpkaliMessage_constr_1, CHOICE_constraint },
 	asn_MBR_TcpkaliMessage_1,
-	6,	/* Elements count */
+	10,	/* Elements count */
 	&asn_SPC_TcpkaliMessage_specs_1	/* Additional specs */
 };
 
@@ -3,6 +3,9 @@
  * From ASN.1 module "TcpkaliOrchestration"
  * 	found in "TcpkaliOrchestration.asn1"
  * 	`asn1c -gen-OER -gen-PER -pdu=TcpkaliMessage`
+ *
+ * Edited by hand since, for the stats, setRateAt, setWorkers and
+ * setMessage alternatives; asn1c was not rerun.
  */
 
 #ifndef	_TcpkaliMessage_H_
@@ -18,6 +21,10 @@
 #include "DecreaseRatePercent.h"
 #include "SetRate.h"
 #include "CurrentRate.h"
+#include "Stats.h"
+#include "SetRateAt.h"
+#include "SetWorkers.h"
+#include "SetMessage.h"
 #include <constr_CHOICE.h>
 
 #ifdef __cplusplus
@@ -32,7 +39,11 @@ typedef enum TcpkaliMessage_PR {
 	TcpkaliMessage_PR_increaseRatePercent,
 	TcpkaliMessage_PR_decreaseRatePercent,
 	TcpkaliMessage_PR_setRate,
-	TcpkaliMessage_PR_currentRate
+	TcpkaliMessage_PR_currentRate,
+	TcpkaliMessage_PR_stats,
+	TcpkaliMessage_PR_setRateAt,
+	TcpkaliMessage_PR_setWorkers,
+	TcpkaliMessage_PR_setMessage
 	/* Extensions may appear below */
 	
 } TcpkaliMessage_PR;
@@ -47,6 +58,10 @@ typedef struct TcpkaliMessage {
 		DecreaseRatePercent_t	 decreaseRatePercent;
 		SetRate_t	 setRate;
 		CurrentRate_t	 currentRate;
+		Stats_t	 stats;
+		SetRateAt_t	 setRateAt;
+		SetWorkers_t	 setWorkers;
+		SetMessage_t	 setMessage;
 		/*
 		 * This type is extensible,
 		 * possible extensions are below.
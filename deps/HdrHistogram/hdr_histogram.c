@@ -618,6 +618,18 @@ struct hdr_histogram *hdr_diff(struct hdr_histogram *base, struct hdr_histogram
     }
 }
 
+void hdr_subtract(struct hdr_histogram *update, const struct hdr_histogram *base) {
+    assert(update->lowest_trackable_value == base->lowest_trackable_value);
+    assert(update->highest_trackable_value == base->highest_trackable_value);
+    assert(update->significant_figures == base->significant_figures);
+
+    for(int32_t ct = 0; ct < update->counts_len; ct++) {
+        update->counts[ct] -= base->counts[ct];
+    }
+    update->total_count -= base->total_count;
+    hdr_reset_internal_counters(update);    /* Re-sets min and max */
+}
+
 
 // ##     ##    ###    ##       ##     ## ########  ######
 // ##     ##   ## ##   ##       ##     ## ##       ##    ##
@@ -147,6 +147,11 @@ int64_t hdr_add(struct hdr_histogram* h, struct hdr_histogram* from);
  */
 struct hdr_histogram *hdr_diff(struct hdr_histogram *base, struct hdr_histogram *update);
 
+/*
+ * Turn 'update' into the delta between 'base' and 'update', in place.
+ */
+void hdr_subtract(struct hdr_histogram *update, const struct hdr_histogram *base);
+
 int64_t hdr_min(struct hdr_histogram* h);
 int64_t hdr_max(struct hdr_histogram* h);
 int64_t hdr_value_at_percentile(struct hdr_histogram* h, double percentile);
@@ -46,8 +46,9 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 //Define the private functions
 static const char *networkToPresentation(int af, const void *src, char *dst, size_t size);
 static int sendToServer(Statsd* stats, const char* bucket, StatsType type, int64_t delta, double sampleRate);
-static ssize_t buildStatString(char* stat, size_t stat_size, const char* nameSpace, const char* bucket, StatsType type, int64_t delta, double sampleRate);
-static ssize_t buildStatString_dbl(char* stat, size_t stat_size, const char* nameSpace, const char* bucket, StatsType type, double delta, double sampleRate);
+static ssize_t buildStatString(char* stat, size_t stat_size, const char* nameSpace, const char* bucket, StatsType type, int64_t delta, double sampleRate, const char* tags, const char* moreTags);
+static ssize_t buildStatString_dbl(char* stat, size_t stat_size, const char* nameSpace, const char* bucket, StatsType type, double delta, double sampleRate, const char* tags, const char* moreTags);
+static ssize_t buildStatSuffix(char* suffix, size_t suffix_size, StatsType type, double sampleRate, const char* tags, const char* moreTags);
 
 static const char *networkToPresentation(int af, const void *src, char *dst, size_t size){
    return inet_ntop(af, src, dst, size);
@@ -83,7 +84,7 @@ static int sendToServer(Statsd* stats, const char* bucket, StatsType type, int64
       bucket = stats->bucket;
    }
    
-   dataLength = buildStatString(data, sizeof(data), stats->nameSpace, bucket, type, delta, sampleRate);
+   dataLength = buildStatString(data, sizeof(data), stats->nameSpace, bucket, type, delta, sampleRate, stats->tags, NULL);
    if (dataLength < 0) {
       return -1;
    }
@@ -99,19 +100,18 @@ static int sendToServer(Statsd* stats, const char* bucket, StatsType type, int64
 }
 
 /**
-   This is a helper function that will build up a stats string and return its
-   length. 
+   This is a helper function that will build up the part of the stats string
+   which follows the value: the type, the sample rate and the DogStatsD tags.
 
-   @param[in,out] stat - This is where the final string will be placed
-   @param[in] nameSpace - The namespace of the stat
-   @param[in] bucket - The bucket where to put the stat
+   @param[in,out] suffix - This is where the suffix will be placed
    @param[in] type - The type of stat being packed
-   @param[in] delta - The value of the stat
    @param[in] sampleRate - The intervals at which this data was gathered
+   @param[in] tags - Optional comma separated tags
+   @param[in] moreTags - Optional tags specific to this stat
 
-   @return The length of the stat string, or -1 on error
+   @return The length of the suffix, or -1 on error
 */
-static ssize_t buildStatString(char* stat, size_t stat_size, const char* nameSpace, const char* bucket, StatsType type, int64_t delta, double sampleRate){
+static ssize_t buildStatSuffix(char* suffix, size_t suffix_size, StatsType type, double sampleRate, const char* tags, const char* moreTags){
    char* statType = NULL;
 
    //Figure out what type of message to generate
@@ -132,17 +132,52 @@ static ssize_t buildStatString(char* stat, size_t stat_size, const char* nameSpa
          return -STATSD_BAD_STATS_TYPE;
    }
 
+   if (tags && !*tags) tags = NULL;
+   if (moreTags && !*moreTags) moreTags = NULL;
+
    //Do we have a sample rate?
-   int resulting_size;
+   char rate[16] = "";
    if (sampleRate > 0.0 && sampleRate < 1.0) {
-      resulting_size = snprintf(stat, stat_size, "%s%s%s:%"PRId64"|%s|@%.2f\n",
-            nameSpace ? nameSpace : "", nameSpace ? "." : "",
-            bucket, delta, statType, sampleRate);
-   } else {
-      resulting_size = snprintf(stat, stat_size, "%s%s%s:%"PRId64"|%s\n",
-            nameSpace ? nameSpace : "", nameSpace ? "." : "",
-            bucket, delta, statType);
+      snprintf(rate, sizeof(rate), "|@%.2f", sampleRate);
+   }
+
+   int resulting_size = snprintf(suffix, suffix_size, "|%s%s%s%s%s%s\n",
+         statType, rate,
+         (tags || moreTags) ? "|#" : "",
+         tags ? tags : "",
+         (tags && moreTags) ? "," : "",
+         moreTags ? moreTags : "");
+   if(resulting_size < 0 || (size_t)resulting_size >= suffix_size) {
+       return -1;
+   }
+
+   return resulting_size;
+}
+
+/**
+   This is a helper function that will build up a stats string and return its
+   length. 
+
+   @param[in,out] stat - This is where the final string will be placed
+   @param[in] nameSpace - The namespace of the stat
+   @param[in] bucket - The bucket where to put the stat
+   @param[in] type - The type of stat being packed
+   @param[in] delta - The value of the stat
+   @param[in] sampleRate - The intervals at which this data was gathered
+   @param[in] tags, moreTags - Optional DogStatsD tags
+
+   @return The length of the stat string, or -1 on error
+*/
+static ssize_t buildStatString(char* stat, size_t stat_size, const char* nameSpace, const char* bucket, StatsType type, int64_t delta, double sampleRate, const char* tags, const char* moreTags){
+   char suffix[512];
+   ssize_t suffix_size = buildStatSuffix(suffix, sizeof(suffix), type, sampleRate, tags, moreTags);
+   if (suffix_size < 0) {
+      return suffix_size;
    }
+
+   int resulting_size = snprintf(stat, stat_size, "%s%s%s:%"PRId64"%s",
+         nameSpace ? nameSpace : "", nameSpace ? "." : "",
+         bucket, delta, suffix);
    if(resulting_size >= stat_size) {
        if(stat_size >= 1)
            stat[0] = '\0';
@@ -152,41 +187,19 @@ static ssize_t buildStatString(char* stat, size_t stat_size, const char* nameSpa
    return resulting_size;
 }
 
-static ssize_t buildStatString_dbl(char* stat, size_t stat_size, const char* nameSpace, const char* bucket, StatsType type, double delta, double sampleRate){
-   char* statType = NULL;
-
+static ssize_t buildStatString_dbl(char* stat, size_t stat_size, const char* nameSpace, const char* bucket, StatsType type, double delta, double sampleRate, const char* tags, const char* moreTags){
     if(!isfinite(delta))
         return 0;
 
-   //Figure out what type of message to generate
-   switch(type){
-      case STATSD_COUNT:
-         statType = "c";
-         break;
-      case STATSD_GAUGE:
-         statType = "g";
-         break;
-      case STATSD_SET:
-         statType = "s";
-         break;
-      case STATSD_TIMING:
-         statType = "ms";
-         break;
-      default:
-         return -STATSD_BAD_STATS_TYPE;
+   char suffix[512];
+   ssize_t suffix_size = buildStatSuffix(suffix, sizeof(suffix), type, sampleRate, tags, moreTags);
+   if (suffix_size < 0) {
+      return suffix_size;
    }
 
-   //Do we have a sample rate?
-   int resulting_size;
-   if (sampleRate > 0.0 && sampleRate < 1.0) {
-      resulting_size = snprintf(stat, stat_size, "%s%s%s:%.1f|%s|@%.2f\n",
-            nameSpace ? nameSpace : "", nameSpace ? "." : "",
-            bucket, delta, statType, sampleRate);
-   } else {
-      resulting_size = snprintf(stat, stat_size, "%s%s%s:%.1f|%s\n",
-            nameSpace ? nameSpace : "", nameSpace ? "." : "",
-            bucket, delta, statType);
-   }
+   int resulting_size = snprintf(stat, stat_size, "%s%s%s:%.1f%s",
+         nameSpace ? nameSpace : "", nameSpace ? "." : "",
+         bucket, delta, suffix);
    if(resulting_size >= stat_size) {
        if(stat_size >= 1)
            stat[0] = '\0';
@@ -291,6 +304,9 @@ int ADDCALL statsd_init(Statsd* statsd, const char* server, int port, const char
    statsd->nameSpace = nameSpace;
    statsd->bucket = bucket;
    statsd->random = rand;
+   if (statsd->batchSize <= 0 || statsd->batchSize > BATCH_MAX_SIZE){
+      statsd->batchSize = BATCH_DEFAULT_SIZE;
+   }
 
    //Free the result now that we have copied the data out of it.
    freeaddrinfo(result);
@@ -453,6 +469,19 @@ int ADDCALL statsd_resetBatch(Statsd* statsd){
    @return STATSD_SUCCESS if everything was successful. 
 */
 int ADDCALL statsd_addToBatch(Statsd* statsd, StatsType type, const char* bucket, int64_t value, double sampleRate){
+    return statsd_addToBatch_tags(statsd, type, bucket, value, sampleRate, NULL);
+}
+
+/**
+   Add stats with DogStatsD tags to the batch buffer to be sent later.
+   The tags are added to the ones set by statsd_setTags().
+
+   @param[in] tags - Comma separated tags, such as "key:value,key2:value2"
+
+   @return STATSD_SUCCESS if everything was successful.
+   @see statsd_addToBatch
+*/
+int ADDCALL statsd_addToBatch_tags(Statsd* statsd, StatsType type, const char* bucket, int64_t value, double sampleRate, const char* tags){
     //See if we randomly fall under the sample rate
     if (sampleRate > 0 && sampleRate < 1 && (double)((double)statsd->random() / RAND_MAX) >= sampleRate){
         return STATSD_SUCCESS;
@@ -463,8 +492,9 @@ int ADDCALL statsd_addToBatch(Statsd* statsd, StatsType type, const char* bucket
     }
 
     ssize_t strLength = buildStatString(statsd->batch + statsd->batchIndex,
-                            sizeof(statsd->batch) - statsd->batchIndex,
-                            statsd->nameSpace, bucket, type, value, sampleRate);
+                            statsd->batchSize - statsd->batchIndex,
+                            statsd->nameSpace, bucket, type, value, sampleRate,
+                            statsd->tags, tags);
     if (strLength < 0) {
         return STATSD_BATCH_FULL;
     }
@@ -475,6 +505,10 @@ int ADDCALL statsd_addToBatch(Statsd* statsd, StatsType type, const char* bucket
 }
 
 int ADDCALL statsd_addToBatch_dbl(Statsd* statsd, StatsType type, const char* bucket, double value, double sampleRate){
+    return statsd_addToBatch_dbl_tags(statsd, type, bucket, value, sampleRate, NULL);
+}
+
+int ADDCALL statsd_addToBatch_dbl_tags(Statsd* statsd, StatsType type, const char* bucket, double value, double sampleRate, const char* tags){
     //See if we randomly fall under the sample rate
     if (sampleRate > 0 && sampleRate < 1 && (double)((double)statsd->random() / RAND_MAX) >= sampleRate){
         return STATSD_SUCCESS;
@@ -485,8 +519,9 @@ int ADDCALL statsd_addToBatch_dbl(Statsd* statsd, StatsType type, const char* bu
     }
 
     ssize_t strLength = buildStatString_dbl(statsd->batch + statsd->batchIndex,
-                            sizeof(statsd->batch) - statsd->batchIndex,
-                            statsd->nameSpace, bucket, type, value, sampleRate);
+                            statsd->batchSize - statsd->batchIndex,
+                            statsd->nameSpace, bucket, type, value, sampleRate,
+                            statsd->tags, tags);
     if (strLength < 0) {
         return STATSD_BATCH_FULL;
     }
@@ -519,3 +554,35 @@ int ADDCALL statsd_sendBatch(Statsd* statsd){
    return STATSD_SUCCESS;
 }
 
+/**
+   Limit the size of the batch datagrams. Use the path MTU minus the IP
+   and UDP headers to pack as many stats per datagram as possible
+   without fragmentation.
+
+   @param[in] statsd - The statsd client object
+   @param[in] size - The datagram payload size, up to BATCH_MAX_SIZE
+
+   @return STATSD_SUCCESS, or STATSD_BATCH_IN_PROGRESS if the batch
+      is not empty, or STATSD_BATCH_FULL if the size is not supported.
+*/
+int ADDCALL statsd_setBatchSize(Statsd* statsd, int size){
+   if (statsd->batchIndex > 0){
+      return STATSD_BATCH_IN_PROGRESS;
+   }
+   if (size <= 0 || size > BATCH_MAX_SIZE){
+      return STATSD_BATCH_FULL;
+   }
+   statsd->batchSize = size;
+   return STATSD_SUCCESS;
+}
+
+/**
+   Set the DogStatsD tags which are added to every stat.
+   The string is not copied.
+
+   @param[in] statsd - The statsd client object
+   @param[in] tags - Comma separated tags, or NULL
+*/
+void ADDCALL statsd_setTags(Statsd* statsd, const char* tags){
+   statsd->tags = tags;
+}
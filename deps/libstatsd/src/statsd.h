@@ -56,8 +56,9 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 #define STATSD_PORT 8125
 #define NO_SAMPLE_RATE 0
 #ifndef BATCH_MAX_SIZE
-#define BATCH_MAX_SIZE 512
+#define BATCH_MAX_SIZE 65507 /* Largest UDP payload */
 #endif
+#define BATCH_DEFAULT_SIZE 512
 
 typedef struct _statsd_t {
    const char* serverAddress;
@@ -70,8 +71,11 @@ typedef struct _statsd_t {
    
    int (*random)(void);
 
+   const char* tags; /* DogStatsD tags added to every stat */
+
    char batch[BATCH_MAX_SIZE];
    int batchIndex;
+   int batchSize; /* Datagram size limit, up to BATCH_MAX_SIZE */
 } Statsd;
 
 typedef enum {
@@ -115,7 +119,11 @@ ADDAPI int ADDCALL statsd_timing(Statsd* statsd, const char* bucket, int timing,
 ADDAPI int ADDCALL statsd_resetBatch(Statsd* statsd);
 ADDAPI int ADDCALL statsd_addToBatch(Statsd* statsd, StatsType type, const char* bucket, int64_t value, double sampleRate);
 ADDAPI int ADDCALL statsd_addToBatch_dbl(Statsd* statsd, StatsType type, const char* bucket, double value, double sampleRate);
+ADDAPI int ADDCALL statsd_addToBatch_tags(Statsd* statsd, StatsType type, const char* bucket, int64_t value, double sampleRate, const char* tags);
+ADDAPI int ADDCALL statsd_addToBatch_dbl_tags(Statsd* statsd, StatsType type, const char* bucket, double value, double sampleRate, const char* tags);
 ADDAPI int ADDCALL statsd_sendBatch(Statsd* statsd);
+ADDAPI int ADDCALL statsd_setBatchSize(Statsd* statsd, int size);
+ADDAPI void ADDCALL statsd_setTags(Statsd* statsd, const char* tags);
 
 #ifdef __cplusplus
 }
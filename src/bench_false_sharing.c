@@ -0,0 +1,103 @@
+/*
+ * A contention benchmark: the worker threads are bumping their own counters
+ * and private fields, while the main thread keeps polling the counters,
+ * as engine_get_connection_stats() does. The per-worker structures are
+ * laid out either packed next to each other or CACHE_LINE_ALIGNED.
+ * Build with `make -C src bench_false_sharing`.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "tcpkali_atomic.h"
+
+#define ITERATIONS 10000000
+
+struct packed_worker {
+    atomic_narrow_t counter; /* Polled by the main thread */
+    volatile long private_field; /* Only touched by the worker */
+};
+
+struct padded_worker {
+    volatile long private_field;
+    atomic_narrow_t counter CACHE_LINE_ALIGNED;
+} CACHE_LINE_ALIGNED;
+
+struct run {
+    atomic_narrow_t *counter;
+    volatile long *private_field;
+};
+
+static void *
+worker(void *arg) {
+    struct run *run = arg;
+    for(int i = 0; i < ITERATIONS; i++) {
+        (*run->private_field)++;
+        if((i & 15) == 0) atomic_increment(run->counter);
+    }
+    return NULL;
+}
+
+static double
+benchmark(int n_workers, struct run *runs) {
+    pthread_t threads[n_workers];
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(int i = 0; i < n_workers; i++)
+        pthread_create(&threads[i], NULL, worker, &runs[i]);
+
+    /* Poll until all workers are done. */
+    for(;;) {
+        non_atomic_narrow_t total = 0;
+        for(int i = 0; i < n_workers; i++) total += atomic_get(runs[i].counter);
+        if(total == (non_atomic_narrow_t)n_workers * (ITERATIONS / 16)) break;
+    }
+
+    for(int i = 0; i < n_workers; i++) pthread_join(threads[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int
+main() {
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int n_workers = ncpus > 4 ? 4 : (ncpus < 2 ? 2 : ncpus);
+
+    assert(sizeof(struct padded_worker) % CACHE_LINE_SIZE == 0);
+
+    struct packed_worker packed[n_workers];
+    struct padded_worker *padded;
+    int rc = posix_memalign((void **)&padded, CACHE_LINE_SIZE,
+                            n_workers * sizeof(*padded));
+    assert(rc == 0);
+
+    struct run runs[n_workers];
+    for(int i = 0; i < n_workers; i++) {
+        packed[i].counter = (atomic_narrow_t){0};
+        packed[i].private_field = 0;
+        runs[i].counter = &packed[i].counter;
+        runs[i].private_field = &packed[i].private_field;
+    }
+    double packed_time = benchmark(n_workers, runs);
+
+    for(int i = 0; i < n_workers; i++) {
+        padded[i].counter = (atomic_narrow_t){0};
+        padded[i].private_field = 0;
+        runs[i].counter = &padded[i].counter;
+        runs[i].private_field = &padded[i].private_field;
+    }
+    double padded_time = benchmark(n_workers, runs);
+
+    printf("%d workers, %d iterations each: packed %.3fs, padded %.3fs\n",
+           n_workers, ITERATIONS, packed_time, padded_time);
+
+    free(padded);
+    return 0;
+}
@@ -0,0 +1,592 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Microbenchmarks of the per-message hot paths, measured in isolation:
+ *   expr   eval_expression() of a per-message -m expression
+ *   regex  tregex_eval_rng() of a \{re ...} generator
+ *   sbmh   sbmh_feed() looking for a --latency-marker in the stream
+ *   ring   ring_buffer_add()/ring_buffer_get() of the send timestamps
+ *   tsring ts_ring_push()/ts_ring_pop_elapsed() of the send ticks
+ *   conn   an I/O event on one of many struct connection, touching
+ *          the hot fields the write path uses
+ *   conn-inline  the same, with the connection_cold placed right after
+ *          each connection, as if the structure were not split
+ * Each kernel is run a few times; the best run is reported in cycles
+ * (the CPU timestamp counter, where available) and nanoseconds per op,
+ * along with the cache misses per op where perf_event_open(2) permits.
+ * Build with `make -C src bench_hotpaths`.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <time.h>
+#include <sysexits.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include <pcg_basic.h>
+#include <StreamBoyerMooreHorspool.h>
+
+#include "tcpkali_common.h"
+#include "tcpkali_expr.h"
+#include "tcpkali_regex.h"
+#include "tcpkali_ring.h"
+#include "tcpkali_connection.h"
+
+#define DEFAULT_EXPRESSION                                    \
+    "GET /\\{re [a-z]{4,12}}?uid=\\{connection.uid} HTTP/1.1\\r\\n" \
+    "Host: localhost\\r\\n\\r\\n\\{message.marker}"
+#define DEFAULT_REGEX "[a-z0-9]{16,64}"
+#define DEFAULT_NEEDLE "HTTP/1.1 200 OK"
+
+struct bench_config {
+    const char *expression;
+    const char *regex;
+    const char *needle;
+    size_t haystack_size; /* sbmh: bytes between the needles */
+    size_t chunk_size;    /* sbmh: bytes per sbmh_feed() */
+    size_t ring_depth;    /* ring, tsring: elements kept in flight */
+    size_t connections;   /* conn: number of connections to go over */
+    long iterations;
+    int repeats;
+};
+
+/*
+ * Read the timestamp counter, or the nanosecond clock on the platforms
+ * without a cheap one.
+ */
+static inline uint64_t
+cycles_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ __volatile__("lfence; rdtsc" : "=a"(lo), "=d"(hi)::"memory");
+    return ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+    uint64_t v;
+    __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(v)::"memory");
+    return v;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static double
+seconds_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * A kernel runs (iterations) operations and returns the number
+ * of bytes processed, if that makes sense for it.
+ */
+typedef size_t(kernel_f)(void *state, long iterations);
+
+static volatile size_t sink; /* Keeps the results alive */
+
+/*
+ * The hardware cache miss counter of this thread, or -1 if the kernel
+ * does not let us have one (see perf_event_paranoid).
+ */
+static int
+cache_misses_open(void) {
+#if defined(__linux__) && defined(SYS_perf_event_open)
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static uint64_t
+cache_misses_now(int fd) {
+    uint64_t v = 0;
+    if(fd == -1 || read(fd, &v, sizeof(v)) != sizeof(v)) return 0;
+    return v;
+}
+
+static void
+report(const char *name, kernel_f *kernel, void *state,
+       const struct bench_config *cfg) {
+    static int misses_fd = -2;
+    double best_cycles = 0, best_ns = 0, best_misses = 0;
+    size_t bytes = 0;
+
+    if(misses_fd == -2) misses_fd = cache_misses_open();
+
+    kernel(state, cfg->iterations / 10 + 1); /* Warm up */
+
+    for(int r = 0; r < cfg->repeats; r++) {
+        double started = seconds_now();
+        uint64_t m0 = cache_misses_now(misses_fd);
+        uint64_t c0 = cycles_now();
+        bytes = kernel(state, cfg->iterations);
+        uint64_t c1 = cycles_now();
+        uint64_t m1 = cache_misses_now(misses_fd);
+        double ns = (seconds_now() - started) * 1e9 / cfg->iterations;
+        double cycles = (double)(c1 - c0) / cfg->iterations;
+        double misses = (double)(m1 - m0) / cfg->iterations;
+        if(r == 0 || ns < best_ns) best_ns = ns;
+        if(r == 0 || cycles < best_cycles) best_cycles = cycles;
+        if(r == 0 || misses < best_misses) best_misses = misses;
+    }
+    sink += bytes;
+
+    printf("%-11s %12ld ops %10.1f cycles/op %10.1f ns/op", name,
+           cfg->iterations, best_cycles, best_ns);
+    if(misses_fd != -1) printf(" %8.2f misses/op", best_misses);
+    if(bytes) {
+        printf(" %10.1f MB/s",
+               (bytes / (double)cfg->iterations) / best_ns * 1000.0);
+    }
+    printf("\n");
+}
+
+/*
+ * eval_expression()
+ */
+struct expr_state {
+    tk_expr_t *expr;
+    char *buf;
+    size_t size;
+    pcg32_random_t rng;
+};
+
+/* Stands in for the engine's callback, producing similarly sized values. */
+static ssize_t
+bench_expr_callback(char *buf, size_t size, tk_expr_t *expr,
+                    void UNUSED *key, long *v) {
+    static const char marker[] = "ObservedMarker0000000000000000.";
+    ssize_t s;
+
+    switch(expr->type) {
+    case EXPR_MESSAGE_MARKER:
+        s = sizeof(marker) - 1;
+        if(size < (size_t)s) return -1;
+        memcpy(buf, marker, s);
+        break;
+    default:
+        s = snprintf(buf, size, "%d", 12345);
+        break;
+    }
+    if(v) *v = 12345;
+    if(s < 0 || s > (ssize_t)size) return -1;
+    return s;
+}
+
+static size_t
+expr_kernel(void *arg, long iterations) {
+    struct expr_state *st = arg;
+    size_t bytes = 0;
+    for(long i = 0; i < iterations; i++) {
+        ssize_t s = eval_expression(&st->buf, st->size, st->expr,
+                                    bench_expr_callback, NULL, NULL, 1,
+                                    &st->rng);
+        assert(s >= 0);
+        bytes += s;
+    }
+    return bytes;
+}
+
+static tk_expr_t *
+parse_or_die(const char *str) {
+    tk_expr_t *expr = NULL;
+    if(parse_expression(&expr, str, strlen(str), 0) == -1) {
+        fprintf(stderr, "Cannot parse expression \"%s\"\n", str);
+        exit(EX_USAGE);
+    }
+    unescape_expression(expr);
+    return expr;
+}
+
+static void
+bench_expr(const struct bench_config *cfg) {
+    struct expr_state st;
+    st.expr = parse_or_die(cfg->expression);
+    compile_expression(st.expr);
+    st.size = st.expr->estimate_size + 4096;
+    st.buf = malloc(st.size);
+    assert(st.buf);
+    pcg32_srandom_r(&st.rng, 42, 54);
+    report("expr", expr_kernel, &st, cfg);
+    free(st.buf);
+    free_expression(st.expr, 1);
+}
+
+/*
+ * tregex_eval_rng()
+ */
+struct regex_state {
+    tregex *re;
+    char *buf;
+    size_t size;
+    pcg32_random_t rng;
+};
+
+static size_t
+regex_kernel(void *arg, long iterations) {
+    struct regex_state *st = arg;
+    size_t bytes = 0;
+    for(long i = 0; i < iterations; i++) {
+        ssize_t s = tregex_eval_rng(st->re, st->buf, st->size, &st->rng);
+        assert(s >= 0);
+        bytes += s;
+    }
+    return bytes;
+}
+
+static void
+bench_regex(const struct bench_config *cfg) {
+    char str[strlen(cfg->regex) + sizeof("\\{re }")];
+    snprintf(str, sizeof(str), "\\{re %s}", cfg->regex);
+    tk_expr_t *expr = parse_or_die(str);
+    if(expr->type != EXPR_REGEX) {
+        fprintf(stderr, "Not a single regular expression: \"%s\"\n",
+                cfg->regex);
+        exit(EX_USAGE);
+    }
+
+    struct regex_state st;
+    st.re = expr->u.regex.re;
+    st.size = tregex_max_size(st.re) + 1;
+    st.buf = malloc(st.size);
+    assert(st.buf);
+    pcg32_srandom_r(&st.rng, 42, 54);
+    report("regex", regex_kernel, &st, cfg);
+    free(st.buf);
+    free_expression(expr, 1);
+}
+
+/*
+ * sbmh_feed(): every operation scans a haystack ending with the needle.
+ */
+struct sbmh_state {
+    struct StreamBMH *ctx;
+    struct StreamBMH_Occ occ;
+    const unsigned char *needle;
+    size_t needle_len;
+    unsigned char *haystack;
+    size_t haystack_size;
+    size_t chunk_size;
+};
+
+static size_t
+sbmh_kernel(void *arg, long iterations) {
+    struct sbmh_state *st = arg;
+    for(long i = 0; i < iterations; i++) {
+        sbmh_reset(st->ctx);
+        for(size_t off = 0; off < st->haystack_size && !st->ctx->found;) {
+            size_t len = st->haystack_size - off;
+            if(len > st->chunk_size) len = st->chunk_size;
+            off += sbmh_feed(st->ctx, &st->occ, st->needle, st->needle_len,
+                             st->haystack + off, len);
+        }
+        assert(st->ctx->found);
+    }
+    return (size_t)iterations * st->haystack_size;
+}
+
+static void
+bench_sbmh(const struct bench_config *cfg) {
+    struct sbmh_state st;
+    st.needle = (const unsigned char *)cfg->needle;
+    st.needle_len = strlen(cfg->needle);
+    if(st.needle_len == 0 || st.needle_len > cfg->haystack_size) {
+        fprintf(stderr, "The needle must fit the %zu bytes haystack\n",
+                cfg->haystack_size);
+        exit(EX_USAGE);
+    }
+    st.ctx = malloc(SBMH_SIZE(st.needle_len));
+    assert(st.ctx);
+    sbmh_init(st.ctx, &st.occ, st.needle, st.needle_len);
+
+    /* Printable noise, which does not contain the needle. */
+    st.haystack_size = cfg->haystack_size;
+    st.chunk_size = cfg->chunk_size ? cfg->chunk_size : st.haystack_size;
+    st.haystack = malloc(st.haystack_size);
+    assert(st.haystack);
+    pcg32_random_t rng;
+    pcg32_srandom_r(&rng, 42, 54);
+    for(size_t i = 0; i < st.haystack_size; i++)
+        st.haystack[i] = 'a' + pcg32_boundedrand_r(&rng, 26);
+    memcpy(st.haystack + st.haystack_size - st.needle_len, st.needle,
+           st.needle_len);
+
+    report("sbmh", sbmh_kernel, &st, cfg);
+    free(st.haystack);
+    free(st.ctx);
+}
+
+/*
+ * ring_buffer_add() and ring_buffer_get() of a ring kept at a depth.
+ */
+struct ring_state {
+    struct ring_buffer *rb;
+    struct ts_ring *tr;
+    size_t depth;
+};
+
+static size_t
+ring_kernel(void *arg, long iterations) {
+    struct ring_state *st = arg;
+    double d = 0.0, sum = 0.0;
+    for(long i = 0; i < iterations; i++) {
+        ring_buffer_add(st->rb, (double)i);
+        int got = ring_buffer_get(st->rb, &d);
+        assert(got);
+        sum += d;
+    }
+    sink += (size_t)sum;
+    return 0;
+}
+
+static size_t
+tsring_kernel(void *arg, long iterations) {
+    struct ring_state *st = arg;
+    uint32_t sum = 0;
+    for(long i = 0; i < iterations; i++) {
+        ts_ring_push(st->tr, (uint32_t)i);
+        sum += ts_ring_pop_elapsed(st->tr, (uint32_t)i + 1);
+    }
+    sink += sum;
+    return 0;
+}
+
+static void
+bench_rings(const struct bench_config *cfg, int ring, int tsring) {
+    struct ring_state st;
+    st.depth = cfg->ring_depth;
+
+    if(ring) {
+        st.rb = ring_buffer_new(sizeof(double));
+        for(size_t i = 0; i < st.depth; i++) ring_buffer_add(st.rb, 0.0);
+        report("ring", ring_kernel, &st, cfg);
+        ring_buffer_free(st.rb);
+    }
+
+    if(tsring) {
+        st.tr = ts_ring_new(NULL, st.depth + 1, 0.0);
+        for(size_t i = 0; i < st.depth; i++) ts_ring_push(st.tr, 0);
+        report("tsring", tsring_kernel, &st, cfg);
+        ts_ring_free(NULL, st.tr);
+    }
+}
+
+/*
+ * An I/O event on a connection picked out of many, touching what
+ * connection_cb() and its write path do on every event.
+ */
+struct conns_state {
+    char *memory;
+    size_t stride; /* From one struct connection to the next */
+    size_t count;
+    uint32_t lcg;
+};
+
+static size_t
+conn_kernel(void *arg, long iterations) {
+    struct conns_state *st = arg;
+    uint32_t x = st->lcg;
+    size_t bytes = 0;
+    for(long i = 0; i < iterations; i++) {
+        x = x * 1664525 + 1013904223;
+        struct connection *conn =
+            (void *)(st->memory
+                     + st->stride * (((uint64_t)x * st->count) >> 32));
+        if(conn->conn_wish & CW_WRITE_INTEREST) {
+            size_t available = conn->data.total_size - conn->write_offset;
+            size_t wrote = available < conn->send_limit.minimal_move_size
+                               ? available
+                               : conn->send_limit.minimal_move_size;
+            conn->write_offset += wrote;
+            if((size_t)conn->write_offset == conn->data.total_size)
+                conn->write_offset = conn->data.once_size;
+            conn->send_pace.previous_ts += conn->send_jitter;
+            conn->traffic_ongoing.bytes_sent += wrote;
+            conn->traffic_ongoing.num_writes++;
+            bytes += wrote;
+        }
+        conn->stats_dirty = 1;
+    }
+    st->lcg = x;
+    sink += bytes;
+    return 0;
+}
+
+static void
+bench_conn(const struct bench_config *cfg, int inline_cold) {
+    struct conns_state st;
+    st.count = cfg->connections;
+    st.stride = sizeof(struct connection);
+    if(inline_cold) st.stride += sizeof(struct connection_cold);
+    st.stride = (st.stride + CONNECTION_ALIGNMENT - 1)
+                & ~(size_t)(CONNECTION_ALIGNMENT - 1);
+    st.lcg = 42;
+
+    char *cold = NULL;
+    if(posix_memalign((void **)&st.memory, CONNECTION_ALIGNMENT,
+                      st.stride * st.count)
+       != 0)
+        st.memory = NULL;
+    if(!inline_cold)
+        cold = calloc(st.count, sizeof(struct connection_cold));
+    assert(st.memory && (inline_cold || cold));
+    memset(st.memory, 0, st.stride * st.count);
+
+    for(size_t i = 0; i < st.count; i++) {
+        struct connection *conn = (void *)(st.memory + st.stride * i);
+        conn->cold = inline_cold
+                         ? (void *)((char *)conn + sizeof(*conn))
+                         : (void *)(cold
+                                    + i * sizeof(struct connection_cold));
+        conn->conn_wish = CW_READ_INTEREST | CW_WRITE_INTEREST;
+        conn->data.once_size = 0;
+        conn->data.total_size = 16384;
+        conn->send_limit.minimal_move_size = 1460;
+    }
+
+    report(inline_cold ? "conn-inline" : "conn", conn_kernel, &st, cfg);
+    free(st.memory);
+    free(cold);
+}
+
+static void
+usage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s [OPTIONS]\n"
+            "       [expr|regex|sbmh|ring|tsring|conn|conn-inline...]\n"
+            "Where OPTIONS are:\n"
+            "  -n <N>        Operations per run (default 1000000)\n"
+            "  -R <N>        Runs of each kernel, the best one is shown "
+            "(default 5)\n"
+            "  -e <string>   Expression for expr (default \"%s\")\n"
+            "  -r <regex>    Regular expression for regex (default \"%s\")\n"
+            "  -m <string>   Needle for sbmh (default \"%s\")\n"
+            "  -s <size>     Bytes scanned per sbmh op (default 16384)\n"
+            "  -c <size>     Bytes per sbmh_feed() call (default 1460)\n"
+            "  -d <N>        Elements kept in the rings (default 64)\n"
+            "  -C <N>        Connections for conn (default 100000)\n",
+            argv0, DEFAULT_EXPRESSION, DEFAULT_REGEX, DEFAULT_NEEDLE);
+    exit(EX_USAGE);
+}
+
+int
+main(int argc, char **argv) {
+    struct bench_config cfg = {.expression = DEFAULT_EXPRESSION,
+                               .regex = DEFAULT_REGEX,
+                               .needle = DEFAULT_NEEDLE,
+                               .haystack_size = 16384,
+                               .chunk_size = 1460,
+                               .ring_depth = 64,
+                               .connections = 100000,
+                               .iterations = 1000000,
+                               .repeats = 5};
+    int c;
+
+    while((c = getopt(argc, argv, "n:R:e:r:m:s:c:d:C:h")) != -1) {
+        switch(c) {
+        case 'n':
+            cfg.iterations = atol(optarg);
+            break;
+        case 'R':
+            cfg.repeats = atoi(optarg);
+            break;
+        case 'e':
+            cfg.expression = optarg;
+            break;
+        case 'r':
+            cfg.regex = optarg;
+            break;
+        case 'm':
+            cfg.needle = optarg;
+            break;
+        case 's':
+            cfg.haystack_size = atol(optarg);
+            break;
+        case 'c':
+            cfg.chunk_size = atol(optarg);
+            break;
+        case 'd':
+            cfg.ring_depth = atol(optarg);
+            break;
+        case 'C':
+            cfg.connections = atol(optarg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if(cfg.iterations <= 0 || cfg.repeats <= 0 || cfg.connections == 0)
+        usage(argv[0]);
+
+    const char *all[] = {"expr", "regex", "sbmh", "ring",
+                         "tsring", "conn", "conn-inline"};
+    const char **kernels = (const char **)argv + optind;
+    int n_kernels = argc - optind;
+    if(n_kernels == 0) {
+        kernels = all;
+        n_kernels = sizeof(all) / sizeof(all[0]);
+    }
+
+    for(int i = 0; i < n_kernels; i++) {
+        if(strcmp(kernels[i], "expr") == 0) {
+            bench_expr(&cfg);
+        } else if(strcmp(kernels[i], "regex") == 0) {
+            bench_regex(&cfg);
+        } else if(strcmp(kernels[i], "sbmh") == 0) {
+            bench_sbmh(&cfg);
+        } else if(strcmp(kernels[i], "ring") == 0) {
+            bench_rings(&cfg, 1, 0);
+        } else if(strcmp(kernels[i], "tsring") == 0) {
+            bench_rings(&cfg, 0, 1);
+        } else if(strcmp(kernels[i], "conn") == 0) {
+            bench_conn(&cfg, 0);
+        } else if(strcmp(kernels[i], "conn-inline") == 0) {
+            bench_conn(&cfg, 1);
+        } else {
+            fprintf(stderr, "Unknown kernel \"%s\"\n", kernels[i]);
+            usage(argv[0]);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "libtcpkali.h"
+
+/*
+ * Run the embedded engine against its own listener,
+ * following the per-interval numbers.
+ */
+
+struct observed {
+    int reports;
+    double last_elapsed;
+    unsigned long long msgs_rcvd;
+    unsigned long long latencies;
+};
+
+static int
+stats_cb(const struct libtcpkali_stats *st, void *opaque) {
+    struct observed *obs = opaque;
+    assert(st->elapsed > obs->last_elapsed);
+    assert(st->duration > 0);
+    obs->last_elapsed = st->elapsed;
+    obs->msgs_rcvd += st->msgs_rcvd;
+    obs->latencies += st->latency_message.count;
+    obs->reports++;
+    printf("%.2fs: %zu conns out, %llu msgs in, p50 %.3f ms\n", st->elapsed,
+           st->connections_out, (unsigned long long)st->msgs_rcvd,
+           st->latency_message.p50);
+    return 0;
+}
+
+static int
+stop_cb(const struct libtcpkali_stats *st, void *opaque) {
+    (void)st;
+    (*(int *)opaque)++;
+    return 1;
+}
+
+int
+main() {
+    char errbuf[128];
+
+    struct libtcpkali_config bad = {0};
+    assert(libtcpkali_run(&bad, NULL, errbuf, sizeof(errbuf)) == -1);
+    printf("Rejected: %s\n", errbuf);
+    const char *no_port[] = {"localhost"};
+    bad.destinations = no_port;
+    bad.n_destinations = 1;
+    assert(libtcpkali_run(&bad, NULL, errbuf, sizeof(errbuf)) == -1);
+    printf("Rejected: %s\n", errbuf);
+    const char *dest[] = {"127.0.0.1:13391"};
+    bad.destinations = dest;
+    bad.message = "\\{unknown.expression}";
+    assert(libtcpkali_run(&bad, NULL, errbuf, sizeof(errbuf)) == -1);
+    printf("Rejected: %s\n", errbuf);
+
+    struct observed obs;
+    memset(&obs, 0, sizeof(obs));
+    struct libtcpkali_config config = {
+        .destinations = dest,
+        .n_destinations = 1,
+        .connections = 2,
+        .listen_port = 13391,
+        .listen_mode = LIBTCPKALI_LISTEN_ECHO,
+        .message = "payload\\{message.marker}",
+        .message_rate = 50,
+        .duration = 1.6,
+        .stats_interval = 0.5,
+        .stats_cb = stats_cb,
+        .stats_opaque = &obs,
+    };
+    struct libtcpkali_stats total;
+    assert(libtcpkali_run(&config, &total, errbuf, sizeof(errbuf)) == 0);
+    printf("Total: %.2fs, %llu bytes out, %llu msgs in, %llu latencies\n",
+           total.duration, (unsigned long long)total.bytes_sent,
+           (unsigned long long)total.msgs_rcvd,
+           (unsigned long long)total.latency_message.count);
+    assert(obs.reports == 3);
+    assert(total.bytes_sent > 0);
+    assert(total.msgs_rcvd > 0);
+    assert(total.msgs_rcvd >= obs.msgs_rcvd);
+    assert(total.latency_message.count >= obs.latencies);
+    assert(obs.latencies > 0);
+
+    /* The callback ends the test early. */
+    int stops = 0;
+    config.listen_port = 13392;
+    dest[0] = "127.0.0.1:13392";
+    config.duration = 30;
+    config.stats_interval = 0.2;
+    config.stats_cb = stop_cb;
+    config.stats_opaque = &stops;
+    assert(libtcpkali_run(&config, &total, errbuf, sizeof(errbuf)) == 0);
+    assert(stops == 1);
+    assert(total.duration < 5);
+
+    return 0;
+}
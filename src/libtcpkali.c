@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <assert.h>
+
+#include "tcpkali_common.h"
+#include "tcpkali_engine.h"
+#include "tcpkali_events.h"
+#include "tcpkali_pacefier.h"
+#include "tcpkali_expr.h"
+#include "tcpkali_dns.h"
+#include "tcpkali_iface.h"
+#include "libtcpkali.h"
+
+static int __attribute__((format(printf, 3, 4)))
+config_error(char *errbuf, size_t errbuf_size, const char *fmt, ...) {
+    if(errbuf && errbuf_size) {
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(errbuf, errbuf_size, fmt, ap);
+        va_end(ap);
+    }
+    return -1;
+}
+
+/*
+ * Add the --message-like data, checking the \{expressions} first:
+ * message_collection_add() ends the process on a syntax error.
+ */
+static int
+add_message(struct message_collection *mc, enum mc_snippet_kind kind,
+            const char *data, size_t size) {
+    tk_expr_t *expr = 0;
+    if(parse_expression(&expr, data, size, 0) == -1) return -1;
+    free_expression(expr, 1);
+    message_collection_add(mc, kind, (void *)data, size, 0, 1);
+    return 0;
+}
+
+static void
+latency_numbers(struct libtcpkali_latency *out,
+                struct hdr_histogram *hist) {
+    memset(out, 0, sizeof(*out));
+    if(!hist || !hist->total_count) return;
+    out->count = hist->total_count;
+    out->mean = latency_to_ms(hdr_mean(hist));
+    out->p50 = latency_to_ms(hdr_value_at_percentile(hist, 50.0));
+    out->p95 = latency_to_ms(hdr_value_at_percentile(hist, 95.0));
+    out->p99 = latency_to_ms(hdr_value_at_percentile(hist, 99.0));
+    out->max = latency_to_ms(hdr_max(hist));
+}
+
+static void
+fill_stats(struct libtcpkali_stats *st, non_atomic_traffic_stats traffic,
+           const struct latency_snapshot *latency) {
+    st->bytes_sent = traffic.bytes_sent;
+    st->bytes_rcvd = traffic.bytes_rcvd;
+    st->msgs_sent = traffic.msgs_sent;
+    st->msgs_rcvd = traffic.msgs_rcvd;
+    latency_numbers(&st->latency_connect, latency->connect_histogram);
+    latency_numbers(&st->latency_first_byte, latency->firstbyte_histogram);
+    latency_numbers(&st->latency_message, latency->marker_histogram);
+}
+
+/*
+ * Set up the engine parameters the way the command line does,
+ * for the subset of the options the (config) has.
+ */
+static int
+prepare_params(const struct libtcpkali_config *cf,
+               struct engine_params *params, char *errbuf,
+               size_t errbuf_size) {
+    if(!cf->n_destinations && !cf->listen_port)
+        return config_error(errbuf, errbuf_size,
+                            "Expected destinations or a listen_port");
+    if(cf->connections < 0 || cf->connect_rate < 0 || cf->workers < 0
+       || cf->message_rate < 0 || cf->duration < 0 || cf->stats_interval < 0
+       || cf->connect_timeout < 0)
+        return config_error(errbuf, errbuf_size,
+                            "Expected non-negative numbers");
+    if(cf->listen_port < 0 || cf->listen_port > 65535)
+        return config_error(errbuf, errbuf_size, "Invalid listen_port %d",
+                            cf->listen_port);
+    for(size_t i = 0; i < cf->n_destinations; i++) {
+        const char *hostport = cf->destinations[i];
+        if(!hostport || !strchr(hostport, ':'))
+            return config_error(errbuf, errbuf_size,
+                                "Expected host:port destination, not \"%s\"",
+                                hostport ? hostport : "(null)");
+    }
+
+    struct message_collection *mc = &params->message_collection;
+    if(cf->first_message) {
+        size_t size = cf->first_message_size ? cf->first_message_size
+                                             : strlen(cf->first_message);
+        if(add_message(mc, MSK_PURPOSE_FIRST_MSG, cf->first_message, size)
+           == -1)
+            return config_error(errbuf, errbuf_size,
+                                "Can not parse the first_message");
+    }
+    if(cf->message) {
+        size_t size =
+            cf->message_size ? cf->message_size : strlen(cf->message);
+        if(add_message(mc, MSK_PURPOSE_MESSAGE, cf->message, size) == -1)
+            return config_error(errbuf, errbuf_size,
+                                "Can not parse the message");
+    }
+    message_collection_finalize(mc, 0, 0, NULL, NULL, NULL);
+
+    switch(cf->listen_mode) {
+    case LIBTCPKALI_LISTEN_SILENT:
+        params->listen_mode = LMODE_DEFAULT;
+        break;
+    case LIBTCPKALI_LISTEN_ECHO:
+        params->listen_mode = LMODE_ECHO;
+        break;
+    case LIBTCPKALI_LISTEN_ACTIVE:
+        params->listen_mode = LMODE_ACTIVE;
+        break;
+    default:
+        return config_error(errbuf, errbuf_size, "Unknown listen_mode %d",
+                            (int)cf->listen_mode);
+    }
+
+    if(cf->message_rate) params->channel_send_rate = RATE_MPS(cf->message_rate);
+    if(cf->connect_timeout) params->connect_timeout = cf->connect_timeout;
+    if(cf->latency_connect) params->latency_setting |= SLT_CONNECT;
+    if(cf->latency_first_byte) params->latency_setting |= SLT_FIRSTBYTE;
+    params->message_marker = message_collection_has(mc, EXPR_MESSAGE_MARKER);
+    if(params->message_marker) {
+        params->latency_setting |= SLT_MARKER;
+        int res = parse_expression(&params->latency_marker_expr,
+                                   MESSAGE_MARKER_TOKEN,
+                                   sizeof(MESSAGE_MARKER_TOKEN) - 1, 0);
+        assert(res != -1);
+    }
+
+    int connections = cf->n_destinations ? (cf->connections ?: 1) : 0;
+    params->requested_workers = cf->workers;
+    if(!params->requested_workers && connections < number_of_cpus()
+       && !cf->listen_port)
+        params->requested_workers = connections;
+    if(!params->requested_workers)
+        params->requested_workers = number_of_cpus();
+
+    if(cf->n_destinations)
+        params->remote_addresses = resolve_remote_addresses(
+            (char **)cf->destinations, cf->n_destinations);
+    if(cf->listen_port)
+        params->listen_addresses =
+            detect_listen_addresses(NULL, cf->listen_port);
+
+    return 0;
+}
+
+int
+libtcpkali_run(const struct libtcpkali_config *cf,
+               struct libtcpkali_stats *total, char *errbuf,
+               size_t errbuf_size) {
+    /* The defaults of the tcpkali program. */
+    struct engine_params params = {.verbosity_level = DBG_ERROR,
+                                   .connect_timeout = 1.0,
+                                   .reconnect_backoff = 0.1,
+                                   .channel_lifetime = INFINITY,
+                                   .nagle_setting = NSET_UNSET,
+                                   .write_combine = WRCOMB_ON,
+                                   .read_buffer_size = 16384,
+                                   .read_budget = 65536,
+                                   .listen_backlog = 256,
+                                   .accept_batch = 64,
+                                   .latency_max = 100.0,
+                                   .timer_granularity = 0.001};
+
+    if(!cf) return config_error(errbuf, errbuf_size, "Expected a config");
+    if(prepare_params(cf, &params, errbuf, errbuf_size) == -1) return -1;
+
+    size_t connections = cf->n_destinations ? (cf->connections ?: 1) : 0;
+    double connect_rate = cf->connect_rate ?: 100;
+    double duration = cf->duration ?: 10;
+    double interval = cf->stats_interval ?: 1;
+
+    struct engine *eng = engine_start(params);
+
+    tk_now_update(TK_DEFAULT);
+    double start = tk_now(TK_DEFAULT);
+    double next_report = start + interval;
+    double last_report = start;
+
+    struct pacefier keepup_pace;
+    pacefier_init(&keepup_pace, connect_rate, start);
+    long timeout_us = ceil(1000000.0 / connect_rate);
+    if(timeout_us > 10000) timeout_us = 10000;
+
+    non_atomic_traffic_stats last_traffic = engine_traffic(eng);
+    struct latency_snapshot *last_latency =
+        engine_collect_latency_snapshot(eng);
+
+    for(;;) {
+        usleep(timeout_us);
+        tk_now_update(TK_DEFAULT);
+        double now = tk_now(TK_DEFAULT);
+        if(now - start >= duration) break;
+
+        size_t connecting, conns_in, conns_out, conns_counter;
+        engine_get_connection_stats(eng, &connecting, &conns_in, &conns_out,
+                                    &conns_counter);
+        ssize_t conn_deficit = connections - (connecting + conns_out);
+        size_t allowed = pacefier_allow(&keepup_pace, now);
+        size_t to_start = conn_deficit > 0 ? (size_t)conn_deficit : 0;
+        if(to_start > allowed) to_start = allowed;
+        engine_initiate_new_connections(eng, to_start);
+        pacefier_moved(&keepup_pace, allowed, now);
+
+        if(now < next_report || !cf->stats_cb) continue;
+        next_report += interval;
+        if(next_report < now) next_report = now + interval;
+
+        non_atomic_traffic_stats traffic = engine_traffic(eng);
+        struct latency_snapshot *latency =
+            engine_collect_latency_snapshot(eng);
+        struct latency_snapshot *interval_latency =
+            engine_diff_latency_snapshot(last_latency, latency);
+        engine_free_latency_snapshot(last_latency);
+        last_latency = latency;
+
+        struct libtcpkali_stats st = {.elapsed = now - start,
+                                      .duration = now - last_report,
+                                      .connecting = connecting,
+                                      .connections_in = conns_in,
+                                      .connections_out = conns_out};
+        fill_stats(&st, subtract_traffic_stats(traffic, last_traffic),
+                   interval_latency);
+        engine_free_latency_snapshot(interval_latency);
+        last_traffic = traffic;
+        last_report = now;
+
+        if(cf->stats_cb(&st, cf->stats_opaque)) break;
+    }
+    engine_free_latency_snapshot(last_latency);
+
+    non_atomic_traffic_stats initial_traffic;
+    memset(&initial_traffic, 0, sizeof(initial_traffic));
+    struct engine_summary summary;
+    engine_stop(eng, start, initial_traffic, &summary);
+    if(total) {
+        memset(total, 0, sizeof(*total));
+        total->elapsed = summary.test_duration;
+        total->duration = summary.test_duration;
+        total->connecting = summary.connecting;
+        total->connections_in = summary.conns_in;
+        total->connections_out = summary.conns_out;
+        fill_stats(total, summary.traffic, summary.latency);
+    }
+    engine_free_summary(&summary);
+
+    return 0;
+}
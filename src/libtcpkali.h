@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef LIBTCPKALI_H
+#define LIBTCPKALI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The tcpkali load engine, for running tests from within another program.
+ * The interface only uses the types declared here, and the structures are
+ * only extended at the end, so the programs built against it keep working.
+ */
+
+#define LIBTCPKALI_VERSION 1
+
+enum libtcpkali_listen_mode {
+    LIBTCPKALI_LISTEN_SILENT, /* Ignore the received data */
+    LIBTCPKALI_LISTEN_ECHO,   /* Send the received data back */
+    LIBTCPKALI_LISTEN_ACTIVE, /* Send the messages, too */
+};
+
+/*
+ * Latencies in milliseconds, over the interval or the whole test.
+ * The (count) is zero if nothing was measured.
+ */
+struct libtcpkali_latency {
+    uint64_t count;
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+};
+
+struct libtcpkali_stats {
+    double elapsed;  /* Seconds since the test started */
+    double duration; /* Seconds covered by the numbers below */
+    size_t connecting;
+    size_t connections_in;
+    size_t connections_out;
+    uint64_t bytes_sent;
+    uint64_t bytes_rcvd;
+    uint64_t msgs_sent; /* Counted when the message boundaries are known */
+    uint64_t msgs_rcvd;
+    struct libtcpkali_latency latency_connect;    /* With latency_connect */
+    struct libtcpkali_latency latency_first_byte; /* Likewise */
+    struct libtcpkali_latency latency_message;    /* \{message.marker} */
+};
+
+/*
+ * Called every (stats_interval) with the numbers of the last interval.
+ * A non-zero return value ends the test early.
+ */
+typedef int(libtcpkali_stats_cb)(const struct libtcpkali_stats *,
+                                 void *opaque);
+
+/*
+ * The zero-initialized configuration is valid, if not very useful:
+ * set the destinations, or a listen_port, or both.
+ */
+struct libtcpkali_config {
+    const char *const *destinations; /* "host:port", as in the command line */
+    size_t n_destinations;
+    int connections;            /* Connections to open, 0: one */
+    double connect_rate;        /* Connections per second, 0: 100 */
+    double connect_timeout;     /* Seconds, 0: one second */
+    int listen_port;            /* Accept connections, 0: don't listen */
+    enum libtcpkali_listen_mode listen_mode;
+    int workers;                /* Threads, 0: fewest of CPUs, connections */
+    /*
+     * The data to send, in the --message syntax: the \{expressions}
+     * are expanded, eg. \{message.marker} measures the message latency.
+     */
+    const char *first_message;
+    size_t first_message_size;  /* 0: strlen(first_message) */
+    const char *message;
+    size_t message_size;        /* 0: strlen(message) */
+    double message_rate;        /* Per connection per second, 0: unlimited */
+    int latency_connect;        /* Measure the connect latency */
+    int latency_first_byte;     /* Measure the first byte latency */
+    double duration;            /* Seconds, 0: ten seconds */
+    double stats_interval;      /* Seconds, 0: one second */
+    libtcpkali_stats_cb *stats_cb; /* Optional */
+    void *stats_opaque;
+};
+
+/*
+ * Run a test, blocking until it is over. The final numbers of the whole
+ * test are put into the (total), if given.
+ * RETURN VALUES:
+ *   0: the test has run its course or was ended by the (stats_cb),
+ *  -1: the (config) is not valid, the reason is put into the (errbuf).
+ * Like the tcpkali program, the engine ends the process upon the fatal
+ * system errors, such as a destination which does not resolve or
+ * a port which is already in use. The worker threads are joined when the
+ * test is over, but some of the engine memory and the listening sockets
+ * are not reclaimed: use a different listen_port for each test.
+ */
+int libtcpkali_run(const struct libtcpkali_config *config,
+                   struct libtcpkali_stats *total, char *errbuf,
+                   size_t errbuf_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBTCPKALI_H */
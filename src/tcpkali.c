@@ -30,34 +30,52 @@
 #include <sysexits.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <ctype.h>
 #include <string.h>
 #include <math.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/mman.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h> /* for TCP_INFO */
 #include <libgen.h> /* basename(3) */
 #include <ifaddrs.h>
 #include <err.h>
 #include <errno.h>
 #include <assert.h>
 #include <time.h>
+#include <limits.h>
 
 #include <statsd.h>
 
 #include "tcpkali.h"
 #include "tcpkali_run.h"
+#include "tcpkali_profile.h"
+#include "tcpkali_scenario.h"
+#include "tcpkali_metrics.h"
+#include "tcpkali_json.h"
+#include "tcpkali_compare.h"
 #include "tcpkali_mavg.h"
 #include "tcpkali_data.h"
 #include "tcpkali_events.h"
 #include "tcpkali_signals.h"
+#include "tcpkali_procs.h"
+#include "tcpkali_affinity.h"
 #include "tcpkali_terminfo.h"
 #include "tcpkali_websocket.h"
+#include "tcpkali_http2.h"
+#include "tcpkali_pcap.h"
+#include "tcpkali_corpus.h"
 #include "tcpkali_transport.h"
 #include "tcpkali_syslimits.h"
 #include "tcpkali_logging.h"
 #include "tcpkali_ssl.h"
+#include "tcpkali_dashboard.h"
+#include "tcpkali_multiscan.h"
+#include "tcpkali_framer.h"
+#include "tcpkali_clocksync.h"
 
 /*
  * Describe the command line options.
@@ -72,68 +90,235 @@
 #define SSL_OPT (1 << 15)
 static struct option cli_long_options[] = {
     {"channel-lifetime", 1, 0, CLI_CHAN_OFFSET + 't'},
+    {"channel-lifetime-distribution", 1, 0, CLI_CHAN_OFFSET + 'L'},
+    {"close-style", 1, 0, CLI_CHAN_OFFSET + 'C'},
     {"channel-bandwidth-upstream", 1, 0, 'U'},
     {"channel-bandwidth-downstream", 1, 0, 'D'},
     {"connections", 1, 0, 'c'},
     {"connect-rate", 1, 0, 'R'},
     {"connect-timeout", 1, 0, CLI_CONN_OFFSET + 't'},
+    {"load-profile", 1, 0, CLI_CONN_OFFSET + 'p'},
+    {"scenario", 1, 0, CLI_CONN_OFFSET + 'e'},
     {"delay-send", 1, 0, CLI_CONN_OFFSET + 'z'},
+    {"slow-send", 1, 0, CLI_CHAN_OFFSET + 'S'},
+    {"verify-echo", 0, 0, CLI_CHAN_OFFSET + 'V'},
+    {"keepalive-message", 1, 0, CLI_CHAN_OFFSET + 'K'},
+    {"keepalive-interval", 1, 0, CLI_CHAN_OFFSET + 'I'},
+    {"dns-refresh", 1, 0, CLI_CONN_OFFSET + 'd'},
+    {"remote-select", 1, 0, CLI_CONN_OFFSET + 's'},
+    {"remote-weights", 1, 0, CLI_CONN_OFFSET + 'w'},
+    {"connection-group", 1, 0, CLI_CONN_OFFSET + 'g'},
+    {"ab", 0, 0, CLI_CONN_OFFSET + 'v'},
+    {"mirror", 1, 0, CLI_CONN_OFFSET + 'x'},
+    {"reconnect", 0, 0, CLI_CONN_OFFSET + 'r'},
+    {"reconnect-backoff", 1, 0, CLI_CONN_OFFSET + 'b'},
+    {"connect-backoff", 1, 0, CLI_CONN_OFFSET + 'k'},
+    {"connect-backoff-max", 1, 0, CLI_CONN_OFFSET + 'K'},
     {"duration", 1, 0, 'T'},
+    {"warmup", 1, 0, CLI_CONN_OFFSET + 'W'},
+    {"abort-if", 1, 0, CLI_CONN_OFFSET + 'a'},
+    {"until-stable", 1, 0, CLI_CONN_OFFSET + 'u'},
+    {"stable-windows", 1, 0, CLI_CONN_OFFSET + 'n'},
+    {"find-max-connections", 1, 0, CLI_CONN_OFFSET + 'm'},
+    {"find-max-connect-rate", 1, 0, CLI_CONN_OFFSET + 'c'},
+    {"find-max-strategy", 1, 0, CLI_CONN_OFFSET + 'f'},
+    {"find-max-latency", 1, 0, CLI_CONN_OFFSET + 'l'},
     {"dump-one", 0, 0, CLI_DUMP + '1'},
     {"dump-one-in", 0, 0, CLI_DUMP + 'i'},
     {"dump-one-out", 0, 0, CLI_DUMP + 'o'},
     {"dump-all", 0, 0, CLI_DUMP + 'a'},
     {"dump-all-in", 0, 0, CLI_DUMP + 'I'},
     {"dump-all-out", 0, 0, CLI_DUMP + 'O'},
+    {"record", 1, 0, CLI_DUMP + 'r'},
+    {"record-sample", 1, 0, CLI_DUMP + 's'},
+    {"per-connection-stats", 1, 0, CLI_DUMP + 'p'},
+    {"per-peer-stats", 1, 0, CLI_DUMP + 'P'},
     {"first-message", 1, 0, '1'},
     {"first-message-file", 1, 0, 'F'},
     {"help", 0, 0, 'E'},
     {"header", 1, 0, 'H'},
+    {"http", 0, 0, CLI_CHAN_OFFSET + 'h'},
+    {"http-pipeline", 1, 0, CLI_CHAN_OFFSET + 'p'},
+    {"pipeline", 1, 0, CLI_CHAN_OFFSET + 'p'},
+    {"outstanding", 1, 0, CLI_CHAN_OFFSET + 'p'},
+    {"think-time", 1, 0, CLI_CHAN_OFFSET + 'T'},
+    {"resp", 0, 0, CLI_CHAN_OFFSET + 'P'},
+    {"mqtt", 0, 0, CLI_CHAN_OFFSET + 'Q'},
+    {"mqtt-version", 1, 0, CLI_CHAN_OFFSET + 'v'},
+    {"mqtt-topic", 1, 0, CLI_CHAN_OFFSET + 'u'},
+    {"mqtt-subscribe", 1, 0, CLI_CHAN_OFFSET + 'b'},
+    {"mqtt-qos", 1, 0, CLI_CHAN_OFFSET + 'q'},
+    {"http2", 0, 0, CLI_CHAN_OFFSET + '2'},
+    {"grpc", 0, 0, CLI_CHAN_OFFSET + 'G'},
+    {"grpc-stream", 0, 0, CLI_CHAN_OFFSET + 'B'},
+    {"framing", 1, 0, CLI_CHAN_OFFSET + 'f'},
+    {"framer", 1, 0, CLI_CHAN_OFFSET + 'F'},
+    {"replay-pcap", 1, 0, CLI_CHAN_OFFSET + 'y'},
+    {"replay-timing", 1, 0, CLI_CHAN_OFFSET + 'Y'},
+    {"json-report", 1, 0, CLI_STATSD_OFFSET + 'J'},
+    {"json-stream", 0, 0, CLI_STATSD_OFFSET + 'j'},
+    {"compare-to", 1, 0, CLI_STATSD_OFFSET + 'c'},
+    {"compare-threshold", 1, 0, CLI_STATSD_OFFSET + 'H'},
+    {"dashboard", 0, 0, CLI_STATSD_OFFSET + 'D'},
+    {"timeseries", 1, 0, CLI_STATSD_OFFSET + 'T'},
+    {"timeseries-csv", 1, 0, CLI_STATSD_OFFSET + 'C'},
+    {"sample-interval", 1, 0, CLI_STATSD_OFFSET + 'I'},
+    {"shm-stats", 1, 0, CLI_STATSD_OFFSET + 'S'},
+    {"aggregate", 1, 0, CLI_STATSD_OFFSET + 'A'},
     {"latency-connect", 0, 0, CLI_LATENCY + 'c'},
     {"latency-first-byte", 0, 0, CLI_LATENCY + 'f'},
+    {"latency-handshake", 0, 0, CLI_LATENCY + 'h'},
+    {"latency-upgrade", 0, 0, CLI_LATENCY + 'u'},
+    {"latency-clock", 1, 0, CLI_LATENCY + 'k'},
+    {"clock-offset", 1, 0, CLI_LATENCY + 'o'},
+    {"clock-sync", 0, 0, CLI_LATENCY + 'y'},
+    {"latency-resolution", 1, 0, CLI_LATENCY + 'r'},
+    {"latency-max", 1, 0, CLI_LATENCY + 'x'},
+    {"latency-correction", 1, 0, CLI_LATENCY + 'C'},
     {"latency-marker", 1, 0, CLI_LATENCY + 'm'},
     {"latency-marker-skip", 1, 0, CLI_LATENCY + 's'},
+    {"latency-sample", 1, 0, CLI_LATENCY + 'e'},
+    {"latency-log", 1, 0, CLI_LATENCY + 'L'},
     {"latency-percentiles", 1, 0, CLI_LATENCY + 'p'},
+    {"latency-per-connection", 0, 0, CLI_LATENCY + 'P'},
+    {"latency-by-size", 0, 0, CLI_LATENCY + 'z'},
+    {"latency-slowest", 1, 0, CLI_LATENCY + 'S'},
+    {"latency-timestamping", 1, 0, CLI_LATENCY + 'T'},
     {"listen-port", 1, 0, 'l'},
     {"listen-mode", 1, 0, 'L'},
+    {"listen-backlog", 1, 0, CLI_CONN_OFFSET + 'B'},
+    {"accept-batch", 1, 0, CLI_CONN_OFFSET + 'A'},
+    {"defer-accept", 1, 0, CLI_CONN_OFFSET + 'D'},
+    {"reuseport-cpu", 0, 0, CLI_SOCKET_OPT + 'P'},
+    {"busy-poll", 1, 0, CLI_SOCKET_OPT + 'p'},
     {"message", 1, 0, 'm'},
     {"message-file", 1, 0, 'f'},
+    {"message-corpus", 1, 0, CLI_CHAN_OFFSET + 'm'},
+    {"message-corpus-order", 1, 0, CLI_CHAN_OFFSET + 'o'},
     {"message-rate", 1, 0, 'r'},
+    {"message-arrival", 1, 0, CLI_CHAN_OFFSET + 'a'},
+    {"message-rate-jitter", 1, 0, CLI_CHAN_OFFSET + 'j'},
+    {"burst", 1, 0, CLI_CHAN_OFFSET + 'e'},
+    {"burst-every", 1, 0, CLI_CHAN_OFFSET + 'n'},
+    {"burst-size", 1, 0, CLI_CHAN_OFFSET + 'z'},
+    {"send-budget", 1, 0, CLI_CHAN_OFFSET + 'i'},
+    {"catch-up", 1, 0, CLI_CHAN_OFFSET + 'U'},
+    {"message-rate-distribution", 1, 0, CLI_CHAN_OFFSET + 'Z'},
+    {"rate-scope", 1, 0, CLI_CHAN_OFFSET + 's'},
+    {"kernel-pacing", 0, 0, CLI_CHAN_OFFSET + 'k'},
+    {"timer-granularity", 1, 0, CLI_CHAN_OFFSET + 'g'},
+    {"rate-control", 1, 0, CLI_CHAN_OFFSET + 'c'},
     {"message-stop", 1, 0, 's'},
     {"nagle", 1, 0, 'N'},
     {"rcvbuf", 1, 0, CLI_SOCKET_OPT + 'R'},
+    {"request-delimiter", 1, 0, CLI_CHAN_OFFSET + 'd'},
+    {"response", 1, 0, CLI_CHAN_OFFSET + 'r'},
+    {"response-file", 1, 0, CLI_CHAN_OFFSET + 'R'},
     {"server", 1, 0, 'S'},
     {"sndbuf", 1, 0, CLI_SOCKET_OPT + 'S'},
+    {"rcvlowat", 1, 0, CLI_SOCKET_OPT + 'l'},
+    {"notsent-lowat", 1, 0, CLI_SOCKET_OPT + 'n'},
+    {"read-buffer", 1, 0, CLI_SOCKET_OPT + 'b'},
+    {"read-budget", 1, 0, CLI_SOCKET_OPT + 'B'},
     {"source-ip", 1, 0, 'I'},
+    {"source-ipv6-prefix", 1, 0, CLI_CONN_OFFSET + '6'},
+    {"proxy-protocol", 1, 0, CLI_CONN_OFFSET + 'P'},
+    {"proxy-source", 1, 0, CLI_CONN_OFFSET + 'S'},
     {"ssl", 0, 0, SSL_OPT},
     {"ssl-cert", 1, 0, SSL_OPT + 'c'},
     {"ssl-key", 1, 0, SSL_OPT + 'k'},
+    {"ssl-session-reuse", 0, 0, SSL_OPT + 'r'},
+    {"ssl-ktls", 0, 0, SSL_OPT + 'K'},
     {"statsd", 0, 0, CLI_STATSD_OFFSET + 'e'},
     {"statsd-host", 1, 0, CLI_STATSD_OFFSET + 'h'},
     {"statsd-port", 1, 0, CLI_STATSD_OFFSET + 'p'},
     {"statsd-namespace", 1, 0, CLI_STATSD_OFFSET + 'n'},
     {"statsd-latency-window", 1, 0, CLI_STATSD_OFFSET + 'w'},
+    {"statsd-latency-step", 1, 0, CLI_STATSD_OFFSET + 's'},
+    {"statsd-mtu", 1, 0, CLI_STATSD_OFFSET + 'm'},
+    {"statsd-tags", 1, 0, CLI_STATSD_OFFSET + 't'},
+    {"metrics-listen", 1, 0, CLI_STATSD_OFFSET + 'M'},
     {"unescape-message-args", 0, 0, 'e'},
     {"version", 0, 0, 'V'},
     {"verbose", 1, 0, CLI_VERBOSE_OFFSET + 'v'},
     {"workers", 1, 0, 'w'},
+    {"processes", 1, 0, CLI_VERBOSE_OFFSET + 'P'},
+    {"cpu-affinity", 1, 0, CLI_VERBOSE_OFFSET + 'A'},
+    {"rebalance", 0, 0, CLI_VERBOSE_OFFSET + 'B'},
+    {"worker-select", 1, 0, CLI_VERBOSE_OFFSET + 'S'},
+    {"prewarm", 0, 0, CLI_VERBOSE_OFFSET + 'W'},
+    {"mlockall", 0, 0, CLI_VERBOSE_OFFSET + 'M'},
+    {"memory-report", 0, 0, CLI_VERBOSE_OFFSET + 'm'},
+    {"cpu-cost", 0, 0, CLI_VERBOSE_OFFSET + 'c'},
+    {"idle-connections", 0, 0, CLI_VERBOSE_OFFSET + 'i'},
+    {"hugepages", 0, 0, CLI_VERBOSE_OFFSET + 'H'},
+    {"preflight", 2, 0, CLI_VERBOSE_OFFSET + 'F'},
     {"write-combine", 1, 0, 'C'},
+    {"zerocopy", 0, 0, CLI_SOCKET_OPT + 'Z'},
+    {"zerocopy-receive", 0, 0, CLI_SOCKET_OPT + 'z'},
+    {"sendfile", 0, 0, CLI_SOCKET_OPT + 'F'},
+    {"tcp-info", 0, 0, CLI_SOCKET_OPT + 'T'},
+    {"mptcp", 0, 0, CLI_SOCKET_OPT + 'M'},
+    {"tcp-fastopen", 0, 0, CLI_SOCKET_OPT + 'O'},
+    {"udp", 0, 0, CLI_SOCKET_OPT + 'U'},
     {"websocket", 0, 0, 'W'},
+    {"websocket-mask", 1, 0, CLI_CHAN_OFFSET + 'W'},
+    {"websocket-deflate", 0, 0, CLI_CHAN_OFFSET + 'D'},
     {"ws", 0, 0, 'W'},
     {"message-marker", 0, 0, 'M'},
+    {"message-marker-format", 1, 0, CLI_LATENCY + 'M'},
+    {"fanout", 0, 0, CLI_LATENCY + 'F'},
     {0, 0, 0, 0}};
 
 static struct tcpkali_config {
     int max_connections;
     double connect_rate;  /* New connects per second. */
     double test_duration; /* Seconds for the full test. */
+    double warmup;        /* --warmup seconds, negative if not given */
     double latency_window;  /* Seconds */
+    double latency_step;    /* --statsd-latency-step seconds */
+    char *latency_log_file; /* --latency-log */
+    char *timeseries_file;  /* --timeseries */
+    int catchup_set;        /* --catch-up */
+    char *shm_stats_name;   /* --shm-stats */
+    struct load_profile *load_profile; /* --load-profile */
+    const char *scenario_file; /* --scenario */
+    struct scenario *scenario;
+    struct abort_conditions abort_conditions; /* --abort-if */
+    double until_stable; /* --until-stable coefficient of variation */
+    int stable_windows;  /* --stable-windows */
     int statsd_enable;
     char *statsd_host;
     int statsd_port;
     char *statsd_namespace;
+    int statsd_mtu;    /* Datagram payload size limit */
+    char *statsd_tags; /* DogStatsD tags, enables the breakdown */
+    char *metrics_listen; /* --metrics-listen [host:]port */
+    char *json_report_file; /* --json-report */
+    int json_stream;        /* --json-stream */
+    char *compare_to;       /* --compare-to */
+    struct compare_thresholds compare_thresholds; /* --compare-threshold */
+    int dashboard;          /* --dashboard */
     char *listen_host;    /* Address on which to listen. Can be NULL */
     int listen_port;      /* Port on which to listen. */
+    double dns_refresh;   /* --dns-refresh interval */
+    int processes;        /* --processes <N> */
+    int prewarm;          /* --prewarm */
+    int mlockall;         /* --mlockall */
+    enum preflight_mode preflight; /* --preflight */
+    int clock_offset_set; /* --clock-offset */
+    int clock_sync;       /* --clock-sync */
+    int remote_select_given; /* --remote-select is explicitly set */
+    char *remote_weights; /* --remote-weights list */
+    struct connection_group *groups; /* --connection-group */
+    size_t n_groups;
+    int ab; /* --ab: two groups, one per destination */
+    char *mirror; /* --mirror: the twin of each connection goes there */
+    struct group_targets {
+        char **hostports; /* target= of the group */
+        int n_hostports;
+    } * group_targets;
+    struct addresses listen_unix; /* -l unix:/path */
     char *first_hostport; /* A single (first) host:port specification */
     char *first_path;     /* A /path specification from the first host */
     struct http_headers {
@@ -143,10 +328,14 @@ static struct tcpkali_config {
 } default_config = {.max_connections = 1,
                     .connect_rate = 100.0,
                     .test_duration = 10.0,
+                    .warmup = -1,
+                    .stable_windows = 10,
+                    .compare_thresholds = COMPARE_THRESHOLDS_DEFAULT,
                     .statsd_enable = 0,
                     .statsd_host = "127.0.0.1",
                     .statsd_port = 8125,
-                    .statsd_namespace = "tcpkali"};
+                    .statsd_namespace = "tcpkali",
+                    .statsd_mtu = 1432};
 
 /*
  * Bunch of utility functions defined at the end of this file.
@@ -161,6 +350,22 @@ static double parse_with_multipliers(const char *, char *str,
                                      struct multiplier *, int n);
 static int parse_percentile_values(const char *option, char *str,
                                    struct percentile_values *array);
+static struct addresses resolve_each_address(char **hostports,
+                                             int nhostports, size_t **targets);
+static struct addresses resolve_weighted_addresses(char **hostports,
+                                                   int nhostports,
+                                                   const char *weights_list,
+                                                   double **weights,
+                                                   size_t **targets);
+static struct remote_quota *parse_remote_quotas(char **hostports,
+                                                int nhostports);
+static void parse_connection_group(const char *spec, int unescape,
+                                   struct connection_group *group,
+                                   struct group_targets *targets);
+static void parse_trivial_expression(tk_expr_t **, const char *option,
+                                     const char *str, size_t size,
+                                     int unescape);
+static double startup_clock(void);
 
 /* clang-format off */
 static struct multiplier km_multiplier[] = { { "k", 1000 }, { "m", 1000000 } };
@@ -173,6 +378,9 @@ static struct multiplier s_multiplier[] = {
     { "d", 86400 }, { "day", 86400 }, { "days", 86400 },
     { "y", 31536000 }, { "year", 31536000 }, { "years", 31536000 }
 };
+static struct multiplier fine_s_multiplier[] = {
+    { "ns", 1e-9 }, { "us", 1e-6 }, { "ms", 0.001 }, { "s", 1 }
+};
 static struct multiplier bw_multiplier[] = {
     /* bits per second */
     { "bps", 1.0/8 },
@@ -210,18 +418,34 @@ void portable_srandomdev() {
  */
 int
 main(int argc, char **argv) {
+    const double startup_began = startup_clock();
     struct tcpkali_config conf = default_config;
     struct engine_params engine_params = {.verbosity_level = DBG_ERROR,
                                           .connect_timeout = 1.0,
+                                          .reconnect_backoff = 0.1,
+                                          .connect_backoff_max = 10.0,
                                           .channel_lifetime = INFINITY,
                                           .delay_send = 0.0,
                                           .nagle_setting = NSET_UNSET,
                                           .ssl_enable = 0,
                                           .ssl_cert = "cert.pem",
                                           .ssl_key = "key.pem",
-                                          .write_combine = WRCOMB_ON};
+                                          .write_combine = WRCOMB_ON,
+                                          .read_buffer_size = 16384,
+                                          .read_budget = 65536,
+                                          .listen_backlog = 256,
+                                          .accept_batch = 64,
+                                          .latency_max = 100.0,
+                                          .timer_granularity = 0.001};
     struct rate_modulator rate_modulator = {.state = RM_UNMODULATED};
+    struct connection_modulator connection_modulator = {.mode =
+                                                            CM_UNMODULATED};
     int unescape_message_data = 0;
+    int websocket_mask_random = 0; /* --websocket-mask random */
+    int websocket_deflate = 0;     /* --websocket-deflate */
+    const char *replay_pcap_file = NULL; /* --replay-pcap */
+    const char *corpus_file = NULL;      /* --message-corpus */
+    int corpus_shuffle = 0;              /* --message-corpus-order random */
 
     struct orchestration_args orch_args = {.enabled = 0,
                                            .server_addrs = NULL,
@@ -249,6 +473,8 @@ main(int argc, char **argv) {
             printf(PACKAGE_NAME " version " VERSION
 #ifdef USE_LIBUV
                                 " (libuv"
+#elif defined(USE_IO_URING)
+                                " (io_uring"
 #else
                                 " (libev"
 #endif
@@ -306,6 +532,67 @@ main(int argc, char **argv) {
                 free(hdrbuf);
             }
             } break;
+        case CLI_VERBOSE_OFFSET + 'P': /* --processes <N> */
+            conf.processes = atoi(optarg);
+            if(conf.processes < 1) {
+                fprintf(stderr, "Expected positive --processes=%s\n", optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_VERBOSE_OFFSET + 'B': /* --rebalance */
+#if defined(USE_LIBUV) || defined(USE_IO_URING)
+            warning("--rebalance makes no effect without libev\n");
+#else
+            engine_params.rebalance = 1;
+#endif
+            break;
+        case CLI_VERBOSE_OFFSET + 'S': /* --worker-select */
+            if(strcmp(optarg, "even") == 0) {
+                engine_params.worker_select = WSEL_EVEN;
+            } else if(strcmp(optarg, "least-conn") == 0) {
+                engine_params.worker_select = WSEL_LEAST_CONN;
+            } else if(strcmp(optarg, "least-busy") == 0) {
+#if defined(USE_LIBUV) || defined(USE_IO_URING)
+                warning("--worker-select least-busy is the same as "
+                        "least-conn without libev\n");
+#endif
+                engine_params.worker_select = WSEL_LEAST_BUSY;
+            } else {
+                fprintf(stderr,
+                        "--worker-select=%s is not one of "
+                        "{even|least-conn|least-busy}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_VERBOSE_OFFSET + 'W': /* --prewarm */
+            conf.prewarm = 1;
+            break;
+        case CLI_VERBOSE_OFFSET + 'M': /* --mlockall */
+            conf.mlockall = 1;
+            break;
+        case CLI_VERBOSE_OFFSET + 'F': /* --preflight[=apply] */
+            if(optarg == NULL) {
+                conf.preflight = PREFLIGHT_CHECK;
+            } else if(strcmp(optarg, "apply") == 0) {
+                conf.preflight = PREFLIGHT_APPLY;
+            } else {
+                fprintf(stderr, "Expecting --preflight or --preflight=apply\n");
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_VERBOSE_OFFSET + 'm': /* --memory-report */
+            engine_params.memory_report = 1;
+            break;
+        case CLI_VERBOSE_OFFSET + 'c': /* --cpu-cost */
+            engine_params.cpu_cost = 1;
+            break;
+        case CLI_VERBOSE_OFFSET + 'i': /* --idle-connections */
+            engine_params.idle_connections = 1;
+            break;
+        case CLI_VERBOSE_OFFSET + 'H': /* --hugepages */
+            engine_params.hugepages = 1;
+            break;
         case CLI_VERBOSE_OFFSET + 'v': /* --verbose <level> */
             engine_params.verbosity_level = atoi(optarg);
             if((int)engine_params.verbosity_level < 0
@@ -334,6 +621,45 @@ main(int argc, char **argv) {
         case CLI_DUMP + 'O': /* --dump-all-out */
             engine_params.dump_setting |= DS_DUMP_ALL_OUT;
             break;
+        case CLI_DUMP + 'r': /* --record */
+            engine_params.record_dir = optarg;
+            break;
+        case CLI_DUMP + 's': { /* --record-sample */
+            char *end;
+            double sample = strtod(optarg, &end);
+            if(end != optarg && strcmp(end, "%") == 0) {
+                sample /= 100;
+            } else if(end == optarg || *end) {
+                sample = -1;
+            }
+            if(!(sample > 0 && sample <= 1)) {
+                fprintf(stderr,
+                        "--record-sample=%s is not a fraction "
+                        "of the connections, (0..1] or (0..100]%%\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            engine_params.record_sample = sample;
+        } break;
+        case CLI_DUMP + 'p': /* --per-connection-stats */
+            engine_params.connstats_file = optarg;
+            break;
+        case CLI_DUMP + 'P': { /* --per-peer-stats */
+            unsigned ipv4_bits, ipv6_bits = 128;
+            char tail;
+            int n = sscanf(optarg, "%u,%u%c", &ipv4_bits, &ipv6_bits, &tail);
+            if((n != 1 && n != 2) || ipv4_bits > 32 || ipv6_bits > 128
+               || (n == 1 && strchr(optarg, ','))) {
+                fprintf(stderr,
+                        "--per-peer-stats=%s: expected <IPv4 bits>[,<IPv6 "
+                        "bits>], such as 24,64\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            engine_params.peer_stats = 1;
+            engine_params.peer_stats_ipv4_bits = ipv4_bits;
+            engine_params.peer_stats_ipv6_bits = ipv6_bits;
+        } break;
         case 'c':
             conf.max_connections = parse_with_multipliers(
                 option, optarg, km_multiplier,
@@ -365,6 +691,107 @@ main(int argc, char **argv) {
                 conf.test_duration = INFINITY;
             }
             break;
+        case CLI_CONN_OFFSET + 'W': /* --warmup */
+            conf.warmup = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(conf.warmup < 0) {
+                fprintf(stderr, "Expected non-negative --warmup=%s\n", optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CONN_OFFSET + 'a': /* --abort-if */
+            if(abort_condition_add(&conf.abort_conditions, optarg) == -1)
+                exit(EX_USAGE);
+            break;
+        case CLI_CONN_OFFSET + 'u': { /* --until-stable */
+            char *end;
+            conf.until_stable = strtod(optarg, &end);
+            if(end != optarg && strcmp(end, "%") == 0) {
+                conf.until_stable /= 100;
+                end++;
+            }
+            if(end == optarg || *end
+               || !(conf.until_stable > 0.0 && conf.until_stable < 1.0)) {
+                fprintf(stderr,
+                        "--until-stable=%s is not a fraction within (0..1) "
+                        "or a percentage\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+        } break;
+        case CLI_CONN_OFFSET + 'm': /* --find-max-connections */
+            connection_modulator.limit = (int)parse_with_multipliers(
+                option, optarg, km_multiplier,
+                sizeof(km_multiplier) / sizeof(km_multiplier[0]));
+            if(connection_modulator.limit <= 0) {
+                fprintf(stderr, "Expected positive --find-max-connections=%s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            if(connection_modulator.mode == CM_MAX_CONNECT_RATE) {
+                fprintf(stderr,
+                        "--find-max-connections is not compatible with "
+                        "--find-max-connect-rate\n");
+                exit(EX_USAGE);
+            }
+            connection_modulator.mode = CM_MAX_CONNECTIONS;
+            conf.test_duration = INFINITY;
+            break;
+        case CLI_CONN_OFFSET + 'c': /* --find-max-connect-rate */
+            connection_modulator.latency_target = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(connection_modulator.latency_target <= 0) {
+                fprintf(stderr,
+                        "Expected positive --find-max-connect-rate=%s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            if(connection_modulator.mode == CM_MAX_CONNECTIONS) {
+                fprintf(stderr,
+                        "--find-max-connect-rate is not compatible with "
+                        "--find-max-connections\n");
+                exit(EX_USAGE);
+            }
+            connection_modulator.mode = CM_MAX_CONNECT_RATE;
+            connection_modulator.latency_target_s = optarg;
+            connection_modulator.limit = INFINITY;
+            conf.test_duration = INFINITY;
+            break;
+        case CLI_CONN_OFFSET + 'f': /* --find-max-strategy */
+            if(strcmp(optarg, "double") == 0) {
+                connection_modulator.strategy = CMR_DOUBLE;
+            } else if(strcmp(optarg, "linear") == 0) {
+                connection_modulator.strategy = CMR_LINEAR;
+            } else {
+                fprintf(stderr,
+                        "--find-max-strategy=%s is not one of "
+                        "{double|linear}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CONN_OFFSET + 'l': /* --find-max-latency */
+            connection_modulator.latency_target = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(connection_modulator.latency_target <= 0) {
+                fprintf(stderr, "Expected positive --find-max-latency=%s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CONN_OFFSET + 'n': /* --stable-windows */
+            conf.stable_windows = parse_with_multipliers(
+                option, optarg, km_multiplier,
+                sizeof(km_multiplier) / sizeof(km_multiplier[0]));
+            if(conf.stable_windows < 2) {
+                fprintf(stderr, "--stable-windows=%s should be >= 2\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
         case 'e':
             unescape_message_data = 1;
             break;
@@ -390,6 +817,22 @@ main(int argc, char **argv) {
         case 'f': { /* --message-file */
             char *data;
             size_t size;
+            int fd;
+            if(!unescape_message_data
+               && map_in_file(optarg, &data, &size, &fd) == 0) {
+                /* A large file without expressions is not copied. */
+                if(size >= REPLICATE_MAX_SIZE
+                   && message_collection_add_shared(
+                          &engine_params.message_collection,
+                          MSK_PURPOSE_MESSAGE, data, size, fd)
+                          == 0)
+                    break;
+                message_collection_add(&engine_params.message_collection,
+                                       MSK_PURPOSE_MESSAGE, data, size, 0, 1);
+                munmap(data, size);
+                close(fd);
+                break;
+            }
             if(read_in_file(optarg, &data, &size) != 0) exit(EX_DATAERR);
             message_collection_add(&engine_params.message_collection,
                                    MSK_PURPOSE_MESSAGE, data, size,
@@ -498,26 +941,35 @@ main(int argc, char **argv) {
             break;
         }
         case 's': { /* --message-stop */
-            char *data = strdup(optarg);
-            size_t size = strlen(optarg);
-            if(unescape_message_data) unescape_data(data, &size);
-            if(size == 0) {
-                fprintf(stderr,
-                        "--message-stop: Non-empty message expected\n");
-                exit(EX_USAGE);
-            }
-            if(parse_expression(&engine_params.message_stop_expr, data, size,
-                                0)
-               == -1) {
-                fprintf(stderr,
-                        "--message-stop: Failed to parse expression\n");
-                exit(EX_USAGE);
-            } else if(!EXPR_IS_TRIVIAL(engine_params.message_stop_expr)) {
-                fprintf(stderr,
-                        "--message-stop: Non-trivial expressions are not "
-                        "supported\n");
-                exit(EX_USAGE);
-            }
+            tk_expr_t *expr;
+            parse_trivial_expression(&expr, "--message-stop", optarg,
+                                     strlen(optarg), unescape_message_data);
+            /* All of the patterns are looked for at once. */
+            if(!engine_params.message_stop)
+                engine_params.message_stop = tk_multiscan_new();
+            tk_multiscan_add(engine_params.message_stop, expr->u.data.data,
+                             expr->u.data.size);
+            free_expression(expr, 1);
+            break;
+        }
+        case CLI_CHAN_OFFSET + 'd': /* --request-delimiter */
+            parse_trivial_expression(&engine_params.request_delimiter_expr,
+                                     "--request-delimiter", optarg,
+                                     strlen(optarg), unescape_message_data);
+            break;
+        case CLI_CHAN_OFFSET + 'r': /* --response */
+            parse_trivial_expression(&engine_params.response_expr, "--response",
+                                     optarg, strlen(optarg),
+                                     unescape_message_data);
+            break;
+        case CLI_CHAN_OFFSET + 'R': { /* --response-file */
+            char *data;
+            size_t size;
+            if(read_in_file(optarg, &data, &size) != 0) exit(EX_DATAERR);
+            parse_trivial_expression(&engine_params.response_expr,
+                                     "--response-file", data, size,
+                                     unescape_message_data);
+            free(data);
         } break;
         case 'N': /* --nagle {on|off} */
             /* Enabling Nagle toggles off NODELAY */
@@ -530,15 +982,26 @@ main(int argc, char **argv) {
                 exit(EX_USAGE);
             }
             break;
-        case 'C': /* --write-combine {on|off} */
+        case 'C': /* --write-combine {on|off|cork|adaptive} */
             if(strcmp(optarg, "on") == 0) {
                 fprintf(stderr,
                         "NOTE: --write-combine on is a default setting\n");
                 engine_params.write_combine = WRCOMB_ON;
             } else if(strcmp(optarg, "off") == 0) {
                 engine_params.write_combine = WRCOMB_OFF;
+            } else if(strcmp(optarg, "cork") == 0) {
+                engine_params.write_combine = WRCOMB_CORK;
+            } else if(strcmp(optarg, "adaptive") == 0) {
+#ifdef __linux__
+                engine_params.write_combine = WRCOMB_ADAPTIVE;
+#else
+                warning(
+                    "--write-combine adaptive is not supported "
+                    "on this platform\n");
+#endif
             } else {
-                fprintf(stderr, "Expecting --write-combine off\n");
+                fprintf(stderr,
+                        "Expecting --write-combine {off|cork|adaptive}\n");
                 exit(EX_USAGE);
             }
             break;
@@ -552,6 +1015,54 @@ main(int argc, char **argv) {
             }
             engine_params.sock_rcvbuf_size = size;
         } break;
+        case CLI_SOCKET_OPT + 'l': { /* --rcvlowat */
+            long size = parse_with_multipliers(
+                option, optarg, kb_multiplier,
+                sizeof(kb_multiplier) / sizeof(kb_multiplier[0]));
+            if(size <= 0 || size > INT_MAX) {
+                fprintf(stderr, "Expecting --rcvlowat > 0\n");
+                exit(EX_USAGE);
+            }
+#ifdef SO_RCVLOWAT
+            engine_params.sock_rcvlowat = size;
+#else
+            warning("--rcvlowat is not supported on this platform\n");
+#endif
+        } break;
+        case CLI_SOCKET_OPT + 'n': { /* --notsent-lowat */
+            long size = parse_with_multipliers(
+                option, optarg, kb_multiplier,
+                sizeof(kb_multiplier) / sizeof(kb_multiplier[0]));
+            if(size <= 0 || size > INT_MAX) {
+                fprintf(stderr, "Expecting --notsent-lowat > 0\n");
+                exit(EX_USAGE);
+            }
+#ifdef TCP_NOTSENT_LOWAT
+            engine_params.sock_notsent_lowat = size;
+#else
+            warning("--notsent-lowat is not supported on this platform\n");
+#endif
+        } break;
+        case CLI_SOCKET_OPT + 'b': { /* --read-buffer */
+            long size = parse_with_multipliers(
+                option, optarg, kb_multiplier,
+                sizeof(kb_multiplier) / sizeof(kb_multiplier[0]));
+            if(size <= 0) {
+                fprintf(stderr, "Expecting --read-buffer > 0\n");
+                exit(EX_USAGE);
+            }
+            engine_params.read_buffer_size = size;
+        } break;
+        case CLI_SOCKET_OPT + 'B': { /* --read-budget */
+            long size = parse_with_multipliers(
+                option, optarg, kb_multiplier,
+                sizeof(kb_multiplier) / sizeof(kb_multiplier[0]));
+            if(size < 0) {
+                fprintf(stderr, "Expecting --read-budget >= 0\n");
+                exit(EX_USAGE);
+            }
+            engine_params.read_budget = size;
+        } break;
         case CLI_SOCKET_OPT + 'S': { /* --sndbuf */
             long size = parse_with_multipliers(
                 option, optarg, kb_multiplier,
@@ -562,6 +1073,56 @@ main(int argc, char **argv) {
             }
             engine_params.sock_sndbuf_size = size;
         } break;
+        case CLI_SOCKET_OPT + 'Z': /* --zerocopy */
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+            engine_params.zerocopy = 1;
+#else
+            warning("--zerocopy is not supported on this platform\n");
+#endif
+            break;
+        case CLI_SOCKET_OPT + 'z': /* --zerocopy-receive */
+#if defined(TCP_ZEROCOPY_RECEIVE) && defined(__linux__)
+            engine_params.zerocopy_receive = 1;
+#else
+            warning("--zerocopy-receive is not supported on this platform\n");
+#endif
+            break;
+        case CLI_SOCKET_OPT + 'F': /* --sendfile */
+#ifdef __linux__
+            engine_params.sendfile = 1;
+#else
+            warning("--sendfile is not supported on this platform\n");
+#endif
+            break;
+        case CLI_SOCKET_OPT + 'T': /* --tcp-info */
+#if defined(TCP_INFO) && defined(__linux__)
+            engine_params.tcp_info = 1;
+#else
+            warning("--tcp-info is not supported on this platform\n");
+#endif
+            break;
+        case CLI_SOCKET_OPT + 'M': /* --mptcp */
+#if defined(HAVE_LINUX_MPTCP_H) && defined(TCP_INFO)
+            engine_params.mptcp = 1;
+#else
+            warning("--mptcp is not supported on this platform\n");
+#endif
+            break;
+        case CLI_SOCKET_OPT + 'O': /* --tcp-fastopen */
+#if defined(TCP_FASTOPEN_CONNECT) && defined(TCP_INFO)
+            engine_params.tcp_fastopen = TFO_CONNECT;
+#else
+            warning("--tcp-fastopen is not supported on this platform\n");
+#endif
+            break;
+        case CLI_SOCKET_OPT + 'U': /* --udp */
+#ifdef __linux__
+            engine_params.udp = 1;
+#else
+            fprintf(stderr, "--udp is not supported on this platform\n");
+            exit(EX_USAGE);
+#endif
+            break;
         case CLI_STATSD_OFFSET + 'e':
             conf.statsd_enable = 1;
             break;
@@ -588,7 +1149,55 @@ main(int argc, char **argv) {
                 exit(EX_USAGE);
             }
             break;
+        case CLI_STATSD_OFFSET + 's':
+            conf.latency_step = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(conf.latency_step <= 0) {
+                fprintf(stderr, "Expected positive --statsd-latency-step=%s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_STATSD_OFFSET + 'm':
+            conf.statsd_mtu = atoi(optarg);
+            if(conf.statsd_mtu < 128 || conf.statsd_mtu > BATCH_MAX_SIZE) {
+                fprintf(stderr, "--statsd-mtu=%s is not in [128..%d]\n",
+                        optarg, BATCH_MAX_SIZE);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_STATSD_OFFSET + 't':
+            conf.statsd_tags = strdup(optarg);
+            break;
+        case CLI_STATSD_OFFSET + 'M':
+            conf.metrics_listen = strdup(optarg);
+            break;
+        case CLI_STATSD_OFFSET + 'J': /* --json-report */
+            conf.json_report_file = strdup(optarg);
+            break;
+        case CLI_STATSD_OFFSET + 'j': /* --json-stream */
+            conf.json_stream = 1;
+            break;
+        case CLI_STATSD_OFFSET + 'c': /* --compare-to */
+            conf.compare_to = strdup(optarg);
+            break;
+        case CLI_STATSD_OFFSET + 'H': /* --compare-threshold */
+            if(compare_thresholds_parse(&conf.compare_thresholds, optarg)
+               == -1)
+                exit(EX_USAGE);
+            break;
+        case CLI_STATSD_OFFSET + 'D': /* --dashboard */
+            conf.dashboard = 1;
+            break;
         case 'l': {
+            struct sockaddr_storage ss;
+            conf.listen_unix.n_addrs = 0;
+            if(address_parse_unix(optarg, &ss) == 0) {
+                address_add(&conf.listen_unix, (struct sockaddr *)&ss);
+                conf.listen_port = 0;
+                break;
+            }
             const char *port = optarg;
             const char *colon = strchr(optarg, ':');
             if(colon) {
@@ -606,16 +1215,94 @@ main(int argc, char **argv) {
             }
             }
             break;
-        case 'L': /* --listen-mode={silent|active} */
+        case CLI_CONN_OFFSET + 'B': /* --listen-backlog */
+            engine_params.listen_backlog = atoi(optarg);
+            if(engine_params.listen_backlog <= 0) {
+                fprintf(stderr, "Expected positive --listen-backlog=%s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CONN_OFFSET + 'A': /* --accept-batch */
+            engine_params.accept_batch = atoi(optarg);
+            if(engine_params.accept_batch <= 0) {
+                fprintf(stderr, "Expected positive --accept-batch=%s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CONN_OFFSET + 'D': { /* --defer-accept */
+            double secs = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(secs <= 0.0 || secs > INT_MAX) {
+                fprintf(stderr, "Expected positive --defer-accept=%s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+#ifdef TCP_DEFER_ACCEPT
+            /* The kernel takes whole seconds. */
+            engine_params.defer_accept = (int)ceil(secs);
+#else
+            warning("--defer-accept is not supported on this platform\n");
+#endif
+        } break;
+        case CLI_VERBOSE_OFFSET + 'A': { /* --cpu-affinity */
+            int cpus[CPU_AFFINITY_MAX];
+            int n = strcmp(optarg, "auto") == 0
+                        ? cpu_list_auto(cpus, CPU_AFFINITY_MAX)
+                        : cpu_list_parse(optarg, cpus, CPU_AFFINITY_MAX);
+            if(n <= 0) {
+                fprintf(stderr,
+                        "--cpu-affinity=%s: expected \"auto\" or "
+                        "a list of CPUs such as 0-3,8\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            free(engine_params.cpu_affinity);
+            engine_params.cpu_affinity = malloc(n * sizeof(cpus[0]));
+            assert(engine_params.cpu_affinity);
+            memcpy(engine_params.cpu_affinity, cpus, n * sizeof(cpus[0]));
+            engine_params.cpu_affinity_count = n;
+        } break;
+        case CLI_SOCKET_OPT + 'p': /* --busy-poll */
+            engine_params.busy_poll = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(engine_params.busy_poll <= 0.0) {
+                fprintf(stderr, "Expected positive --busy-poll=%s\n", optarg);
+                exit(EX_USAGE);
+            }
+#if defined(USE_LIBUV) || defined(USE_IO_URING)
+            warning("--busy-poll only sets SO_BUSY_POLL without libev\n");
+#endif
+            break;
+        case CLI_SOCKET_OPT + 'P': /* --reuseport-cpu */
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(HAVE_SCHED_GETAFFINITY)
+            engine_params.reuseport_cpu = 1;
+#else
+            warning("--reuseport-cpu is not supported on this platform\n");
+#endif
+            break;
+        case 'L': /* --listen-mode={silent|active|echo|discard|respond} */
             if(strcmp(optarg, "silent") == 0) {
                 engine_params.listen_mode = LMODE_DEFAULT;
-            }
-            if(strcmp(optarg, "active") == 0) {
+            } else if(strcmp(optarg, "active") == 0) {
                 engine_params.listen_mode &= ~_LMODE_SND_MASK;
                 engine_params.listen_mode |= LMODE_ACTIVE;
+            } else if(strcmp(optarg, "echo") == 0) {
+                engine_params.listen_mode &= ~_LMODE_RCV_MASK;
+                engine_params.listen_mode |= LMODE_ECHO;
+            } else if(strcmp(optarg, "discard") == 0) {
+                engine_params.listen_mode &= ~_LMODE_RCV_MASK;
+                engine_params.listen_mode |= LMODE_DISCARD;
+            } else if(strcmp(optarg, "respond") == 0) {
+                engine_params.listen_mode &= ~_LMODE_RCV_MASK;
+                engine_params.listen_mode |= LMODE_RESPOND;
             } else {
                 fprintf(stderr,
-                        "--listen-mode=%s is not one of {silent|active}\n",
+                        "--listen-mode=%s is not one of "
+                        "{silent|active|echo|discard|respond}\n",
                         optarg);
                 exit(EX_USAGE);
             }
@@ -630,46 +1317,568 @@ main(int argc, char **argv) {
                 exit(EX_USAGE);
             }
             break;
-        case CLI_CONN_OFFSET + 'z': /* --delay-send */
-            engine_params.delay_send = parse_with_multipliers(
+        case CLI_CONN_OFFSET + 'r': /* --reconnect */
+            engine_params.reconnect = 1;
+            break;
+        case CLI_CONN_OFFSET + 'b': /* --reconnect-backoff */
+            engine_params.reconnect_backoff = parse_with_multipliers(
                 option, optarg, s_multiplier,
                 sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(engine_params.reconnect_backoff < 0.0) {
+                fprintf(stderr, "Expected non-negative --reconnect-backoff=%s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
             break;
-        case CLI_CHAN_OFFSET + 't':
-            engine_params.channel_lifetime = parse_with_multipliers(
+        case CLI_CONN_OFFSET + 'k': /* --connect-backoff */
+        case CLI_CONN_OFFSET + 'K': { /* --connect-backoff-max */
+            double backoff = parse_with_multipliers(
                 option, optarg, s_multiplier,
                 sizeof(s_multiplier) / sizeof(s_multiplier[0]));
-            if(engine_params.channel_lifetime < 0.0) {
-                fprintf(stderr, "Expected non-negative --channel-lifetime=%s\n",
+            if(!(backoff > 0.0)) {
+                fprintf(stderr, "Expected positive %s=%s\n",
+                        c == CLI_CONN_OFFSET + 'k' ? "--connect-backoff"
+                                                   : "--connect-backoff-max",
                         optarg);
                 exit(EX_USAGE);
             }
+            if(c == CLI_CONN_OFFSET + 'k')
+                engine_params.connect_backoff = backoff;
+            else
+                engine_params.connect_backoff_max = backoff;
+        } break;
+        case CLI_CONN_OFFSET + 'p': /* --load-profile */
+            load_profile_free(conf.load_profile);
+            conf.load_profile = load_profile_read(optarg);
+            if(!conf.load_profile) exit(EX_DATAERR);
             break;
-        case 'W': /* --websocket: Enable WebSocket framing */
-            engine_params.websocket_enable = 1;
+        case CLI_CONN_OFFSET + 'e': /* --scenario */
+            conf.scenario_file = optarg;
             break;
-        case SSL_OPT: /* --ssl: Enable TLS */
-#ifdef HAVE_OPENSSL
-            engine_params.ssl_enable = 1;
-#else
-            fprintf(stderr, "Compiled without TLS support\n");
-            exit(EX_USAGE);
-#endif
+        case CLI_CONN_OFFSET + 'z': /* --delay-send */
+            engine_params.delay_send = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
             break;
-        case SSL_OPT + 'c': /* --ssl-cert: X.509 certificate file */
-#ifdef HAVE_OPENSSL
-            engine_params.ssl_cert = strdup(optarg);
-#else
-            fprintf(stderr, "Compiled without TLS support\n");
-            exit(EX_USAGE);
-#endif
+        case CLI_CHAN_OFFSET + 'S': /* --slow-send */
+            engine_params.slow_send = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(engine_params.slow_send <= 0.0) {
+                fprintf(stderr, "Expected positive --slow-send=%s\n", optarg);
+                exit(EX_USAGE);
+            }
             break;
-        case SSL_OPT + 'k': /* --ssl-key: SSL private key file */
-#ifdef HAVE_OPENSSL
-            engine_params.ssl_key = strdup(optarg);
-#else
+        case CLI_CHAN_OFFSET + 'V': /* --verify-echo */
+            engine_params.verify_echo = 1;
+            break;
+        case CLI_CHAN_OFFSET + 'K': { /* --keepalive-message */
+            size_t size = strlen(optarg);
+            char *data = strdup(optarg);
+            assert(data);
+            if(unescape_message_data) unescape_data(data, &size);
+            if(size == 0
+               || parse_expression(&engine_params.keepalive_expr, data, size, 0)
+                      == -1) {
+                fprintf(stderr, "--keepalive-message: Failed to parse "
+                                "non-empty expression\n");
+                exit(EX_USAGE);
+            }
+            free(data);
+            /* Evaluated once per worker, the frame can't vary. */
+            if(engine_params.keepalive_expr->dynamic_scope != DS_GLOBAL_FIXED) {
+                fprintf(stderr, "--keepalive-message: Per-connection and "
+                                "per-message expressions are not supported\n");
+                exit(EX_USAGE);
+            }
+        } break;
+        case CLI_CHAN_OFFSET + 'I': /* --keepalive-interval */
+            engine_params.keepalive_interval = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(engine_params.keepalive_interval <= 0.0) {
+                fprintf(stderr, "Expected positive --keepalive-interval=%s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CONN_OFFSET + 'd': /* --dns-refresh */
+            conf.dns_refresh = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(conf.dns_refresh <= 0.0) {
+                fprintf(stderr, "Expected positive --dns-refresh=%s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CONN_OFFSET + 's': /* --remote-select */
+            if(strcmp(optarg, "round-robin") == 0) {
+                engine_params.remote_select = RSEL_ROUND_ROBIN;
+            } else if(strcmp(optarg, "weighted") == 0) {
+                engine_params.remote_select = RSEL_WEIGHTED;
+            } else if(strcmp(optarg, "hash") == 0) {
+                engine_params.remote_select = RSEL_HASH;
+            } else if(strcmp(optarg, "least-conn") == 0) {
+                engine_params.remote_select = RSEL_LEAST_CONN;
+            } else if(strcmp(optarg, "least-latency") == 0) {
+                engine_params.remote_select = RSEL_LEAST_LATENCY;
+            } else {
+                fprintf(stderr,
+                        "--remote-select=%s is not one of "
+                        "{round-robin|weighted|hash|least-conn|"
+                        "least-latency}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            conf.remote_select_given = 1;
+            break;
+        case CLI_CONN_OFFSET + 'w': /* --remote-weights */
+            conf.remote_weights = strdup(optarg);
+            break;
+        case CLI_CONN_OFFSET + 'g': /* --connection-group */
+            if(conf.n_groups == UINT16_MAX) {
+                fprintf(stderr, "Too many --connection-group options\n");
+                exit(EX_USAGE);
+            }
+            conf.groups = realloc(conf.groups, (conf.n_groups + 1)
+                                                   * sizeof(conf.groups[0]));
+            conf.group_targets =
+                realloc(conf.group_targets,
+                        (conf.n_groups + 1) * sizeof(conf.group_targets[0]));
+            assert(conf.groups && conf.group_targets);
+            parse_connection_group(optarg, unescape_message_data,
+                                   &conf.groups[conf.n_groups],
+                                   &conf.group_targets[conf.n_groups]);
+            if(!conf.groups[conf.n_groups].name) {
+                char name[32];
+                snprintf(name, sizeof(name), "group%zu", conf.n_groups + 1);
+                conf.groups[conf.n_groups].name = strdup(name);
+            }
+            conf.n_groups++;
+            break;
+        case CLI_CONN_OFFSET + 'v': /* --ab */
+            conf.ab = 1;
+            break;
+        case CLI_CONN_OFFSET + 'x': /* --mirror */
+            conf.mirror = optarg;
+            break;
+        case CLI_CHAN_OFFSET + 't':
+            engine_params.channel_lifetime = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(engine_params.channel_lifetime < 0.0) {
+                fprintf(stderr, "Expected non-negative --channel-lifetime=%s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CHAN_OFFSET + 'L': { /* --channel-lifetime-distribution */
+            const char *end = "";
+            double sigma = 1.0;
+            if(strcmp(optarg, "fixed") == 0) {
+                engine_params.lifetime_distribution.kind = LIFETIME_DIST_FIXED;
+            } else if(strcmp(optarg, "uniform") == 0) {
+                engine_params.lifetime_distribution.kind =
+                    LIFETIME_DIST_UNIFORM;
+            } else if(strcmp(optarg, "exponential") == 0) {
+                engine_params.lifetime_distribution.kind =
+                    LIFETIME_DIST_EXPONENTIAL;
+            } else if(strncmp(optarg, "lognormal", 9) == 0) {
+                engine_params.lifetime_distribution.kind =
+                    LIFETIME_DIST_LOGNORMAL;
+                end = optarg + 9;
+                if(*end == ':') {
+                    const char *p = end + 1;
+                    sigma = strtod(p, (char **)&end);
+                    if(end == p) end = "?";
+                }
+            } else {
+                end = "?";
+            }
+            if(*end || !(sigma > 0.0 && sigma <= 10.0)) {
+                fprintf(stderr,
+                        "--channel-lifetime-distribution=%s is not one of "
+                        "{fixed|uniform|exponential|lognormal[:<sigma>]}, "
+                        "with sigma within (0..10]\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            engine_params.lifetime_distribution.sigma = sigma;
+        } break;
+        case CLI_CHAN_OFFSET + 'C': /* --close-style */
+            if(strcmp(optarg, "graceful") == 0) {
+                engine_params.close_style = CLOSE_GRACEFUL;
+            } else if(strcmp(optarg, "reset") == 0) {
+                engine_params.close_style = CLOSE_RESET;
+            } else if(strcmp(optarg, "half-close") == 0) {
+                engine_params.close_style = CLOSE_HALF;
+            } else if(strcmp(optarg, "wait-peer") == 0) {
+                engine_params.close_style = CLOSE_WAIT_PEER;
+            } else {
+                fprintf(stderr,
+                        "--close-style=%s is not one of "
+                        "{graceful|reset|half-close|wait-peer}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CHAN_OFFSET + 'a': /* --message-arrival */
+            if(strcmp(optarg, "uniform") == 0) {
+                engine_params.message_arrival = ARRIVAL_UNIFORM;
+            } else if(strcmp(optarg, "poisson") == 0) {
+                engine_params.message_arrival = ARRIVAL_POISSON;
+            } else {
+                fprintf(stderr,
+                        "--message-arrival=%s is not one of "
+                        "{uniform|poisson}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CHAN_OFFSET + 'j': { /* --message-rate-jitter */
+            engine_params.send_phase_jitter = 1;
+            if(strcmp(optarg, "phase") == 0) break;
+            char *end;
+            double fraction = strtod(optarg, &end);
+            if(end == optarg || *end || !(fraction > 0.0 && fraction <= 1.0)) {
+                fprintf(stderr,
+                        "--message-rate-jitter=%s is not \"phase\" "
+                        "or a fraction within (0..1]\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            engine_params.send_interval_jitter = fraction;
+        } break;
+        case CLI_CHAN_OFFSET + 'e': /* --burst */
+            engine_params.send_burst = parse_with_multipliers(
+                option, optarg, km_multiplier,
+                sizeof(km_multiplier) / sizeof(km_multiplier[0]));
+            if(engine_params.send_burst <= 0.0) {
+                fprintf(stderr, "Expecting positive --burst value\n");
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CHAN_OFFSET + 'n': /* --burst-every */
+            engine_params.burst_every = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(engine_params.burst_every < 0.001) {
+                fprintf(stderr, "Expecting --burst-every of 1ms or more\n");
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CHAN_OFFSET + 'z': { /* --burst-size */
+            double size = parse_with_multipliers(
+                option, optarg, km_multiplier,
+                sizeof(km_multiplier) / sizeof(km_multiplier[0]));
+            if(size < 1 || size > UINT_MAX || size != (unsigned)size) {
+                fprintf(stderr, "Expecting positive integer --burst-size\n");
+                exit(EX_USAGE);
+            }
+            engine_params.burst_size = size;
+        } break;
+        case CLI_CHAN_OFFSET + 'i': { /* --send-budget */
+            double budget = parse_with_multipliers(
+                option, optarg, km_multiplier,
+                sizeof(km_multiplier) / sizeof(km_multiplier[0]));
+            if(budget < 1 || budget > UINT_MAX || budget != (unsigned)budget) {
+                fprintf(stderr, "Expecting positive integer --send-budget\n");
+                exit(EX_USAGE);
+            }
+            engine_params.send_budget = budget;
+        } break;
+        case CLI_CHAN_OFFSET + 'U': /* --catch-up */
+            if(strcmp(optarg, "drop") == 0) {
+                engine_params.send_catchup = PACE_CATCHUP_DROP;
+            } else if(strcmp(optarg, "smooth") == 0) {
+                engine_params.send_catchup = PACE_CATCHUP_SMOOTH;
+            } else if(strcmp(optarg, "full") == 0) {
+                engine_params.send_catchup = PACE_CATCHUP_FULL;
+            } else {
+                fprintf(stderr,
+                        "--catch-up=%s is not one of "
+                        "{drop|smooth|full}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            conf.catchup_set = 1;
+            break;
+        case CLI_CHAN_OFFSET + 'Z': { /* --message-rate-distribution */
+            char *end = NULL;
+            double param = 0.0;
+            if(strncmp(optarg, "zipf:", 5) == 0) {
+                engine_params.rate_distribution.kind = RATE_DIST_ZIPF;
+                param = strtod(optarg + 5, &end);
+            } else if(strncmp(optarg, "pareto:", 7) == 0) {
+                engine_params.rate_distribution.kind = RATE_DIST_PARETO;
+                param = strtod(optarg + 7, &end);
+            }
+            if(!end || *end || end == strchr(optarg, ':') + 1
+               || !(param > 0.0 && param <= 100.0)) {
+                fprintf(stderr,
+                        "--message-rate-distribution=%s is not one of "
+                        "{zipf:<s>|pareto:<a>}, with s, a within (0..100]\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            engine_params.rate_distribution.param = param;
+        } break;
+        case CLI_CHAN_OFFSET + 'c': /* --rate-control */
+            if(strcmp(optarg, "search") == 0) {
+                rate_modulator.controller = RMC_SEARCH;
+            } else if(strcmp(optarg, "pi") == 0) {
+                rate_modulator.controller = RMC_PI;
+            } else {
+                fprintf(stderr,
+                        "--rate-control=%s is not one of "
+                        "{search|pi}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CHAN_OFFSET + 's': /* --rate-scope */
+            if(strcmp(optarg, "connection") == 0) {
+                engine_params.rate_scope = RATE_SCOPE_CONNECTION;
+            } else if(strcmp(optarg, "total") == 0) {
+                engine_params.rate_scope = RATE_SCOPE_TOTAL;
+            } else {
+                fprintf(stderr,
+                        "--rate-scope=%s is not one of "
+                        "{connection|total}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CHAN_OFFSET + 'k': /* --kernel-pacing */
+#ifdef SO_MAX_PACING_RATE
+            engine_params.kernel_pacing = 1;
+#else
+            warning("--kernel-pacing is not supported on this platform\n");
+#endif
+            break;
+        case CLI_CHAN_OFFSET + 'g': /* --timer-granularity */
+            engine_params.timer_granularity = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(engine_params.timer_granularity <= 0.0
+               || engine_params.timer_granularity > 1.0) {
+                fprintf(stderr,
+                        "Expecting --timer-granularity within (0..1s]\n");
+                exit(EX_USAGE);
+            }
+            break;
+        case 'W': /* --websocket: Enable WebSocket framing */
+            engine_params.websocket_enable = 1;
+            break;
+        case CLI_CHAN_OFFSET + 'h': /* --http */
+            engine_params.http_enable = 1;
+            break;
+        case CLI_CHAN_OFFSET + 'f': { /* --framing */
+            /* lenprefix[:<bytes>[:be|le]] */
+            const char *p = optarg;
+            unsigned long prefix_size = 4;
+            int little_endian = 0;
+            int ok = strncmp(p, "lenprefix", sizeof("lenprefix") - 1) == 0;
+            if(ok) p += sizeof("lenprefix") - 1;
+            if(ok && *p == ':') {
+                char *end;
+                prefix_size = strtoul(p + 1, &end, 10);
+                ok = end != p + 1;
+                p = end;
+            }
+            if(ok && *p == ':') {
+                p++;
+                if(strncmp(p, "be", 2) == 0) {
+                    little_endian = 0;
+                } else if(strncmp(p, "le", 2) == 0) {
+                    little_endian = 1;
+                } else {
+                    ok = 0;
+                }
+                p += 2;
+            }
+            if(!ok || *p
+               || (prefix_size != 1 && prefix_size != 2 && prefix_size != 4
+                   && prefix_size != 8)) {
+                fprintf(stderr,
+                        "--framing=%s is not "
+                        "lenprefix[:{1|2|4|8}[:{be|le}]]\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            engine_params.framing_prefix_size = prefix_size;
+            engine_params.framing_little_endian = little_endian;
+        } break;
+        case CLI_CHAN_OFFSET + 'F': /* --framer */
+            engine_params.framer = framer_load(optarg);
+            if(!engine_params.framer) exit(EX_USAGE);
+            break;
+        case CLI_CHAN_OFFSET + 'm': /* --message-corpus */
+            corpus_file = optarg;
+            break;
+        case CLI_CHAN_OFFSET + 'o': /* --message-corpus-order */
+            if(strcmp(optarg, "sequential") == 0) {
+                corpus_shuffle = 0;
+            } else if(strcmp(optarg, "random") == 0) {
+                corpus_shuffle = 1;
+            } else {
+                fprintf(stderr,
+                        "--message-corpus-order=%s is not one of "
+                        "{sequential|random}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CHAN_OFFSET + 'y': /* --replay-pcap */
+            replay_pcap_file = optarg;
+            break;
+        case CLI_CHAN_OFFSET + 'Y': /* --replay-timing */
+            if(strcmp(optarg, "asap") == 0) {
+                engine_params.replay_original_timing = 0;
+            } else if(strcmp(optarg, "original") == 0) {
+                engine_params.replay_original_timing = 1;
+            } else {
+                fprintf(stderr,
+                        "--replay-timing=%s is not one of "
+                        "{asap|original}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CHAN_OFFSET + '2': /* --http2 */
+            engine_params.http2_enable = 1;
+            break;
+        case CLI_CHAN_OFFSET + 'B': /* --grpc-stream */
+            engine_params.grpc_stream = 1;
+            /* FALL THROUGH */
+        case CLI_CHAN_OFFSET + 'G': /* --grpc */
+            engine_params.grpc_enable = 1;
+            engine_params.http2_enable = 1;
+            break;
+        case CLI_CHAN_OFFSET + 'P': /* --resp */
+            engine_params.resp_enable = 1;
+            break;
+        case CLI_CHAN_OFFSET + 'Q': /* --mqtt */
+            if(!engine_params.mqtt_version)
+                engine_params.mqtt_version = MQTT_V311;
+            break;
+        case CLI_CHAN_OFFSET + 'v': /* --mqtt-version */
+            if(strcmp(optarg, "3.1.1") == 0) {
+                engine_params.mqtt_version = MQTT_V311;
+            } else if(strcmp(optarg, "5") == 0) {
+                engine_params.mqtt_version = MQTT_V5;
+            } else {
+                fprintf(stderr, "Expected --mqtt-version 3.1.1 or 5\n");
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CHAN_OFFSET + 'u':   /* --mqtt-topic */
+        case CLI_CHAN_OFFSET + 'b': { /* --mqtt-subscribe */
+            tk_expr_t **expr = c == CLI_CHAN_OFFSET + 'u'
+                                   ? &engine_params.mqtt_topic_expr
+                                   : &engine_params.mqtt_subscribe_expr;
+            size_t size = strlen(optarg);
+            if(size == 0 || size > 65535
+               || parse_expression(expr, optarg, size, 0) == -1) {
+                fprintf(stderr, "--%s: Failed to parse non-empty topic\n",
+                        cli_long_options[longindex].name);
+                exit(EX_USAGE);
+            }
+            /* Evaluated once per connection, for its CONNECT. */
+            if((*expr)->dynamic_scope > DS_PER_CONNECTION) {
+                fprintf(stderr, "--%s: Per-message expressions "
+                                "are not supported\n",
+                        cli_long_options[longindex].name);
+                exit(EX_USAGE);
+            }
+        } break;
+        case CLI_CHAN_OFFSET + 'q': /* --mqtt-qos */
+            if(strcmp(optarg, "0") && strcmp(optarg, "1")) {
+                fprintf(stderr, "Expected --mqtt-qos 0 or 1\n");
+                exit(EX_USAGE);
+            }
+            engine_params.mqtt_qos = atoi(optarg);
+            break;
+        case CLI_CHAN_OFFSET + 'p': { /* --pipeline, --outstanding */
+            int n = atoi(optarg);
+            if(n < 1) {
+                fprintf(stderr, "Expected --%s <N> >= 1\n",
+                        cli_long_options[longindex].name);
+                exit(EX_USAGE);
+            }
+            engine_params.pipeline = n;
+        } break;
+        case CLI_CHAN_OFFSET + 'T': /* --think-time */
+            engine_params.think_time = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(engine_params.think_time <= 0.0) {
+                fprintf(stderr, "Expected positive --think-time=%s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CHAN_OFFSET + 'D': /* --websocket-deflate */
+#ifdef HAVE_LIBZ
+            websocket_deflate = 1;
+            break;
+#else
+            fprintf(stderr,
+                    "--websocket-deflate requires zlib, "
+                    "which is not compiled in\n");
+            exit(EX_USAGE);
+#endif
+        case CLI_CHAN_OFFSET + 'W': /* --websocket-mask */
+            if(strcmp(optarg, "zero") == 0) {
+                websocket_mask_random = 0;
+            } else if(strcmp(optarg, "random") == 0) {
+                websocket_mask_random = 1;
+            } else {
+                fprintf(stderr,
+                        "--websocket-mask=%s is not one of {zero|random}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case SSL_OPT: /* --ssl: Enable TLS */
+#ifdef HAVE_OPENSSL
+            engine_params.ssl_enable = 1;
+#else
+            fprintf(stderr, "Compiled without TLS support\n");
+            exit(EX_USAGE);
+#endif
+            break;
+        case SSL_OPT + 'c': /* --ssl-cert: X.509 certificate file */
+#ifdef HAVE_OPENSSL
+            engine_params.ssl_cert = strdup(optarg);
+#else
+            fprintf(stderr, "Compiled without TLS support\n");
+            exit(EX_USAGE);
+#endif
+            break;
+        case SSL_OPT + 'k': /* --ssl-key: SSL private key file */
+#ifdef HAVE_OPENSSL
+            engine_params.ssl_key = strdup(optarg);
+#else
+            fprintf(stderr, "Compiled without TLS support\n");
+            exit(EX_USAGE);
+#endif
+            break;
+        case SSL_OPT + 'r': /* --ssl-session-reuse */
+#ifdef HAVE_OPENSSL
+            engine_params.ssl_session_reuse = 1;
+#else
             fprintf(stderr, "Compiled without TLS support\n");
             exit(EX_USAGE);
+#endif
+            break;
+        case SSL_OPT + 'K': /* --ssl-ktls */
+#if defined(HAVE_OPENSSL) && defined(SSL_OP_ENABLE_KTLS)
+            engine_params.ssl_ktls = 1;
+#else
+            fprintf(stderr, "--ssl-ktls requires OpenSSL 3 built with kTLS\n");
+            exit(EX_USAGE);
 #endif
             break;
         case CLI_LATENCY + 'c': /* --latency-connect */
@@ -678,6 +1887,12 @@ main(int argc, char **argv) {
         case CLI_LATENCY + 'f': /* --latency-first-byte */
             engine_params.latency_setting |= SLT_FIRSTBYTE;
             break;
+        case CLI_LATENCY + 'h': /* --latency-handshake */
+            engine_params.latency_setting |= SLT_HANDSHAKE;
+            break;
+        case CLI_LATENCY + 'u': /* --latency-upgrade */
+            engine_params.latency_setting |= SLT_UPGRADE;
+            break;
         case CLI_LATENCY + 'm': { /* --latency-marker */
             if(engine_params.message_marker) {
                 fprintf(stderr,
@@ -712,23 +1927,223 @@ main(int argc, char **argv) {
                 exit(EX_USAGE);
             }
         } break;
-        case CLI_LATENCY + 'p': { /* --latency-percentiles */
-            if(parse_percentile_values(cli_long_options[longindex].name,
-                                       optarg, &latency_percentiles))
+        case CLI_LATENCY + 'e': { /* --latency-sample */
+            const char *n = optarg;
+            if(strncmp(n, "1/", 2) == 0) n += 2;
+            char *end;
+            unsigned long every = strtoul(n, &end, 10);
+            if(*n < '0' || *n > '9' || *end || every < 1
+               || every > UINT_MAX) {
+                fprintf(stderr,
+                        "--latency-sample: Expected 1/<N> "
+                        "or <N> messages\n");
                 exit(EX_USAGE);
+            }
+            engine_params.latency_sample = every;
         } break;
-        case 'I': { /* --source-ip */
-            if(add_source_ip(&engine_params.source_addresses, optarg) < 0) {
-                fprintf(stderr, "--source-ip=%s: local IP address expected\n",
+        case CLI_LATENCY + 'L': /* --latency-log */
+            conf.latency_log_file = strdup(optarg);
+            break;
+        case CLI_STATSD_OFFSET + 'T': /* --timeseries */
+            conf.timeseries_file = strdup(optarg);
+            break;
+        case CLI_STATSD_OFFSET + 'C': /* --timeseries-csv */
+            if(timeseries_write_csv(optarg, stdout) == -1) {
+                fprintf(stderr, "--timeseries-csv %s: %s\n", optarg,
+                        errno == EINVAL ? "Not a --timeseries file"
+                                        : strerror(errno));
+                exit(EX_NOINPUT);
+            }
+            exit(0);
+        case CLI_STATSD_OFFSET + 'I': /* --sample-interval */
+            engine_params.sample_interval = parse_with_multipliers(
+                option, optarg, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(engine_params.sample_interval < 0.001
+               || engine_params.sample_interval > 1.0) {
+                fprintf(stderr,
+                        "Expecting --sample-interval within [1ms..1s]\n");
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_STATSD_OFFSET + 'S': /* --shm-stats */
+            conf.shm_stats_name = strdup(optarg);
+            break;
+        case CLI_STATSD_OFFSET + 'A': /* --aggregate */
+            exit(shm_stats_aggregate(optarg));
+        case CLI_LATENCY + 'P': /* --latency-per-connection */
+            engine_params.latency_per_connection = 1;
+            break;
+        case CLI_LATENCY + 'z': /* --latency-by-size */
+            engine_params.latency_by_size = 1;
+            break;
+        case CLI_LATENCY + 'S': /* --latency-slowest */
+            engine_params.latency_slowest = parse_with_multipliers(
+                option, optarg, km_multiplier,
+                sizeof(km_multiplier) / sizeof(km_multiplier[0]));
+            if(engine_params.latency_slowest <= 0
+               || engine_params.latency_slowest > 10000) {
+                fprintf(stderr,
+                        "--latency-slowest: "
+                        "Expected a number of messages, 1..10000\n");
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_LATENCY + 'C': /* --latency-correction */
+            if(strcmp(optarg, "off") == 0) {
+                engine_params.latency_correction = LCM_OFF;
+            } else if(strcmp(optarg, "on") == 0) {
+                engine_params.latency_correction = LCM_ON;
+            } else if(strcmp(optarg, "both") == 0) {
+                engine_params.latency_correction = LCM_BOTH;
+            } else {
+                fprintf(stderr,
+                        "--latency-correction=%s is not one of "
+                        "{off|on|both}\n",
                         optarg);
                 exit(EX_USAGE);
             }
-        } break;
-        case 'S': { /* --server */
-            orch_args.enabled = 1;
-            orch_args.server_addr_str = strdup(optarg);
-            resolve_address(optarg, &orch_args.server_addrs);
-        } break;
+            break;
+        case CLI_LATENCY + 'T': /* --latency-timestamping */
+            if(strcmp(optarg, "off") == 0) {
+                engine_params.latency_timestamping = LTS_OFF;
+            } else if(strcmp(optarg, "software") == 0) {
+                engine_params.latency_timestamping = LTS_SOFTWARE;
+            } else if(strcmp(optarg, "hardware") == 0) {
+                engine_params.latency_timestamping = LTS_HARDWARE;
+            } else {
+                fprintf(stderr,
+                        "--latency-timestamping=%s is not one of "
+                        "{off|software|hardware}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+#if !defined(SO_TIMESTAMPING) || !defined(__linux__)
+            if(engine_params.latency_timestamping != LTS_OFF) {
+                warning("--latency-timestamping is not supported "
+                        "on this platform\n");
+                engine_params.latency_timestamping = LTS_OFF;
+            }
+#endif
+            break;
+        case CLI_LATENCY + 'M': /* --message-marker-format */
+            if(strcmp(optarg, "text") == 0) {
+                engine_params.message_marker_binary = 0;
+            } else if(strcmp(optarg, "binary") == 0) {
+                engine_params.message_marker_binary = 1;
+            } else {
+                fprintf(stderr,
+                        "--message-marker-format=%s is not one of "
+                        "{text|binary}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_LATENCY + 'F': /* --fanout */
+            engine_params.fanout = 1;
+            engine_params.message_marker_binary = 1;
+            break;
+        case CLI_LATENCY + 'k': /* --latency-clock */
+            if(tk_clock_source_from_string(optarg,
+                                           &engine_params.latency_clock)
+               == -1) {
+                fprintf(stderr,
+                        "--latency-clock=%s is not one of "
+                        "{realtime|cached|monotonic}\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_LATENCY + 'o': { /* --clock-offset */
+            /* The -1 stands for a parse error, so the sign goes aside. */
+            int negative = (optarg[0] == '-');
+            double offset = parse_with_multipliers(
+                option, optarg + negative, fine_s_multiplier,
+                sizeof(fine_s_multiplier) / sizeof(fine_s_multiplier[0]));
+            if(!(offset >= 0 && offset <= 3600)) {
+                fprintf(stderr,
+                        "Expecting --clock-offset=[-]<Time> within an hour, "
+                        "such as 1.5ms\n");
+                exit(EX_USAGE);
+            }
+            engine_params.clock_offset_ns = (negative ? -1e9 : 1e9) * offset;
+            conf.clock_offset_set = 1;
+        } break;
+        case CLI_LATENCY + 'y': /* --clock-sync */
+            conf.clock_sync = 1;
+            break;
+        case CLI_LATENCY + 'r': { /* --latency-resolution */
+            double resolution = parse_with_multipliers(
+                option, optarg, fine_s_multiplier,
+                sizeof(fine_s_multiplier) / sizeof(fine_s_multiplier[0]));
+            if(!(resolution >= 1e-9 && resolution <= 1.0)) {
+                fprintf(stderr,
+                        "--latency-resolution=%s: "
+                        "Expected time from 1ns to 1s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            latency_units_per_second = 1.0 / resolution;
+        } break;
+        case CLI_LATENCY + 'x': /* --latency-max */
+            engine_params.latency_max = parse_with_multipliers(
+                option, optarg, fine_s_multiplier,
+                sizeof(fine_s_multiplier) / sizeof(fine_s_multiplier[0]));
+            if(engine_params.latency_max <= 0) {
+                fprintf(stderr, "Expected positive --latency-max=%s\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_LATENCY + 'p': { /* --latency-percentiles */
+            if(parse_percentile_values(cli_long_options[longindex].name,
+                                       optarg, &latency_percentiles))
+                exit(EX_USAGE);
+        } break;
+        case 'I': { /* --source-ip */
+            if(add_source_ip(&engine_params.source_addresses, optarg) < 0) {
+                fprintf(stderr, "--source-ip=%s: local IP address expected\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+        } break;
+        case CLI_CONN_OFFSET + '6': /* --source-ipv6-prefix */
+            if(address_parse_ipv6_prefix(optarg,
+                                         &engine_params.source_prefix,
+                                         &engine_params.source_prefix_len)
+               < 0) {
+                fprintf(stderr,
+                        "--source-ipv6-prefix=%s: IPv6 prefix/length "
+                        "expected\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CONN_OFFSET + 'P': /* --proxy-protocol */
+            if(strcmp(optarg, "v1") == 0) {
+                engine_params.proxy_protocol = PROXY_PROTOCOL_V1;
+            } else if(strcmp(optarg, "v2") == 0) {
+                engine_params.proxy_protocol = PROXY_PROTOCOL_V2;
+            } else {
+                fprintf(stderr, "--proxy-protocol=%s: expected v1 or v2\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case CLI_CONN_OFFSET + 'S': /* --proxy-source */
+            if(proxy_source_parse(optarg, &engine_params.proxy_source) < 0) {
+                fprintf(stderr,
+                        "--proxy-source=%s: IP address or prefix/length "
+                        "expected\n",
+                        optarg);
+                exit(EX_USAGE);
+            }
+            break;
+        case 'S': { /* --server */
+            orch_args.enabled = 1;
+            orch_args.server_addr_str = strdup(optarg);
+            resolve_address(optarg, &orch_args.server_addrs);
+        } break;
         default:
             fprintf(stderr, "%s: unknown option\n", option);
             usage_long(argv[0], &default_config);
@@ -736,7 +2151,193 @@ main(int argc, char **argv) {
         }
     }
 
+    /*
+     * The --scenario phases are played with a load profile, starting from
+     * the values given on the command line.
+     */
+    if(conf.scenario_file) {
+        if(conf.load_profile) {
+            fprintf(stderr,
+                    "--scenario is not compatible with --load-profile\n");
+            exit(EX_USAGE);
+        }
+        double initial[_LPP_MAX] = {
+            [LPP_CONNECTIONS] = conf.max_connections,
+            [LPP_CONNECT_RATE] = conf.connect_rate,
+            [LPP_MESSAGE_RATE] = engine_params.channel_send_rate.value_base
+                                         == RS_MESSAGES_PER_SECOND
+                                     ? engine_params.channel_send_rate.value
+                                     : -1};
+        conf.scenario = scenario_read(conf.scenario_file, initial);
+        if(!conf.scenario) exit(EX_DATAERR);
+        conf.load_profile = conf.scenario->profile;
+        conf.test_duration = conf.scenario->duration;
+    }
+
+    /*
+     * The --processes only report their final numbers to the parent.
+     */
+    if(conf.processes > 1) {
+        const char *incompatible = NULL;
+        if(orch_args.enabled)
+            incompatible = "--server";
+        else if(conf.load_profile)
+            incompatible = conf.scenario ? "--scenario" : "--load-profile";
+        else if(conf.statsd_enable)
+            incompatible = "--statsd";
+        else if(conf.metrics_listen)
+            incompatible = "--metrics-listen";
+        else if(conf.latency_log_file)
+            incompatible = "--latency-log";
+        else if(conf.timeseries_file)
+            incompatible = "--timeseries";
+        else if(engine_params.sample_interval > 0.0)
+            incompatible = "--sample-interval";
+        else if(engine_params.fanout)
+            incompatible = "--fanout";
+        else if(engine_params.connstats_file)
+            incompatible = "--per-connection-stats";
+        else if(engine_params.peer_stats)
+            incompatible = "--per-peer-stats";
+        else if(conf.json_stream)
+            incompatible = "--json-stream";
+        else if(conf.dashboard)
+            incompatible = "--dashboard";
+        else if(conf.dns_refresh > 0.0)
+            incompatible = "--dns-refresh";
+        else if(rate_modulator.mode != RM_UNMODULATED)
+            incompatible = "--message-rate @<Latency>";
+        else if(connection_modulator.mode == CM_MAX_CONNECTIONS)
+            incompatible = "--find-max-connections";
+        else if(connection_modulator.mode == CM_MAX_CONNECT_RATE)
+            incompatible = "--find-max-connect-rate";
+        else if(engine_params.reuseport_cpu)
+            incompatible = "--reuseport-cpu";
+        else if(engine_params.cpu_affinity)
+            incompatible = "--cpu-affinity";
+        else if(conf.compare_to)
+            incompatible = "--compare-to";
+        else if(conf.clock_sync)
+            incompatible = "--clock-sync";
+        if(incompatible) {
+            fprintf(stderr, "--processes is not compatible with %s\n",
+                    incompatible);
+            exit(EX_USAGE);
+        }
+    }
+
+    /*
+     * The --ab destinations are taken by two equal groups, A and B,
+     * which send the same messages from the same workers.
+     */
+    if(conf.ab) {
+        const char *incompatible = NULL;
+        if(conf.n_groups)
+            incompatible = "--connection-group";
+        else if(conf.remote_weights)
+            incompatible = "--remote-weights";
+        else if(conf.dns_refresh > 0.0)
+            incompatible = "--dns-refresh";
+        if(incompatible) {
+            fprintf(stderr, "--ab is not compatible with %s\n", incompatible);
+            exit(EX_USAGE);
+        }
+        if(argc - optind != 2) {
+            fprintf(stderr, "--ab requires the two <host:port> destinations, "
+                            "A and B\n");
+            exit(EX_USAGE);
+        }
+        conf.groups = calloc(2, sizeof(conf.groups[0]));
+        conf.group_targets = calloc(2, sizeof(conf.group_targets[0]));
+        assert(conf.groups && conf.group_targets);
+        for(int g = 0; g < 2; g++) {
+            conf.groups[g].name = g ? "B" : "A";
+            conf.groups[g].share = 1.0;
+            conf.groups[g].channel_lifetime = NAN;
+        }
+        conf.n_groups = 2;
+    }
+
+    /*
+     * The --connection-group connections share the workers, though not
+     * the per-connection state the following options need.
+     */
+    if(conf.n_groups) {
+        const char *incompatible = NULL;
+        if(conf.processes > 1)
+            incompatible = "--processes";
+        else if(engine_params.rate_scope == RATE_SCOPE_TOTAL)
+            incompatible = "--rate-scope total";
+        else if(engine_params.message_arrival == ARRIVAL_POISSON)
+            incompatible = "--message-arrival poisson";
+        else if(rate_modulator.mode != RM_UNMODULATED)
+            incompatible = "--message-rate @<Latency>";
+        else if(engine_params.http2_enable)
+            incompatible = "--http2";
+        else if(replay_pcap_file)
+            incompatible = "--replay-pcap";
+        else if(corpus_file)
+            incompatible = "--message-corpus";
+        else if(engine_params.udp)
+            incompatible = "--udp";
+        if(incompatible) {
+            fprintf(stderr, "%s is not compatible with %s\n",
+                    conf.ab ? "--ab" : "--connection-group", incompatible);
+            exit(EX_USAGE);
+        }
+        if(argc - optind == 0) {
+            fprintf(stderr, "--connection-group requires the <host:port> "
+                            "destinations\n");
+            exit(EX_USAGE);
+        }
+
+        double shares = 0.0;
+        for(size_t g = 0; g < conf.n_groups; g++) {
+            shares += conf.groups[g].share;
+            if(isnan(conf.groups[g].channel_lifetime))
+                conf.groups[g].channel_lifetime =
+                    engine_params.channel_lifetime;
+            if(conf.group_targets[g].n_hostports && conf.dns_refresh > 0.0) {
+                fprintf(stderr, "--connection-group target= is not "
+                                "compatible with --dns-refresh\n");
+                exit(EX_USAGE);
+            }
+        }
+        for(size_t g = 0; g < conf.n_groups; g++)
+            conf.groups[g].share /= shares;
+        engine_params.groups = conf.groups;
+        engine_params.n_groups = conf.n_groups;
+    }
+
+    /*
+     * The --mirror twins take a copy of the data the connections write
+     * through the plain write path, and have no protocol state of their own.
+     */
+    if(conf.mirror) {
+        const char *incompatible = NULL;
+        if(engine_params.ssl_enable)
+            incompatible = "--ssl";
+        else if(engine_params.http2_enable)
+            incompatible = "--http2";
+        else if(engine_params.udp)
+            incompatible = "--udp";
+        else if(engine_params.sendfile)
+            incompatible = "--sendfile";
+        else if(engine_params.rebalance)
+            incompatible = "--rebalance";
+        if(incompatible) {
+            fprintf(stderr, "--mirror is not compatible with %s\n",
+                    incompatible);
+            exit(EX_USAGE);
+        }
+        if(argc - optind == 0) {
+            fprintf(stderr, "--mirror requires the <host:port> destinations\n");
+            exit(EX_USAGE);
+        }
+    }
+
     struct orchestration_data orch_state = {.connected = 0};
+    uint64_t orch_start_at = 0; /* Synchronized start, usec since Epoch */
     if(orch_args.enabled) {
         orch_state = tcpkali_connect_to_orch_server(orch_args);
         if(!orch_state.connected) {
@@ -756,6 +2357,8 @@ main(int argc, char **argv) {
         }
 
         fprintf(stderr, "Received start command from server\n");
+        if(msg->choice.start.startAt)
+            orch_start_at = *msg->choice.start.startAt;
 
         /* Here we should read all the arguments from the start command
          * and override command line arguments if needed but it's
@@ -764,7 +2367,7 @@ main(int argc, char **argv) {
          */
     }
 
-    int print_stats = isatty(1);
+    int print_stats = isatty(1) && conf.processes <= 1;
     if(print_stats) {
         const char *note = 0;
         if(tcpkali_init_terminal(&note) == -1) {
@@ -772,6 +2375,53 @@ main(int argc, char **argv) {
             print_stats = 0;
         }
     }
+    if(conf.dashboard) {
+        if(conf.json_stream) {
+            fprintf(stderr,
+                    "--dashboard is not compatible with --json-stream\n");
+            exit(EX_USAGE);
+        }
+        if(!print_stats) {
+            warning("--dashboard is ignored without a terminal.\n");
+            conf.dashboard = 0;
+        }
+    }
+
+    /*
+     * The --load-profile values override the fixed ones. The system limits
+     * are checked against the largest number of connections in the profile.
+     */
+    if(conf.load_profile) {
+        double value;
+        if(load_profile_max(conf.load_profile, LPP_CONNECTIONS, &value) == 0)
+            conf.max_connections = value + 0.5;
+        if(load_profile_value(conf.load_profile, LPP_CONNECT_RATE, 0, &value)
+               == 0
+           && value > 0)
+            conf.connect_rate = value;
+        if(load_profile_value(conf.load_profile, LPP_MESSAGE_RATE, 0, &value)
+           == 0) {
+            if(rate_modulator.mode != RM_UNMODULATED
+               || engine_params.channel_send_rate.value_base
+                      == RS_BYTES_PER_SECOND) {
+                fprintf(stderr,
+                        "%s message-rate is incompatible with "
+                        "--message-rate @<Latency> and "
+                        "--channel-bandwidth-upstream.\n",
+                        conf.scenario ? "--scenario" : "--load-profile");
+                exit(EX_USAGE);
+            }
+            engine_params.channel_send_rate = RATE_MPS(value < 0.1 ? 0.1 : value);
+        }
+    }
+
+    /* The profiles play from the start, the warmup included. */
+    if(conf.load_profile && conf.warmup >= conf.test_duration) {
+        fprintf(stderr, "--warmup=%g exceeds the %s duration %g\n",
+                conf.warmup, conf.scenario ? "--scenario" : "--load-profile",
+                conf.test_duration);
+        exit(EX_USAGE);
+    }
 
     /* Check that -H,--header is not given without --ws,--websocket */
     if(conf.http_headers.offset > 0 && !engine_params.websocket_enable) {
@@ -779,12 +2429,375 @@ main(int argc, char **argv) {
         exit(EX_USAGE);
     }
 
+    /*
+     * --mqtt sends its own CONNECT first, then the --message is
+     * the payload of the PUBLISH packets.
+     */
+    if(engine_params.mqtt_version) {
+        const char *incompatible = NULL;
+        if(engine_params.websocket_enable)
+            incompatible = "--websocket";
+        else if(engine_params.http_enable)
+            incompatible = "--http";
+        else if(engine_params.http2_enable)
+            incompatible = "--http2";
+        else if(engine_params.resp_enable)
+            incompatible = "--resp";
+        else if(engine_params.framing_prefix_size)
+            incompatible = "--framing";
+        else if(engine_params.framer)
+            incompatible = "--framer";
+        else if(replay_pcap_file)
+            incompatible = "--replay-pcap";
+        else if(corpus_file)
+            incompatible = "--message-corpus";
+        else if(engine_params.keepalive_expr)
+            incompatible = "--keepalive-message (PINGREQ is sent)";
+        else if(engine_params.verify_echo)
+            incompatible = "--verify-echo";
+        else if(engine_params.sendfile)
+            incompatible = "--sendfile";
+        else if(engine_params.udp)
+            incompatible = "--udp";
+        if(incompatible) {
+            fprintf(stderr, "--mqtt is not compatible with %s\n",
+                    incompatible);
+            exit(EX_USAGE);
+        }
+        size_t payloads = 0;
+        struct message_collection *mc = &engine_params.message_collection;
+        for(size_t i = 0; i < mc->snippets_count; i++) {
+            switch(MSK_PURPOSE(&mc->snippets[i])) {
+            case MSK_PURPOSE_MESSAGE:
+                payloads++;
+                break;
+            default:
+                fprintf(stderr,
+                        "--mqtt is incompatible with --first-message\n");
+                exit(EX_USAGE);
+            }
+        }
+        if(payloads > 1) {
+            fprintf(stderr,
+                    "--mqtt requires at most a single PUBLISH payload "
+                    "in --message\n");
+            exit(EX_USAGE);
+        }
+        if(!engine_params.mqtt_topic_expr) {
+            int res = parse_expression(&engine_params.mqtt_topic_expr,
+                                       "tcpkali", sizeof("tcpkali") - 1, 0);
+            assert(res != -1);
+        }
+        /* The PUBACKs answer the QoS 1 PUBLISH packets one by one. */
+        if(engine_params.mqtt_qos) {
+            if(!engine_params.pipeline) engine_params.pipeline = 1;
+            if(engine_params.pipeline > MQTT_PACKET_ID_MAX) {
+                fprintf(stderr,
+                        "--pipeline is limited to %d with --mqtt-qos 1\n",
+                        MQTT_PACKET_ID_MAX);
+                exit(EX_USAGE);
+            }
+            engine_params.latency_setting |= SLT_MARKER;
+        } else if(engine_params.pipeline) {
+            warning("--pipeline makes no effect with --mqtt-qos 0.\n");
+            engine_params.pipeline = 0;
+        }
+    } else if(engine_params.mqtt_topic_expr
+              || engine_params.mqtt_subscribe_expr || engine_params.mqtt_qos) {
+        warning("--mqtt-topic, --mqtt-subscribe and --mqtt-qos make no "
+                "effect without --mqtt.\n");
+    }
+
+    if(engine_params.http_enable) {
+        if(engine_params.websocket_enable) {
+            fprintf(stderr, "--http is incompatible with --websocket\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.http2_enable || engine_params.resp_enable) {
+            fprintf(stderr, "--http is incompatible with --http2 and --resp\n");
+            exit(EX_USAGE);
+        }
+        /* The responses are matched to the requests one by one. */
+        size_t requests = 0;
+        struct message_collection *mc = &engine_params.message_collection;
+        for(size_t i = 0; i < mc->snippets_count; i++) {
+            if(MSK_PURPOSE(&mc->snippets[i]) == MSK_PURPOSE_MESSAGE)
+                requests++;
+        }
+        if(requests != 1) {
+            fprintf(stderr,
+                    "--http requires a single request in --message\n");
+            exit(EX_USAGE);
+        }
+        if(!engine_params.pipeline) engine_params.pipeline = 1;
+        engine_params.latency_setting |= SLT_MARKER;
+    } else if(engine_params.http2_enable) {
+        if(engine_params.websocket_enable) {
+            fprintf(stderr, "--http2 is incompatible with --websocket\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.resp_enable) {
+            fprintf(stderr, "--http2 is incompatible with --resp\n");
+            exit(EX_USAGE);
+        }
+        /* The requests are framed anew, so there is nothing else to send. */
+        size_t requests = 0;
+        struct message_collection *mc = &engine_params.message_collection;
+        for(size_t i = 0; i < mc->snippets_count; i++) {
+            switch(MSK_PURPOSE(&mc->snippets[i])) {
+            case MSK_PURPOSE_MESSAGE:
+                requests++;
+                break;
+            default:
+                fprintf(stderr,
+                        "--http2 is incompatible with --first-message\n");
+                exit(EX_USAGE);
+            }
+        }
+        if(requests > 1) {
+            fprintf(stderr,
+                    "--http2 requires at most a single request body "
+                    "in --message\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.latency_marker_expr) {
+            fprintf(stderr,
+                    "--http2 times the responses, --latency-marker "
+                    "is not supported\n");
+            exit(EX_USAGE);
+        }
+        /* A --grpc-stream call is not answered message by message. */
+        if(engine_params.grpc_stream) {
+            if(engine_params.pipeline > 1)
+                warning("--pipeline makes no effect with --grpc-stream.\n");
+            engine_params.pipeline = 1;
+        } else {
+            if(!engine_params.pipeline) engine_params.pipeline = 1;
+            engine_params.latency_setting |= SLT_MARKER;
+        }
+    } else if(engine_params.resp_enable) {
+        if(engine_params.websocket_enable) {
+            fprintf(stderr, "--resp is incompatible with --websocket\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.latency_marker_expr) {
+            fprintf(stderr,
+                    "--resp times the replies, --latency-marker "
+                    "is not supported\n");
+            exit(EX_USAGE);
+        }
+        /* The replies are matched to the commands one by one. */
+        size_t commands = 0;
+        struct message_collection *mc = &engine_params.message_collection;
+        for(size_t i = 0; i < mc->snippets_count; i++) {
+            if(MSK_PURPOSE(&mc->snippets[i]) == MSK_PURPOSE_MESSAGE)
+                commands++;
+        }
+        if(commands != 1) {
+            fprintf(stderr,
+                    "--resp requires a single command in --message\n");
+            exit(EX_USAGE);
+        }
+        /* The --message is sent as an inline command. */
+        message_collection_add(mc, MSK_PURPOSE_MESSAGE, "\r\n", 2, 0, 0);
+        if(!engine_params.pipeline) engine_params.pipeline = 1;
+        engine_params.latency_setting |= SLT_MARKER;
+    } else if(engine_params.pipeline && !engine_params.mqtt_version) {
+        /*
+         * --outstanding: the --framing frames or the latency markers
+         * coming back answer the messages sent.
+         */
+        if(!engine_params.framing_prefix_size && !engine_params.framer
+           && !engine_params.latency_marker_expr
+           && !engine_params.message_marker) {
+            fprintf(stderr,
+                    "--outstanding requires --http, --http2, --resp, "
+                    "--framing, --framer, --latency-marker "
+                    "or \\{message.marker}\n");
+            exit(EX_USAGE);
+        }
+        size_t messages = 0;
+        struct message_collection *mc = &engine_params.message_collection;
+        for(size_t i = 0; i < mc->snippets_count; i++) {
+            if(MSK_PURPOSE(&mc->snippets[i]) == MSK_PURPOSE_MESSAGE)
+                messages++;
+        }
+        if(messages != 1) {
+            fprintf(stderr,
+                    "--outstanding requires a single --message\n");
+            exit(EX_USAGE);
+        }
+    }
+    if(engine_params.think_time > 0.0 && !engine_params.pipeline) {
+        fprintf(stderr,
+                "--think-time requires --outstanding, --http, --http2 "
+                "or --resp\n");
+        exit(EX_USAGE);
+    }
+
+    if(engine_params.framing_prefix_size
+       && (engine_params.websocket_enable || engine_params.http_enable
+           || engine_params.http2_enable || engine_params.resp_enable)) {
+        fprintf(stderr,
+                "--framing is incompatible with --websocket, --http, "
+                "--http2 and --resp\n");
+        exit(EX_USAGE);
+    }
+    if(engine_params.framer
+       && (engine_params.websocket_enable || engine_params.http_enable
+           || engine_params.http2_enable || engine_params.resp_enable
+           || engine_params.framing_prefix_size)) {
+        fprintf(stderr,
+                "--framer is incompatible with --websocket, --http, "
+                "--http2, --resp and --framing\n");
+        exit(EX_USAGE);
+    }
+    if(engine_params.framing_prefix_size || engine_params.framer)
+        engine_params.latency_setting |= SLT_MARKER;
+
+    if(replay_pcap_file) {
+        if(engine_params.message_collection.snippets_count
+           || engine_params.websocket_enable || engine_params.http_enable
+           || engine_params.http2_enable || engine_params.resp_enable) {
+            fprintf(stderr,
+                    "--replay-pcap is incompatible with --message, "
+                    "--first-message, --websocket, --http, --http2 "
+                    "and --resp\n");
+            exit(EX_USAGE);
+        }
+        engine_params.replay = pcap_replay_load(replay_pcap_file);
+        if(!engine_params.replay) exit(EX_DATAERR);
+        if(engine_params.replay->streams_count == 0) {
+            fprintf(stderr, "%s: No client data in the TCP streams\n",
+                    replay_pcap_file);
+            exit(EX_DATAERR);
+        }
+        if(engine_params.replay->missing_bytes) {
+            fprintf(stderr,
+                    "%s: Warning: %zu bytes of the streams "
+                    "are missing from the capture\n",
+                    replay_pcap_file, engine_params.replay->missing_bytes);
+        }
+        fprintf(stderr, "Replaying %zu TCP streams (%zu bytes) from %s\n",
+                engine_params.replay->streams_count,
+                engine_params.replay->total_bytes, replay_pcap_file);
+    } else if(engine_params.replay_original_timing) {
+        fprintf(stderr, "--replay-timing requires --replay-pcap\n");
+        exit(EX_USAGE);
+    }
+
+    if(corpus_file) {
+        if(engine_params.message_collection.snippets_count || replay_pcap_file
+           || engine_params.websocket_enable || engine_params.http_enable
+           || engine_params.http2_enable || engine_params.resp_enable) {
+            fprintf(stderr,
+                    "--message-corpus is incompatible with --message, "
+                    "--first-message, --replay-pcap, --websocket, --http, "
+                    "--http2 and --resp\n");
+            exit(EX_USAGE);
+        }
+        /* With --framing lenprefix, the corpus holds the frames. */
+        engine_params.corpus = message_corpus_load(
+            corpus_file, engine_params.framing_prefix_size,
+            engine_params.framing_little_endian, corpus_shuffle);
+        if(!engine_params.corpus) exit(EX_DATAERR);
+        fprintf(stderr, "Sending %zu messages (%zu bytes) from %s\n",
+                engine_params.corpus->count,
+                engine_params.corpus->data.total_size, corpus_file);
+    } else if(corpus_shuffle) {
+        fprintf(stderr, "--message-corpus-order requires --message-corpus\n");
+        exit(EX_USAGE);
+    }
+
+    if(engine_params.proxy_source.family && !engine_params.proxy_protocol) {
+        warning("--proxy-source makes no effect without --proxy-protocol.\n");
+        engine_params.proxy_source.family = 0;
+    }
+
+    if(engine_params.udp) {
+        if(conf.listen_port || conf.listen_unix.n_addrs) {
+            fprintf(stderr, "--udp is client-only, --listen-port is not "
+                            "supported\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.ssl_enable || engine_params.websocket_enable
+           || engine_params.http_enable || engine_params.http2_enable
+           || engine_params.resp_enable || engine_params.framing_prefix_size
+           || engine_params.framer || replay_pcap_file || corpus_file || engine_params.tcp_info
+           || engine_params.mptcp || engine_params.tcp_fastopen
+           || engine_params.latency_timestamping != LTS_OFF
+           || engine_params.proxy_protocol) {
+            fprintf(stderr,
+                    "--udp is incompatible with --ssl, --websocket, --http, "
+                    "--http2, --resp, --framing, --framer, --replay-pcap, "
+                    "--message-corpus, --tcp-info, --mptcp, --tcp-fastopen, "
+                    "--latency-timestamping and --proxy-protocol\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.zerocopy) {
+            warning("--zerocopy makes no effect with --udp.\n");
+            engine_params.zerocopy = 0;
+        }
+        if(engine_params.zerocopy_receive) {
+            warning("--zerocopy-receive makes no effect with --udp.\n");
+            engine_params.zerocopy_receive = 0;
+        }
+        if(engine_params.sendfile) {
+            warning("--sendfile makes no effect with --udp.\n");
+            engine_params.sendfile = 0;
+        }
+        if(engine_params.close_style != CLOSE_GRACEFUL) {
+            warning("--close-style makes no effect with --udp.\n");
+            engine_params.close_style = CLOSE_GRACEFUL;
+        }
+    }
+
+    if(engine_params.message_stop)
+        tk_multiscan_compile(engine_params.message_stop);
+
+    if(engine_params.mptcp && !engine_mptcp_available()) {
+        warning("MPTCP is disabled in the kernel (see net.mptcp.enabled), "
+                "using TCP\n");
+        engine_params.mptcp = 0;
+    }
+
+    if(engine_params.record_sample && !engine_params.record_dir) {
+        fprintf(stderr, "--record-sample requires --record\n");
+        exit(EX_USAGE);
+    }
+    if(engine_params.record_dir && !engine_params.record_sample)
+        engine_params.record_sample = 1.0;
+
+    if(websocket_deflate && !engine_params.websocket_enable) {
+        fprintf(stderr, "--websocket-deflate requires --websocket\n");
+        exit(EX_USAGE);
+    }
+
+    if(engine_params.ssl_session_reuse && !engine_params.ssl_enable) {
+        fprintf(stderr, "--ssl-session-reuse requires --ssl\n");
+        exit(EX_USAGE);
+    }
+    if(engine_params.ssl_ktls && !engine_params.ssl_enable) {
+        fprintf(stderr, "--ssl-ktls requires --ssl\n");
+        exit(EX_USAGE);
+    }
+    if((engine_params.latency_setting & SLT_HANDSHAKE)
+       && !engine_params.ssl_enable) {
+        fprintf(stderr, "--latency-handshake requires --ssl\n");
+        exit(EX_USAGE);
+    }
+    if((engine_params.latency_setting & SLT_UPGRADE)
+       && !engine_params.websocket_enable) {
+        fprintf(stderr, "--latency-upgrade requires --websocket\n");
+        exit(EX_USAGE);
+    }
+
 #ifdef HAVE_OPENSSL
     if(engine_params.ssl_enable) {
             tcpkali_init_ssl();
 
             /* If server side operation, look into file names */
-            if(conf.listen_port != 0) {
+            if(conf.listen_port != 0 || conf.listen_unix.n_addrs) {
                 if(access(engine_params.ssl_cert, F_OK) == -1) {
                     fprintf(stderr,
                             "%s: Can not access X.509 certificate file.\n",
@@ -814,15 +2827,32 @@ main(int argc, char **argv) {
         }
     }
 
+    /*
+     * The --find-max-connections may go as far as its limit.
+     */
+    int peak_connections = connection_modulator.mode == CM_MAX_CONNECTIONS
+                               ? connection_modulator.limit
+                               : conf.max_connections;
+
     /*
      * Avoid spawning more threads than connections.
      */
     if(engine_params.requested_workers == 0
-       && conf.max_connections < number_of_cpus() && conf.listen_port == 0) {
-        engine_params.requested_workers = conf.max_connections;
+       && peak_connections < number_of_cpus() && conf.listen_port == 0
+       && conf.listen_unix.n_addrs == 0) {
+        engine_params.requested_workers = peak_connections;
     }
+    /* A worker per --cpu-affinity CPU. */
+    if(!engine_params.requested_workers && engine_params.cpu_affinity)
+        engine_params.requested_workers = engine_params.cpu_affinity_count;
     if(!engine_params.requested_workers)
         engine_params.requested_workers = number_of_cpus();
+    /* The --processes split the workers between them. */
+    if(conf.processes > 1) {
+        engine_params.requested_workers =
+            (engine_params.requested_workers + conf.processes - 1)
+            / conf.processes;
+    }
 
 
     /*
@@ -842,24 +2872,60 @@ main(int argc, char **argv) {
                 conf.latency_window);
             exit(EX_USAGE);
         }
+        if(conf.latency_step > conf.latency_window) {
+            fprintf(stderr,
+                    "--statsd-latency-step=%gs exceeds "
+                    "--statsd-latency-window=%gs.\n",
+                    conf.latency_step, conf.latency_window);
+            exit(EX_USAGE);
+        }
+        if(conf.latency_step && conf.latency_step < 0.1) {
+            fprintf(stderr,
+                    "--statsd-latency-step=%gs is too small. Try 0.1s.\n",
+                    conf.latency_step);
+            exit(EX_USAGE);
+        }
+        if(conf.latency_step
+           && conf.latency_window / conf.latency_step > 1000) {
+            fprintf(stderr,
+                    "--statsd-latency-step=%gs is too small for "
+                    "--statsd-latency-window=%gs.\n",
+                    conf.latency_step, conf.latency_window);
+            exit(EX_USAGE);
+        }
+    } else if(conf.latency_step) {
+        fprintf(stderr,
+                "--statsd-latency-step requires --statsd-latency-window\n");
+        exit(EX_USAGE);
+    }
+
+    if(conf.latency_log_file && !engine_params.latency_setting) {
+        fprintf(stderr,
+                "--latency-log requires at least one of --latency-connect, "
+                "--latency-first-byte, --latency-handshake, --latency-upgrade, "
+                "--latency-marker "
+                "or \\{message.marker}.\n");
+        exit(EX_USAGE);
     }
 
     /*
      * Check that the system environment is prepared to handle high load.
      */
-    if(adjust_system_limits_for_highload(conf.max_connections,
+    const double limits_began = startup_clock();
+    if(adjust_system_limits_for_highload(peak_connections,
                                          engine_params.requested_workers)
        == -1) {
         /* Print the full set of problems with system limits. */
-        check_system_limits_sanity(conf.max_connections,
+        check_system_limits_sanity(peak_connections,
                                    engine_params.requested_workers);
         fprintf(stderr, "System limits will not support the expected load.\n");
         exit(EX_SOFTWARE);
     } else {
         /* Check other system limits and print out if they might be too low. */
-        check_system_limits_sanity(conf.max_connections,
+        check_system_limits_sanity(peak_connections,
                                    engine_params.requested_workers);
     }
+    const double limits_took = startup_clock() - limits_began;
 
     /*
      * Check whether --rcvbuf and --sndbuf options mean something.
@@ -875,13 +2941,80 @@ main(int argc, char **argv) {
         /* The check_setsockopt_effect() function yelled already. */
         warning("--sndbuf option makes no effect.\n");
     }
+    if(engine_params.zerocopy && engine_params.ssl_enable) {
+        warning("--zerocopy makes no effect with --ssl.\n");
+        engine_params.zerocopy = 0;
+    }
+    if(engine_params.zerocopy_receive) {
+        if(engine_params.ssl_enable) {
+            warning("--zerocopy-receive makes no effect with --ssl.\n");
+            engine_params.zerocopy_receive = 0;
+        } else if(engine_params.read_buffer_size
+                  < (size_t)sysconf(_SC_PAGESIZE)) {
+            /* Only the whole pages of the --read-buffer are mapped. */
+            warning("--zerocopy-receive makes no effect with --read-buffer "
+                    "smaller than a page.\n");
+            engine_params.zerocopy_receive = 0;
+        }
+    }
+    if(engine_params.sendfile) {
+        /* The messages must be the mapped --message-file, as is. */
+        const struct message_collection *mc =
+            &engine_params.message_collection;
+        size_t messages = 0, mapped = 0;
+        for(size_t i = 0; i < mc->snippets_count; i++) {
+            if(MSK_PURPOSE(&mc->snippets[i]) != MSK_PURPOSE_MESSAGE) continue;
+            messages++;
+            if(mc->snippets[i].flags & MSK_DATA_SHARED) mapped++;
+        }
+        if(engine_params.ssl_enable && !engine_params.ssl_ktls) {
+            warning("--sendfile makes no effect with --ssl, "
+                    "unless --ssl-ktls is given.\n");
+            engine_params.sendfile = 0;
+        } else if(messages != 1 || mapped != 1
+                  || engine_params.websocket_enable) {
+            warning("--sendfile makes no effect without a single "
+                    "--message-file of 64k or more, free of "
+                    "\\{expressions} and --websocket.\n");
+            engine_params.sendfile = 0;
+        }
+    }
 
     /*
      * Pick multiple destinations from the command line, resolve them.
      */
+    double *remote_weights = NULL;
+    size_t *remote_targets = NULL;
+    struct remote_quota *remote_quotas =
+        parse_remote_quotas(&argv[optind], argc - optind);
+    if(remote_quotas && conf.dns_refresh > 0.0) {
+        fprintf(stderr, "The host:port@rate=,max= quotas are not compatible "
+                        "with --dns-refresh\n");
+        exit(EX_USAGE);
+    }
+    if(conf.remote_weights && !conf.remote_select_given)
+        engine_params.remote_select = RSEL_WEIGHTED;
+    if(conf.dns_refresh > 0.0
+       && (engine_params.remote_select == RSEL_WEIGHTED
+           || engine_params.remote_select == RSEL_HASH
+           || conf.remote_weights)) {
+        fprintf(stderr,
+                "--remote-select weighted, hash and --remote-weights "
+                "are not compatible with --dns-refresh\n");
+        exit(EX_USAGE);
+    }
     if(argc - optind > 0) {
-        engine_params.remote_addresses =
-            resolve_remote_addresses(&argv[optind], argc - optind);
+        if(conf.remote_weights) {
+            engine_params.remote_addresses = resolve_weighted_addresses(
+                &argv[optind], argc - optind, conf.remote_weights,
+                &remote_weights, &remote_targets);
+        } else if(remote_quotas || conf.ab) {
+            engine_params.remote_addresses = resolve_each_address(
+                &argv[optind], argc - optind, &remote_targets);
+        } else {
+            engine_params.remote_addresses =
+                resolve_remote_addresses(&argv[optind], argc - optind);
+        }
         if(engine_params.remote_addresses.n_addrs == 0) {
             errx(EX_NOHOST,
                  "DNS did not return usable addresses for given host(s)");
@@ -889,8 +3022,87 @@ main(int argc, char **argv) {
             fprint_addresses(stderr, "Destination: ", "\nDestination: ", "\n",
                              engine_params.remote_addresses);
         }
-        /* Figure out the host and port for HTTP "Host:" header. */
-        conf.first_hostport = strdup(argv[optind]);
+        /* The --ab groups take the addresses of their own destination. */
+        size_t n_addrs = engine_params.remote_addresses.n_addrs;
+        for(size_t i = 0; conf.ab && i < n_addrs; i++) {
+            struct connection_group *g = &conf.groups[remote_targets[i]];
+            if(g->remote_count == 0) g->remote_first = i;
+            g->remote_count++;
+        }
+        if(remote_quotas) {
+            /* The --processes split the quotas between them. */
+            size_t max_total = 0;
+            for(int n = 0; n < argc - optind; n++) {
+                struct remote_quota *q = &remote_quotas[n];
+                if(max_total != (size_t)-1 && q->max_connections)
+                    max_total += q->max_connections;
+                else
+                    max_total = (size_t)-1;
+                if(conf.processes > 1) {
+                    q->connect_rate /= conf.processes;
+                    q->max_connections = (q->max_connections + conf.processes
+                                          - 1) / conf.processes;
+                }
+            }
+            if(conf.n_groups == 0 && max_total < (size_t)conf.max_connections)
+                warning("--connections=%d exceed the @max= quotas "
+                        "of the destinations, %zu in total.\n",
+                        conf.max_connections, max_total);
+            engine_params.remote_quotas = remote_quotas;
+            engine_params.n_remote_quotas = argc - optind;
+            engine_params.remote_quota_index = remote_targets;
+            remote_targets = NULL;
+        }
+        free(remote_targets);
+        /* The target= destinations follow, used by their groups only. */
+        for(size_t g = 0; g < conf.n_groups; g++) {
+            struct group_targets *gt = &conf.group_targets[g];
+            if(gt->n_hostports == 0) continue;
+            struct addresses own =
+                resolve_remote_addresses(gt->hostports, gt->n_hostports);
+            if(own.n_addrs == 0) {
+                errx(EX_NOHOST, "DNS did not return usable addresses for "
+                                "the %s target= host(s)",
+                     conf.groups[g].name);
+            }
+            char prefix[128];
+            snprintf(prefix, sizeof(prefix), "Destination (%s): ",
+                     conf.groups[g].name);
+            fprint_addresses(stderr, prefix, "\n", "\n", own);
+            conf.groups[g].remote_first =
+                engine_params.remote_addresses.n_addrs;
+            conf.groups[g].remote_count = own.n_addrs;
+            for(size_t i = 0; i < own.n_addrs; i++)
+                address_add(&engine_params.remote_addresses,
+                            (struct sockaddr *)&own.addrs[i]);
+            engine_params.group_remotes += own.n_addrs;
+            free(own.addrs);
+        }
+        if(conf.mirror) {
+            engine_params.mirror_addresses =
+                resolve_remote_addresses(&conf.mirror, 1);
+            if(engine_params.mirror_addresses.n_addrs == 0) {
+                errx(EX_NOHOST, "DNS did not return usable addresses for "
+                                "the --mirror host");
+            }
+            fprint_addresses(stderr, "Destination (mirror): ", "\n", "\n",
+                             engine_params.mirror_addresses);
+        }
+        for(size_t i = 0; i < engine_params.remote_addresses.n_addrs; i++) {
+            if(engine_params.remote_addresses.addrs[i].ss_family == AF_UNIX
+               && engine_params.udp) {
+                fprintf(stderr, "--udp requires the IP destinations\n");
+                exit(EX_USAGE);
+            }
+        }
+        /*
+         * Figure out the host and port for HTTP "Host:" header.
+         * The unix:/path is not an HTTP path, though.
+         */
+        if(engine_params.remote_addresses.addrs[0].ss_family == AF_UNIX)
+            conf.first_hostport = strdup("localhost");
+        else
+            conf.first_hostport = strdup(argv[optind]);
         conf.first_path = strchr(conf.first_hostport, '/');
         if(conf.first_path) {
             *conf.first_path++ = '\0';
@@ -898,8 +3110,38 @@ main(int argc, char **argv) {
             conf.first_path = ""; /* "GET / HTTP/1.1" */
         }
 
+        /* The --proxy-source is announced to the same kind of address. */
+        if(engine_params.proxy_source.family) {
+            for(size_t i = 0; i < engine_params.remote_addresses.n_addrs;
+                i++) {
+                if(engine_params.remote_addresses.addrs[i].ss_family
+                   != engine_params.proxy_source.family) {
+                    fprintf(stderr,
+                            "--proxy-source requires the destinations "
+                            "of the same address family\n");
+                    exit(EX_USAGE);
+                }
+            }
+        }
+
         /* Figure out source IPs */
-        if(engine_params.source_addresses.n_addrs == 0) {
+        if(engine_params.source_prefix_len) {
+            char tmpbuf[INET6_ADDRSTRLEN];
+            for(size_t i = 0; i < engine_params.remote_addresses.n_addrs;
+                i++) {
+                if(engine_params.remote_addresses.addrs[i].ss_family
+                   != AF_INET6) {
+                    fprintf(stderr,
+                            "--source-ipv6-prefix requires IPv6 "
+                            "destinations\n");
+                    exit(EX_USAGE);
+                }
+            }
+            inet_ntop(AF_INET6, &engine_params.source_prefix.sin6_addr,
+                      tmpbuf, sizeof(tmpbuf));
+            fprintf(stderr, "Source IP: random from %s/%d\n", tmpbuf,
+                    engine_params.source_prefix_len);
+        } else if(engine_params.source_addresses.n_addrs == 0) {
             if(detect_source_ips(&engine_params.remote_addresses,
                                  &engine_params.source_addresses)
                < 0) {
@@ -909,71 +3151,851 @@ main(int argc, char **argv) {
             fprint_addresses(stderr, "Source IP: ", "\nSource IP: ", "\n",
                              engine_params.source_addresses);
         }
+
+        if(conf.dns_refresh > 0.0) {
+            engine_params.dns_refresh = dns_refresh_start(
+                &argv[optind], argc - optind, &engine_params.remote_addresses,
+                conf.dns_refresh, engine_params.verbosity_level);
+        }
+
+        struct addresses *ra = &engine_params.remote_addresses;
+        size_t n_shared = ra->n_addrs - engine_params.group_remotes;
+        switch(engine_params.remote_select) {
+        case RSEL_ROUND_ROBIN:
+        case RSEL_LEAST_CONN:
+        case RSEL_LEAST_LATENCY:
+            if(remote_weights) {
+                warning("--remote-weights makes no effect "
+                        "without --remote-select weighted or hash.\n");
+            }
+            break;
+        case RSEL_WEIGHTED:
+            if(remote_weights) {
+                engine_params.remote_alias =
+                    balance_alias_new(remote_weights, n_shared);
+            } else {
+                warning("--remote-select weighted without --remote-weights "
+                        "picks the destinations evenly at random.\n");
+                double *equal = malloc(n_shared * sizeof(*equal));
+                assert(equal);
+                for(size_t i = 0; i < n_shared; i++) equal[i] = 1.0;
+                engine_params.remote_alias =
+                    balance_alias_new(equal, n_shared);
+                free(equal);
+            }
+            break;
+        case RSEL_HASH: {
+            uint32_t *hashes = malloc(n_shared * sizeof(*hashes));
+            assert(hashes);
+            for(size_t i = 0; i < n_shared; i++) {
+                hashes[i] = balance_hash(&ra->addrs[i],
+                                         sockaddr_len(&ra->addrs[i]));
+            }
+            engine_params.remote_ring =
+                balance_ring_new(hashes, remote_weights, n_shared);
+            free(hashes);
+        } break;
+        }
+        free(remote_weights);
     } else {
         conf.max_connections = 0;
+        if(conf.dns_refresh > 0.0) {
+            warning("--dns-refresh makes no effect without destinations.\n");
+        }
+    }
+    if(engine_params.reuseport_cpu && conf.listen_port <= 0) {
+        warning("--reuseport-cpu makes no effect without --listen-port.\n");
+        engine_params.reuseport_cpu = 0;
     }
     if(conf.listen_port > 0) {
         engine_params.listen_addresses =
             detect_listen_addresses(conf.listen_host, conf.listen_port);
+    } else if(conf.listen_unix.n_addrs) {
+        engine_params.listen_addresses = conf.listen_unix;
+        fprint_addresses(stderr, "Listen on: ", "\nListen on: ", "\n",
+                         engine_params.listen_addresses);
+    }
+
+    /*
+     * Report the kernel settings which will cap the run, raising them
+     * if asked for. The remote and listen addresses are known by now.
+     */
+    if(conf.preflight != PREFLIGHT_OFF) {
+        struct preflight_params pp = {
+            .connections =
+                engine_params.remote_addresses.n_addrs ? peak_connections : 0,
+            .connect_rate = conf.connect_rate,
+            .churn = isfinite(engine_params.channel_lifetime),
+            .destinations = engine_params.remote_addresses.n_addrs,
+            .sources = engine_params.source_prefix_len
+                           ? 0
+                           : engine_params.source_addresses.n_addrs,
+            .listen_backlog = engine_params.listen_addresses.n_addrs
+                                  ? engine_params.listen_backlog
+                                  : 0,
+            .rcvbuf = engine_params.sock_rcvbuf_size,
+            .sndbuf = engine_params.sock_sndbuf_size,
+            .busy_poll_us = engine_params.busy_poll <= 0.0
+                                ? 0
+                                : engine_params.busy_poll < 1.0
+                                      ? 1e6 * engine_params.busy_poll
+                                      : 1000000};
+        system_preflight(&pp, conf.preflight);
+    }
+
+    /*
+     * The -l side answers the --clock-sync probes on its listen ports,
+     * the connecting side probes the first destination's clock.
+     */
+    struct clock_sync *clock_sync = NULL;
+    if(conf.clock_sync) {
+        if(conf.clock_offset_set) {
+            fprintf(stderr,
+                    "--clock-offset is not compatible with --clock-sync\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.listen_addresses.n_addrs) {
+            clock_sync = clock_sync_listen(&engine_params.listen_addresses,
+                                           engine_params.latency_clock);
+            if(!clock_sync) {
+                fprintf(stderr, "--clock-sync: can not listen over UDP: %s\n",
+                        strerror(errno));
+                exit(EX_UNAVAILABLE);
+            }
+        }
+        if(engine_params.remote_addresses.n_addrs) {
+            struct sockaddr_storage *ss =
+                &engine_params.remote_addresses.addrs[0];
+            char buf[INET6_ADDRSTRLEN + 64];
+            int64_t rtt_ns;
+            if(ss->ss_family != AF_INET && ss->ss_family != AF_INET6) {
+                fprintf(stderr, "--clock-sync requires the IP destinations\n");
+                exit(EX_USAGE);
+            }
+            if(clock_sync_query((struct sockaddr *)ss, sockaddr_len(ss),
+                                engine_params.latency_clock,
+                                &engine_params.clock_offset_ns, &rtt_ns)
+               == -1) {
+                fprintf(stderr, "--clock-sync: %s did not tell its clock: %s\n",
+                        format_sockaddr(ss, buf, sizeof(buf)),
+                        errno == EPROTO ? "it uses another --latency-clock"
+                                        : strerror(errno));
+                exit(EX_UNAVAILABLE);
+            }
+            fprintf(stderr,
+                    "Clock offset to %s: %+.3f ms (round trip %.3f ms)\n",
+                    format_sockaddr(ss, buf, sizeof(buf)),
+                    engine_params.clock_offset_ns / 1e6, rtt_ns / 1e6);
+        } else if(!clock_sync) {
+            warning("--clock-sync makes no effect without destinations "
+                    "or --listen-port.\n");
+        }
+    }
+
+    /*
+     * Add final touches to the collection:
+     * add websocket headers if needed, etc.
+     */
+    message_collection_finalize(
+        &engine_params.message_collection, engine_params.websocket_enable,
+        websocket_deflate, conf.first_hostport, conf.first_path, conf.http_headers.buffer);
+
+    /*
+     * The groups without a message= send the --message, --first-message.
+     */
+    int groups_send = 0;
+    for(size_t g = 0; g < engine_params.n_groups; g++) {
+        struct connection_group *group = &engine_params.groups[g];
+        if(group->message_collection.snippets_count) {
+            group->own_messages = 1;
+            message_collection_finalize(
+                &group->message_collection, engine_params.websocket_enable,
+                websocket_deflate, conf.first_hostport, conf.first_path,
+                conf.http_headers.buffer);
+            engine_params.message_marker |= message_collection_has(
+                &group->message_collection, EXPR_MESSAGE_MARKER);
+        } else {
+            group->message_collection = engine_params.message_collection;
+        }
+        if(message_collection_estimate_size(
+               &group->message_collection, MSK_PURPOSE_MESSAGE,
+               MSK_PURPOSE_MESSAGE, MCE_MINIMUM_SIZE, WS_SIDE_CLIENT, 0)) {
+            groups_send = 1;
+        } else if(group->own_send_rate
+                  && group->channel_send_rate.value_base
+                         == RS_MESSAGES_PER_SECOND) {
+            fprintf(stderr,
+                    "--connection-group %s: rate= makes no sense "
+                    "without messages\n",
+                    group->name);
+            exit(EX_USAGE);
+        }
+    }
+
+    if(engine_params.message_marker_binary) {
+        for(size_t g = 0; g <= engine_params.n_groups; g++) {
+            struct message_collection *mc =
+                g ? &engine_params.groups[g - 1].message_collection
+                  : &engine_params.message_collection;
+            for(size_t i = 0; i < mc->snippets_count; i++) {
+                if(mc->snippets[i].expr)
+                    expression_set_marker_size(mc->snippets[i].expr,
+                                               MESSAGE_MARKER_BINARY_SIZE);
+            }
+        }
+    }
+
+    /* Without a --message, the --http2 requests are GETs. */
+    int no_message_to_send =
+        (0 == message_collection_estimate_size(
+                  &engine_params.message_collection, MSK_PURPOSE_MESSAGE,
+                  MSK_PURPOSE_MESSAGE, MCE_MINIMUM_SIZE, WS_SIDE_CLIENT, 0))
+        && !engine_params.http2_enable && !engine_params.corpus
+        && !engine_params.mqtt_version && !groups_send;
+
+    /*
+     * A Fast Open connection is not made until something is written,
+     * so the connections without the data to send only listen with it.
+     */
+    if(engine_params.tcp_fastopen == TFO_CONNECT && no_message_to_send
+       && !engine_params.websocket_enable && !engine_params.replay
+       && !engine_params.ssl_enable
+       && 0 == message_collection_estimate_size(
+                   &engine_params.message_collection, MSK_PURPOSE_FIRST_MSG,
+                   MSK_PURPOSE_FIRST_MSG, MCE_MINIMUM_SIZE, WS_SIDE_CLIENT,
+                   0)) {
+        if(argc - optind > 0)
+            warning("--tcp-fastopen is only used by the listeners, "
+                    "there is no data to send in the SYN.\n");
+        engine_params.tcp_fastopen = TFO_LISTEN;
+    }
+
+    /* Each --udp datagram carries exactly one message. */
+    if(engine_params.udp) {
+        const struct message_collection *mc =
+            &engine_params.message_collection;
+        for(size_t i = 0; i < mc->snippets_count; i++) {
+            if(MSK_PURPOSE(&mc->snippets[i]) == MSK_PURPOSE_MESSAGE
+               && mc->snippets[i].expr
+               && !expression_has_fixed_size(mc->snippets[i].expr)) {
+                fprintf(stderr,
+                        "--udp requires the messages of a fixed size\n");
+                exit(EX_USAGE);
+            }
+        }
+    }
+
+    /*
+     * Message marker mode can be explicitly enabled via --message-marker,
+     * or implicitly via \{message.marker} in the messages to sent.
+     */
+    engine_params.message_marker |= message_collection_has(&engine_params.message_collection, EXPR_MESSAGE_MARKER);
+    /* The \{message.seq} and \{time.us} are rewritten as they are sent. */
+    int message_slots =
+        message_collection_has(&engine_params.message_collection,
+                               EXPR_MESSAGE_SEQ)
+        || message_collection_has(&engine_params.message_collection,
+                                  EXPR_TIME_US);
+    if(engine_params.fanout && !engine_params.message_marker) {
+        fprintf(stderr, "--fanout requires \\{message.marker} "
+                        "or --message-marker\n");
+        exit(EX_USAGE);
+    }
+    if((conf.clock_offset_set || conf.clock_sync)
+       && !engine_params.message_marker) {
+        warning("--clock-offset and --clock-sync make no effect "
+                "without --message-marker.\n");
+    }
+    if(engine_params.message_marker) {
+        engine_params.latency_setting |= SLT_MARKER;
+        int res = engine_params.message_marker_binary
+            ? parse_expression(&engine_params.latency_marker_expr, MESSAGE_MARKER_BINARY_MAGIC, sizeof(MESSAGE_MARKER_BINARY_MAGIC) - 1, 0)
+            : parse_expression(&engine_params.latency_marker_expr, MESSAGE_MARKER_TOKEN, sizeof(MESSAGE_MARKER_TOKEN) - 1, 0);
+        assert(res != -1);
+        assert(EXPR_IS_TRIVIAL(engine_params.latency_marker_expr));
+    }
+
+    /* The PUBLISH packets are framed once per connection. */
+    if(engine_params.mqtt_version
+       && (engine_params.message_marker
+           || engine_params.message_collection.most_dynamic_expression
+                  >= DS_MESSAGE_SLOTS)) {
+        fprintf(stderr,
+                "--mqtt does not support the --message expressions "
+                "changing from one message to the next\n");
+        exit(EX_USAGE);
+    }
+
+    /*
+     * The --http2 request headers are the same for all requests,
+     * so they are HPACK-encoded once, here.
+     */
+    if(engine_params.http2_enable && conf.first_hostport) {
+        struct message_collection *mc = &engine_params.message_collection;
+        if(engine_params.message_marker
+           || mc->most_dynamic_expression >= DS_MESSAGE_SLOTS) {
+            fprintf(stderr,
+                    "--http2 does not support the --message expressions "
+                    "changing from one message to the next\n");
+            exit(EX_USAGE);
+        }
+        size_t body_size = message_collection_estimate_size(
+            mc, MSK_PURPOSE_MESSAGE, MSK_PURPOSE_MESSAGE, MCE_MAXIMUM_SIZE,
+            WS_SIDE_CLIENT, 0);
+        size_t body_max = HTTP2_MAX_FRAME_SIZE
+                          - (engine_params.grpc_enable ? GRPC_PREFIX_SIZE : 0);
+        if(body_size > body_max) {
+            fprintf(stderr,
+                    "--http2 request body is limited to %zu bytes\n",
+                    body_max);
+            exit(EX_USAGE);
+        }
+        if(engine_params.grpc_enable && !*conf.first_path) {
+            fprintf(stderr,
+                    "--grpc requires the host:port/package.Service/Method "
+                    "destination\n");
+            exit(EX_USAGE);
+        }
+        size_t path_size = strlen(conf.first_path) + 2;
+        char *path = malloc(path_size);
+        assert(path);
+        snprintf(path, path_size, "/%s", conf.first_path);
+        if(engine_params.grpc_enable) {
+            engine_params.http2_headers = malloc(
+                grpc_request_headers_estimate(conf.first_hostport, path));
+            assert(engine_params.http2_headers);
+            engine_params.http2_headers_size = grpc_request_headers(
+                engine_params.http2_headers, engine_params.ssl_enable,
+                conf.first_hostport, path);
+        } else {
+            engine_params.http2_headers = malloc(
+                http2_request_headers_estimate(conf.first_hostport, path));
+            assert(engine_params.http2_headers);
+            engine_params.http2_headers_size = http2_request_headers(
+                engine_params.http2_headers, body_size > 0,
+                engine_params.ssl_enable, conf.first_hostport, path);
+        }
+        free(path);
+    }
+
+    /*
+     * The client frames are masked once, as the messages are prepared.
+     * The \{message.marker} timestamps are patched in later, as they are sent.
+     */
+    if(websocket_mask_random) {
+        if(message_collection_has(&engine_params.message_collection,
+                                  EXPR_MESSAGE_MARKER)) {
+            fprintf(stderr,
+                    "--websocket-mask random is not supported "
+                    "with \\{message.marker}.\n");
+            exit(EX_USAGE);
+        }
+        if(message_slots) {
+            fprintf(stderr,
+                    "--websocket-mask random is not supported "
+                    "with \\{message.seq} and \\{time.us}.\n");
+            exit(EX_USAGE);
+        }
+        uint8_t key[4] = {0, 0, 0, 0};
+        while(!(key[0] | key[1] | key[2] | key[3])) {
+            uint32_t r = random();
+            memcpy(key, &r, sizeof(key));
+        }
+        websocket_set_mask_key(key);
+    }
+
+    /*
+     * Check that we will actually send messages
+     * if we are also told to measure latency.
+     */
+    if(engine_params.latency_marker_expr && !engine_params.message_marker) {
+        const char *optname = engine_params.message_marker ?
+                            "--message-marker" : "--latency-marker";
+        if(no_message_to_send) {
+            fprintf(stderr,
+                    "%s is given, but no messages "
+                    "are supposed to be sent. Specify --message?\n", optname);
+            exit(EX_USAGE);
+        } else if(argc - optind == 0) {
+            fprintf(stderr,
+                    "%s is given, but no connections "
+                    "are supposed to be initiated. Specify <host:port>?\n",
+                    optname);
+            exit(EX_USAGE);
+        }
+    }
+
+    /*
+     * If we want to get max rate for specific latency
+     * check that we specified the marker for latency measurement
+     */
+    if(rate_modulator.mode != RM_UNMODULATED
+       && !engine_params.latency_marker_expr
+       && !engine_params.message_marker) {
+        fprintf(stderr,
+                "--message-rate @<Latency> requires specifying "
+                "--latency-marker or --message-marker as well.\n");
+        exit(EX_USAGE);
+    }
+
+    if(rate_modulator.controller != RMC_SEARCH
+       && rate_modulator.mode == RM_UNMODULATED) {
+        fprintf(stderr, "--rate-control requires --message-rate @<Latency>.\n");
+        exit(EX_USAGE);
+    }
+
+    if(engine_params.message_arrival != ARRIVAL_UNIFORM
+       && engine_params.channel_send_rate.value_base != RS_MESSAGES_PER_SECOND
+       && rate_modulator.mode == RM_UNMODULATED) {
+        fprintf(stderr, "--message-arrival requires --message-rate.\n");
+        exit(EX_USAGE);
+    }
+
+    if(engine_params.send_phase_jitter) {
+        if(engine_params.channel_send_rate.value_base == RS_UNLIMITED
+           && rate_modulator.mode == RM_UNMODULATED) {
+            fprintf(stderr,
+                    "--message-rate-jitter requires --message-rate "
+                    "or --channel-bandwidth-upstream.\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.message_arrival != ARRIVAL_UNIFORM
+           || engine_params.rate_scope == RATE_SCOPE_TOTAL) {
+            fprintf(stderr,
+                    "--message-rate-jitter is not compatible with "
+                    "--message-arrival poisson and --rate-scope total, "
+                    "which do not follow a per-connection pace.\n");
+            exit(EX_USAGE);
+        }
+    }
+
+    if(engine_params.send_burst > 0.0 || conf.catchup_set) {
+        const char *pace_option =
+            engine_params.send_burst > 0.0 ? "--burst" : "--catch-up";
+        if(engine_params.channel_send_rate.value_base == RS_UNLIMITED
+           && rate_modulator.mode == RM_UNMODULATED) {
+            fprintf(stderr,
+                    "%s requires --message-rate "
+                    "or --channel-bandwidth-upstream.\n",
+                    pace_option);
+            exit(EX_USAGE);
+        }
+        if(engine_params.message_arrival != ARRIVAL_UNIFORM
+           || engine_params.rate_scope == RATE_SCOPE_TOTAL) {
+            fprintf(stderr,
+                    "%s is not compatible with "
+                    "--message-arrival poisson and --rate-scope total, "
+                    "which do not follow a per-connection pace.\n",
+                    pace_option);
+            exit(EX_USAGE);
+        }
+        if(engine_params.send_burst > 0.0
+           && engine_params.send_catchup == PACE_CATCHUP_FULL)
+            warning("--burst makes no effect with --catch-up full\n");
+    }
+
+    /* The --burst-every bursts replace the per-connection pace. */
+    if(engine_params.burst_size && engine_params.burst_every == 0.0) {
+        fprintf(stderr, "--burst-size requires --burst-every\n");
+        exit(EX_USAGE);
+    }
+    if(engine_params.burst_every > 0.0) {
+        if(no_message_to_send) {
+            fprintf(stderr,
+                    "--burst-every is given, but no messages "
+                    "are supposed to be sent. Specify --message?\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.channel_send_rate.value_base != RS_UNLIMITED
+           || rate_modulator.mode != RM_UNMODULATED) {
+            fprintf(stderr,
+                    "--burst-every is not compatible with --message-rate "
+                    "and --channel-bandwidth-upstream\n");
+            exit(EX_USAGE);
+        }
+        if(!engine_params.burst_size) engine_params.burst_size = 1;
+    }
+
+    if(engine_params.send_budget
+       && engine_params.channel_send_rate.value_base == RS_UNLIMITED
+       && rate_modulator.mode == RM_UNMODULATED) {
+        fprintf(stderr,
+                "--send-budget requires --message-rate "
+                "or --channel-bandwidth-upstream.\n");
+        exit(EX_USAGE);
+    }
+
+    if(engine_params.lifetime_distribution.kind != LIFETIME_DIST_FIXED
+       && engine_params.channel_lifetime == INFINITY && !conf.n_groups) {
+        fprintf(stderr,
+                "--channel-lifetime-distribution requires "
+                "--channel-lifetime.\n");
+        exit(EX_USAGE);
+    }
+
+    if(engine_params.rate_distribution.kind != RATE_DIST_NONE) {
+        if(engine_params.channel_send_rate.value_base == RS_UNLIMITED
+           && rate_modulator.mode == RM_UNMODULATED) {
+            fprintf(stderr,
+                    "--message-rate-distribution requires --message-rate "
+                    "or --channel-bandwidth-upstream.\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.rate_scope == RATE_SCOPE_TOTAL) {
+            fprintf(stderr,
+                    "--message-rate-distribution is not compatible with "
+                    "--rate-scope total, which has no per-connection "
+                    "rate.\n");
+            exit(EX_USAGE);
+        }
+    }
+
+    /*
+     * --slow-send writes the plain bytes of the data from the timer,
+     * bypassing the rest of the sending machinery.
+     */
+    if(engine_params.slow_send > 0.0) {
+        const char *incompatible = NULL;
+        if(engine_params.channel_send_rate.value_base != RS_UNLIMITED
+           || rate_modulator.mode != RM_UNMODULATED)
+            incompatible = "--message-rate and --channel-bandwidth-upstream";
+        else if(engine_params.channel_recv_rate.value_base != RS_UNLIMITED)
+            incompatible = "--channel-bandwidth-downstream";
+        else if(engine_params.ssl_enable)
+            incompatible = "--ssl";
+        else if(engine_params.websocket_enable)
+            incompatible = "--websocket";
+        else if(engine_params.http2_enable)
+            incompatible = "--http2";
+        else if(engine_params.udp)
+            incompatible = "--udp";
+        else if(engine_params.sendfile)
+            incompatible = "--sendfile";
+        else if(engine_params.zerocopy)
+            incompatible = "--zerocopy";
+        else if(engine_params.pipeline)
+            incompatible = "--pipeline";
+        else if(engine_params.replay)
+            incompatible = "--replay-pcap";
+        else if(engine_params.message_marker)
+            incompatible = "\\{message.marker}";
+        else if(message_slots)
+            incompatible = "\\{message.seq} and \\{time.us}";
+        else if(engine_params.delay_send > 0.0)
+            incompatible = "--delay-send";
+        if(incompatible) {
+            fprintf(stderr, "--slow-send is not compatible with %s\n",
+                    incompatible);
+            exit(EX_USAGE);
+        }
+    }
+
+    /*
+     * --verify-echo compares the received bytes with those written
+     * through the regular write path, in order.
+     */
+    if(engine_params.verify_echo) {
+        const char *incompatible = NULL;
+        if(engine_params.websocket_enable)
+            incompatible = "--websocket";
+        else if(engine_params.http2_enable)
+            incompatible = "--http2";
+        else if(engine_params.udp)
+            incompatible = "--udp";
+        else if(engine_params.sendfile)
+            incompatible = "--sendfile";
+        else if(engine_params.slow_send > 0.0)
+            incompatible = "--slow-send";
+        else if(engine_params.keepalive_expr)
+            incompatible = "--keepalive-message";
+        if(incompatible) {
+            fprintf(stderr, "--verify-echo is not compatible with %s\n",
+                    incompatible);
+            exit(EX_USAGE);
+        }
+    }
+
+    /*
+     * --keepalive-message, or the --mqtt PINGREQ, is written raw from
+     * the connection timer once there is nothing else left to send.
+     */
+    if(engine_params.keepalive_expr || engine_params.keepalive_interval > 0.0) {
+        const char *incompatible = NULL;
+        if((!engine_params.keepalive_expr && !engine_params.mqtt_version)
+           || !(engine_params.keepalive_interval > 0.0)) {
+            fprintf(stderr, "--keepalive-message and --keepalive-interval "
+                            "require each other\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.ssl_enable && !engine_params.ssl_ktls)
+            incompatible = "--ssl (only with --ssl-ktls)";
+        else if(engine_params.http2_enable)
+            incompatible = "--http2";
+        else if(engine_params.channel_recv_rate.value_base != RS_UNLIMITED)
+            incompatible = "--channel-bandwidth-downstream";
+        else if(engine_params.udp)
+            incompatible = "--udp";
+        if(incompatible) {
+            fprintf(stderr, "%s is not compatible with %s\n",
+                    engine_params.keepalive_expr ? "--keepalive-message"
+                                                 : "--keepalive-interval",
+                    incompatible);
+            exit(EX_USAGE);
+        }
+    }
+
+    if(engine_params.rate_scope == RATE_SCOPE_TOTAL) {
+        if(engine_params.channel_send_rate.value_base == RS_UNLIMITED
+           && rate_modulator.mode == RM_UNMODULATED) {
+            fprintf(stderr,
+                    "--rate-scope requires --message-rate "
+                    "or --channel-bandwidth-upstream.\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.message_arrival != ARRIVAL_UNIFORM
+           || engine_params.latency_correction != LCM_OFF) {
+            fprintf(stderr,
+                    "--rate-scope total is not compatible with "
+                    "--message-arrival and --latency-correction, which "
+                    "follow the per-connection schedule.\n");
+            exit(EX_USAGE);
+        }
+    }
+
+    if(engine_params.kernel_pacing) {
+        if(engine_params.channel_send_rate.value_base == RS_UNLIMITED
+           && rate_modulator.mode == RM_UNMODULATED) {
+            warning(
+                "--kernel-pacing makes no effect without --message-rate "
+                "or --channel-bandwidth-upstream\n");
+        } else if(engine_params.rate_scope == RATE_SCOPE_TOTAL
+                  || engine_params.message_arrival != ARRIVAL_UNIFORM) {
+            warning(
+                "--kernel-pacing makes no effect with --rate-scope total "
+                "or --message-arrival poisson\n");
+        }
+    }
+
+    /* The --abort-if conditions, then those of the --scenario phases. */
+    size_t n_phases = conf.scenario ? conf.scenario->count : 0;
+    for(size_t l = 0; l <= n_phases; l++) {
+        const struct abort_conditions *list =
+            l ? &conf.scenario->phases[l - 1].abort_conditions
+              : &conf.abort_conditions;
+        for(size_t i = 0; i < list->count; i++) {
+            static const struct {
+                statsd_report_latency_types type;
+                const char *option;
+            } latency_options[] = {[AM_LATENCY_CONNECT] = {SLT_CONNECT,
+                                                           "--latency-connect"},
+                                   [AM_LATENCY_FIRSTBYTE] = {SLT_FIRSTBYTE,
+                                                             "--latency-first-byte"},
+                                   [AM_LATENCY_HANDSHAKE] = {SLT_HANDSHAKE,
+                                                             "--latency-handshake"},
+                                   [AM_LATENCY_UPGRADE] = {SLT_UPGRADE,
+                                                           "--latency-upgrade"},
+                                   [AM_LATENCY_MARKER] = {SLT_MARKER,
+                                                          "--latency-marker"}};
+            struct abort_condition *cond = &list->conds[i];
+            if(cond->metric != AM_ERRORS
+               && !(engine_params.latency_setting
+                    & latency_options[cond->metric].type)) {
+                fprintf(stderr, "%s %s requires %s.\n",
+                        l ? "--scenario abort-if" : "--abort-if", cond->text,
+                        latency_options[cond->metric].option);
+                exit(EX_USAGE);
+            }
+        }
+    }
+
+    if(connection_modulator.mode != CM_UNMODULATED) {
+        const char *option = connection_modulator.mode == CM_MAX_CONNECTIONS
+                                 ? "--find-max-connections"
+                                 : "--find-max-connect-rate";
+        const char *incompatible = NULL;
+        if(conf.load_profile)
+            incompatible = conf.scenario ? "--scenario" : "--load-profile";
+        else if(rate_modulator.mode != RM_UNMODULATED)
+            incompatible = "--message-rate @<Latency>";
+        else if(conf.until_stable > 0)
+            incompatible = "--until-stable";
+        if(incompatible) {
+            fprintf(stderr, "%s is not compatible with %s\n", option,
+                    incompatible);
+            exit(EX_USAGE);
+        }
+        if(conf.max_connections == 0) {
+            fprintf(stderr, "%s requires a destination.\n", option);
+            exit(EX_USAGE);
+        }
+        if(connection_modulator.mode == CM_MAX_CONNECTIONS) {
+            if(conf.max_connections > connection_modulator.limit) {
+                fprintf(stderr,
+                        "--connections=%d exceeds --find-max-connections=%g\n",
+                        conf.max_connections, connection_modulator.limit);
+                exit(EX_USAGE);
+            }
+            if(connection_modulator.latency_target > 0
+               && !(engine_params.latency_setting
+                    & (SLT_MARKER | SLT_CONNECT))) {
+                fprintf(stderr,
+                        "--find-max-latency requires --latency-marker "
+                        "or --latency-connect.\n");
+                exit(EX_USAGE);
+            }
+        } else if(!(engine_params.latency_setting & SLT_CONNECT)) {
+            fprintf(stderr,
+                    "--find-max-connect-rate requires --latency-connect.\n");
+            exit(EX_USAGE);
+        }
+    } else if(connection_modulator.latency_target > 0
+              || connection_modulator.strategy != CMR_DOUBLE) {
+        warning(
+            "--find-max-latency and --find-max-strategy make no effect "
+            "without --find-max-connections\n");
     }
 
     /*
-     * Add final touches to the collection:
-     * add websocket headers if needed, etc.
+     * The rate modulator moves the very numbers which should settle.
      */
-    message_collection_finalize(
-        &engine_params.message_collection, engine_params.websocket_enable,
-        conf.first_hostport, conf.first_path, conf.http_headers.buffer);
+    if(conf.until_stable > 0 && rate_modulator.mode != RM_UNMODULATED) {
+        fprintf(stderr,
+                "--until-stable is not compatible with "
+                "--message-rate @<Latency>.\n");
+        exit(EX_USAGE);
+    }
 
-    int no_message_to_send =
-        (0 == message_collection_estimate_size(
-                  &engine_params.message_collection, MSK_PURPOSE_MESSAGE,
-                  MSK_PURPOSE_MESSAGE, MCE_MINIMUM_SIZE, WS_SIDE_CLIENT, 0));
+    if(engine_params.latency_by_size
+       && !(engine_params.latency_setting & SLT_MARKER)) {
+        fprintf(stderr,
+                "--latency-by-size requires --latency-marker "
+                "or \\{message.marker}.\n");
+        exit(EX_USAGE);
+    }
+    if(engine_params.latency_slowest
+       && !(engine_params.latency_setting & SLT_MARKER)) {
+        fprintf(stderr,
+                "--latency-slowest requires --latency-marker "
+                "or \\{message.marker}.\n");
+        exit(EX_USAGE);
+    }
+    /* The histograms count from one unit up to --latency-max. */
+    double latency_max_units =
+        engine_params.latency_max * latency_units_per_second;
+    if(latency_max_units < 2 || latency_max_units > 1e15) {
+        fprintf(stderr,
+                "--latency-max must be from 2 to 10^15 times "
+                "the --latency-resolution.\n");
+        exit(EX_USAGE);
+    }
 
     /*
-     * Message marker mode can be explicitly enabled via --message-marker,
-     * or implicitly via \{message.marker} in the messages to sent.
+     * The intended send time only exists if the sending is paced.
      */
-    engine_params.message_marker |= message_collection_has(&engine_params.message_collection, EXPR_MESSAGE_MARKER);
-    if(engine_params.message_marker) {
-        engine_params.latency_setting |= SLT_MARKER;
-        int res = parse_expression(&engine_params.latency_marker_expr, MESSAGE_MARKER_TOKEN, sizeof(MESSAGE_MARKER_TOKEN) - 1, 0);
-        assert(res != -1);
-        assert(EXPR_IS_TRIVIAL(engine_params.latency_marker_expr));
+    if(engine_params.latency_correction != LCM_OFF) {
+        if(engine_params.channel_send_rate.value_base == RS_UNLIMITED
+           && rate_modulator.mode == RM_UNMODULATED) {
+            fprintf(stderr,
+                    "--latency-correction requires --message-rate "
+                    "or --channel-bandwidth-upstream.\n");
+            exit(EX_USAGE);
+        }
+        if(!(engine_params.latency_setting & SLT_MARKER)) {
+            fprintf(stderr,
+                    "--latency-correction requires --latency-marker "
+                    "or \\{message.marker}.\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.latency_correction == LCM_BOTH
+           && engine_params.message_marker) {
+            fprintf(stderr,
+                    "--latency-correction=both is not supported with "
+                    "\\{message.marker}, use \"on\" instead.\n");
+            exit(EX_USAGE);
+        }
+    }
+
+    if(engine_params.listen_mode & LMODE_RESPOND) {
+        if(!engine_params.request_delimiter_expr
+           || !engine_params.response_expr) {
+            fprintf(stderr,
+                    "--listen-mode=respond requires --request-delimiter "
+                    "and --response.\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.listen_mode & LMODE_ACTIVE) {
+            fprintf(stderr,
+                    "--listen-mode=respond is not compatible with "
+                    "--listen-mode=active.\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.ssl_enable || engine_params.websocket_enable) {
+            fprintf(stderr,
+                    "--listen-mode=respond is not compatible with "
+                    "--ssl and --websocket.\n");
+            exit(EX_USAGE);
+        }
+    } else if(engine_params.request_delimiter_expr
+              || engine_params.response_expr) {
+        fprintf(stderr,
+                "--request-delimiter and --response "
+                "require --listen-mode=respond.\n");
+        exit(EX_USAGE);
+    }
+
+    if(engine_params.listen_mode & LMODE_ECHO) {
+#ifdef __linux__
+        if(engine_params.listen_mode & LMODE_ACTIVE) {
+            fprintf(stderr,
+                    "--listen-mode=echo is not compatible with "
+                    "--listen-mode=active.\n");
+            exit(EX_USAGE);
+        }
+        if(engine_params.ssl_enable || engine_params.websocket_enable) {
+            fprintf(stderr,
+                    "--listen-mode=echo is not compatible with "
+                    "--ssl and --websocket.\n");
+            exit(EX_USAGE);
+        }
+#else
+        fprintf(stderr,
+                "--listen-mode=echo is not supported on this platform.\n");
+        exit(EX_USAGE);
+#endif
     }
 
     /*
-     * Check that we will actually send messages
-     * if we are also told to measure latency.
+     * The kernel timestamps are matched to the --latency-marker messages.
      */
-    if(engine_params.latency_marker_expr && !engine_params.message_marker) {
-        const char *optname = engine_params.message_marker ?
-                            "--message-marker" : "--latency-marker";
-        if(no_message_to_send) {
+    if(engine_params.latency_timestamping != LTS_OFF) {
+        if(!engine_params.latency_marker_expr || engine_params.message_marker) {
             fprintf(stderr,
-                    "%s is given, but no messages "
-                    "are supposed to be sent. Specify --message?\n", optname);
+                    "--latency-timestamping requires --latency-marker.\n");
             exit(EX_USAGE);
-        } else if(argc - optind == 0) {
+        }
+        if(engine_params.ssl_enable) {
             fprintf(stderr,
-                    "%s is given, but no connections "
-                    "are supposed to be initiated. Specify <host:port>?\n",
-                    optname);
+                    "--latency-timestamping is not compatible with --ssl.\n");
             exit(EX_USAGE);
         }
     }
 
     /*
-     * If we want to get max rate for specific latency
-     * check that we specified the marker for latency measurement
+     * The sampled replies are matched to the messages by their count.
      */
-    if(rate_modulator.mode != RM_UNMODULATED
-       && !engine_params.latency_marker_expr
-       && !engine_params.message_marker) {
-        fprintf(stderr,
-                "--message-rate @<Latency> requires specifying "
-                "--latency-marker or --message-marker as well.\n");
-        exit(EX_USAGE);
+    if(engine_params.latency_sample > 1) {
+        const char *incompatible = NULL;
+        if(engine_params.message_marker)
+            incompatible = "--message-marker";
+        else if(engine_params.latency_timestamping != LTS_OFF)
+            incompatible = "--latency-timestamping";
+        else if(engine_params.framer)
+            incompatible = "--framer";
+        if(incompatible) {
+            fprintf(stderr, "--latency-sample is not compatible with %s.\n",
+                    incompatible);
+            exit(EX_USAGE);
+        }
     }
 
     /*
@@ -998,20 +4020,27 @@ main(int argc, char **argv) {
     }
 
     /*
-     * --write-combine=off makes little sense with Nagle on.
-     * Disable Nagle or complain.
+     * --write-combine=off, cork and adaptive make little sense with
+     * Nagle on. Disable Nagle or complain.
      */
-    if(engine_params.write_combine == WRCOMB_OFF) {
+    if(engine_params.write_combine != WRCOMB_ON) {
+        const char *wrcomb =
+            engine_params.write_combine == WRCOMB_OFF
+                ? "off"
+                : engine_params.write_combine == WRCOMB_CORK ? "cork"
+                                                             : "adaptive";
         switch(engine_params.nagle_setting) {
         case NSET_UNSET:
             fprintf(stderr,
-                    "NOTE: --write-combine=off presumes --nagle=off.\n");
+                    "NOTE: --write-combine=%s presumes --nagle=off.\n",
+                    wrcomb);
             engine_params.nagle_setting = NSET_NODELAY_ON;
             break;
         case NSET_NODELAY_OFF: /* --nagle=on */
             warning(
-                "--write-combine=off makes little sense "
-                "with --nagle=on.\n");
+                "--write-combine=%s makes little sense "
+                "with --nagle=on.\n",
+                wrcomb);
             break;
         case NSET_NODELAY_ON: /* --nagle=off */
             /* This is the proper setting when --write-combine=off */
@@ -1019,7 +4048,8 @@ main(int argc, char **argv) {
         }
     }
 
-    if(optind == argc && conf.listen_port == 0) {
+    if(optind == argc && conf.listen_port == 0
+       && conf.listen_unix.n_addrs == 0) {
         fprintf(stderr,
                 "Expecting target <host:port> or --listen-port. See -h or "
                 "--help.\n");
@@ -1030,7 +4060,8 @@ main(int argc, char **argv) {
     /*
      * Check if the number of connections can be opened in time.
      */
-    if(conf.max_connections / conf.connect_rate > conf.test_duration / 10) {
+    if(!conf.load_profile
+       && conf.max_connections / conf.connect_rate > conf.test_duration / 10) {
         if(conf.max_connections / conf.connect_rate > conf.test_duration) {
             fprintf(stderr,
                     "%d connections can not be opened "
@@ -1055,7 +4086,9 @@ main(int argc, char **argv) {
     /* Which latency types to report to statsd */
     statsd_report_latency_types requested_latency_types = engine_params.latency_setting;
 
-    if(requested_latency_types && !latency_percentiles.size) {
+    if((requested_latency_types || engine_params.tcp_info
+        || engine_params.mptcp || engine_params.tcp_fastopen)
+       && !latency_percentiles.size) {
         static struct percentile_value percentile_values[] = {
             { 95, "95" }, { 99, "99" }, { 99.5, "99.5" } };
         static struct percentile_values pvs = {
@@ -1072,6 +4105,8 @@ main(int argc, char **argv) {
     if(conf.statsd_enable) {
         statsd_new(&statsd, conf.statsd_host, conf.statsd_port,
                    conf.statsd_namespace, NULL);
+        statsd_setBatchSize(statsd, conf.statsd_mtu);
+        statsd_setTags(statsd, conf.statsd_tags);
         /* Clear up traffic numbers, for better graphing. */
         report_to_statsd(statsd, 0, requested_latency_types, &latency_percentiles);
     } else {
@@ -1085,10 +4120,117 @@ main(int argc, char **argv) {
         tcpkali_init_kbdinput();
     }
 
+    /*
+     * The baseline is checked before the test, not to find out
+     * it is unusable only after the test.
+     */
+    struct compare_run *baseline = NULL;
+    if(conf.compare_to) {
+        baseline = compare_run_load_file(conf.compare_to);
+        if(!baseline) {
+            int invalid = errno == EINVAL;
+            fprintf(stderr, "--compare-to %s: %s\n", conf.compare_to,
+                    invalid ? "No final --json-report found"
+                            : strerror(errno));
+            exit(invalid ? EX_DATAERR : EX_NOINPUT);
+        }
+    }
+
+    FILE *json_report = NULL;
+    if(conf.json_report_file) {
+        if(strcmp(conf.json_report_file, "-") == 0) {
+            json_report = stdout;
+        } else {
+            json_report = fopen(conf.json_report_file, "w");
+            if(!json_report) {
+                fprintf(stderr, "--json-report %s: %s\n",
+                        conf.json_report_file, strerror(errno));
+                exit(EX_CANTCREAT);
+            }
+        }
+    }
+
+    /*
+     * Fork the --processes, each running its share of the connections
+     * and the --connect-rate (and the --rate-scope total rate).
+     * The parent only waits for them to merge and print the totals.
+     */
+    struct procs *procs = NULL;
+    int proc_index = -1;
+    if(conf.processes > 1) {
+        procs = procs_fork(conf.processes, &proc_index);
+        if(proc_index < 0) {
+            struct engine_summary summary;
+            int exit_code = procs_wait(procs, &summary);
+            engine_summary_print(&engine_params, &latency_percentiles,
+                                 &summary);
+            if(json_report) {
+                json_report_write(json_report, "final", summary.test_duration,
+                                  &engine_params, &summary,
+                                  &latency_percentiles);
+                if(json_report != stdout && fclose(json_report) != 0) {
+                    fprintf(stderr, "--json-report %s: %s\n",
+                            conf.json_report_file, strerror(errno));
+                }
+            }
+            engine_free_summary(&summary);
+            exit(exit_code);
+        }
+        conf.max_connections =
+            procs_share(conf.max_connections, conf.processes, proc_index);
+        conf.connect_rate /= conf.processes;
+        if(engine_params.rate_scope == RATE_SCOPE_TOTAL)
+            engine_params.channel_send_rate.value /= conf.processes;
+        /* The parent prints and writes the merged results. */
+        json_report = NULL;
+        int devnull = open("/dev/null", O_WRONLY);
+        if(devnull != -1) {
+            dup2(devnull, STDOUT_FILENO);
+            close(devnull);
+        }
+    }
+
     /* Block term signals so they're not scheduled in the worker threads. */
     block_term_signals();
 
+    /*
+     * Keep the memory, including the one allocated later, out of swap.
+     */
+    if(conf.mlockall && mlockall(MCL_CURRENT | MCL_FUTURE) == -1) {
+        warning("--mlockall makes no effect: %s\n", strerror(errno));
+    }
+
+    /* The -c connections of this process are ranked. */
+    engine_params.rate_distribution.population =
+        conf.max_connections > 0 ? conf.max_connections : 1;
+
+    if(conf.prewarm) {
+        if(conf.max_connections)
+            engine_params.prewarm_connections = conf.max_connections;
+        else
+            warning("--prewarm makes no effect without destinations.\n");
+    }
+
+    const double engine_began = startup_clock();
     struct engine *eng = engine_start(engine_params);
+    if(conf.prewarm) {
+        double now = startup_clock();
+        fprintf(stderr,
+                "Started in %.3f s (system limits %.3f s, "
+                "workers and pools %.3f s)\n",
+                now - startup_began, limits_took, now - engine_began);
+    }
+
+    struct metrics_server *metrics = NULL;
+    if(conf.metrics_listen) {
+        metrics = metrics_server_start(eng, conf.metrics_listen);
+        if(!metrics) exit(EX_UNAVAILABLE);
+    }
+
+    struct stable_detector stable_detector;
+    if(conf.until_stable > 0)
+        stable_init(&stable_detector, ESM_METRICS, conf.until_stable,
+                    conf.stable_windows);
 
     /*
      * Traffic in/out moving average, smoothing period is 3 seconds.
@@ -1098,15 +4240,93 @@ main(int argc, char **argv) {
         .max_connections = conf.max_connections,
         .connect_rate = conf.connect_rate,
         .latency_window = conf.latency_window,
+        .latency_step = conf.latency_step,
         .statsd = statsd,
+        .statsd_breakdown = (statsd && conf.statsd_tags)
+                                ? statsd_breakdown_new(eng)
+                                : NULL,
         .rate_modulator = &rate_modulator,
+        .connection_modulator = &connection_modulator,
+        .abort_conditions = &conf.abort_conditions,
+        .until_stable = conf.until_stable > 0 ? &stable_detector : NULL,
         .latency_percentiles = &latency_percentiles,
-        .print_stats = print_stats
+        .print_stats = print_stats,
+        .dashboard = conf.dashboard ? dashboard_new(eng, 1.0) : NULL,
+        .load_profile = conf.load_profile,
+        .load_profile_start = tk_now(TK_DEFAULT),
+        .scenario = conf.scenario,
+        .scenario_phase_start = tk_now(TK_DEFAULT)
     };
+    if(conf.scenario) {
+        oc_args.scenario_phase_traffic = engine_traffic(eng);
+        oc_args.scenario_phase_latency = engine_collect_latency_snapshot(eng);
+    }
+    if(conf.latency_log_file) {
+        oc_args.latency_log =
+            hdrlog_open(conf.latency_log_file, tk_now(TK_DEFAULT));
+        if(!oc_args.latency_log) {
+            fprintf(stderr, "--latency-log %s: %s\n", conf.latency_log_file,
+                    errno == ENOTSUP
+                        ? "tcpkali is built without zlib support"
+                        : strerror(errno));
+            exit(EX_CANTCREAT);
+        }
+        oc_args.previous_log_latency = engine_collect_latency_snapshot(eng);
+        oc_args.checkpoint.last_latency_log_flush = tk_now(TK_DEFAULT);
+    }
+    if(conf.timeseries_file) {
+        oc_args.timeseries = timeseries_open(conf.timeseries_file);
+        if(!oc_args.timeseries) {
+            fprintf(stderr, "--timeseries %s: %s\n", conf.timeseries_file,
+                    errno == EINVAL ? "Not a --timeseries file"
+                                    : strerror(errno));
+            exit(EX_CANTCREAT);
+        }
+    }
+    if(conf.shm_stats_name) {
+        oc_args.shm_stats = shm_stats_open(conf.shm_stats_name);
+        if(!oc_args.shm_stats) {
+            fprintf(stderr, "--shm-stats %s: %s\n", conf.shm_stats_name,
+                    errno == EINVAL   ? "Not a valid --shm-stats segment"
+                    : errno == ENOSPC ? "All the instance slots are taken"
+                                      : strerror(errno));
+            exit(EX_CANTCREAT);
+        }
+    }
+    if(conf.json_stream) oc_args.json_stream = stdout;
+    /* --compare-to keeps the reports of this run, as --json-stream does. */
+    char *compare_text = NULL;
+    size_t compare_size = 0;
+    if(baseline) {
+        oc_args.compare_stream = open_memstream(&compare_text, &compare_size);
+        assert(oc_args.compare_stream);
+    }
+    if(conf.ab) {
+        oc_args.ab_runs[0] = compare_run_new();
+        oc_args.ab_runs[1] = compare_run_new();
+    }
+    if(conf.json_stream || baseline) {
+        oc_args.json_stream_start = tk_now(TK_DEFAULT);
+        oc_args.json_traffic_stats = engine_traffic(eng);
+        if(engine_params.cpu_cost)
+            engine_cpu_stats(eng, &oc_args.json_cpu_stats);
+        oc_args.previous_json_latency = engine_collect_latency_snapshot(eng);
+        oc_args.checkpoint.last_json_stream = tk_now(TK_DEFAULT);
+    }
+    if(orch_state.connected) {
+        size_t connecting, conns_in, conns_out;
+        engine_get_connection_stats(eng, &connecting, &conns_in, &conns_out,
+                                    &oc_args.orch_connections_counter);
+        oc_args.orch_traffic_stats = engine_traffic(eng);
+        oc_args.previous_orch_latency = engine_collect_latency_snapshot(eng);
+        oc_args.checkpoint.last_orch_stats = tk_now(TK_DEFAULT);
+    }
     mavg_init(&oc_args.traffic_mavgs[0], tk_now(TK_DEFAULT), 1.0 / 8, 3.0);
     mavg_init(&oc_args.traffic_mavgs[1], tk_now(TK_DEFAULT), 1.0 / 8, 3.0);
     mavg_init(&oc_args.count_mavgs[0], tk_now(TK_DEFAULT), 1.0 / 8, 3.0);
     mavg_init(&oc_args.count_mavgs[1], tk_now(TK_DEFAULT), 1.0 / 8, 3.0);
+    mavg_init(&oc_args.churn_mavgs[0], tk_now(TK_DEFAULT), 1.0 / 8, 3.0);
+    mavg_init(&oc_args.churn_mavgs[1], tk_now(TK_DEFAULT), 1.0 / 8, 3.0);
 
     /*
      * Convert SIGINT into change of a flag.
@@ -1115,18 +4335,51 @@ main(int argc, char **argv) {
      */
     flagify_term_signals(&oc_args.term_flag);
 
+    /*
+     * Start in lockstep with the other nodes driven by the same
+     * orchestration server.
+     */
+    if(orch_start_at) {
+        uint64_t now_usec = tk_clock_realtime_usec();
+        if(orch_start_at > now_usec) {
+            fprintf(stderr, "Waiting %.3fs for the synchronized start\n",
+                    (orch_start_at - now_usec) / 1000000.0);
+        } else {
+            fprintf(stderr, "Synchronized start time is %.3fs in the past\n",
+                    (now_usec - orch_start_at) / 1000000.0);
+        }
+        while(tk_clock_sleep_until_usec(orch_start_at) == -1) {
+            if(errno != EINTR) {
+                fprintf(stderr, "Can not wait for the start time: %s\n",
+                        strerror(errno));
+                break;
+            }
+            if(oc_args.term_flag) exit(EX_USAGE);
+        }
+        tk_now_update(TK_DEFAULT);
+        oc_args.load_profile_start = tk_now(TK_DEFAULT);
+        oc_args.scenario_phase_start = tk_now(TK_DEFAULT);
+        oc_args.checkpoint.last_orch_stats = tk_now(TK_DEFAULT);
+        oc_args.json_stream_start = tk_now(TK_DEFAULT);
+        oc_args.checkpoint.last_json_stream = tk_now(TK_DEFAULT);
+    }
+
     /*
      * Ramp up to the specified number of connections by opening them at a
      * specifed --connect-rate.
      */
-    if(conf.max_connections) {
+    enum oc_return_value orv = OC_CONNECTED;
+    oc_args.checkpoint.epoch_start = tk_now(TK_DEFAULT);
+    if(conf.max_connections && !conf.load_profile
+       && connection_modulator.mode == CM_UNMODULATED) {
         oc_args.epoch_end = tk_now(TK_DEFAULT) + conf.test_duration;
-        if(open_connections_until_maxed_out(PHASE_ESTABLISHING_CONNECTIONS,
-                &oc_args, &orch_state) == OC_CONNECTED) {
+        orv = open_connections_until_maxed_out(PHASE_ESTABLISHING_CONNECTIONS,
+                                               &oc_args, &orch_state);
+        if(orv == OC_CONNECTED) {
             fprintf(stderr, "%s", tcpkali_clear_eol());
             fprintf(stderr, "Ramped up to %d connections.\n",
                     conf.max_connections);
-        } else {
+        } else if(orv != OC_ABORTED) {
             fprintf(stderr, "%s", tcpkali_clear_eol());
             fprintf(stderr,
                     "Could not create %d connection%s"
@@ -1143,19 +4396,108 @@ main(int argc, char **argv) {
      * Start measuring the steady-state performance, as opposed to
      * ramping up and waiting for the connections to be established.
      * (initial_traffic_stats) contain traffic numbers accumulated duing
-     * ramp-up time.
+     * ramp-up time. Aborted during ramp-up, the numbers cover the ramp-up.
      */
-    oc_args.checkpoint.initial_traffic_stats = engine_traffic(eng);
-    oc_args.checkpoint.epoch_start = tk_now(TK_DEFAULT);
+    if(orv != OC_ABORTED) {
+        oc_args.checkpoint.initial_traffic_stats = engine_traffic(eng);
+        oc_args.checkpoint.epoch_start = tk_now(TK_DEFAULT);
 
-    /* Reset the test duration after ramp-up. */
-    oc_args.epoch_end = tk_now(TK_DEFAULT) + conf.test_duration;
-    enum oc_return_value orv = open_connections_until_maxed_out(
-                                    PHASE_STEADY_STATE, &oc_args, &orch_state);
+        /* Reset the test duration after ramp-up. */
+        oc_args.epoch_end = tk_now(TK_DEFAULT) + conf.test_duration;
+        if(conf.warmup >= 0) {
+            oc_args.warmup_end = tk_now(TK_DEFAULT) + conf.warmup;
+            /* The --load-profile has the warmup as its first part. */
+            if(!conf.load_profile) oc_args.epoch_end += conf.warmup;
+        }
+        orv = open_connections_until_maxed_out(PHASE_STEADY_STATE, &oc_args,
+                                               &orch_state);
+    }
+    dashboard_free(oc_args.dashboard);
+    oc_args.dashboard = NULL;
 
     fprintf(stderr, "%s", tcpkali_clear_eol());
+    if(conf.scenario) report_scenario_phase(&oc_args, tk_now(TK_DEFAULT));
+    write_latency_log_interval(&oc_args, tk_now(TK_DEFAULT));
+    tcpkali_send_stats(&oc_args, &orch_state, tk_now(TK_DEFAULT));
+    tcpkali_flush_orch_output(&orch_state, 1.0);
+    write_json_stream_interval(&oc_args, tk_now(TK_DEFAULT));
+    metrics_server_stop(metrics);
+    struct engine_summary summary;
     engine_terminate(eng, oc_args.checkpoint.epoch_start,
-                     oc_args.checkpoint.initial_traffic_stats, &latency_percentiles);
+                     oc_args.checkpoint.initial_traffic_stats, &latency_percentiles,
+                     &summary);
+    clock_sync_free(clock_sync);
+    if(orv == OC_ABORTED) {
+        struct abort_condition *cond = oc_args.aborted;
+        snprintf(summary.abort.condition, sizeof(summary.abort.condition),
+                 "%s", cond->text);
+        summary.abort.value =
+            cond->metric == AM_ERRORS ? cond->value : 1000 * cond->value;
+        fprintf(stderr, "Aborted on --abort-if %s: %g%s\n", cond->text,
+                summary.abort.value,
+                cond->metric == AM_ERRORS ? " errors/s" : " ms");
+    }
+    if(orv == OC_STEADY) {
+        summary.steady.windows = conf.stable_windows;
+        summary.steady.after = summary.test_duration;
+        printf("Steady state after %.1fs, over the last %d seconds:\n",
+               summary.steady.after, summary.steady.windows);
+        for(int m = 0; m < ESM_METRICS; m++) {
+            struct stable_estimate est;
+            stable_estimate(&stable_detector, m, &est);
+            summary.steady.values[m].mean = est.measured ? est.mean : NAN;
+            summary.steady.values[m].ci95 = est.measured ? est.ci95 : NAN;
+            if(!est.measured) continue;
+            printf("  %-10s %.*f ± %.*f (cv %.1f%%)\n",
+                   engine_steady_metric_name(m), m == ESM_LATENCY ? 3 : 0,
+                   est.mean, m == ESM_LATENCY ? 3 : 0, est.ci95,
+                   100 * est.cv);
+        }
+    }
+    if(oc_args.until_stable) stable_free(&stable_detector);
+    if(procs) procs_report(procs, proc_index, &summary);
+    if(oc_args.json_stream) {
+        json_report_write(oc_args.json_stream, "final",
+                          tk_now(TK_DEFAULT) - oc_args.json_stream_start,
+                          &engine_params, &summary, &latency_percentiles);
+    }
+    if(json_report) {
+        json_report_write(json_report, "final", summary.test_duration,
+                          &engine_params, &summary, &latency_percentiles);
+        if(json_report != stdout && fclose(json_report) != 0) {
+            fprintf(stderr, "--json-report %s: %s\n", conf.json_report_file,
+                    strerror(errno));
+        }
+    }
+    int regressions = 0;
+    if(baseline) {
+        json_report_write(oc_args.compare_stream, "final",
+                          summary.test_duration, &engine_params, &summary,
+                          &latency_percentiles);
+        fclose(oc_args.compare_stream);
+        oc_args.compare_stream = NULL;
+        struct compare_run *current =
+            compare_run_load(compare_text, compare_size);
+        assert(current);
+        printf("Compared to --compare-to %s:\n", conf.compare_to);
+        regressions = compare_runs(stdout, baseline, current,
+                                   &conf.compare_thresholds);
+        if(regressions)
+            fprintf(stderr, "%d metrics regressed against %s\n", regressions,
+                    conf.compare_to);
+        compare_run_free(current);
+        compare_run_free(baseline);
+        free(compare_text);
+    }
+    report_ab_comparison(&oc_args, &summary);
+    engine_free_summary(&summary);
+    hdrlog_close(oc_args.latency_log);
+    timeseries_close(oc_args.timeseries);
+    shm_stats_close(oc_args.shm_stats);
+    dns_refresh_stop(engine_params.dns_refresh);
+    if(engine_params.remote_alias)
+        balance_alias_free(engine_params.remote_alias);
+    if(engine_params.remote_ring) balance_ring_free(engine_params.remote_ring);
 
     /* Send zeroes, otherwise graphs would continue showing non-zeroes... */
     report_to_statsd(statsd, 0, requested_latency_types, &latency_percentiles);
@@ -1175,6 +4517,19 @@ main(int argc, char **argv) {
                     rate_modulator.latency_target_s, conf.test_duration);
             exit(EX_UNAVAILABLE);
         }
+        if(connection_modulator.mode != CM_UNMODULATED) {
+            fprintf(stderr,
+                    "Failed to find the max %s in -T%g seconds "
+                    "(in range %g..%g)\n",
+                    connection_modulator.mode == CM_MAX_CONNECTIONS
+                        ? "--connections"
+                        : "--connect-rate",
+                    conf.test_duration, connection_modulator.lower_bound,
+                    connection_modulator.upper_bound
+                        ? connection_modulator.upper_bound
+                        : connection_modulator.limit);
+            exit(EX_UNAVAILABLE);
+        }
         break;
     case OC_RATE_GOAL_MET:
         printf("Best --message-rate for latency %s⁹⁵ᵖ is %g\n",
@@ -1188,11 +4543,71 @@ main(int argc, char **argv) {
                 rate_modulator.latency_target_s);
         exit(EX_UNAVAILABLE);
         break;
+    case OC_CONNS_GOAL_MET:
+        if(connection_modulator.mode == CM_MAX_CONNECT_RATE) {
+            printf("Max --connect-rate for connect latency %s⁹⁵ᵖ is %g "
+                   "(%g: %s)\n",
+                   connection_modulator.latency_target_s,
+                   connection_modulator.lower_bound,
+                   connection_modulator.upper_bound,
+                   connection_modulator.breach);
+        } else if(connection_modulator.lower_bound
+                  >= connection_modulator.limit) {
+            printf("All --find-max-connections %.0f connections sustained\n",
+                   connection_modulator.limit);
+        } else {
+            printf("Max --connections sustained is %.0f (%.0f: %s)\n",
+                   connection_modulator.lower_bound,
+                   connection_modulator.upper_bound,
+                   connection_modulator.breach);
+        }
+        break;
+    case OC_CONNS_GOAL_FAILED:
+        fprintf(stderr,
+                "Max %s can not be determined: %g not sustained (%s)\n",
+                connection_modulator.mode == CM_MAX_CONNECTIONS
+                    ? "--connections"
+                    : "--connect-rate",
+                connection_modulator.upper_bound, connection_modulator.breach);
+        exit(EX_UNAVAILABLE);
+        break;
+    case OC_ABORTED:
+        exit(TCPKALI_EXIT_ABORTED);
+        break;
+    case OC_STEADY:
+        break;
     }
 
+    if(regressions) exit(TCPKALI_EXIT_REGRESSION);
     return 0;
 }
 
+/*
+ * Parse the string which is searched for or sent verbatim,
+ * such as --message-stop. Exits on errors.
+ */
+static void
+parse_trivial_expression(tk_expr_t **expr, const char *option,
+                         const char *str, size_t size, int unescape) {
+    char *data = malloc(size + 1);
+    assert(data);
+    memcpy(data, str, size);
+    data[size] = '\0';
+    if(unescape) unescape_data(data, &size);
+    if(size == 0) {
+        fprintf(stderr, "%s: Non-empty message expected\n", option);
+        exit(EX_USAGE);
+    }
+    if(parse_expression(expr, data, size, 0) == -1) {
+        fprintf(stderr, "%s: Failed to parse expression\n", option);
+        exit(EX_USAGE);
+    } else if(!EXPR_IS_TRIVIAL(*expr)) {
+        fprintf(stderr, "%s: Non-trivial expressions are not supported\n",
+                option);
+        exit(EX_USAGE);
+    }
+}
+
 static double
 parse_with_multipliers(const char *option, char *str, struct multiplier *ms,
                        int n) {
@@ -1219,6 +4634,238 @@ parse_with_multipliers(const char *option, char *str, struct multiplier *ms,
     return value;
 }
 
+/*
+ * Resolve the destinations one by one, noting the destination
+ * (an index into hostports) each resolved address came from.
+ */
+static struct addresses
+resolve_each_address(char **hostports, int nhostports, size_t **targets) {
+    struct addresses addresses = {0, 0};
+
+    *targets = NULL;
+    for(int n = 0; n < nhostports; n++) {
+        struct addresses one = resolve_remote_addresses(&hostports[n], 1);
+        *targets = realloc(*targets, (addresses.n_addrs + one.n_addrs + 1)
+                                         * sizeof(**targets));
+        assert(*targets);
+        for(size_t i = 0; i < one.n_addrs; i++) {
+            (*targets)[addresses.n_addrs] = n;
+            address_add(&addresses, (struct sockaddr *)&one.addrs[i]);
+        }
+        free(one.addrs);
+    }
+
+    return addresses;
+}
+
+/*
+ * Resolve the destinations one by one, giving each resolved address
+ * its share of the --remote-weights weight of its destination.
+ */
+static struct addresses
+resolve_weighted_addresses(char **hostports, int nhostports,
+                           const char *weights_list, double **weights,
+                           size_t **targets) {
+    double *target_weights = malloc(nhostports * sizeof(*target_weights));
+    size_t *target_addrs = calloc(nhostports, sizeof(*target_addrs));
+    const char *p = weights_list;
+    double sum = 0.0;
+
+    assert(target_weights && target_addrs);
+    for(int n = 0; n < nhostports; n++) {
+        char *endptr;
+        double w = strtod(p, &endptr);
+        if(endptr == p || w < 0.0 || !isfinite(w)
+           || *endptr != (n + 1 < nhostports ? ',' : '\0')) {
+            fprintf(stderr,
+                    "--remote-weights=%s: expected %d comma-separated "
+                    "non-negative weights, one per destination\n",
+                    weights_list, nhostports);
+            exit(EX_USAGE);
+        }
+        p = endptr + 1;
+        sum += w;
+        target_weights[n] = w;
+    }
+
+    if(sum == 0.0) {
+        fprintf(stderr, "--remote-weights=%s: all weights are zero\n",
+                weights_list);
+        exit(EX_USAGE);
+    }
+
+    struct addresses addresses =
+        resolve_each_address(hostports, nhostports, targets);
+    *weights = malloc((addresses.n_addrs + 1) * sizeof(**weights));
+    assert(*weights);
+    for(size_t i = 0; i < addresses.n_addrs; i++)
+        target_addrs[(*targets)[i]]++;
+    for(size_t i = 0; i < addresses.n_addrs; i++) {
+        size_t n = (*targets)[i];
+        (*weights)[i] = target_weights[n] / target_addrs[n];
+    }
+    free(target_weights);
+    free(target_addrs);
+
+    return addresses;
+}
+
+/*
+ * Cut the @rate=<R>,max=<N> quotas off the host:port destinations.
+ * Returns the quota of each destination, or NULL if none has any.
+ */
+static struct remote_quota *
+parse_remote_quotas(char **hostports, int nhostports) {
+    struct remote_quota *quotas = NULL;
+
+    for(int n = 0; n < nhostports; n++) {
+        char *spec = strrchr(hostports[n], '@');
+        if(!spec || (strncmp(spec, "@rate=", 6) && strncmp(spec, "@max=", 5)))
+            continue;
+        if(!quotas) {
+            quotas = calloc(nhostports, sizeof(*quotas));
+            assert(quotas);
+        }
+        *spec++ = '\0';
+
+        for(char *p = spec; p;) {
+            char *next = strchr(p, ',');
+            if(next) *next++ = '\0';
+            char *value = strchr(p, '=');
+            if(value) *value++ = '\0';
+
+            if(value && strcmp(p, "rate") == 0) {
+                quotas[n].connect_rate = parse_with_multipliers(
+                    "rate", value, km_multiplier,
+                    sizeof(km_multiplier) / sizeof(km_multiplier[0]));
+                if(quotas[n].connect_rate <= 0) {
+                    fprintf(stderr, "%s: expected @rate > 0\n",
+                            hostports[n]);
+                    exit(EX_USAGE);
+                }
+            } else if(value && strcmp(p, "max") == 0) {
+                double max = parse_with_multipliers(
+                    "max", value, km_multiplier,
+                    sizeof(km_multiplier) / sizeof(km_multiplier[0]));
+                if(max < 1) {
+                    fprintf(stderr, "%s: expected @max > 0\n",
+                            hostports[n]);
+                    exit(EX_USAGE);
+                }
+                quotas[n].max_connections = max;
+            } else {
+                fprintf(stderr,
+                        "%s: unknown quota %s, expected @rate=<R> "
+                        "and max=<N>\n",
+                        hostports[n], p);
+                exit(EX_USAGE);
+            }
+            p = next;
+        }
+    }
+
+    return quotas;
+}
+
+/*
+ * Parse a --connection-group "share=<N>[%],name=...,rate=...,message=..."
+ * specification. The message= comes last, as it takes the rest of it.
+ */
+static void
+parse_connection_group(const char *spec, int unescape,
+                       struct connection_group *group,
+                       struct group_targets *targets) {
+    const char *option = "--connection-group";
+    char *copy = strdup(spec);
+    assert(copy);
+
+    memset(group, 0, sizeof(*group));
+    memset(targets, 0, sizeof(*targets));
+    group->channel_lifetime = NAN; /* --channel-lifetime, unless lifetime= */
+
+    for(char *p = copy; p && *p;) {
+        char *value = strchr(p, '=');
+        if(!value) {
+            fprintf(stderr, "%s %s: expected attribute=value, not \"%s\"\n",
+                    option, spec, p);
+            exit(EX_USAGE);
+        }
+        *value++ = '\0';
+        if(strcmp(p, "message") == 0) {
+            message_collection_add(&group->message_collection,
+                                   MSK_PURPOSE_MESSAGE, value, strlen(value),
+                                   unescape, 1);
+            break;
+        }
+        char *next = strchr(value, ',');
+        if(next) *next++ = '\0';
+
+        if(strcmp(p, "share") == 0) {
+            char *endptr;
+            group->share = strtod(value, &endptr);
+            if(*endptr == '%') endptr++;
+            if(endptr == value || *endptr || !(group->share > 0.0)
+               || !isfinite(group->share)) {
+                fprintf(stderr, "%s %s: expected positive share=%s\n", option,
+                        spec, value);
+                exit(EX_USAGE);
+            }
+        } else if(strcmp(p, "name") == 0) {
+            group->name = strdup(value);
+        } else if(strcmp(p, "rate") == 0) {
+            double rate = parse_with_multipliers(
+                option, value, km_multiplier,
+                sizeof(km_multiplier) / sizeof(km_multiplier[0]));
+            if(rate <= 0) {
+                fprintf(stderr, "%s %s: expected rate > 0\n", option, spec);
+                exit(EX_USAGE);
+            }
+            group->channel_send_rate = RATE_MPS(rate);
+            group->own_send_rate = 1;
+        } else if(strcmp(p, "upstream") == 0) {
+            double Bps = parse_with_multipliers(
+                option, value, bw_multiplier,
+                sizeof(bw_multiplier) / sizeof(bw_multiplier[0]));
+            if(Bps <= 0) {
+                fprintf(stderr, "%s %s: expected upstream > 0\n", option,
+                        spec);
+                exit(EX_USAGE);
+            }
+            group->channel_send_rate = RATE_BPS(Bps);
+            group->own_send_rate = 1;
+        } else if(strcmp(p, "lifetime") == 0) {
+            group->channel_lifetime = parse_with_multipliers(
+                option, value, s_multiplier,
+                sizeof(s_multiplier) / sizeof(s_multiplier[0]));
+            if(group->channel_lifetime <= 0.0) {
+                fprintf(stderr, "%s %s: expected positive lifetime\n", option,
+                        spec);
+                exit(EX_USAGE);
+            }
+        } else if(strcmp(p, "target") == 0) {
+            targets->hostports =
+                realloc(targets->hostports, (targets->n_hostports + 1)
+                                                * sizeof(targets->hostports[0]));
+            assert(targets->hostports);
+            targets->hostports[targets->n_hostports++] = strdup(value);
+        } else {
+            fprintf(stderr,
+                    "%s %s: unknown attribute %s, expected share, name, "
+                    "rate, upstream, lifetime, target or message\n",
+                    option, spec, p);
+            exit(EX_USAGE);
+        }
+        p = next;
+    }
+
+    if(group->share == 0.0) {
+        fprintf(stderr, "%s %s: share= is required\n", option, spec);
+        exit(EX_USAGE);
+    }
+
+    free(copy);
+}
+
 static int
 parse_percentile_values(const char *option, char *str,
                        struct percentile_values *array) {
@@ -1306,30 +4953,138 @@ usage_long(char *argv0, struct tcpkali_config *conf) {
     "  --dump-one-in                Dump incoming data for a single connection\n"
     "  --dump-one-out               Dump outgoing data for a single connection\n"
     "  --dump-{all,all-in,all-out}  Dump i/o data for all connections\n"
+    "  --record <dir>               Record the received data into files in dir\n"
+    "  --record-sample <Fraction>   Record only a fraction of the connections\n"
+    "  --per-connection-stats <f>   Write a CSV line per closed connection\n"
+    "  --per-peer-stats <Bits>      Report the -l traffic by the peer subnet\n"
     "  --nagle {on|off}             Control Nagle algorithm (set TCP_NODELAY)\n"
     "  --rcvbuf <SizeBytes>         Set TCP receive buffers (set SO_RCVBUF)\n"
     "  --sndbuf <SizeBytes>         Set TCP send buffers (set SO_SNDBUF)\n"
+    "  --rcvlowat <SizeBytes>       Wake up for that much data (SO_RCVLOWAT)\n"
+    "  --notsent-lowat <SizeBytes>  Limit unsent data (TCP_NOTSENT_LOWAT)\n"
+    "  --read-buffer <SizeBytes>    Receive buffer of a worker (default 16k)\n"
+    "  --read-budget <SizeBytes>    Read up to that much per event (default 64k)\n"
     "  --source-ip <IP>             Use the specified IP address to connect\n"
-    "  --write-combine off          Disable batching adjacent writes\n"
+    "  --source-ipv6-prefix <Prefix/Len>\n"
+    "                               Connect from random IPv6 addresses in it\n"
+    "  --proxy-protocol v1|v2       Start with a PROXY protocol header\n"
+    "  --proxy-source <Addr/Len>    Announce random client addresses from it\n"
+    "  --write-combine off|cork|adaptive\n"
+    "                               Disable batching adjacent writes,\n"
+    "                               batch whole messages only, or batch\n"
+    "                               only while the socket is backed up\n"
+    "  --zerocopy                   Send large writes with MSG_ZEROCOPY\n"
+    "  --zerocopy-receive           Map the received pages, no copying\n"
+    "  --sendfile                   Send the --message-file with sendfile(2)\n"
+    "  --tcp-info                   Report RTT, retransmits, cwnd from TCP_INFO\n"
+    "  --mptcp                      Use Multipath TCP, report its subflows\n"
+    "  --tcp-fastopen               Send the first data in the SYN (TFO)\n"
+    "  --udp                        Send messages as datagrams over UDP\n"
     "  -w, --workers <N=%ld>%s         Number of parallel threads to use\n"
+    "  --processes <N>              Split the load into N forked processes\n"
+    "  --cpu-affinity <CPUs|auto>   Pin the workers to the CPUs, e.g. 0-3,8\n"
+    "  --rebalance                  Move connections off the busiest workers\n"
+    "  --worker-select <strategy>   Spread new connections over the workers:\n"
+    "                               even (default), least-conn or least-busy\n"
+    "  --prewarm                    Allocate for all --connections upfront\n"
+    "  --mlockall                   Lock the memory with mlockall(2)\n"
+    "  --memory-report              Report the memory used per connection\n"
+    "  --cpu-cost                   Report the CPU time and cycles per message\n"
+    "  --idle-connections           Grow the latency state on first use\n"
+    "  --hugepages                  Keep connections and payloads in 2MB pages\n"
+    "  --preflight[=apply]          Check (and raise) the kernel limits first\n"
     "\n"
     "  --ws, --websocket            Use RFC6455 WebSocket transport\n"
+    "  --websocket-mask <key>       Client frames mask: \"zero\" (default) or \"random\"\n"
+    "  --websocket-deflate          Send compressed frames (permessage-deflate)\n"
     "  --ssl                        Enable TLS\n"
     "  --ssl-cert <filename>        X.509 certificate file (default: cert.pem)\n"
     "  --ssl-key <filename>         Private key file (default: key.pem)\n"
+    "  --ssl-session-reuse          Resume TLS sessions to each destination\n"
+    "  --ssl-ktls                   Offload TLS encryption into the kernel\n"
     "  -H, --header <string>        Add HTTP header into WebSocket handshake\n"
+    "  --http                       Count and time the HTTP/1.1 responses\n"
+    "  --http2                      Send --message as HTTP/2 requests\n"
+    "  --grpc                       gRPC calls to the /package.Service/Method\n"
+    "  --grpc-stream                Stream --message over one gRPC call\n"
+    "  --resp                       Send --message as a Redis command\n"
+    "  --mqtt                       Send --message as MQTT PUBLISH packets\n"
+    "  --mqtt-version <3.1.1|5>     MQTT protocol version (default: 3.1.1)\n"
+    "  --mqtt-topic <string>        Topic of the PUBLISH (default: tcpkali)\n"
+    "  --mqtt-subscribe <string>    SUBSCRIBE to the topic filter at QoS 0\n"
+    "  --mqtt-qos <0|1>             QoS of the PUBLISH, 1 to time the PUBACKs\n"
+    "  --pipeline <N=1>             Requests in flight with --http, --http2, --resp\n"
+    "  --outstanding <N>            Unanswered messages per connection, answered\n"
+    "                               by the --framing frames or latency markers\n"
+    "  --think-time <Time>          Pause sending after each response\n"
+    "  --framing lenprefix:N:be|le  Count and time the length-prefixed frames\n"
+    "  --framer <so>[:<args>]       Count and time the responses of a plugin\n"
+    "  --message-corpus <file>      Send the lines (or --framing frames) of a file\n"
+    "  --message-corpus-order <mode>  Walk the corpus \"sequential\" (default)\n"
+    "                               or in \"random\" order\n"
+    "  --replay-pcap <file>         Replay the TCP client streams from a capture\n"
+    "  --replay-timing <mode>       Replay \"asap\" (default) or with the \"original\"\n"
+    "                               packet timing\n"
     "  -c, --connections <N=%d>      Connections to keep open to the destinations\n"
     "  --connect-rate <Rate=%g>     Limit number of new connections per second\n"
+    "  --load-profile <file>        Vary connections and rates over time\n"
+    "  --scenario <file>            Run the test in phases given in a file\n"
     "  --connect-timeout <Time=1s>  Limit time spent in a connection attempt\n"
+    "  --reconnect                  Replace the lost connections from the worker\n"
+    "  --reconnect-backoff <Time=100ms>  First delay after a failed reconnect\n"
+    "  --connect-backoff <Time>     Leave the failing destinations alone for\n"
+    "                               up to Time, doubled with each failure\n"
+    "  --connect-backoff-max <Time=10s>  Limit the --connect-backoff delay\n"
     "  --channel-lifetime <Time>    Shut down each connection after Time seconds\n"
+    "  --channel-lifetime-distribution <dist>  Vary the lifetime around the\n"
+    "                               mean, where <dist> is fixed (default),\n"
+    "                               uniform, exponential or lognormal[:sigma]\n"
+    "  --close-style <style>        Close with graceful (default), reset (RST),\n"
+    "                               half-close or wait-peer\n"
     "  --channel-bandwidth-upstream <Bandwidth>     Limit upstream bandwidth\n"
     "  --channel-bandwidth-downstream <Bandwidth>   Limit downstream bandwidth\n"
-    "  -l, --listen-port <port>     Listen on the specified port\n"
+    "  -l, --listen-port <port>     Listen on the specified port or unix:/path\n"
     "  --listen-mode=<mode>         What to do upon client connect, where <mode> is:\n"
     "               \"silent\"        Do not send data, ignore received data (default)\n"
     "               \"active\"        Actively send messages\n"
+    "               \"echo\"          Send the received data back (Linux)\n"
+    "               \"discard\"       Drop received data without copying it\n"
+    "               \"respond\"       Send --response for each --request-delimiter\n"
+    "  --listen-backlog <N=256>     Queue of the connections not yet accepted\n"
+    "  --accept-batch <N=64>        Accept up to N connections per event\n"
+    "  --defer-accept <Time>        Accept once the client sends (TCP_DEFER_ACCEPT)\n"
+    "  --reuseport-cpu              Pin the workers, accept on the receiving CPU\n"
+    "  --busy-poll <Time>           Spin for events for up to Time past the last one\n"
     "  -T, --duration <Time=10s>    Exit after the specified amount of time\n"
+    "  --warmup <Time>              Measure only after Time past the ramp-up\n"
+    "  --abort-if <Condition>       Exit early, e.g. \"latency.p99>50ms for 10s\"\n"
+    "  --until-stable <CV>          Exit once the numbers vary less, e.g. 5%%\n"
+    "  --stable-windows <N=10>      Seconds the --until-stable variation is taken over\n"
+    "  --find-max-connections <N>   Search for the most connections sustained, up to N\n"
+    "  --find-max-connect-rate <Latency>  Search for the most connects per second\n"
+    "                               within the 95p --latency-connect, churning\n"
+    "  --find-max-strategy <S>      Ramp up by \"double\" (default) or \"linear\" steps\n"
+    "  --find-max-latency <Latency> Not sustained above that 95p latency\n"
     "  --delay-send <Time>          Delay sending data by a specified amount of time\n"
+    "  --slow-send <Time>           Send one byte per Time on each connection\n"
+    "  --verify-echo                Check that the data comes back as sent\n"
+    "  --keepalive-message <string> Send it on the idle connections periodically\n"
+    "  --keepalive-interval <Time>  Period of the --keepalive-message or PINGREQ\n"
+    "  --dns-refresh <Time>         Re-resolve the destinations periodically\n"
+    "  --remote-select <strategy>   Spread connections over the destinations:\n"
+    "                               round-robin (default), weighted, hash\n"
+    "                               (of connection.uid), least-conn\n"
+    "                               or least-latency\n"
+    "  --remote-weights <w1,w2,...> Weights of the destinations, in order\n"
+    "  <host:port>@rate=<R>,max=<N> Connect to the destination at most <R>\n"
+    "                               per second, up to <N> connections open\n"
+    "  --connection-group <Spec>    A share of the connections with its own workload:\n"
+    "                               \"share=90%%,rate=10,lifetime=1m,target=<host:port>,\n"
+    "                               name=<Name>,message=<string>\" (message= last)\n"
+    "  --ab                         Compare the two <host:port> destinations, A and B:\n"
+    "                               half of the connections each, same messages\n"
+    "  --mirror <host:port>         Copy what each connection writes to its twin\n"
+    "                               connection to this target\n"
     "\n"
     "  -e, --unescape-message-args  Unescape the message data arguments\n"
     "  -1, --first-message <string> Send this message first, once\n"
@@ -1338,20 +5093,85 @@ usage_long(char *argv0, struct tcpkali_config *conf) {
     "  -f, --message-file <name>    Read message to send from a file\n"
     "  -r, --message-rate <Rate>    Messages per second to send in a connection\n"
     "  -r, --message-rate @<Latency> Measure a message rate at a given latency\n"
+    "  --rate-control <method>      Find the -r @<Latency> rate by binary \"search\"\n"
+    "                               (default) or by a \"pi\" controller\n"
+    "  --message-arrival <law>      Message intervals: \"uniform\" or \"poisson\"\n"
+    "  --message-rate-jitter <J>    Start each connection at a random \"phase\",\n"
+    "                               and vary the intervals by a fraction J\n"
+    "  --burst <N>                  Messages (bytes with upstream bandwidth)\n"
+    "                               sent at once after a stall (default: 2s)\n"
+    "  --burst-every <T>            Have all connections send --burst-size\n"
+    "                               messages at once, every T (e.g. 1s)\n"
+    "  --burst-size <N>             Messages per connection per burst (default: 1)\n"
+    "  --send-budget <N>            Write at most N paced connections per event\n"
+    "                               loop iteration, the most overdue first\n"
+    "  --catch-up <policy>          After a stall, \"drop\" the pace beyond\n"
+    "                               the --burst (default), \"smooth\" or \"full\"\n"
+    "  --rate-scope <scope>         Apply -r and upstream bandwidth limits to\n"
+    "                               each \"connection\" (default) or in \"total\"\n"
+    "  --message-rate-distribution <zipf:s|pareto:a>\n"
+    "                               Skew the per-connection rates, same total\n"
+    "  --kernel-pacing              Pace the upstream with SO_MAX_PACING_RATE\n"
+    "  --timer-granularity <T=1ms>  Wake the paced connections in ticks of T\n"
     "  --message-stop <string>      Abort if this string is found in received data\n"
+    "                               (repeat for more strings)\n"
+    "  --request-delimiter <string> End of a request, for --listen-mode=respond\n"
+    "  --response <string>          Response to each request\n"
+    "  --response-file <name>       Read the response from a file\n"
     "\n"
     "  --latency-connect            Measure TCP connection establishment latency\n"
     "  --latency-first-byte         Measure time to first byte latency\n"
+    "  --latency-handshake          Measure TLS handshake latency (--ssl)\n"
+    "  --latency-upgrade            Measure WebSocket upgrade latency (--ws)\n"
     "  --latency-marker <string>    Measure latency using a per-message marker\n"
     "  --latency-marker-skip <N>    Ignore the first N occurrences of a marker\n"
+    "  --latency-sample 1/<N>       Measure the latency of every Nth message\n"
     "  --latency-percentiles <list> Report latency at specified percentiles\n"
+    "  --latency-log <filename>     Write HdrHistogram interval log, every 1s\n"
+    "  --latency-per-connection     Keep a marker latency histogram per connection\n"
+    "  --latency-by-size            Report marker latencies by message size\n"
+    "  --latency-slowest <N>        Report the N slowest messages' connections\n"
+    "  --latency-correction <mode>  Measure from the intended send time, where\n"
+    "                               <mode> is \"off\" (default), \"on\" or \"both\"\n"
+    "  --latency-timestamping <ts>  Use kernel send and receive times, where\n"
+    "                               <ts> is \"off\" (default), \"software\" or\n"
+    "                               \"hardware\"\n"
     "  --message-marker             Parse markers to calculate latency\n"
+    "  --message-marker-format <f>  Marker encoding: \"text\" (default) or \"binary\"\n"
+    "  --fanout                     Track the binary markers by publisher, on any\n"
+    "                               receiving connection\n"
+    "  --latency-clock <clock>      Message marker time source, where <clock> is:\n"
+    "               \"realtime\"      Read the wall clock for every use (default)\n"
+    "               \"cached\"        Read the wall clock once per loop iteration\n"
+    "               \"monotonic\"     Nanosecond TSC/CLOCK_MONOTONIC_RAW clock\n"
+    "  --clock-offset <[-]T>        The peer's clock runs ahead of ours by <T>\n"
+    "  --clock-sync                 Measure the --clock-offset with the peer (UDP)\n"
+    "  --latency-resolution <T=100us>  Smallest latency told apart (1ns..1s)\n"
+    "  --latency-max <T=100s>       Largest latency recorded\n"
     "\n"
     "  --statsd                     Enable StatsD output (default %s)\n"
     "  --statsd-host <host>         StatsD host to send data (default is localhost)\n"
     "  --statsd-port <port>         StatsD port to use (default is %d)\n"
     "  --statsd-namespace <string>  Metric namespace (default is \"%s\")\n"
     "  --statsd-latency-window <T>  Aggregate latencies in discrete windows\n"
+    "  --statsd-latency-step <T>    Slide the latency window every <T>\n"
+    "  --statsd-mtu <size>          StatsD datagram size limit (default is %d)\n"
+    "  --statsd-tags <tags>         DogStatsD tags, per-worker/remote metrics\n"
+    "  --metrics-listen <[host:]port>  Serve Prometheus metrics over HTTP\n"
+    "  --json-report <filename>     Write the final results as JSON (\"-\": stdout)\n"
+    "  --json-stream                Print JSON results to stdout, every 1s\n"
+    "  --compare-to <filename>      Exit with 4 on regressions against a\n"
+    "                               --json-report or --json-stream baseline\n"
+    "  --compare-threshold <list>   Regression thresholds (default: 5%%,\n"
+    "                               latency=10%%): <N>%%, throughput=<N>%%,\n"
+    "                               connect-rate=<N>%%, latency=<N>%%\n"
+    "  --dashboard                  Full-screen per-worker numbers, every 1s\n"
+    "  --timeseries <filename>      Append binary stats records, every 0.25s\n"
+    "  --timeseries-csv <filename>  Print a --timeseries file as CSV and exit\n"
+    "  --sample-interval <T>        Spread of the throughput over <T> intervals,\n"
+    "                               also the --timeseries record interval\n"
+    "  --shm-stats <name>           Publish the numbers for an --aggregate view\n"
+    "  --aggregate <name>           Merge the --shm-stats instances, every 1s\n"
     "\n"
     "  --server <host:port>         Orchestration server to connect to\n"
     "\n"
@@ -1366,7 +5186,7 @@ usage_long(char *argv0, struct tcpkali_config *conf) {
         (_DBG_MAX - 1), number_of_cpus(), number_of_cpus() < 10 ? " " : "",
         conf->max_connections, conf->connect_rate,
         conf->statsd_enable ? "enabled" : "disabled", conf->statsd_port,
-        conf->statsd_namespace);
+        conf->statsd_namespace, conf->statsd_mtu);
 }
 
 static void
@@ -1410,3 +5230,14 @@ usage_short(char *argv0) {
     );
     /* clang-format on */
 }
+
+/*
+ * The monotonic time in seconds, for the startup report;
+ * the event loop time is not there yet.
+ */
+static double
+startup_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
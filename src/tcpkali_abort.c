@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <assert.h>
+
+#include "tcpkali_abort.h"
+
+static const struct {
+    const char *name;
+    enum abort_metric metric;
+} metrics[] = {{"connect", AM_LATENCY_CONNECT},
+               {"firstbyte", AM_LATENCY_FIRSTBYTE},
+               {"handshake", AM_LATENCY_HANDSHAKE},
+               {"upgrade", AM_LATENCY_UPGRADE},
+               {"latency", AM_LATENCY_MARKER},
+               {"marker", AM_LATENCY_MARKER},
+               {"errors", AM_ERRORS}};
+
+static const char *
+skip_spaces(const char *p) {
+    while(isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+/*
+ * Parse the number with an optional multiplier suffix:
+ * us, ms and s for the times, k and M for the counts.
+ * Returns the position past the number, or NULL.
+ */
+static const char *
+parse_number(const char *p, int is_time, double *value) {
+    char *end;
+    errno = 0;
+    double v = strtod(p, &end);
+    if(end == p || errno || !isfinite(v) || v < 0) return NULL;
+    p = end;
+
+    if(is_time) {
+        if(strncmp(p, "us", 2) == 0) v /= 1000000, p += 2;
+        else if(strncmp(p, "ms", 2) == 0) v /= 1000, p += 2;
+        else if(*p == 'm' && !isalpha((unsigned char)p[1])) v *= 60, p++;
+        else if(*p == 's') p++;
+    } else {
+        if(*p == 'k') v *= 1000, p++;
+        else if(*p == 'M') v *= 1000000, p++;
+    }
+    /* Not glued to a word, such as "10sec". */
+    if(isalpha((unsigned char)*p)) return NULL;
+
+    *value = v;
+    return p;
+}
+
+int
+abort_condition_add(struct abort_conditions *list, const char *str) {
+    struct abort_condition cond;
+    memset(&cond, 0, sizeof(cond));
+
+    const char *p = skip_spaces(str);
+    size_t i;
+    for(i = 0; i < sizeof(metrics) / sizeof(metrics[0]); i++) {
+        size_t len = strlen(metrics[i].name);
+        if(strncmp(p, metrics[i].name, len) == 0 && !isalpha((unsigned char)p[len])) {
+            p += len;
+            break;
+        }
+    }
+    if(i == sizeof(metrics) / sizeof(metrics[0])) {
+        fprintf(stderr,
+                "--abort-if %s: Expecting a metric "
+                "{latency|connect|firstbyte|handshake|upgrade}.p<N> "
+                "or errors\n",
+                str);
+        return -1;
+    }
+    cond.metric = metrics[i].metric;
+
+    if(cond.metric != AM_ERRORS) {
+        char *end;
+        if(strncmp(p, ".p", 2) != 0
+           || (cond.percentile = strtod(p + 2, &end), end == p + 2)
+           || !(cond.percentile > 0.0 && cond.percentile <= 100.0)) {
+            fprintf(stderr,
+                    "--abort-if %s: Expecting %s.p<N> with a percentile "
+                    "within (0..100]\n",
+                    str, metrics[i].name);
+            return -1;
+        }
+        p = end;
+    }
+
+    p = skip_spaces(p);
+    if(*p != '>' && *p != '<') {
+        fprintf(stderr, "--abort-if %s: Expecting > or < after %s\n", str,
+                metrics[i].name);
+        return -1;
+    }
+    cond.greater = (*p++ == '>');
+
+    p = parse_number(skip_spaces(p), cond.metric != AM_ERRORS, &cond.threshold);
+    if(!p) {
+        fprintf(stderr, "--abort-if %s: Expecting a %s threshold\n", str,
+                cond.metric != AM_ERRORS ? "time" : "numeric");
+        return -1;
+    }
+
+    p = skip_spaces(p);
+    if(strncmp(p, "for", 3) == 0 && !isalpha((unsigned char)p[3])) {
+        p = parse_number(skip_spaces(p + 3), 1, &cond.duration);
+        if(!p) {
+            fprintf(stderr, "--abort-if %s: Expecting a duration after \"for\"\n",
+                    str);
+            return -1;
+        }
+        p = skip_spaces(p);
+    }
+    if(*p) {
+        fprintf(stderr, "--abort-if %s: Unexpected \"%s\"\n", str, p);
+        return -1;
+    }
+
+    cond.text = strdup(str);
+    cond.value = NAN;
+    assert(cond.text);
+    list->conds =
+        realloc(list->conds, (list->count + 1) * sizeof(list->conds[0]));
+    assert(list->conds);
+    list->conds[list->count++] = cond;
+    return 0;
+}
+
+int
+abort_condition_update(struct abort_condition *cond, double window_start,
+                       double now, double value) {
+    if(isnan(value)) return 0;
+
+    cond->value = value;
+    if(cond->greater ? value > cond->threshold : value < cond->threshold) {
+        if(cond->held_since == 0.0) cond->held_since = window_start;
+        return now - cond->held_since >= cond->duration;
+    } else {
+        cond->held_since = 0.0;
+        return 0;
+    }
+}
+
+void
+abort_conditions_free(struct abort_conditions *list) {
+    for(size_t i = 0; i < list->count; i++) free(list->conds[i].text);
+    free(list->conds);
+    list->conds = NULL;
+    list->count = 0;
+}
+
+#ifdef TCPKALI_ABORT_UNIT_TEST
+
+int
+main() {
+    struct abort_conditions list = {NULL, 0};
+
+    assert(abort_condition_add(&list, "latency.p99>50ms for 10s") == 0);
+    assert(abort_condition_add(&list, " connect.p50 < 2s ") == 0);
+    assert(abort_condition_add(&list, "errors>1k") == 0);
+    assert(abort_condition_add(&list, "marker.p99.9>500us for 1m") == 0);
+    assert(list.count == 4);
+
+    struct abort_condition *c = &list.conds[0];
+    assert(c->metric == AM_LATENCY_MARKER && c->percentile == 99.0);
+    assert(c->greater && fabs(c->threshold - 0.05) < 1e-12);
+    assert(c->duration == 10.0);
+    assert(list.conds[1].metric == AM_LATENCY_CONNECT);
+    assert(!list.conds[1].greater && list.conds[1].threshold == 2.0);
+    assert(list.conds[2].metric == AM_ERRORS);
+    assert(list.conds[2].threshold == 1000 && list.conds[2].duration == 0);
+    assert(list.conds[3].percentile == 99.9 && list.conds[3].duration == 60);
+
+    /* Has to hold for 10 seconds of windows in a row. */
+    assert(abort_condition_update(c, 100, 101, 0.06) == 0);
+    assert(abort_condition_update(c, 101, 102, 0.01) == 0);
+    assert(c->held_since == 0.0);
+    for(int t = 102; t < 111; t++)
+        assert(abort_condition_update(c, t, t + 1, 0.07) == 0);
+    assert(abort_condition_update(c, 111, 112, NAN) == 0);
+    assert(c->value == 0.07);
+    assert(abort_condition_update(c, 112, 113, 0.08) == 1);
+
+    /* No duration: trips right away. */
+    assert(abort_condition_update(&list.conds[2], 0, 1, 999) == 0);
+    assert(abort_condition_update(&list.conds[2], 1, 2, 1001) == 1);
+
+    fprintf(stderr, "Expecting errors:\n");
+    assert(abort_condition_add(&list, "latency>50ms") == -1);
+    assert(abort_condition_add(&list, "latency.p0>50ms") == -1);
+    assert(abort_condition_add(&list, "throughput>1") == -1);
+    assert(abort_condition_add(&list, "errors=1") == -1);
+    assert(abort_condition_add(&list, "connect.p50>fast") == -1);
+    assert(abort_condition_add(&list, "connect.p50>1s for") == -1);
+    assert(abort_condition_add(&list, "connect.p50>1sec") == -1);
+    assert(abort_condition_add(&list, "errors>1 and more") == -1);
+    assert(list.count == 4);
+
+    abort_conditions_free(&list);
+    assert(list.count == 0);
+    return 0;
+}
+
+#endif /* TCPKALI_ABORT_UNIT_TEST */
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_ABORT_H
+#define TCPKALI_ABORT_H
+
+/*
+ * Conditions to end the test early, see --abort-if.
+ *
+ *     <metric> {>|<} <value> [for <duration>]
+ *
+ *     latency.p99>50ms for 10s     --latency-marker 99th percentile
+ *     connect.p50 > 1s             --latency-connect median
+ *     errors>100 for 5s            Connection failures per second
+ *
+ * The metrics are measured over one second windows. A condition trips
+ * once it has held in every window for at least its duration.
+ */
+
+#define TCPKALI_EXIT_ABORTED 3 /* Exit status once a condition trips */
+
+enum abort_metric {
+    AM_LATENCY_CONNECT,   /* connect.pNN, --latency-connect */
+    AM_LATENCY_FIRSTBYTE, /* firstbyte.pNN, --latency-first-byte */
+    AM_LATENCY_HANDSHAKE, /* handshake.pNN, --latency-handshake */
+    AM_LATENCY_UPGRADE,   /* upgrade.pNN, --latency-upgrade */
+    AM_LATENCY_MARKER,    /* latency.pNN or marker.pNN, --latency-marker */
+    AM_ERRORS,            /* errors, connection failures per second */
+};
+
+struct abort_condition {
+    char *text; /* As given, for the reports */
+    enum abort_metric metric;
+    double percentile; /* Of the latency metrics */
+    int greater;       /* Trip above the threshold, otherwise below */
+    double threshold;  /* Seconds for the latencies */
+    double duration;   /* Seconds the condition has to hold for */
+    double held_since; /* Window start it holds since, 0.0 if it does not */
+    double value;      /* The most recent value */
+};
+
+struct abort_conditions {
+    struct abort_condition *conds;
+    size_t count;
+};
+
+/*
+ * Parse the condition and append it to the list. The errors are printed
+ * to stderr. Returns 0 on success, -1 on error.
+ */
+int abort_condition_add(struct abort_conditions *, const char *str);
+
+/*
+ * Account for the (value) observed in the window which ended at (now).
+ * The (value) is NAN if there was nothing to measure, such as no latency
+ * samples, which leaves the state as is. Returns 1 once the condition
+ * trips.
+ */
+int abort_condition_update(struct abort_condition *, double window_start,
+                           double now, double value);
+
+void abort_conditions_free(struct abort_conditions *);
+
+#endif /* TCPKALI_ABORT_H */
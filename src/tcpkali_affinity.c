@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <assert.h>
+
+#include <config.h>
+
+#ifdef HAVE_SCHED_H
+#include <sched.h>
+#endif
+
+#include "tcpkali_affinity.h"
+
+int
+cpu_list_parse(const char *str, int *cpus, int max) {
+    int n = 0;
+
+    for(;;) {
+        char *end;
+        long first = strtol(str, &end, 10);
+        if(end == str || first < 0) return -1;
+        long last = first;
+        if(*end == '-') {
+            str = end + 1;
+            last = strtol(str, &end, 10);
+            if(end == str || last < first) return -1;
+        }
+        for(long cpu = first; cpu <= last; cpu++) {
+            if(n == max) return -1;
+            cpus[n++] = cpu;
+        }
+        switch(*end) {
+        case ',':
+            str = end + 1;
+            continue;
+        case '\n': /* As read from sysfs */
+        case '\0':
+            return n;
+        default:
+            return -1;
+        }
+    }
+}
+
+/*
+ * The NUMA node of the first network card which has one, or -1.
+ */
+static int
+network_numa_node() {
+    DIR *dir = opendir("/sys/class/net");
+    if(!dir) return -1;
+
+    int node = -1;
+    struct dirent *de;
+    while(node < 0 && (de = readdir(dir))) {
+        if(de->d_name[0] == '.') continue;
+        char path[512];
+        snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node",
+                 de->d_name);
+        FILE *f = fopen(path, "r");
+        if(!f) continue; /* Virtual interfaces have no device */
+        if(fscanf(f, "%d", &node) != 1) node = -1;
+        fclose(f);
+    }
+    closedir(dir);
+    return node;
+}
+
+static int
+numa_node_cpus(int node, int *cpus, int max) {
+    char path[128];
+    char buf[4096];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+             node);
+    FILE *f = fopen(path, "r");
+    if(!f) return -1;
+    int n = fgets(buf, sizeof(buf), f) ? cpu_list_parse(buf, cpus, max) : -1;
+    fclose(f);
+    return n;
+}
+
+int
+cpu_list_auto(int *cpus, int max) {
+#ifdef HAVE_SCHED_GETAFFINITY
+    cpu_set_t allowed;
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return -1;
+
+    /* The CPUs close to the network cards go first. */
+    int n = 0;
+    int node = network_numa_node();
+    if(node >= 0) {
+        int local[CPU_SETSIZE];
+        int n_local = numa_node_cpus(node, local, CPU_SETSIZE);
+        for(int i = 0; i < n_local && n < max; i++) {
+            if(local[i] < CPU_SETSIZE && CPU_ISSET(local[i], &allowed)) {
+                cpus[n++] = local[i];
+                CPU_CLR(local[i], &allowed);
+            }
+        }
+    }
+    for(int cpu = 0; cpu < CPU_SETSIZE && n < max; cpu++) {
+        if(CPU_ISSET(cpu, &allowed)) cpus[n++] = cpu;
+    }
+    return n ? n : -1;
+#else
+    (void)cpus;
+    (void)max;
+    return -1;
+#endif
+}
+
+int
+cpu_pin_thread(int cpu) {
+#ifdef HAVE_SCHED_GETAFFINITY
+    cpu_set_t mine;
+    if(cpu < 0 || cpu >= CPU_SETSIZE) return -1;
+    CPU_ZERO(&mine);
+    CPU_SET(cpu, &mine);
+    /* Affects the calling thread only. */
+    return sched_setaffinity(0, sizeof(mine), &mine);
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+#ifdef TCPKALI_AFFINITY_UNIT_TEST
+
+int
+main() {
+    int cpus[8];
+
+    assert(cpu_list_parse("3", cpus, 8) == 1 && cpus[0] == 3);
+    assert(cpu_list_parse("0-3,8,10-11\n", cpus, 8) == 7);
+    assert(cpus[0] == 0 && cpus[3] == 3 && cpus[4] == 8 && cpus[6] == 11);
+    assert(cpu_list_parse("0-8", cpus, 8) == -1);
+    assert(cpu_list_parse("", cpus, 8) == -1);
+    assert(cpu_list_parse("1,", cpus, 8) == -1);
+    assert(cpu_list_parse("3-1", cpus, 8) == -1);
+    assert(cpu_list_parse("-1", cpus, 8) == -1);
+    assert(cpu_list_parse("1;2", cpus, 8) == -1);
+
+    int n = cpu_list_auto(cpus, 8);
+#ifdef HAVE_SCHED_GETAFFINITY
+    assert(n >= 1 && n <= 8);
+    for(int i = 0; i < n; i++) {
+        for(int j = 0; j < i; j++) assert(cpus[i] != cpus[j]);
+    }
+#else
+    assert(n == -1);
+#endif
+
+    return 0;
+}
+
+#endif /* TCPKALI_AFFINITY_UNIT_TEST */
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_AFFINITY_H
+#define TCPKALI_AFFINITY_H
+
+/*
+ * The CPUs to pin the workers to, see --cpu-affinity.
+ */
+
+#define CPU_AFFINITY_MAX 1024 /* CPUs in a list */
+
+/*
+ * Parse the list of CPUs such as "0-3,8,10-11" into the (cpus) array
+ * of up to (max) entries. The same syntax is used by the kernel
+ * in /sys/devices/system/node/nodeN/cpulist.
+ * Returns the number of CPUs parsed, or -1 if the list is malformed.
+ */
+int cpu_list_parse(const char *str, int *cpus, int max);
+
+/*
+ * Order the CPUs we're allowed to run on so that the ones on the NUMA
+ * node of the network cards go first. Returns the number of CPUs,
+ * or -1 if the CPUs we're allowed to run on can't be determined.
+ */
+int cpu_list_auto(int *cpus, int max);
+
+/*
+ * Pin the calling thread to the CPU. Returns 0 on success.
+ */
+int cpu_pin_thread(int cpu);
+
+#endif /* TCPKALI_AFFINITY_H */
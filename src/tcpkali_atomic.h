@@ -31,6 +31,14 @@
 
 #define PRIan PRIu32 /* printf formatting argument for narrow type */
 
+/*
+ * Counters updated by one thread and polled by another are kept
+ * in their own cache lines, away from the fields either thread writes
+ * for its own purposes (false sharing).
+ */
+#define CACHE_LINE_SIZE 64
+#define CACHE_LINE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+
 /*
  * We introduce two atomic integer types, narrow (32-bit) and wide, which is
  * hopefully 64-bit, if the system permits. We also introduce non-atomic
@@ -72,11 +80,33 @@ atomic_decrement(atomic_narrow_t *i) {
     __sync_add_and_fetch(&i->_atomic_val, -1);
 }
 
+/*
+ * The counter written by one thread only, and read by the others:
+ * no locked instruction, the readers still see the whole values.
+ */
+static inline void UNUSED
+atomic_owner_increment(atomic_narrow_t *i) {
+    __atomic_store_n(&i->_atomic_val,
+                     __atomic_load_n(&i->_atomic_val, __ATOMIC_RELAXED) + 1,
+                     __ATOMIC_RELAXED);
+}
+
 static inline non_atomic_narrow_t UNUSED
 atomic_inc_and_get(atomic_narrow_t *i) {
     return __sync_add_and_fetch(&i->_atomic_val, 1);
 }
 
+static inline non_atomic_narrow_t UNUSED
+atomic_add_and_get(atomic_narrow_t *i, non_atomic_narrow_t v) {
+    return __sync_add_and_fetch(&i->_atomic_val, v);
+}
+
+static inline non_atomic_narrow_t UNUSED
+atomic_exchange(atomic_narrow_t *i, non_atomic_narrow_t v) {
+    __sync_synchronize();
+    return __sync_lock_test_and_set(&i->_atomic_val, v);
+}
+
 static inline non_atomic_narrow_t UNUSED
 atomic_get(const atomic_narrow_t *i) {
     return __sync_add_and_fetch(&((atomic_narrow_t *)i)->_atomic_val, 0);
@@ -87,6 +117,12 @@ atomic_wide_get(const atomic_wide_t *i) {
     return __sync_add_and_fetch(&((atomic_wide_t *)i)->_atomic_val, 0);
 }
 
+static inline int UNUSED
+atomic_wide_cas(atomic_wide_t *i, non_atomic_wide_t expected,
+                non_atomic_wide_t v) {
+    return __sync_bool_compare_and_swap(&i->_atomic_val, expected, v);
+}
+
 #else /* No builtin atomics, emulate */
 
 #if SIZEOF_SIZE_T == 4
@@ -123,6 +159,16 @@ atomic_wide_get(atomic_wide_t *i) {
     return i->_atomic_val;
 }
 
+static inline int UNUSED
+atomic_wide_cas(atomic_wide_t *i, non_atomic_wide_t expected,
+                non_atomic_wide_t v) {
+    unsigned char swapped;
+    asm volatile("lock cmpxchg %3, %0; sete %1"
+                 : "+m"(i->_atomic_val), "=q"(swapped), "+a"(expected)
+                 : "r"(v));
+    return swapped;
+}
+
 static inline void UNUSED
 atomic_increment(atomic_narrow_t *i) {
     asm volatile("lock incl %0" : "+m"(i->_atomic_val));
@@ -133,6 +179,11 @@ atomic_decrement(atomic_narrow_t *i) {
     asm volatile("lock decl %0" : "+m"(i->_atomic_val));
 }
 
+static inline void UNUSED
+atomic_owner_increment(atomic_narrow_t *i) {
+    asm volatile("incl %0" : "+m"(i->_atomic_val));
+}
+
 static inline non_atomic_narrow_t UNUSED
 atomic_inc_and_get(atomic_narrow_t *i) {
     non_atomic_narrow_t prev = 1;
@@ -140,6 +191,19 @@ atomic_inc_and_get(atomic_narrow_t *i) {
     return 1 + prev;
 }
 
+static inline non_atomic_narrow_t UNUSED
+atomic_add_and_get(atomic_narrow_t *i, non_atomic_narrow_t v) {
+    non_atomic_narrow_t prev = v;
+    asm volatile("lock xaddl %1, %0" : "+m"(i->_atomic_val), "+r"(prev));
+    return v + prev;
+}
+
+static inline non_atomic_narrow_t UNUSED
+atomic_exchange(atomic_narrow_t *i, non_atomic_narrow_t v) {
+    asm volatile("xchgl %1, %0" : "+m"(i->_atomic_val), "+r"(v));
+    return v;
+}
+
 #endif /* Builtin atomics */
 
 #endif /* TCPKALI_ATOMIC_H */
@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+#include "tcpkali_balance.h"
+
+struct balance_alias {
+    size_t n;
+    struct alias_column {
+        uint64_t threshold; /* Keep the column if coin < threshold, of 2^32 */
+        size_t alias;       /* Otherwise go to the alias */
+    } columns[];
+};
+
+/*
+ * Vose's construction of the alias table.
+ */
+struct balance_alias *
+balance_alias_new(const double *weights, size_t n) {
+    assert(n > 0);
+
+    double sum = 0.0;
+    for(size_t i = 0; i < n; i++) {
+        assert(weights[i] >= 0.0);
+        sum += weights[i];
+    }
+    assert(sum > 0.0);
+
+    struct balance_alias *a =
+        malloc(sizeof(*a) + n * sizeof(a->columns[0]));
+    double *prob = malloc(n * sizeof(*prob));
+    size_t *small = malloc(n * sizeof(*small));
+    size_t *large = malloc(n * sizeof(*large));
+    assert(a && prob && small && large);
+    size_t n_small = 0, n_large = 0;
+
+    a->n = n;
+    for(size_t i = 0; i < n; i++) {
+        prob[i] = weights[i] * n / sum;
+        if(prob[i] < 1.0)
+            small[n_small++] = i;
+        else
+            large[n_large++] = i;
+    }
+
+    while(n_small && n_large) {
+        size_t s = small[--n_small];
+        size_t l = large[n_large - 1];
+        a->columns[s].threshold = (uint64_t)(prob[s] * 4294967296.0);
+        a->columns[s].alias = l;
+        prob[l] -= 1.0 - prob[s];
+        if(prob[l] < 1.0) {
+            n_large--;
+            small[n_small++] = l;
+        }
+    }
+    /* The rest are full columns, up to the rounding errors. */
+    while(n_large) {
+        size_t l = large[--n_large];
+        a->columns[l].threshold = (uint64_t)1 << 32;
+        a->columns[l].alias = l;
+    }
+    while(n_small) {
+        size_t s = small[--n_small];
+        a->columns[s].threshold = (uint64_t)1 << 32;
+        a->columns[s].alias = s;
+    }
+
+    free(prob);
+    free(small);
+    free(large);
+    return a;
+}
+
+void
+balance_alias_free(struct balance_alias *a) {
+    free(a);
+}
+
+size_t
+balance_alias_pick(const struct balance_alias *a, uint32_t column_rand,
+                   uint32_t coin_rand) {
+    size_t column = ((uint64_t)column_rand * a->n) >> 32;
+    if(coin_rand < a->columns[column].threshold)
+        return column;
+    else
+        return a->columns[column].alias;
+}
+
+struct balance_ring {
+    size_t n_points;
+    struct ring_point {
+        uint32_t hash;
+        uint32_t target;
+    } points[];
+};
+
+uint32_t
+balance_hash(const void *data, size_t size) {
+    const unsigned char *p = data;
+    uint32_t h = 2166136261u;
+    for(size_t i = 0; i < size; i++) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+/*
+ * Spread the sequential keys (such as connection.uid) over the ring.
+ */
+static uint32_t
+mix32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static int
+compare_ring_points(const void *ap, const void *bp) {
+    const struct ring_point *a = ap;
+    const struct ring_point *b = bp;
+    if(a->hash != b->hash) return a->hash < b->hash ? -1 : 1;
+    return (a->target > b->target) - (a->target < b->target);
+}
+
+static size_t
+ring_replicas(const double *weights, size_t n, double sum, size_t target) {
+    if(!weights) return BALANCE_RING_REPLICAS;
+    if(weights[target] == 0.0) return 0;
+    size_t replicas = lround(BALANCE_RING_REPLICAS * weights[target] * n / sum);
+    return replicas ? replicas : 1;
+}
+
+struct balance_ring *
+balance_ring_new(const uint32_t *target_hashes, const double *weights,
+                 size_t n) {
+    assert(n > 0 && n <= UINT32_MAX);
+
+    double sum = n;
+    if(weights) {
+        sum = 0.0;
+        for(size_t i = 0; i < n; i++) {
+            assert(weights[i] >= 0.0);
+            sum += weights[i];
+        }
+        assert(sum > 0.0);
+    }
+
+    size_t n_points = 0;
+    for(size_t i = 0; i < n; i++)
+        n_points += ring_replicas(weights, n, sum, i);
+
+    struct balance_ring *r =
+        malloc(sizeof(*r) + n_points * sizeof(r->points[0]));
+    assert(r);
+    r->n_points = 0;
+    for(size_t i = 0; i < n; i++) {
+        size_t replicas = ring_replicas(weights, n, sum, i);
+        for(uint32_t rep = 0; rep < replicas; rep++) {
+            uint32_t seed[2] = {target_hashes[i], rep};
+            r->points[r->n_points].hash = mix32(balance_hash(seed, sizeof(seed)));
+            r->points[r->n_points].target = i;
+            r->n_points++;
+        }
+    }
+    assert(r->n_points == n_points);
+
+    qsort(r->points, r->n_points, sizeof(r->points[0]), compare_ring_points);
+    return r;
+}
+
+void
+balance_ring_free(struct balance_ring *r) {
+    free(r);
+}
+
+size_t
+balance_ring_pick(const struct balance_ring *r, uint32_t key,
+                  int (*usable)(void *opaque, size_t target), void *opaque) {
+    uint32_t h = mix32(key);
+
+    /* The first point at or after the key's hash. */
+    size_t lo = 0, hi = r->n_points;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(r->points[mid].hash < h)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for(size_t step = 0; step < r->n_points; step++) {
+        size_t target = r->points[(lo + step) % r->n_points].target;
+        if(!usable || usable(opaque, target)) return target;
+    }
+
+    return (size_t)-1;
+}
+
+/*
+ * The number of items the target takes up to the (level): its k-th item
+ * brings it to the level (load + k) / capacity.
+ */
+static size_t
+fill_count(double load, double capacity, double level) {
+    double k = floor(level * capacity - load);
+    return k > 0 ? (size_t)k : 0;
+}
+
+void
+balance_fill(const double *load, const double *capacity, size_t n,
+             size_t n_req, size_t *added) {
+    assert(n > 0);
+
+    /*
+     * Find the highest level the targets could be filled up to
+     * without exceeding n_req items in total.
+     */
+    double lo = 0.0;
+    double hi = 0.0;
+    for(size_t i = 0; i < n; i++) {
+        assert(capacity[i] > 0.0);
+        double level = (load[i] + n_req) / capacity[i];
+        if(hi < level) hi = level;
+    }
+    for(int iteration = 0; iteration < 64; iteration++) {
+        double mid = (lo + hi) / 2;
+        size_t count = 0;
+        for(size_t i = 0; i < n; i++)
+            count += fill_count(load[i], capacity[i], mid);
+        if(count <= n_req)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    size_t left = n_req;
+    for(size_t i = 0; i < n; i++) {
+        added[i] = fill_count(load[i], capacity[i], lo);
+        left -= added[i];
+    }
+
+    /* Give the few remaining items one by one. */
+    while(left--) {
+        size_t best = 0;
+        double best_level = 0.0;
+        for(size_t i = 0; i < n; i++) {
+            double level = (load[i] + added[i] + 1) / capacity[i];
+            if(i == 0 || level < best_level) {
+                best = i;
+                best_level = level;
+            }
+        }
+        added[best]++;
+    }
+}
+
+#ifdef TCPKALI_BALANCE_UNIT_TEST
+
+#include <stdio.h>
+
+static uint32_t
+test_rand(uint64_t *state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state >> 32;
+}
+
+static int
+skip_target(void *opaque, size_t target) {
+    return target != *(size_t *)opaque;
+}
+
+int
+main() {
+    enum { N_TARGETS = 5, N_PICKS = 1000000, N_KEYS = 100000 };
+    double weights[N_TARGETS] = {1, 2, 0, 3, 4};
+    size_t counts[N_TARGETS] = {0};
+    uint64_t state = 1;
+
+    /* The alias table follows the weights. */
+    struct balance_alias *a = balance_alias_new(weights, N_TARGETS);
+    for(size_t i = 0; i < N_PICKS; i++) {
+        size_t t = balance_alias_pick(a, test_rand(&state), test_rand(&state));
+        assert(t < N_TARGETS);
+        counts[t]++;
+    }
+    for(size_t i = 0; i < N_TARGETS; i++) {
+        double expected = N_PICKS * weights[i] / 10;
+        assert(fabs(counts[i] - expected) < 0.01 * N_PICKS);
+    }
+    assert(counts[2] == 0);
+    balance_alias_free(a);
+
+    /* Single target. */
+    a = balance_alias_new((double[]){0.5}, 1);
+    assert(balance_alias_pick(a, ~0u, ~0u) == 0);
+    assert(balance_alias_pick(a, 0, 0) == 0);
+    balance_alias_free(a);
+
+    uint32_t hashes[N_TARGETS];
+    for(size_t i = 0; i < N_TARGETS; i++) {
+        char name[16];
+        int len = snprintf(name, sizeof(name), "target%zu", i);
+        hashes[i] = balance_hash(name, len);
+    }
+
+    /* The ring spreads the keys roughly evenly. */
+    struct balance_ring *r = balance_ring_new(hashes, NULL, N_TARGETS);
+    size_t mapping[N_KEYS];
+    for(size_t i = 0; i < N_TARGETS; i++) counts[i] = 0;
+    for(uint32_t key = 0; key < N_KEYS; key++) {
+        mapping[key] = balance_ring_pick(r, key, NULL, NULL);
+        assert(mapping[key] < N_TARGETS);
+        assert(balance_ring_pick(r, key, NULL, NULL) == mapping[key]);
+        counts[mapping[key]]++;
+    }
+    for(size_t i = 0; i < N_TARGETS; i++) {
+        assert(counts[i] > 0.15 * N_KEYS && counts[i] < 0.25 * N_KEYS);
+    }
+
+    /* Skipping a target only moves its own keys. */
+    size_t skipped = 3;
+    for(uint32_t key = 0; key < N_KEYS; key++) {
+        size_t t = balance_ring_pick(r, key, skip_target, &skipped);
+        if(mapping[key] == skipped)
+            assert(t != skipped && t < N_TARGETS);
+        else
+            assert(t == mapping[key]);
+    }
+    balance_ring_free(r);
+
+    /* The weighted ring. A zero weight target gets nothing. */
+    r = balance_ring_new(hashes, weights, N_TARGETS);
+    for(size_t i = 0; i < N_TARGETS; i++) counts[i] = 0;
+    for(uint32_t key = 0; key < N_KEYS; key++)
+        counts[balance_ring_pick(r, key, NULL, NULL)]++;
+    assert(counts[2] == 0);
+    assert(counts[4] > counts[0]);
+    balance_ring_free(r);
+
+    /* Nothing is usable. */
+    r = balance_ring_new(hashes, NULL, 1);
+    skipped = 0;
+    assert(balance_ring_pick(r, 42, skip_target, &skipped) == (size_t)-1);
+    balance_ring_free(r);
+
+    /* The fill evens out the loads, then the loads per capacity. */
+    size_t added[3];
+    balance_fill((double[]){10, 0, 5}, (double[]){1, 1, 1}, 3, 9, added);
+    assert(added[0] == 0 && added[1] == 7 && added[2] == 2);
+    balance_fill((double[]){0, 0}, (double[]){1, 3}, 2, 8, added);
+    assert(added[0] == 2 && added[1] == 6);
+    balance_fill((double[]){0, 0, 0}, (double[]){1, 1, 1}, 3, 4, added);
+    assert(added[0] + added[1] + added[2] == 4);
+    assert(added[0] <= 2 && added[1] <= 2 && added[2] <= 2);
+    balance_fill((double[]){3, 1}, (double[]){0.5, 0.5}, 2, 0, added);
+    assert(added[0] == 0 && added[1] == 0);
+    balance_fill((double[]){0, 0}, (double[]){0.1, 1}, 2, 1000000, added);
+    assert(added[0] + added[1] == 1000000);
+    assert(added[0] > 90000 && added[0] < 92000);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_BALANCE_UNIT_TEST */
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_BALANCE_H
+#define TCPKALI_BALANCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * How the outgoing connections are spread over the destinations.
+ */
+enum remote_select {
+    RSEL_ROUND_ROBIN,   /* Default */
+    RSEL_WEIGHTED,      /* Randomly, in proportion to --remote-weights */
+    RSEL_HASH,          /* Consistent hashing of the connection.uid */
+    RSEL_LEAST_CONN,    /* Fewest connections open, of two random picks */
+    RSEL_LEAST_LATENCY, /* Lower recent latency and failures, likewise */
+};
+
+/*
+ * Walker's alias table: picks one of (n) targets with the probability
+ * proportional to its weight in O(1).
+ */
+struct balance_alias;
+
+/*
+ * The weights must be non-negative, and not all of them zero.
+ */
+struct balance_alias *balance_alias_new(const double *weights, size_t n);
+void balance_alias_free(struct balance_alias *);
+
+/*
+ * Pick the target using two independent random numbers.
+ */
+size_t balance_alias_pick(const struct balance_alias *, uint32_t column_rand,
+                          uint32_t coin_rand);
+
+/*
+ * A consistent hash ring. Each target is placed on the ring several times,
+ * in proportion to its weight (if weights are given), at positions derived
+ * from the target's own hash. Taking a target out of use moves only
+ * the keys which mapped to it; the rest stay where they were.
+ */
+struct balance_ring;
+
+#define BALANCE_RING_REPLICAS 160 /* Ring points per target of mean weight */
+
+/*
+ * The (target_hashes) identify the targets, see balance_hash().
+ * The (weights) may be NULL for the equal weights.
+ */
+struct balance_ring *balance_ring_new(const uint32_t *target_hashes,
+                                      const double *weights, size_t n);
+void balance_ring_free(struct balance_ring *);
+
+/*
+ * Find the target for the (key) in O(log n). The targets for which
+ * (usable) returns zero are skipped, moving on along the ring.
+ * Returns (size_t)-1 if none of the targets are usable.
+ */
+size_t balance_ring_pick(const struct balance_ring *, uint32_t key,
+                         int (*usable)(void *opaque, size_t target),
+                         void *opaque);
+
+/*
+ * Split (n_req) new items between the (n) targets, filling up the least
+ * loaded ones first, so that the targets' (load + added) / capacity
+ * end up as even as possible. The capacities must be positive.
+ * The (added) counts sum up to (n_req).
+ */
+void balance_fill(const double *load, const double *capacity, size_t n,
+                  size_t n_req, size_t *added);
+
+/*
+ * FNV-1a hash of the data, to derive the target_hashes.
+ */
+uint32_t balance_hash(const void *data, size_t size);
+
+#endif /* TCPKALI_BALANCE_H */
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_BUDGET_H
+#define TCPKALI_BUDGET_H
+
+#include "tcpkali_atomic.h"
+
+/*
+ * The upstream rate budget shared by all workers, see --rate-scope.
+ *
+ * The budget is kept as the time at which the tokens handed out so far
+ * would have been used up at the aggregate rate (the theoretical arrival
+ * time of the Generic Cell Rate Algorithm), in nanoseconds. The workers
+ * take the tokens in batches into their local caches, so the shared
+ * state is touched about once per batch, without locking.
+ */
+struct rate_budget {
+    atomic_wide_t tat_ns;
+};
+
+/*
+ * The unused tokens lapse after this many seconds, to avoid bursts
+ * after the load has been unable to keep up.
+ */
+#define RATE_BUDGET_BURST_SECONDS 0.01
+
+/*
+ * Take up to (want) tokens out of the budget replenished at the
+ * (events_per_second) rate. Returns the number of tokens taken.
+ */
+static inline double
+rate_budget_take(struct rate_budget *b, double events_per_second, double now,
+                 double want) {
+    uint64_t now_ns = now * 1e9;
+    uint64_t floor_ns = now_ns - RATE_BUDGET_BURST_SECONDS * 1e9;
+
+    for(;;) {
+        uint64_t tat = atomic_wide_get(&b->tat_ns);
+        uint64_t start = tat < floor_ns ? floor_ns : tat;
+        if(start >= now_ns) return 0.0;
+
+        double available = (now_ns - start) * events_per_second / 1e9;
+        double take = available < want ? available : want;
+        uint64_t new_tat = start + (uint64_t)(take / events_per_second * 1e9);
+        if(new_tat == tat) return 0.0;
+        if(atomic_wide_cas(&b->tat_ns, tat, new_tat)) return take;
+    }
+}
+
+/*
+ * Seconds until the budget has (need) more tokens.
+ */
+static inline double
+rate_budget_when_allowed(struct rate_budget *b, double events_per_second,
+                         double now, double need) {
+    double tat = atomic_wide_get(&b->tat_ns) / 1e9;
+    double delay = tat + need / events_per_second - now;
+    return delay > 0.0 ? delay : 0.0;
+}
+
+#endif /* TCPKALI_BUDGET_H */
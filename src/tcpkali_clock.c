@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "tcpkali_clock.h"
+
+/*
+ * TSC to nanoseconds conversion, set up once by tk_clock_global_init().
+ * The TSC readings are anchored to CLOCK_MONOTONIC_RAW, so the stamps
+ * are comparable between processes on the same host.
+ */
+static struct {
+    int use_tsc;
+    uint64_t tsc_base;
+    uint64_t ns_base;
+    double ns_per_tick;
+} tsc_params;
+
+static uint64_t
+monotonic_raw_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+
+static int
+tsc_is_invariant() {
+    unsigned eax, ebx, ecx, edx;
+    if(!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+        return 0;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx >> 8) & 1;
+}
+
+static void
+tsc_calibrate() {
+    if(!tsc_is_invariant()) return;
+
+    uint64_t ns_start = monotonic_raw_ns();
+    uint64_t tsc_start = __rdtsc();
+    struct timespec delay = {0, 20000000}; /* 20ms */
+    nanosleep(&delay, NULL);
+    uint64_t ns_end = monotonic_raw_ns();
+    uint64_t tsc_end = __rdtsc();
+
+    if(tsc_end <= tsc_start || ns_end <= ns_start) return;
+
+    tsc_params.ns_per_tick =
+        (double)(ns_end - ns_start) / (double)(tsc_end - tsc_start);
+    tsc_params.tsc_base = tsc_end;
+    tsc_params.ns_base = ns_end;
+    tsc_params.use_tsc = 1;
+}
+
+static inline uint64_t
+monotonic_ns() {
+    if(tsc_params.use_tsc) {
+        return tsc_params.ns_base
+               + (uint64_t)((__rdtsc() - tsc_params.tsc_base)
+                            * tsc_params.ns_per_tick);
+    }
+    return monotonic_raw_ns();
+}
+#else
+static void
+tsc_calibrate() {}
+
+static inline uint64_t
+monotonic_ns() {
+    return monotonic_raw_ns();
+}
+#endif
+
+static inline uint64_t
+realtime_usec() {
+    struct timeval tp;
+    gettimeofday(&tp, NULL);
+    return (uint64_t)tp.tv_sec * 1000000 + tp.tv_usec;
+}
+
+uint64_t
+tk_clock_realtime_usec() {
+    return realtime_usec();
+}
+
+uint64_t
+tk_clock_source_ns(enum tk_clock_source source) {
+    if(source == TK_CLOCK_MONOTONIC) return monotonic_ns();
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int
+tk_clock_sleep_until_usec(uint64_t usec) {
+#ifdef HAVE_CLOCK_NANOSLEEP
+    struct timespec ts = {.tv_sec = usec / 1000000,
+                          .tv_nsec = (usec % 1000000) * 1000};
+    int err = clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &ts, NULL);
+    if(err) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+#else
+    /* Sleep off the bulk of the interval, then re-check the wall clock. */
+    for(;;) {
+        uint64_t now = realtime_usec();
+        if(now >= usec) return 0;
+        uint64_t left = usec - now;
+        struct timespec ts = {.tv_sec = left / 1000000,
+                              .tv_nsec = (left % 1000000) * 1000};
+        if(nanosleep(&ts, NULL) == -1) return -1;
+    }
+#endif
+}
+
+void
+tk_clock_global_init(enum tk_clock_source source) {
+    if(source == TK_CLOCK_MONOTONIC) tsc_calibrate();
+}
+
+void
+tk_clock_init(struct tk_clock *clock, enum tk_clock_source source) {
+    clock->source = source;
+    clock->loop_now = 0;
+    clock->cached = 0;
+}
+
+uint64_t
+tk_clock_stamp(struct tk_clock *clock, double loop_now) {
+    switch(clock->source) {
+    case TK_CLOCK_REALTIME:
+        break;
+    case TK_CLOCK_CACHED:
+        /* The loop time only moves once per event loop iteration. */
+        if(clock->loop_now != loop_now || clock->cached == 0) {
+            clock->loop_now = loop_now;
+            clock->cached = realtime_usec();
+        }
+        return clock->cached;
+    case TK_CLOCK_MONOTONIC:
+        return monotonic_ns();
+    }
+    return realtime_usec();
+}
+
+uint64_t
+tk_clock_stamp_before(struct tk_clock *clock, double loop_now, double ago) {
+    uint64_t now = tk_clock_stamp(clock, loop_now);
+    uint64_t delta = (clock->source == TK_CLOCK_MONOTONIC) ? ago * 1e9
+                                                           : ago * 1e6;
+    return delta < now ? now - delta : 0;
+}
+
+int64_t
+tk_clock_elapsed_ns(struct tk_clock *clock, double loop_now, uint64_t stamp) {
+    uint64_t now = tk_clock_stamp(clock, loop_now);
+    if(clock->source == TK_CLOCK_MONOTONIC)
+        return (int64_t)(now - stamp);
+    else
+        return 1000 * (int64_t)(now - stamp);
+}
+
+int
+tk_clock_source_from_string(const char *str, enum tk_clock_source *source) {
+    if(strcmp(str, "realtime") == 0) {
+        *source = TK_CLOCK_REALTIME;
+    } else if(strcmp(str, "cached") == 0) {
+        *source = TK_CLOCK_CACHED;
+    } else if(strcmp(str, "monotonic") == 0) {
+        *source = TK_CLOCK_MONOTONIC;
+    } else {
+        return -1;
+    }
+    return 0;
+}
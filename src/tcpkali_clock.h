@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_CLOCK_H
+#define TCPKALI_CLOCK_H
+
+#include <stdint.h>
+
+/*
+ * The time source for the message marker timestamps.
+ */
+enum tk_clock_source {
+    TK_CLOCK_REALTIME,  /* gettimeofday(2) every time (default) */
+    TK_CLOCK_CACHED,    /* Wall clock, read once per event loop iteration */
+    TK_CLOCK_MONOTONIC, /* Calibrated TSC or CLOCK_MONOTONIC_RAW, in ns */
+};
+
+/*
+ * Per-worker clock state.
+ */
+struct tk_clock {
+    enum tk_clock_source source;
+    double loop_now; /* Event loop time the cached value belongs to */
+    uint64_t cached; /* Cached stamp for TK_CLOCK_CACHED */
+};
+
+/*
+ * Prepare the clock sources, calibrating the TSC if the monotonic clock
+ * is going to be used. To be called once, before the workers start.
+ */
+void tk_clock_global_init(enum tk_clock_source);
+
+/*
+ * Initialize the per-worker clock.
+ */
+void tk_clock_init(struct tk_clock *, enum tk_clock_source);
+
+/*
+ * Obtain the timestamp to be put into an outgoing message marker.
+ * The wall clocks produce microseconds since the Epoch (compatible with
+ * the other tcpkali instances), the monotonic clock produces nanoseconds.
+ * The (loop_now) argument is the current event loop time, tk_now().
+ */
+uint64_t tk_clock_stamp(struct tk_clock *, double loop_now);
+
+/*
+ * Obtain the timestamp (ago) seconds before tk_clock_stamp().
+ */
+uint64_t tk_clock_stamp_before(struct tk_clock *, double loop_now,
+                               double ago);
+
+/*
+ * Nanoseconds elapsed since the given stamp.
+ */
+int64_t tk_clock_elapsed_ns(struct tk_clock *, double loop_now,
+                            uint64_t stamp);
+
+/*
+ * Microseconds since the Epoch.
+ */
+uint64_t tk_clock_realtime_usec(void);
+
+/*
+ * The current time of the clock source, in nanoseconds on the scale
+ * of its stamps: since the Epoch for the wall clocks, or since boot for
+ * the monotonic one. Used to compare the clocks of the two hosts.
+ */
+uint64_t tk_clock_source_ns(enum tk_clock_source);
+
+/*
+ * Sleep until the wall clock reaches the given time, in microseconds
+ * since the Epoch. Returns -1 and sets errno (EINTR) if interrupted.
+ */
+int tk_clock_sleep_until_usec(uint64_t usec);
+
+/*
+ * Parse the --latency-clock value.
+ * Returns -1 if the name is not recognized.
+ */
+int tk_clock_source_from_string(const char *, enum tk_clock_source *);
+
+#endif /* TCPKALI_CLOCK_H */
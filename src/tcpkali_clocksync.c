@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <endian.h>
+#include <assert.h>
+
+#include "tcpkali_clocksync.h"
+
+/* The probes sent by clock_sync_query(). */
+#define CLOCK_SYNC_PROBES 8
+/* How long to wait for each answer, ms. */
+#define CLOCK_SYNC_WAIT_MS 200
+/* How often the responder looks at its termination flag, ms. */
+#define CLOCK_SYNC_POLL_MS 100
+
+/*
+ * The probe and its answer, in the little-endian byte order.
+ */
+struct clock_sync_packet {
+    char magic[4]; /* "TKcs" */
+    uint32_t source; /* enum tk_clock_source of the answering side */
+    uint64_t sent_ns; /* The prober's clock, echoed back */
+    uint64_t peer_ns; /* The answering side's clock */
+};
+static const char clock_sync_magic[4] = {'T', 'K', 'c', 's'};
+
+struct clock_sync {
+    struct pollfd *fds;
+    int nfds;
+    enum tk_clock_source source;
+    int terminate;
+    pthread_t thread;
+};
+
+/*
+ * The wall clocks are told apart from the monotonic one,
+ * the cached one reads the same wall clock.
+ */
+static uint32_t
+source_kind(enum tk_clock_source source) {
+    return source == TK_CLOCK_MONOTONIC ? 1 : 0;
+}
+
+static void
+clock_sync_answer(struct clock_sync *cs, int fd) {
+    struct clock_sync_packet pkt;
+    struct sockaddr_storage ss;
+    socklen_t sslen = sizeof(ss);
+
+    ssize_t rd = recvfrom(fd, &pkt, sizeof(pkt), MSG_DONTWAIT,
+                          (struct sockaddr *)&ss, &sslen);
+    if(rd != sizeof(pkt)
+       || memcmp(pkt.magic, clock_sync_magic, sizeof(pkt.magic)) != 0)
+        return;
+    pkt.source = htole32(source_kind(cs->source));
+    pkt.peer_ns = htole64(tk_clock_source_ns(cs->source));
+    (void)sendto(fd, &pkt, sizeof(pkt), MSG_DONTWAIT,
+                 (struct sockaddr *)&ss, sslen);
+}
+
+static void *
+clock_sync_thread(void *arg) {
+    struct clock_sync *cs = arg;
+
+    while(!__atomic_load_n(&cs->terminate, __ATOMIC_ACQUIRE)) {
+        int n = poll(cs->fds, cs->nfds, CLOCK_SYNC_POLL_MS);
+        if(n <= 0) continue;
+        for(int i = 0; i < cs->nfds; i++) {
+            if(cs->fds[i].revents & POLLIN)
+                clock_sync_answer(cs, cs->fds[i].fd);
+        }
+    }
+
+    return NULL;
+}
+
+struct clock_sync *
+clock_sync_listen(const struct addresses *addresses,
+                  enum tk_clock_source source) {
+    struct clock_sync *cs = calloc(1, sizeof(*cs));
+    assert(cs);
+    cs->source = source;
+    cs->fds = calloc(addresses->n_addrs ? addresses->n_addrs : 1,
+                     sizeof(cs->fds[0]));
+    assert(cs->fds);
+
+    int saved_errno = EADDRNOTAVAIL;
+    for(size_t i = 0; i < addresses->n_addrs; i++) {
+        struct sockaddr_storage *ss = &addresses->addrs[i];
+        if(ss->ss_family != AF_INET && ss->ss_family != AF_INET6) continue;
+        int fd = socket(ss->ss_family, SOCK_DGRAM, 0);
+        if(fd == -1) {
+            saved_errno = errno;
+            continue;
+        }
+        int on = 1;
+        (void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        /* The [::] and 0.0.0.0 are listened to separately. */
+        if(ss->ss_family == AF_INET6)
+            (void)setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on));
+        if(bind(fd, (struct sockaddr *)ss, sockaddr_len(ss)) == -1) {
+            saved_errno = errno;
+            close(fd);
+            continue;
+        }
+        cs->fds[cs->nfds].fd = fd;
+        cs->fds[cs->nfds].events = POLLIN;
+        cs->nfds++;
+    }
+
+    if(cs->nfds == 0) {
+        free(cs->fds);
+        free(cs);
+        errno = saved_errno;
+        return NULL;
+    }
+
+    int rc = pthread_create(&cs->thread, NULL, clock_sync_thread, cs);
+    assert(rc == 0);
+
+    return cs;
+}
+
+void
+clock_sync_free(struct clock_sync *cs) {
+    if(!cs) return;
+
+    __atomic_store_n(&cs->terminate, 1, __ATOMIC_RELEASE);
+    pthread_join(cs->thread, NULL);
+
+    for(int i = 0; i < cs->nfds; i++) close(cs->fds[i].fd);
+    free(cs->fds);
+    free(cs);
+}
+
+int
+clock_sync_query(const struct sockaddr *sa, socklen_t salen,
+                 enum tk_clock_source source, int64_t *offset_ns,
+                 int64_t *rtt_ns) {
+    int fd = socket(sa->sa_family, SOCK_DGRAM, 0);
+    if(fd == -1) return -1;
+    if(connect(fd, sa, salen) == -1) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    int answers = 0;
+    int other_clock = 0;
+    int64_t best_rtt = INT64_MAX;
+    int64_t best_offset = 0;
+
+    for(int probe = 0; probe < CLOCK_SYNC_PROBES; probe++) {
+        struct clock_sync_packet pkt;
+        memset(&pkt, 0, sizeof(pkt));
+        memcpy(pkt.magic, clock_sync_magic, sizeof(pkt.magic));
+        uint64_t sent = tk_clock_source_ns(source);
+        pkt.sent_ns = htole64(sent);
+        if(send(fd, &pkt, sizeof(pkt), 0) != sizeof(pkt)) continue;
+
+        /* Skip the late answers to the earlier probes. */
+        for(;;) {
+            struct pollfd pfd = {.fd = fd, .events = POLLIN};
+            if(poll(&pfd, 1, CLOCK_SYNC_WAIT_MS) <= 0) break;
+            struct clock_sync_packet ans;
+            ssize_t rd = recv(fd, &ans, sizeof(ans), MSG_DONTWAIT);
+            uint64_t received = tk_clock_source_ns(source);
+            if(rd != sizeof(ans)
+               || memcmp(ans.magic, clock_sync_magic, sizeof(ans.magic)) != 0
+               || le64toh(ans.sent_ns) != sent)
+                continue;
+            if(le32toh(ans.source) != source_kind(source)) {
+                other_clock = 1;
+                break;
+            }
+            int64_t rtt = (int64_t)(received - sent);
+            if(rtt < best_rtt) {
+                best_rtt = rtt;
+                /* The peer read its clock half way through the round trip. */
+                best_offset = (int64_t)(le64toh(ans.peer_ns) - sent) - rtt / 2;
+            }
+            answers++;
+            break;
+        }
+        if(other_clock) break;
+    }
+
+    close(fd);
+
+    if(other_clock) {
+        errno = EPROTO;
+        return -1;
+    } else if(answers == 0) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
+    *offset_ns = best_offset;
+    *rtt_ns = best_rtt;
+    return 0;
+}
+
+#ifdef TCPKALI_CLOCKSYNC_UNIT_TEST
+
+int
+main() {
+    struct sockaddr_storage ss;
+    memset(&ss, 0, sizeof(ss));
+    struct sockaddr_in sin = {.sin_family = AF_INET,
+                              .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+    memcpy(&ss, &sin, sizeof(sin));
+    struct addresses addrs = {&ss, 1};
+
+    /* Nothing there to answer. */
+    int64_t offset, rtt;
+    sin.sin_port = htons(1); /* tcpmux, hardly listened to over UDP */
+    errno = 0;
+    assert(clock_sync_query((struct sockaddr *)&sin, sizeof(sin),
+                            TK_CLOCK_REALTIME, &offset, &rtt)
+           == -1);
+    assert(errno == ETIMEDOUT || errno == ECONNREFUSED);
+
+    /* Bind to some free port, then find it out. */
+    struct clock_sync *cs = clock_sync_listen(&addrs, TK_CLOCK_REALTIME);
+    assert(cs);
+    struct sockaddr_in bound;
+    socklen_t blen = sizeof(bound);
+    int rc = getsockname(cs->fds[0].fd, (struct sockaddr *)&bound, &blen);
+    assert(rc == 0);
+
+    /* The same host's clock is in sync with itself. */
+    rc = clock_sync_query((struct sockaddr *)&bound, blen, TK_CLOCK_REALTIME,
+                          &offset, &rtt);
+    assert(rc == 0);
+    assert(rtt >= 0 && rtt < 200000000);
+    assert(offset >= -rtt && offset <= rtt);
+
+    /* The cached clock is the same wall clock. */
+    rc = clock_sync_query((struct sockaddr *)&bound, blen, TK_CLOCK_CACHED,
+                          &offset, &rtt);
+    assert(rc == 0);
+
+    /* The monotonic clock is not comparable with the wall clock. */
+    errno = 0;
+    rc = clock_sync_query((struct sockaddr *)&bound, blen, TK_CLOCK_MONOTONIC,
+                          &offset, &rtt);
+    assert(rc == -1 && errno == EPROTO);
+
+    clock_sync_free(cs);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_CLOCKSYNC_UNIT_TEST */
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_CLOCKSYNC_H
+#define TCPKALI_CLOCKSYNC_H
+
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "tcpkali_clock.h"
+#include "tcpkali_iface.h"
+
+/*
+ * The clock offset calibration for the one-way marker latency, see
+ * --clock-sync. The -l side answers the UDP probes sent to its listen
+ * ports with its own --latency-clock reading. The connecting side sends
+ * a few probes before the test and takes the offset from the one with
+ * the shortest round trip, assuming the two halves of it are equal.
+ */
+
+struct clock_sync;
+
+/*
+ * Start answering the probes on the UDP ports of the listen addresses.
+ * Returns NULL and sets errno if none of the ports could be bound.
+ */
+struct clock_sync *clock_sync_listen(const struct addresses *,
+                                     enum tk_clock_source);
+
+/*
+ * Stop answering the probes.
+ */
+void clock_sync_free(struct clock_sync *);
+
+/*
+ * Probe the peer's clock. The (offset_ns) is how far the peer's clock
+ * runs ahead of ours, (rtt_ns) is the round trip the offset comes from.
+ * Returns -1 and sets errno if the peer did not answer (ETIMEDOUT)
+ * or uses a different --latency-clock (EPROTO).
+ */
+int clock_sync_query(const struct sockaddr *, socklen_t,
+                     enum tk_clock_source, int64_t *offset_ns,
+                     int64_t *rtt_ns);
+
+#endif /* TCPKALI_CLOCKSYNC_H */
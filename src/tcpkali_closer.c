@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <assert.h>
+
+#include "tcpkali_closer.h"
+#include "tcpkali_spsc.h"
+
+/* How often the thread looks into the rings while the closes go on, ns. */
+#define CLOSER_POLL_INTERVAL_NS 1000000
+/* How many of these looks find nothing before the thread goes to sleep. */
+#define CLOSER_QUIET_POLLS 10
+
+struct closer_ring {
+    struct spsc_ring ring; /* Of the file descriptors */
+    struct closer *closer;
+};
+
+struct closer {
+    struct closer_ring *rings;
+    int rings_count;
+    struct spsc_writer writer;
+};
+
+void
+closer_close(struct closer_ring *ring, int fd) {
+    if(!ring || spsc_ring_append(&ring->ring, &fd, sizeof(fd), NULL, 0) == -1) {
+        close(fd);
+        return;
+    }
+    spsc_writer_notify(&ring->closer->writer);
+}
+
+size_t
+closer_flush(struct closer_ring *ring) {
+    if(!ring) return 0;
+
+    size_t tail = ring->ring.tail;
+    size_t pending =
+        tail - __atomic_load_n(&ring->ring.head, __ATOMIC_ACQUIRE);
+
+    if(pending == 0) return 0;
+
+    spsc_writer_wake(&ring->closer->writer);
+    while(__atomic_load_n(&ring->ring.head, __ATOMIC_ACQUIRE) != tail) {
+        struct timespec ts = {0, CLOSER_POLL_INTERVAL_NS / 10};
+        nanosleep(&ts, NULL);
+    }
+
+    return pending / sizeof(int);
+}
+
+/*
+ * Close the file descriptors in the ring.
+ * Returns the number of them closed.
+ */
+static size_t
+closer_ring_drain(struct closer_ring *ring) {
+    size_t tail = spsc_ring_tail(&ring->ring);
+    size_t head = ring->ring.head;
+
+    for(size_t n = head; n != tail; n += sizeof(int)) {
+        int fd;
+        spsc_ring_copy_out(&ring->ring, n, &fd, sizeof(fd));
+        close(fd);
+    }
+
+    spsc_ring_consume(&ring->ring, tail);
+    return (tail - head) / sizeof(int);
+}
+
+static size_t
+closer_drain(void *arg, int terminate) {
+    struct closer *cl = arg;
+    size_t drained = 0;
+    (void)terminate;
+    for(int i = 0; i < cl->rings_count; i++)
+        drained += closer_ring_drain(&cl->rings[i]);
+    return drained;
+}
+
+struct closer *
+closer_new(int workers, size_t ring_fds) {
+    struct closer *cl = calloc(1, sizeof(*cl));
+    assert(cl);
+    cl->rings_count = workers;
+    cl->rings = aligned_alloc(64, workers * sizeof(cl->rings[0]));
+    assert(cl->rings);
+    memset(cl->rings, 0, workers * sizeof(cl->rings[0]));
+    if(ring_fds < 64) ring_fds = 64;
+    for(int i = 0; i < workers; i++) {
+        spsc_ring_init(&cl->rings[i].ring, ring_fds * sizeof(int));
+        cl->rings[i].closer = cl;
+    }
+
+    /* More closes are likely to follow while the wave goes on. */
+    spsc_writer_start(&cl->writer, closer_drain, cl, CLOSER_POLL_INTERVAL_NS,
+                      CLOSER_QUIET_POLLS);
+
+    return cl;
+}
+
+struct closer_ring *
+closer_ring(struct closer *cl, int worker) {
+    assert(worker >= 0 && worker < cl->rings_count);
+    return &cl->rings[worker];
+}
+
+void
+closer_free(struct closer *cl) {
+    if(!cl) return;
+
+    spsc_writer_stop(&cl->writer);
+
+    for(int i = 0; i < cl->rings_count; i++) spsc_ring_free(&cl->rings[i].ring);
+    free(cl->rings);
+    free(cl);
+}
+
+#ifdef TCPKALI_CLOSER_UNIT_TEST
+
+#include <fcntl.h>
+#include <errno.h>
+
+static int
+is_open(int fd) {
+    return fcntl(fd, F_GETFD) != -1 || errno != EBADF;
+}
+
+int
+main() {
+    struct closer *cl = closer_new(2, 10);
+    struct closer_ring *ring = closer_ring(cl, 1);
+    assert(ring->ring.size == 64 * sizeof(int));
+
+    /* More than the ring holds: the rest is closed right away. */
+    int fds[200];
+    for(int i = 0; i < 200; i += 2) {
+        int rc = pipe(&fds[i]);
+        assert(rc == 0);
+    }
+    for(int i = 0; i < 200; i++) closer_close(ring, fds[i]);
+    closer_flush(ring);
+    for(int i = 0; i < 200; i++) assert(!is_open(fds[i]));
+    assert(closer_flush(ring) == 0);
+
+    /* Woken up from its sleep once it is idle. */
+    struct timespec ts = {0, 50000000};
+    nanosleep(&ts, NULL);
+    int late[2];
+    int rc = pipe(late);
+    assert(rc == 0);
+    closer_close(ring, late[0]);
+    while(is_open(late[0])) {
+        struct timespec poll = {0, 1000000};
+        nanosleep(&poll, NULL);
+    }
+
+    /* Without a ring, the socket is closed right away. */
+    int now[2];
+    rc = pipe(now);
+    assert(rc == 0);
+    closer_close(NULL, now[0]);
+    assert(!is_open(now[0]));
+    assert(closer_flush(NULL) == 0);
+    close(now[1]);
+
+    /* The leftovers are closed when the thread stops. */
+    closer_close(closer_ring(cl, 0), late[1]);
+    closer_free(cl);
+    assert(!is_open(late[1]));
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_CLOSER_UNIT_TEST */
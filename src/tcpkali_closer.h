@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_CLOSER_H
+#define TCPKALI_CLOSER_H
+
+#include <stddef.h>
+
+/*
+ * The deferred close(2) of the connection sockets.
+ *
+ * Closing a socket with unsent data in its buffers, or with SO_LINGER,
+ * is where the kernel tears the connection down, which may take a while.
+ * Rather than stalling the worker on thousands of such closes in a row,
+ * each worker passes the file descriptors into its own ring, without
+ * locks or system calls, and a background thread closes them in batches.
+ * The worker closes the socket itself when its ring is full.
+ * The thread only pays off when it has a CPU of its own.
+ */
+
+struct closer;
+struct closer_ring;
+
+/*
+ * Start the closer thread, with a ring of at least (ring_fds) per worker.
+ */
+struct closer *closer_new(int workers, size_t ring_fds);
+
+/*
+ * The ring of the given worker. Only that worker may pass sockets to it.
+ */
+struct closer_ring *closer_ring(struct closer *, int worker);
+
+/*
+ * Pass the file descriptor over to be closed by the closer thread,
+ * or close it right away if the ring is full or NULL.
+ */
+void closer_close(struct closer_ring *, int fd);
+
+/*
+ * Wait until the closer thread has closed everything passed to the ring,
+ * such as to make room for the new sockets under the open files limit.
+ * Returns the number of file descriptors waited for, 0 for a NULL ring.
+ */
+size_t closer_flush(struct closer_ring *);
+
+/*
+ * Close what is left in the rings and stop the thread.
+ * The workers must not pass the sockets anymore.
+ */
+void closer_free(struct closer *);
+
+#endif /* TCPKALI_CLOSER_H */
@@ -41,18 +41,66 @@
 typedef enum {
     SLT_CONNECT = (1 << 0),
     SLT_FIRSTBYTE = (1 << 1),
-    SLT_MARKER = (1 << 2)
+    SLT_MARKER = (1 << 2),
+    SLT_HANDSHAKE = (1 << 3),
+    SLT_UPGRADE = (1 << 4)
 } statsd_report_latency_types;
 
 #define MESSAGE_MARKER_TOKEN "TCPKaliMsgTS-"
 
+/*
+ * Binary \{message.marker} (--message-marker-format binary): the magic,
+ * followed by the little-endian 64-bit timestamp, 32-bit connection uid
+ * and 32-bit per-connection sequence number.
+ */
+#define MESSAGE_MARKER_BINARY_MAGIC "\x8bTKM"
+struct message_marker_binary {
+    uint64_t timestamp;
+    uint32_t uid;
+    uint32_t sequence;
+} __attribute__((packed));
+#define MESSAGE_MARKER_BINARY_SIZE \
+    (sizeof(MESSAGE_MARKER_BINARY_MAGIC) - 1 + sizeof(struct message_marker_binary))
+
+/*
+ * The latency histograms count in the units of --latency-resolution,
+ * 10000 per second (1/10 ms) by default. Set once by the option parser,
+ * before the engine, the workers and the --processes children start.
+ */
+extern double latency_units_per_second;
+#define LATENCY_SIGNIFICANT_FIGURES 3
+
+static inline double
+latency_to_ms(double value) {
+    return value * 1000.0 / latency_units_per_second;
+}
+
+/*
+ * The decimal places showing one --latency-resolution unit in ms:
+ * 1 by default, 3 at 1us, 6 at 1ns.
+ */
+static inline int
+latency_ms_precision(void) {
+    int digits = 0;
+    for(double u = latency_units_per_second / 1000.0; u > 1.0001 && digits < 6;
+        u /= 10)
+        digits++;
+    return digits;
+}
+
 /*
  * Snapshot of the current latency.
  */
 struct latency_snapshot {
     struct hdr_histogram *connect_histogram;
     struct hdr_histogram *firstbyte_histogram;
+    struct hdr_histogram *handshake_histogram;
+    struct hdr_histogram *upgrade_histogram;
     struct hdr_histogram *marker_histogram;
+    struct hdr_histogram *marker_uncorrected_histogram;
+    /* The engine reuses the freed snapshots, see latency_snapshot_get(). */
+    struct latency_snapshot_pool *pool;
+    struct latency_snapshot *pool_next;
 };
 
 /*
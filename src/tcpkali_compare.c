@@ -0,0 +1,690 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <assert.h>
+
+#include "tcpkali_compare.h"
+
+/* Below this many windows in either run the change is not tested. */
+#define COMPARE_MIN_WINDOWS 5
+/* The p-value below which the change is deemed significant. */
+#define COMPARE_SIGNIFICANCE 0.05
+/* The shorter windows, such as the last one, tell little. */
+#define COMPARE_MIN_WINDOW_DURATION 0.5
+
+/*
+ * Just enough of a JSON parser to read the tcpkali reports back.
+ */
+struct json {
+    enum { JT_NULL, JT_BOOL, JT_NUMBER, JT_STRING, JT_ARRAY, JT_OBJECT } type;
+    double number;
+    char *string;
+    size_t count; /* Of the array items or the object members */
+    char **keys;  /* Of the object members */
+    struct json *items;
+};
+
+static void
+json_free(struct json *v) {
+    for(size_t i = 0; i < v->count; i++) {
+        if(v->keys) free(v->keys[i]);
+        json_free(&v->items[i]);
+    }
+    free(v->keys);
+    free(v->items);
+    free(v->string);
+    memset(v, 0, sizeof(*v));
+}
+
+static const char *
+skip_spaces(const char *p) {
+    while(isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+/*
+ * Parse the string after the opening quote. Non-ASCII escapes are
+ * replaced with '?', the reports don't use them.
+ */
+static char *
+json_parse_string(const char **pp) {
+    const char *p = *pp;
+    size_t len = 0;
+    char *str = malloc(strlen(p) + 1);
+    assert(str);
+    for(; *p != '"'; p++) {
+        if(*p == '\0') {
+            free(str);
+            return NULL;
+        } else if(*p != '\\') {
+            str[len++] = *p;
+            continue;
+        }
+        switch(*++p) {
+        case 'b': str[len++] = '\b'; break;
+        case 'f': str[len++] = '\f'; break;
+        case 'n': str[len++] = '\n'; break;
+        case 'r': str[len++] = '\r'; break;
+        case 't': str[len++] = '\t'; break;
+        case 'u': {
+            unsigned code = 0;
+            for(int i = 1; i <= 4; i++) {
+                if(!isxdigit((unsigned char)p[i])) {
+                    free(str);
+                    return NULL;
+                }
+                code = code * 16
+                       + (isdigit((unsigned char)p[i])
+                              ? p[i] - '0'
+                              : (tolower((unsigned char)p[i]) - 'a') + 10);
+            }
+            p += 4;
+            str[len++] = code < 0x80 ? code : '?';
+        } break;
+        case '\0':
+            free(str);
+            return NULL;
+        default:
+            str[len++] = *p;
+        }
+    }
+    str[len] = '\0';
+    *pp = p + 1;
+    return str;
+}
+
+static int
+json_parse_value(const char **pp, struct json *v, int depth) {
+    const char *p = skip_spaces(*pp);
+    memset(v, 0, sizeof(*v));
+    if(depth > 32) return -1;
+
+    switch(*p) {
+    case '{':
+    case '[': {
+        char close = *p == '{' ? '}' : ']';
+        v->type = *p == '{' ? JT_OBJECT : JT_ARRAY;
+        p = skip_spaces(p + 1);
+        if(*p == close) {
+            p++;
+            break;
+        }
+        for(;;) {
+            char *key = NULL;
+            if(v->type == JT_OBJECT) {
+                if(*p != '"' || !(p++, key = json_parse_string(&p)))
+                    return json_free(v), -1;
+                p = skip_spaces(p);
+                if(*p++ != ':') return free(key), json_free(v), -1;
+            }
+            struct json item;
+            if(json_parse_value(&p, &item, depth + 1) == -1)
+                return free(key), json_free(v), -1;
+            v->items = realloc(v->items, (v->count + 1) * sizeof(*v->items));
+            assert(v->items);
+            if(v->type == JT_OBJECT) {
+                v->keys = realloc(v->keys, (v->count + 1) * sizeof(*v->keys));
+                assert(v->keys);
+                v->keys[v->count] = key;
+            }
+            v->items[v->count++] = item;
+            p = skip_spaces(p);
+            if(*p == ',') {
+                p = skip_spaces(p + 1);
+            } else if(*p == close) {
+                p++;
+                break;
+            } else {
+                return json_free(v), -1;
+            }
+        }
+    } break;
+    case '"':
+        p++;
+        v->type = JT_STRING;
+        if(!(v->string = json_parse_string(&p))) return -1;
+        break;
+    case 't':
+    case 'f':
+    case 'n':
+        if(strncmp(p, "true", 4) == 0) {
+            v->type = JT_BOOL;
+            v->number = 1;
+            p += 4;
+        } else if(strncmp(p, "false", 5) == 0) {
+            v->type = JT_BOOL;
+            p += 5;
+        } else if(strncmp(p, "null", 4) == 0) {
+            v->type = JT_NULL;
+            v->number = NAN;
+            p += 4;
+        } else {
+            return -1;
+        }
+        break;
+    default: {
+        char *end;
+        if(*p != '-' && !isdigit((unsigned char)*p)) return -1;
+        v->type = JT_NUMBER;
+        v->number = strtod(p, &end);
+        p = end;
+    }
+    }
+
+    *pp = p;
+    return 0;
+}
+
+/*
+ * The object member, or NULL.
+ */
+static const struct json *
+json_member(const struct json *v, const char *key) {
+    if(!v || v->type != JT_OBJECT) return NULL;
+    for(size_t i = 0; i < v->count; i++) {
+        if(strcmp(v->keys[i], key) == 0) return &v->items[i];
+    }
+    return NULL;
+}
+
+static double
+json_number_of(const struct json *v) {
+    return v && v->type == JT_NUMBER ? v->number : NAN;
+}
+
+struct compare_run {
+    size_t n_metrics;
+    struct compare_metric {
+        char name[64];
+        enum compare_kind kind;
+        double final; /* NAN unless in the final report */
+        size_t n_windows;
+        double *windows;
+    } *metrics;
+};
+
+static void
+run_add(struct compare_run *run, const char *name, enum compare_kind kind,
+        int final, double value) {
+    if(!isfinite(value)) return;
+
+    struct compare_metric *m = NULL;
+    for(size_t i = 0; i < run->n_metrics; i++) {
+        if(strcmp(run->metrics[i].name, name) == 0) {
+            m = &run->metrics[i];
+            break;
+        }
+    }
+    if(!m) {
+        run->metrics = realloc(run->metrics,
+                               (run->n_metrics + 1) * sizeof(*run->metrics));
+        assert(run->metrics);
+        m = &run->metrics[run->n_metrics++];
+        memset(m, 0, sizeof(*m));
+        snprintf(m->name, sizeof(m->name), "%s", name);
+        m->kind = kind;
+        m->final = NAN;
+    }
+
+    if(final) {
+        m->final = value;
+    } else {
+        m->windows = realloc(m->windows,
+                             (m->n_windows + 1) * sizeof(m->windows[0]));
+        assert(m->windows);
+        m->windows[m->n_windows++] = value;
+    }
+}
+
+/*
+ * Take the metrics of a single report.
+ */
+static void
+run_add_report(struct compare_run *run, const struct json *report,
+               int final) {
+    double duration = json_number_of(json_member(report, "duration"));
+    if(!final && !(duration >= COMPARE_MIN_WINDOW_DURATION)) return;
+
+    static const char *rates[] = {"bps_in", "bps_out", "mps_in", "mps_out"};
+    for(size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        run_add(run, rates[i], CK_THROUGHPUT, final,
+                json_number_of(
+                    json_member(json_member(report, "rates"), rates[i])));
+    }
+
+    double opened = json_number_of(json_member(
+        json_member(report, "traffic"), "connections_opened"));
+    if(duration > 0)
+        run_add(run, "connect_rate", CK_CONNECT_RATE, final,
+                opened / duration);
+
+    const struct json *latency = json_member(report, "latency");
+    for(size_t t = 0; latency && t < latency->count; t++) {
+        const struct json *type = &latency->items[t];
+        const struct json *pcts = json_member(type, "percentiles");
+        if(!(json_number_of(json_member(type, "count")) > 0) || !pcts
+           || pcts->type != JT_OBJECT)
+            continue;
+        for(size_t i = 0; i < pcts->count; i++) {
+            char name[64];
+            snprintf(name, sizeof(name), "latency.%s.p%s", latency->keys[t],
+                     pcts->keys[i]);
+            run_add(run, name, CK_LATENCY, final,
+                    json_number_of(&pcts->items[i]));
+        }
+    }
+}
+
+struct compare_run *
+compare_run_new() {
+    struct compare_run *run = calloc(1, sizeof(*run));
+    assert(run);
+    return run;
+}
+
+void
+compare_run_add(struct compare_run *run, const char *name,
+                enum compare_kind kind, int final, double value) {
+    run_add(run, name, kind, final, value);
+}
+
+struct compare_run *
+compare_run_load(const char *text, size_t size) {
+    struct compare_run *run = compare_run_new();
+    int have_final = 0;
+
+    for(const char *end = text + size; text < end;) {
+        const char *eol = memchr(text, '\n', end - text);
+        if(!eol) eol = end;
+        char *line = strndup(text, eol - text);
+        assert(line);
+        text = eol + 1;
+
+        struct json report;
+        const char *p = line;
+        if(*skip_spaces(p) && json_parse_value(&p, &report, 0) == 0) {
+            const struct json *type = json_member(&report, "type");
+            if(type && type->type == JT_STRING) {
+                int final = strcmp(type->string, "final") == 0;
+                if(final || strcmp(type->string, "checkpoint") == 0)
+                    run_add_report(run, &report, final);
+                have_final |= final;
+            }
+            json_free(&report);
+        }
+        free(line);
+    }
+
+    if(!have_final) {
+        compare_run_free(run);
+        errno = EINVAL;
+        return NULL;
+    }
+    return run;
+}
+
+struct compare_run *
+compare_run_load_file(const char *filename) {
+    FILE *f = fopen(filename, "r");
+    if(!f) return NULL;
+
+    size_t size = 0;
+    size_t allocated = 65536;
+    char *text = malloc(allocated);
+    assert(text);
+    for(size_t rd; (rd = fread(text + size, 1, allocated - size, f)) > 0;) {
+        size += rd;
+        if(size == allocated) {
+            allocated *= 2;
+            text = realloc(text, allocated);
+            assert(text);
+        }
+    }
+    int error = ferror(f);
+    fclose(f);
+
+    struct compare_run *run = NULL;
+    if(error)
+        errno = EIO;
+    else
+        run = compare_run_load(text, size);
+    free(text);
+    return run;
+}
+
+void
+compare_run_free(struct compare_run *run) {
+    if(!run) return;
+    for(size_t i = 0; i < run->n_metrics; i++) free(run->metrics[i].windows);
+    free(run->metrics);
+    free(run);
+}
+
+/*
+ * The one-sided p-value of the Mann-Whitney U test for the (a) values
+ * tending to be greater than the (b) ones, by the normal approximation.
+ */
+static double
+mann_whitney_p(const double *a, size_t na, const double *b, size_t nb) {
+    double u = 0;
+    for(size_t i = 0; i < na; i++) {
+        for(size_t j = 0; j < nb; j++) {
+            if(a[i] > b[j])
+                u += 1;
+            else if(a[i] == b[j])
+                u += 0.5;
+        }
+    }
+    double mean = na * nb / 2.0;
+    double sd = sqrt(na * nb * (na + nb + 1) / 12.0);
+    if(!(sd > 0)) return 1.0;
+    /* With the continuity correction. */
+    double z = (u - mean - 0.5) / sd;
+    return 0.5 * erfc(z / sqrt(2));
+}
+
+int
+compare_runs(FILE *f, const struct compare_run *baseline,
+             const struct compare_run *current,
+             const struct compare_thresholds *thr) {
+    int regressions = 0;
+
+    for(size_t i = 0; i < baseline->n_metrics; i++) {
+        const struct compare_metric *b = &baseline->metrics[i];
+        const struct compare_metric *c = NULL;
+        for(size_t j = 0; j < current->n_metrics; j++) {
+            if(strcmp(current->metrics[j].name, b->name) == 0) {
+                c = &current->metrics[j];
+                break;
+            }
+        }
+        /* Nothing to compare to, such as an idle direction. */
+        if(!c || !(b->final > 0) || !isfinite(c->final)) continue;
+
+        double change = (c->final - b->final) / b->final;
+        double threshold;
+        switch(b->kind) {
+        case CK_THROUGHPUT:
+            threshold = thr->throughput;
+            break;
+        case CK_CONNECT_RATE:
+            threshold = thr->connect_rate;
+            break;
+        case CK_LATENCY:
+        default:
+            threshold = thr->latency;
+        }
+        int lower_is_better = b->kind == CK_LATENCY;
+        int worse = lower_is_better ? change > threshold : change < -threshold;
+
+        fprintf(f, "  %-24s %12.6g → %-12.6g %+7.1f%%", b->name, b->final,
+                c->final, 100 * change);
+        if(b->n_windows >= COMPARE_MIN_WINDOWS
+           && c->n_windows >= COMPARE_MIN_WINDOWS) {
+            double p = lower_is_better
+                           ? mann_whitney_p(c->windows, c->n_windows,
+                                            b->windows, b->n_windows)
+                           : mann_whitney_p(b->windows, b->n_windows,
+                                            c->windows, c->n_windows);
+            fprintf(f, "  p=%.3f", p);
+            if(worse && p >= COMPARE_SIGNIFICANCE) {
+                fprintf(f, "  (not significant)");
+                worse = 0;
+            }
+        }
+        if(worse) {
+            fprintf(f, "  REGRESSION");
+            regressions++;
+        }
+        fprintf(f, "\n");
+    }
+
+    return regressions;
+}
+
+void
+compare_ab(FILE *f, const char *name_a, const struct compare_run *a,
+           const char *name_b, const struct compare_run *b) {
+    fprintf(f, "  %-24s %12s %12s %8s\n", "", name_a, name_b, "B vs A");
+    for(size_t i = 0; i < a->n_metrics; i++) {
+        const struct compare_metric *ma = &a->metrics[i];
+        const struct compare_metric *mb = NULL;
+        for(size_t j = 0; j < b->n_metrics; j++) {
+            if(strcmp(b->metrics[j].name, ma->name) == 0) {
+                mb = &b->metrics[j];
+                break;
+            }
+        }
+        if(!mb || !isfinite(ma->final) || !isfinite(mb->final)) continue;
+        if(!(ma->final > 0) && !(mb->final > 0)) continue;
+
+        fprintf(f, "  %-24s %12.6g %12.6g", ma->name, ma->final, mb->final);
+        if(ma->final > 0)
+            fprintf(f, " %+7.1f%%",
+                    100 * (mb->final - ma->final) / ma->final);
+        else
+            fprintf(f, " %8s", "");
+        if(ma->n_windows >= COMPARE_MIN_WINDOWS
+           && mb->n_windows >= COMPARE_MIN_WINDOWS) {
+            /* Two-sided: either of them could be the better one. */
+            double p = 2 * fmin(mann_whitney_p(ma->windows, ma->n_windows,
+                                               mb->windows, mb->n_windows),
+                                mann_whitney_p(mb->windows, mb->n_windows,
+                                               ma->windows, ma->n_windows));
+            p = fmin(p, 1.0);
+            fprintf(f, "  p=%.3f", p);
+            if(p < COMPARE_SIGNIFICANCE) fprintf(f, "  (significant)");
+        }
+        fprintf(f, "\n");
+    }
+}
+
+int
+compare_thresholds_parse(struct compare_thresholds *thr, const char *str) {
+    static const char *names[] = {"throughput", "connect-rate", "latency"};
+    const char *p = str;
+
+    do {
+        p = skip_spaces(p);
+        int which = -1; /* All of them */
+        for(int i = 0; i < 3; i++) {
+            size_t len = strlen(names[i]);
+            if(strncmp(p, names[i], len) == 0 && p[len] == '=') {
+                which = i;
+                p += len + 1;
+                break;
+            }
+        }
+
+        char *end;
+        double value = strtod(p, &end);
+        if(end == p || *end != '%' || !(value >= 0)) {
+            fprintf(stderr,
+                    "--compare-threshold %s: Expecting <N>%% or "
+                    "{throughput|connect-rate|latency}=<N>%%\n",
+                    str);
+            return -1;
+        }
+        value /= 100;
+        if(which == -1 || which == 0) thr->throughput = value;
+        if(which == -1 || which == 1) thr->connect_rate = value;
+        if(which == -1 || which == 2) thr->latency = value;
+        p = skip_spaces(end + 1);
+    } while(*p == ',' && p++);
+
+    if(*p) {
+        fprintf(stderr, "--compare-threshold %s: Unexpected \"%s\"\n", str,
+                p);
+        return -1;
+    }
+    return 0;
+}
+
+#ifdef TCPKALI_COMPARE_UNIT_TEST
+
+static struct compare_run *
+make_run(double bps, double p95, int windows) {
+    char text[16384];
+    size_t size = 0;
+    for(int i = 0; i < windows; i++) {
+        /* Some noise around the numbers. */
+        double noise = 1 + ((i * 7) % 5 - 2) / 100.0;
+        size += snprintf(
+            text + size, sizeof(text) - size,
+            "{\"type\":\"checkpoint\",\"duration\":1,\"rates\":{\"bps_in\":%g,"
+            "\"bps_out\":0},\"traffic\":{\"connections_opened\":0},"
+            "\"latency\":{\"message\":{\"count\":10,\"percentiles\":"
+            "{\"95\":%g,\"99.5\":%g}},\"connect\":{\"count\":0}}}\n",
+            bps * noise, p95 * noise, 2 * p95 * noise);
+    }
+    /* The last partial window is not taken. */
+    size += snprintf(text + size, sizeof(text) - size,
+                     "{\"type\":\"checkpoint\",\"duration\":0.1,"
+                     "\"rates\":{\"bps_in\":1}}\n");
+    size += snprintf(
+        text + size, sizeof(text) - size,
+        "{\"type\":\"final\",\"duration\":10,\"rates\":{\"bps_in\":%g,"
+        "\"bps_out\":0,\"mps_in\":null},\"traffic\":"
+        "{\"connections_opened\":100},\"note\":\"\\\"\\u00e9\\n\","
+        "\"remotes\":[{\"a\":[1,-2.5e3,true,false]}],"
+        "\"latency\":{\"message\":{\"count\":100,\"percentiles\":"
+        "{\"95\":%g,\"99.5\":%g}}}}\n",
+        bps, p95, 2 * p95);
+    return compare_run_load(text, size);
+}
+
+int
+main() {
+    struct compare_thresholds thr = COMPARE_THRESHOLDS_DEFAULT;
+    assert(compare_thresholds_parse(&thr, "20%") == 0);
+    assert(thr.throughput == 0.2 && thr.connect_rate == 0.2
+           && thr.latency == 0.2);
+    assert(compare_thresholds_parse(&thr, "latency=50%, throughput=1.5%")
+           == 0);
+    assert(thr.latency == 0.5 && thr.throughput == 0.015
+           && thr.connect_rate == 0.2);
+    assert(compare_thresholds_parse(&thr, "5") == -1);
+    assert(compare_thresholds_parse(&thr, "speed=5%") == -1);
+    assert(compare_thresholds_parse(&thr, "5%,") == -1);
+
+    double hi[] = {6, 7, 8, 9, 10};
+    double lo[] = {1, 2, 3, 4, 5};
+    assert(mann_whitney_p(hi, 5, lo, 5) < 0.01);
+    assert(mann_whitney_p(lo, 5, hi, 5) > 0.99);
+    assert(mann_whitney_p(hi, 5, hi, 5) > 0.5);
+
+    errno = 0;
+    assert(compare_run_load("{\"type\":\"checkpoint\"}\n", 22) == NULL);
+    assert(errno == EINVAL);
+    assert(compare_run_load("{\"type\":", 8) == NULL);
+
+    struct compare_run *base = make_run(1e9, 2.0, 10);
+    assert(base);
+    const struct compare_metric *m = &base->metrics[0];
+    assert(strcmp(m->name, "bps_in") == 0);
+    assert(m->final == 1e9 && m->n_windows == 10);
+    int found = 0;
+    for(size_t i = 0; i < base->n_metrics; i++) {
+        m = &base->metrics[i];
+        if(strcmp(m->name, "latency.message.p99.5") == 0) {
+            assert(m->final == 4.0 && m->n_windows == 10);
+            found++;
+        } else if(strcmp(m->name, "connect_rate") == 0) {
+            assert(m->final == 10.0);
+            found++;
+        }
+        assert(strncmp(m->name, "latency.connect", 15) != 0);
+        assert(strcmp(m->name, "mps_in") != 0);
+    }
+    assert(found == 2);
+
+    thr = (struct compare_thresholds)COMPARE_THRESHOLDS_DEFAULT;
+    FILE *devnull = fopen("/dev/null", "w");
+    assert(devnull);
+
+    /* Same numbers */
+    struct compare_run *run = make_run(1e9, 2.0, 10);
+    assert(compare_runs(devnull, base, run, &thr) == 0);
+    compare_run_free(run);
+
+    /* Lower throughput and higher latency: three regressions. */
+    run = make_run(0.8e9, 3.0, 10);
+    assert(compare_runs(devnull, base, run, &thr) == 3);
+    compare_run_free(run);
+
+    /* Better numbers */
+    run = make_run(1.2e9, 1.0, 10);
+    assert(compare_runs(devnull, base, run, &thr) == 0);
+    compare_run_free(run);
+
+    /* Too few windows to test, the thresholds alone decide. */
+    run = make_run(0.8e9, 2.0, 2);
+    assert(compare_runs(devnull, base, run, &thr) == 1);
+    compare_run_free(run);
+
+    /* Beyond the threshold, yet within the noise of the windows. */
+    thr.throughput = 0.001;
+    run = make_run(0.998e9, 2.0, 10);
+    assert(compare_runs(devnull, base, run, &thr) == 0);
+    compare_run_free(run);
+
+    /* The A/B runs of the same numbers, and of the different ones. */
+    struct compare_run *ra = compare_run_new();
+    struct compare_run *rb = compare_run_new();
+    for(int w = 0; w < 10; w++) {
+        compare_run_add(ra, "bps_in", CK_THROUGHPUT, 0, 100 + w);
+        compare_run_add(rb, "bps_in", CK_THROUGHPUT, 0, 200 + w);
+    }
+    compare_run_add(ra, "bps_in", CK_THROUGHPUT, 1, 105);
+    compare_run_add(rb, "bps_in", CK_THROUGHPUT, 1, 205);
+    compare_run_add(rb, "mps_in", CK_THROUGHPUT, 1, 1);
+    assert(ra->n_metrics == 1 && ra->metrics[0].n_windows == 10);
+    assert(ra->metrics[0].final == 105);
+    char buf[512];
+    FILE *mem = fmemopen(buf, sizeof(buf), "w");
+    assert(mem);
+    compare_ab(mem, "A", ra, "B", rb);
+    fclose(mem);
+    assert(strstr(buf, "+95.2%") && strstr(buf, "(significant)"));
+    assert(!strstr(buf, "mps_in"));
+    mem = fmemopen(buf, sizeof(buf), "w");
+    assert(mem);
+    compare_ab(mem, "A", ra, "A", ra);
+    fclose(mem);
+    assert(strstr(buf, "p=1.000") && !strstr(buf, "(significant)"));
+    compare_run_free(ra);
+    compare_run_free(rb);
+
+    fclose(devnull);
+    compare_run_free(base);
+    return 0;
+}
+
+#endif /* TCPKALI_COMPARE_UNIT_TEST */
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_COMPARE_H
+#define TCPKALI_COMPARE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * Performance regression checks against a baseline run, see --compare-to.
+ *
+ * A run is a sequence of JSON reports, one per line, as written by
+ * --json-stream: the one second "checkpoint" windows, followed by the
+ * "final" report. A --json-report file is a run without the windows.
+ *
+ * The bits and messages per second, the connection rate and the latency
+ * percentiles of the final reports are compared. A metric regresses once
+ * it got worse than its threshold, and, where both runs have enough
+ * windows, the Mann-Whitney U test over the per-window values finds
+ * the change significant.
+ */
+
+#define TCPKALI_EXIT_REGRESSION 4 /* Exit status on a regression */
+
+struct compare_thresholds {
+    double throughput;   /* Relative drop of the bits and messages rates */
+    double connect_rate; /* Relative drop of the connections per second */
+    double latency;      /* Relative growth of the latency percentiles */
+};
+
+#define COMPARE_THRESHOLDS_DEFAULT \
+    { .throughput = 0.05, .connect_rate = 0.05, .latency = 0.10 }
+
+/*
+ * Parse the --compare-threshold list, such as "5%" for all the metrics,
+ * or "throughput=5%,connect-rate=10%,latency=20%". The errors are printed
+ * to stderr. Returns 0 on success, -1 on error.
+ */
+int compare_thresholds_parse(struct compare_thresholds *, const char *str);
+
+struct compare_run;
+
+enum compare_kind {
+    CK_THROUGHPUT,
+    CK_CONNECT_RATE,
+    CK_LATENCY, /* Milliseconds, the lower the better */
+};
+
+/*
+ * An empty run, to be filled with compare_run_add(). The (final) value
+ * goes into the final report, otherwise (value) is of the next window.
+ */
+struct compare_run *compare_run_new(void);
+void compare_run_add(struct compare_run *, const char *name,
+                     enum compare_kind, int final, double value);
+
+/*
+ * Load the reports of a run from the (text) of (size) bytes.
+ * Returns NULL with errno set to EINVAL if there is no final report.
+ */
+struct compare_run *compare_run_load(const char *text, size_t size);
+struct compare_run *compare_run_load_file(const char *filename);
+void compare_run_free(struct compare_run *);
+
+/*
+ * Print the comparison of the (current) run to the (baseline).
+ * Returns the number of the regressed metrics.
+ */
+int compare_runs(FILE *, const struct compare_run *baseline,
+                 const struct compare_run *current,
+                 const struct compare_thresholds *);
+
+/*
+ * Print the final values of the two runs of the --ab targets side
+ * by side, with the two-sided Mann-Whitney p-value of the difference
+ * where both have enough windows.
+ */
+void compare_ab(FILE *, const char *name_a, const struct compare_run *a,
+                const char *name_b, const struct compare_run *b);
+
+#endif /* TCPKALI_COMPARE_H */
@@ -1,107 +1,212 @@
 #define _GNU_SOURCE
 #include <assert.h>
+#include <stdlib.h>
+#include <pthread.h>
 
 #include "tcpkali_common.h"
 #include "tcpkali_connection.h"
 #include "tcpkali_ssl.h"
+#ifdef HAVE_OPENSSL
+#include <openssl/rand.h>
+#endif
 
-int
-ssl_setup(struct connection UNUSED *conn, int UNUSED sockfd,
-          char UNUSED *ssl_cert, char UNUSED *ssl_key) {
 #ifdef HAVE_OPENSSL
-    conn->conn_blocked = 0;
-    if(conn->ssl_ctx == NULL) {
-        const SSL_METHOD *method = conn->conn_type == CONN_OUTGOING
+/*
+ * Server-side session tickets are encrypted with the same keys in all
+ * workers, so a client may resume on any of them (SO_REUSEPORT).
+ */
+static unsigned char ssl_ticket_keys[48];
+static pthread_once_t ssl_ticket_keys_once = PTHREAD_ONCE_INIT;
+
+static void
+ssl_ticket_keys_init(void) {
+    if(RAND_bytes(ssl_ticket_keys, sizeof(ssl_ticket_keys)) != 1) {
+        fprintf(stderr, "Can not generate TLS ticket keys %lu\n",
+                ERR_get_error());
+        exit(1);
+    }
+}
+
+/*
+ * Remember the newest session (or ticket) of the remote, --ssl-session-reuse.
+ */
+static int
+ssl_new_session_cb(SSL *ssl, SSL_SESSION *session) {
+    struct connection *conn = SSL_get_app_data(ssl);
+    struct ssl_shared *shared = SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+    size_t n = conn->cold->remote_index;
+
+    if(n >= shared->sessions_count) return 0;
+    if(shared->sessions[n]) SSL_SESSION_free(shared->sessions[n]);
+    shared->sessions[n] = session;
+    return 1; /* Keep the reference. */
+}
+
+static SSL_CTX *
+ssl_shared_ctx(struct ssl_shared *shared, enum conn_type conn_type) {
+    SSL_CTX **ctxp = conn_type == CONN_OUTGOING ? &shared->client_ctx
+                                                : &shared->server_ctx;
+    if(*ctxp) return *ctxp;
+
+    const SSL_METHOD *method = conn_type == CONN_OUTGOING
 #if (OPENSSL_VERSION_NUMBER < 0x10100000L)
-                                       ? TLSv1_2_client_method()
-                                       : TLSv1_2_server_method();
+                                   ? TLSv1_2_client_method()
+                                   : TLSv1_2_server_method();
 #else
-                                       ? TLS_client_method()
-                                       : TLS_server_method();
+                                   ? TLS_client_method()
+                                   : TLS_server_method();
 #endif
-        if(method == NULL) {
-            fprintf(stderr, "Can not create SSL method %lu\n", ERR_get_error());
-            ERR_print_errors_fp(stderr);
-            exit(1);
-        }
-        conn->ssl_ctx = SSL_CTX_new(method);
+    if(method == NULL) {
+        fprintf(stderr, "Can not create SSL method %lu\n", ERR_get_error());
+        ERR_print_errors_fp(stderr);
+        exit(1);
     }
-    if(conn->ssl_ctx == NULL) {
+    SSL_CTX *ctx = SSL_CTX_new(method);
+    if(ctx == NULL) {
         fprintf(stderr, "Can not create SSL context %lu\n", ERR_get_error());
         ERR_print_errors_fp(stderr);
         exit(1);
-    } else {
-        if(conn->conn_type == CONN_INCOMING) {
+    }
+
+    if(conn_type == CONN_INCOMING) {
 #ifdef  HAVE_SSL_CTX_SET_ECDH_AUTO
-            SSL_CTX_set_ecdh_auto(conn->ssl_ctx, 1);
+        SSL_CTX_set_ecdh_auto(ctx, 1);
 #endif
-            if(SSL_CTX_use_certificate_file(conn->ssl_ctx, ssl_cert,
-                                            SSL_FILETYPE_PEM)
-               <= 0) {
-                fprintf(stderr, "%s: %s\n", ssl_cert,
-                        ERR_error_string(ERR_get_error(), NULL));
-                exit(1);
-            }
-            if(SSL_CTX_use_PrivateKey_file(conn->ssl_ctx, ssl_key,
-                                           SSL_FILETYPE_PEM)
-               <= 0) {
-                fprintf(stderr, "%s: %s\n", ssl_key,
-                        ERR_error_string(ERR_get_error(), NULL));
-                exit(1);
-            }
+        if(SSL_CTX_use_certificate_file(ctx, shared->cert, SSL_FILETYPE_PEM)
+           <= 0) {
+            fprintf(stderr, "%s: %s\n", shared->cert,
+                    ERR_error_string(ERR_get_error(), NULL));
+            exit(1);
         }
-        if(!conn->ssl_fd) {
-            conn->ssl_fd = SSL_new(conn->ssl_ctx);
-            SSL_set_fd(conn->ssl_fd, sockfd);
-            switch(conn->conn_type) {
-            case CONN_OUTGOING:
-                SSL_set_connect_state(conn->ssl_fd);
-                break;
-            case CONN_INCOMING:
-                SSL_set_accept_state(conn->ssl_fd);
-                break;
-            case CONN_ACCEPTOR:
-                assert(!"Unreachable");
-                break;
-            }
+        if(SSL_CTX_use_PrivateKey_file(ctx, shared->key, SSL_FILETYPE_PEM)
+           <= 0) {
+            fprintf(stderr, "%s: %s\n", shared->key,
+                    ERR_error_string(ERR_get_error(), NULL));
+            exit(1);
         }
-        int status = -1;
+        pthread_once(&ssl_ticket_keys_once, ssl_ticket_keys_init);
+        SSL_CTX_set_tlsext_ticket_keys(ctx, ssl_ticket_keys,
+                                       sizeof(ssl_ticket_keys));
+    }
+#ifdef SSL_OP_ENABLE_KTLS
+    if(shared->ktls) SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#endif
+#if (OPENSSL_VERSION_NUMBER >= 0x10002000L)
+    if(conn_type == CONN_OUTGOING && shared->alpn_h2)
+        SSL_CTX_set_alpn_protos(ctx, (const unsigned char *)"\x02h2", 3);
+#endif
+    if(conn_type == CONN_OUTGOING && shared->sessions_count) {
+        shared->sessions =
+            calloc(shared->sessions_count, sizeof(shared->sessions[0]));
+        assert(shared->sessions);
+        SSL_CTX_set_app_data(ctx, shared);
+        SSL_CTX_set_session_cache_mode(
+            ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ctx, ssl_new_session_cb);
+    }
+
+    *ctxp = ctx;
+    return ctx;
+}
+#endif /* HAVE_OPENSSL */
+
+int
+ssl_setup(struct connection UNUSED *conn, int UNUSED sockfd,
+          struct ssl_shared UNUSED *shared) {
+#ifdef HAVE_OPENSSL
+    conn->conn_blocked = 0;
+    if(!conn->cold->ssl_fd) {
+        conn->cold->ssl_fd =
+            SSL_new(ssl_shared_ctx(shared, conn->conn_type));
+        if(conn->cold->ssl_fd == NULL) {
+            fprintf(stderr, "Can not create SSL connection %lu\n",
+                    ERR_get_error());
+            ERR_print_errors_fp(stderr);
+            exit(1);
+        }
+        SSL_set_fd(conn->cold->ssl_fd, sockfd);
+        SSL_set_app_data(conn->cold->ssl_fd, conn);
         switch(conn->conn_type) {
         case CONN_OUTGOING:
-            status = SSL_connect(conn->ssl_fd);
+            if(shared->sessions
+               && (size_t)conn->cold->remote_index < shared->sessions_count
+               && shared->sessions[conn->cold->remote_index]) {
+                SSL_set_session(conn->cold->ssl_fd,
+                                shared->sessions[conn->cold->remote_index]);
+            }
+            SSL_set_connect_state(conn->cold->ssl_fd);
             break;
         case CONN_INCOMING:
-            status = SSL_accept(conn->ssl_fd);
+            SSL_set_accept_state(conn->cold->ssl_fd);
             break;
         case CONN_ACCEPTOR:
             assert(!"Unreachable");
             break;
         }
-        switch(SSL_get_error(conn->ssl_fd, status)) {
-        case SSL_ERROR_NONE:
-            assert(status == 1);
-            break;
-        case SSL_ERROR_WANT_READ:
-            assert(status == -1);
-            conn->conn_blocked |= CBLOCKED_ON_READ;
-            break;
-        case SSL_ERROR_WANT_WRITE:
-            assert(status == -1);
-            conn->conn_blocked |= CBLOCKED_ON_WRITE;
-            break;
-        default:
-            fprintf(stderr, "Can not create SSL connect %lu\n",
-                    ERR_get_error());
-            ERR_print_errors_fp(stderr);
-            return 0;
-        }
-        if(status < 0) {
-            conn->conn_blocked |= CBLOCKED_ON_INIT;
+    }
+    int status = -1;
+    switch(conn->conn_type) {
+    case CONN_OUTGOING:
+        status = SSL_connect(conn->cold->ssl_fd);
+        break;
+    case CONN_INCOMING:
+        status = SSL_accept(conn->cold->ssl_fd);
+        break;
+    case CONN_ACCEPTOR:
+        assert(!"Unreachable");
+        break;
+    }
+    switch(SSL_get_error(conn->cold->ssl_fd, status)) {
+    case SSL_ERROR_NONE:
+        assert(status == 1);
+        if(SSL_session_reused(conn->cold->ssl_fd)) shared->sessions_resumed++;
+#ifdef SSL_OP_ENABLE_KTLS
+        /*
+         * The kernel took over the encryption: the data can be written
+         * into the socket directly. The reads still go through OpenSSL.
+         */
+        if(shared->ktls && BIO_get_ktls_send(SSL_get_wbio(conn->cold->ssl_fd))) {
+            conn->ktls_send = 1;
+            conn->zerocopy.enabled = 0; /* Not supported by the TLS ULP */
+            shared->ktls_offloaded++;
         }
+#endif
+        break;
+    case SSL_ERROR_WANT_READ:
+        assert(status == -1);
+        conn->conn_blocked |= CBLOCKED_ON_READ;
+        break;
+    case SSL_ERROR_WANT_WRITE:
+        assert(status == -1);
+        conn->conn_blocked |= CBLOCKED_ON_WRITE;
+        break;
+    default:
+        fprintf(stderr, "Can not create SSL connect %lu\n",
+                ERR_get_error());
+        ERR_print_errors_fp(stderr);
+        return 0;
+    }
+    if(status < 0) {
+        conn->conn_blocked |= CBLOCKED_ON_INIT;
     }
-    assert(conn->ssl_fd != NULL);
+    assert(conn->cold->ssl_fd != NULL);
 #else
     assert(!"Unreachable");
 #endif /* HAVE_OPENSSL */
     return 1;
 }
+
+void
+ssl_shared_free(struct ssl_shared UNUSED *shared) {
+#ifdef HAVE_OPENSSL
+    for(size_t n = 0; shared->sessions && n < shared->sessions_count; n++) {
+        if(shared->sessions[n]) SSL_SESSION_free(shared->sessions[n]);
+    }
+    free(shared->sessions);
+    shared->sessions = NULL;
+    if(shared->client_ctx) SSL_CTX_free(shared->client_ctx);
+    if(shared->server_ctx) SSL_CTX_free(shared->server_ctx);
+    shared->client_ctx = NULL;
+    shared->server_ctx = NULL;
+#endif /* HAVE_OPENSSL */
+}
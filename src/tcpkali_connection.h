@@ -7,37 +7,204 @@
 #include "config.h"
 
 #include "tcpkali_events.h"
+#include "tcpkali_framer.h"
+#include "tcpkali_framing.h"
+#include "tcpkali_http.h"
+#include "tcpkali_http2.h"
+#include "tcpkali_grpc.h"
 #include "tcpkali_iface.h"
+#include "tcpkali_mqtt.h"
 #include "tcpkali_pacefier.h"
 #include "tcpkali_rate.h"
+#include "tcpkali_resp.h"
 #include "tcpkali_ssl.h"
 #include "tcpkali_traffic_stats.h"
 #include "tcpkali_transport.h"
+#include "tcpkali_websocket.h"
+#include "tcpkali_wheel.h"
+
+#define CONNECTION_ALIGNMENT 64 /* Cache line size */
 
 /*
- * A single connection is described by this structure (about 150 bytes).
+ * Rarely used connection data, kept out of the way of the I/O path.
+ */
+struct connection_cold {
+    non_atomic_traffic_stats traffic_reported; /* Reported to worker */
+    TAILQ_ENTRY(connection) dirty_hook; /* See (stats_dirty) */
+    struct message_collection *message_collection; /* Shared, read-only */
+    struct payload_job *payload_job; /* Spare payload, see tcpkali_pregen.h */
+    /* --rebalance: the move to another worker, see connection_detach() */
+    struct {
+        non_atomic_wide_t bytes_mark; /* Data moved by the last ranking */
+        double timer_at;              /* The pending (timer), or 0.0 */
+        double lifetime_at;           /* The pending (lifetime_timer) */
+        int watching;                 /* The watcher was active */
+    } migration;
+    int16_t remote_index;                     /* \x ->
+                                                 loop_arguments.params.remote_addresses.addrs[x] */
+    uint16_t group; /* 1 + index into params.groups[], 0 if none */
+    unsigned message_set; /* Of the (message_collection), see SetMessage */
+    non_atomic_narrow_t connection_unique_id; /* connection.uid */
+    uint32_t expr_seed; /* Of the connection.regex values */
+    double send_rate_weight; /* --message-rate-distribution, or 0.0 */
+    struct sockaddr_storage peer_name; /* For CONN_INCOMING */
+    size_t peer_index; /* --per-peer-stats: into the worker's peer table */
+    /* --listen-mode=echo */
+    struct {
+        int pipe[2];     /* Received data is spliced through */
+        size_t queued;   /* Bytes in the pipe */
+        size_t capacity; /* Pipe size */
+    } echo;
+    /* Incoming WebSocket frames, see (ws_frames) */
+    struct websocket_parser ws_parser;
+    struct z_stream_s *ws_inflate; /* permessage-deflate, if compressed */
+    /* The incoming --ws upgrade request, until answered */
+    struct http_websocket_request *ws_request;
+    unsigned ws_accept_pending; /* 1 + index into largs->ws_accepts, or 0 */
+    size_t burst_slot; /* 1 + index into largs->burst.conns, or 0 */
+    size_t send_queue_slot; /* 1 + index into largs->send_queue, or 0 */
+    /* Incoming HTTP responses, see (http_responses) */
+    struct http_parser http_parser;
+    /* Incoming --resp replies, see (resp_replies) */
+    struct resp_parser resp_parser;
+    /* --mqtt packets, see (mqtt_packets) */
+    struct {
+        struct mqtt_parser parser;
+        uint32_t published; /* QoS 1 PUBLISH packets numbered and sent */
+    } mqtt;
+    /* Of the --pipeline requests yet to be answered, see (pipelined) */
+    size_t pipelined_bytes;
+    double think_until; /* --think-time: no requests until then */
+    /* --framing lenprefix, see (lenprefix_frames) */
+    struct lenprefix_parser lenprefix_parser;
+    void *framer_state; /* --framer, see (framer_responses) */
+    uint64_t record_offset; /* Bytes --record'ed, see (recorded) */
+    size_t keepalive_sent;  /* Of a partially written --keepalive-message */
+    /* --replay-timing original, see (replay_timed) */
+    struct {
+        const struct pcap_stream *stream;
+        size_t burst; /* See pcap_stream_due() */
+    } replay;
+    /* --http2 streams, see (http2_frames) */
+    struct {
+        struct http2_parser parser;
+        uint32_t streams_started;  /* Requests sent on streams 1, 3, ... */
+        uint32_t max_streams;      /* SETTINGS_MAX_CONCURRENT_STREAMS */
+        int64_t send_window;       /* Connection flow control window */
+        int64_t stream_window;     /* --grpc-stream flow control window */
+        uint32_t initial_window;   /* SETTINGS_INITIAL_WINDOW_SIZE */
+        struct grpc_reader grpc_reader; /* --grpc-stream messages received */
+        size_t body_size;          /* DATA bytes in a request */
+        size_t recv_unacked;       /* DATA bytes received, not yet credited */
+        struct {
+            uint32_t id; /* Stream identifier, 0 if the slot is free */
+            double sent_ts;
+        } *streams;                /* --pipeline slots */
+        int stopped;               /* GOAWAY or a protocol error */
+        uint8_t control[128];      /* SETTINGS and PING ACKs, WINDOW_UPDATEs */
+        size_t control_size;
+        size_t control_retry;      /* SSL_write() to be repeated this long */
+    } http2;
+    struct echo_verify *echo_verify; /* --verify-echo */
+    struct connection_mirror *mirror; /* The --mirror twin, or NULL */
+    char *zerocopy_rx_map; /* Read-only socket pages, see zerocopy_read() */
+    uint64_t echo_mismatches;        /* Reported so far */
+    /* --listen-mode=respond */
+    struct {
+        struct StreamBMH *sbmh_request_ctx; /* --request-delimiter search */
+        size_t owed; /* Bytes of the --response copies yet to be sent */
+    } respond;
+    /* Latency */
+    struct {
+        double connection_initiated;
+        double handshake_started; /* Handshake could proceed */
+        double upgrade_started;   /* WebSocket upgrade request started */
+        struct ts_ring *sent_timestamps;
+        struct ts_ring *uncorrected_timestamps; /* --latency-correction=both */
+        struct hdr_histogram *marker_histogram;
+        unsigned marker_step; /* The worker's rate step it measures */
+        /* All the message latencies, for the --per-connection-stats */
+        uint64_t summary_count;
+        int64_t summary_sum;
+        int64_t summary_max;
+        unsigned size_class;  /* --latency-by-size, see message_size_class() */
+        unsigned message_bytes_credit; /* See (EXPL:1) below. */
+        unsigned lm_occurrences_skip;  /* See --latency-marker-skip */
+        /* --latency-sample: the messages sent and replies received */
+        uint64_t sample_sent;
+        uint64_t sample_rcvd;
+        unsigned samples_skip; /* Sampled replies whose ticks were dropped */
+        /* Boyer-Moore-Horspool substring search algorithm data */
+        struct StreamBMH *sbmh_marker_ctx;
+        /* The following fields might be shared across connections. */
+        int sbmh_shared;                  /* The trivial --latency-marker */
+        struct marker_intern *sbmh_intern; /* Unless (sbmh_shared) */
+        struct StreamBMH_Occ *sbmh_occ;
+        const uint8_t *sbmh_data;
+        size_t sbmh_size;
+        struct message_marker_parser_state {
+            enum {
+                MP_DISENGAGED,
+                MP_SLURPING_DIGITS,
+                MP_SLURPING_BINARY
+            } state;
+            uint64_t collected_digits;
+            /* Binary marker body, possibly split between reads. */
+            size_t collected_size;
+            struct message_marker_binary collected_binary;
+            /* Sequence tracking of the received binary markers. */
+            int seen_binary;
+            uint32_t last_uid;
+            uint32_t last_sequence;
+        } marker_parser;
+        struct fanout_sources *fanout; /* --fanout, by the publisher uid */
+        /* Sending side of the binary markers. */
+        int marker_binary;           /* --message-marker-format binary */
+        uint32_t marker_sequence;    /* Next sequence number to assign */
+        size_t marker_sequenced_upto; /* Data offset, see update_timestamps() */
+        /* Kernel send timestamps awaited, see --latency-timestamping */
+        struct tstamp_state *tstamp;
+    } latency;
+    /* The \{message.seq} numbering, see update_slots(). */
+    uint64_t slot_sequence;
+    size_t slots_sequenced_upto;
+#ifdef HAVE_OPENSSL
+    /* SSL/TLS support, the context is in struct ssl_shared */
+    SSL *ssl_fd;
+#endif
+};
+
+/*
+ * A single connection is described by this structure. The fields touched
+ * on every I/O event come first, starting at a cache line boundary;
+ * the rest is in connection_cold.
  */
 struct connection {
     tk_io watcher;
-    tk_timer timer;
     off_t write_offset;
     struct transport_data_spec data;
     non_atomic_traffic_stats traffic_ongoing;  /* Connection-local numbers */
     size_t avg_message_size;
     size_t bytes_leftovers;
-    non_atomic_traffic_stats traffic_reported; /* Reported to worker */
-    float channel_eol_point; /* End of life time, since epoch */
     struct pacefier send_pace;
+    double send_schedule_ts; /* Intended time to send the next byte at */
+    double send_next_arrival_ts; /* --message-arrival poisson */
+    size_t send_arrived_bytes;   /* Released but not yet sent */
+    double send_jitter;          /* --message-rate-jitter of the pace, s */
+    size_t send_burst_room;      /* --burst-every: released, not yet sent */
     struct pacefier recv_pace;
     bandwidth_limit_t send_limit;
+    unsigned send_rate_version; /* Of the send_limit, see --load-profile */
     bandwidth_limit_t recv_limit;
-    struct message_collection message_collection;
     enum {
         CW_READ_INTEREST = 0x01,
         CW_READ_BLOCKED = 0x10,
         CW_WRITE_INTEREST = 0x02,
         CW_WRITE_BLOCKED = 0x20,
         CW_WRITE_DELAYED = 0x40,
+        CW_WRITE_ZEROCOPY = 0x80, /* Waiting for MSG_ZEROCOPY completions */
+        CW_WRITE_PIPELINED = 0x04, /* --pipeline requests in flight */
+        CW_WRITE_MIRRORED = 0x08,  /* The --mirror twin is behind */
     } conn_wish : 8;
     enum conn_type {
         CONN_OUTGOING,
@@ -52,44 +219,72 @@ struct connection {
         WSTATE_SENDING_HTTP_UPGRADE,
         WSTATE_WS_ESTABLISHED,
     } ws_state : 1;
-    int16_t remote_index;                     /* \x ->
-                                                 loop_arguments.params.remote_addresses.addrs[x] */
-    non_atomic_narrow_t connection_unique_id; /* connection.uid */
-    TAILQ_ENTRY(connection) hook;
-    struct sockaddr_storage peer_name; /* For CONN_INCOMING */
-    /* Latency */
-    struct {
-        double connection_initiated;
-        struct ring_buffer *sent_timestamps;
-        struct hdr_histogram *marker_histogram;
-        unsigned message_bytes_credit; /* See (EXPL:1) below. */
-        unsigned lm_occurrences_skip;  /* See --latency-marker-skip */
-        /* Boyer-Moore-Horspool substring search algorithm data */
-        struct StreamBMH *sbmh_marker_ctx;
-        /* The following fields might be shared across connections. */
-        int sbmh_shared;
-        struct StreamBMH_Occ *sbmh_occ;
-        const uint8_t *sbmh_data;
-        size_t sbmh_size;
-        struct message_marker_parser_state {
-            enum { MP_DISENGAGED, MP_SLURPING_DIGITS } state;
-            uint64_t collected_digits;
-        } marker_parser;
-    } latency;
-    struct StreamBMH *sbmh_stop_ctx;
+    unsigned timestamping : 1; /* SO_TIMESTAMPING, cold->latency.tstamp */
+    unsigned echo : 1;         /* --listen-mode=echo, cold->echo */
+    unsigned recv_discard : 1; /* --listen-mode=discard */
+    unsigned respond : 1;      /* --listen-mode=respond, cold->respond */
+    unsigned ws_frames : 1;    /* Parse the incoming frames, cold->ws_parser */
+    unsigned http_responses : 1; /* Parse the responses, cold->http_parser */
+    unsigned http2_frames : 1;   /* Parse the frames, cold->http2 */
+    unsigned lenprefix_frames : 1; /* cold->lenprefix_parser, --framing */
+    unsigned framer_responses : 1; /* cold->framer_state, --framer */
+    unsigned resp_replies : 1;   /* Parse the replies, cold->resp_parser */
+    unsigned mqtt_packets : 1;   /* Parse the packets, cold->mqtt */
+    unsigned pipelined : 1;      /* Requests in flight are limited */
+    unsigned replay_timed : 1;   /* --replay-pcap pacing, cold->replay */
+    unsigned recorded : 1;       /* --record the received data */
+    unsigned sendfile_body : 1;  /* --sendfile the messages, data.body_fd */
+    unsigned ktls_send : 1;    /* --ssl-ktls: the kernel encrypts writes */
+    unsigned kernel_paced : 1; /* --kernel-pacing: SO_MAX_PACING_RATE set */
+    unsigned closing : 1;      /* --close-style: waiting for the peer */
+    unsigned stats_dirty : 1;  /* traffic_ongoing is not yet reported */
+    unsigned verify_echo : 1;  /* --verify-echo, see cold->echo_verify */
+    unsigned stop_scan : 1;    /* --message-stop, see stop_scan_state */
+    unsigned fastopen : 1;     /* --tcp-fastopen, see fastopen_count() */
+    unsigned huge : 1;         /* In the --hugepages arena, with its cold */
+    unsigned zerocopy_rx : 1;  /* --zerocopy-receive, see zerocopy_read() */
     enum {
         CBLOCKED_ON_INIT  = 0x01,
         CBLOCKED_ON_READ  = 0x10,
         CBLOCKED_ON_WRITE = 0x20
     } conn_blocked : 8;
+    uint32_t stop_scan_state; /* --message-stop, see tk_multiscan_feed() */
+    /* --write-combine adaptive, see write_combine_adapt() */
+    uint32_t wrcomb_batch;     /* The body bytes per write, or 0 */
+    uint32_t wrcomb_countdown; /* Writes until the socket is looked at */
+    /* MSG_ZEROCOPY sends, see --zerocopy */
+    struct {
+        uint32_t sent;      /* Number of zerocopy sends issued */
+        uint32_t completed; /* Number of sends released by the kernel */
+        int enabled;
+    } zerocopy;
+    struct connection_cold *cold;
+    TAILQ_ENTRY(connection) hook;
+    struct tk_pool *pool; /* Where to release this structure, if not free() */
+    struct tk_wheel_entry timer;          /* Timeouts and pacing wakeups */
+    struct tk_wheel_entry lifetime_timer; /* --channel-lifetime */
+} __attribute__((aligned(CONNECTION_ALIGNMENT)));
+
+/*
+ * The TLS contexts, shared by the connections of a worker thread
+ * instead of being created anew for every connection.
+ */
+struct ssl_shared {
 #ifdef HAVE_OPENSSL
-    /* SSL/TLS support */
-    SSL_CTX *ssl_ctx;
-    SSL *ssl_fd;
+    SSL_CTX *client_ctx;
+    SSL_CTX *server_ctx;
+    SSL_SESSION **sessions; /* --ssl-session-reuse, by remote_index */
 #endif
+    size_t sessions_count;  /* Non-zero to resume the sessions */
+    size_t sessions_resumed; /* Handshakes which resumed a session */
+    int ktls;                /* --ssl-ktls */
+    int alpn_h2;             /* --http2: offer "h2" in ALPN */
+    size_t ktls_offloaded;   /* Connections sending through kTLS */
+    const char *cert;
+    const char *key;
 };
 
-int ssl_setup(struct connection *conn, int sockfd, char *ssl_cert,
-              char *ssl_key);
+int ssl_setup(struct connection *conn, int sockfd, struct ssl_shared *);
+void ssl_shared_free(struct ssl_shared *);
 
 #endif /* TCPKALI_CONNECTION_H */
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <sys/socket.h>
+#include <netdb.h>
+
+#include "tcpkali_connstats.h"
+#include "tcpkali_spsc.h"
+
+/* How long the writer sleeps when the rings are empty, nanoseconds. */
+#define CONNSTATS_POLL_INTERVAL_NS 5000000
+
+struct connstats_ring {
+    struct spsc_ring ring; /* Of the connstats_record, (dropped) counted */
+};
+
+struct connstats {
+    struct connstats_ring *rings;
+    int rings_count;
+    FILE *fp;
+    char *filename;
+    int write_error;
+    struct spsc_writer writer;
+};
+
+int
+connstats_append(struct connstats_ring *ring,
+                 const struct connstats_record *rec) {
+    if(spsc_ring_append(&ring->ring, rec, sizeof(*rec), NULL, 0) == -1) {
+        ring->ring.dropped++;
+        return -1;
+    }
+    return 0;
+}
+
+static void
+connstats_print(FILE *fp, const struct connstats_record *rec) {
+    char host[INET6_ADDRSTRLEN] = "";
+    char port[8] = "";
+    socklen_t salen = rec->remote.sa.sa_family == AF_INET6
+                          ? sizeof(rec->remote.sin6)
+                          : sizeof(rec->remote.sin);
+
+    if(rec->remote.sa.sa_family == AF_UNSPEC
+       || getnameinfo(&rec->remote.sa, salen, host, sizeof(host), port,
+                      sizeof(port), NI_NUMERICHOST | NI_NUMERICSERV)
+              != 0) {
+        host[0] = '\0';
+        port[0] = '\0';
+    }
+
+    fprintf(fp,
+            "%" PRIu64 ",%s,%s%s%s%s%s,%.6f,%" PRIu64 ",%" PRIu64 ",%" PRIu64
+            ",%" PRIu64 ",%s",
+            rec->uid, rec->remote.sa.sa_family == AF_UNSPEC ? "in" : "out",
+            rec->remote.sa.sa_family == AF_INET6 ? "[" : "", host,
+            rec->remote.sa.sa_family == AF_INET6 ? "]" : "",
+            port[0] ? ":" : "", port, rec->lifetime, rec->bytes_sent,
+            rec->bytes_rcvd, rec->msgs_sent, rec->msgs_rcvd,
+            rec->close_reason);
+    for(int i = 0; i < 2; i++) {
+        if(rec->latency_ns[i] < 0)
+            fputs(",", fp);
+        else
+            fprintf(fp, ",%.3f", rec->latency_ns[i] / 1e6);
+    }
+    fputc('\n', fp);
+}
+
+/*
+ * Write out the records in the ring.
+ * Returns the number of records consumed from the ring.
+ */
+static size_t
+connstats_ring_drain(struct connstats *cs, struct connstats_ring *ring) {
+    size_t tail = spsc_ring_tail(&ring->ring);
+    size_t head = ring->ring.head;
+
+    /* After a write error, the records are discarded. */
+    struct connstats_record rec;
+    for(size_t n = head; n != tail && !cs->write_error; n += sizeof(rec)) {
+        spsc_ring_copy_out(&ring->ring, n, &rec, sizeof(rec));
+        connstats_print(cs->fp, &rec);
+    }
+
+    spsc_ring_consume(&ring->ring, tail);
+    return (tail - head) / sizeof(rec);
+}
+
+static void
+connstats_flush(struct connstats *cs) {
+    if(cs->write_error) return;
+    if(fflush(cs->fp) != 0 || ferror(cs->fp)) {
+        cs->write_error = errno ? errno : EIO;
+        fprintf(stderr, "--per-connection-stats %s: %s\n", cs->filename,
+                strerror(cs->write_error));
+    }
+}
+
+static size_t
+connstats_drain(void *arg, int terminate) {
+    struct connstats *cs = arg;
+    size_t drained = 0;
+    for(int i = 0; i < cs->rings_count; i++)
+        drained += connstats_ring_drain(cs, &cs->rings[i]);
+    /* The lines are flushed as soon as there is a pause. */
+    if(drained == 0 || terminate) connstats_flush(cs);
+    return drained;
+}
+
+struct connstats *
+connstats_open(const char *filename, int workers, size_t ring_records) {
+    FILE *fp = fopen(filename, "w");
+    if(!fp) return NULL;
+    fputs("uid,type,remote,lifetime_s,bytes_sent,bytes_rcvd,msgs_sent,"
+          "msgs_rcvd,close_reason,latency_mean_ms,latency_max_ms\n",
+          fp);
+
+    struct connstats *cs = calloc(1, sizeof(*cs));
+    assert(cs);
+    cs->fp = fp;
+    cs->filename = strdup(filename);
+    cs->rings_count = workers;
+    cs->rings = aligned_alloc(64, workers * sizeof(cs->rings[0]));
+    assert(cs->rings);
+    memset(cs->rings, 0, workers * sizeof(cs->rings[0]));
+    if(ring_records < 64) ring_records = 64;
+    for(int i = 0; i < workers; i++)
+        spsc_ring_init(&cs->rings[i].ring,
+                       ring_records * sizeof(struct connstats_record));
+
+    spsc_writer_start(&cs->writer, connstats_drain, cs,
+                      CONNSTATS_POLL_INTERVAL_NS, 0);
+
+    return cs;
+}
+
+struct connstats_ring *
+connstats_ring(struct connstats *cs, int worker) {
+    assert(worker >= 0 && worker < cs->rings_count);
+    return &cs->rings[worker];
+}
+
+size_t
+connstats_close(struct connstats *cs) {
+    size_t dropped = 0;
+
+    if(!cs) return 0;
+
+    spsc_writer_stop(&cs->writer);
+
+    for(int i = 0; i < cs->rings_count; i++) {
+        dropped += cs->rings[i].ring.dropped;
+        spsc_ring_free(&cs->rings[i].ring);
+    }
+    fclose(cs->fp);
+    free(cs->rings);
+    free(cs->filename);
+    free(cs);
+
+    return dropped;
+}
+
+#ifdef TCPKALI_CONNSTATS_UNIT_TEST
+
+int
+main() {
+    char filename[] = "/tmp/check_tcpkali_connstats.XXXXXX";
+    int fd = mkstemp(filename);
+    assert(fd != -1);
+
+    struct connstats *cs = connstats_open(filename, 2, 10);
+    assert(cs);
+    struct connstats_ring *ring = connstats_ring(cs, 1);
+    assert(ring->ring.size >= 64 * sizeof(struct connstats_record));
+
+    struct connstats_record rec = {.uid = 7,
+                                   .lifetime = 1.5,
+                                   .bytes_sent = 100,
+                                   .bytes_rcvd = 200,
+                                   .msgs_sent = 1,
+                                   .msgs_rcvd = 2,
+                                   .latency_ns = {1000000, 2500000},
+                                   .close_reason = "clean"};
+    rec.remote.sin.sin_family = AF_INET;
+    rec.remote.sin.sin_port = htons(80);
+    rec.remote.sin.sin_addr.s_addr = htonl(0x7f000001);
+
+    /* Wrap around the ring many times while the writer drains it. */
+    size_t appended = 0;
+    size_t dropped = 0;
+    for(int i = 0; i < 20000; i++) {
+        if(connstats_append(ring, &rec) == 0)
+            appended++;
+        else
+            dropped++;
+    }
+    struct connstats_record in = {.uid = 8,
+                                  .latency_ns = {-1, -1},
+                                  .close_reason = "remote"};
+    assert(connstats_append(connstats_ring(cs, 0), &in) == 0);
+    assert(connstats_close(cs) == dropped);
+
+    FILE *fp = fdopen(fd, "r");
+    assert(fp);
+    char line[256];
+    assert(fgets(line, sizeof(line), fp));
+    assert(strncmp(line, "uid,type,remote,", 16) == 0);
+    size_t found = 0;
+    int found_in = 0;
+    while(fgets(line, sizeof(line), fp)) {
+        if(strcmp(line, "8,in,,0.000000,0,0,0,0,remote,,\n") == 0) {
+            found_in++;
+            continue;
+        }
+        assert(strcmp(line, "7,out,127.0.0.1:80,1.500000,100,200,1,2,clean,"
+                            "1.000,2.500\n")
+               == 0);
+        found++;
+    }
+    assert(found == appended);
+    assert(found_in == 1);
+    fclose(fp);
+    unlink(filename);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_CONNSTATS_UNIT_TEST */
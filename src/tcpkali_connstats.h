@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_CONNSTATS_H
+#define TCPKALI_CONNSTATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+
+/*
+ * The per-connection statistics, see --per-connection-stats.
+ *
+ * Each worker appends a fixed size record per closed connection into its
+ * own ring, without locks or system calls. A background thread drains the
+ * rings and writes the records as CSV lines, so the formatting is not done
+ * by the workers. When the writer falls behind, the records which do not
+ * fit are dropped and counted, rather than holding up the worker.
+ */
+
+struct connstats_record {
+    uint64_t uid;      /* \{connection.uid} */
+    double lifetime;   /* Seconds */
+    uint64_t bytes_sent;
+    uint64_t bytes_rcvd;
+    uint64_t msgs_sent;
+    uint64_t msgs_rcvd;
+    /* The mean and the maximum message latency, or -1. */
+    int64_t latency_ns[2];
+    union {
+        struct sockaddr sa; /* AF_UNSPEC for the incoming connections */
+        struct sockaddr_in sin;
+        struct sockaddr_in6 sin6;
+    } remote;
+    const char *close_reason; /* Must be a static string */
+};
+
+struct connstats;
+struct connstats_ring;
+
+/*
+ * Create the file, write out the CSV header and start the writer thread.
+ * Returns NULL and sets errno on failure.
+ */
+struct connstats *connstats_open(const char *filename, int workers,
+                                 size_t ring_records);
+
+/*
+ * The ring of the given worker. Only that worker may append to it.
+ */
+struct connstats_ring *connstats_ring(struct connstats *, int worker);
+
+/*
+ * Copy the record into the ring. Returns -1 if the ring is full,
+ * in which case the record is dropped.
+ */
+int connstats_append(struct connstats_ring *, const struct connstats_record *);
+
+/*
+ * Write out what is left in the rings, stop the thread and close
+ * the file. Returns the number of records dropped.
+ * The workers must not append to the rings anymore.
+ */
+size_t connstats_close(struct connstats *);
+
+#endif /* TCPKALI_CONNSTATS_H */
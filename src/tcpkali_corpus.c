@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <assert.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tcpkali_corpus.h"
+
+static void
+corpus_add(struct message_corpus *corpus, size_t *offsets_size,
+           const void *msg, size_t size) {
+    /* The (offsets) are terminated by the end of the last message. */
+    if(corpus->count + 1 >= *offsets_size) {
+        *offsets_size = *offsets_size ? 2 * *offsets_size : 64;
+        corpus->offsets = realloc(corpus->offsets,
+                                  *offsets_size * sizeof(corpus->offsets[0]));
+        assert(corpus->offsets);
+    }
+    corpus->offsets[corpus->count++] = corpus->data.total_size;
+    memcpy((char *)corpus->data.ptr + corpus->data.total_size, msg, size);
+    corpus->data.total_size += size;
+    corpus->offsets[corpus->count] = corpus->data.total_size;
+}
+
+static uint64_t
+frame_length(const uint8_t *p, unsigned prefix_size, int little_endian) {
+    uint64_t length = 0;
+    for(unsigned i = 0; i < prefix_size; i++) {
+        length = (length << 8)
+                 | p[little_endian ? prefix_size - 1 - i : i];
+    }
+    return length;
+}
+
+struct message_corpus *
+message_corpus_parse(const void *data, size_t size, unsigned prefix_size,
+                     int little_endian, const char **errmsg) {
+    struct message_corpus *corpus = calloc(1, sizeof(*corpus));
+    assert(corpus);
+    /* A newline might be added after the last line. */
+    corpus->data.ptr = malloc(size + 2);
+    corpus->data.allocated_size = size + 1;
+    assert(corpus->data.ptr);
+
+    size_t offsets_size = 0;
+    const uint8_t *p = data;
+    const uint8_t *end = p + size;
+
+    if(prefix_size) {
+        while(p < end) {
+            if((size_t)(end - p) < prefix_size) {
+                *errmsg = "Truncated length prefix at the end";
+                message_corpus_free(corpus);
+                return NULL;
+            }
+            uint64_t length = frame_length(p, prefix_size, little_endian);
+            if(length > (uint64_t)(end - p) - prefix_size) {
+                *errmsg = "Truncated frame at the end";
+                message_corpus_free(corpus);
+                return NULL;
+            }
+            corpus_add(corpus, &offsets_size, p, prefix_size + length);
+            p += prefix_size + length;
+        }
+    } else {
+        while(p < end) {
+            const uint8_t *eol = memchr(p, '\n', end - p);
+            size_t line_size = eol ? (size_t)(eol - p) + 1 : (size_t)(end - p);
+            if(line_size == 1 || (line_size == 2 && p[0] == '\r' && eol)) {
+                /* Skip the empty lines. */
+            } else {
+                corpus_add(corpus, &offsets_size, p, line_size);
+                if(!eol) {
+                    ((char *)corpus->data.ptr)[corpus->data.total_size++] =
+                        '\n';
+                    corpus->offsets[corpus->count] = corpus->data.total_size;
+                }
+            }
+            p += line_size;
+        }
+    }
+
+    if(corpus->count == 0) {
+        *errmsg = "No messages found";
+        message_corpus_free(corpus);
+        return NULL;
+    }
+
+    ((char *)corpus->data.ptr)[corpus->data.total_size] = '\0';
+    corpus->data.single_message_size =
+        (corpus->data.total_size + corpus->count - 1) / corpus->count;
+    return corpus;
+}
+
+void
+message_corpus_shuffle(struct message_corpus *corpus) {
+    size_t *order = malloc(corpus->count * sizeof(order[0]));
+    assert(order);
+    for(size_t i = 0; i < corpus->count; i++) order[i] = i;
+    for(size_t i = corpus->count - 1; i > 0; i--) {
+        uint64_t r = ((uint64_t)random() << 31) | (uint64_t)random();
+        size_t j = r % (i + 1);
+        size_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+
+    char *from = corpus->data.ptr;
+    size_t *from_offsets = corpus->offsets;
+    char *to = malloc(corpus->data.allocated_size + 1);
+    size_t *to_offsets = malloc((corpus->count + 1) * sizeof(to_offsets[0]));
+    assert(to && to_offsets);
+    size_t off = 0;
+    for(size_t i = 0; i < corpus->count; i++) {
+        size_t n = order[i];
+        size_t size = from_offsets[n + 1] - from_offsets[n];
+        to_offsets[i] = off;
+        memcpy(to + off, from + from_offsets[n], size);
+        off += size;
+    }
+    assert(off == corpus->data.total_size);
+    to_offsets[corpus->count] = off;
+    to[off] = '\0';
+
+    free(from);
+    free(from_offsets);
+    free(order);
+    corpus->data.ptr = to;
+    corpus->offsets = to_offsets;
+}
+
+struct message_corpus *
+message_corpus_load(const char *filename, unsigned prefix_size,
+                    int little_endian, int shuffle) {
+    int fd = open(filename, O_RDONLY);
+    if(fd == -1) {
+        fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if(fstat(fd, &st) == -1) {
+        fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    const char *errmsg = "No messages found";
+    struct message_corpus *corpus = NULL;
+    if(st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map == MAP_FAILED) {
+            fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+            close(fd);
+            return NULL;
+        }
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        corpus = message_corpus_parse(map, st.st_size, prefix_size,
+                                      little_endian, &errmsg);
+        munmap(map, st.st_size);
+    }
+    close(fd);
+
+    if(!corpus) {
+        fprintf(stderr, "%s: %s\n", filename, errmsg);
+        return NULL;
+    }
+    if(shuffle) message_corpus_shuffle(corpus);
+    return corpus;
+}
+
+void
+message_corpus_free(struct message_corpus *corpus) {
+    if(!corpus) return;
+    free(corpus->data.ptr);
+    free(corpus->offsets);
+    free(corpus);
+}
+
+#ifdef TCPKALI_CORPUS_UNIT_TEST
+
+static void
+check_message(const struct message_corpus *corpus, size_t n,
+              const char *expected) {
+    size_t size = corpus->offsets[n + 1] - corpus->offsets[n];
+    assert(size == strlen(expected));
+    assert(memcmp((char *)corpus->data.ptr + corpus->offsets[n], expected,
+                  size)
+           == 0);
+}
+
+int
+main() {
+    const char *errmsg = NULL;
+
+    /* The lines are the messages, the empty lines are skipped. */
+    const char lines[] = "GET /a\n\nGET /b\r\n\r\nGET /c";
+    struct message_corpus *corpus =
+        message_corpus_parse(lines, sizeof(lines) - 1, 0, 0, &errmsg);
+    assert(corpus);
+    assert(corpus->count == 3);
+    check_message(corpus, 0, "GET /a\n");
+    check_message(corpus, 1, "GET /b\r\n");
+    check_message(corpus, 2, "GET /c\n");
+    assert(corpus->data.total_size == 22);
+    assert(corpus->data.once_size == 0);
+    assert(corpus->data.single_message_size == 8);
+
+    /* The shuffled messages are all there, back to back. */
+    srandom(1);
+    message_corpus_shuffle(corpus);
+    assert(corpus->count == 3);
+    assert(corpus->offsets[0] == 0);
+    assert(corpus->offsets[3] == 22);
+    int seen = 0;
+    for(size_t i = 0; i < corpus->count; i++) {
+        const char *msg = (char *)corpus->data.ptr + corpus->offsets[i];
+        seen |= 1 << (msg[5] - 'a');
+    }
+    assert(seen == 7);
+    message_corpus_free(corpus);
+
+    /* The frames keep their length prefixes. */
+    const char frames[] = "\0\3abc\0\0\0\1x";
+    corpus = message_corpus_parse(frames, sizeof(frames) - 1 - 1, 2, 0,
+                                  &errmsg);
+    assert(!corpus);
+    corpus = message_corpus_parse(frames, sizeof(frames) - 1, 2, 0, &errmsg);
+    assert(corpus);
+    assert(corpus->count == 3);
+    assert(corpus->offsets[1] == 5);
+    assert(corpus->offsets[2] == 7);
+    assert(corpus->offsets[3] == 10);
+    message_corpus_free(corpus);
+
+    const char le_frames[] = "\2\0\0\0ab";
+    corpus = message_corpus_parse(le_frames, sizeof(le_frames) - 1, 4, 1,
+                                  &errmsg);
+    assert(corpus);
+    assert(corpus->count == 1);
+    message_corpus_free(corpus);
+
+    assert(!message_corpus_parse("\n\r\n", 3, 0, 0, &errmsg));
+    assert(strcmp(errmsg, "No messages found") == 0);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_CORPUS_UNIT_TEST */
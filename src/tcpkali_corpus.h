@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_CORPUS_H
+#define TCPKALI_CORPUS_H
+
+#include <stddef.h>
+
+#include "tcpkali_transport.h"
+
+/*
+ * Many different messages read from a file, see --message-corpus.
+ *
+ * The messages are either the lines of a text file, or the
+ * length-prefixed frames as with --framing lenprefix. They are stored
+ * back to back in a single buffer, which is shared by all connections.
+ * Each connection starts at a different message and walks through the
+ * corpus sequentially, wrapping around at the end.
+ */
+
+struct message_corpus {
+    /*
+     * The messages are repeated (once_size == 0).
+     * The (ptr) is shared by all the connections sending the corpus.
+     */
+    struct transport_data_spec data;
+    /*
+     * The start of each message in (data.ptr), followed by
+     * the end of the last one: (count + 1) entries.
+     */
+    size_t *offsets;
+    size_t count;
+};
+
+/*
+ * Read the corpus file. With non-zero (prefix_size) the file consists
+ * of the length-prefixed frames, otherwise of the lines; the empty lines
+ * are skipped. With (shuffle), the messages are stored in random order.
+ * Returns NULL and complains on stderr if the file can't be read.
+ */
+struct message_corpus *message_corpus_load(const char *filename,
+                                           unsigned prefix_size,
+                                           int little_endian, int shuffle);
+
+/*
+ * Split the data in memory into the messages.
+ * Returns NULL and sets (*errmsg) if the data can't be parsed.
+ */
+struct message_corpus *message_corpus_parse(const void *data, size_t size,
+                                            unsigned prefix_size,
+                                            int little_endian,
+                                            const char **errmsg);
+
+/*
+ * Reorder the messages randomly, using random(3).
+ */
+void message_corpus_shuffle(struct message_corpus *);
+
+void message_corpus_free(struct message_corpus *);
+
+#endif /* TCPKALI_CORPUS_H */
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "tcpkali_cpucost.h"
+
+double
+cpu_thread_seconds() {
+#ifdef RUSAGE_THREAD
+    struct rusage ru;
+    if(getrusage(RUSAGE_THREAD, &ru) == 0) {
+        return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec
+               + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000000.0;
+    }
+#endif
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#endif
+    return 0.0;
+}
+
+#ifdef __linux__
+/*
+ * A counter of the calling thread, on whichever CPU it runs,
+ * of the user space and the kernel, if allowed to.
+ */
+static int
+perf_counter_open(uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if(fd == -1 && (errno == EACCES || errno == EPERM)) {
+        /* kernel.perf_event_paranoid allows the user space only. */
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    return fd;
+}
+#endif
+
+int
+cpu_counters_open(struct cpu_counters *cc) {
+    cc->cycles_fd = -1;
+    cc->instructions_fd = -1;
+#ifdef __linux__
+    cc->cycles_fd = perf_counter_open(PERF_COUNT_HW_CPU_CYCLES);
+    if(cc->cycles_fd == -1) return -1;
+    cc->instructions_fd = perf_counter_open(PERF_COUNT_HW_INSTRUCTIONS);
+    return 0;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+static uint64_t
+perf_counter_read(int fd) {
+    uint64_t value = 0;
+    if(fd == -1 || read(fd, &value, sizeof(value)) != sizeof(value))
+        return 0;
+    return value;
+}
+
+void
+cpu_counters_read(const struct cpu_counters *cc, uint64_t *cycles,
+                  uint64_t *instructions) {
+    *cycles = perf_counter_read(cc->cycles_fd);
+    *instructions = perf_counter_read(cc->instructions_fd);
+}
+
+void
+cpu_counters_close(struct cpu_counters *cc) {
+    if(cc->cycles_fd != -1) close(cc->cycles_fd);
+    if(cc->instructions_fd != -1) close(cc->instructions_fd);
+    cc->cycles_fd = -1;
+    cc->instructions_fd = -1;
+}
+
+#ifdef TCPKALI_CPUCOST_UNIT_TEST
+
+static volatile uint64_t sink;
+
+int
+main() {
+    double started = cpu_thread_seconds();
+    assert(started >= 0.0);
+
+    struct cpu_counters cc;
+    int have_counters = cpu_counters_open(&cc) == 0;
+    if(!have_counters) {
+        assert(cc.cycles_fd == -1 && cc.instructions_fd == -1);
+        fprintf(stderr, "No CPU counters: %s\n", strerror(errno));
+    }
+
+    /* Spin for a while, the CPU time should accrue. */
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    do {
+        for(int i = 0; i < 100000; i++) sink += i;
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+    } while((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9 < 0.2);
+
+    double spent = cpu_thread_seconds() - started;
+    assert(spent > 0.05 && spent < 10.0);
+
+    uint64_t cycles, instructions;
+    cpu_counters_read(&cc, &cycles, &instructions);
+    if(have_counters) assert(cycles > 0);
+    else assert(cycles == 0 && instructions == 0);
+    cpu_counters_close(&cc);
+    assert(cc.cycles_fd == -1);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_CPUCOST_UNIT_TEST */
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_CPUCOST_H
+#define TCPKALI_CPUCOST_H
+
+#include <stdint.h>
+
+/*
+ * The CPU cost of a worker thread, see --cpu-cost.
+ */
+
+/*
+ * The user and system CPU time the calling thread has taken, in seconds,
+ * by getrusage(RUSAGE_THREAD).
+ */
+double cpu_thread_seconds(void);
+
+/*
+ * The cycles and instructions hardware counters of the calling thread,
+ * by perf_event_open(2). Once opened, they could be read by any thread.
+ */
+struct cpu_counters {
+    int cycles_fd;
+    int instructions_fd; /* -1 if the instructions are not counted */
+};
+
+/*
+ * Open the counters for the calling thread.
+ * Returns -1 with errno set if the cycles could not be counted,
+ * such as in a virtual machine or with kernel.perf_event_paranoid > 2.
+ */
+int cpu_counters_open(struct cpu_counters *);
+void cpu_counters_read(const struct cpu_counters *, uint64_t *cycles,
+                       uint64_t *instructions);
+void cpu_counters_close(struct cpu_counters *);
+
+#endif /* TCPKALI_CPUCOST_H */
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tcpkali_common.h"
+#include "tcpkali_terminfo.h"
+#include "tcpkali_dashboard.h"
+
+struct dashboard {
+    struct engine *eng;
+    double refresh_interval;
+    double last_refresh;
+    int n_workers; /* Allocated, see engine_workers_max() */
+    struct dashboard_worker {
+        non_atomic_traffic_stats traffic;  /* As of the last refresh */
+        struct latency_snapshot *latency; /* Likewise, or NULL */
+    } * workers;
+};
+
+struct dashboard *
+dashboard_new(struct engine *eng, double refresh_interval) {
+    struct dashboard *db = calloc(1, sizeof(*db));
+    assert(db);
+    db->eng = eng;
+    db->refresh_interval = refresh_interval;
+    /* The workers might be added later, see engine_set_workers(). */
+    db->n_workers = engine_workers_max(eng);
+    db->workers =
+        calloc(db->n_workers ? db->n_workers : 1, sizeof(db->workers[0]));
+    assert(db->workers);
+    return db;
+}
+
+void
+dashboard_free(struct dashboard *db) {
+    if(!db) return;
+    tcpkali_leave_fullscreen();
+    for(int n = 0; n < db->n_workers; n++) {
+        if(db->workers[n].latency)
+            engine_free_latency_snapshot(db->workers[n].latency);
+    }
+    free(db->workers);
+    free(db);
+}
+
+/*
+ * The histogram shown: the message latency, if measured,
+ * or the first of the connection-level ones.
+ */
+static struct hdr_histogram *
+shown_histogram(const struct latency_snapshot *latency, const char **name) {
+    struct {
+        struct hdr_histogram *hist;
+        const char *name;
+    } kinds[] = {{latency->marker_histogram, "message"},
+                 {latency->firstbyte_histogram, "first byte"},
+                 {latency->connect_histogram, "connect"},
+                 {latency->handshake_histogram, "handshake"},
+                 {latency->upgrade_histogram, "upgrade"}};
+    for(size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        if(kinds[i].hist) {
+            if(name) *name = kinds[i].name;
+            return kinds[i].hist;
+        }
+    }
+    return NULL;
+}
+
+static void
+format_percentile(char *buf, size_t size, struct hdr_histogram *hist,
+                  double percentile) {
+    if(hist && hist->total_count) {
+        snprintf(buf, size, "%.*f", latency_ms_precision(),
+                 latency_to_ms(hdr_value_at_percentile(hist, percentile)));
+    } else {
+        snprintf(buf, size, "-");
+    }
+}
+
+#define DASHBOARD_ROW_FORMAT "%-6s %8s %10s %10s %5s %7s %7s %8s %8s"
+
+void
+dashboard_update(struct dashboard *db, double now) {
+    if(now - db->last_refresh < db->refresh_interval) return;
+    double elapsed = db->last_refresh ? now - db->last_refresh : 0;
+    db->last_refresh = now;
+
+    tcpkali_enter_fullscreen();
+
+    /* The retired workers are not shown, see engine_set_workers(). */
+    int n_workers = engine_running_workers(db->eng);
+    if(n_workers > db->n_workers) n_workers = db->n_workers;
+
+    /* The header, column titles and totals take five lines. */
+    int rows = tcpkali_terminal_height() - 5;
+    if(rows < 1) rows = 1;
+
+    const char *latency_name = NULL;
+    struct latency_snapshot *probe = NULL;
+    if(n_workers) {
+        probe = engine_collect_worker_latency_snapshot(db->eng, 0);
+        shown_histogram(probe, &latency_name);
+    }
+
+    char header[256];
+    snprintf(header, sizeof(header),
+             "%d worker%s, refreshed every %gs%s%s%s", n_workers,
+             n_workers == 1 ? "" : "s", db->refresh_interval,
+             latency_name ? ", " : "", latency_name ? latency_name : "",
+             latency_name ? " latency over the last interval" : "");
+
+    fprintf(stderr, "%s%s%s\n%s\n", tcpkali_cursor_home(), header,
+            tcpkali_clear_eol(), tcpkali_clear_eol());
+    fprintf(stderr, "%s" DASHBOARD_ROW_FORMAT "%s%s\n", tk_attr(TKA_HIGHLIGHT),
+            "Worker", "Conns", "Msgs/s in", "Msgs/s out", "Busy", "Lag ms",
+            "Debt ms", "p50 ms", "p99 ms", tk_attr(TKA_NORMAL),
+            tcpkali_clear_eol());
+
+    size_t total_conns = 0;
+    double total_in = 0;
+    double total_out = 0;
+    int saturated = 0;
+
+    for(int n = 0; n < n_workers; n++) {
+        struct dashboard_worker *w = &db->workers[n];
+
+        size_t connecting, incoming, outgoing;
+        engine_get_worker_connection_stats(db->eng, n, &connecting, &incoming,
+                                           &outgoing);
+        struct engine_loop_stats loop;
+        engine_worker_loop_stats(db->eng, n, &loop);
+
+        non_atomic_traffic_stats traffic = engine_worker_traffic(db->eng, n);
+        non_atomic_traffic_stats delta =
+            subtract_traffic_stats(traffic, w->traffic);
+        w->traffic = traffic;
+        double msgs_in = elapsed > 0 ? delta.msgs_rcvd / elapsed : 0;
+        double msgs_out = elapsed > 0 ? delta.msgs_sent / elapsed : 0;
+
+        struct latency_snapshot *latency =
+            n ? engine_collect_worker_latency_snapshot(db->eng, n) : probe;
+        struct latency_snapshot *interval =
+            w->latency ? engine_diff_latency_snapshot(w->latency, latency)
+                       : NULL;
+        if(w->latency) engine_free_latency_snapshot(w->latency);
+        w->latency = latency;
+
+        total_conns += incoming + outgoing;
+        total_in += msgs_in;
+        total_out += msgs_out;
+        if(loop.saturated) saturated++;
+        if(n >= rows) {
+            if(interval) engine_free_latency_snapshot(interval);
+            continue;
+        }
+
+        char name[16], conns[32], in[32], out[32], busy[16], lag[16],
+            debt[16], p50[32], p99[32];
+        struct hdr_histogram *hist =
+            interval ? shown_histogram(interval, NULL) : NULL;
+        snprintf(name, sizeof(name), "%d", n);
+        snprintf(conns, sizeof(conns), "%zu", incoming + outgoing);
+        snprintf(in, sizeof(in), "%.0f", msgs_in);
+        snprintf(out, sizeof(out), "%.0f", msgs_out);
+        snprintf(busy, sizeof(busy), "%.0f%%", 100 * loop.busy);
+        snprintf(lag, sizeof(lag), "%.1f", 1000 * loop.lag);
+        snprintf(debt, sizeof(debt), "%.1f", 1000 * loop.pacing_debt);
+        format_percentile(p50, sizeof(p50), hist, 50.0);
+        format_percentile(p99, sizeof(p99), hist, 99.0);
+        if(interval) engine_free_latency_snapshot(interval);
+
+        fprintf(stderr, "%s" DASHBOARD_ROW_FORMAT "%s%s\n",
+                loop.saturated ? tk_attr(TKA_WARNING) : "", name, conns, in,
+                out, busy, lag, debt, p50, p99,
+                loop.saturated ? tk_attr(TKA_NORMAL) : "", tcpkali_clear_eol());
+    }
+
+    if(n_workers > rows) {
+        fprintf(stderr, "... %d more worker%s%s\n", n_workers - rows,
+                n_workers - rows == 1 ? "" : "s", tcpkali_clear_eol());
+    }
+    char conns[32], in[32], out[32], sat[32];
+    snprintf(conns, sizeof(conns), "%zu", total_conns);
+    snprintf(in, sizeof(in), "%.0f", total_in);
+    snprintf(out, sizeof(out), "%.0f", total_out);
+    snprintf(sat, sizeof(sat), "%d saturated", saturated);
+    fprintf(stderr, "%s%-6s %8s %10s %10s  %s%s%s", tk_attr(TKA_HIGHLIGHT),
+            "Total", conns, in, out, saturated ? sat : "", tk_attr(TKA_NORMAL),
+            tcpkali_clear_eos());
+}
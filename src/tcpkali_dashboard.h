@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_DASHBOARD_H
+#define TCPKALI_DASHBOARD_H
+
+#include "tcpkali_engine.h"
+
+/*
+ * The full-screen --dashboard: a row per worker with its connections,
+ * message rates, event loop saturation and latencies over the last
+ * refresh interval, for telling which worker holds the test back.
+ */
+struct dashboard;
+
+struct dashboard *dashboard_new(struct engine *, double refresh_interval);
+
+/*
+ * Redraw the screen if (refresh_interval) has passed since the last time.
+ * The first call switches the terminal into the full-screen mode.
+ */
+void dashboard_update(struct dashboard *, double now);
+
+/*
+ * Restore the terminal and release the dashboard.
+ */
+void dashboard_free(struct dashboard *);
+
+#endif /* TCPKALI_DASHBOARD_H */
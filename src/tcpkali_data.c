@@ -30,6 +30,10 @@
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "tcpkali_terminfo.h"
 #include "tcpkali_data.h"
@@ -227,3 +231,30 @@ read_in_file(const char *filename, char **data, size_t *size) {
 
     return 0;
 }
+
+int
+map_in_file(const char *filename, char **data, size_t *size, int *fdp) {
+    int fd = open(filename, O_RDONLY);
+    if(fd == -1) return -1;
+
+    struct stat st;
+    if(fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE; /* Avoid page faults on the sending path */
+#endif
+    void *p = mmap(NULL, st.st_size, PROT_READ, flags, fd, 0);
+    if(p == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    *data = p;
+    *size = st.st_size;
+    *fdp = fd;
+    return 0;
+}
@@ -60,4 +60,15 @@ void unescape_data(void *data, size_t *initial_data_size);
  */
 int read_in_file(const char *filename, char **data, size_t *size);
 
+/*
+ * Map the specified file contents read-only, prefaulting the pages.
+ * The mapping is released with munmap(2), the (*fd) is left open.
+ *
+ * RETURN VALUES:
+ *   0: file was mapped,
+ *  -1: file can not be mapped (e.g. empty or not a regular file),
+ *      read_in_file() is expected to be used instead.
+ */
+int map_in_file(const char *filename, char **data, size_t *size, int *fd);
+
 #endif /* TCPKALI_DATA_H */
@@ -37,12 +37,18 @@
 #include <netdb.h>  /* gethostbyname(3) */
 #include <libgen.h> /* basename(3) */
 #include <err.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 #include <assert.h>
 
 #include "tcpkali.h"
+#include "tcpkali_dns.h"
+#include "tcpkali_atomic.h"
+#include "tcpkali_logging.h"
 
 /*
- * Convert the given host:port strings into a sequence of all
+ * Convert the given host:port (or unix:/path) strings into a sequence of all
  * socket addresses corresponding to the ip:port combinations.
  * Note: the number of socket addresses can be greater or less than
  * the number of host:port pairs specified due to aliasing (several
@@ -57,6 +63,13 @@ resolve_remote_addresses(char **hostports, int nhostports) {
 
     for(int n = 0; n < nhostports; n++) {
         struct addrinfo *res = 0;
+        struct sockaddr_storage ss;
+
+        /* The unix:/path targets are not resolved. */
+        if(address_parse_unix(hostports[n], &ss) == 0) {
+            address_add(&addresses, (struct sockaddr *)&ss);
+            continue;
+        }
 
         resolve_address(hostports[n], &res);
 
@@ -71,17 +84,20 @@ resolve_remote_addresses(char **hostports, int nhostports) {
     return addresses;
 }
 
-void
-resolve_address(char *address, struct addrinfo **res) {
+/*
+ * Resolve the host:port[/path] string, returning the getaddrinfo(3) error.
+ */
+static int
+lookup_address(const char *address, struct addrinfo **res) {
     char *hostport = strdup(address);
+    assert(hostport);
     char *host = hostport;
     char *service_string = strchr(hostport, ':');
-    if(service_string) {
-        *service_string++ = '\0';
-    } else {
-        fprintf(stderr, "Expected :port specification. See --help.\n");
-        exit(EX_USAGE);
+    if(!service_string) {
+        free(hostport);
+        return EAI_SERVICE;
     }
+    *service_string++ = '\0';
 
     char *path = strchr(service_string, '/');
     if(path) *path++ = '\0';
@@ -93,11 +109,200 @@ resolve_address(char *address, struct addrinfo **res) {
         .ai_flags = AI_ADDRCONFIG, /* Do not return unroutable IPs */
     };
     int error = getaddrinfo(host, service_string, &hints, res);
+
+    free(hostport);
+    return error;
+}
+
+void
+resolve_address(char *address, struct addrinfo **res) {
+    if(!strchr(address, ':')) {
+        fprintf(stderr, "Expected :port specification. See --help.\n");
+        exit(EX_USAGE);
+    }
+
+    int error = lookup_address(address, res);
     if(error) {
-        errx(EX_NOHOST, "Resolving %s:%s: %s", host, service_string,
-             gai_strerror(error));
+        errx(EX_NOHOST, "Resolving %s: %s", address, gai_strerror(error));
     }
+}
 
-    free(hostport);
+struct dns_refresh {
+    char **hostports;
+    int n_hostports;
+    double interval;
+    enum verbosity_level verbosity_level;
+    struct sockaddr_storage *addrs; /* DNS_REFRESH_MAX_ADDRS entries */
+    atomic_narrow_t n_addrs;        /* Entries published to the workers */
+    atomic_narrow_t retired[DNS_REFRESH_MAX_ADDRS];
+    int table_full_reported;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    int terminate;
+};
+
+/*
+ * Resolve all of the destinations anew. Returns -1 if any of them
+ * failed to resolve, so that a transient DNS failure retires nothing.
+ */
+static int
+dns_refresh_resolve(struct dns_refresh *dns, struct addresses *fresh) {
+    for(int n = 0; n < dns->n_hostports; n++) {
+        struct sockaddr_storage ss;
+        if(address_parse_unix(dns->hostports[n], &ss) == 0) {
+            address_add(fresh, (struct sockaddr *)&ss);
+            continue;
+        }
+
+        struct addrinfo *res = 0;
+        int error = lookup_address(dns->hostports[n], &res);
+        if(error) {
+            debug_log(DBG_WARNING, dns->verbosity_level,
+                      "DNS refresh of %s failed: %s\n", dns->hostports[n],
+                      gai_strerror(error));
+            return -1;
+        }
+        for(struct addrinfo *tmp = res; tmp; tmp = tmp->ai_next) {
+            address_add(fresh, tmp->ai_addr);
+        }
+        freeaddrinfo(res);
+    }
+
+    return 0;
+}
+
+/*
+ * Append the new addresses to the table, then retire the ones
+ * which are no longer resolved and restore the ones which are back.
+ */
+static void
+dns_refresh_update(struct dns_refresh *dns, struct addresses *fresh) {
+    char buf[INET6_ADDRSTRLEN + 64];
+    size_t n_addrs = atomic_get(&dns->n_addrs);
+    struct addresses table = {dns->addrs, n_addrs};
+
+    for(size_t i = 0; i < fresh->n_addrs; i++) {
+        struct sockaddr *sa = (struct sockaddr *)&fresh->addrs[i];
+        if(address_is_member(&table, sa)) continue;
+        if(n_addrs == DNS_REFRESH_MAX_ADDRS) {
+            if(!dns->table_full_reported++)
+                warning("DNS refresh: more than %d destinations, "
+                        "ignoring the rest\n",
+                        DNS_REFRESH_MAX_ADDRS);
+            break;
+        }
+        dns->addrs[n_addrs] = fresh->addrs[i];
+        /* The address is written out before it is counted in. */
+        atomic_increment(&dns->n_addrs);
+        table.n_addrs = ++n_addrs;
+        debug_log(DBG_NORMAL, dns->verbosity_level,
+                  "DNS refresh: new destination %s\n",
+                  format_sockaddr(&fresh->addrs[i], buf, sizeof(buf)));
+    }
+
+    /* Do not retire everything if the new ones did not fit. */
+    size_t active = 0;
+    for(size_t i = 0; i < n_addrs; i++) {
+        if(address_is_member(fresh, (struct sockaddr *)&dns->addrs[i]))
+            active++;
+    }
+    if(active == 0) return;
+
+    for(size_t i = 0; i < n_addrs; i++) {
+        int retire =
+            !address_is_member(fresh, (struct sockaddr *)&dns->addrs[i]);
+        if((int)atomic_exchange(&dns->retired[i], retire) != retire) {
+            debug_log(DBG_NORMAL, dns->verbosity_level,
+                      "DNS refresh: %s destination %s\n",
+                      retire ? "retired" : "restored",
+                      format_sockaddr(&dns->addrs[i], buf, sizeof(buf)));
+        }
+    }
+}
+
+static void *
+dns_refresh_thread(void *arg) {
+    struct dns_refresh *dns = arg;
+
+    pthread_mutex_lock(&dns->lock);
+    while(!dns->terminate) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        double at = deadline.tv_sec + deadline.tv_nsec / 1e9 + dns->interval;
+        deadline.tv_sec = (time_t)at;
+        deadline.tv_nsec = (long)((at - (time_t)at) * 1e9);
+        while(!dns->terminate
+              && pthread_cond_timedwait(&dns->wakeup, &dns->lock, &deadline)
+                     != ETIMEDOUT)
+            ;
+        if(dns->terminate) break;
+        pthread_mutex_unlock(&dns->lock);
+
+        struct addresses fresh = {0, 0};
+        if(dns_refresh_resolve(dns, &fresh) == 0 && fresh.n_addrs)
+            dns_refresh_update(dns, &fresh);
+        free(fresh.addrs);
+
+        pthread_mutex_lock(&dns->lock);
+    }
+    pthread_mutex_unlock(&dns->lock);
+
+    return NULL;
+}
+
+struct dns_refresh *
+dns_refresh_start(char **hostports, int n, struct addresses *addresses,
+                  double interval, enum verbosity_level verbosity_level) {
+    struct dns_refresh *dns = calloc(1, sizeof(*dns));
+    assert(dns);
+    dns->hostports = hostports;
+    dns->n_hostports = n;
+    dns->interval = interval;
+    dns->verbosity_level = verbosity_level;
+    dns->addrs = calloc(DNS_REFRESH_MAX_ADDRS, sizeof(dns->addrs[0]));
+    assert(dns->addrs);
+
+    /* The initial addresses open the table. */
+    size_t count = addresses->n_addrs < DNS_REFRESH_MAX_ADDRS
+                       ? addresses->n_addrs
+                       : DNS_REFRESH_MAX_ADDRS;
+    memcpy(dns->addrs, addresses->addrs, count * sizeof(dns->addrs[0]));
+    atomic_add_and_get(&dns->n_addrs, count);
+    free(addresses->addrs);
+    addresses->addrs = dns->addrs;
+    addresses->n_addrs = count;
+
+    pthread_mutex_init(&dns->lock, NULL);
+    pthread_cond_init(&dns->wakeup, NULL);
+    int rc = pthread_create(&dns->thread, NULL, dns_refresh_thread, dns);
+    assert(rc == 0);
+
+    return dns;
+}
+
+void
+dns_refresh_stop(struct dns_refresh *dns) {
+    if(!dns) return;
+    pthread_mutex_lock(&dns->lock);
+    dns->terminate = 1;
+    pthread_cond_signal(&dns->wakeup);
+    pthread_mutex_unlock(&dns->lock);
+    pthread_join(dns->thread, NULL);
+    pthread_cond_destroy(&dns->wakeup);
+    pthread_mutex_destroy(&dns->lock);
+    /* The (addrs) stay with the engine parameters. */
+    free(dns);
+}
+
+size_t
+dns_refresh_count(const struct dns_refresh *dns) {
+    return atomic_get(&dns->n_addrs);
+}
+
+int
+dns_refresh_retired(const struct dns_refresh *dns, size_t index) {
+    return index < DNS_REFRESH_MAX_ADDRS && atomic_get(&dns->retired[index]);
 }
 
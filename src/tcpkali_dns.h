@@ -30,6 +30,7 @@
 #include <stdio.h>
 #include <netdb.h>  /* addrinfo */
 #include "tcpkali_iface.h"
+#include "tcpkali_logging.h"
 
 /*
  * Given a sequence of host:port strings, return all of the resolved IP
@@ -39,4 +40,33 @@ struct addresses resolve_remote_addresses(char **hostports, int n);
 
 void resolve_address(char *address, struct addrinfo **res);
 
+/*
+ * The --dns-refresh destinations, re-resolved on a background thread.
+ * The addresses are only ever appended to the table, so the indexes into it
+ * (the connections' remote_index, the per-remote statistics) remain valid.
+ * The addresses no longer returned by DNS are retired instead of removed.
+ */
+#define DNS_REFRESH_MAX_ADDRS 256
+struct dns_refresh;
+
+/*
+ * Start re-resolving the (hostports) every (interval) seconds.
+ * The resolved (addresses) are moved into the table, and point into it.
+ */
+struct dns_refresh *dns_refresh_start(char **hostports, int n,
+                                      struct addresses *addresses,
+                                      double interval,
+                                      enum verbosity_level);
+void dns_refresh_stop(struct dns_refresh *);
+
+/*
+ * The number of addresses published in the table so far.
+ */
+size_t dns_refresh_count(const struct dns_refresh *);
+
+/*
+ * Returns non-zero if the address at the (index) is no longer resolved.
+ */
+int dns_refresh_retired(const struct dns_refresh *, size_t index);
+
 #endif /* TCPKALI_DNS_H */
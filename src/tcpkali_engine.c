@@ -26,6 +26,7 @@
  */
 #define _GNU_SOURCE
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
@@ -34,20 +35,102 @@
 #include <netinet/tcp.h> /* for TCP_NODELAY */
 #include <unistd.h>
 #include <stddef.h> /* offsetof(3) */
+#include <signal.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 #include <pthread.h>
 #include <assert.h>
 #include <sys/queue.h>
 #include <sysexits.h>
 #include <math.h>
 #include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <endian.h>
 
 #include <config.h>
 
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define TCPKALI_ZEROCOPY 1
+/* Below this size page pinning is more expensive than copying. */
+#define ZEROCOPY_MIN_WRITE_SIZE 10240
+#endif
+
+#if defined(TCP_INFO) && defined(__linux__)
+#define TCPKALI_TCP_INFO 1
+/* Connections sampled by a worker every stats_timer_cb() run. */
+#define TCP_INFO_SAMPLES_PER_TICK 16
+#endif
+
+#if defined(HAVE_LINUX_MPTCP_H) && defined(TCPKALI_TCP_INFO)
+#include <linux/mptcp.h>
+#define TCPKALI_MPTCP 1 /* --mptcp */
+#ifndef IPPROTO_MPTCP
+#define IPPROTO_MPTCP 262
+#endif
+#ifndef SOL_MPTCP
+#define SOL_MPTCP 284
+#endif
+/* Subflows of a connection sampled for their delivery rate. */
+#define MPTCP_SUBFLOWS_SAMPLED 8
+/*
+ * The struct tcp_info of <netinet/tcp.h> stops short of the delivery
+ * rate. The kernel only ever appends to its structure, so the fields
+ * up to tcpi_delivery_rate follow in the same order.
+ */
+struct mptcp_subflow_tcp_info {
+    struct tcp_info ti;
+    uint64_t pacing_rate;
+    uint64_t max_pacing_rate;
+    uint64_t bytes_acked;
+    uint64_t bytes_received;
+    uint32_t segs_out;
+    uint32_t segs_in;
+    uint32_t notsent_bytes;
+    uint32_t min_rtt;
+    uint32_t data_segs_in;
+    uint32_t data_segs_out;
+    uint64_t delivery_rate; /* Bytes per second */
+};
+#endif
+
+#if defined(__linux__) && defined(SPLICE_F_NONBLOCK)
+#define TCPKALI_SPLICE 1 /* --listen-mode=echo */
+#endif
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#define TCPKALI_SENDFILE 1 /* --sendfile */
+#define TCPKALI_UDP 1      /* --udp, with sendmmsg(2) and recvmmsg(2) */
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#ifdef SIOCOUTQNSD
+#define TCPKALI_WRCOMB_ADAPTIVE 1 /* --write-combine adaptive */
+#endif
+#endif
+
+#if defined(SO_TIMESTAMPING) && defined(__linux__)
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#define TCPKALI_TIMESTAMPING 1
+#endif
+
+#if defined(TCP_ZEROCOPY_RECEIVE) && defined(__linux__)
+#include <sys/mman.h>
+#define TCPKALI_ZEROCOPY_RECEIVE 1 /* --zerocopy-receive */
+#endif
+
 #ifdef HAVE_SCHED_H
 #include <sched.h>
 #endif
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(__linux__)
+#include <linux/filter.h>
+#endif
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 
 #include <StreamBoyerMooreHorspool.h>
 #include <hdr_histogram.h>
@@ -55,10 +138,21 @@
 
 #include "tcpkali.h"
 #include "tcpkali_ring.h"
+#include "tcpkali_clock.h"
+#include "tcpkali_scan.h"
+#include "tcpkali_multiscan.h"
+#include "tcpkali_pool.h"
+#include "tcpkali_wheel.h"
+#include "tcpkali_pregen.h"
 #include "tcpkali_atomic.h"
+#include "tcpkali_affinity.h"
 #include "tcpkali_events.h"
 #include "tcpkali_pacefier.h"
+#include "tcpkali_mavg.h"
+#include "tcpkali_budget.h"
 #include "tcpkali_websocket.h"
+#include "tcpkali_verify.h"
+#include "tcpkali_probes.h"
 #include "tcpkali_terminfo.h"
 #include "tcpkali_logging.h"
 #include "tcpkali_expr.h"
@@ -66,6 +160,12 @@
 #include "tcpkali_traffic_stats.h"
 #include "tcpkali_connection.h"
 #include "tcpkali_ssl.h"
+#include "tcpkali_record.h"
+#include "tcpkali_connstats.h"
+#include "tcpkali_closer.h"
+#include "tcpkali_hugepage.h"
+#include "tcpkali_logpipe.h"
+#include "tcpkali_cpucost.h"
 
 #ifndef TAILQ_FOREACH_SAFE
 #define TAILQ_FOREACH_SAFE(var, head, field, tvar) \
@@ -73,6 +173,111 @@
         (var) && ((tvar) = TAILQ_NEXT((var), field), 1); (var) = (tvar))
 #endif
 
+/* The weight of the newest sample in the --remote-select least-latency. */
+#define REMOTE_HEALTH_DECAY 0.1
+
+/* How soon to look for a free slot under the host:port@max= quota, s. */
+#define REMOTE_QUOTA_RETRY 0.05
+
+/* The most unconnected sockets a worker keeps per family. */
+#define SOCKET_POOL_SIZE 64
+
+/* The connection uids a worker leases at once. */
+#define CONNECTION_UID_LEASE 64
+
+/*
+ * --write-combine adaptive: how many writes go by between the looks
+ * at the socket queue, and the largest batch it grows to.
+ */
+#define WRCOMB_CHECK_WRITES 16
+#define WRCOMB_BATCH_MAX (256 * 1024)
+
+/* How often the workers flush the connection stats, see stats_timer_cb(). */
+#define STATS_FLUSH_INTERVAL_MS 42
+
+/*
+ * A worker is saturated when it spends most of its time in the callbacks
+ * or cannot get to its timers on time, see loop_stats_publish().
+ */
+#define LOOP_SATURATED_BUSY 0.9
+#define LOOP_SATURATED_LAG 0.05
+
+/*
+ * --rebalance moves the connections off a worker this busy,
+ * to a worker this much less busy, in batches of at most this many.
+ */
+#define REBALANCE_MIN_BUSY 0.5
+#define REBALANCE_MIN_GAP 0.2
+#define REBALANCE_MAX_CONNECTIONS 1024
+
+/*
+ * --worker-select least-busy takes the busier workers to be this busy,
+ * so they still get a few connections.
+ */
+#define LEAST_BUSY_MAX 0.95
+
+/*
+ * The SetMessage orchestration commands accepted during a test.
+ * The earlier messages are kept, the connections may still use them.
+ */
+#define MESSAGE_SETS_MAX 256
+
+/*
+ * The --latency-by-size message size classes: up to 64 bytes, up to 256
+ * bytes, and so on, each class four times as large as the previous one.
+ * The last class takes all the larger messages.
+ */
+#define MESSAGE_SIZE_CLASSES 8
+#define MESSAGE_SIZE_CLASS_MIN 64
+
+/*
+ * The --message replaced by the SetMessage, see engine_set_message().
+ */
+struct message_set {
+    struct message_collection message_collection;
+    struct transport_data_spec *data_templates[2];
+};
+
+/*
+ * The message rate changes reach the workers through shared memory rather
+ * than the control pipe, see engine_publish_send_rate(). The sequence is
+ * odd while the engine_params.channel_send_rate is being changed, and
+ * tags the rate versions otherwise. The workers and connections pick up
+ * the new version on their own time, see worker_follow_send_rate().
+ */
+struct send_rate_shared {
+    atomic_narrow_t sequence;
+    non_atomic_narrow_t restarted; /* The last version restarting the pace */
+};
+
+/*
+ * The unconnected sockets of a family, made and configured ahead of time
+ * by socket_pool_refill(), so that start_new_connection() mostly connects.
+ */
+struct socket_pool {
+    unsigned count;  /* Sockets in fds[] */
+    unsigned demand; /* Sockets asked for since the last refill */
+    unsigned target; /* How many to keep, as many as the last batch asked */
+    int fds[SOCKET_POOL_SIZE];
+};
+
+/*
+ * The --fanout sequence tracking of a subscriber: the publishers it has
+ * received the binary markers from, looked up linearly from the last one
+ * seen, as there are usually a few publishers per subscriber.
+ */
+struct fanout_sources {
+    size_t delivered; /* The first deliveries of the messages */
+    unsigned count;
+    unsigned size;
+    unsigned last; /* The sources[] entry of the previous marker */
+    struct fanout_source {
+        uint32_t uid;
+        uint32_t next; /* The sequence number expected next */
+        uint64_t seen; /* Bit (n) for the sequence (next - 1 - n) */
+    } sources[];
+};
+
 struct loop_arguments {
     /**************************
      * NON-SHARED WORKER DATA *
@@ -82,72 +287,330 @@ struct loop_arguments {
         address_offset; /* An offset into the params.remote_addresses[] */
 
     tk_timer stats_timer;
-    tk_timer channel_lifetime_timer;
+    tk_timer sample_timer; /* --sample-interval */
+    tk_timer burst_timer;  /* --burst-every */
+    struct tk_wheel timer_wheel; /* Connection timers */
+    tk_timer timer_wheel_timer;  /* Drives the timer_wheel */
+    double timer_wheel_deadline; /* When timer_wheel_timer fires, or 0.0 */
+    struct tk_clock clock;       /* Message marker timestamps */
     int global_control_pipe_rd_nbio; /* Non-blocking pipe anyone could read
                                         from. */
-    int global_feedback_pipe_wr;     /* Blocking pipe for progress reporting. */
     int private_control_pipe_rd; /* Private blocking pipe for this worker (read
                                     side). */
     int private_control_pipe_wr; /* Private blocking pipe for this worker (write
                                     side). */
     int thread_no;
     int dump_connect_fd; /* Which connection to dump */
+    struct loop_arguments *peers; /* All workers, for --rebalance */
+    int n_peers;
+    pthread_mutex_t *workers_lock; /* See engine_set_workers() */
 
     TAILQ_HEAD(, connection) open_conns; /* Thread-local connections */
+    TAILQ_HEAD(, connection) acceptors;  /* Listening sockets */
+    /* The connections which moved data since the last stats flush */
+    TAILQ_HEAD(, connection) dirty_conns;
     unsigned long worker_connections_initiated;
     unsigned long worker_connections_accepted;
     unsigned long worker_connection_failures;
     unsigned long worker_connection_timeouts;
     struct hdr_histogram *connect_histogram_local;   /* --latency-connect */
     struct hdr_histogram *firstbyte_histogram_local; /* --latency-first-byte */
+    struct hdr_histogram *handshake_histogram_local; /* --latency-handshake */
+    struct hdr_histogram *upgrade_histogram_local;   /* --latency-upgrade */
     struct hdr_histogram *marker_histogram_local;    /* --latency-marker */
+    struct hdr_histogram *marker_uncorrected_histogram_local; /* ...=both */
+    /*
+     * The marker latencies of the earlier rate steps,
+     * see worker_next_rate_step().
+     * The (marker_histogram_local) measures the (marker_step).
+     * Past the MARKER_STEPS_MAX steps, the latencies are reset instead.
+     */
+    struct marker_step {
+        unsigned step; /* Into engine.rate_steps[] */
+        struct hdr_histogram *histogram;
+    } * marker_steps;
+    size_t n_marker_steps;
+    unsigned marker_step;
+    /* --latency-by-size, allocated as the size classes are seen. */
+    struct hdr_histogram *size_class_histograms[MESSAGE_SIZE_CLASSES];
+    /*
+     * The --latency-slowest messages: a min-heap of the (latency),
+     * so that the fastest of the kept ones is at the top to compare with.
+     */
+    struct engine_slow_message *slowest;
+    size_t n_slowest;
+    /* The --fanout deliveries of the connections closed so far. */
+    struct hdr_histogram *fanout_deliveries;
+    atomic_narrow_t rate_step; /* Set by the engine before publishing */
+
+    /* The version of the params.channel_send_rate, see send_rate_shared. */
+    non_atomic_narrow_t send_rate_version;
+    non_atomic_narrow_t send_rate_restarted;
 
+    struct ssl_shared ssl; /* --ssl contexts of this worker */
     /* Per-worker scratch buffer allows debugging the last received data */
-    char scratch_recv_buf[16384];
+    char *scratch_recv_buf;
+    size_t scratch_recv_size; /* --read-buffer */
+    char *keepalive_data;     /* --keepalive-message, evaluated */
+    size_t keepalive_size;
     size_t scratch_recv_last_size;
+    double scratch_recv_ts; /* Kernel receive time of the data, or 0.0 */
+    /* --zerocopy-receive: the socket pages mapped per connection */
+    size_t zerocopy_rx_page;
+    size_t zerocopy_rx_size; /* The whole pages of --read-buffer */
+    double tstamp_offset;   /* Loop time minus the kernel timestamp clock */
 
     pcg32_random_t rng;
 
+    struct record_ring *record_ring; /* --record, or NULL */
+    double record_clock_offset;      /* UNIX time minus the loop time */
+    struct connstats_ring *connstats_ring; /* --per-connection-stats */
+    struct closer_ring *closer_ring;       /* The sockets to close */
+    struct sample_ring *sample_ring;       /* --sample-interval, or NULL */
+    non_atomic_traffic_stats sample_base;  /* Put into the samples so far */
+    struct tk_huge_arena *huge_arena;      /* --hugepages, or NULL */
+    struct peer_table *peer_table;         /* --per-peer-stats, or NULL */
+    struct log_ring *log_ring;       /* Dumps and log lines, or NULL */
+
+    /* Refills payloads with per-message expressions, or NULL */
+    struct payload_generator *payload_generator;
+
+    /* The exploded \{connection.uid % N} payloads, by message collection */
+    struct data_template_cache *data_template_caches;
+
+    /* The upgrade requests to answer together, see ws_accepts_flush(). */
+    struct {
+        struct connection **conns;
+        size_t count;
+        size_t size;
+    } ws_accepts;
+
+    /* The outgoing connections fired together, see burst_timer_cb(). */
+    struct {
+        struct connection **conns;
+        size_t count;
+        size_t size;
+    } burst;
+
+    /* The paced connections due to write, see send_queue_run(). */
+    struct {
+        struct send_queue_entry {
+            double deadline; /* The intended time of the pending data */
+            struct connection *conn;
+        } *entries; /* Min-heap by the (deadline) */
+        size_t count;
+        size_t size;
+    } send_queue;
+
+    /* The event loop behavior since the last loop_stats_publish(). */
+    struct {
+        double period_start; /* Loop time the period has started at */
+        double busy;         /* Time spent running the callbacks */
+        double stall;        /* The longest iteration's callbacks */
+        double lag;          /* The worst stats_timer lateness */
+        double pacing_debt;  /* The worst connection's send schedule debt */
+        double stats_due;    /* When the stats_timer should fire next */
+        double max_lag;      /* Since the start of the test */
+        unsigned long events;
+        unsigned long iterations;
+    } loop_local;
+    double busy_poll_last_event; /* Loop time of the latest events */
+    int loop_stopped;            /* See busy_poll_run() */
+
+    /*
+     * Released connections and their fixed-size buffers are kept here
+     * for reuse, to avoid malloc(3)/free(3) churn on connection storms.
+     */
+    struct {
+        struct tk_pool connections;      /* struct connection */
+        struct tk_pool sent_timestamps;  /* struct ts_ring */
+        struct tk_pool marker_histograms; /* struct hdr_histogram */
+        struct tk_pool sbmh_marker_ctxs; /* Shared --latency-marker context */
+        struct socket_pool sockets[2];   /* AF_INET and AF_INET6 */
+    } pools;
+
+    /* The evaluated --latency-marker strings, see marker_intern_take(). */
+    struct {
+        struct marker_intern **buckets;
+        size_t buckets_count; /* A power of 2 */
+        size_t count;
+    } marker_interns;
+
     /*******************************************
      * WORKER DATA SHARED WITH OTHER PROCESSES *
      *******************************************/
 
     const struct engine_params *shared_eng_params;
+    const struct send_rate_shared *send_rate_shared;
+    /* The (message_set) of the connections, 0 for the --message */
+    struct message_set *const *message_sets;
+    const atomic_narrow_t *n_message_sets; /* See engine_set_message() */
+    unsigned message_set;
+    struct rate_budget *send_budget; /* Shared by all workers */
+    double send_budget_tokens;       /* Taken from send_budget */
+
+    /*
+     * Number of new connections requested by engine_initiate_new_connections()
+     * and not yet picked up by the worker. The worker is woken up by
+     * a single 'c' written when this counter leaves zero.
+     * Written by the main thread, in a cache line of their own.
+     */
+    atomic_narrow_t connections_requested CACHE_LINE_ALIGNED;
+    atomic_narrow_t connections_to_close; /* See engine_close_connections() */
+    /* See engine_rebalance() */
+    atomic_narrow_t rebalance_target;   /* Worker to move the load to */
+    atomic_narrow_t rebalance_permille; /* Share of the load to move */
+    /* See engine_set_workers() */
+    atomic_narrow_t retiring;  /* Takes no more connections from others */
+    atomic_narrow_t drain_to;  /* Workers to leave the connections to */
+    atomic_narrow_t connections_dropped; /* To be opened elsewhere */
+    struct engine_memory_stats memory; /* See worker_account_memory() */
+    /* See worker_prewarm() */
+    size_t prewarm_connections;  /* Cleared once the pools are filled */
+    struct prewarm_sync *prewarm;
+    /* --reuseport-cpu */
+    int pinned_cpu; /* The CPU the worker runs on, or -1 */
+    struct listen_sync *listen_sync; /* Only for the initial workers */
 
     /*
      * Connection identifier counter is shared between all connections
      * across all workers. We don't allocate it per worker, so it points
-     * to the same memory in the parameters of all workers.
+     * to the same memory in the parameters of all workers. The workers
+     * lease the identifiers from it in blocks, see connection_uid_take().
      */
-    atomic_narrow_t *connection_unique_id_atomic;
+    atomic_narrow_t *connection_unique_id_atomic CACHE_LINE_ALIGNED;
+    non_atomic_narrow_t uid_lease_next; /* The next uid of the leased block */
+    non_atomic_narrow_t uid_lease_end;  /* Past the leased block */
+    atomic_narrow_t *rate_rank_atomic; /* --message-rate-distribution */
 
     /*
-     * Reporting histograms should not be touched
-     * unless asked through a private control pipe.
+     * Reporting histograms are periodically published by the worker
+     * and can be read by the reporting thread at any time,
+     * see histogram_publish(). The sequence number tags the epochs:
+     * it is odd while a new epoch is being published.
      */
-    struct hdr_histogram *connect_histogram_shared;
-    struct hdr_histogram *firstbyte_histogram_shared;
-    struct hdr_histogram *marker_histogram_shared;
-    pthread_mutex_t shared_histograms_lock;
+    struct published_histogram {
+        atomic_narrow_t sequence; /* Twice the number of epochs published */
+        int64_t published_count;  /* Worker-side total_count, to skip copies */
+        struct hdr_histogram *histogram;
+    } connect_histogram_shared, firstbyte_histogram_shared,
+        handshake_histogram_shared, upgrade_histogram_shared,
+        marker_histogram_shared, marker_uncorrected_histogram_shared;
 
     /*
-     * Per-remote server stats, pointing to a global table.
+     * Per-remote server stats, indexed by the remote_index.
      */
     struct remote_stats {
         atomic_narrow_t connection_attempts;
         atomic_narrow_t connection_failures;
+        atomic_traffic_stats traffic; /* Outgoing connections' traffic */
     } * remote_stats;
+    unsigned *remote_outstanding; /* RSEL_LEAST_CONN: connections open */
+    struct tk_wheel_entry reconnect_timer; /* --reconnect */
+    unsigned reconnect_failures; /* Connection attempts failed in a row */
+    /* RSEL_LEAST_LATENCY: the recent experience with each remote. */
+    struct remote_health {
+        exp_moving_average latency;  /* Marker or connect latency, seconds */
+        exp_moving_average failures; /* Share of the connections failed */
+    } * remote_health;
+    /* --connect-backoff: the failed connects to each remote, in a row. */
+    struct remote_backoff {
+        unsigned failures;
+        double until; /* Not connected to until then, loop time */
+    } * remote_backoff;
+    double remote_backoff_now; /* The loop time of the remote_usable() */
+    /* The host:port@rate=,max= quotas, shared by all workers, or NULL. */
+    struct remote_quota_state {
+        struct rate_budget connect_budget; /* rate= */
+        atomic_narrow_t open;              /* Against max= */
+    } * remote_quotas;
+
+    /*
+     * Per-remote latency histograms, unless there is a single destination
+     * or too many of them, see ENGINE_REMOTE_LATENCY_MAX.
+     */
+    struct remote_latency {
+        struct hdr_histogram *connect_histogram_local;
+        struct hdr_histogram *firstbyte_histogram_local;
+        struct hdr_histogram *handshake_histogram_local;
+        struct hdr_histogram *upgrade_histogram_local;
+        struct hdr_histogram *marker_histogram_local;
+        struct published_histogram connect_histogram_shared,
+            firstbyte_histogram_shared, handshake_histogram_shared,
+            upgrade_histogram_shared, marker_histogram_shared;
+    } * remote_latency;
+    size_t remote_latency_count; /* The initial destinations only */
+
+    /* Per --connection-group stats, indexed by connection.cold->group - 1. */
+    struct group_stats {
+        unsigned open; /* The group's connections of this worker */
+        unsigned address_offset; /* Into the group's target= addresses */
+        atomic_traffic_stats traffic;
+    } * group_stats;
+    struct remote_latency *group_latency; /* With --latency-*, or NULL */
+    unsigned slow_publish_countdown;
+
+    /* --cpu-cost: the numbers as of the last cpu_cost_publish(). */
+    struct cpu_counters cpu_counters;
+    struct {
+        uint64_t time_us;
+        uint64_t cycles;
+        uint64_t instructions;
+    } cpu_local;
+
+    /* --tcp-info, see worker_sample_tcp_info(). */
+    struct hdr_histogram *tcp_info_histogram_local[ETI_METRICS];
+    struct published_histogram tcp_info_histogram_shared[ETI_METRICS];
 
-    /* The following atomic members are accessed outside of worker thread */
-    atomic_traffic_stats worker_traffic_stats;
+    /* Avoid mixing output from several threads when dumping complex state */
+    pthread_mutex_t *serialize_output_lock;
+
+    /*
+     * The following atomic members are accessed outside of worker thread,
+     * see engine_get_connection_stats(). They start a new cache line,
+     * and the structure is padded to the cache line size, so the polling
+     * does not disturb this or the neighbouring workers' own fields.
+     */
+    atomic_traffic_stats worker_traffic_stats CACHE_LINE_ALIGNED;
     atomic_narrow_t outgoing_connecting;
     atomic_narrow_t outgoing_established;
     atomic_narrow_t incoming_established;
     atomic_narrow_t connections_counter;
-
-    /* Avoid mixing output from several threads when dumping complex state */
-    pthread_mutex_t *serialize_output_lock;
-};
+    /* --mptcp: the connections established, and those fallen back to TCP */
+    atomic_narrow_t mptcp_connections;
+    atomic_narrow_t mptcp_fallbacks;
+    /* --tcp-fastopen: the connections closed, and those with SYN data */
+    atomic_narrow_t fastopen_connections;
+    atomic_narrow_t fastopen_accepted;
+    /* --latency-sample: the samples which did not fit the rings */
+    atomic_wide_t latency_samples_dropped;
+    /* --grpc: the calls ended, by grpc-status, see grpc_call_ended() */
+    atomic_wide_t grpc_calls[GRPC_STATUS_CODES + 1];
+    /* --zerocopy-receive: the bytes received without copying */
+    atomic_wide_t zerocopy_rx_bytes;
+    /* --mirror: the twins connected and failed, the data they moved */
+    atomic_narrow_t mirrors_opened;
+    atomic_narrow_t mirrors_failed;
+    atomic_wide_t mirror_bytes_sent;
+    atomic_wide_t mirror_bytes_rcvd;
+    atomic_wide_t mirror_bytes_dropped;
+    /* --reconnect: the lost connections to replace, see reconnect_later() */
+    atomic_narrow_t reconnects_pending;
+    /* Published by loop_stats_publish(), see engine_loop_stats(). */
+    atomic_narrow_t loop_busy_permille;
+    atomic_narrow_t loop_lag_us;
+    atomic_narrow_t loop_stall_us;
+    atomic_narrow_t loop_events_per_iteration_x100;
+    atomic_narrow_t loop_pacing_debt_us;
+    atomic_narrow_t loop_max_lag_us;
+    atomic_narrow_t loop_saturated;
+    atomic_narrow_t loop_periods;
+    atomic_narrow_t loop_saturated_periods;
+    /* Published by cpu_cost_publish(), see engine_cpu_stats(). */
+    atomic_wide_t cpu_time_us;
+    atomic_wide_t cpu_cycles;
+    atomic_wide_t cpu_instructions;
+} CACHE_LINE_ALIGNED;
 
 /*
  * Types of control messages which might require fair ordering between channels.
@@ -157,20 +620,87 @@ enum control_message_type_e {
     _CONTROL_MESSAGES_MAXID /* Do not use. */
 };
 
+/*
+ * The engine_start() waits for the workers' worker_prewarm().
+ */
+struct prewarm_sync {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    int pending; /* Workers still filling up their pools */
+};
+
+/*
+ * --reuseport-cpu: the initial workers listen() in order,
+ * for the nth socket in each SO_REUSEPORT group to belong
+ * to the nth worker, see attach_reuseport_cpu_filter().
+ */
+struct listen_sync {
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+    int next;      /* The worker to listen next */
+    int n_workers; /* The initial workers */
+    const int *cpus; /* The CPU each worker is pinned to */
+};
+
 /*
  * Engine abstracts over workers.
  */
+#define MARKER_STEPS_MAX 100 /* Rate steps to keep the latencies of */
+
+/*
+ * The freed latency snapshots, kept for the next engine_collect_*() call.
+ * The main thread takes a snapshot several times a second; reusing them
+ * saves allocating and faulting in the histograms each time.
+ */
+struct latency_snapshot_pool {
+    pthread_mutex_t lock;
+    struct engine *eng;
+    struct latency_snapshot *free_list;
+    /* What histogram_add_published() copies into, under the lock */
+    struct hdr_histogram *copy;
+    size_t copy_size;
+};
+
 struct engine {
     struct engine_params params; /* A copy of engine parameters */
     struct loop_arguments *loops;
     pthread_t *threads;
+    int global_control_pipe_rd;
     int global_control_pipe_wr;
-    int global_feedback_pipe_rd;
     int next_worker_order[_CONTROL_MESSAGES_MAXID];
-    int n_workers;
+    int n_workers;   /* Running, see engine_set_workers() */
+    int n_loops;     /* Ever set up, the retired ones keep their stats */
+    int max_workers; /* The size of loops[] and threads[] */
+    struct engine_params worker_params; /* Copied into the new workers */
+    double record_clock_offset;         /* UNIX time minus the loop time */
+    /* Keeps the migrations out of a retiring worker */
+    pthread_mutex_t workers_lock;
     non_atomic_traffic_stats total_traffic_stats;
     atomic_narrow_t connection_unique_id_global;
+    atomic_narrow_t rate_rank_global; /* --message-rate-distribution */
     pthread_mutex_t serialize_output_lock;
+    struct rate_budget send_budget; /* --rate-scope total */
+    struct remote_quota_state *remote_quotas; /* Of params.remote_quotas */
+    struct send_rate_shared send_rate;
+    struct message_set *message_sets[MESSAGE_SETS_MAX];
+    atomic_narrow_t n_message_sets; /* Set after the message_sets[] */
+    struct recorder *recorder;      /* --record */
+    struct connstats *connstats;    /* --per-connection-stats */
+    struct closer *closer;          /* Closes the sockets for the workers */
+    struct sampler *sampler;        /* --sample-interval */
+    /* The sampled intervals counted in, see engine_next_sample(). */
+    struct hdr_histogram *throughput[SAMPLE_METRICS];
+    struct logpipe *logpipe;        /* --dump-*, -v */
+    struct latency_snapshot_pool latency_pool;
+    struct prewarm_sync prewarm;    /* --prewarm */
+    struct listen_sync listen_sync; /* --reuseport-cpu */
+    int *worker_cpus; /* Of each worker slot, or NULL if not pinned */
+    /* Each message rate set, see engine_update_workers_send_rate(). */
+    struct rate_step {
+        rate_spec_t rate;
+        double start;
+    } * rate_steps;
+    size_t n_rate_steps;
 };
 
 const struct engine_params *
@@ -189,57 +719,171 @@ enum connection_close_reason {
     CCR_DATA,     /* Data framing error */
 };
 static void *single_engine_loop_thread(void *argp);
+static void worker_setup(struct engine *eng, int n);
+static void worker_launch(struct engine *eng, int n);
 static void start_new_connection(TK_P);
+static void socket_pool_refill(struct loop_arguments *largs);
+static void reconnect_timer_cb(struct tk_wheel *wheel,
+                               struct tk_wheel_entry *e);
+static struct connection *connection_new(struct loop_arguments *largs);
+static void drain_worker_pools(struct loop_arguments *largs);
+static void worker_prewarm(struct loop_arguments *largs);
+static void worker_cpus(int *cpus, int n);
+static void worker_setup_on_cpu(struct engine *eng, int n);
+static void listen_turn_wait(struct listen_sync *ls, int n);
+static void listen_turn_done(struct listen_sync *ls);
+static void attach_reuseport_cpu_filter(struct loop_arguments *largs,
+                                        int lsock);
+static void worker_account_memory(struct loop_arguments *largs);
 static void close_connection(TK_P_ struct connection *conn,
                              enum connection_close_reason reason);
+static void connstats_record_close(TK_P_ struct connection *conn,
+                                   enum connection_close_reason reason);
 static void connections_flush_stats(TK_P);
 static void connection_flush_stats(TK_P_ struct connection *conn);
+static inline void connection_stats_dirty(struct loop_arguments *,
+                                          struct connection *);
 static void close_all_connections(TK_P_ enum connection_close_reason reason);
+static void close_acceptors(TK_P);
 static void connection_cb(TK_P_ tk_io *w, int revents);
+static void connection_cb_plain(TK_P_ tk_io *w, int revents);
+static void connection_cb_marker(TK_P_ tk_io *w, int revents);
 static void passive_websocket_cb(TK_P_ tk_io *w, int revents);
 static void control_cb(TK_P_ tk_io *w, int revents);
 static void accept_cb(TK_P_ tk_io *w, int revents);
+static void mirror_cb(TK_P_ tk_io *w, int revents);
+static void mirror_open(TK_P_ struct connection *conn);
+static void mirror_close(TK_P_ struct connection *conn);
 static void stats_timer_cb(TK_P_ tk_timer UNUSED *w, int UNUSED revents);
-static void conn_timer_cb(TK_P_ tk_timer *w, int revents); /* Timeout timer */
-static void expire_channel_lives(TK_P_ tk_timer *w, int revents);
-static void setup_channel_lifetime_timer(TK_P_ double first_timeout);
+static void sample_timer_cb(TK_P_ tk_timer UNUSED *w, int UNUSED revents);
+static void burst_timer_cb(TK_P_ tk_timer UNUSED *w, int UNUSED revents);
+static void burst_join(struct loop_arguments *largs, struct connection *conn);
+static void burst_leave(struct loop_arguments *largs, struct connection *conn);
+static void send_queue_remove(struct loop_arguments *largs,
+                              struct connection *conn);
+static double send_intended_ts(struct connection *conn, double now);
+static void worker_update_shared_histograms(struct loop_arguments *largs);
+static void worker_update_remote_histograms(struct loop_arguments *largs);
+static void worker_reset_histograms(struct loop_arguments *largs);
+static void worker_next_rate_step(struct loop_arguments *largs);
+static void worker_follow_send_rate(struct loop_arguments *largs);
+static void worker_sample_tcp_info(struct loop_arguments *largs);
+static void mptcp_count_connection(struct loop_arguments *largs, int sockfd);
+static void fastopen_count(struct loop_arguments *largs, int sockfd);
+static void data_template_cache_free(struct loop_arguments *largs);
+static int stream_protocol(const struct engine_params *params, int family);
+static struct hdr_histogram *remote_histogram_new(struct hdr_histogram *);
+static struct remote_latency *remote_latency_new(struct loop_arguments *,
+                                                 size_t n);
+static void send_pace_init(struct loop_arguments *largs,
+                           struct connection *conn, double now);
+static void send_pace_burst(struct loop_arguments *largs,
+                            struct connection *conn);
+static void conn_timer_cb(struct tk_wheel *wheel, struct tk_wheel_entry *e);
+static void expire_channel_life(struct tk_wheel *wheel,
+                                struct tk_wheel_entry *e);
+static void timer_wheel_cb(TK_P_ tk_timer *w, int revents);
+static void timer_wheel_schedule(TK_P_ struct tk_wheel_entry *e, double delay);
 static void update_io_interest(TK_P_ struct connection *conn);
+static void connection_io_stream(TK_P_ struct connection *conn);
 static struct sockaddr_storage *pick_remote_address(
-    struct loop_arguments *largs, size_t *remote_index);
+    struct loop_arguments *largs, uint32_t key, size_t *remote_index);
+static struct sockaddr_storage *pick_group_remote_address(
+    struct loop_arguments *largs, size_t group_index, size_t *remote_index);
 static char *express_bytes(size_t bytes, char *buf, size_t size);
-static int limit_channel_lifetime(struct loop_arguments *largs);
+static int limit_channel_lifetime(struct loop_arguments *largs,
+                                  const struct connection_group *group);
 static void set_nbio(int fd, int onoff);
-static void set_socket_options(int fd, struct loop_arguments *largs);
+static struct hdr_histogram *hdr_init_similar(struct hdr_histogram *);
+static struct hdr_histogram *latency_histogram_new(double latency_max);
+static void set_socket_options(int fd, sa_family_t family,
+                               struct loop_arguments *largs);
+static int enable_zerocopy(int fd);
+static void update_kernel_pacing(struct loop_arguments *largs,
+                                 struct connection *conn, int fd);
+static void errqueue_reap(TK_P_ struct connection *conn);
+static void tstamp_enable(TK_P_ struct connection *conn, int sockfd);
+static int ssl_handshake_step(TK_P_ struct connection *conn, int sockfd);
+static int record_replies_latency(TK_P_ struct connection *conn,
+                                  unsigned replies);
+static void pipeline_answered(TK_P_ struct connection *conn);
+static double rate_distribution_shape(const struct engine_params *params,
+                                      size_t k);
+static void pipeline_markers_answered(TK_P_ struct connection *conn,
+                                      unsigned markers);
+static ssize_t tstamp_read(TK_P_ struct connection *conn, void *buf,
+                           size_t size);
 static void common_connection_init(TK_P_ struct connection *conn,
                                    enum conn_type conn_type,
                                    enum conn_state conn_state, int sockfd);
-static void largest_contiguous_chunk(struct loop_arguments *largs,
+static void ws_accept_queue(struct loop_arguments *largs,
+                            struct connection *conn);
+static void ws_accept_dequeue(struct loop_arguments *largs,
+                              struct connection *conn);
+static void ws_accepts_flush(TK_P);
+static void ws_accept_respond(TK_P_ struct connection *conn);
+static void largest_contiguous_chunk(TK_P_ struct loop_arguments *largs,
                                      struct connection *conn,
                                      const void **position,
                                      size_t *available_header,
                                      size_t *available_body);
-static void debug_dump_data(const char *prefix, int fd, const void *data,
-                            size_t size, ssize_t limit);
-static void debug_dump_data_highlight(const char *prefix, int fd,
+/* Maximum number of data chunks given to a single writev() */
+#define WRITE_CHUNKS_MAX 8
+/* The --record data waiting to be written out, per worker */
+#define RECORD_RING_SIZE (16 * 1024 * 1024)
+/* Per-worker buffer for the dumps and log lines waiting to be printed */
+#define LOG_RING_SIZE (4 * 1024 * 1024)
+/* The --per-connection-stats records waiting to be written out, per worker */
+#define CONNSTATS_RING_RECORDS (32 * 1024)
+/* The closed sockets waiting for the closer thread, per worker */
+#define CLOSER_RING_FDS (4 * 1024)
+/* The data a --mirror twin may fall behind its connection by */
+#define MIRROR_QUEUE_MAX (64 * 1024)
+/* The size of its queue, grown up to the MIRROR_QUEUE_MAX as needed */
+#define MIRROR_QUEUE_MIN 4096
+/* Maximum number of --udp datagrams given to a single sendmmsg() */
+#define UDP_BATCH_MAX 64
+
+/* See tcpkali_common.h. */
+double latency_units_per_second = 10000;
+
+static size_t wrapped_around_chunks(struct loop_arguments *largs,
+                                    struct connection *conn,
+                                    struct iovec *chunks, int *n_chunks);
+static int iov_slice(const struct iovec *chunks, int n_chunks, size_t offset,
+                     size_t size, struct iovec *slice);
+static void debug_dump_data(struct loop_arguments *largs, const char *prefix,
+                            int fd, const void *data, size_t size,
+                            ssize_t limit);
+static void debug_dump_data_highlight(struct loop_arguments *largs,
+                                      const char *prefix, int fd,
                                       const void *data, size_t size,
                                       ssize_t limit, size_t hl_offset,
                                       size_t hl_length);
+static void debug_dump_print(const struct log_dump *dump, const void *data,
+                             size_t size);
+static void worker_log(struct loop_arguments *largs, const char *fmt, ...)
+    PRINTFLIKE(2, 3);
 static void
 latency_record_incoming_ts(TK_P_ struct connection *conn, char *buf,
                            size_t size);
 
 #ifdef USE_LIBUV
 static void
-expire_channel_lives_uv(tk_timer *w) {
-    expire_channel_lives(w->loop, w, 0);
+timer_wheel_cb_uv(tk_timer *w) {
+    timer_wheel_cb(w->loop, w, 0);
 }
 static void
 stats_timer_cb_uv(tk_timer *w) {
     stats_timer_cb(w->loop, w, 0);
 }
 static void
-conn_timer_cb_uv(tk_timer *w) {
-    conn_timer_cb(w->loop, w, 0);
+sample_timer_cb_uv(tk_timer *w) {
+    sample_timer_cb(w->loop, w, 0);
+}
+static void
+burst_timer_cb_uv(tk_timer *w) {
+    burst_timer_cb(w->loop, w, 0);
 }
 static void
 passive_websocket_cb_uv(tk_io *w, int UNUSED status, int revents) {
@@ -250,6 +894,14 @@ connection_cb_uv(tk_io *w, int UNUSED status, int revents) {
     connection_cb(w->loop, w, revents);
 }
 static void
+connection_cb_plain_uv(tk_io *w, int UNUSED status, int revents) {
+    connection_cb_plain(w->loop, w, revents);
+}
+static void
+connection_cb_marker_uv(tk_io *w, int UNUSED status, int revents) {
+    connection_cb_marker(w->loop, w, revents);
+}
+static void
 accept_cb_uv(tk_io *w, int UNUSED status, int revents) {
     accept_cb(w->loop, w, revents);
 }
@@ -257,14 +909,38 @@ static void
 control_cb_uv(tk_io *w, int UNUSED status, int revents) {
     control_cb(w->loop, w, revents);
 }
+static void
+mirror_cb_uv(tk_io *w, int UNUSED status, int revents) {
+    mirror_cb(w->loop, w, revents);
+}
 #endif
 
-#define DEBUG(level, fmt, args...)                                        \
-    do {                                                                  \
-        if((int)largs->params.verbosity_level >= level)                   \
-            debug_log(level, largs->params.verbosity_level, fmt, ##args); \
+#define DEBUG(level, fmt, args...)                      \
+    do {                                                \
+        if((int)largs->params.verbosity_level >= level) \
+            worker_log(largs, fmt, ##args);             \
     } while(0)
 
+static void
+prepare_data_templates(struct message_collection *mc,
+                       struct transport_data_spec *data_templates[2]) {
+    enum transport_websocket_side tws_side;
+    for(tws_side = TWS_SIDE_CLIENT; tws_side <= TWS_SIDE_SERVER; tws_side++) {
+        assert(data_templates[tws_side] == NULL);
+        pcg32_random_t rng;
+        pcg32_srandom_r(&rng, random(), tws_side);
+        data_templates[tws_side] = transport_spec_from_message_collection(
+            0, mc, 0, 0, tws_side, TS_CONVERSION_INITIAL, &rng);
+        assert(data_templates[tws_side]
+               || mc->most_dynamic_expression != DS_GLOBAL_FIXED);
+    }
+
+    if(data_templates[0])
+        replicate_payload(data_templates[0], REPLICATE_MAX_SIZE);
+    if(data_templates[1])
+        replicate_payload(data_templates[1], REPLICATE_MAX_SIZE);
+}
+
 struct engine *
 engine_start(struct engine_params params) {
     int fildes[2];
@@ -276,12 +952,6 @@ engine_start(struct engine_params params) {
     int gctl_pipe_wr = fildes[1];
     set_nbio(gctl_pipe_rd, 1);
 
-    /* Global feedback pipe. Engine <- workers. */
-    rc = pipe(fildes);
-    assert(rc == 0);
-    int gfbk_pipe_rd = fildes[0];
-    int gfbk_pipe_wr = fildes[1];
-
     /* Figure out number of asynchronous workers to start. */
     int n_workers = params.requested_workers;
     if(!n_workers) {
@@ -296,33 +966,57 @@ engine_start(struct engine_params params) {
      * might contain expressions which must be resolved
      * on a per connection or per message basis.
      */
-    enum transport_websocket_side tws_side;
-    for(tws_side = TWS_SIDE_CLIENT; tws_side <= TWS_SIDE_SERVER; tws_side++) {
-        assert(params.data_templates[tws_side] == NULL);
-        pcg32_random_t rng;
-        pcg32_srandom_r(&rng, random(), tws_side);
-        params.data_templates[tws_side] =
-            transport_spec_from_message_collection(
-                0, &params.message_collection, 0, 0, tws_side,
-                TS_CONVERSION_INITIAL, &rng);
-        assert(params.data_templates[tws_side]
-               || params.message_collection.most_dynamic_expression
-                      != DS_GLOBAL_FIXED);
+    prepare_data_templates(&params.message_collection, params.data_templates);
+    for(size_t g = 0; g < params.n_groups; g++) {
+        prepare_data_templates(&params.groups[g].message_collection,
+                               params.groups[g].data_templates);
+    }
+    if(params.corpus)
+        replicate_payload(&params.corpus->data, REPLICATE_MAX_SIZE);
+
+    /* The workers could be added up to the number of CPUs later. */
+    int max_workers = n_workers;
+    if(max_workers < number_of_cpus()) max_workers = number_of_cpus();
+
+    if(params.rate_distribution.kind != RATE_DIST_NONE) {
+        double sum = 0.0;
+        for(size_t k = 1; k <= params.rate_distribution.population; k++)
+            sum += rate_distribution_shape(&params, k);
+        params.rate_distribution.norm =
+            params.rate_distribution.population / sum;
     }
-
-    if(params.data_templates[0])
-        replicate_payload(params.data_templates[0], REPLICATE_MAX_SIZE);
-    if(params.data_templates[1])
-        replicate_payload(params.data_templates[1], REPLICATE_MAX_SIZE);
 
     struct engine *eng = calloc(1, sizeof(*eng));
     eng->params = params;
-    eng->loops = calloc(n_workers, sizeof(eng->loops[0]));
-    eng->threads = calloc(n_workers, sizeof(eng->threads[0]));
-    eng->n_workers = n_workers;
+    eng->rate_steps = malloc(sizeof(eng->rate_steps[0]));
+    assert(eng->rate_steps);
+    eng->rate_steps[0].rate = params.channel_send_rate;
+    eng->rate_steps[0].start = tk_now(TK_DEFAULT);
+    eng->n_rate_steps = 1;
+    /* Keep the workers' cache lines apart, see CACHE_LINE_ALIGNED. */
+    void *loops;
+    rc = posix_memalign(&loops, CACHE_LINE_SIZE,
+                        max_workers * sizeof(eng->loops[0]));
+    assert(rc == 0);
+    memset(loops, 0, max_workers * sizeof(eng->loops[0]));
+    eng->loops = loops;
+    eng->threads = calloc(max_workers, sizeof(eng->threads[0]));
+    eng->max_workers = max_workers;
+    eng->latency_pool.eng = eng;
+    if(params.n_remote_quotas) {
+        eng->remote_quotas = calloc(params.n_remote_quotas,
+                                    sizeof(eng->remote_quotas[0]));
+        assert(eng->remote_quotas);
+    }
+    eng->global_control_pipe_rd = gctl_pipe_rd;
     eng->global_control_pipe_wr = gctl_pipe_wr;
-    eng->global_feedback_pipe_rd = gfbk_pipe_rd;
-    if(pthread_mutex_init(&eng->serialize_output_lock, 0) != 0) {
+    if(pthread_mutex_init(&eng->serialize_output_lock, 0) != 0
+       || pthread_mutex_init(&eng->workers_lock, 0) != 0
+       || pthread_mutex_init(&eng->latency_pool.lock, 0) != 0
+       || pthread_mutex_init(&eng->prewarm.lock, 0) != 0
+       || pthread_cond_init(&eng->prewarm.done, 0) != 0
+       || pthread_mutex_init(&eng->listen_sync.lock, 0) != 0
+       || pthread_cond_init(&eng->listen_sync.turn, 0) != 0) {
         /* At this stage in the program, no point to continue. */
         assert(!"Should really be unreachable");
         return NULL;
@@ -339,69 +1033,311 @@ engine_start(struct engine_params params) {
                   (void *)params.latency_marker_expr->u.data.data,
                   params.latency_marker_expr->u.data.size);
     }
-    if(params.message_stop_expr    /* --message-stop */
-       && EXPR_IS_TRIVIAL(params.message_stop_expr)) {
-        sbmh_init(NULL, &params.sbmh_shared_stop_occ,
-                  (void *)params.message_stop_expr->u.data.data,
-                  params.message_stop_expr->u.data.size);
+
+    if(params.request_delimiter_expr /* --request-delimiter */
+       && EXPR_IS_TRIVIAL(params.request_delimiter_expr)) {
+        sbmh_init(NULL, &params.sbmh_shared_request_occ,
+                  (void *)params.request_delimiter_expr->u.data.data,
+                  params.request_delimiter_expr->u.data.size);
+    }
+
+    tk_clock_global_init(params.latency_clock);
+
+    if(params.record_dir) {
+        eng->recorder =
+            recorder_open(params.record_dir, max_workers, RECORD_RING_SIZE);
+        if(!eng->recorder) {
+            fprintf(stderr, "--record %s: %s\n", params.record_dir,
+                    strerror(errno));
+            exit(EX_CANTCREAT);
+        }
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        eng->record_clock_offset =
+            tv.tv_sec + tv.tv_usec / 1000000.0 - tk_now(TK_DEFAULT);
     }
 
-    params.epoch = tk_now(TK_DEFAULT); /* Single epoch for all threads */
-    for(int n = 0; n < eng->n_workers; n++) {
-        struct loop_arguments *largs = &eng->loops[n];
-        TAILQ_INIT(&largs->open_conns);
-        largs->connection_unique_id_atomic = &eng->connection_unique_id_global;
-        largs->params = params;
-        largs->shared_eng_params = &eng->params;
-        largs->remote_stats = calloc(params.remote_addresses.n_addrs,
-                                     sizeof(largs->remote_stats[0]));
-        largs->address_offset = n;
-        largs->thread_no = n;
-        largs->serialize_output_lock = &eng->serialize_output_lock;
-        const int decims_in_1s = 10 * 1000; /* decimilliseconds, 1/10 ms */
-        if(params.latency_setting & SLT_CONNECT) {
-            int ret = hdr_init(
-                1, /* 1/10 milliseconds is the lowest storable value. */
-                100 * decims_in_1s, /* 100 seconds is a max storable value */
-                3, &largs->connect_histogram_local);
+    if(params.sample_interval > 0.0) {
+        /* Room for two seconds worth of samples, drained every 0.25s. */
+        eng->sampler =
+            sampler_new(max_workers, ceil(2.0 / params.sample_interval));
+        for(int m = 0; m < SAMPLE_METRICS; m++) {
+            int ret = hdr_init(1, 1000000000000LL, 3, &eng->throughput[m]);
             assert(ret == 0);
         }
-        if(params.latency_setting & SLT_FIRSTBYTE) {
-            int ret = hdr_init(
-                1, /* 1/10 milliseconds is the lowest storable value. */
-                100 * decims_in_1s, /* 100 seconds is a max storable value */
-                3, &largs->firstbyte_histogram_local);
-            assert(ret == 0);
+    }
+
+    /*
+     * The kernel side of the teardown is done off the workers,
+     * given a CPU to spare for it.
+     */
+    if(n_workers < number_of_cpus())
+        eng->closer = closer_new(max_workers, CLOSER_RING_FDS);
+
+    if(params.connstats_file) {
+        eng->connstats = connstats_open(params.connstats_file, max_workers,
+                                        CONNSTATS_RING_RECORDS);
+        if(!eng->connstats) {
+            fprintf(stderr, "--per-connection-stats %s: %s\n",
+                    params.connstats_file, strerror(errno));
+            exit(EX_CANTCREAT);
         }
-        if(params.latency_setting & SLT_MARKER) {
-            int ret = hdr_init(
-                1, /* 1/10 milliseconds is the lowest storable value. */
-                100 * decims_in_1s, /* 100 seconds is a max storable value */
-                3, &largs->marker_histogram_local);
-            assert(ret == 0);
-            DEBUG(DBG_DETAIL, "Initialized HdrHistogram with size %ld\n",
-                  (long)hdr_get_memory_size(largs->marker_histogram_local));
+    }
+
+    /*
+     * Let the writer thread format and print the dumps and the detailed
+     * logs, so the workers do not slow down to the speed of the terminal.
+     */
+    if(params.dump_setting || params.verbosity_level >= DBG_DETAIL) {
+        eng->logpipe = logpipe_open(max_workers, LOG_RING_SIZE,
+                                    tcpkali_clear_eol(), debug_dump_print);
+    }
+
+    if(params.cpu_affinity || params.reuseport_cpu) {
+        eng->worker_cpus = calloc(max_workers, sizeof(eng->worker_cpus[0]));
+        assert(eng->worker_cpus);
+        if(params.cpu_affinity) {
+            for(int n = 0; n < max_workers; n++)
+                eng->worker_cpus[n] =
+                    params.cpu_affinity[n % params.cpu_affinity_count];
+        } else {
+            worker_cpus(eng->worker_cpus, max_workers);
         }
-        if(pthread_mutex_init(&largs->shared_histograms_lock, 0) != 0) {
-            /* At this stage in the program, no point to continue. */
-            assert(!"Should really be unreachable");
+    }
+    if(params.reuseport_cpu) {
+        eng->listen_sync.n_workers = n_workers;
+        eng->listen_sync.cpus = eng->worker_cpus;
+    }
+
+    params.epoch = tk_now(TK_DEFAULT); /* Single epoch for all threads */
+    eng->worker_params = params;
+    eng->prewarm.pending = params.prewarm_connections ? n_workers : 0;
+    for(int n = 0; n < n_workers; n++) {
+        worker_setup_on_cpu(eng, n);
+        if(params.prewarm_connections) {
+            /* Each worker fills up its own pools, in parallel. */
+            eng->loops[n].prewarm_connections =
+                (params.prewarm_connections + n_workers - 1) / n_workers;
+            eng->loops[n].prewarm = &eng->prewarm;
         }
+        if(params.reuseport_cpu) eng->loops[n].listen_sync = &eng->listen_sync;
+        worker_launch(eng, n);
+    }
+    eng->n_workers = n_workers;
+    eng->n_loops = n_workers;
+
+    pthread_mutex_lock(&eng->prewarm.lock);
+    while(eng->prewarm.pending)
+        pthread_cond_wait(&eng->prewarm.done, &eng->prewarm.lock);
+    pthread_mutex_unlock(&eng->prewarm.lock);
+    pthread_mutex_lock(&eng->listen_sync.lock);
+    while(eng->listen_sync.next < eng->listen_sync.n_workers)
+        pthread_cond_wait(&eng->listen_sync.turn, &eng->listen_sync.lock);
+    pthread_mutex_unlock(&eng->listen_sync.lock);
+    /* The workers added or relaunched later start cold. */
+    for(int n = 0; n < n_workers; n++) {
+        eng->loops[n].prewarm_connections = 0;
+        eng->loops[n].prewarm = NULL;
+        eng->loops[n].listen_sync = NULL;
+    }
 
-        int private_pipe[2];
-        int rc = pipe(private_pipe);
-        assert(rc == 0);
-        largs->private_control_pipe_rd = private_pipe[0];
-        largs->private_control_pipe_wr = private_pipe[1];
-        largs->global_control_pipe_rd_nbio = gctl_pipe_rd;
-        largs->global_feedback_pipe_wr = gfbk_pipe_wr;
-        pcg32_srandom_r(&largs->rng, random(), n);
+    return eng;
+}
 
-        rc = pthread_create(&eng->threads[n], 0, single_engine_loop_thread,
-                            largs);
-        assert(rc == 0);
+/*
+ * Set up the n-th worker's state. This is done once per slot:
+ * a worker retired by engine_set_workers() keeps its statistics,
+ * and is launched again in the same slot.
+ */
+static void
+worker_setup(struct engine *eng, int n) {
+    const struct engine_params params = eng->worker_params;
+    struct loop_arguments *largs = &eng->loops[n];
+    TAILQ_INIT(&largs->open_conns);
+    TAILQ_INIT(&largs->acceptors);
+    TAILQ_INIT(&largs->dirty_conns);
+    largs->connection_unique_id_atomic = &eng->connection_unique_id_global;
+    largs->rate_rank_atomic = &eng->rate_rank_global;
+    largs->params = params;
+    largs->shared_eng_params = &eng->params;
+    largs->send_rate_shared = &eng->send_rate;
+    /* Only the engine thread changes the rate, no need to retry. */
+    largs->params.channel_send_rate = eng->params.channel_send_rate;
+    largs->send_rate_version = atomic_get(&eng->send_rate.sequence);
+    largs->send_rate_restarted = eng->send_rate.restarted;
+    largs->message_sets = eng->message_sets;
+    largs->n_message_sets = &eng->n_message_sets;
+    largs->message_set = atomic_get(&eng->n_message_sets);
+    largs->send_budget = &eng->send_budget;
+    largs->remote_quotas = eng->remote_quotas;
+    largs->marker_step = eng->n_rate_steps - 1;
+    atomic_exchange(&largs->rate_step, largs->marker_step);
+    if(params.latency_slowest) {
+        largs->slowest =
+            calloc(params.latency_slowest, sizeof(largs->slowest[0]));
+        assert(largs->slowest);
+    }
+    /* The --dns-refresh may add destinations later. */
+    size_t remotes_max = params.dns_refresh
+                             ? DNS_REFRESH_MAX_ADDRS
+                             : params.remote_addresses.n_addrs;
+    largs->remote_stats =
+        calloc(remotes_max ? remotes_max : 1, sizeof(largs->remote_stats[0]));
+    if(params.remote_select == RSEL_LEAST_CONN) {
+        largs->remote_outstanding = calloc(
+            remotes_max ? remotes_max : 1,
+            sizeof(largs->remote_outstanding[0]));
+        assert(largs->remote_outstanding);
+    }
+    /* Kept across the restarts: the objects may still be in use. */
+    if(params.hugepages && !largs->huge_arena)
+        largs->huge_arena = tk_huge_arena_new();
+    if(params.peer_stats && !largs->peer_table)
+        largs->peer_table = peer_table_new(params.peer_stats_ipv4_bits,
+                                      params.peer_stats_ipv6_bits);
+    if(params.connect_backoff > 0.0) {
+        largs->remote_backoff = calloc(remotes_max ? remotes_max : 1,
+                                       sizeof(largs->remote_backoff[0]));
+        assert(largs->remote_backoff);
+    }
+    if(params.remote_select == RSEL_LEAST_LATENCY) {
+        largs->remote_health = calloc(remotes_max ? remotes_max : 1,
+                                      sizeof(largs->remote_health[0]));
+        assert(largs->remote_health);
+        for(size_t i = 0; i < (remotes_max ? remotes_max : 1); i++) {
+            exp_moving_average_init(&largs->remote_health[i].latency,
+                                    REMOTE_HEALTH_DECAY);
+            exp_moving_average_init(&largs->remote_health[i].failures,
+                                    REMOTE_HEALTH_DECAY);
+        }
+    }
+    largs->address_offset = n;
+    largs->thread_no = n;
+    largs->pinned_cpu = eng->worker_cpus ? eng->worker_cpus[n] : -1;
+    largs->peers = eng->loops;
+    largs->n_peers = eng->max_workers;
+    largs->workers_lock = &eng->workers_lock;
+    largs->ssl.cert = params.ssl_cert;
+    largs->ssl.key = params.ssl_key;
+    largs->ssl.ktls = params.ssl_ktls;
+    largs->ssl.alpn_h2 = params.http2_enable;
+    if(params.ssl_session_reuse)
+        largs->ssl.sessions_count = remotes_max;
+    largs->serialize_output_lock = &eng->serialize_output_lock;
+    largs->scratch_recv_size =
+        params.read_buffer_size ? params.read_buffer_size : 16384;
+    largs->scratch_recv_buf = malloc(largs->scratch_recv_size);
+    assert(largs->scratch_recv_buf);
+    if(params.zerocopy_receive) {
+        largs->zerocopy_rx_page = sysconf(_SC_PAGESIZE);
+        largs->zerocopy_rx_size = largs->scratch_recv_size
+                                  / largs->zerocopy_rx_page
+                                  * largs->zerocopy_rx_page;
+    }
+    if(params.keepalive_expr) {
+        /* The same bytes for all the connections, as a client would send. */
+        ssize_t s = eval_expression(&largs->keepalive_data, 0,
+                                    params.keepalive_expr, NULL, NULL, NULL, 1,
+                                    &largs->rng);
+        assert(s >= 0);
+        largs->keepalive_size = s;
+    } else if(params.mqtt_version && params.keepalive_interval > 0.0) {
+        largs->keepalive_data = malloc(MQTT_PINGREQ_SIZE);
+        assert(largs->keepalive_data);
+        largs->keepalive_size = mqtt_pingreq((uint8_t *)largs->keepalive_data);
+    }
+    tk_clock_init(&largs->clock, params.latency_clock);
+    if(params.latency_setting & SLT_CONNECT)
+        largs->connect_histogram_local = latency_histogram_new(params.latency_max);
+    if(params.latency_setting & SLT_FIRSTBYTE)
+        largs->firstbyte_histogram_local = latency_histogram_new(params.latency_max);
+    if(params.latency_setting & SLT_HANDSHAKE)
+        largs->handshake_histogram_local = latency_histogram_new(params.latency_max);
+    if(params.latency_setting & SLT_UPGRADE)
+        largs->upgrade_histogram_local = latency_histogram_new(params.latency_max);
+    if(params.latency_setting & SLT_MARKER) {
+        largs->marker_histogram_local = latency_histogram_new(params.latency_max);
+        DEBUG(DBG_DETAIL, "Initialized HdrHistogram with size %ld\n",
+              (long)hdr_get_memory_size(largs->marker_histogram_local));
+    }
+    largs->connect_histogram_shared.histogram =
+        hdr_init_similar(largs->connect_histogram_local);
+    largs->firstbyte_histogram_shared.histogram =
+        hdr_init_similar(largs->firstbyte_histogram_local);
+    largs->handshake_histogram_shared.histogram =
+        hdr_init_similar(largs->handshake_histogram_local);
+    largs->upgrade_histogram_shared.histogram =
+        hdr_init_similar(largs->upgrade_histogram_local);
+    largs->marker_histogram_shared.histogram =
+        hdr_init_similar(largs->marker_histogram_local);
+    if(params.latency_correction == LCM_BOTH) {
+        largs->marker_uncorrected_histogram_local =
+            hdr_init_similar(largs->marker_histogram_local);
+        largs->marker_uncorrected_histogram_shared.histogram =
+            hdr_init_similar(largs->marker_histogram_local);
+    }
+    if(params.tcp_info || params.mptcp || params.tcp_fastopen) {
+        for(int m = 0; m < ETI_METRICS; m++) {
+            /* Microseconds for the RTT, kbit/s for the rate, counts
+             * for the rest. */
+            int ret = hdr_init(1, 100 * 1000000, 2,
+                               &largs->tcp_info_histogram_local[m]);
+            assert(ret == 0);
+            largs->tcp_info_histogram_shared[m].histogram =
+                hdr_init_similar(largs->tcp_info_histogram_local[m]);
+        }
+    }
+    if(params.latency_setting && params.remote_addresses.n_addrs > 1
+       && params.remote_addresses.n_addrs <= ENGINE_REMOTE_LATENCY_MAX) {
+        largs->remote_latency = remote_latency_new(
+            largs, params.remote_addresses.n_addrs);
+        largs->remote_latency_count = params.remote_addresses.n_addrs;
+    }
+    if(params.n_groups) {
+        largs->group_stats =
+            calloc(params.n_groups, sizeof(largs->group_stats[0]));
+        assert(largs->group_stats);
+        for(size_t i = 0; i < params.n_groups; i++)
+            largs->group_stats[i].address_offset = n;
+        if(params.latency_setting)
+            largs->group_latency = remote_latency_new(largs, params.n_groups);
     }
 
-    return eng;
+    int private_pipe[2];
+    int rc = pipe(private_pipe);
+    assert(rc == 0);
+    largs->private_control_pipe_rd = private_pipe[0];
+    largs->private_control_pipe_wr = private_pipe[1];
+    largs->global_control_pipe_rd_nbio = eng->global_control_pipe_rd;
+    pcg32_srandom_r(&largs->rng, random(), n);
+    if(eng->recorder) {
+        largs->record_ring = recorder_ring(eng->recorder, n);
+        largs->record_clock_offset = eng->record_clock_offset;
+    }
+    if(eng->logpipe) largs->log_ring = logpipe_ring(eng->logpipe, n);
+    if(eng->connstats)
+        largs->connstats_ring = connstats_ring(eng->connstats, n);
+    if(eng->closer) largs->closer_ring = closer_ring(eng->closer, n);
+    if(eng->sampler) largs->sample_ring = sampler_ring(eng->sampler, n);
+}
+
+/*
+ * Start the thread of the n-th worker, set up by worker_setup().
+ */
+static void
+worker_launch(struct engine *eng, int n) {
+    struct loop_arguments *largs = &eng->loops[n];
+
+    /* The rate might have been changed since the start. */
+    largs->params.channel_send_rate = eng->params.channel_send_rate;
+    atomic_exchange(&largs->connections_to_close, 0);
+    double max_lag = largs->loop_local.max_lag;
+    memset(&largs->loop_local, 0, sizeof(largs->loop_local));
+    largs->loop_local.max_lag = max_lag;
+
+    int rc = pthread_create(&eng->threads[n], 0, single_engine_loop_thread,
+                            largs);
+    assert(rc == 0);
 }
 
 /*
@@ -409,16 +1345,18 @@ engine_start(struct engine_params params) {
  */
 static void
 print_latency_hdr_histrogram_percentiles(
-    const char *title, const struct percentile_values *report_percentiles,
+    const char *indent, const char *title,
+    const struct percentile_values *report_percentiles,
     struct hdr_histogram *histogram) {
     assert(histogram);
 
     size_t size = report_percentiles->size;
 
-    printf("%s latency at percentiles: ", title);
+    printf("%s%s latency at percentiles: ", indent, title);
     for(size_t i = 0; i < size; i++) {
         double per_d = report_percentiles->values[i].value_d;
-        printf("%.1f%s", hdr_value_at_percentile(histogram, per_d) / 10.0,
+        printf("%.*f%s", latency_ms_precision(),
+               latency_to_ms(hdr_value_at_percentile(histogram, per_d)),
                i == size - 1 ? "" : "/");
     }
     printf(" ms (");
@@ -430,73 +1368,718 @@ print_latency_hdr_histrogram_percentiles(
 }
 
 static void
-latency_snapshot_print(const struct percentile_values *latency_percentiles,
+latency_snapshot_print(const char *indent,
+                       const struct percentile_values *latency_percentiles,
                        const struct latency_snapshot *latency) {
     if(latency->connect_histogram) {
-        print_latency_hdr_histrogram_percentiles(
-            "TCP connect", latency_percentiles, latency->connect_histogram);
+        print_latency_hdr_histrogram_percentiles(indent, "TCP connect",
+                                                 latency_percentiles,
+                                                 latency->connect_histogram);
     }
     if(latency->firstbyte_histogram) {
-        print_latency_hdr_histrogram_percentiles("First byte", latency_percentiles,
+        print_latency_hdr_histrogram_percentiles(indent, "First byte",
+                                                 latency_percentiles,
                                                  latency->firstbyte_histogram);
     }
+    if(latency->handshake_histogram) {
+        print_latency_hdr_histrogram_percentiles(indent, "TLS handshake",
+                                                 latency_percentiles,
+                                                 latency->handshake_histogram);
+    }
+    if(latency->upgrade_histogram) {
+        print_latency_hdr_histrogram_percentiles(indent, "WebSocket upgrade",
+                                                 latency_percentiles,
+                                                 latency->upgrade_histogram);
+    }
     if(latency->marker_histogram) {
-        print_latency_hdr_histrogram_percentiles("Message", latency_percentiles,
+        print_latency_hdr_histrogram_percentiles(indent, "Message",
+                                                 latency_percentiles,
                                                  latency->marker_histogram);
     }
+    if(latency->marker_uncorrected_histogram) {
+        print_latency_hdr_histrogram_percentiles(
+            indent, "Uncorrected message", latency_percentiles,
+            latency->marker_uncorrected_histogram);
+    }
+}
+
+static void
+tcp_info_snapshot_print(const struct percentile_values *percentiles,
+                        const struct tcp_info_snapshot *tcp_info) {
+    static const struct {
+        const char *title;
+        double divisor;
+        int precision;
+        const char *unit;
+    } metrics[ETI_METRICS] = {
+        [ETI_RTT] = {"TCP RTT", 1000.0, 3, " ms"},
+        [ETI_RETRANSMITS] = {"TCP retransmits", 1, 0, ""},
+        [ETI_CWND] = {"TCP cwnd", 1, 0, " segments"},
+        [ETI_UNACKED] = {"TCP unacked", 1, 0, " segments"},
+        [ETI_MPTCP_SUBFLOWS] = {"MPTCP subflows", 1, 0, ""},
+        [ETI_MPTCP_SUBFLOW_RATE] = {"MPTCP subflow rate", 1000.0, 3,
+                                    " Mbps"}};
+
+    if(tcp_info->mptcp_connections) {
+        printf("MPTCP connections: %zu, fallen back to TCP: %zu\n",
+               tcp_info->mptcp_connections, tcp_info->mptcp_fallbacks);
+    }
+    if(tcp_info->fastopen_connections) {
+        printf("TCP Fast Open: SYN data accepted on %zu of %zu connections "
+               "(%.1f%%)\n",
+               tcp_info->fastopen_accepted, tcp_info->fastopen_connections,
+               100.0 * tcp_info->fastopen_accepted
+                   / tcp_info->fastopen_connections);
+    }
+
+    for(int m = 0; m < ETI_METRICS; m++) {
+        struct hdr_histogram *histogram = tcp_info->histogram[m];
+        /* Only --tcp-info samples the TCP, only --mptcp the MPTCP ones. */
+        if(histogram->total_count == 0) continue;
+        printf("%s at percentiles: ", metrics[m].title);
+        for(size_t i = 0; i < percentiles->size; i++) {
+            printf("%.*f%s", metrics[m].precision,
+                   hdr_value_at_percentile(histogram,
+                                           percentiles->values[i].value_d)
+                       / metrics[m].divisor,
+                   i == percentiles->size - 1 ? "" : "/");
+        }
+        printf("%s (", metrics[m].unit);
+        for(size_t i = 0; i < percentiles->size; i++) {
+            printf("%s%s", percentiles->values[i].value_s,
+                   i == percentiles->size - 1 ? "" : "/");
+        }
+        printf("%%)\n");
+    }
 }
 
 /*
- * Estimate packets per second.
+ * Print the traffic, connection failures and latencies of each destination.
  */
-static unsigned int
-estimate_segments_per_op(non_atomic_wide_t ops, non_atomic_wide_t bytes) {
-    const int tcp_mss = 1460; /* TCP Maximum Segment Size, estimate! */
-    return ops ? ((bytes / ops) + (tcp_mss - 1)) / tcp_mss : 0;
+static void
+remote_summary_print(const struct engine_params *params,
+                     const struct percentile_values *latency_percentiles,
+                     const struct engine_summary *summary) {
+    printf("Per-destination totals:\n");
+    for(size_t i = 0; i < summary->n_remotes; i++) {
+        const struct engine_remote_summary *rs = &summary->remotes[i];
+        char addr_buf[INET6_ADDRSTRLEN + 64];
+        char rcvd_buf[64];
+        char sent_buf[64];
+        printf("  %s: %s↓, %s↑, %zu connection%s (%zu failed)\n",
+               format_sockaddr(&params->remote_addresses.addrs[i], addr_buf,
+                               sizeof(addr_buf)),
+               express_bytes(rs->traffic.bytes_rcvd, rcvd_buf,
+                             sizeof(rcvd_buf)),
+               express_bytes(rs->traffic.bytes_sent, sent_buf,
+                             sizeof(sent_buf)),
+               rs->connection_attempts,
+               rs->connection_attempts == 1 ? "" : "s",
+               rs->connection_failures);
+        if(rs->latency) {
+            latency_snapshot_print("    ", latency_percentiles, rs->latency);
+        }
+    }
 }
-static double
-estimate_pps(double duration, non_atomic_wide_t ops, non_atomic_wide_t bytes) {
-    unsigned packets_per_op = estimate_segments_per_op(ops, bytes);
-    return (packets_per_op * ops) / duration;
+
+static void
+group_summary_print(const struct engine_params *params,
+                    const struct percentile_values *latency_percentiles,
+                    const struct engine_summary *summary) {
+    printf("Per-group totals:\n");
+    for(size_t i = 0; i < summary->n_groups && i < params->n_groups; i++) {
+        const struct engine_group_summary *gs = &summary->groups[i];
+        char rcvd_buf[64];
+        char sent_buf[64];
+        printf("  %s (%g%%): %s↓, %s↑, %" PRIaw " connection%s, "
+               "%" PRIaw " messages↓, %" PRIaw " messages↑\n",
+               params->groups[i].name, 100 * params->groups[i].share,
+               express_bytes(gs->traffic.bytes_rcvd, rcvd_buf,
+                             sizeof(rcvd_buf)),
+               express_bytes(gs->traffic.bytes_sent, sent_buf,
+                             sizeof(sent_buf)),
+               gs->traffic.conns_opened,
+               gs->traffic.conns_opened == 1 ? "" : "s",
+               gs->traffic.msgs_rcvd, gs->traffic.msgs_sent);
+        if(gs->latency) {
+            latency_snapshot_print("    ", latency_percentiles, gs->latency);
+        }
+    }
 }
 
-void
-engine_update_workers_send_rate(struct engine *eng, rate_spec_t rate_spec) {
-    /*
-     * Ask workers to recompute per-connection rates.
-     */
-    eng->params.channel_send_rate = rate_spec;
-    for(int n = 0; n < eng->n_workers; n++) {
-        int rc = write(eng->loops[n].private_control_pipe_wr, "r", 1);
-        assert(rc == 1);
+/*
+ * Print the accepted connections' numbers by the peer, see --per-peer-stats.
+ */
+static void
+peer_summary_print(const struct engine_summary *summary) {
+    printf("Per-peer totals:\n");
+    for(size_t i = 0; i < summary->n_peers; i++) {
+        const struct peer_stats *peer = &summary->peers[i];
+        char peer_buf[INET6_ADDRSTRLEN + 16];
+        char rcvd_buf[64];
+        char sent_buf[64];
+        printf("  %s: %s↓, %s↑, %" PRIaw " connection%s, "
+               "%" PRIaw " messages↓, %" PRIaw " messages↑",
+               peer_stats_format(peer, peer_buf, sizeof(peer_buf)),
+               express_bytes(peer->traffic.bytes_rcvd, rcvd_buf,
+                             sizeof(rcvd_buf)),
+               express_bytes(peer->traffic.bytes_sent, sent_buf,
+                             sizeof(sent_buf)),
+               peer->traffic.conns_opened,
+               peer->traffic.conns_opened == 1 ? "" : "s",
+               peer->traffic.msgs_rcvd, peer->traffic.msgs_sent);
+        if(peer->latency_count) {
+            printf(", latency mean %.1f max %.1f ms",
+                   1000 * peer->latency_sum / peer->latency_count,
+                   1000 * peer->latency_max);
+        }
+        printf("\n");
+    }
+    if(summary->n_peers > 1) {
+        printf("Peer fairness: %.3f (Jain's index of the bytes, 1.0 is even)\n",
+               peer_stats_fairness(summary->peers, summary->n_peers));
     }
 }
 
-rate_spec_t
-engine_set_message_send_rate(struct engine *eng, double msg_rate) {
-    rate_spec_t new_rate = RATE_MPS(msg_rate);
-    engine_update_workers_send_rate(eng, new_rate);
-    return new_rate;
+/*
+ * Print the --grpc calls by their grpc-status.
+ */
+static void
+grpc_summary_print(const struct engine_summary *summary) {
+    uint64_t failed = 0;
+    for(int c = 1; c <= GRPC_STATUS_CODES; c++)
+        failed += summary->grpc_calls[c];
+    printf("gRPC calls: %" PRIu64 " OK, %" PRIu64 " failed",
+           summary->grpc_calls[0], failed);
+    const char *sep = ": ";
+    for(int c = 1; c <= GRPC_STATUS_CODES; c++) {
+        if(!summary->grpc_calls[c]) continue;
+        printf("%s%" PRIu64 " %s", sep, summary->grpc_calls[c],
+               grpc_status_name(c));
+        sep = ", ";
+    }
+    printf("\n");
 }
 
-rate_spec_t
-engine_update_send_rate(struct engine *eng, double multiplier) {
-    rate_spec_t new_rate = eng->params.channel_send_rate;
-    new_rate.value = new_rate.value * multiplier;
-    engine_update_workers_send_rate(eng, new_rate);
-    return new_rate;
+/*
+ * Print what the --mirror twins have moved, next to the totals
+ * of their connections.
+ */
+static void
+mirror_summary_print(const struct engine_summary *summary) {
+    const struct engine_mirror_summary *ms = &summary->mirror;
+    char sent[64], rcvd[64];
+    printf("Mirror connections: %zu opened, %zu failed\n", ms->opened,
+           ms->failed);
+    printf("Mirror data sent: %s, received: %s, not mirrored: %" PRIu64
+           " bytes\n",
+           express_bytes(ms->bytes_sent, sent, sizeof(sent)),
+           express_bytes(ms->bytes_rcvd, rcvd, sizeof(rcvd)),
+           ms->bytes_dropped);
 }
 
 /*
- * Send a signal to finish work and wait for all workers to terminate.
+ * Print the min/p1/p50/max of the --sample-interval numbers,
+ * multiplied by (scale).
  */
-void
-engine_terminate(struct engine *eng, double epoch,
-                 non_atomic_traffic_stats initial_traffic_stats,
-                 struct percentile_values *latency_percentiles) {
-    size_t connecting, conn_in, conn_out, conn_counter;
+static void
+throughput_spread_print(struct hdr_histogram *h, double scale,
+                        const char *suffix) {
+    printf("%.3f/%.3f/%.3f/%.3f%s", hdr_min(h) * scale,
+           hdr_value_at_percentile(h, 1.0) * scale,
+           hdr_value_at_percentile(h, 50.0) * scale, hdr_max(h) * scale,
+           suffix);
+}
 
-    engine_get_connection_stats(eng, &connecting, &conn_in, &conn_out,
+/*
+ * Print the spread of the rates over the --sample-interval intervals,
+ * which shows the bursts and stalls the aggregate rates average out.
+ */
+static void
+throughput_summary_print(const struct engine_params *params,
+                         const struct engine_summary *summary, int messages) {
+    struct hdr_histogram *const *h = summary->throughput;
+    double per_second = 1.0 / params->sample_interval;
+
+    if(!h[SM_BYTES_RCVD]->total_count) {
+        printf("Throughput per %g ms: no complete intervals\n",
+               1000 * params->sample_interval);
+        return;
+    }
+    printf("Throughput per %g ms, min/p1/p50/max of %" PRId64
+           " intervals:\n",
+           1000 * params->sample_interval, h[SM_BYTES_RCVD]->total_count);
+    printf("  Bandwidth:    ");
+    throughput_spread_print(h[SM_BYTES_RCVD], 8 * per_second / 1000000.0,
+                            "↓ Mbps\n");
+    printf("                ");
+    throughput_spread_print(h[SM_BYTES_SENT], 8 * per_second / 1000000.0,
+                            "↑ Mbps\n");
+    if(messages) {
+        printf("  Message rate: ");
+        throughput_spread_print(h[SM_MSGS_RCVD], per_second, "↓ mps\n");
+        printf("                ");
+        throughput_spread_print(h[SM_MSGS_SENT], per_second, "↑ mps\n");
+    }
+}
+
+/*
+ * Print the message latencies against the rate they were measured at.
+ */
+static void
+rate_step_summary_print(const struct percentile_values *latency_percentiles,
+                        const struct engine_summary *summary) {
+    printf("Per-rate-step latencies:\n");
+    for(size_t i = 0; i < summary->n_rate_steps; i++) {
+        const struct engine_rate_step_summary *rs = &summary->rate_steps[i];
+        char title[128];
+        snprintf(title, sizeof(title),
+                 "At %g %s for %.1fs (%.1f mps↓), message", rs->rate.value,
+                 rs->rate.value_base == RS_BYTES_PER_SECOND ? "Bps" : "mps",
+                 rs->duration,
+                 rs->duration > 0 ? rs->histogram->total_count / rs->duration
+                                  : 0.0);
+        print_latency_hdr_histrogram_percentiles("  ", title,
+                                                 latency_percentiles,
+                                                 rs->histogram);
+    }
+}
+
+/*
+ * Print the --fanout deliveries per subscriber and their quality.
+ */
+static void
+fanout_summary_print(const non_atomic_traffic_stats *traffic,
+                     struct hdr_histogram *deliveries) {
+    double delivered = traffic->msgs_rcvd - traffic->msgs_duplicated;
+    double expected = delivered + traffic->msgs_lost;
+    printf("Fan-out: %" PRId64 " subscribers, %" PRId64 "/%" PRId64
+           "/%" PRId64 " min/median/max messages each\n",
+           deliveries->total_count, hdr_min(deliveries),
+           hdr_value_at_percentile(deliveries, 50.0), hdr_max(deliveries));
+    printf("Fan-out duplicated: %" PRIu64 " (%.3f%%), missing: %" PRIu64
+           " (%.3f%%)\n",
+           (uint64_t)traffic->msgs_duplicated,
+           traffic->msgs_rcvd ? 100.0 * traffic->msgs_duplicated
+                                    / traffic->msgs_rcvd
+                              : 0.0,
+           (uint64_t)traffic->msgs_lost,
+           expected > 0 ? 100.0 * traffic->msgs_lost / expected : 0.0);
+}
+
+/*
+ * Print the --latency-by-size message latencies.
+ */
+static void
+size_class_summary_print(const struct percentile_values *latency_percentiles,
+                         const struct engine_summary *summary) {
+    printf("Latencies by message size:\n");
+    for(size_t i = 0; i < summary->n_size_classes; i++) {
+        const struct engine_size_class_summary *sc = &summary->size_classes[i];
+        char title[128];
+        if(sc->size_max)
+            snprintf(title, sizeof(title), "%zu..%zu bytes, message",
+                     sc->size_min, sc->size_max);
+        else
+            snprintf(title, sizeof(title), "%zu+ bytes, message",
+                     sc->size_min);
+        print_latency_hdr_histrogram_percentiles("  ", title,
+                                                 latency_percentiles,
+                                                 sc->histogram);
+    }
+}
+
+/*
+ * Print the --latency-slowest messages.
+ */
+static void
+slowest_summary_print(const struct engine_params *params,
+                      const struct engine_summary *summary) {
+    printf("Slowest messages:\n");
+    for(size_t i = 0; i < summary->n_slowest; i++) {
+        const struct engine_slow_message *sm = &summary->slowest[i];
+        char addr_buf[INET6_ADDRSTRLEN + 64];
+        char inflight_buf[64];
+        const char *remote = "incoming";
+        if(sm->remote_index >= 0
+           && (size_t)sm->remote_index < params->remote_addresses.n_addrs) {
+            remote = format_sockaddr(
+                &params->remote_addresses.addrs[sm->remote_index], addr_buf,
+                sizeof(addr_buf));
+        }
+        printf("  %.1f ms, connection %u (%s), %.3f s old, %s in flight\n",
+               1000 * sm->latency, sm->connection_uid, remote,
+               sm->connection_age,
+               express_bytes(sm->bytes_in_flight, inflight_buf,
+                             sizeof(inflight_buf)));
+    }
+}
+
+/*
+ * Estimate packets per second.
+ */
+static unsigned int
+estimate_segments_per_op(non_atomic_wide_t ops, non_atomic_wide_t bytes) {
+    const int tcp_mss = 1460; /* TCP Maximum Segment Size, estimate! */
+    return ops ? ((bytes / ops) + (tcp_mss - 1)) / tcp_mss : 0;
+}
+static double
+estimate_pps(double duration, non_atomic_wide_t ops, non_atomic_wide_t bytes) {
+    unsigned packets_per_op = estimate_segments_per_op(ops, bytes);
+    return (packets_per_op * ops) / duration;
+}
+
+/*
+ * Make the new rate visible to the workers. Rather than being woken up
+ * through the control pipe, the workers notice the new version as they
+ * go, and the connections adjust to it before they send again.
+ * With (restart_pace), the connections start their sending schedule anew.
+ */
+static void
+engine_publish_send_rate(struct engine *eng, rate_spec_t rate_spec,
+                         int restart_pace) {
+    non_atomic_narrow_t version = atomic_inc_and_get(&eng->send_rate.sequence);
+    eng->params.channel_send_rate = rate_spec;
+    if(restart_pace) eng->send_rate.restarted = version + 1;
+    atomic_increment(&eng->send_rate.sequence);
+}
+
+void
+engine_update_workers_send_rate(struct engine *eng, rate_spec_t rate_spec) {
+    struct rate_step *steps = realloc(
+        eng->rate_steps, (eng->n_rate_steps + 1) * sizeof(steps[0]));
+    assert(steps);
+    steps[eng->n_rate_steps].rate = rate_spec;
+    steps[eng->n_rate_steps].start = tk_now(TK_DEFAULT);
+    eng->rate_steps = steps;
+    unsigned step = eng->n_rate_steps++;
+
+    for(int n = 0; n < eng->n_loops; n++)
+        atomic_exchange(&eng->loops[n].rate_step, step);
+    engine_publish_send_rate(eng, rate_spec, 1);
+}
+
+void
+engine_follow_message_send_rate(struct engine *eng, double msg_rate) {
+    engine_publish_send_rate(eng, RATE_MPS(msg_rate), 0);
+}
+
+int
+engine_set_message(struct engine *eng, const char *data, size_t size) {
+    const char *incompatible = NULL;
+    if(eng->params.corpus)
+        incompatible = "--message-corpus";
+    else if(eng->params.replay)
+        incompatible = "--replay-pcap";
+    else if(eng->params.http2_enable)
+        incompatible = "--http2";
+    if(incompatible) {
+        fprintf(stderr, "SetMessage is not compatible with %s, ignored\n",
+                incompatible);
+        return -1;
+    }
+
+    non_atomic_narrow_t n = atomic_get(&eng->n_message_sets);
+    if(n == MESSAGE_SETS_MAX) {
+        fprintf(stderr, "Too many SetMessage commands, ignored\n");
+        return -1;
+    }
+
+    /* Check the expression first, message_collection_add() would exit. */
+    tk_expr_t *expr = NULL;
+    if(parse_expression(&expr, data, size, 1) == -1) return -1;
+    free_expression(expr, 0);
+
+    struct message_collection messages;
+    memset(&messages, 0, sizeof(messages));
+    message_collection_add(&messages, MSK_PURPOSE_MESSAGE, (void *)data, size,
+                           0, 1);
+    /* The --message is sent as an inline command. */
+    if(eng->params.resp_enable)
+        message_collection_add(&messages, MSK_PURPOSE_MESSAGE, "\r\n", 2, 0,
+                               0);
+
+    const char *unusable = NULL;
+    if(message_collection_has(&messages, EXPR_MESSAGE_MARKER)
+       && !eng->params.message_marker)
+        unusable = "\\{message.marker} requires --message-marker at start";
+    for(size_t i = 0; i < messages.snippets_count; i++) {
+        tk_expr_t *snip_expr = messages.snippets[i].expr;
+        if(!snip_expr) continue;
+        if(eng->params.udp && !expression_has_fixed_size(snip_expr))
+            unusable = "--udp requires the messages of a fixed size";
+        if(eng->params.message_marker_binary)
+            expression_set_marker_size(snip_expr, MESSAGE_MARKER_BINARY_SIZE);
+    }
+    if(unusable) {
+        fprintf(stderr, "SetMessage: %s, ignored\n", unusable);
+        message_collection_free(&messages);
+        return -1;
+    }
+
+    struct message_set *set = calloc(1, sizeof(*set));
+    assert(set);
+    message_collection_replace_messages(&eng->params.message_collection,
+                                        &messages, &set->message_collection);
+    prepare_data_templates(&set->message_collection, set->data_templates);
+
+    /* The workers see the set once they see the new count. */
+    eng->message_sets[n] = set;
+    atomic_increment(&eng->n_message_sets);
+    return 0;
+}
+
+void
+engine_reset_latency(struct engine *eng) {
+    for(int n = 0; n < eng->n_loops; n++) {
+        if(n < eng->n_workers) {
+            int rc = write(eng->loops[n].private_control_pipe_wr, "w", 1);
+            assert(rc == 1);
+        } else {
+            /* The retired workers are joined, nothing else touches these. */
+            worker_reset_histograms(&eng->loops[n]);
+        }
+    }
+    for(int m = 0; m < SAMPLE_METRICS; m++) {
+        if(eng->throughput[m]) hdr_reset(eng->throughput[m]);
+    }
+}
+
+int
+engine_next_sample(struct engine *eng, double from,
+                   struct throughput_sample *sample, double *start) {
+    if(!eng->sampler || !sampler_next(eng->sampler, eng->n_workers, sample))
+        return 0;
+
+    double interval = eng->worker_params.sample_interval;
+    *start = eng->worker_params.epoch + sample->interval * interval;
+    /* The interval cut by the (from) is left out as incomplete. */
+    if(*start >= from) {
+        for(int m = 0; m < SAMPLE_METRICS; m++)
+            hdr_record_value(eng->throughput[m], sample->value[m]);
+    }
+    return 1;
+}
+
+size_t
+engine_close_connections(struct engine *eng, size_t n_req) {
+    /* Split the request evenly, like engine_initiate_new_connections(). */
+    size_t per_worker = n_req / eng->n_workers;
+    size_t remainder = n_req % eng->n_workers;
+    size_t n = 0;
+    for(int i = 0; i < eng->n_workers; i++) {
+        size_t share = per_worker + ((size_t)i < remainder ? 1 : 0);
+        struct loop_arguments *largs = &eng->loops[i];
+        n += share;
+        /*
+         * Replace rather than add to the outstanding request: the caller
+         * repeats it until the connection counts catch up.
+         */
+        if(atomic_exchange(&largs->connections_to_close, share) != 0
+           || share == 0)
+            continue; /* The worker is already signalled */
+        for(;;) {
+            int wrote = write(largs->private_control_pipe_wr, "x", 1);
+            if(wrote == -1 && errno == EINTR) continue;
+            assert(wrote == 1);
+            break;
+        }
+    }
+    return n;
+}
+
+rate_spec_t
+engine_set_message_send_rate(struct engine *eng, double msg_rate) {
+    rate_spec_t new_rate = RATE_MPS(msg_rate);
+    engine_update_workers_send_rate(eng, new_rate);
+    return new_rate;
+}
+
+rate_spec_t
+engine_update_send_rate(struct engine *eng, double multiplier) {
+    rate_spec_t new_rate = eng->params.channel_send_rate;
+    new_rate.value = new_rate.value * multiplier;
+    engine_update_workers_send_rate(eng, new_rate);
+    return new_rate;
+}
+
+/*
+ * Merge the --latency-by-size histograms across the workers.
+ * The workers are stopped by now.
+ */
+static void
+collect_size_classes(struct engine *eng, struct engine_summary *summary) {
+    if(!eng->params.latency_by_size) return;
+
+    summary->size_classes =
+        calloc(MESSAGE_SIZE_CLASSES, sizeof(summary->size_classes[0]));
+    assert(summary->size_classes);
+    size_t size_min = 0;
+    size_t size_max = MESSAGE_SIZE_CLASS_MIN;
+    for(int c = 0; c < MESSAGE_SIZE_CLASSES; c++, size_max *= 4) {
+        struct hdr_histogram *merged = NULL;
+        for(int n = 0; n < eng->n_loops; n++) {
+            struct hdr_histogram *h = eng->loops[n].size_class_histograms[c];
+            if(!h) continue;
+            if(!merged) merged = hdr_init_similar(h);
+            hdr_add(merged, h);
+            free(h);
+            eng->loops[n].size_class_histograms[c] = NULL;
+        }
+        if(merged && merged->total_count) {
+            struct engine_size_class_summary *sc =
+                &summary->size_classes[summary->n_size_classes++];
+            sc->size_min = size_min;
+            sc->size_max = c < MESSAGE_SIZE_CLASSES - 1 ? size_max : 0;
+            sc->histogram = merged;
+        } else {
+            free(merged);
+        }
+        size_min = size_max + 1;
+    }
+}
+
+/*
+ * Merge the --fanout deliveries of the subscribers, which the workers
+ * recorded as they closed the connections. The workers are stopped by now.
+ */
+static void
+collect_fanout(struct engine *eng, struct engine_summary *summary) {
+    for(int n = 0; n < eng->n_loops; n++) {
+        struct hdr_histogram *h = eng->loops[n].fanout_deliveries;
+        if(!h) continue;
+        if(!summary->fanout_deliveries)
+            summary->fanout_deliveries = hdr_init_similar(h);
+        hdr_add(summary->fanout_deliveries, h);
+        free(h);
+        eng->loops[n].fanout_deliveries = NULL;
+    }
+}
+
+static int
+slow_message_cmp(const void *ap, const void *bp) {
+    const struct engine_slow_message *a = ap;
+    const struct engine_slow_message *b = bp;
+    return (a->latency < b->latency) - (a->latency > b->latency);
+}
+
+/*
+ * Merge the --latency-slowest messages of the workers,
+ * keeping the slowest of them. The workers are stopped by now.
+ */
+static void
+collect_slowest(struct engine *eng, struct engine_summary *summary) {
+    if(!eng->params.latency_slowest) return;
+
+    size_t total = 0;
+    for(int n = 0; n < eng->n_loops; n++) total += eng->loops[n].n_slowest;
+    summary->slowest = calloc(total ? total : 1, sizeof(summary->slowest[0]));
+    assert(summary->slowest);
+    for(int n = 0; n < eng->n_loops; n++) {
+        struct loop_arguments *largs = &eng->loops[n];
+        memcpy(&summary->slowest[summary->n_slowest], largs->slowest,
+               largs->n_slowest * sizeof(largs->slowest[0]));
+        summary->n_slowest += largs->n_slowest;
+        free(largs->slowest);
+        largs->slowest = NULL;
+        largs->n_slowest = 0;
+    }
+    qsort(summary->slowest, summary->n_slowest, sizeof(summary->slowest[0]),
+          slow_message_cmp);
+    if(summary->n_slowest > (size_t)eng->params.latency_slowest)
+        summary->n_slowest = eng->params.latency_slowest;
+}
+
+/*
+ * Send a signal to finish work and wait for all workers to terminate.
+ */
+/*
+ * Merge the marker latencies of each rate step across the workers.
+ * The workers are stopped by now.
+ */
+static void
+collect_rate_steps(struct engine *eng, struct engine_summary *summary) {
+    if(eng->n_rate_steps < 2 || !eng->loops[0].marker_histogram_local)
+        return;
+
+    struct hdr_histogram **histograms =
+        calloc(eng->n_rate_steps, sizeof(histograms[0]));
+    assert(histograms);
+    for(int n = 0; n < eng->n_loops; n++) {
+        struct loop_arguments *largs = &eng->loops[n];
+        for(size_t i = 0; i <= largs->n_marker_steps; i++) {
+            /* The current step, as published upon termination, is last. */
+            unsigned step = i < largs->n_marker_steps
+                                ? largs->marker_steps[i].step
+                                : largs->marker_step;
+            struct hdr_histogram *h =
+                i < largs->n_marker_steps
+                    ? largs->marker_steps[i].histogram
+                    : largs->marker_histogram_shared.histogram;
+            if(!histograms[step]) histograms[step] = hdr_init_similar(h);
+            hdr_add(histograms[step], h);
+            if(i < largs->n_marker_steps) free(h);
+        }
+        free(largs->marker_steps);
+        largs->marker_steps = NULL;
+        largs->n_marker_steps = 0;
+    }
+
+    /* Only the steps with the latencies kept are reported. */
+    summary->rate_steps =
+        calloc(eng->n_rate_steps, sizeof(summary->rate_steps[0]));
+    assert(summary->rate_steps);
+    double now = tk_now(TK_DEFAULT);
+    for(size_t i = 0; i < eng->n_rate_steps; i++) {
+        if(!histograms[i] || !histograms[i]->total_count) {
+            free(histograms[i]);
+            continue;
+        }
+        struct engine_rate_step_summary *rs =
+            &summary->rate_steps[summary->n_rate_steps++];
+        rs->rate = eng->rate_steps[i].rate;
+        rs->duration = (i + 1 < eng->n_rate_steps ? eng->rate_steps[i + 1].start
+                                                  : now)
+                       - eng->rate_steps[i].start;
+        rs->histogram = histograms[i];
+    }
+    free(histograms);
+}
+
+/*
+ * The connections migrate between the workers, and so does the memory of
+ * the --hugepages arenas. Those are only unmapped once all workers are done.
+ */
+static void
+huge_arenas_free(struct engine *eng) {
+    size_t hugetlb = 0, thp = 0;
+    for(int n = 0; n < eng->n_loops; n++) {
+        struct tk_huge_arena *arena = eng->loops[n].huge_arena;
+        if(!arena) continue;
+        size_t h, t;
+        tk_huge_arena_stats(arena, &h, &t);
+        hugetlb += h;
+        thp += t;
+        tk_huge_arena_free(arena);
+        eng->loops[n].huge_arena = NULL;
+    }
+    if(eng->params.hugepages) {
+        fprintf(stderr,
+                "Huge pages: %zu reserved and %zu transparent 2MB chunks "
+                "used\n",
+                hugetlb, thp);
+    }
+}
+
+void
+engine_stop(struct engine *eng, double epoch,
+            non_atomic_traffic_stats initial_traffic_stats,
+            struct engine_summary *summary) {
+    size_t connecting, conn_in, conn_out, conn_counter;
+
+    memset(summary, 0, sizeof(*summary));
+
+    engine_get_connection_stats(eng, &connecting, &conn_in, &conn_out,
                                 &conn_counter);
 
     /*
@@ -508,26 +2091,256 @@ engine_terminate(struct engine *eng, double epoch,
     }
 
     for(int n = 0; n < eng->n_workers; n++) {
-        struct loop_arguments *largs = &eng->loops[n];
         void *value;
         pthread_join(eng->threads[n], &value);
-        add_traffic_numbers_AtoN(&largs->worker_traffic_stats,
+    }
+    for(int n = 0; n < eng->n_loops; n++) {
+        add_traffic_numbers_AtoN(&eng->loops[n].worker_traffic_stats,
                                  &eng->total_traffic_stats);
     }
+    huge_arenas_free(eng);
+    free(eng->remote_quotas);
+    eng->remote_quotas = NULL;
+
+    if(eng->params.zerocopy_receive) {
+        non_atomic_wide_t mapped = 0;
+        for(int n = 0; n < eng->n_loops; n++)
+            mapped += atomic_wide_get(&eng->loops[n].zerocopy_rx_bytes);
+        fprintf(stderr,
+                "Zero-copy receive: %" PRIu64 " of %" PRIu64
+                " bytes received were mapped\n",
+                (uint64_t)mapped,
+                (uint64_t)eng->total_traffic_stats.bytes_rcvd);
+    }
+
+    if(eng->recorder) {
+        size_t dropped = recorder_close(eng->recorder);
+        eng->recorder = NULL;
+        if(dropped) {
+            fprintf(stderr,
+                    "--record: %zu received bytes were not recorded, "
+                    "the writer fell behind\n",
+                    dropped);
+        }
+    }
+
+    closer_free(eng->closer);
+    eng->closer = NULL;
+
+    if(eng->connstats) {
+        size_t dropped = connstats_close(eng->connstats);
+        eng->connstats = NULL;
+        if(dropped) {
+            fprintf(stderr,
+                    "--per-connection-stats: %zu connections were not "
+                    "written out, the writer fell behind\n",
+                    dropped);
+        }
+    }
+
+    if(eng->sampler) {
+        /* The intervals the workers have not all reached are left out. */
+        struct throughput_sample sample;
+        double start;
+        while(engine_next_sample(eng, epoch, &sample, &start))
+            ;
+        sampler_free(eng->sampler);
+        eng->sampler = NULL;
+        for(int m = 0; m < SAMPLE_METRICS; m++) {
+            summary->throughput[m] = eng->throughput[m];
+            eng->throughput[m] = NULL;
+        }
+    }
+
+    if(eng->logpipe) {
+        size_t dropped = logpipe_close(eng->logpipe);
+        eng->logpipe = NULL;
+        if(dropped) {
+            fprintf(stderr,
+                    "%zu data dumps and log lines were not printed, "
+                    "the output fell behind\n",
+                    dropped);
+        }
+    }
 
     /*
-     * The engine termination (using 'T') will implicitly prepare
-     * latency snapshots. We only need to collect it now.
+     * The engine termination (using 'T') made the workers publish
+     * their final histograms. We only need to collect them now.
      */
     struct latency_snapshot *latency = engine_collect_latency_snapshot(eng);
+    summary->tcp_info = engine_collect_tcp_info_snapshot(eng);
+
+    size_t n_remotes = eng->params.remote_addresses.n_addrs;
+    summary->n_remotes = n_remotes;
+    summary->remotes =
+        calloc(n_remotes ? n_remotes : 1, sizeof(summary->remotes[0]));
+    assert(summary->remotes);
+    for(size_t i = 0; i < n_remotes; i++) {
+        engine_get_remote_stats(eng, i,
+                                &summary->remotes[i].connection_attempts,
+                                &summary->remotes[i].connection_failures);
+        summary->remotes[i].traffic = engine_remote_traffic(eng, i);
+        summary->remotes[i].latency =
+            engine_collect_remote_latency_snapshot(eng, i);
+    }
+
+    summary->n_groups = eng->params.n_groups;
+    summary->groups = calloc(summary->n_groups ? summary->n_groups : 1,
+                             sizeof(summary->groups[0]));
+    assert(summary->groups);
+    for(size_t i = 0; i < summary->n_groups; i++) {
+        summary->groups[i].traffic = engine_group_traffic(eng, i);
+        summary->groups[i].latency =
+            engine_collect_group_latency_snapshot(eng, i);
+    }
+
+    collect_rate_steps(eng, summary);
+    collect_size_classes(eng, summary);
+    collect_slowest(eng, summary);
+    collect_fanout(eng, summary);
+
+    struct engine_loop_stats loop;
+    engine_loop_stats(eng, &loop);
+
+    /* The retired workers' connections have been handed over. */
+    for(int n = 0; n < eng->n_workers; n++) {
+        const struct engine_memory_stats *ms = &eng->loops[n].memory;
+        summary->memory.connections += ms->connections;
+        for(int c = 0; c < EMC_COMPONENTS; c++)
+            summary->memory.bytes[c] += ms->bytes[c];
+        summary->latency_samples_dropped +=
+            atomic_wide_get(&eng->loops[n].latency_samples_dropped);
+        for(int c = 0; c <= GRPC_STATUS_CODES; c++)
+            summary->grpc_calls[c] +=
+                atomic_wide_get(&eng->loops[n].grpc_calls[c]);
+        struct engine_mirror_summary *mirror = &summary->mirror;
+        mirror->opened += atomic_get(&eng->loops[n].mirrors_opened);
+        mirror->failed += atomic_get(&eng->loops[n].mirrors_failed);
+        mirror->bytes_sent +=
+            atomic_wide_get(&eng->loops[n].mirror_bytes_sent);
+        mirror->bytes_rcvd +=
+            atomic_wide_get(&eng->loops[n].mirror_bytes_rcvd);
+        mirror->bytes_dropped +=
+            atomic_wide_get(&eng->loops[n].mirror_bytes_dropped);
+    }
+
+    if(eng->params.peer_stats) {
+        struct peer_table *peers =
+            peer_table_new(eng->params.peer_stats_ipv4_bits,
+                           eng->params.peer_stats_ipv6_bits);
+        for(int n = 0; n < eng->n_loops; n++) {
+            if(!eng->loops[n].peer_table) continue;
+            peer_table_merge(peers, eng->loops[n].peer_table);
+            peer_table_free(eng->loops[n].peer_table);
+            eng->loops[n].peer_table = NULL;
+        }
+        summary->n_peers = peer_table_export(peers, &summary->peers);
+        peer_table_free(peers);
+    }
+
+    if(eng->params.cpu_cost) engine_cpu_stats(eng, &summary->cpu);
 
     eng->n_workers = 0;
+    eng->n_loops = 0;
 
     /* Data snd/rcv after ramp-up (since epoch) */
     double now = tk_now(TK_DEFAULT);
-    double test_duration = now - epoch;
-    non_atomic_traffic_stats epoch_traffic =
+    summary->test_duration = now - epoch;
+    summary->traffic =
         subtract_traffic_stats(eng->total_traffic_stats, initial_traffic_stats);
+    summary->connecting = connecting;
+    summary->conns_in = conn_in;
+    summary->conns_out = conn_out;
+    summary->connections_counter = conn_counter;
+    summary->latency = latency;
+    summary->loop = loop;
+}
+
+void
+engine_terminate(struct engine *eng, double epoch,
+                 non_atomic_traffic_stats initial_traffic_stats,
+                 struct percentile_values *latency_percentiles,
+                 struct engine_summary *summary) {
+    struct engine_summary local_summary;
+
+    if(!summary) summary = &local_summary;
+
+    engine_stop(eng, epoch, initial_traffic_stats, summary);
+    engine_summary_print(&eng->params, latency_percentiles, summary);
+
+    if(summary == &local_summary) engine_free_summary(summary);
+}
+
+const char *
+engine_memory_component_name(enum engine_memory_component c) {
+    static const char *const names[EMC_COMPONENTS] = {
+        [EMC_STATE] = "state",           [EMC_PAYLOAD] = "payload",
+        [EMC_SEARCH] = "search",
+        [EMC_TIMESTAMPS] = "timestamps", [EMC_HISTOGRAMS] = "histograms",
+        [EMC_PROTOCOL] = "protocol"};
+    assert(c < EMC_COMPONENTS);
+    return names[c];
+}
+
+const char *
+engine_steady_metric_name(enum engine_steady_metric m) {
+    static const char *const names[ESM_METRICS] = {
+        [ESM_BPS_IN] = "bps_in",   [ESM_BPS_OUT] = "bps_out",
+        [ESM_MPS_IN] = "mps_in",   [ESM_MPS_OUT] = "mps_out",
+        [ESM_LATENCY] = "latency_ms"};
+    assert(m < ESM_METRICS);
+    return names[m];
+}
+
+/*
+ * Print the --memory-report, per connection.
+ */
+static void
+memory_summary_print(const struct engine_memory_stats *memory) {
+    size_t total = 0;
+    for(int c = 0; c < EMC_COMPONENTS; c++) total += memory->bytes[c];
+
+    printf("Memory per connection: %zu bytes (", total / memory->connections);
+    const char *sep = "";
+    for(int c = 0; c < EMC_COMPONENTS; c++) {
+        if(!memory->bytes[c]) continue;
+        printf("%s%s %zu", sep, engine_memory_component_name(c),
+               memory->bytes[c] / memory->connections);
+        sep = ", ";
+    }
+    printf(") over %zu connections\n", memory->connections);
+}
+
+static void
+cpu_summary_print(const struct engine_cpu_stats *cpu) {
+    printf("CPU cost: %.3f s of the workers", cpu->seconds);
+    if(cpu->messages)
+        printf(", %.2f µs/message", 1000000 * cpu->seconds / cpu->messages);
+    if(cpu->bytes)
+        printf(", %.3f ns/byte", 1000000000 * cpu->seconds / cpu->bytes);
+    printf("\n");
+    if(!cpu->cycles) return;
+
+    printf("CPU cycles: %" PRIu64, cpu->cycles);
+    if(cpu->messages)
+        printf(", %.0f cycles/message", (double)cpu->cycles / cpu->messages);
+    if(cpu->bytes)
+        printf(", %.2f cycles/byte", (double)cpu->cycles / cpu->bytes);
+    if(cpu->instructions)
+        printf(", %.2f instructions/cycle",
+               (double)cpu->instructions / cpu->cycles);
+    printf("\n");
+}
+
+/*
+ * Print the final numbers of a test.
+ */
+void
+engine_summary_print(const struct engine_params *params,
+                     const struct percentile_values *latency_percentiles,
+                     const struct engine_summary *summary) {
+    double test_duration = summary->test_duration;
+    non_atomic_traffic_stats epoch_traffic = summary->traffic;
     non_atomic_wide_t epoch_data_transmitted =
         epoch_traffic.bytes_sent + epoch_traffic.bytes_rcvd;
 
@@ -539,7 +2352,8 @@ engine_terminate(struct engine *eng, double epoch,
     printf("Total data received: %s (%" PRIu64 " bytes)\n",
            express_bytes(epoch_traffic.bytes_rcvd, buf, sizeof(buf)),
            (uint64_t)epoch_traffic.bytes_rcvd);
-    long conns = (0 * connecting) + conn_in + conn_out;
+    long conns = (0 * summary->connecting) + summary->conns_in
+                 + summary->conns_out;
     if(!conns) conns = 1; /* Assume a single channel. */
     printf("Bandwidth per channel: %.3f⇅ Mbps (%.1f kBps)\n",
            8 * ((epoch_data_transmitted / test_duration) / conns) / 1000000.0,
@@ -547,10 +2361,40 @@ engine_terminate(struct engine *eng, double epoch,
     printf("Aggregate bandwidth: %.3f↓, %.3f↑ Mbps\n",
            8 * (epoch_traffic.bytes_rcvd / test_duration) / 1000000.0,
            8 * (epoch_traffic.bytes_sent / test_duration) / 1000000.0);
-    if(eng->params.message_marker) {
+    int messages = params->message_marker || params->websocket_enable
+                   || params->http_enable || params->http2_enable
+                   || params->resp_enable || params->mqtt_version
+                   || params->framing_prefix_size || params->framer;
+    if(messages) {
         printf("Aggregate message rate: %.3f↓, %.3f↑ mps\n",
                (epoch_traffic.msgs_rcvd / test_duration),
                (epoch_traffic.msgs_sent / test_duration));
+        if(params->message_marker_binary) {
+            printf("Messages lost: %" PRIu64 ", reordered: %" PRIu64 "\n",
+                   (uint64_t)epoch_traffic.msgs_lost,
+                   (uint64_t)epoch_traffic.msgs_reordered);
+        }
+        if(params->fanout && summary->fanout_deliveries)
+            fanout_summary_print(&epoch_traffic, summary->fanout_deliveries);
+    }
+    if(summary->throughput[SM_BYTES_RCVD])
+        throughput_summary_print(params, summary, messages);
+    if(params->verify_echo) {
+        printf("Echo mismatches: %" PRIu64 " blocks of %d bytes\n",
+               (uint64_t)epoch_traffic.echo_mismatches, ECHO_VERIFY_BLOCK);
+    }
+    if(params->latency_sample > 1) {
+        printf("Latency samples: 1 in %u messages, %" PRIu64 " dropped\n",
+               params->latency_sample, summary->latency_samples_dropped);
+    }
+    if(params->grpc_enable) grpc_summary_print(summary);
+    if(params->mirror_addresses.n_addrs) mirror_summary_print(summary);
+    /* When the connections are churned, as on the status line. */
+    if(params->channel_lifetime != INFINITY
+       || params->close_style != CLOSE_GRACEFUL) {
+        printf("Connection rate: %.1f opened/s, %.1f closed/s\n",
+               epoch_traffic.conns_opened / test_duration,
+               epoch_traffic.conns_closed / test_duration);
     }
     printf("Packet rate estimate: %.1f↓, %.1f↑ (%u↓, %u↑ TCP MSS/op)\n",
            estimate_pps(test_duration, epoch_traffic.num_reads,
@@ -561,12 +2405,99 @@ engine_terminate(struct engine *eng, double epoch,
                                     epoch_traffic.bytes_rcvd),
            estimate_segments_per_op(epoch_traffic.num_writes,
                                     epoch_traffic.bytes_sent));
-    latency_snapshot_print(latency_percentiles, latency);
+    if(params->sock_rcvlowat || params->sock_notsent_lowat) {
+        /* Show what --rcvlowat and --notsent-lowat did to the syscalls. */
+        printf("Reads: %.1f/s of %.0f bytes, writes: %.1f/s of %.0f bytes\n",
+               epoch_traffic.num_reads / test_duration,
+               epoch_traffic.num_reads ? (double)epoch_traffic.bytes_rcvd
+                                             / epoch_traffic.num_reads
+                                       : 0.0,
+               epoch_traffic.num_writes / test_duration,
+               epoch_traffic.num_writes ? (double)epoch_traffic.bytes_sent
+                                              / epoch_traffic.num_writes
+                                        : 0.0);
+    }
+    if(summary->latency)
+        latency_snapshot_print("", latency_percentiles, summary->latency);
+    if(summary->n_rate_steps > 1) {
+        rate_step_summary_print(latency_percentiles, summary);
+    }
+    if(summary->n_size_classes) {
+        size_class_summary_print(latency_percentiles, summary);
+    }
+    if(summary->n_slowest) {
+        slowest_summary_print(params, summary);
+    }
+    if(summary->tcp_info) {
+        tcp_info_snapshot_print(latency_percentiles, summary->tcp_info);
+    }
+    if(summary->n_remotes > 1) {
+        remote_summary_print(params, latency_percentiles, summary);
+    }
+    if(summary->n_groups) {
+        group_summary_print(params, latency_percentiles, summary);
+    }
+    if(summary->n_peers) {
+        peer_summary_print(summary);
+    }
+    if(summary->memory.connections) {
+        memory_summary_print(&summary->memory);
+    }
+
+    if(params->cpu_cost) {
+        cpu_summary_print(&summary->cpu);
+    }
+
+    if(summary->loop.saturated_share > 0.0) {
+        printf("Generator saturated: %.0f%% of the time, worst loop lag %.1f "
+               "ms. Consider adding --workers or --processes.\n",
+               100 * summary->loop.saturated_share,
+               1000 * summary->loop.max_lag);
+    }
 
-    engine_free_latency_snapshot(latency);
     printf("Test duration: %g s.\n", test_duration);
 }
 
+void
+engine_free_summary(struct engine_summary *summary) {
+    if(summary) {
+        engine_free_latency_snapshot(summary->latency);
+        engine_free_tcp_info_snapshot(summary->tcp_info);
+        summary->tcp_info = NULL;
+        for(size_t i = 0; i < summary->n_remotes; i++)
+            engine_free_latency_snapshot(summary->remotes[i].latency);
+        free(summary->remotes);
+        for(size_t i = 0; i < summary->n_groups; i++)
+            engine_free_latency_snapshot(summary->groups[i].latency);
+        free(summary->groups);
+        for(size_t i = 0; i < summary->n_rate_steps; i++)
+            free(summary->rate_steps[i].histogram);
+        free(summary->rate_steps);
+        summary->rate_steps = NULL;
+        summary->n_rate_steps = 0;
+        for(size_t i = 0; i < summary->n_size_classes; i++)
+            free(summary->size_classes[i].histogram);
+        free(summary->size_classes);
+        summary->size_classes = NULL;
+        summary->n_size_classes = 0;
+        free(summary->slowest);
+        summary->slowest = NULL;
+        summary->n_slowest = 0;
+        free(summary->fanout_deliveries);
+        summary->fanout_deliveries = NULL;
+        for(int m = 0; m < SAMPLE_METRICS; m++) {
+            free(summary->throughput[m]);
+            summary->throughput[m] = NULL;
+        }
+        free(summary->peers);
+        summary->peers = NULL;
+        summary->n_peers = 0;
+        summary->latency = NULL;
+        summary->remotes = NULL;
+        summary->groups = NULL;
+    }
+}
+
 static char *
 express_bytes(size_t bytes, char *buf, size_t size) {
     if(bytes < 2048) {
@@ -579,22 +2510,189 @@ express_bytes(size_t bytes, char *buf, size_t size) {
     return buf;
 }
 
-/*
- * Get number of connections opened by all of the workers.
- */
 void
-engine_get_connection_stats(struct engine *eng, size_t *connecting,
-                            size_t *incoming, size_t *outgoing,
-                            size_t *counter) {
-    size_t c_conn = 0;
-    size_t c_in = 0;
-    size_t c_out = 0;
-    size_t c_count = 0;
+engine_rebalance(struct engine *eng) {
+#if !defined(USE_LIBUV) && !defined(USE_IO_URING)
+    int hot = -1, cool = -1;
+    double hot_busy = 0.0, cool_busy = 0.0;
 
     for(int n = 0; n < eng->n_workers; n++) {
-        c_conn += atomic_get(&eng->loops[n].outgoing_connecting);
-        c_out += atomic_get(&eng->loops[n].outgoing_established);
-        c_in += atomic_get(&eng->loops[n].incoming_established);
+        double busy = atomic_get(&eng->loops[n].loop_busy_permille) / 1000.0;
+        if(hot == -1 || busy > hot_busy) {
+            hot = n;
+            hot_busy = busy;
+        }
+        if(cool == -1 || busy < cool_busy) {
+            cool = n;
+            cool_busy = busy;
+        }
+    }
+
+    if(hot == cool || hot_busy < REBALANCE_MIN_BUSY
+       || hot_busy - cool_busy < REBALANCE_MIN_GAP)
+        return;
+
+    /* Even out the two workers. */
+    double share = (hot_busy - cool_busy) / (2 * hot_busy);
+    atomic_exchange(&eng->loops[hot].rebalance_target, cool);
+    atomic_exchange(&eng->loops[hot].rebalance_permille, 1000 * share);
+    int rc = write(eng->loops[hot].private_control_pipe_wr, "b", 1);
+    assert(rc == 1);
+#else
+    (void)eng;
+#endif
+}
+
+/*
+ * Stop the n-th worker, the last one running,
+ * after it leaves its connections to the others.
+ */
+static void
+worker_retire(struct engine *eng, int n) {
+    struct loop_arguments *largs = &eng->loops[n];
+
+    assert(n == eng->n_workers - 1 && n > 0);
+
+    /* No new connections from the --rebalance after this point. */
+    pthread_mutex_lock(&eng->workers_lock);
+    atomic_exchange(&largs->retiring, 1);
+    pthread_mutex_unlock(&eng->workers_lock);
+    eng->n_workers--;
+
+    atomic_exchange(&largs->drain_to, n);
+    int rc = write(largs->private_control_pipe_wr, "D", 1);
+    assert(rc == 1);
+    void *value;
+    pthread_join(eng->threads[n], &value);
+
+    /* Skip the commands left unread, they are stale by now. */
+    char buf[64];
+    set_nbio(largs->private_control_pipe_rd, 1);
+    while(read(largs->private_control_pipe_rd, buf, sizeof(buf)) > 0)
+        ;
+    set_nbio(largs->private_control_pipe_rd, 0);
+
+    size_t dropped = atomic_exchange(&largs->connections_dropped, 0);
+    if(dropped) engine_initiate_new_connections(eng, dropped);
+}
+
+int
+engine_set_workers(struct engine *eng, int n_req) {
+    if(n_req < 1) n_req = 1;
+    if(n_req > eng->max_workers) n_req = eng->max_workers;
+
+    while(eng->n_workers < n_req) {
+        int n = eng->n_workers;
+        if(n == eng->n_loops) {
+            worker_setup_on_cpu(eng, n);
+            eng->n_loops++;
+        }
+        atomic_exchange(&eng->loops[n].retiring, 0);
+        worker_launch(eng, n);
+        eng->n_workers++;
+    }
+    while(eng->n_workers > n_req) {
+        worker_retire(eng, eng->n_workers - 1);
+    }
+
+    return eng->n_workers;
+}
+
+int
+engine_running_workers(struct engine *eng) {
+    return eng->n_workers;
+}
+
+void
+engine_worker_loop_stats(struct engine *eng, int worker,
+                         struct engine_loop_stats *out) {
+    assert(worker >= 0 && worker < eng->n_loops);
+    struct loop_arguments *largs = &eng->loops[worker];
+
+    out->busy = atomic_get(&largs->loop_busy_permille) / 1000.0;
+    out->lag = atomic_get(&largs->loop_lag_us) / 1000000.0;
+    out->stall = atomic_get(&largs->loop_stall_us) / 1000000.0;
+    out->events_per_iteration =
+        atomic_get(&largs->loop_events_per_iteration_x100) / 100.0;
+    out->pacing_debt = atomic_get(&largs->loop_pacing_debt_us) / 1000000.0;
+    out->saturated = atomic_get(&largs->loop_saturated) ? 1 : 0;
+    size_t periods = atomic_get(&largs->loop_periods);
+    size_t saturated_periods = atomic_get(&largs->loop_saturated_periods);
+    out->saturated_share =
+        periods ? (double)saturated_periods / periods : 0.0;
+    out->max_lag = atomic_get(&largs->loop_max_lag_us) / 1000000.0;
+}
+
+void
+engine_loop_stats(struct engine *eng, struct engine_loop_stats *out) {
+    double events_per_iteration = 0.0;
+
+    memset(out, 0, sizeof(*out));
+
+    for(int n = 0; n < eng->n_workers; n++) {
+        struct engine_loop_stats w;
+        engine_worker_loop_stats(eng, n, &w);
+        if(out->busy < w.busy) out->busy = w.busy;
+        if(out->lag < w.lag) out->lag = w.lag;
+        if(out->stall < w.stall) out->stall = w.stall;
+        if(out->pacing_debt < w.pacing_debt)
+            out->pacing_debt = w.pacing_debt;
+        if(out->max_lag < w.max_lag) out->max_lag = w.max_lag;
+        if(w.saturated) out->saturated = 1;
+        events_per_iteration += w.events_per_iteration;
+        /* The workers publish in step, so the worst one is taken. */
+        if(out->saturated_share < w.saturated_share)
+            out->saturated_share = w.saturated_share;
+    }
+
+    if(eng->n_workers)
+        out->events_per_iteration = events_per_iteration / eng->n_workers;
+}
+
+void
+engine_cpu_stats(struct engine *eng, struct engine_cpu_stats *out) {
+    memset(out, 0, sizeof(*out));
+
+    non_atomic_traffic_stats traffic = engine_traffic(eng);
+    for(int n = 0; n < eng->n_loops; n++) {
+        struct loop_arguments *largs = &eng->loops[n];
+        out->seconds += atomic_wide_get(&largs->cpu_time_us) / 1000000.0;
+        out->cycles += atomic_wide_get(&largs->cpu_cycles);
+        out->instructions += atomic_wide_get(&largs->cpu_instructions);
+    }
+    out->bytes = traffic.bytes_sent + traffic.bytes_rcvd;
+    out->messages = traffic.msgs_sent + traffic.msgs_rcvd;
+}
+
+/*
+ * Get number of connections opened by all of the workers.
+ */
+void
+engine_get_worker_connection_stats(struct engine *eng, int worker,
+                                   size_t *connecting, size_t *incoming,
+                                   size_t *outgoing) {
+    assert(worker >= 0 && worker < eng->n_loops);
+    struct loop_arguments *largs = &eng->loops[worker];
+    *connecting = atomic_get(&largs->outgoing_connecting)
+                  + atomic_get(&largs->reconnects_pending);
+    *incoming = atomic_get(&largs->incoming_established);
+    *outgoing = atomic_get(&largs->outgoing_established);
+}
+
+void
+engine_get_connection_stats(struct engine *eng, size_t *connecting,
+                            size_t *incoming, size_t *outgoing,
+                            size_t *counter) {
+    size_t c_conn = 0;
+    size_t c_in = 0;
+    size_t c_out = 0;
+    size_t c_count = 0;
+
+    for(int n = 0; n < eng->n_loops; n++) {
+        c_conn += atomic_get(&eng->loops[n].outgoing_connecting);
+        c_conn += atomic_get(&eng->loops[n].reconnects_pending);
+        c_out += atomic_get(&eng->loops[n].outgoing_established);
+        c_in += atomic_get(&eng->loops[n].incoming_established);
         c_count += atomic_get(&eng->loops[n].connections_counter);
     }
     *connecting = c_conn;
@@ -605,129 +2703,225 @@ engine_get_connection_stats(struct engine *eng, size_t *connecting,
 
 void
 engine_free_latency_snapshot(struct latency_snapshot *latency) {
-    if(latency) {
+    struct latency_snapshot_pool *pool = latency ? latency->pool : NULL;
+    if(pool) {
+        pthread_mutex_lock(&pool->lock);
+        latency->pool_next = pool->free_list;
+        pool->free_list = latency;
+        pthread_mutex_unlock(&pool->lock);
+    } else if(latency) {
         free(latency->connect_histogram);
         free(latency->firstbyte_histogram);
+        free(latency->handshake_histogram);
+        free(latency->upgrade_histogram);
         free(latency->marker_histogram);
+        free(latency->marker_uncorrected_histogram);
         free(latency);
     }
 }
 
 /*
- * Prepare latency snapshot data.
+ * Add the histogram published by the worker into (dst) through (copy),
+ * a buffer of hdr_get_memory_size(src->histogram) bytes, retrying
+ * if the worker was publishing a new version while we were copying.
  */
-void
-engine_prepare_latency_snapshot(struct engine *eng) {
-    if(eng->params.latency_setting != 0) {
-        /*
-         * If histogram is requested, we first need to ask each worker to
-         * assemble that information among its connections.
-         */
-        for(int n = 0; n < eng->n_workers; n++) {
-            int fd = eng->loops[n].private_control_pipe_wr;
-            int wrote = write(fd, "h", 1);
-            assert(wrote == 1);
-        }
-        /* Gather feedback. */
-        for(int n = 0; n < eng->n_workers; n++) {
-            char c;
-            int rd = read(eng->global_feedback_pipe_rd, &c, 1);
-            assert(rd == 1);
-            assert(c == '.');
+static void
+histogram_add_published_via(struct hdr_histogram *dst,
+                            struct published_histogram *src,
+                            struct hdr_histogram *copy) {
+    if(!dst || !src->histogram) return;
+
+    size_t size = hdr_get_memory_size(src->histogram);
+
+    for(;;) {
+        non_atomic_narrow_t seq = atomic_get(&src->sequence);
+        if((seq & 1) == 0) {
+            memcpy(copy, src->histogram, size);
+            if(atomic_get(&src->sequence) == seq) break;
         }
+#ifdef HAVE_SCHED_H
+        sched_yield();
+#endif
     }
+
+    hdr_add(dst, copy);
 }
 
 /*
- * Grab the prepared latency snapshot data.
+ * Same as histogram_add_published_via(), with a temporary buffer.
  */
-struct latency_snapshot *
-engine_collect_latency_snapshot(struct engine *eng) {
-    struct latency_snapshot *latency = calloc(1, sizeof(*latency));
+static void
+histogram_add_published(struct hdr_histogram *dst,
+                        struct published_histogram *src) {
+    if(!dst || !src->histogram) return;
+
+    size_t size = hdr_get_memory_size(src->histogram);
+    struct hdr_histogram *copy = malloc(size);
+    assert(copy);
+    histogram_add_published_via(dst, src, copy);
+    free(copy);
+}
+
+/*
+ * A snapshot with empty histograms, either reused or created
+ * with the histogram parameters of the workers.
+ */
+static struct latency_snapshot *
+latency_snapshot_get(struct latency_snapshot_pool *pool) {
+    struct engine *eng = pool->eng;
+
+    pthread_mutex_lock(&pool->lock);
+    struct latency_snapshot *latency = pool->free_list;
+    if(latency) pool->free_list = latency->pool_next;
+    pthread_mutex_unlock(&pool->lock);
+
+    if(latency) {
+        struct hdr_histogram *hists[] = {latency->connect_histogram,
+                                         latency->firstbyte_histogram,
+                                         latency->handshake_histogram,
+                                         latency->upgrade_histogram,
+                                         latency->marker_histogram,
+                                         latency->marker_uncorrected_histogram};
+        for(size_t i = 0; i < sizeof(hists) / sizeof(hists[0]); i++)
+            if(hists[i]) hdr_reset(hists[i]);
+        latency->pool_next = NULL;
+        return latency;
+    }
+
+    latency = calloc(1, sizeof(*latency));
+    assert(latency);
+    latency->pool = pool;
 
     if(eng->params.latency_setting == 0) return latency;
 
-    struct hdr_init_values {
-        int64_t lowest_trackable_value;
-        int64_t highest_trackable_value;
-        int64_t significant_figures;
-    } conn_init = {0, 0, 0}, fb_init = {0, 0, 0}, mark_init = {0, 0, 0};
-
-    /* There's going to be no wait or contention here due
-     * to the pipe-driven command-response logic. However,
-     * we still lock the reporting histogram to pretend that
-     * we correctly deal with memory barriers (which we don't
-     * have to on x86).
+    /*
+     * The histogram parameters never change after the worker is set up,
+     * so the first worker's histograms serve as a template.
      */
-    pthread_mutex_lock(&eng->loops[0].shared_histograms_lock);
-    if(eng->loops[0].connect_histogram_shared) {
-        conn_init.lowest_trackable_value =
-            eng->loops[0].connect_histogram_shared->lowest_trackable_value;
-        conn_init.highest_trackable_value =
-            eng->loops[0].connect_histogram_shared->highest_trackable_value;
-        conn_init.significant_figures =
-            eng->loops[0].connect_histogram_shared->significant_figures;
-    }
-    if(eng->loops[0].firstbyte_histogram_shared) {
-        fb_init.lowest_trackable_value =
-            eng->loops[0].firstbyte_histogram_shared->lowest_trackable_value;
-        fb_init.highest_trackable_value =
-            eng->loops[0].firstbyte_histogram_shared->highest_trackable_value;
-        fb_init.significant_figures =
-            eng->loops[0].firstbyte_histogram_shared->significant_figures;
-    }
-    if(eng->loops[0].marker_histogram_shared) {
-        mark_init.lowest_trackable_value =
-            eng->loops[0].marker_histogram_shared->lowest_trackable_value;
-        mark_init.highest_trackable_value =
-            eng->loops[0].marker_histogram_shared->highest_trackable_value;
-        mark_init.significant_figures =
-            eng->loops[0].marker_histogram_shared->significant_figures;
-    }
-    pthread_mutex_unlock(&eng->loops[0].shared_histograms_lock);
-
-    if(conn_init.significant_figures) {
-        int ret = hdr_init(
-            conn_init.lowest_trackable_value, conn_init.highest_trackable_value,
-            conn_init.significant_figures, &latency->connect_histogram);
-        assert(ret == 0);
-    }
-    if(fb_init.significant_figures) {
-        int ret = hdr_init(
-            fb_init.lowest_trackable_value, fb_init.highest_trackable_value,
-            fb_init.significant_figures, &latency->firstbyte_histogram);
-        assert(ret == 0);
-    }
-    if(mark_init.significant_figures) {
-        int ret = hdr_init(
-            mark_init.lowest_trackable_value, mark_init.highest_trackable_value,
-            mark_init.significant_figures, &latency->marker_histogram);
-        assert(ret == 0);
-    }
+    latency->connect_histogram =
+        hdr_init_similar(eng->loops[0].connect_histogram_shared.histogram);
+    latency->firstbyte_histogram =
+        hdr_init_similar(eng->loops[0].firstbyte_histogram_shared.histogram);
+    latency->handshake_histogram =
+        hdr_init_similar(eng->loops[0].handshake_histogram_shared.histogram);
+    latency->upgrade_histogram =
+        hdr_init_similar(eng->loops[0].upgrade_histogram_shared.histogram);
+    latency->marker_histogram =
+        hdr_init_similar(eng->loops[0].marker_histogram_shared.histogram);
+    latency->marker_uncorrected_histogram = hdr_init_similar(
+        eng->loops[0].marker_uncorrected_histogram_shared.histogram);
 
-    for(int n = 0; n < eng->n_workers; n++) {
-        pthread_mutex_lock(&eng->loops[n].shared_histograms_lock);
-        if(latency->connect_histogram)
-            hdr_add(latency->connect_histogram,
-                    eng->loops[n].connect_histogram_shared);
-        if(latency->firstbyte_histogram)
-            hdr_add(latency->firstbyte_histogram,
-                    eng->loops[n].firstbyte_histogram_shared);
-        if(latency->marker_histogram)
-            hdr_add(latency->marker_histogram,
-                    eng->loops[n].marker_histogram_shared);
-        pthread_mutex_unlock(&eng->loops[n].shared_histograms_lock);
+    return latency;
+}
+
+/*
+ * Grab the prepared latency snapshot data.
+ */
+static struct latency_snapshot *
+collect_latency_snapshot(struct engine *eng, int from_worker,
+                         int to_worker) {
+    struct latency_snapshot_pool *pool = &eng->latency_pool;
+    struct latency_snapshot *latency = latency_snapshot_get(pool);
+
+    if(eng->params.latency_setting == 0) return latency;
+
+    pthread_mutex_lock(&pool->lock);
+    for(int n = from_worker; n < to_worker; n++) {
+        struct published_histogram *shared[] = {
+            &eng->loops[n].connect_histogram_shared,
+            &eng->loops[n].firstbyte_histogram_shared,
+            &eng->loops[n].handshake_histogram_shared,
+            &eng->loops[n].upgrade_histogram_shared,
+            &eng->loops[n].marker_histogram_shared,
+            &eng->loops[n].marker_uncorrected_histogram_shared};
+        struct hdr_histogram *dst[] = {latency->connect_histogram,
+                                       latency->firstbyte_histogram,
+                                       latency->handshake_histogram,
+                                       latency->upgrade_histogram,
+                                       latency->marker_histogram,
+                                       latency->marker_uncorrected_histogram};
+        for(size_t i = 0; i < sizeof(dst) / sizeof(dst[0]); i++) {
+            if(!dst[i] || !shared[i]->histogram) continue;
+            size_t size = hdr_get_memory_size(shared[i]->histogram);
+            if(pool->copy_size < size) {
+                free(pool->copy);
+                pool->copy = malloc(size);
+                assert(pool->copy);
+                pool->copy_size = size;
+            }
+            histogram_add_published_via(dst[i], shared[i], pool->copy);
+        }
     }
+    pthread_mutex_unlock(&pool->lock);
 
     return latency;
 }
 
+struct latency_snapshot *
+engine_collect_latency_snapshot(struct engine *eng) {
+    return collect_latency_snapshot(eng, 0, eng->n_loops);
+}
+
+struct latency_snapshot *
+engine_collect_worker_latency_snapshot(struct engine *eng, int worker) {
+    assert(worker >= 0 && worker < eng->n_loops);
+    return collect_latency_snapshot(eng, worker, worker + 1);
+}
+
+/*
+ * Subtract the histograms of (base) from those of (update).
+ */
+void
+engine_subtract_latency_snapshot(struct latency_snapshot *update,
+                                 const struct latency_snapshot *base) {
+    assert(base);
+    assert(update);
+
+    struct hdr_histogram *u[] = {update->connect_histogram,
+                                 update->firstbyte_histogram,
+                                 update->handshake_histogram,
+                                 update->upgrade_histogram,
+                                 update->marker_histogram,
+                                 update->marker_uncorrected_histogram};
+    const struct hdr_histogram *b[] = {base->connect_histogram,
+                                       base->firstbyte_histogram,
+                                       base->handshake_histogram,
+                                       base->upgrade_histogram,
+                                       base->marker_histogram,
+                                       base->marker_uncorrected_histogram};
+    for(size_t i = 0; i < sizeof(u) / sizeof(u[0]); i++) {
+        if(u[i] && b[i]) hdr_subtract(u[i], b[i]);
+    }
+}
+
 struct latency_snapshot *
 engine_diff_latency_snapshot(struct latency_snapshot *base, struct latency_snapshot *update) {
 
     assert(base);
     assert(update);
 
+    /* Copy the update into a pooled snapshot and subtract in place. */
+    if(update->pool) {
+        struct latency_snapshot *diff = latency_snapshot_get(update->pool);
+        struct hdr_histogram *d[] = {diff->connect_histogram,
+                                     diff->firstbyte_histogram,
+                                     diff->handshake_histogram,
+                                     diff->upgrade_histogram,
+                                     diff->marker_histogram,
+                                     diff->marker_uncorrected_histogram};
+        struct hdr_histogram *u[] = {update->connect_histogram,
+                                     update->firstbyte_histogram,
+                                     update->handshake_histogram,
+                                     update->upgrade_histogram,
+                                     update->marker_histogram,
+                                     update->marker_uncorrected_histogram};
+        for(size_t i = 0; i < sizeof(d) / sizeof(d[0]); i++) {
+            if(d[i] && u[i]) memcpy(d[i], u[i], hdr_get_memory_size(u[i]));
+        }
+        engine_subtract_latency_snapshot(diff, base);
+        return diff;
+    }
+
     struct latency_snapshot *diff = calloc(1, sizeof(*diff));
     assert(diff);
 
@@ -737,22 +2931,192 @@ engine_diff_latency_snapshot(struct latency_snapshot *base, struct latency_snaps
     if(base->firstbyte_histogram)
         diff->firstbyte_histogram =
             hdr_diff(base->firstbyte_histogram, update->firstbyte_histogram);
+    if(base->handshake_histogram)
+        diff->handshake_histogram =
+            hdr_diff(base->handshake_histogram, update->handshake_histogram);
+    if(base->upgrade_histogram)
+        diff->upgrade_histogram =
+            hdr_diff(base->upgrade_histogram, update->upgrade_histogram);
     if(base->marker_histogram)
         diff->marker_histogram =
             hdr_diff(base->marker_histogram, update->marker_histogram);
+    if(base->marker_uncorrected_histogram)
+        diff->marker_uncorrected_histogram =
+            hdr_diff(base->marker_uncorrected_histogram,
+                     update->marker_uncorrected_histogram);
 
     return diff;
 }
 
 non_atomic_traffic_stats
 engine_traffic(struct engine *eng) {
-    non_atomic_traffic_stats traffic = {0, 0, 0, 0, 0, 0};
-    for(int n = 0; n < eng->n_workers; n++) {
+    non_atomic_traffic_stats traffic = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    for(int n = 0; n < eng->n_loops; n++) {
         add_traffic_numbers_AtoN(&eng->loops[n].worker_traffic_stats, &traffic);
     }
     return traffic;
 }
 
+int
+engine_workers(struct engine *eng) {
+    return eng->n_loops;
+}
+
+int
+engine_workers_max(struct engine *eng) {
+    return eng->max_workers;
+}
+
+non_atomic_traffic_stats
+engine_worker_traffic(struct engine *eng, int worker) {
+    non_atomic_traffic_stats traffic = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    assert(worker >= 0 && worker < eng->n_loops);
+    add_traffic_numbers_AtoN(&eng->loops[worker].worker_traffic_stats,
+                             &traffic);
+    return traffic;
+}
+
+non_atomic_traffic_stats
+engine_remote_traffic(struct engine *eng, size_t remote_index) {
+    non_atomic_traffic_stats traffic = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    assert(remote_index < eng->params.remote_addresses.n_addrs);
+    for(int n = 0; n < eng->n_loops; n++) {
+        add_traffic_numbers_AtoN(
+            &eng->loops[n].remote_stats[remote_index].traffic, &traffic);
+    }
+    return traffic;
+}
+
+/*
+ * Sum up the per-remote or per-group histograms of all workers.
+ */
+static struct latency_snapshot *
+collect_scoped_latency_snapshot(struct engine *eng, int of_group,
+                                size_t index) {
+    struct latency_snapshot *latency = calloc(1, sizeof(*latency));
+    assert(latency);
+
+    const struct remote_latency *tmpl =
+        of_group ? &eng->loops[0].group_latency[index]
+                 : &eng->loops[0].remote_latency[index];
+    latency->connect_histogram =
+        hdr_init_similar(tmpl->connect_histogram_shared.histogram);
+    latency->firstbyte_histogram =
+        hdr_init_similar(tmpl->firstbyte_histogram_shared.histogram);
+    latency->handshake_histogram =
+        hdr_init_similar(tmpl->handshake_histogram_shared.histogram);
+    latency->upgrade_histogram =
+        hdr_init_similar(tmpl->upgrade_histogram_shared.histogram);
+    latency->marker_histogram =
+        hdr_init_similar(tmpl->marker_histogram_shared.histogram);
+
+    for(int n = 0; n < eng->n_loops; n++) {
+        struct remote_latency *rl = of_group
+                                        ? &eng->loops[n].group_latency[index]
+                                        : &eng->loops[n].remote_latency[index];
+        histogram_add_published(latency->connect_histogram,
+                                &rl->connect_histogram_shared);
+        histogram_add_published(latency->firstbyte_histogram,
+                                &rl->firstbyte_histogram_shared);
+        histogram_add_published(latency->handshake_histogram,
+                                &rl->handshake_histogram_shared);
+        histogram_add_published(latency->upgrade_histogram,
+                                &rl->upgrade_histogram_shared);
+        histogram_add_published(latency->marker_histogram,
+                                &rl->marker_histogram_shared);
+    }
+
+    return latency;
+}
+
+struct latency_snapshot *
+engine_collect_remote_latency_snapshot(struct engine *eng,
+                                       size_t remote_index) {
+    assert(remote_index < eng->params.remote_addresses.n_addrs);
+    if(eng->n_loops == 0 || !eng->loops[0].remote_latency
+       || remote_index >= eng->loops[0].remote_latency_count)
+        return NULL;
+    return collect_scoped_latency_snapshot(eng, 0, remote_index);
+}
+
+non_atomic_traffic_stats
+engine_group_traffic(struct engine *eng, size_t group) {
+    non_atomic_traffic_stats traffic = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    assert(group < eng->params.n_groups);
+    for(int n = 0; n < eng->n_loops; n++) {
+        add_traffic_numbers_AtoN(&eng->loops[n].group_stats[group].traffic,
+                                 &traffic);
+    }
+    return traffic;
+}
+
+struct latency_snapshot *
+engine_collect_group_latency_snapshot(struct engine *eng, size_t group) {
+    assert(group < eng->params.n_groups);
+    if(eng->n_loops == 0 || !eng->loops[0].group_latency) return NULL;
+    return collect_scoped_latency_snapshot(eng, 1, group);
+}
+
+struct tcp_info_snapshot *
+engine_collect_tcp_info_snapshot(struct engine *eng) {
+    if(!(eng->params.tcp_info || eng->params.mptcp || eng->params.tcp_fastopen)
+       || eng->n_loops == 0)
+        return NULL;
+
+    struct tcp_info_snapshot *snapshot = calloc(1, sizeof(*snapshot));
+    assert(snapshot);
+    for(int n = 0; n < eng->n_loops; n++) {
+        snapshot->mptcp_connections +=
+            atomic_get(&eng->loops[n].mptcp_connections);
+        snapshot->mptcp_fallbacks += atomic_get(&eng->loops[n].mptcp_fallbacks);
+        snapshot->fastopen_connections +=
+            atomic_get(&eng->loops[n].fastopen_connections);
+        snapshot->fastopen_accepted +=
+            atomic_get(&eng->loops[n].fastopen_accepted);
+    }
+    for(int m = 0; m < ETI_METRICS; m++) {
+        snapshot->histogram[m] = hdr_init_similar(
+            eng->loops[0].tcp_info_histogram_shared[m].histogram);
+        for(int n = 0; n < eng->n_loops; n++) {
+            histogram_add_published(
+                snapshot->histogram[m],
+                &eng->loops[n].tcp_info_histogram_shared[m]);
+        }
+    }
+    return snapshot;
+}
+
+void
+engine_free_tcp_info_snapshot(struct tcp_info_snapshot *snapshot) {
+    if(snapshot) {
+        for(int m = 0; m < ETI_METRICS; m++) free(snapshot->histogram[m]);
+        free(snapshot);
+    }
+}
+
+void
+engine_refresh_remote_addresses(struct engine *eng) {
+    if(eng->params.dns_refresh)
+        eng->params.remote_addresses.n_addrs =
+            dns_refresh_count(eng->params.dns_refresh);
+}
+
+void
+engine_get_remote_stats(struct engine *eng, size_t remote_index,
+                        size_t *attempts, size_t *failures) {
+    size_t c_attempts = 0;
+    size_t c_failures = 0;
+
+    assert(remote_index < eng->params.remote_addresses.n_addrs);
+    for(int n = 0; n < eng->n_loops; n++) {
+        struct remote_stats *rs = &eng->loops[n].remote_stats[remote_index];
+        c_attempts += atomic_get(&rs->connection_attempts);
+        c_failures += atomic_get(&rs->connection_failures);
+    }
+    *attempts = c_attempts;
+    *failures = c_failures;
+}
+
 /*
  * Enable (1) and disable (0) the non-blocking mode on a file descriptor.
  */
@@ -790,1563 +3154,6978 @@ set_socket_xxxbuf(int fd, int opt, const char *opt_name, size_t value,
 }
 
 static void
-set_socket_options(int fd, struct loop_arguments *largs) {
-    int on = ~0;
-    int rc = setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
-    assert(rc != -1);
-    if(largs->params.nagle_setting != NSET_UNSET) {
-        int v = largs->params.nagle_setting;
-        rc = setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &v, sizeof(v));
+set_socket_options(int fd, sa_family_t family,
+                   struct loop_arguments *largs) {
+    /* The --udp and Unix domain sockets have no TCP options to set. */
+    if(!largs->params.udp && family != AF_UNIX) {
+        int on = ~0;
+        int rc = setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
         assert(rc != -1);
+        if(largs->params.nagle_setting != NSET_UNSET) {
+            int v = largs->params.nagle_setting;
+            rc = setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &v, sizeof(v));
+            assert(rc != -1);
+        }
+#ifdef SO_RCVLOWAT
+        /* Wake up once that much data is there, see --rcvlowat. */
+        if(largs->params.sock_rcvlowat) {
+            int v = largs->params.sock_rcvlowat;
+            rc = setsockopt(fd, SOL_SOCKET, SO_RCVLOWAT, &v, sizeof(v));
+            assert(rc != -1);
+        }
+#endif
+#ifdef TCP_NOTSENT_LOWAT
+        /* Keep the data waiting in our process, see --notsent-lowat. */
+        if(largs->params.sock_notsent_lowat) {
+            int v = largs->params.sock_notsent_lowat;
+            rc = setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &v, sizeof(v));
+            assert(rc != -1);
+        }
+#endif
+    }
+#ifdef SO_BUSY_POLL
+    /*
+     * Let the kernel poll the device queue for this socket's data,
+     * see --busy-poll. Raising it above the net.core.busy_read sysctl
+     * takes CAP_NET_ADMIN, so the failures are not fatal.
+     */
+    if(largs->params.busy_poll > 0.0) {
+        int usec = largs->params.busy_poll < 1.0 ? 1e6 * largs->params.busy_poll
+                                                 : 1000000;
+        if(setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) == -1)
+            DEBUG(DBG_DETAIL, "Can't set SO_BUSY_POLL: %s\n", strerror(errno));
+#ifdef SO_PREFER_BUSY_POLL
+        int on = 1;
+        (void)setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &on, sizeof(on));
+#endif
     }
+#endif
 
     SET_XXXBUF(fd, SO_RCVBUF, largs->params.sock_rcvbuf_size);
 
     SET_XXXBUF(fd, SO_SNDBUF, largs->params.sock_sndbuf_size);
 }
 
-size_t
-engine_initiate_new_connections(struct engine *eng, size_t n_req) {
-    static char buf[1024]; /* This is thread-safe! */
-    if(!buf[0]) {
-        memset(buf, 'c', sizeof(buf));
-    }
-    size_t n = 0;
+/*
+ * Returns non-zero if the kernel accepted SO_ZEROCOPY on the socket.
+ */
+static int
+enable_zerocopy(int UNUSED fd) {
+#ifdef TCPKALI_ZEROCOPY
+    int on = 1;
+    return setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) == 0;
+#else
+    return 0;
+#endif
+}
 
-    enum {
-        ATTEMPT_FAIR_BALANCE,
-        FIRST_READER_WINS
-    } balance = ATTEMPT_FAIR_BALANCE;
-    if(balance == ATTEMPT_FAIR_BALANCE) {
-        while(n < n_req) {
-            int worker = eng->next_worker_order[CONTROL_MESSAGE_CONNECT]++
-                         % eng->n_workers;
-            int fd = eng->loops[worker].private_control_pipe_wr;
-            int wrote = write(fd, buf, 1);
-            if(wrote == -1 && errno == EINTR) /* Ctrl+C? */
-                return n;
-            assert(wrote == 1);
-            n++;
-        }
-    } else {
-        int fd = eng->global_control_pipe_wr;
-        set_nbio(fd, 1);
-        while(n < n_req) {
-            int current_batch =
-                (n_req - n) < sizeof(buf) ? (n_req - n) : sizeof(buf);
-            int wrote = write(fd, buf, current_batch);
-            if(wrote == -1) {
-                if(errno == EAGAIN) break;
-                if(errno == EINTR) return n; /* Ctrl+C? */
-                assert(wrote != -1);
-            }
-            if(wrote > 0) n += wrote;
+/*
+ * --zerocopy-receive: map the whole pages of the received data into the
+ * connection's window of the socket, instead of copying them out.
+ * What can't be mapped, such as the partial page at the end of the data,
+ * is read() into the (buf). Sets (*data) to where the returned bytes are,
+ * and (*unread) to the number of bytes known to be left in the socket.
+ */
+static ssize_t
+zerocopy_read(struct loop_arguments *largs, struct connection *conn, int fd,
+              char *buf, size_t size, char **data, size_t *unread) {
+    *data = buf;
+    *unread = 0;
+#ifdef TCPKALI_ZEROCOPY_RECEIVE
+    if(!conn->cold->zerocopy_rx_map) {
+        void *map =
+            mmap(NULL, largs->zerocopy_rx_size, PROT_READ, MAP_SHARED, fd, 0);
+        if(map == MAP_FAILED) {
+            DEBUG(DBG_DETAIL, "--zerocopy-receive is not usable: %s\n",
+                  strerror(errno));
+            conn->zerocopy_rx = 0;
+            return read(fd, buf, size);
         }
-        set_nbio(fd, 0);
+        conn->cold->zerocopy_rx_map = map;
     }
-    return n;
-}
-
-static void
-expire_channel_lives(TK_P_ tk_timer UNUSED *w, int UNUSED revents) {
-    struct loop_arguments *largs = tk_userdata(TK_A);
-    struct connection *conn;
-    struct connection *tmpconn;
 
-    assert(limit_channel_lifetime(largs));
-    double delta = tk_now(TK_A) - largs->params.epoch;
-    TAILQ_FOREACH_SAFE(conn, &largs->open_conns, hook, tmpconn) {
-        double expires_in = conn->channel_eol_point - delta;
-        if(expires_in <= 0.0) {
-            close_connection(TK_A_ conn, CCR_CLEAN);
-        } else {
-            /*
-             * Channels are added to the tail of the queue and have the same
-             * Expiration timeout. This channel and the others after it
-             * are not yet expired. Restart timeout so we'll get to it
-             * and the one after it when the time is really due.
-             */
-            setup_channel_lifetime_timer(TK_A_ expires_in);
-            break;
+    /* The struct tcp_zerocopy_receive of <linux/tcp.h>, up to the .err */
+    struct {
+        uint64_t address;
+        uint32_t length;
+        uint32_t recv_skip_hint;
+        uint32_t inq;
+        int32_t err;
+    } zc;
+    memset(&zc, 0, sizeof(zc));
+    zc.address = (uintptr_t)conn->cold->zerocopy_rx_map;
+    zc.length = size / largs->zerocopy_rx_page * largs->zerocopy_rx_page;
+    socklen_t zc_len = sizeof(zc);
+    if(zc.length == 0) {
+        return read(fd, buf, size);
+    } else if(getsockopt(fd, IPPROTO_TCP, TCP_ZEROCOPY_RECEIVE, &zc, &zc_len)
+              == -1) {
+        /* The socket errors are reported by read(). */
+        if(errno != EINTR && errno != EAGAIN) {
+            DEBUG(DBG_DETAIL, "--zerocopy-receive is not usable: %s\n",
+                  strerror(errno));
+            conn->zerocopy_rx = 0;
         }
+        return read(fd, buf, size);
+    } else if(zc.err) {
+        errno = zc.err;
+        return -1;
+    } else if(zc.length) {
+        atomic_add(&largs->zerocopy_rx_bytes, zc.length);
+        *data = conn->cold->zerocopy_rx_map;
+        /* The older kernels don't tell the (inq) */
+        *unread = zc.inq > zc.recv_skip_hint ? zc.inq : zc.recv_skip_hint;
+        return zc.length;
     }
-}
 
-static void
-stats_timer_cb(TK_P_ tk_timer UNUSED *w, int UNUSED revents) {
-    connections_flush_stats(TK_A);
+    /* Copy out what precedes the next whole pages, leaving them mapped. */
+    if(zc.recv_skip_hint && zc.recv_skip_hint < size)
+        size = zc.recv_skip_hint;
+    ssize_t rd = read(fd, buf, size);
+    if(rd > 0 && zc.inq > (size_t)rd) *unread = zc.inq - rd;
+    return rd;
+#else
+    (void)largs;
+    (void)conn;
+    return read(fd, buf, size);
+#endif
 }
 
-static void *
-single_engine_loop_thread(void *argp) {
-    struct loop_arguments *largs = (struct loop_arguments *)argp;
-    tk_loop *loop = tk_loop_new();
-    tk_set_userdata(loop, largs);
-
-    tk_io global_control_watcher;
-    tk_io private_control_watcher;
-    const int on_main_thread = (largs->thread_no == 0);
-
-#ifdef SO_REUSEPORT
-    const int have_reuseport = 1;
-#else
-    const int have_reuseport = 0;
-#endif
-
-    /*
-     * If want to serve connections but don't have SO_REUSEPORT,
-     * tell the user upfront.
-     */
-    if(!have_reuseport && on_main_thread
-       && largs->params.listen_addresses.n_addrs) {
-        warning(
-            "A system without SO_REUSEPORT detected."
-            " Using only one core for serving connections.\n");
-    }
-
-    signal(SIGPIPE, SIG_IGN);
-
-    tcpkali_ssl_thread_setup();
-    /*
-     * Open all listening sockets, if they are specified.
-     */
-    if(largs->params.listen_addresses.n_addrs
-       /* Only listen on stuff on other cores when SO_REUSEPORT is available */
-       && (have_reuseport || on_main_thread)) {
-        int opened_listening_sockets = 0;
-        for(size_t n = 0; n < largs->params.listen_addresses.n_addrs; n++) {
-            struct sockaddr_storage *ss =
-                &largs->params.listen_addresses.addrs[n];
-            int rc;
-            int lsock = socket(ss->ss_family, SOCK_STREAM, IPPROTO_TCP);
-            assert(lsock != -1);
-            set_nbio(lsock, 1);
-#ifdef SO_REUSEPORT
-            int on = ~0;
-            rc = setsockopt(lsock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
-            assert(rc != -1);
-#else
 /*
- * SO_REUSEPORT cannot be used, which means that only a single
- * thread could create their own separate listening socket on
- * a specified address/port. This is bad, but changing.
- * See http://permalink.gmane.org/gmane.linux.network/158320
+ * The writes whose kernel send timestamps are yet to be collected
+ * from the socket error queue, see --latency-timestamping.
+ * The kernel identifies a write by the offset of its last byte,
+ * counted from the moment SO_TIMESTAMPING was enabled.
  */
-#endif /* SO_REUSEPORT */
-            rc = bind(lsock, (struct sockaddr *)ss, sockaddr_len(ss));
-            if(rc == -1) {
-                char buf[256];
-                DEBUG(DBG_ALWAYS, "Bind %s is not done on thread %d: %s\n",
-                      format_sockaddr(ss, buf, sizeof(buf)), largs->thread_no,
-                      strerror(errno));
-                exit(EX_UNAVAILABLE);
-            }
-            assert(rc == 0);
-            rc = listen(lsock, 256);
-            assert(rc == 0);
-            opened_listening_sockets++;
-
-            struct connection *conn = calloc(1, sizeof(*conn));
-            conn->conn_type = CONN_ACCEPTOR;
-            /* avoid TAILQ_INSERT_TAIL(&largs->open_conns, conn, hook); */
-            pacefier_init(&conn->send_pace, -1.0, tk_now(TK_A));
-            pacefier_init(&conn->recv_pace, -1.0, tk_now(TK_A));
-#ifdef USE_LIBUV
-            uv_poll_init(TK_A_ & conn->watcher, lsock);
-            uv_poll_start(&conn->watcher, TK_READ | TK_WRITE, accept_cb_uv);
-#else
-            ev_io_init(&conn->watcher, accept_cb, lsock, TK_READ | TK_WRITE);
-            ev_io_start(TK_A_ & conn->watcher);
-#endif
-        }
-        if(!opened_listening_sockets) {
-            DEBUG(DBG_ALWAYS, "Could not listen on any local sockets!\n");
-            exit(EX_UNAVAILABLE);
-        }
-    }
-
-    const int stats_flush_interval_ms = 42;
-#ifdef USE_LIBUV
-    if(limit_channel_lifetime(largs)) {
-        uv_timer_init(TK_A_ & largs->channel_lifetime_timer);
-        uv_timer_start(&largs->channel_lifetime_timer, expire_channel_lives_uv,
-                       0, 0);
-    }
-    uv_timer_init(TK_A_ & largs->stats_timer);
-    uv_timer_start(&largs->stats_timer, stats_timer_cb_uv, stats_flush_interval_ms, stats_flush_interval_ms);
-    uv_poll_init(TK_A_ & global_control_watcher,
-                 largs->global_control_pipe_rd_nbio);
-    uv_poll_init(TK_A_ & private_control_watcher,
-                 largs->private_control_pipe_rd);
-    uv_poll_start(&global_control_watcher, TK_READ, control_cb_uv);
-    uv_poll_start(&private_control_watcher, TK_READ, control_cb_uv);
-    uv_run(TK_A_ UV_RUN_DEFAULT);
-    uv_timer_stop(&largs->stats_timer);
-    uv_poll_stop(&global_control_watcher);
-    uv_poll_stop(&private_control_watcher);
-#else
-    if(limit_channel_lifetime(largs)) {
-        ev_timer_init(&largs->channel_lifetime_timer, expire_channel_lives, 0,
-                      0);
-    }
-    ev_timer_init(&largs->stats_timer, stats_timer_cb, stats_flush_interval_ms / 1000.0, stats_flush_interval_ms / 1000.0);
-    ev_timer_start(TK_A_ & largs->stats_timer);
-    ev_io_init(&global_control_watcher, control_cb,
-               largs->global_control_pipe_rd_nbio, TK_READ);
-    ev_io_init(&private_control_watcher, control_cb,
-               largs->private_control_pipe_rd, TK_READ);
-    ev_io_start(loop, &global_control_watcher);
-    ev_io_start(loop, &private_control_watcher);
-    ev_run(loop, 0);
-    ev_timer_stop(TK_A_ & largs->stats_timer);
-    ev_io_stop(TK_A_ & global_control_watcher);
-    ev_io_stop(TK_A_ & private_control_watcher);
-#endif
-
-    connections_flush_stats(TK_A);
-
-    close_all_connections(TK_A_ CCR_CLEAN);
-
-    /* Avoid mixing debug output from several threads. */
-    pthread_mutex_lock(largs->serialize_output_lock);
-
-    DEBUG(DBG_DETAIL,
-          "Exiting worker %d\n"
-          "  %" PRIan "↓, %" PRIan "↑ open connections (%" PRIan
-          " connecting)\n"
-          "  %" PRIan
-          " connections_counter \n"
-          "  ↳ %lu connections_initiated\n"
-          "  ↳ %lu connections_accepted\n"
-          "  %lu connection_failures\n"
-          "  ↳ %lu connection_timeouts\n"
-          "  %" PRIaw
-          " worker_data_sent\n"
-          "  %" PRIaw
-          " worker_data_rcvd\n"
-          "  %" PRIaw
-          " worker_num_writes\n"
-          "  %" PRIaw " worker_num_reads\n",
-          largs->thread_no, atomic_get(&largs->incoming_established),
-          atomic_get(&largs->outgoing_established),
-          atomic_get(&largs->outgoing_connecting),
-          atomic_get(&largs->connections_counter),
-          largs->worker_connections_initiated,
-          largs->worker_connections_accepted, largs->worker_connection_failures,
-          largs->worker_connection_timeouts,
-          atomic_wide_get(&largs->worker_traffic_stats.bytes_sent),
-          atomic_wide_get(&largs->worker_traffic_stats.bytes_rcvd),
-          atomic_wide_get(&largs->worker_traffic_stats.num_writes),
-          atomic_wide_get(&largs->worker_traffic_stats.num_reads));
+#define TSTAMP_TX_PENDING 64 /* Older writes are forgotten */
+struct tstamp_state {
+    uint32_t bytes_sent;    /* Since SO_TIMESTAMPING was enabled */
+    uint32_t messages_sent; /* Pushed into the sent timestamps ring */
+    uint32_t head;          /* Oldest pending write, free-running */
+    uint32_t tail;          /* Next pending write, free-running */
+    struct tstamp_pending_write {
+        uint32_t last_byte;     /* Key of the write's timestamp */
+        uint32_t messages_upto; /* (messages_sent) after the write */
+        uint32_t messages;      /* Messages started by the write */
+    } pending[TSTAMP_TX_PENDING];
+};
 
-    if(largs->connect_histogram_local) {
-        struct hdr_histogram *hist = largs->connect_histogram_local;
-        DEBUG(DBG_DETAIL,
-              "  Connect latency:\n"
-              "    %.1f latency_95_ms\n"
-              "    %.1f latency_99_ms\n"
-              "    %.1f latency_99_5_ms\n"
-              "    %.1f latency_mean_ms\n"
-              "    %.1f latency_max_ms\n",
-              hdr_value_at_percentile(hist, 95.0) / 10.0,
-              hdr_value_at_percentile(hist, 99.0) / 10.0,
-              hdr_value_at_percentile(hist, 99.5) / 10.0, hdr_mean(hist) / 10.0,
-              hdr_max(hist) / 10.0);
-        if(largs->params.verbosity_level >= DBG_DEBUG)
-            hdr_percentiles_print(hist, stderr, 5, 10, CLASSIC);
+/*
+ * Ask the kernel to timestamp the sent and received data of
+ * the connection. The send timestamps are only matched to the messages
+ * of the --latency-marker, so the receive-only connections are skipped.
+ */
+static void
+tstamp_enable(TK_P_ struct connection *conn, int UNUSED sockfd) {
+#ifdef TCPKALI_TIMESTAMPING
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    int flags = SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    if(largs->params.latency_timestamping == LTS_HARDWARE) {
+        flags |= SOF_TIMESTAMPING_TX_HARDWARE | SOF_TIMESTAMPING_RX_HARDWARE
+                 | SOF_TIMESTAMPING_RAW_HARDWARE;
+    } else {
+        flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE
+                 | SOF_TIMESTAMPING_SOFTWARE;
     }
-    if(largs->marker_histogram_local) {
-        struct hdr_histogram *hist = largs->marker_histogram_local;
-        DEBUG(DBG_DETAIL,
-              "  Marker latency:\n"
-              "    %.1f latency_95_ms\n"
-              "    %.1f latency_99_ms\n"
-              "    %.1f latency_99_5_ms\n"
-              "    %.1f latency_mean_ms\n"
-              "    %.1f latency_max_ms\n",
-              hdr_value_at_percentile(hist, 95.0) / 10.0,
-              hdr_value_at_percentile(hist, 99.0) / 10.0,
-              hdr_value_at_percentile(hist, 99.5) / 10.0, hdr_mean(hist) / 10.0,
-              hdr_max(hist) / 10.0);
-        if(largs->params.verbosity_level >= DBG_DEBUG)
-            hdr_percentiles_print(hist, stderr, 5, 10, CLASSIC);
+    if(setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags))
+       == -1) {
+        DEBUG(DBG_WARNING, "Can't enable SO_TIMESTAMPING on fd %d: %s\n",
+              sockfd, strerror(errno));
+        return;
     }
 
     /*
-     * Print the scratch buffer to highlight the last thing received.
+     * The kernel timestamps are taken against CLOCK_REALTIME (or the NIC
+     * clock synchronized with it), not necessarily against the loop time.
      */
-    if(largs->params.verbosity_level >= DBG_DETAIL) {
-        debug_dump_data("Last received bytes ", -1, largs->scratch_recv_buf,
-                        largs->scratch_recv_last_size, -1500);
+    if(largs->tstamp_offset == 0.0) {
+        struct timespec rt;
+        clock_gettime(CLOCK_REALTIME, &rt);
+        largs->tstamp_offset =
+            tk_now(TK_A) - (rt.tv_sec + rt.tv_nsec / 1000000000.0);
     }
 
-    pthread_mutex_unlock(largs->serialize_output_lock);
+    conn->cold->latency.tstamp = calloc(1, sizeof(*conn->cold->latency.tstamp));
+    assert(conn->cold->latency.tstamp);
+    conn->timestamping = 1;
+#else
+    (void)loop;
+    (void)conn;
+#endif
+}
 
-    return 0;
+#ifdef TCPKALI_TIMESTAMPING
+/*
+ * Convert the SCM_TIMESTAMPING data into the loop time, or 0.0
+ * if the requested kind of timestamp is not there.
+ */
+static double
+tstamp_loop_time(struct loop_arguments *largs,
+                 const struct scm_timestamping *tss) {
+    const struct timespec *ts =
+        &tss->ts[largs->params.latency_timestamping == LTS_HARDWARE ? 2 : 0];
+    if(ts->tv_sec == 0 && ts->tv_nsec == 0) return 0.0;
+    return ts->tv_sec + ts->tv_nsec / 1000000000.0 + largs->tstamp_offset;
 }
+#endif
 
 /*
- * Init HDR Histogram with properties similar to a given one.
+ * Read the data along with its kernel receive timestamp,
+ * which is left in largs->scratch_recv_ts.
  */
-static struct hdr_histogram *
-hdr_init_similar(struct hdr_histogram *htemplate) {
-    if(htemplate) {
-        struct hdr_histogram *dst = 0;
-        if(hdr_init(htemplate->lowest_trackable_value,
-                    htemplate->highest_trackable_value,
-                    htemplate->significant_figures, &dst)
-           == 0) {
-            return dst;
-        } else {
-            assert(!"Can't create copy of histogram");
+static ssize_t
+tstamp_read(TK_P_ struct connection *conn, void *buf, size_t size) {
+#ifdef TCPKALI_TIMESTAMPING
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    char control[128];
+    struct iovec iov = {.iov_base = buf, .iov_len = size};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    largs->scratch_recv_ts = 0.0;
+    ssize_t rd = recvmsg(tk_fd(&conn->watcher), &msg, 0);
+    if(rd > 0) {
+        struct cmsghdr *cm;
+        for(cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if(cm->cmsg_level == SOL_SOCKET
+               && cm->cmsg_type == SCM_TIMESTAMPING) {
+                largs->scratch_recv_ts =
+                    tstamp_loop_time(largs, (void *)CMSG_DATA(cm));
+            }
         }
     }
-    return NULL;
+    return rd;
+#else
+    (void)loop;
+    return read(tk_fd(&conn->watcher), buf, size);
+#endif
 }
 
 /*
- * Copy a histogram by erasing the destination histogram first and adding
- * the source histogram into it.
+ * Ask the worker to open (n) more connections. The worker gets
+ * at most one wakeup byte, no matter how many connections it is asked
+ * to open before it gets to them.
  */
 static void
-histogram_data_copy_to_shared(struct hdr_histogram *src,
-                              struct hdr_histogram **dst) {
-    if(src) {
-        if(*dst) {
-            hdr_reset(*dst);
-        } else {
-            *dst = hdr_init_similar(src);
-            assert(*dst);
-        }
-        hdr_add(*dst, src);
+worker_request_connections(struct loop_arguments *largs, size_t n) {
+    if(n == 0
+       || atomic_add_and_get(&largs->connections_requested, n) != n)
+        return; /* The worker is already signalled */
+    for(;;) {
+        int wrote = write(largs->private_control_pipe_wr, "c", 1);
+        if(wrote == -1 && errno == EINTR) continue;
+        assert(wrote == 1);
+        break;
     }
 }
 
 /*
- * Each worker maintains two sets of histogram data structures:
- *  1) the xxx_histogram_local ones, which are not protected by mutex
- *     and are directly writable by connections when they operate and die.
- *  2) the xxx_histogram_shared, which are protected by the mutex and
- *     are only updated from time to time.
- *     The shared ones are used for reporting to external observers.
+ * Give the connections to the workers with the fewest connections
+ * (open, being opened or asked for), or, with --worker-select least-busy,
+ * the fewest per the share of time the worker has to spare.
  */
 static void
-worker_update_shared_histograms(struct loop_arguments *largs) {
-    if(largs->params.latency_setting == 0) return;
-
-    pthread_mutex_lock(&largs->shared_histograms_lock);
+worker_select_least_loaded(struct engine *eng, size_t n_req) {
+    int n_workers = eng->n_workers;
+    double *load = calloc(n_workers, sizeof(load[0]));
+    double *capacity = calloc(n_workers, sizeof(capacity[0]));
+    size_t *added = calloc(n_workers, sizeof(added[0]));
+    assert(load && capacity && added);
+
+    for(int n = 0; n < n_workers; n++) {
+        struct loop_arguments *largs = &eng->loops[n];
+        load[n] = atomic_get(&largs->outgoing_connecting)
+                  + atomic_get(&largs->outgoing_established)
+                  + atomic_get(&largs->incoming_established)
+                  + atomic_get(&largs->reconnects_pending)
+                  + atomic_get(&largs->connections_requested);
+        capacity[n] = 1.0;
+        if(eng->params.worker_select == WSEL_LEAST_BUSY) {
+            double busy = atomic_get(&largs->loop_busy_permille) / 1000.0;
+            /* Even a saturated worker takes some, to be measured. */
+            capacity[n] = busy < LEAST_BUSY_MAX ? 1.0 - busy
+                                                : 1.0 - LEAST_BUSY_MAX;
+        }
+    }
 
-    /* --latency-connect */
-    histogram_data_copy_to_shared(largs->connect_histogram_local,
-                                  &largs->connect_histogram_shared);
+    balance_fill(load, capacity, n_workers, n_req, added);
+    for(int n = 0; n < n_workers; n++)
+        worker_request_connections(&eng->loops[n], added[n]);
 
-    /* --latency-firstbyte */
-    histogram_data_copy_to_shared(largs->firstbyte_histogram_local,
-                                  &largs->firstbyte_histogram_shared);
+    free(load);
+    free(capacity);
+    free(added);
+}
 
-    /* --latency-marker */
-    histogram_data_copy_to_shared(largs->marker_histogram_local,
-                                  &largs->marker_histogram_shared);
+size_t
+engine_initiate_new_connections(struct engine *eng, size_t n_req) {
+    static char buf[1024]; /* This is thread-safe! */
+    if(!buf[0]) {
+        memset(buf, 'c', sizeof(buf));
+    }
+    size_t n = 0;
 
-    if(largs->marker_histogram_local) {
+    enum {
+        ATTEMPT_FAIR_BALANCE,
+        LEAST_LOADED,
+        FIRST_READER_WINS
+    } balance = eng->params.worker_select == WSEL_EVEN ? ATTEMPT_FAIR_BALANCE
+                                                       : LEAST_LOADED;
+    if(balance == ATTEMPT_FAIR_BALANCE) {
         /*
-         * 2. There are connections with accumulated data,
-         *    process a few of them (all would be expensive)
-         *    and add their data as well.
-         * FYI: 10 hdr_adds() take ~0.2ms.
+         * Split the request evenly between the workers,
+         * rotating the remainder.
          */
-        struct connection *conn;
-        int nmax = 10;
-        TAILQ_FOREACH(conn, &largs->open_conns, hook) {
-            if(conn->latency.marker_histogram) {
-                /* Only active connections might histograms */
-                hdr_add(largs->marker_histogram_shared,
-                        conn->latency.marker_histogram);
-                if(--nmax == 0) break;
+        size_t per_worker = n_req / eng->n_workers;
+        size_t remainder = n_req % eng->n_workers;
+        int first = eng->next_worker_order[CONTROL_MESSAGE_CONNECT];
+        eng->next_worker_order[CONTROL_MESSAGE_CONNECT] += remainder;
+        for(int i = 0; i < eng->n_workers && n < n_req; i++) {
+            size_t share = per_worker + ((size_t)i < remainder ? 1 : 0);
+            if(share == 0) break;
+            n += share;
+            worker_request_connections(
+                &eng->loops[(first + i) % eng->n_workers], share);
+        }
+    } else if(balance == LEAST_LOADED) {
+        worker_select_least_loaded(eng, n_req);
+        n = n_req;
+    } else {
+        int fd = eng->global_control_pipe_wr;
+        set_nbio(fd, 1);
+        while(n < n_req) {
+            int current_batch =
+                (n_req - n) < sizeof(buf) ? (n_req - n) : sizeof(buf);
+            int wrote = write(fd, buf, current_batch);
+            if(wrote == -1) {
+                if(errno == EAGAIN) break;
+                if(errno == EINTR) return n; /* Ctrl+C? */
+                assert(wrote != -1);
             }
+            if(wrote > 0) n += wrote;
         }
+        set_nbio(fd, 0);
     }
+    return n;
+}
 
-
-    pthread_mutex_unlock(&largs->shared_histograms_lock);
+/*
+ * Make close(2) drop the connection with RST, leaving no TIME_WAIT behind.
+ */
+static void
+set_linger_reset(int fd) {
+    struct linger lg = {.l_onoff = 1, .l_linger = 0};
+    (void)setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
 }
 
 /*
- * Receive a control event from the pipe.
+ * Time to close a connection which has lived for --channel-lifetime.
+ * With --close-style half-close and wait-peer the other side is given
+ * a --connect-timeout to close first, then the connection is reset.
  */
 static void
-control_cb(TK_P_ tk_io *w, int UNUSED revents) {
+expire_channel_life(struct tk_wheel *wheel, struct tk_wheel_entry *e) {
+    TK_P = wheel->userdata;
     struct loop_arguments *largs = tk_userdata(TK_A);
+    struct connection *conn =
+        (struct connection *)((char *)e
+                              - offsetof(struct connection, lifetime_timer));
 
-    char c;
-    int ret = read(tk_fd(w), &c, 1);
-    if(ret != 1) {
-        if(errno != EAGAIN)
-            DEBUG(DBG_ALWAYS,
-                  "%d Reading from control channel %d returned: %s\n",
-                  largs->thread_no, tk_fd(w), strerror(errno));
-        return;
-    }
-    switch(c) {
-    case 'c': /* Initiate a new connection */
-        start_new_connection(TK_A);
+    switch(largs->params.close_style) {
+    case CLOSE_GRACEFUL:
+    case CLOSE_RESET:
         break;
-    case 'r': /* Recompute message rate on live connections */
-        largs->params.channel_send_rate =
-            largs->shared_eng_params->channel_send_rate;
-
-        struct connection *conn;
-        TAILQ_FOREACH(conn, &largs->open_conns, hook) {
-            conn->send_limit = compute_bandwidth_limit_by_message_size(
-                largs->params.channel_send_rate,
-                conn->avg_message_size);
-            double now = tk_now(TK_A);
-            if(conn->conn_type == CONN_OUTGOING
-                    || (largs->params.listen_mode & _LMODE_SND_MASK)) {
-                pacefier_init(&conn->send_pace, conn->send_limit.bytes_per_second, now);
-            }
-        }
-        if(largs->marker_histogram_local && largs->marker_histogram_shared) {
-            pthread_mutex_lock(&largs->shared_histograms_lock);
-            hdr_reset(largs->marker_histogram_local);
-            hdr_reset(largs->marker_histogram_shared);
-            pthread_mutex_unlock(&largs->shared_histograms_lock);
-            TAILQ_FOREACH(conn, &largs->open_conns, hook) {
-                hdr_reset(conn->latency.marker_histogram);
-            }
+    case CLOSE_HALF:
+    case CLOSE_WAIT_PEER:
+        if(conn->closing) {
+            set_linger_reset(tk_fd(&conn->watcher));
+            break;
+        } else if(conn->conn_state != CSTATE_CONNECTED || conn->echo) {
+            break;
         }
-        break;
-    case 'T': /* Terminate */
-        worker_update_shared_histograms(largs);
-        tk_stop(TK_A);
-        break;
-    case 'h': /* Update historgrams */
-        worker_update_shared_histograms(largs);
-        int wrote = write(largs->global_feedback_pipe_wr, ".", 1);
-        assert(wrote == 1);
-        break;
-    default:
-        DEBUG(DBG_ALWAYS, "Unknown operation '%c' from a control channel %d\n",
-              c, tk_fd(w));
-    }
-}
-
-static ssize_t
-expr_callback(char *buf, size_t size, tk_expr_t *expr, void *key, long *v) {
-    struct connection *conn = key;
-    ssize_t s;
-
-    switch(expr->type) {
-    case EXPR_CONNECTION_PTR:
-        s = snprintf(buf, size, "%p", conn);
-        if(v) *v = (long)conn;
-        break;
-    case EXPR_CONNECTION_UID:
-        s = snprintf(buf, size, "%" PRIan, conn->connection_unique_id);
-        if(v) *v = (long)conn->connection_unique_id;
-        break;
-    case EXPR_MESSAGE_MARKER: {
-#define MZEROS   "0000000000000000"
-        const size_t tok_size = sizeof(MESSAGE_MARKER_TOKEN MZEROS ".")-1;
-        assert(size >= tok_size);
-        memcpy(buf, MESSAGE_MARKER_TOKEN MZEROS ".", tok_size);
-        s = tok_size;
-        if(v) *v = (long)0;
-        break;
-    }
-    default:
-        s = snprintf(buf, size, "?");
-        if(v) *v = 0;
-        break;
+        conn->closing = 1;
+        if(largs->params.close_style == CLOSE_HALF)
+            shutdown(tk_fd(&conn->watcher), SHUT_WR);
+        conn->conn_wish &= ~CW_WRITE_INTEREST;
+        conn->conn_wish |= CW_READ_INTEREST;
+        update_io_interest(TK_A_ conn);
+        timer_wheel_schedule(TK_A_ & conn->lifetime_timer,
+                             largs->params.connect_timeout);
+        return;
     }
 
-    if(s < 0 || s > (ssize_t)size) return -1;
-    return s;
+    close_connection(TK_A_ conn, CCR_LIFETIME);
 }
 
+/*
+ * --send-budget: the paced connections whose time to write has come are
+ * queued by the intended time of their pending data, and the most overdue
+ * ones are written first, up to the budget per event loop iteration.
+ * Under overload, the pacing debt is spread over all the connections
+ * instead of piling up on the ones the timers happen to fire last.
+ */
 static void
-explode_data_template(struct message_collection *mc,
-                      struct transport_data_spec *const data_templates[2],
-                      enum transport_websocket_side tws_side,
-                      struct transport_data_spec *out_data,
-                      struct loop_arguments *largs,
-                      struct connection *conn) {
-    if(data_templates[tws_side]) {
-        assert(mc->most_dynamic_expression == DS_GLOBAL_FIXED);
-        /*
-         * Return the already once prepared data.
-         */
-        *out_data = *data_templates[tws_side];
-        out_data->flags |= TDS_FLAG_PTR_SHARED;
-    } else {
-        /*
-         * We might need a unique ID for a connection, and it is a bit expensive
-         * to obtain it. We set it here once during connection establishment.
-         */
-        conn->connection_unique_id =
-            atomic_inc_and_get(largs->connection_unique_id_atomic);
-
-        struct transport_data_spec *new_data_ptr;
-        new_data_ptr = transport_spec_from_message_collection(
-            out_data, mc, expr_callback, conn, tws_side, TS_CONVERSION_INITIAL, &largs->rng);
-        assert(new_data_ptr == out_data);
+send_queue_place(struct loop_arguments *largs, size_t index,
+                 struct send_queue_entry entry) {
+    largs->send_queue.entries[index] = entry;
+    entry.conn->cold->send_queue_slot = index + 1;
+}
 
-        switch(mc->most_dynamic_expression) {
-        case DS_GLOBAL_FIXED:
-            assert(!"Unreachable");
-        case DS_PER_CONNECTION:
-            if(largs->params.message_marker == 0) {
-                replicate_payload(out_data, REPLICATE_MAX_SIZE);
-            }
-            break;
-        case DS_PER_MESSAGE:
+static void
+send_queue_sift_up(struct loop_arguments *largs, size_t index) {
+    struct send_queue_entry entry = largs->send_queue.entries[index];
+    while(index > 0) {
+        size_t parent = (index - 1) / 2;
+        if(largs->send_queue.entries[parent].deadline <= entry.deadline)
             break;
-        }
-        assert(out_data->ptr);
+        send_queue_place(largs, index, largs->send_queue.entries[parent]);
+        index = parent;
     }
+    send_queue_place(largs, index, entry);
 }
 
 static void
-explode_data_template_override(struct message_collection *mc,
-                               enum transport_websocket_side tws_side,
-                               struct transport_data_spec *out_data,
-                               struct loop_arguments *largs,
-                               struct connection *conn) {
-    assert(mc->most_dynamic_expression == DS_PER_MESSAGE);
+send_queue_sift_down(struct loop_arguments *largs, size_t index) {
+    struct send_queue_entry *entries = largs->send_queue.entries;
+    size_t count = largs->send_queue.count;
+    struct send_queue_entry entry = entries[index];
+    for(;;) {
+        size_t child = 2 * index + 1;
+        if(child >= count) break;
+        if(child + 1 < count
+           && entries[child + 1].deadline < entries[child].deadline)
+            child++;
+        if(entry.deadline <= entries[child].deadline) break;
+        send_queue_place(largs, index, entries[child]);
+        index = child;
+    }
+    send_queue_place(largs, index, entry);
+}
 
-    struct transport_data_spec *new_data_ptr;
-    new_data_ptr = transport_spec_from_message_collection(
-        out_data, mc, expr_callback, conn, tws_side,
-        TS_CONVERSION_OVERRIDE_MESSAGES, &largs->rng);
-    assert(new_data_ptr == out_data);
+/*
+ * Queue the connection to write once its turn comes, see send_queue_run().
+ * It stays CW_WRITE_BLOCKED meanwhile, so the poller does not wake it.
+ */
+static void
+send_queue_push(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct send_queue_entry entry = {
+        .deadline = send_intended_ts(conn, tk_now(TK_A)), .conn = conn};
+
+    if(conn->cold->send_queue_slot) send_queue_remove(largs, conn);
+    if(largs->send_queue.count == largs->send_queue.size) {
+        largs->send_queue.size =
+            largs->send_queue.size ? 2 * largs->send_queue.size : 64;
+        largs->send_queue.entries = realloc(
+            largs->send_queue.entries,
+            largs->send_queue.size * sizeof(largs->send_queue.entries[0]));
+        assert(largs->send_queue.entries);
+    }
+    largs->send_queue.entries[largs->send_queue.count++] = entry;
+    send_queue_sift_up(largs, largs->send_queue.count - 1);
 }
 
+/*
+ * Take the connection out of the queue, as it is closed or migrated.
+ */
 static void
-explode_string_expression(char **buf_p, size_t *size, tk_expr_t *expr,
-                          struct loop_arguments *largs,
-                          struct connection *conn) {
-    *buf_p = 0;
-    ssize_t s = eval_expression(buf_p, 0, expr, expr_callback, conn, 0,
-                                conn->conn_type == CONN_OUTGOING, &largs->rng);
-    assert(s >= 0);
-    *size = s;
+send_queue_remove(struct loop_arguments *largs, struct connection *conn) {
+    size_t index = conn->cold->send_queue_slot - 1;
+    struct send_queue_entry last =
+        largs->send_queue.entries[--largs->send_queue.count];
+    conn->cold->send_queue_slot = 0;
+    if(index == largs->send_queue.count) return;
+    send_queue_place(largs, index, last);
+    if(index > 0
+       && largs->send_queue.entries[(index - 1) / 2].deadline > last.deadline)
+        send_queue_sift_up(largs, index);
+    else
+        send_queue_sift_down(largs, index);
 }
 
-static void start_new_connection(TK_P) {
-    char tmpbuf[INET6_ADDRSTRLEN + 64];
+/*
+ * Write the most overdue of the queued connections, up to the budget.
+ */
+static void
+send_queue_run(TK_P) {
     struct loop_arguments *largs = tk_userdata(TK_A);
-    struct remote_stats *remote_stats;
-    size_t remote_index;
-
-    struct sockaddr_storage *ss = pick_remote_address(largs, &remote_index);
-    remote_stats = &largs->remote_stats[remote_index];
-
-    atomic_increment(&largs->connections_counter);
-    atomic_increment(&remote_stats->connection_attempts);
-    largs->worker_connections_initiated++;
-
-    int sockfd = socket(ss->ss_family, SOCK_STREAM, IPPROTO_TCP);
-    if(sockfd == -1) {
-        switch(errno) {
-        case EMFILE:
-            DEBUG(DBG_ERROR, "Cannot create socket: %s\n", strerror(errno));
-            DEBUG(DBG_ALWAYS,
-                  "Increase `ulimit -n` to twice exceed the --connections.\n");
-            exit(1);
-        case ENFILE:
-            DEBUG(DBG_ERROR, "Cannot create socket: %s\n", strerror(errno));
-            DEBUG(DBG_ALWAYS, "Increase kern.maxfiles/fs.file-max sysctls\n");
-            exit(1);
-        }
-        DEBUG(DBG_WARNING, "Cannot create socket: %s\n", strerror(errno));
-        return; /* Come back later */
-    } else {
-        set_nbio(sockfd, 1);
-        set_socket_options(sockfd, largs);
+    for(unsigned budget = largs->params.send_budget;
+        budget > 0 && largs->send_queue.count; budget--) {
+        struct connection *conn = largs->send_queue.entries[0].conn;
+        send_queue_remove(largs, conn);
+        conn->conn_wish &= ~CW_WRITE_BLOCKED;
+        update_io_interest(TK_A_ conn);
+        connection_cb(TK_A_ & conn->watcher, TK_WRITE);
     }
+}
 
-    /* If --source-ip is specified, bind to the next one. */
-    if(largs->params.source_addresses.n_addrs) {
-        struct sockaddr_storage *bind_ss =
-            &largs->params.source_addresses
-                 .addrs[largs->worker_connections_initiated
-                        % largs->params.source_addresses.n_addrs];
-        int rc =
-            bind(sockfd, (struct sockaddr *)bind_ss, sockaddr_len(bind_ss));
-        if(rc == -1) {
-            atomic_increment(&remote_stats->connection_failures);
-            largs->worker_connection_failures++;
-            close(sockfd);
-            DEBUG(DBG_WARNING, "Connection to %s is not done: %s\n",
-                  format_sockaddr(ss, tmpbuf, sizeof(tmpbuf)), strerror(errno));
-            return;
-        }
-    }
+/*
+ * (Re)start the event loop timer to fire when the timer wheel
+ * needs to move next.
+ */
+static void
+timer_wheel_rearm(TK_P) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    double now = tk_now(TK_A);
+    double timeout = tk_wheel_next_timeout(&largs->timer_wheel, now);
 
-    int conn_state;
-    int rc = connect(sockfd, (struct sockaddr *)ss, sockaddr_len(ss));
-    if(rc == -1) {
-        switch(errno) {
-        case EINPROGRESS:
-            break;
-        case EADDRNOTAVAIL: /* Bind failed */
-            if(largs->params.source_addresses.n_addrs) {
-                /* This is local problem, not remote address problem. */
-                largs->worker_connection_failures++;
-                DEBUG(DBG_WARNING, "Connection to %s is not done: %s\n",
-                      format_sockaddr(ss, tmpbuf, sizeof(tmpbuf)),
-                      strerror(errno));
-            }
-        /* FALL THROUGH */
-        default:
-            atomic_increment(&remote_stats->connection_failures);
-            largs->worker_connection_failures++;
-            if(atomic_get(&remote_stats->connection_failures) == 1) {
-                DEBUG(DBG_WARNING, "Connection to %s is not done: %s\n",
-                      format_sockaddr(ss, tmpbuf, sizeof(tmpbuf)),
-                      strerror(errno));
-            }
-            close(sockfd);
-            return;
-        }
+    /* Come back for the rest of the queue after polling the sockets. */
+    if(largs->send_queue.count) timeout = 0.0;
 
-        atomic_increment(&largs->outgoing_connecting);
-        conn_state = CSTATE_CONNECTING;
-    } else { /* This branch is for completeness only. Should not happen. */
-        if(largs->params.channel_lifetime == 0.0) {
-            close(sockfd);
-            return;
-        }
-        atomic_increment(&largs->outgoing_established);
-        conn_state = CSTATE_CONNECTED;
-        if(largs->connect_histogram_local)
-            hdr_record_value(largs->connect_histogram_local, 0);
+    if(timeout < 0.0) {
+        /* Nothing is scheduled, let the timer expire idly if armed. */
+        return;
     }
 
-    /*
-     * Print the src/dst for a connection if verbosity level is high enough.
-     */
-    if(largs->params.verbosity_level >= DBG_DETAIL) {
-        char srcaddr_buf[INET6_ADDRSTRLEN + 64];
-        char dstaddr_buf[INET6_ADDRSTRLEN + 64];
-        struct sockaddr_storage srcaddr;
-        socklen_t addrlen = sizeof(srcaddr);
-        if(getsockname(sockfd, (struct sockaddr *)&srcaddr, &addrlen) == 0) {
-            DEBUG(DBG_DETAIL, "Connection %s -> %s opened as %d\n",
-                  format_sockaddr(&srcaddr, srcaddr_buf, sizeof(srcaddr_buf)),
-                  format_sockaddr(ss, dstaddr_buf, sizeof(dstaddr_buf)),
-                  sockfd);
-        } else {
-            DEBUG(DBG_WARNING, "Can't getsockname(%d): %s", sockfd,
-                  strerror(errno));
-        }
-    }
+    largs->timer_wheel_deadline = now + timeout;
+#ifdef USE_LIBUV
+    uint64_t delay = ceil(1000 * timeout);
+    uv_timer_start(&largs->timer_wheel_timer, timer_wheel_cb_uv, delay, 0);
+#else
+    ev_timer_stop(TK_A_ & largs->timer_wheel_timer);
+    ev_timer_set(&largs->timer_wheel_timer, timeout, 0);
+    ev_timer_start(TK_A_ & largs->timer_wheel_timer);
+#endif
+}
 
-    struct connection *conn = calloc(1, sizeof(*conn));
-    conn->remote_index = remote_index;
-    common_connection_init(TK_A_ conn, CONN_OUTGOING, conn_state, sockfd);
+static void
+timer_wheel_cb(TK_P_ tk_timer UNUSED *w, int UNUSED revents) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    largs->timer_wheel_deadline = 0.0;
+    tk_wheel_advance(&largs->timer_wheel, tk_now(TK_A));
+    if(largs->send_queue.count) send_queue_run(TK_A);
+    timer_wheel_rearm(TK_A);
 }
 
 /*
- * Pick an address in a round-robin fashion, skipping certainly broken ones.
+ * Schedule a connection timer to fire in (delay) seconds from now.
+ * A single event loop timer serves all of them.
  */
-static struct sockaddr_storage *
-pick_remote_address(struct loop_arguments *largs, size_t *remote_index) {
-    /*
-     * If it is known that a particular destination is broken, choose
-     * the working one right away.
-     */
-    size_t off = 0;
-    for(size_t attempts = 0; attempts < largs->params.remote_addresses.n_addrs;
-        attempts++) {
-        off = largs->address_offset++ % largs->params.remote_addresses.n_addrs;
-        struct remote_stats *rs = &largs->remote_stats[off];
-        if(atomic_get(&rs->connection_attempts) > 10
-           && atomic_get(&rs->connection_failures)
-                  == atomic_get(&rs->connection_attempts)) {
-            continue;
-        } else {
-            break;
-        }
-    }
-
-    *remote_index = off;
-    return &largs->params.remote_addresses.addrs[off];
-}
-
 static void
-conn_timer_cb(TK_P_ tk_timer *w, int UNUSED revents) {
+timer_wheel_schedule(TK_P_ struct tk_wheel_entry *e, double delay) {
     struct loop_arguments *largs = tk_userdata(TK_A);
-    struct connection *conn =
-        (struct connection *)((char *)w - offsetof(struct connection, timer));
-
-    switch(conn->conn_state) {
-    case CSTATE_CONNECTED:
-        switch(conn->conn_type) {
-        case CONN_INCOMING:
-            if((largs->params.listen_mode & _LMODE_SND_MASK) == 0) {
-                conn->conn_wish &=
-                    ~(CW_READ_BLOCKED | CW_WRITE_BLOCKED | CW_WRITE_DELAYED);
-                update_io_interest(TK_A_ conn);
-                break;
-            }
-        /* Fall through */
-        case CONN_OUTGOING:
-            if(conn->conn_wish & CW_WRITE_DELAYED) {
-                /* Reinitialize the upstream bandwidth limit */
-                pacefier_init(&conn->send_pace,
-                              conn->send_limit.bytes_per_second, tk_now(TK_A));
-            }
-            conn->conn_wish &=
-                ~(CW_READ_BLOCKED | CW_WRITE_BLOCKED | CW_WRITE_DELAYED);
-            update_io_interest(TK_A_ conn);
-            break;
-        case CONN_ACCEPTOR:
-            assert(conn->conn_type != CONN_ACCEPTOR);
-            break;
-        }
-        break;
-    case CSTATE_CONNECTING:
-        /* Timed out in the connection establishment phase. */
-        close_connection(TK_A_ conn, CCR_TIMEOUT);
-        return;
+    double at = tk_now(TK_A) + delay;
+    tk_wheel_add(&largs->timer_wheel, e, at);
+    if(largs->timer_wheel_deadline == 0.0
+       || at < largs->timer_wheel_deadline) {
+        timer_wheel_rearm(TK_A);
     }
 }
 
+#if !defined(USE_LIBUV) && !defined(USE_IO_URING)
 /*
- * Check whether we have configured an extended (e.g., non-zero), but
- * finite channel lifetime. Zero channel lifetime is managed differently:
- * the channel closes right after we figure out that the connection took place.
+ * Run the callbacks of a loop iteration, accounting for the time
+ * they take, see loop_stats_publish().
  */
-static int
-limit_channel_lifetime(struct loop_arguments *largs) {
-    return (largs->params.channel_lifetime != INFINITY
-            && largs->params.channel_lifetime > 0.0);
+static void
+invoke_pending_timed(TK_P) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    unsigned int pending = ev_pending_count(TK_A);
+    if(pending == 0) return;
+
+    ev_tstamp started = ev_time();
+    ev_invoke_pending(TK_A);
+    ws_accepts_flush(TK_A);
+    ev_tstamp spent = ev_time() - started;
+
+    largs->loop_local.busy += spent;
+    if(largs->loop_local.stall < spent) largs->loop_local.stall = spent;
+    largs->loop_local.events += pending;
+    largs->loop_local.iterations++;
+    largs->busy_poll_last_event = ev_now(TK_A);
 }
 
+/*
+ * --busy-poll: check for the events without blocking in epoll_wait(2),
+ * saving the wakeup latency, for as long as the events keep coming.
+ * Past the spin budget since the latest event, block until the next one.
+ */
 static void
-setup_channel_lifetime_timer(TK_P_ double first_timeout) {
+busy_poll_run(TK_P) {
     struct loop_arguments *largs = tk_userdata(TK_A);
-#ifdef USE_LIBUV
-    uint64_t delay = 1000 * first_timeout;
-    if(delay == 0) delay = 1;
-    uv_timer_start(&largs->channel_lifetime_timer, expire_channel_lives_uv,
-                   delay, 0);
-#else
-    ev_timer_stop(TK_A_ & largs->channel_lifetime_timer);
-    ev_timer_set(&largs->channel_lifetime_timer, first_timeout, 0);
-    ev_timer_start(TK_A_ & largs->channel_lifetime_timer);
+    const double budget = largs->params.busy_poll;
+    while(!largs->loop_stopped) {
+        if(ev_now(TK_A) - largs->busy_poll_last_event < budget)
+            ev_run(TK_A_ EVRUN_NOWAIT);
+        else
+            ev_run(TK_A_ EVRUN_ONCE);
+    }
+}
 #endif
+
+static non_atomic_narrow_t
+loop_stats_micros(double seconds) {
+    return seconds < 4000.0 ? 1000000 * seconds : 4000000000u;
 }
 
 /*
- * If we're not dumping something on a main thread, and we need
- * to keep dumping some connection, enable data dumping for that connection.
+ * Make the event loop behavior over the last period
+ * visible to engine_loop_stats().
  */
 static void
-maybe_enable_dump(struct loop_arguments *largs, enum conn_type ctype, int fd) {
-    /*
-     * Enable dumping only on main (first) worker.
-     * It spares us from too much coordination over
-     * which worker's channel should get its data dumped.
-     */
-    const int main_thread = (largs->thread_no == 0);
-
-    if(main_thread
-       /* DS_DUMP_ALL is handled differently */
-       && (largs->params.dump_setting & DS_DUMP_ONE)
-       && largs->dump_connect_fd == 0
-       /*
-        * In case tcpkali acts as both client and listener (-l), we only dump
-        * client-side connections.
-        */
-       && (ctype == CONN_OUTGOING
-           || largs->params.remote_addresses.n_addrs == 0)) {
-        /*
-         * Enable dumping on a chosen file descriptor.
-         */
-        largs->dump_connect_fd = fd;
-    }
+loop_stats_publish(TK_P) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    double now = tk_now(TK_A);
+    double period = now - largs->loop_local.period_start;
+    if(period <= 0.0) return;
+
+    double busy = largs->loop_local.busy / period;
+    if(busy > 1.0) busy = 1.0;
+    double lag = largs->loop_local.lag;
+    if(largs->loop_local.max_lag < lag) largs->loop_local.max_lag = lag;
+    int saturated = (busy >= LOOP_SATURATED_BUSY || lag >= LOOP_SATURATED_LAG);
+
+    atomic_exchange(&largs->loop_busy_permille, 1000 * busy);
+    atomic_exchange(&largs->loop_lag_us, loop_stats_micros(lag));
+    atomic_exchange(&largs->loop_stall_us,
+                    loop_stats_micros(largs->loop_local.stall));
+    atomic_exchange(&largs->loop_events_per_iteration_x100,
+                    largs->loop_local.iterations
+                        ? (100 * largs->loop_local.events)
+                              / largs->loop_local.iterations
+                        : 0);
+    atomic_exchange(&largs->loop_pacing_debt_us,
+                    loop_stats_micros(largs->loop_local.pacing_debt));
+    atomic_exchange(&largs->loop_max_lag_us,
+                    loop_stats_micros(largs->loop_local.max_lag));
+    atomic_exchange(&largs->loop_saturated, saturated);
+    atomic_increment(&largs->loop_periods);
+    if(saturated) atomic_increment(&largs->loop_saturated_periods);
+
+    largs->loop_local.period_start = now;
+    largs->loop_local.busy = 0.0;
+    largs->loop_local.stall = 0.0;
+    largs->loop_local.lag = 0.0;
+    largs->loop_local.pacing_debt = 0.0;
+    largs->loop_local.events = 0;
+    largs->loop_local.iterations = 0;
 }
 
+/*
+ * Make the CPU the worker took since the last time
+ * visible to engine_cpu_stats().
+ */
+static void
+cpu_cost_publish(struct loop_arguments *largs) {
+    uint64_t time_us = 1000000 * cpu_thread_seconds();
+    uint64_t cycles, instructions;
+    cpu_counters_read(&largs->cpu_counters, &cycles, &instructions);
+
+    atomic_add(&largs->cpu_time_us, time_us - largs->cpu_local.time_us);
+    atomic_add(&largs->cpu_cycles, cycles - largs->cpu_local.cycles);
+    atomic_add(&largs->cpu_instructions,
+               instructions - largs->cpu_local.instructions);
+
+    largs->cpu_local.time_us = time_us;
+    largs->cpu_local.cycles = cycles;
+    largs->cpu_local.instructions = instructions;
+}
 
 static void
-connection_timer_refresh(TK_P_ struct connection *conn, double delay) {
+stats_timer_cb(TK_P_ tk_timer UNUSED *w, int UNUSED revents) {
     struct loop_arguments *largs = tk_userdata(TK_A);
-
-    tk_timer_stop(TK_A, &conn->timer);
-
-    switch(conn->conn_state) {
-    case CSTATE_CONNECTED:
-        /* Use the supplied delay */
-        break;
-    case CSTATE_CONNECTING:
-        delay = largs->params.connect_timeout;
-        break;
+    double now = tk_now(TK_A);
+    /* Anything keeping the loop busy delays the timers as well. */
+    if(now - largs->loop_local.stats_due > largs->loop_local.lag)
+        largs->loop_local.lag = now - largs->loop_local.stats_due;
+    largs->loop_local.stats_due = now + STATS_FLUSH_INTERVAL_MS / 1000.0;
+
+    worker_follow_send_rate(largs);
+    /* The connections switch over as they go, see SetMessage. */
+    largs->message_set = atomic_get(largs->n_message_sets);
+    connections_flush_stats(TK_A);
+    worker_update_shared_histograms(largs);
+    if(largs->params.tcp_info || largs->params.mptcp)
+        worker_sample_tcp_info(largs);
+    /* The per-remote and --tcp-info histograms are published
+     * every sixth time (250ms). */
+    if(largs->slow_publish_countdown-- == 0) {
+        largs->slow_publish_countdown = 5;
+        worker_update_remote_histograms(largs);
+        loop_stats_publish(TK_A);
+        if(largs->params.cpu_cost) cpu_cost_publish(largs);
     }
+}
 
-    if(delay > 0.0) {
+/*
+ * Start the --sample-interval timer to fire at the next interval boundary
+ * since the engine epoch, so the lateness of the loop does not accumulate.
+ * The (elapsed) time a bit short of a boundary is taken as that boundary.
+ */
+static void
+sample_timer_rearm(TK_P_ double elapsed) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    double interval = largs->params.sample_interval;
+    double timeout =
+        (floor(elapsed / interval + 0.25) + 1) * interval - elapsed;
 #ifdef USE_LIBUV
-        uv_timer_init(TK_A_ & conn->timer);
-        uint64_t uint_delay = 1000 * delay;
-        if(uint_delay == 0) uint_delay = 1;
-        uv_timer_start(&conn->timer, conn_timer_cb_uv, uint_delay, 0);
+    uint64_t delay = ceil(1000 * timeout);
+    uv_timer_start(&largs->sample_timer, sample_timer_cb_uv, delay, 0);
 #else
-        ev_timer_init(&conn->timer, conn_timer_cb, delay, 0.0);
-        ev_timer_start(TK_A_ & conn->timer);
+    ev_timer_stop(TK_A_ & largs->sample_timer);
+    ev_timer_set(&largs->sample_timer, timeout, 0);
+    ev_timer_start(TK_A_ & largs->sample_timer);
 #endif
-    }
 }
 
 /*
- * Initialize common connection parameters.
+ * Put the worker's traffic of the --sample-interval which has just ended
+ * into the ring for engine_next_sample().
  */
 static void
-common_connection_init(TK_P_ struct connection *conn, enum conn_type conn_type,
-                       enum conn_state conn_state, int sockfd) {
+sample_timer_cb(TK_P_ tk_timer UNUSED *w, int UNUSED revents) {
     struct loop_arguments *largs = tk_userdata(TK_A);
+    double interval = largs->params.sample_interval;
+    double elapsed = tk_now(TK_A) - largs->params.epoch;
+    double ended = floor(elapsed / interval + 0.25);
+
+    if(ended >= 1) {
+        non_atomic_traffic_stats traffic;
+        memset(&traffic, 0, sizeof(traffic));
+        connections_flush_stats(TK_A);
+        add_traffic_numbers_AtoN(&largs->worker_traffic_stats, &traffic);
+        non_atomic_traffic_stats delta =
+            subtract_traffic_stats(traffic, largs->sample_base);
+
+        struct throughput_sample sample = {.interval = ended - 1};
+        sample.value[SM_BYTES_RCVD] = delta.bytes_rcvd;
+        sample.value[SM_BYTES_SENT] = delta.bytes_sent;
+        sample.value[SM_MSGS_RCVD] = delta.msgs_rcvd;
+        sample.value[SM_MSGS_SENT] = delta.msgs_sent;
+        /* A full ring leaves the traffic to the next sample. */
+        if(sample_put(largs->sample_ring, &sample) == 0)
+            largs->sample_base = traffic;
+    }
 
-    conn->conn_type = conn_type;
-    conn->conn_state = conn_state;
-
-    maybe_enable_dump(largs, conn_type, sockfd);
-
-    double now = tk_now(TK_A);
+    sample_timer_rearm(TK_A_ elapsed);
+}
 
-    conn->latency.connection_initiated = now;
-    conn->bytes_leftovers = 0;
+/*
+ * Start the --burst-every timer to fire at the next burst boundary since
+ * the engine epoch. The epoch is shared by the workers, and so are the
+ * boundaries: the workers fire their bursts at the same instants.
+ */
+static void
+burst_timer_rearm(TK_P_ double elapsed) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    double interval = largs->params.burst_every;
+    double timeout =
+        (floor(elapsed / interval + 0.25) + 1) * interval - elapsed;
+#ifdef USE_LIBUV
+    uint64_t delay = ceil(1000 * timeout);
+    uv_timer_start(&largs->burst_timer, burst_timer_cb_uv, delay, 0);
+#else
+    ev_timer_stop(TK_A_ & largs->burst_timer);
+    ev_timer_set(&largs->burst_timer, timeout, 0);
+    ev_timer_start(TK_A_ & largs->burst_timer);
+#endif
+}
 
-    if(limit_channel_lifetime(largs)) {
-        if(TAILQ_FIRST(&largs->open_conns) == NULL) {
-            setup_channel_lifetime_timer(TK_A_ largs->params.channel_lifetime);
-        }
-        conn->channel_eol_point =
-            (now - largs->params.epoch) + largs->params.channel_lifetime;
+/*
+ * Have the outgoing connection fired by the --burst-every timer.
+ */
+static void
+burst_join(struct loop_arguments *largs, struct connection *conn) {
+    if(largs->burst.count == largs->burst.size) {
+        largs->burst.size = largs->burst.size ? 2 * largs->burst.size : 64;
+        largs->burst.conns =
+            realloc(largs->burst.conns,
+                    largs->burst.size * sizeof(largs->burst.conns[0]));
+        assert(largs->burst.conns);
     }
-    TAILQ_INSERT_TAIL(&largs->open_conns, conn, hook);
+    largs->burst.conns[largs->burst.count++] = conn;
+    conn->cold->burst_slot = largs->burst.count;
+}
 
-    /*
-     * Set up downstream bandwidth regardless of the type of connection.
-     */
+/*
+ * Take the connection out of the bursts, as it is closed or migrated.
+ */
+static void
+burst_leave(struct loop_arguments *largs, struct connection *conn) {
+    size_t index = conn->cold->burst_slot - 1;
+    struct connection *last = largs->burst.conns[--largs->burst.count];
+    largs->burst.conns[index] = last;
+    last->cold->burst_slot = index + 1;
+    conn->cold->burst_slot = 0;
+}
 
-    conn->recv_limit = compute_bandwidth_limit(largs->params.channel_recv_rate);
-    pacefier_init(&conn->recv_pace, conn->recv_limit.bytes_per_second, now);
+/*
+ * Release the --burst-size messages of every outgoing connection of the
+ * worker and write them out right away, rather than arm the write
+ * interest of each one and wait for the poller to report it.
+ * The whole messages a connection could not send since the previous
+ * burst are forgotten, so a slow server sees the bursts, not a backlog.
+ */
+static void
+burst_timer_cb(TK_P_ tk_timer UNUSED *w, int UNUSED revents) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    double elapsed = tk_now(TK_A) - largs->params.epoch;
 
     /*
-     * If we're going to send data, establish bandwidth control for upstream.
+     * From the end of the array: a connection closed while writing
+     * is replaced by the last one, which has been fired already.
      */
-
-    int active_socket = conn_type == CONN_OUTGOING
-                        || (largs->params.listen_mode & _LMODE_SND_MASK);
-
-    if(active_socket) {
-
-        message_collection_replicate(&largs->params.message_collection, &conn->message_collection);
-        enum transport_websocket_side tws_side =
-            (conn_type == CONN_OUTGOING) ? TWS_SIDE_CLIENT : TWS_SIDE_SERVER;
-        explode_data_template(&conn->message_collection,
-                              largs->params.data_templates, tws_side,
-                              &conn->data, largs, conn);
-        enum websocket_side ws_side =
-            (tws_side == TWS_SIDE_CLIENT) ? WS_SIDE_CLIENT : WS_SIDE_SERVER;
-        conn->avg_message_size = message_collection_estimate_size(
-            &conn->message_collection,
-            MSK_PURPOSE_MESSAGE, MSK_PURPOSE_MESSAGE,
-            MCE_AVERAGE_SIZE, ws_side, largs->params.websocket_enable);
-        conn->send_limit = compute_bandwidth_limit_by_message_size(
-            largs->params.channel_send_rate, conn->avg_message_size);
-        pacefier_init(&conn->send_pace, conn->send_limit.bytes_per_second, now);
-        if(largs->params.message_stop_expr) {
-            conn->sbmh_stop_ctx = malloc(SBMH_SIZE(largs->params.message_stop_expr->estimate_size));
-            assert(conn->sbmh_stop_ctx);
-            sbmh_init(conn->sbmh_stop_ctx, NULL, 0, 0);
+    for(size_t i = largs->burst.count; i > 0; i--) {
+        struct connection *conn = largs->burst.conns[i - 1];
+        size_t msgsize = conn->avg_message_size;
+        if(conn->conn_state != CSTATE_CONNECTED || msgsize == 0) continue;
+        conn->send_burst_room = conn->send_burst_room % msgsize
+                                + largs->params.burst_size * msgsize;
+        if((conn->conn_wish & CW_WRITE_BLOCKED)
+           && (conn->conn_wish & CW_WRITE_INTEREST)
+           && !(conn->conn_wish
+                & (CW_WRITE_ZEROCOPY | CW_WRITE_PIPELINED
+                   | CW_WRITE_MIRRORED))) {
+            conn->conn_wish &= ~CW_WRITE_BLOCKED;
+            update_io_interest(TK_A_ conn);
+            connection_cb(TK_A_ & conn->watcher, TK_WRITE);
         }
     }
 
-    if(largs->params.latency_marker_expr && (conn->data.single_message_size || largs->params.message_marker)) {
-        if(conn->data.single_message_size) {
-            conn->latency.message_bytes_credit /* See (EXPL:1) below. */
-                = conn->data.single_message_size - 1;
-        }
-        /*
-         * Figure out how many latency markers to skip
-         * before starting to measure latency with them.
-         */
-        conn->latency.lm_occurrences_skip =
-            largs->params.latency_marker_skip;
+    burst_timer_rearm(TK_A_ elapsed);
+}
 
-        /*
-         * Initialize the Boyer-Moore-Horspool context for substring search.
-         */
-        struct StreamBMH_Occ *init_occ = NULL;
-        if(EXPR_IS_TRIVIAL(largs->params.latency_marker_expr)) {
-            /* Shared search table and expression */
-            conn->latency.sbmh_shared = 1;
-            conn->latency.sbmh_occ = &largs->params.sbmh_shared_marker_occ;
-            conn->latency.sbmh_data =
-                (uint8_t *)largs->params.latency_marker_expr->u.data.data;
-            conn->latency.sbmh_size =
-                largs->params.latency_marker_expr->u.data.size;
-        } else {
-            /* Individual search table. */
-            conn->latency.sbmh_shared = 0;
-            conn->latency.sbmh_occ =
-                malloc(sizeof(*conn->latency.sbmh_occ));
-            assert(conn->latency.sbmh_occ);
-            init_occ = conn->latency.sbmh_occ;
-            explode_string_expression(
-                (char **)&conn->latency.sbmh_data, &conn->latency.sbmh_size,
-                largs->params.latency_marker_expr, largs, conn);
-        }
-        conn->latency.sbmh_marker_ctx =
-            malloc(SBMH_SIZE(conn->latency.sbmh_size));
-        assert(conn->latency.sbmh_marker_ctx);
-        sbmh_init(conn->latency.sbmh_marker_ctx, init_occ,
-                  conn->latency.sbmh_data, conn->latency.sbmh_size);
+static void *
+single_engine_loop_thread(void *argp) {
+    struct loop_arguments *largs = (struct loop_arguments *)argp;
+    tk_loop *loop = tk_loop_new();
+    tk_set_userdata(loop, largs);
+    if(largs->log_ring) log_ring_attach(largs->log_ring);
 
-        /*
-         * Initialize the latency histogram by copying out the template
-         * parameter from the loop arguments.
-         */
-        conn->latency.sent_timestamps = ring_buffer_new(sizeof(double));
-        conn->latency.marker_histogram =
-            hdr_init_similar(largs->marker_histogram_local);
+    tk_io global_control_watcher;
+    tk_io private_control_watcher;
+    const int on_main_thread = (largs->thread_no == 0);
+
+    if(largs->params.message_collection.most_dynamic_expression
+       == DS_PER_MESSAGE) {
+        largs->payload_generator = payload_generator_new(
+            pcg32_random_r(&largs->rng), largs->thread_no);
     }
 
+#ifdef SO_REUSEPORT
+    const int have_reuseport = 1;
+#else
+    const int have_reuseport = 0;
+#endif
+
     /*
-     * Catch connection timeout.
+     * If want to serve connections but don't have SO_REUSEPORT,
+     * tell the user upfront.
      */
-    int want_catch_connect = (conn_state == CSTATE_CONNECTING
-                              && largs->params.connect_timeout > 0.0);
-    if(want_catch_connect) {
-        assert(conn_type == CONN_OUTGOING);
-        connection_timer_refresh(TK_A_ conn, 0.0);
+    if(!have_reuseport && on_main_thread
+       && largs->params.listen_addresses.n_addrs) {
+        warning(
+            "A system without SO_REUSEPORT detected."
+            " Using only one core for serving connections.\n");
     }
 
-    conn->conn_wish =
-        CW_READ_INTEREST
-        | ((conn->data.total_size || want_catch_connect) ? CW_WRITE_INTEREST
-                                                         : 0);
+    signal(SIGPIPE, SIG_IGN);
 
-    if(largs->params.websocket_enable) {
-        if(conn_type == CONN_OUTGOING) {
-            int want_events = TK_READ | TK_WRITE;
-#ifdef USE_LIBUV
-            uv_poll_init(TK_A_ & conn->watcher, sockfd);
-            uv_poll_start(&conn->watcher, want_events, connection_cb_uv);
+    tcpkali_ssl_thread_setup();
+    if(largs->pinned_cpu >= 0 && cpu_pin_thread(largs->pinned_cpu) != 0) {
+        DEBUG(DBG_ERROR, "Can not pin worker %d to CPU %d: %s\n",
+              largs->thread_no, largs->pinned_cpu, strerror(errno));
+    }
+    if(largs->prewarm) worker_prewarm(largs);
+    /* A relaunched worker is a new thread with its own counters. */
+    memset(&largs->cpu_local, 0, sizeof(largs->cpu_local));
+    if(largs->params.cpu_cost
+       && cpu_counters_open(&largs->cpu_counters) == -1 && on_main_thread) {
+        warning("--cpu-cost: The CPU cycles can not be counted (%s), "
+                "reporting the CPU time only.\n",
+                strerror(errno));
+    }
+
+    /*
+     * Open all listening sockets, if they are specified.
+     */
+    if(largs->listen_sync)
+        listen_turn_wait(largs->listen_sync, largs->thread_no);
+    if(largs->params.listen_addresses.n_addrs
+       /* Only listen on stuff on other cores when SO_REUSEPORT is available */
+       && (have_reuseport || on_main_thread)) {
+        int opened_listening_sockets = 0;
+        for(size_t n = 0; n < largs->params.listen_addresses.n_addrs; n++) {
+            struct sockaddr_storage *ss =
+                &largs->params.listen_addresses.addrs[n];
+            int rc;
+            if(ss->ss_family == AF_UNIX) {
+                /* A path is bound once, then removed by the next run. */
+                if(!on_main_thread) continue;
+                struct stat st;
+                const char *path = ((struct sockaddr_un *)ss)->sun_path;
+                if(stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+            }
+            int lsock = socket(ss->ss_family, SOCK_STREAM,
+                               stream_protocol(&largs->params, ss->ss_family));
+            assert(lsock != -1);
+            set_nbio(lsock, 1);
+#ifdef SO_REUSEPORT
+            if(ss->ss_family != AF_UNIX) {
+                int on = ~0;
+                rc = setsockopt(lsock, SOL_SOCKET, SO_REUSEPORT, &on,
+                                sizeof(on));
+                assert(rc != -1);
+            }
 #else
-            ev_io_init(&conn->watcher, connection_cb, sockfd, want_events);
-            ev_io_start(TK_A_ & conn->watcher);
+/*
+ * SO_REUSEPORT cannot be used, which means that only a single
+ * thread could create their own separate listening socket on
+ * a specified address/port. This is bad, but changing.
+ * See http://permalink.gmane.org/gmane.linux.network/158320
+ */
+#endif /* SO_REUSEPORT */
+            rc = bind(lsock, (struct sockaddr *)ss, sockaddr_len(ss));
+            if(rc == -1) {
+                char buf[256];
+                DEBUG(DBG_ALWAYS, "Bind %s is not done on thread %d: %s\n",
+                      format_sockaddr(ss, buf, sizeof(buf)), largs->thread_no,
+                      strerror(errno));
+                exit(EX_UNAVAILABLE);
+            }
+            assert(rc == 0);
+#ifdef TCP_DEFER_ACCEPT
+            if(largs->params.defer_accept && ss->ss_family != AF_UNIX) {
+                /* Wake up only once the client has sent some data. */
+                int secs = largs->params.defer_accept;
+                rc = setsockopt(lsock, IPPROTO_TCP, TCP_DEFER_ACCEPT, &secs,
+                                sizeof(secs));
+                if(rc == -1)
+                    DEBUG(DBG_WARNING, "Can't set TCP_DEFER_ACCEPT: %s\n",
+                          strerror(errno));
+            }
 #endif
-        } else {
+#ifdef TCP_FASTOPEN
+            if(largs->params.tcp_fastopen && ss->ss_family != AF_UNIX) {
+                /* Accept the data in the SYN, up to a backlog of them. */
+                int qlen = largs->params.listen_backlog;
+                rc = setsockopt(lsock, IPPROTO_TCP, TCP_FASTOPEN, &qlen,
+                                sizeof(qlen));
+                if(rc == -1)
+                    DEBUG(DBG_WARNING, "Can't set TCP_FASTOPEN: %s\n",
+                          strerror(errno));
+            }
+#endif
+            rc = listen(lsock, largs->params.listen_backlog);
+            assert(rc == 0);
+            /* The group exists once the first socket listens. */
+            if(largs->listen_sync && on_main_thread
+               && ss->ss_family != AF_UNIX)
+                attach_reuseport_cpu_filter(largs, lsock);
+            opened_listening_sockets++;
+
+            struct connection *conn = connection_new(largs);
+            conn->conn_type = CONN_ACCEPTOR;
+            /* Not in open_conns, see close_acceptors(). */
+            TAILQ_INSERT_TAIL(&largs->acceptors, conn, hook);
+            pacefier_init(&conn->send_pace, -1.0, tk_now(TK_A));
+            pacefier_init(&conn->recv_pace, -1.0, tk_now(TK_A));
 #ifdef USE_LIBUV
-            uv_poll_init(TK_A_ & conn->watcher, sockfd);
-            uv_poll_start(&conn->watcher, TK_READ, passive_websocket_cb_uv);
+            uv_poll_init(TK_A_ & conn->watcher, lsock);
+            uv_poll_start(&conn->watcher, TK_READ | TK_WRITE, accept_cb_uv);
 #else
-            ev_io_init(&conn->watcher, passive_websocket_cb, sockfd, TK_READ);
+            ev_io_init(&conn->watcher, accept_cb, lsock, TK_READ | TK_WRITE);
             ev_io_start(TK_A_ & conn->watcher);
 #endif
         }
-    } else { /* Plain socket */
-        int want_write = (conn->data.total_size || want_catch_connect);
-        int want_events = TK_READ | (want_write ? TK_WRITE : 0);
+        if(!opened_listening_sockets && on_main_thread) {
+            DEBUG(DBG_ALWAYS, "Could not listen on any local sockets!\n");
+            exit(EX_UNAVAILABLE);
+        }
+    }
+    if(largs->listen_sync) listen_turn_done(largs->listen_sync);
+
+    const int stats_flush_interval_ms = STATS_FLUSH_INTERVAL_MS;
+    largs->loop_local.period_start = tk_now(TK_A);
+    largs->loop_local.stats_due =
+        tk_now(TK_A) + stats_flush_interval_ms / 1000.0;
+    tk_wheel_init(&largs->timer_wheel, tk_now(TK_A),
+                  largs->params.timer_granularity);
+    largs->timer_wheel.userdata = TK_A;
+    tk_wheel_entry_init(&largs->reconnect_timer, reconnect_timer_cb);
 #ifdef USE_LIBUV
-        uv_poll_init(TK_A_ & conn->watcher, sockfd);
-        uv_poll_start(&conn->watcher, want_events, connection_cb_uv);
+    uv_timer_init(TK_A_ & largs->timer_wheel_timer);
+    uv_timer_init(TK_A_ & largs->stats_timer);
+    uv_timer_start(&largs->stats_timer, stats_timer_cb_uv, stats_flush_interval_ms, stats_flush_interval_ms);
+    uv_timer_init(TK_A_ & largs->sample_timer);
+    if(largs->sample_ring)
+        sample_timer_rearm(TK_A_ tk_now(TK_A) - largs->params.epoch);
+    uv_timer_init(TK_A_ & largs->burst_timer);
+    if(largs->params.burst_every > 0.0)
+        burst_timer_rearm(TK_A_ tk_now(TK_A) - largs->params.epoch);
+    uv_poll_init(TK_A_ & global_control_watcher,
+                 largs->global_control_pipe_rd_nbio);
+    uv_poll_init(TK_A_ & private_control_watcher,
+                 largs->private_control_pipe_rd);
+    uv_poll_start(&global_control_watcher, TK_READ, control_cb_uv);
+    uv_poll_start(&private_control_watcher, TK_READ, control_cb_uv);
+    uv_run(TK_A_ UV_RUN_DEFAULT);
+    uv_timer_stop(&largs->stats_timer);
+    uv_timer_stop(&largs->sample_timer);
+    uv_timer_stop(&largs->burst_timer);
+    uv_timer_stop(&largs->timer_wheel_timer);
+    uv_poll_stop(&global_control_watcher);
+    uv_poll_stop(&private_control_watcher);
 #else
-        ev_io_init(&conn->watcher, connection_cb, sockfd, want_events);
-        ev_io_start(TK_A_ & conn->watcher);
+#ifndef USE_IO_URING
+    ev_set_invoke_pending_cb(loop, invoke_pending_timed);
+#endif
+    ev_timer_init(&largs->timer_wheel_timer, timer_wheel_cb, 0, 0);
+    ev_timer_init(&largs->stats_timer, stats_timer_cb, stats_flush_interval_ms / 1000.0, stats_flush_interval_ms / 1000.0);
+    ev_timer_start(TK_A_ & largs->stats_timer);
+    ev_timer_init(&largs->sample_timer, sample_timer_cb, 0, 0);
+    if(largs->sample_ring)
+        sample_timer_rearm(TK_A_ tk_now(TK_A) - largs->params.epoch);
+    ev_timer_init(&largs->burst_timer, burst_timer_cb, 0, 0);
+    if(largs->params.burst_every > 0.0)
+        burst_timer_rearm(TK_A_ tk_now(TK_A) - largs->params.epoch);
+    ev_io_init(&global_control_watcher, control_cb,
+               largs->global_control_pipe_rd_nbio, TK_READ);
+    ev_io_init(&private_control_watcher, control_cb,
+               largs->private_control_pipe_rd, TK_READ);
+    ev_io_start(loop, &global_control_watcher);
+    ev_io_start(loop, &private_control_watcher);
+#ifndef USE_IO_URING
+    if(largs->params.busy_poll > 0.0)
+        busy_poll_run(loop);
+    else
+#endif
+        ev_run(loop, 0);
+    ev_timer_stop(TK_A_ & largs->stats_timer);
+    ev_timer_stop(TK_A_ & largs->sample_timer);
+    ev_timer_stop(TK_A_ & largs->burst_timer);
+    ev_timer_stop(TK_A_ & largs->timer_wheel_timer);
+    ev_io_stop(TK_A_ & global_control_watcher);
+    ev_io_stop(TK_A_ & private_control_watcher);
 #endif
+
+    connections_flush_stats(TK_A);
+
+    if(largs->params.memory_report) worker_account_memory(largs);
+    close_all_connections(TK_A_ CCR_CLEAN);
+    close_acceptors(TK_A);
+    drain_worker_pools(largs);
+    data_template_cache_free(largs);
+    assert(largs->ws_accepts.count == 0);
+    free(largs->ws_accepts.conns);
+    assert(largs->burst.count == 0);
+    free(largs->burst.conns);
+    assert(largs->send_queue.count == 0);
+    free(largs->send_queue.entries);
+    ssl_shared_free(&largs->ssl);
+    if(largs->payload_generator) {
+        payload_generator_free(largs->payload_generator);
+        largs->payload_generator = NULL;
     }
-    if(largs->params.ssl_enable != 0) {
-        ssl_setup(conn, sockfd, largs->params.ssl_cert, largs->params.ssl_key);
+    if(largs->params.cpu_cost) {
+        cpu_cost_publish(largs);
+        cpu_counters_close(&largs->cpu_counters);
     }
-}
 
-static void
-accept_cb(TK_P_ tk_io *w, int UNUSED revents) {
+    /* Print out the pending output, the report below is synchronous. */
+    if(largs->log_ring) log_ring_detach(largs->log_ring);
+
+    /* Avoid mixing debug output from several threads. */
+    pthread_mutex_lock(largs->serialize_output_lock);
+
+    DEBUG(DBG_DETAIL,
+          "Exiting worker %d\n"
+          "  %" PRIan "↓, %" PRIan "↑ open connections (%" PRIan
+          " connecting)\n"
+          "  %" PRIan
+          " connections_counter \n"
+          "  ↳ %lu connections_initiated\n"
+          "  ↳ %lu connections_accepted\n"
+          "  %lu connection_failures\n"
+          "  ↳ %lu connection_timeouts\n"
+          "  %" PRIaw
+          " worker_data_sent\n"
+          "  %" PRIaw
+          " worker_data_rcvd\n"
+          "  %" PRIaw
+          " worker_num_writes\n"
+          "  %" PRIaw " worker_num_reads\n",
+          largs->thread_no, atomic_get(&largs->incoming_established),
+          atomic_get(&largs->outgoing_established),
+          atomic_get(&largs->outgoing_connecting),
+          atomic_get(&largs->connections_counter),
+          largs->worker_connections_initiated,
+          largs->worker_connections_accepted, largs->worker_connection_failures,
+          largs->worker_connection_timeouts,
+          atomic_wide_get(&largs->worker_traffic_stats.bytes_sent),
+          atomic_wide_get(&largs->worker_traffic_stats.bytes_rcvd),
+          atomic_wide_get(&largs->worker_traffic_stats.num_writes),
+          atomic_wide_get(&largs->worker_traffic_stats.num_reads));
+
+    if(largs->params.ssl_session_reuse) {
+        DEBUG(DBG_DETAIL, "  %zu ssl_sessions_resumed\n",
+              largs->ssl.sessions_resumed);
+    }
+    if(largs->params.ssl_ktls) {
+        DEBUG(DBG_DETAIL, "  %zu ssl_ktls_offloaded\n",
+              largs->ssl.ktls_offloaded);
+    }
+
+    const int digits = latency_ms_precision();
+    if(largs->connect_histogram_local) {
+        struct hdr_histogram *hist = largs->connect_histogram_local;
+        DEBUG(DBG_DETAIL,
+              "  Connect latency:\n"
+              "    %.*f latency_95_ms\n"
+              "    %.*f latency_99_ms\n"
+              "    %.*f latency_99_5_ms\n"
+              "    %.*f latency_mean_ms\n"
+              "    %.*f latency_max_ms\n",
+              digits, latency_to_ms(hdr_value_at_percentile(hist, 95.0)),
+              digits, latency_to_ms(hdr_value_at_percentile(hist, 99.0)),
+              digits, latency_to_ms(hdr_value_at_percentile(hist, 99.5)),
+              digits, latency_to_ms(hdr_mean(hist)), digits,
+              latency_to_ms(hdr_max(hist)));
+        if(largs->params.verbosity_level >= DBG_DEBUG)
+            hdr_percentiles_print(hist, stderr, 5, 10, CLASSIC);
+    }
+    if(largs->marker_histogram_local) {
+        struct hdr_histogram *hist = largs->marker_histogram_local;
+        DEBUG(DBG_DETAIL,
+              "  Marker latency:\n"
+              "    %.*f latency_95_ms\n"
+              "    %.*f latency_99_ms\n"
+              "    %.*f latency_99_5_ms\n"
+              "    %.*f latency_mean_ms\n"
+              "    %.*f latency_max_ms\n",
+              digits, latency_to_ms(hdr_value_at_percentile(hist, 95.0)),
+              digits, latency_to_ms(hdr_value_at_percentile(hist, 99.0)),
+              digits, latency_to_ms(hdr_value_at_percentile(hist, 99.5)),
+              digits, latency_to_ms(hdr_mean(hist)), digits,
+              latency_to_ms(hdr_max(hist)));
+        if(largs->params.verbosity_level >= DBG_DEBUG)
+            hdr_percentiles_print(hist, stderr, 5, 10, CLASSIC);
+    }
+
+    /*
+     * Print the scratch buffer to highlight the last thing received.
+     */
+    if(largs->params.verbosity_level >= DBG_DETAIL) {
+        debug_dump_data(largs, "Last received bytes ", -1,
+                        largs->scratch_recv_buf, largs->scratch_recv_last_size,
+                        -1500);
+    }
+
+    pthread_mutex_unlock(largs->serialize_output_lock);
+
+    return 0;
+}
+
+/*
+ * Init HDR Histogram with properties similar to a given one.
+ */
+/*
+ * The per-remote histograms trade precision for size: with two
+ * significant figures they are an order of magnitude smaller,
+ * which keeps their publishing cheap.
+ */
+static struct hdr_histogram *
+remote_histogram_new(struct hdr_histogram *htemplate) {
+    if(htemplate) {
+        struct hdr_histogram *dst = 0;
+        int ret = hdr_init(htemplate->lowest_trackable_value,
+                           htemplate->highest_trackable_value, 2, &dst);
+        assert(ret == 0);
+        return dst;
+    }
+    return NULL;
+}
+
+/*
+ * The (n) sets of the per-remote or per-group histograms,
+ * shaped after the worker's own.
+ */
+static struct remote_latency *
+remote_latency_new(struct loop_arguments *largs, size_t n) {
+    struct remote_latency *latency = calloc(n, sizeof(latency[0]));
+    assert(latency);
+    for(size_t i = 0; i < n; i++) {
+        struct remote_latency *rl = &latency[i];
+        rl->connect_histogram_local =
+            remote_histogram_new(largs->connect_histogram_local);
+        rl->firstbyte_histogram_local =
+            remote_histogram_new(largs->firstbyte_histogram_local);
+        rl->handshake_histogram_local =
+            remote_histogram_new(largs->handshake_histogram_local);
+        rl->upgrade_histogram_local =
+            remote_histogram_new(largs->upgrade_histogram_local);
+        rl->marker_histogram_local =
+            remote_histogram_new(largs->marker_histogram_local);
+        rl->connect_histogram_shared.histogram =
+            hdr_init_similar(rl->connect_histogram_local);
+        rl->firstbyte_histogram_shared.histogram =
+            hdr_init_similar(rl->firstbyte_histogram_local);
+        rl->handshake_histogram_shared.histogram =
+            hdr_init_similar(rl->handshake_histogram_local);
+        rl->upgrade_histogram_shared.histogram =
+            hdr_init_similar(rl->upgrade_histogram_local);
+        rl->marker_histogram_shared.histogram =
+            hdr_init_similar(rl->marker_histogram_local);
+    }
+    return latency;
+}
+
+/*
+ * A latency histogram from one --latency-resolution unit
+ * up to (latency_max) seconds.
+ */
+static struct hdr_histogram *
+latency_histogram_new(double latency_max) {
+    struct hdr_histogram *h = NULL;
+    int64_t highest = (int64_t)(latency_max * latency_units_per_second + 0.5);
+    int ret = hdr_init(1, highest, LATENCY_SIGNIFICANT_FIGURES, &h);
+    assert(ret == 0);
+    return h;
+}
+
+static struct hdr_histogram *
+hdr_init_similar(struct hdr_histogram *htemplate) {
+    if(htemplate) {
+        struct hdr_histogram *dst = 0;
+        if(hdr_init(htemplate->lowest_trackable_value,
+                    htemplate->highest_trackable_value,
+                    htemplate->significant_figures, &dst)
+           == 0) {
+            return dst;
+        } else {
+            assert(!"Can't create copy of histogram");
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Copy the local histogram to its published counterpart.
+ * The readers are never blocked: the sequence number is odd for the
+ * duration of the copy, and the readers retry if it changed.
+ * Both histograms have the same layout, so the copy is a memcpy(3)
+ * rather than a histogram walk.
+ */
+static void
+histogram_publish(struct hdr_histogram *src, struct published_histogram *dst) {
+    if(!src) return;
+    /* Histograms only grow, unless reset, so an unchanged count
+     * means the published copy is still current. */
+    if(dst->published_count == src->total_count && src->total_count) return;
+    dst->published_count = src->total_count;
+    assert(dst->histogram);
+    assert(dst->histogram->counts_len == src->counts_len);
+    atomic_increment(&dst->sequence);
+    memcpy(dst->histogram, src, hdr_get_memory_size(src));
+    atomic_increment(&dst->sequence);
+}
+
+/*
+ * Move the latencies gathered by a few connections (with the
+ * --latency-per-connection option) into the worker's histogram.
+ * The drained connections are rotated to the end of the list,
+ * so all of them are drained over the successive calls.
+ */
+static void
+worker_drain_connection_histograms(struct loop_arguments *largs) {
+    struct connection *first = NULL;
+    struct connection *conn;
+    int nmax = 100; /* hdr_add() takes ~20us */
+
+    while(nmax && (conn = TAILQ_FIRST(&largs->open_conns)) != first) {
+        if(!first) first = conn;
+        TAILQ_REMOVE(&largs->open_conns, conn, hook);
+        TAILQ_INSERT_TAIL(&largs->open_conns, conn, hook);
+        struct hdr_histogram *hist = conn->cold->latency.marker_histogram;
+        if(hist && hist->total_count) {
+            if(conn->cold->latency.marker_step == largs->marker_step)
+                hdr_add(largs->marker_histogram_local, hist);
+            hdr_reset(hist);
+            conn->cold->latency.marker_step = largs->marker_step;
+            nmax--;
+        }
+    }
+}
+
+/*
+ * Each worker maintains two sets of histogram data structures:
+ *  1) the xxx_histogram_local ones, which are only accessed by the worker
+ *     and are directly writable by connections when they operate and die.
+ *  2) the xxx_histogram_shared, which are copied from the local ones
+ *     from time to time and are used for reporting to external observers.
+ */
+static void
+worker_update_shared_histograms(struct loop_arguments *largs) {
+    if(largs->params.latency_setting == 0) return;
+
+    if(largs->params.latency_per_connection && largs->marker_histogram_local)
+        worker_drain_connection_histograms(largs);
+
+    /* --latency-connect */
+    histogram_publish(largs->connect_histogram_local,
+                      &largs->connect_histogram_shared);
+
+    /* --latency-firstbyte */
+    histogram_publish(largs->firstbyte_histogram_local,
+                      &largs->firstbyte_histogram_shared);
+
+    /* --latency-handshake */
+    histogram_publish(largs->handshake_histogram_local,
+                      &largs->handshake_histogram_shared);
+
+    /* --latency-upgrade */
+    histogram_publish(largs->upgrade_histogram_local,
+                      &largs->upgrade_histogram_shared);
+
+    /* --latency-marker */
+    histogram_publish(largs->marker_histogram_local,
+                      &largs->marker_histogram_shared);
+    histogram_publish(largs->marker_uncorrected_histogram_local,
+                      &largs->marker_uncorrected_histogram_shared);
+}
+
+static void
+remote_latency_publish(struct remote_latency *rl) {
+    histogram_publish(rl->connect_histogram_local,
+                      &rl->connect_histogram_shared);
+    histogram_publish(rl->firstbyte_histogram_local,
+                      &rl->firstbyte_histogram_shared);
+    histogram_publish(rl->handshake_histogram_local,
+                      &rl->handshake_histogram_shared);
+    histogram_publish(rl->upgrade_histogram_local,
+                      &rl->upgrade_histogram_shared);
+    histogram_publish(rl->marker_histogram_local,
+                      &rl->marker_histogram_shared);
+}
+
+static void
+worker_update_remote_histograms(struct loop_arguments *largs) {
+    for(int m = 0; m < ETI_METRICS; m++) {
+        histogram_publish(largs->tcp_info_histogram_local[m],
+                          &largs->tcp_info_histogram_shared[m]);
+    }
+
+    for(size_t i = 0; largs->remote_latency && i < largs->remote_latency_count;
+        i++) {
+        remote_latency_publish(&largs->remote_latency[i]);
+    }
+    for(size_t i = 0; largs->group_latency && i < largs->params.n_groups; i++) {
+        remote_latency_publish(&largs->group_latency[i]);
+    }
+}
+
+/*
+ * Forget the local histogram, and publish it as such.
+ */
+static void
+histogram_reset(struct hdr_histogram *src, struct published_histogram *dst) {
+    if(!src) return;
+    hdr_reset(src);
+    histogram_publish(src, dst);
+}
+
+static void
+remote_latency_reset(struct remote_latency *rl) {
+    histogram_reset(rl->connect_histogram_local,
+                    &rl->connect_histogram_shared);
+    histogram_reset(rl->firstbyte_histogram_local,
+                    &rl->firstbyte_histogram_shared);
+    histogram_reset(rl->handshake_histogram_local,
+                    &rl->handshake_histogram_shared);
+    histogram_reset(rl->upgrade_histogram_local,
+                    &rl->upgrade_histogram_shared);
+    histogram_reset(rl->marker_histogram_local, &rl->marker_histogram_shared);
+}
+
+/*
+ * Forget all the latencies recorded so far, see --warmup.
+ */
+static void
+worker_reset_histograms(struct loop_arguments *largs) {
+    histogram_reset(largs->connect_histogram_local,
+                    &largs->connect_histogram_shared);
+    histogram_reset(largs->firstbyte_histogram_local,
+                    &largs->firstbyte_histogram_shared);
+    histogram_reset(largs->handshake_histogram_local,
+                    &largs->handshake_histogram_shared);
+    histogram_reset(largs->upgrade_histogram_local,
+                    &largs->upgrade_histogram_shared);
+    histogram_reset(largs->marker_histogram_local,
+                    &largs->marker_histogram_shared);
+    histogram_reset(largs->marker_uncorrected_histogram_local,
+                    &largs->marker_uncorrected_histogram_shared);
+    for(int m = 0; m < ETI_METRICS; m++) {
+        histogram_reset(largs->tcp_info_histogram_local[m],
+                        &largs->tcp_info_histogram_shared[m]);
+    }
+    for(size_t i = 0; largs->remote_latency && i < largs->remote_latency_count;
+        i++) {
+        remote_latency_reset(&largs->remote_latency[i]);
+    }
+    for(size_t i = 0; largs->group_latency && i < largs->params.n_groups; i++) {
+        remote_latency_reset(&largs->group_latency[i]);
+    }
+
+    for(size_t i = 0; i < largs->n_marker_steps; i++)
+        free(largs->marker_steps[i].histogram);
+    largs->n_marker_steps = 0;
+    for(int c = 0; c < MESSAGE_SIZE_CLASSES; c++) {
+        if(largs->size_class_histograms[c])
+            hdr_reset(largs->size_class_histograms[c]);
+    }
+    largs->n_slowest = 0;
+
+    struct connection *conn;
+    if(largs->fanout_deliveries) hdr_reset(largs->fanout_deliveries);
+    TAILQ_FOREACH(conn, &largs->open_conns, hook) {
+        if(conn->cold->latency.marker_histogram)
+            hdr_reset(conn->cold->latency.marker_histogram);
+        if(conn->cold->latency.fanout)
+            conn->cold->latency.fanout->delivered = 0;
+    }
+}
+
+/*
+ * Put the marker latencies of the rate step which just ended aside,
+ * and measure the new one afresh. The connections' histograms are reset
+ * as they are used, see marker_histogram().
+ */
+static void
+worker_next_rate_step(struct loop_arguments *largs) {
+    unsigned step = atomic_get(&largs->rate_step);
+    if(!largs->marker_histogram_local || step == largs->marker_step) return;
+
+    struct hdr_histogram *ended = largs->marker_histogram_local;
+    if(ended->total_count && largs->marker_step >= MARKER_STEPS_MAX) {
+        /* The --rate-control pi changes the rate twice a second. */
+        hdr_reset(ended);
+    } else if(ended->total_count) {
+        struct marker_step *steps =
+            realloc(largs->marker_steps,
+                    (largs->n_marker_steps + 1) * sizeof(steps[0]));
+        assert(steps);
+        steps[largs->n_marker_steps].step = largs->marker_step;
+        steps[largs->n_marker_steps].histogram = ended;
+        largs->marker_steps = steps;
+        largs->n_marker_steps++;
+        largs->marker_histogram_local = hdr_init_similar(ended);
+    }
+    largs->marker_step = step;
+
+    histogram_publish(largs->marker_histogram_local,
+                      &largs->marker_histogram_shared);
+    histogram_reset(largs->marker_uncorrected_histogram_local,
+                    &largs->marker_uncorrected_histogram_shared);
+}
+
+/*
+ * --mptcp: record the number of subflows of the connection and the delivery
+ * rate of each, unless it has fallen back to plain TCP.
+ * Returns 0 if the connection is not sampled.
+ */
+static int
+worker_sample_mptcp_info(struct loop_arguments *largs, int sockfd) {
+#ifdef TCPKALI_MPTCP
+    struct mptcp_info mi;
+    socklen_t len = sizeof(mi);
+    memset(&mi, 0, sizeof(mi));
+    if(getsockopt(sockfd, SOL_MPTCP, MPTCP_INFO, &mi, &len) != 0
+       || (mi.mptcpi_flags & MPTCP_INFO_FLAG_FALLBACK))
+        return 0;
+    hdr_record_value(largs->tcp_info_histogram_local[ETI_MPTCP_SUBFLOWS],
+                     mi.mptcpi_subflows + 1);
+
+    struct {
+        struct mptcp_subflow_data head;
+        struct mptcp_subflow_tcp_info subflow[MPTCP_SUBFLOWS_SAMPLED];
+    } sfi;
+    memset(&sfi, 0, sizeof(sfi));
+    sfi.head.size_subflow_data = sizeof(sfi.head);
+    sfi.head.size_user = sizeof(sfi.subflow[0]);
+    len = sizeof(sfi);
+    if(getsockopt(sockfd, SOL_MPTCP, MPTCP_TCPINFO, &sfi, &len) != 0
+       || sfi.head.size_kernel < sizeof(sfi.subflow[0]))
+        return 1; /* An older kernel, without the delivery rate. */
+    for(size_t i = 0;
+        i < sfi.head.num_subflows && i < MPTCP_SUBFLOWS_SAMPLED; i++) {
+        hdr_record_value(
+            largs->tcp_info_histogram_local[ETI_MPTCP_SUBFLOW_RATE],
+            (sfi.subflow[i].delivery_rate * 8) / 1000);
+    }
+    return 1;
+#else
+    (void)largs;
+    (void)sockfd;
+    return 0;
+#endif
+}
+
+/*
+ * Record getsockopt(TCP_INFO) of a few established connections,
+ * and the MPTCP_INFO with --mptcp.
+ * The sampled connections are rotated to the end of the list, so the
+ * successive calls go over all of them, TCP_INFO_SAMPLES_PER_TICK at a time.
+ */
+static void
+worker_sample_tcp_info(struct loop_arguments *largs) {
+#ifdef TCPKALI_TCP_INFO
+    struct connection *first = NULL;
+    struct connection *conn;
+    int nmax = TCP_INFO_SAMPLES_PER_TICK;
+
+    while(nmax && (conn = TAILQ_FIRST(&largs->open_conns)) != first) {
+        if(!first) first = conn;
+        TAILQ_REMOVE(&largs->open_conns, conn, hook);
+        TAILQ_INSERT_TAIL(&largs->open_conns, conn, hook);
+        if(conn->conn_type == CONN_ACCEPTOR
+           || conn->conn_state != CSTATE_CONNECTED)
+            continue;
+
+        int sockfd = tk_fd(&conn->watcher);
+        int sampled = 0;
+        if(largs->params.mptcp)
+            sampled = worker_sample_mptcp_info(largs, sockfd);
+
+        struct tcp_info ti;
+        socklen_t len = sizeof(ti);
+        if(largs->params.tcp_info
+           && getsockopt(sockfd, IPPROTO_TCP, TCP_INFO, &ti, &len) == 0) {
+            sampled = 1;
+            hdr_record_value(largs->tcp_info_histogram_local[ETI_RTT],
+                             ti.tcpi_rtt);
+            hdr_record_value(largs->tcp_info_histogram_local[ETI_RETRANSMITS],
+                             ti.tcpi_total_retrans);
+            hdr_record_value(largs->tcp_info_histogram_local[ETI_CWND],
+                             ti.tcpi_snd_cwnd);
+            hdr_record_value(largs->tcp_info_histogram_local[ETI_UNACKED],
+                             ti.tcpi_unacked);
+        }
+        if(sampled) nmax--;
+    }
+#else
+    (void)largs;
+#endif
+}
+
+/*
+ * --mptcp: count the newly established connection, and whether it has
+ * fallen back to plain TCP, because the peer or a middlebox along the path
+ * did not do MPTCP.
+ */
+static void
+mptcp_count_connection(struct loop_arguments *largs, int sockfd) {
+#ifdef TCPKALI_MPTCP
+    int protocol = 0;
+    socklen_t len = sizeof(protocol);
+    if(getsockopt(sockfd, SOL_SOCKET, SO_PROTOCOL, &protocol, &len) != 0
+       || protocol != IPPROTO_MPTCP)
+        return; /* A --listen-unix or a unix socket destination. */
+
+    struct mptcp_info mi;
+    len = sizeof(mi);
+    memset(&mi, 0, sizeof(mi));
+    atomic_increment(&largs->mptcp_connections);
+    if(getsockopt(sockfd, SOL_MPTCP, MPTCP_INFO, &mi, &len) != 0
+       || (mi.mptcpi_flags & MPTCP_INFO_FLAG_FALLBACK))
+        atomic_increment(&largs->mptcp_fallbacks);
+#else
+    (void)largs;
+    (void)sockfd;
+#endif
+}
+
+/*
+ * --tcp-fastopen: count the closing connection, and whether the server
+ * acknowledged the data sent in its SYN. A server without a cookie for us
+ * yet, or with Fast Open disabled, only acknowledges the SYN itself.
+ */
+static void
+fastopen_count(struct loop_arguments *largs, int sockfd) {
+#ifdef TCPKALI_TCP_INFO
+    struct tcp_info ti;
+    socklen_t len = sizeof(ti);
+    if(getsockopt(sockfd, IPPROTO_TCP, TCP_INFO, &ti, &len) != 0) return;
+    atomic_increment(&largs->fastopen_connections);
+    if(ti.tcpi_options & TCPI_OPT_SYN_DATA)
+        atomic_increment(&largs->fastopen_accepted);
+#else
+    (void)largs;
+    (void)sockfd;
+#endif
+}
+
+/*
+ * The protocol of the stream sockets to the given address family.
+ */
+static int
+stream_protocol(const struct engine_params *params, int family) {
+    if(family == AF_UNIX) return 0;
+#ifdef TCPKALI_MPTCP
+    if(params->mptcp) return IPPROTO_MPTCP;
+#else
+    (void)params;
+#endif
+    return IPPROTO_TCP;
+}
+
+int
+engine_mptcp_available(void) {
+#ifdef TCPKALI_MPTCP
+    /* net.mptcp.enabled=0 or a kernel without CONFIG_MPTCP refuse it. */
+    int sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_MPTCP);
+    if(sockfd == -1) return 0;
+    close(sockfd);
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * The --connection-group of the connection, or NULL.
+ */
+static inline const struct connection_group *
+connection_group(struct loop_arguments *largs, struct connection *conn) {
+    return conn->cold->group ? &largs->params.groups[conn->cold->group - 1]
+                             : NULL;
+}
+
+/*
+ * How dynamic the messages of the connection are. The connections
+ * which do not send anything have no messages.
+ */
+static inline enum tk_expr_dynamic_scope
+connection_messages_scope(const struct connection *conn) {
+    return conn->cold->message_collection
+               ? conn->cold->message_collection->most_dynamic_expression
+               : DS_GLOBAL_FIXED;
+}
+
+/*
+ * The upstream rate of the connection, unless its --connection-group
+ * has a rate of its own, follows the --message-rate changes.
+ */
+static rate_spec_t
+connection_send_rate(struct loop_arguments *largs, struct connection *conn) {
+    const struct connection_group *group = connection_group(largs, conn);
+    rate_spec_t rate = group && group->own_send_rate
+                           ? group->channel_send_rate
+                           : largs->params.channel_send_rate;
+    if(conn->cold->send_rate_weight > 0.0)
+        rate.value *= conn->cold->send_rate_weight;
+    return rate;
+}
+
+/*
+ * The unnormalized --message-rate-distribution weight of the k-th
+ * connection, 1 <= k <= population. The hottest connection comes first.
+ */
+static double
+rate_distribution_shape(const struct engine_params *params, size_t k) {
+    switch(params->rate_distribution.kind) {
+    case RATE_DIST_NONE:
+        break;
+    case RATE_DIST_ZIPF:
+        return pow(k, -params->rate_distribution.param);
+    case RATE_DIST_PARETO:
+        /* The upper tail quantile in the middle of the k-th slice. */
+        return pow((k - 0.5) / params->rate_distribution.population,
+                   -1.0 / params->rate_distribution.param);
+    }
+    return 1.0;
+}
+
+/*
+ * Rank the new connection within the --message-rate-distribution.
+ * The ranks go round, so the connections made at any moment follow
+ * the distribution as a whole and keep the configured aggregate rate.
+ */
+static void
+connection_rank_send_rate(struct loop_arguments *largs,
+                          struct connection *conn) {
+    size_t population = largs->params.rate_distribution.population;
+    size_t k = (atomic_inc_and_get(largs->rate_rank_atomic) - 1) % population;
+    conn->cold->send_rate_weight = rate_distribution_shape(&largs->params,
+                                                           k + 1)
+                                   * largs->params.rate_distribution.norm;
+}
+
+/*
+ * Pick up the rate published by engine_publish_send_rate(). The live
+ * connections follow it before they send again, see
+ * connection_follow_send_rate(), so the rate change costs the worker
+ * nothing beyond this check.
+ */
+static void
+worker_follow_send_rate(struct loop_arguments *largs) {
+    const struct send_rate_shared *shared = largs->send_rate_shared;
+    if(atomic_get(&shared->sequence) == largs->send_rate_version) return;
+
+    rate_spec_t rate;
+    non_atomic_narrow_t version;
+    non_atomic_narrow_t restarted;
+    for(;;) {
+        version = atomic_get(&shared->sequence);
+        if((version & 1) == 0) {
+            rate = largs->shared_eng_params->channel_send_rate;
+            restarted = shared->restarted;
+            if(atomic_get(&shared->sequence) == version) break;
+        }
+#ifdef HAVE_SCHED_H
+        sched_yield();
+#endif
+    }
+
+    largs->params.channel_send_rate = rate;
+    largs->send_rate_version = version;
+    if(restarted != largs->send_rate_restarted) {
+        largs->send_rate_restarted = restarted;
+        worker_next_rate_step(largs);
+    }
+}
+
+/*
+ * Recompute the upstream limit of the connection after the rate change.
+ * The sending schedule starts anew if the rate was set rather than
+ * followed (see --load-profile) since the connection last looked.
+ */
+static void
+connection_follow_send_rate(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    int restart_pace =
+        (int)(largs->send_rate_restarted - conn->send_rate_version) > 0;
+
+    conn->send_rate_version = largs->send_rate_version;
+    conn->send_limit = compute_bandwidth_limit_by_message_size(
+        connection_send_rate(largs, conn), conn->avg_message_size);
+    if(conn->conn_type == CONN_OUTGOING
+       || (largs->params.listen_mode & _LMODE_SND_MASK)) {
+        if(restart_pace || conn->send_pace.events_per_second <= 0.0)
+            send_pace_init(largs, conn, tk_now(TK_A));
+        else {
+            conn->send_pace.events_per_second =
+                conn->send_limit.bytes_per_second;
+            send_pace_burst(largs, conn);
+        }
+        update_kernel_pacing(largs, conn, tk_fd(&conn->watcher));
+    }
+}
+
+/*
+ * Receive a control event from the pipe.
+ */
+#if !defined(USE_LIBUV) && !defined(USE_IO_URING)
+/*
+ * The connections handed over to another worker, see engine_rebalance().
+ */
+struct migration_batch {
+    size_t count;
+    struct connection *conns[];
+};
+
+/*
+ * Whether the connection only relies on the state which can be
+ * moved to another worker by connection_detach()/connection_adopt().
+ */
+static int
+connection_migratable(const struct connection *conn) {
+    return conn->conn_type != CONN_ACCEPTOR
+           && conn->conn_state == CSTATE_CONNECTED && !conn->closing
+           && conn->zerocopy.sent == conn->zerocopy.completed
+#ifdef HAVE_OPENSSL
+           /* Tied to this worker's SSL_CTX and session cache */
+           && !conn->cold->ssl_fd
+#endif
+           /* Refilled by this worker's payload generator */
+           && !conn->cold->payload_job;
+}
+
+/*
+ * Take the connection out of this worker, keeping it open.
+ */
+static void
+connection_detach(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+
+    conn->cold->migration.watching = ev_is_active(&conn->watcher);
+    conn->cold->migration.timer_at =
+        tk_wheel_entry_at(&largs->timer_wheel, &conn->timer);
+    conn->cold->migration.lifetime_at =
+        tk_wheel_entry_at(&largs->timer_wheel, &conn->lifetime_timer);
+    tk_io_stop(TK_A, &conn->watcher);
+    tk_wheel_remove(&largs->timer_wheel, &conn->timer);
+    tk_wheel_remove(&largs->timer_wheel, &conn->lifetime_timer);
+
+    if(conn->stats_dirty) {
+        TAILQ_REMOVE(&largs->dirty_conns, conn, cold->dirty_hook);
+        conn->stats_dirty = 0;
+    }
+    connection_flush_stats(TK_A_ conn);
+
+    if(conn->conn_type == CONN_OUTGOING) {
+        atomic_decrement(&largs->outgoing_established);
+        if(largs->remote_outstanding)
+            largs->remote_outstanding[conn->cold->remote_index]--;
+        if(conn->cold->group) largs->group_stats[conn->cold->group - 1].open--;
+    } else {
+        atomic_decrement(&largs->incoming_established);
+    }
+
+    TAILQ_REMOVE(&largs->open_conns, conn, hook);
+    if(conn->cold->burst_slot) burst_leave(largs, conn);
+    if(conn->cold->send_queue_slot) {
+        /* Write as soon as adopted, see connection_adopt(). */
+        send_queue_remove(largs, conn);
+        conn->cold->migration.timer_at = tk_now(TK_A);
+    }
+
+    if(largs->dump_connect_fd == tk_fd(&conn->watcher)) {
+        largs->dump_connect_fd = 0;
+    }
+}
+
+/*
+ * Continue serving the connection detached by another worker.
+ */
+static void
+connection_adopt(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    double now = tk_now(TK_A);
+
+    /* Released into this worker's pool from now on. */
+    if(conn->pool) conn->pool = &largs->pools.connections;
+
+    TAILQ_INSERT_TAIL(&largs->open_conns, conn, hook);
+    if(conn->conn_type == CONN_OUTGOING && largs->params.burst_every > 0.0)
+        burst_join(largs, conn);
+
+    if(conn->conn_type == CONN_OUTGOING) {
+        atomic_increment(&largs->outgoing_established);
+        if(largs->remote_outstanding)
+            largs->remote_outstanding[conn->cold->remote_index]++;
+        if(conn->cold->group) largs->group_stats[conn->cold->group - 1].open++;
+    } else {
+        atomic_increment(&largs->incoming_established);
+        /* The index was into the peer table of the previous worker. */
+        if(largs->peer_table && conn->conn_type == CONN_INCOMING)
+            conn->cold->peer_index = peer_table_find(
+                largs->peer_table, (struct sockaddr *)&conn->cold->peer_name);
+    }
+
+    if(conn->cold->migration.timer_at > 0.0) {
+        double delay = conn->cold->migration.timer_at - now;
+        timer_wheel_schedule(TK_A_ & conn->timer, delay > 0.0 ? delay : 0.0);
+    }
+    if(conn->cold->migration.lifetime_at > 0.0) {
+        double delay = conn->cold->migration.lifetime_at - now;
+        timer_wheel_schedule(TK_A_ & conn->lifetime_timer,
+                             delay > 0.0 ? delay : 0.0);
+    }
+    if(conn->cold->migration.watching) ev_io_start(TK_A_ & conn->watcher);
+}
+
+struct migration_candidate {
+    struct connection *conn;
+    non_atomic_wide_t load;
+};
+
+static int
+migration_candidate_cmp(const void *ap, const void *bp) {
+    const struct migration_candidate *a = ap;
+    const struct migration_candidate *b = bp;
+    return a->load < b->load ? 1 : (a->load > b->load ? -1 : 0);
+}
+
+/*
+ * Pass the detached connections to another worker,
+ * through its private control pipe.
+ */
+static void
+migration_batch_send(struct loop_arguments *largs, int target,
+                     struct migration_batch *batch) {
+    if(batch->count == 0) {
+        free(batch);
+        return;
+    }
+
+    DEBUG(DBG_DETAIL, "Moving %zu connections from worker %d to %d\n",
+          batch->count, largs->thread_no, target);
+
+    /* Atomic, as it is shorter than PIPE_BUF. */
+    char msg[1 + sizeof(batch)];
+    msg[0] = 'm';
+    memcpy(&msg[1], &batch, sizeof(batch));
+    int rc = write(largs->peers[target].private_control_pipe_wr, msg,
+                   sizeof(msg));
+    assert(rc == sizeof(msg));
+}
+
+/*
+ * Hand over the connections carrying the given share of this worker's
+ * data to another worker.
+ * The connections are ranked by the data they moved since the last time.
+ */
+static void
+migrate_load_share(TK_P_ int target, double share) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    size_t n_conns = 0;
+    struct connection *conn;
+    TAILQ_FOREACH(conn, &largs->open_conns, hook) n_conns++;
+    if(!n_conns) return;
+
+    struct migration_candidate *candidates =
+        malloc(n_conns * sizeof(candidates[0]));
+    assert(candidates);
+    size_t n_candidates = 0;
+    non_atomic_wide_t total_load = 0;
+    TAILQ_FOREACH(conn, &largs->open_conns, hook) {
+        non_atomic_wide_t bytes =
+            conn->traffic_ongoing.bytes_sent + conn->traffic_ongoing.bytes_rcvd;
+        non_atomic_wide_t load = bytes - conn->cold->migration.bytes_mark;
+        conn->cold->migration.bytes_mark = bytes;
+        total_load += load;
+        if(load && connection_migratable(conn)) {
+            candidates[n_candidates].conn = conn;
+            candidates[n_candidates].load = load;
+            n_candidates++;
+        }
+    }
+    qsort(candidates, n_candidates, sizeof(candidates[0]),
+          migration_candidate_cmp);
+
+    /*
+     * The hottest connections go first, unless moving a connection
+     * would overshoot: that would just move the hot spot over.
+     */
+    struct migration_batch *batch =
+        malloc(sizeof(*batch) + REBALANCE_MAX_CONNECTIONS * sizeof(conn));
+    assert(batch);
+    batch->count = 0;
+    double budget = share * total_load;
+    for(size_t i = 0;
+        i < n_candidates && batch->count < REBALANCE_MAX_CONNECTIONS; i++) {
+        if(candidates[i].load > budget) continue;
+        budget -= candidates[i].load;
+        connection_detach(TK_A_ candidates[i].conn);
+        batch->conns[batch->count++] = candidates[i].conn;
+    }
+    free(candidates);
+
+    migration_batch_send(largs, target, batch);
+}
+
+/*
+ * Move the share of the load requested by engine_rebalance().
+ */
+static void
+migrate_connections(TK_P) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    int target = atomic_get(&largs->rebalance_target);
+    double share = atomic_get(&largs->rebalance_permille) / 1000.0;
+
+    if(target >= largs->n_peers || target == largs->thread_no) return;
+
+    /* The connections sent to a retiring worker would be lost. */
+    pthread_mutex_lock(largs->workers_lock);
+    if(!atomic_get(&largs->peers[target].retiring))
+        migrate_load_share(TK_A_ target, share);
+    pthread_mutex_unlock(largs->workers_lock);
+}
+
+/*
+ * Deal the connections out to the workers [0, n_peers) evenly.
+ */
+static void
+migrate_all_connections(TK_P_ int n_peers) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct connection *conn, *tmp;
+
+    size_t n_conns = 0;
+    TAILQ_FOREACH(conn, &largs->open_conns, hook) n_conns++;
+    if(!n_conns || n_peers <= 0) return;
+
+    struct migration_batch **batches = calloc(n_peers, sizeof(batches[0]));
+    assert(batches);
+    for(int i = 0; i < n_peers; i++) {
+        batches[i] = malloc(sizeof(*batches[i])
+                            + (n_conns / n_peers + 1) * sizeof(conn));
+        assert(batches[i]);
+        batches[i]->count = 0;
+    }
+
+    int next = 0;
+    TAILQ_FOREACH_SAFE(conn, &largs->open_conns, hook, tmp) {
+        if(!connection_migratable(conn)) continue;
+        connection_detach(TK_A_ conn);
+        batches[next]->conns[batches[next]->count++] = conn;
+        next = (next + 1) % n_peers;
+    }
+
+    for(int i = 0; i < n_peers; i++)
+        migration_batch_send(largs, i, batches[i]);
+    free(batches);
+}
+
+static void
+adopt_connections(TK_P_ int fd) {
+    struct migration_batch *batch;
+    int rc = read(fd, &batch, sizeof(batch));
+    assert(rc == sizeof(batch));
+    for(size_t i = 0; i < batch->count; i++)
+        connection_adopt(TK_A_ batch->conns[i]);
+    free(batch);
+}
+#endif /* !USE_LIBUV && !USE_IO_URING */
+
+/*
+ * Leave the connections to the remaining workers before retiring,
+ * see engine_set_workers(). The connections which could not be moved
+ * are closed, and the main thread opens as many in the other workers.
+ */
+static void
+worker_drain(TK_P) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+
+#if !defined(USE_LIBUV) && !defined(USE_IO_URING)
+    migrate_all_connections(TK_A_ atomic_get(&largs->drain_to));
+#endif
+
+    non_atomic_narrow_t dropped =
+        atomic_exchange(&largs->connections_requested, 0)
+        + atomic_exchange(&largs->reconnects_pending, 0);
+    struct connection *conn;
+    TAILQ_FOREACH(conn, &largs->open_conns, hook) {
+        if(conn->conn_type == CONN_OUTGOING) dropped++;
+    }
+    atomic_exchange(&largs->connections_dropped, dropped);
+}
+
+static void
+control_cb(TK_P_ tk_io *w, int UNUSED revents) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+
+    char c;
+    int ret = read(tk_fd(w), &c, 1);
+    if(ret != 1) {
+        if(errno != EAGAIN)
+            DEBUG(DBG_ALWAYS,
+                  "%d Reading from control channel %d returned: %s\n",
+                  largs->thread_no, tk_fd(w), strerror(errno));
+        return;
+    }
+    switch(c) {
+    case 'c': /* Initiate new connections */
+        if(tk_fd(w) == largs->private_control_pipe_rd) {
+            /* Open all connections requested since the last wakeup. */
+            non_atomic_narrow_t n =
+                atomic_exchange(&largs->connections_requested, 0);
+            while(n--) start_new_connection(TK_A);
+        } else {
+            start_new_connection(TK_A);
+        }
+        socket_pool_refill(largs);
+        break;
+    case 'w': /* Forget the latencies so far, see --warmup */
+        worker_reset_histograms(largs);
+        break;
+    case 'x': { /* Close some of the outgoing connections */
+        non_atomic_narrow_t n =
+            atomic_exchange(&largs->connections_to_close, 0);
+        struct connection *conn, *tmp;
+        TAILQ_FOREACH_SAFE(conn, &largs->open_conns, hook, tmp) {
+            if(n == 0) break;
+            if(conn->conn_type != CONN_OUTGOING) continue;
+            close_connection(TK_A_ conn, CCR_CLEAN);
+            n--;
+        }
+        break;
+    }
+#if !defined(USE_LIBUV) && !defined(USE_IO_URING)
+    case 'b': /* Move some connections elsewhere, see engine_rebalance() */
+        migrate_connections(TK_A);
+        break;
+    case 'm': /* Take over the connections of another worker */
+        assert(tk_fd(w) == largs->private_control_pipe_rd);
+        adopt_connections(TK_A_ tk_fd(w));
+        break;
+#endif
+    case 'D': /* Retire, see engine_set_workers() */
+        worker_drain(TK_A);
+        /* FALL THROUGH */
+    case 'T': /* Terminate */
+        worker_update_shared_histograms(largs);
+        worker_update_remote_histograms(largs);
+        largs->loop_stopped = 1;
+        tk_stop(TK_A);
+        break;
+    default:
+        DEBUG(DBG_ALWAYS, "Unknown operation '%c' from a control channel %d\n",
+              c, tk_fd(w));
+    }
+}
+
+static struct payload_job_key
+expr_key_of(const struct connection *conn) {
+    return (struct payload_job_key){
+        .conn = conn,
+        .uid = conn->cold->connection_unique_id,
+        .expr_seed = conn->cold->expr_seed,
+        .marker_binary = conn->cold->latency.marker_binary};
+}
+
+/*
+ * Evaluate the connection-specific parts of the expression, given
+ * a snapshot of the connection. Safe to run off the worker thread.
+ */
+static ssize_t
+expr_key_callback(char *buf, size_t size, tk_expr_t *expr, void *key,
+                  long *v) {
+    const struct payload_job_key *k = key;
+    ssize_t s;
+
+    switch(expr->type) {
+    case EXPR_CONNECTION_PTR:
+        s = snprintf(buf, size, "%p", k->conn);
+        if(v) *v = (long)k->conn;
+        break;
+    case EXPR_CONNECTION_UID:
+        s = snprintf(buf, size, "%" PRIan, k->uid);
+        if(v) *v = (long)k->uid;
+        break;
+    case EXPR_REGEX: {
+        /*
+         * Draw the connection.regex from the connection's own sequence,
+         * to come up with the same value every time it is evaluated.
+         */
+        pcg32_random_t rng;
+        pcg32_srandom_r(&rng, k->expr_seed, (uintptr_t)expr);
+        s = tregex_eval_rng(expr->u.regex.re, buf, size, &rng);
+        if(v) *v = (long)0;
+        break;
+    }
+    case EXPR_MESSAGE_SEQ:
+    case EXPR_TIME_US: {
+        /* Rewritten as the data is sent, see update_slots(). */
+        s = expr->type == EXPR_MESSAGE_SEQ ? EXPR_MESSAGE_SEQ_WIDTH
+                                           : EXPR_TIME_US_WIDTH;
+        assert(size >= (size_t)s);
+        memset(buf, '0', s);
+        if(v) *v = (long)0;
+        break;
+    }
+    case EXPR_MESSAGE_MARKER: {
+        if(k->marker_binary) {
+            const size_t magic_len = sizeof(MESSAGE_MARKER_BINARY_MAGIC) - 1;
+            struct message_marker_binary mb = {.uid = htole32(k->uid)};
+            assert(size >= MESSAGE_MARKER_BINARY_SIZE);
+            memcpy(buf, MESSAGE_MARKER_BINARY_MAGIC, magic_len);
+            memcpy(buf + magic_len, &mb, sizeof(mb));
+            s = MESSAGE_MARKER_BINARY_SIZE;
+            if(v) *v = (long)0;
+            break;
+        }
+#define MZEROS   "0000000000000000"
+        const size_t tok_size = sizeof(MESSAGE_MARKER_TOKEN MZEROS ".")-1;
+        assert(size >= tok_size);
+        memcpy(buf, MESSAGE_MARKER_TOKEN MZEROS ".", tok_size);
+        s = tok_size;
+        if(v) *v = (long)0;
+        break;
+    }
+    default:
+        s = snprintf(buf, size, "?");
+        if(v) *v = 0;
+        break;
+    }
+
+    if(s < 0 || s > (ssize_t)size) return -1;
+    return s;
+}
+
+static ssize_t
+expr_callback(char *buf, size_t size, tk_expr_t *expr, void *key, long *v) {
+    struct payload_job_key k = expr_key_of(key);
+    return expr_key_callback(buf, size, expr, &k, v);
+}
+
+/*
+ * --hugepages: move the connection's own payload into the 2MB pages.
+ * The replicated payloads of many connections would otherwise take
+ * a TLB entry per every 4k page sent.
+ */
+static void
+data_move_to_hugepages(struct loop_arguments *largs,
+                       struct transport_data_spec *data) {
+    if(data->flags & (TDS_FLAG_PTR_SHARED | TDS_FLAG_PTR_HUGE)) return;
+    void *p = tk_huge_alloc(largs->huge_arena, data->allocated_size + 1);
+    if(!p) return; /* Stays in the malloc(3) memory */
+    memcpy(p, data->ptr, data->total_size + 1);
+    free(data->ptr);
+    data->ptr = p;
+    data->flags |= TDS_FLAG_PTR_HUGE;
+}
+
+/*
+ * Release the data owned by the connection or the cache.
+ */
+static void
+data_spec_free(struct loop_arguments *largs,
+               struct transport_data_spec *data) {
+    if(data->flags & TDS_FLAG_PTR_HUGE)
+        tk_huge_free(largs->huge_arena, data->ptr, data->allocated_size + 1);
+    else
+        free(data->ptr);
+    free(data->marker_offsets);
+    free(data->slots);
+}
+
+/*
+ * The next \{connection.uid}. The workers lease the uids from the shared
+ * counter in blocks, so the connects do not bounce its cache line between
+ * the CPUs. The connections take the --replay-pcap streams in turns by
+ * their uids, so there the uids are leased one by one to stay dense.
+ */
+static non_atomic_narrow_t
+connection_uid_take(struct loop_arguments *largs) {
+    if(largs->uid_lease_next == largs->uid_lease_end) {
+        non_atomic_narrow_t block =
+            largs->params.replay ? 1 : CONNECTION_UID_LEASE;
+        non_atomic_narrow_t last =
+            atomic_add_and_get(largs->connection_unique_id_atomic, block);
+        largs->uid_lease_next = last - block + 1;
+        largs->uid_lease_end = last + 1;
+    }
+    return largs->uid_lease_next++;
+}
+
+static void
+explode_data_template(struct message_collection *mc,
+                      struct transport_data_spec *const data_templates[2],
+                      enum transport_websocket_side tws_side,
+                      struct transport_data_spec *out_data,
+                      struct loop_arguments *largs,
+                      struct connection *conn) {
+    if(data_templates[tws_side]) {
+        assert(mc->most_dynamic_expression == DS_GLOBAL_FIXED);
+        /*
+         * Return the already once prepared data.
+         */
+        *out_data = *data_templates[tws_side];
+        out_data->flags |= TDS_FLAG_PTR_SHARED;
+    } else {
+        /*
+         * We might need a unique ID for a connection, and it is a bit expensive
+         * to obtain it. We set it here once during connection establishment.
+         */
+        if(!conn->cold->connection_unique_id)
+            conn->cold->connection_unique_id = connection_uid_take(largs);
+
+        struct transport_data_spec *new_data_ptr;
+        new_data_ptr = transport_spec_from_message_collection(
+            out_data, mc, expr_callback, conn, tws_side, TS_CONVERSION_INITIAL, &largs->rng);
+        assert(new_data_ptr == out_data);
+
+        switch(mc->most_dynamic_expression) {
+        case DS_GLOBAL_FIXED:
+            assert(!"Unreachable");
+        case DS_PER_CONNECTION:
+        case DS_MESSAGE_SLOTS:
+            if(largs->params.message_marker == 0) {
+                replicate_payload(out_data, REPLICATE_MAX_SIZE);
+            }
+            if(largs->huge_arena) data_move_to_hugepages(largs, out_data);
+            break;
+        case DS_PER_MESSAGE:
+            break;
+        }
+        assert(out_data->ptr);
+        TK_PROBE2(explode, conn->cold->connection_unique_id,
+                  out_data->total_size);
+    }
+}
+
+/*
+ * The messages with \{connection.uid % N} take only a few different forms.
+ * The connections with the same uid modulo the period of the collection
+ * share the data exploded once by the worker, read-only.
+ */
+#define DATA_TEMPLATE_CACHE_MAX 256 /* The periods of the data cached */
+struct data_template_cache {
+    struct data_template_cache *next;
+    const struct message_collection *mc;
+    enum transport_websocket_side tws_side;
+    long period; /* 0 if the data is not cached */
+    struct transport_data_spec *data; /* [period], .ptr is set once exploded */
+};
+
+static struct data_template_cache *
+data_template_cache_find(struct loop_arguments *largs,
+                         const struct message_collection *mc,
+                         enum transport_websocket_side tws_side) {
+    struct data_template_cache *cache;
+    for(cache = largs->data_template_caches; cache; cache = cache->next) {
+        if(cache->mc == mc && cache->tws_side == tws_side) return cache;
+    }
+
+    cache = calloc(1, sizeof(*cache));
+    assert(cache);
+    cache->mc = mc;
+    cache->tws_side = tws_side;
+    /* The per-message data differs every time. */
+    if(mc->most_dynamic_expression == DS_PER_CONNECTION)
+        cache->period =
+            message_collection_connection_period(mc, DATA_TEMPLATE_CACHE_MAX);
+    if(cache->period) {
+        cache->data = calloc(cache->period, sizeof(cache->data[0]));
+        assert(cache->data);
+    }
+    cache->next = largs->data_template_caches;
+    largs->data_template_caches = cache;
+    return cache;
+}
+
+/*
+ * Take the shared data for the connection, exploding it on the
+ * first use. Returns 0 if the collection is too dynamic to be cached.
+ */
+static int
+data_template_cache_take(struct loop_arguments *largs,
+                         struct connection *conn,
+                         struct message_collection *mc,
+                         enum transport_websocket_side tws_side) {
+    struct data_template_cache *cache =
+        data_template_cache_find(largs, mc, tws_side);
+    if(cache->period == 0) return 0;
+
+    if(!conn->cold->connection_unique_id)
+        conn->cold->connection_unique_id = connection_uid_take(largs);
+    struct transport_data_spec *data =
+        &cache->data[conn->cold->connection_unique_id % cache->period];
+    if(!data->ptr) {
+        struct transport_data_spec *const no_templates[2] = {NULL, NULL};
+        explode_data_template(mc, no_templates, tws_side, data, largs, conn);
+    }
+
+    conn->data = *data;
+    conn->data.flags |= TDS_FLAG_PTR_SHARED;
+    return 1;
+}
+
+static void
+data_template_cache_free(struct loop_arguments *largs) {
+    struct data_template_cache *cache;
+    while((cache = largs->data_template_caches)) {
+        largs->data_template_caches = cache->next;
+        for(long i = 0; i < cache->period; i++) {
+            data_spec_free(largs, &cache->data[i]);
+        }
+        free(cache->data);
+        free(cache);
+    }
+}
+
+/*
+ * The connections take turns replaying the --replay-pcap streams.
+ * The stream data is shared by the connections, not copied.
+ */
+static void
+replay_stream_take(struct loop_arguments *largs, struct connection *conn) {
+    const struct pcap_replay *replay = largs->params.replay;
+
+    if(!conn->cold->connection_unique_id)
+        conn->cold->connection_unique_id = connection_uid_take(largs);
+    const struct pcap_stream *stream =
+        &replay->streams[(conn->cold->connection_unique_id - 1)
+                         % replay->streams_count];
+    conn->data = stream->data;
+    assert(conn->data.flags & TDS_FLAG_PTR_SHARED);
+
+    if(largs->params.replay_original_timing) {
+        conn->replay_timed = 1;
+        conn->cold->replay.stream = stream;
+        conn->cold->replay.burst = 0;
+    }
+}
+
+/*
+ * The connections share the --message-corpus, each one starting
+ * at a random message and walking through it from there.
+ */
+static void
+corpus_take(struct loop_arguments *largs, struct connection *conn) {
+    const struct message_corpus *corpus = largs->params.corpus;
+
+    conn->data = corpus->data;
+    conn->data.flags |= TDS_FLAG_PTR_SHARED;
+    conn->write_offset =
+        corpus->offsets[pcg32_boundedrand_r(&largs->rng, corpus->count)];
+}
+
+/*
+ * Copy the received data or the end of stream into the --record ring.
+ */
+static void
+record_received(TK_P_ struct connection *conn, enum record_type type,
+                const void *data, size_t size) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct record_header hdr = {
+        .connection_id = conn->cold->connection_unique_id,
+        .offset = conn->cold->record_offset,
+        .timestamp_ns =
+            (tk_now(TK_A) + largs->record_clock_offset) * 1000000000.0,
+        .size = size,
+        .type = type,
+        .flags = (conn->conn_type == CONN_INCOMING) ? RECORD_F_INCOMING : 0};
+    record_append(largs->record_ring, &hdr, data);
+    conn->cold->record_offset += size;
+}
+
+/*
+ * Replace the --message with the --http2 request frames, sent after the
+ * connection preface. Several requests are replicated into the buffer,
+ * so that a single write() could send the requests allowed in flight.
+ * The stream identifiers are set just before sending the requests,
+ * see http2_number_requests().
+ * The --grpc messages are length-prefixed here. With --grpc-stream, the
+ * call is opened on stream 1 after the preface, and the messages are
+ * the DATA frames of that stream.
+ */
+static void
+http2_frame_requests(struct loop_arguments *largs, struct connection *conn) {
+    struct transport_data_spec *data = &conn->data;
+    const uint8_t *body = (const uint8_t *)data->ptr + data->once_size;
+    size_t body_size = data->single_message_size;
+    size_t headers_size = largs->params.http2_headers_size;
+    uint8_t *grpc_message = NULL;
+    if(largs->params.grpc_enable) {
+        grpc_message = malloc(GRPC_PREFIX_SIZE + body_size);
+        assert(grpc_message);
+        body_size = grpc_frame_message(grpc_message, body, body_size);
+        body = grpc_message;
+    }
+    int streaming = largs->params.grpc_stream;
+    size_t request_size = streaming
+                              ? HTTP2_FRAME_HEADER_SIZE + body_size
+                              : HTTP2_REQUEST_SIZE(headers_size, body_size);
+    size_t copies = REPLICATE_MAX_SIZE / request_size;
+    if(copies > largs->params.pipeline && !streaming)
+        copies = largs->params.pipeline;
+    if(copies == 0) copies = 1;
+
+    size_t once_max = HTTP2_PREFACE_MAX
+                      + (streaming ? HTTP2_FRAME_HEADER_SIZE + headers_size
+                                   : 0);
+    uint8_t *ptr = malloc(once_max + copies * request_size);
+    assert(ptr);
+    size_t once_size = http2_client_preface(ptr);
+    if(streaming) {
+        once_size += http2_frame(ptr + once_size, H2F_HEADERS,
+                                 H2FL_END_HEADERS, 1,
+                                 largs->params.http2_headers, headers_size);
+    }
+    for(size_t i = 0; i < copies; i++) {
+        uint8_t *request = ptr + once_size + i * request_size;
+        if(streaming)
+            http2_frame(request, H2F_DATA, 0, 1, body, body_size);
+        else
+            http2_frame_request(request, largs->params.http2_headers,
+                                headers_size, body, body_size);
+    }
+    free(grpc_message);
+
+    if(!(data->flags & TDS_FLAG_PTR_SHARED)) data_spec_free(largs, data);
+    memset(data, 0, sizeof(*data));
+    data->ptr = ptr;
+    data->once_size = once_size;
+    data->total_size = once_size + copies * request_size;
+    data->allocated_size = once_max + copies * request_size;
+    data->single_message_size = request_size;
+    if(copies > 1) data->flags = TDS_FLAG_REPLICATED;
+
+    conn->cold->http2.body_size = body_size;
+    conn->cold->http2.max_streams = UINT32_MAX; /* Until SETTINGS say */
+    conn->cold->http2.send_window = 65535;
+    conn->cold->http2.stream_window = 65535;
+    conn->cold->http2.initial_window = 65535;
+    if(!streaming) {
+        conn->cold->http2.streams = calloc(
+            largs->params.pipeline, sizeof(conn->cold->http2.streams[0]));
+        assert(conn->cold->http2.streams);
+    }
+    /* The grpc-status is looked for in the trailers. */
+    if(largs->params.grpc_enable) {
+        conn->cold->http2.parser.block = malloc(GRPC_TRAILERS_MAX);
+        assert(conn->cold->http2.parser.block);
+        conn->cold->http2.parser.block_max = GRPC_TRAILERS_MAX;
+    }
+}
+
+static void
+explode_data_template_override(struct message_collection *mc,
+                               enum transport_websocket_side tws_side,
+                               struct transport_data_spec *out_data,
+                               struct loop_arguments *largs,
+                               struct connection *conn) {
+    assert(mc->most_dynamic_expression == DS_PER_MESSAGE);
+
+    struct transport_data_spec *new_data_ptr;
+    new_data_ptr = transport_spec_from_message_collection(
+        out_data, mc, expr_callback, conn, tws_side,
+        TS_CONVERSION_OVERRIDE_MESSAGES, &largs->rng);
+    assert(new_data_ptr == out_data);
+}
+
+/*
+ * Create a spare buffer for the connection's payload,
+ * to be refilled in the background.
+ */
+static struct payload_job *
+payload_job_new(struct loop_arguments *largs, struct connection *conn,
+                enum transport_websocket_side tws_side) {
+    struct payload_job *job = calloc(1, sizeof(*job));
+    assert(job);
+    job->spec = conn->data;
+    job->spec.ptr = malloc(conn->data.allocated_size + 1);
+    assert(job->spec.ptr);
+    /* Retain the data which is sent once, it is not regenerated. */
+    memcpy(job->spec.ptr, conn->data.ptr, conn->data.total_size);
+    if(conn->data.marker_offsets) {
+        size_t index_size =
+            conn->data.marker_offsets_size * sizeof(conn->data.marker_offsets[0]);
+        job->spec.marker_offsets = malloc(index_size);
+        assert(job->spec.marker_offsets);
+        memcpy(job->spec.marker_offsets, conn->data.marker_offsets, index_size);
+    }
+    if(conn->data.slots) {
+        size_t index_size =
+            conn->data.slots_size * sizeof(conn->data.slots[0]);
+        job->spec.slots = malloc(index_size);
+        assert(job->spec.slots);
+        memcpy(job->spec.slots, conn->data.slots, index_size);
+    }
+    job->mc = conn->cold->message_collection;
+    /* The generator can't take the uid later, see expr_key_of(). */
+    if(!conn->cold->connection_unique_id)
+        conn->cold->connection_unique_id = connection_uid_take(largs);
+    job->expr_cb = expr_key_callback;
+    job->expr_cb_key = expr_key_of(conn);
+    job->tws_side = tws_side;
+    job->state = PJ_IDLE;
+    return job;
+}
+
+static void
+explode_string_expression(char **buf_p, size_t *size, tk_expr_t *expr,
+                          struct loop_arguments *largs,
+                          struct connection *conn) {
+    *buf_p = 0;
+    ssize_t s = eval_expression(buf_p, 0, expr, expr_callback, conn, 0,
+                                conn->conn_type == CONN_OUTGOING, &largs->rng);
+    assert(s >= 0);
+    *size = s;
+}
+
+/*
+ * Replace the --message with the --mqtt PUBLISH packets, sent after the
+ * CONNECT and the SUBSCRIBE of this connection. The QoS 1 packets are
+ * replicated for a single write() to send those allowed in flight, and
+ * take their Packet Identifiers just before being sent, see
+ * mqtt_number_publishes(). The QoS 0 packets are not replicated, keeping
+ * the connections small: the writes wrap around the buffer instead.
+ */
+static void
+mqtt_frame_messages(struct loop_arguments *largs, struct connection *conn) {
+    struct transport_data_spec *data = &conn->data;
+    const struct engine_params *params = &largs->params;
+    enum mqtt_version version = params->mqtt_version;
+    const uint8_t *payload = (const uint8_t *)data->ptr + data->once_size;
+    size_t payload_size = data->single_message_size;
+    int qos = params->mqtt_qos;
+
+    /* Unique per process and connection, in the 23 bytes of MQTT 3.1.1. */
+    if(!conn->cold->connection_unique_id)
+        conn->cold->connection_unique_id = connection_uid_take(largs);
+    char client_id[64];
+    size_t client_id_size = snprintf(
+        client_id, sizeof(client_id), "tcpkali-%x-%llx", (unsigned)getpid(),
+        (unsigned long long)conn->cold->connection_unique_id);
+    char *topic;
+    size_t topic_size;
+    explode_string_expression(&topic, &topic_size, params->mqtt_topic_expr,
+                              largs, conn);
+    char *filter = NULL;
+    size_t filter_size = 0;
+    if(params->mqtt_subscribe_expr)
+        explode_string_expression(&filter, &filter_size,
+                                  params->mqtt_subscribe_expr, largs, conn);
+
+    /* The broker allows one and a half Keep Alive between the packets. */
+    unsigned keepalive = 0;
+    if(largs->keepalive_size) keepalive = ceil(params->keepalive_interval);
+
+    size_t once_max = mqtt_connect_estimate(version, client_id_size)
+                      + (filter ? mqtt_subscribe_estimate(version, filter_size)
+                                : 0);
+    size_t publish_size = 0;
+    size_t copies = 0;
+    if(payload_size) {
+        publish_size =
+            mqtt_publish_estimate(version, topic_size, payload_size, qos);
+        copies = qos ? REPLICATE_MAX_SIZE / publish_size : 1;
+        if(copies > params->pipeline && qos) copies = params->pipeline;
+        if(copies == 0) copies = 1;
+    }
+
+    uint8_t *ptr = malloc(once_max + copies * publish_size);
+    assert(ptr);
+    size_t once_size =
+        mqtt_connect(ptr, version, client_id, client_id_size, keepalive);
+    if(filter)
+        once_size +=
+            mqtt_subscribe(ptr + once_size, version, 1, filter, filter_size);
+    for(size_t i = 0; i < copies; i++) {
+        mqtt_publish(ptr + once_size + i * publish_size, version, topic,
+                     topic_size, qos, payload, payload_size);
+    }
+    free(topic);
+    free(filter);
+
+    if(!(data->flags & TDS_FLAG_PTR_SHARED)) data_spec_free(largs, data);
+    memset(data, 0, sizeof(*data));
+    data->ptr = ptr;
+    data->once_size = once_size;
+    data->total_size = once_size + copies * publish_size;
+    data->allocated_size = once_max + copies * publish_size;
+    data->single_message_size = publish_size;
+    if(copies > 1) data->flags = TDS_FLAG_REPLICATED;
+}
+
+/*
+ * The connections evaluating the --latency-marker expression to the
+ * same string share the string and its search table, interned by the
+ * worker by the contents, until the last connection gives it back.
+ */
+struct marker_intern {
+    struct marker_intern *next; /* In the hash bucket */
+    uint32_t hash;
+    size_t refcount;
+    struct StreamBMH_Occ occ;
+    size_t size;
+    uint8_t data[];
+};
+
+static uint32_t
+marker_intern_hash(const void *data, size_t size) {
+    const uint8_t *p = data;
+    uint32_t h = 2166136261u; /* FNV-1a */
+    for(size_t i = 0; i < size; i++) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+static void
+marker_interns_rehash(struct loop_arguments *largs, size_t buckets_count) {
+    struct marker_intern **buckets =
+        calloc(buckets_count, sizeof(buckets[0]));
+    assert(buckets);
+    for(size_t i = 0; i < largs->marker_interns.buckets_count; i++) {
+        struct marker_intern *mi = largs->marker_interns.buckets[i];
+        while(mi) {
+            struct marker_intern *next = mi->next;
+            struct marker_intern **head =
+                &buckets[mi->hash & (buckets_count - 1)];
+            mi->next = *head;
+            *head = mi;
+            mi = next;
+        }
+    }
+    free(largs->marker_interns.buckets);
+    largs->marker_interns.buckets = buckets;
+    largs->marker_interns.buckets_count = buckets_count;
+}
+
+/*
+ * Find or add the marker string, with its search table built once.
+ */
+static struct marker_intern *
+marker_intern_take(struct loop_arguments *largs, const uint8_t *data,
+                   size_t size) {
+    uint32_t hash = marker_intern_hash(data, size);
+    if(largs->marker_interns.buckets_count) {
+        struct marker_intern *mi =
+            largs->marker_interns
+                .buckets[hash & (largs->marker_interns.buckets_count - 1)];
+        for(; mi; mi = mi->next) {
+            if(mi->hash == hash && mi->size == size
+               && memcmp(mi->data, data, size) == 0) {
+                mi->refcount++;
+                return mi;
+            }
+        }
+    }
+
+    if(largs->marker_interns.count >= largs->marker_interns.buckets_count)
+        marker_interns_rehash(largs, largs->marker_interns.buckets_count
+                                         ? 2 * largs->marker_interns.buckets_count
+                                         : 64);
+
+    struct marker_intern *mi = malloc(sizeof(*mi) + size);
+    assert(mi);
+    mi->hash = hash;
+    mi->refcount = 1;
+    mi->size = size;
+    memcpy(mi->data, data, size);
+    sbmh_init(NULL, &mi->occ, mi->data, size);
+    struct marker_intern **head =
+        &largs->marker_interns
+             .buckets[hash & (largs->marker_interns.buckets_count - 1)];
+    mi->next = *head;
+    *head = mi;
+    largs->marker_interns.count++;
+    return mi;
+}
+
+static void
+marker_intern_give(struct loop_arguments *largs, struct marker_intern *mi) {
+    if(--mi->refcount) return;
+
+    struct marker_intern **pp =
+        &largs->marker_interns
+             .buckets[mi->hash & (largs->marker_interns.buckets_count - 1)];
+    while(*pp != mi) pp = &(*pp)->next;
+    *pp = mi->next;
+    largs->marker_interns.count--;
+    free(mi);
+}
+
+static void
+remote_health_latency(struct loop_arguments *largs, size_t remote_index,
+                      double latency) {
+    if(largs->remote_health)
+        exp_moving_average_add(&largs->remote_health[remote_index].latency,
+                               latency);
+}
+
+static void
+remote_health_outcome(struct loop_arguments *largs, size_t remote_index,
+                      int failed) {
+    if(largs->remote_health)
+        exp_moving_average_add(&largs->remote_health[remote_index].failures,
+                               failed ? 1.0 : 0.0);
+}
+
+/*
+ * --connect-backoff: each connect failing in a row doubles the time the
+ * remote is left alone, up to --connect-backoff-max, with the full jitter:
+ * a random time up to that. A successful connect resets the backoff.
+ */
+static void
+remote_backoff_outcome(struct loop_arguments *largs, size_t remote_index,
+                       double now, int failed) {
+    struct remote_backoff *rb;
+
+    if(!largs->remote_backoff) return;
+    rb = &largs->remote_backoff[remote_index];
+    if(!failed) {
+        rb->failures = 0;
+        rb->until = 0.0;
+        return;
+    }
+
+    if(rb->failures < 32) rb->failures++;
+    double ceiling = ldexp(largs->params.connect_backoff, rb->failures - 1);
+    if(ceiling > largs->params.connect_backoff_max)
+        ceiling = largs->params.connect_backoff_max;
+    rb->until = now + ceiling * ldexp(pcg32_random_r(&largs->rng), -32);
+}
+
+static int
+remote_backing_off(struct loop_arguments *largs, size_t remote_index) {
+    return largs->remote_backoff
+           && largs->remote_backoff[remote_index].until
+                  > largs->remote_backoff_now;
+}
+
+/*
+ * The host:port@rate=,max= quota of the remote and its shared state,
+ * or NULL. The target= destinations of the groups have no quotas.
+ */
+static const struct remote_quota *
+remote_quota_of(struct loop_arguments *largs, size_t remote_index,
+                struct remote_quota_state **state) {
+    if(!largs->remote_quotas
+       || remote_index >= largs->params.remote_addresses.n_addrs
+                              - largs->params.group_remotes)
+        return NULL;
+    size_t q = largs->params.remote_quota_index[remote_index];
+    *state = &largs->remote_quotas[q];
+    return &largs->params.remote_quotas[q];
+}
+
+/*
+ * Seconds until the quota of the remote lets another connection in,
+ * or 0.0 if it does so right away. A free max= slot is only guessed at.
+ */
+static double
+remote_quota_wait(struct loop_arguments *largs, size_t remote_index) {
+    struct remote_quota_state *state;
+    const struct remote_quota *quota =
+        remote_quota_of(largs, remote_index, &state);
+
+    if(!quota) return 0.0;
+    if(quota->max_connections
+       && atomic_get(&state->open) >= quota->max_connections)
+        return REMOTE_QUOTA_RETRY;
+    if(quota->connect_rate > 0.0)
+        return rate_budget_when_allowed(&state->connect_budget,
+                                        quota->connect_rate,
+                                        largs->remote_backoff_now, 1.0);
+    return 0.0;
+}
+
+/*
+ * The connection to the remote is closed, freeing its max= slot.
+ */
+static void
+remote_quota_release(struct loop_arguments *largs, size_t remote_index) {
+    struct remote_quota_state *state;
+    const struct remote_quota *quota =
+        remote_quota_of(largs, remote_index, &state);
+    if(quota && quota->max_connections) atomic_decrement(&state->open);
+}
+
+/*
+ * The expected cost of going to the remote: its recent latency,
+ * plus a connect timeout for each failure. The remotes not tried yet
+ * cost nothing, so they are tried early.
+ */
+static double
+remote_health_cost(struct loop_arguments *largs, size_t remote_index) {
+    const struct remote_health *rh = &largs->remote_health[remote_index];
+    double cost = 0.0;
+    if(isfinite(rh->latency.accumulator)) cost += rh->latency.accumulator;
+    if(isfinite(rh->failures.accumulator))
+        cost += rh->failures.accumulator * largs->params.connect_timeout;
+    return cost;
+}
+
+/*
+ * Open the --reconnect replacements which are due.
+ */
+static void
+reconnect_timer_cb(struct tk_wheel *wheel, struct tk_wheel_entry *e) {
+    TK_P = wheel->userdata;
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    (void)e;
+
+    non_atomic_narrow_t n = atomic_exchange(&largs->reconnects_pending, 0);
+    while(n--) start_new_connection(TK_A);
+    socket_pool_refill(largs);
+}
+
+/*
+ * An outgoing connection is lost: replace it from this worker right away,
+ * without waiting for the main thread to notice the deficit. The attempts
+ * failing in a row back off exponentially from --reconnect-backoff,
+ * with a random jitter of up to a half of the delay.
+ */
+static void
+reconnect_later(TK_P_ int attempt_failed) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+
+    if(!largs->params.reconnect) return;
+
+    atomic_increment(&largs->reconnects_pending);
+    if(attempt_failed)
+        largs->reconnect_failures++;
+    else
+        largs->reconnect_failures = 0;
+    if(tk_wheel_active(&largs->reconnect_timer)) return;
+
+    double delay = 0.0;
+    if(largs->reconnect_failures) {
+        unsigned doublings = largs->reconnect_failures - 1;
+        if(doublings > 6) doublings = 6;
+        delay = largs->params.reconnect_backoff * (1 << doublings);
+        delay -= delay / 2 * ldexp(pcg32_random_r(&largs->rng), -32);
+    }
+    timer_wheel_schedule(TK_A_ & largs->reconnect_timer, delay);
+}
+
+/*
+ * Pick the --connection-group for a new connection: the one most short
+ * of its share of the worker's connections. The replacements of the
+ * closed connections thus keep the groups in proportion, regardless
+ * of how long the connections of each group live.
+ */
+static size_t
+pick_connection_group(struct loop_arguments *largs) {
+    size_t n_groups = largs->params.n_groups;
+    unsigned total = 0;
+    for(size_t g = 0; g < n_groups; g++) total += largs->group_stats[g].open;
+
+    size_t pick = 0;
+    double largest_deficit = -INFINITY;
+    for(size_t g = 0; g < n_groups; g++) {
+        double deficit = largs->params.groups[g].share * (total + 1)
+                         - largs->group_stats[g].open;
+        if(deficit > largest_deficit) {
+            largest_deficit = deficit;
+            pick = g;
+        }
+    }
+    return pick;
+}
+
+/*
+ * A new non-blocking socket for an outgoing connection,
+ * with the --nagle, --rcvbuf and the other options set.
+ */
+static int
+outgoing_socket(struct loop_arguments *largs, sa_family_t family) {
+    int sockfd =
+        largs->params.udp
+            ? tk_socket(family, SOCK_DGRAM, IPPROTO_UDP)
+            : tk_socket(family, SOCK_STREAM,
+                        stream_protocol(&largs->params, family));
+    if(sockfd != -1) {
+        set_nbio(sockfd, 1);
+        set_socket_options(sockfd, family, largs);
+    }
+    return sockfd;
+}
+
+static struct socket_pool *
+socket_pool_of(struct loop_arguments *largs, sa_family_t family) {
+    switch(family) {
+    case AF_INET:
+        return &largs->pools.sockets[0];
+    case AF_INET6:
+        return &largs->pools.sockets[1];
+    default: /* The Unix domain sockets are cheap to make as they go. */
+        return NULL;
+    }
+}
+
+/*
+ * A socket which start_new_connection() just has to connect,
+ * or -1 if the pool of that family has run dry.
+ */
+static int
+socket_pool_take(struct loop_arguments *largs, sa_family_t family) {
+    struct socket_pool *sp = socket_pool_of(largs, family);
+    if(!sp) return -1;
+    sp->demand++;
+    return sp->count ? sp->fds[--sp->count] : -1;
+}
+
+/*
+ * Once a batch of connections is out, make as many sockets as it took,
+ * for the next one. Running out of file descriptors stops the refill,
+ * so the pool does not take them away from the connections.
+ */
+static void
+socket_pool_refill(struct loop_arguments *largs) {
+    static const sa_family_t families[2] = {AF_INET, AF_INET6};
+    for(size_t i = 0; i < 2; i++) {
+        struct socket_pool *sp = &largs->pools.sockets[i];
+        if(sp->demand == 0) continue;
+        sp->target = sp->demand < SOCKET_POOL_SIZE ? sp->demand
+                                                   : SOCKET_POOL_SIZE;
+        sp->demand = 0;
+        while(sp->count < sp->target) {
+            int sockfd = outgoing_socket(largs, families[i]);
+            if(sockfd == -1) break;
+            sp->fds[sp->count++] = sockfd;
+        }
+    }
+}
+
+static void start_new_connection(TK_P) {
+    char tmpbuf[INET6_ADDRSTRLEN + 64];
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct remote_stats *remote_stats;
+    size_t remote_index;
+    non_atomic_narrow_t unique_id = 0;
+    const struct connection_group *group = NULL;
+    size_t group_index = 0;
+
+    /* --remote-select hash places the connection by its connection.uid. */
+    if(largs->params.remote_select == RSEL_HASH)
+        unique_id = connection_uid_take(largs);
+
+    if(largs->params.n_groups) {
+        group_index = pick_connection_group(largs);
+        group = &largs->params.groups[group_index];
+    }
+
+    largs->remote_backoff_now = tk_now(TK_A);
+    struct sockaddr_storage *ss =
+        group && group->remote_count
+            ? pick_group_remote_address(largs, group_index, &remote_index)
+            : pick_remote_address(largs, unique_id, &remote_index);
+    remote_stats = &largs->remote_stats[remote_index];
+
+    /*
+     * All the remotes are left alone for a while, see --connect-backoff:
+     * wait with the --reconnect replacements, still counted as connecting,
+     * so the deficit does not make the main thread ask for more.
+     */
+    if(remote_backing_off(largs, remote_index)) {
+        double delay = largs->remote_backoff[remote_index].until
+                       - largs->remote_backoff_now;
+        atomic_increment(&largs->reconnects_pending);
+        if(!tk_wheel_active(&largs->reconnect_timer))
+            timer_wheel_schedule(TK_A_ & largs->reconnect_timer, delay);
+        return;
+    }
+
+    /*
+     * Likewise, when even the picked remote is out of its host:port@rate=
+     * or max= quota. Otherwise, the attempt takes its rate= token.
+     */
+    struct remote_quota_state *quota_state = NULL;
+    const struct remote_quota *quota =
+        remote_quota_of(largs, remote_index, &quota_state);
+    if(quota) {
+        double delay = remote_quota_wait(largs, remote_index);
+        if(delay > 0.0) {
+            atomic_increment(&largs->reconnects_pending);
+            if(!tk_wheel_active(&largs->reconnect_timer))
+                timer_wheel_schedule(TK_A_ & largs->reconnect_timer, delay);
+            return;
+        }
+        if(quota->connect_rate > 0.0)
+            rate_budget_take(&quota_state->connect_budget,
+                             quota->connect_rate, largs->remote_backoff_now,
+                             1.0);
+    }
+
+    atomic_owner_increment(&largs->connections_counter);
+    atomic_owner_increment(&remote_stats->connection_attempts);
+    largs->worker_connections_initiated++;
+
+    int sockfd = socket_pool_take(largs, ss->ss_family);
+    if(sockfd == -1) sockfd = outgoing_socket(largs, ss->ss_family);
+    /* The sockets closed lately might still hold the descriptors. */
+    if(sockfd == -1 && (errno == EMFILE || errno == ENFILE)
+       && closer_flush(largs->closer_ring))
+        sockfd = outgoing_socket(largs, ss->ss_family);
+    if(sockfd == -1) {
+        switch(errno) {
+        case EMFILE:
+            DEBUG(DBG_ERROR, "Cannot create socket: %s\n", strerror(errno));
+            DEBUG(DBG_ALWAYS,
+                  "Increase `ulimit -n` to twice exceed the --connections.\n");
+            exit(1);
+        case ENFILE:
+            DEBUG(DBG_ERROR, "Cannot create socket: %s\n", strerror(errno));
+            DEBUG(DBG_ALWAYS, "Increase kern.maxfiles/fs.file-max sysctls\n");
+            exit(1);
+        }
+        DEBUG(DBG_WARNING, "Cannot create socket: %s\n", strerror(errno));
+        reconnect_later(TK_A_ 1);
+        return; /* Come back later */
+    }
+
+    /*
+     * If --source-ip is specified, bind to the next one.
+     * With --source-ipv6-prefix, bind to a random address in the prefix,
+     * which need not be configured on any interface.
+     */
+    struct sockaddr_storage prefix_ss;
+    struct sockaddr_storage *bind_ss = NULL;
+    if(largs->params.source_prefix_len) {
+        uint32_t random_bits[4];
+        for(int i = 0; i < 4; i++)
+            random_bits[i] = pcg32_random_r(&largs->rng);
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&prefix_ss;
+        *sin6 = largs->params.source_prefix;
+        address_fill_ipv6_prefix(sin6, largs->params.source_prefix_len,
+                                 (const uint8_t *)random_bits);
+#ifdef IP_FREEBIND
+        /* The SOL_IP option covers IPv6 sockets on all Linux kernels. */
+        int on = 1;
+        (void)setsockopt(sockfd, IPPROTO_IP, IP_FREEBIND, &on, sizeof(on));
+#endif
+        bind_ss = &prefix_ss;
+    } else if(largs->params.source_addresses.n_addrs) {
+        bind_ss = &largs->params.source_addresses
+                       .addrs[largs->worker_connections_initiated
+                              % largs->params.source_addresses.n_addrs];
+    }
+    if(bind_ss) {
+#ifdef IP_BIND_ADDRESS_NO_PORT
+        /*
+         * Postpone the port choice until connect(), so the kernel picks
+         * a port unique for the (source, destination) pair instead of
+         * reserving one of the 64k ports on the source address for good.
+         * Unsupported (pre-4.2) kernels just fall back to the old way.
+         */
+        if(bind_ss->ss_family == AF_INET || bind_ss->ss_family == AF_INET6) {
+            int on = 1;
+            (void)setsockopt(sockfd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &on,
+                             sizeof(on));
+        }
+#endif
+        int rc =
+            bind(sockfd, (struct sockaddr *)bind_ss, sockaddr_len(bind_ss));
+        if(rc == -1) {
+            atomic_owner_increment(&remote_stats->connection_failures);
+            largs->worker_connection_failures++;
+            remote_health_outcome(largs, remote_index, 1);
+            close(sockfd);
+            DEBUG(DBG_WARNING, "Connection to %s is not done: %s\n",
+                  format_sockaddr(ss, tmpbuf, sizeof(tmpbuf)), strerror(errno));
+            reconnect_later(TK_A_ 1);
+            return;
+        }
+    }
+
+    /*
+     * --tcp-fastopen: once the kernel has a cookie from the server,
+     * connect() returns right away and the SYN goes out with the first
+     * write, carrying the first chunk of data.
+     */
+    int fastopen = 0;
+#ifdef TCP_FASTOPEN_CONNECT
+    if(largs->params.tcp_fastopen == TFO_CONNECT && !largs->params.udp
+       && largs->params.channel_lifetime != 0.0
+       && ss->ss_family != AF_UNIX) {
+        int on = 1;
+        fastopen = setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on,
+                              sizeof(on))
+                   == 0;
+    }
+#endif
+
+    int conn_state;
+    int rc = tk_connect(sockfd, (struct sockaddr *)ss, sockaddr_len(ss));
+    if(rc == 0 && fastopen) {
+        /* The connection is not there until the first write is done. */
+        atomic_increment(&largs->outgoing_connecting);
+        conn_state = CSTATE_CONNECTING;
+    } else if(rc == -1) {
+        switch(errno) {
+        case EINPROGRESS:
+            break;
+        case EADDRNOTAVAIL: /* Bind failed */
+            if(largs->params.source_addresses.n_addrs
+               || largs->params.source_prefix_len) {
+                /* This is local problem, not remote address problem. */
+                largs->worker_connection_failures++;
+                DEBUG(DBG_WARNING, "Connection to %s is not done: %s\n",
+                      format_sockaddr(ss, tmpbuf, sizeof(tmpbuf)),
+                      strerror(errno));
+            }
+        /* FALL THROUGH */
+        default:
+            atomic_owner_increment(&remote_stats->connection_failures);
+            largs->worker_connection_failures++;
+            remote_health_outcome(largs, remote_index, 1);
+            remote_backoff_outcome(largs, remote_index, tk_now(TK_A), 1);
+            if(atomic_get(&remote_stats->connection_failures) == 1) {
+                DEBUG(DBG_WARNING, "Connection to %s is not done: %s\n",
+                      format_sockaddr(ss, tmpbuf, sizeof(tmpbuf)),
+                      strerror(errno));
+            }
+            close(sockfd);
+            reconnect_later(TK_A_ 1);
+            return;
+        }
+
+        atomic_increment(&largs->outgoing_connecting);
+        conn_state = CSTATE_CONNECTING;
+    } else { /* A connected --udp socket, or an immediate TCP connection. */
+        if(largs->params.channel_lifetime == 0.0) {
+            close(sockfd);
+            return;
+        }
+        atomic_increment(&largs->outgoing_established);
+        conn_state = CSTATE_CONNECTED;
+        if(largs->params.mptcp) mptcp_count_connection(largs, sockfd);
+        if(largs->connect_histogram_local)
+            hdr_record_value(largs->connect_histogram_local, 0);
+        remote_health_outcome(largs, remote_index, 0);
+        remote_backoff_outcome(largs, remote_index, tk_now(TK_A), 0);
+        if(!largs->params.message_marker)
+            remote_health_latency(largs, remote_index, 0.0);
+    }
+
+    /*
+     * Print the src/dst for a connection if verbosity level is high enough.
+     */
+    if(largs->params.verbosity_level >= DBG_DETAIL) {
+        char srcaddr_buf[INET6_ADDRSTRLEN + 64];
+        char dstaddr_buf[INET6_ADDRSTRLEN + 64];
+        struct sockaddr_storage srcaddr;
+        socklen_t addrlen = sizeof(srcaddr);
+        if(getsockname(sockfd, (struct sockaddr *)&srcaddr, &addrlen) == 0) {
+            DEBUG(DBG_DETAIL, "Connection %s -> %s opened as %d\n",
+                  format_sockaddr(&srcaddr, srcaddr_buf, sizeof(srcaddr_buf)),
+                  format_sockaddr(ss, dstaddr_buf, sizeof(dstaddr_buf)),
+                  sockfd);
+        } else {
+            DEBUG(DBG_WARNING, "Can't getsockname(%d): %s", sockfd,
+                  strerror(errno));
+        }
+    }
+
+    struct connection *conn = connection_new(largs);
+    conn->cold->remote_index = remote_index;
+    conn->cold->connection_unique_id = unique_id;
+    if(largs->remote_outstanding) largs->remote_outstanding[remote_index]++;
+    if(quota && quota->max_connections) atomic_increment(&quota_state->open);
+    if(group) {
+        conn->cold->group = group_index + 1;
+        largs->group_stats[group_index].open++;
+    }
+    TK_PROBE3(conn_open, sockfd, remote_index, unique_id);
+    common_connection_init(TK_A_ conn, CONN_OUTGOING, conn_state, sockfd);
+    conn->fastopen = fastopen;
+    connection_io_stream(TK_A_ conn);
+    if(largs->params.mirror_addresses.n_addrs) mirror_open(TK_A_ conn);
+}
+
+/*
+ * A destination is not used if it is retired by --dns-refresh,
+ * if it is known to be broken, during its --connect-backoff,
+ * or while it is out of its host:port@rate=,max= quota.
+ */
+static int
+remote_usable(void *opaque, size_t off) {
+    struct loop_arguments *largs = opaque;
+    const struct dns_refresh *dns = largs->params.dns_refresh;
+    struct remote_stats *rs = &largs->remote_stats[off];
+
+    if(dns && dns_refresh_retired(dns, off)) {
+        return 0;
+    } else if(remote_backing_off(largs, off)) {
+        return 0;
+    } else if(remote_quota_wait(largs, off) > 0.0) {
+        return 0;
+    } else if(atomic_get(&rs->connection_attempts) > 10
+              && atomic_get(&rs->connection_failures)
+                     == atomic_get(&rs->connection_attempts)) {
+        return 0;
+    } else {
+        return 1;
+    }
+}
+
+/*
+ * Pick an address according to the --remote-select strategy, skipping
+ * certainly broken ones. The (key) is the connection.uid for RSEL_HASH.
+ */
+static struct sockaddr_storage *
+pick_remote_address(struct loop_arguments *largs, uint32_t key,
+                    size_t *remote_index) {
+    const struct dns_refresh *dns = largs->params.dns_refresh;
+
+    /* Adopt the destinations added by --dns-refresh. */
+    if(dns) largs->params.remote_addresses.n_addrs = dns_refresh_count(dns);
+
+    /* The trailing target= destinations are only used by their groups. */
+    size_t n_addrs =
+        largs->params.remote_addresses.n_addrs - largs->params.group_remotes;
+    size_t off = (size_t)-1;
+
+    switch(largs->params.remote_select) {
+    case RSEL_ROUND_ROBIN:
+        break;
+    case RSEL_WEIGHTED:
+        for(size_t attempts = 0; attempts < n_addrs; attempts++) {
+            size_t t = balance_alias_pick(largs->params.remote_alias,
+                                          pcg32_random_r(&largs->rng),
+                                          pcg32_random_r(&largs->rng));
+            if(remote_usable(largs, t)) {
+                off = t;
+                break;
+            }
+        }
+        break;
+    case RSEL_HASH:
+        off = balance_ring_pick(largs->params.remote_ring, key, remote_usable,
+                                largs);
+        break;
+    case RSEL_LEAST_CONN:
+    case RSEL_LEAST_LATENCY:
+        /* The power of two choices: the better one of two random ones. */
+        if(n_addrs > 1) {
+            size_t a = pcg32_boundedrand_r(&largs->rng, n_addrs);
+            size_t b = pcg32_boundedrand_r(&largs->rng, n_addrs - 1);
+            if(b >= a) b++;
+            int a_usable = remote_usable(largs, a);
+            int b_usable = remote_usable(largs, b);
+            if(a_usable && b_usable) {
+                int b_better =
+                    largs->remote_outstanding
+                        ? largs->remote_outstanding[b]
+                              < largs->remote_outstanding[a]
+                        : remote_health_cost(largs, b)
+                              < remote_health_cost(largs, a);
+                off = b_better ? b : a;
+            } else if(a_usable) {
+                off = a;
+            } else if(b_usable) {
+                off = b;
+            }
+        }
+        break;
+    }
+
+    /*
+     * Go round-robin. If it is known that a particular destination
+     * is broken, choose the working one right away.
+     */
+    if(off == (size_t)-1) {
+        off = 0;
+        for(size_t attempts = 0; attempts < n_addrs; attempts++) {
+            off = largs->address_offset++ % n_addrs;
+            if(remote_usable(largs, off)) break;
+        }
+    }
+
+    *remote_index = off;
+    return &largs->params.remote_addresses.addrs[off];
+}
+
+/*
+ * Go round-robin over the target= destinations of a --connection-group,
+ * skipping the certainly broken ones.
+ */
+static struct sockaddr_storage *
+pick_group_remote_address(struct loop_arguments *largs, size_t group_index,
+                          size_t *remote_index) {
+    const struct connection_group *group = &largs->params.groups[group_index];
+    struct group_stats *gs = &largs->group_stats[group_index];
+    size_t off = group->remote_first;
+
+    for(size_t attempts = 0; attempts < group->remote_count; attempts++) {
+        off = group->remote_first + gs->address_offset++ % group->remote_count;
+        if(remote_usable(largs, off)) break;
+    }
+
+    *remote_index = off;
+    return &largs->params.remote_addresses.addrs[off];
+}
+
+/*
+ * The --mirror twin of an outgoing connection. What the connection
+ * writes is queued here and sent to the --mirror target at the twin's
+ * own pace; what comes back is read and thrown away. A twin more than
+ * MIRROR_QUEUE_MAX behind holds its connection back, see mirror_room().
+ */
+struct connection_mirror {
+    tk_io watcher;
+    struct connection *conn; /* Whose data is mirrored */
+    struct sockaddr_storage *remote;
+    uint8_t *buf; /* The bytes [head, tail) are yet to be sent */
+    size_t head;
+    size_t tail;
+    size_t size; /* Of the (buf) */
+    int connected;
+};
+
+/*
+ * --mirror: open the twin of the connection just started. The twin
+ * which cannot be opened is counted as failed, and the connection
+ * goes on without it.
+ */
+static void
+mirror_open(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    const struct addresses *mirrors = &largs->params.mirror_addresses;
+    struct sockaddr_storage *ss =
+        &mirrors->addrs[largs->worker_connections_initiated
+                        % mirrors->n_addrs];
+
+    int sockfd = outgoing_socket(largs, ss->ss_family);
+    if(sockfd != -1
+       && tk_connect(sockfd, (struct sockaddr *)ss, sockaddr_len(ss)) == -1
+       && errno != EINPROGRESS) {
+        int saved_errno = errno;
+        close(sockfd);
+        sockfd = -1;
+        errno = saved_errno;
+    }
+    if(sockfd == -1) {
+        char buf[INET6_ADDRSTRLEN + 64];
+        atomic_increment(&largs->mirrors_failed);
+        if(atomic_get(&largs->mirrors_failed) == 1) {
+            DEBUG(DBG_WARNING, "Mirror connection to %s is not done: %s\n",
+                  format_sockaddr(ss, buf, sizeof(buf)), strerror(errno));
+        }
+        return;
+    }
+
+    struct connection_mirror *m = calloc(1, sizeof(*m));
+    assert(m);
+    m->conn = conn;
+    m->remote = ss;
+    conn->cold->mirror = m;
+#ifdef USE_LIBUV
+    uv_poll_init(TK_A_ & m->watcher, sockfd);
+    uv_poll_start(&m->watcher, TK_READ | TK_WRITE, mirror_cb_uv);
+#else
+    ev_io_init(&m->watcher, mirror_cb, sockfd, TK_READ | TK_WRITE);
+    ev_io_start(TK_A_ & m->watcher);
+#endif
+}
+
+/*
+ * Wait for writing while connecting or while there is data to send.
+ */
+static void
+mirror_update_interest(TK_P_ struct connection_mirror *m) {
+    int events =
+        TK_READ | (!m->connected || m->tail > m->head ? TK_WRITE : 0);
+#ifdef USE_LIBUV
+    (void)loop;
+    uv_poll_start(&m->watcher, events, mirror_cb_uv);
+#else
+    if((m->watcher.events & (TK_READ | TK_WRITE)) == events) return;
+    ev_io_stop(TK_A_ & m->watcher);
+    ev_io_set(&m->watcher, m->watcher.fd, events);
+    ev_io_start(TK_A_ & m->watcher);
+#endif
+}
+
+/*
+ * The most the connection may write now for its twin to keep up.
+ */
+static size_t
+mirror_room(const struct connection_mirror *m) {
+    return MIRROR_QUEUE_MAX - (m->tail - m->head);
+}
+
+/*
+ * Send out what is queued, as much as the socket takes.
+ * Returns -1 if the twin is broken.
+ */
+static int
+mirror_send(struct loop_arguments *largs, struct connection_mirror *m) {
+    while(m->connected && m->tail > m->head) {
+        ssize_t wrote = tk_write(tk_fd(&m->watcher), m->buf + m->head,
+                                 m->tail - m->head);
+        if(wrote == -1) {
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN) break;
+            return -1;
+        }
+        m->head += wrote;
+        atomic_add(&largs->mirror_bytes_sent, wrote);
+    }
+    if(m->head == m->tail) m->head = m->tail = 0;
+    return 0;
+}
+
+static void
+mirror_free_by_handle(tk_io *w) {
+    struct connection_mirror *m =
+        (struct connection_mirror *)((char *)w
+                                     - offsetof(struct connection_mirror,
+                                                watcher));
+    free(m->buf);
+    free(m);
+}
+
+/*
+ * Close the twin along with its connection, sending what it can
+ * of the data still queued.
+ */
+static void
+mirror_close(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct connection_mirror *m = conn->cold->mirror;
+    conn->cold->mirror = NULL;
+
+    tk_io_stop(TK_A, &m->watcher);
+    (void)mirror_send(largs, m);
+    if(m->tail > m->head)
+        atomic_add(&largs->mirror_bytes_dropped, m->tail - m->head);
+    tk_close(&m->watcher, mirror_free_by_handle);
+}
+
+/*
+ * The twin could not connect, or the --mirror target broke it off:
+ * the connection goes on by itself.
+ */
+static void
+mirror_fail(TK_P_ struct connection *conn, const char *reason) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    char buf[INET6_ADDRSTRLEN + 64];
+
+    atomic_increment(&largs->mirrors_failed);
+    if(atomic_get(&largs->mirrors_failed) == 1) {
+        DEBUG(DBG_WARNING, "Mirror connection to %s is lost: %s\n",
+              format_sockaddr(conn->cold->mirror->remote, buf, sizeof(buf)),
+              reason);
+    }
+    mirror_close(TK_A_ conn);
+    if(conn->conn_wish & CW_WRITE_MIRRORED) {
+        conn->conn_wish &= ~CW_WRITE_MIRRORED;
+        update_io_interest(TK_A_ conn);
+    }
+}
+
+/*
+ * Queue the (size) bytes the connection has just written from the
+ * (iov) for its twin, and send them on right away if the twin keeps up.
+ * The writers stay within the mirror_room().
+ */
+static void
+mirror_queue(TK_P_ struct connection *conn, const struct iovec *iov,
+             size_t size) {
+    struct connection_mirror *m = conn->cold->mirror;
+    assert(size <= mirror_room(m));
+
+    if(m->size - m->tail < size) {
+        memmove(m->buf, m->buf + m->head, m->tail - m->head);
+        m->tail -= m->head;
+        m->head = 0;
+        size_t new_size = m->size ? m->size : MIRROR_QUEUE_MIN;
+        while(new_size - m->tail < size) new_size *= 2;
+        if(new_size != m->size) {
+            m->buf = realloc(m->buf, new_size);
+            assert(m->buf);
+            m->size = new_size;
+        }
+    }
+    for(size_t i = 0; size; i++) {
+        size_t n = iov[i].iov_len < size ? iov[i].iov_len : size;
+        memcpy(m->buf + m->tail, iov[i].iov_base, n);
+        m->tail += n;
+        size -= n;
+    }
+
+    if(mirror_send(tk_userdata(TK_A), m) == -1)
+        mirror_fail(TK_A_ conn, strerror(errno));
+    else
+        mirror_update_interest(TK_A_ m);
+}
+
+static void
+mirror_cb(TK_P_ tk_io *w, int revents) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct connection_mirror *m =
+        (struct connection_mirror *)((char *)w
+                                     - offsetof(struct connection_mirror,
+                                                watcher));
+    struct connection *conn = m->conn;
+
+    if(!m->connected) {
+        int so_error = 0;
+        socklen_t so_error_len = sizeof(so_error);
+        if(getsockopt(tk_fd(w), SOL_SOCKET, SO_ERROR, &so_error,
+                      &so_error_len)
+           == -1)
+            so_error = errno;
+        if(so_error) {
+            mirror_fail(TK_A_ conn, strerror(so_error));
+            return;
+        }
+        if(!(revents & TK_WRITE)) return;
+        m->connected = 1;
+        atomic_increment(&largs->mirrors_opened);
+    }
+
+    if(revents & TK_READ) {
+        char buf[16384];
+        ssize_t rd = tk_read(tk_fd(w), buf, sizeof(buf));
+        if(rd > 0) {
+            atomic_add(&largs->mirror_bytes_rcvd, rd);
+        } else if(rd == 0) {
+            mirror_fail(TK_A_ conn, "closed by the peer");
+            return;
+        } else if(errno != EAGAIN && errno != EINTR) {
+            mirror_fail(TK_A_ conn, strerror(errno));
+            return;
+        }
+    }
+
+    if(mirror_send(largs, m) == -1) {
+        mirror_fail(TK_A_ conn, strerror(errno));
+        return;
+    }
+    mirror_update_interest(TK_A_ m);
+
+    /* Caught up enough for the connection to write again. */
+    if((conn->conn_wish & CW_WRITE_MIRRORED)
+       && mirror_room(m) >= MIRROR_QUEUE_MAX / 2) {
+        conn->conn_wish &= ~CW_WRITE_MIRRORED;
+        update_io_interest(TK_A_ conn);
+    }
+}
+
+/*
+ * --keepalive-message: the connection has no data (left) to send,
+ * so its timer is free to schedule the keepalives.
+ */
+static int
+connection_idle(const struct connection *conn) {
+    return conn->data.total_size == conn->data.once_size
+           && (size_t)conn->write_offset == conn->data.total_size;
+}
+
+static void
+keepalive_start(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    if(!largs->keepalive_size || conn->conn_type != CONN_OUTGOING
+       || tk_wheel_active(&conn->timer))
+        return;
+    /* Spread the connections' keepalives over the interval. */
+    timer_wheel_schedule(TK_A_ & conn->timer,
+                         largs->params.keepalive_interval
+                             * ldexp(pcg32_random_r(&largs->rng), -32));
+}
+
+/*
+ * Write the --keepalive-message evaluated for this worker, bypassing
+ * the pacing and the rest of the write path, then wait for the next one.
+ */
+static void
+keepalive_send(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    size_t offset = conn->cold->keepalive_sent;
+    double delay = largs->params.keepalive_interval;
+    size_t size = largs->keepalive_size - offset;
+    if(conn->cold->mirror && size > mirror_room(conn->cold->mirror))
+        size = mirror_room(conn->cold->mirror);
+    ssize_t wrote =
+        size ? tk_write(tk_fd(&conn->watcher), largs->keepalive_data + offset,
+                        size)
+             : 0;
+    if(wrote > 0) {
+        conn->traffic_ongoing.num_writes++;
+        conn->traffic_ongoing.bytes_sent += wrote;
+        connection_stats_dirty(largs, conn);
+        if(conn->cold->mirror) {
+            struct iovec iov = {
+                .iov_base = (void *)(largs->keepalive_data + offset),
+                .iov_len = wrote};
+            mirror_queue(TK_A_ conn, &iov, wrote);
+        }
+        offset += wrote;
+    } else if(wrote == -1 && errno != EAGAIN && errno != EINTR) {
+        char buf[INET6_ADDRSTRLEN + 64];
+        DEBUG(DBG_WARNING, "Connection reset by %s\n",
+              format_sockaddr(&largs->params.remote_addresses
+                                   .addrs[conn->cold->remote_index],
+                              buf, sizeof(buf)));
+        close_connection(TK_A_ conn, CCR_REMOTE);
+        return;
+    }
+    if(offset == largs->keepalive_size) {
+        conn->cold->keepalive_sent = 0;
+    } else {
+        /* The rest of the message goes out on the next tick. */
+        conn->cold->keepalive_sent = offset;
+        delay = 0.0;
+    }
+    timer_wheel_schedule(TK_A_ & conn->timer, delay);
+}
+
+/*
+ * --slow-send: write the next byte, then wait on the timer wheel for the
+ * turn of the following one. The data is shared between the connections,
+ * so each only keeps its (write_offset) into it.
+ */
+static void
+slow_send_byte(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    const char *position = (const char *)conn->data.ptr + conn->write_offset;
+    ssize_t wrote =
+        conn->cold->mirror && !mirror_room(conn->cold->mirror)
+            ? 0
+            : tk_write(tk_fd(&conn->watcher), position, 1);
+    if(wrote == 1) {
+        if(conn->cold->mirror) {
+            struct iovec iov = {.iov_base = (void *)position, .iov_len = 1};
+            mirror_queue(TK_A_ conn, &iov, 1);
+        }
+        conn->write_offset++;
+        conn->traffic_ongoing.num_writes++;
+        conn->traffic_ongoing.bytes_sent++;
+        connection_stats_dirty(largs, conn);
+        if((size_t)conn->write_offset == conn->data.total_size) {
+            /* Only the header was there to send. Now, silence. */
+            if(conn->data.total_size == conn->data.once_size) {
+                keepalive_start(TK_A_ conn);
+                return;
+            }
+            conn->write_offset = conn->data.once_size;
+        }
+    } else if(wrote == -1 && errno != EAGAIN && errno != EINTR) {
+        char buf[INET6_ADDRSTRLEN + 64];
+        DEBUG(DBG_WARNING, "Connection reset by %s\n",
+              format_sockaddr(&largs->params.remote_addresses
+                                   .addrs[conn->cold->remote_index],
+                              buf, sizeof(buf)));
+        close_connection(TK_A_ conn, CCR_REMOTE);
+        return;
+    }
+    timer_wheel_schedule(TK_A_ & conn->timer, largs->params.slow_send);
+}
+
+/*
+ * Hand the established connection over to slow_send_byte(). The first
+ * bytes of the connections are spread over the interval at random.
+ */
+static void
+slow_send_start(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    conn->conn_wish &= ~CW_WRITE_INTEREST;
+    update_io_interest(TK_A_ conn);
+    timer_wheel_schedule(TK_A_ & conn->timer,
+                         largs->params.slow_send
+                             * ldexp(pcg32_random_r(&largs->rng), -32));
+}
+
+static void
+conn_timer_cb(struct tk_wheel *wheel, struct tk_wheel_entry *e) {
+    TK_P = wheel->userdata;
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct connection *conn =
+        (struct connection *)((char *)e - offsetof(struct connection, timer));
+
+    switch(conn->conn_state) {
+    case CSTATE_CONNECTED:
+        switch(conn->conn_type) {
+        case CONN_INCOMING:
+            if((largs->params.listen_mode & _LMODE_SND_MASK) == 0) {
+                conn->conn_wish &=
+                    ~(CW_READ_BLOCKED | CW_WRITE_BLOCKED | CW_WRITE_DELAYED);
+                update_io_interest(TK_A_ conn);
+                break;
+            }
+        /* Fall through */
+        case CONN_OUTGOING: {
+            if(largs->keepalive_size && conn->conn_type == CONN_OUTGOING
+               && connection_idle(conn)) {
+                keepalive_send(TK_A_ conn);
+                break;
+            }
+            if(largs->params.slow_send > 0.0
+               && conn->conn_type == CONN_OUTGOING) {
+                slow_send_byte(TK_A_ conn);
+                break;
+            }
+            if(conn->conn_wish & CW_WRITE_DELAYED) {
+                /* Reinitialize the upstream bandwidth limit */
+                send_pace_init(tk_userdata(TK_A), conn, tk_now(TK_A));
+            }
+            /*
+             * The connection waited for its pace while the socket
+             * was most likely writable all along: write now rather
+             * than arm the write interest and wait for the poller.
+             * The whole timer wheel tick is serviced this way.
+             */
+            int write_now = (conn->conn_wish & CW_WRITE_BLOCKED)
+                            && (conn->conn_wish & CW_WRITE_INTEREST)
+                            && !(conn->conn_wish
+                                 & (CW_WRITE_ZEROCOPY | CW_WRITE_PIPELINED
+                                    | CW_WRITE_MIRRORED))
+                            && !conn->echo;
+            if(write_now && largs->params.send_budget) {
+                conn->conn_wish &= ~(CW_READ_BLOCKED | CW_WRITE_DELAYED);
+                update_io_interest(TK_A_ conn);
+                send_queue_push(TK_A_ conn);
+                break;
+            }
+            conn->conn_wish &=
+                ~(CW_READ_BLOCKED | CW_WRITE_BLOCKED | CW_WRITE_DELAYED);
+            update_io_interest(TK_A_ conn);
+            if(write_now) connection_cb(TK_A_ & conn->watcher, TK_WRITE);
+        } break;
+        case CONN_ACCEPTOR:
+            assert(conn->conn_type != CONN_ACCEPTOR);
+            break;
+        }
+        break;
+    case CSTATE_CONNECTING:
+        /* Timed out in the connection establishment phase. */
+        close_connection(TK_A_ conn, CCR_TIMEOUT);
+        return;
+    }
+}
+
+/*
+ * Check whether we have configured an extended (e.g., non-zero), but
+ * finite channel lifetime. Zero channel lifetime is managed differently:
+ * the channel closes right after we figure out that the connection took place.
+ */
+static int
+limit_channel_lifetime(struct loop_arguments *largs,
+                       const struct connection_group *group) {
+    double lifetime =
+        group ? group->channel_lifetime : largs->params.channel_lifetime;
+    return (lifetime != INFINITY && lifetime > 0.0);
+}
+
+/*
+ * If we're not dumping something on a main thread, and we need
+ * to keep dumping some connection, enable data dumping for that connection.
+ */
+static void
+maybe_enable_dump(struct loop_arguments *largs, enum conn_type ctype, int fd) {
+    /*
+     * Enable dumping only on main (first) worker.
+     * It spares us from too much coordination over
+     * which worker's channel should get its data dumped.
+     */
+    const int main_thread = (largs->thread_no == 0);
+
+    if(main_thread
+       /* DS_DUMP_ALL is handled differently */
+       && (largs->params.dump_setting & DS_DUMP_ONE)
+       && largs->dump_connect_fd == 0
+       /*
+        * In case tcpkali acts as both client and listener (-l), we only dump
+        * client-side connections.
+        */
+       && (ctype == CONN_OUTGOING
+           || largs->params.remote_addresses.n_addrs == 0)) {
+        /*
+         * Enable dumping on a chosen file descriptor.
+         */
+        largs->dump_connect_fd = fd;
+    }
+}
+
+
+static void
+connection_timer_refresh(TK_P_ struct connection *conn, double delay) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+
+    tk_wheel_remove(&largs->timer_wheel, &conn->timer);
+
+    switch(conn->conn_state) {
+    case CSTATE_CONNECTED:
+        /* Use the supplied delay */
+        break;
+    case CSTATE_CONNECTING:
+        delay = largs->params.connect_timeout;
+        break;
+    }
+
+    if(delay > 0.0) {
+        timer_wheel_schedule(TK_A_ & conn->timer, delay);
+    }
+}
+
+/*
+ * Initialize common connection parameters.
+ */
+/*
+ * The messages expected to be in flight at once, to size the send
+ * timestamp rings with: those sent at the (rate) over a round trip of
+ * about TS_RING_RTT_GUESS. A ring grows in ts_ring_make_room() when more
+ * are in flight. Sizing it by what the socket buffers could hold instead
+ * takes megabytes per connection with the short messages.
+ */
+#define TS_RING_RTT_GUESS 0.1 /* s */
+#define TS_RING_EXPECTED_MAX 1024
+static size_t
+expected_messages_in_flight(rate_spec_t rate, size_t message_size) {
+    double per_second = 0.0;
+    switch(rate.value_base) {
+    case RS_UNLIMITED:
+        return TS_RING_EXPECTED_MAX; /* As fast as it goes */
+    case RS_BYTES_PER_SECOND:
+        per_second = rate.value / message_size;
+        break;
+    case RS_MESSAGES_PER_SECOND:
+        per_second = rate.value;
+        break;
+    }
+    double expected = per_second * TS_RING_RTT_GUESS;
+    return expected < TS_RING_EXPECTED_MAX ? (size_t)expected
+                                           : TS_RING_EXPECTED_MAX;
+}
+
+static struct ts_ring *
+take_ts_ring(struct loop_arguments *largs, size_t expected, double now) {
+    /* --idle-connections: start small, ts_ring_make_room() grows it. */
+    if(largs->params.idle_connections) expected = 0;
+    struct ts_ring *ring = tk_pool_take(&largs->pools.sent_timestamps);
+    if(ring)
+        ts_ring_reset(largs->huge_arena, ring, expected, now);
+    else
+        ring = ts_ring_new(largs->huge_arena, expected, now);
+    return ring;
+}
+
+static struct hdr_histogram *
+take_marker_histogram(struct loop_arguments *largs) {
+    struct hdr_histogram *h = tk_pool_take(&largs->pools.marker_histograms);
+    if(h)
+        hdr_reset(h);
+    else
+        h = hdr_init_similar(largs->marker_histogram_local);
+    return h;
+}
+
+/*
+ * The interval until the next event of a Poisson process.
+ */
+static double
+exponential_interval(pcg32_random_t *rng, double events_per_second) {
+    /* -ln(U)/rate, where U is uniformly distributed in (0, 1]. */
+    double u = (pcg32_random_r(rng) + 1.0) / 4294967296.0;
+    return -log(u) / events_per_second;
+}
+
+/*
+ * The lifetime of a new connection, averaging to (lifetime),
+ * see --channel-lifetime-distribution.
+ */
+static double
+channel_lifetime_sample(struct loop_arguments *largs, double lifetime) {
+    double u = (pcg32_random_r(&largs->rng) + 1.0) / 4294967296.0;
+    switch(largs->params.lifetime_distribution.kind) {
+    case LIFETIME_DIST_FIXED:
+        break;
+    case LIFETIME_DIST_UNIFORM:
+        return 2 * lifetime * u;
+    case LIFETIME_DIST_EXPONENTIAL:
+        return exponential_interval(&largs->rng, 1.0 / lifetime);
+    case LIFETIME_DIST_LOGNORMAL: {
+        /* Box-Muller; mu is chosen for the mean to be the (lifetime). */
+        double sigma = largs->params.lifetime_distribution.sigma;
+        double v = ldexp(pcg32_random_r(&largs->rng), -32);
+        double z = sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+        return lifetime * exp(sigma * z - sigma * sigma / 2);
+    }
+    }
+    return lifetime;
+}
+
+/*
+ * Whether the whole messages are released at random intervals,
+ * see --message-arrival.
+ */
+static int
+send_arrivals_enabled(struct loop_arguments *largs, struct connection *conn) {
+    return largs->params.message_arrival == ARRIVAL_POISSON
+           && largs->params.channel_send_rate.value_base
+                  == RS_MESSAGES_PER_SECOND
+           && largs->params.channel_send_rate.value > 0.0
+           && conn->avg_message_size > 0;
+}
+
+/*
+ * A random share [0..fraction) of the time it takes to send a message
+ * at the connection's pace, see --message-rate-jitter.
+ */
+static double
+send_jitter_interval(struct loop_arguments *largs, struct connection *conn,
+                     double fraction) {
+    size_t msgsize = conn->avg_message_size ? conn->avg_message_size
+                                            : conn->send_limit.minimal_move_size;
+    double interval = msgsize / conn->send_limit.bytes_per_second;
+    return fraction * interval * ldexp(pcg32_random_r(&largs->rng), -32);
+}
+
+/*
+ * Size the upstream pacefier bucket by the --burst and --catch-up,
+ * leaving room for a whole message at least, or it would never be sent.
+ */
+static void
+send_pace_burst(struct loop_arguments *largs, struct connection *conn) {
+    struct pacefier *pace = &conn->send_pace;
+    double burst = largs->params.send_burst;
+    if(connection_send_rate(largs, conn).value_base == RS_MESSAGES_PER_SECOND)
+        burst *= conn->avg_message_size;
+    pacefier_set_burst(pace, burst, largs->params.send_catchup);
+    if(pace->events_per_second > 0.0
+       && pacefier_burst_seconds(pace) * pace->events_per_second
+              < conn->send_limit.minimal_move_size)
+        pace->burst_events = conn->send_limit.minimal_move_size;
+}
+
+/*
+ * (Re)start pacing the upstream data. Along with the pacefier, which
+ * forgives the pace it could not keep up with, we maintain the intended
+ * send schedule, see --latency-correction.
+ */
+static void
+send_pace_init(struct loop_arguments *largs, struct connection *conn,
+               double now) {
+    /*
+     * The connections opened together would otherwise send in lockstep.
+     * Start each one at a random phase of its message interval.
+     */
+    if(largs->params.send_phase_jitter
+       && conn->send_limit.bytes_per_second > 0.0)
+        now += send_jitter_interval(largs, conn, 1.0);
+    pacefier_init(&conn->send_pace, conn->send_limit.bytes_per_second, now);
+    send_pace_burst(largs, conn);
+    conn->send_schedule_ts = now;
+    conn->send_arrived_bytes = 0;
+    conn->send_jitter = 0.0;
+    if(send_arrivals_enabled(largs, conn)) {
+        conn->send_next_arrival_ts =
+            now + exponential_interval(&largs->rng,
+                                       largs->params.channel_send_rate.value);
+    }
+}
+
+/*
+ * Account for the data which has been sent under the pace.
+ */
+static void
+send_pace_moved(struct loop_arguments *largs, struct connection *conn,
+                size_t wrote, double now) {
+    if(largs->params.rate_scope == RATE_SCOPE_TOTAL) {
+        largs->send_budget_tokens -=
+            largs->params.channel_send_rate.value_base
+                    == RS_MESSAGES_PER_SECOND
+                ? (double)wrote / conn->avg_message_size
+                : (double)wrote;
+    } else if(send_arrivals_enabled(largs, conn)) {
+        conn->send_arrived_bytes -= wrote < conn->send_arrived_bytes
+                                        ? wrote
+                                        : conn->send_arrived_bytes;
+    } else {
+        pacefier_moved(&conn->send_pace, wrote, now);
+        if(largs->params.send_interval_jitter > 0.0) {
+            /* Shift the pace by a new random offset, not accumulating. */
+            double jitter = send_jitter_interval(
+                largs, conn, largs->params.send_interval_jitter);
+            conn->send_pace.previous_ts += jitter - conn->send_jitter;
+            conn->send_schedule_ts += jitter - conn->send_jitter;
+            conn->send_jitter = jitter;
+        }
+    }
+    conn->send_schedule_ts += wrote / conn->send_limit.bytes_per_second;
+    if(conn->send_limit.bytes_per_second > 0.0
+       && now - conn->send_schedule_ts > largs->loop_local.pacing_debt)
+        largs->loop_local.pacing_debt = now - conn->send_schedule_ts;
+}
+
+/*
+ * The time the next byte was intended to be sent at, if the connection
+ * had kept up with its --message-rate or --channel-bandwidth-upstream.
+ */
+static double
+send_intended_ts(struct connection *conn, double now) {
+    if(conn->send_limit.bytes_per_second <= 0.0
+       || conn->send_schedule_ts > now)
+        return now;
+    return conn->send_schedule_ts;
+}
+
+/*
+ * With --kernel-pacing, the kernel spreads the upstream data over time,
+ * and the user space limit only keeps that much data queued ahead,
+ * waking up the connection once per that interval.
+ */
+#define KERNEL_PACING_AHEAD 0.1 /* s */
+
+/*
+ * Hand the upstream --channel-bandwidth-upstream or --message-rate limit
+ * over to the kernel, see --kernel-pacing. The --rate-scope=total and
+ * the --message-arrivals=poisson limits are left to the user space.
+ */
+static void
+update_kernel_pacing(struct loop_arguments *largs, struct connection *conn,
+                     int UNUSED fd) {
+#ifdef SO_MAX_PACING_RATE
+    double bw = conn->send_limit.bytes_per_second;
+    int pace = largs->params.kernel_pacing && bw > 0.0 && bw < UINT32_MAX
+               && largs->params.rate_scope != RATE_SCOPE_TOTAL
+               && !send_arrivals_enabled(largs, conn);
+    if(!pace && !conn->kernel_paced) return;
+
+    unsigned int rate = pace ? (unsigned int)bw : ~0U; /* ~0U: unlimited */
+    if(setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate))
+       == 0) {
+        conn->kernel_paced = pace;
+    } else {
+        conn->kernel_paced = 0;
+    }
+#else
+    (void)largs;
+    (void)conn;
+#endif
+}
+
+/*
+ * The --latency-by-size class of the messages of (size) bytes.
+ */
+static unsigned
+message_size_class(size_t size) {
+    unsigned class = 0;
+    for(size_t limit = MESSAGE_SIZE_CLASS_MIN;
+        size > limit && class < MESSAGE_SIZE_CLASSES - 1; limit *= 4)
+        class++;
+    return class;
+}
+
+/*
+ * Prepare the data the connection is going to send: the messages of its
+ * --connection-group, or the --message, unless replaced by SetMessage.
+ */
+static void
+connection_take_messages(struct loop_arguments *largs,
+                         struct connection *conn) {
+    const struct connection_group *group = connection_group(largs, conn);
+
+    /*
+     * The collection is shared by all the connections, which evaluate
+     * its expressions without changing them. It is kept with the engine
+     * until the workers are gone, so it needs no reference counting.
+     */
+    struct message_collection *mc;
+    struct transport_data_spec *const *data_templates;
+    conn->cold->message_set = largs->message_set;
+    if(group && (group->own_messages || !largs->message_set)) {
+        mc = (struct message_collection *)&group->message_collection;
+        data_templates = group->data_templates;
+    } else if(largs->message_set) {
+        struct message_set *set = largs->message_sets[largs->message_set - 1];
+        mc = &set->message_collection;
+        data_templates = set->data_templates;
+    } else {
+        mc = &largs->params.message_collection;
+        data_templates = largs->params.data_templates;
+    }
+    enum transport_websocket_side tws_side =
+        (conn->conn_type == CONN_OUTGOING) ? TWS_SIDE_CLIENT : TWS_SIDE_SERVER;
+    int replayed = conn->conn_type == CONN_OUTGOING && largs->params.replay;
+    int cached = mc->most_dynamic_expression != DS_GLOBAL_FIXED && !replayed
+                 && !largs->params.corpus
+                 && data_template_cache_take(largs, conn, mc, tws_side);
+    conn->cold->message_collection = mc;
+    if(replayed) {
+        replay_stream_take(largs, conn);
+    } else if(largs->params.corpus) {
+        corpus_take(largs, conn);
+    } else if(!cached) {
+        explode_data_template(mc, data_templates, tws_side, &conn->data,
+                              largs, conn);
+    }
+    if(largs->payload_generator
+       && mc->most_dynamic_expression == DS_PER_MESSAGE) {
+        conn->cold->payload_job = payload_job_new(largs, conn, tws_side);
+        payload_job_submit(largs->payload_generator, conn->cold->payload_job);
+    }
+    enum websocket_side ws_side =
+        (tws_side == TWS_SIDE_CLIENT) ? WS_SIDE_CLIENT : WS_SIDE_SERVER;
+    if(conn->http2_frames) {
+        http2_frame_requests(largs, conn);
+        conn->avg_message_size = conn->data.single_message_size;
+    } else if(conn->mqtt_packets) {
+        mqtt_frame_messages(largs, conn);
+        conn->avg_message_size = conn->data.single_message_size;
+    } else if(conn->resp_replies && conn->data.single_message_size) {
+        /* The commands are counted by their replies, size them exactly. */
+        conn->avg_message_size = conn->data.single_message_size;
+    } else if(largs->params.corpus) {
+        /* The corpus messages vary in size, count them on average. */
+        conn->avg_message_size = conn->data.single_message_size;
+    } else {
+        conn->avg_message_size = message_collection_estimate_size(
+            mc, MSK_PURPOSE_MESSAGE,
+            MSK_PURPOSE_MESSAGE, MCE_AVERAGE_SIZE, ws_side,
+            largs->params.websocket_enable);
+    }
+    /*
+     * The expressions are sized as they are exploded. All the timestamps
+     * in the (sent_timestamps) ring are of the messages of this size.
+     */
+    if(largs->params.latency_by_size)
+        conn->cold->latency.size_class = message_size_class(
+            conn->data.single_message_size ? conn->data.single_message_size
+                                           : conn->avg_message_size);
+}
+
+/*
+ * Take the spare payload back from the generator and free it.
+ */
+static void
+connection_drop_payload_job(struct loop_arguments *largs,
+                            struct connection *conn) {
+    if(!conn->cold->payload_job) return;
+    (void)payload_job_collect(largs->payload_generator,
+                              conn->cold->payload_job);
+    free(conn->cold->payload_job->spec.ptr);
+    free(conn->cold->payload_job->spec.marker_offsets);
+    free(conn->cold->payload_job->spec.slots);
+    free(conn->cold->payload_job);
+    conn->cold->payload_job = NULL;
+}
+
+/*
+ * Whether the connection is done with its current round of messages,
+ * and can switch over to the other ones, see connection_switch_messages().
+ */
+static int
+connection_message_boundary(const struct connection *conn) {
+    const struct transport_data_spec *data = &conn->data;
+    size_t offset = conn->write_offset;
+    if(conn->traffic_ongoing.bytes_sent < data->once_size
+       || offset < data->once_size)
+        return 0;
+    if(offset == data->total_size) return 1;
+    /* The replicated messages repeat every (single_message_size) bytes. */
+    return (data->flags & TDS_FLAG_REPLICATED) && data->single_message_size
+           && (offset - data->once_size) % data->single_message_size == 0;
+}
+
+/*
+ * Send the messages of the latest SetMessage from now on. Called at
+ * a message boundary, so no message is sent in part.
+ * Returns 1 if the connection's data has been replaced, to be sent
+ * past its (once_size).
+ */
+static int
+connection_switch_messages(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    const struct connection_group *group = connection_group(largs, conn);
+
+    if(group && group->own_messages) {
+        conn->cold->message_set = largs->message_set;
+        return 0;
+    }
+    /* The kernel still refers to the data sent with MSG_ZEROCOPY. */
+    if(conn->zerocopy.sent != conn->zerocopy.completed) return 0;
+
+    connection_drop_payload_job(largs, conn);
+    if(conn->data.ptr && !(conn->data.flags & TDS_FLAG_PTR_SHARED))
+        data_spec_free(largs, &conn->data);
+    memset(&conn->data, 0, sizeof(conn->data));
+
+    connection_take_messages(largs, conn);
+    if(!(conn->data.flags & TDS_FLAG_BODY_IN_FILE)) conn->sendfile_body = 0;
+    conn->cold->latency.marker_sequenced_upto = 0;
+    conn->cold->slots_sequenced_upto = 0;
+    /* The --message-rate is kept in messages, not bytes. */
+    connection_follow_send_rate(TK_A_ conn);
+    return 1;
+}
+
+/*
+ * Set up the data to send, its pacing and the latency measurement
+ * of the connection to be sent data over.
+ */
+static void
+connection_prepare_payload(TK_P_ struct connection *conn, int sockfd) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    double now = tk_now(TK_A);
+    /*
+     * If we're going to send data, establish bandwidth control for upstream.
+     */
+    int active_socket = conn->conn_type == CONN_OUTGOING
+                        || (largs->params.listen_mode & _LMODE_SND_MASK);
+    if(active_socket) {
+        connection_take_messages(largs, conn);
+        if(largs->params.rate_distribution.kind != RATE_DIST_NONE)
+            connection_rank_send_rate(largs, conn);
+        conn->send_rate_version = largs->send_rate_version;
+        conn->send_limit = compute_bandwidth_limit_by_message_size(
+            connection_send_rate(largs, conn), conn->avg_message_size);
+        send_pace_init(largs, conn, now);
+        update_kernel_pacing(largs, conn, sockfd);
+        if(largs->params.zerocopy) {
+            conn->zerocopy.enabled = enable_zerocopy(sockfd);
+        }
+        if(largs->params.sendfile
+           && (conn->data.flags & TDS_FLAG_BODY_IN_FILE)) {
+            conn->sendfile_body = 1;
+        }
+        if(largs->params.message_stop) {
+            conn->stop_scan = 1;
+            conn->stop_scan_state = 0;
+        }
+    }
+
+    /*
+     * The requests are answered one by one, see --pipeline. Without
+     * the protocol replies, the --framing frames or the latency markers
+     * coming back tell the answers.
+     */
+    if((conn->http_responses || conn->resp_replies
+        || (conn->http2_frames && !largs->params.grpc_stream)
+        || (conn->mqtt_packets && largs->params.mqtt_qos)
+        || (largs->params.pipeline && conn->conn_type == CONN_OUTGOING
+            && (conn->lenprefix_frames || conn->framer_responses
+                || largs->params.latency_marker_expr
+                || largs->params.message_marker)))
+       && conn->data.single_message_size)
+        conn->pipelined = 1;
+
+    /*
+     * Without the latency markers, the --http and --resp replies,
+     * the --mqtt PUBACKs, the --framing frames and the --framer responses
+     * end the messages.
+     */
+    if((conn->http_responses || conn->resp_replies || conn->lenprefix_frames
+        || conn->framer_responses
+        || (conn->mqtt_packets && largs->params.mqtt_qos))
+       && !largs->params.latency_marker_expr
+       && conn->data.single_message_size) {
+        conn->cold->latency.message_bytes_credit /* See (EXPL:1) below. */
+            = conn->data.single_message_size - 1;
+        size_t expected = expected_messages_in_flight(
+            connection_send_rate(largs, conn), conn->data.single_message_size);
+        conn->cold->latency.sent_timestamps =
+            take_ts_ring(largs, expected, now);
+        if(largs->params.latency_correction == LCM_BOTH)
+            conn->cold->latency.uncorrected_timestamps =
+                take_ts_ring(largs, expected, now);
+    }
+    if(largs->params.latency_marker_expr && (conn->data.single_message_size || largs->params.message_marker)) {
+        if(conn->data.single_message_size) {
+            conn->cold->latency.message_bytes_credit /* See (EXPL:1) below. */
+                = conn->data.single_message_size - 1;
+        }
+        /*
+         * Figure out how many latency markers to skip
+         * before starting to measure latency with them.
+         */
+        conn->cold->latency.lm_occurrences_skip =
+            largs->params.latency_marker_skip;
+
+        /*
+         * Initialize the Boyer-Moore-Horspool context for substring search.
+         */
+        if(EXPR_IS_TRIVIAL(largs->params.latency_marker_expr)) {
+            /* Shared search table and expression */
+            conn->cold->latency.sbmh_shared = 1;
+            conn->cold->latency.sbmh_occ = &largs->params.sbmh_shared_marker_occ;
+            conn->cold->latency.sbmh_data =
+                (uint8_t *)largs->params.latency_marker_expr->u.data.data;
+            conn->cold->latency.sbmh_size =
+                largs->params.latency_marker_expr->u.data.size;
+        } else {
+            /* The search table of the same marker string, if seen. */
+            char *marker;
+            size_t marker_size;
+            explode_string_expression(&marker, &marker_size,
+                                      largs->params.latency_marker_expr, largs,
+                                      conn);
+            struct marker_intern *mi =
+                marker_intern_take(largs, (uint8_t *)marker, marker_size);
+            free(marker);
+            conn->cold->latency.sbmh_shared = 0;
+            conn->cold->latency.sbmh_intern = mi;
+            conn->cold->latency.sbmh_occ = &mi->occ;
+            conn->cold->latency.sbmh_data = mi->data;
+            conn->cold->latency.sbmh_size = mi->size;
+        }
+        if(conn->cold->latency.sbmh_shared)
+            conn->cold->latency.sbmh_marker_ctx =
+                tk_pool_take(&largs->pools.sbmh_marker_ctxs);
+        if(!conn->cold->latency.sbmh_marker_ctx) {
+            conn->cold->latency.sbmh_marker_ctx =
+                malloc(SBMH_SIZE(conn->cold->latency.sbmh_size));
+            assert(conn->cold->latency.sbmh_marker_ctx);
+        }
+        /* The occurrence table is already built. */
+        sbmh_init(conn->cold->latency.sbmh_marker_ctx, NULL,
+                  conn->cold->latency.sbmh_data, conn->cold->latency.sbmh_size);
+
+        /*
+         * Initialize the latency histogram by copying out the template
+         * parameter from the loop arguments.
+         */
+        if(conn->data.single_message_size) {
+            size_t expected =
+                expected_messages_in_flight(connection_send_rate(largs, conn),
+                                            conn->data.single_message_size);
+            conn->cold->latency.sent_timestamps =
+                take_ts_ring(largs, expected, now);
+            if(largs->params.latency_correction == LCM_BOTH)
+                conn->cold->latency.uncorrected_timestamps =
+                    take_ts_ring(largs, expected, now);
+        }
+        if(conn->cold->latency.sent_timestamps
+           && largs->params.latency_timestamping != LTS_OFF) {
+            tstamp_enable(TK_A_ conn, sockfd);
+        }
+        /* With --idle-connections, see marker_histogram(). */
+        if(largs->params.latency_per_connection
+           && !largs->params.idle_connections) {
+            conn->cold->latency.marker_histogram =
+                take_marker_histogram(largs);
+            conn->cold->latency.marker_step = largs->marker_step;
+        }
+    }
+}
+
+/*
+ * --proxy-protocol: announce the client address to the server behind
+ * the balancer before anything else is sent over the established
+ * connection. The header fits into the empty socket buffer, so it is
+ * written at once.
+ */
+static int
+proxy_header_send(struct loop_arguments *largs, struct connection *conn,
+                  int sockfd) {
+    struct sockaddr_storage src;
+    const struct sockaddr_storage *dst =
+        &largs->params.remote_addresses.addrs[conn->cold->remote_index];
+    uint8_t buf[PROXY_HEADER_MAX];
+
+    if(largs->params.proxy_source.family) {
+        uint32_t random_bits[5];
+        for(size_t i = 0; i < 5; i++)
+            random_bits[i] = pcg32_random_r(&largs->rng);
+        proxy_source_pick(&largs->params.proxy_source, random_bits, &src);
+    } else {
+        socklen_t addrlen = sizeof(src);
+        if(getsockname(sockfd, (struct sockaddr *)&src, &addrlen) == -1)
+            memset(&src, 0, sizeof(src));
+    }
+
+    size_t size =
+        proxy_header_build(largs->params.proxy_protocol,
+                           (struct sockaddr *)&src, (struct sockaddr *)dst,
+                           buf);
+    ssize_t wrote = tk_write(sockfd, buf, size);
+    if(wrote != (ssize_t)size) {
+        DEBUG(DBG_DETAIL, "Can't send the PROXY header on %d: %s\n", sockfd,
+              wrote == -1 ? strerror(errno) : "short write");
+        return -1;
+    }
+    return 0;
+}
+
+static void
+common_connection_init(TK_P_ struct connection *conn, enum conn_type conn_type,
+                       enum conn_state conn_state, int sockfd) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+
+    conn->conn_type = conn_type;
+    conn->conn_state = conn_state;
+
+    maybe_enable_dump(largs, conn_type, sockfd);
+
+    double now = tk_now(TK_A);
+
+    conn->cold->latency.connection_initiated = now;
+    conn->bytes_leftovers = 0;
+    if(conn_type != CONN_ACCEPTOR && conn_state == CSTATE_CONNECTED) {
+        conn->traffic_ongoing.conns_opened++;
+        connection_stats_dirty(largs, conn);
+    }
+
+    tk_wheel_entry_init(&conn->timer, conn_timer_cb);
+    tk_wheel_entry_init(&conn->lifetime_timer, expire_channel_life);
+    conn->cold->expr_seed = pcg32_random_r(&largs->rng);
+    const struct connection_group *group = connection_group(largs, conn);
+    if(limit_channel_lifetime(largs, group)) {
+        double lifetime = group ? group->channel_lifetime
+                                : largs->params.channel_lifetime;
+        timer_wheel_schedule(TK_A_ & conn->lifetime_timer,
+                             channel_lifetime_sample(largs, lifetime));
+    }
+    TAILQ_INSERT_TAIL(&largs->open_conns, conn, hook);
+    if(conn_type == CONN_OUTGOING && largs->params.burst_every > 0.0)
+        burst_join(largs, conn);
+
+    /*
+     * Set up downstream bandwidth regardless of the type of connection.
+     */
+
+    conn->recv_limit = compute_bandwidth_limit(largs->params.channel_recv_rate);
+    pacefier_init(&conn->recv_pace, conn->recv_limit.bytes_per_second, now);
+
+    conn->cold->latency.marker_binary = largs->params.message_marker_binary;
+    conn->zerocopy_rx = largs->zerocopy_rx_size && conn_type != CONN_ACCEPTOR;
+
+    if(conn_type == CONN_OUTGOING && largs->params.verify_echo) {
+        conn->verify_echo = 1;
+        conn->cold->echo_verify = echo_verify_new();
+    }
+
+    /* The client skips the HTTP upgrade response, then parses the frames. */
+    if(conn_type == CONN_OUTGOING && largs->params.websocket_enable) {
+        conn->ws_frames = 1;
+        conn->cold->ws_parser.skip_http_response = 1;
+    }
+    if(conn_type == CONN_OUTGOING && largs->params.http_enable)
+        conn->http_responses = 1;
+    if(conn_type == CONN_OUTGOING && largs->params.http2_enable)
+        conn->http2_frames = 1;
+    if(conn_type == CONN_OUTGOING && largs->params.resp_enable)
+        conn->resp_replies = 1;
+    if(conn_type == CONN_OUTGOING && largs->params.mqtt_version) {
+        conn->mqtt_packets = 1;
+        conn->cold->mqtt.parser.v5 = largs->params.mqtt_version == MQTT_V5;
+    }
+    if(largs->params.framing_prefix_size) {
+        conn->lenprefix_frames = 1;
+        conn->cold->lenprefix_parser.prefix_size =
+            largs->params.framing_prefix_size;
+        conn->cold->lenprefix_parser.little_endian =
+            largs->params.framing_little_endian;
+    }
+    if(largs->params.framer) {
+        conn->framer_responses = 1;
+        if(largs->params.framer->state_size) {
+            conn->cold->framer_state =
+                calloc(1, largs->params.framer->state_size);
+            assert(conn->cold->framer_state);
+        }
+    }
+
+    /* The --record-sample of the connections has the data recorded. */
+    if(largs->record_ring
+       && (largs->params.record_sample >= 1.0
+           || pcg32_random_r(&largs->rng)
+                  < largs->params.record_sample * 4294967296.0)) {
+        conn->recorded = 1;
+        if(!conn->cold->connection_unique_id)
+            conn->cold->connection_unique_id = connection_uid_take(largs);
+    }
+
+    /*
+     * The outgoing connections take their messages once connected,
+     * not to waste the effort on the ones which fail to connect.
+     */
+    if(conn_state == CSTATE_CONNECTED)
+        connection_prepare_payload(TK_A_ conn, sockfd);
+
+    /*
+     * Catch connection timeout.
+     */
+    if(conn_state == CSTATE_CONNECTING
+       && largs->params.connect_timeout > 0.0) {
+        assert(conn_type == CONN_OUTGOING);
+        connection_timer_refresh(TK_A_ conn, 0.0);
+    }
+
+    /* The connection is writable once connected. */
+    int want_write =
+        conn->data.total_size || conn_state == CSTATE_CONNECTING;
+    conn->conn_wish = CW_READ_INTEREST | (want_write ? CW_WRITE_INTEREST : 0);
+
+    if(largs->params.websocket_enable) {
+        if(conn_type == CONN_OUTGOING) {
+            int want_events = TK_READ | TK_WRITE;
+#ifdef USE_LIBUV
+            uv_poll_init(TK_A_ & conn->watcher, sockfd);
+            uv_poll_start(&conn->watcher, want_events, connection_cb_uv);
+#else
+            ev_io_init(&conn->watcher, connection_cb, sockfd, want_events);
+            ev_io_start(TK_A_ & conn->watcher);
+#endif
+        } else {
+#ifdef USE_LIBUV
+            uv_poll_init(TK_A_ & conn->watcher, sockfd);
+            uv_poll_start(&conn->watcher, TK_READ, passive_websocket_cb_uv);
+#else
+            ev_io_init(&conn->watcher, passive_websocket_cb, sockfd, TK_READ);
+            ev_io_start(TK_A_ & conn->watcher);
+#endif
+        }
+    } else { /* Plain socket */
+        int want_events = TK_READ | (want_write ? TK_WRITE : 0);
+        /* The run-wide settings pick the specialized connection_io(). */
+        int plain = !largs->params.ssl_enable && !largs->params.udp
+                    && !largs->params.dump_setting;
+#ifdef USE_LIBUV
+        uv_poll_init(TK_A_ & conn->watcher, sockfd);
+        uv_poll_start(&conn->watcher, want_events,
+                      !plain ? connection_cb_uv
+                             : largs->params.message_marker
+                                   ? connection_cb_marker_uv
+                                   : connection_cb_plain_uv);
+#else
+        if(!plain)
+            ev_io_init(&conn->watcher, connection_cb, sockfd, want_events);
+        else if(largs->params.message_marker)
+            ev_io_init(&conn->watcher, connection_cb_marker, sockfd,
+                       want_events);
+        else
+            ev_io_init(&conn->watcher, connection_cb_plain, sockfd,
+                       want_events);
+        ev_io_start(TK_A_ & conn->watcher);
+#endif
+    }
+    /* With --proxy-protocol the TLS waits for the connection and header. */
+    if(largs->params.proxy_protocol && conn_type == CONN_OUTGOING
+       && conn_state == CSTATE_CONNECTED
+       && proxy_header_send(largs, conn, sockfd) == -1) {
+        DEBUG(DBG_WARNING, "Connection %d goes without the PROXY header\n",
+              sockfd);
+    }
+    if(largs->params.ssl_enable != 0
+       && !(largs->params.proxy_protocol && conn_state == CSTATE_CONNECTING)) {
+        ssl_handshake_step(TK_A_ conn, sockfd);
+    }
+    if(largs->params.slow_send > 0.0 && conn_type == CONN_OUTGOING
+       && conn_state == CSTATE_CONNECTED && conn->data.total_size) {
+        slow_send_start(TK_A_ conn);
+    }
+    if(conn_state == CSTATE_CONNECTED && conn->data.total_size == 0)
+        keepalive_start(TK_A_ conn);
+}
+
+/*
+ * Set up the pipe to splice the received data back through,
+ * see --listen-mode=echo.
+ */
+static int
+echo_init(struct loop_arguments *largs, struct connection *conn) {
+#ifdef TCPKALI_SPLICE
+    if(pipe2(conn->cold->echo.pipe, O_NONBLOCK | O_CLOEXEC) == -1) {
+        DEBUG(DBG_ERROR, "Cannot create a pipe for echo: %s\n",
+              strerror(errno));
+        return 0;
+    }
+    int capacity = fcntl(conn->cold->echo.pipe[0], F_GETPIPE_SZ);
+    conn->cold->echo.capacity = capacity > 0 ? (size_t)capacity : 65536;
+    conn->cold->echo.queued = 0;
+    conn->echo = 1;
+    return 1;
+#else
+    (void)largs;
+    (void)conn;
+    return 0;
+#endif
+}
+
+/*
+ * With --listen-mode=discard the received data is dropped in the kernel,
+ * unless something wants to look at it.
+ */
+static int
+recv_discard_enabled(struct loop_arguments *largs, struct connection *conn) {
+#if defined(__linux__) && defined(MSG_TRUNC)
+    return (largs->params.listen_mode & LMODE_DISCARD)
+           && !largs->params.ssl_enable && !largs->params.websocket_enable
+           && !(largs->params.dump_setting & (DS_DUMP_ONE_IN | DS_DUMP_ALL_IN))
+           && !conn->stop_scan && !conn->cold->latency.sbmh_marker_ctx;
+#else
+    (void)largs;
+    (void)conn;
+    return 0;
+#endif
+}
+
+/*
+ * Accept a single connection from the listening socket.
+ * Returns 0 when there is nothing (more) to accept right now.
+ */
+static int
+accept_one(TK_P_ int lsock) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct sockaddr_storage peer_name;
+    socklen_t addrlen = sizeof(peer_name);
+
+#ifdef HAVE_ACCEPT4
+    /* The peer address comes along, saving getpeername() and fcntl(). */
+    int sockfd = tk_accept4(lsock, (struct sockaddr *)&peer_name, &addrlen,
+                            SOCK_NONBLOCK);
+#else
+    int sockfd = tk_accept(lsock, (struct sockaddr *)&peer_name, &addrlen);
+#endif
+    if(sockfd == -1) {
+        switch(errno) {
+        case EINTR:
+            break;
+        case EAGAIN:
+            break;
+        case EMFILE:
+        case ENFILE:
+            /* The sockets closed lately might still hold the descriptors. */
+            if(closer_flush(largs->closer_ring)) return 1;
+            if(largs->params.remote_addresses.n_addrs == 0) {
+                /*
+                 * If we are in a purely listen mode (no active connections),
+                 * we largely ignore connections that exceeding capacity.
+                 * Leave some indication that we're churning through these
+                 * connections. It will be visible in the status ribbon
+                 * even if verbosity is low.
+                 */
+                atomic_owner_increment(&largs->connections_counter);
+                DEBUG(DBG_DETAIL, "Cannot accept a new connection: %s\n",
+                      strerror(errno));
+                break;
+            }
+            DEBUG(DBG_ERROR, "Cannot accept a new connection: %s\n",
+                  strerror(errno));
+            if(errno == EMFILE) { /* Per-process limit */
+                DEBUG(DBG_ALWAYS,
+                      "Increase `ulimit -n` to twice exceed the "
+                      "--connections.\n");
+            } else if(errno == ENFILE) { /* System limit */
+                DEBUG(DBG_ALWAYS,
+                      "Increase kern.maxfiles/fs.file-max sysctls\n");
+            }
+            exit(1);
+        default:
+            DEBUG(DBG_DETAIL, "Cannot accept a new connection: %s\n",
+                  strerror(errno));
+        }
+        return 0;
+    }
+#ifndef HAVE_ACCEPT4
+    set_nbio(sockfd, 1);
+#endif
+
+    atomic_owner_increment(&largs->connections_counter);
+    largs->worker_connections_accepted++;
+
+    /* If channel lifetime is 0, close it right away. */
+    if(largs->params.channel_lifetime == 0.0) {
+        close(sockfd);
+        return 1;
+    }
+
+    struct connection *conn = connection_new(largs);
+    memcpy(&conn->cold->peer_name, &peer_name, sizeof(peer_name));
+    if(largs->peer_table)
+        conn->cold->peer_index = peer_table_find(
+            largs->peer_table, (struct sockaddr *)&conn->cold->peer_name);
+    set_socket_options(sockfd, conn->cold->peer_name.ss_family, largs);
+    if((largs->params.listen_mode & LMODE_ECHO) && !echo_init(largs, conn)) {
+        tk_pool_give(conn->pool, conn);
+        close(sockfd);
+        return 1;
+    }
+    atomic_increment(&largs->incoming_established);
+    if(largs->params.mptcp) mptcp_count_connection(largs, sockfd);
+    common_connection_init(TK_A_ conn, CONN_INCOMING, CSTATE_CONNECTED, sockfd);
+    conn->recv_discard = recv_discard_enabled(largs, conn);
+    if(largs->params.listen_mode & LMODE_RESPOND) {
+        size_t needle_size = largs->params.request_delimiter_expr->u.data.size;
+        conn->cold->respond.sbmh_request_ctx = malloc(SBMH_SIZE(needle_size));
+        assert(conn->cold->respond.sbmh_request_ctx);
+        sbmh_init(conn->cold->respond.sbmh_request_ctx, NULL, 0, 0);
+        conn->respond = 1;
+    }
+    connection_io_stream(TK_A_ conn);
+    return 1;
+}
+
+static void
+accept_cb(TK_P_ tk_io *w, int UNUSED revents) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+
+    /*
+     * Drain the accept queue, up to --accept-batch connections,
+     * before serving the rest of the connections.
+     */
+    for(int n = largs->params.accept_batch; n > 0; n--) {
+        if(!accept_one(TK_A_ tk_fd(w))) break;
+    }
+}
+
+/*
+ * Debug data by dumping it in a format escaping all the special
+ * characters.
+ */
+static void
+debug_dump_data(struct loop_arguments *largs, const char *prefix, int fd,
+                const void *data, size_t size, ssize_t limit) {
+    debug_dump_data_highlight(largs, prefix, fd, data, size, limit, 0, 0);
+}
+static void
+debug_dump_data_highlight(struct loop_arguments *largs, const char *prefix,
+                          int fd, const void *data, size_t size,
+                          ssize_t limit, size_t hl_offset, size_t hl_length) {
+    struct log_dump dump = {.prefix = prefix,
+                            .fd = fd,
+                            .original_size = size,
+                            .hl_offset = hl_offset,
+                            .hl_length = hl_length};
+
+    /*
+     * Do not show more than (limit) first bytes,
+     * or more than (-limit) last bytes of the buffer.
+     */
+    if(limit) {
+        if(limit > 0 && (size_t)limit < size) {
+            dump.following = size - limit;
+            size = limit;
+        } else if((size_t)-limit < size) {
+            dump.preceding = size + limit;
+            size = -limit;
+            data += dump.preceding;
+        }
+    }
+
+    /* Only the bytes to show are copied for the writer thread. */
+    if(largs->log_ring)
+        log_ring_dump(largs->log_ring, &dump, data, size);
+    else
+        debug_dump_print(&dump, data, size);
+}
+
+/*
+ * Print the dump, normally on the log writer thread.
+ */
+static void
+debug_dump_print(const struct log_dump *dump, const void *data, size_t size) {
+    char stack_buffer[4000];
+    char *buffer = stack_buffer;
+    size_t buf_size = PRINTABLE_DATA_SUGGESTED_BUFFER_SIZE(size);
+
+    if(buf_size > sizeof(stack_buffer)) {
+        /* This is used only for debugging of an otherwise expensive dataset.
+         * We could have cached the malloc result, but that'd be a non-local
+         * complication, yielding negligible performance benefit
+         * (after all, we're here to print a multi-kilobyte message dump).
+         */
+        buffer = malloc(buf_size);
+        assert(buffer);
+    }
+
+    const char *prefix = dump->prefix;
+    char fdnumbuf[16];
+    if(dump->fd >= 0) {
+        snprintf(fdnumbuf, sizeof(fdnumbuf), "%d, ", dump->fd);
+    } else {
+        fdnumbuf[0] = '\0';
+    }
+    fprintf(stderr, "%s%s(%s%ld): %s%s[%s%s%s]%s%s\n", tcpkali_clear_eol(),
+            prefix, fdnumbuf, (long)dump->original_size,
+            dump->preceding ? "..." : "",
+            tk_attr(*prefix == 'S' ? TKA_SndBrace : TKA_RcvBrace),
+            tk_attr(TKA_NORMAL),
+            printable_data_highlight(buffer, buf_size, data, size, 0,
+                                     dump->hl_offset, dump->hl_length),
+            tk_attr(*prefix == 'S' ? TKA_SndBrace : TKA_RcvBrace),
+            tk_attr(TKA_NORMAL), dump->following ? "..." : "");
+    if(buffer != stack_buffer) free(buffer);
+}
+
+/*
+ * The DEBUG() output of the worker, printed by the log writer thread
+ * when there is one.
+ */
+static void
+worker_log(struct loop_arguments *largs, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    if(largs->log_ring) {
+        log_ring_vprintf(largs->log_ring, fmt, ap);
+    } else {
+        fprintf(stderr, "%s", tcpkali_clear_eol());
+        vfprintf(stderr, fmt, ap);
+    }
+    va_end(ap);
+}
+
+enum lb_return_value {
+    LB_UNLIMITED, /* Not limiting bandwidth, proceed. */
+    LB_PROCEED,   /* Use send_pace_moved() afterwards. */
+    LB_LOCKSTEP,  /* Proceed but pause right after. */
+    LB_GO_SLEEP,  /* Not allowed to move data.        */
+};
+
+/*
+ * --message-arrival poisson: release whole messages at exponentially
+ * distributed intervals, regardless of whether the earlier messages
+ * made it out. Falling behind builds up a backlog instead of slowing
+ * the arrivals down.
+ */
+static enum lb_return_value
+limit_message_arrivals(TK_P_ struct connection *conn,
+                       size_t *suggested_move_size) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    double rate = largs->params.channel_send_rate.value;
+    double now = tk_now(TK_A);
+
+    while(conn->send_next_arrival_ts <= now) {
+        /* The intended time of the backlog, see send_intended_ts(). */
+        if(conn->send_arrived_bytes == 0)
+            conn->send_schedule_ts = conn->send_next_arrival_ts;
+        conn->send_arrived_bytes += conn->avg_message_size;
+        conn->send_next_arrival_ts += exponential_interval(&largs->rng, rate);
+    }
+
+    if(conn->send_arrived_bytes >= *suggested_move_size) return LB_PROCEED;
+
+    double delay = conn->send_next_arrival_ts - now;
+    if(delay < 0.001) delay = 0.001;
+    TK_PROBE2(rate_sleep, tk_fd(&conn->watcher), (long)(delay * 1e6));
+    connection_timer_refresh(TK_A_ conn, delay);
+
+    *suggested_move_size = conn->send_arrived_bytes;
+    return conn->send_arrived_bytes ? LB_LOCKSTEP : LB_GO_SLEEP;
+}
+
+/*
+ * --rate-scope total: the connections of all workers share the budget.
+ * The tokens are counted in the units of the rate: messages or bytes.
+ */
+static enum lb_return_value
+limit_total_rate(TK_P_ struct connection *conn, size_t *suggested_move_size) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    double rate = largs->params.channel_send_rate.value;
+    double bytes_per_token =
+        largs->params.channel_send_rate.value_base == RS_MESSAGES_PER_SECOND
+            ? conn->avg_message_size
+            : 1.0;
+    size_t smallest_block_to_move = conn->send_limit.minimal_move_size;
+    double now = tk_now(TK_A);
+
+    if(bytes_per_token <= 0.0 || rate <= 0.0) return LB_UNLIMITED;
+
+    double allowed = largs->send_budget_tokens * bytes_per_token;
+    if(allowed < *suggested_move_size) {
+        /* About a millisecond of the aggregate rate at a time. */
+        double batch = rate * 0.001;
+        if(batch < smallest_block_to_move / bytes_per_token)
+            batch = smallest_block_to_move / bytes_per_token;
+        largs->send_budget_tokens +=
+            rate_budget_take(largs->send_budget, rate, now, batch);
+        allowed = largs->send_budget_tokens * bytes_per_token;
+    }
+
+    if(allowed >= *suggested_move_size) return LB_PROCEED;
+
+    enum lb_return_value rvalue;
+    double delay;
+    if(allowed < smallest_block_to_move) {
+        delay = rate_budget_when_allowed(
+            largs->send_budget, rate, now,
+            (smallest_block_to_move - allowed) / bytes_per_token);
+        *suggested_move_size = 0;
+        rvalue = LB_GO_SLEEP;
+    } else {
+        size_t move = allowed;
+        *suggested_move_size = move - (move % smallest_block_to_move);
+        delay = smallest_block_to_move / bytes_per_token / rate;
+        rvalue = LB_LOCKSTEP;
+    }
+
+    if(delay < 0.001) delay = 0.001;
+    TK_PROBE2(rate_sleep, tk_fd(&conn->watcher), (long)(delay * 1e6));
+    connection_timer_refresh(TK_A_ conn, delay);
+
+    return rvalue;
+}
+
+static enum lb_return_value
+limit_channel_bandwidth(TK_P_ struct connection *conn,
+                        size_t *suggested_move_size, int event) {
+    struct pacefier *pace = NULL;
+    bandwidth_limit_t limit = {0, 0};
+    enum lb_return_value rvalue = LB_UNLIMITED;
+
+    if(event & TK_WRITE) {
+        limit = conn->send_limit;
+        pace = &conn->send_pace;
+    } else if(event & TK_READ) {
+        limit = conn->recv_limit;
+        pace = &conn->recv_pace;
+    } else {
+        assert(event & (TK_WRITE | TK_READ));
+    }
+
+    double bw = limit.bytes_per_second;
+    if(bw < 0.0) {
+        return LB_UNLIMITED; /* Limit not set, don't limit. */
+    }
+
+    if(event & TK_WRITE) {
+        struct loop_arguments *largs = tk_userdata(TK_A);
+        if(largs->params.rate_scope == RATE_SCOPE_TOTAL)
+            return limit_total_rate(TK_A_ conn, suggested_move_size);
+        if(send_arrivals_enabled(largs, conn))
+            return limit_message_arrivals(TK_A_ conn, suggested_move_size);
+    }
+
+    size_t smallest_block_to_move = limit.minimal_move_size;
+    size_t allowed_to_move;
+    if((event & TK_WRITE) && conn->kernel_paced) {
+        /* The kernel paces the data, only keep it from queueing up. */
+        allowed_to_move =
+            pacefier_allow(pace, tk_now(TK_A) + KERNEL_PACING_AHEAD);
+    } else {
+        allowed_to_move = pacefier_allow(pace, tk_now(TK_A));
+    }
+
+    if(allowed_to_move < *suggested_move_size) {
+        double delay;
+
+        if(event & TK_READ) {
+            if(allowed_to_move < smallest_block_to_move) {
+                /*   allowed     smallest|suggested
+                   |------^-----------^-------^-------> */
+                delay = pacefier_when_allowed(pace, tk_now(TK_A), 1460);
+                *suggested_move_size = 0;
+                rvalue = LB_GO_SLEEP;
+            } else {
+                /*
+                 * If we're reading, there's no gain in reading many
+                 * tiny chunks: the packets on the wire will still
+                 * very likely be the same, as TCP stacks don't like
+                 * sending too small window updates to the sender.
+                 * So if the reading allowance is too small, make it
+                 * large enough still to batch reads.
+                 */
+                if(allowed_to_move > 1460)
+                    *suggested_move_size = allowed_to_move;
+                else
+                    *suggested_move_size = 1460;
+                return LB_PROCEED;
+            }
+        } else {
+            if(allowed_to_move < smallest_block_to_move) {
+                /*   allowed     smallest|suggested
+                   |------^-----------^-------^-------> */
+                delay = (double)(smallest_block_to_move - allowed_to_move) / bw;
+                *suggested_move_size = 0;
+                rvalue = LB_GO_SLEEP;
+            } else {
+                /*   smallest  allowed  suggested
+                   |------^--------^-------^-------> */
+                size_t excess = (allowed_to_move % smallest_block_to_move);
+                delay = (double)(smallest_block_to_move - excess) / bw;
+                *suggested_move_size = allowed_to_move - excess;
+                rvalue = LB_LOCKSTEP;
+            }
+            if(conn->kernel_paced && delay < KERNEL_PACING_AHEAD / 2)
+                delay = KERNEL_PACING_AHEAD / 2;
+        }
+
+        if(delay < 0.001) delay = 0.001;
+
+        TK_PROBE2(rate_sleep, tk_fd(&conn->watcher), (long)(delay * 1e6));
+        connection_timer_refresh(TK_A_ conn, delay);
+
+        return rvalue;
+    }
+
+    return LB_PROCEED;
+}
+
+static void
+passive_websocket_cb(TK_P_ tk_io *w, int revents) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct connection *conn =
+        (struct connection *)((char *)w - offsetof(struct connection, watcher));
+
+    if(conn->conn_blocked & CBLOCKED_ON_INIT) {
+        if(((conn->conn_blocked & CBLOCKED_ON_READ) && (revents & TK_READ)) ||
+           ((conn->conn_blocked & CBLOCKED_ON_WRITE) && (revents & TK_WRITE))) {
+            if(conn->conn_blocked & CBLOCKED_ON_READ) {
+                revents &= ~TK_READ;
+            }
+            if(conn->conn_blocked & CBLOCKED_ON_WRITE) {
+                revents &= ~TK_WRITE;
+            }
+            if(ssl_handshake_step(TK_A_ conn, 0)) {
+                if(conn->conn_blocked & CBLOCKED_ON_INIT) {
+                    conn->conn_wish |= CW_READ_INTEREST;
+                    conn->conn_wish |= CW_WRITE_INTEREST;
+                    update_io_interest(TK_A_ conn);
+                    return;
+                }
+            } else {
+                close_connection(TK_A_ conn, CCR_REMOTE);
+                return;
+            }
+        } else {
+            return;
+        }
+    }
+    if(revents & TK_WRITE) {
+        if(conn->conn_blocked & CBLOCKED_ON_READ) {
+            return;
+        }
+        conn->conn_blocked &= ~CBLOCKED_ON_WRITE;
+    }
+    if(revents & TK_READ) {
+        ssize_t rd = 0;
+        if(largs->params.ssl_enable) {
+#ifdef HAVE_OPENSSL
+            if(conn->conn_blocked & CBLOCKED_ON_WRITE) {
+                return;
+            }
+            conn->conn_blocked &= ~CBLOCKED_ON_READ;
+            rd = SSL_read(conn->cold->ssl_fd, largs->scratch_recv_buf,
+                          largs->scratch_recv_size);
+            switch(SSL_get_error(conn->cold->ssl_fd, rd)) {
+            case SSL_ERROR_NONE:
+                break;
+            case SSL_ERROR_WANT_WRITE:
+                conn->conn_blocked |= CBLOCKED_ON_WRITE;
+                return;
+            case SSL_ERROR_WANT_READ:
+                conn->conn_blocked |= CBLOCKED_ON_READ;
+                return;
+            case SSL_ERROR_ZERO_RETURN:
+            default:
+                rd = -1;  // Close it
+            }
+#endif
+        } else if(conn->timestamping) {
+            rd = tstamp_read(TK_A_ conn, largs->scratch_recv_buf,
+                             largs->scratch_recv_size);
+        } else {
+            rd = tk_read(tk_fd(w), largs->scratch_recv_buf,
+                         largs->scratch_recv_size);
+        }
+        switch(rd) {
+        case -1:
+            switch(errno) {
+            case EAGAIN:
+                return;
+            default:
+                close_connection(TK_A_ conn, CCR_REMOTE);
+                return;
+            }
+        /* Fall through */
+        case 0:
+            close_connection(TK_A_ conn, CCR_REMOTE);
+            return;
+        default:
+            largs->scratch_recv_last_size = rd; /* Only update on >0 data */
+            conn->traffic_ongoing.num_reads++;
+            conn->traffic_ongoing.bytes_rcvd += rd;
+            connection_stats_dirty(largs, conn);
+            if(largs->params.dump_setting & DS_DUMP_ALL_IN
+               || ((largs->params.dump_setting & DS_DUMP_ONE_IN)
+                   && largs->dump_connect_fd == tk_fd(w))) {
+                debug_dump_data(largs, "Rcv", tk_fd(w),
+                                largs->scratch_recv_buf, rd, 0);
+            }
+            if(conn->recorded)
+                record_received(TK_A_ conn, RECORD_DATA,
+                                largs->scratch_recv_buf, rd);
+            latency_record_incoming_ts(TK_A_ conn, largs->scratch_recv_buf, rd);
+
+            /*
+             * Parse the upgrade request as it comes, and queue it
+             * to be answered once it is complete.
+             */
+            if(conn->ws_state == WSTATE_WS_ESTABLISHED) break;
+            if(!conn->cold->ws_request) {
+                conn->cold->ws_request =
+                    calloc(1, sizeof(*conn->cold->ws_request));
+                assert(conn->cold->ws_request);
+            }
+            size_t consumed;
+            switch(http_websocket_parse(conn->cold->ws_request,
+                                        largs->scratch_recv_buf, rd,
+                                        &consumed)) {
+            case HDW_NOT_ENOUGH_DATA:
+                return;
+            case HDW_WEBSOCKET_DETECTED:
+                conn->ws_state = WSTATE_WS_ESTABLISHED;
+                ws_accept_queue(largs, conn);
+#if defined(USE_LIBUV) || defined(USE_IO_URING)
+                /* No hook at the end of the loop iteration: answer now. */
+                ws_accepts_flush(TK_A);
+#endif
+                return;
+            case HDW_UNEXPECTED_ERROR:
+                close_connection(TK_A_ conn, CCR_DATA);
+                return;
+            }
+            break;
+        }
+    }
+    /* Retry the response blocked by the TLS layer. */
+    if(conn->ws_state == WSTATE_WS_ESTABLISHED && conn->cold->ws_request
+       && !conn->cold->ws_accept_pending && !conn->conn_blocked)
+        ws_accept_respond(TK_A_ conn);
+}
+
+/*
+ * Queue the complete upgrade request, to have its Sec-WebSocket-Accept
+ * computed along with the others received in this loop iteration.
+ */
+static void
+ws_accept_queue(struct loop_arguments *largs, struct connection *conn) {
+    if(largs->ws_accepts.count == largs->ws_accepts.size) {
+        largs->ws_accepts.size =
+            largs->ws_accepts.size ? 2 * largs->ws_accepts.size : 16;
+        largs->ws_accepts.conns = realloc(
+            largs->ws_accepts.conns,
+            largs->ws_accepts.size * sizeof(largs->ws_accepts.conns[0]));
+        assert(largs->ws_accepts.conns);
+    }
+    largs->ws_accepts.conns[largs->ws_accepts.count++] = conn;
+    conn->cold->ws_accept_pending = largs->ws_accepts.count;
+}
+
+/*
+ * Take the connection out of the queue, as it is closed.
+ */
+static void
+ws_accept_dequeue(struct loop_arguments *largs, struct connection *conn) {
+    size_t index = conn->cold->ws_accept_pending - 1;
+    struct connection *last =
+        largs->ws_accepts.conns[--largs->ws_accepts.count];
+    largs->ws_accepts.conns[index] = last;
+    last->cold->ws_accept_pending = index + 1;
+    conn->cold->ws_accept_pending = 0;
+}
+
+/*
+ * Answer the upgrade requests queued during the loop iteration,
+ * hashing their keys together.
+ */
+static void
+ws_accepts_flush(TK_P) {
     struct loop_arguments *largs = tk_userdata(TK_A);
+    size_t count = largs->ws_accepts.count;
+    struct http_websocket_request *reqs[32];
 
-    int sockfd = accept(tk_fd(w), 0, 0);
-    if(sockfd == -1) {
-        switch(errno) {
-        case EINTR:
+    if(count == 0) return;
+
+    for(size_t done = 0; done < count;) {
+        size_t batch = count - done < 32 ? count - done : 32;
+        for(size_t i = 0; i < batch; i++)
+            reqs[i] = largs->ws_accepts.conns[done + i]->cold->ws_request;
+        http_websocket_accept(reqs, batch);
+        done += batch;
+    }
+
+    /* Responding may close the connections, so the queue is emptied first. */
+    for(size_t i = 0; i < count; i++)
+        largs->ws_accepts.conns[i]->cold->ws_accept_pending = 0;
+    largs->ws_accepts.count = 0;
+    for(size_t i = 0; i < count; i++) {
+        struct connection *conn = largs->ws_accepts.conns[i];
+        ws_accept_respond(TK_A_ conn);
+    }
+}
+
+/*
+ * Send the 101 Switching Protocols response to the accepted upgrade request
+ * and continue with the WebSocket data.
+ */
+static void
+ws_accept_respond(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    tk_io *w = &conn->watcher;
+    char out_buf[200];
+    size_t response_size = http_websocket_response(
+        conn->cold->ws_request, out_buf, sizeof(out_buf));
+
+    if(largs->params.ssl_enable) {
+#ifdef HAVE_OPENSSL
+        int wrote = SSL_write(conn->cold->ssl_fd, out_buf, response_size);
+        switch(SSL_get_error(conn->cold->ssl_fd, wrote)) {
+        case SSL_ERROR_NONE:
             break;
-        case EAGAIN:
+        case SSL_ERROR_WANT_WRITE:
+            conn->conn_blocked |= CBLOCKED_ON_WRITE;
+            return;
+        case SSL_ERROR_WANT_READ:
+            conn->conn_blocked |= CBLOCKED_ON_READ;
+            return;
+        case SSL_ERROR_ZERO_RETURN:
+        default:
+            wrote = -1;  // Close it
+        }
+        if(wrote != (ssize_t)response_size) {
+            close_connection(TK_A_ conn, CCR_DATA);
+            return;
+        }
+#endif
+    } else {
+        if(tk_write(tk_fd(w), out_buf, response_size)
+           != (ssize_t)response_size) {
+            close_connection(TK_A_ conn, CCR_DATA);
+            return;
+        }
+    }
+    free(conn->cold->ws_request);
+    conn->cold->ws_request = NULL;
+    int want_events = TK_READ | TK_WRITE;
+#ifdef USE_LIBUV
+    uv_poll_start(&conn->watcher, want_events, connection_cb_uv);
+#else
+    ev_io_stop(TK_A_ w);
+    ev_io_init(&conn->watcher, connection_cb, tk_fd(w), want_events);
+    ev_io_start(TK_A_ & conn->watcher);
+#endif
+}
+
+static void
+update_io_interest(TK_P_ struct connection *conn) {
+    int events = 0;
+    /* Remove read or write wish, if we don't want them */
+    events |= (conn->conn_wish & CW_READ_INTEREST) ? TK_READ : 0;
+    events |= (conn->conn_wish & CW_WRITE_INTEREST) ? TK_WRITE : 0;
+    /* Remove read or write wish, if we are blocked on them */
+    events &= ~((conn->conn_wish & CW_READ_BLOCKED) ? TK_READ : 0);
+    events &= ~((conn->conn_wish
+                 & (CW_WRITE_BLOCKED | CW_WRITE_DELAYED | CW_WRITE_ZEROCOPY
+                    | CW_WRITE_PIPELINED | CW_WRITE_MIRRORED))
+                ? TK_WRITE : 0);
+
+#ifdef USE_LIBUV
+    (void)loop;
+    uv_poll_start(&conn->watcher, events, conn->watcher.poll_cb);
+#else
+    /* Restarting the watcher costs a poller update, an epoll_ctl(2). */
+    if(conn->watcher.active
+       && (conn->watcher.events & (TK_READ | TK_WRITE)) == events)
+        return;
+    ev_io_stop(TK_A_ & conn->watcher);
+#ifdef USE_IO_URING
+    ev_io_set(&conn->watcher, conn->watcher.fd, events);
+#else
+    /*
+     * Not ev_io_set(), which forces libev to re-register the descriptor.
+     * This way libev compares the interest it has registered with the
+     * one wanted at the end of the loop iteration, so the write interest
+     * dropped and restored by a rate-limited connection within the same
+     * iteration is not passed to the kernel at all.
+     */
+    conn->watcher.events = events;
+#endif
+    ev_io_start(TK_A_ & conn->watcher);
+#endif
+}
+
+/*
+ * With io_uring, have the loop receive and send the connection's data
+ * through the ring, see tk_uring_io_stream(). Not for the connections
+ * that read or write by other means than tk_read() and tk_write(), or
+ * that look at the kernel's socket buffers.
+ */
+static void
+connection_io_stream(TK_P_ struct connection *conn) {
+#ifdef USE_IO_URING
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    const struct engine_params *params = &largs->params;
+
+    if(conn->conn_type == CONN_ACCEPTOR || conn->conn_state != CSTATE_CONNECTED
+       || params->ssl_enable || params->udp
+       || params->write_combine != WRCOMB_ON
+       || params->close_style == CLOSE_HALF || conn->timestamping
+       || conn->echo || conn->recv_discard || conn->zerocopy_rx
+       || conn->zerocopy.enabled || conn->sendfile_body)
+        return;
+    tk_uring_io_stream(TK_A_ & conn->watcher);
+#else
+    (void)loop;
+    (void)conn;
+#endif
+}
+
+/*
+ * The kernel has sent out the data up to and including the (key) byte
+ * at the time (sent_ts): replace the user space send timestamps
+ * of the messages started by these writes.
+ */
+static void
+tstamp_tx_complete(struct loop_arguments *largs, struct connection *conn,
+                   uint32_t key, double sent_ts) {
+    struct tstamp_state *st = conn->cold->latency.tstamp;
+    /*
+     * The --latency-correction=on ring holds the intended send times,
+     * which are not to be replaced with the actual ones.
+     */
+    struct ts_ring *ring = conn->cold->latency.uncorrected_timestamps;
+    if(!ring && largs->params.latency_correction == LCM_OFF)
+        ring = conn->cold->latency.sent_timestamps;
+
+    while(st->head != st->tail) {
+        struct tstamp_pending_write *pw =
+            &st->pending[st->head % TSTAMP_TX_PENDING];
+        if((int32_t)(pw->last_byte - key) > 0) break;
+        st->head++;
+        if(!ring || sent_ts == 0.0) continue;
+        uint32_t tick = ts_ring_tick(ring, sent_ts);
+        for(uint32_t n = 0; n < pw->messages; n++) {
+            uint32_t back = st->messages_sent - (pw->messages_upto - 1 - n);
+            /* Older messages might have been replied to already. */
+            if(back <= ts_ring_count(ring)) ts_ring_replace(ring, back, tick);
+        }
+    }
+}
+
+/*
+ * Remember the write which started (messages) new messages,
+ * to match it with its kernel send timestamp later.
+ */
+static void
+tstamp_tx_expect(struct connection *conn, size_t messages) {
+    struct tstamp_state *st = conn->cold->latency.tstamp;
+    st->messages_sent += messages;
+    if(st->tail - st->head == TSTAMP_TX_PENDING) st->head++;
+    struct tstamp_pending_write *pw =
+        &st->pending[st->tail++ % TSTAMP_TX_PENDING];
+    pw->last_byte = st->bytes_sent - 1;
+    pw->messages_upto = st->messages_sent;
+    pw->messages = messages;
+}
+
+/*
+ * Collect MSG_ZEROCOPY completion notifications and the SO_TIMESTAMPING
+ * send timestamps from the socket error queue.
+ * The pending notifications keep the socket in the POLLERR state,
+ * so this has to be done on every wakeup while any sends are in flight.
+ */
+static void
+errqueue_reap(TK_P_ struct connection *conn) {
+#if defined(TCPKALI_ZEROCOPY) || defined(TCPKALI_TIMESTAMPING)
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    char control[256];
+
+    for(;;) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if(recvmsg(tk_fd(&conn->watcher), &msg, MSG_ERRQUEUE) == -1) {
+            if(errno == EINTR) continue;
             break;
-        case EMFILE:
-        case ENFILE:
-            if(largs->params.remote_addresses.n_addrs == 0) {
-                /*
-                 * If we are in a purely listen mode (no active connections),
-                 * we largely ignore connections that exceeding capacity.
-                 * Leave some indication that we're churning through these
-                 * connections. It will be visible in the status ribbon
-                 * even if verbosity is low.
-                 */
-                atomic_increment(&largs->connections_counter);
-                DEBUG(DBG_DETAIL, "Cannot accept a new connection: %s\n",
-                      strerror(errno));
-                break;
+        }
+
+        double sent_ts = 0.0;
+        struct cmsghdr *cm;
+        for(cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+#ifdef TCPKALI_TIMESTAMPING
+            if(cm->cmsg_level == SOL_SOCKET
+               && cm->cmsg_type == SCM_TIMESTAMPING) {
+                /* Precedes the IP_RECVERR it belongs to. */
+                sent_ts = tstamp_loop_time(largs, (void *)CMSG_DATA(cm));
+                continue;
             }
-            DEBUG(DBG_ERROR, "Cannot accept a new connection: %s\n",
-                  strerror(errno));
-            if(errno == EMFILE) { /* Per-process limit */
-                DEBUG(DBG_ALWAYS,
-                      "Increase `ulimit -n` to twice exceed the "
-                      "--connections.\n");
-            } else if(errno == ENFILE) { /* System limit */
-                DEBUG(DBG_ALWAYS,
-                      "Increase kern.maxfiles/fs.file-max sysctls\n");
+#endif
+            if(!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                 || (cm->cmsg_level == SOL_IPV6
+                     && cm->cmsg_type == IPV6_RECVERR)))
+                continue;
+            struct sock_extended_err *serr = (void *)CMSG_DATA(cm);
+#ifdef TCPKALI_TIMESTAMPING
+            if(serr->ee_errno == ENOMSG
+               && serr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+                if(conn->timestamping)
+                    tstamp_tx_complete(largs, conn, serr->ee_data, sent_ts);
+                continue;
+            }
+#endif
+#ifdef TCPKALI_ZEROCOPY
+            if(serr->ee_errno != 0
+               || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+            /* [ee_info..ee_data] range of sends is complete. */
+            if((int32_t)(serr->ee_data + 1 - conn->zerocopy.completed) > 0)
+                conn->zerocopy.completed = serr->ee_data + 1;
+            if(serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                /* Kernel copied data anyway, e.g. on loopback. */
+                if(conn->zerocopy.enabled)
+                    DEBUG(DBG_DETAIL,
+                          "MSG_ZEROCOPY is not effective on fd %d, "
+                          "falling back to write()\n",
+                          tk_fd(&conn->watcher));
+                conn->zerocopy.enabled = 0;
             }
+#endif
+        }
+    }
+
+    if((conn->conn_wish & CW_WRITE_ZEROCOPY)
+       && conn->zerocopy.sent == conn->zerocopy.completed) {
+        conn->conn_wish &= ~CW_WRITE_ZEROCOPY;
+        update_io_interest(TK_A_ conn);
+    }
+#else
+    (void)loop;
+    (void)conn;
+#endif
+}
+
+/*
+ * Whether the payload is rewritten in place when we wrap around
+ * to the beginning of the message data.
+ */
+static int
+payload_rewritten_on_wrap(struct loop_arguments *largs,
+                          struct connection *conn) {
+    return largs->params.message_marker || conn->http2_frames
+           || (conn->mqtt_packets && largs->params.mqtt_qos)
+           || connection_messages_scope(conn) >= DS_MESSAGE_SLOTS;
+}
+
+/*
+ * Make space for (messages) more timestamps in the ring.
+ * With --latency-sample, returns the number of timestamps
+ * which still do not fit, rather than giving up.
+ */
+static size_t
+ts_ring_make_room(struct loop_arguments *largs, struct ts_ring *ring,
+                  size_t messages) {
+    if(messages > ts_ring_capacity(ring) - ts_ring_count(ring)) {
+        /*
+         * More messages are in flight than the socket buffers can hold;
+         * check that we aren't recording send timestamps without actually
+         * receiving any data back.
+         */
+        const unsigned MEGABYTE = 1024 * 1024;
+        while(messages > ts_ring_capacity(ring) - ts_ring_count(ring)
+              && ts_ring_capacity(ring) * sizeof(ring->ticks[0])
+                     <= 10 * MEGABYTE) {
+            ts_ring_grow(largs->huge_arena, ring);
+        }
+        if(messages > ts_ring_capacity(ring) - ts_ring_count(ring)) {
+            if(largs->params.latency_sample > 1)
+                return messages
+                       - (ts_ring_capacity(ring) - ts_ring_count(ring));
+            DEBUG(
+                DBG_ERROR,
+                "Sending messages too fast, "
+                "not receiving them back fast enough.\n"
+                "Check that the --latency-marker data is being received back.\n"
+                "Use -d option to dump received message data.\n");
             exit(1);
-        default:
-            DEBUG(DBG_DETAIL, "Cannot accept a new connection: %s\n",
-                  strerror(errno));
         }
-        return;
     }
-    set_nbio(sockfd, 1);
-    set_socket_options(sockfd, largs);
+    return 0;
+}
+
+/*
+ * The (intended_ts) is the time the data was supposed to be sent at,
+ * see send_intended_ts().
+ */
+static void
+latency_record_outgoing_ts(TK_P_ struct connection *conn, size_t wrote,
+                           double intended_ts) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+
+    TK_PROBE2(message_send, tk_fd(&conn->watcher), wrote);
+
+    if(largs->params.message_marker || conn->http_responses
+       || conn->resp_replies || conn->mqtt_packets || conn->lenprefix_frames
+       || conn->framer_responses) {
+            if (conn->avg_message_size > 0) {
+                conn->traffic_ongoing.msgs_sent += (conn->bytes_leftovers + wrote) / conn->avg_message_size;
+                conn->bytes_leftovers = (conn->bytes_leftovers + wrote) % conn->avg_message_size;
+            }
+        if(largs->params.message_marker) return;
+    }
+
+    if(!conn->cold->latency.sent_timestamps) return;
+
+    /*
+     * (EXPL:1)
+     * Arguably we should record timestamps only for the whole messages which
+     * were sent. However, in some cases (such as with echo servers) the server
+     * could start replying earlier than the whole message is received. This
+     * confuses the latency estimation code because the reply gets received
+     * before the message is fully sent to the remote system. For example,
+     *  tcpkali --message Foooooo --latency-marker F <ip>:echo
+     * would fail, because F is sometimes received before than the trailing
+     * ooo's get to be sent. Therefore we record the timestamp even after
+     * only the very first message byte is sent.
+     */
+
+    size_t msgsize = conn->data.single_message_size;
+    size_t credit = conn->cold->latency.message_bytes_credit;
+    size_t pretend_sent = wrote + credit;
+    size_t messages = pretend_sent / msgsize;
+    conn->cold->latency.message_bytes_credit =
+        pretend_sent % conn->data.single_message_size;
+    if(!messages) return;
+    if(conn->timestamping) tstamp_tx_expect(conn, messages);
+    if(conn->framer_responses && largs->params.framer->next_request) {
+        uint64_t now_ns = tk_now(TK_A) * 1e9;
+        for(size_t n = messages; n; n--)
+            largs->params.framer->next_request(conn->cold->framer_state,
+                                               now_ns);
+    }
+
+    /*
+     * --latency-sample: only the messages numbered 0, N, 2N...
+     * since the connection start are timestamped. The k-th message
+     * of this write is the (sample_sent + k - 1)-th one.
+     */
+    size_t first = 1;
+    size_t step = 1;
+    unsigned sample = largs->params.latency_sample;
+    if(sample > 1) {
+        uint64_t sent = conn->cold->latency.sample_sent;
+        uint64_t next = (sent + sample - 1) / sample * sample;
+        conn->cold->latency.sample_sent = sent + messages;
+        if(next >= sent + messages) return;
+        first = next - sent + 1;
+        step = sample;
+        messages = (messages - first) / sample + 1;
+    }
+
+    double now = tk_now(TK_A);
+    struct ts_ring *ring = conn->cold->latency.sent_timestamps;
+    struct ts_ring *uncorrected = conn->cold->latency.uncorrected_timestamps;
+    size_t shortfall = ts_ring_make_room(largs, ring, messages);
+    if(uncorrected) {
+        size_t u = ts_ring_make_room(largs, uncorrected, messages);
+        if(shortfall < u) shortfall = u;
+    }
+    if(shortfall) {
+        /*
+         * Sampling is not expected to fill the ring, but when it does,
+         * the oldest samples are given up: the replies to them are
+         * later matched by count and not recorded.
+         */
+        size_t dropped = shortfall;
+        if(dropped > ts_ring_count(ring)) dropped = ts_ring_count(ring);
+        ring->head += dropped;
+        if(uncorrected) uncorrected->head += dropped;
+        if(shortfall > dropped) {
+            /* Even the empty ring is not enough, skip the new ones too. */
+            first += (shortfall - dropped) * step;
+            messages -= shortfall - dropped;
+        }
+        conn->cold->latency.samples_skip += shortfall;
+        atomic_add(&largs->latency_samples_dropped, shortfall);
+    }
+
+    if(largs->params.latency_correction && intended_ts < now) {
+        /*
+         * The pace lets the message out once all of its bytes are due,
+         * so the message is intended to be sent at the time its last
+         * byte is due. The k-th message starts at (k * msgsize - credit).
+         */
+        double bps = conn->send_limit.bytes_per_second;
+        for(size_t k = first, n = messages; n; k += step, n--) {
+            double due = intended_ts + (k * msgsize - credit + msgsize - 1) / bps;
+            ts_ring_push(ring, ts_ring_tick(ring, due < now ? due : now));
+        }
+    } else {
+        for(uint32_t tick = ts_ring_tick(ring, now), n = messages; n; n--) {
+            ts_ring_push(ring, tick);
+        }
+    }
+    if(uncorrected) {
+        for(uint32_t tick = ts_ring_tick(uncorrected, now); messages;
+            messages--) {
+            ts_ring_push(uncorrected, tick);
+        }
+    }
+}
+
+static unsigned nibble(const unsigned char c) {
+    switch(c) {
+    case '0' ... '9': return (c - '0');
+    case 'a' ... 'f': return (c - 'a') + 10;
+    case 'A' ... 'F': return (c - 'A') + 10;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * The per-remote histograms of an outgoing connection, or NULL.
+ */
+static struct remote_latency *
+remote_latency(struct loop_arguments *largs, struct connection *conn) {
+    if(largs->remote_latency && conn->conn_type == CONN_OUTGOING
+       && (size_t)conn->cold->remote_index < largs->remote_latency_count)
+        return &largs->remote_latency[conn->cold->remote_index];
+    return NULL;
+}
+
+/*
+ * The per-group histograms of a --connection-group connection, or NULL.
+ */
+static struct remote_latency *
+group_latency(struct loop_arguments *largs, struct connection *conn) {
+    if(largs->group_latency && conn->cold->group)
+        return &largs->group_latency[conn->cold->group - 1];
+    return NULL;
+}
+
+/*
+ * The echoed data differs from the data sent (--verify-echo).
+ * Only the first mismatch of a connection is shown, the rest are counted.
+ */
+static void
+echo_mismatch(struct loop_arguments *largs, struct connection *conn,
+              size_t mismatches, uint64_t offset) {
+    if(conn->cold->echo_mismatches == 0) {
+        DEBUG(DBG_WARNING,
+              "Connection %u: the echo differs from the data sent "
+              "within %d bytes at offset %" PRIu64 "\n",
+              (unsigned)conn->cold->connection_unique_id, ECHO_VERIFY_BLOCK,
+              offset);
+    }
+    conn->cold->echo_mismatches += mismatches;
+    conn->traffic_ongoing.echo_mismatches += mismatches;
+}
+
+/*
+ * The HTTP upgrade response has arrived: record the time since
+ * the upgrade request started to be sent (--latency-upgrade).
+ */
+static void
+record_upgrade_latency(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    int64_t latency = latency_units_per_second
+                      * (tk_now(TK_A) - conn->cold->latency.upgrade_started);
+    hdr_record_value(largs->upgrade_histogram_local, latency);
+    struct remote_latency *rl = remote_latency(largs, conn);
+    if(rl) hdr_record_value(rl->upgrade_histogram_local, latency);
+    struct remote_latency *gl = group_latency(largs, conn);
+    if(gl) hdr_record_value(gl->upgrade_histogram_local, latency);
+}
+
+/*
+ * Advance the TLS handshake. The handshake is timed from the first step
+ * which did not block on write, that is, since the TCP connection
+ * got established (--latency-handshake).
+ */
+static int
+ssl_handshake_step(TK_P_ struct connection *conn, int sockfd) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+
+    if(!ssl_setup(conn, sockfd, &largs->ssl)) return 0;
+
+    if(conn->cold->latency.handshake_started == 0.0
+       && !(conn->conn_blocked & CBLOCKED_ON_WRITE)) {
+        conn->cold->latency.handshake_started = tk_now(TK_A);
+    } else if(!(conn->conn_blocked & CBLOCKED_ON_INIT)
+       && largs->handshake_histogram_local
+       && conn->cold->latency.handshake_started > 0.0) {
+        int64_t latency =
+            latency_units_per_second
+            * (tk_now(TK_A) - conn->cold->latency.handshake_started);
+        hdr_record_value(largs->handshake_histogram_local, latency);
+        struct remote_latency *rl = remote_latency(largs, conn);
+        if(rl) hdr_record_value(rl->handshake_histogram_local, latency);
+        struct remote_latency *gl = group_latency(largs, conn);
+        if(gl) hdr_record_value(gl->handshake_histogram_local, latency);
+    }
+
+    return 1;
+}
+
+/*
+ * The --per-connection-stats keep the latency summary of each connection,
+ * as the --latency-per-connection histograms are drained as they go.
+ */
+static void
+record_connstats_latency(struct loop_arguments *largs,
+                         struct connection *conn, int64_t latency) {
+    if(!largs->connstats_ring) return;
+    conn->cold->latency.summary_count++;
+    conn->cold->latency.summary_sum += latency;
+    if(latency > conn->cold->latency.summary_max)
+        conn->cold->latency.summary_max = latency;
+}
 
-    atomic_increment(&largs->connections_counter);
-    largs->worker_connections_accepted++;
+/*
+ * --per-peer-stats: the marker latency of an accepted connection.
+ */
+static void
+record_peer_latency(struct loop_arguments *largs, struct connection *conn,
+                    int64_t latency) {
+    if(!largs->peer_table || conn->conn_type != CONN_INCOMING) return;
+    struct peer_stats *peer =
+        peer_table_entry(largs->peer_table, conn->cold->peer_index);
+    double seconds = latency / latency_units_per_second;
+    peer->latency_count++;
+    peer->latency_sum += seconds;
+    if(seconds > peer->latency_max) peer->latency_max = seconds;
+}
 
-    /* If channel lifetime is 0, close it right away. */
-    if(largs->params.channel_lifetime == 0.0) {
-        close(sockfd);
-        return;
+/*
+ * Unless --latency-per-connection is given, the marker latencies
+ * are recorded straight into the worker's histogram.
+ * With --idle-connections, the connection's histogram is allocated
+ * upon its first message.
+ */
+static struct hdr_histogram *
+marker_histogram(struct loop_arguments *largs, struct connection *conn) {
+    if(!conn->cold->latency.marker_histogram
+       && largs->params.latency_per_connection) {
+        conn->cold->latency.marker_histogram = take_marker_histogram(largs);
+        conn->cold->latency.marker_step = largs->marker_step;
+    } else if(conn->cold->latency.marker_histogram
+              && conn->cold->latency.marker_step != largs->marker_step) {
+        /* Recorded at an earlier rate, see worker_next_rate_step(). */
+        hdr_reset(conn->cold->latency.marker_histogram);
+        conn->cold->latency.marker_step = largs->marker_step;
     }
+    return conn->cold->latency.marker_histogram
+               ? conn->cold->latency.marker_histogram
+               : largs->marker_histogram_local;
+}
 
-    struct connection *conn = calloc(1, sizeof(*conn));
-    socklen_t addrlen = sizeof(conn->peer_name);
-    if(getpeername(sockfd, (struct sockaddr *)&conn->peer_name, &addrlen)
-       != 0) {
-        DEBUG(DBG_WARNING, "Can't getpeername(%d): %s", sockfd,
-              strerror(errno));
-        free(conn);
-        close(sockfd);
-        return;
+static void
+record_size_class_latency(struct loop_arguments *largs,
+                          struct connection *conn, int64_t latency) {
+    struct hdr_histogram **h =
+        &largs->size_class_histograms[conn->cold->latency.size_class];
+    if(!*h) {
+        *h = hdr_init_similar(largs->marker_histogram_local);
+        assert(*h);
     }
-    atomic_increment(&largs->incoming_established);
-    common_connection_init(TK_A_ conn, CONN_INCOMING, CSTATE_CONNECTED, sockfd);
+    hdr_record_value(*h, latency);
 }
 
 /*
- * Debug data by dumping it in a format escaping all the special
- * characters.
+ * Keep the message among the --latency-slowest if it is slower
+ * than the fastest of them. The (latency) is in --latency-resolution units.
  */
 static void
-debug_dump_data(const char *prefix, int fd, const void *data, size_t size,
-                ssize_t limit) {
-    debug_dump_data_highlight(prefix, fd, data, size, limit, 0, 0);
-}
-static void
-debug_dump_data_highlight(const char *prefix, int fd, const void *data,
-                          size_t size, ssize_t limit, size_t hl_offset,
-                          size_t hl_length) {
-    /*
-     * Do not show more than (limit) first bytes,
-     * or more than (-limit) last bytes of the buffer.
-     */
-    size_t original_size = size;
-    size_t preceding = 0;
-    size_t following = 0;
-    if(limit) {
-        if(limit > 0 && (size_t)limit < size) {
-            following = size - limit;
-            size = limit;
-        } else if((size_t)-limit < size) {
-            preceding = size + limit;
-            size = -limit;
-            data += preceding;
+record_slow_message(struct loop_arguments *largs, struct connection *conn,
+                    int64_t latency, double now) {
+    struct engine_slow_message *heap = largs->slowest;
+    size_t n = largs->n_slowest;
+    double seconds = latency / latency_units_per_second;
+    size_t pos;
+
+    if(n < (size_t)largs->params.latency_slowest) {
+        /* Sift the new one up from the bottom. */
+        for(pos = n; pos > 0 && heap[(pos - 1) / 2].latency > seconds;
+            pos = (pos - 1) / 2) {
+            heap[pos] = heap[(pos - 1) / 2];
+        }
+        largs->n_slowest++;
+    } else if(seconds > heap[0].latency) {
+        /* Replace the fastest one and sift it down. */
+        for(pos = 0;;) {
+            size_t child = 2 * pos + 1;
+            if(child >= n) break;
+            if(child + 1 < n && heap[child + 1].latency < heap[child].latency)
+                child++;
+            if(heap[child].latency >= seconds) break;
+            heap[pos] = heap[child];
+            pos = child;
         }
+    } else {
+        return;
     }
 
-    char stack_buffer[4000];
-    char *buffer = stack_buffer;
-    size_t buf_size = PRINTABLE_DATA_SUGGESTED_BUFFER_SIZE(size);
+    const non_atomic_traffic_stats *reported = &conn->cold->traffic_reported;
+    non_atomic_wide_t sent =
+        reported->bytes_sent + conn->traffic_ongoing.bytes_sent;
+    non_atomic_wide_t rcvd =
+        reported->bytes_rcvd + conn->traffic_ongoing.bytes_rcvd;
+    heap[pos] = (struct engine_slow_message){
+        .latency = seconds,
+        .connection_age = now - conn->cold->latency.connection_initiated,
+        .remote_index = conn->conn_type == CONN_OUTGOING
+                            ? conn->cold->remote_index
+                            : -1,
+        .connection_uid = conn->cold->connection_unique_id,
+        .bytes_in_flight = sent > rcvd ? sent - rcvd : 0};
+}
 
-    if(buf_size > sizeof(stack_buffer)) {
-        /* This is used only for debugging of an otherwise expensive dataset.
-         * We could have cached the malloc result, but that'd be a non-local
-         * complication, yielding negligible performance benefit
-         * (after all, we're here to print a multi-kilobyte message dump).
-         */
-        buffer = malloc(buf_size);
-        assert(buffer);
+static void
+record_marker_latency(TK_P_ struct loop_arguments *largs,
+                      struct connection *conn, int64_t latency_ns) {
+    /* The markers stamped by a peer are on its clock, see --clock-sync. */
+    latency_ns += largs->params.clock_offset_ns;
+    int64_t latency = latency_ns * (latency_units_per_second / 1e9);
+    if(latency < 0) latency = 0; /* Cached or skewed clocks */
+    TK_PROBE2(latency, tk_fd(&conn->watcher), latency_ns);
+    if(hdr_record_value(marker_histogram(largs, conn), latency)
+       == false) {
+        fprintf(stderr,
+                "Latency value %g is too large, "
+                "can't record.\n",
+                latency / latency_units_per_second);
     }
+    record_connstats_latency(largs, conn, latency);
+    record_peer_latency(largs, conn, latency);
+    struct remote_latency *rl = remote_latency(largs, conn);
+    if(rl) hdr_record_value(rl->marker_histogram_local, latency);
+    struct remote_latency *gl = group_latency(largs, conn);
+    if(gl) hdr_record_value(gl->marker_histogram_local, latency);
+    if(largs->params.latency_by_size)
+        record_size_class_latency(largs, conn, latency);
+    if(largs->slowest) record_slow_message(largs, conn, latency, tk_now(TK_A));
+    if(conn->conn_type == CONN_OUTGOING)
+        remote_health_latency(largs, conn->cold->remote_index,
+                              latency / latency_units_per_second);
+}
 
-    char fdnumbuf[16];
-    if(fd >= 0) {
-        snprintf(fdnumbuf, sizeof(fdnumbuf), "%d, ", fd);
-    } else {
-        fdnumbuf[0] = '\0';
+/*
+ * Check the marker sequence against the earlier ones from the same
+ * publisher. Returns 0 if the message has been delivered already.
+ */
+static int
+fanout_track(struct connection *conn, uint32_t uid, uint32_t sequence) {
+    struct fanout_sources *fs = conn->cold->latency.fanout;
+    struct fanout_source *src = NULL;
+
+    for(unsigned n = 0; fs && n < fs->count; n++) {
+        unsigned i = (fs->last + n) % fs->count;
+        if(fs->sources[i].uid == uid) {
+            src = &fs->sources[i];
+            fs->last = i;
+            break;
+        }
     }
-    fprintf(stderr, "%s%s(%s%ld): %s%s[%s%s%s]%s%s\n", tcpkali_clear_eol(),
-            prefix, fdnumbuf, (long)original_size, preceding ? "..." : "",
-            tk_attr(*prefix == 'S' ? TKA_SndBrace : TKA_RcvBrace),
-            tk_attr(TKA_NORMAL),
-            printable_data_highlight(buffer, buf_size, data, size, 0, hl_offset,
-                                     hl_length),
-            tk_attr(*prefix == 'S' ? TKA_SndBrace : TKA_RcvBrace),
-            tk_attr(TKA_NORMAL), following ? "..." : "");
-    if(buffer != stack_buffer) free(buffer);
-}
 
-static enum lb_return_value {
-    LB_UNLIMITED, /* Not limiting bandwidth, proceed. */
-    LB_PROCEED,   /* Use pacefier_moved() afterwards. */
-    LB_LOCKSTEP,  /* Proceed but pause right after. */
-    LB_GO_SLEEP,  /* Not allowed to move data.        */
-} limit_channel_bandwidth(TK_P_ struct connection *conn,
-                          size_t *suggested_move_size, int event) {
-    struct pacefier *pace = NULL;
-    bandwidth_limit_t limit = {0, 0};
-    enum lb_return_value rvalue = LB_UNLIMITED;
+    if(!src) {
+        if(!fs || fs->count == fs->size) {
+            unsigned size = fs ? 2 * fs->size : 4;
+            fs = realloc(fs, sizeof(*fs) + size * sizeof(fs->sources[0]));
+            assert(fs);
+            if(!conn->cold->latency.fanout) {
+                fs->delivered = 0;
+                fs->count = 0;
+            }
+            fs->size = size;
+            conn->cold->latency.fanout = fs;
+        }
+        /* The messages published before this one are not expected. */
+        fs->last = fs->count++;
+        src = &fs->sources[fs->last];
+        src->uid = uid;
+        src->next = sequence + 1;
+        src->seen = 1;
+        fs->delivered++;
+        return 1;
+    }
 
-    if(event & TK_WRITE) {
-        limit = conn->send_limit;
-        pace = &conn->send_pace;
-    } else if(event & TK_READ) {
-        limit = conn->recv_limit;
-        pace = &conn->recv_pace;
+    if((int32_t)(sequence - src->next) >= 0) {
+        uint32_t gap = sequence - src->next;
+        conn->traffic_ongoing.msgs_lost += gap;
+        src->seen = gap < 63 ? (src->seen << (gap + 1)) | 1 : 1;
+        src->next = sequence + 1;
     } else {
-        assert(event & (TK_WRITE | TK_READ));
+        uint32_t back = src->next - 1 - sequence;
+        if(back < 64 && (src->seen & ((uint64_t)1 << back))) {
+            conn->traffic_ongoing.msgs_duplicated++;
+            return 0;
+        }
+        /* Counted as lost when the later ones came. */
+        if(back < 64) src->seen |= (uint64_t)1 << back;
+        conn->traffic_ongoing.msgs_reordered++;
     }
+    fs->delivered++;
+    return 1;
+}
 
-    double bw = limit.bytes_per_second;
-    if(bw < 0.0) {
-        return LB_UNLIMITED; /* Limit not set, don't limit. */
+/*
+ * A complete binary marker has been received: record its latency and
+ * check its sequence number against the previous marker from the same
+ * connection uid, or from the same publisher with --fanout.
+ */
+static void
+record_binary_marker(TK_P_ struct loop_arguments *largs,
+                     struct connection *conn,
+                     const struct message_marker_binary *mb) {
+    struct message_marker_parser_state *mp =
+        &conn->cold->latency.marker_parser;
+    uint32_t uid = le32toh(mb->uid);
+    uint32_t sequence = le32toh(mb->sequence);
+
+    conn->traffic_ongoing.msgs_rcvd++;
+    if(largs->params.fanout) {
+        /* The duplicates' latency is not that of a delivery. */
+        if(fanout_track(conn, uid, sequence))
+            record_marker_latency(
+                TK_A_ largs, conn,
+                tk_clock_elapsed_ns(&largs->clock, tk_now(TK_A),
+                                    le64toh(mb->timestamp)));
+        return;
+    }
+    record_marker_latency(TK_A_ largs, conn,
+                          tk_clock_elapsed_ns(&largs->clock, tk_now(TK_A),
+                                              le64toh(mb->timestamp)));
+
+    if(mp->seen_binary && mp->last_uid == uid) {
+        uint32_t expected = mp->last_sequence + 1;
+        if(sequence == expected) {
+            /* In order */
+        } else if((int32_t)(sequence - expected) > 0) {
+            conn->traffic_ongoing.msgs_lost += sequence - expected;
+        } else {
+            conn->traffic_ongoing.msgs_reordered++;
+            return; /* Keep waiting for the (expected) one. */
+        }
     }
+    mp->seen_binary = 1;
+    mp->last_uid = uid;
+    mp->last_sequence = sequence;
+}
 
-    size_t smallest_block_to_move = limit.minimal_move_size;
-    size_t allowed_to_move = pacefier_allow(pace, tk_now(TK_A));
+static void
+latency_record_incoming_ts(TK_P_ struct connection *conn, char *buf,
+                           size_t size) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
 
-    if(allowed_to_move < *suggested_move_size) {
-        double delay;
+    if(!conn->cold->latency.sent_timestamps && !largs->params.message_marker) return;
 
-        if(event & TK_READ) {
-            if(allowed_to_move < smallest_block_to_move) {
-                /*   allowed     smallest|suggested
-                   |------^-----------^-------^-------> */
-                delay = pacefier_when_allowed(pace, tk_now(TK_A), 1460);
-                *suggested_move_size = 0;
-                rvalue = LB_GO_SLEEP;
+    const uint8_t *lm = conn->cold->latency.sbmh_data;
+    size_t lm_size = conn->cold->latency.sbmh_size;
+    unsigned num_markers_found = 0;
+    unsigned num_markers_timed = 0; /* \{message.marker} */
+
+    for(; size > 0;) {
+        switch(conn->cold->latency.marker_parser.state) {
+        case MP_DISENGAGED:
+            break;
+        case MP_SLURPING_BINARY: {
+            struct message_marker_parser_state *mp =
+                &conn->cold->latency.marker_parser;
+            size_t want = sizeof(mp->collected_binary) - mp->collected_size;
+            size_t take = size < want ? size : want;
+            memcpy((char *)&mp->collected_binary + mp->collected_size, buf,
+                   take);
+            mp->collected_size += take;
+            buf += take;
+            size -= take;
+            if(take < want) continue;
+            mp->state = MP_DISENGAGED;
+            record_binary_marker(TK_A_ largs, conn, &mp->collected_binary);
+            num_markers_timed++;
+        } break;
+        case MP_SLURPING_DIGITS:
+            if(*buf != '.') {
+                conn->cold->latency.marker_parser.collected_digits <<= 4;
+                conn->cold->latency.marker_parser.collected_digits |= nibble(*buf);
+                buf++;
+                size--;
+                continue;
             } else {
-                /*
-                 * If we're reading, there's no gain in reading many
-                 * tiny chunks: the packets on the wire will still
-                 * very likely be the same, as TCP stacks don't like
-                 * sending too small window updates to the sender.
-                 * So if the reading allowance is too small, make it
-                 * large enough still to batch reads.
-                 */
-                if(allowed_to_move > 1460)
-                    *suggested_move_size = allowed_to_move;
-                else
-                    *suggested_move_size = 1460;
-                return LB_PROCEED;
+                conn->cold->latency.marker_parser.state = MP_DISENGAGED;
+                conn->traffic_ongoing.msgs_rcvd++;
+                num_markers_timed++;
+                record_marker_latency(
+                    TK_A_ largs, conn, tk_clock_elapsed_ns(
+                              &largs->clock, tk_now(TK_A),
+                              conn->cold->latency.marker_parser.collected_digits));
             }
-        } else {
-            if(allowed_to_move < smallest_block_to_move) {
-                /*   allowed     smallest|suggested
-                   |------^-----------^-------^-------> */
-                delay = (double)(smallest_block_to_move - allowed_to_move) / bw;
-                *suggested_move_size = 0;
-                rvalue = LB_GO_SLEEP;
+        }
+        size_t analyzed =
+            tk_scan_feed(conn->cold->latency.sbmh_marker_ctx, conn->cold->latency.sbmh_occ, lm,
+                      lm_size, (unsigned char *)buf, size);
+        if(conn->cold->latency.sbmh_marker_ctx->found == sbmh_true) {
+            buf += analyzed;
+            size -= analyzed;
+            if(conn->cold->latency.marker_binary) {
+                conn->cold->latency.marker_parser.state = MP_SLURPING_BINARY;
+                conn->cold->latency.marker_parser.collected_size = 0;
+            } else if(largs->params.message_marker) {
+                conn->cold->latency.marker_parser.state = MP_SLURPING_DIGITS;
+                conn->cold->latency.marker_parser.collected_digits = 0;
+                /* The whole timestamp is here, decode it at once. */
+                uint64_t ts;
+                if(size > 16 && buf[16] == '.' && tk_scan_hex16(buf, &ts)) {
+                    conn->cold->latency.marker_parser.collected_digits = ts;
+                    buf += 16;
+                    size -= 16;
+                }
             } else {
-                /*   smallest  allowed  suggested
-                   |------^--------^-------^-------> */
-                size_t excess = (allowed_to_move % smallest_block_to_move);
-                delay = (double)(smallest_block_to_move - excess) / bw;
-                *suggested_move_size = allowed_to_move - excess;
-                rvalue = LB_LOCKSTEP;
+                num_markers_found++;
             }
+            sbmh_reset(conn->cold->latency.sbmh_marker_ctx);
+        } else {
+            break;
         }
+    }
 
-        if(delay < 0.001) delay = 0.001;
+    if(largs->params.message_marker) {
+        pipeline_markers_answered(TK_A_ conn, num_markers_timed);
+        return;
+    }
 
-        connection_timer_refresh(TK_A_ conn, delay);
+    /*
+     * Skip the necessary numbers of markers.
+     */
+    if(conn->cold->latency.lm_occurrences_skip) {
+        if(num_markers_found <= conn->cold->latency.lm_occurrences_skip) {
+            conn->cold->latency.lm_occurrences_skip -= num_markers_found;
+            return;
+        } else {
+            num_markers_found -= conn->cold->latency.lm_occurrences_skip;
+            conn->cold->latency.lm_occurrences_skip = 0;
+        }
+    }
 
-        return rvalue;
+    /*
+     * Now, for all found markers extract and use the corresponding
+     * end-to-end message latency.
+     */
+    if(!num_markers_found) return;
+    pipeline_markers_answered(TK_A_ conn, num_markers_found);
+    if(record_replies_latency(TK_A_ conn, num_markers_found) != 0) {
+        fprintf(stderr,
+                "More messages received than sent. "
+                "Choose a different --latency-marker.\n"
+                "Use -d option to dump received message data.\n");
+        exit(1);
     }
+}
 
-    return LB_PROCEED;
+/*
+ * Record the latency of the (replies) to the oldest messages sent.
+ * Returns -1 if more replies are received than the messages sent.
+ */
+static int
+record_replies_latency(TK_P_ struct connection *conn, unsigned replies) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct ts_ring *ring = conn->cold->latency.sent_timestamps;
+    struct ts_ring *uncorrected = conn->cold->latency.uncorrected_timestamps;
+    /* The kernel receive time, see --latency-timestamping. */
+    double now = conn->timestamping && largs->scratch_recv_ts > 0.0
+                     ? largs->scratch_recv_ts
+                     : tk_now(TK_A);
+    uint32_t now_tick = ts_ring_tick(ring, now);
+    const double ticks_to_units =
+        latency_units_per_second / TS_RING_TICKS_PER_SECOND;
+    struct remote_latency *rl = remote_latency(largs, conn);
+    struct remote_latency *gl = group_latency(largs, conn);
+    unsigned sample = largs->params.latency_sample;
+    while(replies--) {
+        if(sample > 1) {
+            /* See latency_record_outgoing_ts(). */
+            if(conn->cold->latency.sample_rcvd++ % sample) continue;
+            if(conn->cold->latency.samples_skip) {
+                conn->cold->latency.samples_skip--;
+                continue;
+            }
+        }
+        if(!ts_ring_empty(ring)) {
+            uint32_t elapsed = ts_ring_pop_elapsed(ring, now_tick);
+            int64_t latency = elapsed * ticks_to_units;
+            TK_PROBE2(latency, tk_fd(&conn->watcher),
+                      (int64_t)elapsed * 1000000000
+                          / TS_RING_TICKS_PER_SECOND);
+            if(hdr_record_value(marker_histogram(largs, conn), latency)
+               == false) {
+                fprintf(stderr,
+                        "Latency value %g is too large, "
+                        "can't record.\n",
+                        (double)elapsed / TS_RING_TICKS_PER_SECOND);
+            }
+            record_connstats_latency(largs, conn, latency);
+            record_peer_latency(largs, conn, latency);
+            if(rl) hdr_record_value(rl->marker_histogram_local, latency);
+            if(gl) hdr_record_value(gl->marker_histogram_local, latency);
+            if(largs->params.latency_by_size)
+                record_size_class_latency(largs, conn, latency);
+            if(largs->slowest)
+                record_slow_message(largs, conn, latency, now);
+            if(uncorrected) {
+                /* Both rings have the same base time, and thus ticks. */
+                elapsed = ts_ring_pop_elapsed(uncorrected, now_tick);
+                hdr_record_value(largs->marker_uncorrected_histogram_local,
+                                 elapsed * ticks_to_units);
+            }
+        } else {
+            return -1;
+        }
+    }
+    return 0;
 }
 
+#ifdef HAVE_LIBZ
+/*
+ * Inflate a piece of the permessage-deflate compressed message
+ * to look for the latency markers in it. The server may take over
+ * the compression context, so the stream lives as long as the connection.
+ */
 static void
-passive_websocket_cb(TK_P_ tk_io *w, int revents) {
+websocket_inflate_scan(TK_P_ struct connection *conn, const uint8_t *data,
+                       size_t size) {
     struct loop_arguments *largs = tk_userdata(TK_A);
-    struct connection *conn =
-        (struct connection *)((char *)w - offsetof(struct connection, watcher));
-    char out_buf[200];
-    size_t response_size = 0;
+    z_stream *zs = conn->cold->ws_inflate;
+    unsigned char out[16384];
+
+    if(!zs) {
+        zs = calloc(1, sizeof(*zs));
+        assert(zs);
+        int ret = inflateInit2(zs, -15);
+        assert(ret == Z_OK);
+        conn->cold->ws_inflate = zs;
+    }
 
-    if(conn->conn_blocked & CBLOCKED_ON_INIT) {
-        if(((conn->conn_blocked & CBLOCKED_ON_READ) && (revents & TK_READ)) ||
-           ((conn->conn_blocked & CBLOCKED_ON_WRITE) && (revents & TK_WRITE))) {
-            if(conn->conn_blocked & CBLOCKED_ON_READ) {
-                revents &= ~TK_READ;
+    zs->next_in = (unsigned char *)data;
+    zs->avail_in = size;
+    do {
+        zs->next_out = out;
+        zs->avail_out = sizeof(out);
+        int ret = inflate(zs, Z_SYNC_FLUSH);
+        if(ret != Z_OK && ret != Z_BUF_ERROR) {
+            DEBUG(DBG_WARNING, "Can't inflate WebSocket message: %s\n",
+                  zs->msg ? zs->msg : "corrupted data");
+            inflateReset(zs);
+            return;
+        }
+        latency_record_incoming_ts(TK_A_ conn, (char *)out,
+                                   sizeof(out) - zs->avail_out);
+    } while(zs->avail_out == 0);
+}
+#endif
+
+/*
+ * Look for the latency markers in the payload of the incoming frames only,
+ * skipping the HTTP response and the frame headers by their length.
+ * A marker may not span messages. The messages are counted here unless
+ * the \{message.marker}s count them.
+ */
+static void
+websocket_scan_incoming(TK_P_ struct connection *conn, char *buf,
+                        size_t size) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct websocket_parser *wp = &conn->cold->ws_parser;
+    uint8_t *ptr = (uint8_t *)buf;
+    /* The compressed messages are only inflated to find the markers. */
+    int latency_scan_wanted = conn->cold->latency.sent_timestamps
+                              || largs->params.message_marker;
+
+    for(;;) {
+        uint8_t *payload;
+        size_t payload_size;
+        switch(websocket_parse(wp, &ptr, &size, &payload, &payload_size)) {
+        case WSPE_NEED_MORE_DATA:
+            return;
+        case WSPE_PAYLOAD:
+            if(!wp->compressed) {
+                latency_record_incoming_ts(TK_A_ conn, (char *)payload,
+                                           payload_size);
+            } else if(latency_scan_wanted) {
+#ifdef HAVE_LIBZ
+                websocket_inflate_scan(TK_A_ conn, payload, payload_size);
+#endif
             }
-            if(conn->conn_blocked & CBLOCKED_ON_WRITE) {
-                revents &= ~TK_WRITE;
+            break;
+        case WSPE_MESSAGE_END:
+            if(!largs->params.message_marker)
+                conn->traffic_ongoing.msgs_rcvd++;
+#ifdef HAVE_LIBZ
+            if(wp->compressed && latency_scan_wanted) {
+                /* RFC 7692, 7.2.2: restore the flushed block tail. */
+                static const uint8_t tail[4] = {0x00, 0x00, 0xff, 0xff};
+                websocket_inflate_scan(TK_A_ conn, tail, sizeof(tail));
             }
-            if(ssl_setup(conn, 0, largs->params.ssl_cert, largs->params.ssl_key)) {
-                if(conn->conn_blocked & CBLOCKED_ON_INIT) {
-                    conn->conn_wish |= CW_READ_INTEREST;
-                    conn->conn_wish |= CW_WRITE_INTEREST;
-                    update_io_interest(TK_A_ conn);
-                    return;
-                }
-            } else {
-                close_connection(TK_A_ conn, CCR_REMOTE);
-                return;
+#endif
+            if(conn->cold->latency.sbmh_marker_ctx)
+                sbmh_reset(conn->cold->latency.sbmh_marker_ctx);
+            break;
+        case WSPE_PROTOCOL_ERROR:
+            DEBUG(DBG_WARNING,
+                  "Unexpected WebSocket frame, "
+                  "treating the rest as a byte stream\n");
+            conn->ws_frames = 0;
+            latency_record_incoming_ts(TK_A_ conn, (char *)ptr, size);
+            return;
+        }
+    }
+}
+
+/*
+ * A --pipeline request is answered, let the next one out.
+ */
+static void
+pipeline_answered(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    if(largs->params.think_time > 0.0)
+        conn->cold->think_until = tk_now(TK_A) + largs->params.think_time;
+    if(conn->cold->pipelined_bytes > conn->data.single_message_size)
+        conn->cold->pipelined_bytes -= conn->data.single_message_size;
+    else
+        conn->cold->pipelined_bytes = 0;
+    if(conn->conn_wish & CW_WRITE_PIPELINED) {
+        conn->conn_wish &= ~CW_WRITE_PIPELINED;
+        update_io_interest(TK_A_ conn);
+    }
+}
+
+/*
+ * Without the protocol replies or the --framing frames to count,
+ * the latency markers coming back answer the requests.
+ */
+static void
+pipeline_markers_answered(TK_P_ struct connection *conn, unsigned markers) {
+    if(!conn->pipelined || conn->http_responses || conn->resp_replies
+       || conn->mqtt_packets || conn->lenprefix_frames
+       || conn->framer_responses)
+        return;
+    while(markers--) pipeline_answered(TK_A_ conn);
+}
+
+/*
+ * The replies can not be told apart anymore: stop limiting the requests.
+ */
+static void
+pipeline_stop(TK_P_ struct connection *conn) {
+    conn->pipelined = 0;
+    if(conn->conn_wish & CW_WRITE_PIPELINED) {
+        conn->conn_wish &= ~CW_WRITE_PIPELINED;
+        update_io_interest(TK_A_ conn);
+    }
+}
+
+/*
+ * Count the --http responses. Each response answers the oldest request
+ * in flight, and its latency is recorded unless the latency markers are
+ * looked for in the response bodies instead.
+ */
+static void
+http_scan_incoming(TK_P_ struct connection *conn, char *buf, size_t size) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    uint8_t *ptr = (uint8_t *)buf;
+    int scan_bodies = conn->cold->latency.sbmh_marker_ctx != NULL;
+
+    for(;;) {
+        uint8_t *body;
+        size_t body_size;
+        switch(http_parse(&conn->cold->http_parser, &ptr, &size, &body,
+                          &body_size)) {
+        case HTTPE_NEED_MORE_DATA:
+            return;
+        case HTTPE_BODY:
+            if(scan_bodies)
+                latency_record_incoming_ts(TK_A_ conn, (char *)body,
+                                           body_size);
+            break;
+        case HTTPE_RESPONSE_END:
+            if(!largs->params.message_marker)
+                conn->traffic_ongoing.msgs_rcvd++;
+            if(scan_bodies) {
+                sbmh_reset(conn->cold->latency.sbmh_marker_ctx);
+            } else if(conn->cold->latency.sent_timestamps) {
+                /* Unsolicited, e.g. answering the --first-message. */
+                (void)record_replies_latency(TK_A_ conn, 1);
             }
-        } else {
+            pipeline_answered(TK_A_ conn);
+            break;
+        case HTTPE_PROTOCOL_ERROR:
+            DEBUG(DBG_WARNING,
+                  "Unexpected HTTP response, "
+                  "treating the rest as a byte stream\n");
+            conn->http_responses = 0;
+            pipeline_stop(TK_A_ conn);
+            if(scan_bodies)
+                latency_record_incoming_ts(TK_A_ conn, (char *)ptr, size);
             return;
         }
     }
-    if(revents & TK_WRITE) {
-        if(conn->conn_blocked & CBLOCKED_ON_READ) {
+}
+
+/*
+ * Count the --resp replies. Each reply answers the oldest command
+ * in flight, which is how the Redis servers answer the pipelined commands.
+ */
+static void
+resp_scan_incoming(TK_P_ struct connection *conn, char *buf, size_t size) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    uint8_t *ptr = (uint8_t *)buf;
+
+    for(;;) {
+        switch(resp_parse(&conn->cold->resp_parser, &ptr, &size)) {
+        case RESPE_NEED_MORE_DATA:
+            return;
+        case RESPE_REPLY_END:
+            conn->traffic_ongoing.msgs_rcvd++;
+            if(conn->cold->resp_parser.error_reply)
+                DEBUG(DBG_DETAIL, "RESP error reply received\n");
+            if(conn->cold->latency.sent_timestamps)
+                (void)record_replies_latency(TK_A_ conn, 1);
+            pipeline_answered(TK_A_ conn);
+            break;
+        case RESPE_PROTOCOL_ERROR:
+            DEBUG(DBG_ERROR, "Unexpected RESP reply, not counting replies\n");
+            conn->resp_replies = 0;
+            pipeline_stop(TK_A_ conn);
             return;
         }
-        conn->conn_blocked &= ~CBLOCKED_ON_WRITE;
     }
-    if(revents & TK_READ) {
-        ssize_t rd = 0;
-        if(largs->params.ssl_enable) {
-#ifdef HAVE_OPENSSL
-            if(conn->conn_blocked & CBLOCKED_ON_WRITE) {
-                return;
-            }
-            conn->conn_blocked &= ~CBLOCKED_ON_READ;
-            rd = SSL_read(conn->ssl_fd, largs->scratch_recv_buf,
-                          sizeof(largs->scratch_recv_buf));
-            switch(SSL_get_error(conn->ssl_fd, rd)) {
-            case SSL_ERROR_NONE:
-                break;
-            case SSL_ERROR_WANT_WRITE:
-                conn->conn_blocked |= CBLOCKED_ON_WRITE;
-                return;
-            case SSL_ERROR_WANT_READ:
-                conn->conn_blocked |= CBLOCKED_ON_READ;
-                return;
-            case SSL_ERROR_ZERO_RETURN:
-            default:
-                rd = -1;  // Close it
-            }
-#endif
-        } else {
-            rd = read(tk_fd(w), largs->scratch_recv_buf,
-                      sizeof(largs->scratch_recv_buf));
-        }
-        switch(rd) {
-        case -1:
-            switch(errno) {
-            case EAGAIN:
-                return;
-            default:
-                close_connection(TK_A_ conn, CCR_REMOTE);
-                return;
-            }
-        /* Fall through */
-        case 0:
-            close_connection(TK_A_ conn, CCR_REMOTE);
-            return;
-        default:
-            largs->scratch_recv_last_size = rd; /* Only update on >0 data */
-            conn->traffic_ongoing.num_reads++;
-            conn->traffic_ongoing.bytes_rcvd += rd;
-            if(largs->params.dump_setting & DS_DUMP_ALL_IN
-               || ((largs->params.dump_setting & DS_DUMP_ONE_IN)
-                   && largs->dump_connect_fd == tk_fd(w))) {
-                debug_dump_data("Rcv", tk_fd(w), largs->scratch_recv_buf, rd,
-                                0);
-            }
-            latency_record_incoming_ts(TK_A_ conn, largs->scratch_recv_buf, rd);
+}
 
-            /*
-             * Attempt to detect websocket key in HTTP and respond.
-             */
-            switch(http_detect_websocket(largs->scratch_recv_buf, rd, out_buf,
-                                         sizeof(out_buf), &response_size)) {
-            case HDW_NOT_ENOUGH_DATA:
-                return;
-            case HDW_WEBSOCKET_DETECTED:
-                conn->ws_state = WSTATE_WS_ESTABLISHED;
+/*
+ * Count the --mqtt PUBACK and PUBLISH packets. Each PUBACK answers the
+ * oldest QoS 1 PUBLISH in flight, in the order the brokers acknowledge
+ * them. The latency markers are looked for in the PUBLISH payloads
+ * delivered by the --mqtt-subscribe, if asked to.
+ */
+static void
+mqtt_scan_incoming(TK_P_ struct connection *conn, char *buf, size_t size) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct mqtt_parser *mp = &conn->cold->mqtt.parser;
+    uint8_t *ptr = (uint8_t *)buf;
+    int scan_payloads = conn->cold->latency.sbmh_marker_ctx != NULL;
+
+    for(;;) {
+        uint8_t *payload;
+        size_t payload_size;
+        switch(mqtt_parse(mp, &ptr, &size, &payload, &payload_size)) {
+        case MQTTE_NEED_MORE_DATA:
+            return;
+        case MQTTE_PAYLOAD:
+            if(scan_payloads)
+                latency_record_incoming_ts(TK_A_ conn, (char *)payload,
+                                           payload_size);
+            break;
+        case MQTTE_PACKET_END:
+            switch(mp->type) {
+            case MQTT_CONNACK:
+                if(mp->reason)
+                    DEBUG(DBG_ERROR, "MQTT connection refused, code %u\n",
+                          mp->reason);
+                break;
+            case MQTT_SUBACK:
+                if(mp->reason >= MQTT_REASON_FAILURE)
+                    DEBUG(DBG_ERROR, "MQTT subscription refused, code %u\n",
+                          mp->reason);
+                break;
+            case MQTT_PUBACK:
+                conn->traffic_ongoing.msgs_rcvd++;
+                if(mp->reason >= MQTT_REASON_FAILURE)
+                    DEBUG(DBG_DETAIL, "MQTT PUBLISH refused, code %u\n",
+                          mp->reason);
+                if(conn->cold->latency.sent_timestamps)
+                    (void)record_replies_latency(TK_A_ conn, 1);
+                pipeline_answered(TK_A_ conn);
+                break;
+            case MQTT_PUBLISH:
+                conn->traffic_ongoing.msgs_rcvd++;
+                if(scan_payloads)
+                    sbmh_reset(conn->cold->latency.sbmh_marker_ctx);
+                break;
+            default: /* PINGRESP */
                 break;
-            case HDW_TRUNCATED_INPUT:
-            case HDW_UNEXPECTED_ERROR:
-                close_connection(TK_A_ conn, CCR_DATA);
-                return;
             }
             break;
+        case MQTTE_PROTOCOL_ERROR:
+            DEBUG(DBG_ERROR, "Unexpected MQTT packet, not counting packets\n");
+            conn->mqtt_packets = 0;
+            pipeline_stop(TK_A_ conn);
+            return;
         }
     }
-    if((conn->ws_state == WSTATE_WS_ESTABLISHED) && !conn->conn_blocked) {
-        if(!response_size) {
-            switch(http_detect_websocket(largs->scratch_recv_buf,
-                                  largs->scratch_recv_last_size, out_buf,
-                                  sizeof(out_buf), &response_size)) {
-            case HDW_NOT_ENOUGH_DATA:
-            case HDW_WEBSOCKET_DETECTED:
-                break;
-            case HDW_TRUNCATED_INPUT:
-            case HDW_UNEXPECTED_ERROR:
-                close_connection(TK_A_ conn, CCR_DATA);
-                return;
-            }
-        }
-        if(largs->params.ssl_enable) {
-#ifdef HAVE_OPENSSL
-            int wrote = SSL_write(conn->ssl_fd, out_buf, response_size);
-            switch(SSL_get_error(conn->ssl_fd, wrote)) {
-            case SSL_ERROR_NONE:
-                break;
-            case SSL_ERROR_WANT_WRITE:
-                conn->conn_blocked |= CBLOCKED_ON_WRITE;
-                return;
-            case SSL_ERROR_WANT_READ:
-                conn->conn_blocked |= CBLOCKED_ON_READ;
-                return;
-            case SSL_ERROR_ZERO_RETURN:
-            default:
-                wrote = -1;  // Close it
-            }
-            if(wrote != (ssize_t)response_size) {
-                close_connection(TK_A_ conn, CCR_DATA);
-                return;
-            }
-#endif
-        } else {
-            if(write(tk_fd(w), out_buf, response_size)
-               != (ssize_t)response_size) {
-                close_connection(TK_A_ conn, CCR_DATA);
-                return;
+}
+
+/*
+ * Count the --framing lenprefix frames, skipping from frame to frame
+ * by their length. Each frame answers the oldest message in flight,
+ * unless the latency markers are looked for in the frame payloads instead.
+ */
+static void
+lenprefix_scan_incoming(TK_P_ struct connection *conn, char *buf,
+                        size_t size) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    uint8_t *ptr = (uint8_t *)buf;
+    int scan_payloads = conn->cold->latency.sbmh_marker_ctx != NULL;
+
+    for(;;) {
+        uint8_t *payload;
+        size_t payload_size;
+        switch(lenprefix_parse(&conn->cold->lenprefix_parser, &ptr, &size,
+                               &payload, &payload_size)) {
+        case LPE_NEED_MORE_DATA:
+            return;
+        case LPE_PAYLOAD:
+            if(scan_payloads)
+                latency_record_incoming_ts(TK_A_ conn, (char *)payload,
+                                           payload_size);
+            break;
+        case LPE_FRAME_END:
+            if(!largs->params.message_marker)
+                conn->traffic_ongoing.msgs_rcvd++;
+            if(scan_payloads) {
+                sbmh_reset(conn->cold->latency.sbmh_marker_ctx);
+            } else if(conn->cold->latency.sent_timestamps) {
+                /* Unsolicited frames are not timed. */
+                (void)record_replies_latency(TK_A_ conn, 1);
             }
+            pipeline_answered(TK_A_ conn);
+            break;
         }
-        int want_events = TK_READ | TK_WRITE;
-#ifdef USE_LIBUV
-        uv_poll_start(&conn->watcher, want_events, connection_cb_uv);
-#else
-        ev_io_stop(TK_A_ w);
-        ev_io_init(&conn->watcher, connection_cb, tk_fd(w), want_events);
-        ev_io_start(TK_A_ & conn->watcher);
-#endif
     }
 }
 
+/*
+ * A --framer response has ended: it answers the oldest message in flight,
+ * unless the plugin has matched it to its request and timed it itself.
+ */
 static void
-update_io_interest(TK_P_ struct connection *conn) {
-    int events = 0;
-    /* Remove read or write wish, if we don't want them */
-    events |= (conn->conn_wish & CW_READ_INTEREST) ? TK_READ : 0;
-    events |= (conn->conn_wish & CW_WRITE_INTEREST) ? TK_WRITE : 0;
-    /* Remove read or write wish, if we are blocked on them */
-    events &= ~((conn->conn_wish & CW_READ_BLOCKED) ? TK_READ : 0);
-    events &= ~((conn->conn_wish & (CW_WRITE_BLOCKED | CW_WRITE_DELAYED))
-                ? TK_WRITE : 0);
+framer_response_end(TK_P_ struct connection *conn, int scan_payloads) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    const struct tcpkali_framer *framer = largs->params.framer;
+    struct ts_ring *ring = conn->cold->latency.sent_timestamps;
+    int64_t latency_ns;
+
+    if(!largs->params.message_marker) conn->traffic_ongoing.msgs_rcvd++;
+    if(scan_payloads) {
+        sbmh_reset(conn->cold->latency.sbmh_marker_ctx);
+    } else if(framer->on_response
+              && framer->on_response(conn->cold->framer_state,
+                                     tk_now(TK_A) * 1e9, &latency_ns)
+                     == 1) {
+        record_marker_latency(TK_A_ largs, conn, latency_ns);
+        /* The request is answered; its timestamp is not needed anymore. */
+        if(ring && !ts_ring_empty(ring)) (void)ts_ring_pop_elapsed(ring, 0);
+        ring = conn->cold->latency.uncorrected_timestamps;
+        if(ring && !ts_ring_empty(ring)) (void)ts_ring_pop_elapsed(ring, 0);
+    } else if(ring) {
+        /* Unsolicited responses are not timed. */
+        (void)record_replies_latency(TK_A_ conn, 1);
+    }
+    pipeline_answered(TK_A_ conn);
+}
 
-#ifdef USE_LIBUV
-    (void)loop;
-    uv_poll_start(&conn->watcher, events, conn->watcher.poll_cb);
-#else
-    ev_io_stop(TK_A_ & conn->watcher);
-    ev_io_set(&conn->watcher, conn->watcher.fd, events);
-    ev_io_start(TK_A_ & conn->watcher);
-#endif
+/*
+ * Count the --framer plugin responses, as the plugin finds their ends
+ * in the received data. The data is handed to the plugin as it is read.
+ */
+static void
+framer_scan_incoming(TK_P_ struct connection *conn, char *buf, size_t size) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    const struct tcpkali_framer *framer = largs->params.framer;
+    const uint8_t *ptr = (const uint8_t *)buf;
+    int scan_payloads = conn->cold->latency.sbmh_marker_ctx != NULL;
+
+    while(size) {
+        int response_end = 0;
+        ssize_t consumed = framer->on_bytes_received(conn->cold->framer_state,
+                                                     ptr, size, &response_end);
+        if(consumed < 0 || (size_t)consumed > size) {
+            DEBUG(DBG_ERROR,
+                  "--framer protocol error, not counting responses\n");
+            conn->framer_responses = 0;
+            pipeline_stop(TK_A_ conn);
+            return;
+        }
+        if(scan_payloads && consumed)
+            latency_record_incoming_ts(TK_A_ conn, (char *)ptr, consumed);
+        ptr += consumed;
+        size -= consumed;
+        if(response_end) framer_response_end(TK_A_ conn, scan_payloads);
+        if(consumed == 0) break; /* Does not want this data, oddly */
+    }
 }
 
+/*
+ * Queue a control frame to be sent in between the --http2 requests,
+ * see http2_flush_control().
+ */
 static void
-latency_record_outgoing_ts(TK_P_ struct connection *conn, size_t wrote) {
+http2_queue_control(TK_P_ struct connection *conn, enum http2_frame_type type,
+                    uint8_t flags, uint32_t stream_id, const void *payload,
+                    size_t payload_size) {
     struct loop_arguments *largs = tk_userdata(TK_A);
+    struct connection_cold *cold = conn->cold;
 
-    if(largs->params.message_marker) {
-            if (conn->avg_message_size > 0) {
-                conn->traffic_ongoing.msgs_sent += (conn->bytes_leftovers + wrote) / conn->avg_message_size;
-                conn->bytes_leftovers = (conn->bytes_leftovers + wrote) % conn->avg_message_size;
-            }
+    if(cold->http2.control_size + HTTP2_FRAME_HEADER_SIZE + payload_size
+       > sizeof(cold->http2.control)) {
+        DEBUG(DBG_DETAIL, "Too many HTTP/2 control frames queued\n");
         return;
     }
+    cold->http2.control_size +=
+        http2_frame(cold->http2.control + cold->http2.control_size, type,
+                    flags, stream_id, payload, payload_size);
+    conn->conn_wish &= ~CW_WRITE_PIPELINED;
+    conn->conn_wish |= CW_WRITE_INTEREST;
+    update_io_interest(TK_A_ conn);
+}
 
-    if(!conn->latency.sent_timestamps) return;
+/*
+ * The stream has been answered or reset: release its --pipeline slot.
+ * The --grpc-stream call ending stops the sending altogether.
+ * Returns 0 if the stream is not one of ours.
+ */
+static int
+http2_stream_closed(TK_P_ struct connection *conn, uint32_t stream_id,
+                    int answered) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    size_t depth = largs->params.pipeline;
+    size_t slot = ((stream_id - 1) / 2) % depth;
 
-    /*
-     * (EXPL:1)
-     * Arguably we should record timestamps only for the whole messages which
-     * were sent. However, in some cases (such as with echo servers) the server
-     * could start replying earlier than the whole message is received. This
-     * confuses the latency estimation code because the reply gets received
-     * before the message is fully sent to the remote system. For example,
-     *  tcpkali --message Foooooo --latency-marker F <ip>:echo
-     * would fail, because F is sometimes received before than the trailing
-     * ooo's get to be sent. Therefore we record the timestamp even after
-     * only the very first message byte is sent.
-     */
+    if(largs->params.grpc_stream) {
+        if(stream_id != 1) return 0;
+        conn->cold->http2.stopped = 1;
+        return 1;
+    }
 
-    size_t msgsize = conn->data.single_message_size;
-    size_t pretend_sent = wrote + conn->latency.message_bytes_credit;
-    size_t messages = pretend_sent / msgsize;
-    conn->latency.message_bytes_credit =
-        pretend_sent % conn->data.single_message_size;
-    int ring_grown = 0;
-    for(double now = tk_now(TK_A); messages; messages--) {
-        ring_grown |= ring_buffer_add(conn->latency.sent_timestamps, now);
+    for(size_t n = depth; n; n--, slot = (slot + 1) % depth) {
+        if(conn->cold->http2.streams[slot].id == stream_id) break;
     }
-    if(ring_grown) {
-        /*
-         * Ring has grown [even more]; check that we aren't recording send
-         * timestamps without actually receiving any data back.
-         */
-        const unsigned MEGABYTE = 1024 * 1024;
-        if(conn->latency.sent_timestamps->size > 10 * MEGABYTE) {
-            DEBUG(
-                DBG_ERROR,
-                "Sending messages too fast, "
-                "not receiving them back fast enough.\n"
-                "Check that the --latency-marker data is being received back.\n"
-                "Use -d option to dump received message data.\n");
-            exit(1);
+    if(conn->cold->http2.streams[slot].id != stream_id) return 0;
+    conn->cold->http2.streams[slot].id = 0;
+
+    if(answered) {
+        conn->traffic_ongoing.msgs_rcvd++;
+        record_marker_latency(
+            TK_A_ largs, conn,
+            1e9 * (tk_now(TK_A) - conn->cold->http2.streams[slot].sent_ts));
+    }
+    pipeline_answered(TK_A_ conn);
+    return 1;
+}
+
+/*
+ * Count the --grpc call by the grpc-status of its trailers, if the
+ * stream is ended by a HEADERS frame, or as the one without the status.
+ */
+static void
+grpc_call_ended(struct loop_arguments *largs, const struct http2_parser *hp) {
+    int status = -1;
+
+    if(hp && hp->type == H2F_HEADERS) {
+        char value[8];
+        size_t size;
+        const uint8_t *block = http2_header_block(hp, &size);
+        if(http2_find_header(block, size, "grpc-status", value, sizeof(value))
+           >= 0)
+            status = grpc_parse_status(value);
+    }
+    atomic_add(&largs->grpc_calls[status < 0 ? GRPC_STATUS_CODES : status],
+               1);
+}
+
+/*
+ * The flow control window the --grpc-stream messages are sent within.
+ */
+static void
+http2_window_opened(TK_P_ struct connection *conn) {
+    if(conn->conn_wish & CW_WRITE_PIPELINED) {
+        conn->conn_wish &= ~CW_WRITE_PIPELINED;
+        update_io_interest(TK_A_ conn);
+    }
+}
+
+/*
+ * Count and time the --http2 responses, and keep the connection going:
+ * acknowledge the SETTINGS and PINGs, follow the connection send window
+ * and replenish the receive window.
+ */
+static void
+http2_scan_incoming(TK_P_ struct connection *conn, char *buf, size_t size) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct connection_cold *cold = conn->cold;
+    struct http2_parser *hp = &cold->http2.parser;
+    uint8_t *ptr = (uint8_t *)buf;
+
+    while(!cold->http2.stopped) {
+        enum http2_parse_event event = http2_parse(hp, &ptr, &size);
+
+        /* The --grpc-stream messages are counted as they come. */
+        if(hp->data_size && largs->params.grpc_stream && hp->stream_id == 1)
+            conn->traffic_ongoing.msgs_rcvd += grpc_count_messages(
+                &cold->http2.grpc_reader, hp->data, hp->data_size);
+
+        switch(event) {
+        case H2E_NEED_MORE_DATA:
+            return;
+        case H2E_FRAME:
+            break;
+        case H2E_PROTOCOL_ERROR:
+            DEBUG(DBG_ERROR,
+                  "Unexpected HTTP/2 frame, not sending more requests\n");
+            cold->http2.stopped = 1;
+            return;
+        }
+
+        switch(hp->type) {
+        case H2F_DATA:
+            cold->http2.recv_unacked += hp->length;
+            if(cold->http2.recv_unacked >= HTTP2_MAX_STREAM_ID / 2) {
+                uint8_t increment[4] = {cold->http2.recv_unacked >> 24,
+                                        cold->http2.recv_unacked >> 16,
+                                        cold->http2.recv_unacked >> 8,
+                                        cold->http2.recv_unacked};
+                http2_queue_control(TK_A_ conn, H2F_WINDOW_UPDATE, 0, 0,
+                                    increment, sizeof(increment));
+                /* The --grpc-stream responses are all on the stream 1. */
+                if(largs->params.grpc_stream)
+                    http2_queue_control(TK_A_ conn, H2F_WINDOW_UPDATE, 0, 1,
+                                        increment, sizeof(increment));
+                cold->http2.recv_unacked = 0;
+            }
+            /* FALL THROUGH */
+        case H2F_HEADERS:
+            if((hp->flags & H2FL_END_STREAM)
+               && http2_stream_closed(TK_A_ conn, hp->stream_id, 1)
+               && largs->params.grpc_enable)
+                grpc_call_ended(largs, hp);
+            break;
+        case H2F_RST_STREAM:
+            if(http2_stream_closed(TK_A_ conn, hp->stream_id, 0)
+               && largs->params.grpc_enable)
+                grpc_call_ended(largs, NULL);
+            break;
+        case H2F_SETTINGS:
+            if(hp->flags & H2FL_ACK) break;
+            for(size_t off = 0; off + 6 <= hp->payload_size; off += 6) {
+                uint32_t value = http2_payload_u32(hp, off + 2);
+                switch((hp->payload[off] << 8) | hp->payload[off + 1]) {
+                case H2S_MAX_CONCURRENT_STREAMS:
+                    cold->http2.max_streams = value;
+                    break;
+                case H2S_INITIAL_WINDOW_SIZE:
+                    cold->http2.stream_window +=
+                        (int64_t)value - cold->http2.initial_window;
+                    cold->http2.initial_window = value;
+                    http2_window_opened(TK_A_ conn);
+                    break;
+                }
+            }
+            http2_queue_control(TK_A_ conn, H2F_SETTINGS, H2FL_ACK, 0, NULL,
+                                0);
+            break;
+        case H2F_PING:
+            if(hp->flags & H2FL_ACK || hp->payload_size < 8) break;
+            http2_queue_control(TK_A_ conn, H2F_PING, H2FL_ACK, 0,
+                                hp->payload, 8);
+            break;
+        case H2F_WINDOW_UPDATE:
+            if(hp->stream_id == 0)
+                cold->http2.send_window +=
+                    http2_payload_u32(hp, 0) & HTTP2_MAX_STREAM_ID;
+            else if(largs->params.grpc_stream && hp->stream_id == 1)
+                cold->http2.stream_window +=
+                    http2_payload_u32(hp, 0) & HTTP2_MAX_STREAM_ID;
+            else
+                break;
+            http2_window_opened(TK_A_ conn);
+            break;
+        case H2F_GOAWAY:
+            DEBUG(DBG_DETAIL, "HTTP/2 GOAWAY received\n");
+            cold->http2.stopped = 1;
+            return;
+        default:
+            break;
         }
     }
 }
 
-static unsigned nibble(const unsigned char c) {
-    switch(c) {
-    case '0' ... '9': return (c - '0');
-    case 'a' ... 'f': return (c - 'a') + 10;
-    case 'A' ... 'F': return (c - 'A') + 10;
-    default:
-        return 0;
+/*
+ * Number of bytes of the --http2 requests which are allowed to be sent:
+ * no more than --pipeline and SETTINGS_MAX_CONCURRENT_STREAMS streams,
+ * and no more DATA than the connection send window can take.
+ */
+static size_t
+http2_requests_room(struct loop_arguments *largs, struct connection *conn) {
+    struct connection_cold *cold = conn->cold;
+    size_t msgsize = conn->data.single_message_size;
+    size_t in_flight = cold->pipelined_bytes;
+    size_t streams = largs->params.pipeline;
+
+    if(cold->http2.stopped) return 0;
+    if(streams > cold->http2.max_streams) streams = cold->http2.max_streams;
+
+    /* The request partially sent is to be finished regardless. */
+    size_t started = in_flight + (msgsize - in_flight % msgsize) % msgsize;
+    size_t startable = ((size_t)HTTP2_MAX_STREAM_ID + 1) / 2
+                       - cold->http2.streams_started;
+    if(cold->http2.body_size) {
+        size_t fit = cold->http2.send_window > 0
+                         ? cold->http2.send_window / cold->http2.body_size
+                         : 0;
+        if(startable > fit) startable = fit;
+    }
+
+    size_t depth = streams * msgsize;
+    if(depth > started + startable * msgsize)
+        depth = started + startable * msgsize;
+    return depth > in_flight ? depth - in_flight : 0;
+}
+
+/*
+ * Number of bytes of the --grpc-stream messages which are allowed to be
+ * sent: the DATA frames the connection and the stream windows can take.
+ */
+static size_t
+http2_stream_room(struct connection *conn) {
+    struct connection_cold *cold = conn->cold;
+    size_t msgsize = conn->data.single_message_size;
+    size_t payload = msgsize - HTTP2_FRAME_HEADER_SIZE;
+
+    if(cold->http2.stopped) return 0;
+
+    /* The message partially sent is to be finished regardless. */
+    size_t sent = (size_t)conn->write_offset > conn->data.once_size
+                      ? conn->write_offset - conn->data.once_size
+                      : 0;
+    size_t unfinished = (msgsize - sent % msgsize) % msgsize;
+    int64_t window = cold->http2.send_window < cold->http2.stream_window
+                         ? cold->http2.send_window
+                         : cold->http2.stream_window;
+    size_t startable = window > 0 ? (size_t)window / payload : 0;
+    return unfinished + startable * msgsize;
+}
+
+/*
+ * Give the next stream identifiers to the requests starting
+ * within the (size) bytes to be sent from the (position).
+ */
+static void
+http2_number_requests(struct connection *conn, const void *position,
+                      size_t size) {
+    size_t msgsize = conn->data.single_message_size;
+    size_t once_size = conn->data.once_size;
+    size_t from = (const char *)position - (const char *)conn->data.ptr;
+    size_t to = from + size;
+
+    if(to <= once_size) return;
+    if(from < once_size) from = once_size;
+    uint32_t stream = conn->cold->http2.streams_started;
+    for(size_t k = (from - once_size + msgsize - 1) / msgsize;
+        k < (to - once_size + msgsize - 1) / msgsize; k++, stream++) {
+        http2_number_request(
+            (uint8_t *)conn->data.ptr + once_size + k * msgsize, msgsize,
+            2 * stream + 1);
+    }
+}
+
+/*
+ * The (wrote) bytes of the requests are just sent: the requests
+ * which started there take their streams.
+ */
+static void
+http2_requests_sent(TK_P_ struct connection *conn, size_t wrote) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct connection_cold *cold = conn->cold;
+    size_t msgsize = conn->data.single_message_size;
+    size_t depth = largs->params.pipeline;
+    size_t to = conn->write_offset - conn->data.once_size;
+    size_t from = to - wrote;
+    size_t starts = (to + msgsize - 1) / msgsize - (from + msgsize - 1) / msgsize;
+    double now = tk_now(TK_A);
+
+    /* The --grpc-stream DATA frames only take from the windows. */
+    if(largs->params.grpc_stream) {
+        cold->http2.send_window -= starts * cold->http2.body_size;
+        cold->http2.stream_window -= starts * cold->http2.body_size;
+        conn->traffic_ongoing.msgs_sent += starts;
+        return;
+    }
+
+    for(; starts; starts--) {
+        uint32_t id = 2 * cold->http2.streams_started++ + 1;
+        size_t slot = ((id - 1) / 2) % depth;
+        for(size_t n = depth; n && cold->http2.streams[slot].id; n--)
+            slot = (slot + 1) % depth;
+        cold->http2.streams[slot].id = id;
+        cold->http2.streams[slot].sent_ts = now;
+        cold->http2.send_window -= cold->http2.body_size;
+        conn->traffic_ongoing.msgs_sent++;
     }
 }
 
+/*
+ * Give the next Packet Identifiers to the QoS 1 PUBLISH packets starting
+ * within the (size) bytes to be sent from the (position). No more than
+ * --pipeline of them are in flight, so the identifiers are reused
+ * only after they are acknowledged.
+ */
 static void
-latency_record_incoming_ts(TK_P_ struct connection *conn, char *buf,
-                           size_t size) {
-    struct loop_arguments *largs = tk_userdata(TK_A);
+mqtt_number_publishes(struct connection *conn, const void *position,
+                      size_t size) {
+    size_t msgsize = conn->data.single_message_size;
+    size_t once_size = conn->data.once_size;
+    size_t from = (const char *)position - (const char *)conn->data.ptr;
+    size_t to = from + size;
+
+    if(to <= once_size) return;
+    if(from < once_size) from = once_size;
+    uint32_t published = conn->cold->mqtt.published;
+    for(size_t k = (from - once_size + msgsize - 1) / msgsize;
+        k < (to - once_size + msgsize - 1) / msgsize; k++, published++) {
+        mqtt_publish_number(
+            (uint8_t *)conn->data.ptr + once_size + k * msgsize,
+            published % MQTT_PACKET_ID_MAX + 1);
+    }
+}
 
-    if(!conn->latency.sent_timestamps && !largs->params.message_marker) return;
+/*
+ * The (wrote) bytes of the QoS 1 PUBLISH packets are just sent.
+ */
+static void
+mqtt_publishes_sent(struct connection *conn, size_t wrote) {
+    size_t msgsize = conn->data.single_message_size;
+    size_t to = conn->write_offset - conn->data.once_size;
+    size_t from = to - wrote;
+    conn->cold->mqtt.published +=
+        (to + msgsize - 1) / msgsize - (from + msgsize - 1) / msgsize;
+}
 
-    const uint8_t *lm = conn->latency.sbmh_data;
-    size_t lm_size = conn->latency.sbmh_size;
-    unsigned num_markers_found = 0;
+/*
+ * Send the queued control frames in between the --http2 requests.
+ * Returns -1 if the writing is to be resumed later,
+ * or the connection got closed.
+ */
+static int
+http2_flush_control(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct connection_cold *cold = conn->cold;
+    size_t size = cold->http2.control_retry ? cold->http2.control_retry
+                                            : cold->http2.control_size;
+    ssize_t wrote = 0;
 
-    for(; size > 0;) {
-        switch(conn->latency.marker_parser.state) {
-        case MP_DISENGAGED:
-            break;
-        case MP_SLURPING_DIGITS:
-            if(*buf != '.') {
-                conn->latency.marker_parser.collected_digits <<= 4;
-                conn->latency.marker_parser.collected_digits |= nibble(*buf);
-                buf++;
-                size--;
-                continue;
-            } else {
-                conn->latency.marker_parser.state = MP_DISENGAGED;
-                conn->traffic_ongoing.msgs_rcvd++;
-                struct timeval tp;
-                gettimeofday(&tp, NULL);
-                int64_t latency = (int64_t)tp.tv_sec * 1000000 + tp.tv_usec
-                        - (int64_t)conn->latency.marker_parser.collected_digits;
-                latency /= 100; // 1/10 ms
-                if(hdr_record_value(conn->latency.marker_histogram, latency)
-                        == false) {
-                    fprintf(stderr,
-                            "Latency value %g is too large, "
-                            "can't record.\n",
-                            (double) (latency / 10000));
-                }
-            }
-        }
-        size_t analyzed =
-            sbmh_feed(conn->latency.sbmh_marker_ctx, conn->latency.sbmh_occ, lm,
-                      lm_size, (unsigned char *)buf, size);
-        if(conn->latency.sbmh_marker_ctx->found == sbmh_true) {
-            buf += analyzed;
-            size -= analyzed;
-            if(largs->params.message_marker) {
-                conn->latency.marker_parser.state = MP_SLURPING_DIGITS;
-                conn->latency.marker_parser.collected_digits = 0;
-            } else {
-                num_markers_found++;
-            }
-            sbmh_reset(conn->latency.sbmh_marker_ctx);
-        } else {
+    if(largs->params.ssl_enable && !conn->ktls_send) {
+#ifdef HAVE_OPENSSL
+        if(conn->conn_blocked & CBLOCKED_ON_READ) return -1;
+        conn->conn_blocked &= ~CBLOCKED_ON_WRITE;
+        wrote = SSL_write(cold->ssl_fd, cold->http2.control, size);
+        switch(SSL_get_error(cold->ssl_fd, wrote)) {
+        case SSL_ERROR_NONE:
+            cold->http2.control_retry = 0;
             break;
+        case SSL_ERROR_WANT_WRITE:
+            cold->http2.control_retry = size;
+            conn->conn_blocked |= CBLOCKED_ON_WRITE;
+            conn->conn_wish |= CW_WRITE_INTEREST;
+            update_io_interest(TK_A_ conn);
+            return -1;
+        case SSL_ERROR_WANT_READ:
+            cold->http2.control_retry = size;
+            conn->conn_blocked |= CBLOCKED_ON_READ;
+            conn->conn_wish |= CW_READ_INTEREST;
+            update_io_interest(TK_A_ conn);
+            return -1;
+        case SSL_ERROR_ZERO_RETURN:
+        default:
+            close_connection(TK_A_ conn, CCR_REMOTE);
+            return -1;
         }
-    }
-
-    if(largs->params.message_marker) return;
-
-    /*
-     * Skip the necessary numbers of markers.
-     */
-    if(conn->latency.lm_occurrences_skip) {
-        if(num_markers_found <= conn->latency.lm_occurrences_skip) {
-            conn->latency.lm_occurrences_skip -= num_markers_found;
-            return;
-        } else {
-            num_markers_found -= conn->latency.lm_occurrences_skip;
-            conn->latency.lm_occurrences_skip = 0;
+#endif
+    } else {
+        wrote = tk_write(tk_fd(&conn->watcher), cold->http2.control, size);
+        if(wrote == -1) {
+            if(errno == EAGAIN || errno == EINTR) return -1;
+            close_connection(TK_A_ conn, CCR_REMOTE);
+            return -1;
         }
     }
 
-    /*
-     * Now, for all found markers extract and use the corresponding
-     * end-to-end message latency.
-     */
-    double now = tk_now(TK_A);
-    while(num_markers_found--) {
-        double ts;
-        int got = ring_buffer_get(conn->latency.sent_timestamps, &ts);
-        if(got) {
-            int64_t latency = 10000 * (now - ts);
-            if(hdr_record_value(conn->latency.marker_histogram, latency)
-               == false) {
-                fprintf(stderr,
-                        "Latency value %g is too large, "
-                        "can't record.\n",
-                        now - ts);
-            }
-        } else {
-            fprintf(stderr,
-                    "More messages received than sent. "
-                    "Choose a different --latency-marker.\n"
-                    "Use -d option to dump received message data.\n");
-            exit(1);
-        }
-    }
+    memmove(cold->http2.control, cold->http2.control + wrote,
+            cold->http2.control_size - wrote);
+    cold->http2.control_size -= wrote;
+    conn->traffic_ongoing.num_writes++;
+    conn->traffic_ongoing.bytes_sent += wrote;
+    connection_stats_dirty(largs, conn);
+    return 0;
 }
 
+/*
+ * Exit if any of the --message-stop patterns is found in the received data.
+ * All of them are looked for in a single pass, see tk_multiscan_feed().
+ */
 static void
 scan_incoming_bytes(TK_P_ struct connection *conn, char *buf, size_t size) {
     struct loop_arguments *largs = tk_userdata(TK_A);
 
-    if(conn->sbmh_stop_ctx) {
-        size_t needlen = largs->params.message_stop_expr->u.data.size;
-        size_t analyzed = sbmh_feed(
-            conn->sbmh_stop_ctx, &largs->params.sbmh_shared_stop_occ,
-            (unsigned char *)largs->params.message_stop_expr->u.data.data,
-            needlen, (unsigned char *)buf, size);
-        if(conn->sbmh_stop_ctx->found == sbmh_true) {
+    if(conn->stop_scan) {
+        int match;
+        size_t analyzed =
+            tk_multiscan_feed(largs->params.message_stop,
+                              &conn->stop_scan_state, buf, size, &match);
+        if(match != -1) {
+            size_t needlen;
+            const char *needle =
+                tk_multiscan_pattern(largs->params.message_stop, match,
+                                     &needlen);
             /* Length of --message-stop. */
             size_t needle_tail_in_scope = analyzed > needlen ? needlen : analyzed;
             debug_dump_data_highlight(
-                "Last packet", -1, buf, size, 0,
+                largs, "Last packet", -1, buf, size, 0,
                 analyzed > needlen ? analyzed - needlen : 0,
                 needle_tail_in_scope);
             char stop_msg[PRINTABLE_DATA_SUGGESTED_BUFFER_SIZE(needlen)];
             fprintf(stdout, "Found --message-stop=%s, aborting.\n",
-                    printable_data_highlight(
-                        stop_msg, sizeof(stop_msg),
-                        largs->params.message_stop_expr->u.data.data, needlen,
-                        1, 0, needlen));
+                    printable_data_highlight(stop_msg, sizeof(stop_msg),
+                                             needle, needlen, 1, 0, needlen));
             exit(2);
         }
-        (void)analyzed;
     }
 }
 
@@ -2360,32 +10139,286 @@ static void override_timestamp(char *ptr, size_t size, unsigned long long ts) {
     ptr[16] = '.';
 }
 
-static void update_timestamps(char *ptr, size_t size) {
-    struct timeval tp;
-    gettimeofday(&tp, NULL);
-    unsigned long long ts = (unsigned long long)tp.tv_sec * 1000000 + tp.tv_usec;
-    char *end = ptr + size;
-    while((ptr = memmem(ptr, end - ptr, MESSAGE_MARKER_TOKEN, sizeof(MESSAGE_MARKER_TOKEN) - 1))) {
-        size_t remaining = end - ptr;
-        const size_t full_marker = (sizeof(MESSAGE_MARKER_TOKEN)-1) + 16 + 1;
-        if(remaining >= full_marker) {
-            override_timestamp(ptr, remaining, ts);
-            ptr += full_marker;
+static void
+override_binary_marker(char *ptr, unsigned long long ts, uint32_t *sequence) {
+    const size_t magic_len = sizeof(MESSAGE_MARKER_BINARY_MAGIC) - 1;
+    struct message_marker_binary *mb = (void *)(ptr + magic_len);
+    assert(ptr[0] == MESSAGE_MARKER_BINARY_MAGIC[0]);
+    mb->timestamp = htole64(ts);
+    if(sequence) mb->sequence = htole32((*sequence)++);
+}
+
+/*
+ * Stamp the current time into the markers starting within the [ptr, ptr+size)
+ * range, using the marker offsets recorded when the data was built.
+ * A marker which straddles the end of the range is stamped as well,
+ * as its head is going to be sent now and its tail is not changed later.
+ * The binary markers also get their sequence numbers, but only once:
+ * a marker which was stamped yet not sent is restamped with the same number.
+ */
+static void
+update_timestamps(TK_P_ struct loop_arguments *largs, struct connection *conn,
+                  const void *ptr, size_t size) {
+    struct transport_data_spec *data = &conn->data;
+    int binary = conn->cold->latency.marker_binary;
+    const size_t full_marker = binary ? MESSAGE_MARKER_BINARY_SIZE
+                                      : (sizeof(MESSAGE_MARKER_TOKEN) - 1)
+                                            + 16 + 1;
+    size_t from = (const char *)ptr - (const char *)data->ptr;
+    size_t to = from + size;
+
+    if(data->marker_count == 0) return;
+
+    /* Find the first marker at or after (from). */
+    size_t lo = 0;
+    size_t hi = data->marker_count;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(data->marker_offsets[mid] < from)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if(lo == data->marker_count) return;
+
+    double now = tk_now(TK_A);
+    unsigned long long ts = tk_clock_stamp(&largs->clock, now);
+    double intended_ts = send_intended_ts(conn, now);
+    int correct = largs->params.latency_correction && intended_ts < now;
+    for(size_t m = lo; m < data->marker_count; m++) {
+        size_t off = data->marker_offsets[m];
+        if(off >= to) break;
+        assert(off + full_marker <= data->total_size);
+        if(correct) {
+            /*
+             * The marker is due once all of its bytes are due as per the
+             * schedule, see send_intended_ts() and latency_record_outgoing_ts().
+             */
+            double due = intended_ts
+                         + (off + full_marker - from)
+                               / conn->send_limit.bytes_per_second;
+            ts = tk_clock_stamp_before(&largs->clock, now,
+                                       due < now ? now - due : 0.0);
+        }
+        if(binary) {
+            int fresh = off >= conn->cold->latency.marker_sequenced_upto;
+            override_binary_marker(
+                (char *)data->ptr + off, ts,
+                fresh ? &conn->cold->latency.marker_sequence : NULL);
+            if(fresh)
+                conn->cold->latency.marker_sequenced_upto = off + full_marker;
         } else {
-            break;
+            override_timestamp((char *)data->ptr + off, data->total_size - off,
+                               ts);
+        }
+    }
+}
+
+static void
+format_slot_value(char *ptr, size_t width, uint64_t value) {
+    for(size_t i = width; i > 0; i--) {
+        ptr[i - 1] = '0' + value % 10;
+        value /= 10;
+    }
+}
+
+/*
+ * Rewrite the \{message.seq} and \{time.us} slots starting within
+ * the [ptr, ptr+size) range, in the same way update_timestamps() does
+ * with the markers. A slot is numbered once: a \{message.seq} which was
+ * written out yet not sent retains its number.
+ */
+static void
+update_slots(struct connection *conn, const void *ptr, size_t size) {
+    struct transport_data_spec *data = &conn->data;
+    size_t from = (const char *)ptr - (const char *)data->ptr;
+    size_t to = from + size;
+
+    /* Find the first slot at or after (from). */
+    size_t lo = 0;
+    size_t hi = data->slot_count;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(data->slots[mid].offset < from)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if(lo == data->slot_count || data->slots[lo].offset >= to) return;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t now_us = ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+
+    for(size_t s = lo; s < data->slot_count; s++) {
+        const struct data_slot *slot = &data->slots[s];
+        char *p = (char *)data->ptr + slot->offset;
+        if(slot->offset >= to) break;
+        if(slot->type == EXPR_TIME_US) {
+            assert(slot->offset + EXPR_TIME_US_WIDTH <= data->total_size);
+            format_slot_value(p, EXPR_TIME_US_WIDTH, now_us);
+        } else if(slot->offset >= conn->cold->slots_sequenced_upto) {
+            assert(slot->offset + EXPR_MESSAGE_SEQ_WIDTH <= data->total_size);
+            format_slot_value(p, EXPR_MESSAGE_SEQ_WIDTH,
+                              conn->cold->slot_sequence++);
+            conn->cold->slots_sequenced_upto =
+                slot->offset + EXPR_MESSAGE_SEQ_WIDTH;
+        }
+    }
+}
+
+/*
+ * If the (chunks[0]) extends to the end of the data buffer, append the
+ * repeated part of the buffer (the messages) as the subsequent chunks.
+ * This is only possible if the buffer contents do not change when we wrap
+ * around. Returns the number of bytes added.
+ */
+static size_t
+wrapped_around_chunks(struct loop_arguments *largs, struct connection *conn,
+                      struct iovec *chunks, int *n_chunks) {
+    const char *body = conn->data.ptr + conn->data.once_size;
+    size_t body_size = conn->data.total_size - conn->data.once_size;
+    size_t added = 0;
+
+    if((char *)chunks[0].iov_base + chunks[0].iov_len
+           != (char *)conn->data.ptr + conn->data.total_size
+       || body_size == 0 || conn->ws_state == WSTATE_SENDING_HTTP_UPGRADE
+       || payload_rewritten_on_wrap(largs, conn))
+        return 0;
+
+    /* Do not bite off more than a replicated buffer's worth. */
+    while(*n_chunks < WRITE_CHUNKS_MAX && added < REPLICATE_MAX_SIZE) {
+        chunks[*n_chunks].iov_base = (void *)body;
+        chunks[*n_chunks].iov_len = body_size;
+        (*n_chunks)++;
+        added += body_size;
+    }
+
+    return added;
+}
+
+/*
+ * Extract the (size) bytes starting at (offset) out of the (chunks).
+ * Returns the number of entries in the (slice).
+ */
+static int
+iov_slice(const struct iovec *chunks, int n_chunks, size_t offset,
+          size_t size, struct iovec *slice) {
+    int n_slice = 0;
+
+    for(int i = 0; i < n_chunks && size; i++) {
+        if(offset >= chunks[i].iov_len) {
+            offset -= chunks[i].iov_len;
+            continue;
+        }
+        size_t len = chunks[i].iov_len - offset;
+        if(len > size) len = size;
+        slice[n_slice].iov_base = (char *)chunks[i].iov_base + offset;
+        slice[n_slice].iov_len = len;
+        n_slice++;
+        size -= len;
+        offset = 0;
+    }
+
+    if(n_slice == 0) {
+        slice[0].iov_base = (char *)chunks[0].iov_base + offset;
+        slice[0].iov_len = 0;
+        n_slice = 1;
+    }
+
+    return n_slice;
+}
+
+#ifdef TCPKALI_UDP
+/*
+ * Send the (slice) as the --udp datagrams: the (header_size) bytes
+ * sent once go first, the messages follow, one (datagram_size) each.
+ * Returns the number of bytes in the datagrams sent.
+ */
+static ssize_t
+udp_send_datagrams(int fd, const struct iovec *slice, int n_slice,
+                   size_t header_size, size_t datagram_size) {
+    struct mmsghdr msgs[UDP_BATCH_MAX];
+    struct iovec iovs[UDP_BATCH_MAX];
+    unsigned n = 0;
+
+    for(int i = 0; i < n_slice && n < UDP_BATCH_MAX; i++) {
+        char *p = slice[i].iov_base;
+        size_t left = slice[i].iov_len;
+        while(left && n < UDP_BATCH_MAX) {
+            size_t size = header_size ? header_size : datagram_size;
+            if(size > left || size == 0) size = left;
+            header_size = 0;
+            iovs[n].iov_base = p;
+            iovs[n].iov_len = size;
+            memset(&msgs[n], 0, sizeof(msgs[n]));
+            msgs[n].msg_hdr.msg_iov = &iovs[n];
+            msgs[n].msg_hdr.msg_iovlen = 1;
+            n++;
+            p += size;
+            left -= size;
         }
     }
+
+    int sent = sendmmsg(fd, msgs, n, 0);
+    if(sent == -1) return -1;
+
+    ssize_t wrote = 0;
+    for(int i = 0; i < sent; i++) wrote += iovs[i].iov_len;
+    return wrote;
+}
+
+/*
+ * Receive a batch of the --udp datagrams into (buf), each one
+ * in its own slot large enough for the messages we send.
+ * The datagrams are then moved back to back, as if read from a stream.
+ */
+static ssize_t
+udp_recv_datagrams(int fd, char *buf, size_t size, size_t message_size) {
+    struct mmsghdr msgs[UDP_BATCH_MAX];
+    struct iovec iovs[UDP_BATCH_MAX];
+    size_t slot = 512;
+    while(slot < message_size && slot < size) slot <<= 1;
+    if(slot > size) slot = size;
+    unsigned n = size / slot;
+    if(n > UDP_BATCH_MAX) n = UDP_BATCH_MAX;
+
+    for(unsigned i = 0; i < n; i++) {
+        iovs[i].iov_base = buf + i * slot;
+        iovs[i].iov_len = slot;
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int received = recvmmsg(fd, msgs, n, 0, NULL);
+    if(received == -1) return -1;
+
+    size_t rd = 0;
+    for(int i = 0; i < received; i++) {
+        if(rd != (size_t)i * slot)
+            memmove(buf + rd, buf + i * slot, msgs[i].msg_len);
+        rd += msgs[i].msg_len;
+    }
+    return rd;
 }
+#endif /* TCPKALI_UDP */
 
 /*
  * Compute the largest amount of data we can send to the channel
  * using a single write() call.
  */
 static void
-largest_contiguous_chunk(struct loop_arguments *largs, struct connection *conn,
-                         const void **position, size_t *available_header,
-                         size_t *available_body) {
+largest_contiguous_chunk(TK_P_ struct loop_arguments *largs,
+                         struct connection *conn, const void **position,
+                         size_t *available_header, size_t *available_body) {
     off_t *current_offset = &conn->write_offset;
+
+    if(conn->cold->message_set != largs->message_set
+       && connection_message_boundary(conn)
+       && connection_switch_messages(TK_A_ conn))
+        *current_offset = conn->data.once_size;
+
     size_t accessible_size = conn->data.total_size;
     size_t available = accessible_size - *current_offset;
 
@@ -2399,6 +10432,9 @@ largest_contiguous_chunk(struct loop_arguments *largs, struct connection *conn,
        && largs->params.websocket_enable) {
         accessible_size = conn->data.ws_hdr_size;
         size_t available = accessible_size - *current_offset;
+        /* Past the TCP connect and the TLS handshake, see --latency-upgrade */
+        if(conn->cold->latency.upgrade_started == 0.0)
+            conn->cold->latency.upgrade_started = tk_now(TK_A);
         *position = conn->data.ptr + *current_offset;
         *available_header = available;
         *available_body = 0;
@@ -2419,17 +10455,28 @@ largest_contiguous_chunk(struct loop_arguments *largs, struct connection *conn,
         *available_body = available - *available_header;
     } else {
         /* If we're at the end of the buffer, re-blow it with new messages */
-        if(conn->message_collection.most_dynamic_expression
-               == DS_PER_MESSAGE
+        if(connection_messages_scope(conn) == DS_PER_MESSAGE
            && (conn->conn_type == CONN_OUTGOING
                || (largs->params.listen_mode & _LMODE_SND_MASK))) {
-            explode_data_template_override(&conn->message_collection,
-                                           (conn->conn_type == CONN_OUTGOING)
-                                               ? TWS_SIDE_CLIENT
-                                               : TWS_SIDE_SERVER,
-                                           &conn->data, largs, conn);
+            struct payload_job *job = conn->cold->payload_job;
+            if(job && payload_job_collect(largs->payload_generator, job)) {
+                /* Swap in the pre-generated buffer. */
+                struct transport_data_spec next = job->spec;
+                job->spec = conn->data;
+                conn->data = next;
+            } else {
+                explode_data_template_override(
+                    conn->cold->message_collection,
+                    (conn->conn_type == CONN_OUTGOING) ? TWS_SIDE_CLIENT
+                                                       : TWS_SIDE_SERVER,
+                    &conn->data, largs, conn);
+            }
+            if(job) payload_job_submit(largs->payload_generator, job);
             accessible_size = conn->data.total_size;
         }
+        /* The markers are sent anew, and need new sequence numbers. */
+        conn->cold->latency.marker_sequenced_upto = 0;
+        conn->cold->slots_sequenced_upto = 0;
 
         size_t off = conn->data.once_size;
         *position = conn->data.ptr + off;
@@ -2437,31 +10484,237 @@ largest_contiguous_chunk(struct loop_arguments *largs, struct connection *conn,
         *current_offset = off;
     }
 
-    if(largs->params.message_marker) {
-        if(*position < conn->data.marker_token_ptr) {
-            /* Short-circquit search: we know where marker is, directly. */
-            struct timeval tp;
-            gettimeofday(&tp, NULL);
-            unsigned long long ts =
-                (unsigned long long)tp.tv_sec * 1000000 + tp.tv_usec;
-            override_timestamp(conn->data.marker_token_ptr,
-                               (*available_body), ts);
+}
+
+/*
+ * Wait for either reading or writing, for the responders which stop
+ * reading until they have sent out what they owe the remote side.
+ */
+static void
+read_or_write_interest(TK_P_ struct connection *conn, int wish) {
+    if((conn->conn_wish & (CW_READ_INTEREST | CW_WRITE_INTEREST)) != wish) {
+        conn->conn_wish &= ~(CW_READ_INTEREST | CW_WRITE_INTEREST);
+        conn->conn_wish |= wish;
+        update_io_interest(TK_A_ conn);
+    }
+}
+
+/*
+ * Reflect the received data back to the sender, see --listen-mode=echo.
+ * The data is spliced from the socket into the pipe and from the pipe into
+ * the socket, never leaving the kernel. While the socket can't take all
+ * of the piped data, we stop reading and wait until it can.
+ */
+static void
+echo_connection_io(TK_P_ struct connection *conn, int revents) {
+#ifdef TCPKALI_SPLICE
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct connection_cold *cold = conn->cold;
+    int fd = tk_fd(&conn->watcher);
+
+    if((revents & TK_READ) && cold->echo.queued < cold->echo.capacity) {
+        ssize_t rd = splice(fd, NULL, cold->echo.pipe[1], NULL,
+                            cold->echo.capacity - cold->echo.queued,
+                            SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        switch(rd) {
+        case -1:
+            if(errno == EAGAIN || errno == EINTR) break;
+        /* Fall through */
+        case 0:
+            close_connection(TK_A_ conn, CCR_REMOTE);
+            return;
+        default:
+            cold->echo.queued += rd;
+            conn->traffic_ongoing.num_reads++;
+            conn->traffic_ongoing.bytes_rcvd += rd;
+            connection_stats_dirty(largs, conn);
+        }
+    }
+
+    if(cold->echo.queued) {
+        ssize_t wrote = splice(cold->echo.pipe[0], NULL, fd, NULL,
+                               cold->echo.queued,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if(wrote == -1) {
+            if(errno != EAGAIN && errno != EINTR) {
+                close_connection(TK_A_ conn, CCR_REMOTE);
+                return;
+            }
         } else {
-            /* Do a string search to find our markers and update timestamps */
-            update_timestamps((char *)*position, *available_body);
+            cold->echo.queued -= wrote;
+            conn->traffic_ongoing.num_writes++;
+            conn->traffic_ongoing.bytes_sent += wrote;
+            connection_stats_dirty(largs, conn);
+        }
+    }
+
+    read_or_write_interest(TK_A_ conn, cold->echo.queued ? CW_WRITE_INTEREST
+                                                        : CW_READ_INTEREST);
+#else
+    (void)loop;
+    (void)conn;
+    (void)revents;
+#endif
+}
+
+/*
+ * Find the --request-delimiter occurrences in the received data,
+ * owing the remote side a --response for each.
+ */
+static void
+respond_scan(struct loop_arguments *largs, struct connection *conn,
+             const char *buf, size_t size) {
+    struct StreamBMH *ctx = conn->cold->respond.sbmh_request_ctx;
+    const tk_expr_t *delimiter = largs->params.request_delimiter_expr;
+    size_t requests = 0;
+
+    while(size) {
+        size_t analyzed = tk_scan_feed(
+            ctx, &largs->params.sbmh_shared_request_occ,
+            (const unsigned char *)delimiter->u.data.data,
+            delimiter->u.data.size, (const unsigned char *)buf, size);
+        if(ctx->found != sbmh_true) break;
+        requests++;
+        sbmh_reset(ctx);
+        buf += analyzed;
+        size -= analyzed;
+    }
+
+    conn->traffic_ongoing.msgs_rcvd += requests;
+    conn->cold->respond.owed += requests * largs->params.response_expr->u.data.size;
+}
+
+/*
+ * Send the owed responses, batching the copies of the --response
+ * into as few writes as possible.
+ */
+#define RESPOND_BATCH_MAX 64
+static void
+respond_flush(TK_P_ struct connection *conn) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    const char *response = largs->params.response_expr->u.data.data;
+    size_t response_size = largs->params.response_expr->u.data.size;
+    size_t *owed = &conn->cold->respond.owed;
+
+    while(*owed) {
+        struct iovec iov[RESPOND_BATCH_MAX];
+        int iovcnt = 0;
+        size_t batch = 0;
+        /* The first owed response might have been partially sent. */
+        size_t offset = (response_size - *owed % response_size) % response_size;
+        for(; iovcnt < RESPOND_BATCH_MAX && batch < *owed; iovcnt++) {
+            iov[iovcnt].iov_base = (void *)(response + offset);
+            iov[iovcnt].iov_len = response_size - offset;
+            batch += response_size - offset;
+            offset = 0;
+        }
+
+        ssize_t wrote = tk_writev(tk_fd(&conn->watcher), iov, iovcnt);
+        if(wrote == -1) {
+            if(errno == EAGAIN || errno == EINTR) break;
+            close_connection(TK_A_ conn, CCR_REMOTE);
+            return;
         }
+        /* Responses completed by this write. */
+        conn->traffic_ongoing.msgs_sent +=
+            (*owed + response_size - 1) / response_size
+            - (*owed - wrote + response_size - 1) / response_size;
+        *owed -= wrote;
+        conn->traffic_ongoing.num_writes++;
+        conn->traffic_ongoing.bytes_sent += wrote;
+        connection_stats_dirty(largs, conn);
+        if((size_t)wrote < batch) break;
+    }
+
+    read_or_write_interest(TK_A_ conn,
+                           *owed ? CW_WRITE_INTEREST : CW_READ_INTEREST);
+}
+
+/*
+ * The body bytes to write at once, out of the (available_body).
+ */
+static inline size_t
+write_combine_size(const struct loop_arguments *largs,
+                   const struct connection *conn, size_t available_body) {
+    size_t batch = conn->send_limit.minimal_move_size;
+    switch(largs->params.write_combine) {
+    case WRCOMB_OFF:
+        break;
+    case WRCOMB_ADAPTIVE:
+        if(conn->wrcomb_batch > batch) batch = conn->wrcomb_batch;
+        break;
+    case WRCOMB_ON:
+    case WRCOMB_CORK:
+        return available_body;
     }
+    return available_body < batch ? available_body : batch;
 }
 
+/*
+ * --write-combine adaptive: keep the kernel send queue just non-empty.
+ * A drained queue means the link waits for us, so the writes grow to save
+ * on the system calls. More than a batch of data not yet sent means the
+ * messages would only wait in the kernel, so the writes shrink back towards
+ * the single messages, which leave as soon as they are due.
+ * The (unsent) is -1 if the socket is to be asked.
+ */
 static void
-connection_cb(TK_P_ tk_io *w, int revents) {
+write_combine_adapt(struct connection *conn, int sockfd, int unsent) {
+    size_t minimal = conn->send_limit.minimal_move_size;
+    size_t batch = conn->wrcomb_batch > minimal ? conn->wrcomb_batch : minimal;
+
+    conn->wrcomb_countdown = WRCOMB_CHECK_WRITES;
+    if(unsent < 0) {
+#ifdef TCPKALI_WRCOMB_ADAPTIVE
+        if(ioctl(sockfd, SIOCOUTQNSD, &unsent) == -1) return;
+#else
+        (void)sockfd;
+        return;
+#endif
+    }
+
+    if(unsent == 0) {
+        if(2 * batch <= WRCOMB_BATCH_MAX) batch *= 2;
+    } else if((size_t)unsent > batch && batch > minimal) {
+        batch /= 2;
+        batch -= minimal ? batch % minimal : 0;
+        if(batch < minimal) batch = minimal;
+    }
+    conn->wrcomb_batch = batch;
+}
+
+/*
+ * The features which may be in use on a connection, for connection_io()
+ * to be compiled without the checks for the ones which are known not to be.
+ */
+enum connection_features {
+    CF_SSL = 0x01,       /* --ssl */
+    CF_WEBSOCKET = 0x02, /* --websocket */
+    CF_UDP = 0x04,       /* --udp */
+    CF_DUMP = 0x08,      /* --dump-* */
+    CF_MARKER = 0x10,    /* --message-marker */
+    CF_ALL = 0x1f
+};
+
+static inline __attribute__((always_inline)) void
+connection_io(TK_P_ tk_io *w, int revents, const unsigned features) {
     struct loop_arguments *largs = tk_userdata(TK_A);
     struct connection *conn =
         (struct connection *)((char *)w - offsetof(struct connection, watcher));
     struct sockaddr_storage *remote =
         conn->conn_type == CONN_OUTGOING
-            ? &largs->params.remote_addresses.addrs[conn->remote_index]
-            : &conn->peer_name;
+            ? &largs->params.remote_addresses.addrs[conn->cold->remote_index]
+            : &conn->cold->peer_name;
+
+    if(conn->echo) {
+        echo_connection_io(TK_A_ conn, revents);
+        return;
+    }
+
+    /* Before reading the replies to the messages we've got send times of. */
+    if(conn->zerocopy.sent != conn->zerocopy.completed || conn->timestamping) {
+        errqueue_reap(TK_A_ conn);
+    }
 
     if(conn->conn_blocked & CBLOCKED_ON_INIT) {
         if(((conn->conn_blocked & CBLOCKED_ON_READ) && (revents & TK_READ)) ||
@@ -2472,7 +10725,7 @@ connection_cb(TK_P_ tk_io *w, int revents) {
             if(conn->conn_blocked & CBLOCKED_ON_WRITE) {
                 revents &= ~TK_WRITE;
             }
-            if(ssl_setup(conn, 0, largs->params.ssl_cert, largs->params.ssl_key)) {
+            if(ssl_handshake_step(TK_A_ conn, 0)) {
                 if(conn->conn_blocked & CBLOCKED_ON_INIT) {
                     conn->conn_wish |= CW_READ_INTEREST;
                     conn->conn_wish |= CW_WRITE_INTEREST;
@@ -2496,33 +10749,95 @@ connection_cb(TK_P_ tk_io *w, int revents) {
             return;
         }
 
+        /* A refused connection is not an established one. */
+        int so_error = 0;
+        socklen_t so_error_len = sizeof(so_error);
+        if(getsockopt(w->fd, SOL_SOCKET, SO_ERROR, &so_error, &so_error_len)
+               == 0
+           && so_error) {
+            char buf[INET6_ADDRSTRLEN + 64];
+            errno = so_error;
+            DEBUG(DBG_DETAIL, "Connection to %s is not done: %s\n",
+                  format_sockaddr(remote, buf, sizeof(buf)),
+                  strerror(errno));
+            close_connection(TK_A_ conn, CCR_REMOTE);
+            return;
+        }
+        if(largs->params.proxy_protocol
+           && proxy_header_send(largs, conn, w->fd) == -1) {
+            close_connection(TK_A_ conn, CCR_REMOTE);
+            return;
+        }
+
         atomic_decrement(&largs->outgoing_connecting);
         atomic_increment(&largs->outgoing_established);
         conn->conn_state = CSTATE_CONNECTED;
+        connection_prepare_payload(TK_A_ conn, w->fd);
+        connection_io_stream(TK_A_ conn);
+        conn->traffic_ongoing.conns_opened++;
+        if(largs->params.mptcp) mptcp_count_connection(largs, w->fd);
+        connection_stats_dirty(largs, conn);
+        largs->reconnect_failures = 0;
+        remote_health_outcome(largs, conn->cold->remote_index, 0);
+        remote_backoff_outcome(largs, conn->cold->remote_index, tk_now(TK_A),
+                               0);
+        if(!largs->params.message_marker)
+            remote_health_latency(
+                largs, conn->cold->remote_index,
+                tk_now(TK_A) - conn->cold->latency.connection_initiated);
         if(largs->connect_histogram_local) {
             int64_t latency =
-                10000 * (tk_now(TK_A) - conn->latency.connection_initiated);
+                latency_units_per_second
+                * (tk_now(TK_A) - conn->cold->latency.connection_initiated);
             hdr_record_value(largs->connect_histogram_local, latency);
+            struct remote_latency *rl = remote_latency(largs, conn);
+            if(rl) hdr_record_value(rl->connect_histogram_local, latency);
+            struct remote_latency *gl = group_latency(largs, conn);
+            if(gl) hdr_record_value(gl->connect_histogram_local, latency);
         }
 
         /*
-         * We were asked to produce the WRITE event
-         * only to detect successful connection.
+         * We asked for the WRITE event to detect the successful connection.
          * If there's nothing to write, we remove the write interest.
          */
-        tk_timer_stop(TK_A, &conn->timer);
+        tk_wheel_remove(&largs->timer_wheel, &conn->timer);
         if((conn->data.total_size == 0) && !(conn->conn_blocked & CBLOCKED_ON_WRITE)) {
             conn->conn_wish &= ~CW_WRITE_INTEREST; /* Remove write interest */
             update_io_interest(TK_A_ conn);
             revents &= ~TK_WRITE; /* Don't actually write in this loop */
+            keepalive_start(TK_A_ conn);
+        } else if(largs->params.slow_send > 0.0) {
+            slow_send_start(TK_A_ conn);
+            revents &= ~TK_WRITE;
+        }
+
+        /* The TLS handshake follows the PROXY header. */
+        if((features & CF_SSL) && largs->params.ssl_enable
+           && largs->params.proxy_protocol) {
+            if(!ssl_handshake_step(TK_A_ conn, w->fd)) {
+                close_connection(TK_A_ conn, CCR_REMOTE);
+                return;
+            }
+            if(conn->conn_blocked & CBLOCKED_ON_INIT) {
+                conn->conn_wish |= CW_READ_INTEREST | CW_WRITE_INTEREST;
+                update_io_interest(TK_A_ conn);
+                return;
+            }
         }
     }
 
     if(revents & TK_READ) {
         int record_moved_data = 0;
+        /*
+         * Drain the socket while it fills up the buffer, but not more than
+         * the --read-budget per event, to stay fair to other connections.
+         */
+        size_t read_budget = largs->params.read_budget;
+        int read_more;
         do {
-            size_t read_size = sizeof(largs->scratch_recv_buf);
-            if(largs->params.websocket_enable == 0
+            read_more = 0;
+            size_t read_size = largs->scratch_recv_size;
+            if(!(features & CF_WEBSOCKET) || largs->params.websocket_enable == 0
                || conn->ws_state == WSTATE_WS_ESTABLISHED) {
                 switch(
                     limit_channel_bandwidth(TK_A_ conn, &read_size, TK_READ)) {
@@ -2546,14 +10861,16 @@ connection_cb(TK_P_ tk_io *w, int revents) {
 
             assert(read_size > 0);
             ssize_t rd = 0;
-            if(largs->params.ssl_enable) {
+            char *rbuf = largs->scratch_recv_buf; /* Or the mapped pages */
+            size_t unread = 0; /* Known to be left in the socket */
+            if((features & CF_SSL) && largs->params.ssl_enable) {
 #ifdef HAVE_OPENSSL
                 if(conn->conn_blocked & CBLOCKED_ON_WRITE) {
                     goto process_WRITE;
                 }
                 conn->conn_blocked &= ~CBLOCKED_ON_READ;
-                rd = SSL_read(conn->ssl_fd, largs->scratch_recv_buf, read_size);
-                switch(SSL_get_error(conn->ssl_fd, rd)) {
+                rd = SSL_read(conn->cold->ssl_fd, largs->scratch_recv_buf, read_size);
+                switch(SSL_get_error(conn->cold->ssl_fd, rd)) {
                 case SSL_ERROR_NONE:
                     break;
                 case SSL_ERROR_WANT_WRITE:
@@ -2572,8 +10889,27 @@ connection_cb(TK_P_ tk_io *w, int revents) {
                     rd = -1;  // Close it
                 }
 #endif
+            } else if(conn->timestamping) {
+                rd = tstamp_read(TK_A_ conn, largs->scratch_recv_buf,
+                                 read_size);
+#ifdef TCPKALI_UDP
+            } else if((features & CF_UDP) && largs->params.udp) {
+                rd = udp_recv_datagrams(tk_fd(w), largs->scratch_recv_buf,
+                                        read_size,
+                                        conn->data.single_message_size);
+#endif
+#ifdef MSG_TRUNC
+            } else if(conn->recv_discard) {
+                /* Linux drops the TCP data without copying it out. */
+                rd = recv(tk_fd(w), largs->scratch_recv_buf, read_size,
+                          MSG_TRUNC);
+#endif
+            } else if(conn->zerocopy_rx) {
+                rd = zerocopy_read(largs, conn, tk_fd(w),
+                                   largs->scratch_recv_buf, read_size, &rbuf,
+                                   &unread);
             } else {
-                rd = read(tk_fd(w), largs->scratch_recv_buf, read_size);
+                rd = tk_read(tk_fd(w), largs->scratch_recv_buf, read_size);
             }
             switch(rd) {
             case -1:
@@ -2592,6 +10928,8 @@ connection_cb(TK_P_ tk_io *w, int revents) {
                 }
                 break;
             case 0: {
+                /* Empty datagrams do not end the --udp "connection". */
+                if((features & CF_UDP) && largs->params.udp) break;
                 char buf[INET6_ADDRSTRLEN + 64];
                 DEBUG(DBG_DETAIL, "Connection half-closed by %s\n",
                       format_sockaddr(remote, buf, sizeof(buf)));
@@ -2606,59 +10944,258 @@ connection_cb(TK_P_ tk_io *w, int revents) {
                                                      * the server response before sending rest, unblock our WRITE
                                                      * side.
                                                      */
-                if(conn->traffic_ongoing.bytes_rcvd == 0
+                if((features & CF_WEBSOCKET)
+                   && conn->traffic_ongoing.bytes_rcvd == 0
                    && conn->ws_state == WSTATE_SENDING_HTTP_UPGRADE
                    && largs->params.websocket_enable
                    && conn->data.ws_hdr_size != conn->data.total_size) {
                     conn->ws_state = WSTATE_WS_ESTABLISHED;
                     conn->conn_wish |= CW_WRITE_INTEREST;
                     update_io_interest(TK_A_ conn);
+                    if(largs->upgrade_histogram_local
+                       && conn->cold->latency.upgrade_started > 0.0)
+                        record_upgrade_latency(TK_A_ conn);
                 }
                 if(conn->traffic_ongoing.bytes_rcvd == 0
                    && largs->firstbyte_histogram_local) {
                     int64_t latency =
-                        10000
-                        * (tk_now(TK_A) - conn->latency.connection_initiated);
+                        latency_units_per_second
+                        * (tk_now(TK_A) - conn->cold->latency.connection_initiated);
                     hdr_record_value(largs->firstbyte_histogram_local, latency);
+                    struct remote_latency *rl = remote_latency(largs, conn);
+                    if(rl)
+                        hdr_record_value(rl->firstbyte_histogram_local,
+                                         latency);
+                    struct remote_latency *gl = group_latency(largs, conn);
+                    if(gl)
+                        hdr_record_value(gl->firstbyte_histogram_local,
+                                         latency);
                 }
                 conn->traffic_ongoing.num_reads++;
                 conn->traffic_ongoing.bytes_rcvd += rd;
-                if(largs->params.dump_setting & DS_DUMP_ALL_IN
-                   || ((largs->params.dump_setting & DS_DUMP_ONE_IN)
-                       && largs->dump_connect_fd == tk_fd(w))) {
-                    debug_dump_data("Rcv", tk_fd(w), largs->scratch_recv_buf,
-                                    rd, 0);
+                connection_stats_dirty(largs, conn);
+                if(conn->verify_echo) {
+                    uint64_t offset;
+                    size_t mismatches = echo_verify_received(
+                        conn->cold->echo_verify, rbuf, rd, &offset);
+                    if(mismatches)
+                        echo_mismatch(largs, conn, mismatches, offset);
+                }
+                if((features & CF_DUMP)
+                   && (largs->params.dump_setting & DS_DUMP_ALL_IN
+                       || ((largs->params.dump_setting & DS_DUMP_ONE_IN)
+                           && largs->dump_connect_fd == tk_fd(w)))) {
+                    debug_dump_data(largs, "Rcv", tk_fd(w), rbuf, rd, 0);
                 }
-                latency_record_incoming_ts(TK_A_ conn, largs->scratch_recv_buf,
-                                           rd);
-                scan_incoming_bytes(TK_A_ conn, largs->scratch_recv_buf, rd);
+                if(conn->recorded)
+                    record_received(TK_A_ conn, RECORD_DATA, rbuf, rd);
+                if(conn->http2_frames)
+                    http2_scan_incoming(TK_A_ conn, rbuf, rd);
+                else if(conn->http_responses)
+                    http_scan_incoming(TK_A_ conn, rbuf, rd);
+                else if(conn->resp_replies)
+                    resp_scan_incoming(TK_A_ conn, rbuf, rd);
+                else if(conn->mqtt_packets)
+                    mqtt_scan_incoming(TK_A_ conn, rbuf, rd);
+                else if(conn->lenprefix_frames)
+                    lenprefix_scan_incoming(TK_A_ conn, rbuf, rd);
+                else if(conn->framer_responses)
+                    framer_scan_incoming(TK_A_ conn, rbuf, rd);
+                else if(conn->ws_frames)
+                    websocket_scan_incoming(TK_A_ conn, rbuf, rd);
+                else
+                    latency_record_incoming_ts(TK_A_ conn, rbuf, rd);
+                scan_incoming_bytes(TK_A_ conn, rbuf, rd);
+                if(conn->respond)
+                    respond_scan(largs, conn, rbuf, rd);
 
                 if(record_moved_data) {
                     pacefier_moved(&conn->recv_pace, rd, tk_now(TK_A));
                 }
+
+                /*
+                 * A short read has likely emptied the socket. The datagrams
+                 * are read until EAGAIN, and the SSL records while their
+                 * data is already decrypted.
+                 */
+                int drained = !((features & CF_UDP) && largs->params.udp)
+                              && (size_t)rd < read_size && !unread;
+#ifdef HAVE_OPENSSL
+                if((features & CF_SSL) && largs->params.ssl_enable)
+                    drained = SSL_pending(conn->cold->ssl_fd) == 0;
+#endif
+                read_budget = read_budget > (size_t)rd ? read_budget - rd : 0;
+                read_more = read_budget && !drained
+                            && (conn->conn_wish & CW_READ_INTEREST)
+                            && !(conn->conn_wish & CW_READ_BLOCKED);
                 break;
             }
-        } while(0);
+        } while(read_more);
     }
 
 process_WRITE:
+    if(conn->respond) {
+        /* Answer what has just been read, or continue answering. */
+        respond_flush(TK_A_ conn);
+        return;
+    }
+
     if(revents & TK_WRITE) {
         const void *position;
         size_t available_header, available_body;
+        struct iovec chunks[WRITE_CHUNKS_MAX];
+        int n_chunks = 1;
+        size_t consumed = 0; /* Bytes written from the (chunks) */
         int record_moved = 0;
         int lockstep = 0;
 
-        largest_contiguous_chunk(largs, conn, &position, &available_header,
-                                 &available_body);
+        /* Closing by --close-style: nothing is sent anymore. */
+        if(conn->closing) {
+            conn->conn_wish &= ~CW_WRITE_INTEREST;
+            update_io_interest(TK_A_ conn);
+            return;
+        }
+
+        /*
+         * Buffers given to MSG_ZEROCOPY sends must not be rewritten
+         * until the kernel is done with them.
+         */
+        if(conn->zerocopy.sent != conn->zerocopy.completed
+           && (size_t)conn->write_offset == conn->data.total_size
+           && payload_rewritten_on_wrap(largs, conn)) {
+            conn->conn_wish |= CW_WRITE_ZEROCOPY;
+            update_io_interest(TK_A_ conn);
+            return;
+        }
+
+        /*
+         * The --http2 control frames go in between the requests, and
+         * not in the middle of an SSL_write() which has to be repeated.
+         */
+        if(conn->http2_frames && conn->cold->http2.control_size
+           && conn->traffic_ongoing.bytes_sent >= conn->data.once_size
+           && (conn->write_offset - conn->data.once_size)
+                      % conn->data.single_message_size
+                  == 0
+           && (conn->cold->http2.control_retry
+               || !(conn->conn_blocked & CBLOCKED_ON_WRITE))) {
+            if(http2_flush_control(TK_A_ conn) == -1) return;
+        }
+
+        largest_contiguous_chunk(TK_A_ largs, conn, &position,
+                                 &available_header, &available_body);
         if(!(available_header + available_body) && !(conn->conn_blocked & CBLOCKED_ON_WRITE)) {
             /* Only the header was sent. Now, silence. */
             assert(conn->data.total_size == conn->data.once_size
                    || largs->params.websocket_enable);
             conn->conn_wish &= ~CW_WRITE_INTEREST; /* disable write interest */
             update_io_interest(TK_A_ conn);
+            if(connection_idle(conn)) keepalive_start(TK_A_ conn);
             return;
         }
 
+        /*
+         * Continue past the end of the buffer into the repeated messages,
+         * so that a single writev() could send the tail of the buffer
+         * together with the wrap-around.
+         */
+        chunks[0].iov_base = (void *)position;
+        chunks[0].iov_len = available_header + available_body;
+        if(!((features & CF_SSL) && largs->params.ssl_enable)
+           || conn->ktls_send) {
+            available_body +=
+                wrapped_around_chunks(largs, conn, chunks, &n_chunks);
+        }
+
+        /* Keep at most --pipeline requests in flight. */
+        if(conn->pipelined) {
+            /* Pause for the --think-time after a response. */
+            double think = conn->cold->think_until - tk_now(TK_A);
+            if(think > 0.0 && !(conn->conn_blocked & CBLOCKED_ON_WRITE)) {
+                conn->conn_wish |= CW_WRITE_DELAYED;
+                update_io_interest(TK_A_ conn);
+                connection_timer_refresh(TK_A_ conn, think);
+                return;
+            }
+            size_t depth = largs->params.pipeline
+                           * conn->data.single_message_size;
+            size_t room = conn->http2_frames
+                              ? http2_requests_room(largs, conn)
+                              : depth > conn->cold->pipelined_bytes
+                                    ? depth - conn->cold->pipelined_bytes
+                                    : 0;
+            if(available_body > room) available_body = room;
+            if(!(available_header + available_body)
+               && !(conn->conn_blocked & CBLOCKED_ON_WRITE)) {
+                conn->conn_wish |= CW_WRITE_PIPELINED;
+                update_io_interest(TK_A_ conn);
+                return;
+            }
+        } else if(conn->http2_frames) {
+            /* The --grpc-stream messages wait for the window to open. */
+            size_t room = http2_stream_room(conn);
+            if(available_body > room) available_body = room;
+            if(!(available_header + available_body)
+               && !(conn->conn_blocked & CBLOCKED_ON_WRITE)) {
+                conn->conn_wish |= CW_WRITE_PIPELINED;
+                update_io_interest(TK_A_ conn);
+                return;
+            }
+        }
+
+        /* Send the --replay-pcap stream data when it is due. */
+        if(conn->replay_timed) {
+            double elapsed =
+                tk_now(TK_A) - conn->cold->latency.connection_initiated;
+            double next_at;
+            size_t due = pcap_stream_due(conn->cold->replay.stream,
+                                         &conn->cold->replay.burst, elapsed,
+                                         &next_at);
+            size_t room = due > (size_t)conn->write_offset
+                              ? due - conn->write_offset
+                              : 0;
+            if(available_header > room) available_header = room;
+            if(available_body > room - available_header)
+                available_body = room - available_header;
+            if(!(available_header + available_body)
+               && !(conn->conn_blocked & CBLOCKED_ON_WRITE)) {
+                double delay = next_at - elapsed;
+                if(delay < 0.001) delay = 0.001;
+                conn->conn_wish |= CW_WRITE_BLOCKED;
+                update_io_interest(TK_A_ conn);
+                connection_timer_refresh(TK_A_ conn, delay);
+                return;
+            }
+        }
+
+        /* The --burst-every messages wait for the next burst. */
+        if(conn->cold->burst_slot) {
+            if(available_body > conn->send_burst_room)
+                available_body = conn->send_burst_room;
+            if(!(available_header + available_body)
+               && !(conn->conn_blocked & CBLOCKED_ON_WRITE)) {
+                conn->conn_wish |= CW_WRITE_BLOCKED;
+                update_io_interest(TK_A_ conn);
+                return;
+            }
+        }
+
+        /* No more than the --mirror twin has room to take a copy of. */
+        if(conn->cold->mirror) {
+            size_t room = mirror_room(conn->cold->mirror);
+            if(available_header > room) available_header = room;
+            if(available_body > room - available_header)
+                available_body = room - available_header;
+            if(!(available_header + available_body)) {
+                conn->conn_wish |= CW_WRITE_MIRRORED;
+                update_io_interest(TK_A_ conn);
+                return;
+            }
+        }
+
+        if(conn->send_rate_version != largs->send_rate_version)
+            connection_follow_send_rate(TK_A_ conn);
+
         /* Adjust (available_body) to avoid sending too much stuff. */
         switch(limit_channel_bandwidth(TK_A_ conn, &available_body, TK_WRITE)) {
         case LB_UNLIMITED:
@@ -2676,32 +11213,86 @@ process_WRITE:
             return;
         }
 
+        /* A --udp datagram carries whole messages only. */
+        if((features & CF_UDP) && largs->params.udp
+           && conn->data.single_message_size) {
+            available_body -= available_body % conn->data.single_message_size;
+            if(!(available_header + available_body)) {
+                if(!lockstep) connection_timer_refresh(TK_A_ conn, 0.001);
+                conn->conn_wish |= CW_WRITE_BLOCKED;
+                update_io_interest(TK_A_ conn);
+                return;
+            }
+        }
+
+        /*
+         * --write-combine cork: send the messages due in a single write,
+         * ending at a message boundary. If the bandwidth limit lets out
+         * less than a message, hold it back in the kernel with MSG_MORE
+         * until the rest of the message follows.
+         */
+        int send_more = 0;
+        if(largs->params.write_combine == WRCOMB_CORK
+           && conn->data.single_message_size && available_body) {
+            size_t msgsize = conn->data.single_message_size;
+            size_t end = conn->write_offset + available_header + available_body;
+            size_t partial = end > conn->data.once_size
+                                 ? (end - conn->data.once_size) % msgsize
+                                 : 0;
+            if(partial && available_body > partial)
+                available_body -= partial;
+            else if(partial)
+                send_more = 1;
+        }
+
         if((largs->params.delay_send > 0.0
             && largs->params.delay_send
-                   > tk_now(TK_A) - conn->latency.connection_initiated)) {
+                   > tk_now(TK_A) - conn->cold->latency.connection_initiated)) {
             conn->conn_wish |= CW_WRITE_DELAYED;
             update_io_interest(TK_A_ conn);
             connection_timer_refresh(TK_A_ conn, largs->params.delay_send);
             return;
         }
+
+        /* Only stamp the markers which are about to be sent. */
+        if((features & CF_MARKER) && largs->params.message_marker) {
+            update_timestamps(TK_A_ largs, conn, position,
+                              available_header + available_body);
+        }
+        if(conn->data.slot_count) {
+            update_slots(conn, position, available_header + available_body);
+        }
+        if(conn->http2_frames && conn->pipelined) {
+            http2_number_requests(conn, position,
+                                  available_header + available_body);
+        }
+        if(conn->mqtt_packets && conn->pipelined) {
+            mqtt_number_publishes(conn, position,
+                                  available_header + available_body);
+        }
+
         do { /* Write de-coalescing loop */
             size_t available_write =
                 available_header
-                + (largs->params.write_combine == WRCOMB_ON
+                + ((features & CF_UDP) && largs->params.udp
                        ? available_body
-                       : available_body < conn->send_limit.minimal_move_size
-                             ? available_body
-                             : conn->send_limit.minimal_move_size);
+                       : write_combine_size(largs, conn, available_body));
+
+            struct iovec slice[WRITE_CHUNKS_MAX];
+            int n_slice = iov_slice(chunks, n_chunks, consumed,
+                                    available_write, slice);
+            position = slice[0].iov_base;
 
             ssize_t wrote = 0;
-            if(largs->params.ssl_enable) {
+            if((features & CF_SSL) && largs->params.ssl_enable
+               && !conn->ktls_send) {
 #ifdef HAVE_OPENSSL
                 if(conn->conn_blocked & CBLOCKED_ON_READ) {
                     return;
                 }
                 conn->conn_blocked &= ~CBLOCKED_ON_WRITE;
-                wrote = SSL_write(conn->ssl_fd, position, available_write);
-                switch(SSL_get_error(conn->ssl_fd, wrote)) {
+                wrote = SSL_write(conn->cold->ssl_fd, position, available_write);
+                switch(SSL_get_error(conn->cold->ssl_fd, wrote)) {
                 case SSL_ERROR_NONE:
                     break;
                 case SSL_ERROR_WANT_WRITE:
@@ -2719,9 +11310,54 @@ process_WRITE:
                     wrote = -1;  // Close it
                 }
 #endif
+#ifdef TCPKALI_UDP
+            } else if((features & CF_UDP) && largs->params.udp) {
+                wrote = udp_send_datagrams(tk_fd(w), slice, n_slice,
+                                           available_header,
+                                           conn->data.single_message_size);
+#endif
+#ifdef TCPKALI_SENDFILE
+            } else if(conn->sendfile_body && available_header == 0) {
+                /*
+                 * The messages are sent from the page cache. The body
+                 * is the file, so the position in it is the file offset.
+                 */
+                off_t offset = (const char *)position
+                               - ((const char *)conn->data.ptr
+                                  + conn->data.once_size);
+                wrote = sendfile(tk_fd(w), conn->data.body_fd, &offset,
+                                 slice[0].iov_len);
+#endif
+#ifdef TCPKALI_ZEROCOPY
+            } else if(conn->zerocopy.enabled
+                      && available_write >= ZEROCOPY_MIN_WRITE_SIZE) {
+                struct msghdr msg;
+                memset(&msg, 0, sizeof(msg));
+                msg.msg_iov = slice;
+                msg.msg_iovlen = n_slice;
+                wrote = sendmsg(tk_fd(w), &msg, MSG_ZEROCOPY);
+                if(wrote > 0) conn->zerocopy.sent++;
+#endif
+#ifdef MSG_MORE
+            } else if(send_more) {
+                struct msghdr msg;
+                memset(&msg, 0, sizeof(msg));
+                msg.msg_iov = slice;
+                msg.msg_iovlen = n_slice;
+                wrote = sendmsg(tk_fd(w), &msg, MSG_MORE);
+#endif
+            } else if(n_slice == 1) {
+                wrote = tk_write(tk_fd(w), position, available_write);
             } else {
-                wrote = write(tk_fd(w), position, available_write);
+                wrote = tk_writev(tk_fd(w), slice, n_slice);
+            }
+#ifdef TCPKALI_ZEROCOPY
+            if(wrote == -1 && errno == ENOBUFS && conn->zerocopy.enabled) {
+                /* Out of optmem for page pinning, copy instead. */
+                conn->zerocopy.enabled = 0;
+                continue;
             }
+#endif
             if(wrote == -1) {
                 char buf[INET6_ADDRSTRLEN + 64];
                 switch(errno) {
@@ -2730,9 +11366,12 @@ process_WRITE:
                 case EAGAIN:
                     /* Undo rate limiting if not all data was sent. */
                     if(lockstep) {
-                        tk_timer_stop(TK_A, &conn->timer);
+                        tk_wheel_remove(&largs->timer_wheel, &conn->timer);
                         lockstep = 0; /* Don't pause I/O later */
                     }
+                    /* The send buffer is full of unsent data. */
+                    if(largs->params.write_combine == WRCOMB_ADAPTIVE)
+                        write_combine_adapt(conn, tk_fd(w), INT_MAX);
                     break;
                 case EPIPE:
                 default:
@@ -2744,23 +11383,68 @@ process_WRITE:
                 break;
             } else {
                 conn->write_offset += wrote;
+                /* Wrapped around into the repeated messages? */
+                while((size_t)conn->write_offset > conn->data.total_size) {
+                    conn->write_offset -=
+                        conn->data.total_size - conn->data.once_size;
+                }
+                consumed += wrote;
                 conn->traffic_ongoing.num_writes++;
                 conn->traffic_ongoing.bytes_sent += wrote;
+                connection_stats_dirty(largs, conn);
+                if(conn->cold->mirror) mirror_queue(TK_A_ conn, slice, wrote);
+                if(largs->params.write_combine == WRCOMB_ADAPTIVE
+                   && conn->wrcomb_countdown-- == 0)
+                    write_combine_adapt(conn, tk_fd(w), -1);
+                if(conn->timestamping)
+                    conn->cold->latency.tstamp->bytes_sent += wrote;
+                if(conn->verify_echo) {
+                    size_t left = wrote;
+                    for(int i = 0; i < n_slice && left; i++) {
+                        size_t len = slice[i].iov_len < left ? slice[i].iov_len
+                                                             : left;
+                        echo_verify_sent(conn->cold->echo_verify,
+                                         slice[i].iov_base, len);
+                        left -= len;
+                    }
+                }
+                double intended_ts = send_intended_ts(conn, tk_now(TK_A));
                 if(record_moved)
-                    pacefier_moved(&conn->send_pace, wrote, tk_now(TK_A));
-                if(largs->params.dump_setting & DS_DUMP_ALL_OUT
-                   || ((largs->params.dump_setting & DS_DUMP_ONE_OUT)
-                       && largs->dump_connect_fd == tk_fd(w))) {
-                    debug_dump_data("Snd", tk_fd(w), position, wrote, 0);
+                    send_pace_moved(largs, conn, wrote, tk_now(TK_A));
+                if((features & CF_DUMP)
+                   && (largs->params.dump_setting & DS_DUMP_ALL_OUT
+                       || ((largs->params.dump_setting & DS_DUMP_ONE_OUT)
+                           && largs->dump_connect_fd == tk_fd(w)))) {
+                    size_t left = wrote;
+                    for(int i = 0; i < n_slice && left; i++) {
+                        size_t len = slice[i].iov_len < left ? slice[i].iov_len
+                                                             : left;
+                        debug_dump_data(largs, "Snd", tk_fd(w),
+                                        slice[i].iov_base, len, 0);
+                        left -= len;
+                    }
                 }
                 if((size_t)wrote > available_header) {
-                    position += wrote;
                     wrote -= available_header;
                     available_header = 0;
                     available_body -= wrote;
 
+                    if(conn->cold->burst_slot)
+                        conn->send_burst_room -=
+                            (size_t)wrote < conn->send_burst_room
+                                ? (size_t)wrote
+                                : conn->send_burst_room;
+
                     /* Record latencies for the body only, not headers */
-                    latency_record_outgoing_ts(TK_A_ conn, wrote);
+                    latency_record_outgoing_ts(TK_A_ conn, wrote, intended_ts);
+                    if(conn->pipelined)
+                        conn->cold->pipelined_bytes += wrote;
+                    if(conn->http2_frames)
+                        http2_requests_sent(TK_A_ conn, wrote);
+                    else if(conn->mqtt_packets && conn->pipelined)
+                        mqtt_publishes_sent(conn, wrote);
+                } else {
+                    available_header -= wrote;
                 }
             }
         } while(available_body);
@@ -2768,7 +11452,7 @@ process_WRITE:
         if(lockstep) {
             if(available_body) {
                 /* Undo rate limiting if not all was sent. */
-                tk_timer_stop(TK_A, &conn->timer);
+                tk_wheel_remove(&largs->timer_wheel, &conn->timer);
                 /* Will circle back and might set up a new timer */
             } else {
                 conn->conn_wish |= CW_WRITE_BLOCKED;
@@ -2779,6 +11463,24 @@ process_WRITE:
     } /* (events & TK_WRITE) */
 }
 
+/*
+ * The handler of the connections which may use any of the features.
+ */
+static void
+connection_cb(TK_P_ tk_io *w, int revents) {
+    connection_io(TK_A_ w, revents, CF_ALL);
+}
+
+/* The plain TCP connections, with or without the latency markers. */
+static void
+connection_cb_plain(TK_P_ tk_io *w, int revents) {
+    connection_io(TK_A_ w, revents, 0);
+}
+static void
+connection_cb_marker(TK_P_ tk_io *w, int revents) {
+    connection_io(TK_A_ w, revents, CF_MARKER);
+}
+
 /*
  * Ungracefully close all connections and report accumulated stats
  * back to the central loop structure.
@@ -2795,16 +11497,31 @@ close_all_connections(TK_P_ enum connection_close_reason reason) {
 
 /*
  * Move the connections' stats.data.ptr out into the atomically managed
- * thread-specific aggregate counters.
+ * thread-specific aggregate counters. Only the connections marked
+ * by connection_stats_dirty() since the last flush are visited.
  */
 static void connections_flush_stats(TK_P) {
     struct loop_arguments *largs = tk_userdata(TK_A);
     struct connection *conn;
-    TAILQ_FOREACH(conn, &largs->open_conns, hook) {
+    while((conn = TAILQ_FIRST(&largs->dirty_conns))) {
+        TAILQ_REMOVE(&largs->dirty_conns, conn, cold->dirty_hook);
+        conn->stats_dirty = 0;
         connection_flush_stats(TK_A_ conn);
     }
 }
 
+/*
+ * Note that the connection's traffic_ongoing has changed,
+ * so that the next connections_flush_stats() reports it.
+ */
+static inline void
+connection_stats_dirty(struct loop_arguments *largs, struct connection *conn) {
+    if(!conn->stats_dirty) {
+        conn->stats_dirty = 1;
+        TAILQ_INSERT_TAIL(&largs->dirty_conns, conn, cold->dirty_hook);
+    }
+}
+
 /*
  * Add whatever data transfer counters we accumulated in a connection
  * back to the worker-wide tally.
@@ -2813,49 +11530,425 @@ static void
 connection_flush_stats(TK_P_ struct connection *conn) {
     struct loop_arguments *largs = tk_userdata(TK_A);
     non_atomic_traffic_stats delta =
-        subtract_traffic_stats(conn->traffic_ongoing, conn->traffic_reported);
-    conn->traffic_reported = conn->traffic_ongoing;
+        subtract_traffic_stats(conn->traffic_ongoing, conn->cold->traffic_reported);
+    conn->cold->traffic_reported = conn->traffic_ongoing;
     add_traffic_numbers_NtoA(&delta, &largs->worker_traffic_stats);
+    if(conn->conn_type == CONN_OUTGOING) {
+        add_traffic_numbers_NtoA(
+            &delta, &largs->remote_stats[conn->cold->remote_index].traffic);
+    } else if(conn->conn_type == CONN_INCOMING && largs->peer_table) {
+        struct peer_stats *peer =
+            peer_table_entry(largs->peer_table, conn->cold->peer_index);
+        add_traffic_numbers_NtoN(&delta, &peer->traffic);
+    }
+    if(conn->cold->group) {
+        add_traffic_numbers_NtoA(
+            &delta, &largs->group_stats[conn->cold->group - 1].traffic);
+    }
+}
+
+/*
+ * Allocate a connection structure and its cold part, not initialized.
+ * With --hugepages, they are packed into the 2MB pages of the worker.
+ */
+static struct connection *
+connection_alloc(struct loop_arguments *largs) {
+    struct connection *conn;
+    if(largs->huge_arena) {
+        conn = tk_huge_alloc(largs->huge_arena, sizeof(*conn));
+        if(conn) {
+            conn->cold = tk_huge_alloc(largs->huge_arena, sizeof(*conn->cold));
+            if(conn->cold) {
+                conn->huge = 1;
+                return conn;
+            }
+            tk_huge_free(largs->huge_arena, conn, sizeof(*conn));
+        }
+    }
+    void *ptr;
+    int rc = posix_memalign(&ptr, CONNECTION_ALIGNMENT, sizeof(*conn));
+    assert(rc == 0);
+    conn = ptr;
+    conn->cold = malloc(sizeof(*conn->cold));
+    assert(conn->cold);
+    conn->huge = 0;
+    return conn;
+}
+
+/*
+ * Allocate a zeroed connection structure, reusing a released one if possible.
+ */
+static struct connection *
+connection_new(struct loop_arguments *largs) {
+    struct connection *conn = tk_pool_take(&largs->pools.connections);
+    if(!conn) conn = connection_alloc(largs);
+    struct connection_cold *cold = conn->cold;
+    int huge = conn->huge;
+    memset(conn, 0, sizeof(*conn));
+    memset(cold, 0, sizeof(*cold));
+    conn->cold = cold;
+    conn->huge = huge;
+    conn->pool = &largs->pools.connections;
+    return conn;
+}
+
+/*
+ * The --hugepages connections go away with the arenas, see engine_stop().
+ */
+static void
+connection_destroy(void *ptr) {
+    struct connection *conn = ptr;
+    if(conn->huge) return;
+    free(conn->cold);
+    free(conn);
 }
 
 static void
 free_connection_by_handle(tk_io *w) {
     struct connection *conn =
         (struct connection *)((char *)w - offsetof(struct connection, watcher));
-    free(conn);
+    if(conn->pool)
+        tk_pool_give(conn->pool, conn);
+    else
+        connection_destroy(conn);
+}
+
+/*
+ * Release the pooled objects when the worker is done.
+ */
+static void
+drain_worker_pools(struct loop_arguments *largs) {
+    tk_pool_drain(&largs->pools.connections, connection_destroy);
+    /* The rings may be in the --hugepages arena, see ts_ring_free(). */
+    struct ts_ring *ring;
+    while((ring = tk_pool_take(&largs->pools.sent_timestamps)))
+        ts_ring_free(largs->huge_arena, ring);
+    tk_pool_drain(&largs->pools.sent_timestamps, free); /* Empty by now */
+    tk_pool_drain(&largs->pools.marker_histograms, free);
+    tk_pool_drain(&largs->pools.sbmh_marker_ctxs, free);
+    for(size_t i = 0; i < 2; i++) {
+        struct socket_pool *sp = &largs->pools.sockets[i];
+        while(sp->count) close(sp->fds[--sp->count]);
+    }
+    /* The connections have given back their markers by now. */
+    assert(largs->marker_interns.count == 0);
+    free(largs->marker_interns.buckets);
+    largs->marker_interns.buckets = NULL;
+    largs->marker_interns.buckets_count = 0;
+}
+
+/*
+ * Fill up the pools with the objects for the --prewarm connections,
+ * writing the connections over to fault the pages in, so the connections
+ * opened during the ramp-up do not wait on malloc(3) and the page faults.
+ */
+static void
+worker_prewarm(struct loop_arguments *largs) {
+    size_t n_conns = largs->prewarm_connections;
+
+    /* The timestamp rings are sized as take_ts_ring() would. */
+    size_t rings_per_conn = 0;
+    size_t ring_expected = 0;
+    const struct transport_data_spec *data =
+        largs->params.data_templates[TWS_SIDE_CLIENT];
+    if((largs->params.latency_setting & SLT_MARKER) && data
+       && data->single_message_size) {
+        rings_per_conn = largs->params.latency_correction == LCM_BOTH ? 2 : 1;
+        if(!largs->params.idle_connections)
+            ring_expected = expected_messages_in_flight(
+                largs->params.channel_send_rate, data->single_message_size);
+    }
+
+    for(size_t i = 0; i < n_conns; i++) {
+        struct connection *conn = connection_alloc(largs);
+        struct connection_cold *cold = conn->cold;
+        int huge = conn->huge;
+        memset(conn, 0, sizeof(*conn));
+        memset(cold, 0, sizeof(*cold));
+        conn->cold = cold;
+        conn->huge = huge;
+        tk_pool_give(&largs->pools.connections, conn);
+
+        for(size_t r = 0; r < rings_per_conn; r++) {
+            /* Not touched: most of a ring is never used. */
+            tk_pool_give(&largs->pools.sent_timestamps,
+                         ts_ring_new(largs->huge_arena, ring_expected, 0.0));
+        }
+
+        if(largs->params.latency_per_connection
+           && largs->marker_histogram_local) {
+            struct hdr_histogram *h =
+                hdr_init_similar(largs->marker_histogram_local);
+            hdr_reset(h);
+            tk_pool_give(&largs->pools.marker_histograms, h);
+        }
+    }
+
+    DEBUG(DBG_DETAIL, "Worker %d prewarmed %zu connections\n",
+          largs->thread_no, n_conns);
+
+    pthread_mutex_lock(&largs->prewarm->lock);
+    if(--largs->prewarm->pending == 0)
+        pthread_cond_signal(&largs->prewarm->done);
+    pthread_mutex_unlock(&largs->prewarm->lock);
+}
+
+/*
+ * --reuseport-cpu without --cpu-affinity: the nth worker runs on the nth
+ * CPU we're allowed to run on. With more workers than CPUs, they share them.
+ */
+static void
+worker_cpus(int *cpus, int n) {
+#ifdef HAVE_SCHED_GETAFFINITY
+    cpu_set_t allowed;
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) == 0
+       && CPU_COUNT(&allowed)) {
+        int ncpus = 0;
+        for(int cpu = 0; cpu < CPU_SETSIZE && ncpus < n; cpu++) {
+            if(CPU_ISSET(cpu, &allowed)) cpus[ncpus++] = cpu;
+        }
+        for(int i = ncpus; i < n; i++) cpus[i] = cpus[i % ncpus];
+        return;
+    }
+#endif
+    long ncpus = number_of_cpus();
+    for(int i = 0; i < n; i++) cpus[i] = i % ncpus;
+}
+
+/*
+ * Set up the pinned worker from its own CPU, for the memory it first
+ * touches to come from that CPU's NUMA node. The worker allocates
+ * the rest, such as its pools, after pinning itself to the CPU.
+ */
+static void
+worker_setup_on_cpu(struct engine *eng, int n) {
+#ifdef HAVE_SCHED_GETAFFINITY
+    cpu_set_t saved;
+    if(eng->worker_cpus && sched_getaffinity(0, sizeof(saved), &saved) == 0
+       && cpu_pin_thread(eng->worker_cpus[n]) == 0) {
+        worker_setup(eng, n);
+        sched_setaffinity(0, sizeof(saved), &saved);
+        return;
+    }
+#endif
+    worker_setup(eng, n);
+}
+
+static void
+listen_turn_wait(struct listen_sync *ls, int n) {
+    pthread_mutex_lock(&ls->lock);
+    while(ls->next != n) pthread_cond_wait(&ls->turn, &ls->lock);
+    pthread_mutex_unlock(&ls->lock);
+}
+
+static void
+listen_turn_done(struct listen_sync *ls) {
+    pthread_mutex_lock(&ls->lock);
+    ls->next++;
+    pthread_cond_broadcast(&ls->turn);
+    pthread_mutex_unlock(&ls->lock);
+}
+
+/*
+ * Select the listening socket of the worker pinned to the CPU which
+ * received the connection request, so the connection's packets and its
+ * processing stay on that CPU. The program returns the index of the
+ * socket in the SO_REUSEPORT group; the out of range index on the CPUs
+ * without a worker makes the kernel fall back to hashing.
+ */
+static void
+attach_reuseport_cpu_filter(struct loop_arguments *largs, int lsock) {
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(__linux__)
+    const struct listen_sync *ls = largs->listen_sync;
+    int n_workers = ls->n_workers;
+    if(n_workers > (BPF_MAXINSNS - 2) / 2) n_workers = (BPF_MAXINSNS - 2) / 2;
+    struct sock_filter *code = calloc(2 * n_workers + 2, sizeof(*code));
+    assert(code);
+    size_t n = 0;
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                                             SKF_AD_OFF + SKF_AD_CPU);
+    for(int w = 0; w < n_workers; w++) {
+        /* The first worker pinned to the CPU takes its connections. */
+        code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                                                 ls->cpus[w], 0, 1);
+        code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, w);
+    }
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, ls->n_workers);
+    struct sock_fprog prog = {.len = n, .filter = code};
+    if(setsockopt(lsock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog,
+                  sizeof(prog))
+       == -1) {
+        DEBUG(DBG_ERROR, "Can't steer the connections by CPU: %s\n",
+              strerror(errno));
+    }
+    free(code);
+#else
+    (void)largs;
+    (void)lsock;
+#endif
+}
+
+/*
+ * Add up the memory held by the connection, by component.
+ */
+static void
+connection_account_memory(struct loop_arguments *largs,
+                          const struct connection *conn,
+                          struct engine_memory_stats *ms) {
+    const struct connection_cold *cold = conn->cold;
+    ms->connections++;
+    ms->bytes[EMC_STATE] += sizeof(*conn) + sizeof(*cold);
+
+    if(!(conn->data.flags & TDS_FLAG_PTR_SHARED)) {
+        ms->bytes[EMC_PAYLOAD] +=
+            conn->data.allocated_size
+            + conn->data.marker_offsets_size
+                  * sizeof(conn->data.marker_offsets[0])
+            + conn->data.slots_size * sizeof(conn->data.slots[0]);
+    }
+    if(cold->payload_job) {
+        ms->bytes[EMC_PAYLOAD] +=
+            sizeof(*cold->payload_job) + cold->payload_job->spec.allocated_size
+            + cold->payload_job->spec.marker_offsets_size
+                  * sizeof(cold->payload_job->spec.marker_offsets[0])
+            + cold->payload_job->spec.slots_size
+                  * sizeof(cold->payload_job->spec.slots[0]);
+    }
+
+    if(cold->latency.sbmh_marker_ctx) {
+        ms->bytes[EMC_SEARCH] += SBMH_SIZE(cold->latency.sbmh_size);
+    }
+    if(cold->respond.sbmh_request_ctx) {
+        ms->bytes[EMC_SEARCH] +=
+            SBMH_SIZE(largs->params.request_delimiter_expr->u.data.size);
+    }
+
+    const struct ts_ring *rings[] = {cold->latency.sent_timestamps,
+                                     cold->latency.uncorrected_timestamps};
+    for(size_t i = 0; i < sizeof(rings) / sizeof(rings[0]); i++) {
+        if(!rings[i]) continue;
+        ms->bytes[EMC_TIMESTAMPS] +=
+            sizeof(*rings[i])
+            + ts_ring_capacity(rings[i]) * sizeof(rings[i]->ticks[0]);
+    }
+
+    if(cold->latency.marker_histogram) {
+        ms->bytes[EMC_HISTOGRAMS] +=
+            hdr_get_memory_size(cold->latency.marker_histogram);
+    }
+
+    if(cold->http2.streams) {
+        ms->bytes[EMC_PROTOCOL] +=
+            largs->params.pipeline * sizeof(cold->http2.streams[0]);
+    }
+    ms->bytes[EMC_PROTOCOL] += cold->http2.parser.block_max;
+    if(cold->latency.tstamp) {
+        ms->bytes[EMC_PROTOCOL] += sizeof(*cold->latency.tstamp);
+    }
+}
+
+/*
+ * Account for the memory of the connections still open, see --memory-report.
+ */
+static void
+worker_account_memory(struct loop_arguments *largs) {
+    struct connection *conn;
+    memset(&largs->memory, 0, sizeof(largs->memory));
+    TAILQ_FOREACH(conn, &largs->open_conns, hook) {
+        connection_account_memory(largs, conn, &largs->memory);
+    }
+    /* The marker search tables and the payloads shared by the
+     * connections, once per worker. */
+    for(size_t i = 0; i < largs->marker_interns.buckets_count; i++) {
+        for(struct marker_intern *mi = largs->marker_interns.buckets[i]; mi;
+            mi = mi->next)
+            largs->memory.bytes[EMC_SEARCH] += sizeof(*mi) + mi->size;
+    }
+    for(struct data_template_cache *cache = largs->data_template_caches; cache;
+        cache = cache->next) {
+        for(long i = 0; i < cache->period; i++) {
+            if(cache->data[i].ptr)
+                largs->memory.bytes[EMC_PAYLOAD] +=
+                    cache->data[i].allocated_size;
+        }
+    }
 }
 
 /*
  * Free internal structures associated with connection.
+ * Fixed-size buffers are returned to the worker pools for reuse.
  */
 static void
-connection_free_internals(struct connection *conn) {
-    /* Remove sent timestamps ring */
-    ring_buffer_free(conn->latency.sent_timestamps);
+connection_free_internals(struct loop_arguments *largs,
+                          struct connection *conn) {
+    /* Release sent timestamps ring */
+    if(conn->cold->latency.sent_timestamps)
+        tk_pool_give(&largs->pools.sent_timestamps,
+                     conn->cold->latency.sent_timestamps);
+    if(conn->cold->latency.uncorrected_timestamps)
+        tk_pool_give(&largs->pools.sent_timestamps,
+                     conn->cold->latency.uncorrected_timestamps);
+    free(conn->cold->latency.tstamp);
+    free(conn->cold->framer_state);
+    if(conn->cold->latency.fanout) {
+        if(!largs->fanout_deliveries) {
+            int ret = hdr_init(1, 10000000000LL, LATENCY_SIGNIFICANT_FIGURES,
+                               &largs->fanout_deliveries);
+            assert(ret == 0);
+        }
+        if(conn->cold->latency.fanout->delivered)
+            hdr_record_value(largs->fanout_deliveries,
+                             conn->cold->latency.fanout->delivered);
+        free(conn->cold->latency.fanout);
+    }
+    echo_verify_free(conn->cold->echo_verify);
+#ifdef TCPKALI_ZEROCOPY_RECEIVE
+    if(conn->cold->zerocopy_rx_map)
+        munmap(conn->cold->zerocopy_rx_map, largs->zerocopy_rx_size);
+#endif
+    if(conn->cold->ws_accept_pending) ws_accept_dequeue(largs, conn);
+    if(conn->cold->burst_slot) burst_leave(largs, conn);
+    if(conn->cold->send_queue_slot) send_queue_remove(largs, conn);
+    free(conn->cold->ws_request);
+
+    if(conn->echo) {
+        close(conn->cold->echo.pipe[0]);
+        close(conn->cold->echo.pipe[1]);
+    }
+    free(conn->cold->respond.sbmh_request_ctx);
+    free(conn->cold->http2.streams);
+    free(conn->cold->http2.parser.block);
+#ifdef HAVE_LIBZ
+    if(conn->cold->ws_inflate) {
+        inflateEnd(conn->cold->ws_inflate);
+        free(conn->cold->ws_inflate);
+    }
+#endif
 
-    /* Remove latency histogram data */
-    if(conn->latency.marker_histogram) free(conn->latency.marker_histogram);
+    /* Release latency histogram data */
+    if(conn->cold->latency.marker_histogram)
+        tk_pool_give(&largs->pools.marker_histograms,
+                     conn->cold->latency.marker_histogram);
 
     /* Remove Boyer-Moore-Horspool string search context. */
-    if(conn->latency.sbmh_marker_ctx) {
+    if(conn->cold->latency.sbmh_marker_ctx) {
         /* Receive side of --latency-marker or --message-marker */
-        free(conn->latency.sbmh_marker_ctx);
-        if(conn->latency.sbmh_shared == 0) {
-            free(conn->latency.sbmh_occ);
-            free((void *)conn->latency.sbmh_data);
+        if(conn->cold->latency.sbmh_shared) {
+            tk_pool_give(&largs->pools.sbmh_marker_ctxs,
+                         conn->cold->latency.sbmh_marker_ctx);
+        } else {
+            free(conn->cold->latency.sbmh_marker_ctx);
+            marker_intern_give(largs, conn->cold->latency.sbmh_intern);
         }
     }
 
-    /* Remove --message-stop context. */
-    if(conn->sbmh_stop_ctx) {
-        free(conn->sbmh_stop_ctx);
-    }
+    /* Release --message-stop context. */
 
-    message_collection_free(&conn->message_collection);
+    connection_drop_payload_job(largs, conn);
 
 #ifdef HAVE_OPENSSL
-    if(conn->ssl_ctx) {
-        SSL_CTX_free(conn->ssl_ctx);
+    if(conn->cold->ssl_fd) {
+        SSL_free(conn->cold->ssl_fd);
     }
 #endif
 }
@@ -2869,9 +11962,19 @@ close_connection(TK_P_ struct connection *conn,
     char buf[256];
     struct loop_arguments *largs = tk_userdata(TK_A);
 
+    TK_PROBE3(conn_close, tk_fd(&conn->watcher), conn->conn_type, reason);
+
+    if(conn->fastopen && conn->conn_state == CSTATE_CONNECTED)
+        fastopen_count(largs, tk_fd(&conn->watcher));
+
     /* Stop I/O and timer notifications */
     tk_io_stop(TK_A, &conn->watcher);
-    tk_timer_stop(TK_A, &conn->timer);
+    tk_wheel_remove(&largs->timer_wheel, &conn->timer);
+    tk_wheel_remove(&largs->timer_wheel, &conn->lifetime_timer);
+    if(conn->cold->mirror) mirror_close(TK_A_ conn);
+
+    /* The peer was asked to close it, see --close-style. */
+    if(conn->closing && reason == CCR_REMOTE) reason = CCR_LIFETIME;
 
     switch(reason) {
     case CCR_LIFETIME:
@@ -2883,8 +11986,14 @@ close_connection(TK_P_ struct connection *conn,
         case CONN_OUTGOING:
             /* Make sure we don't go to this address eventually
              * because it is broken. */
-            atomic_increment(
-                &largs->remote_stats[conn->remote_index].connection_failures);
+            atomic_owner_increment(
+                &largs->remote_stats[conn->cold->remote_index]
+                     .connection_failures);
+            remote_health_outcome(largs, conn->cold->remote_index, 1);
+            if(conn->conn_state == CSTATE_CONNECTING)
+                remote_backoff_outcome(largs, conn->cold->remote_index,
+                                       tk_now(TK_A), 1);
+            reconnect_later(TK_A_ conn->conn_state == CSTATE_CONNECTING);
         case CONN_INCOMING:
         case CONN_ACCEPTOR:
             /* Do not affect counters. */
@@ -2897,20 +12006,46 @@ close_connection(TK_P_ struct connection *conn,
         errno = ETIMEDOUT;
         DEBUG(DBG_NORMAL, "Connection to %s is being closed: %s\n",
               format_sockaddr(
-                  &largs->params.remote_addresses.addrs[conn->remote_index],
+                  &largs->params.remote_addresses.addrs[conn->cold->remote_index],
                   buf, sizeof(buf)),
               strerror(errno));
         largs->worker_connection_failures++;
         largs->worker_connection_timeouts++;
+        remote_health_outcome(largs, conn->cold->remote_index, 1);
+        remote_backoff_outcome(largs, conn->cold->remote_index, tk_now(TK_A),
+                               1);
+        reconnect_later(TK_A_ conn->conn_state == CSTATE_CONNECTING);
         break;
     }
 
+    if(conn->recorded) record_received(TK_A_ conn, RECORD_CLOSE, NULL, 0);
+
+    if(conn->verify_echo) {
+        uint64_t offset;
+        if(echo_verify_finish(conn->cold->echo_verify, &offset))
+            echo_mismatch(largs, conn, 1, offset);
+    }
+
+    if(conn->conn_type != CONN_ACCEPTOR && conn->conn_state == CSTATE_CONNECTED) {
+        /* The connections closed as the worker stops are not churned. */
+        if(!largs->loop_stopped) conn->traffic_ongoing.conns_closed++;
+        if(largs->params.close_style == CLOSE_RESET)
+            set_linger_reset(tk_fd(&conn->watcher));
+    }
+
     /* Propagate connection stats back to the worker */
+    if(conn->stats_dirty) {
+        TAILQ_REMOVE(&largs->dirty_conns, conn, cold->dirty_hook);
+        conn->stats_dirty = 0;
+    }
     connection_flush_stats(TK_A_ conn);
+    if(largs->connstats_ring && conn->conn_type != CONN_ACCEPTOR)
+        connstats_record_close(TK_A_ conn, reason);
 
-    if(conn->latency.marker_histogram) {
+    if(conn->cold->latency.marker_histogram
+       && conn->cold->latency.marker_step == largs->marker_step) {
         int64_t n = hdr_add(largs->marker_histogram_local,
-                            conn->latency.marker_histogram);
+                            conn->cold->latency.marker_histogram);
         assert(n == 0);
     }
 
@@ -2921,6 +12056,10 @@ close_connection(TK_P_ struct connection *conn,
             atomic_decrement(&largs->outgoing_connecting);
         else
             atomic_decrement(&largs->outgoing_established);
+        if(largs->remote_outstanding)
+            largs->remote_outstanding[conn->cold->remote_index]--;
+        if(conn->cold->group) largs->group_stats[conn->cold->group - 1].open--;
+        remote_quota_release(largs, conn->cold->remote_index);
         break;
     case CONN_INCOMING:
         atomic_decrement(&largs->incoming_established);
@@ -2931,18 +12070,80 @@ close_connection(TK_P_ struct connection *conn,
 
     TAILQ_REMOVE(&largs->open_conns, conn, hook);
 
-    if(conn->data.ptr && !(conn->data.flags & TDS_FLAG_PTR_SHARED)) {
-        free(conn->data.ptr);
-    }
+    if(conn->data.ptr && !(conn->data.flags & TDS_FLAG_PTR_SHARED))
+        data_spec_free(largs, &conn->data);
 
-    connection_free_internals(conn);
+    connection_free_internals(largs, conn);
 
     /* Stop dumping a given connection, if being dumped. */
     if(largs->dump_connect_fd == tk_fd(&conn->watcher)) {
         largs->dump_connect_fd = 0;
     }
 
-    tk_close(&conn->watcher, free_connection_by_handle);
+    /* The closer thread, if any, does the close(2), see tcpkali_closer.h. */
+    int sockfd = tk_fd(&conn->watcher);
+    tk_release(&conn->watcher, free_connection_by_handle);
+    closer_close(largs->closer_ring, sockfd);
+}
+
+/*
+ * Hand the --per-connection-stats numbers of the closed connection
+ * over to the writer thread.
+ */
+static void
+connstats_record_close(TK_P_ struct connection *conn,
+                       enum connection_close_reason reason) {
+    static const char *const reasons[] = {[CCR_CLEAN] = "clean",
+                                          [CCR_LIFETIME] = "lifetime",
+                                          [CCR_TIMEOUT] = "timeout",
+                                          [CCR_REMOTE] = "remote",
+                                          [CCR_DATA] = "data"};
+    struct loop_arguments *largs = tk_userdata(TK_A);
+
+    if(!conn->cold->connection_unique_id)
+        conn->cold->connection_unique_id = connection_uid_take(largs);
+
+    struct connstats_record rec = {
+        .uid = conn->cold->connection_unique_id,
+        .lifetime = tk_now(TK_A) - conn->cold->latency.connection_initiated,
+        .bytes_sent = conn->traffic_ongoing.bytes_sent,
+        .bytes_rcvd = conn->traffic_ongoing.bytes_rcvd,
+        .msgs_sent = conn->traffic_ongoing.msgs_sent,
+        .msgs_rcvd = conn->traffic_ongoing.msgs_rcvd,
+        .latency_ns = {-1, -1},
+        .close_reason = reasons[reason]};
+
+    if(conn->conn_type == CONN_OUTGOING) {
+        const struct sockaddr_storage *ss =
+            &largs->params.remote_addresses.addrs[conn->cold->remote_index];
+        if(ss->ss_family == AF_INET)
+            memcpy(&rec.remote.sin, ss, sizeof(rec.remote.sin));
+        else if(ss->ss_family == AF_INET6)
+            memcpy(&rec.remote.sin6, ss, sizeof(rec.remote.sin6));
+    }
+
+    if(conn->cold->latency.summary_count) {
+        double to_ns = 1e9 / latency_units_per_second;
+        rec.latency_ns[0] = (double)conn->cold->latency.summary_sum
+                            / conn->cold->latency.summary_count * to_ns;
+        rec.latency_ns[1] = conn->cold->latency.summary_max * to_ns;
+    }
+
+    (void)connstats_append(largs->connstats_ring, &rec);
+}
+
+/*
+ * Stop listening, then the clients only reach the other workers.
+ */
+static void
+close_acceptors(TK_P) {
+    struct loop_arguments *largs = tk_userdata(TK_A);
+    struct connection *conn;
+    while((conn = TAILQ_FIRST(&largs->acceptors))) {
+        TAILQ_REMOVE(&largs->acceptors, conn, hook);
+        tk_io_stop(TK_A, &conn->watcher);
+        tk_close(&conn->watcher, free_connection_by_handle);
+    }
 }
 
 /*
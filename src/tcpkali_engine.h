@@ -35,20 +35,97 @@
 #include "tcpkali_logging.h"
 #include "tcpkali_atomic.h"
 #include "tcpkali_rate.h"
+#include "tcpkali_pacefier.h"
 #include "tcpkali_expr.h"
 #include "tcpkali_dns.h"
+#include "tcpkali_balance.h"
+#include "tcpkali_peers.h"
+#include "tcpkali_proxy.h"
+#include "tcpkali_grpc.h"
+#include "tcpkali_mqtt.h"
+#include "tcpkali_samples.h"
+#include "tcpkali_clock.h"
+#include "tcpkali_pcap.h"
+#include "tcpkali_corpus.h"
 
 long number_of_cpus();
 
 struct engine;
 
+/*
+ * A --connection-group: a share of the outgoing connections
+ * with a workload of its own.
+ */
+struct connection_group {
+    const char *name;  /* name=, or "group1", "group2", ... */
+    double share;      /* Of the outgoing connections, sums up to 1.0 */
+    struct message_collection message_collection; /* message=, or -m copy */
+    struct transport_data_spec *data_templates[2]; /* See engine_start() */
+    rate_spec_t channel_send_rate; /* rate=, upstream= */
+    int own_send_rate;             /* Not following the --message-rate */
+    int own_messages;              /* message=, not following SetMessage */
+    double channel_lifetime;       /* lifetime=, or --channel-lifetime */
+    size_t remote_first; /* target=: params.remote_addresses.addrs[x]... */
+    size_t remote_count; /* ...the group's own; or 0 for the destinations */
+};
+
+/*
+ * The host:port@rate=<R>,max=<N> quota of a destination, shared by all
+ * the addresses it resolves to.
+ */
+struct remote_quota {
+    double connect_rate; /* rate=: new connections per second, or 0 */
+    size_t max_connections; /* max=: open at the same time, or 0 */
+};
+
 struct engine_params {
     struct addresses remote_addresses;
+    struct dns_refresh *dns_refresh; /* --dns-refresh, or NULL */
+    enum remote_select remote_select;     /* --remote-select */
+    struct balance_alias *remote_alias;   /* RSEL_WEIGHTED */
+    struct balance_ring *remote_ring;     /* RSEL_HASH */
+    struct remote_quota *remote_quotas;   /* Of the destinations, or NULL */
+    size_t n_remote_quotas;
+    size_t *remote_quota_index; /* remote_addresses.addrs[x] -> quotas[y] */
     struct addresses listen_addresses;
+    int listen_backlog;                   /* --listen-backlog */
+    int accept_batch;                     /* --accept-batch, per event */
+    int defer_accept;                     /* --defer-accept, seconds */
+    int reuseport_cpu; /* --reuseport-cpu: steer by the receiving CPU */
+    int *cpu_affinity; /* --cpu-affinity: the CPUs of the workers, or NULL */
+    int cpu_affinity_count;
+    double busy_poll; /* --busy-poll: spin that long past an event, s */
     struct addresses source_addresses;
+    struct sockaddr_in6 source_prefix; /* --source-ipv6-prefix */
+    int source_prefix_len;             /* ...its length, or 0 */
     size_t requested_workers;             /* Number of threads to start */
     rate_spec_t channel_send_rate;        /* --channel-upstream */
     rate_spec_t channel_recv_rate;        /* --channel-downstream */
+    enum {
+        ARRIVAL_UNIFORM, /* Evenly spaced messages (default) */
+        ARRIVAL_POISSON, /* Exponentially distributed intervals */
+    } message_arrival;                    /* --message-arrival */
+    int send_phase_jitter;                /* --message-rate-jitter */
+    double send_interval_jitter;          /* Fraction of the interval */
+    double send_burst; /* --burst: messages or bytes, 0.0 for 2s worth */
+    enum pacefier_catchup send_catchup;   /* --catch-up */
+    double burst_every; /* --burst-every: the synchronized bursts, s */
+    unsigned burst_size; /* --burst-size: messages per connection per burst */
+    unsigned send_budget; /* --send-budget: paced writes per loop iteration */
+    enum {
+        RATE_SCOPE_CONNECTION, /* The send rate is per connection */
+        RATE_SCOPE_TOTAL,      /* The send rate is shared by all */
+    } rate_scope;                         /* --rate-scope */
+    struct {
+        enum {
+            RATE_DIST_NONE,   /* Every connection gets the same rate */
+            RATE_DIST_ZIPF,   /* zipf:s, the k-th connection gets 1/k^s */
+            RATE_DIST_PARETO, /* pareto:a, spaced Pareto quantiles */
+        } kind;
+        double param;      /* s or a */
+        size_t population; /* The connections ranked, -c */
+        double norm;       /* Makes the weights average to 1.0 */
+    } rate_distribution;   /* --message-rate-distribution */
     enum verbosity_level verbosity_level; /* Default verbosity level is 1 */
     enum {
         NSET_UNSET = -1,
@@ -58,22 +135,109 @@ struct engine_params {
     enum {
         WRCOMB_OFF = 0, /* Disable write coalescing */
         WRCOMB_ON = 1,  /* Enable write coalescing (default) */
+        WRCOMB_CORK = 2, /* Whole messages per write, the rest held back */
+        WRCOMB_ADAPTIVE = 3, /* Keep the send queue just non-empty */
     } write_combine;
     enum {
         LMODE_DEFAULT = 0x00, /* Do not send data, ignore received data */
         LMODE_ACTIVE = 0x01,  /* Actively send messages */
+        LMODE_ECHO = 0x10,    /* Send the received data back */
+        LMODE_DISCARD = 0x20, /* Drop received data without copying it */
+        LMODE_RESPOND = 0x40, /* Answer requests with the --response */
         _LMODE_RCV_MASK = 0xf0,
         _LMODE_SND_MASK = 0x0f,
     } listen_mode;
     uint32_t sock_rcvbuf_size; /* SO_RCVBUF setting */
     uint32_t sock_sndbuf_size; /* SO_SNDBUF setting */
+    int sock_rcvlowat;         /* --rcvlowat: SO_RCVLOWAT setting */
+    int sock_notsent_lowat;    /* --notsent-lowat: TCP_NOTSENT_LOWAT */
+    int kernel_pacing;         /* --kernel-pacing: SO_MAX_PACING_RATE */
+    double timer_granularity;  /* --timer-granularity: wheel tick, s */
+    size_t read_buffer_size;   /* --read-buffer, per worker */
+    size_t read_budget;        /* --read-budget, per readiness event */
+    int zerocopy;              /* --zerocopy: use MSG_ZEROCOPY for writes */
+    int zerocopy_receive;      /* --zerocopy-receive: TCP_ZEROCOPY_RECEIVE */
+    int sendfile;              /* --sendfile: send the --message-file */
+    int udp;                   /* --udp: connected datagram sockets */
+    int verify_echo;           /* --verify-echo: compare the echoed data */
+    int tcp_info;              /* --tcp-info: sample getsockopt(TCP_INFO) */
+    int mptcp;                 /* --mptcp: IPPROTO_MPTCP stream sockets */
+    enum {
+        TFO_OFF,
+        TFO_LISTEN,  /* Only the listeners take the data in the SYN */
+        TFO_CONNECT, /* The connections send it, too */
+    } tcp_fastopen;            /* --tcp-fastopen */
     double connect_timeout;
     double channel_lifetime;
+    struct {
+        enum {
+            LIFETIME_DIST_FIXED,       /* Every connection lives as long */
+            LIFETIME_DIST_UNIFORM,     /* Within (0, 2*lifetime] */
+            LIFETIME_DIST_EXPONENTIAL, /* Memoryless, the mean lifetime */
+            LIFETIME_DIST_LOGNORMAL,   /* lognormal:sigma, the mean lifetime */
+        } kind;
+        double sigma; /* Of the underlying normal distribution */
+    } lifetime_distribution; /* --channel-lifetime-distribution */
+    enum {
+        CLOSE_GRACEFUL,  /* close(2) right away (default) */
+        CLOSE_RESET,     /* SO_LINGER {1, 0}: RST, no TIME_WAIT */
+        CLOSE_HALF,      /* shutdown(SHUT_WR), wait for the peer to close */
+        CLOSE_WAIT_PEER, /* Stop sending, wait for the peer to close */
+    } close_style;       /* --close-style */
+    int reconnect;             /* --reconnect the lost connections */
+    double reconnect_backoff;  /* --reconnect-backoff, the first delay */
+    double connect_backoff;     /* --connect-backoff, 0 if disabled */
+    double connect_backoff_max; /* --connect-backoff-max */
+    int rebalance;             /* --rebalance the busy workers */
+    enum {
+        WSEL_EVEN,       /* Split evenly, in turn (default) */
+        WSEL_LEAST_CONN, /* Fill up the workers with fewer connections */
+        WSEL_LEAST_BUSY, /* Likewise, weighted by the workers' spare time */
+    } worker_select;     /* --worker-select */
+    size_t prewarm_connections; /* --prewarm: allocate for that many upfront */
+    int memory_report;    /* --memory-report */
+    int cpu_cost;         /* --cpu-cost */
+    int idle_connections; /* --idle-connections: grow the state on demand */
     double epoch;
     int websocket_enable; /* Enable Websocket responder on (-l) */
     int ssl_enable;       /* Enable SSL/TLS */
     char *ssl_cert;       /* SSL/TLS cert file */
     char *ssl_key;        /* SSL/TLS key file */
+    int ssl_session_reuse; /* Resume the TLS sessions per remote */
+    int ssl_ktls;          /* Let the kernel encrypt the writes */
+    int http_enable;        /* --http: count and time the responses */
+    unsigned pipeline;      /* --pipeline: requests in flight */
+    double think_time;      /* --think-time: pause after each response */
+    int http2_enable;       /* --http2: multiplexed requests and responses */
+    uint8_t *http2_headers; /* HPACK-encoded --http2 request headers */
+    size_t http2_headers_size;
+    int grpc_enable; /* --grpc: gRPC calls over the --http2 streams */
+    int grpc_stream; /* --grpc-stream: a streaming call per connection */
+    unsigned framing_prefix_size; /* --framing lenprefix, 0 if disabled */
+    int framing_little_endian;
+    const struct tcpkali_framer *framer; /* --framer plugin, or NULL */
+    int resp_enable; /* --resp: Redis commands and replies */
+    enum mqtt_version mqtt_version; /* --mqtt, 0 if disabled */
+    int mqtt_qos;                   /* --mqtt-qos of the PUBLISH packets */
+    tk_expr_t *mqtt_topic_expr;     /* --mqtt-topic, or NULL */
+    tk_expr_t *mqtt_subscribe_expr; /* --mqtt-subscribe, or NULL */
+    struct pcap_replay *replay;  /* --replay-pcap streams, or NULL */
+    int replay_original_timing; /* --replay-timing original */
+    struct message_corpus *corpus; /* --message-corpus, or NULL */
+    struct connection_group *groups; /* --connection-group, or NULL */
+    size_t n_groups;
+    size_t group_remotes; /* Trailing remote_addresses of the target= */
+    struct addresses mirror_addresses; /* --mirror target, or none */
+    const char *record_dir;     /* --record the received data, or NULL */
+    double record_sample;       /* --record-sample: connections recorded */
+    const char *connstats_file; /* --per-connection-stats, or NULL */
+    double sample_interval;     /* --sample-interval <Time>, or 0.0 */
+    int peer_stats; /* --per-peer-stats, by the prefixes of the bits: */
+    unsigned peer_stats_ipv4_bits;
+    unsigned peer_stats_ipv6_bits;
+    enum proxy_protocol proxy_protocol; /* --proxy-protocol v1|v2 */
+    struct proxy_source proxy_source;   /* --proxy-source, or family 0 */
+    int hugepages; /* --hugepages: connections and payloads in 2MB pages */
     /* Pre-computed message data template */
     struct message_collection message_collection;  /* A descr. what to send */
     struct transport_data_spec *data_templates[2]; /* client, server tmpls */
@@ -87,20 +251,49 @@ struct engine_params {
     } dump_setting;
     statsd_report_latency_types latency_setting;
     int latency_marker_skip;        /* --latency-marker-skip <N> */
+    unsigned latency_sample;        /* --latency-sample 1/<N>, 0: all */
+    int latency_per_connection;     /* --latency-per-connection */
+    int latency_by_size;            /* --latency-by-size */
+    int latency_slowest;            /* --latency-slowest <N> */
+    enum latency_correction_mode {
+        LCM_OFF,  /* Measure from the actual send time */
+        LCM_ON,   /* Measure from the intended send time */
+        LCM_BOTH, /* Both of the above, for --latency-marker */
+    } latency_correction;           /* --latency-correction */
+    enum latency_timestamping_mode {
+        LTS_OFF,      /* User space send and receive times */
+        LTS_SOFTWARE, /* Kernel SO_TIMESTAMPING software timestamps */
+        LTS_HARDWARE, /* NIC SO_TIMESTAMPING hardware timestamps */
+    } latency_timestamping;         /* --latency-timestamping */
     int message_marker;             /* \{message.marker} */
+    enum tk_clock_source latency_clock; /* --latency-clock */
+    int64_t clock_offset_ns;        /* --clock-offset, --clock-sync */
+    double latency_max;             /* --latency-max, seconds */
+    int message_marker_binary;      /* --message-marker-format binary */
+    int fanout;                     /* --fanout: sequences by publisher */
     double delay_send;              /* --delay-send <Time> */
+    double slow_send;               /* --slow-send: seconds per byte, or 0 */
+    tk_expr_t *keepalive_expr;      /* --keepalive-message, or NULL */
+    double keepalive_interval;      /* --keepalive-interval <Time> */
     tk_expr_t *latency_marker_expr; /* --latency-marker */
-    tk_expr_t *message_stop_expr;   /* --message-stop */
+    struct tk_multiscan *message_stop; /* --message-stop, compiled */
+    tk_expr_t *request_delimiter_expr; /* --request-delimiter */
+    tk_expr_t *response_expr;          /* --response, --response-file */
 
     /* Streaming Boyer-Moore-Horspool */
     struct StreamBMH_Occ sbmh_shared_marker_occ; /* --latency-marker */
-    struct StreamBMH_Occ sbmh_shared_stop_occ;   /* --message-stop */
+    struct StreamBMH_Occ sbmh_shared_request_occ; /* --request-delimiter */
 };
 
 struct engine *engine_start(struct engine_params);
 const struct engine_params *engine_params(struct engine *);
 rate_spec_t engine_set_message_send_rate(struct engine *, double msg_rate);
 rate_spec_t engine_update_send_rate(struct engine *, double multiplier);
+/*
+ * Change the message rate without restarting the measurements,
+ * unlike engine_set_message_send_rate().
+ */
+void engine_follow_message_send_rate(struct engine *, double msg_rate);
 
 /*
  * Report the number of opened connections by categories.
@@ -108,23 +301,333 @@ rate_spec_t engine_update_send_rate(struct engine *, double multiplier);
 void engine_get_connection_stats(struct engine *, size_t *connecting,
                                  size_t *incoming, size_t *outgoing,
                                  size_t *counter);
+void engine_get_worker_connection_stats(struct engine *, int worker,
+                                        size_t *connecting, size_t *incoming,
+                                        size_t *outgoing);
+
+/*
+ * The event loop saturation of the workers, the worst worker's numbers.
+ * The workers publish them every 250ms.
+ */
+struct engine_loop_stats {
+    double busy;  /* Share of time spent running the callbacks (libev) */
+    double lag;   /* How late the periodic worker timer fired, s */
+    double stall; /* The longest loop iteration, s (libev) */
+    double events_per_iteration; /* Averaged across the workers (libev) */
+    double pacing_debt; /* How far a connection fell behind its rate, s */
+    int saturated;      /* Some worker could not keep up recently */
+    /* Since the start of the test */
+    double saturated_share; /* Share of time some worker was saturated */
+    double max_lag;         /* The worst lag seen, s */
+};
+void engine_loop_stats(struct engine *, struct engine_loop_stats *);
+/* The numbers of a single worker, see engine_workers(). */
+void engine_worker_loop_stats(struct engine *, int worker,
+                              struct engine_loop_stats *);
+
+/*
+ * The CPU the workers have taken, see --cpu-cost. The workers publish
+ * the numbers every 250ms and as they exit.
+ */
+struct engine_cpu_stats {
+    double seconds;        /* User and system, getrusage(RUSAGE_THREAD) */
+    uint64_t cycles;       /* perf_event_open(2), 0 if not available */
+    uint64_t instructions; /* Likewise */
+    /* The traffic the CPU was spent on, for the per-message numbers. */
+    uint64_t bytes;    /* Sent and received */
+    uint64_t messages; /* Sent and received */
+};
+void engine_cpu_stats(struct engine *, struct engine_cpu_stats *);
+
+/*
+ * Move some connections from the busiest worker to the least busy one,
+ * if the two are far apart, see --rebalance. Only the default libev
+ * backend measures the workers' busy time, so this is a no-op otherwise.
+ */
+void engine_rebalance(struct engine *);
+
+/*
+ * Change the number of running workers to (n), between one and
+ * the number of CPUs. The new workers take their share of the connections
+ * opened from now on. A retired worker leaves its connections to the
+ * others (libev), or closes them while as many are opened elsewhere.
+ * Returns the resulting number of workers.
+ */
+int engine_set_workers(struct engine *, int n);
+
+/*
+ * Replace the --message of the connections, see SetMessage.
+ * The connections keep going, and switch over to the new messages
+ * once done with the message being sent; the ones of
+ * a --connection-group with a message= of its own keep it.
+ * Returns -1 if the message is not used, the reason is printed.
+ */
+int engine_set_message(struct engine *, const char *data, size_t size);
+int engine_running_workers(struct engine *);
 
 /*
- * Create snapshot of the current latency histogram.
+ * Create snapshot of the latency histograms most recently published
+ * by the workers. The workers publish them every few tens of milliseconds,
+ * so this never waits for them.
  */
-void engine_prepare_latency_snapshot(struct engine *);
 struct latency_snapshot *engine_collect_latency_snapshot(struct engine *);
+/* The histograms of a single worker, see engine_workers(). */
+struct latency_snapshot *engine_collect_worker_latency_snapshot(struct engine *,
+                                                                int worker);
 struct latency_snapshot *engine_diff_latency_snapshot(struct latency_snapshot *base, struct latency_snapshot *update);
+/* Same as engine_diff_latency_snapshot(), turning (update) into the diff. */
+void engine_subtract_latency_snapshot(struct latency_snapshot *update,
+                                      const struct latency_snapshot *base);
+/* The snapshots are kept for reuse by the later engine_collect_*() calls. */
 void engine_free_latency_snapshot(struct latency_snapshot *);
 
+/*
+ * Reset all the latency histograms of the workers and their connections,
+ * without changing the message rate. See --warmup.
+ */
+void engine_reset_latency(struct engine *);
+
+/*
+ * Take the traffic of the next --sample-interval all the workers are done
+ * with, and the (start) of that interval in tk_now() time. The interval
+ * is counted into the summary if it starts at (from) or later.
+ * Returns 0 if there is no such interval yet, or no --sample-interval.
+ */
+int engine_next_sample(struct engine *, double from,
+                       struct throughput_sample *, double *start);
+
 size_t engine_initiate_new_connections(struct engine *, size_t n);
+/*
+ * Close (n) outgoing connections. The request replaces any earlier one
+ * not yet carried out by the workers.
+ */
+size_t engine_close_connections(struct engine *, size_t n);
 
 non_atomic_traffic_stats engine_traffic(struct engine *);
 
+/*
+ * The number of workers ever started and their individual traffic numbers.
+ * The retired workers keep their numbers, see engine_set_workers().
+ */
+int engine_workers(struct engine *);
+int engine_workers_max(struct engine *);
+non_atomic_traffic_stats engine_worker_traffic(struct engine *, int worker);
+
+/*
+ * Make the destinations added by --dns-refresh since the last call
+ * visible in engine_params()->remote_addresses. Called by the main thread.
+ */
+void engine_refresh_remote_addresses(struct engine *);
+
+/*
+ * Connection attempts and failures towards the given
+ * engine_params()->remote_addresses entry, across all workers.
+ */
+void engine_get_remote_stats(struct engine *, size_t remote_index,
+                             size_t *attempts, size_t *failures);
+
+/*
+ * Traffic of the outgoing connections to the given remote address.
+ */
+non_atomic_traffic_stats engine_remote_traffic(struct engine *,
+                                               size_t remote_index);
+
+/*
+ * Latencies observed with the given remote address. The per-remote
+ * histograms are kept with two significant figures, and only if there are
+ * 2..ENGINE_REMOTE_LATENCY_MAX destination addresses; returns NULL otherwise.
+ */
+#define ENGINE_REMOTE_LATENCY_MAX 100
+struct latency_snapshot *engine_collect_remote_latency_snapshot(
+    struct engine *, size_t remote_index);
+
+/*
+ * Traffic and latencies of the connections of a --connection-group.
+ * The latencies are collected with --latency-* only; NULL otherwise.
+ */
+non_atomic_traffic_stats engine_group_traffic(struct engine *, size_t group);
+struct latency_snapshot *engine_collect_group_latency_snapshot(
+    struct engine *, size_t group);
+
+/*
+ * The distributions of the TCP_INFO values sampled from the established
+ * connections with --tcp-info, and of the MPTCP_INFO values with --mptcp,
+ * gathered across workers.
+ */
+enum engine_tcp_info_metric {
+    ETI_RTT,                /* tcpi_rtt, microseconds */
+    ETI_RETRANSMITS,        /* tcpi_total_retrans */
+    ETI_CWND,               /* tcpi_snd_cwnd, segments */
+    ETI_UNACKED,            /* tcpi_unacked, segments */
+    ETI_MPTCP_SUBFLOWS,     /* mptcpi_subflows, the initial subflow too */
+    ETI_MPTCP_SUBFLOW_RATE, /* tcpi_delivery_rate of a subflow, kbit/s */
+    ETI_METRICS
+};
+struct tcp_info_snapshot {
+    struct hdr_histogram *histogram[ETI_METRICS];
+    /* --mptcp: the connections established, and those the peer or
+     * the path made fall back to plain TCP. */
+    size_t mptcp_connections;
+    size_t mptcp_fallbacks;
+    /* --tcp-fastopen: the connections which tried to put the data into
+     * the SYN, and those whose SYN data the server acknowledged. */
+    size_t fastopen_connections;
+    size_t fastopen_accepted;
+};
+/* Returns NULL without --tcp-info, --mptcp or --tcp-fastopen. */
+struct tcp_info_snapshot *engine_collect_tcp_info_snapshot(struct engine *);
+void engine_free_tcp_info_snapshot(struct tcp_info_snapshot *);
+/* Whether the kernel opens IPPROTO_MPTCP sockets, see --mptcp. */
+int engine_mptcp_available(void);
+
+/*
+ * The memory held by the connections open at the end of the test,
+ * by component, see --memory-report. The kernel socket buffers
+ * and the TLS and zlib contexts are not counted.
+ */
+enum engine_memory_component {
+    EMC_STATE,      /* struct connection and its cold part */
+    EMC_PAYLOAD,    /* The data to send, unless shared between connections */
+    EMC_SEARCH,     /* The Boyer-Moore-Horspool search contexts */
+    EMC_TIMESTAMPS, /* The sent message timestamp rings */
+    EMC_HISTOGRAMS, /* --latency-per-connection */
+    EMC_PROTOCOL,   /* The --http2 streams, --latency-timestamping state */
+    EMC_COMPONENTS
+};
+struct engine_memory_stats {
+    size_t connections;
+    size_t bytes[EMC_COMPONENTS];
+};
+/* "state", "payload", etc. */
+const char *engine_memory_component_name(enum engine_memory_component);
+
+/*
+ * The numbers of the steady state, see --until-stable.
+ */
+enum engine_steady_metric {
+    ESM_BPS_IN,  /* Bits per second received */
+    ESM_BPS_OUT, /* Bits per second sent */
+    ESM_MPS_IN,  /* Messages per second received */
+    ESM_MPS_OUT, /* Messages per second sent */
+    ESM_LATENCY, /* --latency-marker 95th percentile, ms */
+    ESM_METRICS
+};
+struct engine_steady_summary {
+    int windows;  /* One second windows it held for; 0 if never steady */
+    double after; /* Seconds into the test */
+    struct engine_estimate {
+        double mean; /* NAN if not measured */
+        double ci95; /* Half-width of the 95% confidence interval */
+    } values[ESM_METRICS];
+};
+/* "bps_in", "latency_ms", etc. */
+const char *engine_steady_metric_name(enum engine_steady_metric);
+
+/*
+ * The final numbers of a test, as printed by engine_terminate().
+ */
+struct engine_summary {
+    double test_duration;             /* Since epoch_start */
+    non_atomic_traffic_stats traffic; /* Since epoch_start */
+    size_t connecting;
+    size_t conns_in;
+    size_t conns_out;
+    size_t connections_counter;
+    size_t n_remotes; /* engine_params()->remote_addresses.n_addrs */
+    struct engine_remote_summary {
+        size_t connection_attempts;
+        size_t connection_failures;
+        non_atomic_traffic_stats traffic; /* Since the start of the test */
+        struct latency_snapshot *latency; /* Optional, since the start */
+    } *remotes;
+    size_t n_groups; /* engine_params()->n_groups */
+    struct engine_group_summary {
+        non_atomic_traffic_stats traffic; /* Since the start of the test */
+        struct latency_snapshot *latency; /* Optional, since the start */
+    } *groups;
+    /*
+     * The --latency-marker latencies at each message rate, if the rate
+     * changed during the test: up and down arrows, --message-rate
+     * @<Latency>, SetRateAt.
+     */
+    size_t n_rate_steps;
+    struct engine_rate_step_summary {
+        rate_spec_t rate;
+        double duration;                 /* Seconds at the rate */
+        struct hdr_histogram *histogram; /* The marker latencies */
+    } *rate_steps;
+    /*
+     * The --latency-by-size marker latencies, by the message size class.
+     * Only the classes with the latencies recorded are reported.
+     */
+    size_t n_size_classes;
+    struct engine_size_class_summary {
+        size_t size_min; /* Bytes */
+        size_t size_max; /* Bytes, 0 for no limit */
+        struct hdr_histogram *histogram;
+    } *size_classes;
+    /* The --latency-slowest messages, the slowest first. */
+    size_t n_slowest;
+    struct engine_slow_message {
+        double latency;         /* Seconds */
+        double connection_age;  /* Since the connection was initiated */
+        int remote_index;       /* params.remote_addresses, -1 if incoming */
+        unsigned connection_uid;
+        size_t bytes_in_flight; /* Sent, but not received back yet */
+    } *slowest;
+    /* The --fanout messages delivered to each subscribing connection. */
+    struct hdr_histogram *fanout_deliveries;
+    struct latency_snapshot *latency;
+    struct tcp_info_snapshot *tcp_info; /* --tcp-info, --mptcp */
+    struct engine_memory_stats memory;  /* --memory-report */
+    struct engine_loop_stats loop;
+    struct engine_cpu_stats cpu; /* --cpu-cost, of the whole run */
+    /* --per-peer-stats: the accepted connections by the peer prefix */
+    size_t n_peers;
+    struct peer_stats *peers;
+    /* --latency-sample: the samples dropped for the lack of ring space */
+    uint64_t latency_samples_dropped;
+    /* --sample-interval: the traffic per interval, by enum sample_metric */
+    struct hdr_histogram *throughput[SAMPLE_METRICS];
+    /* --grpc: the calls by grpc-status, the last ones ended without one */
+    uint64_t grpc_calls[GRPC_STATUS_CODES + 1];
+    /* --mirror: the twin connections and the data copied to them */
+    struct engine_mirror_summary {
+        size_t opened;          /* Connected to the --mirror target */
+        size_t failed;          /* Refused, or broken before their pair */
+        uint64_t bytes_sent;    /* To the --mirror target */
+        uint64_t bytes_rcvd;    /* From it, and thrown away */
+        uint64_t bytes_dropped; /* Queued for a twin, never sent */
+    } mirror;
+    /* The --abort-if condition which ended the test, filled by the caller */
+    struct engine_abort_summary {
+        char condition[128]; /* Empty if the test ran its course */
+        double value; /* Milliseconds for the latencies, errors per second */
+    } abort;
+    struct engine_steady_summary steady; /* Filled by the caller */
+};
+void engine_free_summary(struct engine_summary *);
+
 void engine_terminate(struct engine *, double epoch_start,
                       /* Traffic observed during ramp-up phase */
                       non_atomic_traffic_stats initial_traffic,
                       /* Report latencies at specified %'iles */
-                      struct percentile_values *report_latency_percentiles);
+                      struct percentile_values *report_latency_percentiles,
+                      /* Optional, filled with the printed numbers */
+                      struct engine_summary *summary);
+
+/*
+ * Same as engine_terminate(), without printing the (summary).
+ */
+void engine_stop(struct engine *, double epoch_start,
+                 non_atomic_traffic_stats initial_traffic,
+                 struct engine_summary *summary);
+
+/*
+ * Print the final numbers, as engine_terminate() does.
+ */
+void engine_summary_print(const struct engine_params *,
+                          const struct percentile_values *,
+                          const struct engine_summary *);
 
 #endif /* TCPKALI_ENGINE_H */
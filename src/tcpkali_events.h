@@ -41,6 +41,8 @@ typedef uv_loop_t tk_loop;
         int r = close(fd);                                 \
         assert(r == 0);                                    \
     } while(0)
+#define tk_release(w, free_cb) \
+    uv_close((uv_handle_t*)(w), (uv_close_cb)free_cb)
 #define tk_userdata(loop) ((loop)->data)
 #define tk_set_userdata(loop, p) ((loop)->data = (p))
 #define tk_loop_new() uv_loop_new()
@@ -48,6 +50,74 @@ typedef uv_loop_t tk_loop;
 #define tk_io_stop(loop, p) uv_poll_stop((p))
 #define tk_timer_stop(loop, t) uv_timer_stop((t))
 
+#elif HAVE_IO_URING == 1 /* Use io_uring */
+/****************/
+/* Use io_uring */
+/****************/
+#define USE_IO_URING 1
+
+#include "tcpkali_uring.h"
+
+#define TK_DEFAULT (tk_uring_default_loop())
+#define TK_P_ tk_loop *loop,
+#define TK_P tk_loop *loop
+#define TK_A_ loop,
+#define TK_A loop
+
+#define TK_READ TK_URING_READ
+#define TK_WRITE TK_URING_WRITE
+
+#define tk_now_update(loop) tk_uring_now_update(loop)
+#define tk_now(loop) tk_uring_now(loop)
+
+typedef tk_uring_io tk_io;
+typedef tk_uring_timer tk_timer;
+typedef struct tk_uring_loop tk_loop;
+
+#define tk_fd(w) ((w)->fd)
+#define tk_close(w, free_cb)          \
+    do {                              \
+        tk_uring_io_close(tk_fd(w));  \
+        close(tk_fd(w));              \
+        (w)->fd = -1;                 \
+        free_cb(w);                   \
+    } while(0)
+#define tk_release(w, free_cb)        \
+    do {                              \
+        tk_uring_io_close(tk_fd(w));  \
+        (w)->fd = -1;                 \
+        free_cb(w);                   \
+    } while(0)
+#define tk_userdata(loop) tk_uring_userdata(loop)
+#define tk_set_userdata(loop, p) tk_uring_set_userdata((loop), (p))
+#define tk_loop_new() tk_uring_loop_new()
+#define tk_stop(loop) tk_uring_break(loop)
+#define tk_io_stop(loop, p) tk_uring_io_stop((loop), (p))
+#define tk_timer_stop(loop, t) tk_uring_timer_stop((loop), (t))
+
+/*
+ * The engine's non-libuv code is written against libev.
+ * Map the libev calls it makes onto the io_uring loop.
+ */
+#define ev_io_init tk_uring_io_init
+#define ev_io_set tk_uring_io_set
+#define ev_io_start tk_uring_io_start
+#define ev_io_stop tk_uring_io_stop
+#define ev_timer_init tk_uring_timer_init
+#define ev_timer_set tk_uring_timer_set
+#define ev_timer_start tk_uring_timer_start
+#define ev_timer_stop tk_uring_timer_stop
+#define ev_run(loop, flags) tk_uring_run(loop)
+
+/* The data of the tk_uring_io_stream() sockets is moved by the loop. */
+#define tk_socket(domain, type, protocol) socket((domain), (type), (protocol))
+#define tk_connect(fd, addr, len) connect((fd), (addr), (len))
+#define tk_accept(fd, addr, len) accept((fd), (addr), (len))
+#define tk_accept4(fd, addr, len, flags) accept4((fd), (addr), (len), (flags))
+#define tk_read(fd, buf, size) tk_uring_read((fd), (buf), (size))
+#define tk_write(fd, buf, size) tk_uring_write((fd), (buf), (size))
+#define tk_writev(fd, iov, iovcnt) tk_uring_writev((fd), (iov), (iovcnt))
+
 #else /* Use libev */
 /*************/
 /* Use libev */
@@ -78,6 +148,11 @@ typedef struct ev_loop tk_loop;
         (w)->fd = -1;        \
         free_cb(w);          \
     } while(0)
+#define tk_release(w, free_cb) \
+    do {                       \
+        (w)->fd = -1;          \
+        free_cb(w);            \
+    } while(0)
 #define tk_userdata ev_userdata
 #define tk_set_userdata ev_set_userdata
 #define tk_loop_new()                     \
@@ -87,6 +162,23 @@ typedef struct ev_loop tk_loop;
 #define tk_io_stop(loop, p) ev_io_stop((loop), (p))
 #define tk_timer_stop(loop, t) ev_timer_stop((loop), (t))
 
-#endif /* libuv vs libev */
+#endif /* libuv vs io_uring vs libev */
+
+/*
+ * The socket calls of the connections' data path: start_new_connection(),
+ * accept_one() and connection_cb(). These go to the kernel TCP/IP stack.
+ * A backend running the connections on a user space stack (such as the
+ * ff_socket(), ff_read() family of F-Stack) would define them ahead,
+ * along with its own tk_io loop over that stack's event notification.
+ */
+#ifndef tk_socket
+#define tk_socket(domain, type, protocol) socket((domain), (type), (protocol))
+#define tk_connect(fd, addr, len) connect((fd), (addr), (len))
+#define tk_accept(fd, addr, len) accept((fd), (addr), (len))
+#define tk_accept4(fd, addr, len, flags) accept4((fd), (addr), (len), (flags))
+#define tk_read(fd, buf, size) read((fd), (buf), (size))
+#define tk_write(fd, buf, size) write((fd), (buf), (size))
+#define tk_writev(fd, iov, iovcnt) writev((fd), (iov), (iovcnt))
+#endif
 
 #endif /* TCPKALI_EVENTS */
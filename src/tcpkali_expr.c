@@ -36,9 +36,40 @@
 #include "tcpkali_terminfo.h"
 #include "tcpkali_data.h"
 #include "tcpkali_expr.h"
+#include "tcpkali_random.h"
+
+/*
+ * A linear sequence of steps equivalent to a tree of concatenations.
+ */
+struct tk_expr_program {
+    struct tk_expr_op {
+        enum {
+            TKOP_COPY,     /* Copy a literal */
+            TKOP_CALLBACK, /* Emit a connection.uid, connection.ptr, marker */
+            TKOP_REGEX,    /* Emit a string matching a regular expression */
+            TKOP_RANDOM,   /* Emit a block of random data */
+            TKOP_ZIPF,     /* Emit a key drawn from the alias table */
+            TKOP_EXPR,     /* Evaluate a subexpression, e.g., modulo */
+        } code;
+        union {
+            struct {
+                size_t offset; /* Into the literals */
+                size_t size;
+            } copy;
+            tk_expr_t *expr;
+        } u;
+    } *ops;
+    size_t ops_count;
+    size_t ops_size;
+    char *literals;
+    size_t literals_size;
+    size_t literals_allocated;
+    size_t estimate_size;
+};
 
 int yyparse(void **param);
 void *yy_scan_bytes(const char *, int len);
+void expr_lex_reset(void);
 void *yy_delete_buffer(void *);
 void *yyrestart(FILE *);
 
@@ -73,20 +104,31 @@ free_expression(tk_expr_t *expr, int delete_data) {
         case EXPR_CONNECTION_PTR:
         case EXPR_CONNECTION_UID:
         case EXPR_MESSAGE_MARKER:
+        case EXPR_MESSAGE_SEQ:
+        case EXPR_TIME_US:
+        case EXPR_RANDOM:
+            break;
+        case EXPR_ZIPF:
+            if(delete_data) free(expr->u.zipf.table);
             break;
         case EXPR_REGEX:{
             if (delete_data) tregex_free(expr->u.regex.re);
             break;
         };
         }
-        if (expr->res_buf) free((void *)expr->res_buf);
+        if (expr->program) {
+            free(expr->program->ops);
+            free(expr->program->literals);
+            free(expr->program);
+        }
         free((void *) expr);
     }
 }
 
-int
-parse_expression(tk_expr_t **expr_p, const char *buf, size_t size, int debug) {
+static int
+parse_grammar(tk_expr_t **expr_p, const char *buf, size_t size, int debug) {
     void *ybuf;
+    expr_lex_reset();
     ybuf = yy_scan_bytes(buf, size);
     if(!ybuf) {
         assert(ybuf);
@@ -117,6 +159,318 @@ parse_expression(tk_expr_t **expr_p, const char *buf, size_t size, int debug) {
     }
 }
 
+/*
+ * Find the end of the \{expression} which starts with the opening brace
+ * at (p), that is, past its closing brace. The quoted strings and the
+ * regex classes may have the braces of their own. Returns NULL
+ * if the end is not found, for the grammar to tell what is wrong.
+ */
+static const char *
+fragment_end(const char *p, const char *end) {
+    int depth = 0;
+    for(; p < end; p++) {
+        switch(*p) {
+        case '{':
+            depth++;
+            break;
+        case '}':
+            if(--depth == 0) return p + 1;
+            break;
+        case '"':
+            for(p++; p < end && *p != '"'; p++) {
+                if(*p == '\\') p++;
+            }
+            if(p >= end) return NULL;
+            break;
+        case '[':
+            p = memchr(p, ']', end - p);
+            if(!p) return NULL;
+            break;
+        }
+    }
+    return NULL;
+}
+
+static tk_expr_t *
+literal_expression(const char *data, size_t size) {
+    tk_expr_t *expr = calloc(1, sizeof(*expr));
+    assert(expr);
+    char *p = malloc(size + 1);
+    assert(p);
+    memcpy(p, data, size);
+    p[size] = '\0';
+    expr->type = EXPR_DATA;
+    expr->u.data.data = p;
+    expr->u.data.size = size;
+    expr->estimate_size = size;
+    return expr;
+}
+
+/*
+ * Concatenate the parts pairwise, so the tree is only as deep
+ * as the log of the number of parts.
+ */
+static tk_expr_t *
+concat_parts(tk_expr_t **parts, size_t n) {
+    if(n == 1) return parts[0];
+    return concat_expressions(concat_parts(parts, n / 2),
+                              concat_parts(parts + n / 2, n - n / 2));
+}
+
+/*
+ * The literal data is split off with memchr(), and only
+ * the \{expressions} are left to the grammar, one by one.
+ * For the large --message-file with a few expressions, this is both faster
+ * and does not keep the whole data on the parser stack.
+ */
+int
+parse_expression(tk_expr_t **expr_p, const char *buf, size_t size, int debug) {
+    const char *end = buf + size;
+    const char *literal = buf;
+    tk_expr_t **parts = NULL;
+    size_t parts_count = 0;
+    size_t parts_size = 0;
+    int unclosed = 0;
+
+    if(expr_p) *expr_p = 0;
+    if(size == 0) return parse_grammar(expr_p, buf, size, debug);
+
+    for(const char *p = buf; (p = memchr(p, '\\', end - p));) {
+        /* The lexer takes "\\\\" for a literal, before any "\\{". */
+        if(p + 1 < end && p[1] == '\\') {
+            p += 2;
+            continue;
+        } else if(p + 1 == end || p[1] != '{') {
+            p++;
+            continue;
+        }
+
+        const char *fragment = p;
+        p = fragment_end(fragment + 1, end);
+        if(!p) {
+            unclosed = 1;
+            break;
+        }
+
+        if(parts_count + 3 > parts_size) {
+            parts_size = parts_size ? 2 * parts_size : 16;
+            parts = realloc(parts, parts_size * sizeof(parts[0]));
+            assert(parts);
+        }
+        if(fragment > literal)
+            parts[parts_count++] =
+                literal_expression(literal, fragment - literal);
+        if(parse_grammar(&parts[parts_count], fragment, p - fragment, debug)
+           == -1)
+            goto fail;
+        parts_count++;
+        literal = p;
+    }
+
+    if(parts_count == 0) {
+        /* The grammar takes the rest, such as a brace not closed. */
+        if(unclosed) return parse_grammar(expr_p, buf, size, debug);
+        parts = malloc(sizeof(parts[0]));
+        assert(parts);
+    }
+    if(literal < end) {
+        if(unclosed) {
+            if(parse_grammar(&parts[parts_count], literal, end - literal,
+                             debug)
+               == -1)
+                goto fail;
+            parts_count++;
+        } else {
+            parts[parts_count++] = literal_expression(literal, end - literal);
+        }
+    }
+
+    tk_expr_t *expr = concat_parts(parts, parts_count);
+    free(parts);
+    if(expr_p)
+        *expr_p = expr;
+    else
+        free_expression(expr, 1);
+    return 0;
+
+fail:
+    for(size_t i = 0; i < parts_count; i++) free_expression(parts[i], 1);
+    free(parts);
+    return -1;
+}
+
+static struct tk_expr_op *
+program_add_op(struct tk_expr_program *prog) {
+    if(prog->ops_count == prog->ops_size) {
+        prog->ops_size = prog->ops_size ? 2 * prog->ops_size : 8;
+        prog->ops = realloc(prog->ops, prog->ops_size * sizeof(prog->ops[0]));
+        assert(prog->ops);
+    }
+    struct tk_expr_op *op = &prog->ops[prog->ops_count++];
+    memset(op, 0, sizeof(*op));
+    return op;
+}
+
+static void
+program_add_literal(struct tk_expr_program *prog, const char *data,
+                    size_t size) {
+    if(size == 0) return;
+
+    if(prog->literals_size + size > prog->literals_allocated) {
+        size_t allocated = 2 * prog->literals_allocated;
+        if(allocated < prog->literals_size + size)
+            allocated = prog->literals_size + size;
+        prog->literals = realloc(prog->literals, allocated);
+        assert(prog->literals);
+        prog->literals_allocated = allocated;
+    }
+    memcpy(prog->literals + prog->literals_size, data, size);
+
+    /* Adjacent literals are copied in one go. */
+    struct tk_expr_op *last =
+        prog->ops_count ? &prog->ops[prog->ops_count - 1] : NULL;
+    if(last && last->code == TKOP_COPY) {
+        last->u.copy.size += size;
+    } else {
+        struct tk_expr_op *op = program_add_op(prog);
+        op->code = TKOP_COPY;
+        op->u.copy.offset = prog->literals_size;
+        op->u.copy.size = size;
+    }
+    prog->literals_size += size;
+}
+
+static void
+program_add_expr(struct tk_expr_program *prog, tk_expr_t *expr) {
+    struct tk_expr_op *op;
+
+    switch(expr->type) {
+    case EXPR_DATA:
+        program_add_literal(prog, expr->u.data.data, expr->u.data.size);
+        return;
+    case EXPR_CONCAT:
+        program_add_expr(prog, expr->u.concat.expr[0]);
+        program_add_expr(prog, expr->u.concat.expr[1]);
+        return;
+    case EXPR_CONNECTION_PTR:
+    case EXPR_CONNECTION_UID:
+    case EXPR_MESSAGE_MARKER:
+    case EXPR_MESSAGE_SEQ:
+    case EXPR_TIME_US:
+        op = program_add_op(prog);
+        op->code = TKOP_CALLBACK;
+        break;
+    case EXPR_REGEX:
+        op = program_add_op(prog);
+        op->code = expr->dynamic_scope == DS_PER_CONNECTION ? TKOP_CALLBACK
+                                                            : TKOP_REGEX;
+        break;
+    case EXPR_RANDOM:
+        op = program_add_op(prog);
+        op->code = TKOP_RANDOM;
+        break;
+    case EXPR_ZIPF:
+        op = program_add_op(prog);
+        op->code = TKOP_ZIPF;
+        break;
+    case EXPR_RAW:
+    case EXPR_WS_FRAME:
+    case EXPR_MODULO:
+        /* Rare: evaluate as is. */
+        op = program_add_op(prog);
+        op->code = TKOP_EXPR;
+        break;
+    default:
+        assert(!"Unreachable");
+        return;
+    }
+    op->u.expr = expr;
+}
+
+void
+compile_expression(tk_expr_t *expr) {
+    if(!expr || expr->program || expr->type != EXPR_CONCAT
+       || expr->dynamic_scope != DS_PER_MESSAGE)
+        return;
+
+    struct tk_expr_program *prog = calloc(1, sizeof(*prog));
+    assert(prog);
+    program_add_expr(prog, expr);
+    prog->estimate_size = expr->estimate_size;
+    expr->program = prog;
+}
+
+static ssize_t
+eval_random(char *buf, size_t size, const tk_expr_t *expr,
+            pcg32_random_t *rng) {
+    if(size < expr->u.random.size) return -1;
+    if(expr->u.random.alnum)
+        tk_random_alnum(rng, buf, expr->u.random.size);
+    else
+        tk_random_bytes(rng, buf, expr->u.random.size);
+    return expr->u.random.size;
+}
+
+static ssize_t
+eval_zipf(char *buf, size_t size, const tk_expr_t *expr,
+          pcg32_random_t *rng) {
+    uint32_t key = tk_alias_sample(expr->u.zipf.table, rng);
+    char digits[10];
+    size_t n = 0;
+    do {
+        digits[sizeof(digits) - ++n] = '0' + key % 10;
+        key /= 10;
+    } while(key);
+    if(size < n) return -1;
+    memcpy(buf, digits + sizeof(digits) - n, n);
+    return n;
+}
+
+static ssize_t
+run_expression_program(char *buf, size_t size,
+                       const struct tk_expr_program *prog, expr_callback_f cb,
+                       void *key, long *value, int client_mode,
+                       pcg32_random_t *rng) {
+    size_t off = 0;
+
+    if(prog->estimate_size > size) return -1;
+
+    for(size_t i = 0; i < prog->ops_count; i++) {
+        const struct tk_expr_op *op = &prog->ops[i];
+        char *p = buf + off;
+        ssize_t s;
+        switch(op->code) {
+        case TKOP_COPY:
+            memcpy(p, prog->literals + op->u.copy.offset, op->u.copy.size);
+            s = op->u.copy.size;
+            break;
+        case TKOP_CALLBACK:
+            s = cb(p, size - off, op->u.expr, key, value);
+            break;
+        case TKOP_REGEX:
+            s = tregex_eval_rng(op->u.expr->u.regex.re, p, size - off, rng);
+            break;
+        case TKOP_RANDOM:
+            s = eval_random(p, size - off, op->u.expr, rng);
+            break;
+        case TKOP_ZIPF:
+            s = eval_zipf(p, size - off, op->u.expr, rng);
+            break;
+        case TKOP_EXPR:
+            s = eval_expression(&p, size - off, op->u.expr, cb, key, value,
+                                client_mode, rng);
+            break;
+        default:
+            assert(!"Unreachable");
+            return -1;
+        }
+        if(s < 0) return -1;
+        off += s;
+    }
+
+    return off;
+}
+
 ssize_t
 eval_expression(char **buf_p, size_t size, tk_expr_t *expr, expr_callback_f cb,
                 void *key, long *value, int client_mode, pcg32_random_t *rng) {
@@ -129,10 +483,9 @@ eval_expression(char **buf_p, size_t size, tk_expr_t *expr, expr_callback_f cb,
     } else {
         buf = *buf_p;
     }
-    if (expr->dynamic_scope == DS_PER_CONNECTION && expr->res_buf){
-        /* Not first eval of "per connection" expr, just get res from a buffer */
-        memcpy(buf, expr->res_buf, expr->res_size);
-        return expr->res_size;
+    if(expr->program) {
+        return run_expression_program(buf, size, expr->program, cb, key, value,
+                                      client_mode, rng);
     }
 
     size_t res_size = -1;
@@ -160,6 +513,9 @@ eval_expression(char **buf_p, size_t size, tk_expr_t *expr, expr_callback_f cb,
                 expr->u.ws_frame.fin, expr->u.ws_frame.size);
             memcpy(buf + hdr_size, expr->u.ws_frame.data,
                    expr->u.ws_frame.size);
+            if(client_mode)
+                websocket_mask_payload((uint8_t *)buf + hdr_size,
+                                       expr->u.ws_frame.size);
             res_size = (hdr_size + expr->u.ws_frame.size);
             break;
         }
@@ -172,9 +528,6 @@ eval_expression(char **buf_p, size_t size, tk_expr_t *expr, expr_callback_f cb,
         ssize_t s = snprintf(buf, size, "%ld", v);
         if(s < 0 || s > (ssize_t)size) return -1;
         if(value) *value = v;
-        if(expr->u.modulo.expr->dynamic_scope == DS_PER_CONNECTION) {
-            expr->dynamic_scope = DS_PER_CONNECTION;
-        }
         res_size = s;
         break;
     }
@@ -202,20 +555,28 @@ eval_expression(char **buf_p, size_t size, tk_expr_t *expr, expr_callback_f cb,
         res_size = cb(buf, size, expr, key, value);
         break;
     }
-    case EXPR_MESSAGE_MARKER: {
+    case EXPR_MESSAGE_MARKER:
+    case EXPR_MESSAGE_SEQ:
+    case EXPR_TIME_US: {
         res_size = cb(buf, size, expr, key, value);
         break;
     }
     case EXPR_REGEX: {
-        res_size = tregex_eval_rng(expr->u.regex.re, buf, size, rng);
+        /* The connection.regex is chosen by the connection, if there is one */
+        if(expr->dynamic_scope == DS_PER_CONNECTION && cb)
+            res_size = cb(buf, size, expr, key, value);
+        else
+            res_size = tregex_eval_rng(expr->u.regex.re, buf, size, rng);
+        break;
     }
+    case EXPR_RANDOM: {
+        res_size = eval_random(buf, size, expr, rng);
+        break;
+    }
+    case EXPR_ZIPF: {
+        res_size = eval_zipf(buf, size, expr, rng);
+        break;
     }
-
-    /* First eval of "per connection" expr, save results to a buffer */
-    if (expr->dynamic_scope == DS_PER_CONNECTION && res_size > 0){
-        expr->res_buf = malloc(res_size);
-        memcpy(expr->res_buf, buf, res_size);
-        expr->res_size = res_size;
     }
 
     return res_size;
@@ -232,8 +593,6 @@ replicate_expression(tk_expr_t *expr) {
         new_expr->u.data.size = expr->u.data.size;
         new_expr->estimate_size = expr->estimate_size;
         new_expr->dynamic_scope = expr->dynamic_scope;
-        new_expr->res_buf = NULL;
-        new_expr->res_size = 0;
         return new_expr;
     };
     case EXPR_WS_FRAME: {
@@ -246,17 +605,15 @@ replicate_expression(tk_expr_t *expr) {
         new_expr->u.ws_frame.fin = expr->u.ws_frame.fin;
         new_expr->estimate_size = expr->estimate_size;
         new_expr->dynamic_scope = expr->dynamic_scope;
-        new_expr->res_buf = NULL;
-        new_expr->res_size = 0;
         return new_expr;
     };
-    case EXPR_MESSAGE_MARKER: {
+    case EXPR_MESSAGE_MARKER:
+    case EXPR_MESSAGE_SEQ:
+    case EXPR_TIME_US: {
         tk_expr_t *new_expr = calloc(1, sizeof(tk_expr_t));
-        new_expr->type = EXPR_MESSAGE_MARKER;
+        new_expr->type = expr->type;
         new_expr->estimate_size = expr->estimate_size;
         new_expr->dynamic_scope = expr->dynamic_scope;
-        new_expr->res_buf = NULL;
-        new_expr->res_size = 0;
         return new_expr;
     };
     case EXPR_RAW: {
@@ -265,8 +622,6 @@ replicate_expression(tk_expr_t *expr) {
         new_expr->u.raw.expr = replicate_expression(expr->u.raw.expr);
         new_expr->estimate_size = expr->estimate_size;
         new_expr->dynamic_scope = expr->dynamic_scope;
-        new_expr->res_buf = NULL;
-        new_expr->res_size = 0;
         return new_expr;
     };
     case EXPR_MODULO: {
@@ -276,8 +631,6 @@ replicate_expression(tk_expr_t *expr) {
         new_expr->u.modulo.modulo_value = expr->u.modulo.modulo_value;
         new_expr->estimate_size = expr->estimate_size;
         new_expr->dynamic_scope = expr->dynamic_scope;
-        new_expr->res_buf = NULL;
-        new_expr->res_size = 0;
         return new_expr;
     };
     case EXPR_CONCAT: {
@@ -287,8 +640,7 @@ replicate_expression(tk_expr_t *expr) {
         new_expr->u.concat.expr[1] = replicate_expression(expr->u.concat.expr[1]);
         new_expr->estimate_size = expr->estimate_size;
         new_expr->dynamic_scope = expr->dynamic_scope;
-        new_expr->res_buf = NULL;
-        new_expr->res_size = 0;
+        if(expr->program) compile_expression(new_expr);
         return new_expr;
     };
     case EXPR_CONNECTION_PTR: {
@@ -296,8 +648,6 @@ replicate_expression(tk_expr_t *expr) {
         new_expr->type = EXPR_CONNECTION_PTR;
         new_expr->estimate_size = expr->estimate_size;
         new_expr->dynamic_scope = expr->dynamic_scope;
-        new_expr->res_buf = NULL;
-        new_expr->res_size = 0;
         return new_expr;
     };
     case EXPR_CONNECTION_UID:{
@@ -305,8 +655,6 @@ replicate_expression(tk_expr_t *expr) {
         new_expr->type = EXPR_CONNECTION_UID;
         new_expr->estimate_size = expr->estimate_size;
         new_expr->dynamic_scope = expr->dynamic_scope;
-        new_expr->res_buf = NULL;
-        new_expr->res_size = 0;
         return new_expr;
     };
     case EXPR_REGEX: {
@@ -315,8 +663,22 @@ replicate_expression(tk_expr_t *expr) {
         new_expr->u.regex.re = expr->u.regex.re;
         new_expr->estimate_size = expr->estimate_size;
         new_expr->dynamic_scope = expr->dynamic_scope;
-        new_expr->res_buf = NULL;
-        new_expr->res_size = 0;
+        return new_expr;
+    };
+    case EXPR_RANDOM: {
+        tk_expr_t *new_expr = calloc(1, sizeof(tk_expr_t));
+        new_expr->type = EXPR_RANDOM;
+        new_expr->u.random = expr->u.random;
+        new_expr->estimate_size = expr->estimate_size;
+        new_expr->dynamic_scope = expr->dynamic_scope;
+        return new_expr;
+    };
+    case EXPR_ZIPF: {
+        tk_expr_t *new_expr = calloc(1, sizeof(tk_expr_t));
+        new_expr->type = EXPR_ZIPF;
+        new_expr->u.zipf = expr->u.zipf;
+        new_expr->estimate_size = expr->estimate_size;
+        new_expr->dynamic_scope = expr->dynamic_scope;
         return new_expr;
     };
 
@@ -363,6 +725,10 @@ expression_split_by_websocket_frame(tk_expr_t *expr) {
     case EXPR_CONNECTION_UID:
     case EXPR_REGEX:
     case EXPR_MESSAGE_MARKER:
+    case EXPR_MESSAGE_SEQ:
+    case EXPR_TIME_US:
+    case EXPR_RANDOM:
+    case EXPR_ZIPF:
         result.esw_prefix = expr;
         return result;
     case EXPR_WS_FRAME:
@@ -443,6 +809,10 @@ unescape_expression(tk_expr_t *expr) {
     case EXPR_CONNECTION_UID:
     case EXPR_REGEX:
     case EXPR_MESSAGE_MARKER:
+    case EXPR_MESSAGE_SEQ:
+    case EXPR_TIME_US:
+    case EXPR_RANDOM:
+    case EXPR_ZIPF:
         return;
     case EXPR_WS_FRAME: {
         size_t overhead = expr->estimate_size - expr->u.ws_frame.size;
@@ -473,10 +843,6 @@ float avg_digit_num(long modulo) {
 }
 
 size_t average_size(tk_expr_t *expr) {
-    if (expr->res_buf) {
-        return expr->res_size;
-    }
-
     switch(expr->type) {
     case EXPR_CONCAT: {
         size_t avg_size = average_size(expr->u.concat.expr[0])
@@ -489,14 +855,132 @@ size_t average_size(tk_expr_t *expr) {
     case EXPR_MODULO: {
         return round(avg_digit_num(expr->u.modulo.modulo_value));
     }
+    case EXPR_ZIPF:
+        return expr->u.zipf.avg_size;
     case EXPR_DATA:
     case EXPR_RAW:
     case EXPR_CONNECTION_PTR:
     case EXPR_CONNECTION_UID:
     case EXPR_MESSAGE_MARKER:
+    case EXPR_MESSAGE_SEQ:
+    case EXPR_TIME_US:
+    case EXPR_RANDOM:
     case EXPR_WS_FRAME:
         return expr->estimate_size;
     }
 
     assert(!"Unreachable");
 }
+
+void
+expression_set_marker_size(tk_expr_t *expr, size_t size) {
+    switch(expr->type) {
+    case EXPR_CONCAT:
+        expression_set_marker_size(expr->u.concat.expr[0], size);
+        expression_set_marker_size(expr->u.concat.expr[1], size);
+        return;
+    case EXPR_RAW:
+        expression_set_marker_size(expr->u.raw.expr, size);
+        return;
+    case EXPR_MESSAGE_MARKER:
+        assert(size <= expr->estimate_size);
+        expr->estimate_size = size;
+        return;
+    case EXPR_DATA:
+    case EXPR_MODULO:
+    case EXPR_CONNECTION_PTR:
+    case EXPR_CONNECTION_UID:
+    case EXPR_REGEX:
+    case EXPR_MESSAGE_SEQ:
+    case EXPR_TIME_US:
+    case EXPR_RANDOM:
+    case EXPR_ZIPF:
+    case EXPR_WS_FRAME:
+        return;
+    }
+}
+
+int
+expression_has_fixed_size(const tk_expr_t *expr) {
+    switch(expr->type) {
+    case EXPR_CONCAT:
+        return expression_has_fixed_size(expr->u.concat.expr[0])
+               && expression_has_fixed_size(expr->u.concat.expr[1]);
+    case EXPR_RAW:
+        return expression_has_fixed_size(expr->u.raw.expr);
+    case EXPR_REGEX:
+        return tregex_min_size(expr->u.regex.re) == expr->estimate_size;
+    case EXPR_ZIPF:
+        return expr->estimate_size == 1;
+    case EXPR_DATA:
+    case EXPR_MODULO:
+    case EXPR_CONNECTION_PTR:
+    case EXPR_CONNECTION_UID:
+    case EXPR_MESSAGE_MARKER:
+    case EXPR_MESSAGE_SEQ:
+    case EXPR_TIME_US:
+    case EXPR_RANDOM:
+    case EXPR_WS_FRAME:
+        /* Constant, or computed once per connection. */
+        return 1;
+    }
+    return 0;
+}
+
+static long
+gcd(long a, long b) {
+    while(b) {
+        long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/*
+ * The least common multiple of the periods, 0 if either is unbounded
+ * or the multiple exceeds the (limit).
+ */
+static long
+period_lcm(long a, long b, long limit) {
+    if(a == 0 || b == 0) return 0;
+    long m = a / gcd(a, b);
+    if(m > limit / b) return 0;
+    return m * b;
+}
+
+long
+expression_connection_period(const tk_expr_t *expr, long period, long limit) {
+    if(!expr || period == 0) return period;
+
+    switch(expr->type) {
+    case EXPR_DATA:
+    case EXPR_WS_FRAME:
+        return period;
+    case EXPR_RAW:
+        return expression_connection_period(expr->u.raw.expr, period, limit);
+    case EXPR_CONCAT:
+        period = expression_connection_period(expr->u.concat.expr[0], period,
+                                              limit);
+        return expression_connection_period(expr->u.concat.expr[1], period,
+                                            limit);
+    case EXPR_MODULO: {
+        const tk_expr_t *inner = expr->u.modulo.expr;
+        /* (uid % 64) % 16 still takes one of the 64 values of (uid % 64). */
+        if(inner->type == EXPR_MODULO)
+            return expression_connection_period(inner, period, limit);
+        if(inner->type != EXPR_CONNECTION_UID) return 0;
+        return period_lcm(period, labs(expr->u.modulo.modulo_value), limit);
+    }
+    case EXPR_CONNECTION_PTR:
+    case EXPR_CONNECTION_UID:
+    case EXPR_REGEX:
+    case EXPR_MESSAGE_MARKER:
+    case EXPR_MESSAGE_SEQ:
+    case EXPR_TIME_US:
+    case EXPR_RANDOM:
+    case EXPR_ZIPF:
+        return 0;
+    }
+    return 0;
+}
@@ -41,6 +41,10 @@ typedef struct tk_expr {
         EXPR_CONNECTION_UID, /* 'connection.uid' */
         EXPR_REGEX,
         EXPR_MESSAGE_MARKER, /* 'messager.marker' */
+        EXPR_MESSAGE_SEQ,    /* 'message.seq' */
+        EXPR_TIME_US,        /* 'time.us' */
+        EXPR_RANDOM,         /* 'random.bytes', 'random.alnum' */
+        EXPR_ZIPF,           /* 'zipf <keys> <s>' */
     } type;
     union {
         struct {
@@ -68,20 +72,25 @@ typedef struct tk_expr {
         struct {
             tregex *re;
         } regex;
+        struct {
+            size_t size;
+            int alnum; /* [A-Za-z0-9] rather than any bytes */
+        } random;
+        struct {
+            struct tk_alias_table *table; /* Shared by the replicas */
+            size_t avg_size;              /* Of the keys drawn */
+        } zipf;
     } u;
     size_t estimate_size;
     enum tk_expr_dynamic_scope {
         DS_GLOBAL_FIXED,   /* All connection share data */
         DS_PER_CONNECTION, /* Each connection has its own */
+        DS_MESSAGE_SLOTS,  /* Messages differ in the fixed-width slots only */
         DS_PER_MESSAGE     /* Each message is different */
     } dynamic_scope;
 
-   /*
-    * if it is "per_connection" expr then we evaluate
-    * it only once and save res in res_buf
-    */
-    char *res_buf;
-    size_t res_size;
+    /* Flattened form of a per-message expression, see compile_expression() */
+    struct tk_expr_program *program;
 } tk_expr_t;
 
 /*
@@ -91,6 +100,23 @@ typedef struct tk_expr {
  */
 #define EXPR_IS_TRIVIAL(e) ((e)->type == EXPR_DATA)
 
+/*
+ * The \{message.seq} and \{time.us} values are zero-padded decimals
+ * of a fixed width, so they can be rewritten in place as the data is sent.
+ */
+#define EXPR_MESSAGE_SEQ_WIDTH 10
+#define EXPR_TIME_US_WIDTH 16
+
+/*
+ * The largest \{random.bytes} and \{random.alnum}.
+ */
+#define EXPR_RANDOM_MAX_SIZE (64 * 1024 * 1024)
+
+/*
+ * The most \{zipf} keys, 8 bytes of the alias table each.
+ */
+#define EXPR_ZIPF_MAX_KEYS (16 * 1024 * 1024)
+
 /*
  * Parse the expression string of a given length into an expression.
  * Returns -1 on parse error.
@@ -106,10 +132,22 @@ typedef ssize_t(expr_callback_f)(char *buf, size_t size, tk_expr_t *, void *key,
 /*
  * Returns -1 if the expression doesn't fit in the (size) fully.
  * Returns the size of the data placed into *buf_p otherwise.
+ * The expression is not modified, so it can be evaluated by many
+ * connections at once. The (cb) produces the per-connection values,
+ * including the connection.regex ones, which must stay the same
+ * for the connection.
  */
 ssize_t eval_expression(char **buf_p, size_t size, tk_expr_t *, expr_callback_f,
                         void *key, long *output_value, int client_mode, pcg32_random_t *rng);
 
+/*
+ * Flatten the per-message expression tree into a linear program
+ * of copy-literal and emit-value steps, so eval_expression() does not
+ * have to walk the tree for every message. No-op for other expressions.
+ * The tree must not be restructured afterwards.
+ */
+void compile_expression(tk_expr_t *expr);
+
 /*
  * Replicate expression (copy everything except data)
  */
@@ -152,4 +190,27 @@ void unescape_expression(tk_expr_t *expr);
 
 size_t average_size(tk_expr_t *expr);
 
+/*
+ * Recursively set the size of the \{message.marker} parts, when the
+ * markers are smaller than estimated by the parser (the binary markers).
+ * Only affects the average size, the upper bound estimates are retained.
+ */
+void expression_set_marker_size(tk_expr_t *expr, size_t size);
+
+/*
+ * Returns non-zero if the expression evaluates to the same number of bytes
+ * every time it is evaluated within a connection.
+ */
+int expression_has_fixed_size(const tk_expr_t *expr);
+
+/*
+ * The number of consecutive \{connection.uid} values after which the
+ * expression evaluates to the same data again, such as 16 for
+ * \{connection.uid % 16}, combined with the (period) of the other
+ * expressions: the least common multiple of the two. Starts with 1.
+ * Returns 0 if the period is unbounded or exceeds the (limit).
+ */
+long expression_connection_period(const tk_expr_t *expr, long period,
+                                  long limit);
+
 #endif /* TCPKALI_EXPR_H */
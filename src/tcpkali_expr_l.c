@@ -363,8 +363,8 @@ static void yy_fatal_error (yyconst char msg[]  );
 	*yy_cp = '\0'; \
 	(yy_c_buf_p) = yy_cp;
 
-#define YY_NUM_RULES 61
-#define YY_END_OF_BUFFER 62
+#define YY_NUM_RULES 68
+#define YY_END_OF_BUFFER 69
 /* This struct is not used in this scanner,
    but its presence is necessary. */
 struct yy_trans_info
@@ -372,27 +372,30 @@ struct yy_trans_info
 	flex_int32_t yy_verify;
 	flex_int32_t yy_nxt;
 	};
-static yyconst flex_int16_t yy_accept[177] =
+static yyconst flex_int16_t yy_accept[201] =
     {   0,
         0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
-        0,    0,   62,    2,    2,   36,   12,   12,   12,   37,
-       34,   29,   28,    9,   36,   36,   36,   36,   36,   36,
-       36,   36,   36,   10,   11,    4,    3,    3,    7,    7,
-        8,   39,   38,   38,   44,   45,   50,   49,   48,   42,
-       43,   46,   41,   47,   51,   51,   61,   55,   61,   57,
-       59,   58,   60,    2,    2,    1,   36,   12,   12,    0,
-       35,    0,    0,   28,   36,   36,   36,   36,   36,   36,
-       36,   36,   36,   36,   26,   36,   36,   36,   13,    4,
-        0,    7,    4,    3,    3,    0,    7,    0,    5,    0,
-
-        7,    7,   39,   38,   38,   51,   51,   54,   54,   57,
-       58,   30,   36,   36,   36,   36,   36,   36,   36,   36,
-       24,   14,   36,   36,   25,    6,    6,    5,    0,    5,
-        0,    7,   40,   52,   53,   36,   36,   36,   15,   36,
-       36,   36,   19,   20,   31,   32,   33,   16,    0,    5,
-       36,   18,   36,   36,   36,   36,   36,    5,   17,   36,
-       36,   23,   27,   36,   36,   36,   22,   36,   36,   36,
-       36,   21,   36,   36,   15,    0
+        0,    0,   69,    2,    2,   43,   12,   12,   12,   44,
+       41,   36,   35,    9,   43,   43,   43,   43,   43,   43,
+       43,   43,   43,   43,   43,   43,   10,   11,    4,    3,
+        3,    7,    7,    8,   46,   45,   45,   51,   52,   57,
+       56,   55,   49,   50,   53,   48,   54,   58,   58,   68,
+       62,   68,   64,   66,   65,   67,    2,    2,    1,   43,
+       12,   12,    0,   42,    0,    0,   35,   43,   43,   43,
+       43,   43,   43,   43,   43,   43,   43,   43,   43,   26,
+       43,   43,   43,   43,   43,   30,   13,   43,    4,    0,
+
+        7,    4,    3,    3,    0,    7,    0,    5,    0,    7,
+        7,   46,   45,   45,   58,   58,   61,   61,   64,   65,
+       37,   43,   43,   43,   43,   43,   43,   43,   43,   43,
+       43,   24,   43,   14,   43,   28,   43,   43,   25,   43,
+        6,    6,    5,    0,    5,    0,    7,   47,   59,   60,
+       43,   43,   43,   43,   43,   15,   43,   43,   43,   19,
+       20,   43,   38,   39,   40,   16,   29,   34,    0,    5,
+       33,   43,   32,   18,   43,   43,   43,   43,   43,   43,
+        5,   17,   43,   43,   23,   27,   43,   31,   43,   43,
+       22,   43,   43,   43,   43,   21,   43,   43,   15,    0
+
     } ;
 
 static yyconst flex_int32_t yy_ec[256] =
@@ -408,9 +411,9 @@ static yyconst flex_int32_t yy_ec[256] =
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
        23,   24,   25,    1,    1,    1,   26,   27,   28,   29,
 
-       30,    1,   31,    1,   32,    1,   33,   34,   35,   36,
-       37,   38,    1,   39,   40,   41,   42,   43,   44,   45,
-       46,    1,   47,   48,   49,    1,    1,    1,    1,    1,
+       30,   31,   32,    1,   33,    1,   34,   35,   36,   37,
+       38,   39,   40,   41,   42,   43,   44,   45,   46,   47,
+       48,   49,   50,   51,   52,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
@@ -427,245 +430,340 @@ static yyconst flex_int32_t yy_ec[256] =
         1,    1,    1,    1,    1
     } ;
 
-static yyconst flex_int32_t yy_meta[50] =
+static yyconst flex_int32_t yy_meta[53] =
     {   0,
-        1,    1,    2,    2,    3,    3,    3,    1,    4,    4,
-        4,    4,    1,    5,    3,    1,    1,    1,    1,    3,
-        6,    4,    4,    7,    8,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    9,    4,    9
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1
     } ;
 
-static yyconst flex_int16_t yy_base[196] =
+static yyconst flex_int16_t yy_base[201] =
     {   0,
-      337,  336,    0,    0,   48,   96,  144,  192,  237,  282,
-      330,  378,  359,    0,   31,    0,   57,   61,   72,   61,
-      735,  343,   63,  735,  325,   49,  322,   58,   55,   63,
-      325,  322,  313,  735,  735,  423,  471,  105,  109,   67,
-      735,    0,  120,  132,  735,  735,  735,  735,  735,  735,
-      735,  735,  735,  735,  156,  338,    0,  735,  735,  136,
-      735,  141,  735,    0,  735,  735,    0,  170,  175,  120,
-      735,  348,  335,  165,  309,  307,  306,  304,  301,  299,
-      302,  301,  297,  285,    0,  285,  281,  296,    0,  183,
-      299,  126,  204,    0,  221,  192,  225,  229,  127,  194,
-
-      242,  214,  243,  519,  256,  262,  308,    0,  735,  268,
-      262,  735,  294,  279,  186,  291,  284,  276,  284,  283,
-        0,    0,  194,  272,    0,  232,  284,  276,  277,  735,
-      288,  300,  735,  735,  735,  260,  265,  255,  252,  249,
-      234,  210,    0,    0,    0,    0,    0,    0,  306,  269,
-      188,    0,  193,  163,  156,  150,  137,  141,    0,  123,
-      110,    0,    0,  112,   96,  101,    0,   83,   77,   75,
-       62,    0,   53,   34,    0,  735,  566,  575,  584,  593,
-      602,  611,  620,  628,  637,  646,  655,  664,  673,  680,
-      689,  698,  707,  716,  725
+        1,    0,   53,    0,  105,    0,  157,    0,  209,    0,
+      261,    0,    0,  314,  367,  397,  366,    0,  372,  448,
+      338,  358,  362,    0,  347,  354,  348,  349,  359,  468,
+      362,  360,  363,  361,  353,  379,    0,    0,  511,  500,
+      563,  615,  667,    0,  718,  505,  725,    0,    0,    0,
+        0,    0,    0,    0,    0,    0,    0,  767,  819,  870,
+        0,    0,  921,    0,  911,    0,    0,    0,    0,    0,
+        0,    0,    0,    0,  928,  432,    0,  495,  531,  541,
+      634,  636,  637,  635,  635,  650,  651,  649,  787,    0,
+      647,  677,  693,  705,  714,    0,    0,  753,    0,  933,
+
+        0,  819,    0,    0,  820,    0,  947,    0,  999, 1049,
+      828, 1045, 1047,    0,  825,  830, 1097,    0,    0,    0,
+        0,  840,  869,  902,  891,  902,  913,  907,  900,  911,
+      912,    0,  917,    0, 1043,    0,  904,  938,    0,  971,
+        0,    0,    0, 1060,    0, 1068,  997,    0,    0,    0,
+     1018, 1024, 1026, 1040, 1045, 1043, 1051, 1048, 1053,    0,
+        0, 1042,    0,    0,    0,    0,    0,    0, 1075,    0,
+        0, 1034,    0,    0, 1055, 1048, 1051, 1046, 1056, 1053,
+        0,    0, 1047, 1047,    0,    0, 1063,    0, 1061, 1070,
+        0, 1073, 1079, 1113, 1118,    0, 1114, 1116,    0, 1154
 
     } ;
 
-static yyconst flex_int16_t yy_def[196] =
+static yyconst flex_int16_t yy_def[201] =
     {   0,
-      177,  177,  176,    3,  178,  178,  179,  179,  180,  180,
-      181,  181,  176,  182,  176,  183,  183,  183,  176,  184,
-      176,  176,  183,  176,  183,  183,  183,  183,  183,  183,
-      183,  183,  183,  176,  176,  185,  185,  186,  187,  188,
-      176,  189,  189,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  190,  191,  192,  176,  176,  176,
-      176,  176,  176,  182,  176,  176,  183,  183,  176,  184,
-      176,  184,  176,  183,  183,  183,  183,  183,  183,  183,
-      183,  183,  183,  183,  183,  183,  183,  183,  183,   37,
-      186,  188,   37,   37,  186,  186,  187,  193,  188,  194,
-
-      187,  188,  189,  189,  176,  190,  191,  195,  176,  176,
-      176,  176,  183,  183,  183,  183,  183,  183,  183,  183,
-      183,  183,  183,  183,  183,  188,  186,  186,  193,  176,
-      194,  187,  176,  176,  176,  183,  183,  183,  183,  183,
-      183,  183,  183,  183,  183,  183,  183,  183,  193,  188,
-      183,  183,  183,  183,  183,  183,  183,  186,  183,  183,
-      183,  183,  183,  183,  183,  183,  183,  183,  183,  183,
-      183,  183,  183,  183,  183,    0,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176
+      200,    1,    1,    3,    1,    5,    1,    7,    1,    9,
+        1,   11,  200,  200,  200,  200,   16,   17,  200,    1,
+      200,   21,   16,   21,   16,   16,   16,   16,   16,   16,
+       16,   16,   16,   16,   16,   16,   21,   21,   15,   39,
+       40,    1,   39,   21,   19,   45,   19,   21,   21,   21,
+       21,   21,   21,   21,   21,   21,   21,   15,   58,   15,
+       21,   21,   19,   21,   21,   21,   14,   21,   21,   16,
+       17,   19,   20,   21,   20,   21,   23,   16,   16,   16,
+       16,   16,   16,   16,   16,   16,   16,   16,   16,   16,
+       16,   16,   16,   16,   16,   16,   16,   16,   39,   41,
+
+       43,   39,   40,   41,  100,   42,   42,   43,   15,   42,
+       43,   45,   46,   47,   58,   59,   15,   21,   63,   65,
+       21,   16,   16,   16,   16,   16,   16,   16,   16,   16,
+       16,   16,   16,   16,   16,   16,   16,   16,   16,   16,
+       43,  100,  100,  107,   21,  109,   42,   21,   21,   21,
+       16,   16,   16,   16,   16,   16,   16,   16,   16,   16,
+       16,   16,   16,   16,   16,   16,   16,   16,  107,   43,
+       16,   16,   16,   16,   16,   16,   16,   16,   16,   16,
+      100,   16,   16,   16,   16,   16,   16,   16,   16,   16,
+       16,   16,   16,   16,   16,   16,   16,   16,   16,    0
 
     } ;
 
-static yyconst flex_int16_t yy_nxt[785] =
+static yyconst flex_int16_t yy_nxt[1207] =
     {   0,
-       16,   17,   18,   17,   19,   20,   21,   16,   16,   16,
-       16,   16,   16,   16,   22,   23,   23,   23,   23,   24,
-       16,   16,   16,   16,   16,   16,   25,   26,   16,   16,
-       27,   16,   16,   16,   28,   16,   16,   29,   30,   16,
-       31,   32,   16,   33,   16,   16,   34,   16,   35,   37,
-       37,   37,   38,   39,   65,   40,   40,   40,   68,   68,
-       68,   69,   68,   68,   68,   69,   71,   40,   41,  175,
-       40,   91,   40,   69,   69,   69,   69,   66,   74,   74,
-       74,   74,   76,   79,   72,   77,   81,   80,   84,  174,
-      102,   82,   85,  173,   40,   83,   40,   37,   37,   37,
-
-       38,   39,   86,   40,   40,   40,   95,   95,   95,   95,
-      172,   92,   92,   98,   99,   40,   41,  171,   40,  170,
-       40,  104,  104,  104,  104,   71,  169,  168,   96,  100,
-       91,   91,  101,  105,  105,  105,  105,  110,  110,  110,
-      110,  167,   40,   72,   40,   43,   43,   43,   44,  102,
-      102,  166,   45,   46,   47,   48,  111,  111,  111,  111,
-      107,  107,  107,  165,   96,   49,   50,  164,   51,  108,
-      107,   68,   68,   68,   69,  107,   69,   69,   69,   69,
-       74,   74,   74,   74,   90,   90,   90,   91,  163,  162,
-       52,   53,   54,   43,   43,   43,   44,  127,  161,  130,
-
-       45,   46,   47,   48,  107,   90,   90,   90,   91,  126,
-      145,  146,  147,   49,   50,   96,   51,  131,   91,  126,
-      160,  138,   95,   95,   95,   95,  139,   92,   92,   98,
-       99,   91,   91,  159,  128,  157,   91,  102,   52,   53,
-       54,   56,   56,   56,   96,  100,   98,  126,  101,  100,
-       57,   56,  129,  133,  133,  102,   56,  105,  105,  105,
-      105,   58,  100,  156,  133,  132,  107,  107,  107,  110,
-      110,  110,  110,   91,  155,  134,  107,  111,  111,  111,
-      111,  107,  127,  154,  153,   56,   56,   56,   56,  133,
-      100,  100,  102,  176,  152,   57,   56,  100,  151,   96,
-
-      149,   56,   92,   92,   98,  150,   58,   96,   91,   91,
-      107,  158,  148,  144,  143,  142,  141,  140,  137,  136,
-      100,  134,   96,  101,  125,  124,  100,  123,  122,  129,
-       56,   60,   60,   60,   60,  121,  120,  119,  118,  117,
-      116,  115,   61,  114,  113,   62,   62,   62,   62,  112,
-      176,  108,   89,   88,   87,   78,   75,   73,  176,   15,
-       15,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,   63,   60,
-       60,   60,   60,  176,  176,  176,  176,  176,  176,  176,
-       61,  176,  176,   62,   62,   62,   62,  176,  176,  176,
-
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,   63,   91,   92,  176,
-       92,   92,   92,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,   92,  176,  176,   92,   93,   92,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,  176,   92,
-      176,   92,   94,   94,   94,   95,   92,  176,   92,   92,
-       92,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-       92,  176,  176,   92,   93,   92,  176,  176,  176,  176,
-
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,   92,  176,   92,
-      104,  104,  104,  104,  176,  176,  176,  176,  176,  133,
-      133,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      133,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  133,   14,   14,   14,   14,
-       14,   14,   14,   14,   14,   36,   36,   36,   36,   36,
-       36,   36,   36,   36,   42,   42,   42,   42,   42,   42,
-       42,   42,   42,   55,   55,   55,   55,   55,   55,   55,
-
-       55,   55,   59,   59,   59,   59,   59,   59,   59,   59,
-       59,   64,   64,   64,   64,   64,   64,  176,   64,   64,
-       67,   67,  176,   67,   67,   67,   67,   67,   70,   70,
-       70,   70,   70,   70,   70,   70,   70,   90,   90,   90,
-       90,   90,  176,   90,   90,   90,   91,   91,   91,   91,
-       91,  176,   91,   91,   91,   97,   97,   97,   97,   97,
-       97,   97,   97,   97,   92,   92,   92,   92,   92,  176,
-       92,   92,   92,  103,  103,  103,  176,  103,  103,  103,
-      106,  106,  106,  106,  106,  106,  106,  176,  106,  107,
-      107,  107,  107,  107,  107,  107,  176,  107,  109,  109,
-
-      109,  109,  176,  109,  109,  176,  109,   98,   98,   98,
-       98,   98,   98,   98,   98,   98,  100,  176,  100,  100,
-      100,  100,  100,  100,  100,  135,  135,  135,  135,  176,
-      135,  135,  176,  135,   13,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176
+       13,   14,   14,   14,   14,   14,   14,   14,   14,   14,
+       14,   14,   14,   14,   14,   14,   14,   14,   14,   14,
+       14,   14,   14,   14,   15,   14,   14,   14,   14,   14,
+       14,   14,   14,   14,   14,   14,   14,   14,   14,   14,
+       14,   14,   14,   14,   14,   14,   14,   14,   14,   14,
+       14,   14,   14,   16,   17,   18,   17,   19,   20,   21,
+       16,   16,   16,   16,   16,   16,   16,   22,   23,   23,
+       23,   23,   24,   16,   16,   16,   16,   16,   25,   26,
+       27,   16,   16,   16,   28,   16,   16,   16,   29,   16,
+       16,   30,   16,   31,   32,   33,   34,   16,   35,   16,
+
+       16,   36,   37,   16,   38,   39,   40,   40,   40,   41,
+       42,   39,   43,   43,   43,   39,   39,   39,   39,   39,
+       39,   39,   39,   39,   43,   44,   39,   43,   39,   43,
+       39,   39,   39,   39,   39,   39,   39,   39,   39,   39,
+       39,   39,   39,   39,   39,   39,   39,   39,   39,   39,
+       39,   39,   39,   39,   43,   39,   43,   45,   46,   46,
+       46,   47,   45,   45,   45,   48,   49,   50,   51,   45,
+       45,   45,   45,   45,   45,   45,   45,   45,   52,   53,
+       45,   54,   45,   45,   45,   45,   45,   45,   45,   45,
+       45,   45,   45,   45,   45,   45,   45,   45,   45,   45,
+
+       45,   45,   45,   45,   45,   45,   55,   56,   57,   58,
+       58,   58,   58,   59,   59,   59,   58,   58,   58,   58,
+       58,   58,   60,   59,   58,   58,   58,   58,   59,   58,
+       58,   58,   58,   61,   58,   58,   58,   58,   58,   58,
+       58,   58,   58,   58,   58,   58,   58,   58,   58,   58,
+       58,   58,   58,   58,   58,   58,   58,   58,   58,   58,
+       59,   62,   63,   63,   63,   63,   62,   62,   62,   62,
+       62,   62,   62,   64,   62,   62,   65,   65,   65,   65,
+       62,   62,   62,   62,   62,   62,   62,   62,   62,   62,
+       62,   62,   62,   62,   62,   62,   62,   62,   62,   62,
+
+       62,   62,   62,   62,   62,   62,   62,   62,   62,   62,
+       62,   62,   66,   13,   67,   67,   67,   67,   67,   67,
+       67,   67,   67,   67,   67,   67,   67,   67,   67,   67,
+       67,   67,   67,   67,   67,   67,   67,   13,   67,   67,
+       67,   67,   67,   67,   67,   67,   67,   67,   67,   67,
+       67,   67,   67,   67,   67,   67,   67,   67,   67,   67,
+       67,   67,   67,   67,   67,   67,   13,   71,   71,   71,
+       72,   13,   76,   72,   72,   72,   72,   77,   77,   77,
+       77,   78,   81,   83,   84,   82,   79,   89,   85,   92,
+       68,   90,   93,   95,   97,   94,   13,   70,   70,   70,
+
+       70,   80,   96,   91,   70,   70,   70,   70,   70,   70,
+       70,   98,   70,   70,   70,   70,   69,   70,   70,   70,
+       70,   70,   70,   70,   70,   70,   70,   70,   70,   70,
+       70,   70,   70,   70,   70,   70,   70,   70,   70,   70,
+       70,   70,   70,   70,   70,   70,  121,   70,   73,   73,
+       73,   73,   73,   74,   73,   73,   73,   73,   73,   73,
+       73,   73,   73,   73,   73,   73,   73,   73,   73,   73,
+       73,   75,   73,   73,   73,   73,   73,   73,   73,   73,
+       73,   73,   73,   73,   73,   73,   73,   73,   73,   73,
+       73,   73,   73,   73,   73,   73,   73,   73,   73,   73,
+
+       86,  103,  103,  103,  104,   87,  113,  113,  113,  113,
+       88,   99,   99,   99,   99,  100,  101,   99,  101,  101,
+      101,   99,   99,   99,   99,   99,   99,   99,   99,   99,
+      101,  122,   99,  101,  102,  101,   99,   99,   99,   99,
+       99,   99,   99,   99,   99,   99,   99,   99,   99,   99,
+       99,   99,   99,   99,   99,   99,   99,   99,   99,   99,
+      101,   99,  101,  100,  104,  104,  104,  123,  100,  100,
+      100,  100,  100,  100,  100,  100,  100,  100,  100,  100,
+      100,  100,  100,  124,  100,  100,  105,  100,  100,  100,
+      100,  100,  100,  100,  100,  100,  100,  100,  100,  100,
+
+      100,  100,  100,  100,  100,  100,  100,  100,  100,  100,
+      100,  100,  100,  100,  100,  106,  106,  101,  101,  107,
+      108,  106,  106,  106,  106,  106,  106,  106,  106,  106,
+      106,  106,  106,  106,  106,  109,  106,  106,  110,  106,
+      106,  106,  106,  106,  106,  106,  106,  106,  106,  106,
+      106,  106,  106,  106,  106,  106,  106,  106,  106,  106,
+      106,  106,  106,  106,  106,  106,  106,  101,  101,  101,
+      101,  125,  126,  101,  127,  128,  129,  101,  101,  101,
+      101,  101,  101,  101,  101,  101,  130,  131,  101,  132,
+      111,  135,  101,  101,  101,  101,  101,  101,  101,  101,
+
+      101,  101,  101,  101,  101,  101,  101,  101,  101,  101,
+      101,  101,  101,  101,  101,  101,  136,  101,  112,  112,
+      112,  112,  112,  112,  112,  112,  114,  114,  114,  114,
+      112,  112,  112,  112,  112,  112,  112,  112,  112,  137,
+      138,  112,  139,  112,  112,  112,  112,  112,  112,  112,
+      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
+      112,  112,  112,  112,  112,  112,  112,  115,  115,  115,
+      115,  116,  116,  116,  115,  115,  115,  115,  115,  115,
+      117,  116,  115,  115,  115,  115,  116,  115,  115,  115,
+      115,  140,  115,  115,  115,  115,  115,  115,  115,  115,
+
+      115,  115,  115,  115,  115,  115,  115,  115,  115,  115,
+      115,  115,  115,  115,  115,  115,  115,  115,  116,  116,
+      116,  116,  116,  133,  141,  142,  116,  116,  116,  116,
+      116,  116,  134,  141,  116,  116,  116,  116,  149,  116,
+      116,  116,  116,  149,  116,  116,  116,  116,  116,  116,
+      116,  116,  116,  116,  116,  116,  116,  116,  116,  116,
+      116,  116,  116,  116,  116,  116,  116,  116,  116,  116,
+      118,  118,  118,  118,  118,  118,  118,  118,  118,  118,
+      118,  118,  118,  151,  118,  118,  118,  118,  118,  118,
+      118,  118,  118,  118,  152,  118,  118,  118,  118,  118,
+
+      118,  118,  118,  118,  118,  118,  118,  118,  118,  118,
+      118,  118,  118,  118,  118,  118,  118,  118,  118,  118,
+      118,  118,  119,  119,  119,  119,  120,  120,  120,  120,
+      200,  153,  154,   73,  100,  100,  100,  100,  155,  157,
+      158,  159,  160,  161,  156,  162,  166,  107,  107,  100,
+      100,   73,  143,  107,  107,  107,  107,  107,  107,  107,
+      107,  107,  107,  107,  107,  107,  107,  167,  107,  107,
+      144,  107,  107,  107,  107,  107,  107,  107,  107,  107,
+      107,  107,  107,  107,  107,  107,  107,  107,  107,  107,
+      107,  107,  107,  107,  107,  107,  107,  107,  107,  109,
+
+      109,  168,  170,  109,  145,  109,  109,  109,  109,  109,
+      109,  109,  109,  109,  109,  109,  109,  109,  109,  109,
+      109,  109,  146,  109,  109,  109,  109,  109,  109,  109,
+      109,  109,  109,  109,  109,  109,  109,  109,  109,  109,
+      109,  109,  109,  109,  109,  109,  109,  109,  109,  109,
+      109,  106,  106,  171,  141,  148,  148,  148,  148,  163,
+      164,  165,  107,  107,  172,  142,  148,  173,  148,  174,
+      109,  109,  147,  200,  175,  176,  177,  178,  179,  180,
+      181,  182,  183,  169,  184,  185,  186,  187,  188,  189,
+      190,  109,  191,  192,  148,  193,  148,  150,  150,  150,
+
+      150,  150,  150,  150,  150,  150,  150,  150,  150,  150,
+      194,  150,  150,  150,  150,  150,  150,  150,  150,  150,
+      150,  195,  150,  150,  150,  150,  150,  150,  150,  150,
+      150,  150,  150,  150,  150,  150,  150,  150,  150,  150,
+      150,  150,  150,  150,  150,  150,  150,  150,  150,  196,
+      197,  198,  199,  200,  200,  200,  200,  200,  200,  200,
+      200,  200,  200,  200,  200,  200,  200,  200,  200,  200,
+      200,  200,  200,  200,  200,  200,  200,  200,  200,  200,
+      200,  200,  200,  200,  200,  200,  200,  200,  200,  200,
+      200,  200,  200,  200,  200,  200,  200,  200,  200,  200,
+
+      200,  200,  200,  200,  200,  200
     } ;
 
-static yyconst flex_int16_t yy_chk[785] =
+static yyconst flex_int16_t yy_chk[1207] =
     {   0,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    3,    3,    3,    3,    3,    3,    3,
         3,    3,    3,    3,    3,    3,    3,    3,    3,    3,
         3,    3,    3,    3,    3,    3,    3,    3,    3,    3,
         3,    3,    3,    3,    3,    3,    3,    3,    3,    3,
         3,    3,    3,    3,    3,    3,    3,    3,    3,    3,
-        3,    3,    3,    3,    3,    3,    3,    3,    3,    5,
-        5,    5,    5,    5,   15,    5,    5,    5,   17,   17,
-       17,   17,   18,   18,   18,   18,   20,    5,    5,  174,
-        5,   40,    5,   19,   19,   19,   19,   15,   23,   23,
-       23,   23,   26,   28,   20,   26,   29,   28,   30,  173,
-       40,   29,   30,  171,    5,   29,    5,    6,    6,    6,
-
-        6,    6,   30,    6,    6,    6,   38,   38,   38,   38,
-      170,   39,   39,   39,   39,    6,    6,  169,    6,  168,
-        6,   43,   43,   43,   43,   70,  166,  165,   38,   39,
-       92,   99,   39,   44,   44,   44,   44,   60,   60,   60,
-       60,  164,    6,   70,    6,    7,    7,    7,    7,   92,
-       99,  161,    7,    7,    7,    7,   62,   62,   62,   62,
-       55,   55,   55,  160,  158,    7,    7,  157,    7,   55,
-       55,   68,   68,   68,   68,   55,   69,   69,   69,   69,
-       74,   74,   74,   74,   90,   90,   90,   90,  156,  155,
-        7,    7,    7,    8,    8,    8,    8,   96,  154,  100,
-
-        8,    8,    8,    8,   55,   93,   93,   93,   93,   93,
-      123,  123,  123,    8,    8,   96,    8,  100,  102,  102,
-      153,  115,   95,   95,   95,   95,  115,   97,   97,   97,
-       97,   98,   98,  151,   98,  142,  126,  102,    8,    8,
-        8,    9,    9,    9,   95,   97,  101,  101,   97,   98,
-        9,    9,   98,  103,  103,  126,    9,  105,  105,  105,
-      105,    9,  101,  141,  103,  101,  106,  106,  106,  110,
-      110,  110,  110,  150,  140,  106,  106,  111,  111,  111,
-      111,  106,  129,  139,  138,    9,   10,   10,   10,  103,
-      131,  131,  150,  131,  137,   10,   10,  129,  136,  128,
-
-      129,   10,  132,  132,  132,  132,   10,  127,  149,  149,
-      106,  149,  124,  120,  119,  118,  117,  116,  114,  113,
-      132,  107,   91,  132,   88,   87,  149,   86,   84,  149,
-       10,   11,   11,   11,   11,   83,   82,   81,   80,   79,
-       78,   77,   11,   76,   75,   11,   11,   11,   11,   73,
-       72,   56,   33,   32,   31,   27,   25,   22,   13,    2,
-        1,    0,    0,    0,    0,    0,    0,    0,    0,    0,
-        0,    0,    0,    0,    0,    0,    0,    0,   11,   12,
-       12,   12,   12,    0,    0,    0,    0,    0,    0,    0,
-       12,    0,    0,   12,   12,   12,   12,    0,    0,    0,
 
-        0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
-        0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
-        0,    0,    0,    0,    0,    0,   12,   36,   36,    0,
-       36,   36,   36,    0,    0,    0,    0,    0,    0,    0,
-        0,    0,   36,    0,    0,   36,   36,   36,    0,    0,
-        0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
-        0,    0,    0,    0,    0,    0,    0,    0,    0,   36,
-        0,   36,   37,   37,   37,   37,   37,    0,   37,   37,
-       37,    0,    0,    0,    0,    0,    0,    0,    0,    0,
-       37,    0,    0,   37,   37,   37,    0,    0,    0,    0,
-
-        0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
-        0,    0,    0,    0,    0,    0,    0,   37,    0,   37,
-      104,  104,  104,  104,    0,    0,    0,    0,    0,  104,
-      104,    0,    0,    0,    0,    0,    0,    0,    0,    0,
-      104,    0,    0,    0,    0,    0,    0,    0,    0,    0,
-        0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
-        0,    0,    0,    0,    0,  104,  177,  177,  177,  177,
-      177,  177,  177,  177,  177,  178,  178,  178,  178,  178,
-      178,  178,  178,  178,  179,  179,  179,  179,  179,  179,
-      179,  179,  179,  180,  180,  180,  180,  180,  180,  180,
-
-      180,  180,  181,  181,  181,  181,  181,  181,  181,  181,
-      181,  182,  182,  182,  182,  182,  182,    0,  182,  182,
-      183,  183,    0,  183,  183,  183,  183,  183,  184,  184,
-      184,  184,  184,  184,  184,  184,  184,  185,  185,  185,
-      185,  185,    0,  185,  185,  185,  186,  186,  186,  186,
-      186,    0,  186,  186,  186,  187,  187,  187,  187,  187,
-      187,  187,  187,  187,  188,  188,  188,  188,  188,    0,
-      188,  188,  188,  189,  189,  189,    0,  189,  189,  189,
-      190,  190,  190,  190,  190,  190,  190,    0,  190,  191,
-      191,  191,  191,  191,  191,  191,    0,  191,  192,  192,
-
-      192,  192,    0,  192,  192,    0,  192,  193,  193,  193,
-      193,  193,  193,  193,  193,  193,  194,    0,  194,  194,
-      194,  194,  194,  194,  194,  195,  195,  195,  195,    0,
-      195,  195,    0,  195,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176,  176,  176,  176,  176,  176,  176,
-      176,  176,  176,  176
+        3,    3,    3,    3,    3,    5,    5,    5,    5,    5,
+        5,    5,    5,    5,    5,    5,    5,    5,    5,    5,
+        5,    5,    5,    5,    5,    5,    5,    5,    5,    5,
+        5,    5,    5,    5,    5,    5,    5,    5,    5,    5,
+        5,    5,    5,    5,    5,    5,    5,    5,    5,    5,
+        5,    5,    5,    5,    5,    5,    5,    7,    7,    7,
+        7,    7,    7,    7,    7,    7,    7,    7,    7,    7,
+        7,    7,    7,    7,    7,    7,    7,    7,    7,    7,
+        7,    7,    7,    7,    7,    7,    7,    7,    7,    7,
+        7,    7,    7,    7,    7,    7,    7,    7,    7,    7,
+
+        7,    7,    7,    7,    7,    7,    7,    7,    7,    9,
+        9,    9,    9,    9,    9,    9,    9,    9,    9,    9,
+        9,    9,    9,    9,    9,    9,    9,    9,    9,    9,
+        9,    9,    9,    9,    9,    9,    9,    9,    9,    9,
+        9,    9,    9,    9,    9,    9,    9,    9,    9,    9,
+        9,    9,    9,    9,    9,    9,    9,    9,    9,    9,
+        9,   11,   11,   11,   11,   11,   11,   11,   11,   11,
+       11,   11,   11,   11,   11,   11,   11,   11,   11,   11,
+       11,   11,   11,   11,   11,   11,   11,   11,   11,   11,
+       11,   11,   11,   11,   11,   11,   11,   11,   11,   11,
+
+       11,   11,   11,   11,   11,   11,   11,   11,   11,   11,
+       11,   11,   11,   14,   14,   14,   14,   14,   14,   14,
+       14,   14,   14,   14,   14,   14,   14,   14,   14,   14,
+       14,   14,   14,   14,   14,   14,   14,   21,   14,   14,
+       14,   14,   14,   14,   14,   14,   14,   14,   14,   14,
+       14,   14,   14,   14,   14,   14,   14,   14,   14,   14,
+       14,   14,   14,   14,   14,   14,   15,   17,   17,   17,
+       17,   19,   22,   19,   19,   19,   19,   23,   23,   23,
+       23,   25,   27,   28,   29,   27,   26,   31,   29,   32,
+       15,   31,   33,   34,   35,   33,   16,   16,   16,   16,
+
+       16,   26,   34,   31,   16,   16,   16,   16,   16,   16,
+       16,   36,   16,   16,   16,   16,   15,   16,   16,   16,
+       16,   16,   16,   16,   16,   16,   16,   16,   16,   16,
+       16,   16,   16,   16,   16,   16,   16,   16,   16,   16,
+       16,   16,   16,   16,   16,   16,   76,   16,   20,   20,
+       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
+       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
+       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
+       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
+       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
+
+       30,   40,   40,   40,   40,   30,   46,   46,   46,   46,
+       30,   39,   39,   39,   39,   39,   39,   39,   39,   39,
+       39,   39,   39,   39,   39,   39,   39,   39,   39,   39,
+       39,   78,   39,   39,   39,   39,   39,   39,   39,   39,
+       39,   39,   39,   39,   39,   39,   39,   39,   39,   39,
+       39,   39,   39,   39,   39,   39,   39,   39,   39,   39,
+       39,   39,   39,   41,   41,   41,   41,   79,   41,   41,
+       41,   41,   41,   41,   41,   41,   41,   41,   41,   41,
+       41,   41,   41,   80,   41,   41,   41,   41,   41,   41,
+       41,   41,   41,   41,   41,   41,   41,   41,   41,   41,
+
+       41,   41,   41,   41,   41,   41,   41,   41,   41,   41,
+       41,   41,   41,   41,   41,   42,   42,   42,   42,   42,
+       42,   42,   42,   42,   42,   42,   42,   42,   42,   42,
+       42,   42,   42,   42,   42,   42,   42,   42,   42,   42,
+       42,   42,   42,   42,   42,   42,   42,   42,   42,   42,
+       42,   42,   42,   42,   42,   42,   42,   42,   42,   42,
+       42,   42,   42,   42,   42,   42,   42,   43,   43,   43,
+       43,   81,   82,   43,   83,   84,   85,   43,   43,   43,
+       43,   43,   43,   43,   43,   43,   86,   87,   43,   88,
+       43,   91,   43,   43,   43,   43,   43,   43,   43,   43,
+
+       43,   43,   43,   43,   43,   43,   43,   43,   43,   43,
+       43,   43,   43,   43,   43,   43,   92,   43,   45,   45,
+       45,   45,   45,   45,   45,   45,   47,   47,   47,   47,
+       45,   45,   45,   45,   45,   45,   45,   45,   45,   93,
+       94,   45,   95,   45,   45,   45,   45,   45,   45,   45,
+       45,   45,   45,   45,   45,   45,   45,   45,   45,   45,
+       45,   45,   45,   45,   45,   45,   45,   58,   58,   58,
+       58,   58,   58,   58,   58,   58,   58,   58,   58,   58,
+       58,   58,   58,   58,   58,   58,   58,   58,   58,   58,
+       58,   98,   58,   58,   58,   58,   58,   58,   58,   58,
+
+       58,   58,   58,   58,   58,   58,   58,   58,   58,   58,
+       58,   58,   58,   58,   58,   58,   58,   58,   58,   59,
+       59,   59,   59,   89,  102,  105,   59,   59,   59,   59,
+       59,   59,   89,  111,   59,   59,   59,   59,  115,   59,
+       59,   59,   59,  116,   59,   59,   59,   59,   59,   59,
+       59,   59,   59,   59,   59,   59,   59,   59,   59,   59,
+       59,   59,   59,   59,   59,   59,   59,   59,   59,   59,
+       60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
+       60,   60,   60,  122,   60,   60,   60,   60,   60,   60,
+       60,   60,   60,   60,  123,   60,   60,   60,   60,   60,
+
+       60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
+       60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
+       60,   60,   63,   63,   63,   63,   65,   65,   65,   65,
+       75,  124,  125,   75,  100,  100,  100,  100,  126,  127,
+      128,  129,  130,  131,  126,  133,  137,  107,  107,  107,
+      107,   75,  107,  107,  107,  107,  107,  107,  107,  107,
+      107,  107,  107,  107,  107,  107,  107,  138,  107,  107,
+      107,  107,  107,  107,  107,  107,  107,  107,  107,  107,
+      107,  107,  107,  107,  107,  107,  107,  107,  107,  107,
+      107,  107,  107,  107,  107,  107,  107,  107,  107,  109,
+
+      109,  140,  147,  109,  109,  109,  109,  109,  109,  109,
+      109,  109,  109,  109,  109,  109,  109,  109,  109,  109,
+      109,  109,  109,  109,  109,  109,  109,  109,  109,  109,
+      109,  109,  109,  109,  109,  109,  109,  109,  109,  109,
+      109,  109,  109,  109,  109,  109,  109,  109,  109,  109,
+      109,  110,  110,  151,  110,  112,  112,  113,  113,  135,
+      135,  135,  144,  144,  152,  144,  112,  153,  113,  154,
+      146,  146,  110,  146,  155,  156,  157,  158,  159,  162,
+      169,  172,  175,  144,  176,  177,  178,  179,  180,  183,
+      184,  146,  187,  189,  112,  190,  113,  117,  117,  117,
+
+      117,  117,  117,  117,  117,  117,  117,  117,  117,  117,
+      192,  117,  117,  117,  117,  117,  117,  117,  117,  117,
+      117,  193,  117,  117,  117,  117,  117,  117,  117,  117,
+      117,  117,  117,  117,  117,  117,  117,  117,  117,  117,
+      117,  117,  117,  117,  117,  117,  117,  117,  117,  194,
+      195,  197,  198,  200,  200,  200,  200,  200,  200,  200,
+      200,  200,  200,  200,  200,  200,  200,  200,  200,  200,
+      200,  200,  200,  200,  200,  200,  200,  200,  200,  200,
+      200,  200,  200,  200,  200,  200,  200,  200,  200,  200,
+      200,  200,  200,  200,  200,  200,  200,  200,  200,  200,
+
+      200,  200,  200,  200,  200,  200
     } ;
 
 static yy_state_type yy_last_accepting_state;
@@ -697,11 +795,14 @@ int transport_expr_lex(void);
 
 #define yyterminate()   return END;
 
+/* The leading zeros of the last integer count, see Fraction. */
+int expr_integer_digits;
+
 #define YY_NO_INPUT 1
 
 
 
-#line 705 "tcpkali_expr_l.c"
+#line 806 "tcpkali_expr_l.c"
 
 #define INITIAL 0
 #define in_expression 1
@@ -898,10 +999,10 @@ YY_DECL
 	register char *yy_cp, *yy_bp;
 	register int yy_act;
     
-#line 27 "tcpkali_expr_l.l"
+#line 30 "tcpkali_expr_l.l"
 
 
-#line 905 "tcpkali_expr_l.c"
+#line 1006 "tcpkali_expr_l.c"
 
 	if ( !(yy_init) )
 		{
@@ -954,13 +1055,13 @@ yy_match:
 			while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 				{
 				yy_current_state = (int) yy_def[yy_current_state];
-				if ( yy_current_state >= 177 )
+				if ( yy_current_state >= 201 )
 					yy_c = yy_meta[(unsigned int) yy_c];
 				}
 			yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
 			++yy_cp;
 			}
-		while ( yy_current_state != 176 );
+		while ( yy_current_state != 200 );
 		yy_cp = (yy_last_accepting_cpos);
 		yy_current_state = (yy_last_accepting_state);
 
@@ -982,13 +1083,13 @@ do_action:	/* This label is used only to access EOF actions. */
 
 case 1:
 YY_RULE_SETUP
-#line 30 "tcpkali_expr_l.l"
+#line 33 "tcpkali_expr_l.l"
 { yy_push_state(in_expression); return '{'; }
 	YY_BREAK
 case 2:
 /* rule 2 can match eol */
 YY_RULE_SETUP
-#line 32 "tcpkali_expr_l.l"
+#line 35 "tcpkali_expr_l.l"
 {
             yylval.tv_string.buf = malloc(yyleng + 1);
             yylval.tv_string.len = yyleng;
@@ -999,14 +1100,14 @@ YY_RULE_SETUP
 	YY_BREAK
 
 case YY_STATE_EOF(INITIAL):
-#line 41 "tcpkali_expr_l.l"
+#line 44 "tcpkali_expr_l.l"
 yyterminate();
 	YY_BREAK
 
 case 3:
 /* rule 3 can match eol */
 YY_RULE_SETUP
-#line 45 "tcpkali_expr_l.l"
+#line 48 "tcpkali_expr_l.l"
 /* Ignore whitespace */
 	YY_BREAK
 /* Any not too brace-y characters within <> brackets parsed as a filename.
@@ -1015,7 +1116,7 @@ YY_RULE_SETUP
 case 4:
 /* rule 4 can match eol */
 YY_RULE_SETUP
-#line 50 "tcpkali_expr_l.l"
+#line 53 "tcpkali_expr_l.l"
 {
             yylval.tv_string.buf = strdup(yytext);
             yylval.tv_string.len = strlen(yytext);
@@ -1028,7 +1129,7 @@ YY_RULE_SETUP
 case 5:
 /* rule 5 can match eol */
 YY_RULE_SETUP
-#line 59 "tcpkali_expr_l.l"
+#line 62 "tcpkali_expr_l.l"
 {
             size_t new_size = yyleng - 2;
             char *new_str = malloc(new_size + 1);
@@ -1043,7 +1144,7 @@ YY_RULE_SETUP
 case 6:
 /* rule 6 can match eol */
 YY_RULE_SETUP
-#line 70 "tcpkali_expr_l.l"
+#line 73 "tcpkali_expr_l.l"
 {
             fprintf(stderr, "Unexpected filename format: %s ends with a backslashed quote\n", yytext);
             return -1;
@@ -1052,7 +1153,7 @@ YY_RULE_SETUP
 case 7:
 /* rule 7 can match eol */
 YY_RULE_SETUP
-#line 75 "tcpkali_expr_l.l"
+#line 78 "tcpkali_expr_l.l"
 {
             fprintf(stderr, "Unexpected filename format: %s\n", yytext);
             return -1;
@@ -1060,155 +1161,191 @@ YY_RULE_SETUP
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 80 "tcpkali_expr_l.l"
+#line 83 "tcpkali_expr_l.l"
 { yy_pop_state(); return '>'; }
 	YY_BREAK
 
 
 case 9:
 YY_RULE_SETUP
-#line 84 "tcpkali_expr_l.l"
+#line 87 "tcpkali_expr_l.l"
 { yy_push_state(in_filename); return '<'; }
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 85 "tcpkali_expr_l.l"
+#line 88 "tcpkali_expr_l.l"
 { yy_push_state(in_expression); return '{'; }
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 86 "tcpkali_expr_l.l"
+#line 89 "tcpkali_expr_l.l"
 { yy_pop_state(); return '}'; }
 	YY_BREAK
 case 12:
 /* rule 12 can match eol */
 YY_RULE_SETUP
-#line 87 "tcpkali_expr_l.l"
+#line 90 "tcpkali_expr_l.l"
 /* Ignore whitespace */
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 88 "tcpkali_expr_l.l"
+#line 91 "tcpkali_expr_l.l"
 return TOK_ws;
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 89 "tcpkali_expr_l.l"
+#line 92 "tcpkali_expr_l.l"
 return TOK_raw; /* Do not wrap in WS frame */
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 90 "tcpkali_expr_l.l"
+#line 93 "tcpkali_expr_l.l"
 { yylval.tv_opcode = WS_OP_CONTINUATION;
                       return TOK_ws_opcode; }
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 92 "tcpkali_expr_l.l"
+#line 95 "tcpkali_expr_l.l"
 { yylval.tv_opcode = WS_OP_TEXT_FRAME;
                       return TOK_ws_opcode; }
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 94 "tcpkali_expr_l.l"
+#line 97 "tcpkali_expr_l.l"
 { yylval.tv_opcode = WS_OP_BINARY_FRAME;
                       return TOK_ws_opcode; }
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 96 "tcpkali_expr_l.l"
+#line 99 "tcpkali_expr_l.l"
 { yylval.tv_opcode = WS_OP_CLOSE;
                       return TOK_ws_opcode; }
 	YY_BREAK
 case 19:
 YY_RULE_SETUP
-#line 98 "tcpkali_expr_l.l"
+#line 101 "tcpkali_expr_l.l"
 { yylval.tv_opcode = WS_OP_PING;
                       return TOK_ws_opcode; }
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 100 "tcpkali_expr_l.l"
+#line 103 "tcpkali_expr_l.l"
 { yylval.tv_opcode = WS_OP_PONG;
                       return TOK_ws_opcode; }
 	YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 102 "tcpkali_expr_l.l"
+#line 105 "tcpkali_expr_l.l"
 return TOK_connection;
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
-#line 103 "tcpkali_expr_l.l"
+#line 106 "tcpkali_expr_l.l"
 return TOK_message;
 	YY_BREAK
 case 23:
 YY_RULE_SETUP
-#line 104 "tcpkali_expr_l.l"
+#line 107 "tcpkali_expr_l.l"
 return TOK_global;
 	YY_BREAK
 case 24:
 YY_RULE_SETUP
-#line 105 "tcpkali_expr_l.l"
+#line 108 "tcpkali_expr_l.l"
 return TOK_ptr;
 	YY_BREAK
 case 25:
 YY_RULE_SETUP
-#line 106 "tcpkali_expr_l.l"
+#line 109 "tcpkali_expr_l.l"
 return TOK_uid;
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
-#line 107 "tcpkali_expr_l.l"
+#line 110 "tcpkali_expr_l.l"
 { yy_push_state(in_regex); return TOK_regex; }
 	YY_BREAK
 case 27:
 YY_RULE_SETUP
-#line 108 "tcpkali_expr_l.l"
+#line 111 "tcpkali_expr_l.l"
 return TOK_marker;
 	YY_BREAK
 case 28:
 YY_RULE_SETUP
-#line 109 "tcpkali_expr_l.l"
-{
-            yylval.tv_long = atol(yytext);
-            return integer;
-        }
+#line 112 "tcpkali_expr_l.l"
+return TOK_seq;
 	YY_BREAK
 case 29:
 YY_RULE_SETUP
 #line 113 "tcpkali_expr_l.l"
-return '.';
+return TOK_time;
 	YY_BREAK
 case 30:
 YY_RULE_SETUP
 #line 114 "tcpkali_expr_l.l"
-return TOK_ellipsis;
+return TOK_us;
 	YY_BREAK
 case 31:
 YY_RULE_SETUP
 #line 115 "tcpkali_expr_l.l"
-{ yylval.tv_long = 0x4; return TOK_ws_reserved_flag; }
+return TOK_random;
 	YY_BREAK
 case 32:
 YY_RULE_SETUP
 #line 116 "tcpkali_expr_l.l"
-{ yylval.tv_long = 0x2; return TOK_ws_reserved_flag; }
+return TOK_bytes;
 	YY_BREAK
 case 33:
 YY_RULE_SETUP
 #line 117 "tcpkali_expr_l.l"
-{ yylval.tv_long = 0x1; return TOK_ws_reserved_flag; }
+return TOK_alnum;
 	YY_BREAK
 case 34:
 YY_RULE_SETUP
 #line 118 "tcpkali_expr_l.l"
-return '%';
+return TOK_zipf;
 	YY_BREAK
 case 35:
-/* rule 35 can match eol */
 YY_RULE_SETUP
-#line 121 "tcpkali_expr_l.l"
+#line 119 "tcpkali_expr_l.l"
+{
+            yylval.tv_long = atol(yytext);
+            expr_integer_digits = yyleng;
+            return integer;
+        }
+	YY_BREAK
+case 36:
+YY_RULE_SETUP
+#line 124 "tcpkali_expr_l.l"
+return '.';
+	YY_BREAK
+case 37:
+YY_RULE_SETUP
+#line 125 "tcpkali_expr_l.l"
+return TOK_ellipsis;
+	YY_BREAK
+case 38:
+YY_RULE_SETUP
+#line 126 "tcpkali_expr_l.l"
+{ yylval.tv_long = 0x4; return TOK_ws_reserved_flag; }
+	YY_BREAK
+case 39:
+YY_RULE_SETUP
+#line 127 "tcpkali_expr_l.l"
+{ yylval.tv_long = 0x2; return TOK_ws_reserved_flag; }
+	YY_BREAK
+case 40:
+YY_RULE_SETUP
+#line 128 "tcpkali_expr_l.l"
+{ yylval.tv_long = 0x1; return TOK_ws_reserved_flag; }
+	YY_BREAK
+case 41:
+YY_RULE_SETUP
+#line 129 "tcpkali_expr_l.l"
+return '%';
+	YY_BREAK
+case 42:
+/* rule 42 can match eol */
+YY_RULE_SETUP
+#line 132 "tcpkali_expr_l.l"
 {
                     size_t new_size = yyleng - 2;
                     char *new_str = malloc(new_size + 1);
@@ -1220,10 +1357,10 @@ YY_RULE_SETUP
                     return quoted_string;
                 }
 	YY_BREAK
-case 36:
-/* rule 36 can match eol */
+case 43:
+/* rule 43 can match eol */
 YY_RULE_SETUP
-#line 132 "tcpkali_expr_l.l"
+#line 143 "tcpkali_expr_l.l"
 {
                     fprintf(stderr,
                         "Unexpected token in message expression: %s\n",
@@ -1232,9 +1369,9 @@ YY_RULE_SETUP
                     return -1;
                 }
 	YY_BREAK
-case 37:
+case 44:
 YY_RULE_SETUP
-#line 140 "tcpkali_expr_l.l"
+#line 151 "tcpkali_expr_l.l"
 {
                     fprintf(stderr,
                         "Unexpected token in message expression: %s\n",
@@ -1245,16 +1382,16 @@ YY_RULE_SETUP
 	YY_BREAK
 
 
-case 38:
-/* rule 38 can match eol */
+case 45:
+/* rule 45 can match eol */
 YY_RULE_SETUP
-#line 151 "tcpkali_expr_l.l"
+#line 162 "tcpkali_expr_l.l"
 /* Ignore whitespace */
 	YY_BREAK
-case 39:
-/* rule 39 can match eol */
+case 46:
+/* rule 46 can match eol */
 YY_RULE_SETUP
-#line 152 "tcpkali_expr_l.l"
+#line 163 "tcpkali_expr_l.l"
 {
                 yylval.tv_string.buf = malloc(yyleng + 1);
                 yylval.tv_string.len = yyleng;
@@ -1263,13 +1400,13 @@ YY_RULE_SETUP
                 return string_token;
             }
 	YY_BREAK
-case 40:
-/* rule 40 can match eol */
+case 47:
+/* rule 47 can match eol */
 *yy_cp = (yy_hold_char); /* undo effects of setting up yytext */
 (yy_c_buf_p) = yy_cp -= 2;
 YY_DO_BEFORE_ACTION; /* set up yytext again */
 YY_RULE_SETUP
-#line 159 "tcpkali_expr_l.l"
+#line 170 "tcpkali_expr_l.l"
 {
                 yylval.tv_string.buf = malloc(yyleng + 1);
                 yylval.tv_string.len = yyleng;
@@ -1278,62 +1415,62 @@ YY_RULE_SETUP
                 return string_token;
             }
 	YY_BREAK
-case 41:
+case 48:
 YY_RULE_SETUP
-#line 166 "tcpkali_expr_l.l"
+#line 177 "tcpkali_expr_l.l"
 { return '|'; }
 	YY_BREAK
-case 42:
+case 49:
 YY_RULE_SETUP
-#line 167 "tcpkali_expr_l.l"
+#line 178 "tcpkali_expr_l.l"
 { yy_push_state(in_regex_class); return '['; }
 	YY_BREAK
-case 43:
+case 50:
 YY_RULE_SETUP
-#line 168 "tcpkali_expr_l.l"
+#line 179 "tcpkali_expr_l.l"
 { return ']'; }
 	YY_BREAK
-case 44:
+case 51:
 YY_RULE_SETUP
-#line 169 "tcpkali_expr_l.l"
+#line 180 "tcpkali_expr_l.l"
 { return '('; }
 	YY_BREAK
-case 45:
+case 52:
 YY_RULE_SETUP
-#line 170 "tcpkali_expr_l.l"
+#line 181 "tcpkali_expr_l.l"
 { return ')'; }
 	YY_BREAK
-case 46:
+case 53:
 YY_RULE_SETUP
-#line 171 "tcpkali_expr_l.l"
+#line 182 "tcpkali_expr_l.l"
 { yy_push_state(in_regex_range); return '{'; }
 	YY_BREAK
-case 47:
+case 54:
 YY_RULE_SETUP
-#line 172 "tcpkali_expr_l.l"
+#line 183 "tcpkali_expr_l.l"
 { yy_pop_state(); unput('}'); }
 	YY_BREAK
-case 48:
+case 55:
 YY_RULE_SETUP
-#line 173 "tcpkali_expr_l.l"
+#line 184 "tcpkali_expr_l.l"
 { return '?'; }
 	YY_BREAK
-case 49:
+case 56:
 YY_RULE_SETUP
-#line 174 "tcpkali_expr_l.l"
+#line 185 "tcpkali_expr_l.l"
 { return '+'; }
 	YY_BREAK
-case 50:
+case 57:
 YY_RULE_SETUP
-#line 175 "tcpkali_expr_l.l"
+#line 186 "tcpkali_expr_l.l"
 { return '*'; }
 	YY_BREAK
 
 
-case 51:
-/* rule 51 can match eol */
+case 58:
+/* rule 58 can match eol */
 YY_RULE_SETUP
-#line 180 "tcpkali_expr_l.l"
+#line 191 "tcpkali_expr_l.l"
 {
                 yylval.tv_string.buf = malloc(yyleng + 1);
                 yylval.tv_string.len = yyleng;
@@ -1343,13 +1480,13 @@ YY_RULE_SETUP
                 return string_token;
             }
 	YY_BREAK
-case 52:
-/* rule 52 can match eol */
+case 59:
+/* rule 59 can match eol */
 *yy_cp = (yy_hold_char); /* undo effects of setting up yytext */
 (yy_c_buf_p) = yy_cp -= 2;
 YY_DO_BEFORE_ACTION; /* set up yytext again */
 YY_RULE_SETUP
-#line 189 "tcpkali_expr_l.l"
+#line 200 "tcpkali_expr_l.l"
 {
                 yylval.tv_string.buf = malloc(yyleng + 1);
                 yylval.tv_string.len = yyleng;
@@ -1359,10 +1496,10 @@ YY_RULE_SETUP
                 return string_token;
             }
 	YY_BREAK
-case 53:
-/* rule 53 can match eol */
+case 60:
+/* rule 60 can match eol */
 YY_RULE_SETUP
-#line 198 "tcpkali_expr_l.l"
+#line 209 "tcpkali_expr_l.l"
 {
                 assert(yyleng == 3);
                 yylval.tv_class_range.from = yytext[0];
@@ -1370,10 +1507,10 @@ YY_RULE_SETUP
                 return class_range_token;
             }
 	YY_BREAK
-case 54:
-/* rule 54 can match eol */
+case 61:
+/* rule 61 can match eol */
 YY_RULE_SETUP
-#line 205 "tcpkali_expr_l.l"
+#line 216 "tcpkali_expr_l.l"
 {
                 assert(yyleng == 2);
                 yylval.tv_string.buf = malloc(yyleng + 1);
@@ -1383,15 +1520,15 @@ YY_RULE_SETUP
                 return string_token;
             }
 	YY_BREAK
-case 55:
+case 62:
 YY_RULE_SETUP
-#line 214 "tcpkali_expr_l.l"
+#line 225 "tcpkali_expr_l.l"
 { yy_pop_state(); unput(']'); }
 	YY_BREAK
-case 56:
-/* rule 56 can match eol */
+case 63:
+/* rule 63 can match eol */
 YY_RULE_SETUP
-#line 216 "tcpkali_expr_l.l"
+#line 227 "tcpkali_expr_l.l"
 {
                     fprintf(stderr,
                         "Unexpected token in regular expression: %s\n",
@@ -1402,37 +1539,37 @@ YY_RULE_SETUP
 	YY_BREAK
 
 
-case 57:
-/* rule 57 can match eol */
+case 64:
+/* rule 64 can match eol */
 YY_RULE_SETUP
-#line 226 "tcpkali_expr_l.l"
+#line 237 "tcpkali_expr_l.l"
 /* Ignore whitespace */
 	YY_BREAK
-case 58:
+case 65:
 YY_RULE_SETUP
-#line 227 "tcpkali_expr_l.l"
+#line 238 "tcpkali_expr_l.l"
 {
             yylval.tv_long = atol(yytext);
             return integer;
         }
 	YY_BREAK
-case 59:
+case 66:
 YY_RULE_SETUP
-#line 232 "tcpkali_expr_l.l"
+#line 243 "tcpkali_expr_l.l"
 { return ','; }
 	YY_BREAK
-case 60:
+case 67:
 YY_RULE_SETUP
-#line 234 "tcpkali_expr_l.l"
+#line 245 "tcpkali_expr_l.l"
 { yy_pop_state(); return '}'; }
 	YY_BREAK
 
-case 61:
+case 68:
 YY_RULE_SETUP
-#line 237 "tcpkali_expr_l.l"
+#line 248 "tcpkali_expr_l.l"
 YY_FATAL_ERROR( "flex scanner jammed" );
 	YY_BREAK
-#line 1436 "tcpkali_expr_l.c"
+#line 1573 "tcpkali_expr_l.c"
 case YY_STATE_EOF(in_expression):
 case YY_STATE_EOF(in_filename):
 case YY_STATE_EOF(in_regex):
@@ -1729,7 +1866,7 @@ static int yy_get_next_buffer (void)
 		while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 			{
 			yy_current_state = (int) yy_def[yy_current_state];
-			if ( yy_current_state >= 177 )
+			if ( yy_current_state >= 201 )
 				yy_c = yy_meta[(unsigned int) yy_c];
 			}
 		yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
@@ -1757,11 +1894,11 @@ static int yy_get_next_buffer (void)
 	while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 		{
 		yy_current_state = (int) yy_def[yy_current_state];
-		if ( yy_current_state >= 177 )
+		if ( yy_current_state >= 201 )
 			yy_c = yy_meta[(unsigned int) yy_c];
 		}
 	yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
-	yy_is_jam = (yy_current_state == 176);
+	yy_is_jam = (yy_current_state == 200);
 
 	return yy_is_jam ? 0 : yy_current_state;
 }
@@ -2475,8 +2612,18 @@ void yyfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 237 "tcpkali_expr_l.l"
+#line 248 "tcpkali_expr_l.l"
+
 
 
 
 
+
+/*
+ * Go back to the initial state, which a syntax error leaves behind.
+ */
+void
+expr_lex_reset(void) {
+    yy_start_stack_ptr = 0;
+    BEGIN(INITIAL);
+}
@@ -1,8 +1,9 @@
-/* A Bison parser, made by GNU Bison 3.0.4.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
 /* Bison implementation for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989-1990, 2000-2015 Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
    This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
@@ -15,7 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -33,6 +34,10 @@
 /* C LALR(1) parser skeleton written by Richard Stallman, by
    simplifying the original so-called "semantic" parser.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 /* All symbols defined below should begin with yy or YY, to avoid
    infringing on user name space.  This should be done even for local
    variables, as they might otherwise be expanded by user macros.
@@ -40,11 +45,11 @@
    define necessary library symbols; they are noted "INFRINGES ON
    USER NAME SPACE" below.  */
 
-/* Identify Bison output.  */
-#define YYBISON 1
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
 
-/* Bison version.  */
-#define YYBISON_VERSION "3.0.4"
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
 
 /* Skeleton name.  */
 #define YYSKELETON_NAME "yacc.c"
@@ -61,172 +66,215 @@
 
 
 
-/* Copy the first part of user declarations.  */
-#line 1 "tcpkali_expr_y.y" /* yacc.c:339  */
+/* First part of user prologue.  */
+#line 1 "tcpkali_expr_y.y"
 
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <math.h>
 
 #include "tcpkali_websocket.h"
+#include "tcpkali_random.h"
 #include "tcpkali_expr.h"
 
 int yylex(void);
+extern int expr_integer_digits;
 int yyerror(tk_expr_t **, const char *);
 
 #define YYPARSE_PARAM   param
 #define YYERROR_VERBOSE
 
 
-#line 84 "tcpkali_expr_y.c" /* yacc.c:339  */
+#line 92 "tcpkali_expr_y.c"
 
+# ifndef YY_CAST
+#  ifdef __cplusplus
+#   define YY_CAST(Type, Val) static_cast<Type> (Val)
+#   define YY_REINTERPRET_CAST(Type, Val) reinterpret_cast<Type> (Val)
+#  else
+#   define YY_CAST(Type, Val) ((Type) (Val))
+#   define YY_REINTERPRET_CAST(Type, Val) ((Type) (Val))
+#  endif
+# endif
 # ifndef YY_NULLPTR
-#  if defined __cplusplus && 201103L <= __cplusplus
-#   define YY_NULLPTR nullptr
+#  if defined __cplusplus
+#   if 201103L <= __cplusplus
+#    define YY_NULLPTR nullptr
+#   else
+#    define YY_NULLPTR 0
+#   endif
 #  else
-#   define YY_NULLPTR 0
+#   define YY_NULLPTR ((void*)0)
 #  endif
 # endif
 
-/* Enabling verbose error messages.  */
-#ifdef YYERROR_VERBOSE
-# undef YYERROR_VERBOSE
-# define YYERROR_VERBOSE 1
-#else
-# define YYERROR_VERBOSE 0
-#endif
-
-/* In a future release of Bison, this section will be replaced
-   by #include "y.tab.h".  */
-#ifndef YY_YY_TCPKALI_EXPR_Y_H_INCLUDED
-# define YY_YY_TCPKALI_EXPR_Y_H_INCLUDED
-/* Debug traces.  */
-#ifndef YYDEBUG
-# define YYDEBUG 0
-#endif
-#if YYDEBUG
-extern int yydebug;
-#endif
-
-/* Token type.  */
-#ifndef YYTOKENTYPE
-# define YYTOKENTYPE
-  enum yytokentype
-  {
-    END = 0,
-    TOK_ws = 258,
-    TOK_raw = 259,
-    TOK_ws_opcode = 260,
-    TOK_ws_reserved_flag = 261,
-    TOK_global = 262,
-    TOK_connection = 263,
-    TOK_message = 264,
-    TOK_ptr = 265,
-    TOK_uid = 266,
-    TOK_regex = 267,
-    TOK_marker = 268,
-    TOK_ellipsis = 269,
-    string_token = 270,
-    class_range_token = 271,
-    repeat_range_token = 272,
-    quoted_string = 273,
-    filename = 274,
-    integer = 275
-  };
-#endif
-/* Tokens.  */
-#define END 0
-#define TOK_ws 258
-#define TOK_raw 259
-#define TOK_ws_opcode 260
-#define TOK_ws_reserved_flag 261
-#define TOK_global 262
-#define TOK_connection 263
-#define TOK_message 264
-#define TOK_ptr 265
-#define TOK_uid 266
-#define TOK_regex 267
-#define TOK_marker 268
-#define TOK_ellipsis 269
-#define string_token 270
-#define class_range_token 271
-#define repeat_range_token 272
-#define quoted_string 273
-#define filename 274
-#define integer 275
-
-/* Value type.  */
-#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-
-union YYSTYPE
+#include "tcpkali_expr_y.h"
+/* Symbol kind.  */
+enum yysymbol_kind_t
 {
-#line 21 "tcpkali_expr_y.y" /* yacc.c:355  */
-
-    tk_expr_t   *tv_expr;
-    tregex      *tv_regex;
-    long         tv_long;
-    struct {
-        char  *buf;
-        size_t len;
-    } tv_string;
-    struct {
-        unsigned char from;
-        unsigned char to;
-    } tv_class_range;
-    struct {
-        unsigned char from;
-        unsigned char to;
-    } tv_repeat_range;
-    enum ws_frame_opcode tv_opcode;
-    char  tv_char;
-
-#line 186 "tcpkali_expr_y.c" /* yacc.c:355  */
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of expression"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL_TOK_ws = 3,                     /* "ws"  */
+  YYSYMBOL_TOK_raw = 4,                    /* "raw"  */
+  YYSYMBOL_TOK_ws_opcode = 5,              /* "text, binary, close, ping, pong, continuation"  */
+  YYSYMBOL_TOK_ws_reserved_flag = 6,       /* "rsv1, rsv2, rsv3"  */
+  YYSYMBOL_TOK_global = 7,                 /* "global"  */
+  YYSYMBOL_TOK_connection = 8,             /* "connection"  */
+  YYSYMBOL_TOK_message = 9,                /* "message"  */
+  YYSYMBOL_TOK_ptr = 10,                   /* " ptr"  */
+  YYSYMBOL_TOK_uid = 11,                   /* "uid"  */
+  YYSYMBOL_TOK_regex = 12,                 /* "re"  */
+  YYSYMBOL_TOK_marker = 13,                /* "marker"  */
+  YYSYMBOL_TOK_seq = 14,                   /* "seq"  */
+  YYSYMBOL_TOK_time = 15,                  /* "time"  */
+  YYSYMBOL_TOK_us = 16,                    /* "us"  */
+  YYSYMBOL_TOK_random = 17,                /* "random"  */
+  YYSYMBOL_TOK_bytes = 18,                 /* "bytes"  */
+  YYSYMBOL_TOK_alnum = 19,                 /* "alnum"  */
+  YYSYMBOL_TOK_zipf = 20,                  /* "zipf"  */
+  YYSYMBOL_TOK_ellipsis = 21,              /* "..."  */
+  YYSYMBOL_string_token = 22,              /* "arbitrary string"  */
+  YYSYMBOL_class_range_token = 23,         /* "regex character class range"  */
+  YYSYMBOL_repeat_range_token = 24,        /* "regex repeat spec"  */
+  YYSYMBOL_quoted_string = 25,             /* "quoted string"  */
+  YYSYMBOL_filename = 26,                  /* "file name"  */
+  YYSYMBOL_integer = 27,                   /* integer  */
+  YYSYMBOL_28_ = 28,                       /* '|'  */
+  YYSYMBOL_29_some_string_or_expression_ = 29, /* "some string or \\{expression}"  */
+  YYSYMBOL_30_data_and_expressions_ = 30,  /* "data and expressions"  */
+  YYSYMBOL_31_connection_global_re_or_filename_ext_ = 31, /* "connection, global, re, or <filename.ext>"  */
+  YYSYMBOL_32_ = 32,                       /* '{'  */
+  YYSYMBOL_33_ = 33,                       /* '}'  */
+  YYSYMBOL_34_ = 34,                       /* '.'  */
+  YYSYMBOL_35_ = 35,                       /* '%'  */
+  YYSYMBOL_36_ = 36,                       /* '<'  */
+  YYSYMBOL_37_ = 37,                       /* '>'  */
+  YYSYMBOL_38_ = 38,                       /* '?'  */
+  YYSYMBOL_39_ = 39,                       /* '+'  */
+  YYSYMBOL_40_ = 40,                       /* '*'  */
+  YYSYMBOL_41_ = 41,                       /* ','  */
+  YYSYMBOL_42_ = 42,                       /* '['  */
+  YYSYMBOL_43_ = 43,                       /* ']'  */
+  YYSYMBOL_44_ = 44,                       /* '('  */
+  YYSYMBOL_45_ = 45,                       /* ')'  */
+  YYSYMBOL_YYACCEPT = 46,                  /* $accept  */
+  YYSYMBOL_Grammar = 47,                   /* Grammar  */
+  YYSYMBOL_ByteSequencesAndExpressions = 48, /* ByteSequencesAndExpressions  */
+  YYSYMBOL_String = 49,                    /* String  */
+  YYSYMBOL_ByteSequenceOrExpr = 50,        /* ByteSequenceOrExpr  */
+  YYSYMBOL_WSExpression = 51,              /* WSExpression  */
+  YYSYMBOL_NonWSExpression = 52,           /* NonWSExpression  */
+  YYSYMBOL_Number = 53,                    /* Number  */
+  YYSYMBOL_Fraction = 54,                  /* Fraction  */
+  YYSYMBOL_NumericExpr = 55,               /* NumericExpr  */
+  YYSYMBOL_WSFrameFinalized = 56,          /* WSFrameFinalized  */
+  YYSYMBOL_WSFrameWithData = 57,           /* WSFrameWithData  */
+  YYSYMBOL_WSBasicFrame = 58,              /* WSBasicFrame  */
+  YYSYMBOL_FileOrQuoted = 59,              /* FileOrQuoted  */
+  YYSYMBOL_File = 60,                      /* File  */
+  YYSYMBOL_CompleteRegex = 61,             /* CompleteRegex  */
+  YYSYMBOL_RegexAlternatives = 62,         /* RegexAlternatives  */
+  YYSYMBOL_RegexSequence = 63,             /* RegexSequence  */
+  YYSYMBOL_RepeatedRegex = 64,             /* RepeatedRegex  */
+  YYSYMBOL_RegexPiece = 65,                /* RegexPiece  */
+  YYSYMBOL_RegexClasses = 66,              /* RegexClasses  */
+  YYSYMBOL_RegexClass = 67                 /* RegexClass  */
 };
+typedef enum yysymbol_kind_t yysymbol_kind_t;
 
-typedef union YYSTYPE YYSTYPE;
-# define YYSTYPE_IS_TRIVIAL 1
-# define YYSTYPE_IS_DECLARED 1
-#endif
 
 
-extern YYSTYPE yylval;
 
-int yyparse (tk_expr_t **param);
+#ifdef short
+# undef short
+#endif
 
-#endif /* !YY_YY_TCPKALI_EXPR_Y_H_INCLUDED  */
+/* On compilers that do not define __PTRDIFF_MAX__ etc., make sure
+   <limits.h> and (if available) <stdint.h> are included
+   so that the code can choose integer types of a good width.  */
 
-/* Copy the second part of user declarations.  */
+#ifndef __PTRDIFF_MAX__
+# include <limits.h> /* INFRINGES ON USER NAME SPACE */
+# if defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stdint.h> /* INFRINGES ON USER NAME SPACE */
+#  define YY_STDINT_H
+# endif
+#endif
 
-#line 203 "tcpkali_expr_y.c" /* yacc.c:358  */
+/* Narrow types that promote to a signed type and that can represent a
+   signed or unsigned integer of at least N bits.  In tables they can
+   save space and decrease cache pressure.  Promoting to a signed type
+   helps avoid bugs in integer arithmetic.  */
 
-#ifdef short
-# undef short
+#ifdef __INT_LEAST8_MAX__
+typedef __INT_LEAST8_TYPE__ yytype_int8;
+#elif defined YY_STDINT_H
+typedef int_least8_t yytype_int8;
+#else
+typedef signed char yytype_int8;
 #endif
 
-#ifdef YYTYPE_UINT8
-typedef YYTYPE_UINT8 yytype_uint8;
+#ifdef __INT_LEAST16_MAX__
+typedef __INT_LEAST16_TYPE__ yytype_int16;
+#elif defined YY_STDINT_H
+typedef int_least16_t yytype_int16;
 #else
-typedef unsigned char yytype_uint8;
+typedef short yytype_int16;
 #endif
 
-#ifdef YYTYPE_INT8
-typedef YYTYPE_INT8 yytype_int8;
-#else
-typedef signed char yytype_int8;
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
 #endif
 
-#ifdef YYTYPE_UINT16
-typedef YYTYPE_UINT16 yytype_uint16;
+#if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST8_TYPE__ yytype_uint8;
+#elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST8_MAX <= INT_MAX)
+typedef uint_least8_t yytype_uint8;
+#elif !defined __UINT_LEAST8_MAX__ && UCHAR_MAX <= INT_MAX
+typedef unsigned char yytype_uint8;
 #else
-typedef unsigned short int yytype_uint16;
+typedef short yytype_uint8;
 #endif
 
-#ifdef YYTYPE_INT16
-typedef YYTYPE_INT16 yytype_int16;
+#if defined __UINT_LEAST16_MAX__ && __UINT_LEAST16_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST16_TYPE__ yytype_uint16;
+#elif (!defined __UINT_LEAST16_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST16_MAX <= INT_MAX)
+typedef uint_least16_t yytype_uint16;
+#elif !defined __UINT_LEAST16_MAX__ && USHRT_MAX <= INT_MAX
+typedef unsigned short yytype_uint16;
 #else
-typedef short int yytype_int16;
+typedef int yytype_uint16;
+#endif
+
+#ifndef YYPTRDIFF_T
+# if defined __PTRDIFF_TYPE__ && defined __PTRDIFF_MAX__
+#  define YYPTRDIFF_T __PTRDIFF_TYPE__
+#  define YYPTRDIFF_MAXIMUM __PTRDIFF_MAX__
+# elif defined PTRDIFF_MAX
+#  ifndef ptrdiff_t
+#   include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  endif
+#  define YYPTRDIFF_T ptrdiff_t
+#  define YYPTRDIFF_MAXIMUM PTRDIFF_MAX
+# else
+#  define YYPTRDIFF_T long
+#  define YYPTRDIFF_MAXIMUM LONG_MAX
+# endif
 #endif
 
 #ifndef YYSIZE_T
@@ -234,15 +282,28 @@ typedef short int yytype_int16;
 #  define YYSIZE_T __SIZE_TYPE__
 # elif defined size_t
 #  define YYSIZE_T size_t
-# elif ! defined YYSIZE_T
+# elif defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
 #  include <stddef.h> /* INFRINGES ON USER NAME SPACE */
 #  define YYSIZE_T size_t
 # else
-#  define YYSIZE_T unsigned int
+#  define YYSIZE_T unsigned
 # endif
 #endif
 
-#define YYSIZE_MAXIMUM ((YYSIZE_T) -1)
+#define YYSIZE_MAXIMUM                                  \
+  YY_CAST (YYPTRDIFF_T,                                 \
+           (YYPTRDIFF_MAXIMUM < YY_CAST (YYSIZE_T, -1)  \
+            ? YYPTRDIFF_MAXIMUM                         \
+            : YY_CAST (YYSIZE_T, -1)))
+
+#define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
+
+
+/* Stored state numbers (used for stacks). */
+typedef yytype_int8 yy_state_t;
+
+/* State numbers in computations.  */
+typedef int yy_state_fast_t;
 
 #ifndef YY_
 # if defined YYENABLE_NLS && YYENABLE_NLS
@@ -256,47 +317,43 @@ typedef short int yytype_int16;
 # endif
 #endif
 
-#ifndef YY_ATTRIBUTE
-# if (defined __GNUC__                                               \
-      && (2 < __GNUC__ || (__GNUC__ == 2 && 96 <= __GNUC_MINOR__)))  \
-     || defined __SUNPRO_C && 0x5110 <= __SUNPRO_C
-#  define YY_ATTRIBUTE(Spec) __attribute__(Spec)
-# else
-#  define YY_ATTRIBUTE(Spec) /* empty */
-# endif
-#endif
 
 #ifndef YY_ATTRIBUTE_PURE
-# define YY_ATTRIBUTE_PURE   YY_ATTRIBUTE ((__pure__))
+# if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
+# else
+#  define YY_ATTRIBUTE_PURE
+# endif
 #endif
 
 #ifndef YY_ATTRIBUTE_UNUSED
-# define YY_ATTRIBUTE_UNUSED YY_ATTRIBUTE ((__unused__))
-#endif
-
-#if !defined _Noreturn \
-     && (!defined __STDC_VERSION__ || __STDC_VERSION__ < 201112)
-# if defined _MSC_VER && 1200 <= _MSC_VER
-#  define _Noreturn __declspec (noreturn)
+# if defined __GNUC__ && 2 < __GNUC__ + (7 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_UNUSED __attribute__ ((__unused__))
 # else
-#  define _Noreturn YY_ATTRIBUTE ((__noreturn__))
+#  define YY_ATTRIBUTE_UNUSED
 # endif
 #endif
 
 /* Suppress unused-variable warnings by "using" E.  */
 #if ! defined lint || defined __GNUC__
-# define YYUSE(E) ((void) (E))
+# define YY_USE(E) ((void) (E))
 #else
-# define YYUSE(E) /* empty */
+# define YY_USE(E) /* empty */
 #endif
 
-#if defined __GNUC__ && 407 <= __GNUC__ * 100 + __GNUC_MINOR__
 /* Suppress an incorrect diagnostic about yylval being uninitialized.  */
-# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN \
-    _Pragma ("GCC diagnostic push") \
-    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")\
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
     _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
-# define YY_IGNORE_MAYBE_UNINITIALIZED_END \
+# endif
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
     _Pragma ("GCC diagnostic pop")
 #else
 # define YY_INITIAL_VALUE(Value) Value
@@ -309,8 +366,22 @@ typedef short int yytype_int16;
 # define YY_INITIAL_VALUE(Value) /* Nothing. */
 #endif
 
+#if defined __cplusplus && defined __GNUC__ && ! defined __ICC && 6 <= __GNUC__
+# define YY_IGNORE_USELESS_CAST_BEGIN                          \
+    _Pragma ("GCC diagnostic push")                            \
+    _Pragma ("GCC diagnostic ignored \"-Wuseless-cast\"")
+# define YY_IGNORE_USELESS_CAST_END            \
+    _Pragma ("GCC diagnostic pop")
+#endif
+#ifndef YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_END
+#endif
+
 
-#if ! defined yyoverflow || YYERROR_VERBOSE
+#define YY_ASSERT(E) ((void) (0 && (E)))
+
+#if !defined yyoverflow
 
 /* The parser invokes alloca or malloc; define the necessary symbols.  */
 
@@ -375,8 +446,7 @@ void free (void *); /* INFRINGES ON USER NAME SPACE */
 #   endif
 #  endif
 # endif
-#endif /* ! defined yyoverflow || YYERROR_VERBOSE */
-
+#endif /* !defined yyoverflow */
 
 #if (! defined yyoverflow \
      && (! defined __cplusplus \
@@ -385,17 +455,17 @@ void free (void *); /* INFRINGES ON USER NAME SPACE */
 /* A type that is properly aligned for any stack member.  */
 union yyalloc
 {
-  yytype_int16 yyss_alloc;
+  yy_state_t yyss_alloc;
   YYSTYPE yyvs_alloc;
 };
 
 /* The size of the maximum gap between one aligned stack and the next.  */
-# define YYSTACK_GAP_MAXIMUM (sizeof (union yyalloc) - 1)
+# define YYSTACK_GAP_MAXIMUM (YYSIZEOF (union yyalloc) - 1)
 
 /* The size of an array large to enough to hold all stacks, each with
    N elements.  */
 # define YYSTACK_BYTES(N) \
-     ((N) * (sizeof (yytype_int16) + sizeof (YYSTYPE)) \
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE)) \
       + YYSTACK_GAP_MAXIMUM)
 
 # define YYCOPY_NEEDED 1
@@ -408,11 +478,11 @@ union yyalloc
 # define YYSTACK_RELOCATE(Stack_alloc, Stack)                           \
     do                                                                  \
       {                                                                 \
-        YYSIZE_T yynewbytes;                                            \
+        YYPTRDIFF_T yynewbytes;                                         \
         YYCOPY (&yyptr->Stack_alloc, Stack, yysize);                    \
         Stack = &yyptr->Stack_alloc;                                    \
-        yynewbytes = yystacksize * sizeof (*Stack) + YYSTACK_GAP_MAXIMUM; \
-        yyptr += yynewbytes / sizeof (*yyptr);                          \
+        yynewbytes = yystacksize * YYSIZEOF (*Stack) + YYSTACK_GAP_MAXIMUM; \
+        yyptr += yynewbytes / YYSIZEOF (*yyptr);                        \
       }                                                                 \
     while (0)
 
@@ -424,12 +494,12 @@ union yyalloc
 # ifndef YYCOPY
 #  if defined __GNUC__ && 1 < __GNUC__
 #   define YYCOPY(Dst, Src, Count) \
-      __builtin_memcpy (Dst, Src, (Count) * sizeof (*(Src)))
+      __builtin_memcpy (Dst, Src, YY_CAST (YYSIZE_T, (Count)) * sizeof (*(Src)))
 #  else
 #   define YYCOPY(Dst, Src, Count)              \
       do                                        \
         {                                       \
-          YYSIZE_T yyi;                         \
+          YYPTRDIFF_T yyi;                      \
           for (yyi = 0; yyi < (Count); yyi++)   \
             (Dst)[yyi] = (Src)[yyi];            \
         }                                       \
@@ -439,44 +509,47 @@ union yyalloc
 #endif /* !YYCOPY_NEEDED */
 
 /* YYFINAL -- State number of the termination state.  */
-#define YYFINAL  22
+#define YYFINAL  25
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   78
+#define YYLAST   108
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS  39
+#define YYNTOKENS  46
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS  20
+#define YYNNTS  22
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  49
+#define YYNRULES  57
 /* YYNSTATES -- Number of states.  */
-#define YYNSTATES  81
+#define YYNSTATES  98
 
-/* YYTRANSLATE[YYX] -- Symbol number corresponding to YYX as returned
-   by yylex, with out-of-bounds checking.  */
-#define YYUNDEFTOK  2
-#define YYMAXUTOK   278
+/* YYMAXUTOK -- Last valid token kind.  */
+#define YYMAXUTOK   285
 
-#define YYTRANSLATE(YYX)                                                \
-  ((unsigned int) (YYX) <= YYMAXUTOK ? yytranslate[YYX] : YYUNDEFTOK)
+
+/* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex, with out-of-bounds checking.  */
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
 
 /* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
-   as returned by yylex, without out-of-bounds checking.  */
-static const yytype_uint8 yytranslate[] =
+   as returned by yylex.  */
+static const yytype_int8 yytranslate[] =
 {
        0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,    28,     2,     2,
-      37,    38,    33,    32,    34,     2,    27,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,    35,     2,     2,
+      44,    45,    40,    39,    41,     2,    34,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-      29,     2,    30,    31,     2,     2,     2,     2,     2,     2,
+      36,     2,    37,    38,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,    35,     2,    36,     2,     2,     2,     2,     2,     2,
+       2,    42,     2,    43,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,    25,    21,    26,     2,     2,     2,     2,
+       2,     2,     2,    32,    28,    33,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
@@ -491,206 +564,224 @@ static const yytype_uint8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
        5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
-      15,    16,    17,    18,    19,    20,    22,    23,    24
+      15,    16,    17,    18,    19,    20,    21,    22,    23,    24,
+      25,    26,    27,    29,    30,    31
 };
 
 #if YYDEBUG
-  /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
-static const yytype_uint16 yyrline[] =
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+static const yytype_int16 yyrline[] =
 {
-       0,    75,    75,    81,    87,    90,    95,    96,   107,   116,
-     119,   123,   126,   134,   137,   148,   155,   166,   174,   184,
-     192,   198,   204,   212,   214,   219,   225,   227,   243,   251,
-     251,   254,   274,   277,   280,   285,   286,   291,   292,   293,
-     294,   295,   296,   299,   302,   305,   310,   311,   316,   319
+       0,    87,    87,    93,    99,   102,   107,   108,   119,   128,
+     131,   135,   138,   146,   150,   156,   162,   174,   187,   210,
+     221,   228,   239,   247,   257,   258,   262,   265,   273,   279,
+     285,   293,   295,   300,   306,   308,   324,   332,   332,   335,
+     355,   358,   361,   366,   367,   372,   373,   374,   375,   376,
+     377,   380,   383,   386,   391,   392,   397,   400
 };
 #endif
 
-#if YYDEBUG || YYERROR_VERBOSE || 0
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
+
+#if YYDEBUG || 0
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
+
 /* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
    First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
 static const char *const yytname[] =
 {
-  "\"end of expression\"", "error", "$undefined", "\"ws\"", "\"raw\"",
-  "\"text, binary, close, ping, pong, continuation\"",
+  "\"end of expression\"", "error", "\"invalid token\"", "\"ws\"",
+  "\"raw\"", "\"text, binary, close, ping, pong, continuation\"",
   "\"rsv1, rsv2, rsv3\"", "\"global\"", "\"connection\"", "\"message\"",
-  "\" ptr\"", "\"uid\"", "\"re\"", "\"marker\"", "\"...\"",
+  "\" ptr\"", "\"uid\"", "\"re\"", "\"marker\"", "\"seq\"", "\"time\"",
+  "\"us\"", "\"random\"", "\"bytes\"", "\"alnum\"", "\"zipf\"", "\"...\"",
   "\"arbitrary string\"", "\"regex character class range\"",
   "\"regex repeat spec\"", "\"quoted string\"", "\"file name\"", "integer",
   "'|'", "\"some string or \\\\{expression}\"", "\"data and expressions\"",
   "\"connection, global, re, or <filename.ext>\"", "'{'", "'}'", "'.'",
   "'%'", "'<'", "'>'", "'?'", "'+'", "'*'", "','", "'['", "']'", "'('",
   "')'", "$accept", "Grammar", "ByteSequencesAndExpressions", "String",
-  "ByteSequenceOrExpr", "WSExpression", "NonWSExpression", "NumericExpr",
-  "WSFrameFinalized", "WSFrameWithData", "WSBasicFrame", "FileOrQuoted",
-  "File", "CompleteRegex", "RegexAlternatives", "RegexSequence",
-  "RepeatedRegex", "RegexPiece", "RegexClasses", "RegexClass", YY_NULLPTR
+  "ByteSequenceOrExpr", "WSExpression", "NonWSExpression", "Number",
+  "Fraction", "NumericExpr", "WSFrameFinalized", "WSFrameWithData",
+  "WSBasicFrame", "FileOrQuoted", "File", "CompleteRegex",
+  "RegexAlternatives", "RegexSequence", "RepeatedRegex", "RegexPiece",
+  "RegexClasses", "RegexClass", YY_NULLPTR
 };
-#endif
 
-# ifdef YYPRINT
-/* YYTOKNUM[NUM] -- (External) token number corresponding to the
-   (internal) symbol number NUM (which must be that of a token).  */
-static const yytype_uint16 yytoknum[] =
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
 {
-       0,   256,   257,   258,   259,   260,   261,   262,   263,   264,
-     265,   266,   267,   268,   269,   270,   271,   272,   273,   274,
-     275,   124,   276,   277,   278,   123,   125,    46,    37,    60,
-      62,    63,    43,    42,    44,    91,    93,    40,    41
-};
-# endif
+  return yytname[yysymbol];
+}
+#endif
 
-#define YYPACT_NINF -40
+#define YYPACT_NINF (-43)
 
-#define yypact_value_is_default(Yystate) \
-  (!!((Yystate) == (-40)))
+#define yypact_value_is_default(Yyn) \
+  ((Yyn) == YYPACT_NINF)
 
-#define YYTABLE_NINF -1
+#define YYTABLE_NINF (-1)
 
-#define yytable_value_is_error(Yytable_value) \
+#define yytable_value_is_error(Yyn) \
   0
 
-  /* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
-     STATE-NUM.  */
+/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
+   STATE-NUM.  */
 static const yytype_int8 yypact[] =
 {
-       3,   -40,   -40,    -2,    23,    41,    28,     5,    27,    13,
-      29,    31,    32,   -11,    38,    34,    35,    37,    39,    11,
-     -40,   -40,   -40,   -40,   -40,   -40,    50,   -40,     4,   -40,
-     -40,    51,    36,    49,   -40,     6,   -11,   -40,    43,   -11,
-     -40,    19,    40,   -40,   -40,    46,   -40,   -40,   -40,   -40,
-      42,   -11,   -40,   -40,   -11,   -40,   -40,    28,    -1,   -40,
-      33,   -11,   -40,    47,   -40,   -40,   -40,   -40,   -40,   -40,
-     -40,   -40,   -40,   -40,   -40,   -11,    -9,   -40,    52,    48,
-     -40
+       3,   -43,   -43,    -2,    61,    62,    -8,    32,    29,    17,
+      31,    33,    34,   -14,    35,    36,    39,    46,    38,    40,
+      41,    30,    14,   -43,   -43,   -43,   -43,   -43,   -43,    69,
+     -43,    12,   -43,   -43,    63,    45,    27,   -43,   -11,   -14,
+     -43,    49,   -14,   -43,    20,    64,    19,    51,    42,   -43,
+     -43,    54,   -43,   -43,   -43,   -43,    50,   -14,   -43,   -43,
+     -14,   -43,   -43,   -43,    -8,     0,   -43,    37,   -14,   -43,
+      57,   -43,   -43,   -43,   -43,    58,    59,    53,   -43,   -43,
+     -43,   -43,   -43,   -43,   -43,   -43,   -43,   -14,   -24,   -43,
+     -43,    65,   -43,    66,   -43,   -43,    55,   -43
 };
 
-  /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
-     Performed when YYTABLE does not specify something else to do.  Zero
-     means the default is an error.  */
-static const yytype_uint8 yydefact[] =
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
+static const yytype_int8 yydefact[] =
 {
        0,     2,     6,     0,     0,     0,     8,     4,     0,     0,
-       0,     0,     0,     0,     0,     0,     0,    13,    11,    23,
-      26,    12,     1,     3,     7,     5,     0,    29,     0,    14,
-      30,     0,     0,     0,    43,     0,     0,    18,    32,    33,
-      35,    37,     0,     9,    10,     0,    25,    24,    27,    28,
-       0,     0,    20,    21,     0,    22,    49,    48,     0,    46,
-       0,     0,    36,     0,    38,    39,    40,    31,    19,    15,
-      16,    17,    44,    47,    45,    34,     0,    41,     0,     0,
-      42
+       0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+      13,    11,    31,    34,    12,     1,     3,     7,     5,     0,
+      37,     0,    19,    38,     0,     0,     0,    51,     0,     0,
+      23,    40,    41,    43,    45,     0,     0,     0,     0,     9,
+      10,     0,    33,    32,    35,    36,     0,     0,    28,    29,
+       0,    30,    14,    57,    56,     0,    54,     0,     0,    44,
+       0,    46,    47,    48,    15,     0,     0,    24,    18,    39,
+      27,    20,    21,    22,    52,    55,    53,    42,     0,    16,
+      17,     0,    49,     0,    26,    25,     0,    50
 };
 
-  /* YYPGOTO[NTERM-NUM].  */
+/* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-     -40,   -40,    62,   -26,   -40,   -40,    45,   -40,   -40,   -40,
-     -40,    56,    30,   -17,   -40,    15,   -39,   -40,   -40,    20
+     -43,   -43,    82,   -34,   -43,   -43,    60,   -43,   -43,   -43,
+     -43,   -43,   -43,    68,    24,   -13,   -43,    26,   -42,   -43,
+     -43,    43
 };
 
-  /* YYDEFGOTO[NTERM-NUM].  */
+/* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int8 yydefgoto[] =
 {
-      -1,     4,     5,     6,     7,    15,    16,    17,    18,    19,
-      20,    29,    21,    37,    38,    39,    40,    41,    58,    59
+       0,     4,     5,     6,     7,    18,    19,    78,    95,    20,
+      21,    22,    23,    32,    24,    40,    41,    42,    43,    44,
+      65,    66
 };
 
-  /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
-     positive, shift that token.  If negative, reduce the rule whose
-     number is the opposite.  If YYTABLE_NINF, syntax error.  */
-static const yytype_uint8 yytable[] =
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
+static const yytype_int8 yytable[] =
 {
-      62,     8,     9,     1,    34,    10,    11,    12,     9,    57,
-      13,    10,    11,    12,     2,    56,    13,    77,     2,    60,
-       2,     2,    56,    22,    35,    78,    36,    14,     3,    27,
-       3,    27,    57,    14,    70,    72,    62,    71,    28,    30,
-      14,    23,    14,    24,    63,    46,    52,    53,    54,    30,
-      64,    65,    66,    47,    26,    49,    31,    42,    32,    33,
-      43,    44,    55,    51,    61,    45,    68,    76,    69,    25,
-      67,    74,    79,    50,    80,    48,    75,     0,    73
+      69,     8,     9,     1,    64,    10,    11,    12,    37,    92,
+      13,     2,    63,    14,    27,    15,     9,    93,    16,    10,
+      11,    12,     2,    63,    13,     2,    67,    14,    38,    15,
+      39,    64,    16,    33,    17,     3,    52,    75,    76,    30,
+      61,    62,    30,    84,    82,    69,    33,    83,    17,    31,
+      17,    53,    70,    17,     2,    58,    59,    60,    71,    72,
+      73,    25,    26,    29,     3,    34,    47,    35,    36,    45,
+      46,    49,    48,    50,    55,    57,    51,    68,    77,    79,
+      74,    80,    86,    81,    88,    89,    90,    91,    97,    28,
+      54,    56,    94,    96,    87,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,     0,     0,     0,     0,    85
 };
 
 static const yytype_int8 yycheck[] =
 {
-      39,     3,     4,     0,    15,     7,     8,     9,     4,    35,
-      12,     7,     8,     9,    15,    16,    12,    26,    15,    36,
-      15,    15,    16,     0,    35,    34,    37,    29,    25,    18,
-      25,    18,    58,    29,    51,    36,    75,    54,    25,     9,
-      29,     0,    29,    15,    25,     6,    10,    11,    12,    19,
-      31,    32,    33,    14,    27,     5,    27,    19,    27,    27,
-      26,    26,    13,    12,    21,    28,    20,    20,    26,     7,
-      30,    38,    20,    28,    26,    19,    61,    -1,    58
+      42,     3,     4,     0,    38,     7,     8,     9,    22,    33,
+      12,    22,    23,    15,    22,    17,     4,    41,    20,     7,
+       8,     9,    22,    23,    12,    22,    39,    15,    42,    17,
+      44,    65,    20,     9,    36,    32,     6,    18,    19,    25,
+      13,    14,    25,    43,    57,    87,    22,    60,    36,    32,
+      36,    21,    32,    36,    22,    10,    11,    12,    38,    39,
+      40,     0,     0,    34,    32,    34,    27,    34,    34,    34,
+      34,    33,    26,    33,     5,    12,    35,    28,    27,    37,
+      16,    27,    45,    33,    27,    27,    27,    34,    33,     7,
+      22,    31,    27,    27,    68,    -1,    -1,    -1,    -1,    -1,
+      -1,    -1,    -1,    -1,    -1,    -1,    -1,    -1,    65
 };
 
-  /* YYSTOS[STATE-NUM] -- The (internal number of the) accessing
-     symbol of state STATE-NUM.  */
-static const yytype_uint8 yystos[] =
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
+static const yytype_int8 yystos[] =
 {
-       0,     0,    15,    25,    40,    41,    42,    43,     3,     4,
-       7,     8,     9,    12,    29,    44,    45,    46,    47,    48,
-      49,    51,     0,     0,    15,    41,    27,    18,    25,    50,
-      51,    27,    27,    27,    15,    35,    37,    52,    53,    54,
-      55,    56,    19,    26,    26,    28,     6,    14,    50,     5,
-      45,    12,    10,    11,    12,    13,    16,    42,    57,    58,
-      52,    21,    55,    25,    31,    32,    33,    30,    20,    26,
-      52,    52,    36,    58,    38,    54,    20,    26,    34,    20,
-      26
+       0,     0,    22,    32,    47,    48,    49,    50,     3,     4,
+       7,     8,     9,    12,    15,    17,    20,    36,    51,    52,
+      55,    56,    57,    58,    60,     0,     0,    22,    48,    34,
+      25,    32,    59,    60,    34,    34,    34,    22,    42,    44,
+      61,    62,    63,    64,    65,    34,    34,    27,    26,    33,
+      33,    35,     6,    21,    59,     5,    52,    12,    10,    11,
+      12,    13,    14,    23,    49,    66,    67,    61,    28,    64,
+      32,    38,    39,    40,    16,    18,    19,    27,    53,    37,
+      27,    33,    61,    61,    43,    67,    45,    63,    27,    27,
+      27,    34,    33,    41,    27,    54,    27,    33
 };
 
-  /* YYR1[YYN] -- Symbol number of symbol that rule YYN derives.  */
-static const yytype_uint8 yyr1[] =
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr1[] =
 {
-       0,    39,    40,    40,    41,    41,    42,    42,    43,    43,
-      43,    44,    45,    45,    45,    45,    45,    45,    45,    46,
-      46,    46,    46,    47,    47,    47,    48,    48,    49,    50,
-      50,    51,    52,    53,    53,    54,    54,    55,    55,    55,
-      55,    55,    55,    56,    56,    56,    57,    57,    58,    58
+       0,    46,    47,    47,    48,    48,    49,    49,    50,    50,
+      50,    51,    52,    52,    52,    52,    52,    52,    52,    52,
+      52,    52,    52,    52,    53,    53,    54,    55,    55,    55,
+      55,    56,    56,    56,    57,    57,    58,    59,    59,    60,
+      61,    62,    62,    63,    63,    64,    64,    64,    64,    64,
+      64,    65,    65,    65,    66,    66,    67,    67
 };
 
-  /* YYR2[YYN] -- Number of symbols on the right hand side of rule YYN.  */
-static const yytype_uint8 yyr2[] =
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr2[] =
 {
        0,     2,     1,     2,     1,     2,     1,     2,     1,     3,
-       3,     1,     1,     1,     2,     4,     4,     4,     2,     3,
-       3,     3,     3,     1,     2,     2,     1,     2,     3,     1,
-       1,     3,     1,     1,     3,     1,     2,     1,     2,     2,
-       2,     4,     6,     1,     3,     3,     1,     2,     1,     1
+       3,     1,     1,     1,     3,     3,     4,     4,     3,     2,
+       4,     4,     4,     2,     1,     3,     1,     3,     3,     3,
+       3,     1,     2,     2,     1,     2,     3,     1,     1,     3,
+       1,     1,     3,     1,     2,     1,     2,     2,     2,     4,
+       6,     1,     3,     3,     1,     2,     1,     1
 };
 
 
+enum { YYENOMEM = -2 };
+
 #define yyerrok         (yyerrstatus = 0)
 #define yyclearin       (yychar = YYEMPTY)
-#define YYEMPTY         (-2)
-#define YYEOF           0
 
 #define YYACCEPT        goto yyacceptlab
 #define YYABORT         goto yyabortlab
 #define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
 
 
 #define YYRECOVERING()  (!!yyerrstatus)
 
-#define YYBACKUP(Token, Value)                                  \
-do                                                              \
-  if (yychar == YYEMPTY)                                        \
-    {                                                           \
-      yychar = (Token);                                         \
-      yylval = (Value);                                         \
-      YYPOPSTACK (yylen);                                       \
-      yystate = *yyssp;                                         \
-      goto yybackup;                                            \
-    }                                                           \
-  else                                                          \
-    {                                                           \
-      yyerror (param, YY_("syntax error: cannot back up")); \
-      YYERROR;                                                  \
-    }                                                           \
-while (0)
-
-/* Error token number */
-#define YYTERROR        1
-#define YYERRCODE       256
-
+#define YYBACKUP(Token, Value)                                    \
+  do                                                              \
+    if (yychar == YYEMPTY)                                        \
+      {                                                           \
+        yychar = (Token);                                         \
+        yylval = (Value);                                         \
+        YYPOPSTACK (yylen);                                       \
+        yystate = *yyssp;                                         \
+        goto yybackup;                                            \
+      }                                                           \
+    else                                                          \
+      {                                                           \
+        yyerror (param, YY_("syntax error: cannot back up")); \
+        YYERROR;                                                  \
+      }                                                           \
+  while (0)
+
+/* Backward compatibility with an undocumented macro.
+   Use YYerror or YYUNDEF. */
+#define YYERRCODE YYUNDEF
 
 
 /* Enable debugging if requested.  */
@@ -707,56 +798,53 @@ do {                                            \
     YYFPRINTF Args;                             \
 } while (0)
 
-/* This macro is provided for backward compatibility. */
-#ifndef YY_LOCATION_PRINT
-# define YY_LOCATION_PRINT(File, Loc) ((void) 0)
-#endif
 
 
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)                    \
+
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
 do {                                                                      \
   if (yydebug)                                                            \
     {                                                                     \
       YYFPRINTF (stderr, "%s ", Title);                                   \
       yy_symbol_print (stderr,                                            \
-                  Type, Value, param); \
+                  Kind, Value, param); \
       YYFPRINTF (stderr, "\n");                                           \
     }                                                                     \
 } while (0)
 
 
-/*----------------------------------------.
-| Print this symbol's value on YYOUTPUT.  |
-`----------------------------------------*/
+/*-----------------------------------.
+| Print this symbol's value on YYO.  |
+`-----------------------------------*/
 
 static void
-yy_symbol_value_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep, tk_expr_t **param)
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, tk_expr_t **param)
 {
-  FILE *yyo = yyoutput;
-  YYUSE (yyo);
-  YYUSE (param);
+  FILE *yyoutput = yyo;
+  YY_USE (yyoutput);
+  YY_USE (param);
   if (!yyvaluep)
     return;
-# ifdef YYPRINT
-  if (yytype < YYNTOKENS)
-    YYPRINT (yyoutput, yytoknum[yytype], *yyvaluep);
-# endif
-  YYUSE (yytype);
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
 
-/*--------------------------------.
-| Print this symbol on YYOUTPUT.  |
-`--------------------------------*/
+/*---------------------------.
+| Print this symbol on YYO.  |
+`---------------------------*/
 
 static void
-yy_symbol_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep, tk_expr_t **param)
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, tk_expr_t **param)
 {
-  YYFPRINTF (yyoutput, "%s %s (",
-             yytype < YYNTOKENS ? "token" : "nterm", yytname[yytype]);
+  YYFPRINTF (yyo, "%s %s (",
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
 
-  yy_symbol_value_print (yyoutput, yytype, yyvaluep, param);
-  YYFPRINTF (yyoutput, ")");
+  yy_symbol_value_print (yyo, yykind, yyvaluep, param);
+  YYFPRINTF (yyo, ")");
 }
 
 /*------------------------------------------------------------------.
@@ -765,7 +853,7 @@ yy_symbol_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep, tk_
 `------------------------------------------------------------------*/
 
 static void
-yy_stack_print (yytype_int16 *yybottom, yytype_int16 *yytop)
+yy_stack_print (yy_state_t *yybottom, yy_state_t *yytop)
 {
   YYFPRINTF (stderr, "Stack now");
   for (; yybottom <= yytop; yybottom++)
@@ -788,21 +876,21 @@ do {                                                            \
 `------------------------------------------------*/
 
 static void
-yy_reduce_print (yytype_int16 *yyssp, YYSTYPE *yyvsp, int yyrule, tk_expr_t **param)
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
+                 int yyrule, tk_expr_t **param)
 {
-  unsigned long int yylno = yyrline[yyrule];
+  int yylno = yyrline[yyrule];
   int yynrhs = yyr2[yyrule];
   int yyi;
-  YYFPRINTF (stderr, "Reducing stack by rule %d (line %lu):\n",
+  YYFPRINTF (stderr, "Reducing stack by rule %d (line %d):\n",
              yyrule - 1, yylno);
   /* The symbols being reduced.  */
   for (yyi = 0; yyi < yynrhs; yyi++)
     {
       YYFPRINTF (stderr, "   $%d = ", yyi + 1);
       yy_symbol_print (stderr,
-                       yystos[yyssp[yyi + 1 - yynrhs]],
-                       &(yyvsp[(yyi + 1) - (yynrhs)])
-                                              , param);
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)], param);
       YYFPRINTF (stderr, "\n");
     }
 }
@@ -817,8 +905,8 @@ do {                                    \
    multiple parsers can coexist.  */
 int yydebug;
 #else /* !YYDEBUG */
-# define YYDPRINTF(Args)
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
 # define YY_STACK_PRINT(Bottom, Top)
 # define YY_REDUCE_PRINT(Rule)
 #endif /* !YYDEBUG */
@@ -841,250 +929,31 @@ int yydebug;
 #endif
 
 
-#if YYERROR_VERBOSE
-
-# ifndef yystrlen
-#  if defined __GLIBC__ && defined _STRING_H
-#   define yystrlen strlen
-#  else
-/* Return the length of YYSTR.  */
-static YYSIZE_T
-yystrlen (const char *yystr)
-{
-  YYSIZE_T yylen;
-  for (yylen = 0; yystr[yylen]; yylen++)
-    continue;
-  return yylen;
-}
-#  endif
-# endif
-
-# ifndef yystpcpy
-#  if defined __GLIBC__ && defined _STRING_H && defined _GNU_SOURCE
-#   define yystpcpy stpcpy
-#  else
-/* Copy YYSRC to YYDEST, returning the address of the terminating '\0' in
-   YYDEST.  */
-static char *
-yystpcpy (char *yydest, const char *yysrc)
-{
-  char *yyd = yydest;
-  const char *yys = yysrc;
-
-  while ((*yyd++ = *yys++) != '\0')
-    continue;
-
-  return yyd - 1;
-}
-#  endif
-# endif
-
-# ifndef yytnamerr
-/* Copy to YYRES the contents of YYSTR after stripping away unnecessary
-   quotes and backslashes, so that it's suitable for yyerror.  The
-   heuristic is that double-quoting is unnecessary unless the string
-   contains an apostrophe, a comma, or backslash (other than
-   backslash-backslash).  YYSTR is taken from yytname.  If YYRES is
-   null, do not copy; instead, return the length of what the result
-   would have been.  */
-static YYSIZE_T
-yytnamerr (char *yyres, const char *yystr)
-{
-  if (*yystr == '"')
-    {
-      YYSIZE_T yyn = 0;
-      char const *yyp = yystr;
-
-      for (;;)
-        switch (*++yyp)
-          {
-          case '\'':
-          case ',':
-            goto do_not_strip_quotes;
-
-          case '\\':
-            if (*++yyp != '\\')
-              goto do_not_strip_quotes;
-            /* Fall through.  */
-          default:
-            if (yyres)
-              yyres[yyn] = *yyp;
-            yyn++;
-            break;
-
-          case '"':
-            if (yyres)
-              yyres[yyn] = '\0';
-            return yyn;
-          }
-    do_not_strip_quotes: ;
-    }
-
-  if (! yyres)
-    return yystrlen (yystr);
-
-  return yystpcpy (yyres, yystr) - yyres;
-}
-# endif
 
-/* Copy into *YYMSG, which is of size *YYMSG_ALLOC, an error message
-   about the unexpected token YYTOKEN for the state stack whose top is
-   YYSSP.
-
-   Return 0 if *YYMSG was successfully written.  Return 1 if *YYMSG is
-   not large enough to hold the message.  In that case, also set
-   *YYMSG_ALLOC to the required number of bytes.  Return 2 if the
-   required number of bytes is too large to store.  */
-static int
-yysyntax_error (YYSIZE_T *yymsg_alloc, char **yymsg,
-                yytype_int16 *yyssp, int yytoken)
-{
-  YYSIZE_T yysize0 = yytnamerr (YY_NULLPTR, yytname[yytoken]);
-  YYSIZE_T yysize = yysize0;
-  enum { YYERROR_VERBOSE_ARGS_MAXIMUM = 5 };
-  /* Internationalized format string. */
-  const char *yyformat = YY_NULLPTR;
-  /* Arguments of yyformat. */
-  char const *yyarg[YYERROR_VERBOSE_ARGS_MAXIMUM];
-  /* Number of reported tokens (one for the "unexpected", one per
-     "expected"). */
-  int yycount = 0;
-
-  /* There are many possibilities here to consider:
-     - If this state is a consistent state with a default action, then
-       the only way this function was invoked is if the default action
-       is an error action.  In that case, don't check for expected
-       tokens because there are none.
-     - The only way there can be no lookahead present (in yychar) is if
-       this state is a consistent state with a default action.  Thus,
-       detecting the absence of a lookahead is sufficient to determine
-       that there is no unexpected or expected token to report.  In that
-       case, just report a simple "syntax error".
-     - Don't assume there isn't a lookahead just because this state is a
-       consistent state with a default action.  There might have been a
-       previous inconsistent state, consistent state with a non-default
-       action, or user semantic action that manipulated yychar.
-     - Of course, the expected token list depends on states to have
-       correct lookahead information, and it depends on the parser not
-       to perform extra reductions after fetching a lookahead from the
-       scanner and before detecting a syntax error.  Thus, state merging
-       (from LALR or IELR) and default reductions corrupt the expected
-       token list.  However, the list is correct for canonical LR with
-       one exception: it will still contain any token that will not be
-       accepted due to an error action in a later state.
-  */
-  if (yytoken != YYEMPTY)
-    {
-      int yyn = yypact[*yyssp];
-      yyarg[yycount++] = yytname[yytoken];
-      if (!yypact_value_is_default (yyn))
-        {
-          /* Start YYX at -YYN if negative to avoid negative indexes in
-             YYCHECK.  In other words, skip the first -YYN actions for
-             this state because they are default actions.  */
-          int yyxbegin = yyn < 0 ? -yyn : 0;
-          /* Stay within bounds of both yycheck and yytname.  */
-          int yychecklim = YYLAST - yyn + 1;
-          int yyxend = yychecklim < YYNTOKENS ? yychecklim : YYNTOKENS;
-          int yyx;
-
-          for (yyx = yyxbegin; yyx < yyxend; ++yyx)
-            if (yycheck[yyx + yyn] == yyx && yyx != YYTERROR
-                && !yytable_value_is_error (yytable[yyx + yyn]))
-              {
-                if (yycount == YYERROR_VERBOSE_ARGS_MAXIMUM)
-                  {
-                    yycount = 1;
-                    yysize = yysize0;
-                    break;
-                  }
-                yyarg[yycount++] = yytname[yyx];
-                {
-                  YYSIZE_T yysize1 = yysize + yytnamerr (YY_NULLPTR, yytname[yyx]);
-                  if (! (yysize <= yysize1
-                         && yysize1 <= YYSTACK_ALLOC_MAXIMUM))
-                    return 2;
-                  yysize = yysize1;
-                }
-              }
-        }
-    }
-
-  switch (yycount)
-    {
-# define YYCASE_(N, S)                      \
-      case N:                               \
-        yyformat = S;                       \
-      break
-      YYCASE_(0, YY_("syntax error"));
-      YYCASE_(1, YY_("syntax error, unexpected %s"));
-      YYCASE_(2, YY_("syntax error, unexpected %s, expecting %s"));
-      YYCASE_(3, YY_("syntax error, unexpected %s, expecting %s or %s"));
-      YYCASE_(4, YY_("syntax error, unexpected %s, expecting %s or %s or %s"));
-      YYCASE_(5, YY_("syntax error, unexpected %s, expecting %s or %s or %s or %s"));
-# undef YYCASE_
-    }
-
-  {
-    YYSIZE_T yysize1 = yysize + yystrlen (yyformat);
-    if (! (yysize <= yysize1 && yysize1 <= YYSTACK_ALLOC_MAXIMUM))
-      return 2;
-    yysize = yysize1;
-  }
 
-  if (*yymsg_alloc < yysize)
-    {
-      *yymsg_alloc = 2 * yysize;
-      if (! (yysize <= *yymsg_alloc
-             && *yymsg_alloc <= YYSTACK_ALLOC_MAXIMUM))
-        *yymsg_alloc = YYSTACK_ALLOC_MAXIMUM;
-      return 1;
-    }
 
-  /* Avoid sprintf, as that infringes on the user's name space.
-     Don't have undefined behavior even if the translation
-     produced a string with the wrong number of "%s"s.  */
-  {
-    char *yyp = *yymsg;
-    int yyi = 0;
-    while ((*yyp = *yyformat) != '\0')
-      if (*yyp == '%' && yyformat[1] == 's' && yyi < yycount)
-        {
-          yyp += yytnamerr (yyp, yyarg[yyi++]);
-          yyformat += 2;
-        }
-      else
-        {
-          yyp++;
-          yyformat++;
-        }
-  }
-  return 0;
-}
-#endif /* YYERROR_VERBOSE */
 
 /*-----------------------------------------------.
 | Release the memory associated to this symbol.  |
 `-----------------------------------------------*/
 
 static void
-yydestruct (const char *yymsg, int yytype, YYSTYPE *yyvaluep, tk_expr_t **param)
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep, tk_expr_t **param)
 {
-  YYUSE (yyvaluep);
-  YYUSE (param);
+  YY_USE (yyvaluep);
+  YY_USE (param);
   if (!yymsg)
     yymsg = "Deleting";
-  YY_SYMBOL_PRINT (yymsg, yytype, yyvaluep, yylocationp);
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
 
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
-  YYUSE (yytype);
+  YY_USE (yykind);
   YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
 
-
-
-/* The lookahead symbol.  */
+/* Lookahead token kind.  */
 int yychar;
 
 /* The semantic value of the lookahead symbol.  */
@@ -1093,6 +962,8 @@ YYSTYPE yylval;
 int yynerrs;
 
 
+
+
 /*----------.
 | yyparse.  |
 `----------*/
@@ -1100,43 +971,36 @@ int yynerrs;
 int
 yyparse (tk_expr_t **param)
 {
-    int yystate;
+    yy_state_fast_t yystate = 0;
     /* Number of tokens to shift before error messages enabled.  */
-    int yyerrstatus;
-
-    /* The stacks and their tools:
-       'yyss': related to states.
-       'yyvs': related to semantic values.
+    int yyerrstatus = 0;
 
-       Refer to the stacks through separate pointers, to allow yyoverflow
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
        to reallocate them elsewhere.  */
 
-    /* The state stack.  */
-    yytype_int16 yyssa[YYINITDEPTH];
-    yytype_int16 *yyss;
-    yytype_int16 *yyssp;
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
 
-    /* The semantic value stack.  */
-    YYSTYPE yyvsa[YYINITDEPTH];
-    YYSTYPE *yyvs;
-    YYSTYPE *yyvsp;
+    /* The state stack: array, bottom, top.  */
+    yy_state_t yyssa[YYINITDEPTH];
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
 
-    YYSIZE_T yystacksize;
+    /* The semantic value stack: array, bottom, top.  */
+    YYSTYPE yyvsa[YYINITDEPTH];
+    YYSTYPE *yyvs = yyvsa;
+    YYSTYPE *yyvsp = yyvs;
 
   int yyn;
+  /* The return value of yyparse.  */
   int yyresult;
-  /* Lookahead token as an internal (translated) token number.  */
-  int yytoken = 0;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
   /* The variables used to return semantic value and location from the
      action routines.  */
   YYSTYPE yyval;
 
-#if YYERROR_VERBOSE
-  /* Buffer for error messages, and its allocated size.  */
-  char yymsgbuf[128];
-  char *yymsg = yymsgbuf;
-  YYSIZE_T yymsg_alloc = sizeof yymsgbuf;
-#endif
+
 
 #define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
 
@@ -1144,71 +1008,75 @@ yyparse (tk_expr_t **param)
      Keep to zero when no symbol should be popped.  */
   int yylen = 0;
 
-  yyssp = yyss = yyssa;
-  yyvsp = yyvs = yyvsa;
-  yystacksize = YYINITDEPTH;
-
   YYDPRINTF ((stderr, "Starting parse\n"));
 
-  yystate = 0;
-  yyerrstatus = 0;
-  yynerrs = 0;
   yychar = YYEMPTY; /* Cause a token to be read.  */
+
   goto yysetstate;
 
+
 /*------------------------------------------------------------.
-| yynewstate -- Push a new state, which is found in yystate.  |
+| yynewstate -- push a new state, which is found in yystate.  |
 `------------------------------------------------------------*/
- yynewstate:
+yynewstate:
   /* In all cases, when you get here, the value and location stacks
      have just been pushed.  So pushing a state here evens the stacks.  */
   yyssp++;
 
- yysetstate:
-  *yyssp = yystate;
+
+/*--------------------------------------------------------------------.
+| yysetstate -- set current state (the top of the stack) to yystate.  |
+`--------------------------------------------------------------------*/
+yysetstate:
+  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+  YY_ASSERT (0 <= yystate && yystate < YYNSTATES);
+  YY_IGNORE_USELESS_CAST_BEGIN
+  *yyssp = YY_CAST (yy_state_t, yystate);
+  YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
 
   if (yyss + yystacksize - 1 <= yyssp)
+#if !defined yyoverflow && !defined YYSTACK_RELOCATE
+    YYNOMEM;
+#else
     {
       /* Get the current used size of the three stacks, in elements.  */
-      YYSIZE_T yysize = yyssp - yyss + 1;
+      YYPTRDIFF_T yysize = yyssp - yyss + 1;
 
-#ifdef yyoverflow
+# if defined yyoverflow
       {
         /* Give user a chance to reallocate the stack.  Use copies of
            these so that the &'s don't force the real ones into
            memory.  */
+        yy_state_t *yyss1 = yyss;
         YYSTYPE *yyvs1 = yyvs;
-        yytype_int16 *yyss1 = yyss;
 
         /* Each stack pointer address is followed by the size of the
            data in use in that stack, in bytes.  This used to be a
            conditional around just the two extra args, but that might
            be undefined if yyoverflow is a macro.  */
         yyoverflow (YY_("memory exhausted"),
-                    &yyss1, yysize * sizeof (*yyssp),
-                    &yyvs1, yysize * sizeof (*yyvsp),
+                    &yyss1, yysize * YYSIZEOF (*yyssp),
+                    &yyvs1, yysize * YYSIZEOF (*yyvsp),
                     &yystacksize);
-
         yyss = yyss1;
         yyvs = yyvs1;
       }
-#else /* no yyoverflow */
-# ifndef YYSTACK_RELOCATE
-      goto yyexhaustedlab;
-# else
+# else /* defined YYSTACK_RELOCATE */
       /* Extend the stack our own way.  */
       if (YYMAXDEPTH <= yystacksize)
-        goto yyexhaustedlab;
+        YYNOMEM;
       yystacksize *= 2;
       if (YYMAXDEPTH < yystacksize)
         yystacksize = YYMAXDEPTH;
 
       {
-        yytype_int16 *yyss1 = yyss;
+        yy_state_t *yyss1 = yyss;
         union yyalloc *yyptr =
-          (union yyalloc *) YYSTACK_ALLOC (YYSTACK_BYTES (yystacksize));
+          YY_CAST (union yyalloc *,
+                   YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
         if (! yyptr)
-          goto yyexhaustedlab;
+          YYNOMEM;
         YYSTACK_RELOCATE (yyss_alloc, yyss);
         YYSTACK_RELOCATE (yyvs_alloc, yyvs);
 #  undef YYSTACK_RELOCATE
@@ -1216,30 +1084,31 @@ yyparse (tk_expr_t **param)
           YYSTACK_FREE (yyss1);
       }
 # endif
-#endif /* no yyoverflow */
 
       yyssp = yyss + yysize - 1;
       yyvsp = yyvs + yysize - 1;
 
-      YYDPRINTF ((stderr, "Stack size increased to %lu\n",
-                  (unsigned long int) yystacksize));
+      YY_IGNORE_USELESS_CAST_BEGIN
+      YYDPRINTF ((stderr, "Stack size increased to %ld\n",
+                  YY_CAST (long, yystacksize)));
+      YY_IGNORE_USELESS_CAST_END
 
       if (yyss + yystacksize - 1 <= yyssp)
         YYABORT;
     }
+#endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
 
-  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
 
   if (yystate == YYFINAL)
     YYACCEPT;
 
   goto yybackup;
 
+
 /*-----------.
 | yybackup.  |
 `-----------*/
 yybackup:
-
   /* Do appropriate processing given the current state.  Read a
      lookahead token if we need one and don't already have one.  */
 
@@ -1250,18 +1119,29 @@ yybackup:
 
   /* Not known => get a lookahead token if don't already have one.  */
 
-  /* YYCHAR is either YYEMPTY or YYEOF or a valid lookahead symbol.  */
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
   if (yychar == YYEMPTY)
     {
-      YYDPRINTF ((stderr, "Reading a token: "));
+      YYDPRINTF ((stderr, "Reading a token\n"));
       yychar = yylex ();
     }
 
-  if (yychar <= YYEOF)
+  if (yychar <= END)
     {
-      yychar = yytoken = YYEOF;
+      yychar = END;
+      yytoken = YYSYMBOL_YYEOF;
       YYDPRINTF ((stderr, "Now at end of input.\n"));
     }
+  else if (yychar == YYerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = YYUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      goto yyerrlab1;
+    }
   else
     {
       yytoken = YYTRANSLATE (yychar);
@@ -1289,15 +1169,13 @@ yybackup:
 
   /* Shift the lookahead token.  */
   YY_SYMBOL_PRINT ("Shifting", yytoken, &yylval, &yylloc);
-
-  /* Discard the shifted token.  */
-  yychar = YYEMPTY;
-
   yystate = yyn;
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
   *++yyvsp = yylval;
   YY_IGNORE_MAYBE_UNINITIALIZED_END
 
+  /* Discard the shifted token.  */
+  yychar = YYEMPTY;
   goto yynewstate;
 
 
@@ -1312,7 +1190,7 @@ yydefault:
 
 
 /*-----------------------------.
-| yyreduce -- Do a reduction.  |
+| yyreduce -- do a reduction.  |
 `-----------------------------*/
 yyreduce:
   /* yyn is the number of a rule to reduce with.  */
@@ -1332,45 +1210,45 @@ yyreduce:
   YY_REDUCE_PRINT (yyn);
   switch (yyn)
     {
-        case 2:
-#line 75 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 2: /* Grammar: "end of expression"  */
+#line 87 "tcpkali_expr_y.y"
+        {
         tk_expr_t *expr = calloc(1, sizeof(tk_expr_t));
         expr->type = EXPR_DATA;
         *(tk_expr_t **)param = expr;
         return 0;
     }
-#line 1344 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1222 "tcpkali_expr_y.c"
     break;
 
-  case 3:
-#line 81 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 3: /* Grammar: ByteSequencesAndExpressions "end of expression"  */
+#line 93 "tcpkali_expr_y.y"
+                                      {
         *(tk_expr_t **)param = (yyvsp[-1].tv_expr);
         return 0;
     }
-#line 1353 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1231 "tcpkali_expr_y.c"
     break;
 
-  case 4:
-#line 87 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 4: /* ByteSequencesAndExpressions: ByteSequenceOrExpr  */
+#line 99 "tcpkali_expr_y.y"
+                       {
         (yyval.tv_expr) = (yyvsp[0].tv_expr);
     }
-#line 1361 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1239 "tcpkali_expr_y.c"
     break;
 
-  case 5:
-#line 90 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 5: /* ByteSequencesAndExpressions: ByteSequenceOrExpr ByteSequencesAndExpressions  */
+#line 102 "tcpkali_expr_y.y"
+                                                     {
         (yyval.tv_expr) = concat_expressions((yyvsp[-1].tv_expr), (yyvsp[0].tv_expr));
     }
-#line 1369 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1247 "tcpkali_expr_y.c"
     break;
 
-  case 7:
-#line 96 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 7: /* String: String "arbitrary string"  */
+#line 108 "tcpkali_expr_y.y"
+                          {
         size_t len = (((yyvsp[-1].tv_string)).len + ((yyvsp[0].tv_string)).len);
         char *p = malloc(len + 1);
         memcpy(p, ((yyvsp[-1].tv_string)).buf, ((yyvsp[-1].tv_string)).len);
@@ -1379,12 +1257,12 @@ yyreduce:
         (yyval.tv_string).buf = p;
         (yyval.tv_string).len = len;
     }
-#line 1383 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1261 "tcpkali_expr_y.c"
     break;
 
-  case 8:
-#line 107 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 8: /* ByteSequenceOrExpr: String  */
+#line 119 "tcpkali_expr_y.y"
+           {
         /* If there's nothing to parse, don't return anything */
         tk_expr_t *expr = calloc(1, sizeof(tk_expr_t));
         expr->type = EXPR_DATA;
@@ -1393,28 +1271,28 @@ yyreduce:
         expr->estimate_size = ((yyvsp[0].tv_string)).len;
         (yyval.tv_expr) = expr;
     }
-#line 1397 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1275 "tcpkali_expr_y.c"
     break;
 
-  case 9:
-#line 116 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 9: /* ByteSequenceOrExpr: '{' WSExpression '}'  */
+#line 128 "tcpkali_expr_y.y"
+                           {
         (yyval.tv_expr) = (yyvsp[-1].tv_expr);
     }
-#line 1405 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1283 "tcpkali_expr_y.c"
     break;
 
-  case 10:
-#line 119 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 10: /* ByteSequenceOrExpr: '{' NonWSExpression '}'  */
+#line 131 "tcpkali_expr_y.y"
+                              {
         (yyval.tv_expr) = (yyvsp[-1].tv_expr);
     }
-#line 1413 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1291 "tcpkali_expr_y.c"
     break;
 
-  case 12:
-#line 126 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {    /* \{<filename.txt>} */
+  case 12: /* NonWSExpression: File  */
+#line 138 "tcpkali_expr_y.y"
+         {    /* \{<filename.txt>} */
         tk_expr_t *expr = calloc(1, sizeof(tk_expr_t));
         expr->type = EXPR_DATA;
         expr->u.data.data = ((yyvsp[0].tv_string)).buf;
@@ -1422,20 +1300,105 @@ yyreduce:
         expr->estimate_size = ((yyvsp[0].tv_string)).len;
         (yyval.tv_expr) = expr;
     }
-#line 1426 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1304 "tcpkali_expr_y.c"
     break;
 
-  case 13:
-#line 134 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 13: /* NonWSExpression: NumericExpr  */
+#line 146 "tcpkali_expr_y.y"
+                  {
         (yyval.tv_expr) = (yyvsp[0].tv_expr);
     }
-#line 1434 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1312 "tcpkali_expr_y.c"
     break;
 
-  case 14:
-#line 137 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 14: /* NonWSExpression: "message" '.' "seq"  */
+#line 150 "tcpkali_expr_y.y"
+                              {
+        (yyval.tv_expr) = calloc(1, sizeof(*((yyval.tv_expr))));
+        (yyval.tv_expr)->type = EXPR_MESSAGE_SEQ;
+        (yyval.tv_expr)->estimate_size = EXPR_MESSAGE_SEQ_WIDTH;
+        (yyval.tv_expr)->dynamic_scope = DS_MESSAGE_SLOTS;
+    }
+#line 1323 "tcpkali_expr_y.c"
+    break;
+
+  case 15: /* NonWSExpression: "time" '.' "us"  */
+#line 156 "tcpkali_expr_y.y"
+                          {
+        (yyval.tv_expr) = calloc(1, sizeof(*((yyval.tv_expr))));
+        (yyval.tv_expr)->type = EXPR_TIME_US;
+        (yyval.tv_expr)->estimate_size = EXPR_TIME_US_WIDTH;
+        (yyval.tv_expr)->dynamic_scope = DS_MESSAGE_SLOTS;
+    }
+#line 1334 "tcpkali_expr_y.c"
+    break;
+
+  case 16: /* NonWSExpression: "random" '.' "bytes" integer  */
+#line 162 "tcpkali_expr_y.y"
+                                       {
+        if((yyvsp[0].tv_long) <= 0 || (yyvsp[0].tv_long) > EXPR_RANDOM_MAX_SIZE) {
+            fprintf(stderr, "\\{random.bytes %ld} size is out of range\n",
+                    (yyvsp[0].tv_long));
+            YYABORT;
+        }
+        (yyval.tv_expr) = calloc(1, sizeof(*((yyval.tv_expr))));
+        (yyval.tv_expr)->type = EXPR_RANDOM;
+        (yyval.tv_expr)->u.random.size = (yyvsp[0].tv_long);
+        (yyval.tv_expr)->estimate_size = (yyvsp[0].tv_long);
+        (yyval.tv_expr)->dynamic_scope = DS_PER_MESSAGE;
+    }
+#line 1351 "tcpkali_expr_y.c"
+    break;
+
+  case 17: /* NonWSExpression: "random" '.' "alnum" integer  */
+#line 174 "tcpkali_expr_y.y"
+                                       {
+        if((yyvsp[0].tv_long) <= 0 || (yyvsp[0].tv_long) > EXPR_RANDOM_MAX_SIZE) {
+            fprintf(stderr, "\\{random.alnum %ld} size is out of range\n",
+                    (yyvsp[0].tv_long));
+            YYABORT;
+        }
+        (yyval.tv_expr) = calloc(1, sizeof(*((yyval.tv_expr))));
+        (yyval.tv_expr)->type = EXPR_RANDOM;
+        (yyval.tv_expr)->u.random.size = (yyvsp[0].tv_long);
+        (yyval.tv_expr)->u.random.alnum = 1;
+        (yyval.tv_expr)->estimate_size = (yyvsp[0].tv_long);
+        (yyval.tv_expr)->dynamic_scope = DS_PER_MESSAGE;
+    }
+#line 1369 "tcpkali_expr_y.c"
+    break;
+
+  case 18: /* NonWSExpression: "zipf" integer Number  */
+#line 187 "tcpkali_expr_y.y"
+                              {
+        if((yyvsp[-1].tv_long) <= 0 || (yyvsp[-1].tv_long) > EXPR_ZIPF_MAX_KEYS || !((yyvsp[0].tv_double) >= 0.0 && (yyvsp[0].tv_double) <= 100.0)) {
+            fprintf(stderr, "\\{zipf %ld %g} keys or exponent "
+                    "is out of range\n", (yyvsp[-1].tv_long), (yyvsp[0].tv_double));
+            YYABORT;
+        }
+        /* The key k is drawn with the weight of 1/(k+1)^s. */
+        double *weights = malloc((yyvsp[-1].tv_long) * sizeof(weights[0]));
+        assert(weights);
+        double total = 0.0, digits = 0.0;
+        for(long k = 0; k < (yyvsp[-1].tv_long); k++) {
+            weights[k] = pow(k + 1, -(yyvsp[0].tv_double));
+            total += weights[k];
+            digits += weights[k] * (k ? floor(log10(k)) + 1 : 1);
+        }
+        (yyval.tv_expr) = calloc(1, sizeof(*((yyval.tv_expr))));
+        (yyval.tv_expr)->type = EXPR_ZIPF;
+        (yyval.tv_expr)->u.zipf.table = tk_alias_table_new(weights, (yyvsp[-1].tv_long));
+        (yyval.tv_expr)->u.zipf.avg_size = round(digits / total);
+        (yyval.tv_expr)->estimate_size = snprintf(NULL, 0, "%ld", (yyvsp[-1].tv_long) - 1);
+        (yyval.tv_expr)->dynamic_scope = DS_PER_MESSAGE;
+        free(weights);
+    }
+#line 1397 "tcpkali_expr_y.c"
+    break;
+
+  case 19: /* NonWSExpression: "raw" FileOrQuoted  */
+#line 210 "tcpkali_expr_y.y"
+                           {
         tk_expr_t *expr = calloc(1, sizeof(tk_expr_t));
         expr->type = EXPR_DATA;
         expr->u.data.data = ((yyvsp[0].tv_string)).buf;
@@ -1446,24 +1409,24 @@ yyreduce:
         (yyval.tv_expr)->u.raw.expr = expr;
         (yyval.tv_expr)->estimate_size = expr->estimate_size;
     }
-#line 1450 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1413 "tcpkali_expr_y.c"
     break;
 
-  case 15:
-#line 148 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 20: /* NonWSExpression: "raw" '{' NonWSExpression '}'  */
+#line 221 "tcpkali_expr_y.y"
+                                      {
         (yyval.tv_expr) = calloc(1, sizeof(tk_expr_t));
         (yyval.tv_expr)->type = EXPR_RAW;
         (yyval.tv_expr)->u.raw.expr = (yyvsp[-1].tv_expr);
         (yyval.tv_expr)->estimate_size = (yyvsp[-1].tv_expr)->estimate_size;
         (yyval.tv_expr)->dynamic_scope = (yyvsp[-1].tv_expr)->dynamic_scope;
     }
-#line 1462 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1425 "tcpkali_expr_y.c"
     break;
 
-  case 16:
-#line 155 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 21: /* NonWSExpression: "global" '.' "re" CompleteRegex  */
+#line 228 "tcpkali_expr_y.y"
+                                             {
         tk_expr_t *expr = calloc(1, sizeof(tk_expr_t));
         expr->type = EXPR_DATA;
         char *data = malloc(tregex_max_size((yyvsp[0].tv_regex)) + 1);
@@ -1474,12 +1437,12 @@ yyreduce:
         tregex_free((yyvsp[0].tv_regex));
         (yyval.tv_expr) = expr;
     }
-#line 1478 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1441 "tcpkali_expr_y.c"
     break;
 
-  case 17:
-#line 166 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 22: /* NonWSExpression: "connection" '.' "re" CompleteRegex  */
+#line 239 "tcpkali_expr_y.y"
+                                                 {
         tk_expr_t *expr = calloc(1, sizeof(tk_expr_t));
         expr->type = EXPR_REGEX;
         expr->u.regex.re = (yyvsp[0].tv_regex);
@@ -1487,12 +1450,12 @@ yyreduce:
         expr->dynamic_scope = DS_PER_CONNECTION;
         (yyval.tv_expr) = expr;
     }
-#line 1491 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1454 "tcpkali_expr_y.c"
     break;
 
-  case 18:
-#line 174 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 23: /* NonWSExpression: "re" CompleteRegex  */
+#line 247 "tcpkali_expr_y.y"
+                              {
         tk_expr_t *expr = calloc(1, sizeof(tk_expr_t));
         expr->type = EXPR_REGEX;
         expr->u.regex.re = (yyvsp[0].tv_regex);
@@ -1500,12 +1463,30 @@ yyreduce:
         expr->dynamic_scope = DS_PER_MESSAGE;
         (yyval.tv_expr) = expr;
     }
-#line 1504 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1467 "tcpkali_expr_y.c"
     break;
 
-  case 19:
-#line 184 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 24: /* Number: integer  */
+#line 257 "tcpkali_expr_y.y"
+            { (yyval.tv_double) = (yyvsp[0].tv_long); }
+#line 1473 "tcpkali_expr_y.c"
+    break;
+
+  case 25: /* Number: integer '.' Fraction  */
+#line 258 "tcpkali_expr_y.y"
+                           { (yyval.tv_double) = (yyvsp[-2].tv_long) + (yyvsp[0].tv_double); }
+#line 1479 "tcpkali_expr_y.c"
+    break;
+
+  case 26: /* Fraction: integer  */
+#line 262 "tcpkali_expr_y.y"
+            { (yyval.tv_double) = (yyvsp[0].tv_long) / pow(10, expr_integer_digits); }
+#line 1485 "tcpkali_expr_y.c"
+    break;
+
+  case 27: /* NumericExpr: NumericExpr '%' integer  */
+#line 265 "tcpkali_expr_y.y"
+                            {
         (yyval.tv_expr) = calloc(1, sizeof(*((yyval.tv_expr))));
         (yyval.tv_expr)->type = EXPR_MODULO;
         (yyval.tv_expr)->u.modulo.expr = (yyvsp[-2].tv_expr);
@@ -1513,63 +1494,63 @@ yyreduce:
         (yyval.tv_expr)->estimate_size = (yyvsp[-2].tv_expr)->estimate_size;
         (yyval.tv_expr)->dynamic_scope = (yyvsp[-2].tv_expr)->dynamic_scope;
     }
-#line 1517 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1498 "tcpkali_expr_y.c"
     break;
 
-  case 20:
-#line 192 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 28: /* NumericExpr: "connection" '.' " ptr"  */
+#line 273 "tcpkali_expr_y.y"
+                                 {
         (yyval.tv_expr) = calloc(1, sizeof(*((yyval.tv_expr))));
         (yyval.tv_expr)->type = EXPR_CONNECTION_PTR;
         (yyval.tv_expr)->estimate_size = sizeof("100000000000000");
         (yyval.tv_expr)->dynamic_scope = DS_PER_CONNECTION;
     }
-#line 1528 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1509 "tcpkali_expr_y.c"
     break;
 
-  case 21:
-#line 198 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 29: /* NumericExpr: "connection" '.' "uid"  */
+#line 279 "tcpkali_expr_y.y"
+                                 {
         (yyval.tv_expr) = calloc(1, sizeof(*((yyval.tv_expr))));
         (yyval.tv_expr)->type = EXPR_CONNECTION_UID;
         (yyval.tv_expr)->estimate_size = sizeof("100000000000000");
         (yyval.tv_expr)->dynamic_scope = DS_PER_CONNECTION;
     }
-#line 1539 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1520 "tcpkali_expr_y.c"
     break;
 
-  case 22:
-#line 204 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 30: /* NumericExpr: "message" '.' "marker"  */
+#line 285 "tcpkali_expr_y.y"
+                                 {
         (yyval.tv_expr) = calloc(1, sizeof(*((yyval.tv_expr))));
         (yyval.tv_expr)->type = EXPR_MESSAGE_MARKER;
         (yyval.tv_expr)->estimate_size = sizeof("1000000000000" "1000000000000000" "!") - 1;
         (yyval.tv_expr)->dynamic_scope = DS_PER_MESSAGE;
     }
-#line 1550 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1531 "tcpkali_expr_y.c"
     break;
 
-  case 24:
-#line 214 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 32: /* WSFrameFinalized: WSFrameFinalized "..."  */
+#line 295 "tcpkali_expr_y.y"
+                                    {
         (yyval.tv_expr) = (yyvsp[-1].tv_expr);
         (yyval.tv_expr)->u.ws_frame.fin = 0; /* Expect continuation. */
     }
-#line 1559 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1540 "tcpkali_expr_y.c"
     break;
 
-  case 25:
-#line 219 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 33: /* WSFrameFinalized: WSFrameFinalized "rsv1, rsv2, rsv3"  */
+#line 300 "tcpkali_expr_y.y"
+                                            {
         (yyval.tv_expr) = (yyvsp[-1].tv_expr);
         (yyval.tv_expr)->u.ws_frame.rsvs |= (yyvsp[0].tv_long);
     }
-#line 1568 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1549 "tcpkali_expr_y.c"
     break;
 
-  case 27:
-#line 227 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 35: /* WSFrameWithData: WSFrameWithData FileOrQuoted  */
+#line 308 "tcpkali_expr_y.y"
+                                   {
         (yyval.tv_expr) = (yyvsp[-1].tv_expr);
         /* Combine old data with new data. */
         size_t total_size = (yyval.tv_expr)->u.ws_frame.size + ((yyvsp[0].tv_string)).len;
@@ -1583,24 +1564,24 @@ yyreduce:
         (yyval.tv_expr)->u.ws_frame.size = total_size;
         (yyval.tv_expr)->estimate_size += ((yyvsp[0].tv_string)).len;
     }
-#line 1587 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1568 "tcpkali_expr_y.c"
     break;
 
-  case 28:
-#line 243 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 36: /* WSBasicFrame: "ws" '.' "text, binary, close, ping, pong, continuation"  */
+#line 324 "tcpkali_expr_y.y"
+                             {
         (yyval.tv_expr) = calloc(1, sizeof(*((yyval.tv_expr))));
         (yyval.tv_expr)->type = EXPR_WS_FRAME;
         (yyval.tv_expr)->u.ws_frame.opcode = (yyvsp[0].tv_opcode);
         (yyval.tv_expr)->u.ws_frame.fin = 1; /* Complete frame */
         (yyval.tv_expr)->estimate_size = WEBSOCKET_MAX_FRAME_HDR_SIZE;
     }
-#line 1599 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1580 "tcpkali_expr_y.c"
     break;
 
-  case 31:
-#line 254 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 39: /* File: '<' "file name" '>'  */
+#line 335 "tcpkali_expr_y.y"
+                     {
         const char *name = (yyvsp[-1].tv_string).buf;
         FILE *fp = fopen(name, "r");
         if(!fp) {
@@ -1618,113 +1599,114 @@ yyreduce:
         fclose(fp);
         (yyval.tv_string).buf[(yyval.tv_string).len] = '\0';
     }
-#line 1622 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1603 "tcpkali_expr_y.c"
     break;
 
-  case 33:
-#line 277 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 41: /* RegexAlternatives: RegexSequence  */
+#line 358 "tcpkali_expr_y.y"
+                  {
         (yyval.tv_regex) = tregex_alternative((yyvsp[0].tv_regex));
     }
-#line 1630 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1611 "tcpkali_expr_y.c"
     break;
 
-  case 34:
-#line 280 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 42: /* RegexAlternatives: RegexAlternatives '|' RegexSequence  */
+#line 361 "tcpkali_expr_y.y"
+                                          {
         (yyval.tv_regex) = tregex_alternative_add((yyvsp[-2].tv_regex), (yyvsp[0].tv_regex));
     }
-#line 1638 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1619 "tcpkali_expr_y.c"
     break;
 
-  case 36:
-#line 286 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 44: /* RegexSequence: RegexSequence RepeatedRegex  */
+#line 367 "tcpkali_expr_y.y"
+                                  {
         (yyval.tv_regex) = tregex_join((yyvsp[-1].tv_regex), (yyvsp[0].tv_regex));
     }
-#line 1646 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1627 "tcpkali_expr_y.c"
     break;
 
-  case 38:
-#line 292 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    { (yyval.tv_regex) = tregex_repeat((yyvsp[-1].tv_regex), 0, 1); }
-#line 1652 "tcpkali_expr_y.c" /* yacc.c:1661  */
+  case 46: /* RepeatedRegex: RegexPiece '?'  */
+#line 373 "tcpkali_expr_y.y"
+                     { (yyval.tv_regex) = tregex_repeat((yyvsp[-1].tv_regex), 0, 1); }
+#line 1633 "tcpkali_expr_y.c"
     break;
 
-  case 39:
-#line 293 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    { (yyval.tv_regex) = tregex_repeat((yyvsp[-1].tv_regex), 1, 16); }
-#line 1658 "tcpkali_expr_y.c" /* yacc.c:1661  */
+  case 47: /* RepeatedRegex: RegexPiece '+'  */
+#line 374 "tcpkali_expr_y.y"
+                     { (yyval.tv_regex) = tregex_repeat((yyvsp[-1].tv_regex), 1, 16); }
+#line 1639 "tcpkali_expr_y.c"
     break;
 
-  case 40:
-#line 294 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    { (yyval.tv_regex) = tregex_repeat((yyvsp[-1].tv_regex), 0, 16); }
-#line 1664 "tcpkali_expr_y.c" /* yacc.c:1661  */
+  case 48: /* RepeatedRegex: RegexPiece '*'  */
+#line 375 "tcpkali_expr_y.y"
+                     { (yyval.tv_regex) = tregex_repeat((yyvsp[-1].tv_regex), 0, 16); }
+#line 1645 "tcpkali_expr_y.c"
     break;
 
-  case 41:
-#line 295 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    { (yyval.tv_regex) = tregex_repeat((yyvsp[-3].tv_regex), (yyvsp[-1].tv_long), (yyvsp[-1].tv_long)); }
-#line 1670 "tcpkali_expr_y.c" /* yacc.c:1661  */
+  case 49: /* RepeatedRegex: RegexPiece '{' integer '}'  */
+#line 376 "tcpkali_expr_y.y"
+                                 { (yyval.tv_regex) = tregex_repeat((yyvsp[-3].tv_regex), (yyvsp[-1].tv_long), (yyvsp[-1].tv_long)); }
+#line 1651 "tcpkali_expr_y.c"
     break;
 
-  case 42:
-#line 296 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    { (yyval.tv_regex) = tregex_repeat((yyvsp[-5].tv_regex), (yyvsp[-3].tv_long), (yyvsp[-1].tv_long)); }
-#line 1676 "tcpkali_expr_y.c" /* yacc.c:1661  */
+  case 50: /* RepeatedRegex: RegexPiece '{' integer ',' integer '}'  */
+#line 377 "tcpkali_expr_y.y"
+                                             { (yyval.tv_regex) = tregex_repeat((yyvsp[-5].tv_regex), (yyvsp[-3].tv_long), (yyvsp[-1].tv_long)); }
+#line 1657 "tcpkali_expr_y.c"
     break;
 
-  case 43:
-#line 299 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 51: /* RegexPiece: "arbitrary string"  */
+#line 380 "tcpkali_expr_y.y"
+                 {
         (yyval.tv_regex) = tregex_string((yyvsp[0].tv_string).buf, (yyvsp[0].tv_string).len);
     }
-#line 1684 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1665 "tcpkali_expr_y.c"
     break;
 
-  case 44:
-#line 302 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 52: /* RegexPiece: '[' RegexClasses ']'  */
+#line 383 "tcpkali_expr_y.y"
+                           {
         (yyval.tv_regex) = (yyvsp[-1].tv_regex);
     }
-#line 1692 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1673 "tcpkali_expr_y.c"
     break;
 
-  case 45:
-#line 305 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 53: /* RegexPiece: '(' CompleteRegex ')'  */
+#line 386 "tcpkali_expr_y.y"
+                            {
         (yyval.tv_regex) = (yyvsp[-1].tv_regex);
     }
-#line 1700 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1681 "tcpkali_expr_y.c"
     break;
 
-  case 47:
-#line 311 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 55: /* RegexClasses: RegexClasses RegexClass  */
+#line 392 "tcpkali_expr_y.y"
+                              {
         (yyval.tv_regex) = tregex_union_ranges((yyvsp[-1].tv_regex), (yyvsp[0].tv_regex));
     }
-#line 1708 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1689 "tcpkali_expr_y.c"
     break;
 
-  case 48:
-#line 316 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 56: /* RegexClass: String  */
+#line 397 "tcpkali_expr_y.y"
+           {
         (yyval.tv_regex) = tregex_range_from_string((yyvsp[0].tv_string).buf, (yyvsp[0].tv_string).len);
     }
-#line 1716 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1697 "tcpkali_expr_y.c"
     break;
 
-  case 49:
-#line 319 "tcpkali_expr_y.y" /* yacc.c:1661  */
-    {
+  case 57: /* RegexClass: "regex character class range"  */
+#line 400 "tcpkali_expr_y.y"
+                        {
         (yyval.tv_regex) = tregex_range((yyvsp[0].tv_class_range).from, (yyvsp[0].tv_class_range).to);
     }
-#line 1724 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1705 "tcpkali_expr_y.c"
     break;
 
 
-#line 1728 "tcpkali_expr_y.c" /* yacc.c:1661  */
+#line 1709 "tcpkali_expr_y.c"
+
       default: break;
     }
   /* User semantic actions sometimes alter yychar, and that requires
@@ -1738,25 +1720,23 @@ yyreduce:
      case of YYERROR or YYBACKUP, subsequent parser actions might lead
      to an incorrect destructor call or verbose syntax error message
      before the lookahead is translated.  */
-  YY_SYMBOL_PRINT ("-> $$ =", yyr1[yyn], &yyval, &yyloc);
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
 
   YYPOPSTACK (yylen);
   yylen = 0;
-  YY_STACK_PRINT (yyss, yyssp);
 
   *++yyvsp = yyval;
 
   /* Now 'shift' the result of the reduction.  Determine what state
      that goes to, based on the state we popped back to and the rule
      number reduced by.  */
-
-  yyn = yyr1[yyn];
-
-  yystate = yypgoto[yyn - YYNTOKENS] + *yyssp;
-  if (0 <= yystate && yystate <= YYLAST && yycheck[yystate] == *yyssp)
-    yystate = yytable[yystate];
-  else
-    yystate = yydefgoto[yyn - YYNTOKENS];
+  {
+    const int yylhs = yyr1[yyn] - YYNTOKENS;
+    const int yyi = yypgoto[yylhs] + *yyssp;
+    yystate = (0 <= yyi && yyi <= YYLAST && yycheck[yyi] == *yyssp
+               ? yytable[yyi]
+               : yydefgoto[yylhs]);
+  }
 
   goto yynewstate;
 
@@ -1767,59 +1747,23 @@ yyreduce:
 yyerrlab:
   /* Make sure we have latest lookahead translation.  See comments at
      user semantic actions for why this is necessary.  */
-  yytoken = yychar == YYEMPTY ? YYEMPTY : YYTRANSLATE (yychar);
-
+  yytoken = yychar == YYEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
   /* If not already recovering from an error, report this error.  */
   if (!yyerrstatus)
     {
       ++yynerrs;
-#if ! YYERROR_VERBOSE
       yyerror (param, YY_("syntax error"));
-#else
-# define YYSYNTAX_ERROR yysyntax_error (&yymsg_alloc, &yymsg, \
-                                        yyssp, yytoken)
-      {
-        char const *yymsgp = YY_("syntax error");
-        int yysyntax_error_status;
-        yysyntax_error_status = YYSYNTAX_ERROR;
-        if (yysyntax_error_status == 0)
-          yymsgp = yymsg;
-        else if (yysyntax_error_status == 1)
-          {
-            if (yymsg != yymsgbuf)
-              YYSTACK_FREE (yymsg);
-            yymsg = (char *) YYSTACK_ALLOC (yymsg_alloc);
-            if (!yymsg)
-              {
-                yymsg = yymsgbuf;
-                yymsg_alloc = sizeof yymsgbuf;
-                yysyntax_error_status = 2;
-              }
-            else
-              {
-                yysyntax_error_status = YYSYNTAX_ERROR;
-                yymsgp = yymsg;
-              }
-          }
-        yyerror (param, yymsgp);
-        if (yysyntax_error_status == 2)
-          goto yyexhaustedlab;
-      }
-# undef YYSYNTAX_ERROR
-#endif
     }
 
-
-
   if (yyerrstatus == 3)
     {
       /* If just tried and failed to reuse lookahead token after an
          error, discard it.  */
 
-      if (yychar <= YYEOF)
+      if (yychar <= END)
         {
           /* Return failure if at end of input.  */
-          if (yychar == YYEOF)
+          if (yychar == END)
             YYABORT;
         }
       else
@@ -1839,12 +1783,11 @@ yyerrlab:
 | yyerrorlab -- error raised explicitly by YYERROR.  |
 `---------------------------------------------------*/
 yyerrorlab:
-
-  /* Pacify compilers like GCC when the user code never invokes
-     YYERROR and the label yyerrorlab therefore never appears in user
-     code.  */
-  if (/*CONSTCOND*/ 0)
-     goto yyerrorlab;
+  /* Pacify compilers when the user code never invokes YYERROR and the
+     label yyerrorlab therefore never appears in user code.  */
+  if (0)
+    YYERROR;
+  ++yynerrs;
 
   /* Do not reclaim the symbols of the rule whose action triggered
      this YYERROR.  */
@@ -1861,13 +1804,14 @@ yyerrorlab:
 yyerrlab1:
   yyerrstatus = 3;      /* Each real token shifted decrements this.  */
 
+  /* Pop stack until we find a state that shifts the error token.  */
   for (;;)
     {
       yyn = yypact[yystate];
       if (!yypact_value_is_default (yyn))
         {
-          yyn += YYTERROR;
-          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYTERROR)
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
             {
               yyn = yytable[yyn];
               if (0 < yyn)
@@ -1881,7 +1825,7 @@ yyerrlab1:
 
 
       yydestruct ("Error: popping",
-                  yystos[yystate], yyvsp, param);
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp, param);
       YYPOPSTACK (1);
       yystate = *yyssp;
       YY_STACK_PRINT (yyss, yyssp);
@@ -1893,7 +1837,7 @@ yyerrlab1:
 
 
   /* Shift the error token.  */
-  YY_SYMBOL_PRINT ("Shifting", yystos[yyn], yyvsp, yylsp);
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
 
   yystate = yyn;
   goto yynewstate;
@@ -1904,26 +1848,30 @@ yyerrlab1:
 `-------------------------------------*/
 yyacceptlab:
   yyresult = 0;
-  goto yyreturn;
+  goto yyreturnlab;
+
 
 /*-----------------------------------.
 | yyabortlab -- YYABORT comes here.  |
 `-----------------------------------*/
 yyabortlab:
   yyresult = 1;
-  goto yyreturn;
+  goto yyreturnlab;
+
 
-#if !defined yyoverflow || YYERROR_VERBOSE
-/*-------------------------------------------------.
-| yyexhaustedlab -- memory exhaustion comes here.  |
-`-------------------------------------------------*/
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
 yyexhaustedlab:
   yyerror (param, YY_("memory exhausted"));
   yyresult = 2;
-  /* Fall through.  */
-#endif
+  goto yyreturnlab;
+
 
-yyreturn:
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
   if (yychar != YYEMPTY)
     {
       /* Make sure we have latest lookahead translation.  See comments at
@@ -1939,20 +1887,18 @@ yyreturn:
   while (yyssp != yyss)
     {
       yydestruct ("Cleanup: popping",
-                  yystos[*yyssp], yyvsp, param);
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp, param);
       YYPOPSTACK (1);
     }
 #ifndef yyoverflow
   if (yyss != yyssa)
     YYSTACK_FREE (yyss);
 #endif
-#if YYERROR_VERBOSE
-  if (yymsg != yymsgbuf)
-    YYSTACK_FREE (yymsg);
-#endif
+
   return yyresult;
 }
-#line 323 "tcpkali_expr_y.y" /* yacc.c:1906  */
+
+#line 404 "tcpkali_expr_y.y"
 
 
 int
@@ -1,8 +1,9 @@
-/* A Bison parser, made by GNU Bison 3.0.4.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
 /* Bison interface for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989-1990, 2000-2015 Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
    This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
@@ -15,7 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -30,6 +31,10 @@
    This special exception was added by the Free Software Foundation in
    version 2.2 of Bison.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 #ifndef YY_YY_TCPKALI_EXPR_Y_H_INCLUDED
 # define YY_YY_TCPKALI_EXPR_Y_H_INCLUDED
 /* Debug traces.  */
@@ -40,34 +45,48 @@
 extern int yydebug;
 #endif
 
-/* Token type.  */
+/* Token kinds.  */
 #ifndef YYTOKENTYPE
 # define YYTOKENTYPE
   enum yytokentype
   {
-    END = 0,
-    TOK_ws = 258,
-    TOK_raw = 259,
-    TOK_ws_opcode = 260,
-    TOK_ws_reserved_flag = 261,
-    TOK_global = 262,
-    TOK_connection = 263,
-    TOK_message = 264,
-    TOK_ptr = 265,
-    TOK_uid = 266,
-    TOK_regex = 267,
-    TOK_marker = 268,
-    TOK_ellipsis = 269,
-    string_token = 270,
-    class_range_token = 271,
-    repeat_range_token = 272,
-    quoted_string = 273,
-    filename = 274,
-    integer = 275
+    YYEMPTY = -2,
+    END = 0,                       /* "end of expression"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    TOK_ws = 258,                  /* "ws"  */
+    TOK_raw = 259,                 /* "raw"  */
+    TOK_ws_opcode = 260,           /* "text, binary, close, ping, pong, continuation"  */
+    TOK_ws_reserved_flag = 261,    /* "rsv1, rsv2, rsv3"  */
+    TOK_global = 262,              /* "global"  */
+    TOK_connection = 263,          /* "connection"  */
+    TOK_message = 264,             /* "message"  */
+    TOK_ptr = 265,                 /* " ptr"  */
+    TOK_uid = 266,                 /* "uid"  */
+    TOK_regex = 267,               /* "re"  */
+    TOK_marker = 268,              /* "marker"  */
+    TOK_seq = 269,                 /* "seq"  */
+    TOK_time = 270,                /* "time"  */
+    TOK_us = 271,                  /* "us"  */
+    TOK_random = 272,              /* "random"  */
+    TOK_bytes = 273,               /* "bytes"  */
+    TOK_alnum = 274,               /* "alnum"  */
+    TOK_zipf = 275,                /* "zipf"  */
+    TOK_ellipsis = 276,            /* "..."  */
+    string_token = 277,            /* "arbitrary string"  */
+    class_range_token = 278,       /* "regex character class range"  */
+    repeat_range_token = 279,      /* "regex repeat spec"  */
+    quoted_string = 280,           /* "quoted string"  */
+    filename = 281,                /* "file name"  */
+    integer = 282                  /* integer  */
   };
+  typedef enum yytokentype yytoken_kind_t;
 #endif
-/* Tokens.  */
+/* Token kinds.  */
+#define YYEMPTY -2
 #define END 0
+#define YYerror 256
+#define YYUNDEF 257
 #define TOK_ws 258
 #define TOK_raw 259
 #define TOK_ws_opcode 260
@@ -79,24 +98,31 @@ extern int yydebug;
 #define TOK_uid 266
 #define TOK_regex 267
 #define TOK_marker 268
-#define TOK_ellipsis 269
-#define string_token 270
-#define class_range_token 271
-#define repeat_range_token 272
-#define quoted_string 273
-#define filename 274
-#define integer 275
+#define TOK_seq 269
+#define TOK_time 270
+#define TOK_us 271
+#define TOK_random 272
+#define TOK_bytes 273
+#define TOK_alnum 274
+#define TOK_zipf 275
+#define TOK_ellipsis 276
+#define string_token 277
+#define class_range_token 278
+#define repeat_range_token 279
+#define quoted_string 280
+#define filename 281
+#define integer 282
 
 /* Value type.  */
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-
 union YYSTYPE
 {
-#line 21 "tcpkali_expr_y.y" /* yacc.c:1915  */
+#line 24 "tcpkali_expr_y.y"
 
     tk_expr_t   *tv_expr;
     tregex      *tv_regex;
     long         tv_long;
+    double       tv_double;
     struct {
         char  *buf;
         size_t len;
@@ -112,9 +138,9 @@ union YYSTYPE
     enum ws_frame_opcode tv_opcode;
     char  tv_char;
 
-#line 116 "tcpkali_expr_y.h" /* yacc.c:1915  */
-};
+#line 142 "tcpkali_expr_y.h"
 
+};
 typedef union YYSTYPE YYSTYPE;
 # define YYSTYPE_IS_TRIVIAL 1
 # define YYSTYPE_IS_DECLARED 1
@@ -123,6 +149,8 @@ typedef union YYSTYPE YYSTYPE;
 
 extern YYSTYPE yylval;
 
+
 int yyparse (tk_expr_t **param);
 
+
 #endif /* !YY_YY_TCPKALI_EXPR_Y_H_INCLUDED  */
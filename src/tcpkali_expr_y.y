@@ -4,11 +4,14 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <math.h>
 
 #include "tcpkali_websocket.h"
+#include "tcpkali_random.h"
 #include "tcpkali_expr.h"
 
 int yylex(void);
+extern int expr_integer_digits;
 int yyerror(tk_expr_t **, const char *);
 
 #define YYPARSE_PARAM   param
@@ -22,6 +25,7 @@ int yyerror(tk_expr_t **, const char *);
     tk_expr_t   *tv_expr;
     tregex      *tv_regex;
     long         tv_long;
+    double       tv_double;
     struct {
         char  *buf;
         size_t len;
@@ -49,6 +53,13 @@ int yyerror(tk_expr_t **, const char *);
 %token              TOK_uid          "uid"
 %token              TOK_regex        "re"
 %token              TOK_marker       "marker"
+%token              TOK_seq          "seq"
+%token              TOK_time         "time"
+%token              TOK_us           "us"
+%token              TOK_random       "random"
+%token              TOK_bytes        "bytes"
+%token              TOK_alnum        "alnum"
+%token              TOK_zipf         "zipf"
 %token              TOK_ellipsis     "..."
 %token              END 0            "end of expression"
 %token  <tv_string> string_token     "arbitrary string"
@@ -62,6 +73,7 @@ int yyerror(tk_expr_t **, const char *);
 
 %type   <tv_string> String File FileOrQuoted
 %type   <tv_expr>   NumericExpr
+%type   <tv_double> Number Fraction
 %type   <tv_regex>  CompleteRegex RepeatedRegex RegexPiece RegexClasses RegexClass RegexAlternatives RegexSequence
 %type   <tv_expr>   WSBasicFrame WSFrameWithData WSFrameFinalized
 %type   <tv_expr>   ByteSequenceOrExpr          "some string or \\{expression}"
@@ -134,6 +146,67 @@ NonWSExpression:
     | NumericExpr {
         $$ = $1;
     }
+    /* Rewritten in place as the data is sent, so no '%' for these. */
+    | TOK_message '.' TOK_seq {
+        $$ = calloc(1, sizeof(*($$)));
+        $$->type = EXPR_MESSAGE_SEQ;
+        $$->estimate_size = EXPR_MESSAGE_SEQ_WIDTH;
+        $$->dynamic_scope = DS_MESSAGE_SLOTS;
+    }
+    | TOK_time '.' TOK_us {
+        $$ = calloc(1, sizeof(*($$)));
+        $$->type = EXPR_TIME_US;
+        $$->estimate_size = EXPR_TIME_US_WIDTH;
+        $$->dynamic_scope = DS_MESSAGE_SLOTS;
+    }
+    | TOK_random '.' TOK_bytes integer {
+        if($4 <= 0 || $4 > EXPR_RANDOM_MAX_SIZE) {
+            fprintf(stderr, "\\{random.bytes %ld} size is out of range\n",
+                    $4);
+            YYABORT;
+        }
+        $$ = calloc(1, sizeof(*($$)));
+        $$->type = EXPR_RANDOM;
+        $$->u.random.size = $4;
+        $$->estimate_size = $4;
+        $$->dynamic_scope = DS_PER_MESSAGE;
+    }
+    | TOK_random '.' TOK_alnum integer {
+        if($4 <= 0 || $4 > EXPR_RANDOM_MAX_SIZE) {
+            fprintf(stderr, "\\{random.alnum %ld} size is out of range\n",
+                    $4);
+            YYABORT;
+        }
+        $$ = calloc(1, sizeof(*($$)));
+        $$->type = EXPR_RANDOM;
+        $$->u.random.size = $4;
+        $$->u.random.alnum = 1;
+        $$->estimate_size = $4;
+        $$->dynamic_scope = DS_PER_MESSAGE;
+    }
+    | TOK_zipf integer Number {
+        if($2 <= 0 || $2 > EXPR_ZIPF_MAX_KEYS || !($3 >= 0.0 && $3 <= 100.0)) {
+            fprintf(stderr, "\\{zipf %ld %g} keys or exponent "
+                    "is out of range\n", $2, $3);
+            YYABORT;
+        }
+        /* The key k is drawn with the weight of 1/(k+1)^s. */
+        double *weights = malloc($2 * sizeof(weights[0]));
+        assert(weights);
+        double total = 0.0, digits = 0.0;
+        for(long k = 0; k < $2; k++) {
+            weights[k] = pow(k + 1, -$3);
+            total += weights[k];
+            digits += weights[k] * (k ? floor(log10(k)) + 1 : 1);
+        }
+        $$ = calloc(1, sizeof(*($$)));
+        $$->type = EXPR_ZIPF;
+        $$->u.zipf.table = tk_alias_table_new(weights, $2);
+        $$->u.zipf.avg_size = round(digits / total);
+        $$->estimate_size = snprintf(NULL, 0, "%ld", $2 - 1);
+        $$->dynamic_scope = DS_PER_MESSAGE;
+        free(weights);
+    }
     | TOK_raw FileOrQuoted {
         tk_expr_t *expr = calloc(1, sizeof(tk_expr_t));
         expr->type = EXPR_DATA;
@@ -180,6 +253,14 @@ NonWSExpression:
         $$ = expr;
     }
 
+Number:
+    integer { $$ = $1; }
+    | integer '.' Fraction { $$ = $1 + $3; }
+
+/* The digits after the decimal point, leading zeros included. */
+Fraction:
+    integer { $$ = $1 / pow(10, expr_integer_digits); }
+
 NumericExpr:
     NumericExpr '%' integer {
         $$ = calloc(1, sizeof(*($$)));
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+
+#include "tcpkali_framer.h"
+
+/*
+ * Check that the plugin is something we can call.
+ */
+static const char *
+framer_invalid(const struct tcpkali_framer *f) {
+    if(f->abi_version != TCPKALI_FRAMER_ABI_VERSION)
+        return "abi_version is not TCPKALI_FRAMER_ABI_VERSION";
+    if(!f->on_bytes_received) return "on_bytes_received is not set";
+    return NULL;
+}
+
+const struct tcpkali_framer *
+framer_load(const char *spec) {
+    char *path = strdup(spec);
+    char *args = strchr(path, ':');
+    if(args) *args++ = '\0';
+
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if(!handle) {
+        fprintf(stderr, "--framer %s: %s\n", path, dlerror());
+        free(path);
+        return NULL;
+    }
+
+    const struct tcpkali_framer *f = dlsym(handle, "tcpkali_framer");
+    const char *invalid =
+        f ? framer_invalid(f) : "No tcpkali_framer symbol defined";
+    if(invalid) {
+        fprintf(stderr, "--framer %s: %s\n", path, invalid);
+    } else if(f->init && f->init(args) == -1) {
+        invalid = "init() failed";
+        fprintf(stderr, "--framer %s: %s\n", path, invalid);
+    }
+    if(invalid) {
+        dlclose(handle);
+        free(path);
+        return NULL;
+    }
+
+    /* The plugin stays loaded until exit. */
+    free(path);
+    return f;
+}
+
+#ifdef TCPKALI_FRAMER_UNIT_TEST
+
+#include <assert.h>
+
+static ssize_t
+test_bytes(void *state, const uint8_t *data, size_t size, int *end) {
+    (void)state;
+    (void)data;
+    *end = 0;
+    return size;
+}
+
+int
+main() {
+    struct tcpkali_framer f = {.abi_version = TCPKALI_FRAMER_ABI_VERSION};
+    assert(framer_invalid(&f));
+    f.on_bytes_received = test_bytes;
+    assert(framer_invalid(&f) == NULL);
+    f.abi_version = TCPKALI_FRAMER_ABI_VERSION + 1;
+    assert(framer_invalid(&f));
+
+    /* Neither a shared object nor a plugin. */
+    assert(framer_load("/nonexistent/framer.so:args") == NULL);
+    assert(framer_load("/dev/null") == NULL);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_FRAMER_UNIT_TEST */
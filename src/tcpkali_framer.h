@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_FRAMER_H
+#define TCPKALI_FRAMER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * The --framer plugin interface: a shared object telling tcpkali where
+ * the responses of its protocol end, and optionally how long they took.
+ * The plugin defines a (const struct tcpkali_framer tcpkali_framer)
+ * symbol. Each connection gets (state_size) zero-initialized bytes of the
+ * plugin state, allocated once with the connection; the hooks are called
+ * with the received data as it is read, so they should neither copy
+ * nor allocate.
+ */
+#define TCPKALI_FRAMER_ABI_VERSION 1
+
+struct tcpkali_framer {
+    unsigned abi_version; /* TCPKALI_FRAMER_ABI_VERSION */
+    size_t state_size;    /* Per connection, may be 0 */
+
+    /*
+     * Optional. Called once, with the <args> of --framer <so>:<args>
+     * or NULL. Returns -1 to refuse to run.
+     */
+    int (*init)(const char *args);
+
+    /*
+     * Consume the received data up to the end of the next response,
+     * or all of it. Sets (*response_end) if a response ends right before
+     * the returned number of bytes. The responses are at least a byte long. Returns -1 on a protocol error, after
+     * which the responses are no longer counted on this connection.
+     */
+    ssize_t (*on_bytes_received)(void *state, const uint8_t *data,
+                                 size_t size, int *response_end);
+
+    /*
+     * Optional. A request (a --message) has started to be sent
+     * at (now_ns), on the tcpkali's clock.
+     */
+    void (*next_request)(void *state, uint64_t now_ns);
+
+    /*
+     * Optional. A response has ended at (now_ns). Returns 1 with the
+     * (*latency_ns) set to attach the latency of the plugin's own request
+     * matching, or 0 to take the oldest request in flight as answered.
+     */
+    int (*on_response)(void *state, uint64_t now_ns, int64_t *latency_ns);
+};
+
+/*
+ * Used by tcpkali itself: load the "<so>[:<args>]" plugin and call its
+ * init(). Returns NULL after printing the reason.
+ */
+const struct tcpkali_framer *framer_load(const char *spec);
+
+#endif /* TCPKALI_FRAMER_H */
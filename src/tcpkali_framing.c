@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tcpkali_framing.h"
+
+enum lenprefix_parse_event
+lenprefix_parse(struct lenprefix_parser *lp, uint8_t **bufp, size_t *sizep,
+                uint8_t **payload, size_t *payload_size) {
+    uint8_t *buf = *bufp;
+    size_t size = *sizep;
+
+    assert(lp->prefix_size >= 1 && lp->prefix_size <= sizeof(lp->prefix));
+
+    if(!lp->in_payload) {
+        size_t take = lp->prefix_size - lp->prefix_collected;
+        if(take > size) take = size;
+        memcpy(lp->prefix + lp->prefix_collected, buf, take);
+        lp->prefix_collected += take;
+        *bufp = buf + take;
+        *sizep = size - take;
+        if(lp->prefix_collected < lp->prefix_size) return LPE_NEED_MORE_DATA;
+
+        uint64_t length = 0;
+        for(unsigned i = 0; i < lp->prefix_size; i++) {
+            unsigned at = lp->little_endian ? lp->prefix_size - 1 - i : i;
+            length = (length << 8) | lp->prefix[at];
+        }
+        lp->prefix_collected = 0;
+        lp->payload_left = length;
+        lp->in_payload = 1;
+        buf = *bufp;
+        size = *sizep;
+    }
+
+    if(lp->payload_left == 0) {
+        lp->in_payload = 0;
+        return LPE_FRAME_END;
+    }
+    if(size == 0) return LPE_NEED_MORE_DATA;
+
+    size_t take = lp->payload_left < size ? lp->payload_left : size;
+    *payload = buf;
+    *payload_size = take;
+    lp->payload_left -= take;
+    *bufp = buf + take;
+    *sizep = size - take;
+    return LPE_PAYLOAD;
+}
+
+#ifdef TCPKALI_FRAMING_UNIT_TEST
+
+#include <stdio.h>
+
+static void
+check_stream(unsigned prefix_size, int little_endian, const uint8_t *stream,
+             size_t stream_size, int expected_frames, const char *expected) {
+    for(size_t piece = 1; piece <= stream_size; piece++) {
+        struct lenprefix_parser lp;
+        char received[256];
+        size_t received_size = 0;
+        int frames = 0;
+        memset(&lp, 0, sizeof(lp));
+        lp.prefix_size = prefix_size;
+        lp.little_endian = little_endian;
+        for(size_t off = 0; off < stream_size; off += piece) {
+            uint8_t *buf = (uint8_t *)stream + off;
+            size_t size = stream_size - off < piece ? stream_size - off : piece;
+            for(;;) {
+                uint8_t *payload;
+                size_t payload_size;
+                enum lenprefix_parse_event ev =
+                    lenprefix_parse(&lp, &buf, &size, &payload, &payload_size);
+                if(ev == LPE_NEED_MORE_DATA) break;
+                if(ev == LPE_PAYLOAD) {
+                    memcpy(received + received_size, payload, payload_size);
+                    received_size += payload_size;
+                } else {
+                    received[received_size++] = '|';
+                    frames++;
+                }
+            }
+            assert(size == 0);
+        }
+        assert(frames == expected_frames);
+        assert(received_size == strlen(expected));
+        assert(memcmp(received, expected, received_size) == 0);
+    }
+}
+
+int
+main() {
+    static const uint8_t be32[] = {0, 0, 0, 5, 'H', 'e', 'l', 'l', 'o',
+                                   0, 0, 0, 0, 0, 0, 0, 2, 'o', 'k'};
+    check_stream(4, 0, be32, sizeof(be32), 3, "Hello||ok|");
+
+    static const uint8_t le16[] = {3, 0, 'a', 'b', 'c', 0, 0, 1, 0, 'z'};
+    check_stream(2, 1, le16, sizeof(le16), 3, "abc||z|");
+
+    static const uint8_t u8[] = {1, 'x', 2, 'y', 'z'};
+    check_stream(1, 0, u8, sizeof(u8), 2, "x|yz|");
+
+    static const uint8_t le64[] = {2, 0, 0, 0, 0, 0, 0, 0, 'h', 'i'};
+    check_stream(8, 1, le64, sizeof(le64), 1, "hi|");
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_FRAMING_UNIT_TEST */
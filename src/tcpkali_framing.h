@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_FRAMING_H
+#define TCPKALI_FRAMING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Streaming parser of the length-prefixed frames, see --framing.
+ * Each frame is a (prefix_size) bytes long payload length, followed
+ * by the payload. The parser is zero-initialized, with the
+ * (prefix_size) and (little_endian) set.
+ */
+struct lenprefix_parser {
+    unsigned prefix_size; /* 1, 2, 4 or 8 bytes */
+    int little_endian;
+    uint8_t prefix[8];        /* The length collected so far */
+    size_t prefix_collected;
+    uint64_t payload_left;    /* Bytes of the payload yet to come */
+    int in_payload;
+};
+
+enum lenprefix_parse_event {
+    LPE_NEED_MORE_DATA, /* The input is exhausted */
+    LPE_PAYLOAD,        /* A piece of the frame payload */
+    LPE_FRAME_END,      /* The frame is complete */
+};
+
+/*
+ * Consume the input until the next event. The payload is only returned,
+ * never copied out. The frames are skipped over by their length, so the
+ * work is proportional to the number of frames, not bytes.
+ */
+enum lenprefix_parse_event lenprefix_parse(struct lenprefix_parser *,
+                                           uint8_t **buf, size_t *size,
+                                           uint8_t **payload,
+                                           size_t *payload_size);
+
+#endif /* TCPKALI_FRAMING_H */
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tcpkali_http2.h"
+#include "tcpkali_grpc.h"
+
+static const char *const grpc_status_names[GRPC_STATUS_CODES] = {
+    "OK",
+    "CANCELLED",
+    "UNKNOWN",
+    "INVALID_ARGUMENT",
+    "DEADLINE_EXCEEDED",
+    "NOT_FOUND",
+    "ALREADY_EXISTS",
+    "PERMISSION_DENIED",
+    "RESOURCE_EXHAUSTED",
+    "FAILED_PRECONDITION",
+    "ABORTED",
+    "OUT_OF_RANGE",
+    "UNIMPLEMENTED",
+    "INTERNAL",
+    "UNAVAILABLE",
+    "DATA_LOSS",
+    "UNAUTHENTICATED",
+};
+
+size_t
+grpc_request_headers_estimate(const char *authority, const char *path) {
+    return http2_request_headers_estimate(authority, path)
+           + http2_header_field_estimate("content-type", "application/grpc")
+           + http2_header_field_estimate("te", "trailers");
+}
+
+size_t
+grpc_request_headers(uint8_t *buf, int https, const char *authority,
+                     const char *path) {
+    uint8_t *p = buf;
+    p += http2_request_headers(p, 1, https, authority, path);
+    p += http2_header_field(p, "content-type", "application/grpc");
+    p += http2_header_field(p, "te", "trailers");
+    assert((size_t)(p - buf) <= grpc_request_headers_estimate(authority, path));
+    return p - buf;
+}
+
+size_t
+grpc_frame_message(uint8_t *buf, const void *message, size_t size) {
+    buf[0] = 0; /* Not compressed */
+    buf[1] = size >> 24;
+    buf[2] = size >> 16;
+    buf[3] = size >> 8;
+    buf[4] = size;
+    if(size) memcpy(buf + GRPC_PREFIX_SIZE, message, size);
+    return GRPC_PREFIX_SIZE + size;
+}
+
+int
+grpc_parse_status(const char *value) {
+    char *end;
+    long code = strtol(value, &end, 10);
+    if(end == value || *end != '\0' || code < 0 || code >= GRPC_STATUS_CODES)
+        return -1;
+    return code;
+}
+
+const char *
+grpc_status_name(unsigned code) {
+    return code < GRPC_STATUS_CODES ? grpc_status_names[code] : "NONE";
+}
+
+size_t
+grpc_count_messages(struct grpc_reader *gr, const uint8_t *data,
+                    size_t size) {
+    size_t messages = 0;
+
+    while(size) {
+        if(gr->message_left) {
+            size_t take = gr->message_left < size ? gr->message_left : size;
+            gr->message_left -= take;
+            data += take;
+            size -= take;
+            if(gr->message_left == 0) messages++;
+            continue;
+        }
+
+        size_t take = GRPC_PREFIX_SIZE - gr->prefix_size;
+        if(take > size) take = size;
+        memcpy(gr->prefix + gr->prefix_size, data, take);
+        gr->prefix_size += take;
+        data += take;
+        size -= take;
+        if(gr->prefix_size < GRPC_PREFIX_SIZE) break;
+
+        gr->prefix_size = 0;
+        gr->message_left = ((uint32_t)gr->prefix[1] << 24)
+                           | (gr->prefix[2] << 16) | (gr->prefix[3] << 8)
+                           | gr->prefix[4];
+        if(gr->message_left == 0) messages++;
+    }
+
+    return messages;
+}
+
+#ifdef TCPKALI_GRPC_UNIT_TEST
+
+#include <stdio.h>
+
+int
+main() {
+    uint8_t buf[256];
+
+    size_t size = grpc_frame_message(buf, "\x08\x96\x01", 3);
+    assert(size == 8);
+    assert(memcmp(buf, "\0\0\0\0\x03\x08\x96\x01", 8) == 0);
+    size += grpc_frame_message(buf + size, NULL, 0);
+    size += grpc_frame_message(buf + size, "abcdefghij", 10);
+    assert(size == 8 + 5 + 15);
+
+    /* Any split of the stream gives the same three messages. */
+    for(size_t piece = 1; piece <= size; piece++) {
+        struct grpc_reader gr;
+        size_t messages = 0;
+        memset(&gr, 0, sizeof(gr));
+        for(size_t off = 0; off < size; off += piece) {
+            size_t len = size - off < piece ? size - off : piece;
+            messages += grpc_count_messages(&gr, buf + off, len);
+        }
+        assert(messages == 3);
+        assert(gr.prefix_size == 0 && gr.message_left == 0);
+    }
+
+    assert(grpc_parse_status("0") == 0);
+    assert(grpc_parse_status("14") == 14);
+    assert(grpc_parse_status("17") == -1);
+    assert(grpc_parse_status("") == -1);
+    assert(grpc_parse_status("1x") == -1);
+    assert(strcmp(grpc_status_name(14), "UNAVAILABLE") == 0);
+    assert(strcmp(grpc_status_name(GRPC_STATUS_CODES), "NONE") == 0);
+
+    /* The request headers are POSTs with the gRPC content type. */
+    size = grpc_request_headers(buf, 0, "localhost",
+                                "/helloworld.Greeter/SayHello");
+    assert(buf[0] == 0x83 && buf[1] == 0x86);
+    char value[32];
+    assert(http2_find_header(buf, size, "content-type", value, sizeof(value))
+           == 16);
+    assert(strcmp(value, "application/grpc") == 0);
+    assert(http2_find_header(buf, size, "te", value, sizeof(value)) == 8);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_GRPC_UNIT_TEST */
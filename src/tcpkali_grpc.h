@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_GRPC_H
+#define TCPKALI_GRPC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * gRPC over the --http2 streams: the requests carry the length-prefixed
+ * messages, and the calls end with the grpc-status trailer.
+ */
+
+#define GRPC_PREFIX_SIZE 5   /* Compressed flag, 32-bit message length */
+#define GRPC_STATUS_CODES 17 /* OK (0) to UNAUTHENTICATED (16) */
+#define GRPC_TRAILERS_MAX 256 /* The HEADERS payload looked into */
+
+/*
+ * Put the request header block for the (path), "/package.Service/Method",
+ * into (buf), which must have grpc_request_headers_estimate() bytes.
+ * Returns the block size.
+ */
+size_t grpc_request_headers_estimate(const char *authority, const char *path);
+size_t grpc_request_headers(uint8_t *buf, int https, const char *authority,
+                            const char *path);
+
+/*
+ * Put the serialized (message) with the uncompressed message prefix into
+ * (buf), which must have GRPC_PREFIX_SIZE + (size) bytes of space.
+ * Returns the framed message size.
+ */
+size_t grpc_frame_message(uint8_t *buf, const void *message, size_t size);
+
+/*
+ * The grpc-status code of the trailer (value), or -1 if it is not one.
+ */
+int grpc_parse_status(const char *value);
+
+/*
+ * "OK", "UNAVAILABLE", etc.
+ */
+const char *grpc_status_name(unsigned code);
+
+/*
+ * Count the length-prefixed messages in the DATA of a stream.
+ * The reader is zero-initialized.
+ */
+struct grpc_reader {
+    uint8_t prefix[GRPC_PREFIX_SIZE];
+    size_t prefix_size;    /* Collected (prefix) bytes */
+    uint32_t message_left; /* Message bytes to skip */
+};
+
+/*
+ * Returns the number of messages which ended within the data.
+ */
+size_t grpc_count_messages(struct grpc_reader *, const uint8_t *data,
+                           size_t size);
+
+#endif /* TCPKALI_GRPC_H */
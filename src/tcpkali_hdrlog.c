@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <config.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <assert.h>
+#include <sys/queue.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#include "tcpkali_hdrlog.h"
+
+/*
+ * The cookies of the V2 histogram encoding, with the word size
+ * indicator (0x10) which HdrHistogram implementations expect.
+ */
+#define HDRLOG_V2_ENCODING_COOKIE (0x1c849303 | 0x10)
+#define HDRLOG_V2_COMPRESSED_COOKIE (0x1c849304 | 0x10)
+#define HDRLOG_V2_HEADER_SIZE 40
+
+struct hdrlog_entry {
+    TAILQ_ENTRY(hdrlog_entry) hook;
+    struct hdr_histogram *histogram;
+    const char *tag;
+    double start_time; /* Relative to the log start time */
+    double length;
+    double max_value;
+};
+
+struct hdrlog {
+    FILE *fp;
+    double start_time;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t entry_queued;
+    TAILQ_HEAD(, hdrlog_entry) entries;
+    int terminate;
+};
+
+static void
+put_be32(unsigned char *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static void
+put_be64(unsigned char *p, uint64_t v) {
+    put_be32(p, v >> 32);
+    put_be32(p + 4, v);
+}
+
+/*
+ * ZigZag LEB128 with at most 9 bytes: the 9th byte carries 8 bits.
+ */
+static size_t
+zigzag_encode(unsigned char *p, int64_t signed_value) {
+    uint64_t v = ((uint64_t)signed_value << 1) ^ (uint64_t)(signed_value >> 63);
+    for(size_t i = 0; i < 8; i++) {
+        if((v >> 7) == 0) {
+            p[i] = v;
+            return i + 1;
+        }
+        p[i] = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    p[8] = v;
+    return 9;
+}
+
+/*
+ * The uncompressed V2 encoding: a header and the run-length encoded counts,
+ * where a negative number denotes a run of zero counts.
+ */
+static unsigned char *
+encode_v2(struct hdr_histogram *h, size_t *size) {
+    int32_t counts_limit = h->counts_len;
+    while(counts_limit > 0 && h->counts[counts_limit - 1] == 0) counts_limit--;
+
+    unsigned char *buf = malloc(HDRLOG_V2_HEADER_SIZE + 9 * counts_limit);
+    assert(buf);
+    unsigned char *p = buf + HDRLOG_V2_HEADER_SIZE;
+
+    for(int32_t i = 0; i < counts_limit;) {
+        int64_t value = h->counts[i++];
+        if(value == 0) {
+            int64_t zeros = 1;
+            while(i < counts_limit && h->counts[i] == 0) {
+                zeros++;
+                i++;
+            }
+            if(zeros > 1) value = -zeros;
+        }
+        p += zigzag_encode(p, value);
+    }
+
+    double ratio = h->conversion_ratio;
+    uint64_t ratio_bits;
+    memcpy(&ratio_bits, &ratio, sizeof(ratio_bits));
+
+    size_t payload_size = p - (buf + HDRLOG_V2_HEADER_SIZE);
+    put_be32(buf, HDRLOG_V2_ENCODING_COOKIE);
+    put_be32(buf + 4, payload_size);
+    put_be32(buf + 8, h->normalizing_index_offset);
+    put_be32(buf + 12, h->significant_figures);
+    put_be64(buf + 16, h->lowest_trackable_value);
+    put_be64(buf + 24, h->highest_trackable_value);
+    put_be64(buf + 32, ratio_bits);
+
+    *size = HDRLOG_V2_HEADER_SIZE + payload_size;
+    return buf;
+}
+
+static char *
+base64_encode(const unsigned char *data, size_t size) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char *out = malloc(4 * ((size + 2) / 3) + 1);
+    assert(out);
+    char *o = out;
+    size_t i;
+    for(i = 0; i + 2 < size; i += 3) {
+        uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        *o++ = alphabet[(v >> 18) & 0x3f];
+        *o++ = alphabet[(v >> 12) & 0x3f];
+        *o++ = alphabet[(v >> 6) & 0x3f];
+        *o++ = alphabet[v & 0x3f];
+    }
+    if(i < size) {
+        uint32_t v = data[i] << 16;
+        if(i + 1 < size) v |= data[i + 1] << 8;
+        *o++ = alphabet[(v >> 18) & 0x3f];
+        *o++ = alphabet[(v >> 12) & 0x3f];
+        *o++ = (i + 1 < size) ? alphabet[(v >> 6) & 0x3f] : '=';
+        *o++ = '=';
+    }
+    *o = '\0';
+    return out;
+}
+
+char *
+hdrlog_encode(struct hdr_histogram *h) {
+#ifdef HAVE_LIBZ
+    size_t raw_size;
+    unsigned char *raw = encode_v2(h, &raw_size);
+
+    uLongf compressed_size = compressBound(raw_size);
+    unsigned char *compressed = malloc(8 + compressed_size);
+    assert(compressed);
+    if(compress2(compressed + 8, &compressed_size, raw, raw_size,
+                 Z_DEFAULT_COMPRESSION)
+       != Z_OK) {
+        free(raw);
+        free(compressed);
+        return NULL;
+    }
+    put_be32(compressed, HDRLOG_V2_COMPRESSED_COOKIE);
+    put_be32(compressed + 4, compressed_size);
+
+    char *encoded = base64_encode(compressed, 8 + compressed_size);
+    free(raw);
+    free(compressed);
+    return encoded;
+#else
+    (void)h;
+    (void)encode_v2;
+    (void)base64_encode;
+    return NULL;
+#endif
+}
+
+static void *
+hdrlog_thread(void *arg) {
+    struct hdrlog *log = arg;
+
+    pthread_mutex_lock(&log->lock);
+    for(;;) {
+        struct hdrlog_entry *e = TAILQ_FIRST(&log->entries);
+        if(!e) {
+            if(log->terminate) break;
+            pthread_cond_wait(&log->entry_queued, &log->lock);
+            continue;
+        }
+        TAILQ_REMOVE(&log->entries, e, hook);
+        pthread_mutex_unlock(&log->lock);
+
+        char *encoded = hdrlog_encode(e->histogram);
+        if(encoded) {
+            fprintf(log->fp, "Tag=%s,%.3f,%.3f,%.3f,%s\n", e->tag,
+                    e->start_time, e->length, e->max_value, encoded);
+            fflush(log->fp);
+            free(encoded);
+        }
+        free(e->histogram);
+        free(e);
+
+        pthread_mutex_lock(&log->lock);
+    }
+    pthread_mutex_unlock(&log->lock);
+
+    return NULL;
+}
+
+struct hdrlog *
+hdrlog_open(const char *filename, double start_time) {
+#ifndef HAVE_LIBZ
+    (void)filename;
+    (void)start_time;
+    (void)hdrlog_thread;
+    errno = ENOTSUP;
+    return NULL;
+#else
+    FILE *fp = fopen(filename, "w");
+    if(!fp) return NULL;
+
+    char date[64];
+    time_t t = start_time;
+    struct tm tm;
+    strftime(date, sizeof(date), "%a %b %d %H:%M:%S %Z %Y",
+             localtime_r(&t, &tm));
+    fprintf(fp,
+            "#[Logged with tcpkali]\n"
+            "#[Histogram log format version 1.3]\n"
+            "#[StartTime: %.3f (seconds since epoch), %s]\n"
+            "\"StartTimestamp\",\"Interval_Length\",\"Interval_Max\","
+            "\"Interval_Compressed_Histogram\"\n",
+            start_time, date);
+    fflush(fp);
+
+    struct hdrlog *log = calloc(1, sizeof(*log));
+    assert(log);
+    log->fp = fp;
+    log->start_time = start_time;
+    TAILQ_INIT(&log->entries);
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->entry_queued, NULL);
+
+    int rc = pthread_create(&log->thread, NULL, hdrlog_thread, log);
+    assert(rc == 0);
+
+    return log;
+#endif
+}
+
+void
+hdrlog_write(struct hdrlog *log, const char *tag, double start_time,
+             double end_time, double max_value_ratio,
+             struct hdr_histogram *h) {
+    struct hdrlog_entry *e = calloc(1, sizeof(*e));
+    assert(e);
+    e->histogram = h;
+    e->tag = tag;
+    e->start_time = start_time - log->start_time;
+    e->length = end_time - start_time;
+    e->max_value = h->total_count ? hdr_max(h) / max_value_ratio : 0.0;
+
+    pthread_mutex_lock(&log->lock);
+    TAILQ_INSERT_TAIL(&log->entries, e, hook);
+    pthread_cond_signal(&log->entry_queued);
+    pthread_mutex_unlock(&log->lock);
+}
+
+void
+hdrlog_close(struct hdrlog *log) {
+    if(!log) return;
+    pthread_mutex_lock(&log->lock);
+    log->terminate = 1;
+    pthread_cond_signal(&log->entry_queued);
+    pthread_mutex_unlock(&log->lock);
+    pthread_join(log->thread, NULL);
+    pthread_cond_destroy(&log->entry_queued);
+    pthread_mutex_destroy(&log->lock);
+    fclose(log->fp);
+    free(log);
+}
+
+#ifdef TCPKALI_HDRLOG_UNIT_TEST
+
+int
+main() {
+    unsigned char buf[9];
+
+    /* ZigZag LEB128 corner cases. */
+    assert(zigzag_encode(buf, 0) == 1 && buf[0] == 0);
+    assert(zigzag_encode(buf, -1) == 1 && buf[0] == 1);
+    assert(zigzag_encode(buf, 1) == 1 && buf[0] == 2);
+    assert(zigzag_encode(buf, 64) == 2 && buf[0] == 0x80 && buf[1] == 1);
+    assert(zigzag_encode(buf, INT64_MIN) == 9 && buf[8] == 0xff);
+
+    char *b64 = base64_encode((const unsigned char *)"tcpkali", 7);
+    assert(strcmp(b64, "dGNwa2FsaQ==") == 0);
+    free(b64);
+
+    struct hdr_histogram *h;
+    int ret = hdr_init(1, 1000000, 3, &h);
+    assert(ret == 0);
+    hdr_record_value(h, 1);
+    hdr_record_values(h, 1000, 5);
+
+    size_t size;
+    unsigned char *raw = encode_v2(h, &size);
+    assert(raw[0] == 0x1c && raw[1] == 0x84 && raw[2] == 0x93
+           && raw[3] == 0x13);
+    /* Counts: 0, 1, a run of zeros, 5. */
+    assert(raw[HDRLOG_V2_HEADER_SIZE] == 0);
+    assert(raw[HDRLOG_V2_HEADER_SIZE + 1] == 2);
+    assert(raw[size - 1] == 10);
+    free(raw);
+
+#ifdef HAVE_LIBZ
+    char *encoded = hdrlog_encode(h);
+    assert(encoded);
+    /* The compressed cookie, as seen in all interval logs. */
+    assert(strncmp(encoded, "HISTFA", 6) == 0);
+    printf("%s\n", encoded);
+    free(encoded);
+#endif
+
+    free(h);
+    return 0;
+}
+
+#endif /* TCPKALI_HDRLOG_UNIT_TEST */
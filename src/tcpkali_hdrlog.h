@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_HDRLOG_H
+#define TCPKALI_HDRLOG_H
+
+#include <hdr_histogram.h>
+
+/*
+ * HdrHistogram interval log (version 1.3) writer, see --latency-log.
+ *
+ * Each interval histogram is recorded as a line with the interval start
+ * (relative to the log start time), length and maximum value, followed by
+ * the base64 representation of the zlib-compressed V2 histogram encoding.
+ * The encoding and writing happen on a background thread.
+ */
+
+struct hdrlog;
+
+/*
+ * Create the log file and write the log header.
+ * Returns NULL and sets errno if the file can't be opened,
+ * or if tcpkali is built without zlib (ENOTSUP).
+ */
+struct hdrlog *hdrlog_open(const char *filename, double start_time);
+
+/*
+ * Queue the interval histogram for writing. The histogram is freed
+ * by the log once written. The tag identifies the latency type.
+ * The maximum value is reported divided by (max_value_ratio).
+ */
+void hdrlog_write(struct hdrlog *, const char *tag, double start_time,
+                  double end_time, double max_value_ratio,
+                  struct hdr_histogram *);
+
+/*
+ * Write the queued histograms, close the file and stop the thread.
+ */
+void hdrlog_close(struct hdrlog *);
+
+/*
+ * Encode the histogram into the compressed V2 encoding, base64'd.
+ * Returns a malloc'ed string or NULL.
+ */
+char *hdrlog_encode(struct hdr_histogram *);
+
+#endif /* TCPKALI_HDRLOG_H */
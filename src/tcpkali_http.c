@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <assert.h>
+
+#include "tcpkali_http.h"
+
+/*
+ * Collect the line up to the LF. Returns 1 once the line is complete,
+ * with the CR stripped and the (line) NUL-terminated.
+ */
+static int
+http_collect_line(struct http_parser *hp, uint8_t **bufp, size_t *sizep) {
+    uint8_t *buf = *bufp;
+    size_t size = *sizep;
+    uint8_t *eol = memchr(buf, '\n', size);
+    size_t take = eol ? (size_t)(eol - buf) : size;
+    size_t room = sizeof(hp->line) - 1 - hp->line_size;
+    size_t keep = take < room ? take : room;
+
+    memcpy(hp->line + hp->line_size, buf, keep);
+    hp->line_size += keep;
+    if(eol) take++;
+    *bufp = buf + take;
+    *sizep = size - take;
+    if(!eol) return 0;
+
+    if(hp->line_size && hp->line[hp->line_size - 1] == '\r') hp->line_size--;
+    hp->line[hp->line_size] = '\0';
+    hp->line_size = 0;
+    return 1;
+}
+
+static int
+http_parse_status_line(struct http_parser *hp) {
+    const char *p = hp->line;
+    if(strncmp(p, "HTTP/", 5) != 0) return -1;
+    p = strchr(p, ' ');
+    if(!p) return -1;
+    while(*p == ' ') p++;
+    unsigned status = 0;
+    for(int i = 0; i < 3; i++, p++) {
+        if(*p < '0' || *p > '9') return -1;
+        status = status * 10 + (*p - '0');
+    }
+    hp->status = status;
+    hp->chunked = 0;
+    hp->content_length_seen = 0;
+    hp->body_left = 0;
+    return 0;
+}
+
+static int
+http_parse_header_line(struct http_parser *hp) {
+    const char *p;
+    if(strncasecmp(hp->line, "Content-Length:", 15) == 0) {
+        uint64_t length = 0;
+        for(p = hp->line + 15; *p == ' ' || *p == '\t'; p++)
+            ;
+        if(*p < '0' || *p > '9') return -1;
+        for(; *p >= '0' && *p <= '9'; p++) {
+            if(length > (UINT64_MAX - 9) / 10) return -1;
+            length = length * 10 + (*p - '0');
+        }
+        hp->content_length_seen = 1;
+        hp->body_left = length;
+    } else if(strncasecmp(hp->line, "Transfer-Encoding:", 18) == 0) {
+        /* The chunked coding is always the last one, RFC 7230, 3.3.1. */
+        size_t len = strlen(hp->line);
+        hp->chunked = len >= 25
+                      && strcasecmp(hp->line + len - 7, "chunked") == 0;
+    }
+    return 0;
+}
+
+static int
+http_parse_chunk_size(struct http_parser *hp) {
+    uint64_t size = 0;
+    const char *p = hp->line;
+    int digits = 0;
+    for(;; p++, digits++) {
+        unsigned d;
+        switch(*p) {
+        case '0' ... '9': d = *p - '0'; break;
+        case 'a' ... 'f': d = *p - 'a' + 10; break;
+        case 'A' ... 'F': d = *p - 'A' + 10; break;
+        default:
+            d = 16;
+        }
+        if(d == 16) break;
+        if(size >> 60) return -1;
+        size = (size << 4) | d;
+    }
+    /* Chunk extensions after ';' are ignored. */
+    if(!digits || (*p && *p != ';' && *p != ' ' && *p != '\t')) return -1;
+    hp->body_left = size;
+    return 0;
+}
+
+/*
+ * The headers are over: figure out where the body ends.
+ */
+static void
+http_headers_end(struct http_parser *hp) {
+    if(hp->status >= 100 && hp->status < 200) {
+        hp->state = HTTPP_STATUS_LINE; /* Interim response */
+    } else if(hp->status == 204 || hp->status == 304) {
+        hp->state = HTTPP_BODY;
+        hp->body_left = 0;
+    } else if(hp->chunked) {
+        hp->state = HTTPP_CHUNK_SIZE;
+    } else if(hp->content_length_seen) {
+        hp->state = HTTPP_BODY;
+    } else {
+        hp->state = HTTPP_BODY_UNTIL_CLOSE;
+    }
+}
+
+enum http_parse_event
+http_parse(struct http_parser *hp, uint8_t **bufp, size_t *sizep,
+           uint8_t **body, size_t *body_size) {
+    uint8_t *buf = *bufp;
+    size_t size = *sizep;
+    enum http_parse_event event = HTTPE_NEED_MORE_DATA;
+
+    while(event == HTTPE_NEED_MORE_DATA) {
+        /* The body is reported before the end of the response. */
+        if(hp->state == HTTPP_BODY && hp->body_left == 0) {
+            hp->state = HTTPP_STATUS_LINE;
+            event = HTTPE_RESPONSE_END;
+            break;
+        }
+        if(!size) break;
+
+        switch(hp->state) {
+        case HTTPP_STATUS_LINE:
+            if(!http_collect_line(hp, &buf, &size)) break;
+            if(http_parse_status_line(hp) != 0) {
+                event = HTTPE_PROTOCOL_ERROR;
+                break;
+            }
+            hp->state = HTTPP_HEADER_LINE;
+            break;
+        case HTTPP_HEADER_LINE:
+            if(!http_collect_line(hp, &buf, &size)) break;
+            if(hp->line[0] == '\0') {
+                http_headers_end(hp);
+            } else if(http_parse_header_line(hp) != 0) {
+                event = HTTPE_PROTOCOL_ERROR;
+            }
+            break;
+        case HTTPP_CHUNK_SIZE:
+            if(!http_collect_line(hp, &buf, &size)) break;
+            if(http_parse_chunk_size(hp) != 0) {
+                event = HTTPE_PROTOCOL_ERROR;
+                break;
+            }
+            hp->state = hp->body_left ? HTTPP_CHUNK_DATA : HTTPP_TRAILER_LINE;
+            break;
+        case HTTPP_CHUNK_END:
+            if(!http_collect_line(hp, &buf, &size)) break;
+            if(hp->line[0] != '\0') {
+                event = HTTPE_PROTOCOL_ERROR;
+                break;
+            }
+            hp->state = HTTPP_CHUNK_SIZE;
+            break;
+        case HTTPP_TRAILER_LINE:
+            if(!http_collect_line(hp, &buf, &size)) break;
+            if(hp->line[0] == '\0') {
+                hp->state = HTTPP_STATUS_LINE;
+                event = HTTPE_RESPONSE_END;
+            }
+            break;
+        case HTTPP_BODY:
+        case HTTPP_CHUNK_DATA: {
+            size_t take = hp->body_left < size ? hp->body_left : size;
+            *body = buf;
+            *body_size = take;
+            event = HTTPE_BODY;
+            buf += take;
+            size -= take;
+            hp->body_left -= take;
+            if(hp->body_left == 0 && hp->state == HTTPP_CHUNK_DATA)
+                hp->state = HTTPP_CHUNK_END;
+        } break;
+        case HTTPP_BODY_UNTIL_CLOSE:
+            *body = buf;
+            *body_size = size;
+            event = HTTPE_BODY;
+            buf += size;
+            size = 0;
+            break;
+        }
+    }
+
+    *bufp = buf;
+    *sizep = size;
+    return event;
+}
+
+#ifdef TCPKALI_HTTP_UNIT_TEST
+
+#include <stdio.h>
+
+int
+main() {
+    static const char *stream =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 5\r\n"
+        "X-Padding: a header line which is longer than the line buffer\r\n"
+        "\r\n"
+        "Hello"
+        "HTTP/1.1 100 Continue\r\n\r\n"
+        "HTTP/1.1 201 Created\r\n"
+        "transfer-encoding: gzip, chunked\r\n"
+        "\r\n"
+        "3;ext=1\r\n, W\r\n"
+        "A\r\norld, and \r\n"
+        "0\r\n"
+        "X-Trailer: yes\r\n"
+        "\r\n"
+        "HTTP/1.0 204 No Content\r\n\r\n"
+        "HTTP/1.1 200 OK\n"
+        "content-length:0\n"
+        "\n"
+        "HTTP/1.1 404 Not Found\r\n"
+        "Content-Length:  4\r\n"
+        "\r\n"
+        "more"
+        "HTTP/1.1 200 OK\r\n"
+        "\r\n"
+        "until the close";
+    const char *expected = "Hello, World, and moreuntil the close";
+    size_t stream_size = strlen(stream);
+
+    for(size_t piece = 1; piece <= stream_size; piece++) {
+        struct http_parser hp;
+        char copy[1024];
+        char received[1024];
+        size_t received_size = 0;
+        int responses = 0;
+        memset(&hp, 0, sizeof(hp));
+        memcpy(copy, stream, stream_size);
+        for(size_t off = 0; off < stream_size; off += piece) {
+            uint8_t *buf = (uint8_t *)copy + off;
+            size_t size = stream_size - off < piece ? stream_size - off : piece;
+            for(;;) {
+                uint8_t *body;
+                size_t body_size;
+                enum http_parse_event ev =
+                    http_parse(&hp, &buf, &size, &body, &body_size);
+                if(ev == HTTPE_NEED_MORE_DATA) break;
+                assert(ev != HTTPE_PROTOCOL_ERROR);
+                if(ev == HTTPE_BODY) {
+                    memcpy(received + received_size, body, body_size);
+                    received_size += body_size;
+                } else {
+                    responses++;
+                }
+            }
+            assert(size == 0);
+        }
+        assert(responses == 5);
+        assert(received_size == strlen(expected));
+        assert(memcmp(received, expected, received_size) == 0);
+    }
+
+    /* Not an HTTP response. */
+    struct http_parser hp;
+    memset(&hp, 0, sizeof(hp));
+    char garbage[] = "SSH-2.0-OpenSSH\r\n";
+    uint8_t *buf = (uint8_t *)garbage;
+    size_t size = sizeof(garbage) - 1;
+    uint8_t *body;
+    size_t body_size;
+    assert(http_parse(&hp, &buf, &size, &body, &body_size)
+           == HTTPE_PROTOCOL_ERROR);
+
+    /* Malformed chunk size. */
+    memset(&hp, 0, sizeof(hp));
+    char badchunk[] =
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n";
+    buf = (uint8_t *)badchunk;
+    size = sizeof(badchunk) - 1;
+    assert(http_parse(&hp, &buf, &size, &body, &body_size)
+           == HTTPE_PROTOCOL_ERROR);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_HTTP_UNIT_TEST */
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_HTTP_H
+#define TCPKALI_HTTP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Only the leading part of the longer header lines is kept,
+ * which is enough for the headers the parser looks at.
+ */
+#define HTTP_PARSER_LINE_MAX 64
+
+/*
+ * Streaming parser of the HTTP/1.x responses, see --http.
+ * The body is delimited by Content-Length or the chunked encoding,
+ * otherwise it lasts until the connection is closed.
+ * The interim 1xx responses are skipped. The parser does not know the
+ * requests, so the responses to HEAD requests can not be parsed.
+ * The parser is zero-initialized.
+ */
+struct http_parser {
+    enum {
+        HTTPP_STATUS_LINE,
+        HTTPP_HEADER_LINE,
+        HTTPP_BODY,            /* Content-Length bytes */
+        HTTPP_BODY_UNTIL_CLOSE,
+        HTTPP_CHUNK_SIZE,
+        HTTPP_CHUNK_DATA,
+        HTTPP_CHUNK_END,       /* CRLF after the chunk data */
+        HTTPP_TRAILER_LINE,
+    } state;
+    char line[HTTP_PARSER_LINE_MAX]; /* The current line, maybe truncated */
+    size_t line_size;
+    unsigned status;         /* Status code of the current response */
+    int chunked;             /* Transfer-Encoding: chunked */
+    int content_length_seen;
+    uint64_t body_left;      /* Bytes of the body or chunk yet to come */
+};
+
+enum http_parse_event {
+    HTTPE_NEED_MORE_DATA, /* The input is exhausted */
+    HTTPE_BODY,           /* A piece of the response body, de-chunked */
+    HTTPE_RESPONSE_END,   /* The response is complete */
+    HTTPE_PROTOCOL_ERROR, /* The input is not an HTTP response stream */
+};
+
+/*
+ * Consume the input until the next event. The body is only returned,
+ * never copied out.
+ */
+enum http_parse_event http_parse(struct http_parser *, uint8_t **buf,
+                                 size_t *size, uint8_t **body,
+                                 size_t *body_size);
+
+#endif /* TCPKALI_HTTP_H */
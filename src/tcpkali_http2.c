@@ -0,0 +1,628 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tcpkali_http2.h"
+
+#define HTTP2_CLIENT_MAGIC "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+
+static void
+put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+size_t
+http2_frame(uint8_t *buf, enum http2_frame_type type, uint8_t flags,
+            uint32_t stream_id, const void *payload, size_t payload_size) {
+    assert(payload_size <= HTTP2_MAX_FRAME_SIZE);
+    buf[0] = payload_size >> 16;
+    buf[1] = payload_size >> 8;
+    buf[2] = payload_size;
+    buf[3] = type;
+    buf[4] = flags;
+    put_u32(&buf[5], stream_id & HTTP2_MAX_STREAM_ID);
+    if(payload_size) memcpy(buf + HTTP2_FRAME_HEADER_SIZE, payload, payload_size);
+    return HTTP2_FRAME_HEADER_SIZE + payload_size;
+}
+
+size_t
+http2_client_preface(uint8_t *buf) {
+    uint8_t *p = buf;
+    uint8_t settings[3 * 6];
+
+    memcpy(p, HTTP2_CLIENT_MAGIC, sizeof(HTTP2_CLIENT_MAGIC) - 1);
+    p += sizeof(HTTP2_CLIENT_MAGIC) - 1;
+
+    /* No server push; the stream windows are never to be replenished. */
+    settings[0] = 0;
+    settings[1] = H2S_ENABLE_PUSH;
+    put_u32(&settings[2], 0);
+    settings[6] = 0;
+    settings[7] = H2S_INITIAL_WINDOW_SIZE;
+    put_u32(&settings[8], HTTP2_MAX_STREAM_ID);
+    /* No dynamic table in the responses, see http2_find_header(). */
+    settings[12] = 0;
+    settings[13] = H2S_HEADER_TABLE_SIZE;
+    put_u32(&settings[14], 0);
+    p += http2_frame(p, H2F_SETTINGS, 0, 0, settings, sizeof(settings));
+
+    /* The connection window starts at 65535 regardless of SETTINGS. */
+    uint8_t increment[4];
+    put_u32(increment, HTTP2_MAX_STREAM_ID - 65535);
+    p += http2_frame(p, H2F_WINDOW_UPDATE, 0, 0, increment, sizeof(increment));
+
+    assert(p - buf <= HTTP2_PREFACE_MAX);
+    return p - buf;
+}
+
+/*
+ * RFC 7541, 5.1: an integer with a (prefix_bits) prefix,
+ * the rest of the first byte is taken from (first_byte).
+ */
+static size_t
+hpack_integer(uint8_t *buf, int prefix_bits, uint8_t first_byte,
+              size_t value) {
+    size_t max_prefix = (1 << prefix_bits) - 1;
+    uint8_t *p = buf;
+
+    if(value < max_prefix) {
+        *p++ = first_byte | value;
+        return 1;
+    }
+    *p++ = first_byte | max_prefix;
+    for(value -= max_prefix; value >= 128; value >>= 7) {
+        *p++ = 0x80 | (value & 0x7f);
+    }
+    *p++ = value;
+    return p - buf;
+}
+
+/*
+ * Literal Header Field Never Indexed, with the name from the static table.
+ */
+static size_t
+hpack_literal(uint8_t *buf, unsigned static_name_index, const char *value) {
+    size_t value_size = strlen(value);
+    uint8_t *p = buf;
+    p += hpack_integer(p, 4, 0x10, static_name_index);
+    p += hpack_integer(p, 7, 0x00, value_size); /* Not Huffman encoded */
+    memcpy(p, value, value_size);
+    return (p - buf) + value_size;
+}
+
+size_t
+http2_request_headers_estimate(const char *authority, const char *path) {
+    /* Two indexed fields, two literals with up to 6 length bytes each. */
+    return 2 + 2 * 7 + strlen(authority) + strlen(path);
+}
+
+size_t
+http2_request_headers(uint8_t *buf, int post, int https,
+                      const char *authority, const char *path) {
+    uint8_t *p = buf;
+
+    /* RFC 7541, Appendix A: the static table indexes. */
+    *p++ = 0x80 | (post ? 3 : 2); /* :method GET or POST */
+    *p++ = 0x80 | (https ? 7 : 6); /* :scheme http or https */
+    if(strcmp(path, "/") == 0)
+        *p++ = 0x80 | 4; /* :path / */
+    else
+        p += hpack_literal(p, 4, path);
+    p += hpack_literal(p, 1, authority);
+
+    assert((size_t)(p - buf) <= http2_request_headers_estimate(authority, path));
+    return p - buf;
+}
+
+size_t
+http2_header_field_estimate(const char *name, const char *value) {
+    /* The representation byte, two lengths up to 6 bytes each. */
+    return 1 + 2 * 6 + strlen(name) + strlen(value);
+}
+
+size_t
+http2_header_field(uint8_t *buf, const char *name, const char *value) {
+    size_t name_size = strlen(name);
+    size_t value_size = strlen(value);
+    uint8_t *p = buf;
+
+    *p++ = 0x10; /* Literal Header Field Never Indexed, New Name */
+    p += hpack_integer(p, 7, 0x00, name_size);
+    memcpy(p, name, name_size);
+    p += name_size;
+    p += hpack_integer(p, 7, 0x00, value_size);
+    memcpy(p, value, value_size);
+    p += value_size;
+
+    assert((size_t)(p - buf) <= http2_header_field_estimate(name, value));
+    return p - buf;
+}
+
+size_t
+http2_frame_request(uint8_t *buf, const uint8_t *headers, size_t headers_size,
+                    const uint8_t *body, size_t body_size) {
+    uint8_t *p = buf;
+    p += http2_frame(p, H2F_HEADERS,
+                     H2FL_END_HEADERS | (body_size ? 0 : H2FL_END_STREAM), 0,
+                     headers, headers_size);
+    if(body_size)
+        p += http2_frame(p, H2F_DATA, H2FL_END_STREAM, 0, body, body_size);
+    assert((size_t)(p - buf) == HTTP2_REQUEST_SIZE(headers_size, body_size));
+    return p - buf;
+}
+
+void
+http2_number_request(uint8_t *request, size_t size, uint32_t stream_id) {
+    size_t off = 0;
+    while(off + HTTP2_FRAME_HEADER_SIZE <= size) {
+        uint8_t *h = request + off;
+        size_t length = ((size_t)h[0] << 16) | (h[1] << 8) | h[2];
+        put_u32(&h[5], stream_id & HTTP2_MAX_STREAM_ID);
+        off += HTTP2_FRAME_HEADER_SIZE + length;
+    }
+}
+
+enum http2_parse_event
+http2_parse(struct http2_parser *hp, uint8_t **bufp, size_t *sizep) {
+    uint8_t *buf = *bufp;
+    size_t size = *sizep;
+    enum http2_parse_event event = H2E_NEED_MORE_DATA;
+
+    hp->data_size = 0;
+    if(hp->header_size < HTTP2_FRAME_HEADER_SIZE) {
+        size_t take = HTTP2_FRAME_HEADER_SIZE - hp->header_size;
+        if(take > size) take = size;
+        memcpy(hp->header + hp->header_size, buf, take);
+        hp->header_size += take;
+        buf += take;
+        size -= take;
+        if(hp->header_size < HTTP2_FRAME_HEADER_SIZE) goto out;
+
+        const uint8_t *h = hp->header;
+        hp->length = ((uint32_t)h[0] << 16) | (h[1] << 8) | h[2];
+        hp->type = h[3];
+        hp->flags = h[4];
+        hp->stream_id = (((uint32_t)h[5] << 24) | (h[6] << 16) | (h[7] << 8)
+                         | h[8])
+                        & HTTP2_MAX_STREAM_ID;
+        /* An HTTP/1.x response would also look like an overly long frame. */
+        if(hp->length > HTTP2_MAX_FRAME_SIZE) {
+            event = H2E_PROTOCOL_ERROR;
+            goto out;
+        }
+        hp->payload_left = hp->length;
+        hp->payload_size = 0;
+        if(hp->type == H2F_HEADERS) hp->block_size = 0;
+    }
+
+    if(hp->payload_left) {
+        size_t take = hp->payload_left < size ? hp->payload_left : size;
+        switch(hp->type) {
+        case H2F_DATA:
+            hp->data = buf;
+            hp->data_size = take;
+            break;
+        case H2F_HEADERS:
+            if(hp->block) {
+                size_t room = hp->block_max - hp->block_size;
+                size_t keep = take < room ? take : room;
+                memcpy(hp->block + hp->block_size, buf, keep);
+                hp->block_size += keep;
+            }
+            break;
+        case H2F_CONTINUATION:
+            break;
+        default: {
+            size_t room = sizeof(hp->payload) - hp->payload_size;
+            size_t keep = take < room ? take : room;
+            memcpy(hp->payload + hp->payload_size, buf, keep);
+            hp->payload_size += keep;
+        }
+        }
+        buf += take;
+        size -= take;
+        hp->payload_left -= take;
+        if(hp->payload_left) goto out;
+    }
+
+    hp->header_size = 0;
+    event = H2E_FRAME;
+out:
+    *bufp = buf;
+    *sizep = size;
+    return event;
+}
+
+uint32_t
+http2_payload_u32(const struct http2_parser *hp, size_t offset) {
+    if(offset + 4 > hp->payload_size) return 0;
+    const uint8_t *p = hp->payload + offset;
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+const uint8_t *
+http2_header_block(const struct http2_parser *hp, size_t *sizep) {
+    const uint8_t *block = hp->block;
+    size_t size = hp->block_size;
+    size_t pad = 0;
+
+    if(hp->flags & H2FL_PADDED) {
+        if(size < 1) goto empty;
+        pad = block[0];
+        block++;
+        size--;
+    }
+    if(hp->flags & H2FL_PRIORITY) {
+        if(size < 5) goto empty;
+        block += 5;
+        size -= 5;
+    }
+    /* The padding is at the end of the frame, which may be cut off. */
+    size_t fields_size = (block - hp->block) + pad <= hp->length
+                             ? hp->length - (block - hp->block) - pad
+                             : 0;
+    if(size > fields_size) size = fields_size;
+    *sizep = size;
+    return block;
+empty:
+    *sizep = 0;
+    return hp->block;
+}
+
+/*
+ * RFC 7541, Appendix B: the Huffman code is canonical, so it is described
+ * by the number of codes of each length and the symbols in the code order.
+ */
+static const uint8_t hpack_huffman_counts[31] = {
+    0, 0, 0, 0,  0, 10, 26, 32, 6,  0, 5,  3,  2,  6, 2, 3,
+    0, 0, 0, 3,  8, 13, 26, 29, 12, 4, 15, 19, 29, 0, 3};
+static const uint8_t hpack_huffman_symbols[256] = {
+    48, 49, 50, 97, 99, 101, 105, 111, 115, 116, 32, 37, 45, 46, 47, 51, 52,
+    53, 54, 55, 56, 57, 61, 65, 95, 98, 100, 102, 103, 104, 108, 109, 110,
+    112, 114, 117, 58, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79,
+    80, 81, 82, 83, 84, 85, 86, 87, 89, 106, 107, 113, 118, 119, 120, 121,
+    122, 38, 42, 44, 59, 88, 90, 33, 34, 40, 41, 63, 39, 43, 124, 35, 62, 0,
+    36, 64, 91, 93, 126, 94, 125, 60, 96, 123, 92, 195, 208, 128, 130, 131,
+    162, 184, 194, 224, 226, 153, 161, 167, 172, 176, 177, 179, 209, 216, 217,
+    227, 229, 230, 129, 132, 133, 134, 136, 146, 154, 156, 160, 163, 164, 169,
+    170, 173, 178, 181, 185, 186, 187, 189, 190, 196, 198, 228, 232, 233, 1,
+    135, 137, 138, 139, 140, 141, 143, 147, 149, 150, 151, 152, 155, 157, 158,
+    165, 166, 168, 174, 175, 180, 182, 183, 188, 191, 197, 231, 239, 9, 142,
+    144, 145, 148, 159, 171, 206, 215, 225, 236, 237, 199, 207, 234, 235, 192,
+    193, 200, 201, 202, 205, 210, 213, 218, 219, 238, 240, 242, 243, 255, 203,
+    204, 211, 212, 214, 221, 222, 223, 241, 244, 245, 246, 247, 248, 250, 251,
+    252, 253, 254, 2, 3, 4, 5, 6, 7, 8, 11, 12, 14, 15, 16, 17, 18, 19, 20,
+    21, 23, 24, 25, 26, 27, 28, 29, 30, 31, 127, 220, 249, 10, 13, 22};
+
+/*
+ * RFC 7541, 5.1: decode an integer with a (prefix_bits) prefix.
+ * Returns -1 if the input ends before the integer does.
+ */
+static int
+hpack_decode_integer(const uint8_t **pp, const uint8_t *end, int prefix_bits,
+                     size_t *value) {
+    const uint8_t *p = *pp;
+    size_t max_prefix = (1 << prefix_bits) - 1;
+
+    if(p == end) return -1;
+    *value = *p++ & max_prefix;
+    if(*value == max_prefix) {
+        for(unsigned shift = 0;; shift += 7) {
+            if(p == end || shift > 28) return -1;
+            *value += (size_t)(*p & 0x7f) << shift;
+            if(!(*p++ & 0x80)) break;
+        }
+    }
+    *pp = p;
+    return 0;
+}
+
+/*
+ * Decode the Huffman coded string into (out), up to (out_size) bytes.
+ * Returns the decoded length, or -1 if the code is invalid
+ * or does not fit.
+ */
+static int
+hpack_huffman_decode(const uint8_t *in, size_t in_size, char *out,
+                     size_t out_size) {
+    size_t out_len = 0;
+    unsigned code = 0;  /* Bits of the current symbol */
+    unsigned first = 0; /* First code of the current length */
+    unsigned index = 0; /* Index of the first symbol of the current length */
+    unsigned len = 0;
+
+    for(size_t i = 0; i < in_size; i++) {
+        for(int bit = 7; bit >= 0; bit--) {
+            code |= (in[i] >> bit) & 1;
+            len++;
+            unsigned count = hpack_huffman_counts[len];
+            if(code - first < count) {
+                if(out_len == out_size) return -1;
+                out[out_len++] = hpack_huffman_symbols[index + code - first];
+                code = first = index = len = 0;
+                continue;
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+            if(len == 30) return -1; /* EOS or no such code */
+        }
+    }
+
+    /* Up to 7 bits of the EOS code prefix, that is, ones, pad the end. */
+    if(len > 7 || code != ((1u << len) - 1) << 1) return -1;
+    return out_len;
+}
+
+/*
+ * Decode the string literal into (out). Returns the decoded length,
+ * -1 if the input ends before the string does, or -2 if the string
+ * does not fit (out_size); it is skipped over then.
+ */
+static int
+hpack_decode_string(const uint8_t **pp, const uint8_t *end, char *out,
+                    size_t out_size) {
+    const uint8_t *p = *pp;
+    int huffman = p < end && (*p & 0x80);
+    size_t size;
+
+    if(hpack_decode_integer(&p, end, 7, &size) == -1) return -1;
+    if(size > (size_t)(end - p)) return -1;
+    *pp = p + size;
+    if(huffman) {
+        int len = hpack_huffman_decode(p, size, out, out_size);
+        return len == -1 ? -2 : len;
+    } else if(size > out_size) {
+        return -2;
+    } else {
+        memcpy(out, p, size);
+        return size;
+    }
+}
+
+int
+http2_find_header(const uint8_t *block, size_t size, const char *name,
+                  char *value, size_t value_size) {
+    const uint8_t *p = block;
+    const uint8_t *end = block + size;
+    size_t name_size = strlen(name);
+    char field_name[64];
+    size_t index;
+
+    assert(name_size <= sizeof(field_name) && value_size > 0);
+
+    while(p < end) {
+        int prefix_bits;
+        if(*p & 0x80) { /* Indexed Header Field */
+            if(hpack_decode_integer(&p, end, 7, &index) == -1) return -1;
+            continue;
+        } else if(*p & 0x40) { /* Literal with Incremental Indexing */
+            prefix_bits = 6;
+        } else if(*p & 0x20) { /* Dynamic Table Size Update */
+            if(hpack_decode_integer(&p, end, 5, &index) == -1) return -1;
+            continue;
+        } else { /* Literal without Indexing or Never Indexed */
+            prefix_bits = 4;
+        }
+
+        if(hpack_decode_integer(&p, end, prefix_bits, &index) == -1)
+            return -1;
+        int matches = 0;
+        if(index == 0) {
+            int len = hpack_decode_string(&p, end, field_name,
+                                          sizeof(field_name));
+            if(len == -1) return -1;
+            matches = (size_t)len == name_size
+                      && memcmp(field_name, name, name_size) == 0;
+        }
+        int len = hpack_decode_string(&p, end, value, value_size - 1);
+        if(len == -1) return -1;
+        if(matches) {
+            if(len < 0) return -1; /* Does not fit the (value) */
+            value[len] = '\0';
+            return len;
+        }
+    }
+
+    return -1;
+}
+
+#ifdef TCPKALI_HTTP2_UNIT_TEST
+
+#include <stdio.h>
+
+int
+main() {
+    uint8_t stream[1024];
+    uint8_t *p = stream;
+
+    /* The well known header block. */
+    uint8_t hdrs[128];
+    size_t hdrs_size = http2_request_headers(hdrs, 0, 0, "example.com", "/");
+    static const uint8_t example[] = {0x82, 0x86, 0x84, 0x11, 11, 'e',
+                                      'x',  'a',  'm',  'p',  'l', 'e',
+                                      '.',  'c',  'o',  'm'};
+    assert(hdrs_size == sizeof(example));
+    assert(memcmp(hdrs, example, sizeof(example)) == 0);
+
+    /* Longer than the 7-bit string length prefix. */
+    char path[200];
+    memset(path, 'a', sizeof(path));
+    path[0] = '/';
+    path[sizeof(path) - 1] = '\0';
+    hdrs_size = http2_request_headers(hdrs, 1, 1, "h", path);
+    assert(hdrs[0] == 0x83 && hdrs[1] == 0x87 && hdrs[2] == 0x14);
+    assert(hdrs[3] == 0x7f && hdrs[4] == 199 - 127 && hdrs[5] == '/');
+    assert(hdrs_size == 2 + 3 + 199 + 3);
+    hdrs_size = http2_request_headers(hdrs, 1, 0, "localhost:8080", "/index");
+
+    /* Preface, then two requests with a body. */
+    size_t preface_size = http2_client_preface(p);
+    assert(memcmp(p, HTTP2_CLIENT_MAGIC, 24) == 0);
+    p += preface_size;
+    for(uint32_t id = 1; id <= 3; id += 2) {
+        size_t size = http2_frame_request(p, hdrs, hdrs_size,
+                                          (const uint8_t *)"body", 4);
+        assert(size == HTTP2_REQUEST_SIZE(hdrs_size, 4));
+        http2_number_request(p, size, id);
+        p += size;
+    }
+    /* A request without a body. */
+    p += http2_frame_request(p, hdrs, hdrs_size, NULL, 0);
+    http2_number_request(p - HTTP2_REQUEST_SIZE(hdrs_size, 0),
+                         HTTP2_REQUEST_SIZE(hdrs_size, 0), 5);
+    size_t stream_size = p - stream;
+
+    static const struct {
+        enum http2_frame_type type;
+        uint8_t flags;
+        uint32_t stream_id;
+    } expected[] = {
+        {H2F_SETTINGS, 0, 0},
+        {H2F_WINDOW_UPDATE, 0, 0},
+        {H2F_HEADERS, H2FL_END_HEADERS, 1},
+        {H2F_DATA, H2FL_END_STREAM, 1},
+        {H2F_HEADERS, H2FL_END_HEADERS, 3},
+        {H2F_DATA, H2FL_END_STREAM, 3},
+        {H2F_HEADERS, H2FL_END_HEADERS | H2FL_END_STREAM, 5},
+    };
+    const size_t expected_frames = sizeof(expected) / sizeof(expected[0]);
+
+    for(size_t piece = 1; piece <= stream_size; piece++) {
+        struct http2_parser hp;
+        size_t frames = 0;
+        memset(&hp, 0, sizeof(hp));
+        for(size_t off = 24; off < stream_size; off += piece) {
+            uint8_t *buf = stream + off;
+            size_t size = stream_size - off < piece ? stream_size - off : piece;
+            for(;;) {
+                enum http2_parse_event ev = http2_parse(&hp, &buf, &size);
+                if(ev == H2E_NEED_MORE_DATA) break;
+                assert(ev == H2E_FRAME);
+                assert(frames < expected_frames);
+                assert(hp.type == expected[frames].type);
+                assert(hp.flags == expected[frames].flags);
+                assert(hp.stream_id == expected[frames].stream_id);
+                switch(hp.type) {
+                case H2F_SETTINGS:
+                    assert(hp.length == 18);
+                    assert(http2_payload_u32(&hp, 14) == 0);
+                    assert(http2_payload_u32(&hp, 8) == HTTP2_MAX_STREAM_ID);
+                    assert(http2_payload_u32(&hp, 2) == 0);
+                    break;
+                case H2F_WINDOW_UPDATE:
+                    assert(http2_payload_u32(&hp, 0)
+                           == HTTP2_MAX_STREAM_ID - 65535);
+                    break;
+                case H2F_DATA:
+                    assert(hp.length == 4 && hp.payload_size == 0);
+                    break;
+                default:
+                    assert(hp.length == hdrs_size);
+                }
+                frames++;
+            }
+            assert(size == 0);
+        }
+        assert(frames == expected_frames);
+    }
+
+    /* Not an HTTP/2 server. */
+    struct http2_parser hp;
+    memset(&hp, 0, sizeof(hp));
+    char garbage[] = "HTTP/1.1 400 Bad Request\r\n";
+    uint8_t *buf = (uint8_t *)garbage;
+    size_t size = sizeof(garbage) - 1;
+    assert(http2_parse(&hp, &buf, &size) == H2E_PROTOCOL_ERROR);
+
+    /* RFC 7541, C.4.3: Huffman coded literals after an indexed field. */
+    static const uint8_t huffman_block[] = {
+        0x82, 0x87, 0x85, 0xbf, 0x40, 0x88, 0x25, 0xa8, 0x49, 0xe9, 0x5b,
+        0xa9, 0x7d, 0x7f, 0x89, 0x25, 0xa8, 0x49, 0xe9, 0x5b, 0xb8, 0xe8,
+        0xb4, 0xbf};
+    char value[32];
+    assert(http2_find_header(huffman_block, sizeof(huffman_block),
+                             "custom-key", value, sizeof(value))
+           == 12);
+    assert(strcmp(value, "custom-value") == 0);
+    assert(http2_find_header(huffman_block, sizeof(huffman_block),
+                             "custom", value, sizeof(value))
+           == -1);
+    assert(http2_find_header(huffman_block, sizeof(huffman_block) - 1,
+                             "custom-key", value, sizeof(value))
+           == -1);
+
+    /* The gRPC trailers, after a table size update, in a padded frame. */
+    uint8_t trailers[64];
+    uint8_t *t = trailers;
+    *t++ = 3;    /* Pad length */
+    *t++ = 0x20; /* Dynamic Table Size Update to 0 */
+    t += http2_header_field(t, "grpc-status", "14");
+    t += http2_header_field(t, "grpc-message", "unavailable");
+    memset(t, 0, 3);
+    t += 3;
+    p = stream;
+    p += http2_frame(p, H2F_HEADERS,
+                     H2FL_END_HEADERS | H2FL_END_STREAM | H2FL_PADDED, 1,
+                     trailers, t - trailers);
+    memset(&hp, 0, sizeof(hp));
+    uint8_t block[24];
+    hp.block = block;
+    hp.block_max = sizeof(block);
+    buf = stream;
+    size = p - stream;
+    assert(http2_parse(&hp, &buf, &size) == H2E_FRAME && size == 0);
+    size_t block_size;
+    const uint8_t *fields = http2_header_block(&hp, &block_size);
+    assert(fields == block + 1 && block_size == sizeof(block) - 1);
+    assert(http2_find_header(fields, block_size, "grpc-status", value,
+                             sizeof(value))
+           == 2);
+    assert(strcmp(value, "14") == 0);
+    assert(http2_find_header(fields, block_size, "grpc-message", value,
+                             sizeof(value))
+           == -1);
+    hp.block_max = sizeof(trailers);
+    hp.block = trailers;
+    hp.block_size = t - trailers;
+    fields = http2_header_block(&hp, &block_size);
+    assert(block_size == (size_t)(t - trailers) - 1 - 3);
+    assert(http2_find_header(fields, block_size, "grpc-message", value,
+                             sizeof(value))
+           == 11);
+    assert(strcmp(value, "unavailable") == 0);
+    assert(http2_find_header(fields, block_size, "grpc-message", value, 8)
+           == -1);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_HTTP2_UNIT_TEST */
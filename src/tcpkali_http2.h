@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_HTTP2_H
+#define TCPKALI_HTTP2_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HTTP2_FRAME_HEADER_SIZE 9
+#define HTTP2_MAX_FRAME_SIZE 16384 /* SETTINGS_MAX_FRAME_SIZE default */
+#define HTTP2_MAX_STREAM_ID 0x7fffffff
+
+enum http2_frame_type {
+    H2F_DATA = 0x0,
+    H2F_HEADERS = 0x1,
+    H2F_PRIORITY = 0x2,
+    H2F_RST_STREAM = 0x3,
+    H2F_SETTINGS = 0x4,
+    H2F_PUSH_PROMISE = 0x5,
+    H2F_PING = 0x6,
+    H2F_GOAWAY = 0x7,
+    H2F_WINDOW_UPDATE = 0x8,
+    H2F_CONTINUATION = 0x9,
+};
+
+enum http2_frame_flags {
+    H2FL_END_STREAM = 0x1, /* DATA, HEADERS */
+    H2FL_ACK = 0x1,        /* SETTINGS, PING */
+    H2FL_END_HEADERS = 0x4,
+    H2FL_PADDED = 0x8,     /* DATA, HEADERS */
+    H2FL_PRIORITY = 0x20,  /* HEADERS */
+};
+
+enum http2_settings {
+    H2S_HEADER_TABLE_SIZE = 0x1,
+    H2S_ENABLE_PUSH = 0x2,
+    H2S_MAX_CONCURRENT_STREAMS = 0x3,
+    H2S_INITIAL_WINDOW_SIZE = 0x4,
+};
+
+/*
+ * The connection preface, our SETTINGS and a WINDOW_UPDATE which opens up
+ * the connection receive window. The SETTINGS keep the server from using
+ * the HPACK dynamic table, so that the response headers could be looked
+ * into without following the table, see http2_find_header().
+ * Returns the number of bytes written into (buf), which must have
+ * HTTP2_PREFACE_MAX bytes of space.
+ */
+#define HTTP2_PREFACE_MAX 128
+size_t http2_client_preface(uint8_t *buf);
+
+/*
+ * Put the HPACK encoded request headers into (buf), which must have
+ * http2_request_headers_estimate() bytes of space. The headers are
+ * literals which are never indexed, so the same block can be sent
+ * on any stream of any connection. Returns the block size.
+ */
+size_t http2_request_headers_estimate(const char *authority, const char *path);
+size_t http2_request_headers(uint8_t *buf, int post, int https,
+                             const char *authority, const char *path);
+
+/*
+ * Put a literal header field, never indexed, into (buf), which must have
+ * http2_header_field_estimate() bytes of space. The fields are appended
+ * to the request header block. Returns the field size.
+ */
+size_t http2_header_field_estimate(const char *name, const char *value);
+size_t http2_header_field(uint8_t *buf, const char *name, const char *value);
+
+/*
+ * Frame the request: the HEADERS frame with the header block,
+ * followed by the DATA frame with the (body), if any.
+ * Returns the number of bytes written into (buf), which must have
+ * HTTP2_REQUEST_SIZE(headers_size, body_size) bytes of space.
+ * The stream identifiers are left zero, see http2_number_request().
+ */
+#define HTTP2_REQUEST_SIZE(headers_size, body_size) \
+    (HTTP2_FRAME_HEADER_SIZE + (headers_size)       \
+     + ((body_size) ? HTTP2_FRAME_HEADER_SIZE + (body_size) : 0))
+size_t http2_frame_request(uint8_t *buf, const uint8_t *headers,
+                           size_t headers_size, const uint8_t *body,
+                           size_t body_size);
+
+/*
+ * Set the stream identifier of all the frames of a framed request.
+ */
+void http2_number_request(uint8_t *request, size_t size, uint32_t stream_id);
+
+/*
+ * Put a control frame with the given payload into (buf), which must have
+ * HTTP2_FRAME_HEADER_SIZE + (payload_size) bytes of space.
+ * Returns the frame size.
+ */
+size_t http2_frame(uint8_t *buf, enum http2_frame_type, uint8_t flags,
+                   uint32_t stream_id, const void *payload,
+                   size_t payload_size);
+
+/*
+ * Only the beginning of the frame payload is kept for the frames
+ * other than DATA, HEADERS and CONTINUATION, which is enough
+ * for the SETTINGS, PING, RST_STREAM, WINDOW_UPDATE and GOAWAY frames.
+ */
+#define HTTP2_PARSER_PAYLOAD_MAX 64
+
+/*
+ * Streaming parser of the incoming HTTP/2 frames, see --http2.
+ * The parser is zero-initialized.
+ */
+struct http2_parser {
+    uint8_t header[HTTP2_FRAME_HEADER_SIZE];
+    size_t header_size; /* Collected (header) bytes */
+    uint32_t length;    /* Payload length of the current frame */
+    enum http2_frame_type type;
+    uint8_t flags;
+    uint32_t stream_id;
+    uint32_t payload_left; /* Payload bytes to skip or keep */
+    uint8_t payload[HTTP2_PARSER_PAYLOAD_MAX];
+    size_t payload_size; /* Kept (payload) bytes */
+    /* The HEADERS payload is kept in the (block), if it is given. */
+    uint8_t *block;
+    size_t block_max;
+    size_t block_size;
+    /* The DATA payload passed over by the last http2_parse() call. */
+    const uint8_t *data;
+    size_t data_size;
+};
+
+enum http2_parse_event {
+    H2E_NEED_MORE_DATA, /* The input is exhausted */
+    H2E_FRAME,          /* The frame described by the parser has ended */
+    H2E_PROTOCOL_ERROR, /* The input is not an HTTP/2 frame stream */
+};
+
+/*
+ * Consume the input until the end of the next frame.
+ */
+enum http2_parse_event http2_parse(struct http2_parser *, uint8_t **buf,
+                                   size_t *size);
+
+/*
+ * Read the 32-bit network order value, such as the SETTINGS value
+ * or the WINDOW_UPDATE increment, at the given offset of the kept payload.
+ * Returns 0 if the payload is not that long.
+ */
+uint32_t http2_payload_u32(const struct http2_parser *, size_t offset);
+
+/*
+ * The header block of the HEADERS frame which has ended, without the
+ * padding and priority fields. It is cut short to (block_max) bytes.
+ */
+const uint8_t *http2_header_block(const struct http2_parser *, size_t *size);
+
+/*
+ * Find the header field of the (name), such as the "grpc-status" trailer,
+ * in the received HPACK block. The dynamic table is not followed, and the
+ * names of the static table are not matched: only the literal names are.
+ * The value is copied into (value), terminated, if it is short enough.
+ * Returns the value length, or -1 if the field is not there, its value
+ * does not fit or the block ends before it.
+ */
+int http2_find_header(const uint8_t *block, size_t size, const char *name,
+                      char *value, size_t value_size);
+
+#endif /* TCPKALI_HTTP2_H */
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/mman.h>
+
+#include "tcpkali_hugepage.h"
+
+#define TK_HUGE_ALIGNMENT 64
+#define TK_HUGE_CLASSES_MAX 32 /* Different object sizes */
+
+struct huge_chunk {
+    struct huge_chunk *next;
+    void *mapping;
+    size_t mapping_size;
+};
+
+struct huge_free_object {
+    struct huge_free_object *next;
+};
+
+struct tk_huge_arena {
+    struct huge_class {
+        size_t size; /* Rounded up to TK_HUGE_ALIGNMENT */
+        struct huge_free_object *free_list;
+        char *bump;     /* The rest of the newest chunk of this size */
+        char *bump_end;
+    } classes[TK_HUGE_CLASSES_MAX];
+    int classes_count;
+    struct huge_chunk *chunks;
+    size_t hugetlb_chunks;
+    size_t thp_chunks;
+};
+
+struct tk_huge_arena *
+tk_huge_arena_new(void) {
+    struct tk_huge_arena *arena = calloc(1, sizeof(*arena));
+    assert(arena);
+    return arena;
+}
+
+/*
+ * Map a 2MB-aligned chunk, from the reserved huge pages if possible.
+ */
+static void *
+huge_chunk_map(struct tk_huge_arena *arena) {
+    struct huge_chunk *chunk = malloc(sizeof(*chunk));
+    if(!chunk) return NULL;
+
+    void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    p = mmap(NULL, TK_HUGE_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if(p != MAP_FAILED) {
+        chunk->mapping = p;
+        chunk->mapping_size = TK_HUGE_CHUNK_SIZE;
+        arena->hugetlb_chunks++;
+    } else {
+        /*
+         * The transparent huge pages need the 2MB alignment,
+         * so map twice as much and use the aligned part of it.
+         */
+        size_t size = 2 * TK_HUGE_CHUNK_SIZE;
+        char *m = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(m == MAP_FAILED) {
+            free(chunk);
+            return NULL;
+        }
+        chunk->mapping = m;
+        chunk->mapping_size = size;
+        p = (void *)(((uintptr_t)m + TK_HUGE_CHUNK_SIZE - 1)
+                     & ~(uintptr_t)(TK_HUGE_CHUNK_SIZE - 1));
+#ifdef MADV_HUGEPAGE
+        (void)madvise(p, TK_HUGE_CHUNK_SIZE, MADV_HUGEPAGE);
+#endif
+        arena->thp_chunks++;
+    }
+
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    return p;
+}
+
+static struct huge_class *
+huge_class(struct tk_huge_arena *arena, size_t size) {
+    for(int i = 0; i < arena->classes_count; i++) {
+        if(arena->classes[i].size == size) return &arena->classes[i];
+    }
+    if(arena->classes_count == TK_HUGE_CLASSES_MAX) return NULL;
+    struct huge_class *hc = &arena->classes[arena->classes_count++];
+    hc->size = size;
+    return hc;
+}
+
+void *
+tk_huge_alloc(struct tk_huge_arena *arena, size_t size) {
+    size = (size + TK_HUGE_ALIGNMENT - 1) & ~(size_t)(TK_HUGE_ALIGNMENT - 1);
+    if(size == 0 || size > TK_HUGE_OBJECT_MAX) return NULL;
+
+    struct huge_class *hc = huge_class(arena, size);
+    if(!hc) return NULL;
+
+    if(hc->free_list) {
+        struct huge_free_object *obj = hc->free_list;
+        hc->free_list = obj->next;
+        return obj;
+    }
+
+    if(hc->bump_end - hc->bump < (ptrdiff_t)size) {
+        char *p = huge_chunk_map(arena);
+        if(!p) return NULL;
+        hc->bump = p;
+        hc->bump_end = p + TK_HUGE_CHUNK_SIZE;
+    }
+    void *obj = hc->bump;
+    hc->bump += size;
+    return obj;
+}
+
+void
+tk_huge_free(struct tk_huge_arena *arena, void *ptr, size_t size) {
+    if(!ptr) return;
+    size = (size + TK_HUGE_ALIGNMENT - 1) & ~(size_t)(TK_HUGE_ALIGNMENT - 1);
+    struct huge_class *hc = huge_class(arena, size);
+    /* Another arena knew more sizes: forget the object until the end. */
+    if(!hc) return;
+    struct huge_free_object *obj = ptr;
+    obj->next = hc->free_list;
+    hc->free_list = obj;
+}
+
+void
+tk_huge_arena_stats(const struct tk_huge_arena *arena, size_t *hugetlb_chunks,
+                    size_t *thp_chunks) {
+    *hugetlb_chunks = arena->hugetlb_chunks;
+    *thp_chunks = arena->thp_chunks;
+}
+
+void
+tk_huge_arena_free(struct tk_huge_arena *arena) {
+    if(!arena) return;
+    struct huge_chunk *chunk;
+    while((chunk = arena->chunks)) {
+        arena->chunks = chunk->next;
+        munmap(chunk->mapping, chunk->mapping_size);
+        free(chunk);
+    }
+    free(arena);
+}
+
+#ifdef TCPKALI_HUGEPAGE_UNIT_TEST
+int
+main() {
+    struct tk_huge_arena *arena = tk_huge_arena_new();
+
+    assert(tk_huge_alloc(arena, 0) == NULL);
+    assert(tk_huge_alloc(arena, TK_HUGE_OBJECT_MAX + 1) == NULL);
+
+    /* The objects are aligned, distinct and writable. */
+    char *a = tk_huge_alloc(arena, 100);
+    char *b = tk_huge_alloc(arena, 100);
+    assert(a && b && a != b);
+    assert(((uintptr_t)a % TK_HUGE_ALIGNMENT) == 0);
+    assert(b - a == 128);
+    memset(a, 1, 100);
+    memset(b, 2, 100);
+    assert(a[99] == 1 && b[0] == 2);
+
+    /* The released object is reused for the same size only. */
+    tk_huge_free(arena, a, 100);
+    char *c = tk_huge_alloc(arena, 1000);
+    assert(c != a);
+    assert(tk_huge_alloc(arena, 120) == a);
+
+    /* The large objects take new chunks once a chunk is used up. */
+    void *big[5];
+    for(int i = 0; i < 5; i++) {
+        big[i] = tk_huge_alloc(arena, TK_HUGE_OBJECT_MAX);
+        assert(big[i]);
+        memset(big[i], i, TK_HUGE_OBJECT_MAX);
+    }
+    size_t hugetlb, thp;
+    tk_huge_arena_stats(arena, &hugetlb, &thp);
+    assert(hugetlb + thp == 4); /* 100, 1000, and two for the large ones */
+
+    /* The objects released into another arena are reused there. */
+    struct tk_huge_arena *other = tk_huge_arena_new();
+    tk_huge_free(other, big[4], TK_HUGE_OBJECT_MAX);
+    assert(tk_huge_alloc(other, TK_HUGE_OBJECT_MAX) == big[4]);
+    tk_huge_arena_free(other);
+
+    /* Running out of the different sizes is not fatal. */
+    for(size_t i = 0; i < 64; i++) tk_huge_alloc(arena, 64 * (i + 100));
+    assert(tk_huge_alloc(arena, 64 * 1000) == NULL);
+
+    tk_huge_arena_free(arena);
+    return 0;
+}
+#endif
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_HUGEPAGE_H
+#define TCPKALI_HUGEPAGE_H
+
+#include <stddef.h>
+
+/*
+ * The objects carved out of 2MB huge pages, see --hugepages.
+ *
+ * The arena maps 2MB chunks with MAP_HUGETLB, or, when no huge pages are
+ * reserved, asks for the transparent huge pages with madvise(2). A chunk
+ * serves the objects of a single size, and the released objects are kept
+ * on a free list of their size for reuse. The chunks are only unmapped
+ * with the arena. Not thread-safe: an arena is kept per worker, though
+ * the objects may be released into another worker's arena.
+ */
+
+#define TK_HUGE_CHUNK_SIZE (2 * 1024 * 1024)
+#define TK_HUGE_OBJECT_MAX (TK_HUGE_CHUNK_SIZE / 4) /* Larger are malloc()ed */
+
+struct tk_huge_arena;
+
+struct tk_huge_arena *tk_huge_arena_new(void);
+
+/*
+ * Allocate the object, aligned to 64 bytes. Returns NULL if the object
+ * is too large, or there are too many different sizes, or the memory
+ * could not be mapped; the caller falls back to malloc(3) then.
+ */
+void *tk_huge_alloc(struct tk_huge_arena *, size_t size);
+
+/*
+ * Release the object of the given size, allocated by any arena.
+ */
+void tk_huge_free(struct tk_huge_arena *, void *ptr, size_t size);
+
+/*
+ * The chunks mapped from the reserved huge pages, and those left
+ * to the transparent huge pages.
+ */
+void tk_huge_arena_stats(const struct tk_huge_arena *, size_t *hugetlb_chunks,
+                         size_t *thp_chunks);
+
+/*
+ * Unmap the chunks. None of the objects may be used anymore, including
+ * those released into the other arenas.
+ */
+void tk_huge_arena_free(struct tk_huge_arena *);
+
+#endif /* TCPKALI_HUGEPAGE_H */
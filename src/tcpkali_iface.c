@@ -69,12 +69,37 @@ address_add(struct addresses *aseq, struct sockaddr *sa) {
             *(struct sockaddr_in6 *)sa;
         aseq->n_addrs++;
         break;
+    case AF_UNIX:
+        *(struct sockaddr_un *)&aseq->addrs[aseq->n_addrs] =
+            *(struct sockaddr_un *)sa;
+        aseq->n_addrs++;
+        break;
     default:
-        assert(!"Not IPv4 and not IPv6");
+        assert(!"Not IPv4, IPv6 or Unix");
         break;
     }
 }
 
+int
+address_parse_unix(const char *str, struct sockaddr_storage *ss) {
+    static const char prefix[] = "unix:";
+
+    if(strncmp(str, prefix, sizeof(prefix) - 1) != 0) return -1;
+
+    const char *path = str + sizeof(prefix) - 1;
+    struct sockaddr_un *sun = (struct sockaddr_un *)ss;
+    if(*path == '\0' || strlen(path) >= sizeof(sun->sun_path)) {
+        fprintf(stderr, "%s: Expected unix:/path, up to %zu characters\n",
+                str, sizeof(sun->sun_path) - 1);
+        exit(EX_USAGE);
+    }
+
+    memset(ss, 0, sizeof(*ss));
+    sun->sun_family = AF_UNIX;
+    strcpy(sun->sun_path, path);
+    return 0;
+}
+
 typedef enum {
     SMATCH_ADDR_ONLY,
     SMATCH_ADDR_PORT,
@@ -100,15 +125,20 @@ sockaddrs_match(struct sockaddr *sa, struct sockaddr *sb, sockaddrs_cmp_e cmp) {
                 return 1;
             }
         } break;
+        case AF_UNIX: {
+            struct sockaddr_un *sua = (struct sockaddr_un *)sa;
+            struct sockaddr_un *sub = (struct sockaddr_un *)sb;
+            if(strncmp(sua->sun_path, sub->sun_path, sizeof(sua->sun_path))
+               == 0) {
+                return 1;
+            }
+        } break;
         }
     }
     return 0;
 }
 
-/*
- * Return non-zero if such address already exists.
- */
-static int
+int
 address_is_member(struct addresses *aseq, struct sockaddr *sb) {
     for(size_t i = 0; i < aseq->n_addrs; i++) {
         struct sockaddr *sa = (struct sockaddr *)&aseq->addrs[i];
@@ -155,6 +185,12 @@ format_sockaddr(struct sockaddr_storage *ss, char *buf, size_t size) {
         in_addr = &((struct sockaddr_in6 *)ss)->sin6_addr;
         nport = ((struct sockaddr_in6 *)ss)->sin6_port;
         break;
+    case AF_UNIX: {
+        const struct sockaddr_un *sun = (struct sockaddr_un *)ss;
+        snprintf(buf, size, "unix:%.*s", (int)sizeof(sun->sun_path),
+                 sun->sun_path);
+        return buf;
+    }
     default:
         assert(!"ipv4 or ipv6 expected");
         return "<unknown>";
@@ -249,6 +285,58 @@ add_source_ip(struct addresses *addresses, const char *optarg) {
     return 0;
 }
 
+/*
+ * Parse the "addr/len" IPv6 prefix, clearing the bits past the prefix.
+ */
+int
+address_parse_ipv6_prefix(const char *str, struct sockaddr_in6 *sin6,
+                          int *prefix_len) {
+    char addr[INET6_ADDRSTRLEN];
+    const char *slash = strchr(str, '/');
+    if(!slash || (size_t)(slash - str) >= sizeof(addr)) return -1;
+    memcpy(addr, str, slash - str);
+    addr[slash - str] = '\0';
+
+    char *end;
+    long len = strtol(slash + 1, &end, 10);
+    if(end == slash + 1 || *end != '\0' || len < 1 || len > 128) return -1;
+
+    memset(sin6, 0, sizeof(*sin6));
+    sin6->sin6_family = AF_INET6;
+    if(inet_pton(AF_INET6, addr, &sin6->sin6_addr) != 1) return -1;
+
+    uint8_t *a = sin6->sin6_addr.s6_addr;
+    for(int i = 0; i < 16; i++) {
+        if(len >= 8 * (i + 1)) continue;
+        a[i] &= len > 8 * i ? (uint8_t)(0xff << (8 - (len - 8 * i))) : 0;
+    }
+    *prefix_len = len;
+    return 0;
+}
+
+/*
+ * Replace the bits past the prefix with the given random bits.
+ */
+void
+address_fill_ipv6_prefix(struct sockaddr_in6 *sin6, int prefix_len,
+                         const uint8_t random_bits[16]) {
+    uint8_t *a = sin6->sin6_addr.s6_addr;
+    int host_zero = 1;
+    for(int i = 0; i < 16; i++) {
+        uint8_t host_mask;
+        if(prefix_len >= 8 * (i + 1))
+            host_mask = 0;
+        else if(prefix_len > 8 * i)
+            host_mask = 0xff >> (prefix_len - 8 * i);
+        else
+            host_mask = 0xff;
+        a[i] = (a[i] & ~host_mask) | (random_bits[i] & host_mask);
+        if(a[i] & host_mask) host_zero = 0;
+    }
+    /* The all-zeroes host part is the Subnet-Router anycast address. */
+    if(host_zero && prefix_len < 128) a[15] |= 1;
+}
+
 static void
 reset_port(struct sockaddr_storage *ss, in_port_t new_port_value) {
     switch(ss->ss_family) {
@@ -260,6 +348,8 @@ reset_port(struct sockaddr_storage *ss, in_port_t new_port_value) {
         struct sockaddr_in6 *sin = (struct sockaddr_in6 *)ss;
         sin->sin6_port = new_port_value;
     } break;
+    case AF_UNIX:
+        break;
     default:
         assert(!"Not IPv4 and not IPv6");
         break;
@@ -397,6 +487,44 @@ main() {
         }
     }
 
+    /* Test the Unix domain socket addresses */
+    struct sockaddr_storage ss;
+    char buf[INET6_ADDRSTRLEN + 64];
+    assert(address_parse_unix("localhost:80", &ss) == -1);
+    assert(address_parse_unix("unix:/tmp/tcpkali.sock", &ss) == 0);
+    assert(ss.ss_family == AF_UNIX);
+    assert(sockaddr_len(&ss) == sizeof(struct sockaddr_un));
+    assert(strcmp(format_sockaddr(&ss, buf, sizeof(buf)),
+                  "unix:/tmp/tcpkali.sock")
+           == 0);
+
+    /* Test the IPv6 source prefixes */
+    struct sockaddr_in6 sin6;
+    int plen;
+    assert(address_parse_ipv6_prefix("2001:db8::", &sin6, &plen) == -1);
+    assert(address_parse_ipv6_prefix("2001:db8::/0", &sin6, &plen) == -1);
+    assert(address_parse_ipv6_prefix("2001:db8::/129", &sin6, &plen) == -1);
+    assert(address_parse_ipv6_prefix("10.0.0.0/8", &sin6, &plen) == -1);
+    assert(address_parse_ipv6_prefix("2001:db8:1:2:3::1/68", &sin6, &plen)
+           == 0);
+    assert(plen == 68);
+    assert(sin6.sin6_family == AF_INET6);
+    inet_ntop(AF_INET6, &sin6.sin6_addr, buf, sizeof(buf));
+    assert(strcmp(buf, "2001:db8:1:2::") == 0);
+
+    uint8_t ones[16], zeroes[16] = {0};
+    memset(ones, 0xff, sizeof(ones));
+    address_fill_ipv6_prefix(&sin6, plen, ones);
+    inet_ntop(AF_INET6, &sin6.sin6_addr, buf, sizeof(buf));
+    assert(strcmp(buf, "2001:db8:1:2:fff:ffff:ffff:ffff") == 0);
+    address_fill_ipv6_prefix(&sin6, plen, zeroes);
+    inet_ntop(AF_INET6, &sin6.sin6_addr, buf, sizeof(buf));
+    assert(strcmp(buf, "2001:db8:1:2::1") == 0);
+    assert(address_parse_ipv6_prefix("2001:db8::7/128", &sin6, &plen) == 0);
+    address_fill_ipv6_prefix(&sin6, plen, ones);
+    inet_ntop(AF_INET6, &sin6.sin6_addr, buf, sizeof(buf));
+    assert(strcmp(buf, "2001:db8::7") == 0);
+
     return 0;
 }
 #endif
@@ -477,6 +605,9 @@ detect_source_ips(struct addresses *dsts, struct addresses *srcs) {
             return 0;
         }
 
+        /* The Unix domain sockets have no source address to pick. */
+        if(ds->ss_family == AF_UNIX) continue;
+
         /*
          * Attempt to create a connection and see what our
          * local address looks like. Then search for that address
@@ -28,15 +28,17 @@
 #define TCPKALI_IFACE_H
 
 #include <stdio.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
 #include "tcpkali_common.h"
 
 /*
- * A list of IPv4/IPv6 addresses.
+ * A list of IPv4/IPv6 and Unix domain socket addresses.
  */
 struct addresses {
     struct sockaddr_storage *addrs;
@@ -51,8 +53,10 @@ sockaddr_len(struct sockaddr_storage *ss) {
         return sizeof(struct sockaddr_in);
     case AF_INET6:
         return sizeof(struct sockaddr_in6);
+    case AF_UNIX:
+        return sizeof(struct sockaddr_un);
     }
-    assert(!"Not IPv4 and not IPv6");
+    assert(!"Not IPv4, IPv6 or Unix");
     return 0;
 }
 
@@ -64,6 +68,17 @@ void fprint_addresses(FILE *, char *prefix, char *separator, char *suffix,
 
 void address_add(struct addresses *, struct sockaddr *sa);
 
+/*
+ * Return non-zero if such address (and port) is already in the list.
+ */
+int address_is_member(struct addresses *, struct sockaddr *sa);
+
+/*
+ * Parse the "unix:/path" string into the Unix domain socket address.
+ * Returns -1 if the string does not start with "unix:".
+ */
+int address_parse_unix(const char *str, struct sockaddr_storage *ss);
+
 /*
  * Return the string representing the socket address.
  * The size should be at least INET6_ADDRSTRLEN+64.
@@ -80,6 +95,20 @@ struct addresses detect_listen_addresses(const char *local_hostname, int listen_
  */
 int add_source_ip(struct addresses *addresses, const char *str);
 
+/*
+ * Parse the "addr/len" IPv6 prefix into the address with the bits past
+ * the prefix cleared. Returns -1 if the string is not an IPv6 prefix.
+ */
+int address_parse_ipv6_prefix(const char *str, struct sockaddr_in6 *,
+                              int *prefix_len);
+
+/*
+ * Replace the bits of the address past the prefix with the random bits,
+ * avoiding the all-zeroes (Subnet-Router anycast) host part.
+ */
+void address_fill_ipv6_prefix(struct sockaddr_in6 *, int prefix_len,
+                              const uint8_t random_bits[16]);
+
 /*
  * Given a list of destination addresses, populate the list of source
  * addresses with compatible source (local) IPs.
@@ -0,0 +1,474 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <config.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "tcpkali_json.h"
+#include "tcpkali_iface.h"
+
+/*
+ * Print a string, escaped according to RFC 8259.
+ */
+static void
+json_string(FILE *f, const char *str) {
+    fputc('"', f);
+    for(const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        switch(*p) {
+        case '"':
+        case '\\':
+            fprintf(f, "\\%c", *p);
+            break;
+        default:
+            if(*p < 0x20)
+                fprintf(f, "\\u%04x", *p);
+            else
+                fputc(*p, f);
+        }
+    }
+    fputc('"', f);
+}
+
+/*
+ * JSON has no representation for NaN and infinities.
+ */
+static void
+json_number(FILE *f, double value) {
+    if(isfinite(value))
+        fprintf(f, "%.6g", value);
+    else
+        fprintf(f, "null");
+}
+
+static double
+per_second(double value, double duration) {
+    return duration > 0 ? value / duration : 0;
+}
+
+/*
+ * Print the count, minimum, mean, maximum and percentiles of the
+ * histogram values divided by (divisor).
+ */
+static void
+json_distribution(FILE *f, const char *name, int *first,
+                  struct hdr_histogram *histogram, double divisor,
+                  const struct percentile_values *percentiles) {
+    if(!histogram) return;
+
+    fprintf(f, "%s\"%s\":{\"count\":%" PRId64 ",\"min\":", *first ? "" : ",",
+            name, histogram->total_count);
+    *first = 0;
+    json_number(f, histogram->total_count ? hdr_min(histogram) / divisor : 0);
+    fprintf(f, ",\"mean\":");
+    json_number(f, histogram->total_count ? hdr_mean(histogram) / divisor : 0);
+    fprintf(f, ",\"max\":");
+    json_number(f, hdr_max(histogram) / divisor);
+    fprintf(f, ",\"percentiles\":{");
+    for(size_t i = 0; i < percentiles->size; i++) {
+        fprintf(f, "%s\"%s\":", i ? "," : "", percentiles->values[i].value_s);
+        json_number(f, hdr_value_at_percentile(histogram,
+                                               percentiles->values[i].value_d)
+                           / divisor);
+    }
+    fprintf(f, "}}");
+}
+
+/*
+ * Print the min/p1/p50/max of the --sample-interval numbers,
+ * multiplied by (scale).
+ */
+static void
+json_spread(FILE *f, const char *name, struct hdr_histogram *histogram,
+            double scale) {
+    fprintf(f, ",\"%s\":{\"min\":", name);
+    json_number(f, hdr_min(histogram) * scale);
+    fprintf(f, ",\"p1\":");
+    json_number(f, hdr_value_at_percentile(histogram, 1.0) * scale);
+    fprintf(f, ",\"p50\":");
+    json_number(f, hdr_value_at_percentile(histogram, 50.0) * scale);
+    fprintf(f, ",\"max\":");
+    json_number(f, hdr_max(histogram) * scale);
+    fprintf(f, "}");
+}
+
+/* The latency histograms are kept in --latency-resolution units. */
+static void
+json_latency(FILE *f, const char *name, int *first,
+             struct hdr_histogram *histogram,
+             const struct percentile_values *percentiles) {
+    json_distribution(f, name, first, histogram,
+                      latency_units_per_second / 1000.0, percentiles);
+}
+
+static void
+json_latencies(FILE *f, const struct latency_snapshot *latency,
+               const struct percentile_values *percentiles) {
+    fprintf(f, "{");
+    if(latency) {
+        int first = 1;
+        json_latency(f, "connect", &first, latency->connect_histogram,
+                     percentiles);
+        json_latency(f, "first_byte", &first, latency->firstbyte_histogram,
+                     percentiles);
+        json_latency(f, "handshake", &first, latency->handshake_histogram,
+                     percentiles);
+        json_latency(f, "upgrade", &first, latency->upgrade_histogram,
+                     percentiles);
+        json_latency(f, "message", &first, latency->marker_histogram,
+                     percentiles);
+        json_latency(f, "message_uncorrected", &first,
+                     latency->marker_uncorrected_histogram, percentiles);
+    }
+    fprintf(f, "}");
+}
+
+static void
+json_traffic(FILE *f, const non_atomic_traffic_stats *traffic) {
+    fprintf(f,
+            "{\"bytes_sent\":%" PRIu64 ",\"bytes_received\":%" PRIu64
+            ",\"writes\":%" PRIu64 ",\"reads\":%" PRIu64
+            ",\"messages_sent\":%" PRIu64 ",\"messages_received\":%" PRIu64
+            ",\"messages_lost\":%" PRIu64 ",\"messages_reordered\":%" PRIu64
+            ",\"messages_duplicated\":%" PRIu64
+            ",\"connections_opened\":%" PRIu64
+            ",\"connections_closed\":%" PRIu64
+            ",\"echo_mismatches\":%" PRIu64 "}",
+            (uint64_t)traffic->bytes_sent, (uint64_t)traffic->bytes_rcvd,
+            (uint64_t)traffic->num_writes, (uint64_t)traffic->num_reads,
+            (uint64_t)traffic->msgs_sent, (uint64_t)traffic->msgs_rcvd,
+            (uint64_t)traffic->msgs_lost, (uint64_t)traffic->msgs_reordered,
+            (uint64_t)traffic->msgs_duplicated,
+            (uint64_t)traffic->conns_opened, (uint64_t)traffic->conns_closed,
+            (uint64_t)traffic->echo_mismatches);
+}
+
+void
+json_report_write(FILE *f, const char *type, double elapsed,
+                  const struct engine_params *params,
+                  const struct engine_summary *summary,
+                  const struct percentile_values *percentiles) {
+    const non_atomic_traffic_stats *traffic = &summary->traffic;
+    double duration = summary->test_duration;
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    fprintf(f, "{\"type\":");
+    json_string(f, type);
+    fprintf(f, ",\"time\":%.3f,\"elapsed\":", tv.tv_sec + tv.tv_usec / 1e6);
+    json_number(f, elapsed);
+    fprintf(f, ",\"duration\":");
+    json_number(f, duration);
+
+    fprintf(f, ",\"traffic\":");
+    json_traffic(f, traffic);
+
+    fprintf(f, ",\"rates\":{\"bps_in\":");
+    json_number(f, per_second(8.0 * traffic->bytes_rcvd, duration));
+    fprintf(f, ",\"bps_out\":");
+    json_number(f, per_second(8.0 * traffic->bytes_sent, duration));
+    fprintf(f, ",\"mps_in\":");
+    json_number(f, per_second(traffic->msgs_rcvd, duration));
+    fprintf(f, ",\"mps_out\":");
+    json_number(f, per_second(traffic->msgs_sent, duration));
+    fprintf(f, "}");
+
+    fprintf(f,
+            ",\"connections\":{\"connecting\":%zu,\"incoming\":%zu"
+            ",\"outgoing\":%zu,\"total\":%zu}",
+            summary->connecting, summary->conns_in, summary->conns_out,
+            summary->connections_counter);
+
+    /* format_sockaddr() does not modify the address. */
+    struct addresses *remotes = (struct addresses *)&params->remote_addresses;
+    fprintf(f, ",\"remotes\":[");
+    for(size_t i = 0; i < summary->n_remotes; i++) {
+        const struct engine_remote_summary *rs = &summary->remotes[i];
+        char buf[INET6_ADDRSTRLEN + 64];
+        format_sockaddr(&remotes->addrs[i], buf, sizeof(buf));
+        fprintf(f, "%s{\"address\":", i ? "," : "");
+        json_string(f, buf);
+        fprintf(f,
+                ",\"connection_attempts\":%zu,\"connection_failures\":%zu"
+                ",\"traffic\":",
+                rs->connection_attempts, rs->connection_failures);
+        json_traffic(f, &rs->traffic);
+        fprintf(f, ",\"latency\":");
+        json_latencies(f, rs->latency, percentiles);
+        fprintf(f, "}");
+    }
+    fprintf(f, "]");
+
+    fprintf(f, ",\"groups\":[");
+    for(size_t i = 0; i < summary->n_groups && i < params->n_groups; i++) {
+        const struct engine_group_summary *gs = &summary->groups[i];
+        fprintf(f, "%s{\"name\":", i ? "," : "");
+        json_string(f, params->groups[i].name);
+        fprintf(f, ",\"share\":");
+        json_number(f, params->groups[i].share);
+        fprintf(f, ",\"traffic\":");
+        json_traffic(f, &gs->traffic);
+        fprintf(f, ",\"latency\":");
+        json_latencies(f, gs->latency, percentiles);
+        fprintf(f, "}");
+    }
+    fprintf(f, "]");
+
+    fprintf(f, ",\"rate_steps\":[");
+    for(size_t i = 0; i < summary->n_rate_steps; i++) {
+        const struct engine_rate_step_summary *rs = &summary->rate_steps[i];
+        fprintf(f, "%s{\"rate\":", i ? "," : "");
+        json_number(f, rs->rate.value);
+        fprintf(f, ",\"unit\":");
+        json_string(f, rs->rate.value_base == RS_BYTES_PER_SECOND ? "Bps"
+                                                                  : "mps");
+        fprintf(f, ",\"duration\":");
+        json_number(f, rs->duration);
+        fprintf(f, ",\"latency\":{");
+        int first = 1;
+        json_latency(f, "message", &first, rs->histogram, percentiles);
+        fprintf(f, "}}");
+    }
+    fprintf(f, "]");
+
+    if(summary->size_classes) {
+        fprintf(f, ",\"size_classes\":[");
+        for(size_t i = 0; i < summary->n_size_classes; i++) {
+            const struct engine_size_class_summary *sc =
+                &summary->size_classes[i];
+            fprintf(f, "%s{\"size_min\":%zu,\"size_max\":", i ? "," : "",
+                    sc->size_min);
+            if(sc->size_max)
+                fprintf(f, "%zu", sc->size_max);
+            else
+                fprintf(f, "null");
+            fprintf(f, ",\"latency\":{");
+            int first = 1;
+            json_latency(f, "message", &first, sc->histogram, percentiles);
+            fprintf(f, "}}");
+        }
+        fprintf(f, "]");
+    }
+
+    if(summary->slowest) {
+        fprintf(f, ",\"slowest\":[");
+        for(size_t i = 0; i < summary->n_slowest; i++) {
+            const struct engine_slow_message *sm = &summary->slowest[i];
+            char buf[INET6_ADDRSTRLEN + 64];
+            fprintf(f, "%s{\"latency\":", i ? "," : "");
+            json_number(f, 1000 * sm->latency);
+            fprintf(f, ",\"connection_uid\":%u,\"remote\":",
+                    sm->connection_uid);
+            if(sm->remote_index >= 0
+               && (size_t)sm->remote_index < remotes->n_addrs) {
+                format_sockaddr(&remotes->addrs[sm->remote_index], buf,
+                                sizeof(buf));
+                json_string(f, buf);
+            } else {
+                fprintf(f, "null");
+            }
+            fprintf(f, ",\"connection_age\":");
+            json_number(f, sm->connection_age);
+            fprintf(f, ",\"bytes_in_flight\":%zu}", sm->bytes_in_flight);
+        }
+        fprintf(f, "]");
+    }
+
+    const struct engine_loop_stats *loop = &summary->loop;
+    fprintf(f, ",\"generator\":{\"busy\":");
+    json_number(f, loop->busy);
+    fprintf(f, ",\"loop_lag_ms\":");
+    json_number(f, 1000 * loop->lag);
+    fprintf(f, ",\"loop_stall_ms\":");
+    json_number(f, 1000 * loop->stall);
+    fprintf(f, ",\"events_per_iteration\":");
+    json_number(f, loop->events_per_iteration);
+    fprintf(f, ",\"pacing_debt_ms\":");
+    json_number(f, 1000 * loop->pacing_debt);
+    fprintf(f, ",\"saturated\":%s,\"saturated_share\":",
+            loop->saturated ? "true" : "false");
+    json_number(f, loop->saturated_share);
+    fprintf(f, "}");
+
+    if(params->cpu_cost) {
+        const struct engine_cpu_stats *cpu = &summary->cpu;
+        fprintf(f, ",\"cpu\":{\"seconds\":");
+        json_number(f, cpu->seconds);
+        fprintf(f, ",\"us_per_message\":");
+        json_number(f, cpu->messages ? 1000000 * cpu->seconds / cpu->messages
+                                     : NAN);
+        fprintf(f, ",\"ns_per_byte\":");
+        json_number(f,
+                    cpu->bytes ? 1000000000 * cpu->seconds / cpu->bytes : NAN);
+        if(cpu->cycles) {
+            fprintf(f, ",\"cycles\":%" PRIu64 ",\"instructions\":%" PRIu64,
+                    cpu->cycles, cpu->instructions);
+            fprintf(f, ",\"cycles_per_message\":");
+            json_number(f, cpu->messages ? (double)cpu->cycles / cpu->messages
+                                         : NAN);
+            fprintf(f, ",\"cycles_per_byte\":");
+            json_number(f,
+                        cpu->bytes ? (double)cpu->cycles / cpu->bytes : NAN);
+        }
+        fprintf(f, "}");
+    }
+
+    const struct engine_memory_stats *memory = &summary->memory;
+    if(memory->connections) {
+        fprintf(f, ",\"memory\":{\"connections\":%zu", memory->connections);
+        fprintf(f, ",\"bytes_per_connection\":{");
+        for(int c = 0; c < EMC_COMPONENTS; c++) {
+            fprintf(f, "%s\"%s\":%zu", c ? "," : "",
+                    engine_memory_component_name(c),
+                    memory->bytes[c] / memory->connections);
+        }
+        fprintf(f, "}}");
+    }
+
+    if(summary->abort.condition[0]) {
+        fprintf(f, ",\"abort\":{\"condition\":");
+        json_string(f, summary->abort.condition);
+        fprintf(f, ",\"value\":");
+        json_number(f, summary->abort.value);
+        fprintf(f, "}");
+    }
+
+    const struct engine_steady_summary *steady = &summary->steady;
+    if(steady->windows) {
+        fprintf(f, ",\"steady_state\":{\"windows\":%d,\"after\":",
+                steady->windows);
+        json_number(f, steady->after);
+        for(int m = 0; m < ESM_METRICS; m++) {
+            if(isnan(steady->values[m].mean)) continue;
+            fprintf(f, ",\"%s\":{\"mean\":", engine_steady_metric_name(m));
+            json_number(f, steady->values[m].mean);
+            fprintf(f, ",\"ci95\":");
+            json_number(f, steady->values[m].ci95);
+            fprintf(f, "}");
+        }
+        fprintf(f, "}");
+    }
+
+    fprintf(f, ",\"latency\":");
+    json_latencies(f, summary->latency, percentiles);
+    if(summary->tcp_info) {
+        const struct tcp_info_snapshot *tcp_info = summary->tcp_info;
+        int first = 1;
+        fprintf(f, ",\"tcp_info\":{");
+        json_distribution(f, "rtt", &first, tcp_info->histogram[ETI_RTT],
+                          1000.0, percentiles);
+        json_distribution(f, "retransmits", &first,
+                          tcp_info->histogram[ETI_RETRANSMITS], 1,
+                          percentiles);
+        json_distribution(f, "cwnd", &first, tcp_info->histogram[ETI_CWND], 1,
+                          percentiles);
+        json_distribution(f, "unacked", &first,
+                          tcp_info->histogram[ETI_UNACKED], 1, percentiles);
+        fprintf(f, "}");
+    }
+    if(summary->tcp_info && summary->tcp_info->mptcp_connections) {
+        const struct tcp_info_snapshot *tcp_info = summary->tcp_info;
+        int first = 0;
+        fprintf(f, ",\"mptcp\":{\"connections\":%zu,\"fallbacks\":%zu",
+                tcp_info->mptcp_connections, tcp_info->mptcp_fallbacks);
+        json_distribution(f, "subflows", &first,
+                          tcp_info->histogram[ETI_MPTCP_SUBFLOWS], 1,
+                          percentiles);
+        json_distribution(f, "subflow_rate_mbps", &first,
+                          tcp_info->histogram[ETI_MPTCP_SUBFLOW_RATE], 1000.0,
+                          percentiles);
+        fprintf(f, "}");
+    }
+    if(summary->tcp_info && summary->tcp_info->fastopen_connections) {
+        fprintf(f, ",\"fastopen\":{\"connections\":%zu,\"accepted\":%zu}",
+                summary->tcp_info->fastopen_connections,
+                summary->tcp_info->fastopen_accepted);
+    }
+    if(params->latency_sample > 1) {
+        fprintf(f,
+                ",\"latency_sample\":{\"every\":%u,\"dropped\":%" PRIu64
+                "}",
+                params->latency_sample, summary->latency_samples_dropped);
+    }
+    if(summary->throughput[SM_BYTES_RCVD]) {
+        struct hdr_histogram *const *h = summary->throughput;
+        double per_second = 1.0 / params->sample_interval;
+        fprintf(f, ",\"throughput\":{\"interval\":");
+        json_number(f, params->sample_interval);
+        fprintf(f, ",\"intervals\":%" PRId64, h[SM_BYTES_RCVD]->total_count);
+        if(h[SM_BYTES_RCVD]->total_count) {
+            json_spread(f, "bps_in", h[SM_BYTES_RCVD], 8 * per_second);
+            json_spread(f, "bps_out", h[SM_BYTES_SENT], 8 * per_second);
+            json_spread(f, "mps_in", h[SM_MSGS_RCVD], per_second);
+            json_spread(f, "mps_out", h[SM_MSGS_SENT], per_second);
+        }
+        fprintf(f, "}");
+    }
+    if(params->mirror_addresses.n_addrs) {
+        const struct engine_mirror_summary *ms = &summary->mirror;
+        fprintf(f,
+                ",\"mirror\":{\"opened\":%zu,\"failed\":%zu,"
+                "\"bytes_sent\":%" PRIu64 ",\"bytes_rcvd\":%" PRIu64
+                ",\"bytes_dropped\":%" PRIu64 "}",
+                ms->opened, ms->failed, ms->bytes_sent, ms->bytes_rcvd,
+                ms->bytes_dropped);
+    }
+    if(params->grpc_enable) {
+        fprintf(f, ",\"grpc\":{\"calls\":{");
+        for(int c = 0; c <= GRPC_STATUS_CODES; c++) {
+            fprintf(f, "%s\"%s\":%" PRIu64, c ? "," : "",
+                    grpc_status_name(c), summary->grpc_calls[c]);
+        }
+        fprintf(f, "}}");
+    }
+    if(params->peer_stats) {
+        fprintf(f, ",\"peers\":[");
+        for(size_t i = 0; i < summary->n_peers; i++) {
+            const struct peer_stats *peer = &summary->peers[i];
+            char buf[INET6_ADDRSTRLEN + 16];
+            fprintf(f, "%s{\"peer\":", i ? "," : "");
+            json_string(f, peer_stats_format(peer, buf, sizeof(buf)));
+            fprintf(f, ",\"traffic\":");
+            json_traffic(f, &peer->traffic);
+            fprintf(f, ",\"latency\":{\"count\":%zu,\"mean\":",
+                    peer->latency_count);
+            json_number(f, peer->latency_count ? 1000 * peer->latency_sum
+                                                     / peer->latency_count
+                                               : 0);
+            fprintf(f, ",\"max\":");
+            json_number(f, 1000 * peer->latency_max);
+            fprintf(f, "}}");
+        }
+        fprintf(f, "],\"peer_fairness\":");
+        json_number(f, peer_stats_fairness(summary->peers, summary->n_peers));
+    }
+    fprintf(f, "}\n");
+    fflush(f);
+}
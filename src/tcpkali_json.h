@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_JSON_H
+#define TCPKALI_JSON_H
+
+#include <stdio.h>
+
+#include "tcpkali_common.h"
+#include "tcpkali_engine.h"
+
+/*
+ * Machine-readable test results, see --json-report and --json-stream.
+ *
+ * Each report is a single line JSON object with the traffic numbers,
+ * the derived rates, connection counts, the latency percentiles
+ * (in milliseconds) of the enabled latency types, and the connection,
+ * traffic and latency numbers of each remote address since the start
+ * of the test. The (type) member tells the final report ("final")
+ * from the periodic ones ("checkpoint").
+ */
+
+/*
+ * Write the report and flush the stream.
+ * (elapsed) is the time since the start of the test; the traffic and
+ * latency numbers of the (summary) cover the last (summary->test_duration)
+ * seconds.
+ */
+void json_report_write(FILE *, const char *type, double elapsed,
+                       const struct engine_params *,
+                       const struct engine_summary *,
+                       const struct percentile_values *);
+
+#endif /* TCPKALI_JSON_H */
@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <assert.h>
+
+#include "tcpkali_logpipe.h"
+#include "tcpkali_spsc.h"
+
+/* Lines longer than this are formatted into a temporary heap buffer. */
+#define LOG_LINE_STACK_SIZE 1024
+/* How long the writer sleeps when the rings are empty, nanoseconds. */
+#define LOG_POLL_INTERVAL_NS 5000000
+/* How often log_ring_detach() checks whether the ring is empty. */
+#define LOG_DETACH_POLL_NS 1000000
+
+enum log_record_type {
+    LOG_LINE = 1,
+    LOG_DUMP = 2,
+};
+
+struct log_record {
+    size_t size; /* Of the data following the record */
+    enum log_record_type type;
+    struct log_dump dump; /* LOG_DUMP only */
+};
+
+struct log_ring {
+    struct spsc_ring ring; /* The (dropped) are the records */
+    /* Set by the worker, see log_ring_attach(). */
+    pthread_t owner __attribute__((aligned(64)));
+    int attached;
+    struct logpipe *pipe;
+};
+
+struct logpipe {
+    struct log_ring *rings;
+    int rings_count;
+    const char *line_prefix;
+    log_dump_formatter_f *formatter;
+    char *scratch; /* For the records wrapping around the ring */
+    size_t scratch_size;
+    struct spsc_writer writer;
+};
+
+static int
+log_ring_owned(struct log_ring *ring) {
+    return __atomic_load_n(&ring->attached, __ATOMIC_ACQUIRE)
+           && pthread_equal(ring->owner, pthread_self());
+}
+
+static void
+log_ring_append(struct log_ring *ring, const struct log_record *rec,
+                const void *data) {
+    if(spsc_ring_append(&ring->ring, rec, sizeof(*rec), data, rec->size)
+       == -1)
+        ring->ring.dropped++;
+}
+
+void
+log_ring_vprintf(struct log_ring *ring, const char *fmt, va_list ap) {
+    if(!log_ring_owned(ring)) {
+        fputs(ring->pipe->line_prefix, stderr);
+        vfprintf(stderr, fmt, ap);
+        return;
+    }
+
+    char stack_buffer[LOG_LINE_STACK_SIZE];
+    char *buffer = stack_buffer;
+    va_list aq;
+    va_copy(aq, ap);
+    int len = vsnprintf(stack_buffer, sizeof(stack_buffer), fmt, aq);
+    va_end(aq);
+    if(len < 0) return;
+    if((size_t)len >= sizeof(stack_buffer)) {
+        buffer = malloc(len + 1);
+        assert(buffer);
+        vsnprintf(buffer, len + 1, fmt, ap);
+    }
+
+    struct log_record rec = {.size = len, .type = LOG_LINE};
+    log_ring_append(ring, &rec, buffer);
+
+    if(buffer != stack_buffer) free(buffer);
+}
+
+void
+log_ring_dump(struct log_ring *ring, const struct log_dump *dump,
+              const void *data, size_t size) {
+    if(!log_ring_owned(ring)) {
+        ring->pipe->formatter(dump, data, size);
+        return;
+    }
+
+    struct log_record rec = {.size = size, .type = LOG_DUMP, .dump = *dump};
+    log_ring_append(ring, &rec, data);
+}
+
+/*
+ * Print out the records in the ring.
+ * Returns the number of records printed.
+ */
+static size_t
+log_ring_drain(struct logpipe *pipe, struct log_ring *ring) {
+    size_t tail = spsc_ring_tail(&ring->ring);
+    size_t head = ring->ring.head;
+    size_t printed = 0;
+
+    if(head == tail) return 0;
+
+    /* Keep the main thread's output from splitting the records. */
+    flockfile(stderr);
+    while(head != tail) {
+        struct log_record rec;
+        spsc_ring_copy_out(&ring->ring, head, &rec, sizeof(rec));
+        head += sizeof(rec);
+
+        size_t contiguous;
+        const char *data =
+            (const char *)spsc_ring_contiguous(&ring->ring, head, tail,
+                                               &contiguous);
+        if(contiguous < rec.size) {
+            if(pipe->scratch_size < rec.size) {
+                free(pipe->scratch);
+                pipe->scratch_size = rec.size;
+                pipe->scratch = malloc(rec.size);
+                assert(pipe->scratch);
+            }
+            spsc_ring_copy_out(&ring->ring, head, pipe->scratch, rec.size);
+            data = pipe->scratch;
+        }
+        head += rec.size;
+
+        switch(rec.type) {
+        case LOG_LINE:
+            fputs(pipe->line_prefix, stderr);
+            fwrite(data, 1, rec.size, stderr);
+            break;
+        case LOG_DUMP:
+            pipe->formatter(&rec.dump, data, rec.size);
+            break;
+        }
+
+        /* Give the space back to the worker a record at a time. */
+        spsc_ring_consume(&ring->ring, head);
+        printed++;
+    }
+    funlockfile(stderr);
+
+    return printed;
+}
+
+static size_t
+logpipe_drain(void *arg, int terminate) {
+    struct logpipe *pipe = arg;
+    size_t printed = 0;
+    (void)terminate;
+    for(int i = 0; i < pipe->rings_count; i++)
+        printed += log_ring_drain(pipe, &pipe->rings[i]);
+    return printed;
+}
+
+struct logpipe *
+logpipe_open(int workers, size_t ring_size, const char *line_prefix,
+             log_dump_formatter_f *formatter) {
+    struct logpipe *pipe = calloc(1, sizeof(*pipe));
+    assert(pipe);
+    pipe->line_prefix = line_prefix;
+    pipe->formatter = formatter;
+    pipe->rings_count = workers;
+    pipe->rings = aligned_alloc(64, workers * sizeof(pipe->rings[0]));
+    assert(pipe->rings);
+    memset(pipe->rings, 0, workers * sizeof(pipe->rings[0]));
+
+    for(int i = 0; i < workers; i++) {
+        struct log_ring *ring = &pipe->rings[i];
+        ring->pipe = pipe;
+        spsc_ring_init(&ring->ring, ring_size < 4096 ? 4096 : ring_size);
+    }
+
+    spsc_writer_start(&pipe->writer, logpipe_drain, pipe, LOG_POLL_INTERVAL_NS,
+                      0);
+
+    return pipe;
+}
+
+struct log_ring *
+logpipe_ring(struct logpipe *pipe, int worker) {
+    assert(worker >= 0 && worker < pipe->rings_count);
+    return &pipe->rings[worker];
+}
+
+void
+log_ring_attach(struct log_ring *ring) {
+    ring->owner = pthread_self();
+    __atomic_store_n(&ring->attached, 1, __ATOMIC_RELEASE);
+}
+
+void
+log_ring_detach(struct log_ring *ring) {
+    if(!log_ring_owned(ring)) return;
+
+    while(__atomic_load_n(&ring->ring.head, __ATOMIC_ACQUIRE)
+          != ring->ring.tail) {
+        struct timespec ts = {0, LOG_DETACH_POLL_NS};
+        nanosleep(&ts, NULL);
+    }
+    __atomic_store_n(&ring->attached, 0, __ATOMIC_RELEASE);
+}
+
+size_t
+logpipe_close(struct logpipe *pipe) {
+    size_t dropped = 0;
+
+    if(!pipe) return 0;
+
+    spsc_writer_stop(&pipe->writer);
+
+    for(int i = 0; i < pipe->rings_count; i++) {
+        dropped += pipe->rings[i].ring.dropped;
+        spsc_ring_free(&pipe->rings[i].ring);
+    }
+    free(pipe->rings);
+    free(pipe->scratch);
+    free(pipe);
+
+    return dropped;
+}
+
+#ifdef TCPKALI_LOGPIPE_UNIT_TEST
+
+static size_t dumps_seen;
+static size_t dump_bytes_seen;
+
+static void
+count_dump(const struct log_dump *dump, const void *data, size_t size) {
+    assert(dump->fd == 5);
+    assert(dump->original_size == size + dump->preceding + dump->following);
+    for(size_t i = 0; i < size; i++)
+        assert(((const char *)data)[i] == 'x');
+    dumps_seen++;
+    dump_bytes_seen += size;
+}
+
+static void
+vprintf_wrapper(struct log_ring *ring, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    log_ring_vprintf(ring, fmt, ap);
+    va_end(ap);
+}
+
+int
+main() {
+    /* The log lines go to stderr, keep the test output clean. */
+    assert(freopen("/dev/null", "w", stderr));
+
+    struct logpipe *pipe = logpipe_open(2, 100, "", count_dump);
+    struct log_ring *ring = logpipe_ring(pipe, 1);
+    assert(ring->ring.size == 4096);
+
+    /* Not attached yet: printed synchronously. */
+    char chunk[1000];
+    memset(chunk, 'x', sizeof(chunk));
+    struct log_dump dump = {.prefix = "Snd", .fd = 5, .original_size = 1000};
+    log_ring_dump(ring, &dump, chunk, sizeof(chunk));
+    assert(dumps_seen == 1);
+
+    /* Wrap around the ring many times while the writer drains it. */
+    log_ring_attach(ring);
+    size_t appended = 1;
+    for(int i = 0; i < 2000; i++) {
+        size_t before = ring->ring.dropped;
+        dump.preceding = i % 10;
+        dump.original_size = sizeof(chunk) - 10 + dump.preceding;
+        log_ring_dump(ring, &dump, chunk, sizeof(chunk) - 10);
+        if(ring->ring.dropped == before) appended++;
+        vprintf_wrapper(ring, "Line %d of %s\n", i, "the test");
+    }
+    /* A line longer than the stack buffer, and never fitting the ring. */
+    char huge[5000];
+    memset(huge, 'y', sizeof(huge) - 1);
+    huge[sizeof(huge) - 1] = '\0';
+    size_t dropped = ring->ring.dropped;
+    vprintf_wrapper(ring, "%s", huge);
+    assert(ring->ring.dropped == dropped + 1);
+    dropped++;
+
+    log_ring_detach(ring);
+    assert(__atomic_load_n(&dumps_seen, __ATOMIC_ACQUIRE) == appended);
+
+    /* After the detach, synchronous again. */
+    dump.preceding = 0;
+    dump.original_size = 10;
+    log_ring_dump(ring, &dump, chunk, 10);
+    assert(dumps_seen == appended + 1);
+
+    assert(logpipe_close(pipe) == dropped);
+    assert(dump_bytes_seen == 1000 + (appended - 1) * 990 + 10);
+
+    return 0;
+}
+
+#endif /* TCPKALI_LOGPIPE_UNIT_TEST */
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_LOGPIPE_H
+#define TCPKALI_LOGPIPE_H
+
+#include <stddef.h>
+#include <stdarg.h>
+
+/*
+ * The worker log lines and data dumps (--dump-*, -v) are handed over to
+ * a background thread instead of being printed by the worker itself.
+ *
+ * Each worker copies its records into its own ring, without locks or
+ * system calls. The writer thread drains the rings and does the output.
+ * The log lines are formatted by the worker, as their arguments do not
+ * outlive the call. The data dumps are copied as raw bytes and formatted
+ * by the writer thread. When the writer falls behind and the record does
+ * not fit into the ring, it is dropped and counted instead of holding up
+ * the worker.
+ */
+
+struct logpipe;
+struct log_ring;
+
+/*
+ * A data dump as given to the formatter. The data is already truncated
+ * to (size) bytes; (preceding) and (following) are the number of bytes
+ * cut off before and after it.
+ */
+struct log_dump {
+    const char *prefix; /* Must be a static string */
+    int fd;             /* Or -1 */
+    size_t original_size;
+    size_t preceding;
+    size_t following;
+    size_t hl_offset;
+    size_t hl_length;
+};
+typedef void(log_dump_formatter_f)(const struct log_dump *, const void *data,
+                                   size_t size);
+
+/*
+ * Start the writer thread with a ring per worker. The log lines are
+ * printed after the (line_prefix), and the dumps with the formatter.
+ */
+struct logpipe *logpipe_open(int workers, size_t ring_size,
+                             const char *line_prefix,
+                             log_dump_formatter_f *);
+
+/*
+ * The ring of the given worker.
+ */
+struct log_ring *logpipe_ring(struct logpipe *, int worker);
+
+/*
+ * Make the calling thread the only one appending to the ring.
+ * The log_ring_*() calls made by the other threads print synchronously.
+ */
+void log_ring_attach(struct log_ring *);
+
+/*
+ * Wait until the writer prints out what is in the ring, and detach it
+ * from the thread, so the later output is synchronous.
+ */
+void log_ring_detach(struct log_ring *);
+
+void log_ring_vprintf(struct log_ring *, const char *fmt, va_list ap);
+void log_ring_dump(struct log_ring *, const struct log_dump *,
+                   const void *data, size_t size);
+
+/*
+ * Print out what is left in the rings and stop the thread.
+ * Returns the number of records dropped.
+ */
+size_t logpipe_close(struct logpipe *);
+
+#endif /* TCPKALI_LOGPIPE_H */
@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <config.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <assert.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+
+#include "tcpkali_engine.h"
+#include "tcpkali_metrics.h"
+
+struct metrics_server {
+    struct engine *eng;
+    int lsock;
+    pthread_t thread;
+    volatile int terminate;
+};
+
+/*
+ * Upper bounds of the latency histogram buckets, in seconds.
+ */
+static const double latency_buckets[] = {
+    0.0001, 0.0002, 0.0005, 0.001, 0.002, 0.005, 0.01, 0.02,
+    0.05,   0.1,    0.2,    0.5,   1,     2,     5,     10};
+#define LATENCY_BUCKETS (sizeof(latency_buckets) / sizeof(latency_buckets[0]))
+
+struct mbuf {
+    char *buf;
+    size_t size;
+    size_t allocated;
+};
+
+static void
+mbuf_printf(struct mbuf *mb, const char *fmt, ...) {
+    for(;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int ret = vsnprintf(mb->buf + mb->size, mb->allocated - mb->size, fmt,
+                            ap);
+        va_end(ap);
+        assert(ret >= 0);
+        if((size_t)ret < mb->allocated - mb->size) {
+            mb->size += ret;
+            return;
+        }
+        mb->allocated = 2 * mb->allocated + ret + 1;
+        mb->buf = realloc(mb->buf, mb->allocated);
+        assert(mb->buf);
+    }
+}
+
+static void
+format_counter(struct mbuf *mb, const char *name, const char *help,
+               unsigned long long value) {
+    mbuf_printf(mb, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", name, help,
+                name, name, value);
+}
+
+/*
+ * The histogram values are kept in --latency-resolution units.
+ */
+static void
+format_histogram(struct mbuf *mb, const char *name, const char *help,
+                 struct hdr_histogram *hist) {
+    int64_t buckets[LATENCY_BUCKETS] = {0};
+
+    struct hdr_iter iter;
+    hdr_iter_recorded_init(&iter, hist);
+    while(hdr_iter_next(&iter)) {
+        double value = iter.value_from_index / latency_units_per_second;
+        for(size_t i = 0; i < LATENCY_BUCKETS; i++) {
+            if(value <= latency_buckets[i]) {
+                buckets[i] += iter.count_at_index;
+                break;
+            }
+        }
+    }
+
+    mbuf_printf(mb, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    int64_t cumulative = 0;
+    for(size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        cumulative += buckets[i];
+        mbuf_printf(mb, "%s_bucket{le=\"%g\"} %lld\n", name, latency_buckets[i],
+                    (long long)cumulative);
+    }
+    mbuf_printf(mb, "%s_bucket{le=\"+Inf\"} %lld\n", name,
+                (long long)hist->total_count);
+    mbuf_printf(mb, "%s_sum %.6f\n", name,
+                hist->total_count ? hdr_mean(hist) * hist->total_count
+                                        / latency_units_per_second
+                                  : 0.0);
+    mbuf_printf(mb, "%s_count %lld\n", name, (long long)hist->total_count);
+}
+
+static void
+format_metrics(struct metrics_server *ms, struct mbuf *mb) {
+    non_atomic_traffic_stats traffic = engine_traffic(ms->eng);
+    format_counter(mb, "tcpkali_sent_bytes_total", "Bytes sent.",
+                   traffic.bytes_sent);
+    format_counter(mb, "tcpkali_received_bytes_total", "Bytes received.",
+                   traffic.bytes_rcvd);
+    format_counter(mb, "tcpkali_writes_total", "Number of write(2) calls.",
+                   traffic.num_writes);
+    format_counter(mb, "tcpkali_reads_total", "Number of read(2) calls.",
+                   traffic.num_reads);
+    format_counter(mb, "tcpkali_sent_messages_total", "Messages sent.",
+                   traffic.msgs_sent);
+    format_counter(mb, "tcpkali_received_messages_total",
+                   "Messages received.", traffic.msgs_rcvd);
+    format_counter(mb, "tcpkali_lost_messages_total",
+                   "Binary marker sequence gaps.", traffic.msgs_lost);
+    format_counter(mb, "tcpkali_reordered_messages_total",
+                   "Binary marker sequence going back.",
+                   traffic.msgs_reordered);
+    format_counter(mb, "tcpkali_duplicated_messages_total",
+                   "Binary marker sequence seen again (--fanout).",
+                   traffic.msgs_duplicated);
+    format_counter(mb, "tcpkali_echo_mismatches_total",
+                   "Echoed blocks differing from the data sent.",
+                   traffic.echo_mismatches);
+
+    size_t connecting, incoming, outgoing, counter;
+    engine_get_connection_stats(ms->eng, &connecting, &incoming, &outgoing,
+                                &counter);
+    mbuf_printf(mb,
+                "# HELP tcpkali_connections Open connections.\n"
+                "# TYPE tcpkali_connections gauge\n"
+                "tcpkali_connections{state=\"connecting\"} %zu\n"
+                "tcpkali_connections{state=\"incoming\"} %zu\n"
+                "tcpkali_connections{state=\"outgoing\"} %zu\n",
+                connecting, incoming, outgoing);
+    format_counter(mb, "tcpkali_connections_opened_total",
+                   "Connections initiated or accepted.", counter);
+    format_counter(mb, "tcpkali_connections_closed_total",
+                   "Established connections closed.", traffic.conns_closed);
+
+    statsd_report_latency_types latency_types =
+        engine_params(ms->eng)->latency_setting;
+    if(!latency_types) return;
+
+    struct latency_snapshot *latency =
+        engine_collect_latency_snapshot(ms->eng);
+    if(latency_types & SLT_CONNECT)
+        format_histogram(mb, "tcpkali_connect_latency_seconds",
+                         "TCP connect latency.", latency->connect_histogram);
+    if(latency_types & SLT_FIRSTBYTE)
+        format_histogram(mb, "tcpkali_first_byte_latency_seconds",
+                         "First byte latency.", latency->firstbyte_histogram);
+    if(latency_types & SLT_HANDSHAKE)
+        format_histogram(mb, "tcpkali_tls_handshake_latency_seconds",
+                         "TLS handshake latency.",
+                         latency->handshake_histogram);
+    if(latency_types & SLT_UPGRADE)
+        format_histogram(mb, "tcpkali_websocket_upgrade_latency_seconds",
+                         "WebSocket upgrade latency.",
+                         latency->upgrade_histogram);
+    if(latency_types & SLT_MARKER)
+        format_histogram(mb, "tcpkali_message_latency_seconds",
+                         "Message latency.", latency->marker_histogram);
+    engine_free_latency_snapshot(latency);
+}
+
+static void
+write_all(int fd, const char *buf, size_t size) {
+    while(size) {
+        ssize_t wrote = write(fd, buf, size);
+        if(wrote == -1 && errno == EINTR) continue;
+        if(wrote <= 0) return;
+        buf += wrote;
+        size -= wrote;
+    }
+}
+
+static void
+serve_scrape(struct metrics_server *ms, int fd) {
+    /* A slow client should not hold up the next scrape for long. */
+    struct timeval tv = {.tv_sec = 1, .tv_usec = 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    /* Wait for the end of the request headers. */
+    char req[2048];
+    size_t req_size = 0;
+    while(req_size < sizeof(req) - 1) {
+        ssize_t rd = read(fd, req + req_size, sizeof(req) - 1 - req_size);
+        if(rd <= 0) return;
+        req_size += rd;
+        req[req_size] = '\0';
+        if(strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) break;
+    }
+
+    struct mbuf body = {0, 0, 0};
+    const char *status;
+    if(strncmp(req, "GET ", 4) != 0) {
+        status = "405 Method Not Allowed";
+        mbuf_printf(&body, "Only GET is supported\n");
+    } else {
+        status = "200 OK";
+        format_metrics(ms, &body);
+    }
+
+    struct mbuf response = {0, 0, 0};
+    mbuf_printf(&response,
+                "HTTP/1.0 %s\r\n"
+                "Content-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: %zu\r\n"
+                "Connection: close\r\n"
+                "\r\n",
+                status, body.size);
+    write_all(fd, response.buf, response.size);
+    write_all(fd, body.buf, body.size);
+    free(response.buf);
+    free(body.buf);
+}
+
+static void *
+metrics_thread(void *arg) {
+    struct metrics_server *ms = arg;
+
+#ifdef SCHED_IDLE
+    /* Only use the CPU time the workers leave over. */
+    struct sched_param param = {.sched_priority = 0};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+    while(!ms->terminate) {
+        struct pollfd pfd = {.fd = ms->lsock, .events = POLLIN};
+        if(poll(&pfd, 1, 250) <= 0) continue;
+        int fd = accept(ms->lsock, NULL, NULL);
+        if(fd == -1) continue;
+        serve_scrape(ms, fd);
+        close(fd);
+    }
+
+    return NULL;
+}
+
+struct metrics_server *
+metrics_server_start(struct engine *eng, const char *listen_spec) {
+    char *spec = strdup(listen_spec);
+    char *host = spec;
+    char *port = strrchr(host, ':');
+    if(port) {
+        *port++ = '\0';
+    } else {
+        port = host;
+        host = "";
+    }
+    /* [::1]:9100 */
+    if(host[0] == '[' && host[strlen(host) - 1] == ']') {
+        host[strlen(host) - 1] = '\0';
+        host++;
+    }
+
+    struct addrinfo hints = {.ai_family = AF_UNSPEC,
+                             .ai_socktype = SOCK_STREAM,
+                             .ai_flags = AI_PASSIVE};
+    struct addrinfo *res;
+    int err = getaddrinfo(*host ? host : NULL, port, &hints, &res);
+    free(spec);
+    if(err) {
+        fprintf(stderr, "--metrics-listen %s: %s\n", listen_spec,
+                gai_strerror(err));
+        return NULL;
+    }
+
+    int lsock = -1;
+    for(struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        lsock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if(lsock == -1) continue;
+        int on = 1;
+        setsockopt(lsock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if(bind(lsock, ai->ai_addr, ai->ai_addrlen) == 0
+           && listen(lsock, 16) == 0)
+            break;
+        err = errno;
+        close(lsock);
+        lsock = -1;
+        errno = err;
+    }
+    freeaddrinfo(res);
+    if(lsock == -1) {
+        fprintf(stderr, "--metrics-listen %s: %s\n", listen_spec,
+                strerror(errno));
+        return NULL;
+    }
+
+    struct metrics_server *ms = calloc(1, sizeof(*ms));
+    assert(ms);
+    ms->eng = eng;
+    ms->lsock = lsock;
+    if(pthread_create(&ms->thread, NULL, metrics_thread, ms) != 0) {
+        fprintf(stderr, "--metrics-listen %s: Can not start thread: %s\n",
+                listen_spec, strerror(errno));
+        close(lsock);
+        free(ms);
+        return NULL;
+    }
+
+    return ms;
+}
+
+void
+metrics_server_stop(struct metrics_server *ms) {
+    if(!ms) return;
+    ms->terminate = 1;
+    pthread_join(ms->thread, NULL);
+    close(ms->lsock);
+    free(ms);
+}
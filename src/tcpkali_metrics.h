@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_METRICS_H
+#define TCPKALI_METRICS_H
+
+/*
+ * Prometheus text exposition endpoint, see --metrics-listen.
+ *
+ * The scrapes are served by a dedicated low priority thread. It only reads
+ * the atomic traffic counters and the published latency histograms,
+ * so the workers are never blocked by a scrape.
+ */
+
+struct engine;
+struct metrics_server;
+
+/*
+ * Start serving the metrics on [host:]port.
+ * Prints the error and returns NULL if the address can't be listened on.
+ */
+struct metrics_server *metrics_server_start(struct engine *,
+                                            const char *listen_spec);
+
+/*
+ * Stop the thread and close the listening socket.
+ * Must be called before the engine is terminated.
+ */
+void metrics_server_stop(struct metrics_server *);
+
+#endif /* TCPKALI_METRICS_H */
@@ -0,0 +1,464 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <string.h>
+#include <assert.h>
+
+#include "tcpkali_mqtt.h"
+
+#define MQTT_REMAINING_LENGTH_MAX 268435455 /* Four Variable Byte digits */
+
+static size_t
+mqtt_varint_size(size_t value) {
+    size_t size = 1;
+    while(value >= 128) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static size_t
+mqtt_varint(uint8_t *buf, size_t value) {
+    size_t size = 0;
+    do {
+        uint8_t digit = value & 0x7f;
+        value >>= 7;
+        buf[size++] = digit | (value ? 0x80 : 0);
+    } while(value);
+    return size;
+}
+
+/*
+ * Size of the packet with the (remaining) bytes after the fixed header.
+ */
+static size_t
+mqtt_packet_size(size_t remaining) {
+    assert(remaining <= MQTT_REMAINING_LENGTH_MAX);
+    return 1 + mqtt_varint_size(remaining) + remaining;
+}
+
+static size_t
+mqtt_fixed_header(uint8_t *buf, uint8_t type_flags, size_t remaining) {
+    buf[0] = type_flags;
+    return 1 + mqtt_varint(buf + 1, remaining);
+}
+
+static size_t
+mqtt_string(uint8_t *buf, const void *str, size_t size) {
+    assert(size <= 65535);
+    buf[0] = size >> 8;
+    buf[1] = size;
+    memcpy(buf + 2, str, size);
+    return 2 + size;
+}
+
+static size_t
+mqtt_connect_remaining(enum mqtt_version version, size_t client_id_size) {
+    /* Protocol Name, Level, Flags and Keep Alive, MQTT 5 Properties */
+    return 10 + (version == MQTT_V5) + 2 + client_id_size;
+}
+
+size_t
+mqtt_connect_estimate(enum mqtt_version version, size_t client_id_size) {
+    return mqtt_packet_size(mqtt_connect_remaining(version, client_id_size));
+}
+
+size_t
+mqtt_connect(uint8_t *buf, enum mqtt_version version, const char *client_id,
+             size_t client_id_size, unsigned keepalive) {
+    size_t size = mqtt_fixed_header(
+        buf, MQTT_CONNECT << 4, mqtt_connect_remaining(version, client_id_size));
+    size += mqtt_string(buf + size, "MQTT", 4);
+    buf[size++] = version;
+    buf[size++] = 0x02; /* Clean Session (Clean Start in MQTT 5) */
+    if(keepalive > 65535) keepalive = 65535;
+    buf[size++] = keepalive >> 8;
+    buf[size++] = keepalive;
+    if(version == MQTT_V5) buf[size++] = 0; /* No Properties */
+    size += mqtt_string(buf + size, client_id, client_id_size);
+    return size;
+}
+
+static size_t
+mqtt_subscribe_remaining(enum mqtt_version version, size_t filter_size) {
+    /* Packet Identifier, MQTT 5 Properties, the filter and its options */
+    return 2 + (version == MQTT_V5) + 2 + filter_size + 1;
+}
+
+size_t
+mqtt_subscribe_estimate(enum mqtt_version version, size_t filter_size) {
+    return mqtt_packet_size(mqtt_subscribe_remaining(version, filter_size));
+}
+
+size_t
+mqtt_subscribe(uint8_t *buf, enum mqtt_version version, uint16_t packet_id,
+               const char *filter, size_t filter_size) {
+    size_t size = mqtt_fixed_header(
+        buf, (MQTT_SUBSCRIBE << 4) | 0x02,
+        mqtt_subscribe_remaining(version, filter_size));
+    buf[size++] = packet_id >> 8;
+    buf[size++] = packet_id;
+    if(version == MQTT_V5) buf[size++] = 0; /* No Properties */
+    size += mqtt_string(buf + size, filter, filter_size);
+    buf[size++] = 0; /* Maximum QoS 0, so nothing is to be acknowledged */
+    return size;
+}
+
+static size_t
+mqtt_publish_remaining(enum mqtt_version version, size_t topic_size,
+                       size_t payload_size, int qos) {
+    return 2 + topic_size + (qos ? 2 : 0) + (version == MQTT_V5)
+           + payload_size;
+}
+
+size_t
+mqtt_publish_estimate(enum mqtt_version version, size_t topic_size,
+                      size_t payload_size, int qos) {
+    return mqtt_packet_size(
+        mqtt_publish_remaining(version, topic_size, payload_size, qos));
+}
+
+size_t
+mqtt_publish(uint8_t *buf, enum mqtt_version version, const char *topic,
+             size_t topic_size, int qos, const void *payload,
+             size_t payload_size) {
+    size_t size = mqtt_fixed_header(
+        buf, (MQTT_PUBLISH << 4) | (qos << 1),
+        mqtt_publish_remaining(version, topic_size, payload_size, qos));
+    size += mqtt_string(buf + size, topic, topic_size);
+    if(qos) {
+        /* See mqtt_publish_number(). */
+        buf[size++] = 0;
+        buf[size++] = 1;
+    }
+    if(version == MQTT_V5) buf[size++] = 0; /* No Properties */
+    memcpy(buf + size, payload, payload_size);
+    return size + payload_size;
+}
+
+void
+mqtt_publish_number(uint8_t *packet, uint16_t packet_id) {
+    size_t offset = 1;
+    while(packet[offset++] & 0x80)
+        ; /* Skip the Remaining Length */
+    offset += 2 + ((packet[offset] << 8) | packet[offset + 1]);
+    packet[offset] = packet_id >> 8;
+    packet[offset + 1] = packet_id;
+}
+
+size_t
+mqtt_pingreq(uint8_t *buf) {
+    return mqtt_fixed_header(buf, MQTT_PINGREQ << 4, 0);
+}
+
+/*
+ * The outcome of the packet, from the first bytes of its Variable Header.
+ */
+static uint8_t
+mqtt_packet_reason(const struct mqtt_parser *p) {
+    const uint8_t *head = p->head;
+    switch(p->type) {
+    case MQTT_CONNACK:
+        /* Acknowledge Flags, then the Return Code or the Reason Code */
+        return p->head_size >= 2 ? head[1] : 0;
+    case MQTT_PUBACK:
+        /* Packet Identifier, then the MQTT 5 Reason Code, if any */
+        return p->v5 && p->head_size >= 3 ? head[2] : 0;
+    case MQTT_SUBACK:
+        /* Packet Identifier, MQTT 5 Properties, then the Reason Codes */
+        if(!p->v5) return p->head_size >= 3 ? head[2] : 0;
+        if(p->head_size >= 3 && head[2] < 0x80
+           && p->head_size > 3 + head[2])
+            return head[3 + head[2]];
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+enum mqtt_parse_event
+mqtt_parse(struct mqtt_parser *p, uint8_t **buf, size_t *size,
+           uint8_t **payload, size_t *payload_size) {
+    uint8_t *ptr = *buf;
+    uint8_t *end = ptr + *size;
+    enum mqtt_parse_event event = MQTTE_NEED_MORE_DATA;
+
+    while(event == MQTTE_NEED_MORE_DATA) {
+        /* The parts of the PUBLISH which are empty. */
+        if(p->state == MQTTP_TOPIC && p->skip == 0) {
+            p->state = p->v5 ? MQTTP_PROPERTIES_LENGTH : MQTTP_PAYLOAD;
+            p->shift = 0;
+        } else if(p->state == MQTTP_PROPERTIES && p->skip == 0) {
+            p->state = MQTTP_PAYLOAD;
+        }
+        if(p->state > MQTTP_LENGTH && p->left == 0) {
+            if(p->state != MQTTP_PAYLOAD && p->state != MQTTP_SKIP) {
+                event = MQTTE_PROTOCOL_ERROR;
+                break;
+            }
+            p->type = p->type_flags >> 4;
+            p->reason = mqtt_packet_reason(p);
+            p->state = MQTTP_TYPE;
+            event = MQTTE_PACKET_END;
+            break;
+        }
+        if(ptr == end) break;
+
+        size_t n;
+        switch(p->state) {
+        case MQTTP_TYPE:
+            p->type_flags = *ptr++;
+            if((p->type_flags >> 4) == 0) {
+                event = MQTTE_PROTOCOL_ERROR;
+                break;
+            }
+            p->state = MQTTP_LENGTH;
+            p->left = 0;
+            p->shift = 0;
+            break;
+        case MQTTP_LENGTH:
+            p->left |= (uint32_t)(*ptr & 0x7f) << p->shift;
+            p->shift += 7;
+            if(*ptr++ & 0x80) {
+                if(p->shift == 28) event = MQTTE_PROTOCOL_ERROR;
+                break;
+            }
+            p->head_size = 0;
+            p->state = (p->type_flags >> 4) == MQTT_PUBLISH
+                           ? MQTTP_TOPIC_LENGTH
+                           : MQTTP_SKIP;
+            break;
+        case MQTTP_TOPIC_LENGTH:
+            p->head[p->head_size++] = *ptr++;
+            p->left--;
+            if(p->head_size < 2) break;
+            /* The Packet Identifier follows the Topic Name at QoS > 0. */
+            p->skip = ((p->head[0] << 8) | p->head[1])
+                      + ((p->type_flags & 0x06) ? 2 : 0);
+            if(p->skip > p->left) {
+                event = MQTTE_PROTOCOL_ERROR;
+                break;
+            }
+            p->state = MQTTP_TOPIC;
+            break;
+        case MQTTP_TOPIC:
+        case MQTTP_PROPERTIES:
+            n = (size_t)(end - ptr) < p->skip ? (size_t)(end - ptr) : p->skip;
+            ptr += n;
+            p->skip -= n;
+            p->left -= n;
+            break;
+        case MQTTP_PROPERTIES_LENGTH:
+            if(p->shift == 0) p->skip = 0;
+            p->skip |= (uint32_t)(*ptr & 0x7f) << p->shift;
+            p->shift += 7;
+            p->left--;
+            if(*ptr++ & 0x80) {
+                if(p->shift == 28) event = MQTTE_PROTOCOL_ERROR;
+                break;
+            }
+            if(p->skip > p->left) {
+                event = MQTTE_PROTOCOL_ERROR;
+                break;
+            }
+            p->state = MQTTP_PROPERTIES;
+            break;
+        case MQTTP_PAYLOAD:
+            n = (size_t)(end - ptr) < p->left ? (size_t)(end - ptr) : p->left;
+            *payload = ptr;
+            *payload_size = n;
+            ptr += n;
+            p->left -= n;
+            event = MQTTE_PAYLOAD;
+            break;
+        case MQTTP_SKIP:
+            n = (size_t)(end - ptr) < p->left ? (size_t)(end - ptr) : p->left;
+            for(size_t i = 0; i < n && p->head_size < sizeof(p->head); i++)
+                p->head[p->head_size++] = ptr[i];
+            ptr += n;
+            p->left -= n;
+            break;
+        }
+    }
+
+    *size = end - ptr;
+    *buf = ptr;
+    return event;
+}
+
+#ifdef TCPKALI_MQTT_UNIT_TEST
+
+#include <stdio.h>
+
+/*
+ * Parse the (stream) in pieces of (piece) bytes, counting the packets
+ * of each type and the payload bytes.
+ */
+static void
+parse_pieces(int v5, uint8_t *stream, size_t size, size_t piece,
+             unsigned counts[16], size_t *payload_total, uint8_t *reasons) {
+    struct mqtt_parser p;
+    memset(&p, 0, sizeof(p));
+    p.v5 = v5;
+    memset(counts, 0, 16 * sizeof(counts[0]));
+    *payload_total = 0;
+    for(size_t off = 0; off < size; off += piece) {
+        uint8_t *ptr = stream + off;
+        size_t len = size - off < piece ? size - off : piece;
+        for(;;) {
+            uint8_t *payload;
+            size_t payload_size;
+            enum mqtt_parse_event ev =
+                mqtt_parse(&p, &ptr, &len, &payload, &payload_size);
+            if(ev == MQTTE_NEED_MORE_DATA) break;
+            assert(ev != MQTTE_PROTOCOL_ERROR);
+            if(ev == MQTTE_PAYLOAD) {
+                *payload_total += payload_size;
+            } else {
+                reasons[p.type] = p.reason;
+                counts[p.type]++;
+            }
+        }
+        assert(len == 0);
+    }
+    assert(p.state == MQTTP_TYPE);
+}
+
+int
+main() {
+    uint8_t buf[512];
+    size_t size;
+
+    /* MQTT 3.1.1 CONNECT, as in the specification's example. */
+    size = mqtt_connect(buf, MQTT_V311, "tk", 2, 60);
+    assert(size == mqtt_connect_estimate(MQTT_V311, 2));
+    assert(size == 16);
+    assert(memcmp(buf, "\x10\x0e\0\x04MQTT\x04\x02\0\x3c\0\x02tk", 16) == 0);
+    size = mqtt_connect(buf, MQTT_V5, "tk", 2, 0);
+    assert(size == 17);
+    assert(memcmp(buf, "\x10\x0f\0\x04MQTT\x05\x02\0\0\0\0\x02tk", 17) == 0);
+
+    size = mqtt_subscribe(buf, MQTT_V311, 1, "a/#", 3);
+    assert(size == mqtt_subscribe_estimate(MQTT_V311, 3));
+    assert(memcmp(buf, "\x82\x08\0\x01\0\x03" "a/#\0", 10) == 0);
+
+    size = mqtt_publish(buf, MQTT_V311, "t", 1, 0, "hi", 2);
+    assert(size == mqtt_publish_estimate(MQTT_V311, 1, 2, 0));
+    assert(memcmp(buf, "\x30\x05\0\x01thi", 7) == 0);
+    size = mqtt_publish(buf, MQTT_V5, "t", 1, 1, "hi", 2);
+    assert(size == mqtt_publish_estimate(MQTT_V5, 1, 2, 1));
+    mqtt_publish_number(buf, 0x1234);
+    assert(memcmp(buf, "\x32\x08\0\x01t\x12\x34\0hi", 10) == 0);
+
+    /* The Remaining Length takes two bytes from 128 on. */
+    static uint8_t big[300];
+    size = mqtt_publish(buf, MQTT_V311, "t", 1, 1, big, 200);
+    assert(size == 3 + 5 + 200);
+    assert(buf[0] == 0x32 && buf[1] == ((205 & 0x7f) | 0x80) && buf[2] == 1);
+    mqtt_publish_number(buf, 7);
+    assert(buf[6] == 0 && buf[7] == 7);
+
+    assert(mqtt_pingreq(buf) == 2 && buf[0] == 0xc0 && buf[1] == 0);
+
+    /*
+     * A broker's stream: CONNACK, SUBACK, PUBACK, a PUBLISH at QoS 0,
+     * an empty PUBLISH, a big PUBLISH at QoS 1, and a PINGRESP.
+     */
+    uint8_t stream[512];
+    size = 0;
+    memcpy(stream + size, "\x20\x02\0\0", 4);
+    size += 4;
+    memcpy(stream + size, "\x90\x03\0\x01\x80", 5);
+    size += 5;
+    memcpy(stream + size, "\x40\x02\0\x01", 4);
+    size += 4;
+    size += mqtt_publish(stream + size, MQTT_V311, "topic", 5, 0, "hello", 5);
+    size += mqtt_publish(stream + size, MQTT_V311, "", 0, 0, "", 0);
+    size += mqtt_publish(stream + size, MQTT_V311, "t", 1, 1, big, 300);
+    memcpy(stream + size, "\xd0\x00", 2);
+    size += 2;
+
+    for(size_t piece = 1; piece <= size; piece++) {
+        unsigned counts[16];
+        uint8_t reasons[16];
+        size_t payload;
+        parse_pieces(0, stream, size, piece, counts, &payload, reasons);
+        assert(counts[MQTT_CONNACK] == 1 && reasons[MQTT_CONNACK] == 0);
+        assert(counts[MQTT_SUBACK] == 1 && reasons[MQTT_SUBACK] == 0x80);
+        assert(counts[MQTT_PUBACK] == 1);
+        assert(counts[MQTT_PUBLISH] == 3);
+        assert(counts[MQTT_PINGRESP] == 1);
+        assert(payload == 5 + 300);
+    }
+
+    /* MQTT 5: the properties are skipped, the reason codes are found. */
+    size = 0;
+    memcpy(stream + size, "\x20\x03\0\x87\0", 5); /* Not authorized */
+    size += 5;
+    memcpy(stream + size, "\x90\x04\0\x01\0\x01", 6);
+    size += 6;
+    memcpy(stream + size, "\x40\x04\0\x01\x10\0", 6); /* No subscribers */
+    size += 6;
+    /* PUBLISH with the Message Expiry Interval property */
+    memcpy(stream + size, "\x30\x0c\0\x01t\x05\x02\0\0\0\x3c" "abc", 14);
+    size += 14;
+    for(size_t piece = 1; piece <= size; piece++) {
+        unsigned counts[16];
+        uint8_t reasons[16];
+        size_t payload;
+        parse_pieces(1, stream, size, piece, counts, &payload, reasons);
+        assert(counts[MQTT_CONNACK] == 1 && reasons[MQTT_CONNACK] == 0x87);
+        assert(counts[MQTT_SUBACK] == 1 && reasons[MQTT_SUBACK] == 0x01);
+        assert(counts[MQTT_PUBACK] == 1 && reasons[MQTT_PUBACK] == 0x10);
+        assert(counts[MQTT_PUBLISH] == 1);
+        assert(payload == 3);
+    }
+
+    /* The malformed packets. */
+    struct {
+        const char *data;
+        size_t size;
+    } bad[] = {
+        {"\x00\x00", 2},                 /* Reserved packet type */
+        {"\x20\xff\xff\xff\xff\x01", 6}, /* Remaining Length too long */
+        {"\x30\x03\0\x05t", 5},          /* Topic beyond the packet */
+        {"\x32\x03\0\x01t", 5},          /* No room for Packet Identifier */
+    };
+    for(size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        struct mqtt_parser p;
+        uint8_t *ptr = (uint8_t *)bad[i].data;
+        size_t len = bad[i].size;
+        uint8_t *payload;
+        size_t payload_size;
+        memset(&p, 0, sizeof(p));
+        assert(mqtt_parse(&p, &ptr, &len, &payload, &payload_size)
+               == MQTTE_PROTOCOL_ERROR);
+    }
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_MQTT_UNIT_TEST */
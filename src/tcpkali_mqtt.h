@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_MQTT_H
+#define TCPKALI_MQTT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * MQTT 3.1.1 and 5 client packets, see --mqtt. The connections send the
+ * CONNECT and the SUBSCRIBE once, then the PUBLISH packets, and parse
+ * the broker's packets for the acknowledgements and the deliveries.
+ */
+
+enum mqtt_version {
+    MQTT_V311 = 4, /* The Protocol Level of the CONNECT */
+    MQTT_V5 = 5,
+};
+
+enum mqtt_packet_type {
+    MQTT_CONNECT = 1,
+    MQTT_CONNACK = 2,
+    MQTT_PUBLISH = 3,
+    MQTT_PUBACK = 4,
+    MQTT_SUBSCRIBE = 8,
+    MQTT_SUBACK = 9,
+    MQTT_PINGREQ = 12,
+    MQTT_PINGRESP = 13,
+    MQTT_DISCONNECT = 14,
+};
+
+#define MQTT_PINGREQ_SIZE 2
+#define MQTT_PACKET_ID_MAX 65535 /* Packet Identifiers are 1 to 65535 */
+#define MQTT_REASON_FAILURE 0x80 /* The reason codes of refusals start here */
+
+/*
+ * Put the CONNECT packet with a clean session for the (client_id) into
+ * (buf), which must have mqtt_connect_estimate() bytes. The (keepalive)
+ * is in seconds, 0 to disable the keepalives.
+ * Returns the packet size.
+ */
+size_t mqtt_connect_estimate(enum mqtt_version, size_t client_id_size);
+size_t mqtt_connect(uint8_t *buf, enum mqtt_version, const char *client_id,
+                    size_t client_id_size, unsigned keepalive);
+
+/*
+ * Put the SUBSCRIBE packet for the topic (filter) at QoS 0 into (buf),
+ * which must have mqtt_subscribe_estimate() bytes.
+ * Returns the packet size.
+ */
+size_t mqtt_subscribe_estimate(enum mqtt_version, size_t filter_size);
+size_t mqtt_subscribe(uint8_t *buf, enum mqtt_version, uint16_t packet_id,
+                      const char *filter, size_t filter_size);
+
+/*
+ * Put the PUBLISH packet of the (payload) to the (topic) into (buf),
+ * which must have mqtt_publish_estimate() bytes. The QoS 1 packets are
+ * numbered with mqtt_publish_number() before they are sent.
+ * Returns the packet size.
+ */
+size_t mqtt_publish_estimate(enum mqtt_version, size_t topic_size,
+                             size_t payload_size, int qos);
+size_t mqtt_publish(uint8_t *buf, enum mqtt_version, const char *topic,
+                    size_t topic_size, int qos, const void *payload,
+                    size_t payload_size);
+void mqtt_publish_number(uint8_t *packet, uint16_t packet_id);
+
+/*
+ * Put the PINGREQ packet into (buf) of MQTT_PINGREQ_SIZE bytes.
+ */
+size_t mqtt_pingreq(uint8_t *buf);
+
+/*
+ * Streaming parser of the packets sent by the broker. The PUBLISH
+ * payloads are passed through, the rest of the packets are skipped over
+ * by their Remaining Length. The parser is zero-initialized, with (v5)
+ * set for MQTT 5, which adds the properties to the PUBLISH packets.
+ */
+struct mqtt_parser {
+    enum {
+        MQTTP_TYPE,              /* The type byte of the next packet */
+        MQTTP_LENGTH,            /* Remaining Length */
+        MQTTP_TOPIC_LENGTH,      /* Of the PUBLISH Topic Name */
+        MQTTP_TOPIC,             /* Topic Name and Packet Identifier */
+        MQTTP_PROPERTIES_LENGTH, /* MQTT 5 PUBLISH Properties */
+        MQTTP_PROPERTIES,
+        MQTTP_PAYLOAD,           /* The PUBLISH Payload */
+        MQTTP_SKIP,              /* The rest of the other packets */
+    } state;
+    uint8_t type_flags; /* The first byte of the packet */
+    uint8_t shift;      /* Of the Variable Byte Integer being parsed */
+    uint8_t head_size;
+    uint8_t head[8];    /* The first bytes of the Variable Header */
+    uint32_t left;      /* Of the Remaining Length */
+    uint32_t skip;      /* Of the current part of the PUBLISH */
+    int v5;
+    /* Of the packet just parsed */
+    enum mqtt_packet_type type;
+    uint8_t reason; /* CONNACK, PUBACK or the first SUBACK code, or 0 */
+};
+
+enum mqtt_parse_event {
+    MQTTE_NEED_MORE_DATA, /* The input is exhausted */
+    MQTTE_PAYLOAD,        /* A piece of the PUBLISH payload is found */
+    MQTTE_PACKET_END,     /* The packet is complete, see (type) */
+    MQTTE_PROTOCOL_ERROR, /* The input is not an MQTT packet stream */
+};
+
+/*
+ * Consume the input until the next event.
+ */
+enum mqtt_parse_event mqtt_parse(struct mqtt_parser *, uint8_t **buf,
+                                 size_t *size, uint8_t **payload,
+                                 size_t *payload_size);
+
+#endif /* TCPKALI_MQTT_H */
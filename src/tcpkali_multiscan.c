@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "tcpkali_multiscan.h"
+
+/* Up to that many pattern starting bytes are filtered 16 bytes at a time. */
+#define MULTISCAN_SIMD_FIRST_MAX 4
+
+struct tk_multiscan {
+    struct multiscan_pattern {
+        unsigned char *data;
+        size_t size;
+    } *patterns;
+    size_t patterns_count;
+    size_t patterns_allocated;
+
+    /*
+     * The transitions of the states, 0 is the initial state.
+     * Until compiled, this is the trie of the patterns, where 0 means
+     * no transition. Compiled, it is the complete automaton.
+     */
+    uint32_t (*next)[256];
+    int *output; /* A pattern ending at the state, or -1 */
+    size_t states_count;
+    size_t states_allocated;
+    int compiled;
+
+    /* The bytes leaving the initial state. */
+    unsigned char first[256];
+    unsigned char first_bytes[MULTISCAN_SIMD_FIRST_MAX];
+    size_t first_count;
+};
+
+struct tk_multiscan *
+tk_multiscan_new(void) {
+    struct tk_multiscan *ms = calloc(1, sizeof(*ms));
+    assert(ms);
+    return ms;
+}
+
+void
+tk_multiscan_free(struct tk_multiscan *ms) {
+    if(!ms) return;
+    for(size_t i = 0; i < ms->patterns_count; i++) free(ms->patterns[i].data);
+    free(ms->patterns);
+    free(ms->next);
+    free(ms->output);
+    free(ms);
+}
+
+static uint32_t
+multiscan_new_state(struct tk_multiscan *ms) {
+    if(ms->states_count == ms->states_allocated) {
+        ms->states_allocated =
+            ms->states_allocated ? 2 * ms->states_allocated : 16;
+        ms->next =
+            realloc(ms->next, ms->states_allocated * sizeof(ms->next[0]));
+        ms->output =
+            realloc(ms->output, ms->states_allocated * sizeof(ms->output[0]));
+        assert(ms->next && ms->output);
+    }
+    uint32_t state = ms->states_count++;
+    memset(ms->next[state], 0, sizeof(ms->next[state]));
+    ms->output[state] = -1;
+    return state;
+}
+
+size_t
+tk_multiscan_add(struct tk_multiscan *ms, const void *pattern, size_t size) {
+    assert(!ms->compiled);
+    assert(size > 0);
+
+    if(ms->patterns_count == ms->patterns_allocated) {
+        ms->patterns_allocated =
+            ms->patterns_allocated ? 2 * ms->patterns_allocated : 4;
+        ms->patterns = realloc(ms->patterns, ms->patterns_allocated
+                                                 * sizeof(ms->patterns[0]));
+        assert(ms->patterns);
+    }
+    size_t index = ms->patterns_count++;
+    ms->patterns[index].data = malloc(size);
+    assert(ms->patterns[index].data);
+    memcpy(ms->patterns[index].data, pattern, size);
+    ms->patterns[index].size = size;
+
+    if(ms->states_count == 0) multiscan_new_state(ms);
+    const unsigned char *p = pattern;
+    uint32_t state = 0;
+    for(size_t i = 0; i < size; i++) {
+        if(!ms->next[state][p[i]]) {
+            uint32_t new_state = multiscan_new_state(ms);
+            ms->next[state][p[i]] = new_state;
+        }
+        state = ms->next[state][p[i]];
+    }
+    /* The first one of the duplicate patterns is reported. */
+    if(ms->output[state] == -1) ms->output[state] = index;
+    return index;
+}
+
+void
+tk_multiscan_compile(struct tk_multiscan *ms) {
+    assert(!ms->compiled);
+    ms->compiled = 1;
+    if(ms->states_count == 0) multiscan_new_state(ms);
+
+    for(int c = 0; c < 256; c++) {
+        if(!ms->next[0][c]) continue;
+        ms->first[c] = 1;
+        if(ms->first_count < MULTISCAN_SIMD_FIRST_MAX)
+            ms->first_bytes[ms->first_count] = c;
+        ms->first_count++;
+    }
+
+    /*
+     * Go over the trie breadth first, so the failure state, the longest
+     * proper suffix of a state which is also a state, is complete when
+     * its transitions are borrowed.
+     */
+    uint32_t *queue = malloc(ms->states_count * sizeof(queue[0]));
+    uint32_t *fail = calloc(ms->states_count, sizeof(fail[0]));
+    assert(queue && fail);
+    size_t head = 0, tail = 0;
+    for(int c = 0; c < 256; c++) {
+        if(ms->next[0][c]) queue[tail++] = ms->next[0][c];
+    }
+    while(head < tail) {
+        uint32_t state = queue[head++];
+        uint32_t f = fail[state];
+        if(ms->output[state] == -1) ms->output[state] = ms->output[f];
+        for(int c = 0; c < 256; c++) {
+            uint32_t child = ms->next[state][c];
+            if(child) {
+                fail[child] = ms->next[f][c];
+                queue[tail++] = child;
+            } else {
+                ms->next[state][c] = ms->next[f][c];
+            }
+        }
+    }
+    free(queue);
+    free(fail);
+}
+
+size_t
+tk_multiscan_count(const struct tk_multiscan *ms) {
+    return ms->patterns_count;
+}
+
+const void *
+tk_multiscan_pattern(const struct tk_multiscan *ms, size_t index,
+                     size_t *size) {
+    assert(index < ms->patterns_count);
+    *size = ms->patterns[index].size;
+    return ms->patterns[index].data;
+}
+
+/*
+ * Skip to the next byte which could start a pattern, or to the (end).
+ */
+static const unsigned char *
+multiscan_skip(const struct tk_multiscan *ms, const unsigned char *p,
+               const unsigned char *end) {
+    if(ms->first_count == 0) return end;
+    if(ms->first_count == 1) {
+        const unsigned char *c = memchr(p, ms->first_bytes[0], end - p);
+        return c ? c : end;
+    }
+
+#ifdef __SSE2__
+    if(ms->first_count <= MULTISCAN_SIMD_FIRST_MAX) {
+        /* The unused lanes repeat the first byte. */
+        const __m128i b0 = _mm_set1_epi8(ms->first_bytes[0]);
+        const __m128i b1 = _mm_set1_epi8(ms->first_bytes[1]);
+        const __m128i b2 = _mm_set1_epi8(
+            ms->first_bytes[ms->first_count > 2 ? 2 : 0]);
+        const __m128i b3 = _mm_set1_epi8(
+            ms->first_bytes[ms->first_count > 3 ? 3 : 0]);
+        for(; end - p >= 16; p += 16) {
+            __m128i d = _mm_loadu_si128((const __m128i *)p);
+            __m128i eq = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(d, b0), _mm_cmpeq_epi8(d, b1)),
+                _mm_or_si128(_mm_cmpeq_epi8(d, b2), _mm_cmpeq_epi8(d, b3)));
+            unsigned mask = _mm_movemask_epi8(eq);
+            if(mask) return p + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    while(p < end && !ms->first[*p]) p++;
+    return p;
+}
+
+size_t
+tk_multiscan_feed(const struct tk_multiscan *ms, uint32_t *state,
+                  const void *data, size_t size, int *match) {
+    const unsigned char *start = data;
+    const unsigned char *p = start;
+    const unsigned char *end = p + size;
+    uint32_t s = *state;
+
+    assert(ms->compiled);
+
+    while(p < end) {
+        if(s == 0) {
+            p = multiscan_skip(ms, p, end);
+            if(p == end) break;
+        }
+        s = ms->next[s][*p++];
+        if(ms->output[s] != -1) {
+            *state = s;
+            *match = ms->output[s];
+            return p - start;
+        }
+    }
+
+    *state = s;
+    *match = -1;
+    return size;
+}
+
+#ifdef TCPKALI_MULTISCAN_UNIT_TEST
+
+#include <stdio.h>
+
+/*
+ * Find all of the patterns in the data fed in (chunk) sized pieces,
+ * returning the indexes of the patterns in the order found.
+ */
+static size_t
+find_all(const struct tk_multiscan *ms, const char *data, size_t chunk,
+         int *found, size_t found_max, size_t *ends) {
+    uint32_t state = 0;
+    size_t n = 0;
+    size_t size = strlen(data);
+    for(size_t off = 0; off < size; off += chunk) {
+        size_t piece = size - off < chunk ? size - off : chunk;
+        size_t analyzed = 0;
+        while(analyzed < piece) {
+            int match;
+            analyzed += tk_multiscan_feed(ms, &state, data + off + analyzed,
+                                          piece - analyzed, &match);
+            if(match == -1) break;
+            assert(n < found_max);
+            ends[n] = off + analyzed;
+            found[n++] = match;
+        }
+    }
+    return n;
+}
+
+int
+main() {
+    struct tk_multiscan *ms = tk_multiscan_new();
+    assert(tk_multiscan_add(ms, "he", 2) == 0);
+    assert(tk_multiscan_add(ms, "she", 3) == 1);
+    assert(tk_multiscan_add(ms, "his", 3) == 2);
+    assert(tk_multiscan_add(ms, "hers", 4) == 3);
+    tk_multiscan_compile(ms);
+    assert(tk_multiscan_count(ms) == 4);
+
+    /* The pieces split the patterns in all possible ways. */
+    for(size_t chunk = 1; chunk < 20; chunk++) {
+        int found[8];
+        size_t ends[8];
+        size_t n = find_all(ms, "ushers and his", chunk, found, 8, ends);
+        /* "she" ending at 4 also ends "he", the longer one is reported,
+         * then "hers" and "his". */
+        assert(n == 3);
+        assert(found[0] == 1 && ends[0] == 4);
+        assert(found[1] == 3 && ends[1] == 6);
+        assert(found[2] == 2 && ends[2] == 14);
+    }
+
+    int match;
+    uint32_t state = 0;
+    assert(tk_multiscan_feed(ms, &state, "xxxxxxxxxxxxxxxxxxxxxxxxxxxxx", 29,
+                             &match)
+           == 29);
+    assert(match == -1 && state == 0);
+    size_t size;
+    assert(memcmp(tk_multiscan_pattern(ms, 3, &size), "hers", 4) == 0);
+    assert(size == 4);
+    tk_multiscan_free(ms);
+
+    /* More starting bytes than the vectorized filter takes. */
+    ms = tk_multiscan_new();
+    const char *words[] = {"alpha", "beta", "gamma", "delta", "epsilon"};
+    for(size_t i = 0; i < 5; i++)
+        tk_multiscan_add(ms, words[i], strlen(words[i]));
+    tk_multiscan_compile(ms);
+    for(size_t chunk = 1; chunk < 40; chunk++) {
+        int found[8];
+        size_t ends[8];
+        size_t n = find_all(
+            ms, "................................gamma......delt.delta",
+            chunk, found, 8, ends);
+        assert(n == 2);
+        assert(found[0] == 2 && ends[0] == 37);
+        assert(found[1] == 3 && ends[1] == 53);
+    }
+    tk_multiscan_free(ms);
+
+    /* A single pattern goes through memchr(). */
+    ms = tk_multiscan_new();
+    tk_multiscan_add(ms, "\r\n\r\n", 4);
+    tk_multiscan_compile(ms);
+    state = 0;
+    assert(tk_multiscan_feed(ms, &state, "GET / HTTP/1.1\r\n\r", 17, &match)
+           == 17);
+    assert(match == -1 && state != 0);
+    assert(tk_multiscan_feed(ms, &state, "\nrest", 5, &match) == 1);
+    assert(match == 0);
+    tk_multiscan_free(ms);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_MULTISCAN_UNIT_TEST */
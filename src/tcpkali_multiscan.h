@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_MULTISCAN_H
+#define TCPKALI_MULTISCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Streaming multi-pattern search (Aho-Corasick).
+ *
+ * All of the patterns are found in a single pass over the data, a pattern
+ * split across several fed buffers included. The automaton is immutable
+ * once compiled and is shared by the connections; the state of a stream
+ * is a single uint32_t, starting at 0.
+ *
+ * Away from the partial matches, the data is skipped to the next byte
+ * which could start a pattern, with a vectorized filter if there are
+ * only a few such bytes.
+ */
+struct tk_multiscan;
+
+struct tk_multiscan *tk_multiscan_new(void);
+void tk_multiscan_free(struct tk_multiscan *);
+
+/*
+ * Add a non-empty pattern before tk_multiscan_compile().
+ * The pattern is copied. Returns the index of the pattern.
+ */
+size_t tk_multiscan_add(struct tk_multiscan *, const void *pattern,
+                        size_t size);
+void tk_multiscan_compile(struct tk_multiscan *);
+
+size_t tk_multiscan_count(const struct tk_multiscan *);
+const void *tk_multiscan_pattern(const struct tk_multiscan *, size_t index,
+                                 size_t *size);
+
+/*
+ * Feed the next (size) bytes of the stream in the (*state).
+ * Returns the number of bytes analyzed, up to and including the end
+ * of the first pattern found, and sets (*match) to its index.
+ * If there is no pattern ending in the data, returns (size) and
+ * sets (*match) to -1. Feeding the rest of the data finds the next
+ * pattern, overlapping ones included.
+ */
+size_t tk_multiscan_feed(const struct tk_multiscan *, uint32_t *state,
+                         const void *data, size_t size, int *match);
+
+#endif /* TCPKALI_MULTISCAN_H */
@@ -27,15 +27,80 @@
 #ifndef TCPKALI_PACEFIER_H
 #define TCPKALI_PACEFIER_H
 
+/*
+ * A token bucket: the events are allowed at the events_per_second pace,
+ * and the pace which could not be kept up with is caught up according
+ * to the pacefier_catchup policy, up to the burst_events at once.
+ */
+enum pacefier_catchup {
+    PACE_CATCHUP_DROP,   /* Forget the events beyond the burst */
+    PACE_CATCHUP_SMOOTH, /* Catch up at up to twice the pace */
+    PACE_CATCHUP_FULL,   /* Catch up on everything, as fast as it goes */
+};
+
 struct pacefier {
     double previous_ts;
     double events_per_second;
+    double burst_events; /* The bucket size, 0.0 for 2 seconds worth */
+    enum pacefier_catchup catchup;
+    double peak_ts; /* PACE_CATCHUP_SMOOTH: previous_ts at twice the pace */
 };
 
 static inline void
 pacefier_init(struct pacefier *p, double events_per_second, double now) {
     p->previous_ts = now;
     p->events_per_second = events_per_second;
+    p->burst_events = 0.0;
+    p->catchup = PACE_CATCHUP_DROP;
+    p->peak_ts = now;
+}
+
+/*
+ * Set the bucket size and the catch-up policy, see --burst and --catch-up.
+ */
+static inline void
+pacefier_set_burst(struct pacefier *p, double burst_events,
+                   enum pacefier_catchup catchup) {
+    p->burst_events = burst_events;
+    p->catchup = catchup;
+}
+
+/*
+ * The bucket size, in seconds of the pace. Unless set, we don't allow
+ * more than 2 (or 2/Rate) seconds skew to prevent too sudden bursts
+ * of events and to avoid overfilling the integers.
+ */
+static inline double
+pacefier_burst_seconds(const struct pacefier *p) {
+    if(p->burst_events > 0.0)
+        return p->burst_events / p->events_per_second;
+    else if(p->events_per_second > 1.0)
+        return 2.0;
+    else
+        return 2.0 / p->events_per_second;
+}
+
+/*
+ * The events which could be moved now, up to the bucket size.
+ * The PACE_CATCHUP_SMOOTH catching up is limited to twice the pace.
+ */
+static inline double
+pacefier_available(const struct pacefier *p, double now) {
+    double burst_seconds = pacefier_burst_seconds(p);
+    double elapsed = now - p->previous_ts;
+    switch(p->catchup) {
+    case PACE_CATCHUP_DROP:
+        if(elapsed > burst_seconds) elapsed = burst_seconds;
+        break;
+    case PACE_CATCHUP_SMOOTH: {
+        double peak_elapsed = 2 * (now - p->peak_ts);
+        if(peak_elapsed > burst_seconds) peak_elapsed = burst_seconds;
+        if(elapsed > peak_elapsed) elapsed = peak_elapsed;
+    } break;
+    case PACE_CATCHUP_FULL:
+        break;
+    }
+    return elapsed * p->events_per_second;
 }
 
 /*
@@ -44,8 +109,7 @@ pacefier_init(struct pacefier *p, double events_per_second, double now) {
  */
 static inline size_t
 pacefier_allow(struct pacefier *p, double now) {
-    double elapsed = now - p->previous_ts;
-    ssize_t move_events = elapsed * p->events_per_second; /* Implicit rounding */
+    ssize_t move_events = pacefier_available(p, now); /* Implicit rounding */
     if(move_events > 0)
         return move_events;
     else
@@ -58,13 +122,17 @@ pacefier_allow(struct pacefier *p, double now) {
 static inline double
 pacefier_when_allowed(struct pacefier *p, double now,
                       size_t need_events) {
-    double elapsed = now - p->previous_ts;
-    double move_events = elapsed * p->events_per_second;
-    if(move_events >= need_events) {
-        return 0.0;
-    } else {
-        return (need_events - move_events) / p->events_per_second;
+    double move_events = (now - p->previous_ts) * p->events_per_second;
+    double delay = 0.0;
+    if(move_events < need_events)
+        delay = (need_events - move_events) / p->events_per_second;
+    if(p->catchup == PACE_CATCHUP_SMOOTH) {
+        double peak_events = (now - p->peak_ts) * 2 * p->events_per_second;
+        double peak_delay =
+            (need_events - peak_events) / (2 * p->events_per_second);
+        if(peak_delay > delay) delay = peak_delay;
     }
+    return delay;
 }
 
 /*
@@ -80,19 +148,24 @@ pacefier_moved(struct pacefier *p, size_t moved, double now) {
     /*
      * If the process cannot keep up with the pace, it will result in
      * previous_ts shifting in the past more and more with time.
-     * We don't allow more than 2/Rate seconds skew to prevent too sudden
-     * bursts of events and to avoid overfilling the integers.
      */
-    double wiggle_seconds;
-    if(p->events_per_second > 1.0) {
-        wiggle_seconds = 2.0;
-    } else {
-        wiggle_seconds = 2.0 / p->events_per_second;
-    }
-    if((now - p->previous_ts) > wiggle_seconds) {
-        p->previous_ts = now - wiggle_seconds;
+    double burst_seconds = pacefier_burst_seconds(p);
+    switch(p->catchup) {
+    case PACE_CATCHUP_DROP:
+        if((now - p->previous_ts) > burst_seconds) {
+            p->previous_ts = now - burst_seconds;
+        }
+        break;
+    case PACE_CATCHUP_SMOOTH:
+        /* The whole skew is kept, only the catch-up pace is limited. */
+        p->peak_ts += moved / (2 * p->events_per_second);
+        if(2 * (now - p->peak_ts) > burst_seconds) {
+            p->peak_ts = now - burst_seconds / 2;
+        }
+        break;
+    case PACE_CATCHUP_FULL:
+        break;
     }
 }
 
-
 #endif /* TCPKALI_PACEFIER_H */
@@ -0,0 +1,755 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <assert.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tcpkali_pcap.h"
+
+/* Link layer types, see pcap-linktype(7). */
+#define LINKTYPE_NULL 0
+#define LINKTYPE_ETHERNET 1
+#define DLT_RAW_BSD 12
+#define DLT_RAW_OPENBSD 14
+#define LINKTYPE_RAW 101
+#define LINKTYPE_LINUX_SLL 113
+#define LINKTYPE_IPV4 228
+#define LINKTYPE_IPV6 229
+#define LINKTYPE_LINUX_SLL2 276
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_RST 0x04
+#define TCP_ACK 0x10
+
+/*
+ * The reordered data held waiting for a gap to be filled. Once there is
+ * more of it, the gap is given up on as lost in the capture.
+ */
+#define PENDING_MAX_BYTES (4 * 1024 * 1024)
+
+/* The packets closer in time than this are sent together. */
+#define BURST_RESOLUTION 0.001
+
+/*
+ * The TCP connection endpoints, in the canonical order: the lower
+ * address/port first, whichever side the packet is coming from.
+ */
+struct flow_key {
+    uint8_t family;
+    uint8_t addr[2][16];
+    uint16_t port[2];
+};
+
+struct pending_segment {
+    struct pending_segment *next;
+    uint32_t seq;
+    size_t size;
+    uint8_t data[];
+};
+
+struct flow {
+    struct flow_key key;
+    int client_side; /* Index of the client in the (key) */
+    int seq_known;
+    int syn_seen;
+    int closed;
+    uint32_t isn;      /* Client initial sequence number */
+    uint32_t next_seq; /* Next client byte expected */
+    double first_ts;
+    uint8_t *buf;
+    size_t size;
+    size_t allocated;
+    struct pcap_burst *bursts;
+    size_t bursts_count;
+    size_t bursts_allocated;
+    struct pending_segment *pending; /* Sorted by (seq) */
+    size_t pending_bytes;
+};
+
+struct reassembly {
+    struct flow **flows;
+    size_t flows_count;
+    size_t flows_allocated;
+    size_t *slots; /* Index+1 of the current flow for the key */
+    size_t slots_count;
+    size_t packets;
+    size_t missing_bytes;
+};
+
+static uint32_t
+u32_at(const uint8_t *p, int swap) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return swap ? __builtin_bswap32(v) : v;
+}
+
+static uint16_t
+be16_at(const uint8_t *p) {
+    return (p[0] << 8) | p[1];
+}
+
+static uint32_t
+be32_at(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static int
+seq_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+static size_t
+flow_key_hash(const struct flow_key *key) {
+    const uint8_t *p = (const uint8_t *)key;
+    size_t h = 2166136261u; /* FNV-1a */
+    for(size_t i = 0; i < sizeof(*key); i++) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+static size_t *
+flow_slot(struct reassembly *r, const struct flow_key *key) {
+    size_t mask = r->slots_count - 1;
+    for(size_t i = flow_key_hash(key) & mask;; i = (i + 1) & mask) {
+        size_t *slot = &r->slots[i];
+        if(*slot == 0
+           || memcmp(&r->flows[*slot - 1]->key, key, sizeof(*key)) == 0)
+            return slot;
+    }
+}
+
+static struct flow *
+flow_new(struct reassembly *r, size_t *slot, const struct flow_key *key) {
+    if(r->flows_count == r->flows_allocated) {
+        r->flows_allocated = r->flows_allocated ? 2 * r->flows_allocated : 64;
+        r->flows = realloc(r->flows, r->flows_allocated * sizeof(r->flows[0]));
+        assert(r->flows);
+    }
+    struct flow *f = calloc(1, sizeof(*f));
+    assert(f);
+    f->key = *key;
+    r->flows[r->flows_count++] = f;
+
+    /* A reused tuple points to the latest of its flows. */
+    int fresh_slot = (*slot == 0);
+    *slot = r->flows_count;
+    if(fresh_slot && 2 * r->flows_count > r->slots_count) {
+        free(r->slots);
+        r->slots_count *= 2;
+        r->slots = calloc(r->slots_count, sizeof(r->slots[0]));
+        assert(r->slots);
+        for(size_t i = 0; i < r->flows_count; i++)
+            *flow_slot(r, &r->flows[i]->key) = i + 1;
+    }
+    return f;
+}
+
+static void
+flow_append(struct flow *f, const uint8_t *data, size_t size, double ts) {
+    if(size == 0) return;
+    if(f->size + size + 1 > f->allocated) {
+        f->allocated = 2 * (f->size + size + 1);
+        f->buf = realloc(f->buf, f->allocated);
+        assert(f->buf);
+    }
+    memcpy(f->buf + f->size, data, size);
+    f->size += size;
+    f->next_seq += size;
+
+    double at = ts - f->first_ts;
+    if(at < 0) at = 0;
+    if(f->bursts_count
+       && at - f->bursts[f->bursts_count - 1].at < BURST_RESOLUTION) {
+        f->bursts[f->bursts_count - 1].upto = f->size;
+        return;
+    }
+    if(f->bursts_count == f->bursts_allocated) {
+        f->bursts_allocated = f->bursts_allocated ? 2 * f->bursts_allocated : 8;
+        f->bursts =
+            realloc(f->bursts, f->bursts_allocated * sizeof(f->bursts[0]));
+        assert(f->bursts);
+    }
+    f->bursts[f->bursts_count].upto = f->size;
+    f->bursts[f->bursts_count].at = at;
+    f->bursts_count++;
+}
+
+/*
+ * Append the part of the segment which is not there yet.
+ * Returns 0 if the segment goes after a gap.
+ */
+static int
+flow_append_segment(struct flow *f, uint32_t seq, const uint8_t *data,
+                    size_t size, double ts) {
+    if(seq_before(f->next_seq, seq)) return 0;
+    size_t already = f->next_seq - seq;
+    if(already < size) flow_append(f, data + already, size - already, ts);
+    return 1;
+}
+
+/*
+ * Append the held segments which are no longer after a gap. With (force),
+ * the gaps are skipped over, counting the bytes lost.
+ */
+static void
+flow_drain_pending(struct reassembly *r, struct flow *f, double ts,
+                   int force) {
+    while(f->pending) {
+        struct pending_segment *ps = f->pending;
+        if(seq_before(f->next_seq, ps->seq)) {
+            if(!force) break;
+            r->missing_bytes += ps->seq - f->next_seq;
+            f->next_seq = ps->seq;
+        }
+        flow_append_segment(f, ps->seq, ps->data, ps->size, ts);
+        f->pending = ps->next;
+        f->pending_bytes -= ps->size;
+        free(ps);
+    }
+}
+
+static void
+flow_hold_segment(struct flow *f, uint32_t seq, const uint8_t *data,
+                  size_t size) {
+    struct pending_segment *ps = malloc(sizeof(*ps) + size);
+    assert(ps);
+    ps->seq = seq;
+    ps->size = size;
+    memcpy(ps->data, data, size);
+
+    struct pending_segment **p = &f->pending;
+    while(*p && !seq_before(seq, (*p)->seq)) p = &(*p)->next;
+    ps->next = *p;
+    *p = ps;
+    f->pending_bytes += size;
+}
+
+static void
+tcp_segment(struct reassembly *r, int family, const uint8_t *src,
+            const uint8_t *dst, const uint8_t *tcp, size_t tcp_size,
+            double ts) {
+    if(tcp_size < 20) return;
+    size_t hdr_size = (tcp[12] >> 4) * 4;
+    if(hdr_size < 20 || hdr_size > tcp_size) return;
+    uint16_t sport = be16_at(tcp);
+    uint16_t dport = be16_at(tcp + 2);
+    uint32_t seq = be32_at(tcp + 4);
+    uint8_t flags = tcp[13];
+    const uint8_t *payload = tcp + hdr_size;
+    size_t payload_size = tcp_size - hdr_size;
+    size_t addr_size = (family == 4) ? 4 : 16;
+
+    r->packets++;
+
+    struct flow_key key;
+    memset(&key, 0, sizeof(key));
+    key.family = family;
+    int cmp = memcmp(src, dst, addr_size);
+    int src_side = (cmp > 0 || (cmp == 0 && sport > dport));
+    memcpy(key.addr[src_side], src, addr_size);
+    memcpy(key.addr[!src_side], dst, addr_size);
+    key.port[src_side] = sport;
+    key.port[!src_side] = dport;
+
+    size_t *slot = flow_slot(r, &key);
+    struct flow *f = *slot ? r->flows[*slot - 1] : NULL;
+
+    /* A new connection reusing the tuple of a finished one. */
+    if(f && (flags & (TCP_SYN | TCP_ACK)) == TCP_SYN
+       && (f->closed || (f->syn_seen && seq != f->isn)))
+        f = NULL;
+
+    if(!f) {
+        f = flow_new(r, slot, &key);
+        f->first_ts = ts;
+        if((flags & TCP_SYN) && (flags & TCP_ACK)) {
+            f->client_side = !src_side; /* The server is answering */
+        } else {
+            f->client_side = src_side;
+        }
+    }
+
+    if(flags & TCP_RST) f->closed = 1;
+    if(src_side != f->client_side) return; /* Only the client data is kept */
+
+    if(flags & TCP_SYN) {
+        f->syn_seen = 1;
+        f->seq_known = 1;
+        f->isn = seq;
+        f->next_seq = seq + 1;
+        seq++;
+    } else if(!f->seq_known) {
+        /* The capture started in the middle of the connection. */
+        f->seq_known = 1;
+        f->next_seq = seq;
+    }
+    if(flags & TCP_FIN) f->closed = 1;
+
+    if(payload_size == 0) return;
+
+    if(!flow_append_segment(f, seq, payload, payload_size, ts)) {
+        flow_hold_segment(f, seq, payload, payload_size);
+        while(f->pending_bytes > PENDING_MAX_BYTES)
+            flow_drain_pending(r, f, ts, 1);
+        return;
+    }
+
+    flow_drain_pending(r, f, ts, 0);
+}
+
+static void
+ipv6_packet(struct reassembly *r, const uint8_t *ip, size_t size, double ts) {
+    if(size < 40) return;
+    size_t payload_size = be16_at(ip + 4);
+    uint8_t next = ip[6];
+    const uint8_t *p = ip + 40;
+    size_t left = size - 40;
+    if(payload_size < left) left = payload_size;
+
+    /* Skip the extension headers. Fragments are not reassembled. */
+    while(next == 0 || next == 43 || next == 60) {
+        if(left < 8) return;
+        size_t ext_size = 8 + p[1] * 8;
+        if(ext_size > left) return;
+        next = p[0];
+        p += ext_size;
+        left -= ext_size;
+    }
+    if(next != 6) return;
+
+    tcp_segment(r, 6, ip + 8, ip + 24, p, left, ts);
+}
+
+static void
+ipv4_packet(struct reassembly *r, const uint8_t *ip, size_t size, double ts) {
+    if(size < 20) return;
+    size_t hdr_size = (ip[0] & 0x0f) * 4;
+    size_t total_size = be16_at(ip + 2);
+    if(hdr_size < 20 || hdr_size > size) return;
+    if(ip[9] != 6) return;
+    /* Fragments are not reassembled. */
+    if(be16_at(ip + 6) & 0x3fff) return;
+    if(total_size < hdr_size) return;
+    if(total_size > size) total_size = size; /* Truncated by snaplen */
+
+    tcp_segment(r, 4, ip + 12, ip + 16, ip + hdr_size, total_size - hdr_size,
+                ts);
+}
+
+static void
+ip_packet(struct reassembly *r, const uint8_t *ip, size_t size, double ts) {
+    if(size < 1) return;
+    switch(ip[0] >> 4) {
+    case 4:
+        ipv4_packet(r, ip, size, ts);
+        break;
+    case 6:
+        ipv6_packet(r, ip, size, ts);
+        break;
+    }
+}
+
+static void
+ethertype_packet(struct reassembly *r, uint16_t ethertype, const uint8_t *p,
+                 size_t size, double ts) {
+    switch(ethertype) {
+    case 0x0800:
+    case 0x86dd:
+        ip_packet(r, p, size, ts);
+        break;
+    }
+}
+
+static void
+link_packet(struct reassembly *r, uint32_t linktype, const uint8_t *p,
+            size_t size, double ts) {
+    switch(linktype) {
+    case LINKTYPE_NULL:
+        /* The address family, in the byte order of the capturing host. */
+        if(size < 4) return;
+        ip_packet(r, p + 4, size - 4, ts);
+        break;
+    case LINKTYPE_ETHERNET: {
+        if(size < 14) return;
+        uint16_t ethertype = be16_at(p + 12);
+        p += 14;
+        size -= 14;
+        /* 802.1Q and 802.1ad VLAN tags. */
+        while(ethertype == 0x8100 || ethertype == 0x88a8
+              || ethertype == 0x9100) {
+            if(size < 4) return;
+            ethertype = be16_at(p + 2);
+            p += 4;
+            size -= 4;
+        }
+        ethertype_packet(r, ethertype, p, size, ts);
+    } break;
+    case DLT_RAW_BSD:
+    case DLT_RAW_OPENBSD:
+    case LINKTYPE_RAW:
+    case LINKTYPE_IPV4:
+    case LINKTYPE_IPV6:
+        ip_packet(r, p, size, ts);
+        break;
+    case LINKTYPE_LINUX_SLL:
+        if(size < 16) return;
+        ethertype_packet(r, be16_at(p + 14), p + 16, size - 16, ts);
+        break;
+    case LINKTYPE_LINUX_SLL2:
+        if(size < 20) return;
+        ethertype_packet(r, be16_at(p), p + 20, size - 20, ts);
+        break;
+    }
+}
+
+static int
+linktype_supported(uint32_t linktype) {
+    switch(linktype) {
+    case LINKTYPE_NULL:
+    case LINKTYPE_ETHERNET:
+    case DLT_RAW_BSD:
+    case DLT_RAW_OPENBSD:
+    case LINKTYPE_RAW:
+    case LINKTYPE_LINUX_SLL:
+    case LINKTYPE_IPV4:
+    case LINKTYPE_IPV6:
+    case LINKTYPE_LINUX_SLL2:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Hand the reassembled flows over to the streams. The flows without
+ * any client data are dropped.
+ */
+static struct pcap_replay *
+streams_from_flows(struct reassembly *r) {
+    struct pcap_replay *replay = calloc(1, sizeof(*replay));
+    assert(replay);
+    replay->streams = calloc(r->flows_count ? r->flows_count : 1,
+                             sizeof(replay->streams[0]));
+    assert(replay->streams);
+    replay->packets = r->packets;
+
+    for(size_t i = 0; i < r->flows_count; i++) {
+        struct flow *f = r->flows[i];
+        flow_drain_pending(r, f, f->first_ts, 1);
+        if(f->size == 0) {
+            free(f->bursts);
+            free(f);
+            continue;
+        }
+        struct pcap_stream *s = &replay->streams[replay->streams_count++];
+        s->data.ptr = realloc(f->buf, f->size + 1);
+        assert(s->data.ptr);
+        ((char *)s->data.ptr)[f->size] = '\0';
+        s->data.once_size = f->size;
+        s->data.total_size = f->size;
+        s->data.allocated_size = f->size;
+        s->data.flags = TDS_FLAG_PTR_SHARED;
+        s->bursts = f->bursts;
+        s->bursts_count = f->bursts_count;
+        replay->total_bytes += f->size;
+        free(f);
+    }
+    replay->missing_bytes = r->missing_bytes;
+
+    free(r->flows);
+    free(r->slots);
+    return replay;
+}
+
+struct pcap_replay *
+pcap_replay_parse(const void *capture, size_t size, const char **errmsg) {
+    const uint8_t *p = capture;
+    int swap;
+    double ts_unit;
+
+    if(size < 24) {
+        *errmsg = "Not a PCAP file";
+        return NULL;
+    }
+    switch(u32_at(p, 0)) {
+    case 0xa1b2c3d4:
+        swap = 0;
+        ts_unit = 1e-6;
+        break;
+    case 0xd4c3b2a1:
+        swap = 1;
+        ts_unit = 1e-6;
+        break;
+    case 0xa1b23c4d:
+        swap = 0;
+        ts_unit = 1e-9;
+        break;
+    case 0x4d3cb2a1:
+        swap = 1;
+        ts_unit = 1e-9;
+        break;
+    case 0x0a0d0d0a:
+        *errmsg =
+            "PCAPNG is not supported, convert with \"editcap -F pcap\"";
+        return NULL;
+    default:
+        *errmsg = "Not a PCAP file";
+        return NULL;
+    }
+    uint32_t linktype = u32_at(p + 20, swap) & 0x0fffffff;
+    if(!linktype_supported(linktype)) {
+        *errmsg = "Unsupported link layer type";
+        return NULL;
+    }
+
+    struct reassembly r;
+    memset(&r, 0, sizeof(r));
+    r.slots_count = 128;
+    r.slots = calloc(r.slots_count, sizeof(r.slots[0]));
+    assert(r.slots);
+
+    /* A capture cut short is replayed up to its last complete record. */
+    for(size_t off = 24; off + 16 <= size;) {
+        const uint8_t *rec = p + off;
+        double ts = u32_at(rec, swap) + u32_at(rec + 4, swap) * ts_unit;
+        size_t incl_len = u32_at(rec + 8, swap);
+        if(incl_len > size - off - 16) break;
+        link_packet(&r, linktype, rec + 16, incl_len, ts);
+        off += 16 + incl_len;
+    }
+
+    return streams_from_flows(&r);
+}
+
+struct pcap_replay *
+pcap_replay_load(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if(fd == -1) {
+        fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if(fstat(fd, &st) == -1) {
+        fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    const char *errmsg = "Not a PCAP file";
+    struct pcap_replay *replay = NULL;
+    if(st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map == MAP_FAILED) {
+            fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+            close(fd);
+            return NULL;
+        }
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        replay = pcap_replay_parse(map, st.st_size, &errmsg);
+        munmap(map, st.st_size);
+    }
+    close(fd);
+
+    if(!replay) fprintf(stderr, "%s: %s\n", filename, errmsg);
+    return replay;
+}
+
+void
+pcap_replay_free(struct pcap_replay *replay) {
+    if(!replay) return;
+    for(size_t i = 0; i < replay->streams_count; i++) {
+        free(replay->streams[i].data.ptr);
+        free(replay->streams[i].bursts);
+    }
+    free(replay->streams);
+    free(replay);
+}
+
+size_t
+pcap_stream_due(const struct pcap_stream *s, size_t *burst, double elapsed,
+                double *next_at) {
+    size_t b = *burst;
+    while(b < s->bursts_count && s->bursts[b].at <= elapsed) b++;
+    *burst = b;
+    *next_at = (b < s->bursts_count) ? s->bursts[b].at : -1.0;
+    return b ? s->bursts[b - 1].upto : 0;
+}
+
+#ifdef TCPKALI_PCAP_UNIT_TEST
+
+/*
+ * Build a capture of Ethernet frames with IPv4 or IPv6 TCP segments.
+ */
+struct capture {
+    uint8_t buf[8192];
+    size_t size;
+};
+
+static void
+capture_start(struct capture *c) {
+    static const uint8_t hdr[24] = {0xd4, 0xc3, 0xb2, 0xa1, 2, 0, 4, 0,
+                                    0,    0,    0,    0,    0, 0, 0, 0,
+                                    0xff, 0xff, 0,    0,    1, 0, 0, 0};
+    memcpy(c->buf, hdr, sizeof(hdr));
+    c->size = sizeof(hdr);
+}
+
+static void
+put32le(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static void
+capture_segment(struct capture *c, int family, int from_client,
+                uint32_t usec, uint8_t flags, uint32_t seq,
+                const char *payload) {
+    size_t payload_size = strlen(payload);
+    size_t ip_size = (family == 4 ? 20 : 40) + 20 + payload_size;
+    uint8_t *rec = c->buf + c->size;
+    memset(rec, 0, 16 + 14 + ip_size);
+    put32le(rec, 1000);
+    put32le(rec + 4, usec);
+    put32le(rec + 8, 14 + ip_size);
+    put32le(rec + 12, 14 + ip_size);
+    uint8_t *eth = rec + 16;
+    eth[12] = family == 4 ? 0x08 : 0x86;
+    eth[13] = family == 4 ? 0x00 : 0xdd;
+    uint8_t *ip = eth + 14;
+    uint8_t *src, *dst;
+    if(family == 4) {
+        ip[0] = 0x45;
+        ip[2] = ip_size >> 8;
+        ip[3] = ip_size;
+        ip[9] = 6;
+        src = ip + 12;
+        dst = ip + 16;
+        src[0] = dst[0] = 10;
+        src[3] = from_client ? 2 : 1;
+        dst[3] = from_client ? 1 : 2;
+    } else {
+        ip[0] = 0x60;
+        ip[4] = (ip_size - 40) >> 8;
+        ip[5] = ip_size - 40;
+        ip[6] = 6;
+        src = ip + 8;
+        dst = ip + 24;
+        src[15] = from_client ? 2 : 1;
+        dst[15] = from_client ? 1 : 2;
+    }
+    uint8_t *tcp = ip + (family == 4 ? 20 : 40);
+    uint16_t sport = from_client ? 40000 : 80;
+    uint16_t dport = from_client ? 80 : 40000;
+    tcp[0] = sport >> 8;
+    tcp[1] = sport;
+    tcp[2] = dport >> 8;
+    tcp[3] = dport;
+    tcp[4] = seq >> 24;
+    tcp[5] = seq >> 16;
+    tcp[6] = seq >> 8;
+    tcp[7] = seq;
+    tcp[12] = 5 << 4;
+    tcp[13] = flags;
+    memcpy(tcp + 20, payload, payload_size);
+    c->size += 16 + 14 + ip_size;
+}
+
+static void
+check_stream(const struct pcap_stream *s, const char *expected) {
+    assert(s->data.total_size == strlen(expected));
+    assert(s->data.once_size == s->data.total_size);
+    assert(memcmp(s->data.ptr, expected, s->data.total_size) == 0);
+}
+
+int
+main() {
+    struct capture c;
+    const char *errmsg = NULL;
+
+    assert(pcap_replay_parse("garbage", 7, &errmsg) == NULL && errmsg);
+
+    /*
+     * Handshake, then the data reordered, retransmitted and interleaved
+     * with the server replies.
+     */
+    capture_start(&c);
+    capture_segment(&c, 4, 1, 0, TCP_SYN, 0xfffffff0, "");
+    capture_segment(&c, 4, 0, 100, TCP_SYN | TCP_ACK, 500, "");
+    capture_segment(&c, 4, 1, 200, TCP_ACK, 0xfffffff1, "");
+    capture_segment(&c, 4, 1, 300, TCP_ACK, 0xfffffff1, "GET / ");
+    capture_segment(&c, 4, 1, 400, TCP_ACK, 0xfffffffc, "1.1\r\n");
+    capture_segment(&c, 4, 1, 500, TCP_ACK, 0xfffffff7, "HTTP/");
+    capture_segment(&c, 4, 1, 600, TCP_ACK, 0xfffffff5, "/ HT");
+    capture_segment(&c, 4, 0, 700, TCP_ACK, 501, "HTTP/1.1 200 OK\r\n");
+    capture_segment(&c, 4, 1, 5000, TCP_ACK | TCP_FIN, 0x00000001, "\r\n");
+    /* Another connection over IPv6, captured after its handshake. */
+    capture_segment(&c, 6, 1, 6000, TCP_ACK, 7, "PING\r\n");
+    capture_segment(&c, 6, 0, 7000, TCP_ACK, 100, "+PONG\r\n");
+
+    struct pcap_replay *replay = pcap_replay_parse(c.buf, c.size, &errmsg);
+    assert(replay);
+    assert(replay->streams_count == 2);
+    assert(replay->missing_bytes == 0);
+    check_stream(&replay->streams[0], "GET / HTTP/1.1\r\n\r\n");
+    check_stream(&replay->streams[1], "PING\r\n");
+
+    /* The bursts at 0.3 and 0.5 ms are sent together, 5 ms apart. */
+    const struct pcap_stream *s = &replay->streams[0];
+    size_t burst = 0;
+    double next_at;
+    assert(pcap_stream_due(s, &burst, 0.0, &next_at) == 0);
+    assert(next_at > 0.0 && next_at < 0.001);
+    assert(pcap_stream_due(s, &burst, 0.002, &next_at) == 16);
+    assert(next_at > 0.004);
+    assert(pcap_stream_due(s, &burst, 0.006, &next_at) == 18);
+    assert(next_at < 0);
+    pcap_replay_free(replay);
+
+    /* The data lost in the capture is skipped over. */
+    capture_start(&c);
+    capture_segment(&c, 4, 1, 0, TCP_ACK, 1000, "abc");
+    capture_segment(&c, 4, 1, 100, TCP_ACK, 1010, "xyz");
+    replay = pcap_replay_parse(c.buf, c.size, &errmsg);
+    assert(replay);
+    assert(replay->streams_count == 1);
+    assert(replay->missing_bytes == 7);
+    check_stream(&replay->streams[0], "abcxyz");
+    pcap_replay_free(replay);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_PCAP_UNIT_TEST */
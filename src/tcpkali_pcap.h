@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_PCAP_H
+#define TCPKALI_PCAP_H
+
+#include <stddef.h>
+
+#include "tcpkali_transport.h"
+
+/*
+ * The client-to-server TCP streams recovered from a PCAP(3) capture,
+ * see --replay-pcap.
+ *
+ * The capture is read in a single pass. The payloads are reassembled
+ * by their sequence numbers: the retransmitted data is dropped, the
+ * reordered segments are held until the gap is filled. The data which
+ * never made it into the capture is skipped over and counted.
+ */
+
+/*
+ * The stream had (upto) bytes sent (at) seconds after its first packet.
+ */
+struct pcap_burst {
+    size_t upto;
+    double at;
+};
+
+struct pcap_stream {
+    /*
+     * The whole stream is sent once (once_size == total_size).
+     * The (ptr) is shared by all the connections replaying the stream.
+     */
+    struct transport_data_spec data;
+    struct pcap_burst *bursts;
+    size_t bursts_count;
+};
+
+struct pcap_replay {
+    struct pcap_stream *streams; /* In the order of their first packet */
+    size_t streams_count;
+    size_t packets;       /* TCP segments seen in the capture */
+    size_t total_bytes;   /* Client bytes in all streams */
+    size_t missing_bytes; /* Client bytes missing from the capture */
+};
+
+/*
+ * Map the capture file into memory and recover the streams from it.
+ * Returns NULL and complains on stderr if the file can't be read.
+ */
+struct pcap_replay *pcap_replay_load(const char *filename);
+
+/*
+ * Recover the streams from the capture in memory.
+ * Returns NULL and sets (*errmsg) if the capture can't be parsed.
+ */
+struct pcap_replay *pcap_replay_parse(const void *capture, size_t size,
+                                      const char **errmsg);
+
+void pcap_replay_free(struct pcap_replay *);
+
+/*
+ * The number of stream bytes due (elapsed) seconds into the replay, with
+ * the original timing. The (*burst) caches the position between the calls
+ * and starts at 0. The (*next_at) is set to the time more data is due,
+ * or to a negative value if the whole stream is due.
+ */
+size_t pcap_stream_due(const struct pcap_stream *, size_t *burst,
+                       double elapsed, double *next_at);
+
+#endif /* TCPKALI_PCAP_H */
@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "tcpkali_peers.h"
+
+struct peer_table {
+    unsigned ipv4_bits;
+    unsigned ipv6_bits;
+    struct peer_stats *entries; /* [0] is the "other" */
+    size_t n_entries;
+    size_t entries_size;
+    uint32_t *slots; /* Open addressing: entry indexes, 0 for the free slot */
+    size_t n_slots;  /* A power of two, kept at least twice the entries */
+};
+
+struct peer_table *
+peer_table_new(unsigned ipv4_bits, unsigned ipv6_bits) {
+    struct peer_table *t = calloc(1, sizeof(*t));
+    assert(t);
+    assert(ipv4_bits <= 32 && ipv6_bits <= 128);
+    t->ipv4_bits = ipv4_bits;
+    t->ipv6_bits = ipv6_bits;
+    t->entries_size = 16;
+    t->entries = calloc(t->entries_size, sizeof(t->entries[0]));
+    t->n_entries = 1;
+    t->n_slots = 32;
+    t->slots = calloc(t->n_slots, sizeof(t->slots[0]));
+    assert(t->entries && t->slots);
+    return t;
+}
+
+void
+peer_table_free(struct peer_table *t) {
+    if(t) {
+        free(t->entries);
+        free(t->slots);
+        free(t);
+    }
+}
+
+static void
+mask_prefix(uint8_t *prefix, size_t size, unsigned bits) {
+    for(size_t i = 0; i < size; i++) {
+        if(bits >= 8) {
+            bits -= 8;
+        } else {
+            prefix[i] &= (uint8_t)(0xff00 >> bits);
+            bits = 0;
+        }
+    }
+}
+
+/*
+ * Fill in the family and the prefix of the (key).
+ */
+static void
+peer_key(const struct peer_table *t, const struct sockaddr *sa,
+         struct peer_stats *key) {
+    memset(key, 0, sizeof(*key));
+    switch(sa->sa_family) {
+    case AF_INET: {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)sa;
+        key->family = AF_INET;
+        memcpy(key->prefix, &sin->sin_addr, 4);
+        key->prefix_bits = t->ipv4_bits;
+    } break;
+    case AF_INET6: {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)sa;
+        if(IN6_IS_ADDR_V4MAPPED(&sin6->sin6_addr)) {
+            key->family = AF_INET;
+            memcpy(key->prefix, &sin6->sin6_addr.s6_addr[12], 4);
+            key->prefix_bits = t->ipv4_bits;
+        } else {
+            key->family = AF_INET6;
+            memcpy(key->prefix, &sin6->sin6_addr, 16);
+            key->prefix_bits = t->ipv6_bits;
+        }
+    } break;
+    case AF_UNIX:
+        key->family = AF_UNIX;
+        return;
+    default:
+        return; /* The "other" */
+    }
+    mask_prefix(key->prefix, sizeof(key->prefix), key->prefix_bits);
+}
+
+static uint32_t
+peer_key_hash(const struct peer_stats *key) {
+    uint32_t h = 2166136261u ^ (uint32_t)key->family;
+    for(size_t i = 0; i < sizeof(key->prefix); i++) {
+        h ^= key->prefix[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int
+peer_key_equal(const struct peer_stats *a, const struct peer_stats *b) {
+    return a->family == b->family
+           && memcmp(a->prefix, b->prefix, sizeof(a->prefix)) == 0;
+}
+
+static void
+place_entry(struct peer_table *t, size_t index) {
+    size_t mask = t->n_slots - 1;
+    size_t s = peer_key_hash(&t->entries[index]) & mask;
+    while(t->slots[s]) s = (s + 1) & mask;
+    t->slots[s] = index;
+}
+
+static size_t
+find_key(struct peer_table *t, const struct peer_stats *key) {
+    if(key->family == 0) return 0;
+
+    size_t mask = t->n_slots - 1;
+    size_t s = peer_key_hash(key) & mask;
+    for(; t->slots[s]; s = (s + 1) & mask) {
+        if(peer_key_equal(&t->entries[t->slots[s]], key)) return t->slots[s];
+    }
+
+    if(t->n_entries > PEER_TABLE_MAX) return 0;
+
+    if(t->n_entries == t->entries_size) {
+        t->entries_size *= 2;
+        t->entries =
+            realloc(t->entries, t->entries_size * sizeof(t->entries[0]));
+        assert(t->entries);
+    }
+    size_t index = t->n_entries++;
+    memset(&t->entries[index], 0, sizeof(t->entries[index]));
+    t->entries[index].family = key->family;
+    memcpy(t->entries[index].prefix, key->prefix, sizeof(key->prefix));
+    t->entries[index].prefix_bits = key->prefix_bits;
+
+    if(2 * t->n_entries > t->n_slots) {
+        t->n_slots *= 2;
+        free(t->slots);
+        t->slots = calloc(t->n_slots, sizeof(t->slots[0]));
+        assert(t->slots);
+        for(size_t i = 1; i < t->n_entries; i++) place_entry(t, i);
+    } else {
+        t->slots[s] = index;
+    }
+
+    return index;
+}
+
+size_t
+peer_table_find(struct peer_table *t, const struct sockaddr *sa) {
+    struct peer_stats key;
+    peer_key(t, sa, &key);
+    return find_key(t, &key);
+}
+
+struct peer_stats *
+peer_table_entry(struct peer_table *t, size_t index) {
+    assert(index < t->n_entries);
+    return &t->entries[index];
+}
+
+static void
+peer_stats_add(struct peer_stats *dst, const struct peer_stats *src) {
+    add_traffic_numbers_NtoN(&src->traffic, &dst->traffic);
+    dst->latency_count += src->latency_count;
+    dst->latency_sum += src->latency_sum;
+    if(dst->latency_max < src->latency_max)
+        dst->latency_max = src->latency_max;
+}
+
+void
+peer_table_merge(struct peer_table *dst, const struct peer_table *src) {
+    for(size_t i = 0; i < src->n_entries; i++) {
+        size_t index = find_key(dst, &src->entries[i]);
+        peer_stats_add(&dst->entries[index], &src->entries[i]);
+    }
+}
+
+static int
+peer_stats_cmp(const void *ap, const void *bp) {
+    const struct peer_stats *a = ap;
+    const struct peer_stats *b = bp;
+    if(a->family != b->family) return a->family < b->family ? -1 : 1;
+    return memcmp(a->prefix, b->prefix, sizeof(a->prefix));
+}
+
+size_t
+peer_table_export(const struct peer_table *t, struct peer_stats **peers) {
+    const struct peer_stats *other = &t->entries[0];
+    int other_seen = other->traffic.conns_opened || other->traffic.bytes_rcvd
+                     || other->traffic.bytes_sent || other->latency_count;
+    size_t n = t->n_entries - 1;
+
+    *peers = malloc((n + 1) * sizeof(**peers));
+    assert(*peers);
+    memcpy(*peers, &t->entries[1], n * sizeof(**peers));
+    qsort(*peers, n, sizeof(**peers), peer_stats_cmp);
+    if(other_seen) (*peers)[n++] = *other;
+    return n;
+}
+
+const char *
+peer_stats_format(const struct peer_stats *peer, char *buf, size_t size) {
+    unsigned full_bits;
+
+    switch(peer->family) {
+    case AF_INET:
+        full_bits = 32;
+        break;
+    case AF_INET6:
+        full_bits = 128;
+        break;
+    case AF_UNIX:
+        snprintf(buf, size, "unix");
+        return buf;
+    default:
+        snprintf(buf, size, "other");
+        return buf;
+    }
+
+    char addr[INET6_ADDRSTRLEN];
+    if(!inet_ntop(peer->family, peer->prefix, addr, sizeof(addr)))
+        snprintf(addr, sizeof(addr), "?");
+    if(peer->prefix_bits < full_bits)
+        snprintf(buf, size, "%s/%u", addr, peer->prefix_bits);
+    else
+        snprintf(buf, size, "%s", addr);
+    return buf;
+}
+
+double
+peer_stats_fairness(const struct peer_stats *peers, size_t n) {
+    double sum = 0.0;
+    double sum_squares = 0.0;
+    size_t counted = 0;
+
+    for(size_t i = 0; i < n; i++) {
+        if(peers[i].family == 0) continue; /* Not a peer of its own */
+        double x = peers[i].traffic.bytes_rcvd + peers[i].traffic.bytes_sent;
+        sum += x;
+        sum_squares += x * x;
+        counted++;
+    }
+
+    if(sum_squares == 0.0) return 0.0;
+    return sum * sum / (counted * sum_squares);
+}
+
+#ifdef TCPKALI_PEERS_UNIT_TEST
+
+static struct sockaddr_in
+ipv4(const char *address) {
+    struct sockaddr_in sin = {.sin_family = AF_INET, .sin_port = htons(1)};
+    int rc = inet_pton(AF_INET, address, &sin.sin_addr);
+    assert(rc == 1);
+    return sin;
+}
+
+static struct sockaddr_in6
+ipv6(const char *address) {
+    struct sockaddr_in6 sin6 = {.sin6_family = AF_INET6};
+    int rc = inet_pton(AF_INET6, address, &sin6.sin6_addr);
+    assert(rc == 1);
+    return sin6;
+}
+
+int
+main() {
+    struct peer_table *t = peer_table_new(24, 64);
+    char buf[64];
+
+    struct sockaddr_in a1 = ipv4("10.0.0.1");
+    struct sockaddr_in a2 = ipv4("10.0.0.200");
+    struct sockaddr_in b = ipv4("10.0.1.1");
+    struct sockaddr_in6 mapped = ipv6("::ffff:10.0.0.7");
+    struct sockaddr_in6 c = ipv6("2001:db8::1");
+    struct sockaddr_un u = {.sun_family = AF_UNIX};
+
+    size_t ia = peer_table_find(t, (struct sockaddr *)&a1);
+    assert(ia != 0);
+    assert(peer_table_find(t, (struct sockaddr *)&a2) == ia);
+    assert(peer_table_find(t, (struct sockaddr *)&mapped) == ia);
+    size_t ib = peer_table_find(t, (struct sockaddr *)&b);
+    assert(ib != 0 && ib != ia);
+    size_t ic = peer_table_find(t, (struct sockaddr *)&c);
+    size_t iu = peer_table_find(t, (struct sockaddr *)&u);
+    assert(ic != ia && ic != ib && iu != ic);
+
+    assert(strcmp(peer_stats_format(peer_table_entry(t, ia), buf,
+                                    sizeof(buf)),
+                  "10.0.0.0/24")
+           == 0);
+    assert(strcmp(peer_stats_format(peer_table_entry(t, ic), buf,
+                                    sizeof(buf)),
+                  "2001:db8::/64")
+           == 0);
+    assert(strcmp(peer_stats_format(peer_table_entry(t, iu), buf,
+                                    sizeof(buf)),
+                  "unix")
+           == 0);
+
+    peer_table_entry(t, ia)->traffic.bytes_rcvd = 100;
+    peer_table_entry(t, ia)->latency_count = 1;
+    peer_table_entry(t, ia)->latency_sum = 0.5;
+    peer_table_entry(t, ia)->latency_max = 0.5;
+    peer_table_entry(t, ib)->traffic.bytes_rcvd = 100;
+
+    /* Overflow into the "other" peer, and grow the slots on the way. */
+    struct peer_table *u2 = peer_table_new(32, 128);
+    for(uint32_t i = 0; i < PEER_TABLE_MAX + 10; i++) {
+        struct sockaddr_in sin = {.sin_family = AF_INET};
+        sin.sin_addr.s_addr = htonl(0x0a000000 + i);
+        size_t index = peer_table_find(u2, (struct sockaddr *)&sin);
+        assert((index == 0) == (i >= PEER_TABLE_MAX));
+        assert(peer_table_find(u2, (struct sockaddr *)&sin) == index);
+        peer_table_entry(u2, index)->traffic.bytes_rcvd += 1;
+    }
+    struct peer_stats *peers;
+    size_t n = peer_table_export(u2, &peers);
+    assert(n == PEER_TABLE_MAX + 1);
+    assert(peers[n - 1].family == 0);
+    assert(peers[n - 1].traffic.bytes_rcvd == 10);
+    assert(strcmp(peer_stats_format(&peers[0], buf, sizeof(buf)), "10.0.0.0")
+           == 0);
+    assert(peer_stats_fairness(peers, n) == 1.0);
+    free(peers);
+    peer_table_free(u2);
+
+    /* Merge into a table with some of the same peers. */
+    struct peer_table *total = peer_table_new(24, 64);
+    size_t ta = peer_table_find(total, (struct sockaddr *)&a2);
+    peer_table_entry(total, ta)->traffic.bytes_rcvd = 200;
+    peer_table_entry(total, ta)->latency_count = 1;
+    peer_table_entry(total, ta)->latency_sum = 1.0;
+    peer_table_entry(total, ta)->latency_max = 1.0;
+    peer_table_merge(total, t);
+    n = peer_table_export(total, &peers);
+    assert(n == 4);
+    assert(strcmp(peer_stats_format(&peers[0], buf, sizeof(buf)), "unix")
+           == 0);
+    for(size_t i = 0; i < n; i++) {
+        if(peers[i].family != AF_INET || peers[i].prefix[2] != 0) continue;
+        assert(peers[i].traffic.bytes_rcvd == 300);
+        assert(peers[i].latency_count == 2);
+        assert(peers[i].latency_sum == 1.5);
+        assert(peers[i].latency_max == 1.0);
+    }
+    /* 300 and 100 bytes, and two peers with none. */
+    double fairness = peer_stats_fairness(peers, n);
+    assert(fairness > 0.3999 && fairness < 0.4001);
+    free(peers);
+
+    peer_table_free(total);
+    peer_table_free(t);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_PEERS_UNIT_TEST */
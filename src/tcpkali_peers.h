@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_PEERS_H
+#define TCPKALI_PEERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "tcpkali_traffic_stats.h"
+
+/*
+ * The accepted connections' traffic and latency by the peer, see
+ * --per-peer-stats.
+ *
+ * The peers are aggregated by their address prefix (a subnet), so that
+ * a fleet of client boxes shows up as a line per box or per rack. Each
+ * worker counts its own connections into its own table, without locks;
+ * the tables are merged at the end of the test. A table holds up to
+ * PEER_TABLE_MAX prefixes: the peers beyond them are counted together
+ * as the "other" peer, so a scan from many addresses costs bounded memory.
+ */
+
+#define PEER_TABLE_MAX 4096
+
+struct peer_stats {
+    int family;         /* AF_INET, AF_INET6, AF_UNIX, or 0 for "other" */
+    uint8_t prefix[16]; /* The masked address, in network byte order */
+    unsigned prefix_bits;
+    non_atomic_traffic_stats traffic;
+    /* The marker latencies, seconds. */
+    size_t latency_count;
+    double latency_sum;
+    double latency_max;
+};
+
+struct peer_table;
+
+/*
+ * The IPv4 addresses are aggregated by their first (ipv4_bits),
+ * the IPv6 ones by their (ipv6_bits). The IPv4-mapped IPv6 addresses
+ * count as the IPv4 ones.
+ */
+struct peer_table *peer_table_new(unsigned ipv4_bits, unsigned ipv6_bits);
+void peer_table_free(struct peer_table *);
+
+/*
+ * Find or add the peer, returning its index for peer_table_entry(),
+ * which stays the same for the life of the table.
+ */
+size_t peer_table_find(struct peer_table *, const struct sockaddr *);
+struct peer_stats *peer_table_entry(struct peer_table *, size_t index);
+
+/*
+ * Add the peers of the (src) table to the (dst) one.
+ */
+void peer_table_merge(struct peer_table *dst, const struct peer_table *src);
+
+/*
+ * A copy of the peers seen, ordered by the address, the "other" last.
+ * Returns the number of peers, the array is to be free()'d.
+ */
+size_t peer_table_export(const struct peer_table *, struct peer_stats **);
+
+/*
+ * Format the peer as "10.0.0.0/24", "10.0.0.1", "unix" or "other".
+ */
+const char *peer_stats_format(const struct peer_stats *, char *buf,
+                              size_t size);
+
+/*
+ * Jain's fairness index of the bytes exchanged with the peers,
+ * between 1/n (one peer took it all) and 1.0 (all peers equal).
+ * Returns 0.0 if there was no traffic.
+ */
+double peer_stats_fairness(const struct peer_stats *, size_t n);
+
+#endif /* TCPKALI_PEERS_H */
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_POOL_H
+#define TCPKALI_POOL_H
+
+#include <stdlib.h>
+#include <assert.h>
+
+/*
+ * A stack of released objects of the same kind, kept around for reuse
+ * instead of going back to the system allocator. The objects retain their
+ * contents (and whatever buffers they own) while in the pool, so the user
+ * decides how to reinitialize an object taken out of it.
+ * Not thread-safe: pools are kept per worker.
+ */
+struct tk_pool {
+    void **objects;
+    size_t count;
+    size_t size;
+};
+
+/*
+ * Take a previously released object, or NULL if the pool is empty.
+ */
+static inline void *
+tk_pool_take(struct tk_pool *pool) {
+    if(pool->count)
+        return pool->objects[--pool->count];
+    else
+        return NULL;
+}
+
+/*
+ * Release the object into the pool.
+ */
+static inline void
+tk_pool_give(struct tk_pool *pool, void *object) {
+    if(pool->count == pool->size) {
+        size_t new_size = pool->size ? 2 * pool->size : 64;
+        void **p = realloc(pool->objects, new_size * sizeof(pool->objects[0]));
+        assert(p);
+        pool->objects = p;
+        pool->size = new_size;
+    }
+    pool->objects[pool->count++] = object;
+}
+
+/*
+ * Destroy all pooled objects with the given function.
+ */
+static inline void
+tk_pool_drain(struct tk_pool *pool, void (*destroy)(void *)) {
+    while(pool->count) destroy(pool->objects[--pool->count]);
+    free(pool->objects);
+    pool->objects = NULL;
+    pool->size = 0;
+}
+
+#endif /* TCPKALI_POOL_H */
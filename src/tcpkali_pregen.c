@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <pthread.h>
+#include <assert.h>
+
+#include "tcpkali_pregen.h"
+
+struct payload_generator {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t job_queued; /* Signalled when jobs are added */
+    pthread_cond_t job_done;   /* Signalled when a busy job is finished */
+    TAILQ_HEAD(, payload_job) jobs;
+    pcg32_random_t rng;
+    int terminate;
+};
+
+static void *
+payload_generator_thread(void *arg) {
+    struct payload_generator *g = arg;
+
+    pthread_mutex_lock(&g->lock);
+    for(;;) {
+        struct payload_job *job = TAILQ_FIRST(&g->jobs);
+        if(!job) {
+            if(g->terminate) break;
+            pthread_cond_wait(&g->job_queued, &g->lock);
+            continue;
+        }
+        TAILQ_REMOVE(&g->jobs, job, hook);
+        job->state = PJ_BUSY;
+        pthread_mutex_unlock(&g->lock);
+
+        struct transport_data_spec *spec;
+        spec = transport_spec_from_message_collection(
+            &job->spec, job->mc, job->expr_cb, &job->expr_cb_key, job->tws_side,
+            TS_CONVERSION_OVERRIDE_MESSAGES, &g->rng);
+        assert(spec == &job->spec);
+
+        pthread_mutex_lock(&g->lock);
+        job->state = PJ_READY;
+        pthread_cond_broadcast(&g->job_done);
+    }
+    pthread_mutex_unlock(&g->lock);
+
+    return NULL;
+}
+
+struct payload_generator *
+payload_generator_new(uint64_t seed, uint64_t seq) {
+    struct payload_generator *g = calloc(1, sizeof(*g));
+    assert(g);
+    pthread_mutex_init(&g->lock, NULL);
+    pthread_cond_init(&g->job_queued, NULL);
+    pthread_cond_init(&g->job_done, NULL);
+    TAILQ_INIT(&g->jobs);
+    pcg32_srandom_r(&g->rng, seed, seq);
+    int rc = pthread_create(&g->thread, NULL, payload_generator_thread, g);
+    assert(rc == 0);
+    return g;
+}
+
+void
+payload_generator_free(struct payload_generator *g) {
+    pthread_mutex_lock(&g->lock);
+    assert(TAILQ_FIRST(&g->jobs) == NULL);
+    g->terminate = 1;
+    pthread_cond_signal(&g->job_queued);
+    pthread_mutex_unlock(&g->lock);
+    pthread_join(g->thread, NULL);
+    pthread_cond_destroy(&g->job_done);
+    pthread_cond_destroy(&g->job_queued);
+    pthread_mutex_destroy(&g->lock);
+    free(g);
+}
+
+void
+payload_job_submit(struct payload_generator *g, struct payload_job *job) {
+    pthread_mutex_lock(&g->lock);
+    assert(job->state == PJ_IDLE);
+    job->state = PJ_QUEUED;
+    TAILQ_INSERT_TAIL(&g->jobs, job, hook);
+    pthread_cond_signal(&g->job_queued);
+    pthread_mutex_unlock(&g->lock);
+}
+
+int
+payload_job_collect(struct payload_generator *g, struct payload_job *job) {
+    int ready = 0;
+
+    pthread_mutex_lock(&g->lock);
+    switch(job->state) {
+    case PJ_IDLE:
+        break;
+    case PJ_QUEUED:
+        /* Not started yet, take it back. */
+        TAILQ_REMOVE(&g->jobs, job, hook);
+        break;
+    case PJ_BUSY:
+        while(job->state == PJ_BUSY) pthread_cond_wait(&g->job_done, &g->lock);
+        assert(job->state == PJ_READY);
+        /* Fall through */
+    case PJ_READY:
+        ready = 1;
+        break;
+    }
+    job->state = PJ_IDLE;
+    pthread_mutex_unlock(&g->lock);
+
+    return ready;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_PREGEN_H
+#define TCPKALI_PREGEN_H
+
+#include <sys/queue.h>
+#include <pcg_basic.h>
+
+#include "tcpkali_atomic.h"
+#include "tcpkali_transport.h"
+
+/*
+ * Background generation of payloads for messages with per-message
+ * expressions, such as \{re ...}.
+ *
+ * Each connection sending such messages owns a spare transport data buffer
+ * (a job). While the connection is sending from its current buffer,
+ * the generator thread refills the spare one. When the current buffer is
+ * exhausted, the connection swaps the two and resubmits the old one.
+ */
+
+struct payload_generator;
+
+/*
+ * The connection's values the expressions refer to, copied into the job
+ * when it is created. The generator thread never reads the connection,
+ * which keeps changing (and may be closed) while the job is being filled.
+ */
+struct payload_job_key {
+    const void *conn;        /* \{connection.ptr}, never dereferenced */
+    non_atomic_narrow_t uid; /* \{connection.uid} */
+    uint32_t expr_seed;      /* \{connection.regex} */
+    int marker_binary;       /* \{message.marker} format */
+};
+
+struct payload_job {
+    TAILQ_ENTRY(payload_job) hook;
+    struct transport_data_spec spec; /* The spare buffer */
+    struct message_collection *mc;
+    expr_callback_f *expr_cb;
+    struct payload_job_key expr_cb_key; /* Passed to (expr_cb) */
+    enum transport_websocket_side tws_side;
+    enum {
+        PJ_IDLE,   /* Owned by the connection */
+        PJ_QUEUED, /* Waiting for the generator */
+        PJ_BUSY,   /* Being filled by the generator */
+        PJ_READY,  /* Filled, waiting to be collected */
+    } state;
+};
+
+/*
+ * Start a generator thread. The random number generator seed
+ * makes the thread's output independent of the other generators.
+ */
+struct payload_generator *payload_generator_new(uint64_t seed, uint64_t seq);
+
+/*
+ * Stop the generator thread. All jobs must have been cancelled.
+ */
+void payload_generator_free(struct payload_generator *);
+
+/*
+ * Queue the job for refilling its spare buffer. The job must be idle.
+ */
+void payload_job_submit(struct payload_generator *, struct payload_job *);
+
+/*
+ * Take the job back from the generator, waiting if it is being filled.
+ * Returns 1 if the spare buffer has been refilled, 0 otherwise.
+ */
+int payload_job_collect(struct payload_generator *, struct payload_job *);
+
+#endif /* TCPKALI_PREGEN_H */
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_PROBES_H
+#define TCPKALI_PROBES_H
+
+#include "config.h"
+
+/*
+ * The USDT (SystemTap/bpftrace) static probes of the "tcpkali" provider.
+ * With <sys/sdt.h> each probe is a single nop in the code and a note
+ * in the ELF file; without it the probes are compiled out. Listed by
+ *   bpftrace -l 'usdt:./tcpkali:*'
+ * The probe arguments are integers only.
+ */
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define TK_PROBE1(name, a) DTRACE_PROBE1(tcpkali, name, a)
+#define TK_PROBE2(name, a, b) DTRACE_PROBE2(tcpkali, name, a, b)
+#define TK_PROBE3(name, a, b, c) DTRACE_PROBE3(tcpkali, name, a, b, c)
+#else
+#define TK_PROBE1(name, a) \
+    do {                   \
+    } while(0)
+#define TK_PROBE2(name, a, b) \
+    do {                      \
+    } while(0)
+#define TK_PROBE3(name, a, b, c) \
+    do {                         \
+    } while(0)
+#endif
+
+#endif /* TCPKALI_PROBES_H */
@@ -0,0 +1,385 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <sysexits.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <config.h>
+
+#ifdef HAVE_SCHED_H
+#include <sched.h>
+#endif
+
+#include <hdr_histogram.h>
+
+#include "tcpkali_procs.h"
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/*
+ * The engine histograms (1/10 ms up to 100 s, 3 significant figures)
+ * take about 90k, and about 230k at 1ns up to 100 s. The larger ones,
+ * with a wider --latency-max, are not merged.
+ */
+#define PROCS_HISTOGRAM_MAX (256 * 1024)
+/* Per-destination numbers are merged for this many destinations. */
+#define PROCS_REMOTES_MAX 256
+
+enum {
+    PH_CONNECT,
+    PH_FIRSTBYTE,
+    PH_HANDSHAKE,
+    PH_UPGRADE,
+    PH_MARKER,
+    PH_MARKER_UNCORRECTED,
+    PH_MAX
+};
+
+struct procs_slot {
+    volatile int reported;
+    double test_duration;
+    non_atomic_traffic_stats traffic;
+    size_t connecting;
+    size_t conns_in;
+    size_t conns_out;
+    size_t connections_counter;
+    size_t n_remotes;
+    struct engine_loop_stats loop;
+    struct engine_memory_stats memory;
+    struct engine_abort_summary abort;
+    struct engine_steady_summary steady;
+    struct {
+        size_t connection_attempts;
+        size_t connection_failures;
+        non_atomic_traffic_stats traffic;
+    } remotes[PROCS_REMOTES_MAX];
+    size_t histogram_size[PH_MAX]; /* 0 if not published */
+    int64_t histograms[PH_MAX][PROCS_HISTOGRAM_MAX / sizeof(int64_t)];
+};
+
+struct procs {
+    int n;
+    pid_t *pids;
+    struct procs_slot *slots; /* Shared with the children */
+    size_t slots_size;
+};
+
+/* For forwarding the termination signals to the children. */
+static struct procs *signalled_procs;
+
+static struct hdr_histogram **
+snapshot_histogram(struct latency_snapshot *latency, int kind) {
+    switch(kind) {
+    case PH_CONNECT:
+        return &latency->connect_histogram;
+    case PH_FIRSTBYTE:
+        return &latency->firstbyte_histogram;
+    case PH_HANDSHAKE:
+        return &latency->handshake_histogram;
+    case PH_UPGRADE:
+        return &latency->upgrade_histogram;
+    case PH_MARKER:
+        return &latency->marker_histogram;
+    case PH_MARKER_UNCORRECTED:
+        return &latency->marker_uncorrected_histogram;
+    }
+    assert(!"Unreachable");
+    return NULL;
+}
+
+/*
+ * Restrict the (index)th process to its own part of the CPUs we're
+ * allowed to run on. With more processes than CPUs, they share them.
+ */
+static void
+procs_pin(int n, int index) {
+#ifdef HAVE_SCHED_GETAFFINITY
+    cpu_set_t allowed, mine;
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+
+    int ncpus = CPU_COUNT(&allowed);
+    if(ncpus == 0) return;
+    int first, last;
+    if(ncpus >= n) {
+        first = (long)index * ncpus / n;
+        last = (long)(index + 1) * ncpus / n;
+    } else {
+        first = index % ncpus;
+        last = first + 1;
+    }
+
+    CPU_ZERO(&mine);
+    for(int cpu = 0, ordinal = 0; cpu < CPU_SETSIZE && ordinal < last; cpu++) {
+        if(!CPU_ISSET(cpu, &allowed)) continue;
+        if(ordinal >= first) CPU_SET(cpu, &mine);
+        ordinal++;
+    }
+    if(sched_setaffinity(0, sizeof(mine), &mine) != 0) {
+        fprintf(stderr, "--processes: can not pin process %d to CPUs: %s\n",
+                index, strerror(errno));
+    }
+#else
+    (void)n;
+    (void)index;
+#endif
+}
+
+struct procs *
+procs_fork(int n, int *index) {
+    struct procs *procs = calloc(1, sizeof(*procs));
+    assert(procs);
+    procs->n = n;
+    procs->pids = calloc(n, sizeof(procs->pids[0]));
+    assert(procs->pids);
+    procs->slots_size = n * sizeof(procs->slots[0]);
+    /* The untouched pages of the slots do not consume memory. */
+    procs->slots = mmap(NULL, procs->slots_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(procs->slots == MAP_FAILED) {
+        fprintf(stderr, "--processes: can not map the shared memory: %s\n",
+                strerror(errno));
+        exit(EX_OSERR);
+    }
+
+    /* Do not let the children repeat whatever is buffered so far. */
+    fflush(stdout);
+    fflush(stderr);
+
+    for(int i = 0; i < n; i++) {
+        pid_t pid = fork();
+        switch(pid) {
+        case -1:
+            fprintf(stderr, "--processes: can not fork: %s\n", strerror(errno));
+            for(int k = 0; k < i; k++) kill(procs->pids[k], SIGKILL);
+            exit(EX_OSERR);
+        case 0:
+            procs_pin(n, i);
+            *index = i;
+            return procs;
+        default:
+            procs->pids[i] = pid;
+        }
+    }
+
+    *index = -1;
+    return procs;
+}
+
+int
+procs_share(int total, int n, int index) {
+    return total / n + (index < total % n);
+}
+
+void
+procs_report(struct procs *procs, int index,
+             const struct engine_summary *summary) {
+    struct procs_slot *slot = &procs->slots[index];
+
+    slot->test_duration = summary->test_duration;
+    slot->traffic = summary->traffic;
+    slot->connecting = summary->connecting;
+    slot->conns_in = summary->conns_in;
+    slot->conns_out = summary->conns_out;
+    slot->connections_counter = summary->connections_counter;
+    slot->loop = summary->loop;
+    slot->memory = summary->memory;
+    slot->abort = summary->abort;
+    slot->steady = summary->steady;
+    slot->n_remotes = summary->n_remotes < PROCS_REMOTES_MAX
+                          ? summary->n_remotes
+                          : PROCS_REMOTES_MAX;
+    for(size_t i = 0; i < slot->n_remotes; i++) {
+        slot->remotes[i].connection_attempts =
+            summary->remotes[i].connection_attempts;
+        slot->remotes[i].connection_failures =
+            summary->remotes[i].connection_failures;
+        slot->remotes[i].traffic = summary->remotes[i].traffic;
+    }
+    for(int kind = 0; kind < PH_MAX; kind++) {
+        struct hdr_histogram *h =
+            summary->latency ? *snapshot_histogram(summary->latency, kind)
+                             : NULL;
+        size_t size = h ? hdr_get_memory_size(h) : 0;
+        if(size > sizeof(slot->histograms[kind])) {
+            fprintf(stderr, "--processes: latency histogram is too large\n");
+            size = 0;
+        }
+        memcpy(slot->histograms[kind], h, size);
+        slot->histogram_size[kind] = size;
+    }
+
+    __sync_synchronize();
+    slot->reported = 1;
+}
+
+static void
+forward_term_signal(int sig) {
+    (void)sig;
+    for(int i = 0; i < signalled_procs->n; i++) {
+        if(signalled_procs->pids[i]) kill(signalled_procs->pids[i], SIGINT);
+    }
+}
+
+/*
+ * The processes' rates add up, with their independent errors;
+ * the latency is the worst process' one. Steady only if all were.
+ */
+static void
+merge_steady_state(struct engine_steady_summary *total,
+                   const struct engine_steady_summary *proc, int first) {
+    if(first) {
+        *total = *proc;
+        return;
+    }
+    if(!total->windows || !proc->windows) {
+        total->windows = 0;
+        return;
+    }
+    if(total->windows > proc->windows) total->windows = proc->windows;
+    if(total->after < proc->after) total->after = proc->after;
+    for(int m = 0; m < ESM_METRICS; m++) {
+        struct engine_estimate *t = &total->values[m];
+        const struct engine_estimate *p = &proc->values[m];
+        if(isnan(p->mean)) continue;
+        if(isnan(t->mean)) {
+            *t = *p;
+        } else if(m == ESM_LATENCY) {
+            if(t->mean < p->mean) *t = *p;
+        } else {
+            t->mean += p->mean;
+            t->ci95 = sqrt(t->ci95 * t->ci95 + p->ci95 * p->ci95);
+        }
+    }
+}
+
+int
+procs_wait(struct procs *procs, struct engine_summary *summary) {
+    int exit_code = 0;
+
+    signalled_procs = procs;
+    struct sigaction act;
+    memset(&act, 0, sizeof(act));
+    act.sa_handler = forward_term_signal;
+    sigemptyset(&act.sa_mask);
+    sigaction(SIGINT, &act, NULL);
+    sigaction(SIGTERM, &act, NULL);
+
+    for(int left = procs->n; left > 0;) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if(pid == -1) {
+            if(errno == EINTR) continue;
+            break;
+        }
+        for(int i = 0; i < procs->n; i++) {
+            if(procs->pids[i] != pid) continue;
+            procs->pids[i] = 0;
+            left--;
+            int code = WIFEXITED(status) ? WEXITSTATUS(status) : EX_SOFTWARE;
+            if(code && !exit_code) exit_code = code;
+        }
+    }
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+
+    memset(summary, 0, sizeof(*summary));
+    summary->latency = calloc(1, sizeof(*summary->latency));
+    assert(summary->latency);
+    summary->n_remotes = procs->slots[0].n_remotes;
+    summary->remotes =
+        calloc(summary->n_remotes ? summary->n_remotes : 1,
+               sizeof(summary->remotes[0]));
+    assert(summary->remotes);
+
+    int merged = 0;
+    for(int i = 0; i < procs->n; i++) {
+        struct procs_slot *slot = &procs->slots[i];
+        if(!slot->reported) {
+            if(!exit_code) exit_code = EX_SOFTWARE;
+            continue;
+        }
+        /* The processes ramp up independently; count the longest one. */
+        if(summary->test_duration < slot->test_duration)
+            summary->test_duration = slot->test_duration;
+        add_traffic_numbers_NtoN(&slot->traffic, &summary->traffic);
+        summary->connecting += slot->connecting;
+        summary->conns_in += slot->conns_in;
+        summary->conns_out += slot->conns_out;
+        summary->connections_counter += slot->connections_counter;
+        /* The worst process tells whether the generator kept up. */
+        if(summary->loop.saturated_share < slot->loop.saturated_share)
+            summary->loop.saturated_share = slot->loop.saturated_share;
+        if(summary->loop.max_lag < slot->loop.max_lag)
+            summary->loop.max_lag = slot->loop.max_lag;
+        summary->memory.connections += slot->memory.connections;
+        for(int c = 0; c < EMC_COMPONENTS; c++)
+            summary->memory.bytes[c] += slot->memory.bytes[c];
+        /* The first process to abort tells why. */
+        if(!summary->abort.condition[0]) summary->abort = slot->abort;
+        merge_steady_state(&summary->steady, &slot->steady, !merged++);
+        for(size_t r = 0; r < summary->n_remotes && r < slot->n_remotes; r++) {
+            struct engine_remote_summary *rs = &summary->remotes[r];
+            rs->connection_attempts += slot->remotes[r].connection_attempts;
+            rs->connection_failures += slot->remotes[r].connection_failures;
+            add_traffic_numbers_NtoN(&slot->remotes[r].traffic, &rs->traffic);
+        }
+        for(int kind = 0; kind < PH_MAX; kind++) {
+            size_t size = slot->histogram_size[kind];
+            if(!size) continue;
+            struct hdr_histogram *src =
+                (struct hdr_histogram *)slot->histograms[kind];
+            struct hdr_histogram **dst =
+                snapshot_histogram(summary->latency, kind);
+            if(*dst) {
+                hdr_add(*dst, src);
+            } else {
+                *dst = malloc(size);
+                assert(*dst);
+                memcpy(*dst, src, size);
+            }
+        }
+    }
+
+    munmap(procs->slots, procs->slots_size);
+    free(procs->pids);
+    free(procs);
+    signalled_procs = NULL;
+
+    return exit_code;
+}
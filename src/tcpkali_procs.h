@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_PROCS_H
+#define TCPKALI_PROCS_H
+
+#include "tcpkali_engine.h"
+
+/*
+ * --processes: independent engines running in the forked processes,
+ * pinned to the disjoint sets of cores. The children publish their
+ * final numbers into a shared memory region, and the parent merges them.
+ */
+struct procs;
+
+/*
+ * Fork (n) processes. Returns in the parent with (*index) set to -1,
+ * and in every child with (*index) set to 0..n-1.
+ * Exits if the processes can not be created.
+ */
+struct procs *procs_fork(int n, int *index);
+
+/*
+ * The (index)th out of (n) shares of the (total), the remainder going
+ * to the first processes.
+ */
+int procs_share(int total, int n, int index);
+
+/*
+ * Called by the child to publish the final numbers of its engine.
+ */
+void procs_report(struct procs *, int index, const struct engine_summary *);
+
+/*
+ * Called by the parent to wait for all children and merge their reports
+ * into (summary), which is to be released with engine_free_summary().
+ * Returns the first non-zero exit code of the children, or 0.
+ */
+int procs_wait(struct procs *, struct engine_summary *summary);
+
+#endif /* TCPKALI_PROCS_H */
@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <assert.h>
+
+#include "tcpkali_profile.h"
+
+struct load_profile_segment {
+    enum { LPS_STEP, LPS_RAMP, LPS_SINE } shape;
+    double start; /* Seconds since the start of the test */
+    double duration;
+    double args[3];
+};
+
+struct load_profile {
+    struct {
+        struct load_profile_segment *segments;
+        size_t count;
+    } params[_LPP_MAX];
+};
+
+static const char *param_names[_LPP_MAX] = {
+        [LPP_CONNECTIONS] = "connections",
+        [LPP_CONNECT_RATE] = "connect-rate",
+        [LPP_MESSAGE_RATE] = "message-rate",
+};
+
+static const struct {
+    const char *name;
+    int nargs;
+} shapes[] = {[LPS_STEP] = {"step", 1},
+              [LPS_RAMP] = {"ramp", 2},
+              [LPS_SINE] = {"sine", 3}};
+
+int
+load_profile_number(const char *str, int is_time, double *value) {
+    char *end;
+    errno = 0;
+    double v = strtod(str, &end);
+    if(end == str || errno || !isfinite(v) || v < 0) return -1;
+
+    if(is_time) {
+        if(strcmp(end, "ms") == 0) v /= 1000;
+        else if(strcmp(end, "m") == 0) v *= 60;
+        else if(strcmp(end, "h") == 0) v *= 3600;
+        else if(*end && strcmp(end, "s") != 0) return -1;
+    } else {
+        if(strcmp(end, "k") == 0) v *= 1000;
+        else if(strcmp(end, "M") == 0) v *= 1000000;
+        else if(*end) return -1;
+    }
+
+    *value = v;
+    return 0;
+}
+
+static void
+add_segment(struct load_profile *lp, enum load_profile_param param,
+            struct load_profile_segment *seg) {
+    size_t count = lp->params[param].count;
+    struct load_profile_segment *segs = realloc(
+        lp->params[param].segments, (count + 1) * sizeof(segs[0]));
+    assert(segs);
+    seg->start = count ? segs[count - 1].start + segs[count - 1].duration : 0;
+    segs[count] = *seg;
+    lp->params[param].segments = segs;
+    lp->params[param].count = count + 1;
+}
+
+struct load_profile *
+load_profile_new(void) {
+    struct load_profile *lp = calloc(1, sizeof(*lp));
+    assert(lp);
+    return lp;
+}
+
+void
+load_profile_add_ramp(struct load_profile *lp, enum load_profile_param param,
+                      double duration, double from, double to) {
+    assert(param < _LPP_MAX && duration > 0);
+    struct load_profile_segment seg = {.shape = from == to ? LPS_STEP
+                                                           : LPS_RAMP,
+                                       .duration = duration,
+                                       .args = {from, to, 0}};
+    add_segment(lp, param, &seg);
+}
+
+static int
+parse_line(struct load_profile *lp, char *line, const char *name,
+           int lineno) {
+    char *tokens[7];
+    int ntokens = 0;
+    for(char *tok = strtok(line, " \t\r"); tok; tok = strtok(NULL, " \t\r")) {
+        if(*tok == '#') break;
+        if(ntokens == sizeof(tokens) / sizeof(tokens[0])) {
+            fprintf(stderr, "%s:%d: Too many values\n", name, lineno);
+            return -1;
+        }
+        tokens[ntokens++] = tok;
+    }
+    if(ntokens == 0) return 0;
+
+    int param;
+    for(param = 0; param < _LPP_MAX; param++) {
+        if(strcmp(tokens[0], param_names[param]) == 0) break;
+    }
+    if(param == _LPP_MAX) {
+        fprintf(stderr,
+                "%s:%d: Unknown parameter \"%s\", expecting one of "
+                "{connections|connect-rate|message-rate}\n",
+                name, lineno, tokens[0]);
+        return -1;
+    }
+
+    struct load_profile_segment seg;
+    memset(&seg, 0, sizeof(seg));
+    size_t shape;
+    for(shape = 0; shape < sizeof(shapes) / sizeof(shapes[0]); shape++) {
+        if(ntokens > 1 && strcmp(tokens[1], shapes[shape].name) == 0) break;
+    }
+    if(shape == sizeof(shapes) / sizeof(shapes[0])) {
+        fprintf(stderr,
+                "%s:%d: Expecting a shape {step|ramp|sine} "
+                "after \"%s\"\n",
+                name, lineno, tokens[0]);
+        return -1;
+    }
+    seg.shape = shape;
+
+    if(ntokens != 3 + shapes[shape].nargs) {
+        fprintf(stderr, "%s:%d: Expecting %s <duration> and %d value%s\n",
+                name, lineno, shapes[shape].name, shapes[shape].nargs,
+                shapes[shape].nargs == 1 ? "" : "s");
+        return -1;
+    }
+    if(load_profile_number(tokens[2], 1, &seg.duration) == -1
+       || seg.duration <= 0) {
+        fprintf(stderr, "%s:%d: Invalid duration \"%s\"\n", name, lineno,
+                tokens[2]);
+        return -1;
+    }
+    for(int i = 0; i < shapes[shape].nargs; i++) {
+        /* The sine period is a time. */
+        int is_time = (seg.shape == LPS_SINE && i == 2);
+        if(load_profile_number(tokens[3 + i], is_time, &seg.args[i]) == -1
+           || (is_time && seg.args[i] <= 0)) {
+            fprintf(stderr, "%s:%d: Invalid value \"%s\"\n", name, lineno,
+                    tokens[3 + i]);
+            return -1;
+        }
+    }
+
+    add_segment(lp, param, &seg);
+    return 0;
+}
+
+struct load_profile *
+load_profile_parse(const char *text, const char *name) {
+    struct load_profile *lp = calloc(1, sizeof(*lp));
+    char *copy = strdup(text);
+    assert(lp && copy);
+
+    int lineno = 1;
+    for(char *line = copy; line; lineno++) {
+        char *eol = strchr(line, '\n');
+        if(eol) *eol++ = '\0';
+        if(parse_line(lp, line, name, lineno) == -1) {
+            free(copy);
+            load_profile_free(lp);
+            return NULL;
+        }
+        line = eol;
+    }
+    free(copy);
+
+    int empty = 1;
+    for(int param = 0; param < _LPP_MAX; param++) {
+        if(lp->params[param].count) empty = 0;
+    }
+    if(empty) {
+        fprintf(stderr, "%s: No load profile segments found\n", name);
+        load_profile_free(lp);
+        return NULL;
+    }
+
+    return lp;
+}
+
+struct load_profile *
+load_profile_read(const char *filename) {
+    FILE *f = fopen(filename, "r");
+    if(!f) {
+        fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+        return NULL;
+    }
+
+    size_t size = 0;
+    char *text = NULL;
+    for(;;) {
+        char *p = realloc(text, size + 4096 + 1);
+        assert(p);
+        text = p;
+        size_t got = fread(text + size, 1, 4096, f);
+        size += got;
+        if(got < 4096) break;
+    }
+    int failed = ferror(f);
+    fclose(f);
+    if(failed) {
+        fprintf(stderr, "%s: Read error\n", filename);
+        free(text);
+        return NULL;
+    }
+    text[size] = '\0';
+
+    struct load_profile *lp = load_profile_parse(text, filename);
+    free(text);
+    return lp;
+}
+
+void
+load_profile_free(struct load_profile *lp) {
+    if(!lp) return;
+    for(int param = 0; param < _LPP_MAX; param++) {
+        free(lp->params[param].segments);
+    }
+    free(lp);
+}
+
+static double
+segment_value(const struct load_profile_segment *seg, double t) {
+    double elapsed = t - seg->start;
+    double v = 0;
+    switch(seg->shape) {
+    case LPS_STEP:
+        v = seg->args[0];
+        break;
+    case LPS_RAMP:
+        v = seg->args[0]
+            + (seg->args[1] - seg->args[0]) * elapsed / seg->duration;
+        break;
+    case LPS_SINE:
+        v = seg->args[0]
+            + seg->args[1] * sin(2 * M_PI * elapsed / seg->args[2]);
+        break;
+    }
+    return v > 0 ? v : 0;
+}
+
+int
+load_profile_value(const struct load_profile *lp,
+                   enum load_profile_param param, double t, double *value) {
+    assert(param < _LPP_MAX);
+    size_t count = lp->params[param].count;
+    if(count == 0) return -1;
+
+    const struct load_profile_segment *segs = lp->params[param].segments;
+    for(size_t i = 0; i < count; i++) {
+        if(t < segs[i].start + segs[i].duration) {
+            *value = segment_value(&segs[i], t < 0 ? 0 : t);
+            return 0;
+        }
+    }
+
+    /* Keep the final value. */
+    const struct load_profile_segment *last = &segs[count - 1];
+    *value = segment_value(last, last->start + last->duration);
+    return 0;
+}
+
+int
+load_profile_max(const struct load_profile *lp, enum load_profile_param param,
+                 double *value) {
+    assert(param < _LPP_MAX);
+    size_t count = lp->params[param].count;
+    if(count == 0) return -1;
+
+    double max = 0;
+    for(size_t i = 0; i < count; i++) {
+        const struct load_profile_segment *seg = &lp->params[param].segments[i];
+        double v = seg->args[0];
+        switch(seg->shape) {
+        case LPS_STEP:
+            break;
+        case LPS_RAMP:
+            if(seg->args[1] > v) v = seg->args[1];
+            break;
+        case LPS_SINE:
+            v += seg->args[1];
+            break;
+        }
+        if(v > max) max = v;
+    }
+    *value = max;
+    return 0;
+}
+
+#ifdef TCPKALI_PROFILE_UNIT_TEST
+
+int
+main() {
+    struct load_profile *lp = load_profile_parse(
+        "# Comment\n"
+        "connections ramp 10s 0 100\n"
+        "\n"
+        "  connections step 1m 100k # Trailing comment\n"
+        "message-rate sine 1h 100 50 4s\n",
+        "test");
+    assert(lp);
+
+    double v;
+    assert(load_profile_value(lp, LPP_CONNECTIONS, 0, &v) == 0 && v == 0);
+    assert(load_profile_value(lp, LPP_CONNECTIONS, 5, &v) == 0 && v == 50);
+    assert(load_profile_value(lp, LPP_CONNECTIONS, 10, &v) == 0
+           && v == 100000);
+    assert(load_profile_value(lp, LPP_CONNECTIONS, 1000, &v) == 0
+           && v == 100000);
+    assert(load_profile_value(lp, LPP_MESSAGE_RATE, 1, &v) == 0
+           && fabs(v - 150) < 1e-9);
+    assert(load_profile_value(lp, LPP_MESSAGE_RATE, 3, &v) == 0
+           && fabs(v - 50) < 1e-9);
+    assert(load_profile_value(lp, LPP_CONNECT_RATE, 0, &v) == -1);
+    assert(load_profile_max(lp, LPP_CONNECTIONS, &v) == 0 && v == 100000);
+    assert(load_profile_max(lp, LPP_MESSAGE_RATE, &v) == 0 && v == 150);
+    load_profile_free(lp);
+
+    lp = load_profile_new();
+    load_profile_add_ramp(lp, LPP_MESSAGE_RATE, 10, 10, 10);
+    load_profile_add_ramp(lp, LPP_MESSAGE_RATE, 10, 10, 30);
+    assert(load_profile_value(lp, LPP_MESSAGE_RATE, 5, &v) == 0 && v == 10);
+    assert(load_profile_value(lp, LPP_MESSAGE_RATE, 15, &v) == 0 && v == 20);
+    assert(load_profile_value(lp, LPP_CONNECTIONS, 15, &v) == -1);
+    assert(load_profile_number("1m", 1, &v) == 0 && v == 60);
+    assert(load_profile_number("1m", 0, &v) == -1);
+    load_profile_free(lp);
+
+    fprintf(stderr, "Expecting errors:\n");
+    assert(load_profile_parse("connections ramp 10s 1\n", "test") == NULL);
+    assert(load_profile_parse("connections hop 10s 1\n", "test") == NULL);
+    assert(load_profile_parse("bandwidth step 10s 1\n", "test") == NULL);
+    assert(load_profile_parse("connections step 0s 1\n", "test") == NULL);
+    assert(load_profile_parse("message-rate sine 1s 1 1 0\n", "test") == NULL);
+    assert(load_profile_parse("# Nothing\n", "test") == NULL);
+
+    return 0;
+}
+
+#endif /* TCPKALI_PROFILE_UNIT_TEST */
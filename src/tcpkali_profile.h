@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_PROFILE_H
+#define TCPKALI_PROFILE_H
+
+/*
+ * Time-varying load profile, see --load-profile.
+ *
+ * The profile is a text file with one segment per line:
+ *
+ *     # <parameter> <shape> <duration> <values...>
+ *     connections   ramp    30s        10 1000
+ *     message-rate  sine    2m         1000 500 20s
+ *     connect-rate  step    10s        100
+ *
+ * The segments of each parameter follow one another from the start of
+ * the test. Past the last segment the parameter keeps its final value.
+ * The shapes are:
+ *
+ *     step <duration> <value>
+ *     ramp <duration> <from> <to>
+ *     sine <duration> <mean> <amplitude> <period>
+ */
+
+enum load_profile_param {
+    LPP_CONNECTIONS,  /* --connections */
+    LPP_CONNECT_RATE, /* --connect-rate */
+    LPP_MESSAGE_RATE, /* --message-rate */
+    _LPP_MAX
+};
+
+struct load_profile;
+
+/*
+ * Parse the profile text. The (name) is used in the error messages,
+ * which are printed to stderr. Returns NULL on error.
+ */
+struct load_profile *load_profile_parse(const char *text, const char *name);
+
+/*
+ * Read and parse the profile file.
+ */
+struct load_profile *load_profile_read(const char *filename);
+
+void load_profile_free(struct load_profile *);
+
+/*
+ * An empty profile, to be filled with load_profile_add_ramp().
+ */
+struct load_profile *load_profile_new(void);
+
+/*
+ * Append a segment to the parameter: a ramp (from) -> (to),
+ * or a step if (from) and (to) are the same.
+ */
+void load_profile_add_ramp(struct load_profile *, enum load_profile_param,
+                           double duration, double from, double to);
+
+/*
+ * Parse the number with an optional multiplier suffix:
+ * k and M for the values, ms, s, m and h for the (is_time) durations.
+ * Returns 0 on success, -1 on error.
+ */
+int load_profile_number(const char *str, int is_time, double *value);
+
+/*
+ * Get the parameter value at (t) seconds since the start of the test.
+ * Returns -1 if the profile does not specify the parameter.
+ */
+int load_profile_value(const struct load_profile *, enum load_profile_param,
+                       double t, double *value);
+
+/*
+ * The largest value the parameter takes, or -1 if not specified.
+ */
+int load_profile_max(const struct load_profile *, enum load_profile_param,
+                     double *value);
+
+#endif /* TCPKALI_PROFILE_H */
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "tcpkali_proxy.h"
+
+static const uint8_t proxy_v2_signature[12] = {
+    0x0d, 0x0a, 0x0d, 0x0a, 0x00, 0x0d, 0x0a, 0x51, 0x55, 0x49, 0x54, 0x0a};
+
+int
+proxy_source_parse(const char *str, struct proxy_source *ps) {
+    char addr[INET6_ADDRSTRLEN];
+    const char *slash = strchr(str, '/');
+    size_t addr_len = slash ? (size_t)(slash - str) : strlen(str);
+    if(addr_len == 0 || addr_len >= sizeof(addr)) return -1;
+    memcpy(addr, str, addr_len);
+    addr[addr_len] = '\0';
+
+    memset(ps, 0, sizeof(*ps));
+    unsigned full_bits;
+    if(inet_pton(AF_INET, addr, ps->prefix) == 1) {
+        ps->family = AF_INET;
+        full_bits = 32;
+    } else if(inet_pton(AF_INET6, addr, ps->prefix) == 1) {
+        ps->family = AF_INET6;
+        full_bits = 128;
+    } else {
+        return -1;
+    }
+
+    ps->prefix_bits = full_bits;
+    if(slash) {
+        char *end;
+        long len = strtol(slash + 1, &end, 10);
+        if(end == slash + 1 || *end != '\0' || len < 0
+           || len > (long)full_bits)
+            return -1;
+        ps->prefix_bits = len;
+    }
+    return 0;
+}
+
+void
+proxy_source_pick(const struct proxy_source *ps,
+                  const uint32_t random_bits[5],
+                  struct sockaddr_storage *src) {
+    uint8_t addr[16];
+    size_t size = ps->family == AF_INET ? 4 : 16;
+
+    memcpy(addr, random_bits, sizeof(addr));
+    for(size_t i = 0; i < size; i++) {
+        uint8_t host_mask;
+        if(ps->prefix_bits >= 8 * (i + 1))
+            host_mask = 0;
+        else if(ps->prefix_bits > 8 * i)
+            host_mask = 0xff >> (ps->prefix_bits - 8 * i);
+        else
+            host_mask = 0xff;
+        addr[i] = (ps->prefix[i] & ~host_mask) | (addr[i] & host_mask);
+    }
+    in_port_t port = htons(1024 + random_bits[4] % (65536 - 1024));
+
+    memset(src, 0, sizeof(*src));
+    if(ps->family == AF_INET) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)src;
+        sin->sin_family = AF_INET;
+        sin->sin_port = port;
+        memcpy(&sin->sin_addr, addr, 4);
+    } else {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)src;
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = port;
+        memcpy(&sin6->sin6_addr, addr, 16);
+    }
+}
+
+size_t
+proxy_header_build(enum proxy_protocol version, const struct sockaddr *src,
+                   const struct sockaddr *dst, uint8_t *buf) {
+    int family = src->sa_family == dst->sa_family
+                         && (src->sa_family == AF_INET
+                             || src->sa_family == AF_INET6)
+                     ? src->sa_family
+                     : AF_UNSPEC;
+    const void *src_addr = NULL;
+    const void *dst_addr = NULL;
+    in_port_t src_port = 0;
+    in_port_t dst_port = 0;
+    size_t addr_size = 0;
+
+    if(family == AF_INET) {
+        const struct sockaddr_in *s = (const struct sockaddr_in *)src;
+        const struct sockaddr_in *d = (const struct sockaddr_in *)dst;
+        src_addr = &s->sin_addr;
+        dst_addr = &d->sin_addr;
+        src_port = s->sin_port;
+        dst_port = d->sin_port;
+        addr_size = 4;
+    } else if(family == AF_INET6) {
+        const struct sockaddr_in6 *s = (const struct sockaddr_in6 *)src;
+        const struct sockaddr_in6 *d = (const struct sockaddr_in6 *)dst;
+        src_addr = &s->sin6_addr;
+        dst_addr = &d->sin6_addr;
+        src_port = s->sin6_port;
+        dst_port = d->sin6_port;
+        addr_size = 16;
+    }
+
+    switch(version) {
+    case PROXY_PROTOCOL_NONE:
+        break;
+    case PROXY_PROTOCOL_V1: {
+        if(family == AF_UNSPEC) {
+            return snprintf((char *)buf, PROXY_HEADER_MAX,
+                            "PROXY UNKNOWN\r\n");
+        }
+        char src_buf[INET6_ADDRSTRLEN];
+        char dst_buf[INET6_ADDRSTRLEN];
+        inet_ntop(family, src_addr, src_buf, sizeof(src_buf));
+        inet_ntop(family, dst_addr, dst_buf, sizeof(dst_buf));
+        int n = snprintf((char *)buf, PROXY_HEADER_MAX,
+                         "PROXY %s %s %s %u %u\r\n",
+                         family == AF_INET ? "TCP4" : "TCP6", src_buf,
+                         dst_buf, ntohs(src_port), ntohs(dst_port));
+        assert(n > 0 && n < PROXY_HEADER_MAX);
+        return n;
+    }
+    case PROXY_PROTOCOL_V2: {
+        uint8_t *p = buf;
+        memcpy(p, proxy_v2_signature, sizeof(proxy_v2_signature));
+        p += sizeof(proxy_v2_signature);
+        *p++ = 0x21; /* Version 2, PROXY command */
+        *p++ = family == AF_INET ? 0x11 : family == AF_INET6 ? 0x21 : 0x00;
+        uint16_t length = addr_size ? 2 * addr_size + 4 : 0;
+        *p++ = length >> 8;
+        *p++ = length;
+        if(addr_size) {
+            memcpy(p, src_addr, addr_size);
+            p += addr_size;
+            memcpy(p, dst_addr, addr_size);
+            p += addr_size;
+            memcpy(p, &src_port, 2);
+            p += 2;
+            memcpy(p, &dst_port, 2);
+            p += 2;
+        }
+        return p - buf;
+    }
+    }
+
+    return 0;
+}
+
+#ifdef TCPKALI_PROXY_UNIT_TEST
+
+static struct sockaddr_storage
+address(const char *addr, unsigned port) {
+    struct sockaddr_storage ss;
+    memset(&ss, 0, sizeof(ss));
+    struct sockaddr_in *sin = (struct sockaddr_in *)&ss;
+    struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&ss;
+    if(inet_pton(AF_INET, addr, &sin->sin_addr) == 1) {
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(port);
+    } else {
+        int rc = inet_pton(AF_INET6, addr, &sin6->sin6_addr);
+        assert(rc == 1);
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons(port);
+    }
+    return ss;
+}
+
+int
+main() {
+    uint8_t buf[PROXY_HEADER_MAX];
+    struct sockaddr_storage src4 = address("192.168.1.2", 40000);
+    struct sockaddr_storage dst4 = address("10.0.0.1", 80);
+    struct sockaddr_storage src6 = address("2001:db8::2", 40000);
+    struct sockaddr_storage dst6 = address("2001:db8::1", 443);
+    size_t size;
+
+    size = proxy_header_build(PROXY_PROTOCOL_V1, (struct sockaddr *)&src4,
+                              (struct sockaddr *)&dst4, buf);
+    assert(size == strlen("PROXY TCP4 192.168.1.2 10.0.0.1 40000 80\r\n"));
+    assert(memcmp(buf, "PROXY TCP4 192.168.1.2 10.0.0.1 40000 80\r\n", size)
+           == 0);
+    size = proxy_header_build(PROXY_PROTOCOL_V1, (struct sockaddr *)&src6,
+                              (struct sockaddr *)&dst6, buf);
+    assert(memcmp(buf, "PROXY TCP6 2001:db8::2 2001:db8::1 40000 443\r\n",
+                  size)
+           == 0);
+    size = proxy_header_build(PROXY_PROTOCOL_V1, (struct sockaddr *)&src6,
+                              (struct sockaddr *)&dst4, buf);
+    assert(size == 15 && memcmp(buf, "PROXY UNKNOWN\r\n", size) == 0);
+
+    /* The longest v1 line fits. */
+    struct sockaddr_storage long6 =
+        address("ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff", 65535);
+    size = proxy_header_build(PROXY_PROTOCOL_V1, (struct sockaddr *)&long6,
+                              (struct sockaddr *)&long6, buf);
+    assert(size == 104);
+
+    static const uint8_t v2_ipv4[] = {
+        0x0d, 0x0a, 0x0d, 0x0a, 0x00, 0x0d, 0x0a, 0x51, 0x55, 0x49, 0x54,
+        0x0a, 0x21, 0x11, 0x00, 0x0c, 192,  168,  1,    2,    10,   0,
+        0,    1,    0x9c, 0x40, 0x00, 0x50};
+    size = proxy_header_build(PROXY_PROTOCOL_V2, (struct sockaddr *)&src4,
+                              (struct sockaddr *)&dst4, buf);
+    assert(size == sizeof(v2_ipv4) && memcmp(buf, v2_ipv4, size) == 0);
+    size = proxy_header_build(PROXY_PROTOCOL_V2, (struct sockaddr *)&src6,
+                              (struct sockaddr *)&dst6, buf);
+    assert(size == 16 + 36 && buf[13] == 0x21 && buf[15] == 36);
+    assert(buf[16 + 15] == 2 && buf[16 + 31] == 1);
+    size = proxy_header_build(PROXY_PROTOCOL_V2, (struct sockaddr *)&src4,
+                              (struct sockaddr *)&dst6, buf);
+    assert(size == 16 && buf[13] == 0x00 && buf[15] == 0);
+
+    struct proxy_source ps;
+    assert(proxy_source_parse("10.1.0.0/16", &ps) == 0);
+    assert(ps.family == AF_INET && ps.prefix_bits == 16);
+    assert(proxy_source_parse("10.1.2.3", &ps) == 0 && ps.prefix_bits == 32);
+    assert(proxy_source_parse("2001:db8::/48", &ps) == 0);
+    assert(ps.family == AF_INET6 && ps.prefix_bits == 48);
+    assert(proxy_source_parse("10.1.0.0/33", &ps) == -1);
+    assert(proxy_source_parse("10.1.0.0/", &ps) == -1);
+    assert(proxy_source_parse("example.com/8", &ps) == -1);
+
+    assert(proxy_source_parse("10.1.0.0/16", &ps) == 0);
+    for(uint32_t i = 0; i < 1000; i++) {
+        uint32_t random_bits[5] = {i * 2654435761u, i, i, i, i * 40503u};
+        struct sockaddr_storage ss;
+        proxy_source_pick(&ps, random_bits, &ss);
+        struct sockaddr_in *sin = (struct sockaddr_in *)&ss;
+        assert(sin->sin_family == AF_INET);
+        assert((ntohl(sin->sin_addr.s_addr) >> 16) == 0x0a01);
+        assert(ntohs(sin->sin_port) >= 1024);
+    }
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_PROXY_UNIT_TEST */
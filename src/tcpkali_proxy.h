@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_PROXY_H
+#define TCPKALI_PROXY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+/*
+ * The HAProxy PROXY protocol header, see --proxy-protocol: a line (v1)
+ * or a binary block (v2) sent ahead of the connection's data, telling
+ * the PROXY-aware server the address the client connected from.
+ */
+enum proxy_protocol {
+    PROXY_PROTOCOL_NONE,
+    PROXY_PROTOCOL_V1, /* "PROXY TCP4 <src> <dst> <sport> <dport>\r\n" */
+    PROXY_PROTOCOL_V2,
+};
+
+/* The longest v1 line, which is longer than any IP v2 header */
+#define PROXY_HEADER_MAX 108
+
+/*
+ * The synthetic source addresses, see --proxy-source.
+ */
+struct proxy_source {
+    int family; /* AF_INET or AF_INET6, 0 for the real source address */
+    uint8_t prefix[16];
+    unsigned prefix_bits;
+};
+
+/*
+ * Parse the "addr/len" (or "addr") IPv4 or IPv6 range.
+ * Returns -1 if the string is not one.
+ */
+int proxy_source_parse(const char *str, struct proxy_source *);
+
+/*
+ * Make up a source address in the range, with an unprivileged port,
+ * out of the 160 random bits.
+ */
+void proxy_source_pick(const struct proxy_source *,
+                       const uint32_t random_bits[5],
+                       struct sockaddr_storage *src);
+
+/*
+ * Build the header announcing the (src) to (dst) connection into (buf)
+ * of PROXY_HEADER_MAX bytes, returning its size. The addresses which are
+ * not both IPv4 or both IPv6 are announced as unknown.
+ */
+size_t proxy_header_build(enum proxy_protocol, const struct sockaddr *src,
+                          const struct sockaddr *dst, uint8_t *buf);
+
+#endif /* TCPKALI_PROXY_H */
@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tcpkali_random.h"
+
+#define RANDOM_LANES 16
+#define PCG32_MULT 6364136223846793005ULL
+
+typedef uint64_t random_lanes_t
+    __attribute__((vector_size(RANDOM_LANES * sizeof(uint64_t))));
+typedef uint32_t random_output_t
+    __attribute__((vector_size(RANDOM_LANES * sizeof(uint32_t))));
+
+/*
+ * Below this size, seeding the lanes costs more than it saves.
+ */
+#define RANDOM_LANES_MIN_SIZE (4 * sizeof(random_output_t))
+
+/*
+ * The lanes are also compiled for the wider vector units, and the
+ * variant the CPU supports is picked as the program is loaded.
+ */
+#if defined(__x86_64__) && defined(__linux__)
+#define RANDOM_LANES_TARGETS \
+    __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define RANDOM_LANES_TARGETS
+#endif
+
+struct random_lanes {
+    random_lanes_t state;
+    random_lanes_t inc; /* Odd, a different stream in each lane */
+};
+
+static void
+random_lanes_seed(struct random_lanes *lanes, pcg32_random_t *rng) {
+    for(int i = 0; i < RANDOM_LANES; i++) {
+        uint64_t state = ((uint64_t)pcg32_random_r(rng) << 32)
+                         | pcg32_random_r(rng);
+        uint64_t seq = ((uint64_t)pcg32_random_r(rng) << 32)
+                       | pcg32_random_r(rng);
+        lanes->state[i] = state;
+        lanes->inc[i] = (seq << 1) | 1;
+    }
+}
+
+/*
+ * The PCG32 XSH RR step of pcg32_random_r(), in all lanes at once.
+ */
+static inline void
+random_lanes_next(struct random_lanes *lanes, random_output_t *out) {
+    random_lanes_t old = lanes->state;
+    lanes->state = old * PCG32_MULT + lanes->inc;
+    random_lanes_t xorshifted = (((old >> 18) ^ old) >> 27) & 0xffffffff;
+    random_lanes_t rot = old >> 59;
+    random_lanes_t r = (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+    *out = __builtin_convertvector(r, random_output_t);
+}
+
+RANDOM_LANES_TARGETS static void
+random_lanes_fill(struct random_lanes *lanes, unsigned char *buf,
+                  size_t size) {
+    unsigned char *end = buf + size;
+
+    while((size_t)(end - buf) >= sizeof(random_output_t)) {
+        random_output_t r;
+        random_lanes_next(lanes, &r);
+        memcpy(buf, &r, sizeof(r));
+        buf += sizeof(r);
+    }
+    if(buf < end) {
+        random_output_t r;
+        random_lanes_next(lanes, &r);
+        memcpy(buf, &r, end - buf);
+    }
+}
+
+void
+tk_random_bytes(pcg32_random_t *rng, void *buf, size_t size) {
+    unsigned char *p = buf;
+
+    if(size < RANDOM_LANES_MIN_SIZE) {
+        for(; size >= sizeof(uint32_t); size -= sizeof(uint32_t)) {
+            uint32_t r = pcg32_random_r(rng);
+            memcpy(p, &r, sizeof(r));
+            p += sizeof(r);
+        }
+        if(size) {
+            uint32_t r = pcg32_random_r(rng);
+            memcpy(p, &r, size);
+        }
+        return;
+    }
+
+    struct random_lanes lanes;
+    random_lanes_seed(&lanes, rng);
+    random_lanes_fill(&lanes, p, size);
+}
+
+#define ALNUM_CHARS \
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"
+#define ALNUM_COUNT (sizeof(ALNUM_CHARS) - 1)
+/* The bytes at or above it are skipped, to keep the characters uniform. */
+#define ALNUM_LIMIT ((256 / ALNUM_COUNT) * ALNUM_COUNT)
+/* The character for each byte below ALNUM_LIMIT. */
+static const char alnum_lookup[256] =
+    ALNUM_CHARS ALNUM_CHARS ALNUM_CHARS ALNUM_CHARS "--------";
+
+void
+tk_random_alnum(pcg32_random_t *rng, char *buf, size_t size) {
+    unsigned char block[4096];
+    struct random_lanes lanes;
+    char *end = buf + size;
+
+    random_lanes_seed(&lanes, rng);
+
+    while(buf < end) {
+        /*
+         * Each byte yields at most one character, so (want) bytes
+         * never overrun the buffer. The rejected byte's character
+         * is overwritten by the next one.
+         */
+        size_t want = end - buf;
+        if(want > sizeof(block)) want = sizeof(block);
+        random_lanes_fill(&lanes, block, want);
+        for(size_t i = 0; i < want; i++) {
+            *buf = alnum_lookup[block[i]];
+            buf += block[i] < ALNUM_LIMIT;
+        }
+    }
+}
+
+/*
+ * Vose's variant: the slots with less than the average weight are
+ * topped up from the ones with more, so each slot gets at most
+ * one alias.
+ */
+struct tk_alias_table *
+tk_alias_table_new(const double *weights, size_t size) {
+    double total = 0.0;
+    for(size_t i = 0; i < size; i++) total += weights[i];
+    if(!(total > 0.0) || size > UINT32_MAX) return NULL;
+
+    struct tk_alias_table *table =
+        malloc(sizeof(*table) + size * sizeof(table->slots[0]));
+    double *scaled = malloc(size * sizeof(scaled[0]));
+    uint32_t *small = malloc(size * sizeof(small[0]));
+    uint32_t *large = malloc(size * sizeof(large[0]));
+    assert(table && scaled && small && large);
+    size_t n_small = 0, n_large = 0;
+
+    table->size = size;
+    for(size_t i = 0; i < size; i++) {
+        scaled[i] = weights[i] * size / total;
+        if(scaled[i] < 1.0)
+            small[n_small++] = i;
+        else
+            large[n_large++] = i;
+    }
+    while(n_small && n_large) {
+        uint32_t s = small[--n_small];
+        uint32_t l = large[n_large - 1];
+        table->slots[s].threshold = scaled[s] * 4294967296.0;
+        table->slots[s].alias = l;
+        scaled[l] -= 1.0 - scaled[s];
+        if(scaled[l] < 1.0) {
+            n_large--;
+            small[n_small++] = l;
+        }
+    }
+    /* The rest are full, up to the rounding errors. */
+    while(n_large) {
+        uint32_t l = large[--n_large];
+        table->slots[l].threshold = UINT32_MAX;
+        table->slots[l].alias = l;
+    }
+    while(n_small) {
+        uint32_t s = small[--n_small];
+        table->slots[s].threshold = UINT32_MAX;
+        table->slots[s].alias = s;
+    }
+
+    free(scaled);
+    free(small);
+    free(large);
+    return table;
+}
+
+#ifdef TCPKALI_RANDOM_UNIT_TEST
+
+int
+main() {
+    /* Each lane is a PCG32 stream of its own. */
+    pcg32_random_t rng;
+    pcg32_srandom_r(&rng, 42, 54);
+    struct random_lanes lanes;
+    random_lanes_seed(&lanes, &rng);
+    pcg32_random_t scalar[RANDOM_LANES];
+    for(int i = 0; i < RANDOM_LANES; i++) {
+        scalar[i].state = lanes.state[i];
+        scalar[i].inc = lanes.inc[i];
+    }
+    for(int n = 0; n < 100; n++) {
+        random_output_t r;
+        random_lanes_next(&lanes, &r);
+        for(int i = 0; i < RANDOM_LANES; i++)
+            assert(r[i] == pcg32_random_r(&scalar[i]));
+    }
+
+    /* All sizes are filled exactly, and the data differs between calls. */
+    static unsigned char a[10000 + 1], b[10000 + 1];
+    for(size_t size = 0; size < 10000; size += 97) {
+        memset(a, 0, sizeof(a));
+        tk_random_bytes(&rng, a, size);
+        tk_random_bytes(&rng, b, size);
+        assert(a[size] == 0);
+        assert(size < 16 || memcmp(a, b, size) != 0);
+    }
+
+    /* The bytes are spread out well enough. */
+    size_t counts[256] = {0};
+    tk_random_bytes(&rng, a, 10000);
+    for(size_t i = 0; i < 10000; i++) counts[a[i]]++;
+    for(int i = 0; i < 256; i++) assert(counts[i] > 10 && counts[i] < 80);
+
+    /* Only the alphanumerics, all of them. */
+    char s[10000 + 1];
+    memset(s, 0, sizeof(s));
+    tk_random_alnum(&rng, s, 10000);
+    assert(s[10000] == 0);
+    memset(counts, 0, sizeof(counts));
+    for(size_t i = 0; i < 10000; i++) {
+        assert(strchr(ALNUM_CHARS, s[i]) && s[i]);
+        counts[(unsigned char)s[i]]++;
+    }
+    for(size_t i = 0; i < ALNUM_COUNT; i++)
+        assert(counts[(unsigned char)ALNUM_CHARS[i]] > 80);
+    tk_random_alnum(&rng, s, 0);
+
+    /* The alias table draws the indexes as often as they weigh. */
+    const double weights[] = {8, 0, 1, 3, 0.5, 0.5, 3};
+    const size_t n_weights = sizeof(weights) / sizeof(weights[0]);
+    struct tk_alias_table *table = tk_alias_table_new(weights, n_weights);
+    assert(table && table->size == n_weights);
+    size_t draws[sizeof(weights) / sizeof(weights[0])] = {0};
+    for(int n = 0; n < 160000; n++) draws[tk_alias_sample(table, &rng)]++;
+    for(size_t i = 0; i < n_weights; i++) {
+        double expected = 160000 * weights[i] / 16;
+        assert(draws[i] >= 0.95 * expected && draws[i] <= 1.05 * expected);
+    }
+    free(table);
+    const double nothing[] = {0, 0};
+    assert(tk_alias_table_new(nothing, 2) == NULL);
+
+    return 0;
+}
+
+#endif /* TCPKALI_RANDOM_UNIT_TEST */
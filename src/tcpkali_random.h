@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_RANDOM_H
+#define TCPKALI_RANDOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pcg_basic.h>
+
+/*
+ * Fill the buffer with random bytes, or with random [A-Za-z0-9]
+ * characters, for the bulk \{random.bytes} and \{random.alnum} data.
+ *
+ * The data comes from several PCG32 streams stepped side by side in
+ * the vector registers. The streams are seeded from the (rng) for
+ * every call, which advances it.
+ */
+void tk_random_bytes(pcg32_random_t *rng, void *buf, size_t size);
+void tk_random_alnum(pcg32_random_t *rng, char *buf, size_t size);
+
+/*
+ * Walker's alias table, to draw the indexes [0..size) with the given
+ * weights in constant time, for the \{zipf} keys. Each slot is taken
+ * by its own index with the probability of (threshold / 2^32),
+ * otherwise by its (alias).
+ */
+struct tk_alias_table {
+    uint32_t size;
+    struct tk_alias_slot {
+        uint32_t threshold;
+        uint32_t alias;
+    } slots[];
+};
+
+/*
+ * Build the table of the (size) non-negative weights, or return NULL
+ * if they add up to nothing.
+ */
+struct tk_alias_table *tk_alias_table_new(const double *weights,
+                                          size_t size);
+
+static inline uint32_t
+tk_alias_sample(const struct tk_alias_table *table, pcg32_random_t *rng) {
+    uint32_t i = ((uint64_t)pcg32_random_r(rng) * table->size) >> 32;
+    return pcg32_random_r(rng) < table->slots[i].threshold
+               ? i
+               : table->slots[i].alias;
+}
+
+#endif /* TCPKALI_RANDOM_H */
@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <sys/stat.h>
+
+#include "tcpkali_record.h"
+#include "tcpkali_spsc.h"
+
+/* The writer waits for this much data to accumulate... */
+#define RECORD_WRITE_BATCH (1024 * 1024)
+/* ...unless the data has been waiting for longer than this, seconds. */
+#define RECORD_WRITE_DELAY 0.1
+/* How long the writer sleeps when the rings are not ready, nanoseconds. */
+#define RECORD_POLL_INTERVAL_NS 5000000
+
+struct record_ring {
+    struct spsc_ring ring; /* The (dropped) are the data bytes */
+    /* Used by the writer thread. */
+    double last_write __attribute__((aligned(64)));
+    int fd;
+    int write_error;
+    char *filename;
+};
+
+struct recorder {
+    struct record_ring *rings;
+    int rings_count;
+    struct spsc_writer writer;
+};
+
+static double
+record_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+record_append(struct record_ring *ring, const struct record_header *hdr,
+              const void *data) {
+    if(spsc_ring_append(&ring->ring, hdr, sizeof(*hdr), data, hdr->size)
+       == -1) {
+        ring->ring.dropped += hdr->size;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Write out the part of the ring which is ready.
+ * Returns the number of bytes consumed from the ring.
+ */
+static size_t
+record_ring_drain(struct record_ring *ring, double now, int force) {
+    size_t tail = spsc_ring_tail(&ring->ring);
+    size_t head = ring->ring.head;
+    size_t ready = tail - head;
+
+    if(ready == 0) return 0;
+    if(!force && ready < RECORD_WRITE_BATCH
+       && now - ring->last_write < RECORD_WRITE_DELAY)
+        return 0;
+
+    while(head != tail && !ring->write_error) {
+        size_t chunk;
+        const uint8_t *p =
+            spsc_ring_contiguous(&ring->ring, head, tail, &chunk);
+        ssize_t wrote = write(ring->fd, p, chunk);
+        if(wrote == -1) {
+            if(errno == EINTR) continue;
+            ring->write_error = errno;
+            fprintf(stderr, "%s: %s\n", ring->filename, strerror(errno));
+            break;
+        }
+        head += wrote;
+    }
+
+    /* After a write error, the records are discarded. */
+    spsc_ring_consume(&ring->ring, tail);
+    ring->last_write = now;
+    return ready;
+}
+
+static size_t
+recorder_drain(void *arg, int terminate) {
+    struct recorder *rec = arg;
+    double now = record_clock();
+    size_t drained = 0;
+    for(int i = 0; i < rec->rings_count; i++)
+        drained += record_ring_drain(&rec->rings[i], now, terminate);
+    return drained;
+}
+
+static int
+record_file_open(struct record_ring *ring, const char *dir, int worker) {
+    size_t len = strlen(dir) + sizeof("/worker-.tkrec") + 12;
+    ring->filename = malloc(len);
+    assert(ring->filename);
+    snprintf(ring->filename, len, "%s/worker-%d.tkrec", dir, worker);
+
+    ring->fd = open(ring->filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if(ring->fd == -1) return -1;
+
+    struct stat st;
+    if(fstat(ring->fd, &st) == -1) return -1;
+    if(st.st_size == 0
+       && write(ring->fd, RECORD_FILE_MAGIC, RECORD_FILE_MAGIC_SIZE)
+              != RECORD_FILE_MAGIC_SIZE)
+        return -1;
+    return 0;
+}
+
+struct recorder *
+recorder_open(const char *dir, int workers, size_t ring_size) {
+    if(mkdir(dir, 0755) == -1 && errno != EEXIST) return NULL;
+
+    struct recorder *rec = calloc(1, sizeof(*rec));
+    assert(rec);
+    rec->rings_count = workers;
+    rec->rings = aligned_alloc(64, workers * sizeof(rec->rings[0]));
+    assert(rec->rings);
+    memset(rec->rings, 0, workers * sizeof(rec->rings[0]));
+
+    for(int i = 0; i < workers; i++) {
+        struct record_ring *ring = &rec->rings[i];
+        ring->fd = -1;
+        if(record_file_open(ring, dir, i) == -1) {
+            int saved_errno = errno;
+            for(int j = 0; j <= i; j++) {
+                if(rec->rings[j].fd != -1) close(rec->rings[j].fd);
+                free(rec->rings[j].filename);
+                spsc_ring_free(&rec->rings[j].ring);
+            }
+            free(rec->rings);
+            free(rec);
+            errno = saved_errno;
+            return NULL;
+        }
+        spsc_ring_init(&ring->ring, ring_size < 4096 ? 4096 : ring_size);
+    }
+
+    spsc_writer_start(&rec->writer, recorder_drain, rec,
+                      RECORD_POLL_INTERVAL_NS, 0);
+
+    return rec;
+}
+
+struct record_ring *
+recorder_ring(struct recorder *rec, int worker) {
+    assert(worker >= 0 && worker < rec->rings_count);
+    return &rec->rings[worker];
+}
+
+size_t
+recorder_close(struct recorder *rec) {
+    size_t dropped = 0;
+
+    if(!rec) return 0;
+
+    spsc_writer_stop(&rec->writer);
+
+    for(int i = 0; i < rec->rings_count; i++) {
+        struct record_ring *ring = &rec->rings[i];
+        dropped += ring->ring.dropped;
+        close(ring->fd);
+        free(ring->filename);
+        spsc_ring_free(&ring->ring);
+    }
+    free(rec->rings);
+    free(rec);
+
+    return dropped;
+}
+
+#ifdef TCPKALI_RECORD_UNIT_TEST
+
+static void
+append_data(struct record_ring *ring, uint64_t id, uint64_t offset,
+            const char *data, int expect_rc) {
+    struct record_header hdr = {.connection_id = id,
+                                .offset = offset,
+                                .timestamp_ns = 1,
+                                .size = strlen(data),
+                                .type = RECORD_DATA};
+    assert(record_append(ring, &hdr, data) == expect_rc);
+}
+
+int
+main() {
+    char dir[] = "/tmp/check_tcpkali_record.XXXXXX";
+    assert(mkdtemp(dir));
+
+    struct recorder *rec = recorder_open(dir, 2, 100);
+    assert(rec);
+    struct record_ring *ring = recorder_ring(rec, 1);
+    assert(ring->ring.size == 4096);
+
+    /* Wrap around the ring many times while the writer drains it. */
+    char chunk[1000];
+    memset(chunk, 'x', sizeof(chunk) - 1);
+    chunk[sizeof(chunk) - 1] = '\0';
+    size_t appended = 0;
+    size_t dropped = 0;
+    for(int i = 0; i < 2000; i++) {
+        struct record_header hdr = {.connection_id = 7,
+                                    .offset = appended,
+                                    .size = sizeof(chunk) - 1,
+                                    .type = RECORD_DATA};
+        if(record_append(ring, &hdr, chunk) == 0)
+            appended += hdr.size;
+        else
+            dropped += hdr.size;
+    }
+    /* A record larger than the ring never fits. */
+    char huge[5000];
+    memset(huge, 'y', sizeof(huge) - 1);
+    huge[sizeof(huge) - 1] = '\0';
+    append_data(ring, 8, 0, huge, -1);
+    dropped += sizeof(huge) - 1;
+
+    assert(recorder_close(rec) == dropped);
+
+    char filename[sizeof(dir) + 32];
+    snprintf(filename, sizeof(filename), "%s/worker-1.tkrec", dir);
+    FILE *fp = fopen(filename, "rb");
+    assert(fp);
+    char magic[RECORD_FILE_MAGIC_SIZE];
+    assert(fread(magic, 1, sizeof(magic), fp) == sizeof(magic));
+    assert(memcmp(magic, RECORD_FILE_MAGIC, sizeof(magic)) == 0);
+    size_t offset = 0;
+    struct record_header hdr;
+    while(fread(&hdr, sizeof(hdr), 1, fp) == 1) {
+        assert(hdr.connection_id == 7);
+        assert(hdr.type == RECORD_DATA);
+        assert(hdr.offset >= offset);
+        assert(hdr.size == sizeof(chunk) - 1);
+        char data[sizeof(chunk)];
+        assert(fread(data, 1, hdr.size, fp) == hdr.size);
+        assert(memcmp(data, chunk, hdr.size) == 0);
+        offset = hdr.offset + hdr.size;
+        appended -= hdr.size;
+    }
+    assert(appended == 0);
+    fclose(fp);
+
+    /* The files are appended to. */
+    rec = recorder_open(dir, 1, 4096);
+    assert(rec);
+    append_data(recorder_ring(rec, 0), 9, 0, "hello", 0);
+    assert(recorder_close(rec) == 0);
+    snprintf(filename, sizeof(filename), "%s/worker-0.tkrec", dir);
+    struct stat st;
+    assert(stat(filename, &st) == 0);
+    assert((size_t)st.st_size
+           == RECORD_FILE_MAGIC_SIZE + sizeof(struct record_header) + 5);
+    unlink(filename);
+    snprintf(filename, sizeof(filename), "%s/worker-1.tkrec", dir);
+    unlink(filename);
+    rmdir(dir);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_RECORD_UNIT_TEST */
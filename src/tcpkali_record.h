@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_RECORD_H
+#define TCPKALI_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The received data log, see --record.
+ *
+ * Each worker copies the received data into its own ring, without locks
+ * or system calls. A background thread drains the rings in large writes
+ * into the append-only files, one per worker (<dir>/worker-<N>.tkrec).
+ * When the writer falls behind, the data which does not fit into the
+ * ring is dropped and counted, rather than holding up the worker.
+ *
+ * Each file starts with RECORD_FILE_MAGIC. The records follow, each one
+ * a struct record_header in the host byte order, followed by (size)
+ * bytes of the received data.
+ */
+
+#define RECORD_FILE_MAGIC "tkrec\0\0\1"
+#define RECORD_FILE_MAGIC_SIZE 8
+
+struct record_header {
+    uint64_t connection_id; /* \{connection.uid} */
+    uint64_t offset;        /* Of the data within the received stream */
+    uint64_t timestamp_ns;  /* Since the UNIX epoch */
+    uint32_t size;          /* Of the data following the header */
+    uint16_t type;
+    uint16_t flags;
+};
+
+enum record_type {
+    RECORD_DATA = 1,  /* Received data */
+    RECORD_CLOSE = 2, /* The connection is closed, (offset) is its length */
+};
+
+enum record_flags {
+    RECORD_F_INCOMING = 0x01, /* Accepted by the listener, not outgoing */
+};
+
+struct recorder;
+struct record_ring;
+
+/*
+ * Create the directory if needed, open the files for appending
+ * and start the writer thread. Returns NULL and sets errno on failure.
+ */
+struct recorder *recorder_open(const char *dir, int workers,
+                               size_t ring_size);
+
+/*
+ * The ring of the given worker. Only that worker may append to it.
+ */
+struct record_ring *recorder_ring(struct recorder *, int worker);
+
+/*
+ * Copy the record into the ring. Returns -1 if the ring is full,
+ * in which case the data is dropped.
+ */
+int record_append(struct record_ring *, const struct record_header *,
+                  const void *data);
+
+/*
+ * Write out what is left in the rings, stop the thread and close
+ * the files. Returns the number of data bytes dropped.
+ * The workers must not append to the rings anymore.
+ */
+size_t recorder_close(struct recorder *);
+
+#endif /* TCPKALI_RECORD_H */
@@ -26,6 +26,13 @@ struct tregex {
         struct {
             unsigned char size;
             unsigned char table[256];
+            /*
+             * Sampling table: a random byte below (limit) maps directly
+             * onto a class member, so a single 32-bit draw yields up to
+             * four characters without a division.
+             */
+            unsigned short limit;
+            unsigned char lookup[256];
         } oneof;
         struct {
             tregex *piece[TREGEX_ELEMENTS];
@@ -78,6 +85,47 @@ tregex_debug_print(tregex *re) {
     }
 }
 
+/*
+ * Rebuild the byte-indexed sampling table after the class has changed.
+ */
+static void
+tregex_class_prepare(tregex *re) {
+    assert(re->kind == TRegexClass);
+    unsigned size = re->oneof.size;
+    if(size == 0) {
+        re->oneof.limit = 0;
+        return;
+    }
+    re->oneof.limit = (256 / size) * size;
+    for(unsigned b = 0; b < re->oneof.limit; b++) {
+        re->oneof.lookup[b] = re->oneof.table[b % size];
+    }
+}
+
+/*
+ * Fill (n) bytes with uniformly distributed members of the class.
+ */
+static void
+tregex_class_fill(tregex *re, char *buf, size_t n, pcg32_random_t *rng) {
+    const unsigned limit = re->oneof.limit;
+    const unsigned char *lookup = re->oneof.lookup;
+    char *end = buf + n;
+
+    assert(re->oneof.size >= 1);
+    if(re->oneof.size == 1) {
+        memset(buf, re->oneof.table[0], n);
+        return;
+    }
+
+    while(buf < end) {
+        uint32_t r = pcg32_random_r(rng);
+        for(int i = 0; i < 4 && buf < end; i++, r >>= 8) {
+            unsigned b = r & 0xff;
+            if(b < limit) *buf++ = lookup[b];
+        }
+    }
+}
+
 tregex *
 tregex_string(const char *str, ssize_t len) {
     if(len < 0) len = strlen(str);
@@ -146,6 +194,7 @@ tregex_range(unsigned char from, unsigned char to) {
     for(unsigned i = from; i <= to; i++) {
         re->oneof.table[re->oneof.size++] = i;
     }
+    tregex_class_prepare(re);
     return re;
 }
 
@@ -167,6 +216,7 @@ tregex_range_from_string(const char *str, ssize_t len) {
             re->oneof.table[re->oneof.size++] = c;
         }
     }
+    tregex_class_prepare(re);
     return re;
 }
 
@@ -185,6 +235,7 @@ tregex_union_ranges(tregex *re, tregex *rhs) {
             re->oneof.table[re->oneof.size++] = c;
         }
     }
+    tregex_class_prepare(re);
     return re;
 }
 
@@ -286,12 +337,19 @@ tregex_eval_rng(tregex *re, char *buf, size_t size, pcg32_random_t *rng) {
     case TRegexClass:
         assert(re->oneof.size >= 1);
         if(bend - buf) {
-            *buf++ = re->oneof.table[pcg32_boundedrand_r(rng, re->oneof.size)];
+            tregex_class_fill(re, buf, 1, rng);
+            buf++;
         }
         break;
     case TRegexRepeat: {
         size_t cycles = re->repeat.minimum
                         + (re->repeat.range ? pcg32_boundedrand_r(rng, re->repeat.range) : 0);
+        /* [a-z]{100,500} and the like: fill the whole run from the table. */
+        if(re->repeat.what->kind == TRegexClass) {
+            tregex_class_fill(re->repeat.what, buf, cycles, rng);
+            buf += cycles;
+            break;
+        }
         for(unsigned i = 0; i < cycles; i++) {
             buf += tregex_eval_rng(re->repeat.what, buf, bend - buf, rng);
         }
@@ -375,6 +433,36 @@ main() {
     assert(n == 1);
     assert(buf[0] == 'a' || buf[0] == 'b');
     tregex_free(re);
+
+    /* [a-z]{100,500}, checking the characters are spread evenly */
+    {
+        char big[512];
+        size_t histogram[256] = {0};
+        size_t total = 0;
+        re = tregex_repeat(tregex_range('a', 'z'), 100, 500);
+        for(int i = 0; i < 1000; i++) {
+            n = tregex_eval(re, big, sizeof(big));
+            assert(n >= 100 && n <= 500);
+            assert(big[n] == '\0');
+            for(ssize_t j = 0; j < n; j++) {
+                assert(big[j] >= 'a' && big[j] <= 'z');
+                histogram[(unsigned char)big[j]]++;
+            }
+            total += n;
+        }
+        for(int c = 'a'; c <= 'z'; c++) {
+            assert(histogram[c] > total / 26 * 0.9);
+            assert(histogram[c] < total / 26 * 1.1);
+        }
+        tregex_free(re);
+    }
+
+    /* [xyz]{8} */
+    re = tregex_repeat(tregex_range_from_string("xyzzy", -1), 8, 8);
+    n = tregex_eval(re, buf, sizeof(buf));
+    assert(n == 8);
+    for(int i = 0; i < 8; i++) assert(strchr("xyz", buf[i]));
+    tregex_free(re);
 }
 
 #endif /* TCPKALI_REGEX_UNIT_TEST */
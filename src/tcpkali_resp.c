@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "tcpkali_resp.h"
+
+/*
+ * Collect the line up to the LF. Returns 1 once the line is complete,
+ * with the CR stripped and the (line) NUL-terminated.
+ */
+static int
+resp_collect_line(struct resp_parser *rp, uint8_t **bufp, size_t *sizep) {
+    uint8_t *buf = *bufp;
+    size_t size = *sizep;
+    uint8_t *eol = memchr(buf, '\n', size);
+    size_t take = eol ? (size_t)(eol - buf) : size;
+    size_t room = sizeof(rp->line) - 1 - rp->line_size;
+    size_t keep = take < room ? take : room;
+
+    memcpy(rp->line + rp->line_size, buf, keep);
+    rp->line_size += keep;
+    if(eol) take++;
+    *bufp = buf + take;
+    *sizep = size - take;
+    if(!eol) return 0;
+
+    if(rp->line_size && rp->line[rp->line_size - 1] == '\r') rp->line_size--;
+    rp->line[rp->line_size] = '\0';
+    rp->line_size = 0;
+    return 1;
+}
+
+/*
+ * Parse the length or the count, -1 stands for the null.
+ * Returns -2 if the line is not a number.
+ */
+static int64_t
+resp_line_number(const struct resp_parser *rp) {
+    char *end;
+    errno = 0;
+    long long n = strtoll(rp->line, &end, 10);
+    if(end == rp->line || *end || errno || n < -1) return -2;
+    return n;
+}
+
+/*
+ * An element is complete. Returns 1 if that completes the reply.
+ */
+static int
+resp_element_done(struct resp_parser *rp) {
+    rp->state = RESPP_TYPE;
+    while(rp->depth) {
+        if(--rp->nested[rp->depth - 1].elements_left) return 0;
+        /* The aggregate itself is complete. */
+        rp->depth--;
+        if(rp->nested[rp->depth].attribute) return 0;
+    }
+    return 1;
+}
+
+enum resp_parse_event
+resp_parse(struct resp_parser *rp, uint8_t **bufp, size_t *sizep) {
+    for(;;) {
+        if(*sizep == 0) return RESPE_NEED_MORE_DATA;
+
+        switch(rp->state) {
+        case RESPP_TYPE:
+            rp->type = **bufp;
+            (*bufp)++;
+            (*sizep)--;
+            switch(rp->type) {
+            case '+': case '-': case ':': case '$': case '*':  /* RESP2 */
+            case '_': case ',': case '#': case '(': case '!':  /* RESP3 */
+            case '=': case '%': case '~': case '>': case '|':
+                break;
+            default:
+                return RESPE_PROTOCOL_ERROR;
+            }
+            if(rp->depth == 0) rp->error_reply = 0;
+            if(rp->type == '-' || rp->type == '!') rp->error_reply = 1;
+            rp->state = RESPP_LINE;
+            continue;
+        case RESPP_LINE:
+            break;
+        case RESPP_BULK: {
+            size_t take = rp->bulk_left < *sizep ? rp->bulk_left : *sizep;
+            *bufp += take;
+            *sizep -= take;
+            rp->bulk_left -= take;
+            if(rp->bulk_left) return RESPE_NEED_MORE_DATA;
+            if(resp_element_done(rp)) return RESPE_REPLY_END;
+            continue;
+        }
+        }
+
+        if(!resp_collect_line(rp, bufp, sizep)) return RESPE_NEED_MORE_DATA;
+
+        int64_t n;
+        switch(rp->type) {
+        case '$': /* Bulk string */
+        case '!': /* Bulk error */
+        case '=': /* Verbatim string */
+            n = resp_line_number(rp);
+            if(n == -2) return RESPE_PROTOCOL_ERROR;
+            if(n >= 0) {
+                rp->bulk_left = n + 2; /* With the CRLF */
+                rp->state = RESPP_BULK;
+                continue;
+            }
+            break;
+        case '*': /* Array */
+        case '~': /* Set */
+        case '>': /* Push */
+        case '%': /* Map */
+        case '|': /* Attribute */
+            n = resp_line_number(rp);
+            if(n == -2) return RESPE_PROTOCOL_ERROR;
+            if(rp->type == '%' || rp->type == '|') n *= 2;
+            if(n > 0) {
+                if(rp->depth == RESP_PARSER_DEPTH_MAX)
+                    return RESPE_PROTOCOL_ERROR;
+                rp->nested[rp->depth].elements_left = n;
+                rp->nested[rp->depth].attribute = (rp->type == '|');
+                rp->depth++;
+                rp->state = RESPP_TYPE;
+                continue;
+            }
+            if(rp->type == '|') { /* An empty attribute */
+                rp->state = RESPP_TYPE;
+                continue;
+            }
+            break;
+        default: /* A single line */
+            break;
+        }
+        if(resp_element_done(rp)) return RESPE_REPLY_END;
+    }
+}
+
+#ifdef TCPKALI_RESP_UNIT_TEST
+
+#include <stdio.h>
+
+int
+main() {
+    static const char *stream =
+        "+OK\r\n"
+        "-ERR unknown command 'FOO', with args beginning with: \r\n"
+        ":1000\r\n"
+        "$5\r\nhe\r\no\r\n"
+        "$-1\r\n"
+        "$0\r\n\r\n"
+        "*3\r\n:1\r\n*2\r\n$3\r\nfoo\r\n+bar\r\n*0\r\n"
+        "*-1\r\n"
+        "%2\r\n+first\r\n:1\r\n+second\r\n~1\r\n_\r\n"
+        "|1\r\n+ttl\r\n:3600\r\n$2\r\nhi\r\n"
+        "*2\r\n|1\r\n+a\r\n+b\r\n:1\r\n:2\r\n"
+        "=7\r\ntxt:abc\r\n"
+        ",3.14\r\n#t\r\n(12345678901234567890\r\n!3\r\nbad\r\n";
+    static const int errors[] = {0, 1, 0, 0, 0, 0, 0, 0, 0, 0,
+                                 0, 0, 0, 0, 0, 1};
+    const int expected_replies = sizeof(errors) / sizeof(errors[0]);
+    size_t stream_size = strlen(stream);
+
+    for(size_t piece = 1; piece <= stream_size; piece++) {
+        struct resp_parser rp;
+        char copy[1024];
+        int replies = 0;
+        memset(&rp, 0, sizeof(rp));
+        memcpy(copy, stream, stream_size);
+        for(size_t off = 0; off < stream_size; off += piece) {
+            uint8_t *buf = (uint8_t *)copy + off;
+            size_t size = stream_size - off < piece ? stream_size - off : piece;
+            for(;;) {
+                enum resp_parse_event ev = resp_parse(&rp, &buf, &size);
+                if(ev == RESPE_NEED_MORE_DATA) break;
+                assert(ev == RESPE_REPLY_END);
+                assert(replies < expected_replies);
+                assert(rp.error_reply == errors[replies]);
+                replies++;
+            }
+            assert(size == 0);
+        }
+        assert(replies == expected_replies);
+        assert(rp.depth == 0);
+    }
+
+    /* Not a RESP reply. */
+    struct resp_parser rp;
+    memset(&rp, 0, sizeof(rp));
+    char garbage[] = "HTTP/1.1 400 Bad Request\r\n";
+    uint8_t *buf = (uint8_t *)garbage;
+    size_t size = sizeof(garbage) - 1;
+    assert(resp_parse(&rp, &buf, &size) == RESPE_PROTOCOL_ERROR);
+
+    /* Malformed length. */
+    memset(&rp, 0, sizeof(rp));
+    char badlen[] = "$x\r\n";
+    buf = (uint8_t *)badlen;
+    size = sizeof(badlen) - 1;
+    assert(resp_parse(&rp, &buf, &size) == RESPE_PROTOCOL_ERROR);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_RESP_UNIT_TEST */
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_RESP_H
+#define TCPKALI_RESP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RESP_PARSER_LINE_MAX 32   /* Enough for the lengths and counts */
+#define RESP_PARSER_DEPTH_MAX 16  /* Nesting of the aggregate replies */
+
+/*
+ * Streaming parser of the RESP2 and RESP3 (REdis Serialization Protocol)
+ * replies, see --resp. The bulk strings are skipped over by their length.
+ * The RESP3 attributes are consumed as a part of the reply they precede.
+ * The parser is zero-initialized.
+ */
+struct resp_parser {
+    enum {
+        RESPP_TYPE,     /* The type byte of the next element */
+        RESPP_LINE,     /* The rest of the line after the type byte */
+        RESPP_BULK,     /* The bulk string and its CRLF */
+    } state;
+    uint8_t type;
+    char line[RESP_PARSER_LINE_MAX]; /* The current line, maybe truncated */
+    size_t line_size;
+    uint64_t bulk_left;
+    unsigned depth; /* Number of the aggregates being parsed */
+    struct {
+        uint64_t elements_left;
+        int attribute; /* Not an element of the enclosing aggregate */
+    } nested[RESP_PARSER_DEPTH_MAX];
+    int error_reply; /* The reply just parsed is an error */
+};
+
+enum resp_parse_event {
+    RESPE_NEED_MORE_DATA, /* The input is exhausted */
+    RESPE_REPLY_END,      /* The reply is complete */
+    RESPE_PROTOCOL_ERROR, /* The input is not a RESP reply stream */
+};
+
+/*
+ * Consume the input until the next event.
+ */
+enum resp_parse_event resp_parse(struct resp_parser *, uint8_t **buf,
+                                 size_t *size);
+
+#endif /* TCPKALI_RESP_H */
@@ -31,6 +31,7 @@
 #include <assert.h>
 
 #include "tcpkali_ring.h"
+#include "tcpkali_hugepage.h"
 
 struct ring_buffer *
 ring_buffer_new(size_t unit_size) {
@@ -82,6 +83,99 @@ ring_buffer_grow(struct ring_buffer *rb) {
     }
 }
 
+static uint32_t
+ts_ring_capacity_for(size_t expected) {
+    uint32_t capacity = 16;
+    while(capacity < expected && capacity < (UINT32_C(1) << 31)) capacity <<= 1;
+    return capacity;
+}
+
+/*
+ * Allocate from the arena if there is one, or from malloc(3).
+ */
+static void *
+ts_ring_alloc(struct tk_huge_arena *arena, size_t size, int *huge) {
+    void *p = arena ? tk_huge_alloc(arena, size) : NULL;
+    *huge = (p != NULL);
+    if(!p) p = malloc(size);
+    assert(p);
+    return p;
+}
+
+static void
+ts_ring_release(struct tk_huge_arena *arena, void *p, size_t size, int huge) {
+    if(huge) {
+        assert(arena);
+        tk_huge_free(arena, p, size);
+    } else {
+        free(p);
+    }
+}
+
+static void
+ts_ring_set_ticks(struct tk_huge_arena *arena, struct ts_ring *r,
+                  uint32_t capacity) {
+    int huge;
+    r->ticks = ts_ring_alloc(arena, capacity * sizeof(r->ticks[0]), &huge);
+    r->huge_ticks = huge;
+    r->mask = capacity - 1;
+}
+
+static void
+ts_ring_release_ticks(struct tk_huge_arena *arena, struct ts_ring *r) {
+    ts_ring_release(arena, r->ticks, ts_ring_capacity(r) * sizeof(r->ticks[0]),
+                    r->huge_ticks);
+    r->ticks = NULL;
+}
+
+struct ts_ring *
+ts_ring_new(struct tk_huge_arena *arena, size_t expected, double base) {
+    int huge;
+    struct ts_ring *r = ts_ring_alloc(arena, sizeof(*r), &huge);
+    memset(r, 0, sizeof(*r));
+    r->huge_ring = huge;
+    ts_ring_set_ticks(arena, r, ts_ring_capacity_for(expected));
+    r->base = base;
+    return r;
+}
+
+void
+ts_ring_free(struct tk_huge_arena *arena, struct ts_ring *r) {
+    if(r) {
+        ts_ring_release_ticks(arena, r);
+        ts_ring_release(arena, r, sizeof(*r), r->huge_ring);
+    }
+}
+
+void
+ts_ring_reset(struct tk_huge_arena *arena, struct ts_ring *r,
+              size_t expected, double base) {
+    uint32_t capacity = ts_ring_capacity_for(expected);
+    if(capacity > ts_ring_capacity(r)) {
+        ts_ring_release_ticks(arena, r);
+        ts_ring_set_ticks(arena, r, capacity);
+    }
+    r->head = r->tail = 0;
+    r->base = base;
+}
+
+void
+ts_ring_grow(struct tk_huge_arena *arena, struct ts_ring *r) {
+    uint32_t capacity = ts_ring_capacity(r);
+    assert(capacity < (UINT32_C(1) << 31));
+    struct ts_ring old = *r;
+    ts_ring_set_ticks(arena, r, 2 * capacity);
+
+    /* Unroll the elements to the beginning of the new buffer. */
+    uint32_t count = ts_ring_count(&old);
+    for(uint32_t i = 0; i < count; i++) {
+        r->ticks[i] = old.ticks[(old.head + i) & old.mask];
+    }
+    ts_ring_release_ticks(arena, &old);
+    r->head = 0;
+    r->tail = count;
+}
+
 #ifdef TCPKALI_RING_UNIT_TEST
 
 static void
@@ -160,6 +254,41 @@ main() {
 
     assert(rb->unit_size == sizeof(int));
 
+    /*
+     * The timestamp ring keeps the order across growth and counter wrap,
+     * in the malloc(3) memory and in a huge page arena.
+     */
+    for(int in_arena = 0; in_arena < 2; in_arena++) {
+        struct tk_huge_arena *arena = in_arena ? tk_huge_arena_new() : NULL;
+        struct ts_ring *tr = ts_ring_new(arena, 5, 1000.0);
+        assert(tr->huge_ring == in_arena && tr->huge_ticks == in_arena);
+        assert(ts_ring_capacity(tr) == 16);
+        assert(ts_ring_empty(tr));
+        assert(ts_ring_tick(tr, 1000.5) == TS_RING_TICKS_PER_SECOND / 2);
+        tr->head = tr->tail = UINT32_MAX - 20;
+        uint32_t tick_add = 0, tick_remove = 0;
+        for(iterations = 1000; iterations--;) {
+            int to_add = random() % 20;
+            int to_remove = random() % 10;
+            while(to_add--) {
+                if(ts_ring_full(tr)) ts_ring_grow(arena, tr);
+                ts_ring_push(tr, tick_add++);
+            }
+            while(to_remove-- && !ts_ring_empty(tr)) {
+                assert(ts_ring_pop_elapsed(tr, tick_remove + 7) == 7);
+                tick_remove++;
+            }
+        }
+        assert(ts_ring_count(tr) == tick_add - tick_remove);
+        assert(tr->huge_ticks == in_arena);
+        ts_ring_reset(arena, tr, 10, 0.0);
+        assert(ts_ring_empty(tr));
+        ts_ring_push(tr, UINT32_MAX);
+        assert(ts_ring_pop_elapsed(tr, 1) == 2);
+        ts_ring_free(arena, tr);
+        if(arena) tk_huge_arena_free(arena);
+    }
+
     return 0;
 }
 
@@ -27,6 +27,8 @@
 #ifndef TCPKALI_RING_H
 #define TCPKALI_RING_H
 
+#include <stdint.h>
+
 struct ring_buffer {
     void *ptr;
     void *left;
@@ -46,6 +48,14 @@ void ring_buffer_init(struct ring_buffer *, size_t unit_size);
         }                    \
     } while(0)
 
+/*
+ * Drop all elements, keeping the allocated buffer.
+ */
+#define ring_buffer_reset(rb)                 \
+    do {                                      \
+        (rb)->left = (rb)->right = (rb)->ptr; \
+    } while(0)
+
 /*
  * Add a specified element to the ring.
  * Returns non-zero value if the ring has grown because of it.
@@ -126,4 +136,88 @@ ring_buffer_next_right(struct ring_buffer *rb) {
 
 void ring_buffer_grow(struct ring_buffer *);
 
+/*
+ * A compact ring of send timestamps.
+ * The timestamps are stored as 32-bit microsecond ticks counted from
+ * a per-ring base time, wrapping around modulo 2^32. The differences
+ * between two ticks are therefore valid for about 71 minutes.
+ * The capacity is a power of two, so the indexes are simply masked.
+ *
+ * The ring and its ticks are taken from the given --hugepages arena,
+ * or from malloc(3) if the arena is NULL or can't serve them. The arena
+ * is passed to every call which (re)allocates, as the ring may be used
+ * by another worker than the one that created it.
+ */
+struct tk_huge_arena;
+
+struct ts_ring {
+    uint32_t *ticks;
+    uint32_t mask; /* Capacity - 1 */
+    uint32_t head; /* Next slot to pop, free-running */
+    uint32_t tail; /* Next slot to push, free-running */
+    unsigned huge_ring : 1;  /* The ring itself is in a huge page arena */
+    unsigned huge_ticks : 1; /* The (ticks) are in a huge page arena */
+    double base;   /* Time corresponding to the tick 0 */
+};
+
+#define TS_RING_TICKS_PER_SECOND 1000000
+
+/*
+ * Create a ring holding at least (expected) timestamps.
+ */
+struct ts_ring *ts_ring_new(struct tk_huge_arena *, size_t expected,
+                            double base);
+void ts_ring_free(struct tk_huge_arena *, struct ts_ring *);
+
+/*
+ * Drop all elements and rebase the ring, making sure it can
+ * hold at least (expected) timestamps without growing.
+ */
+void ts_ring_reset(struct tk_huge_arena *, struct ts_ring *, size_t expected,
+                   double base);
+
+/*
+ * Double the ring capacity. Only to be used when the ring is full.
+ */
+void ts_ring_grow(struct tk_huge_arena *, struct ts_ring *);
+
+#define ts_ring_capacity(r) ((size_t)(r)->mask + 1)
+#define ts_ring_count(r) ((uint32_t)((r)->tail - (r)->head))
+#define ts_ring_full(r) (ts_ring_count(r) > (r)->mask)
+#define ts_ring_empty(r) ((r)->tail == (r)->head)
+
+/*
+ * Convert the time into the ring ticks.
+ */
+static inline uint32_t __attribute__((unused))
+ts_ring_tick(const struct ts_ring *r, double now) {
+    return (uint32_t)(uint64_t)((now - r->base) * TS_RING_TICKS_PER_SECOND);
+}
+
+/*
+ * Add the tick to the ring. The ring must not be full.
+ */
+static inline void __attribute__((unused))
+ts_ring_push(struct ts_ring *r, uint32_t tick) {
+    r->ticks[r->tail++ & r->mask] = tick;
+}
+
+/*
+ * Replace the tick pushed (back) pushes ago, 1 being the latest one.
+ * The tick must still be in the ring: 0 < back <= ts_ring_count(r).
+ */
+static inline void __attribute__((unused))
+ts_ring_replace(struct ts_ring *r, uint32_t back, uint32_t tick) {
+    r->ticks[(r->tail - back) & r->mask] = tick;
+}
+
+/*
+ * Remove the oldest tick and return the number of ticks elapsed since.
+ * The ring must not be empty.
+ */
+static inline uint32_t __attribute__((unused))
+ts_ring_pop_elapsed(struct ts_ring *r, uint32_t now_tick) {
+    return now_tick - r->ticks[r->head++ & r->mask];
+}
+
 #endif /* TCPKALI_RING_H */
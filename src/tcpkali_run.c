@@ -34,6 +34,8 @@
 #include <arpa/inet.h>
 #include <poll.h>
 #include <errno.h>
+#include <limits.h>
+#include <sys/time.h>
 
 #include "tcpkali_run.h"
 #include "tcpkali_mavg.h"
@@ -46,8 +48,15 @@
 
 #define ORCH_BUF_SIZE 1024
 
+/*
+ * Do not add more Stats to the output queue past this size:
+ * the next Stats message covers the skipped intervals.
+ */
+#define ORCH_OUT_STATS_LIMIT 65536
+
 static void
 tcpkali_send_current_rate(rate_spec_t rate, struct orchestration_data *state);
+static size_t flush_orch_output(struct orchestration_data *state);
 
 static const char *
 time_progress(double start, double now, double stop) {
@@ -101,8 +110,9 @@ format_latency(char *buf, size_t size, const char *prefix,
                struct hdr_histogram *hist) {
     if(hist) {
         if(hist->total_count) {
-            return snprintf(buf, size, "%s%.1f ", prefix,
-                            hdr_value_at_percentile(hist, 95.0) / 10.0);
+            return snprintf(
+                buf, size, "%s%.*f ", prefix, latency_ms_precision(),
+                latency_to_ms(hdr_value_at_percentile(hist, 95.0)));
         } else {
             return snprintf(buf, size, "%s? ", prefix);
         }
@@ -114,6 +124,7 @@ format_latency(char *buf, size_t size, const char *prefix,
 static void
 format_latencies(char *buf, size_t size, struct latency_snapshot *latency) {
     if(latency->connect_histogram || latency->firstbyte_histogram
+       || latency->handshake_histogram || latency->upgrade_histogram
        || latency->marker_histogram) {
         char *p = buf;
         p += snprintf(p, size, " (");
@@ -121,6 +132,10 @@ format_latencies(char *buf, size_t size, struct latency_snapshot *latency) {
                             "c=", latency->connect_histogram);
         p += format_latency(p, size-(p-buf),
                             "fb=", latency->firstbyte_histogram);
+        p += format_latency(p, size-(p-buf),
+                            "hs=", latency->handshake_histogram);
+        p += format_latency(p, size-(p-buf),
+                            "up=", latency->upgrade_histogram);
         p += format_latency(p, size-(p-buf),
                             "m=", latency->marker_histogram);
         snprintf(p, size - (p - buf), "ms⁹⁵ᵖ)");
@@ -131,7 +146,11 @@ format_latencies(char *buf, size_t size, struct latency_snapshot *latency) {
 
 static void
 format_message_rate(char *buf, size_t size, const struct oc_args *args, double now) {
-    if(engine_params(args->eng)->message_marker) {
+    if(engine_params(args->eng)->message_marker
+       || engine_params(args->eng)->http_enable
+       || engine_params(args->eng)->http2_enable
+       || engine_params(args->eng)->resp_enable
+       || engine_params(args->eng)->framing_prefix_size) {
         double count_rcvd = mavg_per_second(&args->count_mavgs[0], now);
         double count_sent = mavg_per_second(&args->count_mavgs[1], now);
 
@@ -142,6 +161,23 @@ format_message_rate(char *buf, size_t size, const struct oc_args *args, double n
     }
 }
 
+/*
+ * Connections opened and closed per second, when they are churned.
+ */
+static void
+format_churn_rate(char *buf, size_t size, const struct oc_args *args,
+                  double now) {
+    const struct engine_params *params = engine_params(args->eng);
+    if(params->channel_lifetime != INFINITY
+       || params->close_style != CLOSE_GRACEFUL) {
+        snprintf(buf, size, " (%.0f opened/s, %.0f closed/s)",
+                 round(mavg_per_second(&args->churn_mavgs[0], now)),
+                 round(mavg_per_second(&args->churn_mavgs[1], now)));
+    } else {
+        buf[0] = '\0';
+    }
+}
+
 /*
  * Return non-zero value every time we're more than (delta_time)
  * away from the checkpoint time; updates the checkpoint time.
@@ -156,11 +192,92 @@ every(double delta_time, double now, double *checkpoint_time) {
     }
 }
 
-static enum {
+enum modulation_result {
     MRR_ONGOING,
     MRR_RATE_SEARCH_SUCCEEDED,
     MRR_RATE_SEARCH_FAILED
-} modulate_request_rate(struct engine *eng, double now,
+};
+
+/*
+ * --rate-control pi: adjust the rate a few times a second with
+ * a proportional-integral controller of the smoothed relative latency
+ * error. The controller acts on the logarithm of the rate (in the
+ * incremental form), so it reaches the right order of magnitude quickly
+ * and then settles without the binary search restarts.
+ */
+static enum modulation_result
+track_request_rate(struct engine *eng, double now, struct rate_modulator *rm,
+                   struct latency_snapshot *latency) {
+    const double update_interval = 0.5;
+    const double Kp = 0.3;
+    const double Ki = 1.0;
+    const int stable_updates_needed = 6;   /* Within 10% for 3 seconds */
+    const int control_updates_limit = 600; /* Give up after 5 minutes */
+
+    if(!every(update_interval, now, &rm->last_update_short))
+        return MRR_ONGOING;
+
+    /* The histogram is reset on every rate change. */
+    if(latency->marker_histogram->total_count == 0) return MRR_ONGOING;
+
+    double lat = hdr_value_at_percentile(latency->marker_histogram, 95.0)
+                 / latency_units_per_second;
+    exp_moving_average_add(&rm->smoothed_latency, lat);
+    double error = (rm->latency_target - rm->smoothed_latency.accumulator)
+                   / rm->latency_target;
+    if(error < -1.0) error = -1.0;
+
+    /*
+     * Prevent the integral windup: past the rate we are able to generate,
+     * raising the requested rate only postpones the reaction to latency.
+     */
+    size_t connecting, conns_in, conns_out, conns_counter;
+    engine_get_connection_stats(eng, &connecting, &conns_in, &conns_out,
+                                &conns_counter);
+    double achieved_rate = latency->marker_histogram->total_count
+                           / update_interval;
+    if(engine_params(eng)->rate_scope == RATE_SCOPE_CONNECTION && conns_out)
+        achieved_rate /= conns_out;
+    int saturated = error > 0 && achieved_rate < 0.8 * rm->suggested_rate_value;
+    if(saturated) error = 0;
+
+    if(fabs(error) < 0.1) {
+        if(++rm->stable_updates >= stable_updates_needed) {
+            if(saturated) rm->suggested_rate_value = achieved_rate;
+            return MRR_RATE_SEARCH_SUCCEEDED;
+        }
+    } else {
+        rm->stable_updates = 0;
+    }
+    if(++rm->control_updates > control_updates_limit)
+        return MRR_RATE_SEARCH_FAILED;
+    /* Settled after repeated overshoots, and within the target now. */
+    if(rm->gain < 0.05 && error >= 0) return MRR_RATE_SEARCH_SUCCEEDED;
+
+    /*
+     * The latency tends to rise abruptly past the capacity of the system.
+     * Each overshoot of the target halves the gain, making the controller
+     * settle near the cliff rather than oscillate around it.
+     */
+    if((error < 0) != (rm->previous_error < 0) && rm->control_updates > 1
+       && rm->gain > 0.05)
+        rm->gain /= 2;
+    rm->suggested_rate_value *=
+        exp(rm->gain * (Kp * (error - rm->previous_error)
+                        + Ki * error * update_interval));
+    rm->previous_error = error;
+    if(rm->suggested_rate_value < 1.0) rm->suggested_rate_value = 1.0;
+
+    engine_set_message_send_rate(eng, rm->suggested_rate_value);
+    fprintf(stderr, "Tracking --message-rate %g (latency %.1fms)%s\n",
+            rm->suggested_rate_value, 1000 * rm->smoothed_latency.accumulator,
+            tcpkali_clear_eol());
+
+    return MRR_ONGOING;
+}
+
+static enum modulation_result
+modulate_request_rate(struct engine *eng, double now,
                         struct rate_modulator *rm,
                         struct latency_snapshot *latency) {
     if(rm->mode == RM_UNMODULATED || !latency->marker_histogram)
@@ -181,12 +298,23 @@ static enum {
         rm->last_update_short = now;
         rm->last_update_long = now;
         rm->state = RMS_RATE_RAMP_UP;
+        if(rm->controller == RMC_PI) {
+            exp_moving_average_init(&rm->smoothed_latency, 0.5);
+            rm->previous_error = 0;
+            rm->gain = 1.0;
+            rm->stable_updates = 0;
+            rm->control_updates = 0;
+            rm->state = RMS_RATE_TRACKING;
+        }
     }
 
+    if(rm->state == RMS_RATE_TRACKING)
+        return track_request_rate(eng, now, rm, latency);
+
     if(!every(short_time, now, &rm->last_update_short)) return MRR_ONGOING;
 
-    double lat = hdr_value_at_percentile(latency->marker_histogram, 95.0) / 10.0
-                 / 1000.0;
+    double lat = hdr_value_at_percentile(latency->marker_histogram, 95.0)
+                 / latency_units_per_second;
     if(every(long_time, now, &rm->last_update_long)) {
         /*
          * Every long time (to make moving averages stabilize a bit)
@@ -255,15 +383,615 @@ static enum {
     return MRR_ONGOING;
 }
 
+/*
+ * Append the cumulative snapshot to the --statsd-latency-window ring,
+ * releasing the oldest one if the ring is full.
+ */
+static void
+window_ring_push(struct oc_args *args, struct latency_snapshot *snapshot) {
+    size_t size = args->window_ring_size;
+    if(args->window_ring_count == size) {
+        engine_free_latency_snapshot(args->window_ring[args->window_ring_head]);
+        args->window_ring[args->window_ring_head] = snapshot;
+        args->window_ring_head = (args->window_ring_head + 1) % size;
+    } else {
+        size_t pos = (args->window_ring_head + args->window_ring_count) % size;
+        args->window_ring[pos] = snapshot;
+        args->window_ring_count++;
+    }
+}
+
+static void
+window_ring_clear(struct oc_args *args) {
+    for(size_t i = 0; i < args->window_ring_count; i++) {
+        size_t pos = (args->window_ring_head + i) % args->window_ring_size;
+        engine_free_latency_snapshot(args->window_ring[pos]);
+    }
+    args->window_ring_count = 0;
+    args->window_ring_head = 0;
+}
+
 static void
 reinit_latency_snapshot(struct oc_args *args) {
-    if(args->previous_window_latency) {
-        engine_free_latency_snapshot(args->previous_window_latency);
-        args->previous_window_latency = NULL;
-        engine_prepare_latency_snapshot(args->eng);
-        args->previous_window_latency =
+    if(args->window_ring_count) {
+        window_ring_clear(args);
+        window_ring_push(args, engine_collect_latency_snapshot(args->eng));
+    }
+}
+
+/*
+ * The histogram of values recorded between the two snapshots.
+ * If the histogram was reset in between (see 'r' in the engine),
+ * the update is taken as a whole.
+ */
+static struct hdr_histogram *
+interval_histogram(struct hdr_histogram *base, struct hdr_histogram *update) {
+    struct hdr_histogram *diff = hdr_diff(base, update);
+    assert(diff);
+    for(int32_t i = 0; i < diff->counts_len; i++) {
+        if(diff->counts[i] < 0) {
+            memcpy(diff, update, hdr_get_memory_size(update));
+            break;
+        }
+    }
+    return diff;
+}
+
+static size_t
+connection_failures(struct engine *eng) {
+    size_t total = 0;
+    for(size_t i = 0; i < engine_params(eng)->remote_addresses.n_addrs; i++) {
+        size_t attempts, failures;
+        engine_get_remote_stats(eng, i, &attempts, &failures);
+        total += failures;
+    }
+    return total;
+}
+
+/*
+ * The percentile of the latency recorded within the window, in seconds,
+ * or NAN if there were no samples.
+ */
+static double
+window_percentile(struct hdr_histogram *hist, double percentile) {
+    if(!hist || !hist->total_count) return NAN;
+    return hdr_value_at_percentile(hist, percentile) / latency_units_per_second;
+}
+
+/*
+ * Open the new connections at a different rate from now on.
+ */
+static void
+change_connect_rate(struct oc_args *args, struct pacefier *keepup_pace,
+                    long *timeout_ms, double rate) {
+    args->connect_rate = rate;
+    keepup_pace->events_per_second = rate;
+    *timeout_ms = ceil(1000.0 / rate);
+    if(*timeout_ms > 250) *timeout_ms = 250;
+}
+
+/*
+ * Why the value of the --find-max-connections or --find-max-connect-rate
+ * step is not sustained, or NULL if it is.
+ */
+static const char *
+connection_step_breach(struct oc_args *args, double now, size_t connecting,
+                       size_t conns_out) {
+    struct connection_modulator *cm = args->connection_modulator;
+
+    if(connection_failures(args->eng) > cm->step_failures)
+        return "connection failures";
+
+    if(cm->mode == CM_MAX_CONNECTIONS) {
+        if(connecting || conns_out < (size_t)cm->suggested_value)
+            return "connections not established in time";
+    } else {
+        double opened = engine_traffic(args->eng).conns_opened
+                        - cm->step_opened;
+        if(opened < 0.9 * cm->suggested_value * (now - cm->step_start))
+            return "connect rate not achieved";
+    }
+
+    if(cm->latency_target > 0) {
+        struct latency_snapshot *window =
             engine_collect_latency_snapshot(args->eng);
+        engine_subtract_latency_snapshot(window, cm->step_latency);
+        struct hdr_histogram *hist = window->marker_histogram
+                                         && cm->mode == CM_MAX_CONNECTIONS
+                                         ? window->marker_histogram
+                                         : window->connect_histogram;
+        double lat = window_percentile(hist, 95.0);
+        engine_free_latency_snapshot(window);
+        if(lat > cm->latency_target) return "latency";
+    }
+
+    return NULL;
+}
+
+/*
+ * --find-max-connections, --find-max-connect-rate: hold each value for
+ * a few seconds (the new connections are opened first), then assess it.
+ * The value is not sustained if some connections failed or were not
+ * established in time, if the connect rate was not achieved, or if the
+ * latency exceeded the target.
+ */
+static enum modulation_result
+modulate_connections(struct oc_args *args, double now, size_t connecting,
+                     size_t conns_out, struct pacefier *keepup_pace,
+                     long *timeout_ms) {
+    struct connection_modulator *cm = args->connection_modulator;
+    const double hold_time = 5.0;
+
+    if(cm->mode == CM_UNMODULATED) return MRR_ONGOING;
+
+    if(cm->state == CMS_STATE_INITIAL) {
+        if(cm->mode == CM_MAX_CONNECTIONS) {
+            cm->suggested_value = args->max_connections;
+            cm->linear_step = floor(cm->limit / 10);
+        } else {
+            cm->suggested_value = args->connect_rate;
+            cm->linear_step = args->connect_rate;
+        }
+        if(cm->linear_step < 1) cm->linear_step = 1;
+        cm->lower_bound = 0;
+        cm->upper_bound = 0;
+        cm->state = CMS_RAMP_UP;
+    } else {
+        if(now < cm->step_end) return MRR_ONGOING;
+
+        const char *breach =
+            connection_step_breach(args, now, connecting, conns_out);
+        if(breach) {
+            cm->upper_bound = cm->suggested_value;
+            cm->breach = breach;
+            cm->state = CMS_BINARY_SEARCH;
+        } else {
+            cm->lower_bound = cm->suggested_value;
+        }
+
+        if(cm->state == CMS_RAMP_UP) {
+            if(cm->lower_bound >= cm->limit) return MRR_RATE_SEARCH_SUCCEEDED;
+            if(cm->strategy == CMR_DOUBLE)
+                cm->suggested_value *= 2;
+            else
+                cm->suggested_value += cm->linear_step;
+            if(cm->suggested_value > cm->limit)
+                cm->suggested_value = cm->limit;
+        } else {
+            /* Within 1% of each other means we've found the knee. */
+            double gap = cm->upper_bound - cm->lower_bound;
+            if(gap <= 1 || gap <= cm->lower_bound / 100) {
+                return cm->lower_bound > 0 ? MRR_RATE_SEARCH_SUCCEEDED
+                                           : MRR_RATE_SEARCH_FAILED;
+            }
+            cm->suggested_value = floor(cm->lower_bound + gap / 2);
+        }
     }
+
+    double opening = 0;
+    if(cm->mode == CM_MAX_CONNECTIONS) {
+        /* Excess connections are closed by the caller. */
+        args->max_connections = cm->suggested_value;
+        if(cm->suggested_value > conns_out)
+            opening = cm->suggested_value - conns_out;
+        fprintf(stderr, "Attempting --connections %.0f (in range %.0f..%.0f)%s\n",
+                cm->suggested_value, cm->lower_bound,
+                cm->upper_bound ? cm->upper_bound : cm->limit,
+                tcpkali_clear_eol());
+    } else {
+        change_connect_rate(args, keepup_pace, timeout_ms,
+                            cm->suggested_value);
+        fprintf(stderr, "Attempting --connect-rate %g (in range %g..%g)%s\n",
+                cm->suggested_value, cm->lower_bound,
+                cm->upper_bound ? cm->upper_bound : cm->limit,
+                tcpkali_clear_eol());
+    }
+    cm->step_start = now + opening / args->connect_rate;
+    cm->step_end = cm->step_start + hold_time;
+    cm->step_failures = connection_failures(args->eng);
+    cm->step_opened = engine_traffic(args->eng).conns_opened;
+    if(cm->step_latency) engine_free_latency_snapshot(cm->step_latency);
+    cm->step_latency = engine_collect_latency_snapshot(args->eng);
+
+    return MRR_ONGOING;
+}
+
+/*
+ * Evaluate the --abort-if conditions once per second window.
+ * Returns the condition which tripped, or NULL.
+ */
+static struct abort_condition *
+check_abort_conditions(struct oc_args *args, double now) {
+    /* The --abort-if ones, then those of the --scenario phase. */
+    struct abort_conditions *lists[2] = {
+        args->abort_conditions,
+        args->scenario
+            ? &args->scenario->phases[args->scenario_phase].abort_conditions
+            : NULL};
+    if(!(lists[0] && lists[0]->count) && !(lists[1] && lists[1]->count))
+        return NULL;
+
+    if(!args->previous_abort_latency) {
+        args->previous_abort_latency = engine_collect_latency_snapshot(args->eng);
+        args->abort_failures = connection_failures(args->eng);
+        args->checkpoint.last_abort_check = now;
+        return NULL;
+    }
+    double start = args->checkpoint.last_abort_check;
+    if(now - start < 1.0) return NULL;
+
+    struct latency_snapshot *latency = engine_collect_latency_snapshot(args->eng);
+    struct latency_snapshot *window =
+        engine_diff_latency_snapshot(args->previous_abort_latency, latency);
+    size_t failures = connection_failures(args->eng);
+
+    struct abort_condition *tripped = NULL;
+    for(size_t l = 0; l < 2; l++) {
+        for(size_t i = 0; lists[l] && i < lists[l]->count; i++) {
+            struct abort_condition *cond = &lists[l]->conds[i];
+            double value = NAN;
+            switch(cond->metric) {
+            case AM_LATENCY_CONNECT:
+                value = window_percentile(window->connect_histogram,
+                                          cond->percentile);
+                break;
+            case AM_LATENCY_FIRSTBYTE:
+                value = window_percentile(window->firstbyte_histogram,
+                                          cond->percentile);
+                break;
+            case AM_LATENCY_HANDSHAKE:
+                value = window_percentile(window->handshake_histogram,
+                                          cond->percentile);
+                break;
+            case AM_LATENCY_UPGRADE:
+                value = window_percentile(window->upgrade_histogram,
+                                          cond->percentile);
+                break;
+            case AM_LATENCY_MARKER:
+                value = window_percentile(window->marker_histogram,
+                                          cond->percentile);
+                break;
+            case AM_ERRORS:
+                value = (failures - args->abort_failures) / (now - start);
+                break;
+            }
+            if(abort_condition_update(cond, start, now, value) && !tripped)
+                tripped = cond;
+        }
+    }
+
+    engine_free_latency_snapshot(window);
+    engine_free_latency_snapshot(args->previous_abort_latency);
+    args->previous_abort_latency = latency;
+    args->abort_failures = failures;
+    args->checkpoint.last_abort_check = now;
+    return tripped;
+}
+
+/*
+ * Feed the numbers of each second into the --until-stable detector.
+ * Returns 1 once they have settled.
+ */
+static int
+check_steady_state(struct oc_args *args, double now) {
+    if(!args->until_stable) return 0;
+
+    if(!args->previous_stable_latency) {
+        args->previous_stable_latency =
+            engine_collect_latency_snapshot(args->eng);
+        args->stable_traffic_stats = engine_traffic(args->eng);
+        args->checkpoint.last_stable_check = now;
+        return 0;
+    }
+    double elapsed = now - args->checkpoint.last_stable_check;
+    if(elapsed < 1.0) return 0;
+
+    struct latency_snapshot *latency = engine_collect_latency_snapshot(args->eng);
+    struct latency_snapshot *window =
+        engine_diff_latency_snapshot(args->previous_stable_latency, latency);
+    non_atomic_traffic_stats traffic = engine_traffic(args->eng);
+    non_atomic_traffic_stats delta =
+        subtract_traffic_stats(traffic, args->stable_traffic_stats);
+
+    double values[ESM_METRICS];
+    values[ESM_BPS_IN] = 8.0 * delta.bytes_rcvd / elapsed;
+    values[ESM_BPS_OUT] = 8.0 * delta.bytes_sent / elapsed;
+    values[ESM_MPS_IN] = delta.msgs_rcvd / elapsed;
+    values[ESM_MPS_OUT] = delta.msgs_sent / elapsed;
+    values[ESM_LATENCY] =
+        1000.0 * window_percentile(window->marker_histogram, 95.0);
+    int steady = stable_add(args->until_stable, values);
+
+    engine_free_latency_snapshot(window);
+    engine_free_latency_snapshot(args->previous_stable_latency);
+    args->previous_stable_latency = latency;
+    args->stable_traffic_stats = traffic;
+    args->checkpoint.last_stable_check = now;
+    return steady;
+}
+
+/*
+ * The --ab numbers of a group over the (elapsed) seconds, into its (run).
+ */
+static void
+ab_add_numbers(struct compare_run *run, int final,
+               const non_atomic_traffic_stats *traffic,
+               const struct latency_snapshot *latency, double elapsed,
+               const struct percentile_values *percentiles) {
+    if(!(elapsed > 0)) return;
+    compare_run_add(run, "bps_in", CK_THROUGHPUT, final,
+                    8.0 * traffic->bytes_rcvd / elapsed);
+    compare_run_add(run, "bps_out", CK_THROUGHPUT, final,
+                    8.0 * traffic->bytes_sent / elapsed);
+    compare_run_add(run, "mps_in", CK_THROUGHPUT, final,
+                    traffic->msgs_rcvd / elapsed);
+    compare_run_add(run, "mps_out", CK_THROUGHPUT, final,
+                    traffic->msgs_sent / elapsed);
+    compare_run_add(run, "connect_rate", CK_CONNECT_RATE, final,
+                    traffic->conns_opened / elapsed);
+    if(!latency || !percentiles) return;
+
+    struct {
+        const char *name;
+        struct hdr_histogram *hist;
+    } types[] = {{"connect", latency->connect_histogram},
+                 {"first_byte", latency->firstbyte_histogram},
+                 {"handshake", latency->handshake_histogram},
+                 {"upgrade", latency->upgrade_histogram},
+                 {"message", latency->marker_histogram}};
+    for(size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        for(size_t i = 0; types[t].hist && i < percentiles->size; i++) {
+            char name[64];
+            snprintf(name, sizeof(name), "latency.%s.p%s", types[t].name,
+                     percentiles->values[i].value_s);
+            compare_run_add(run, name, CK_LATENCY, final,
+                            1000.0 * window_percentile(
+                                         types[t].hist,
+                                         percentiles->values[i].value_d));
+        }
+    }
+}
+
+/*
+ * Take the --ab numbers of each second of the two groups, so that
+ * the difference between them could be tested for significance.
+ */
+static void
+sample_ab_windows(struct oc_args *args, double now) {
+    if(!args->ab_runs[0]) return;
+
+    int first = args->checkpoint.last_ab_sample == 0;
+    double elapsed = now - args->checkpoint.last_ab_sample;
+    if(!first && elapsed < 1.0) return;
+
+    for(size_t g = 0; g < 2; g++) {
+        non_atomic_traffic_stats traffic = engine_group_traffic(args->eng, g);
+        struct latency_snapshot *latency =
+            engine_collect_group_latency_snapshot(args->eng, g);
+        if(!first) {
+            non_atomic_traffic_stats delta =
+                subtract_traffic_stats(traffic, args->ab_traffic[g]);
+            struct latency_snapshot *window =
+                latency ? engine_diff_latency_snapshot(args->ab_latency[g],
+                                                       latency)
+                        : NULL;
+            ab_add_numbers(args->ab_runs[g], 0, &delta, window, elapsed,
+                           args->latency_percentiles);
+            engine_free_latency_snapshot(window);
+        }
+        engine_free_latency_snapshot(args->ab_latency[g]);
+        args->ab_latency[g] = latency;
+        args->ab_traffic[g] = traffic;
+    }
+    args->checkpoint.last_ab_sample = now;
+}
+
+void
+report_ab_comparison(struct oc_args *args,
+                     const struct engine_summary *summary) {
+    if(!args->ab_runs[0] || summary->n_groups < 2) return;
+
+    const struct engine_params *params = engine_params(args->eng);
+    for(size_t g = 0; g < 2; g++) {
+        ab_add_numbers(args->ab_runs[g], 1, &summary->groups[g].traffic,
+                       summary->groups[g].latency, summary->test_duration,
+                       args->latency_percentiles);
+    }
+    printf("A/B comparison of %s and %s:\n", params->groups[0].name,
+           params->groups[1].name);
+    compare_ab(stdout, params->groups[0].name, args->ab_runs[0],
+               params->groups[1].name, args->ab_runs[1]);
+
+    for(size_t g = 0; g < 2; g++) {
+        compare_run_free(args->ab_runs[g]);
+        args->ab_runs[g] = NULL;
+        engine_free_latency_snapshot(args->ab_latency[g]);
+        args->ab_latency[g] = NULL;
+    }
+}
+
+void
+write_latency_log_interval(struct oc_args *args, double now) {
+    if(!args->latency_log) return;
+    /* Nothing to report since the last interval has just been written. */
+    if(now - args->checkpoint.last_latency_log_flush < 0.001) return;
+
+    struct latency_snapshot *latency =
+        engine_collect_latency_snapshot(args->eng);
+    struct latency_snapshot *base = args->previous_log_latency;
+    double start = args->checkpoint.last_latency_log_flush;
+
+    /* The latency values are kept in --latency-resolution units,
+     * report the maximum in ms. */
+    double units_per_ms = latency_units_per_second / 1000.0;
+    if(latency->connect_histogram)
+        hdrlog_write(args->latency_log, "connect", start, now, units_per_ms,
+                     interval_histogram(base->connect_histogram,
+                                        latency->connect_histogram));
+    if(latency->firstbyte_histogram)
+        hdrlog_write(args->latency_log, "firstbyte", start, now, units_per_ms,
+                     interval_histogram(base->firstbyte_histogram,
+                                        latency->firstbyte_histogram));
+    if(latency->handshake_histogram)
+        hdrlog_write(args->latency_log, "handshake", start, now, units_per_ms,
+                     interval_histogram(base->handshake_histogram,
+                                        latency->handshake_histogram));
+    if(latency->upgrade_histogram)
+        hdrlog_write(args->latency_log, "upgrade", start, now, units_per_ms,
+                     interval_histogram(base->upgrade_histogram,
+                                        latency->upgrade_histogram));
+    if(latency->marker_histogram)
+        hdrlog_write(args->latency_log, "marker", start, now, units_per_ms,
+                     interval_histogram(base->marker_histogram,
+                                        latency->marker_histogram));
+    if(latency->marker_uncorrected_histogram)
+        hdrlog_write(args->latency_log, "marker_uncorrected", start, now, units_per_ms,
+                     interval_histogram(base->marker_uncorrected_histogram,
+                                        latency->marker_uncorrected_histogram));
+
+    engine_free_latency_snapshot(args->previous_log_latency);
+    args->previous_log_latency = latency;
+    args->checkpoint.last_latency_log_flush = now;
+}
+
+/*
+ * Record the checkpoint into the --timeseries file.
+ */
+static void
+write_timeseries_record(struct oc_args *args, uint64_t timestamp_us,
+                        const non_atomic_traffic_stats *delta,
+                        size_t connecting, size_t conns_in, size_t conns_out) {
+    if(!args->timeseries) return;
+
+    size_t failures = connection_failures(args->eng);
+    struct timeseries_record rec = {
+        .timestamp_us = timestamp_us,
+        .bytes_sent = delta->bytes_sent,
+        .bytes_rcvd = delta->bytes_rcvd,
+        .msgs_sent = delta->msgs_sent,
+        .msgs_rcvd = delta->msgs_rcvd,
+        .conns_opened = delta->conns_opened,
+        .conns_closed = delta->conns_closed,
+        .conn_failures = failures - args->timeseries_failures,
+        .connecting = connecting,
+        .conns_in = conns_in,
+        .conns_out = conns_out};
+    args->timeseries_failures = failures;
+
+    if(timeseries_append(args->timeseries, &rec) == -1) {
+        warning("--timeseries: %s, recording stopped\n", strerror(errno));
+        timeseries_close(args->timeseries);
+        args->timeseries = NULL;
+    }
+}
+
+/*
+ * Take the --sample-interval intervals the workers are done with,
+ * recording them into the --timeseries file instead of the checkpoint.
+ * The connections opened and closed go into the next record written.
+ */
+static void
+take_samples(struct oc_args *args, enum work_phase phase,
+             const non_atomic_traffic_stats *delta, size_t connecting,
+             size_t conns_in, size_t conns_out) {
+    /* The summary counts the steady state intervals only. */
+    double from = phase == PHASE_STEADY_STATE ? args->checkpoint.epoch_start
+                                              : HUGE_VAL;
+    double interval = engine_params(args->eng)->sample_interval;
+
+    args->timeseries_conns.conns_opened += delta->conns_opened;
+    args->timeseries_conns.conns_closed += delta->conns_closed;
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    double unix_offset =
+        tv.tv_sec + tv.tv_usec / 1000000.0 - tk_now(TK_DEFAULT);
+
+    struct throughput_sample sample;
+    double start;
+    while(engine_next_sample(args->eng, from, &sample, &start)) {
+        non_atomic_traffic_stats traffic = args->timeseries_conns;
+        memset(&args->timeseries_conns, 0, sizeof(args->timeseries_conns));
+        traffic.bytes_sent = sample.value[SM_BYTES_SENT];
+        traffic.bytes_rcvd = sample.value[SM_BYTES_RCVD];
+        traffic.msgs_sent = sample.value[SM_MSGS_SENT];
+        traffic.msgs_rcvd = sample.value[SM_MSGS_RCVD];
+        write_timeseries_record(
+            args, (start + interval + unix_offset) * 1000000.0, &traffic,
+            connecting, conns_in, conns_out);
+    }
+}
+
+void
+write_json_stream_interval(struct oc_args *args, double now) {
+    if(!args->json_stream && !args->compare_stream) return;
+    /* Nothing to report since the last interval has just been written. */
+    if(now - args->checkpoint.last_json_stream < 0.001) return;
+
+    struct engine_summary summary;
+    memset(&summary, 0, sizeof(summary));
+
+    non_atomic_traffic_stats traffic = engine_traffic(args->eng);
+    summary.traffic = subtract_traffic_stats(traffic, args->json_traffic_stats);
+    summary.test_duration = now - args->checkpoint.last_json_stream;
+    engine_get_connection_stats(args->eng, &summary.connecting,
+                                &summary.conns_in, &summary.conns_out,
+                                &summary.connections_counter);
+
+    const struct engine_params *params = engine_params(args->eng);
+    struct engine_remote_summary remotes[params->remote_addresses.n_addrs + 1];
+    summary.n_remotes = params->remote_addresses.n_addrs;
+    summary.remotes = remotes;
+    for(size_t i = 0; i < summary.n_remotes; i++) {
+        engine_get_remote_stats(args->eng, i, &remotes[i].connection_attempts,
+                                &remotes[i].connection_failures);
+        remotes[i].traffic = engine_remote_traffic(args->eng, i);
+        remotes[i].latency =
+            engine_collect_remote_latency_snapshot(args->eng, i);
+    }
+    struct engine_group_summary groups[params->n_groups + 1];
+    summary.n_groups = params->n_groups;
+    summary.groups = groups;
+    for(size_t i = 0; i < summary.n_groups; i++) {
+        groups[i].traffic = engine_group_traffic(args->eng, i);
+        groups[i].latency =
+            engine_collect_group_latency_snapshot(args->eng, i);
+    }
+
+    struct latency_snapshot *latency =
+        engine_collect_latency_snapshot(args->eng);
+    summary.latency =
+        engine_diff_latency_snapshot(args->previous_json_latency, latency);
+    engine_loop_stats(args->eng, &summary.loop);
+    if(params->cpu_cost) {
+        struct engine_cpu_stats cpu;
+        engine_cpu_stats(args->eng, &cpu);
+        summary.cpu.seconds = cpu.seconds - args->json_cpu_stats.seconds;
+        summary.cpu.cycles = cpu.cycles - args->json_cpu_stats.cycles;
+        summary.cpu.instructions =
+            cpu.instructions - args->json_cpu_stats.instructions;
+        summary.cpu.bytes = cpu.bytes - args->json_cpu_stats.bytes;
+        summary.cpu.messages = cpu.messages - args->json_cpu_stats.messages;
+        args->json_cpu_stats = cpu;
+    }
+
+    FILE *streams[] = {args->json_stream, args->compare_stream};
+    for(size_t i = 0; i < sizeof(streams) / sizeof(streams[0]); i++) {
+        if(!streams[i]) continue;
+        json_report_write(streams[i], "checkpoint",
+                          now - args->json_stream_start, params, &summary,
+                          args->latency_percentiles);
+    }
+
+    for(size_t i = 0; i < summary.n_remotes; i++)
+        engine_free_latency_snapshot(remotes[i].latency);
+    for(size_t i = 0; i < summary.n_groups; i++)
+        engine_free_latency_snapshot(groups[i].latency);
+    engine_free_latency_snapshot(summary.latency);
+    engine_free_latency_snapshot(args->previous_json_latency);
+    args->previous_json_latency = latency;
+    args->json_traffic_stats = traffic;
+    args->checkpoint.last_json_stream = now;
 }
 
 /* 1.148698 ^ 5 == 2, so 5 key-ups give increase by factor of 2 */
@@ -273,7 +1001,8 @@ reinit_latency_snapshot(struct oc_args *args) {
 
 static int
 process_keyboard_events(struct oc_args *args) {
-    switch(tcpkali_kbdhit()) {
+    enum keyboard_event key = tcpkali_kbdhit();
+    switch(key) {
     case KE_UP_ARROW:
         engine_update_send_rate(args->eng, UP_FACTOR);
         reinit_latency_snapshot(args);
@@ -282,6 +1011,15 @@ process_keyboard_events(struct oc_args *args) {
         engine_update_send_rate(args->eng, DOWN_FACTOR);
         reinit_latency_snapshot(args);
         break;
+    case KE_PLUS:
+    case KE_MINUS: {
+        int n = engine_running_workers(args->eng);
+        int changed = engine_set_workers(
+            args->eng, n + (key == KE_PLUS ? 1 : -1));
+        if(changed != n)
+            printf("\nUsing %d worker%s\n", changed, changed == 1 ? "" : "s");
+        break;
+    }
     case KE_Q:
         return 0;
     case KE_ENTER:
@@ -320,6 +1058,25 @@ process_orch_events(struct oc_args *args,
         engine_set_message_send_rate(args->eng, msg->choice.setRate);
         reinit_latency_snapshot(args);
         break;
+    case TcpkaliMessage_PR_setRateAt: {
+        /* Convert the wall clock time into the event loop time. */
+        double delay = ((double)msg->choice.setRateAt.at
+                        - (double)tk_clock_realtime_usec())
+                       / 1000000.0;
+        args->pending_rate = msg->choice.setRateAt.rate;
+        args->pending_rate_at = tk_now(TK_DEFAULT) + (delay > 0 ? delay : 0);
+        break;
+    }
+    case TcpkaliMessage_PR_setWorkers:
+        engine_set_workers(args->eng, msg->choice.setWorkers < INT_MAX
+                                          ? (int)msg->choice.setWorkers
+                                          : INT_MAX);
+        break;
+    case TcpkaliMessage_PR_setMessage:
+        (void)engine_set_message(args->eng,
+                                 (const char *)msg->choice.setMessage.buf,
+                                 msg->choice.setMessage.size);
+        break;
     case TcpkaliMessage_PR_stop:
         free_orch_message(msg);
         return 0;
@@ -331,6 +1088,104 @@ process_orch_events(struct oc_args *args,
     return 1;
 }
 
+/*
+ * Set the targets according to the --load-profile.
+ */
+static void
+follow_load_profile(struct oc_args *args, struct pacefier *keepup_pace,
+                    long *timeout_ms, double now) {
+    double t = now - args->load_profile_start;
+    double value;
+
+    if(load_profile_value(args->load_profile, LPP_CONNECTIONS, t, &value)
+       == 0) {
+        args->max_connections = value + 0.5;
+    }
+
+    if(load_profile_value(args->load_profile, LPP_CONNECT_RATE, t, &value)
+           == 0
+       && value > 0 && value != args->connect_rate) {
+        change_connect_rate(args, keepup_pace, timeout_ms, value);
+    }
+
+    /* Do not disturb the workers too often. */
+    if(load_profile_value(args->load_profile, LPP_MESSAGE_RATE, t, &value) == 0
+       && every(0.1, now, &args->checkpoint.last_load_profile_rate)) {
+        /* Zero rate means no limit; make it practically idle instead. */
+        if(value < 0.1) value = 0.1;
+        rate_spec_t rate = engine_params(args->eng)->channel_send_rate;
+        if(rate.value_base != RS_MESSAGES_PER_SECOND
+           || fabs(rate.value - value) > 0.01 * value)
+            engine_follow_message_send_rate(args->eng, value);
+    }
+}
+
+void
+report_scenario_phase(struct oc_args *args, double now) {
+    const struct scenario_phase *phase =
+        &args->scenario->phases[args->scenario_phase];
+    double elapsed = now - args->scenario_phase_start;
+    non_atomic_traffic_stats traffic = engine_traffic(args->eng);
+    non_atomic_traffic_stats delta =
+        subtract_traffic_stats(traffic, args->scenario_phase_traffic);
+    struct latency_snapshot *latency =
+        engine_collect_latency_snapshot(args->eng);
+    struct latency_snapshot *interval =
+        engine_diff_latency_snapshot(args->scenario_phase_latency, latency);
+    char latency_buf[256];
+    format_latencies(latency_buf, sizeof(latency_buf), interval);
+    engine_free_latency_snapshot(interval);
+
+    fprintf(stderr, "%s", tcpkali_clear_eol());
+    printf("Phase %s: %.1fs, %.3f↓, %.3f↑ Mbps, %" PRIaw " opened, %" PRIaw
+           " closed%s\n",
+           phase->name, elapsed,
+           elapsed > 0 ? 8 * delta.bytes_rcvd / elapsed / 1000000.0 : 0,
+           elapsed > 0 ? 8 * delta.bytes_sent / elapsed / 1000000.0 : 0,
+           delta.conns_opened, delta.conns_closed, latency_buf);
+    fflush(stdout);
+
+    args->scenario_phase_start = now;
+    args->scenario_phase_traffic = traffic;
+    engine_free_latency_snapshot(args->scenario_phase_latency);
+    args->scenario_phase_latency = latency;
+}
+
+/*
+ * Move on to the --scenario phase due at (now), reporting the previous one.
+ */
+static void
+follow_scenario(struct oc_args *args, double now) {
+    size_t phase =
+        scenario_phase_at(args->scenario, now - args->load_profile_start);
+    if(phase == args->scenario_phase) return;
+
+    report_scenario_phase(args, now);
+    args->scenario_phase = phase;
+    /*
+     * Without the --abort-if ones, the window start is left behind
+     * while the phases have no conditions.
+     */
+    if(!args->abort_conditions || !args->abort_conditions->count) {
+        engine_free_latency_snapshot(args->previous_abort_latency);
+        args->previous_abort_latency = NULL;
+    }
+}
+
+/*
+ * Start the measurements afresh once the --warmup is over, keeping the
+ * message rate as is.
+ */
+static void
+end_warmup(struct oc_args *args, double now) {
+    engine_reset_latency(args->eng);
+    args->checkpoint.initial_traffic_stats = engine_traffic(args->eng);
+    args->checkpoint.epoch_start = now;
+    args->warmup_end = 0;
+    fprintf(stderr, "%s", tcpkali_clear_eol());
+    fprintf(stderr, "Warmed up, measuring from now on.\n");
+}
+
 enum oc_return_value
 open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
                                  struct orchestration_data *orch_state) {
@@ -354,10 +1209,19 @@ open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
     statsd_report_latency_types requested_latency_types =
         engine_params(args->eng)->latency_setting;
     if(requested_latency_types && args->latency_window
-       && !args->previous_window_latency) {
-        engine_prepare_latency_snapshot(args->eng);
-        args->previous_window_latency =
-            engine_collect_latency_snapshot(args->eng);
+       && !args->window_ring) {
+        /*
+         * A snapshot a window ago is kept for every step, so each step
+         * reports the latencies over the last (latency_window) seconds.
+         */
+        double step = args->latency_step ? args->latency_step
+                                         : args->latency_window;
+        args->window_ring_size = ceil(args->latency_window / step - 1e-9);
+        if(args->window_ring_size < 1) args->window_ring_size = 1;
+        args->window_ring = calloc(args->window_ring_size,
+                                   sizeof(args->window_ring[0]));
+        assert(args->window_ring);
+        window_ring_push(args, engine_collect_latency_snapshot(args->eng));
     }
 
 #define STDIN_IDX 0
@@ -373,7 +1237,20 @@ open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
            * we're in a steady state. */
           && (phase == PHASE_STEADY_STATE || conn_deficit > 0)) {
 
-        switch(poll(poll_fds, 2, timeout_ms)) {
+        engine_refresh_remote_addresses(args->eng);
+
+        /* Wake up in time to apply the SetRateAt. */
+        long poll_timeout_ms = timeout_ms;
+        if(args->pending_rate_at) {
+            double left_ms = ceil(1000.0 * (args->pending_rate_at - now));
+            if(left_ms < poll_timeout_ms)
+                poll_timeout_ms = left_ms > 0 ? left_ms : 0;
+        }
+
+        poll_fds[ORCH_IDX].events =
+            POLLIN | (orch_state->out_size ? POLLOUT : 0);
+
+        switch(poll(poll_fds, 2, poll_timeout_ms)) {
         case 0: /* timeout, that's ok */
             break;
         case -1: /* error */
@@ -388,6 +1265,10 @@ open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
                     return OC_INTERRUPT;
                 }
             }
+            /* orchestration server accepts more of our output */
+            if(poll_fds[ORCH_IDX].revents & (POLLOUT | POLLERR | POLLHUP)) {
+                flush_orch_output(orch_state);
+            }
             /* got something from orchestration server*/
             if(poll_fds[ORCH_IDX].revents & POLLIN) {
                 if(!process_orch_events(args, orch_state)) {
@@ -399,11 +1280,32 @@ open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
         tk_now_update(TK_DEFAULT);
         now = tk_now(TK_DEFAULT);
 
+        if(args->pending_rate_at && now >= args->pending_rate_at) {
+            engine_set_message_send_rate(args->eng, args->pending_rate);
+            reinit_latency_snapshot(args);
+            args->pending_rate_at = 0;
+        }
+
+        if(args->warmup_end && now >= args->warmup_end) {
+            end_warmup(args, now);
+        }
 
         size_t connecting, conns_in, conns_out, conns_counter;
         engine_get_connection_stats(args->eng, &connecting, &conns_in, &conns_out,
                                     &conns_counter);
+        if(args->load_profile) {
+            follow_load_profile(args, &keepup_pace, &timeout_ms, now);
+        }
+        if(args->scenario) {
+            follow_scenario(args, now);
+        }
         conn_deficit = args->max_connections - (connecting + conns_out);
+        if(conn_deficit < 0
+           && (args->load_profile
+               || args->connection_modulator->mode == CM_MAX_CONNECTIONS)
+           && every(0.25, now, &args->checkpoint.last_load_profile_close)) {
+            engine_close_connections(args->eng, -conn_deficit);
+        }
 
         size_t allowed = pacefier_allow(&keepup_pace, now);
         size_t to_start = allowed;
@@ -413,6 +1315,17 @@ open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
         if(to_start > (size_t)conn_deficit) {
             to_start = conn_deficit;
         }
+        /*
+         * --find-max-connect-rate replaces the connections as it opens them.
+         * The excess is not allowed to grow if the closing lags behind.
+         */
+        if(phase == PHASE_STEADY_STATE
+           && args->connection_modulator->mode == CM_MAX_CONNECT_RATE) {
+            size_t excess = conn_deficit < 0 ? -conn_deficit : 0;
+            to_start = allowed > excess ? allowed - excess : 0;
+            if(excess + to_start)
+                engine_close_connections(args->eng, excess + to_start);
+        }
         args->connections_opened_tally += engine_initiate_new_connections(args->eng, to_start);
         pacefier_moved(&keepup_pace, allowed, now);
 
@@ -427,6 +1340,16 @@ open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
         args->checkpoint.last_traffic_stats = engine_traffic(args->eng);
         non_atomic_traffic_stats traffic_delta =
             subtract_traffic_stats(args->checkpoint.last_traffic_stats, _last);
+        if(engine_params(args->eng)->sample_interval > 0.0) {
+            take_samples(args, phase, &traffic_delta, connecting, conns_in,
+                         conns_out);
+        } else {
+            struct timeval tv;
+            gettimeofday(&tv, NULL);
+            write_timeseries_record(
+                args, (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec,
+                &traffic_delta, connecting, conns_in, conns_out);
+        }
 
         mavg_add(&args->traffic_mavgs[0], now,
                  (double)traffic_delta.bytes_rcvd);
@@ -436,12 +1359,22 @@ open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
                 (double)traffic_delta.msgs_rcvd);
         mavg_add(&args->count_mavgs[1], now,
                 (double)traffic_delta.msgs_sent);
+        mavg_add(&args->churn_mavgs[0], now,
+                 (double)traffic_delta.conns_opened);
+        mavg_add(&args->churn_mavgs[1], now,
+                 (double)traffic_delta.conns_closed);
 
         double bps_in = 8 * mavg_per_second(&args->traffic_mavgs[0], now);
         double bps_out = 8 * mavg_per_second(&args->traffic_mavgs[1], now);
 
-        engine_prepare_latency_snapshot(args->eng);
         struct latency_snapshot *latency = engine_collect_latency_snapshot(args->eng);
+        int latency_kept = 0;
+
+        if(args->shm_stats) {
+            shm_stats_publish(args->shm_stats,
+                              &args->checkpoint.last_traffic_stats, connecting,
+                              conns_in, conns_out, latency);
+        }
 
         statsd_feedback feedback = {.opened = args->connections_opened_tally,
                                     .conns_in = conns_in,
@@ -449,7 +1382,8 @@ open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
                                     .bps_in = bps_in,
                                     .bps_out = bps_out,
                                     .traffic_delta = traffic_delta,
-                                    .latency = NULL};
+                                    .latency = NULL,
+                                    .breakdown = args->statsd_breakdown};
         args->connections_opened_tally = 0;
 
         if(requested_latency_types && args->latency_window) {
@@ -459,12 +1393,13 @@ open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
              */
             report_to_statsd(args->statsd, &feedback, 0, 0);
 
-            if(every(args->latency_window, now,
-                     &args->checkpoint.last_latency_window_flush)) {
-                struct latency_snapshot *diff =
-                    engine_diff_latency_snapshot(args->previous_window_latency, latency);
-                engine_free_latency_snapshot(args->previous_window_latency);
-                args->previous_window_latency = latency;
+            double step = args->latency_step ? args->latency_step
+                                             : args->latency_window;
+            if(every(step, now, &args->checkpoint.last_latency_window_flush)) {
+                struct latency_snapshot *diff = engine_diff_latency_snapshot(
+                    args->window_ring[args->window_ring_head], latency);
+                window_ring_push(args, latency);
+                latency_kept = 1;
 
                 report_latency_to_statsd(args->statsd, diff,
                     requested_latency_types, args->latency_percentiles);
@@ -478,7 +1413,21 @@ open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
                              args->latency_percentiles);
         }
 
-        if(args->print_stats) {
+        /* --latency-log is written in one second intervals. */
+        if(now - args->checkpoint.last_latency_log_flush >= 1.0)
+            write_latency_log_interval(args, now);
+
+        /* So is the --json-stream written. */
+        if(now - args->checkpoint.last_json_stream >= 1.0)
+            write_json_stream_interval(args, now);
+
+        /* So does the orchestration server receive the Stats. */
+        if(now - args->checkpoint.last_orch_stats >= 1.0)
+            tcpkali_send_stats(args, orch_state, now);
+
+        if(args->dashboard && phase == PHASE_STEADY_STATE) {
+            dashboard_update(args->dashboard, now);
+        } else if(args->print_stats) {
             if(phase == PHASE_ESTABLISHING_CONNECTIONS) {
                 print_connections_line(conns_out, args->max_connections,
                                        conns_counter);
@@ -487,10 +1436,12 @@ open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
                 format_latencies(latency_buf, sizeof(latency_buf), latency);
                 char mps_buf[256];
                 format_message_rate(mps_buf, sizeof(mps_buf), args, now);
+                char churn_buf[64];
+                format_churn_rate(churn_buf, sizeof(churn_buf), args, now);
 
                 fprintf(stderr,
                         "%sTraffic %.3f↓, %.3f↑ Mbps "
-                        "(%s%ld↓ %ld↑ %ld⇡; %s%ld)%s%s%s\n\r",
+                        "(%s%ld↓ %ld↑ %ld⇡; %s%ld)%s%s%s%s\n\r",
                         time_progress(args->checkpoint.epoch_start, now, args->epoch_end),
                         bps_in / 1000000.0, bps_out / 1000000.0,
                         requested_latency_types ? "" : "conns ",
@@ -498,10 +1449,26 @@ open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
                         (long)conns_out, (long)connecting,
                         requested_latency_types ? "" : "seen ",
                         (long)conns_counter,
-                        mps_buf, latency_buf, tcpkali_clear_eol());
+                        churn_buf, mps_buf, latency_buf, tcpkali_clear_eol());
             }
         }
 
+        if(engine_params(args->eng)->rebalance
+           && every(1.0, now, &args->checkpoint.last_rebalance)) {
+            engine_rebalance(args->eng);
+        }
+
+        /* The numbers above might tell more about tcpkali than the target. */
+        struct engine_loop_stats loop;
+        engine_loop_stats(args->eng, &loop);
+        if(loop.saturated
+           && every(10.0, now, &args->checkpoint.last_saturation_warning)) {
+            warning(
+                "Generator saturated: %.0f%% busy, %.1f ms loop lag, "
+                "%.1f ms pacing debt\n",
+                100 * loop.busy, 1000 * loop.lag, 1000 * loop.pacing_debt);
+        }
+
         /* Change the request rate according to the modulation rules. */
         if(phase == PHASE_STEADY_STATE) {
             switch(modulate_request_rate(args->eng, now, args->rate_modulator, latency)) {
@@ -512,10 +1479,24 @@ open_connections_until_maxed_out(enum work_phase phase, struct oc_args *args,
             case MRR_RATE_SEARCH_FAILED:
                 return OC_RATE_GOAL_FAILED;
             }
+            switch(modulate_connections(args, now, connecting, conns_out,
+                                        &keepup_pace, &timeout_ms)) {
+            case MRR_ONGOING:
+                break;
+            case MRR_RATE_SEARCH_SUCCEEDED:
+                return OC_CONNS_GOAL_MET;
+            case MRR_RATE_SEARCH_FAILED:
+                return OC_CONNS_GOAL_FAILED;
+            }
         }
 
-        if(latency != args->previous_window_latency)
-            engine_free_latency_snapshot(latency);
+        if(!latency_kept) engine_free_latency_snapshot(latency);
+
+        args->aborted = check_abort_conditions(args, now);
+        if(args->aborted) return OC_ABORTED;
+        if(phase == PHASE_STEADY_STATE) sample_ab_windows(args, now);
+        if(phase == PHASE_STEADY_STATE && check_steady_state(args, now))
+            return OC_STEADY;
     }
 
     if(now >= args->epoch_end) return OC_TIMEOUT;
@@ -617,10 +1598,82 @@ tcpkali_wait_for_start_command(struct orchestration_data *state) {
     }
 }
 
+/*
+ * Write as much of the queued output as the socket would take
+ * without blocking. Returns the number of bytes still queued.
+ */
+static size_t
+flush_orch_output(struct orchestration_data *state) {
+    size_t sent = 0;
+    while(sent < state->out_size) {
+        ssize_t wr = send(state->sockfd, state->out_buf + sent,
+                          state->out_size - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if(wr > 0) {
+            sent += wr;
+        } else if(wr == -1 && errno == EINTR) {
+            continue;
+        } else if(wr == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            /* The reading side notices the lost connection shortly. */
+            warning("Could not send to the orchestration server: %s\n",
+                    strerror(errno));
+            sent = state->out_size;
+            break;
+        }
+    }
+    memmove(state->out_buf, state->out_buf + sent, state->out_size - sent);
+    state->out_size -= sent;
+    return state->out_size;
+}
+
 static int
 send_bytes_to_orch_server(const void *buffer, size_t size, void *app_key) {
     struct orchestration_data *state = (struct orchestration_data *)app_key;
-    return write(state->sockfd, buffer, size);
+    if(state->out_size + size > state->out_allocated) {
+        size_t allocated = state->out_allocated ? state->out_allocated : 4096;
+        while(allocated < state->out_size + size) allocated *= 2;
+        char *p = realloc(state->out_buf, allocated);
+        if(!p) return -1;
+        state->out_buf = p;
+        state->out_allocated = allocated;
+    }
+    memcpy(state->out_buf + state->out_size, buffer, size);
+    state->out_size += size;
+    return 0;
+}
+
+/*
+ * Encode the message into the output queue and push it out
+ * as far as the socket allows.
+ */
+static void
+send_orch_message(struct orchestration_data *state, TcpkaliMessage_t *msg) {
+    asn_enc_rval_t erv = der_encode(&asn_DEF_TcpkaliMessage, msg,
+                                    send_bytes_to_orch_server, (void *)state);
+    if(erv.encoded == -1) {
+        warning("Could not encode the %s orchestration message\n",
+                erv.failed_type ? erv.failed_type->name : "");
+        return;
+    }
+    flush_orch_output(state);
+}
+
+void
+tcpkali_flush_orch_output(struct orchestration_data *state, double timeout) {
+    if(!state->connected) return;
+    double deadline = tk_now(TK_DEFAULT) + timeout;
+    while(flush_orch_output(state)) {
+        tk_now_update(TK_DEFAULT);
+        double left = deadline - tk_now(TK_DEFAULT);
+        if(left <= 0) {
+            warning("Orchestration server did not take the last %zu bytes\n",
+                    state->out_size);
+            break;
+        }
+        struct pollfd pfd = {.fd = state->sockfd, .events = POLLOUT};
+        (void)poll(&pfd, 1, (int)ceil(1000 * left));
+    }
 }
 
 static void
@@ -629,10 +1682,85 @@ tcpkali_send_current_rate(rate_spec_t rate, struct orchestration_data *state) {
     message.present = TcpkaliMessage_PR_currentRate;
     message.choice.currentRate.valueBase = rate.value_base;
     message.choice.currentRate.value = rate.value;
-    der_encode(&asn_DEF_TcpkaliMessage,
-               &message,
-               send_bytes_to_orch_server,
-               (void *)state);
+    send_orch_message(state, &message);
+}
+
+/*
+ * Encode the latencies recorded since (base) into the Stats message field.
+ */
+static PrintableString_t *
+orch_histogram(struct hdr_histogram *base, struct hdr_histogram *update) {
+    if(!update) return NULL;
+    struct hdr_histogram *diff = interval_histogram(base, update);
+    char *encoded = hdrlog_encode(diff);
+    free(diff);
+    if(!encoded) return NULL;
+    PrintableString_t *str =
+        OCTET_STRING_new_fromBuf(&asn_DEF_PrintableString, encoded, -1);
+    free(encoded);
+    return str;
+}
+
+void
+tcpkali_send_stats(struct oc_args *args, struct orchestration_data *state,
+                   double now) {
+    if(!state->connected) return;
+    /* Nothing to report since the last Stats message has just been sent. */
+    if(now - args->checkpoint.last_orch_stats < 0.001) return;
+    /*
+     * The server does not keep up with the Stats already queued.
+     * Skip this one; the next message will cover the longer interval.
+     */
+    if(state->out_size > ORCH_OUT_STATS_LIMIT) return;
+
+    size_t connecting, conns_in, conns_out, conns_counter;
+    engine_get_connection_stats(args->eng, &connecting, &conns_in, &conns_out,
+                                &conns_counter);
+    non_atomic_traffic_stats traffic = engine_traffic(args->eng);
+    non_atomic_traffic_stats delta =
+        subtract_traffic_stats(traffic, args->orch_traffic_stats);
+    struct latency_snapshot *latency =
+        engine_collect_latency_snapshot(args->eng);
+    struct latency_snapshot *base = args->previous_orch_latency;
+
+    TcpkaliMessage_t message;
+    memset(&message, 0, sizeof(message));
+    message.present = TcpkaliMessage_PR_stats;
+    Stats_t *stats = &message.choice.stats;
+    stats->interval = now - args->checkpoint.last_orch_stats;
+    stats->bytesSent = delta.bytes_sent;
+    stats->bytesReceived = delta.bytes_rcvd;
+    stats->messagesSent = delta.msgs_sent;
+    stats->messagesReceived = delta.msgs_rcvd;
+    stats->connectionsOpened = conns_counter - args->orch_connections_counter;
+    stats->connectionsActive = conns_in + conns_out;
+    stats->latencyConnect = orch_histogram(base->connect_histogram,
+                                           latency->connect_histogram);
+    stats->latencyFirstByte = orch_histogram(base->firstbyte_histogram,
+                                             latency->firstbyte_histogram);
+    stats->latencyMarker =
+        orch_histogram(base->marker_histogram, latency->marker_histogram);
+    size_t failures = connection_failures(args->eng);
+    Counter_t closed = delta.conns_closed;
+    Counter_t failed = failures - args->orch_connection_failures;
+    Counter_t lost = delta.msgs_lost;
+    stats->connectionsClosed = &closed;
+    stats->connectionsFailed = &failed;
+    stats->messagesLost = &lost;
+
+    send_orch_message(state, &message);
+    /* The counters are on the stack. */
+    stats->connectionsClosed = NULL;
+    stats->connectionsFailed = NULL;
+    stats->messagesLost = NULL;
+    ASN_STRUCT_FREE_CONTENTS_ONLY(asn_DEF_TcpkaliMessage, &message);
+
+    engine_free_latency_snapshot(args->previous_orch_latency);
+    args->previous_orch_latency = latency;
+    args->orch_traffic_stats = traffic;
+    args->orch_connections_counter = conns_counter;
+    args->orch_connection_failures = failures;
+    args->checkpoint.last_orch_stats = now;
 }
 
 void
@@ -33,6 +33,16 @@
 #include "tcpkali_engine.h"
 #include "tcpkali_statsd.h"
 #include "tcpkali_signals.h"
+#include "tcpkali_hdrlog.h"
+#include "tcpkali_timeseries.h"
+#include "tcpkali_shm.h"
+#include "tcpkali_profile.h"
+#include "tcpkali_abort.h"
+#include "tcpkali_scenario.h"
+#include "tcpkali_stable.h"
+#include "tcpkali_json.h"
+#include "tcpkali_dashboard.h"
+#include "tcpkali_compare.h"
 #include "TcpkaliMessage.h"
 
 struct orchestration_data;
@@ -44,7 +54,16 @@ struct rate_modulator {
         RM_UNMODULATED, /* Do not modulate request rate */
         RM_MAX_RATE_AT_TARGET_LATENCY
     } mode;
-    enum { RMS_STATE_INITIAL, RMS_RATE_RAMP_UP, RMS_RATE_BINARY_SEARCH } state;
+    enum {
+        RMC_SEARCH, /* Ramp up, then binary search (default) */
+        RMC_PI,     /* Continuously track the latency target */
+    } controller;   /* --rate-control */
+    enum {
+        RMS_STATE_INITIAL,
+        RMS_RATE_RAMP_UP,
+        RMS_RATE_BINARY_SEARCH,
+        RMS_RATE_TRACKING
+    } state;
     double last_update_long;
     double last_update_short;
     double latency_target; /* In seconds. */
@@ -62,6 +81,55 @@ struct rate_modulator {
     double rate_min_bound;
     double rate_max_bound;
     double suggested_rate_value;
+    /*
+     * The proportional-integral controller, see --rate-control.
+     */
+    exp_moving_average smoothed_latency;
+    double previous_error;
+    double gain;
+    int stable_updates;
+    int control_updates;
+};
+
+/*
+ * --find-max-connections, --find-max-connect-rate: ramp up the number
+ * of connections or the connect rate, then binary search for the largest
+ * value the target sustains.
+ */
+struct connection_modulator {
+    enum {
+        CM_UNMODULATED,     /* Keep the --connections and --connect-rate */
+        CM_MAX_CONNECTIONS, /* --find-max-connections */
+        CM_MAX_CONNECT_RATE /* --find-max-connect-rate, churning */
+    } mode;
+    enum {
+        CMR_DOUBLE, /* Double the value every step (default) */
+        CMR_LINEAR  /* Add the (linear_step) every step */
+    } strategy;     /* --find-max-strategy */
+    enum {
+        CMS_STATE_INITIAL,
+        CMS_RAMP_UP,
+        CMS_BINARY_SEARCH
+    } state;
+    double limit;          /* Do not search beyond that */
+    double latency_target; /* In seconds, or 0 */
+    const char *latency_target_s;
+    /*
+     * Runtime parameters.
+     */
+    double linear_step;
+    double step_start;
+    double step_end; /* The current value is assessed at this time */
+    size_t step_failures; /* Connection failures at the step start */
+    size_t step_opened;   /* Connections opened at the step start */
+    struct latency_snapshot *step_latency;
+    const char *breach;   /* Why the (upper_bound) was not sustained */
+    /*
+     * Bounds for binary search.
+     */
+    double lower_bound; /* Sustained */
+    double upper_bound; /* Not sustained, 0 until found */
+    double suggested_value;
 };
 
 enum oc_return_value {
@@ -69,7 +137,11 @@ enum oc_return_value {
     OC_TIMEOUT,
     OC_INTERRUPT,
     OC_RATE_GOAL_MET,
-    OC_RATE_GOAL_FAILED
+    OC_RATE_GOAL_FAILED,
+    OC_CONNS_GOAL_MET,    /* See --find-max-connections */
+    OC_CONNS_GOAL_FAILED,
+    OC_ABORTED, /* An --abort-if condition tripped, see (aborted) */
+    OC_STEADY   /* The numbers settled, see --until-stable */
 };
 
 struct oc_args {
@@ -78,22 +150,89 @@ struct oc_args {
     double connect_rate;
     double epoch_end;
     double latency_window;
+    double latency_step; /* --statsd-latency-step, (latency_window) if 0 */
     volatile sig_atomic_t term_flag;
     struct stats_checkpoint {
         double epoch_start; /* Start of current checkpoint epoch */
         double last_update; /* Last we updated the checkpoint structure */
         double last_latency_window_flush;   /* Last time we flushed statsd latencies */
+        double last_latency_log_flush;      /* Start of --latency-log interval */
+        double last_load_profile_close;     /* --load-profile */
+        double last_load_profile_rate;      /* --load-profile */
+        double last_orch_stats;             /* Last orchestration Stats */
+        double last_json_stream;            /* --json-stream */
+        double last_saturation_warning;     /* Generator saturated */
+        double last_rebalance;              /* --rebalance */
+        double last_abort_check;            /* --abort-if window start */
+        double last_stable_check;           /* --until-stable window start */
+        double last_ab_sample;              /* --ab window start */
         non_atomic_traffic_stats initial_traffic_stats; /* Ramp-up phase traffic */
         non_atomic_traffic_stats last_traffic_stats;
     } checkpoint;
-    struct latency_snapshot *previous_window_latency;
+    /*
+     * The cumulative snapshots taken every (latency_step), oldest first,
+     * starting at (window_ring_head). The oldest one is subtracted from
+     * the current snapshot to get the latencies of the sliding window.
+     */
+    struct latency_snapshot **window_ring;
+    size_t window_ring_size;
+    size_t window_ring_count;
+    size_t window_ring_head;
+    struct hdrlog *latency_log;                    /* --latency-log */
+    struct latency_snapshot *previous_log_latency; /* --latency-log */
+    struct timeseries *timeseries;                 /* --timeseries */
+    size_t timeseries_failures; /* Connection failures at the last record */
+    /* --sample-interval: the connections not in a record yet */
+    non_atomic_traffic_stats timeseries_conns;
+    struct shm_stats *shm_stats;                   /* --shm-stats */
+    double warmup_end; /* --warmup, or 0 once over or not given */
+    struct load_profile *load_profile;             /* --load-profile */
+    double load_profile_start;
+    /*
+     * The --scenario runs its profile from the (load_profile_start),
+     * and reports each phase once it is over.
+     */
+    struct scenario *scenario;
+    size_t scenario_phase;
+    double scenario_phase_start;
+    non_atomic_traffic_stats scenario_phase_traffic;
+    struct latency_snapshot *scenario_phase_latency;
+    /* The orchestration Stats are reported relative to these. */
+    struct latency_snapshot *previous_orch_latency;
+    non_atomic_traffic_stats orch_traffic_stats;
+    size_t orch_connections_counter;
+    size_t orch_connection_failures;
+    FILE *json_stream; /* --json-stream */
+    FILE *compare_stream; /* --compare-to, the reports of this run */
+    double json_stream_start;
+    struct latency_snapshot *previous_json_latency;
+    non_atomic_traffic_stats json_traffic_stats;
+    struct engine_cpu_stats json_cpu_stats; /* --cpu-cost */
+    /* SetRateAt to be applied at the given event loop time. */
+    double pending_rate_at;
+    double pending_rate;
     mavg traffic_mavgs[2];
     mavg count_mavgs[2];    /* --message-marker */
+    mavg churn_mavgs[2];    /* Connections opened, closed */
     size_t connections_opened_tally;
     Statsd *statsd;
+    statsd_breakdown *statsd_breakdown; /* --statsd-tags */
     struct rate_modulator *rate_modulator;
+    struct connection_modulator *connection_modulator;
+    struct abort_conditions *abort_conditions; /* --abort-if */
+    struct latency_snapshot *previous_abort_latency;
+    size_t abort_failures; /* Connection failures at the window start */
+    struct abort_condition *aborted; /* The condition which tripped */
+    struct stable_detector *until_stable; /* --until-stable */
+    struct latency_snapshot *previous_stable_latency;
+    non_atomic_traffic_stats stable_traffic_stats;
+    /* --ab: the windows of the two connection groups, A and B. */
+    struct compare_run *ab_runs[2];
+    struct latency_snapshot *ab_latency[2];
+    non_atomic_traffic_stats ab_traffic[2];
     struct percentile_values *latency_percentiles;
     int print_stats;
+    struct dashboard *dashboard; /* --dashboard, in the steady state */
 };
 
 enum oc_return_value
@@ -101,6 +240,27 @@ open_connections_until_maxed_out(enum work_phase phase,
                                  struct oc_args *,
                                  struct orchestration_data *orch_state);
 
+/*
+ * Write the latencies observed since the previous --latency-log interval.
+ */
+void write_latency_log_interval(struct oc_args *, double now);
+
+/*
+ * Write the --json-stream report of the interval since the previous one.
+ */
+void write_json_stream_interval(struct oc_args *, double now);
+
+/*
+ * Print the numbers of the current --scenario phase, up until (now).
+ */
+void report_scenario_phase(struct oc_args *, double now);
+
+/*
+ * Print the --ab numbers of the A and B connection groups side by side,
+ * the final ones taken from the (summary).
+ */
+void report_ab_comparison(struct oc_args *, const struct engine_summary *);
+
 struct orchestration_args {
     int enabled;
     char *server_addr_str;
@@ -112,6 +272,14 @@ struct orchestration_data {
     int sockfd;
     char *buf;
     char *buf_write;
+    /*
+     * The encoded messages not yet accepted by the server's socket.
+     * Written out as the socket becomes writable, so that a slow server
+     * does not stall the control loop.
+     */
+    char *out_buf;
+    size_t out_size;
+    size_t out_allocated;
 };
 
 struct orchestration_data
@@ -120,6 +288,19 @@ TcpkaliMessage_t * tcpkali_wait_for_start_command(struct orchestration_data *sta
 TcpkaliMessage_t * read_orch_command(struct orchestration_data *state);
 void free_orch_message(TcpkaliMessage_t *msg);
 
+/*
+ * Send the traffic counters and the interval latency histograms
+ * accumulated since the previous call to the orchestration server.
+ */
+void tcpkali_send_stats(struct oc_args *, struct orchestration_data *,
+                        double now);
+
+/*
+ * Wait up to (timeout) seconds for the queued messages to reach the
+ * orchestration server's socket. Used before exit to deliver the final Stats.
+ */
+void tcpkali_flush_orch_output(struct orchestration_data *, double timeout);
+
 void
 free_message(TcpkaliMessage_t *msg);
 
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tcpkali_samples.h"
+
+struct sample_ring {
+    /* Written by the worker. */
+    size_t tail __attribute__((aligned(64)));
+    /* Written by the main thread. */
+    size_t head __attribute__((aligned(64)));
+    uint64_t latest; /* The interval reported last, plus 1, or 0 */
+    /* Read-only. */
+    struct throughput_sample *samples __attribute__((aligned(64)));
+    size_t size; /* Power of 2 */
+};
+
+struct sampler {
+    struct sample_ring *rings;
+    int rings_count;
+    /*
+     * The sums of the intervals not handed out yet, starting with the
+     * (base) interval at pending[head].
+     */
+    struct throughput_sample *pending;
+    size_t head;
+    size_t count;
+    size_t size;
+    uint64_t base;
+    int taken; /* Any interval handed out by sampler_next() */
+};
+
+struct sampler *
+sampler_new(int workers, size_t ring_samples) {
+    size_t size = 64;
+    while(size < ring_samples) size <<= 1;
+
+    struct sampler *s = calloc(1, sizeof(*s));
+    assert(s);
+    s->rings_count = workers;
+    s->rings = aligned_alloc(64, workers * sizeof(s->rings[0]));
+    assert(s->rings);
+    memset(s->rings, 0, workers * sizeof(s->rings[0]));
+    for(int i = 0; i < workers; i++) {
+        s->rings[i].size = size;
+        s->rings[i].samples = malloc(size * sizeof(s->rings[i].samples[0]));
+        assert(s->rings[i].samples);
+    }
+    return s;
+}
+
+void
+sampler_free(struct sampler *s) {
+    if(!s) return;
+    for(int i = 0; i < s->rings_count; i++) free(s->rings[i].samples);
+    free(s->rings);
+    free(s->pending);
+    free(s);
+}
+
+struct sample_ring *
+sampler_ring(struct sampler *s, int worker) {
+    assert(worker >= 0 && worker < s->rings_count);
+    return &s->rings[worker];
+}
+
+int
+sample_put(struct sample_ring *ring, const struct throughput_sample *sample) {
+    size_t tail = ring->tail;
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if(tail - head == ring->size) return -1;
+
+    ring->samples[tail & (ring->size - 1)] = *sample;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/*
+ * Make room for (n) more pending intervals after the current ones.
+ */
+static void
+sampler_reserve(struct sampler *s, size_t n) {
+    if(s->head + s->count + n <= s->size) return;
+    memmove(s->pending, s->pending + s->head,
+            s->count * sizeof(s->pending[0]));
+    s->head = 0;
+    if(s->count + n <= s->size) return;
+    size_t size = s->size ? 2 * s->size : 16;
+    if(size < s->count + n) size = s->count + n;
+    s->pending = realloc(s->pending, size * sizeof(s->pending[0]));
+    assert(s->pending);
+    s->size = size;
+}
+
+/*
+ * Add the worker's numbers to the sums of the interval. The intervals
+ * already handed out are closed, the late numbers go into the next one.
+ */
+static void
+sampler_add(struct sampler *s, const struct throughput_sample *sample) {
+    uint64_t interval = sample->interval;
+
+    if(!s->count && !s->taken) {
+        s->base = interval;
+    } else if(interval < s->base && !s->taken) {
+        /* Nothing is handed out yet, so the earlier intervals are fine. */
+        size_t n = s->base - interval;
+        sampler_reserve(s, n);
+        memmove(s->pending + s->head + n, s->pending + s->head,
+                s->count * sizeof(s->pending[0]));
+        for(size_t i = 0; i < n; i++) {
+            memset(&s->pending[s->head + i], 0, sizeof(s->pending[0]));
+            s->pending[s->head + i].interval = interval + i;
+        }
+        s->count += n;
+        s->base = interval;
+    } else if(interval < s->base) {
+        interval = s->base;
+    }
+
+    size_t at = interval - s->base;
+    if(at >= s->count) {
+        size_t n = at + 1 - s->count;
+        sampler_reserve(s, n);
+        for(size_t i = 0; i < n; i++) {
+            struct throughput_sample *p = &s->pending[s->head + s->count];
+            memset(p, 0, sizeof(*p));
+            p->interval = s->base + s->count;
+            s->count++;
+        }
+    }
+
+    struct throughput_sample *p = &s->pending[s->head + at];
+    for(int m = 0; m < SAMPLE_METRICS; m++) p->value[m] += sample->value[m];
+}
+
+int
+sampler_next(struct sampler *s, int running, struct throughput_sample *out) {
+    for(int i = 0; i < s->rings_count; i++) {
+        struct sample_ring *ring = &s->rings[i];
+        size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        for(size_t n = ring->head; n != tail; n++) {
+            const struct throughput_sample *sample =
+                &ring->samples[n & (ring->size - 1)];
+            sampler_add(s, sample);
+            if(ring->latest < sample->interval + 1)
+                ring->latest = sample->interval + 1;
+        }
+        __atomic_store_n(&ring->head, tail, __ATOMIC_RELEASE);
+    }
+
+    /* The intervals before the earliest one reported last are complete. */
+    uint64_t complete = UINT64_MAX;
+    for(int i = 0; i < running && i < s->rings_count; i++) {
+        uint64_t latest = s->rings[i].latest;
+        if(latest && latest < complete) complete = latest;
+    }
+
+    if(!s->count || complete == UINT64_MAX || s->base >= complete) return 0;
+
+    *out = s->pending[s->head];
+    s->head++;
+    s->count--;
+    s->base++;
+    s->taken = 1;
+    return 1;
+}
+
+#ifdef TCPKALI_SAMPLES_UNIT_TEST
+
+static struct throughput_sample
+sample(uint64_t interval, uint64_t bytes) {
+    struct throughput_sample s = {.interval = interval};
+    s.value[SM_BYTES_RCVD] = bytes;
+    s.value[SM_MSGS_SENT] = 1;
+    return s;
+}
+
+int
+main() {
+    struct sampler *s = sampler_new(3, 10);
+    struct sample_ring *r0 = sampler_ring(s, 0);
+    struct sample_ring *r1 = sampler_ring(s, 1);
+    struct throughput_sample out;
+    struct throughput_sample in;
+
+    /* Nothing reported yet. */
+    assert(sampler_next(s, 3, &out) == 0);
+
+    /* The worker 1 is ahead, the worker 2 is not reporting at all. */
+    in = sample(5, 10);
+    assert(sample_put(r0, &in) == 0);
+    in = sample(5, 20);
+    assert(sample_put(r1, &in) == 0);
+    in = sample(6, 40);
+    assert(sample_put(r1, &in) == 0);
+    assert(sampler_next(s, 3, &out) == 1);
+    assert(out.interval == 5);
+    assert(out.value[SM_BYTES_RCVD] == 30);
+    assert(out.value[SM_MSGS_SENT] == 2);
+    assert(out.value[SM_BYTES_SENT] == 0);
+    assert(sampler_next(s, 3, &out) == 0);
+
+    /* The worker 0 skips the interval 7 and reports a late interval 4. */
+    in = sample(4, 1);
+    assert(sample_put(r0, &in) == 0);
+    in = sample(8, 100);
+    assert(sample_put(r0, &in) == 0);
+    assert(sampler_next(s, 3, &out) == 1);
+    assert(out.interval == 6);
+    assert(out.value[SM_BYTES_RCVD] == 41);
+    assert(sampler_next(s, 3, &out) == 0);
+    in = sample(9, 1000);
+    assert(sample_put(r1, &in) == 0);
+    assert(sampler_next(s, 3, &out) == 1);
+    assert(out.interval == 7);
+    assert(out.value[SM_BYTES_RCVD] == 0);
+    assert(sampler_next(s, 3, &out) == 1);
+    assert(out.interval == 8);
+    assert(out.value[SM_BYTES_RCVD] == 100);
+    assert(sampler_next(s, 3, &out) == 0);
+
+    /* The worker 1 retires, so the worker 0 alone decides. */
+    in = sample(9, 5);
+    assert(sample_put(r0, &in) == 0);
+    assert(sampler_next(s, 1, &out) == 1);
+    assert(out.interval == 9);
+    assert(out.value[SM_BYTES_RCVD] == 1005);
+    assert(sampler_next(s, 1, &out) == 0);
+
+    /* The full ring takes no more. */
+    size_t put = 0;
+    for(uint64_t i = 10; i < 1000; i++) {
+        in = sample(i, i);
+        if(sample_put(r0, &in) == -1) break;
+        put++;
+    }
+    assert(put == 64);
+    uint64_t next = 10;
+    while(sampler_next(s, 1, &out)) {
+        assert(out.interval == next);
+        assert(out.value[SM_BYTES_RCVD] == next);
+        next++;
+    }
+    assert(next == 10 + put);
+    sampler_free(s);
+
+    /* The earlier intervals are fine until the first one is handed out. */
+    s = sampler_new(2, 64);
+    in = sample(3, 3);
+    assert(sample_put(sampler_ring(s, 0), &in) == 0);
+    in = sample(1, 1);
+    assert(sample_put(sampler_ring(s, 1), &in) == 0);
+    in = sample(2, 2);
+    assert(sample_put(sampler_ring(s, 1), &in) == 0);
+    assert(sampler_next(s, 2, &out) == 1);
+    assert(out.interval == 1 && out.value[SM_BYTES_RCVD] == 1);
+    assert(sampler_next(s, 2, &out) == 1);
+    assert(out.interval == 2 && out.value[SM_BYTES_RCVD] == 2);
+    assert(sampler_next(s, 2, &out) == 0);
+    sampler_free(s);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_SAMPLES_UNIT_TEST */
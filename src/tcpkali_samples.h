@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_SAMPLES_H
+#define TCPKALI_SAMPLES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The throughput per --sample-interval, to see the bursts and stalls
+ * which the 0.25s checkpoints average out.
+ *
+ * Each worker puts the traffic of every interval it has seen end into
+ * its own ring, without locks or system calls. The main thread drains
+ * the rings and sums up the workers' numbers of each interval, handing
+ * out the intervals which all the running workers are done with.
+ */
+
+enum sample_metric {
+    SM_BYTES_RCVD,
+    SM_BYTES_SENT,
+    SM_MSGS_RCVD,
+    SM_MSGS_SENT,
+    SAMPLE_METRICS
+};
+
+struct throughput_sample {
+    uint64_t interval; /* The interval number since the engine epoch */
+    uint64_t value[SAMPLE_METRICS];
+};
+
+struct sampler;
+struct sample_ring;
+
+/*
+ * Create the rings for the (workers), each holding (ring_samples)
+ * samples or a bit more.
+ */
+struct sampler *sampler_new(int workers, size_t ring_samples);
+void sampler_free(struct sampler *);
+
+/*
+ * The ring of the given worker. Only that worker may put into it.
+ */
+struct sample_ring *sampler_ring(struct sampler *, int worker);
+
+/*
+ * Copy the sample into the ring. Returns -1 if the ring is full,
+ * in which case the sample is not taken and the worker is expected
+ * to add its numbers to the next one.
+ */
+int sample_put(struct sample_ring *, const struct throughput_sample *);
+
+/*
+ * Take the next interval which the first (running) workers have all
+ * reported. The workers which have not reported anything yet are not
+ * waited for. Returns 0 if no such interval is there yet.
+ * Only one thread may call it.
+ */
+int sampler_next(struct sampler *, int running,
+                 struct throughput_sample *out);
+
+#endif /* TCPKALI_SAMPLES_H */
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "tcpkali_scan.h"
+
+/*
+ * Find the first occurrence of the needle fully contained in the data.
+ */
+static const unsigned char *
+scan_find(const unsigned char *needle, size_t needle_len,
+          const unsigned char *data, size_t size) {
+    if(needle_len > size) return NULL;
+    if(needle_len == 1) return memchr(data, needle[0], size);
+
+#ifdef __SSE2__
+    /*
+     * Compare the first and the last needle bytes against 16 haystack
+     * positions at once; only the candidates passing both are memcmp'ed.
+     */
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_len - 1]);
+    size_t i = 0;
+    for(; i + needle_len - 1 + 16 <= size; i += 16) {
+        __m128i bf = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i bl =
+            _mm_loadu_si128((const __m128i *)(data + i + needle_len - 1));
+        unsigned mask = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(bf, first), _mm_cmpeq_epi8(bl, last)));
+        while(mask) {
+            unsigned bit = __builtin_ctz(mask);
+            if(memcmp(data + i + bit + 1, needle + 1, needle_len - 2) == 0)
+                return data + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    data += i;
+    size -= i;
+#endif
+
+    return memmem(data, size, needle, needle_len);
+}
+
+size_t
+tk_scan_feed(struct StreamBMH *ctx, const struct StreamBMH_Occ *occ,
+             const unsigned char *needle, size_t needle_len,
+             const unsigned char *data, size_t size) {
+    assert(ctx->callback == NULL);
+
+    if(ctx->found == sbmh_true) return 0;
+
+    /*
+     * A needle which started in the previously fed data ends within
+     * the first (needle_len - 1) bytes. Let StreamBMH deal with it.
+     */
+    if(ctx->lookbehind_size) {
+        size_t head = size < needle_len - 1 ? size : needle_len - 1;
+        size_t analyzed =
+            sbmh_feed(ctx, (struct StreamBMH_Occ *)occ, needle, needle_len,
+                      data, head);
+        if(ctx->found == sbmh_true || head == size) return analyzed;
+        /* Partial matches in the head are rediscovered below. */
+        sbmh_reset(ctx);
+    }
+
+    const unsigned char *p = scan_find(needle, needle_len, data, size);
+    if(p) {
+        ctx->found = sbmh_true;
+        return (p - data) + needle_len;
+    }
+
+    /* Remember the tail which may be the beginning of the needle. */
+    size_t tail = size < needle_len - 1 ? size : needle_len - 1;
+    if(tail) {
+        sbmh_feed(ctx, (struct StreamBMH_Occ *)occ, needle, needle_len,
+                  data + size - tail, tail);
+        assert(ctx->found == sbmh_false);
+    }
+    return size;
+}
+
+#ifndef __SSE2__
+static unsigned
+nibble(const unsigned char c) {
+    switch(c) {
+    case '0' ... '9':
+        return (c - '0');
+    case 'a' ... 'f':
+        return (c - 'a') + 10;
+    case 'A' ... 'F':
+        return (c - 'A') + 10;
+    default:
+        return 16;
+    }
+}
+#endif
+
+int
+tk_scan_hex16(const char *src, uint64_t *value) {
+#ifdef __SSE2__
+    __m128i c = _mm_loadu_si128((const __m128i *)src);
+    __m128i lc = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                     _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+    __m128i is_alpha =
+        _mm_and_si128(_mm_cmpgt_epi8(lc, _mm_set1_epi8('a' - 1)),
+                      _mm_cmplt_epi8(lc, _mm_set1_epi8('f' + 1)));
+    if(_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) != 0xffff)
+        return 0;
+
+    /* One nibble per byte */
+    __m128i v = _mm_or_si128(
+        _mm_and_si128(is_digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+        _mm_and_si128(is_alpha, _mm_sub_epi8(lc, _mm_set1_epi8('a' - 10))));
+    /* Two nibbles per byte, most significant digit first */
+    __m128i w = _mm_or_si128(
+        _mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x00ff)), 4),
+        _mm_srli_epi16(v, 8));
+    uint64_t be;
+    _mm_storel_epi64((__m128i *)&be, _mm_packus_epi16(w, w));
+    *value = __builtin_bswap64(be);
+    return 1;
+#else
+    uint64_t acc = 0;
+    for(int i = 0; i < 16; i++) {
+        unsigned n = nibble(src[i]);
+        if(n > 15) return 0;
+        acc = (acc << 4) | n;
+    }
+    *value = acc;
+    return 1;
+#endif
+}
+
+#ifdef TCPKALI_SCAN_UNIT_TEST
+
+#include <time.h>
+
+static size_t
+feed_in_pieces(size_t (*feed)(struct StreamBMH *, const struct StreamBMH_Occ *,
+                              const unsigned char *, size_t,
+                              const unsigned char *, size_t),
+               struct StreamBMH *ctx, const struct StreamBMH_Occ *occ,
+               const unsigned char *needle, size_t nlen,
+               const unsigned char *data, size_t size, size_t piece,
+               size_t *found_at) {
+    size_t offset = 0;
+    size_t found = 0;
+    sbmh_reset(ctx);
+    while(offset < size) {
+        size_t n = size - offset < piece ? size - offset : piece;
+        size_t analyzed = feed(ctx, occ, needle, nlen, data + offset, n);
+        offset += analyzed;
+        if(ctx->found == sbmh_true) {
+            found_at[found++] = offset;
+            sbmh_reset(ctx);
+        }
+    }
+    return found;
+}
+
+static size_t
+plain_feed(struct StreamBMH *ctx, const struct StreamBMH_Occ *occ,
+           const unsigned char *needle, size_t needle_len,
+           const unsigned char *data, size_t size) {
+    return sbmh_feed(ctx, (struct StreamBMH_Occ *)occ, needle, needle_len, data,
+                     size);
+}
+
+static double
+now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main(int argc, char **argv) {
+    static unsigned char data[65536];
+    static size_t found_sbmh[sizeof(data)];
+    static size_t found_scan[sizeof(data)];
+    struct StreamBMH_Occ occ;
+    struct StreamBMH *ctx = malloc(SBMH_SIZE(64));
+    const char *needles[] = {"x", "ab", "aab", "abab", "abcab", "aaaaaaa",
+                             "TCPKALI.", "abcdefghijklmnopqrstuvwxyz0123"};
+
+    /* Streaming results must be identical to StreamBMH. */
+    srandom(1);
+    for(size_t ni = 0; ni < sizeof(needles) / sizeof(needles[0]); ni++) {
+        const unsigned char *needle = (const unsigned char *)needles[ni];
+        size_t nlen = strlen(needles[ni]);
+        sbmh_init(ctx, &occ, needle, nlen);
+        for(int round = 0; round < 50; round++) {
+            size_t size = 1 + random() % 4096;
+            int alphabet = 1 + random() % 4;
+            for(size_t i = 0; i < size; i++) data[i] = 'a' + random() % alphabet;
+            for(int k = random() % 5; k > 0; k--) {
+                size_t at = random() % size;
+                if(at + nlen <= size) memcpy(data + at, needle, nlen);
+            }
+            size_t piece = 1 + random() % 64;
+            size_t a = feed_in_pieces(plain_feed, ctx, &occ, needle, nlen, data,
+                                      size, piece, found_sbmh);
+            size_t b = feed_in_pieces(tk_scan_feed, ctx, &occ, needle, nlen,
+                                      data, size, piece, found_scan);
+            assert(a == b);
+            assert(memcmp(found_sbmh, found_scan, a * sizeof(size_t)) == 0);
+        }
+    }
+
+    uint64_t v;
+    assert(tk_scan_hex16("0123456789abcdef", &v) && v == 0x0123456789abcdefULL);
+    assert(tk_scan_hex16("FEDCBA9876543210", &v) && v == 0xFEDCBA9876543210ULL);
+    assert(tk_scan_hex16("00000000000000fF.", &v) && v == 0xff);
+    assert(!tk_scan_hex16("0123456789abcdeg", &v));
+    assert(!tk_scan_hex16("0123456789abcde.", &v));
+    assert(!tk_scan_hex16("012345678/abcdef", &v));
+    assert(!tk_scan_hex16("0123456789:bcdef", &v));
+    assert(!tk_scan_hex16("\x80\x81" "23456789abcdef", &v));
+
+    /*
+     * ./check_tcpkali_scan bench
+     * compares the throughput against the plain StreamBMH loop.
+     */
+    if(argc > 1 && strcmp(argv[1], "bench") == 0) {
+        const unsigned char *needle = (const unsigned char *)"TCPKALI.";
+        size_t nlen = strlen((const char *)needle);
+        sbmh_init(ctx, &occ, needle, nlen);
+        for(size_t i = 0; i < sizeof(data); i++) data[i] = 'a' + random() % 26;
+        for(size_t at = 0; at + 64 <= sizeof(data); at += 1024)
+            memcpy(data + at, "TCPKALI.0123456789abcdef.", 25);
+        for(int which = 0; which < 2; which++) {
+            const int rounds = 5000;
+            double start = now_seconds();
+            for(int r = 0; r < rounds; r++) {
+                feed_in_pieces(which ? tk_scan_feed : plain_feed, ctx, &occ,
+                               needle, nlen, data, sizeof(data), 16384,
+                               found_scan);
+            }
+            double elapsed = now_seconds() - start;
+            printf("%s: %.1f MB/s\n", which ? "tk_scan_feed" : "sbmh_feed",
+                   rounds * sizeof(data) / elapsed / 1e6);
+        }
+    }
+
+    free(ctx);
+    return 0;
+}
+
+#endif /* TCPKALI_SCAN_UNIT_TEST */
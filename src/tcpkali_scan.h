@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_SCAN_H
+#define TCPKALI_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <StreamBoyerMooreHorspool.h>
+
+/*
+ * Drop-in replacement for sbmh_feed().
+ *
+ * Keeps the streaming semantics of StreamBMH (a needle split across
+ * several fed buffers is still found, the return value is the number
+ * of bytes analyzed up to and including the needle), but searches
+ * the bulk of each buffer with a vectorized first/last byte filter
+ * instead of the per-byte Boyer-Moore-Horspool loop.
+ * The StreamBMH callback is not supported.
+ */
+size_t tk_scan_feed(struct StreamBMH *ctx, const struct StreamBMH_Occ *occ,
+                    const unsigned char *needle, size_t needle_len,
+                    const unsigned char *data, size_t size);
+
+/*
+ * Decode exactly 16 hexadecimal digits into a 64-bit value.
+ * Returns 0 if (src) does not contain 16 valid hexadecimal digits.
+ */
+int tk_scan_hex16(const char *src, uint64_t *value);
+
+#endif /* TCPKALI_SCAN_H */
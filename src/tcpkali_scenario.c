@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "tcpkali_scenario.h"
+
+static const char *param_names[_LPP_MAX] = {
+        [LPP_CONNECTIONS] = "connections",
+        [LPP_CONNECT_RATE] = "connect-rate",
+        [LPP_MESSAGE_RATE] = "message-rate",
+};
+
+/*
+ * phase <name> <duration> [ramp] [<parameter>=<value> ...]
+ * The (values) are the ones the previous phase ended with.
+ */
+static int
+parse_phase(struct scenario *sc, double values[_LPP_MAX], char *args,
+            const char *name, int lineno) {
+    char *phase_name = strtok(args, " \t\r");
+    char *duration_str = phase_name ? strtok(NULL, " \t\r") : NULL;
+    if(!duration_str || *phase_name == '#' || *duration_str == '#') {
+        fprintf(stderr,
+                "%s:%d: Expecting phase <name> <duration> [ramp] "
+                "[<parameter>=<value> ...]\n",
+                name, lineno);
+        return -1;
+    }
+    double duration;
+    if(load_profile_number(duration_str, 1, &duration) == -1
+       || duration <= 0) {
+        fprintf(stderr, "%s:%d: Invalid duration \"%s\"\n", name, lineno,
+                duration_str);
+        return -1;
+    }
+
+    int ramp = 0;
+    int any_set = 0;
+    double set[_LPP_MAX];
+    for(int param = 0; param < _LPP_MAX; param++) set[param] = -1;
+    for(char *tok; (tok = strtok(NULL, " \t\r"));) {
+        if(*tok == '#') break;
+        if(strcmp(tok, "ramp") == 0) {
+            ramp = 1;
+            continue;
+        }
+        char *eq = strchr(tok, '=');
+        int param = _LPP_MAX;
+        if(eq) {
+            *eq = '\0';
+            for(param = 0; param < _LPP_MAX; param++) {
+                if(strcmp(tok, param_names[param]) == 0) break;
+            }
+        }
+        if(param == _LPP_MAX) {
+            fprintf(stderr,
+                    "%s:%d: Unknown setting \"%s\", expecting ramp or "
+                    "{connections|connect-rate|message-rate}=<value>\n",
+                    name, lineno, tok);
+            return -1;
+        }
+        if(load_profile_number(eq + 1, 0, &set[param]) == -1
+           || (param == LPP_CONNECT_RATE && set[param] == 0)) {
+            fprintf(stderr, "%s:%d: Invalid %s value \"%s\"\n", name, lineno,
+                    tok, eq + 1);
+            return -1;
+        }
+        any_set = 1;
+    }
+    if(ramp && !any_set) {
+        fprintf(stderr, "%s:%d: Expecting the values to ramp to\n", name,
+                lineno);
+        return -1;
+    }
+
+    for(int param = 0; param < _LPP_MAX; param++) {
+        double to = set[param] >= 0 ? set[param] : values[param];
+        if(to < 0) continue; /* Not controlled by this test */
+        double from = ramp ? values[param] : to;
+        if(values[param] < 0 && (ramp || sc->count)) {
+            /* The profile has nothing to hold since the test start. */
+            fprintf(stderr,
+                    "%s:%d: No earlier %s value to start the phase %s from, "
+                    "set it in the first phase or on the command line\n",
+                    name, lineno, param_names[param], phase_name);
+            return -1;
+        }
+        load_profile_add_ramp(sc->profile, param, duration, from, to);
+        values[param] = to;
+    }
+
+    struct scenario_phase *phases =
+        realloc(sc->phases, (sc->count + 1) * sizeof(phases[0]));
+    assert(phases);
+    sc->phases = phases;
+    struct scenario_phase *phase = &phases[sc->count++];
+    memset(phase, 0, sizeof(*phase));
+    phase->name = strdup(phase_name);
+    phase->start = sc->duration;
+    phase->duration = duration;
+    sc->duration += duration;
+    return 0;
+}
+
+static int
+parse_line(struct scenario *sc, double values[_LPP_MAX], char *line,
+           const char *name, int lineno) {
+    line += strspn(line, " \t\r");
+    size_t keyword_len = strcspn(line, " \t\r");
+    if(keyword_len == 0 || *line == '#') return 0;
+
+    char *args = line + keyword_len;
+    if(*args) *args++ = '\0';
+
+    if(strcmp(line, "phase") == 0) {
+        return parse_phase(sc, values, args, name, lineno);
+    } else if(strcmp(line, "abort-if") == 0) {
+        if(sc->count == 0) {
+            fprintf(stderr, "%s:%d: abort-if has to follow a phase\n", name,
+                    lineno);
+            return -1;
+        }
+        char *comment = strchr(args, '#');
+        if(comment) *comment = '\0';
+        if(abort_condition_add(&sc->phases[sc->count - 1].abort_conditions,
+                               args)
+           == -1) {
+            fprintf(stderr, "%s:%d: Invalid abort-if condition\n", name,
+                    lineno);
+            return -1;
+        }
+        return 0;
+    } else {
+        fprintf(stderr,
+                "%s:%d: Unknown keyword \"%s\", expecting phase or "
+                "abort-if\n",
+                name, lineno, line);
+        return -1;
+    }
+}
+
+struct scenario *
+scenario_parse(const char *text, const char *name,
+               const double initial[_LPP_MAX]) {
+    struct scenario *sc = calloc(1, sizeof(*sc));
+    char *copy = strdup(text);
+    assert(sc && copy);
+    sc->profile = load_profile_new();
+
+    double values[_LPP_MAX];
+    memcpy(values, initial, sizeof(values));
+
+    int lineno = 1;
+    for(char *line = copy; line; lineno++) {
+        char *eol = strchr(line, '\n');
+        if(eol) *eol++ = '\0';
+        if(parse_line(sc, values, line, name, lineno) == -1) {
+            free(copy);
+            scenario_free(sc);
+            return NULL;
+        }
+        line = eol;
+    }
+    free(copy);
+
+    if(sc->count == 0) {
+        fprintf(stderr, "%s: No phases found\n", name);
+        scenario_free(sc);
+        return NULL;
+    }
+
+    return sc;
+}
+
+struct scenario *
+scenario_read(const char *filename, const double initial[_LPP_MAX]) {
+    FILE *f = fopen(filename, "r");
+    if(!f) {
+        fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+        return NULL;
+    }
+
+    size_t size = 0;
+    char *text = NULL;
+    for(;;) {
+        char *p = realloc(text, size + 4096 + 1);
+        assert(p);
+        text = p;
+        size_t got = fread(text + size, 1, 4096, f);
+        size += got;
+        if(got < 4096) break;
+    }
+    int failed = ferror(f);
+    fclose(f);
+    if(failed) {
+        fprintf(stderr, "%s: Read error\n", filename);
+        free(text);
+        return NULL;
+    }
+    text[size] = '\0';
+
+    struct scenario *sc = scenario_parse(text, filename, initial);
+    free(text);
+    return sc;
+}
+
+void
+scenario_free(struct scenario *sc) {
+    if(!sc) return;
+    for(size_t i = 0; i < sc->count; i++) {
+        free(sc->phases[i].name);
+        abort_conditions_free(&sc->phases[i].abort_conditions);
+    }
+    free(sc->phases);
+    load_profile_free(sc->profile);
+    free(sc);
+}
+
+size_t
+scenario_phase_at(const struct scenario *sc, double t) {
+    for(size_t i = 0; i < sc->count; i++) {
+        if(t < sc->phases[i].start + sc->phases[i].duration) return i;
+    }
+    return sc->count - 1;
+}
+
+#ifdef TCPKALI_SCENARIO_UNIT_TEST
+
+int
+main() {
+    const double initial[_LPP_MAX] = {[LPP_CONNECTIONS] = 10,
+                                      [LPP_CONNECT_RATE] = 100,
+                                      [LPP_MESSAGE_RATE] = -1};
+    struct scenario *sc = scenario_parse(
+        "# Comment\n"
+        "phase warmup 10s message-rate=10   # Comment\n"
+        "\n"
+        "  phase ramp 1m ramp connections=100 message-rate=1k\n"
+        "abort-if latency.p99 > 50ms for 5s\n"
+        "abort-if errors>10\n"
+        "phase steady 30s connect-rate=50\n",
+        "test", initial);
+    assert(sc);
+    assert(sc->count == 3 && sc->duration == 100);
+    assert(strcmp(sc->phases[1].name, "ramp") == 0);
+    assert(sc->phases[1].start == 10 && sc->phases[1].duration == 60);
+    assert(sc->phases[0].abort_conditions.count == 0);
+    assert(sc->phases[1].abort_conditions.count == 2);
+    assert(sc->phases[2].abort_conditions.count == 0);
+
+    assert(scenario_phase_at(sc, 0) == 0);
+    assert(scenario_phase_at(sc, 9.9) == 0);
+    assert(scenario_phase_at(sc, 10) == 1);
+    assert(scenario_phase_at(sc, 99) == 2);
+    assert(scenario_phase_at(sc, 1000) == 2);
+
+    double v;
+    assert(load_profile_value(sc->profile, LPP_CONNECTIONS, 5, &v) == 0
+           && v == 10);
+    assert(load_profile_value(sc->profile, LPP_CONNECTIONS, 40, &v) == 0
+           && v == 55);
+    assert(load_profile_value(sc->profile, LPP_CONNECTIONS, 80, &v) == 0
+           && v == 100);
+    assert(load_profile_value(sc->profile, LPP_MESSAGE_RATE, 5, &v) == 0
+           && v == 10);
+    assert(load_profile_value(sc->profile, LPP_MESSAGE_RATE, 95, &v) == 0
+           && v == 1000);
+    assert(load_profile_value(sc->profile, LPP_CONNECT_RATE, 50, &v) == 0
+           && v == 100);
+    assert(load_profile_value(sc->profile, LPP_CONNECT_RATE, 80, &v) == 0
+           && v == 50);
+    scenario_free(sc);
+
+    /* Not controlled at all. */
+    const double none[_LPP_MAX] = {-1, -1, -1};
+    sc = scenario_parse("phase idle 5s\n", "test", none);
+    assert(sc && sc->duration == 5);
+    assert(load_profile_value(sc->profile, LPP_MESSAGE_RATE, 1, &v) == -1);
+    scenario_free(sc);
+
+    fprintf(stderr, "Expecting errors:\n");
+    assert(scenario_parse("", "test", initial) == NULL);
+    assert(scenario_parse("phase\n", "test", initial) == NULL);
+    assert(scenario_parse("phase a\n", "test", initial) == NULL);
+    assert(scenario_parse("phase a 0s\n", "test", initial) == NULL);
+    assert(scenario_parse("phase a 1x\n", "test", initial) == NULL);
+    assert(scenario_parse("phase a 1s ramp\n", "test", initial) == NULL);
+    assert(scenario_parse("phase a 1s rate=1\n", "test", initial) == NULL);
+    assert(scenario_parse("phase a 1s connect-rate=0\n", "test", initial)
+           == NULL);
+    assert(scenario_parse("phase a 1s ramp message-rate=1\n", "test",
+                          initial)
+           == NULL);
+    assert(scenario_parse("phase a 1s\nphase b 1s message-rate=1\n", "test",
+                          initial)
+           == NULL);
+    assert(scenario_parse("abort-if errors>1\nphase a 1s\n", "test", initial)
+           == NULL);
+    assert(scenario_parse("phase a 1s\nabort-if errors\n", "test", initial)
+           == NULL);
+    assert(scenario_parse("connections step 1s 1\n", "test", initial)
+           == NULL);
+
+    return 0;
+}
+
+#endif /* TCPKALI_SCENARIO_UNIT_TEST */
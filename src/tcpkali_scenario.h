@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_SCENARIO_H
+#define TCPKALI_SCENARIO_H
+
+#include <stddef.h>
+
+#include "tcpkali_profile.h"
+#include "tcpkali_abort.h"
+
+/*
+ * A multi-phase test, see --scenario. The phases run back to back:
+ *
+ *     # name     duration  [ramp] [parameter=value ...]
+ *     phase warmup  30s  connections=100 message-rate=10
+ *     phase ramp    1m   ramp message-rate=1k
+ *     phase steady  5m   connections=200
+ *     abort-if latency.p99>50ms for 10s
+ *     phase spike   30s  message-rate=5k
+ *
+ * The parameters are connections, connect-rate and message-rate.
+ * A phase keeps the values it does not set from the previous phase,
+ * or from the command line. A "ramp" phase moves linearly from the
+ * previous values to the ones it sets. The abort-if lines apply to the
+ * phase above them only.
+ */
+
+struct scenario_phase {
+    char *name;
+    double start; /* Since the test start, seconds */
+    double duration;
+    struct abort_conditions abort_conditions; /* Within the phase */
+};
+
+struct scenario {
+    struct scenario_phase *phases;
+    size_t count;
+    double duration; /* Of all the phases */
+    struct load_profile *profile; /* The parameters over time */
+};
+
+/*
+ * Parse the scenario text. The (initial) values come from the command
+ * line, negative if not given. The errors are printed to stderr, prefixed
+ * by the (name). Returns NULL on error.
+ */
+struct scenario *scenario_parse(const char *text, const char *name,
+                                const double initial[_LPP_MAX]);
+
+/*
+ * Read and parse the scenario file.
+ */
+struct scenario *scenario_read(const char *filename,
+                               const double initial[_LPP_MAX]);
+
+void scenario_free(struct scenario *);
+
+/*
+ * The phase running at (t) seconds since the test start.
+ * The last phase is returned past the end.
+ */
+size_t scenario_phase_at(const struct scenario *, double t);
+
+#endif /* TCPKALI_SCENARIO_H */
@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <string.h>
+#include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "tcpkali_sha1.h"
+
+#define SHA1_BLOCK_SIZE 64
+
+static const uint32_t sha1_iv[5] = {0x67452301, 0xefcdab89, 0x98badcfe,
+                                    0x10325476, 0xc3d2e1f0};
+
+/*
+ * The number of blocks the (size) bytes take once padded.
+ */
+static size_t
+sha1_blocks(size_t size) {
+    return (size + 8) / SHA1_BLOCK_SIZE + 1;
+}
+
+/*
+ * The (n)th block of the padded data: the data, the 0x80 byte,
+ * the zeroes and, in the last block, the data size in bits.
+ */
+static void
+sha1_block(const uint8_t *data, size_t size, size_t n,
+           uint8_t block[SHA1_BLOCK_SIZE]) {
+    size_t offset = n * SHA1_BLOCK_SIZE;
+    size_t take = 0;
+
+    if(offset < size) {
+        take = size - offset;
+        if(take > SHA1_BLOCK_SIZE) take = SHA1_BLOCK_SIZE;
+        memcpy(block, data + offset, take);
+    }
+    memset(block + take, 0, SHA1_BLOCK_SIZE - take);
+    if(take < SHA1_BLOCK_SIZE && offset <= size) block[take] = 0x80;
+    if(n == sha1_blocks(size) - 1) {
+        uint64_t bits = (uint64_t)size * 8;
+        for(int i = 0; i < 8; i++) block[63 - i] = bits >> (8 * i);
+    }
+}
+
+static uint32_t
+load_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+           | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void
+store_be32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void
+sha1_compress(uint32_t h[5], const uint8_t block[SHA1_BLOCK_SIZE]) {
+    uint32_t w[16];
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+    for(int t = 0; t < 80; t++) {
+        uint32_t f, k;
+        if(t < 16) {
+            w[t] = load_be32(block + 4 * t);
+        } else {
+            uint32_t x = w[(t - 3) & 15] ^ w[(t - 8) & 15] ^ w[(t - 14) & 15]
+                         ^ w[t & 15];
+            w[t & 15] = ROL32(x, 1);
+        }
+        if(t < 20) {
+            f = d ^ (b & (c ^ d));
+            k = 0x5a827999;
+        } else if(t < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        } else if(t < 60) {
+            f = (b & c) | (d & (b | c));
+            k = 0x8f1bbcdc;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+        uint32_t temp = ROL32(a, 5) + f + e + k + w[t & 15];
+        e = d;
+        d = c;
+        c = ROL32(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+void
+tk_sha1(const void *data, size_t size, uint8_t digest[TK_SHA1_DIGEST_SIZE]) {
+    uint32_t h[5];
+    uint8_t block[SHA1_BLOCK_SIZE];
+
+    memcpy(h, sha1_iv, sizeof(h));
+    for(size_t n = 0; n < sha1_blocks(size); n++) {
+        sha1_block(data, size, n, block);
+        sha1_compress(h, block);
+    }
+    for(int i = 0; i < 5; i++) store_be32(digest + 4 * i, h[i]);
+}
+
+#ifdef __SSE2__
+
+#define SHA1_LANES 4
+
+#define VROL(x, n) \
+    _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+
+/*
+ * Compress a block in each of the lanes. The lanes which are done
+ * with their data, as told by the (active) mask, keep their state.
+ */
+static void
+sha1_compress_x4(__m128i h[5], uint8_t blocks[SHA1_LANES][SHA1_BLOCK_SIZE],
+                 __m128i active) {
+    __m128i w[16];
+    __m128i a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+    for(int t = 0; t < 80; t++) {
+        __m128i f, k;
+        if(t < 16) {
+            w[t] = _mm_set_epi32(load_be32(blocks[3] + 4 * t),
+                                 load_be32(blocks[2] + 4 * t),
+                                 load_be32(blocks[1] + 4 * t),
+                                 load_be32(blocks[0] + 4 * t));
+        } else {
+            __m128i x = _mm_xor_si128(
+                _mm_xor_si128(w[(t - 3) & 15], w[(t - 8) & 15]),
+                _mm_xor_si128(w[(t - 14) & 15], w[t & 15]));
+            w[t & 15] = VROL(x, 1);
+        }
+        if(t < 20) {
+            f = _mm_xor_si128(d, _mm_and_si128(b, _mm_xor_si128(c, d)));
+            k = _mm_set1_epi32(0x5a827999);
+        } else if(t < 40) {
+            f = _mm_xor_si128(_mm_xor_si128(b, c), d);
+            k = _mm_set1_epi32(0x6ed9eba1);
+        } else if(t < 60) {
+            f = _mm_or_si128(_mm_and_si128(b, c),
+                             _mm_and_si128(d, _mm_or_si128(b, c)));
+            k = _mm_set1_epi32(0x8f1bbcdc);
+        } else {
+            f = _mm_xor_si128(_mm_xor_si128(b, c), d);
+            k = _mm_set1_epi32(0xca62c1d6);
+        }
+        __m128i temp = _mm_add_epi32(
+            _mm_add_epi32(VROL(a, 5), f),
+            _mm_add_epi32(_mm_add_epi32(e, k), w[t & 15]));
+        e = d;
+        d = c;
+        c = VROL(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    h[0] = _mm_add_epi32(h[0], _mm_and_si128(a, active));
+    h[1] = _mm_add_epi32(h[1], _mm_and_si128(b, active));
+    h[2] = _mm_add_epi32(h[2], _mm_and_si128(c, active));
+    h[3] = _mm_add_epi32(h[3], _mm_and_si128(d, active));
+    h[4] = _mm_add_epi32(h[4], _mm_and_si128(e, active));
+}
+
+/*
+ * Up to four buffers at once. The missing lanes repeat the first buffer.
+ */
+static void
+sha1_x4(const void *const data[], const size_t sizes[],
+        uint8_t (*digests)[TK_SHA1_DIGEST_SIZE], size_t n) {
+    uint8_t blocks[SHA1_LANES][SHA1_BLOCK_SIZE];
+    size_t lane_blocks[SHA1_LANES];
+    size_t max_blocks = 0;
+    __m128i h[5];
+
+    assert(n > 0 && n <= SHA1_LANES);
+    for(size_t l = 0; l < SHA1_LANES; l++) {
+        lane_blocks[l] = sha1_blocks(sizes[l < n ? l : 0]);
+        if(max_blocks < lane_blocks[l]) max_blocks = lane_blocks[l];
+    }
+    for(int i = 0; i < 5; i++) h[i] = _mm_set1_epi32(sha1_iv[i]);
+
+    for(size_t b = 0; b < max_blocks; b++) {
+        uint32_t active[SHA1_LANES];
+        for(size_t l = 0; l < SHA1_LANES; l++) {
+            size_t i = l < n ? l : 0;
+            active[l] = b < lane_blocks[l] ? 0xffffffff : 0;
+            if(active[l])
+                sha1_block(data[i], sizes[i], b, blocks[l]);
+            else
+                memset(blocks[l], 0, SHA1_BLOCK_SIZE);
+        }
+        sha1_compress_x4(h, blocks,
+                         _mm_loadu_si128((const __m128i *)active));
+    }
+
+    for(int i = 0; i < 5; i++) {
+        uint32_t v[SHA1_LANES];
+        _mm_storeu_si128((__m128i *)v, h[i]);
+        for(size_t l = 0; l < n; l++) store_be32(digests[l] + 4 * i, v[l]);
+    }
+}
+
+#endif /* __SSE2__ */
+
+void
+tk_sha1_multi(const void *const data[], const size_t sizes[],
+              uint8_t (*digests)[TK_SHA1_DIGEST_SIZE], size_t n) {
+#ifdef __SSE2__
+    for(size_t i = 0; i < n; i += SHA1_LANES) {
+        size_t group = n - i < SHA1_LANES ? n - i : SHA1_LANES;
+        if(group == 1)
+            tk_sha1(data[i], sizes[i], digests[i]);
+        else
+            sha1_x4(data + i, sizes + i, digests + i, group);
+    }
+#else
+    for(size_t i = 0; i < n; i++) tk_sha1(data[i], sizes[i], digests[i]);
+#endif
+}
+
+#ifdef TCPKALI_SHA1_UNIT_TEST
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static void
+check_digest(const char *data, const char *hex) {
+    uint8_t digest[TK_SHA1_DIGEST_SIZE];
+    char out[2 * TK_SHA1_DIGEST_SIZE + 1];
+
+    tk_sha1(data, strlen(data), digest);
+    for(int i = 0; i < TK_SHA1_DIGEST_SIZE; i++)
+        snprintf(out + 2 * i, 3, "%02x", digest[i]);
+    if(strcmp(out, hex) != 0) {
+        fprintf(stderr, "SHA-1(\"%s\") = %s, expected %s\n", data, out, hex);
+        assert(!"Unexpected digest");
+    }
+}
+
+int
+main() {
+    check_digest("", "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    check_digest("abc", "a9993e364706816aba3e25717850c26c9cd0d89d");
+    check_digest("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+                 "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+
+    /* The buffers hashed together match the ones hashed one by one. */
+    static uint8_t data[9][200];
+    for(size_t i = 0; i < sizeof(data); i++) ((uint8_t *)data)[i] = random();
+    for(size_t n = 1; n <= 9; n++) {
+        for(int round = 0; round < 100; round++) {
+            const void *ptrs[9];
+            size_t sizes[9];
+            uint8_t digests[9][TK_SHA1_DIGEST_SIZE];
+            uint8_t expected[TK_SHA1_DIGEST_SIZE];
+            for(size_t i = 0; i < n; i++) {
+                ptrs[i] = data[i];
+                sizes[i] = random() % (sizeof(data[i]) + 1);
+            }
+            tk_sha1_multi(ptrs, sizes, digests, n);
+            for(size_t i = 0; i < n; i++) {
+                tk_sha1(ptrs[i], sizes[i], expected);
+                assert(memcmp(digests[i], expected, sizeof(expected)) == 0);
+            }
+        }
+    }
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_SHA1_UNIT_TEST */
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_SHA1_H
+#define TCPKALI_SHA1_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TK_SHA1_DIGEST_SIZE 20
+
+/*
+ * SHA-1 of a single buffer.
+ */
+void tk_sha1(const void *data, size_t size,
+             uint8_t digest[TK_SHA1_DIGEST_SIZE]);
+
+/*
+ * SHA-1 of (n) independent buffers of any sizes. With SSE2, the buffers
+ * are hashed four at a time, one per 32-bit vector lane, which is about
+ * as fast as hashing a single buffer.
+ */
+void tk_sha1_multi(const void *const data[], const size_t sizes[],
+                   uint8_t (*digests)[TK_SHA1_DIGEST_SIZE], size_t n);
+
+#endif /* TCPKALI_SHA1_H */
@@ -0,0 +1,505 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <assert.h>
+#include <sysexits.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <hdr_histogram.h>
+
+#include "tcpkali_shm.h"
+
+#define SHM_STATS_MAGIC 0x31734b6c616b7074ULL /* "tpkalKs1" */
+#define SHM_STATS_SLOTS 32
+/* The engine histograms, as with --processes; larger ones are not shared. */
+#define SHM_HISTOGRAM_MAX (256 * 1024)
+
+enum {
+    SH_CONNECT,
+    SH_FIRSTBYTE,
+    SH_MARKER,
+    SH_MAX
+};
+
+static const char *shm_histogram_names[SH_MAX] = {"connect", "first byte",
+                                                  "marker"};
+
+struct shm_stats_slot {
+    volatile uint32_t seq; /* Odd while the slot is being written */
+    volatile pid_t pid;    /* 0 if the slot is free */
+    non_atomic_traffic_stats traffic;
+    size_t connecting;
+    size_t conns_in;
+    size_t conns_out;
+    double units_per_second; /* Of the latency histograms */
+    size_t histogram_size[SH_MAX]; /* 0 if not published */
+    int64_t histograms[SH_MAX][SHM_HISTOGRAM_MAX / sizeof(int64_t)];
+};
+
+struct shm_stats_segment {
+    volatile uint64_t magic;
+    uint32_t slots;
+    uint32_t slot_size;
+    struct shm_stats_slot slot[SHM_STATS_SLOTS];
+};
+
+struct shm_stats {
+    char *name;
+    struct shm_stats_segment *segment;
+    struct shm_stats_slot *slot;
+};
+
+static char *
+shm_stats_path(const char *name) {
+    char *path = malloc(strlen(name) + sizeof("/tcpkali-"));
+    assert(path);
+    sprintf(path, "/tcpkali-%s", name);
+    return path;
+}
+
+/*
+ * Map the named segment, creating it if (create).
+ */
+static struct shm_stats_segment *
+shm_stats_map(const char *path, int create) {
+    int fd = shm_open(path, create ? O_RDWR | O_CREAT : O_RDONLY, 0600);
+    if(fd == -1) return NULL;
+
+    struct stat st;
+    if(fstat(fd, &st) == -1) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return NULL;
+    }
+    if(st.st_size == 0 && create
+       && ftruncate(fd, sizeof(struct shm_stats_segment)) == -1) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return NULL;
+    } else if(st.st_size && st.st_size != sizeof(struct shm_stats_segment)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct shm_stats_segment *seg = mmap(
+        NULL, sizeof(*seg), create ? PROT_READ | PROT_WRITE : PROT_READ,
+        MAP_SHARED, fd, 0);
+    close(fd);
+    if(seg == MAP_FAILED) return NULL;
+
+    if(create && seg->magic == 0) {
+        seg->slots = SHM_STATS_SLOTS;
+        seg->slot_size = sizeof(struct shm_stats_slot);
+        __sync_bool_compare_and_swap(&seg->magic, 0, SHM_STATS_MAGIC);
+    }
+    /* An instance may be setting the segment up just now. */
+    if(seg->magic != SHM_STATS_MAGIC && (create || seg->magic)) {
+        munmap(seg, sizeof(*seg));
+        errno = EINVAL;
+        return NULL;
+    }
+    if(seg->magic == SHM_STATS_MAGIC
+       && (seg->slots != SHM_STATS_SLOTS
+           || seg->slot_size != sizeof(struct shm_stats_slot))) {
+        munmap(seg, sizeof(*seg));
+        errno = EINVAL;
+        return NULL;
+    }
+    return seg;
+}
+
+static int
+pid_alive(pid_t pid) {
+    return pid && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+static int
+slot_alive(const struct shm_stats_slot *slot) {
+    return pid_alive(slot->pid);
+}
+
+struct shm_stats *
+shm_stats_open(const char *name) {
+    if(!*name || strchr(name, '/')) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    char *path = shm_stats_path(name);
+    struct shm_stats_segment *seg = shm_stats_map(path, 1);
+    if(!seg) {
+        int err = errno;
+        free(path);
+        errno = err;
+        return NULL;
+    }
+
+    /* Take a free slot, or the one of a process which is gone. */
+    pid_t self = getpid();
+    for(int i = 0; i < SHM_STATS_SLOTS; i++) {
+        struct shm_stats_slot *slot = &seg->slot[i];
+        pid_t pid = slot->pid;
+        if(pid_alive(pid)) continue;
+        if(!__sync_bool_compare_and_swap(&slot->pid, pid, self)) continue;
+
+        /* The one gone might have died in the middle of a write. */
+        if(slot->seq & 1) slot->seq++;
+        slot->seq++;
+        __sync_synchronize();
+        memset(&slot->traffic, 0, sizeof(slot->traffic));
+        slot->connecting = slot->conns_in = slot->conns_out = 0;
+        memset(slot->histogram_size, 0, sizeof(slot->histogram_size));
+        __sync_synchronize();
+        slot->seq++;
+
+        struct shm_stats *shm = calloc(1, sizeof(*shm));
+        assert(shm);
+        shm->name = path;
+        shm->segment = seg;
+        shm->slot = slot;
+        return shm;
+    }
+
+    munmap(seg, sizeof(*seg));
+    free(path);
+    errno = ENOSPC;
+    return NULL;
+}
+
+void
+shm_stats_publish(struct shm_stats *shm,
+                  const non_atomic_traffic_stats *traffic, size_t connecting,
+                  size_t conns_in, size_t conns_out,
+                  const struct latency_snapshot *latency) {
+    struct shm_stats_slot *slot = shm->slot;
+    struct hdr_histogram *hists[SH_MAX] = {
+        latency ? latency->connect_histogram : NULL,
+        latency ? latency->firstbyte_histogram : NULL,
+        latency ? latency->marker_histogram : NULL};
+
+    slot->seq++;
+    __sync_synchronize();
+    slot->traffic = *traffic;
+    slot->connecting = connecting;
+    slot->conns_in = conns_in;
+    slot->conns_out = conns_out;
+    slot->units_per_second = latency_units_per_second;
+    for(int kind = 0; kind < SH_MAX; kind++) {
+        size_t size = hists[kind] ? hdr_get_memory_size(hists[kind]) : 0;
+        if(size > sizeof(slot->histograms[kind])) size = 0;
+        memcpy(slot->histograms[kind], hists[kind], size);
+        slot->histogram_size[kind] = size;
+    }
+    __sync_synchronize();
+    slot->seq++;
+}
+
+void
+shm_stats_close(struct shm_stats *shm) {
+    if(!shm) return;
+
+    shm->slot->pid = 0;
+    __sync_synchronize();
+    int others = 0;
+    for(int i = 0; i < SHM_STATS_SLOTS; i++)
+        others += slot_alive(&shm->segment->slot[i]);
+    if(!others) shm_unlink(shm->name);
+
+    munmap(shm->segment, sizeof(*shm->segment));
+    free(shm->name);
+    free(shm);
+}
+
+/*
+ * The viewer's copy of a slot and what has been counted of it so far.
+ */
+struct shm_view_slot {
+    pid_t pid;
+    non_atomic_traffic_stats traffic;
+    size_t connecting;
+    size_t conns_in;
+    size_t conns_out;
+    double units_per_second;
+    struct hdr_histogram *histograms[SH_MAX];
+};
+
+/*
+ * Copy the slot, unless it is free or keeps being written.
+ * The (hists) are the buffers of SHM_HISTOGRAM_MAX bytes.
+ */
+static int
+shm_read_slot(const struct shm_stats_slot *slot, struct shm_view_slot *copy,
+              struct hdr_histogram **hists) {
+    for(int attempt = 0; attempt < 100; attempt++) {
+        uint32_t seq = slot->seq;
+        if(seq & 1) {
+            usleep(100);
+            continue;
+        }
+        __sync_synchronize();
+        if(!slot_alive(slot)) return 0;
+        copy->pid = slot->pid;
+        copy->traffic = slot->traffic;
+        copy->connecting = slot->connecting;
+        copy->conns_in = slot->conns_in;
+        copy->conns_out = slot->conns_out;
+        copy->units_per_second = slot->units_per_second;
+        for(int kind = 0; kind < SH_MAX; kind++) {
+            size_t size = slot->histogram_size[kind];
+            if(size > SHM_HISTOGRAM_MAX) size = 0;
+            memcpy(hists[kind], slot->histograms[kind], size);
+            copy->histograms[kind] = size ? hists[kind] : NULL;
+        }
+        __sync_synchronize();
+        if(slot->seq == seq) return 1;
+    }
+    return 0;
+}
+
+/*
+ * Record the (src) histogram counting in (units_per_second)
+ * into the nanosecond (dst).
+ */
+static void
+add_histogram_ns(struct hdr_histogram *dst, struct hdr_histogram *src,
+                 double units_per_second) {
+    double scale = 1e9 / units_per_second;
+    struct hdr_iter iter;
+    hdr_iter_recorded_init(&iter, src);
+    while(hdr_iter_next(&iter)) {
+        hdr_record_values(dst, (int64_t)(iter.value_from_index * scale),
+                          iter.count_at_index);
+    }
+}
+
+static struct hdr_histogram *
+new_histogram_ns(void) {
+    struct hdr_histogram *h;
+    /* 1ns up to 100s. */
+    int ret = hdr_init(1, 100 * 1000000000LL, LATENCY_SIGNIFICANT_FIGURES, &h);
+    assert(ret == 0);
+    return h;
+}
+
+static volatile sig_atomic_t aggregate_term_flag;
+
+static void
+aggregate_term(int sig) {
+    (void)sig;
+    aggregate_term_flag = 1;
+}
+
+/*
+ * The first of the marker, first byte and connect latencies measured.
+ */
+static void
+print_latency(struct hdr_histogram **hists) {
+    for(int kind = SH_MAX - 1; kind >= 0; kind--) {
+        if(!hists[kind]->total_count) continue;
+        printf(", %s latency %.3f/%.3f/%.3f ms", shm_histogram_names[kind],
+               hdr_value_at_percentile(hists[kind], 50.0) / 1e6,
+               hdr_value_at_percentile(hists[kind], 95.0) / 1e6,
+               hdr_value_at_percentile(hists[kind], 99.0) / 1e6);
+        break;
+    }
+}
+
+static void
+print_traffic(const non_atomic_traffic_stats *t, double elapsed) {
+    printf("%.3f↓, %.3f↑ Mbps, %.0f↓, %.0f↑ mps",
+           8 * t->bytes_rcvd / elapsed / 1e6, 8 * t->bytes_sent / elapsed / 1e6,
+           t->msgs_rcvd / elapsed, t->msgs_sent / elapsed);
+}
+
+int
+shm_stats_aggregate(const char *name) {
+    if(!*name || strchr(name, '/')) {
+        fprintf(stderr, "--aggregate %s: Not a valid segment name\n", name);
+        return EX_USAGE;
+    }
+    char *path = shm_stats_path(name);
+
+    struct sigaction act;
+    memset(&act, 0, sizeof(act));
+    act.sa_handler = aggregate_term;
+    sigemptyset(&act.sa_mask);
+    sigaction(SIGINT, &act, NULL);
+    sigaction(SIGTERM, &act, NULL);
+
+    struct shm_view_slot *seen = calloc(SHM_STATS_SLOTS, sizeof(*seen));
+    assert(seen);
+    struct hdr_histogram *buffers[SH_MAX];
+    struct hdr_histogram *interval[SH_MAX];
+    struct hdr_histogram *total[SH_MAX];
+    for(int kind = 0; kind < SH_MAX; kind++) {
+        buffers[kind] = malloc(SHM_HISTOGRAM_MAX);
+        assert(buffers[kind]);
+        interval[kind] = new_histogram_ns();
+        total[kind] = new_histogram_ns();
+    }
+    non_atomic_traffic_stats total_traffic;
+    memset(&total_traffic, 0, sizeof(total_traffic));
+    struct timespec start, last;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    last = start;
+
+    struct shm_stats_segment *seg = NULL;
+    int waiting = 0;
+    while(!aggregate_term_flag) {
+        struct timespec pause = {1, 0};
+        nanosleep(&pause, NULL);
+        if(aggregate_term_flag) break;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double elapsed = (now.tv_sec - last.tv_sec)
+                         + (now.tv_nsec - last.tv_nsec) / 1e9;
+        last = now;
+
+        if(!seg) seg = shm_stats_map(path, 0);
+        if(!seg) {
+            if(errno != ENOENT) {
+                fprintf(stderr, "--aggregate %s: %s\n", name,
+                        errno == EINVAL ? "Not a --shm-stats segment"
+                                        : strerror(errno));
+                break;
+            }
+            if(!waiting++)
+                fprintf(stderr, "Waiting for the --shm-stats %s instances\n",
+                        name);
+            continue;
+        }
+
+        non_atomic_traffic_stats traffic;
+        memset(&traffic, 0, sizeof(traffic));
+        size_t instances = 0, connecting = 0, conns_in = 0, conns_out = 0;
+        for(int kind = 0; kind < SH_MAX; kind++) hdr_reset(interval[kind]);
+
+        for(int i = 0; i < SHM_STATS_SLOTS; i++) {
+            struct shm_view_slot *prev = &seen[i];
+            struct shm_view_slot cur = {.pid = 0};
+            if(!shm_read_slot(&seg->slot[i], &cur, buffers)) {
+                prev->pid = 0;
+                continue;
+            }
+            instances++;
+            connecting += cur.connecting;
+            conns_in += cur.conns_in;
+            conns_out += cur.conns_out;
+
+            /* A new instance is counted from the next second on. */
+            int counted = prev->pid == cur.pid;
+            if(counted) {
+                non_atomic_traffic_stats delta =
+                    subtract_traffic_stats(cur.traffic, prev->traffic);
+                add_traffic_numbers_NtoN(&delta, &traffic);
+            }
+            prev->pid = cur.pid;
+            prev->traffic = cur.traffic;
+            prev->connecting = cur.connecting;
+            prev->conns_in = cur.conns_in;
+            prev->conns_out = cur.conns_out;
+
+            for(int kind = 0; kind < SH_MAX; kind++) {
+                struct hdr_histogram *h = cur.histograms[kind];
+                struct hdr_histogram *p = prev->histograms[kind];
+                if(!h) continue;
+                /* Compare against the previous copy, unless reset since. */
+                size_t size = hdr_get_memory_size(h);
+                if(counted && p && hdr_get_memory_size(p) == size
+                   && prev->units_per_second == cur.units_per_second
+                   && h->total_count >= p->total_count) {
+                    struct hdr_histogram *next = malloc(size);
+                    assert(next);
+                    memcpy(next, h, size);
+                    hdr_subtract(h, p);
+                    add_histogram_ns(interval[kind], h, cur.units_per_second);
+                    free(p);
+                    prev->histograms[kind] = next;
+                } else {
+                    free(p);
+                    prev->histograms[kind] = malloc(size);
+                    assert(prev->histograms[kind]);
+                    memcpy(prev->histograms[kind], h, size);
+                }
+            }
+            prev->units_per_second = cur.units_per_second;
+        }
+
+        if(!instances) {
+            /* The segment is gone with the last instance; start over. */
+            munmap(seg, sizeof(*seg));
+            seg = NULL;
+            continue;
+        }
+
+        add_traffic_numbers_NtoN(&traffic, &total_traffic);
+        for(int kind = 0; kind < SH_MAX; kind++)
+            hdr_add(total[kind], interval[kind]);
+
+        printf("%zu instance%s, %zu connections (%zu in, %zu out, "
+               "%zu connecting), ",
+               instances, instances == 1 ? "" : "s", conns_in + conns_out,
+               conns_in, conns_out, connecting);
+        print_traffic(&traffic, elapsed);
+        print_latency(interval);
+        printf("\n");
+        fflush(stdout);
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed =
+        (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+    printf("Total: ");
+    print_traffic(&total_traffic, elapsed);
+    print_latency(total);
+    printf("\n");
+
+    if(seg) munmap(seg, sizeof(*seg));
+    for(int i = 0; i < SHM_STATS_SLOTS; i++)
+        for(int kind = 0; kind < SH_MAX; kind++)
+            free(seen[i].histograms[kind]);
+    for(int kind = 0; kind < SH_MAX; kind++) {
+        free(buffers[kind]);
+        free(interval[kind]);
+        free(total[kind]);
+    }
+    free(seen);
+    free(path);
+    return 0;
+}
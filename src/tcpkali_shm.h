@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_SHM_H
+#define TCPKALI_SHM_H
+
+#include "tcpkali_engine.h"
+
+/*
+ * --shm-stats: the tcpkali instances running on the same host publish
+ * their numbers into a named shared memory segment, one slot each.
+ * The --aggregate viewer merges the slots into host-wide totals,
+ * with the latency percentiles computed from the merged histograms.
+ *
+ * The segment is /dev/shm/tcpkali-<name>, created by the first instance
+ * and removed by the last one to leave. An instance only writes
+ * into its own slot; the viewer retries the reads which overlapped
+ * with the writes (a sequence lock), so neither waits for the other.
+ */
+struct shm_stats;
+
+/*
+ * Take a slot in the named segment, creating the segment if needed.
+ * Returns NULL and sets errno on failure: EINVAL if the segment is not
+ * a tcpkali one, ENOSPC if all of its slots are taken.
+ */
+struct shm_stats *shm_stats_open(const char *name);
+
+/*
+ * Publish the numbers since the start of the test:
+ * the (traffic), the current connections and the (latency) histograms.
+ */
+void shm_stats_publish(struct shm_stats *, const non_atomic_traffic_stats *,
+                       size_t connecting, size_t conns_in, size_t conns_out,
+                       const struct latency_snapshot *);
+
+/*
+ * Leave the slot, removing the segment if no other instance is left.
+ */
+void shm_stats_close(struct shm_stats *);
+
+/*
+ * The --aggregate viewer: print the merged numbers of the instances
+ * every second, and their totals once interrupted. Returns the exit code.
+ */
+int shm_stats_aggregate(const char *name);
+
+#endif /* TCPKALI_SHM_H */
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <assert.h>
+
+#include "tcpkali_spsc.h"
+
+void
+spsc_ring_init(struct spsc_ring *ring, size_t size) {
+    size_t pow2 = 64;
+    while(pow2 < size) pow2 <<= 1;
+    memset(ring, 0, sizeof(*ring));
+    ring->size = pow2;
+    ring->buf = malloc(pow2);
+    assert(ring->buf);
+}
+
+void
+spsc_ring_free(struct spsc_ring *ring) {
+    free(ring->buf);
+    ring->buf = NULL;
+}
+
+void
+spsc_ring_copy_in(struct spsc_ring *ring, size_t offset, const void *data,
+                  size_t size) {
+    size_t at = offset & (ring->size - 1);
+    size_t first = ring->size - at;
+    if(first > size) first = size;
+    memcpy(ring->buf + at, data, first);
+    memcpy(ring->buf, (const uint8_t *)data + first, size - first);
+}
+
+void
+spsc_ring_copy_out(const struct spsc_ring *ring, size_t offset, void *data,
+                   size_t size) {
+    size_t at = offset & (ring->size - 1);
+    size_t first = ring->size - at;
+    if(first > size) first = size;
+    memcpy(data, ring->buf + at, first);
+    memcpy((uint8_t *)data + first, ring->buf, size - first);
+}
+
+int
+spsc_ring_append(struct spsc_ring *ring, const void *hdr, size_t hdr_size,
+                 const void *data, size_t data_size) {
+    size_t tail = ring->tail;
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if(hdr_size + data_size > ring->size - (tail - head)) return -1;
+
+    spsc_ring_copy_in(ring, tail, hdr, hdr_size);
+    tail += hdr_size;
+    if(data_size) {
+        spsc_ring_copy_in(ring, tail, data, data_size);
+        tail += data_size;
+    }
+
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static void *
+spsc_writer_thread(void *arg) {
+    struct spsc_writer *w = arg;
+    int quiet = 0;
+
+    for(;;) {
+        int terminate = __atomic_load_n(&w->terminate, __ATOMIC_ACQUIRE);
+        size_t done = w->drain(w->arg, terminate);
+        if(terminate) break;
+
+        if(done) {
+            quiet = 0;
+        } else if(w->quiet_polls == 0 || quiet++ < w->quiet_polls) {
+            struct timespec ts = {0, w->poll_ns};
+            nanosleep(&ts, NULL);
+        } else {
+            pthread_mutex_lock(&w->lock);
+            __atomic_store_n(&w->idle, 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if(w->drain(w->arg, 0) == 0
+               && !__atomic_load_n(&w->terminate, __ATOMIC_ACQUIRE))
+                pthread_cond_wait(&w->wakeup, &w->lock);
+            __atomic_store_n(&w->idle, 0, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&w->lock);
+            quiet = 0;
+        }
+    }
+
+    return NULL;
+}
+
+void
+spsc_writer_start(struct spsc_writer *w, spsc_drain_f *drain, void *arg,
+                  long poll_ns, int quiet_polls) {
+    memset(w, 0, sizeof(*w));
+    w->drain = drain;
+    w->arg = arg;
+    w->poll_ns = poll_ns;
+    w->quiet_polls = quiet_polls;
+
+    int rc = pthread_mutex_init(&w->lock, NULL);
+    assert(rc == 0);
+    rc = pthread_cond_init(&w->wakeup, NULL);
+    assert(rc == 0);
+    rc = pthread_create(&w->thread, NULL, spsc_writer_thread, w);
+    assert(rc == 0);
+}
+
+void
+spsc_writer_wake(struct spsc_writer *w) {
+    pthread_mutex_lock(&w->lock);
+    pthread_cond_signal(&w->wakeup);
+    pthread_mutex_unlock(&w->lock);
+}
+
+void
+spsc_writer_stop(struct spsc_writer *w) {
+    pthread_mutex_lock(&w->lock);
+    __atomic_store_n(&w->terminate, 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&w->wakeup);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    pthread_cond_destroy(&w->wakeup);
+    pthread_mutex_destroy(&w->lock);
+}
+
+#ifdef TCPKALI_SPSC_UNIT_TEST
+
+struct test_rings {
+    struct spsc_ring ring;
+    size_t records;
+    size_t bytes;
+};
+
+static size_t
+test_drain(void *arg, int terminate) {
+    struct test_rings *t = arg;
+    size_t tail = spsc_ring_tail(&t->ring);
+    size_t head = t->ring.head;
+    size_t start = head;
+    (void)terminate;
+
+    while(head != tail) {
+        uint32_t size;
+        spsc_ring_copy_out(&t->ring, head, &size, sizeof(size));
+        head += sizeof(size);
+        for(uint32_t i = 0; i < size; i++) {
+            uint8_t c;
+            spsc_ring_copy_out(&t->ring, head + i, &c, 1);
+            assert(c == (uint8_t)size);
+        }
+        head += size;
+        t->records++;
+        t->bytes += size;
+    }
+    spsc_ring_consume(&t->ring, head);
+    return tail - start;
+}
+
+int
+main() {
+    struct test_rings t = {.records = 0};
+    spsc_ring_init(&t.ring, 100);
+    assert(t.ring.size == 128);
+
+    struct spsc_writer w;
+    spsc_writer_start(&w, test_drain, &t, 1000000, 3);
+
+    /* Wrap around the ring many times while the writer drains it. */
+    uint8_t data[60];
+    size_t appended = 0;
+    size_t bytes = 0;
+    for(int i = 0; i < 100000; i++) {
+        uint32_t size = 1 + i % 50;
+        memset(data, (uint8_t)size, size);
+        if(spsc_ring_append(&t.ring, &size, sizeof(size), data, size) == 0) {
+            appended++;
+            bytes += size;
+            spsc_writer_notify(&w);
+        } else {
+            t.ring.dropped++;
+        }
+    }
+    /* A record larger than the ring never fits. */
+    uint32_t huge = 200;
+    assert(spsc_ring_append(&t.ring, &huge, sizeof(huge), data, huge) == -1);
+
+    /* Woken up from its sleep once it is idle. */
+    struct timespec ts = {0, 50000000};
+    nanosleep(&ts, NULL);
+    uint32_t size = 5;
+    memset(data, 5, size);
+    assert(spsc_ring_append(&t.ring, &size, sizeof(size), data, size) == 0);
+    spsc_writer_notify(&w);
+    while(__atomic_load_n(&t.ring.head, __ATOMIC_ACQUIRE) != t.ring.tail) {
+        struct timespec poll = {0, 1000000};
+        nanosleep(&poll, NULL);
+    }
+
+    spsc_writer_stop(&w);
+    assert(t.records == appended + 1);
+    assert(t.bytes == bytes + 5);
+    assert(t.ring.dropped + appended == 100000);
+    spsc_ring_free(&t.ring);
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* TCPKALI_SPSC_UNIT_TEST */
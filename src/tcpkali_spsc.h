@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_SPSC_H
+#define TCPKALI_SPSC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * The rings the workers hand their records over to a background thread
+ * with, see --record, --per-connection-stats, the log pipe and the closer.
+ *
+ * Each ring has a single producer, the worker, which appends without
+ * locks or system calls, and a single consumer, the writer thread.
+ * The (head) and (tail) are free-running byte offsets; the records
+ * wrap around the end of the buffer.
+ */
+struct spsc_ring {
+    /* Written by the producer. */
+    size_t tail __attribute__((aligned(64)));
+    size_t dropped; /* Counted by the producer in its own units */
+    /* Written by the consumer. */
+    size_t head __attribute__((aligned(64)));
+    /* Read-only. */
+    uint8_t *buf __attribute__((aligned(64)));
+    size_t size; /* Power of 2 */
+};
+
+/*
+ * Allocate the buffer of at least (size) bytes, rounded up to a power of 2.
+ */
+void spsc_ring_init(struct spsc_ring *, size_t size);
+void spsc_ring_free(struct spsc_ring *);
+
+/*
+ * Copy the (size) bytes from or to the ring at the free-running (offset).
+ */
+void spsc_ring_copy_in(struct spsc_ring *, size_t offset, const void *,
+                       size_t size);
+void spsc_ring_copy_out(const struct spsc_ring *, size_t offset, void *,
+                        size_t size);
+
+/*
+ * Append the header and the data following it as one record.
+ * Returns -1 if the record does not fit, leaving it to the caller
+ * to count what is dropped.
+ */
+int spsc_ring_append(struct spsc_ring *, const void *hdr, size_t hdr_size,
+                     const void *data, size_t data_size);
+
+/*
+ * The consumer side: find out where the records end, and give the space
+ * up to the new (head) back to the producer.
+ */
+static inline size_t __attribute__((unused))
+spsc_ring_tail(const struct spsc_ring *ring) {
+    return __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+static inline void __attribute__((unused))
+spsc_ring_consume(struct spsc_ring *ring, size_t head) {
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+}
+
+/*
+ * The bytes at the (offset) up to the end of the data or of the buffer,
+ * whichever comes first.
+ */
+static inline const uint8_t *__attribute__((unused))
+spsc_ring_contiguous(const struct spsc_ring *ring, size_t offset,
+                     size_t tail, size_t *size) {
+    size_t at = offset & (ring->size - 1);
+    *size = ring->size - at;
+    if(*size > tail - offset) *size = tail - offset;
+    return ring->buf + at;
+}
+
+/*
+ * The writer thread draining the rings. The (drain) callback goes through
+ * all of them and returns the amount of work done, or 0 if there was none.
+ * Once stopped, the callback is called one last time with (terminate) set.
+ *
+ * The passes finding nothing are (poll_ns) apart. After (quiet_polls) of
+ * them in a row, unless 0, the thread goes to sleep until a producer
+ * calls spsc_writer_notify().
+ */
+typedef size_t(spsc_drain_f)(void *arg, int terminate);
+
+struct spsc_writer {
+    spsc_drain_f *drain;
+    void *arg;
+    long poll_ns;
+    int quiet_polls;
+    int idle; /* Waits for the wakeup */
+    int terminate;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    pthread_t thread;
+};
+
+void spsc_writer_start(struct spsc_writer *, spsc_drain_f *, void *arg,
+                       long poll_ns, int quiet_polls);
+
+/*
+ * Drain the rings once more and stop the thread.
+ */
+void spsc_writer_stop(struct spsc_writer *);
+
+/*
+ * Wake the thread up to drain the rings.
+ */
+void spsc_writer_wake(struct spsc_writer *);
+
+/*
+ * Wake the thread up if it sleeps, after the record has been appended.
+ * Ordered against the thread setting its idle flag and then draining
+ * the rings once more: either it sees the record, or we see it idle.
+ */
+static inline void __attribute__((unused))
+spsc_writer_notify(struct spsc_writer *w) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&w->idle, __ATOMIC_RELAXED)) spsc_writer_wake(w);
+}
+
+#endif /* TCPKALI_SPSC_H */
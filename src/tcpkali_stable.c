@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "tcpkali_stable.h"
+
+void
+stable_init(struct stable_detector *sd, int n_metrics, double max_cv,
+            int windows) {
+    assert(n_metrics > 0 && windows > 1);
+    sd->max_cv = max_cv;
+    sd->windows = windows;
+    sd->n_metrics = n_metrics;
+    sd->filled = 0;
+    sd->next = 0;
+    sd->samples = calloc(n_metrics * windows, sizeof(sd->samples[0]));
+    assert(sd->samples);
+}
+
+void
+stable_free(struct stable_detector *sd) {
+    free(sd->samples);
+    sd->samples = NULL;
+}
+
+/*
+ * Two-sided 95% quantile of Student's t distribution with (df) degrees
+ * of freedom, the normal one past the table.
+ */
+static double
+student_t95(int df) {
+    static const double t[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447,
+                               2.365,  2.306, 2.262, 2.228, 2.201, 2.179,
+                               2.160,  2.145, 2.131, 2.120, 2.110, 2.101,
+                               2.093,  2.086, 2.080, 2.074, 2.069, 2.064,
+                               2.060,  2.056, 2.052, 2.048, 2.045, 2.042};
+    if(df < 1) return INFINITY;
+    if(df <= (int)(sizeof(t) / sizeof(t[0]))) return t[df - 1];
+    return 1.960;
+}
+
+void
+stable_estimate(const struct stable_detector *sd, int metric,
+                struct stable_estimate *est) {
+    const double *s = &sd->samples[metric * sd->windows];
+    int n = sd->filled;
+    double sum = 0.0;
+
+    est->measured = 0;
+    est->mean = est->ci95 = est->cv = NAN;
+    if(n < 2) return;
+
+    for(int i = 0; i < n; i++) {
+        if(isnan(s[i])) return;
+        sum += s[i];
+    }
+    double mean = sum / n;
+    double sq = 0.0;
+    for(int i = 0; i < n; i++) sq += (s[i] - mean) * (s[i] - mean);
+    double stddev = sqrt(sq / (n - 1));
+
+    est->mean = mean;
+    est->ci95 = student_t95(n - 1) * stddev / sqrt(n);
+    if(mean > 0.0) {
+        est->cv = stddev / mean;
+        est->measured = 1;
+    }
+}
+
+int
+stable_add(struct stable_detector *sd, const double *values) {
+    for(int m = 0; m < sd->n_metrics; m++)
+        sd->samples[m * sd->windows + sd->next] = values[m];
+    sd->next = (sd->next + 1) % sd->windows;
+    if(sd->filled < sd->windows) sd->filled++;
+    if(sd->filled < sd->windows) return 0;
+
+    int measured = 0;
+    for(int m = 0; m < sd->n_metrics; m++) {
+        struct stable_estimate est;
+        stable_estimate(sd, m, &est);
+        if(!est.measured) continue;
+        if(!(est.cv < sd->max_cv)) return 0;
+        measured++;
+    }
+    return measured > 0;
+}
+
+#ifdef TCPKALI_STABLE_UNIT_TEST
+
+int
+main() {
+    struct stable_detector sd;
+    stable_init(&sd, 3, 0.05, 5);
+
+    /* Ramping up: not steady. */
+    for(int i = 1; i <= 5; i++) {
+        double v[3] = {100.0 * i, 0.0, NAN};
+        assert(stable_add(&sd, v) == 0);
+    }
+
+    /* Settles around 1000, the zero and unmeasured metrics aside. */
+    double settled[] = {1000, 1010, 990, 1005, 995};
+    for(int i = 0; i < 4; i++) {
+        double v[3] = {settled[i], 0.0, i == 2 ? NAN : 1.0};
+        assert(stable_add(&sd, v) == 0);
+    }
+    /* The third metric had a window with nothing to measure. */
+    double v[3] = {settled[4], 0.0, 1.0};
+    assert(stable_add(&sd, v) == 1);
+
+    struct stable_estimate est;
+    stable_estimate(&sd, 0, &est);
+    assert(est.measured && fabs(est.mean - 1000) < 1e-9);
+    assert(est.cv < 0.01);
+    /* stddev = sqrt(250/4) = 7.9, t(4) = 2.776 */
+    assert(fabs(est.ci95 - 2.776 * sqrt(62.5) / sqrt(5)) < 1e-9);
+    stable_estimate(&sd, 1, &est);
+    assert(!est.measured && est.mean == 0.0);
+    stable_estimate(&sd, 2, &est);
+    assert(!est.measured && isnan(est.mean));
+
+    /* An outlier breaks the steadiness. */
+    double outlier[3] = {2000, 0.0, 1.0};
+    assert(stable_add(&sd, outlier) == 0);
+
+    /* Nothing measured is not steady. */
+    struct stable_detector none;
+    stable_init(&none, 1, 0.05, 2);
+    double zero[1] = {0.0};
+    assert(stable_add(&none, zero) == 0);
+    assert(stable_add(&none, zero) == 0);
+    stable_free(&none);
+
+    stable_free(&sd);
+    return 0;
+}
+
+#endif /* TCPKALI_STABLE_UNIT_TEST */
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_STABLE_H
+#define TCPKALI_STABLE_H
+
+/*
+ * Steady state detection, see --until-stable.
+ *
+ * Each window contributes one sample per metric, such as the bytes
+ * per second or the latency within that window. The numbers are steady
+ * once the coefficient of variation (the standard deviation relative
+ * to the mean) of the most recent windows is below the threshold for
+ * every metric being measured. A metric with a zero mean or with a
+ * window which had nothing to measure (NAN) is not taken into account.
+ */
+
+struct stable_detector {
+    double max_cv;  /* Coefficient of variation deemed steady */
+    int windows;    /* Number of the most recent windows to consider */
+    int n_metrics;
+    int filled;     /* Windows recorded, up to (windows) */
+    int next;       /* Ring position of the next window */
+    double *samples; /* [n_metrics][windows] */
+};
+
+struct stable_estimate {
+    double mean;
+    double ci95; /* Half-width of the 95% confidence interval of the mean */
+    double cv;
+    int measured; /* Zero if the metric is not taken into account */
+};
+
+void stable_init(struct stable_detector *, int n_metrics, double max_cv,
+                 int windows);
+void stable_free(struct stable_detector *);
+
+/*
+ * Record the samples of the next window, an array of (n_metrics) values.
+ * Returns 1 if the numbers are steady.
+ */
+int stable_add(struct stable_detector *, const double *values);
+
+/*
+ * The estimate of the metric over the most recent windows.
+ */
+void stable_estimate(const struct stable_detector *, int metric,
+                     struct stable_estimate *);
+
+#endif /* TCPKALI_STABLE_H */
@@ -31,6 +31,7 @@
 #include <math.h>
 
 #include "tcpkali_statsd.h"
+#include "tcpkali_iface.h"
 
 #define SBATCH_INT(t, str, value)                               \
     do {                                                        \
@@ -42,59 +43,218 @@
         assert(ret == STATSD_SUCCESS);                          \
     } while(0)
 
-#define SBATCH_DBL(t, str, value)                                   \
-    do {                                                            \
-        int ret = statsd_addToBatch_dbl(statsd, t, str, value, 1);  \
-        if(ret == STATSD_BATCH_FULL) {                              \
-            statsd_sendBatch(statsd);                               \
-            ret = statsd_addToBatch_dbl(statsd, t, str, value, 1);  \
-        }                                                           \
-        assert(ret == STATSD_SUCCESS);                              \
+#define SBATCH_DBL_TAGGED(t, str, value, tags)                                  \
+    do {                                                                        \
+        int ret = statsd_addToBatch_dbl_tags(statsd, t, str, value, 1, tags);   \
+        if(ret == STATSD_BATCH_FULL) {                                          \
+            statsd_sendBatch(statsd);                                           \
+            ret = statsd_addToBatch_dbl_tags(statsd, t, str, value, 1, tags);   \
+        }                                                                       \
+        assert(ret == STATSD_SUCCESS);                                          \
     } while(0)
 
+#define SBATCH_TAGGED(t, str, value, tags)                                  \
+    do {                                                                    \
+        int ret = statsd_addToBatch_tags(statsd, t, str, value, 1, tags);   \
+        if(ret == STATSD_BATCH_FULL) {                                      \
+            statsd_sendBatch(statsd);                                       \
+            ret = statsd_addToBatch_tags(statsd, t, str, value, 1, tags);   \
+        }                                                                   \
+        assert(ret == STATSD_SUCCESS);                                      \
+    } while(0)
+
+struct statsd_breakdown {
+    struct engine *eng;
+    int n_workers;
+    non_atomic_traffic_stats *workers; /* Reported so far */
+    size_t n_remotes;
+    struct breakdown_remote {
+        char tag[INET6_ADDRSTRLEN + sizeof("remote::65535")];
+        size_t attempts; /* Reported so far */
+        size_t failures;
+        non_atomic_traffic_stats traffic;
+    } * remotes;
+};
+
+/*
+ * Follow the destinations added by --dns-refresh.
+ */
+static void
+breakdown_add_remotes(statsd_breakdown *bd) {
+    const struct addresses *remotes = &engine_params(bd->eng)->remote_addresses;
+    if(remotes->n_addrs <= bd->n_remotes) return;
+
+    bd->remotes =
+        realloc(bd->remotes, remotes->n_addrs * sizeof(bd->remotes[0]));
+    assert(bd->remotes);
+    memset(&bd->remotes[bd->n_remotes], 0,
+           (remotes->n_addrs - bd->n_remotes) * sizeof(bd->remotes[0]));
 
-static void report_latency(Statsd *statsd, statsd_report_latency_types ltype, struct hdr_histogram *hist, const struct percentile_values *latency_percentiles) {
+    for(size_t i = bd->n_remotes; i < remotes->n_addrs; i++) {
+        char buf[INET6_ADDRSTRLEN + 64];
+        format_sockaddr((struct sockaddr_storage *)&remotes->addrs[i], buf,
+                        sizeof(buf));
+        /* "[::1]:80" -> "remote:::1:80", brackets are not valid in tags. */
+        char *tag = bd->remotes[i].tag;
+        char *end = tag + sizeof(bd->remotes[i].tag) - 1;
+        tag += snprintf(tag, end - tag, "remote:");
+        for(const char *p = buf; *p && tag < end; p++) {
+            if(*p != '[' && *p != ']') *tag++ = *p;
+        }
+        *tag = '\0';
+    }
+    bd->n_remotes = remotes->n_addrs;
+}
+
+statsd_breakdown *
+statsd_breakdown_new(struct engine *eng) {
+    statsd_breakdown *bd = calloc(1, sizeof(*bd));
+    assert(bd);
+    bd->eng = eng;
+    /* The workers might be added later, see engine_set_workers(). */
+    bd->n_workers = engine_workers_max(eng);
+    bd->workers = calloc(bd->n_workers ? bd->n_workers : 1,
+                         sizeof(bd->workers[0]));
+    bd->remotes = calloc(1, sizeof(bd->remotes[0]));
+    assert(bd->workers && bd->remotes);
+    breakdown_add_remotes(bd);
+
+    return bd;
+}
 
+static void report_latency_snapshot(
+    Statsd *statsd, const char *scope, const char *tags,
+    const struct latency_snapshot *, statsd_report_latency_types,
+    const struct percentile_values *latency_percentiles);
+
+/*
+ * Report the per-worker traffic and per-remote connection counts and
+ * traffic accumulated since the previous call, and the per-remote latencies.
+ */
+static void
+report_breakdown(Statsd *statsd, statsd_breakdown *bd,
+                 statsd_report_latency_types latency_types,
+                 const struct percentile_values *latency_percentiles) {
+    int n_workers = engine_workers(bd->eng);
+    for(int n = 0; n < n_workers && n < bd->n_workers; n++) {
+        non_atomic_traffic_stats traffic = engine_worker_traffic(bd->eng, n);
+        non_atomic_traffic_stats delta =
+            subtract_traffic_stats(traffic, bd->workers[n]);
+        bd->workers[n] = traffic;
+
+        char tag[32];
+        snprintf(tag, sizeof(tag), "worker:%d", n);
+        SBATCH_TAGGED(STATSD_COUNT, "worker.traffic.data.rcvd",
+                      delta.bytes_rcvd, tag);
+        SBATCH_TAGGED(STATSD_COUNT, "worker.traffic.data.sent",
+                      delta.bytes_sent, tag);
+        SBATCH_TAGGED(STATSD_COUNT, "worker.traffic.msgs.rcvd",
+                      delta.msgs_rcvd, tag);
+        SBATCH_TAGGED(STATSD_COUNT, "worker.traffic.msgs.sent",
+                      delta.msgs_sent, tag);
+    }
+
+    breakdown_add_remotes(bd);
+    for(size_t i = 0; i < bd->n_remotes; i++) {
+        struct breakdown_remote *r = &bd->remotes[i];
+        size_t attempts, failures;
+        engine_get_remote_stats(bd->eng, i, &attempts, &failures);
+        SBATCH_TAGGED(STATSD_COUNT, "remote.connections.attempts",
+                      attempts - r->attempts, r->tag);
+        SBATCH_TAGGED(STATSD_COUNT, "remote.connections.failures",
+                      failures - r->failures, r->tag);
+        r->attempts = attempts;
+        r->failures = failures;
+
+        non_atomic_traffic_stats traffic = engine_remote_traffic(bd->eng, i);
+        non_atomic_traffic_stats delta =
+            subtract_traffic_stats(traffic, r->traffic);
+        r->traffic = traffic;
+        SBATCH_TAGGED(STATSD_COUNT, "remote.traffic.data.rcvd",
+                      delta.bytes_rcvd, r->tag);
+        SBATCH_TAGGED(STATSD_COUNT, "remote.traffic.data.sent",
+                      delta.bytes_sent, r->tag);
+        SBATCH_TAGGED(STATSD_COUNT, "remote.traffic.msgs.rcvd",
+                      delta.msgs_rcvd, r->tag);
+        SBATCH_TAGGED(STATSD_COUNT, "remote.traffic.msgs.sent",
+                      delta.msgs_sent, r->tag);
+
+        if(latency_types) {
+            struct latency_snapshot *latency =
+                engine_collect_remote_latency_snapshot(bd->eng, i);
+            if(latency) {
+                report_latency_snapshot(statsd, "remote.", r->tag, latency,
+                                        latency_types, latency_percentiles);
+                engine_free_latency_snapshot(latency);
+            }
+        }
+    }
+}
+
+/*
+ * Report the latency percentiles, minimum, mean and maximum as
+ * <scope>latency.<kind>.* gauges, with the optional DogStatsD (tags).
+ */
+static void
+report_latency(Statsd *statsd, const char *scope, const char *tags,
+               statsd_report_latency_types ltype, struct hdr_histogram *hist,
+               const struct percentile_values *latency_percentiles) {
     if(!hist || hist->total_count == 0)
         return;
 
-#define LENGTH_PREFIXED_STR(s)  {sizeof(s)-1,(s)}
-    static struct prefixes {
-        const char *min;
-        const char *mean;
-        const char *max;
-        struct {
-            size_t size;
-            const char *str;
-        } latency_kind;
-    } prefixes[] =
-        {[SLT_CONNECT] = {"latency.connect.min", "latency.connect.mean",
-                          "latency.connect.max",
-                          LENGTH_PREFIXED_STR("latency.connect.")},
-         [SLT_FIRSTBYTE] = {"latency.firstbyte.min", "latency.firstbyte.mean",
-                            "latency.firstbyte.max",
-                            LENGTH_PREFIXED_STR("latency.firstbyte.")},
-         [SLT_MARKER] = {"latency.message.min", "latency.message.mean",
-                         "latency.message.max",
-                         LENGTH_PREFIXED_STR("latency.message.")}};
-    assert(ltype < sizeof(prefixes)/sizeof(prefixes[0]));
-    const struct prefixes *pfx = &prefixes[ltype];
-    assert(pfx->mean);
+    static const char *kinds[] = {[SLT_CONNECT] = "connect",
+                                  [SLT_FIRSTBYTE] = "firstbyte",
+                                  [SLT_HANDSHAKE] = "handshake",
+                                  [SLT_UPGRADE] = "upgrade",
+                                  [SLT_MARKER] = "message"};
+    assert(ltype < sizeof(kinds)/sizeof(kinds[0]));
+    const char *kind = kinds[ltype];
+    assert(kind);
 
+    char name[128];
     for(size_t i = 0; i < latency_percentiles->size; i++) {
         const struct percentile_value *pv = &latency_percentiles->values[i];
-        char name[64];
-        memcpy(name, pfx->latency_kind.str, pfx->latency_kind.size);
-        strcpy(name+pfx->latency_kind.size, pv->value_s);
-        double latency_ms = hdr_value_at_percentile(hist, pv->value_d) / 10.0;
-        SBATCH_DBL(STATSD_GAUGE, name, latency_ms);
+        snprintf(name, sizeof(name), "%slatency.%s.%s", scope, kind,
+                 pv->value_s);
+        double latency_ms =
+            latency_to_ms(hdr_value_at_percentile(hist, pv->value_d));
+        SBATCH_DBL_TAGGED(STATSD_GAUGE, name, latency_ms, tags);
     }
 
-    SBATCH_DBL(STATSD_GAUGE, pfx->min, hdr_min(hist) / 10.0);
-    SBATCH_DBL(STATSD_GAUGE, pfx->mean, hdr_mean(hist) / 10.0);
-    SBATCH_DBL(STATSD_GAUGE, pfx->max, hdr_max(hist) / 10.0);
+    snprintf(name, sizeof(name), "%slatency.%s.min", scope, kind);
+    SBATCH_DBL_TAGGED(STATSD_GAUGE, name, latency_to_ms(hdr_min(hist)), tags);
+    snprintf(name, sizeof(name), "%slatency.%s.mean", scope, kind);
+    SBATCH_DBL_TAGGED(STATSD_GAUGE, name, latency_to_ms(hdr_mean(hist)), tags);
+    snprintf(name, sizeof(name), "%slatency.%s.max", scope, kind);
+    SBATCH_DBL_TAGGED(STATSD_GAUGE, name, latency_to_ms(hdr_max(hist)), tags);
 }
 
+static void
+report_latency_snapshot(Statsd *statsd, const char *scope, const char *tags,
+                        const struct latency_snapshot *latency,
+                        statsd_report_latency_types latency_types,
+                        const struct percentile_values *latency_percentiles) {
+    if(latency_types & SLT_CONNECT)
+        report_latency(statsd, scope, tags, SLT_CONNECT,
+                       latency ? latency->connect_histogram : 0,
+                       latency_percentiles);
+    if(latency_types & SLT_FIRSTBYTE)
+        report_latency(statsd, scope, tags, SLT_FIRSTBYTE,
+                       latency ? latency->firstbyte_histogram : 0,
+                       latency_percentiles);
+    if(latency_types & SLT_HANDSHAKE)
+        report_latency(statsd, scope, tags, SLT_HANDSHAKE,
+                       latency ? latency->handshake_histogram : 0,
+                       latency_percentiles);
+    if(latency_types & SLT_UPGRADE)
+        report_latency(statsd, scope, tags, SLT_UPGRADE,
+                       latency ? latency->upgrade_histogram : 0,
+                       latency_percentiles);
+    if(latency_types & SLT_MARKER)
+        report_latency(statsd, scope, tags, SLT_MARKER,
+                       latency ? latency->marker_histogram : 0,
+                       latency_percentiles);
+}
 
 void
 report_to_statsd(Statsd *statsd, statsd_feedback *sf, statsd_report_latency_types latency_types, const struct percentile_values *latency_percentiles) {
@@ -107,6 +267,8 @@ report_to_statsd(Statsd *statsd, statsd_feedback *sf, statsd_report_latency_type
     statsd_resetBatch(statsd);
 
     SBATCH_INT(STATSD_COUNT, "connections.opened", sf->opened);
+    SBATCH_INT(STATSD_COUNT, "connections.closed",
+               sf->traffic_delta.conns_closed);
     SBATCH_INT(STATSD_GAUGE, "connections.total", sf->conns_in + sf->conns_out);
     SBATCH_INT(STATSD_GAUGE, "connections.total.in", sf->conns_in);
     SBATCH_INT(STATSD_GAUGE, "connections.total.out", sf->conns_out);
@@ -122,20 +284,12 @@ report_to_statsd(Statsd *statsd, statsd_feedback *sf, statsd_report_latency_type
     SBATCH_INT(STATSD_COUNT, "traffic.msgs.rcvd", sf->traffic_delta.msgs_rcvd);
     SBATCH_INT(STATSD_COUNT, "traffic.msgs.sent", sf->traffic_delta.msgs_sent);
 
-    if(latency_types) {
-        if(latency_types & SLT_CONNECT)
-            report_latency(statsd, SLT_CONNECT,
-                           sf->latency ? sf->latency->connect_histogram : 0,
-                           latency_percentiles);
-        if(latency_types & SLT_FIRSTBYTE)
-            report_latency(statsd, SLT_FIRSTBYTE,
-                           sf->latency ? sf->latency->firstbyte_histogram : 0,
-                           latency_percentiles);
-        if(latency_types & SLT_MARKER)
-            report_latency(statsd, SLT_MARKER,
-                           sf->latency ? sf->latency->marker_histogram : 0,
-                           latency_percentiles);
-    }
+    report_latency_snapshot(statsd, "", NULL, sf->latency, latency_types,
+                            latency_percentiles);
+
+    if(sf->breakdown)
+        report_breakdown(statsd, sf->breakdown, latency_types,
+                         latency_percentiles);
 
     statsd_sendBatch(statsd);
 }
@@ -146,18 +300,8 @@ report_latency_to_statsd(Statsd *statsd, struct latency_snapshot *latency, stats
 
     statsd_resetBatch(statsd);
 
-    if(latency_types & SLT_CONNECT)
-        report_latency(statsd, SLT_CONNECT,
-                       latency->connect_histogram,
-                       latency_percentiles);
-    if(latency_types & SLT_FIRSTBYTE)
-        report_latency(statsd, SLT_FIRSTBYTE,
-                       latency->firstbyte_histogram,
-                       latency_percentiles);
-    if(latency_types & SLT_MARKER)
-        report_latency(statsd, SLT_MARKER,
-                       latency->marker_histogram,
-                       latency_percentiles);
+    report_latency_snapshot(statsd, "", NULL, latency, latency_types,
+                            latency_percentiles);
 
     statsd_sendBatch(statsd);
 }
@@ -33,6 +33,13 @@
 #include "tcpkali_atomic.h"
 #include "tcpkali_engine.h"
 
+/*
+ * Per-worker and per-remote counters, reported with the DogStatsD
+ * worker:<n> and remote:<address> tags (see --statsd-tags).
+ */
+typedef struct statsd_breakdown statsd_breakdown;
+statsd_breakdown *statsd_breakdown_new(struct engine *);
+
 /*
  * What we are sending to statsd?
  */
@@ -44,6 +51,7 @@ typedef struct {
     size_t bps_out;
     non_atomic_traffic_stats traffic_delta;
     struct latency_snapshot *latency;
+    statsd_breakdown *breakdown; /* Optional */
 } statsd_feedback;
 
 void report_to_statsd(Statsd *statsd, statsd_feedback *feedback_optional,
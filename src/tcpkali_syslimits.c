@@ -29,6 +29,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdarg.h>
+#include <math.h>
 #include <sys/types.h>
 #include <sys/resource.h>
 #include <linux/sysctl.h>
@@ -39,6 +40,17 @@
 #include "tcpkali_syslimits.h"
 #include "tcpkali_logging.h"
 
+/*
+ * Convert a sysctl-style setting name into the Linux /proc/sys file path.
+ */
+static void
+sysctl_filename(const char *setting_name, char *filename, size_t size) {
+    size_t len = snprintf(filename, size, "/proc/sys/");
+    for(; *setting_name && len < size - 1; setting_name++, len++)
+        filename[len] = (*setting_name == '.') ? '/' : *setting_name;
+    filename[len] = '\0';
+}
+
 /*
  * Get a system setting, be it sysctl or a file contents, and put it into
  * the scanf variables.
@@ -91,23 +103,12 @@ vsystem_setting(const char *setting_name, const char *setting_fmt, va_list ap) {
         return 0;
 #else /* !HAVE_SYSCTLBYNAME */
         /* Explicitly convert sysctl-style into file-style for Linux */
-        char filename[128] = "/proc/sys/";
-        char *p = filename + strlen(filename);
+        char filename[128];
 #if !defined(__linux__)
 #warning \
     "Converting sysctl-style parameters into file paths might not be compatible with non-Linux operating systems"
 #endif
-        for(; *setting_name && (size_t)(p - filename) < (sizeof(filename) - 1);
-            setting_name++, p++) {
-            switch(*setting_name) {
-            case '.':
-                *p = '/';
-                break;
-            default:
-                *p = *setting_name;
-            }
-        }
-        *p = '\0';
+        sysctl_filename(setting_name, filename, sizeof(filename));
         return vsystem_setting(filename, setting_fmt, ap);
 #endif /* HAVE_SYSCTLBYNAME */
     } else {
@@ -125,6 +126,29 @@ system_setting(const char *setting_name, const char *setting_fmt, ...) {
     return ret;
 }
 
+/*
+ * Write a sysctl-style setting into its Linux /proc/sys file.
+ * RETURNS -1 with errno set if the setting could not be written,
+ *          0 otherwise.
+ */
+static int __attribute__((format(printf, 2, 3)))
+set_system_setting(const char *setting_name, const char *setting_fmt, ...) {
+    char filename[128];
+    sysctl_filename(setting_name, filename, sizeof(filename));
+
+    FILE *f = fopen(filename, "w");
+    if(!f) return -1;
+
+    va_list ap;
+    va_start(ap, setting_fmt);
+    int printed = vfprintf(f, setting_fmt, ap);
+    va_end(ap);
+
+    /* The kernel only parses the value when the buffer is flushed. */
+    if(fclose(f) != 0 || printed < 0) return -1;
+    return 0;
+}
+
 int
 check_setsockopt_effect(int so_option) {
     const char *auto_rcvbuf[] = {"net.inet.tcp.doautorcvbuf", /* Mac OS X */
@@ -434,3 +458,227 @@ check_system_limits_sanity(int expected_sockets, int workers) {
 
     return return_value;
 }
+
+/*
+ * Print out the integer setting for the --preflight, and raise it to
+ * the (wanted) value if it falls short and PREFLIGHT_APPLY is given.
+ * RETURNS -1 if the system does not have that setting,
+ *          0 otherwise, with the (*value) as it stands after that.
+ */
+static int
+preflight_setting(const char *setting_name, int wanted,
+                  enum preflight_mode mode, int *value) {
+    if(system_setting(setting_name, "%d", value) != 0) return -1;
+
+    if(*value >= wanted) {
+        fprintf(stderr, "Preflight: %s = %d\n", setting_name, *value);
+    } else if(mode != PREFLIGHT_APPLY) {
+        fprintf(stderr, "Preflight: %s = %d, wanted %d\n", setting_name,
+                *value, wanted);
+    } else if(set_system_setting(setting_name, "%d\n", wanted) == -1) {
+        fprintf(stderr, "Preflight: %s = %d, could not set %d: %s\n",
+                setting_name, *value, wanted, strerror(errno));
+    } else {
+        fprintf(stderr, "Preflight: %s = %d, set to %d\n", setting_name,
+                *value, wanted);
+        (void)system_setting(setting_name, "%d", value);
+    }
+
+    return 0;
+}
+
+/*
+ * Check the kernel settings limiting the high-scale runs, see --preflight.
+ */
+int
+system_preflight(const struct preflight_params *pp, enum preflight_mode mode) {
+    int caps = 0;
+    int value;
+
+    if(mode == PREFLIGHT_OFF) return 0;
+
+    /*
+     * The connections to each destination from each source address
+     * take an ephemeral port. The closed ones hold it in TIME_WAIT
+     * for a minute, unless these sockets can be reused.
+     */
+    long port_pairs = (long)pp->sources * pp->destinations;
+    int ports = 0;
+    if(pp->connections && port_pairs) {
+        const char *range_name = "net.ipv4.ip_local_port_range";
+        const char *range_file = "/proc/sys/net/ipv4/ip_local_port_range";
+        int wanted = (pp->connections + port_pairs - 1) / port_pairs;
+        int lo, hi;
+        if(system_setting(range_file, "%d %d", &lo, &hi) == 0) {
+            ports = hi - lo + 1;
+            if(ports >= wanted) {
+                fprintf(stderr, "Preflight: %s = %d %d\n", range_name, lo,
+                        hi);
+            } else if(mode != PREFLIGHT_APPLY) {
+                fprintf(stderr, "Preflight: %s = %d %d, wanted %d ports\n",
+                        range_name, lo, hi, wanted);
+            } else if(set_system_setting(range_name, "%d %d\n",
+                                         lo < 1024 ? lo : 1024, 65535)
+                      == -1) {
+                fprintf(stderr,
+                        "Preflight: %s = %d %d, could not widen it: %s\n",
+                        range_name, lo, hi, strerror(errno));
+            } else {
+                fprintf(stderr, "Preflight: %s = %d %d, set to %d %d\n",
+                        range_name, lo, hi, lo < 1024 ? lo : 1024, 65535);
+                if(system_setting(range_file, "%d %d", &lo, &hi) == 0)
+                    ports = hi - lo + 1;
+            }
+            if(ports * port_pairs < pp->connections) {
+                warning("--connections=%d will be capped at %ld "
+                        "by the ephemeral ports in %s.\n",
+                        pp->connections, ports * port_pairs, range_name);
+                caps++;
+            }
+        }
+    }
+
+    if(pp->connections && (pp->churn || pp->connections > 100)) {
+        /* 2 means the loopback connections only, which may be enough. */
+        const char *tw_name = "net.ipv4.tcp_tw_reuse";
+        if(system_setting(tw_name, "%d", &value) == 0) {
+            if(value == 1) {
+                fprintf(stderr, "Preflight: %s = %d\n", tw_name, value);
+            } else if(mode != PREFLIGHT_APPLY) {
+                fprintf(stderr, "Preflight: %s = %d, wanted 1\n", tw_name,
+                        value);
+            } else if(set_system_setting(tw_name, "1\n") == -1) {
+                fprintf(stderr, "Preflight: %s = %d, could not set 1: %s\n",
+                        tw_name, value, strerror(errno));
+            } else {
+                fprintf(stderr, "Preflight: %s = %d, set to 1\n", tw_name,
+                        value);
+                value = 1;
+            }
+            if(value != 1 && pp->churn && ports
+               && ports * port_pairs / 60.0 < pp->connect_rate) {
+                warning("--connect-rate=%g will be capped at %.0f/s "
+                        "by the ports held in TIME_WAIT, see %s%s.\n",
+                        pp->connect_rate, ports * port_pairs / 60.0, tw_name,
+                        value == 2 ? ", unless on the loopback" : "");
+                caps++;
+            }
+        }
+    }
+
+    /*
+     * The listener's accept queue is limited by the somaxconn,
+     * and the handshakes in progress by the tcp_max_syn_backlog.
+     * Once either fills up, the SYNs are dropped and retried a second
+     * later, so neither should hold less than a second of connects.
+     */
+    if(pp->listen_backlog) {
+        int queue = pp->listen_backlog;
+        int rate = pp->connect_rate < pp->listen_backlog
+                       ? pp->listen_backlog
+                       : (int)ceil(pp->connect_rate);
+        if(preflight_setting("net.core.somaxconn", pp->listen_backlog, mode,
+                             &value)
+               == 0
+           && value < pp->listen_backlog) {
+            warning("--listen-backlog=%d will be capped at %d "
+                    "by net.core.somaxconn.\n",
+                    pp->listen_backlog, value);
+            queue = value;
+            caps++;
+        }
+        if(preflight_setting("net.ipv4.tcp_max_syn_backlog",
+                             pp->connections ? rate : pp->listen_backlog, mode,
+                             &value)
+               == 0
+           && value < queue) {
+            queue = value;
+        }
+        if(pp->connections && queue < pp->connect_rate) {
+            warning("--connect-rate=%g will be capped at %d/s "
+                    "whenever the listener falls behind, "
+                    "see --listen-backlog.\n",
+                    pp->connect_rate, queue);
+            caps++;
+        }
+    }
+
+    /*
+     * The IP filter tracks each connection, including the closed ones
+     * for a while, and is slow with too few hash buckets for it all.
+     */
+    if(pp->connections) {
+        int conns = pp->connections;
+        int wanted = conns < 0x3fffffff ? 2 * conns : conns;
+        if(preflight_setting("net.netfilter.nf_conntrack_max", wanted, mode,
+                             &value)
+               == 0
+           && value < conns) {
+            warning("--connections=%d will be capped at %d "
+                    "by net.netfilter.nf_conntrack_max.\n",
+                    conns, value);
+            caps++;
+        }
+        (void)preflight_setting("net.netfilter.nf_conntrack_buckets",
+                                wanted / 4, mode, &value);
+    }
+
+    /* The SO_RCVBUF and SO_SNDBUF are silently clamped by these. */
+    if(pp->rcvbuf
+       && preflight_setting("net.core.rmem_max", pp->rcvbuf, mode, &value)
+              == 0
+       && value < pp->rcvbuf) {
+        warning("--rcvbuf=%d will be capped at %d by net.core.rmem_max.\n",
+                pp->rcvbuf, value);
+        caps++;
+    }
+    if(pp->sndbuf
+       && preflight_setting("net.core.wmem_max", pp->sndbuf, mode, &value)
+              == 0
+       && value < pp->sndbuf) {
+        warning("--sndbuf=%d will be capped at %d by net.core.wmem_max.\n",
+                pp->sndbuf, value);
+        caps++;
+    }
+
+    /*
+     * The SO_BUSY_POLL above the net.core.busy_read takes CAP_NET_ADMIN,
+     * and the net.core.busy_poll lets epoll(7) spin as well.
+     */
+    if(pp->busy_poll_us) {
+        if(preflight_setting("net.core.busy_read", pp->busy_poll_us, mode,
+                             &value)
+               == 0
+           && value < pp->busy_poll_us) {
+            warning("--busy-poll=%dus will be capped at %dus "
+                    "by net.core.busy_read without CAP_NET_ADMIN.\n",
+                    pp->busy_poll_us, value);
+            caps++;
+        }
+        (void)preflight_setting("net.core.busy_poll", pp->busy_poll_us, mode,
+                                &value);
+    }
+
+    /* The open files limit has been raised as far as it goes already. */
+    struct rlimit rlp;
+    if(getrlimit(RLIMIT_NOFILE, &rlp) == 0) {
+        fprintf(stderr, "Preflight: open files limit = %ld\n",
+                (long)rlp.rlim_cur);
+        if(rlp.rlim_cur != RLIM_INFINITY
+           && rlp.rlim_cur < (rlim_t)pp->connections) {
+            warning("--connections=%d will be capped at about %ld "
+                    "by the open files limit (`ulimit -n`).\n",
+                    pp->connections, (long)rlp.rlim_cur);
+            caps++;
+        }
+    }
+
+    if(caps == 0) {
+        fprintf(stderr,
+                "Preflight: no system limits cap "
+                "--connections=%d at --connect-rate=%g\n",
+                pp->connections, pp->connect_rate);
+    }
+
+    return caps;
+}
@@ -38,6 +38,36 @@ int adjust_system_limits_for_highload(int expected_sockets, int workers);
  */
 int check_system_limits_sanity(int expected_sockets, int workers);
 
+enum preflight_mode {
+    PREFLIGHT_OFF,   /* No --preflight */
+    PREFLIGHT_CHECK, /* --preflight */
+    PREFLIGHT_APPLY  /* --preflight=apply */
+};
+
+/*
+ * What the run is going to ask of the system, see system_preflight().
+ */
+struct preflight_params {
+    int connections;     /* Peak --connections, 0 if not connecting */
+    double connect_rate; /* --connect-rate */
+    int churn;           /* Connections are closed and replaced */
+    int destinations;    /* Destination addresses */
+    int sources;         /* Source addresses, 0 if there are plenty */
+    int listen_backlog;  /* --listen-backlog, 0 if not listening */
+    int rcvbuf; /* --rcvbuf, or 0 */
+    int sndbuf; /* --sndbuf, or 0 */
+    int busy_poll_us; /* --busy-poll, or 0 */
+};
+
+/*
+ * Check the kernel settings which limit the high-scale runs against what
+ * the run is going to ask for, and print them out, along with the limits
+ * which will cap --connections and --connect-rate. With PREFLIGHT_APPLY,
+ * raise the settings found short, where permitted.
+ * RETURNS the number of limits which will cap the run.
+ */
+int system_preflight(const struct preflight_params *, enum preflight_mode);
+
 /*
  * Check whether setsockopt() with a given option will give any effect.
  * RETURN VALUES:
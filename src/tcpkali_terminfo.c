@@ -54,7 +54,11 @@
 static int terminal_initialized = 0;
 static int int_utf8 = 0;
 static int terminal_width = 80;
+static int terminal_height = 24;
 static const char *str_clear_eol = "";  // ANSI terminal code: "\033[K";
+static const char *str_clear_eos = "";  // ANSI terminal code: "\033[J";
+static const char *str_cursor_home = "";  // ANSI terminal code: "\033[H";
+static int fullscreen = 0;
 static char tka_sndbrace[16];
 static char tka_rcvbrace[16];
 static char tka_warn[16];
@@ -90,6 +94,14 @@ const char *
 tcpkali_clear_eol() {
     return str_clear_eol;
 }
+const char *
+tcpkali_clear_eos() {
+    return str_clear_eos;
+}
+const char *
+tcpkali_cursor_home() {
+    return str_cursor_home;
+}
 int
 tcpkali_is_utf8() {
     return int_utf8;
@@ -125,6 +137,36 @@ tcpkali_terminal_width(void) {
     return terminal_width;
 }
 
+int
+tcpkali_terminal_height(void) {
+    if(terminal_width_changed) {
+        terminal_width_changed = 0;
+        tcpkali_init_terminal(NULL);
+    }
+    return terminal_height;
+}
+
+void
+tcpkali_enter_fullscreen(void) {
+    static int registered;
+    if(fullscreen || tcpkali_init_terminal(NULL) != 0) return;
+    /* enter_ca_mode */
+    fprintf(stderr, "%s%s%s", cap("ti"), str_cursor_home, str_clear_eos);
+    fullscreen = 1;
+    if(!registered) {
+        registered = 1;
+        atexit(tcpkali_leave_fullscreen);
+    }
+}
+
+void
+tcpkali_leave_fullscreen(void) {
+    if(fullscreen) {
+        fullscreen = 0;
+        fprintf(stderr, "%s", cap("te")); /* exit_ca_mode */
+    }
+}
+
 void
 tcpkali_disable_cursor(void) {
     if(tcpkali_init_terminal(NULL) == 0) {
@@ -175,11 +217,15 @@ tcpkali_init_terminal(const char **note) {
     signal(SIGWINCH, raise_terminal_width_changed);
     int n = tgetnum("co");
     if(n > 0) terminal_width = n;
+    n = tgetnum("li");
+    if(n > 0) terminal_height = n;
 
     if(strcasestr(getenv("LANG") ?: "", "utf-8")) int_utf8 = 1;
 
     /* Obtain the clear end of line string */
     str_clear_eol = cap("ce");
+    str_clear_eos = cap("cd");
+    str_cursor_home = cap("ho");
 
     const char *bold = cap("md");
 
@@ -248,6 +294,8 @@ tcpkali_kbdhit(void)
     case 'j': return KE_DOWN_ARROW;
     case '\n': return KE_ENTER;
     case 'q': return KE_Q;
+    case '+': return KE_PLUS;
+    case '-': return KE_MINUS;
     }
     return KE_NOTHING;
 }
@@ -284,6 +332,19 @@ tcpkali_terminal_width(void) {
     return terminal_width;
 }
 
+int
+tcpkali_terminal_height(void) {
+    return terminal_height;
+}
+
+void
+tcpkali_enter_fullscreen(void) {
+}
+
+void
+tcpkali_leave_fullscreen(void) {
+}
+
 enum keyboard_event
 tcpkali_kbdhit(void) {
     return KE_NOTHING;
@@ -56,6 +56,18 @@ int tcpkali_is_utf8();
  * Width of the terminal output, in columns.
  */
 int tcpkali_terminal_width();
+/* Height of the terminal, in lines. */
+int tcpkali_terminal_height();
+
+/*
+ * Switch to the alternate screen for the full-screen output, and back.
+ * The cursor_home and clear_eos strings redraw the screen from the top
+ * without flickering.
+ */
+void tcpkali_enter_fullscreen(void);
+void tcpkali_leave_fullscreen(void);
+const char *tcpkali_cursor_home(void);
+const char *tcpkali_clear_eos(void);
 
 /*
  * Get an escape sequence for special terminal output
@@ -69,7 +81,9 @@ enum keyboard_event {
     KE_UP_ARROW,
     KE_DOWN_ARROW,
     KE_ENTER,
-    KE_Q
+    KE_Q,
+    KE_PLUS,
+    KE_MINUS
 };
 
 enum keyboard_event tcpkali_kbdhit(void);
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tcpkali_timeseries.h"
+
+/* The file grows by this many records at a time. */
+#define TIMESERIES_GROW_RECORDS 4096
+
+struct timeseries {
+    int fd;
+    void *map;
+    size_t map_size;
+    size_t capacity; /* Records fitting into the mapping */
+};
+
+static struct timeseries_header *
+timeseries_header(struct timeseries *ts) {
+    return ts->map;
+}
+
+static struct timeseries_record *
+timeseries_records(void *map) {
+    return (void *)((char *)map + sizeof(struct timeseries_header));
+}
+
+/*
+ * Map the file with the room for (capacity) records, growing the file.
+ */
+static int
+timeseries_map(struct timeseries *ts, size_t capacity) {
+    size_t size = sizeof(struct timeseries_header)
+                  + capacity * sizeof(struct timeseries_record);
+    if(ftruncate(ts->fd, size) == -1) return -1;
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ts->fd, 0);
+    if(map == MAP_FAILED) return -1;
+    if(ts->map) munmap(ts->map, ts->map_size);
+    ts->map = map;
+    ts->map_size = size;
+    ts->capacity = capacity;
+    return 0;
+}
+
+struct timeseries *
+timeseries_open(const char *filename) {
+    struct timeseries *ts = calloc(1, sizeof(*ts));
+    assert(ts);
+    struct stat st;
+
+    ts->fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if(ts->fd == -1 || fstat(ts->fd, &st) == -1) {
+        int err = errno;
+        if(ts->fd != -1) close(ts->fd);
+        free(ts);
+        errno = err;
+        return NULL;
+    }
+
+    struct timeseries_header hdr = {.record_size =
+                                        sizeof(struct timeseries_record)};
+    memcpy(hdr.magic, TIMESERIES_FILE_MAGIC, TIMESERIES_FILE_MAGIC_SIZE);
+    size_t records = 0;
+    if(st.st_size) {
+        /* Append to the records already there. */
+        struct timeseries_header old;
+        if(pread(ts->fd, &old, sizeof(old), 0) != sizeof(old)
+           || memcmp(old.magic, hdr.magic, sizeof(hdr.magic))
+           || old.record_size != hdr.record_size) {
+            close(ts->fd);
+            free(ts);
+            errno = EINVAL;
+            return NULL;
+        }
+        records = old.records;
+    }
+
+    if(timeseries_map(ts, records + TIMESERIES_GROW_RECORDS) == -1) {
+        int err = errno;
+        close(ts->fd);
+        free(ts);
+        errno = err;
+        return NULL;
+    }
+    hdr.records = records;
+    *timeseries_header(ts) = hdr;
+    return ts;
+}
+
+int
+timeseries_append(struct timeseries *ts,
+                  const struct timeseries_record *rec) {
+    struct timeseries_header *hdr = timeseries_header(ts);
+    if(hdr->records == ts->capacity
+       && timeseries_map(ts, ts->capacity + TIMESERIES_GROW_RECORDS) == -1)
+        return -1;
+    hdr = timeseries_header(ts);
+    timeseries_records(ts->map)[hdr->records] = *rec;
+    hdr->records++;
+    return 0;
+}
+
+void
+timeseries_close(struct timeseries *ts) {
+    if(!ts) return;
+    size_t size = sizeof(struct timeseries_header)
+                  + timeseries_header(ts)->records
+                        * sizeof(struct timeseries_record);
+    munmap(ts->map, ts->map_size);
+    if(ftruncate(ts->fd, size) == -1) {
+        /* The header still tells where the records end. */
+    }
+    close(ts->fd);
+    free(ts);
+}
+
+int
+timeseries_write_csv(const char *filename, FILE *out) {
+    FILE *fp = fopen(filename, "r");
+    if(!fp) return -1;
+
+    struct timeseries_header hdr;
+    if(fread(&hdr, sizeof(hdr), 1, fp) != 1
+       || memcmp(hdr.magic, TIMESERIES_FILE_MAGIC, TIMESERIES_FILE_MAGIC_SIZE)
+       || hdr.record_size != sizeof(struct timeseries_record)) {
+        fclose(fp);
+        errno = EINVAL;
+        return -1;
+    }
+
+    fprintf(out,
+            "timestamp,bytes_sent,bytes_rcvd,msgs_sent,msgs_rcvd,"
+            "conns_opened,conns_closed,conn_failures,"
+            "connecting,conns_in,conns_out\n");
+    struct timeseries_record rec;
+    for(uint64_t i = 0; i < hdr.records && fread(&rec, sizeof(rec), 1, fp);
+        i++) {
+        fprintf(out,
+                "%" PRIu64 ".%06" PRIu64 ",%" PRIu64 ",%" PRIu64
+                ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32
+                ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n",
+                rec.timestamp_us / 1000000, rec.timestamp_us % 1000000,
+                rec.bytes_sent, rec.bytes_rcvd, rec.msgs_sent, rec.msgs_rcvd,
+                rec.conns_opened, rec.conns_closed, rec.conn_failures,
+                rec.connecting, rec.conns_in, rec.conns_out);
+    }
+    fclose(fp);
+    return 0;
+}
+
+#ifdef TCPKALI_TIMESERIES_UNIT_TEST
+
+int
+main() {
+    char filename[] = "/tmp/check_tcpkali_timeseries.XXXXXX";
+    int fd = mkstemp(filename);
+    assert(fd != -1);
+    close(fd);
+
+    /* Grow the file past its first mapping. */
+    struct timeseries *ts = timeseries_open(filename);
+    assert(ts);
+    for(uint32_t i = 0; i < TIMESERIES_GROW_RECORDS + 10; i++) {
+        struct timeseries_record rec = {.timestamp_us = 1000000 + i,
+                                        .msgs_sent = i};
+        assert(timeseries_append(ts, &rec) == 0);
+    }
+    timeseries_close(ts);
+
+    /* The records are appended after the ones already there. */
+    ts = timeseries_open(filename);
+    assert(ts);
+    struct timeseries_record rec = {.timestamp_us = 2500000,
+                                    .bytes_sent = 42,
+                                    .conns_out = 7};
+    assert(timeseries_append(ts, &rec) == 0);
+    timeseries_close(ts);
+
+    struct stat st;
+    assert(stat(filename, &st) == 0);
+    assert((size_t)st.st_size
+           == sizeof(struct timeseries_header)
+                  + (TIMESERIES_GROW_RECORDS + 11)
+                        * sizeof(struct timeseries_record));
+
+    char *csv;
+    size_t csv_size;
+    FILE *out = open_memstream(&csv, &csv_size);
+    assert(out);
+    assert(timeseries_write_csv(filename, out) == 0);
+    fclose(out);
+    assert(strncmp(csv, "timestamp,", 10) == 0);
+    assert(strstr(csv, "\n1.000003,0,0,3,0,0,0,0,0,0,0\n"));
+    size_t len = strlen(csv);
+    const char *last = "\n2.500000,42,0,0,0,0,0,0,0,0,7\n";
+    assert(len > strlen(last)
+           && strcmp(csv + len - strlen(last), last) == 0);
+    free(csv);
+
+    /* Not a time series. */
+    fd = open(filename, O_WRONLY | O_TRUNC);
+    assert(fd != -1 && write(fd, "garbage", 7) == 7);
+    close(fd);
+    assert(timeseries_open(filename) == NULL && errno == EINVAL);
+    assert(timeseries_write_csv(filename, stdout) == -1);
+
+    unlink(filename);
+    return 0;
+}
+
+#endif /* TCPKALI_TIMESERIES_UNIT_TEST */
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_TIMESERIES_H
+#define TCPKALI_TIMESERIES_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * The throughput and connection counts over time, see --timeseries.
+ *
+ * The file starts with a struct timeseries_header and is followed by the
+ * fixed-size records, one per 0.25s checkpoint or per --sample-interval,
+ * all in the host byte order.
+ * The file is memory-mapped, so appending a record costs no system call.
+ * The header counts the complete records, so a file cut short by a crash
+ * is still read up to the last record counted.
+ */
+
+#define TIMESERIES_FILE_MAGIC "tkts\0\0\0\1"
+#define TIMESERIES_FILE_MAGIC_SIZE 8
+
+struct timeseries_header {
+    char magic[TIMESERIES_FILE_MAGIC_SIZE];
+    uint32_t record_size; /* sizeof(struct timeseries_record) */
+    uint32_t reserved;
+    uint64_t records; /* Complete records following the header */
+    uint64_t reserved2;
+};
+
+struct timeseries_record {
+    uint64_t timestamp_us; /* Since the UNIX epoch */
+    /* Since the previous record. */
+    uint64_t bytes_sent;
+    uint64_t bytes_rcvd;
+    uint32_t msgs_sent;
+    uint32_t msgs_rcvd;
+    uint32_t conns_opened;
+    uint32_t conns_closed;
+    uint32_t conn_failures;
+    /* At the moment of the record. */
+    uint32_t connecting;
+    uint32_t conns_in;
+    uint32_t conns_out;
+};
+
+struct timeseries;
+
+/*
+ * Open the file to append the records to, creating it if needed.
+ * Returns NULL and sets errno on failure, EINVAL if the file exists
+ * and is not a time series.
+ */
+struct timeseries *timeseries_open(const char *filename);
+
+/*
+ * Append the record. Returns -1 and sets errno if the file
+ * could not be grown, in which case the record is lost.
+ */
+int timeseries_append(struct timeseries *, const struct timeseries_record *);
+
+/*
+ * Cut the file down to the records written and close it.
+ */
+void timeseries_close(struct timeseries *);
+
+/*
+ * Print the records of the file as CSV, with a header line.
+ * Returns -1 and sets errno on failure.
+ */
+int timeseries_write_csv(const char *filename, FILE *out);
+
+#endif /* TCPKALI_TIMESERIES_H */
@@ -39,6 +39,12 @@ typedef struct {
     non_atomic_wide_t num_reads; /* Number of read(2) calls */
     non_atomic_wide_t msgs_sent;
     non_atomic_wide_t msgs_rcvd;
+    non_atomic_wide_t msgs_lost;      /* Binary marker sequence gaps */
+    non_atomic_wide_t msgs_reordered; /* Binary marker sequence going back */
+    non_atomic_wide_t msgs_duplicated; /* Binary marker seen again, --fanout */
+    non_atomic_wide_t conns_opened;   /* Connections established */
+    non_atomic_wide_t conns_closed;   /* Established connections closed */
+    non_atomic_wide_t echo_mismatches; /* --verify-echo blocks differing */
 } non_atomic_traffic_stats;
 
 /*
@@ -51,6 +57,12 @@ typedef struct {
     atomic_wide_t num_reads; /* Number of read(2) calls */
     atomic_wide_t msgs_sent;
     atomic_wide_t msgs_rcvd;
+    atomic_wide_t msgs_lost;      /* Binary marker sequence gaps */
+    atomic_wide_t msgs_reordered; /* Binary marker sequence going back */
+    atomic_wide_t msgs_duplicated; /* Binary marker seen again, --fanout */
+    atomic_wide_t conns_opened;   /* Connections established */
+    atomic_wide_t conns_closed;   /* Established connections closed */
+    atomic_wide_t echo_mismatches; /* --verify-echo blocks differing */
 } atomic_traffic_stats;
 
 /*
@@ -65,6 +77,12 @@ add_traffic_numbers_AtoN(const atomic_traffic_stats *src,
     dst->num_reads += atomic_wide_get(&src->num_reads);
     dst->msgs_sent += atomic_wide_get(&src->msgs_sent);
     dst->msgs_rcvd += atomic_wide_get(&src->msgs_rcvd);
+    dst->msgs_lost += atomic_wide_get(&src->msgs_lost);
+    dst->msgs_reordered += atomic_wide_get(&src->msgs_reordered);
+    dst->msgs_duplicated += atomic_wide_get(&src->msgs_duplicated);
+    dst->conns_opened += atomic_wide_get(&src->conns_opened);
+    dst->conns_closed += atomic_wide_get(&src->conns_closed);
+    dst->echo_mismatches += atomic_wide_get(&src->echo_mismatches);
 }
 
 static UNUSED void
@@ -76,6 +94,32 @@ add_traffic_numbers_NtoA(const non_atomic_traffic_stats *src,
     atomic_add(&dst->num_reads, src->num_reads);
     atomic_add(&dst->msgs_sent, src->msgs_sent);
     atomic_add(&dst->msgs_rcvd, src->msgs_rcvd);
+    atomic_add(&dst->msgs_lost, src->msgs_lost);
+    atomic_add(&dst->msgs_reordered, src->msgs_reordered);
+    atomic_add(&dst->msgs_duplicated, src->msgs_duplicated);
+    atomic_add(&dst->conns_opened, src->conns_opened);
+    atomic_add(&dst->conns_closed, src->conns_closed);
+    atomic_add(&dst->echo_mismatches, src->echo_mismatches);
+}
+
+/*
+ * Add non-atomic traffic numbers to non-atomic. Mutates the (dst).
+ */
+static UNUSED void
+add_traffic_numbers_NtoN(const non_atomic_traffic_stats *src,
+                         non_atomic_traffic_stats *dst) {
+    dst->bytes_sent += src->bytes_sent;
+    dst->num_writes += src->num_writes;
+    dst->bytes_rcvd += src->bytes_rcvd;
+    dst->num_reads += src->num_reads;
+    dst->msgs_sent += src->msgs_sent;
+    dst->msgs_rcvd += src->msgs_rcvd;
+    dst->msgs_lost += src->msgs_lost;
+    dst->msgs_reordered += src->msgs_reordered;
+    dst->msgs_duplicated += src->msgs_duplicated;
+    dst->conns_opened += src->conns_opened;
+    dst->conns_closed += src->conns_closed;
+    dst->echo_mismatches += src->echo_mismatches;
 }
 
 /*
@@ -91,6 +135,12 @@ subtract_traffic_stats(const non_atomic_traffic_stats a,
     result.num_reads = a.num_reads - b.num_reads;
     result.msgs_sent = a.msgs_sent - b.msgs_sent;
     result.msgs_rcvd = a.msgs_rcvd - b.msgs_rcvd;
+    result.msgs_lost = a.msgs_lost - b.msgs_lost;
+    result.msgs_reordered = a.msgs_reordered - b.msgs_reordered;
+    result.msgs_duplicated = a.msgs_duplicated - b.msgs_duplicated;
+    result.conns_opened = a.conns_opened - b.conns_opened;
+    result.conns_closed = a.conns_closed - b.conns_closed;
+    result.echo_mismatches = a.echo_mismatches - b.echo_mismatches;
     return result;
 }
 
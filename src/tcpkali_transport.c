@@ -24,12 +24,17 @@
  * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <config.h>
+
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
 #include <assert.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 
 #include "tcpkali_data.h"
 #include "tcpkali_expr.h"
@@ -55,9 +60,41 @@ snippet_compare_cb(const void *ap, const void *bp) {
     return 0;
 }
 
+#ifdef HAVE_LIBZ
+/*
+ * RFC 7692, 7.2.1: compress the message on its own, as the client
+ * does not take over the context, and drop the trailing 00 00 ff ff.
+ */
+static void
+snippet_deflate(struct message_collection_snippet *snip) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    int ret = deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, -15, 8,
+                           Z_DEFAULT_STRATEGY);
+    assert(ret == Z_OK);
+
+    size_t allocated = deflateBound(&zs, snip->size) + 6;
+    unsigned char *out = malloc(allocated);
+    assert(out);
+    zs.next_in = (unsigned char *)snip->data;
+    zs.avail_in = snip->size;
+    zs.next_out = out;
+    zs.avail_out = allocated;
+    ret = deflate(&zs, Z_SYNC_FLUSH);
+    assert(ret == Z_OK && zs.avail_in == 0 && zs.avail_out > 0);
+    size_t size = allocated - zs.avail_out;
+    deflateEnd(&zs);
+
+    assert(size >= 4 && memcmp(out + size - 4, "\0\0\xff\xff", 4) == 0);
+    snip->deflated_data = (char *)out;
+    snip->deflated_size = size - 4;
+}
+#endif
+
 void
 message_collection_finalize(struct message_collection *mc, int as_websocket,
-                            const char *hostport, const char *path, const char *headers) {
+                            int ws_deflate, const char *hostport,
+                            const char *path, const char *headers) {
     const char ws_http_headers_fmt[] =
         "GET /%s HTTP/1.1\r\n"
         "Host: %s\r\n"
@@ -65,7 +102,11 @@ message_collection_finalize(struct message_collection *mc, int as_websocket,
         "Connection: Upgrade\r\n"
         "Sec-WebSocket-Key: x3JJHMbDL1EzLkh9GBhXDw==\r\n"
         "Sec-WebSocket-Version: 13\r\n"
-        "%s\r\n";
+        "%s%s\r\n";
+    const char *ws_extensions =
+        ws_deflate ? "Sec-WebSocket-Extensions: permessage-deflate; "
+                     "client_no_context_takeover\r\n"
+                   : "";
 
     assert(mc->state == MC_EMBRYONIC);
 
@@ -75,12 +116,29 @@ message_collection_finalize(struct message_collection *mc, int as_websocket,
         if(!headers) headers = "";
 
         ssize_t estimated_size = sizeof(ws_http_headers_fmt) + strlen(hostport)
-                                 + strlen(path) + strlen(headers);
+                                 + strlen(path) + strlen(ws_extensions)
+                                 + strlen(headers);
         char http_headers[estimated_size];
-        ssize_t h_size = snprintf(http_headers, estimated_size,
-                                  ws_http_headers_fmt, path, hostport, headers);
+        ssize_t h_size =
+            snprintf(http_headers, estimated_size, ws_http_headers_fmt, path,
+                     hostport, ws_extensions, headers);
         assert(h_size < estimated_size);
 
+#ifdef HAVE_LIBZ
+        /*
+         * The messages which never change are compressed just once.
+         * The rest goes out uncompressed, which RFC 7692 allows.
+         */
+        for(size_t i = 0; ws_deflate && i < mc->snippets_count; i++) {
+            struct message_collection_snippet *snip = &mc->snippets[i];
+            if((snip->flags & MSK_FRAMING_REQUESTED)
+               && !(snip->flags & MSK_EXPRESSION_FOUND))
+                snippet_deflate(snip);
+        }
+#else
+        assert(!ws_deflate);
+#endif
+
         const int NO_UNESCAPE = 0;
         const int PERFORM_EXPR_PARSING = 1;
         message_collection_add(mc, MSK_PURPOSE_HTTP_HEADER, http_headers,
@@ -96,6 +154,37 @@ message_collection_finalize(struct message_collection *mc, int as_websocket,
           snippet_compare_cb);
 }
 
+static void
+data_spec_add_marker(struct transport_data_spec *data, size_t offset) {
+    if(data->marker_count == data->marker_offsets_size) {
+        data->marker_offsets_size =
+            data->marker_offsets_size ? 2 * data->marker_offsets_size : 16;
+        data->marker_offsets =
+            realloc(data->marker_offsets, data->marker_offsets_size
+                                              * sizeof(data->marker_offsets[0]));
+        assert(data->marker_offsets);
+    }
+    assert(data->marker_count == 0
+           || data->marker_offsets[data->marker_count - 1] < offset);
+    data->marker_offsets[data->marker_count++] = offset;
+}
+
+static void
+data_spec_add_slot(struct transport_data_spec *data, size_t offset,
+                   enum tk_expr_type type) {
+    if(data->slot_count == data->slots_size) {
+        data->slots_size = data->slots_size ? 2 * data->slots_size : 16;
+        data->slots =
+            realloc(data->slots, data->slots_size * sizeof(data->slots[0]));
+        assert(data->slots);
+    }
+    assert(data->slot_count == 0
+           || data->slots[data->slot_count - 1].offset < offset);
+    data->slots[data->slot_count].offset = offset;
+    data->slots[data->slot_count].type = type;
+    data->slot_count++;
+}
+
 /*
  * If the payload is less then target_size,
  * replicate it several times so the total buffer exceeds target_size.
@@ -105,7 +194,6 @@ replicate_payload(struct transport_data_spec *data, size_t target_size) {
     size_t payload_size = data->total_size - data->once_size;
 
     assert(!(data->flags & TDS_FLAG_REPLICATED));
-    assert(data->marker_token_ptr == 0);    /* Can't be replicated */
 
     if(!payload_size) {
         /* Can't blow up an empty buffer. */
@@ -123,6 +211,24 @@ replicate_payload(struct transport_data_spec *data, size_t target_size) {
         for(size_t i = 1; i < n; i++) {
             memcpy(&p[once_offset + i * payload_size], msg_data, payload_size);
         }
+        /* The markers in the payload are replicated as well. */
+        size_t markers = data->marker_count;
+        for(size_t i = 1; i < n; i++) {
+            for(size_t m = 0; m < markers; m++) {
+                size_t off = data->marker_offsets[m];
+                if(off >= once_offset)
+                    data_spec_add_marker(data, off + i * payload_size);
+            }
+        }
+        size_t slots = data->slot_count;
+        for(size_t i = 1; i < n; i++) {
+            for(size_t s = 0; s < slots; s++) {
+                struct data_slot slot = data->slots[s];
+                if(slot.offset >= once_offset)
+                    data_spec_add_slot(data, slot.offset + i * payload_size,
+                                       slot.type);
+            }
+        }
         p[once_offset + new_payload_size] = '\0';
         data->ptr = p;
         data->total_size = once_offset + new_payload_size;
@@ -137,19 +243,41 @@ replicate_payload(struct transport_data_spec *data, size_t target_size) {
 }
 
 void
-message_collection_replicate(struct message_collection *mc_from, struct message_collection *mc_to) {
-    mc_to->snippets = malloc(sizeof(mc_from->snippets[0])*mc_from->snippets_size);
+message_collection_replace_messages(struct message_collection *mc_from,
+                                    struct message_collection *messages,
+                                    struct message_collection *mc_to) {
+    assert(mc_from->state != MC_EMBRYONIC);
+    assert(messages->state == MC_EMBRYONIC);
+
+    size_t size = mc_from->snippets_count + messages->snippets_count;
+    mc_to->snippets = calloc(size ? size : 1, sizeof(mc_to->snippets[0]));
+    assert(mc_to->snippets);
+    mc_to->snippets_size = size ? size : 1;
+    mc_to->snippets_count = 0;
+    mc_to->most_dynamic_expression = messages->most_dynamic_expression;
+
+    /* Keep the order: hdr > first_msg > msg. */
     for(size_t i = 0; i < mc_from->snippets_count; i++) {
         struct message_collection_snippet *snip = &mc_from->snippets[i];
-        mc_to->snippets[i].data = snip->data;
-        mc_to->snippets[i].size = snip->size;
-        mc_to->snippets[i].expr = replicate_expression(snip->expr);
-        mc_to->snippets[i].flags = snip->flags;
-        mc_to->snippets[i].sort_index =  snip->sort_index;
+        if(MSK_PURPOSE(snip) == MSK_PURPOSE_MESSAGE) continue;
+        struct message_collection_snippet *to =
+            &mc_to->snippets[mc_to->snippets_count];
+        *to = *snip;
+        to->expr = replicate_expression(snip->expr);
+        to->sort_index = mc_to->snippets_count++;
+        if(to->expr
+           && mc_to->most_dynamic_expression < to->expr->dynamic_scope)
+            mc_to->most_dynamic_expression = to->expr->dynamic_scope;
+    }
+    for(size_t i = 0; i < messages->snippets_count; i++) {
+        struct message_collection_snippet *to =
+            &mc_to->snippets[mc_to->snippets_count];
+        *to = messages->snippets[i];
+        to->sort_index = mc_to->snippets_count++;
     }
-    mc_to->snippets_size = mc_from->snippets_size;
-    mc_to->snippets_count = mc_from->snippets_count;
-    mc_to->most_dynamic_expression = mc_from->most_dynamic_expression;
+
+    free(messages->snippets);
+    memset(messages, 0, sizeof(*messages));
     mc_to->state = mc_from->state;
 }
 
@@ -240,6 +368,9 @@ message_collection_add(struct message_collection *mc, enum mc_snippet_kind kind,
             /* Just use the snip->data instead. */
             mc->snippets_count++;
         } else {
+            /* The expression has the copies of the data it needs. */
+            free(snip->data);
+            snip->data = 0;
             message_collection_add_expr(mc, kind, expr);
         }
     } else {
@@ -248,6 +379,36 @@ message_collection_add(struct message_collection *mc, enum mc_snippet_kind kind,
     }
 }
 
+int
+message_collection_add_shared(struct message_collection *mc,
+                              enum mc_snippet_kind kind, const void *data,
+                              size_t size, int fd) {
+    assert(mc->state == MC_EMBRYONIC);
+    assert(kind == MSK_PURPOSE_FIRST_MSG || kind == MSK_PURPOSE_MESSAGE);
+
+    /* Only "\{" starts an expression, everything else is literal data. */
+    const char *p = data;
+    const char *end = p + size;
+    while((p = memchr(p, '\\', end - p)) && p + 1 < end) {
+        if(p[1] == '{') return -1;
+        p++;
+    }
+
+    message_collection_ensure_space(mc, 1);
+
+    struct message_collection_snippet *snip;
+    snip = &mc->snippets[mc->snippets_count];
+    snip->data = (char *)data;
+    snip->size = size;
+    snip->data_fd = fd;
+    snip->expr = 0;
+    snip->flags = kind | MSK_FRAMING_REQUESTED | MSK_DATA_SHARED;
+    snip->sort_index = mc->snippets_count;
+    mc->snippets_count++;
+
+    return 0;
+}
+
 void
 message_collection_add_expr(struct message_collection *mc,
                             enum mc_snippet_kind kind, struct tk_expr *expr) {
@@ -265,6 +426,7 @@ message_collection_add_expr(struct message_collection *mc,
         snip->sort_index = mc->snippets_count;
 
         if(result.esw_prefix) {
+            compile_expression(result.esw_prefix);
             snip->expr = result.esw_prefix;
             snip->flags = kind;
             if(!(snip->flags & MSK_PURPOSE_HTTP_HEADER))
@@ -363,6 +525,23 @@ message_collection_estimate_size(struct message_collection *mc,
             } else {
                 snippet_size += snip->expr->estimate_size;
             }
+        } else if(snip->deflated_data && ws_enable) {
+            /* Only the client sends the compressed messages. */
+            size_t client_size = snip->deflated_size;
+            switch(mce) {
+            case MCE_MAXIMUM_SIZE:
+                snippet_size += snip->size > client_size ? snip->size
+                                                         : client_size;
+                break;
+            case MCE_AVERAGE_SIZE:
+                snippet_size +=
+                    ws_side == WS_SIDE_CLIENT ? client_size : snip->size;
+                break;
+            case MCE_MINIMUM_SIZE:
+                snippet_size += snip->size < client_size ? snip->size
+                                                         : client_size;
+                break;
+            }
         } else {
             snippet_size += snip->size;
         }
@@ -386,25 +565,41 @@ message_collection_has(const struct message_collection *mc, enum tk_expr_type t)
     return 0;
 }
 
+long
+message_collection_connection_period(const struct message_collection *mc,
+                                     long limit) {
+    long period = 1;
+
+    for(size_t i = 0; i < mc->snippets_count; i++) {
+        period = expression_connection_period(mc->snippets[i].expr, period,
+                                              limit);
+    }
+
+    return period;
+}
+
 typedef struct {
     expr_callback_f *original_callback;
     void *original_key;
-    void **marker_ptr_ptr;
-    int multiple_message_markers;
+    struct transport_data_spec *data_spec;
 } callback_wrapper_key_t;
 static ssize_t
 callback_wrapper(char *buf, size_t size, tk_expr_t *expr, void *key,
                  long *output_value) {
     callback_wrapper_key_t *wkey = key;
 
-    if(expr->type == EXPR_MESSAGE_MARKER) {
-        if(!*wkey->marker_ptr_ptr && !wkey->multiple_message_markers) {
-            *wkey->marker_ptr_ptr = buf;
-        } else {
-            /* Use more generic (slow) scanning algorithm later */
-            wkey->multiple_message_markers = 1;
-            *wkey->marker_ptr_ptr = 0;
-        }
+    switch(expr->type) {
+    case EXPR_MESSAGE_MARKER:
+        data_spec_add_marker(wkey->data_spec,
+                             buf - (char *)wkey->data_spec->ptr);
+        break;
+    case EXPR_MESSAGE_SEQ:
+    case EXPR_TIME_US:
+        data_spec_add_slot(wkey->data_spec,
+                           buf - (char *)wkey->data_spec->ptr, expr->type);
+        break;
+    default:
+        break;
     }
 
     return wkey->original_callback(buf, size, expr, wkey->original_key,
@@ -436,6 +631,24 @@ transport_spec_from_message_collection(struct transport_data_spec *out_spec,
     enum websocket_side ws_side =
         (tws_side == TWS_SIDE_CLIENT) ? WS_SIDE_CLIENT : WS_SIDE_SERVER;
 
+    /*
+     * A large mapped --message-file is sent right from the mapping,
+     * shared by all connections.
+     */
+    if(tconv == TS_CONVERSION_INITIAL && mc->state == MC_FINALIZED_PLAIN_TCP
+       && mc->snippets_count == 1
+       && (mc->snippets[0].flags & MSK_DATA_SHARED)
+       && MSK_PURPOSE(&mc->snippets[0]) == MSK_PURPOSE_MESSAGE
+       && mc->snippets[0].size >= REPLICATE_MAX_SIZE) {
+        data_spec->ptr = mc->snippets[0].data;
+        data_spec->allocated_size = mc->snippets[0].size;
+        data_spec->total_size = mc->snippets[0].size;
+        data_spec->single_message_size = mc->snippets[0].size;
+        data_spec->flags |= TDS_FLAG_PTR_SHARED | TDS_FLAG_BODY_IN_FILE;
+        data_spec->body_fd = mc->snippets[0].data_fd;
+        return data_spec;
+    }
+
     if(tconv == TS_CONVERSION_INITIAL) {
         size_t estimate_size =
             message_collection_estimate_size(mc, 0, 0, MCE_MAXIMUM_SIZE, ws_side, 1);
@@ -448,15 +661,35 @@ transport_spec_from_message_collection(struct transport_data_spec *out_spec,
         assert(data_spec);
         assert(data_spec->ptr);
         data_spec->total_size = data_spec->once_size;
+        /* Forget the markers in the messages we are about to override. */
+        while(data_spec->marker_count
+              && data_spec->marker_offsets[data_spec->marker_count - 1]
+                     >= data_spec->once_size)
+            data_spec->marker_count--;
+        while(data_spec->slot_count
+              && data_spec->slots[data_spec->slot_count - 1].offset
+                     >= data_spec->once_size)
+            data_spec->slot_count--;
     }
 
     callback_wrapper_key_t callback_key = {.original_callback = optional_cb,
-                                           .original_key = expr_cb_key};
+                                           .original_key = expr_cb_key,
+                                           .data_spec = data_spec};
 
     int place_multiple_messages = 0;
+    int messages_placed = 0;
 
     do { /* while(place_multiple_messages) */
 
+        /*
+         * A message which does not fit completely is dropped,
+         * otherwise its head would be sent without its tail.
+         */
+        size_t round_total_size = data_spec->total_size;
+        size_t round_marker_count = data_spec->marker_count;
+        size_t round_slot_count = data_spec->slot_count;
+        size_t round_message_size = data_spec->single_message_size;
+
         if(tconv == TS_CONVERSION_OVERRIDE_MESSAGES) {
             /* We'll rebuild the message anew */
             data_spec->single_message_size = 0;
@@ -468,6 +701,13 @@ transport_spec_from_message_collection(struct transport_data_spec *out_spec,
 
             void *data = snip->data;
             size_t size = snip->size;
+            int ws_rsvs = 0;
+            if(snip->deflated_data && ws_side == WS_SIDE_CLIENT
+               && !(snip->flags & MSK_EXPRESSION_FOUND)) {
+                data = snip->deflated_data;
+                size = snip->deflated_size;
+                ws_rsvs = WS_RSV1_COMPRESSED;
+            }
 
             if(tconv == TS_CONVERSION_OVERRIDE_MESSAGES) {
                 if(MSK_PURPOSE(snip) == MSK_PURPOSE_MESSAGE)
@@ -477,7 +717,8 @@ transport_spec_from_message_collection(struct transport_data_spec *out_spec,
             }
 
             size_t estimate_ws_frame_size = 0;
-            void *marker_ptr = 0;
+            size_t snippet_markers = data_spec->marker_count;
+            size_t snippet_slots = data_spec->slot_count;
 
             if(snip->flags & MSK_EXPRESSION_FOUND) {
                 ssize_t reified_size;
@@ -487,6 +728,12 @@ transport_spec_from_message_collection(struct transport_data_spec *out_spec,
                    > data_spec->allocated_size) {
                     assert(tconv == TS_CONVERSION_OVERRIDE_MESSAGES);
                     place_multiple_messages = 0;
+                    if(messages_placed) {
+                        data_spec->total_size = round_total_size;
+                        data_spec->marker_count = round_marker_count;
+                        data_spec->slot_count = round_slot_count;
+                        data_spec->single_message_size = round_message_size;
+                    }
                     break;
                 }
                 if(mc->state == MC_FINALIZED_WEBSOCKET
@@ -497,33 +744,26 @@ transport_spec_from_message_collection(struct transport_data_spec *out_spec,
                         snip->expr->estimate_size);
                     tptr += estimate_ws_frame_size;
                 }
-                callback_key.marker_ptr_ptr = &marker_ptr;
                 reified_size = eval_expression(
                     (char **)&tptr,
                     data_spec->allocated_size
                         - (data_spec->total_size + estimate_ws_frame_size),
                     snip->expr, callback_wrapper, &callback_key, 0,
                     (tws_side == TWS_SIDE_CLIENT), rng);
-                if(callback_key.multiple_message_markers) {
-                    data_spec->marker_token_ptr = 0;
-                    marker_ptr = 0;
-                } else if(marker_ptr) {
-                    if(data_spec->marker_token_ptr) {
-                        callback_key.multiple_message_markers = 1;
-                        data_spec->marker_token_ptr = 0;
-                        marker_ptr = 0;
-                    } else {
-                        data_spec->marker_token_ptr = marker_ptr;
-                    }
-                }
                 assert(reified_size >= 0);
                 data = 0;
                 size = reified_size;
             } else {
-                if(data_spec->total_size + snip->size
+                if(data_spec->total_size + size
                    > data_spec->allocated_size) {
                     assert(tconv == TS_CONVERSION_OVERRIDE_MESSAGES);
                     place_multiple_messages = 0;
+                    if(messages_placed) {
+                        data_spec->total_size = round_total_size;
+                        data_spec->marker_count = round_marker_count;
+                        data_spec->slot_count = round_slot_count;
+                        data_spec->single_message_size = round_message_size;
+                    }
                     break;
                 }
             }
@@ -532,8 +772,11 @@ transport_spec_from_message_collection(struct transport_data_spec *out_spec,
             if(mc->state == MC_FINALIZED_WEBSOCKET) {
                 /* Do not construct WebSocket/HTTP header. */
                 if((ws_side == WS_SIDE_SERVER)
-                   && (snip->flags & MSK_PURPOSE_HTTP_HEADER))
+                   && (snip->flags & MSK_PURPOSE_HTTP_HEADER)) {
+                    data_spec->marker_count = snippet_markers;
+                    data_spec->slot_count = snippet_slots;
                     continue;
+                }
 
                 if(snip->flags & MSK_FRAMING_REQUESTED) {
                     if(snip->flags & MSK_EXPRESSION_FOUND) {
@@ -559,16 +802,22 @@ transport_spec_from_message_collection(struct transport_data_spec *out_spec,
                                         + data_spec->total_size
                                         + estimate_ws_frame_size,
                                     size);
-                            if(marker_ptr) {
-                                marker_ptr -= estimate_ws_frame_size - ws_frame_size;
-                                data_spec->marker_token_ptr = marker_ptr;
+                            for(size_t m = snippet_markers;
+                                m < data_spec->marker_count; m++) {
+                                data_spec->marker_offsets[m] -=
+                                    estimate_ws_frame_size - ws_frame_size;
+                            }
+                            for(size_t s = snippet_slots;
+                                s < data_spec->slot_count; s++) {
+                                data_spec->slots[s].offset -=
+                                    estimate_ws_frame_size - ws_frame_size;
                             }
                         }
                     } else {
                         ws_frame_size = websocket_frame_header(
                             (uint8_t *)data_spec->ptr + data_spec->total_size,
                             data_spec->allocated_size - data_spec->total_size,
-                            ws_side, WS_OP_TEXT_FRAME, 0, 1, size);
+                            ws_side, WS_OP_TEXT_FRAME, ws_rsvs, 1, size);
                     }
                 }
             }
@@ -582,6 +831,12 @@ transport_spec_from_message_collection(struct transport_data_spec *out_spec,
                            + ws_frame_size,
                        data, size);
             }
+            if(ws_frame_size && ws_side == WS_SIDE_CLIENT) {
+                websocket_mask_payload((uint8_t *)data_spec->ptr
+                                           + data_spec->total_size
+                                           + ws_frame_size,
+                                       size);
+            }
             data_spec->total_size += framed_snippet_size;
 
             switch(MSK_PURPOSE(snip)) {
@@ -601,10 +856,30 @@ transport_spec_from_message_collection(struct transport_data_spec *out_spec,
             }
         }
 
+        messages_placed++;
     } while(place_multiple_messages);
 
     assert(data_spec->total_size <= data_spec->allocated_size);
     ((char *)data_spec->ptr)[data_spec->total_size] = '\0';
 
+    /*
+     * The mapped file placed as the only message is repeated as is,
+     * so the messages can be sent from the file itself.
+     */
+    if(tconv == TS_CONVERSION_INITIAL && mc->state == MC_FINALIZED_PLAIN_TCP) {
+        const struct message_collection_snippet *body = NULL;
+        size_t messages = 0;
+        for(size_t i = 0; i < mc->snippets_count; i++) {
+            if(MSK_PURPOSE(&mc->snippets[i]) != MSK_PURPOSE_MESSAGE) continue;
+            body = &mc->snippets[i];
+            messages++;
+        }
+        if(messages == 1 && (body->flags & MSK_DATA_SHARED)
+           && body->size >= REPLICATE_MAX_SIZE) {
+            data_spec->flags |= TDS_FLAG_BODY_IN_FILE;
+            data_spec->body_fd = body->data_fd;
+        }
+    }
+
     return data_spec;
 }
@@ -40,6 +40,7 @@ struct message_collection {
     struct message_collection_snippet {
         char *data;
         size_t size;
+        int data_fd; /* The file mapped as MSK_DATA_SHARED (data) */
         struct tk_expr *expr;
         enum mc_snippet_kind {
             /* Whether to add WebSocket framing, if needed */
@@ -48,10 +49,14 @@ struct message_collection {
             MSK_PURPOSE_MESSAGE = 0x04,     /* --message, *-file */
             MSK_FRAMING_REQUESTED = 0x10,   /* msg needs framing, hdr doesn't */
             MSK_FRAMING_ASSERTED = 0x20,    /* msg will be framed */
-            MSK_EXPRESSION_FOUND = 0x40     /* Expression */
+            MSK_EXPRESSION_FOUND = 0x40,    /* Expression */
+            MSK_DATA_SHARED = 0x80          /* .data is mapped, not owned */
 #define MSK_PURPOSE(snippet) ((snippet)->flags & 0x0f)
         } flags;
         int sort_index;
+        /* The client frame payload, compressed by --ws-deflate. */
+        char *deflated_data;
+        size_t deflated_size;
     } * snippets;
     /*
      * Number of --first-message, --message, etc
@@ -86,6 +91,20 @@ void message_collection_add(struct message_collection *mc, enum mc_snippet_kind,
                             void *data, size_t size, int unescape,
                             int parse_expressions);
 
+/*
+ * Add a read-only data region, such as a mapped --message-file,
+ * into the message collection. The data is referenced and not copied,
+ * so it must outlive the collection. The (fd) of the mapped file is
+ * kept to send the data with sendfile(2).
+ * RETURN VALUES:
+ *   0: data is added,
+ *  -1: data contains \{expressions} and must be added via
+ *      message_collection_add() instead.
+ */
+int message_collection_add_shared(struct message_collection *mc,
+                                  enum mc_snippet_kind, const void *data,
+                                  size_t size, int fd);
+
 /*
  * Add a new expression to the message collection.
  * The function takes over the expression pointer.
@@ -96,10 +115,12 @@ void message_collection_add_expr(struct message_collection *mc,
 /*
  * Finalize the collection, preventing new data to be added,
  * and adding websocket related messages details.
+ * With (ws_deflate), the permessage-deflate extension is requested
+ * and the static messages are compressed for the client once, here.
  */
 void message_collection_finalize(struct message_collection *, int as_websocket,
-                                 const char *hostport, const char *path,
-                                 const char *headers);
+                                 int ws_deflate, const char *hostport,
+                                 const char *path, const char *headers);
 
 /*
  * Recursively figure out if message collection contains the
@@ -108,6 +129,14 @@ void message_collection_finalize(struct message_collection *, int as_websocket,
  */
 int message_collection_has(const struct message_collection *, enum tk_expr_type);
 
+/*
+ * The number of consecutive \{connection.uid} values after which the
+ * collection evaluates to the same data again, or 0 if it exceeds the
+ * (limit), see expression_connection_period().
+ */
+long message_collection_connection_period(const struct message_collection *,
+                                          long limit);
+
 /*
  * Estimate the size of the snippets of the specified kind (and mask).
  * Works on a finalized message collection.
@@ -134,12 +163,36 @@ struct transport_data_spec {
     size_t total_size;
     size_t allocated_size;
     size_t single_message_size;
-    void *marker_token_ptr;
+    /*
+     * Offsets of the \{message.marker} tokens within (ptr), ascending.
+     * Lets the sender patch in timestamps without searching for tokens.
+     */
+    size_t *marker_offsets;
+    size_t marker_count;
+    size_t marker_offsets_size;
+    /*
+     * The \{message.seq} and \{time.us} values within (ptr), ascending.
+     * Rewritten in place as the data is sent, instead of rebuilding
+     * the messages.
+     */
+    struct data_slot {
+        size_t offset;
+        enum tk_expr_type type; /* EXPR_MESSAGE_SEQ or EXPR_TIME_US */
+    } *slots;
+    size_t slot_count;
+    size_t slots_size;
     enum transport_data_flags {
         TDS_FLAG_NONE = 0x00,
         TDS_FLAG_PTR_SHARED = 0x01, /* Disallow freeing .ptr field */
         TDS_FLAG_REPLICATED = 0x02, /* total_size >= once_ + single_message_ */
+        TDS_FLAG_BODY_IN_FILE = 0x04, /* The messages are in (body_fd) */
+        TDS_FLAG_PTR_HUGE = 0x08, /* .ptr is in the --hugepages arena */
     } flags;
+    /*
+     * With TDS_FLAG_BODY_IN_FILE, the file contains the data
+     * past (once_size), and can be sent with sendfile(2).
+     */
+    int body_fd;
 };
 
 #define REPLICATE_MAX_SIZE (64 * 1024 - 1) /* Proven to be a sweet spot */
@@ -171,11 +224,15 @@ void replicate_payload(struct transport_data_spec *data,
                        size_t target_payload_size);
 
 /*
- * Replicate snippets (need to replicate expressions)
- * it does not copy data
+ * Make (mc_to) a copy of the finalized (mc_from), with the --message
+ * snippets replaced by the ones of the embryonic collection (messages),
+ * which gives them up. The expressions of the other snippets are
+ * replicated, without the data.
+ * The new messages are not compressed by --ws-deflate.
  */
-void message_collection_replicate(struct message_collection *mc_from,
-                                  struct message_collection *mc_to);
+void message_collection_replace_messages(struct message_collection *mc_from,
+                                         struct message_collection *messages,
+                                         struct message_collection *mc_to);
 
 void message_collection_free(struct message_collection *mc);
 
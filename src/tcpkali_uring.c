@@ -0,0 +1,1176 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <config.h>
+
+#ifdef HAVE_IO_URING
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sysexits.h>
+#include <assert.h>
+
+#include <linux/io_uring.h>
+
+#include "tcpkali_uring.h"
+
+/*
+ * Submission queue is flushed into the kernel when full, so it does not
+ * need to be large. Completions may be delivered for every connection
+ * at once, so the completion queue is sized for a large burst.
+ */
+#define TK_URING_SQ_ENTRIES 4096
+#define TK_URING_CQ_ENTRIES 65536
+
+/* user_data of requests whose completions are of no interest. */
+#define TK_URING_NOOP (~(uint64_t)0)
+
+/*
+ * The two upper bits of user_data tell the kind of request: a poll or
+ * a receive, identified by the file descriptor and its generation, or
+ * a send, identified by its struct tk_uring_send.
+ */
+#define TK_URING_POLL_TAG ((uint64_t)0 << 62)
+#define TK_URING_RECV_TAG ((uint64_t)1 << 62)
+#define TK_URING_SEND_TAG ((uint64_t)2 << 62)
+#define TK_URING_TAG_MASK ((uint64_t)3 << 62)
+#define TK_URING_GEN_MASK 0x3fffffff
+
+/*
+ * The receive buffers provided to the kernel, shared by the sockets of
+ * a loop, see tk_uring_io_stream(). The kernel picks the next buffer for
+ * every chunk it receives; the buffer is given back once read out.
+ * A socket stops receiving with TK_URING_RECV_MAX bytes not yet read,
+ * and the writes block with TK_URING_SEND_MAX bytes queued, in addition
+ * to the ones being sent.
+ */
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_CQE_F_BUFFER)
+#define TK_URING_STREAMS
+#define TK_URING_BUFS 1024 /* Power of 2 */
+#define TK_URING_BUF_SIZE 16384
+#define TK_URING_BGID 0
+#endif
+#define TK_URING_RECV_MAX (256 * 1024)
+#define TK_URING_SEND_MAX (256 * 1024)
+
+/*
+ * The data queued for sending, and then being sent, in order.
+ */
+struct tk_uring_send {
+    int fd;
+    uint32_t stream_gen;
+    int submitted; /* IORING_OP_SEND is in progress */
+    size_t size;
+    size_t offset; /* Sent already */
+    size_t allocated;
+    char data[];
+};
+
+/*
+ * A completion reaped ahead of its processing, see uring_submit_all().
+ */
+struct tk_uring_cqe_saved {
+    uint64_t user_data;
+    int32_t res;
+    uint32_t flags;
+};
+
+/*
+ * The completion could arrive after the watcher for a file descriptor
+ * has been stopped and freed. For that reason completions refer to the
+ * file descriptor and its generation, not to the watcher itself.
+ */
+struct tk_uring_fd {
+    tk_uring_io *w;
+    uint32_t gen; /* Incremented each time the watcher is stopped */
+    unsigned armed : 1;  /* POLL_ADD is submitted or queued */
+    unsigned queued : 1; /* Listed in the loop's changes[] */
+    /* The state of tk_uring_io_stream() sockets. */
+    unsigned stream : 1;
+    unsigned ready : 1;       /* Listed in the loop's ready[] */
+    unsigned recv_armed : 1;  /* Multishot IORING_OP_RECV is in progress */
+    unsigned recv_cancel : 1; /* ...and is being cancelled */
+    unsigned recv_eof : 1;
+    unsigned draining : 1; /* close(2) it once the data is sent, see below */
+    int recv_error;
+    int send_error;
+    uint32_t stream_gen; /* Incremented each time the socket is closed */
+    int32_t rx_head;     /* Received buffers, linked through buf_next[] */
+    int32_t rx_tail;
+    uint32_t rx_offset; /* Read already from the rx_head buffer */
+    size_t rx_bytes;
+    struct tk_uring_send *tx_inflight;
+    struct tk_uring_send *tx_pending; /* Queued behind the tx_inflight */
+};
+
+struct tk_uring_loop {
+    int ring_fd;
+
+    /* Submission ring. */
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sq_local_tail; /* Not yet published to the kernel */
+    struct io_uring_sqe *sqes;
+
+    /* Completion ring. */
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+    struct tk_uring_cqe_saved *cq_saved;
+    size_t cq_saved_count;
+    size_t cq_saved_size;
+
+    void *sq_ring_ptr;
+    size_t sq_ring_size;
+    void *cq_ring_ptr;
+    size_t cq_ring_size;
+    size_t sqes_size;
+
+    struct tk_uring_fd *fds;
+    size_t fds_size;
+
+    /* File descriptors which may need their poll requests (re)armed. */
+    int *changes;
+    size_t changes_count;
+    size_t changes_size;
+
+    /* Stream sockets with the received data for their watchers. */
+    int *ready;
+    size_t ready_count;
+    size_t ready_size;
+
+    /* The provided receive buffers ring, see TK_URING_BUFS. */
+    int recv_multishot; /* 1: set up, 0: not yet, -1: not supported */
+    struct io_uring_buf_ring *buf_ring;
+    char *bufs;
+    uint32_t *buf_len;  /* Received into the buffer */
+    int32_t *buf_next;  /* Next buffer received by the same socket, or -1 */
+    uint16_t buf_tail;
+    unsigned bufs_free; /* Given to the kernel */
+
+    /* Min-heap of active timers, 1-based. */
+    tk_uring_timer **timers;
+    size_t timers_count;
+    size_t timers_size;
+
+    size_t active_ios;
+    int break_requested;
+    double now;
+    void *userdata;
+};
+
+/* The loop running in this thread, for tk_uring_read() and friends. */
+static __thread struct tk_uring_loop *tk_uring_current;
+
+static inline uint64_t
+fd_user_data(int fd, uint32_t gen) {
+    return ((uint64_t)(gen & TK_URING_GEN_MASK) << 32) | (uint32_t)fd;
+}
+
+static void
+uring_fatal(const char *what) {
+    fprintf(stderr, "io_uring: %s: %s\n", what, strerror(errno));
+    exit(EX_UNAVAILABLE);
+}
+
+void
+tk_uring_now_update(struct tk_uring_loop *loop) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    loop->now = ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+double
+tk_uring_now(struct tk_uring_loop *loop) {
+    return loop->now;
+}
+
+void *
+tk_uring_userdata(struct tk_uring_loop *loop) {
+    return loop->userdata;
+}
+
+void
+tk_uring_set_userdata(struct tk_uring_loop *loop, void *data) {
+    loop->userdata = data;
+}
+
+void
+tk_uring_break(struct tk_uring_loop *loop) {
+    loop->break_requested = 1;
+}
+
+struct tk_uring_loop *
+tk_uring_default_loop() {
+    static struct tk_uring_loop default_loop = {.ring_fd = -1};
+    if(default_loop.now == 0.0) tk_uring_now_update(&default_loop);
+    return &default_loop;
+}
+
+struct tk_uring_loop *
+tk_uring_loop_new() {
+    struct tk_uring_loop *loop = calloc(1, sizeof(*loop));
+    assert(loop);
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = TK_URING_CQ_ENTRIES;
+    loop->ring_fd = syscall(__NR_io_uring_setup, TK_URING_SQ_ENTRIES, &p);
+    if(loop->ring_fd == -1) uring_fatal("io_uring_setup");
+    if(!(p.features & IORING_FEAT_EXT_ARG)
+       || !(p.features & IORING_FEAT_NODROP)) {
+        fprintf(stderr,
+                "io_uring: kernel is too old, Linux 5.11+ is required\n");
+        exit(EX_UNAVAILABLE);
+    }
+
+    loop->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    loop->cq_ring_size =
+        p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if(p.features & IORING_FEAT_SINGLE_MMAP) {
+        if(loop->cq_ring_size > loop->sq_ring_size)
+            loop->sq_ring_size = loop->cq_ring_size;
+        loop->cq_ring_size = 0;
+    }
+
+    loop->sq_ring_ptr =
+        mmap(0, loop->sq_ring_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, loop->ring_fd, IORING_OFF_SQ_RING);
+    if(loop->sq_ring_ptr == MAP_FAILED) uring_fatal("mmap");
+    if(loop->cq_ring_size) {
+        loop->cq_ring_ptr =
+            mmap(0, loop->cq_ring_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, loop->ring_fd, IORING_OFF_CQ_RING);
+        if(loop->cq_ring_ptr == MAP_FAILED) uring_fatal("mmap");
+    } else {
+        loop->cq_ring_ptr = loop->sq_ring_ptr;
+    }
+    loop->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    loop->sqes = mmap(0, loop->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, loop->ring_fd, IORING_OFF_SQES);
+    if(loop->sqes == MAP_FAILED) uring_fatal("mmap");
+
+    char *sq = loop->sq_ring_ptr;
+    loop->sq_head = (unsigned *)(sq + p.sq_off.head);
+    loop->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    loop->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    loop->sq_entries = *(unsigned *)(sq + p.sq_off.ring_entries);
+    loop->sq_local_tail = *loop->sq_tail;
+    /* The index array is an identity mapping to the sqes[]. */
+    unsigned *sq_array = (unsigned *)(sq + p.sq_off.array);
+    for(unsigned i = 0; i < loop->sq_entries; i++) sq_array[i] = i;
+
+    char *cq = loop->cq_ring_ptr;
+    loop->cq_head = (unsigned *)(cq + p.cq_off.head);
+    loop->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    loop->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    loop->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    tk_uring_now_update(loop);
+
+    return loop;
+}
+
+/*
+ * Publish the queued submissions and optionally wait for completions.
+ * Returns -1 if the kernel would not take the submissions just yet.
+ */
+static int
+uring_enter(struct tk_uring_loop *loop, int wait, double timeout) {
+    __atomic_store_n(loop->sq_tail, loop->sq_local_tail, __ATOMIC_RELEASE);
+
+    for(;;) {
+        unsigned to_submit = loop->sq_local_tail
+                             - __atomic_load_n(loop->sq_head, __ATOMIC_ACQUIRE);
+        if(to_submit == 0 && !wait) return 0;
+
+        struct __kernel_timespec ts;
+        ts.tv_sec = (int64_t)timeout;
+        ts.tv_nsec = (long long)((timeout - ts.tv_sec) * 1000000000.0);
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+
+        unsigned flags = IORING_ENTER_EXT_ARG;
+        if(wait) flags |= IORING_ENTER_GETEVENTS;
+        int rc = syscall(__NR_io_uring_enter, loop->ring_fd, to_submit,
+                         wait ? 1 : 0, flags, &arg, sizeof(arg));
+        if(rc >= 0) return 0;
+        switch(errno) {
+        case ETIME:
+            return 0;
+        case EINTR:
+            continue;
+        case EAGAIN:
+        case EBUSY:
+            /* Completion queue overflow, reap completions first. */
+            return -1;
+        default:
+            uring_fatal("io_uring_enter");
+        }
+    }
+}
+
+static inline unsigned
+uring_sq_pending(struct tk_uring_loop *loop) {
+    return loop->sq_local_tail
+           - __atomic_load_n(loop->sq_head, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Move the completions out of the completion queue, to be processed
+ * later by uring_process_completions(). Returns the number moved.
+ */
+static size_t
+uring_save_completions(struct tk_uring_loop *loop) {
+    unsigned head = *loop->cq_head;
+    unsigned tail = __atomic_load_n(loop->cq_tail, __ATOMIC_ACQUIRE);
+    size_t n = tail - head;
+
+    if(loop->cq_saved_count + n > loop->cq_saved_size) {
+        size_t new_size = loop->cq_saved_size ? 2 * loop->cq_saved_size : 256;
+        while(new_size < loop->cq_saved_count + n) new_size *= 2;
+        loop->cq_saved =
+            realloc(loop->cq_saved, new_size * sizeof(loop->cq_saved[0]));
+        assert(loop->cq_saved);
+        loop->cq_saved_size = new_size;
+    }
+    for(; head != tail; head++) {
+        struct io_uring_cqe *cqe = &loop->cqes[head & loop->cq_mask];
+        struct tk_uring_cqe_saved *saved =
+            &loop->cq_saved[loop->cq_saved_count++];
+        saved->user_data = cqe->user_data;
+        saved->res = cqe->res;
+        saved->flags = cqe->flags;
+    }
+    __atomic_store_n(loop->cq_head, tail, __ATOMIC_RELEASE);
+    return n;
+}
+
+/*
+ * Hand all the queued submissions over to the kernel. No callbacks are
+ * called meanwhile: the completions making room are set aside instead.
+ */
+static void
+uring_submit_all(struct tk_uring_loop *loop) {
+    while(uring_sq_pending(loop)) {
+        if(uring_enter(loop, 0, 0) == 0) continue;
+        /* The completion queue is full, or the kernel is short of memory. */
+        if(uring_save_completions(loop) == 0) sched_yield();
+    }
+}
+
+static struct io_uring_sqe *
+uring_get_sqe(struct tk_uring_loop *loop) {
+    if(uring_sq_pending(loop) >= loop->sq_entries) uring_submit_all(loop);
+    struct io_uring_sqe *sqe =
+        &loop->sqes[loop->sq_local_tail & loop->sq_mask];
+    loop->sq_local_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+static struct tk_uring_fd *
+uring_fd_slot(struct tk_uring_loop *loop, int fd) {
+    assert(fd >= 0);
+    if((size_t)fd >= loop->fds_size) {
+        size_t new_size = loop->fds_size ? 2 * loop->fds_size : 1024;
+        while(new_size <= (size_t)fd) new_size *= 2;
+        struct tk_uring_fd *fds =
+            realloc(loop->fds, new_size * sizeof(loop->fds[0]));
+        assert(fds);
+        memset(&fds[loop->fds_size], 0,
+               (new_size - loop->fds_size) * sizeof(fds[0]));
+        loop->fds = fds;
+        loop->fds_size = new_size;
+    }
+    return &loop->fds[fd];
+}
+
+static void
+uring_queue_change(struct tk_uring_loop *loop, int fd) {
+    struct tk_uring_fd *slot = &loop->fds[fd];
+    if(slot->queued) return;
+    slot->queued = 1;
+    if(loop->changes_count == loop->changes_size) {
+        loop->changes_size = loop->changes_size ? 2 * loop->changes_size : 256;
+        loop->changes =
+            realloc(loop->changes, loop->changes_size * sizeof(int));
+        assert(loop->changes);
+    }
+    loop->changes[loop->changes_count++] = fd;
+}
+
+#ifdef TK_URING_STREAMS
+
+static inline int
+uring_rx_pending(const struct tk_uring_fd *slot) {
+    return slot->rx_head != -1 || slot->recv_eof || slot->recv_error
+           || slot->send_error;
+}
+
+static struct tk_uring_fd *
+uring_stream_slot(struct tk_uring_loop *loop, int fd) {
+    if(loop == NULL || fd < 0 || (size_t)fd >= loop->fds_size) return NULL;
+    struct tk_uring_fd *slot = &loop->fds[fd];
+    return slot->stream ? slot : NULL;
+}
+
+static void
+uring_mark_ready(struct tk_uring_loop *loop, int fd) {
+    struct tk_uring_fd *slot = &loop->fds[fd];
+    if(slot->ready) return;
+    slot->ready = 1;
+    if(loop->ready_count == loop->ready_size) {
+        loop->ready_size = loop->ready_size ? 2 * loop->ready_size : 256;
+        loop->ready = realloc(loop->ready, loop->ready_size * sizeof(int));
+        assert(loop->ready);
+    }
+    loop->ready[loop->ready_count++] = fd;
+}
+
+/*
+ * Give the buffer back to the kernel.
+ */
+static void
+uring_buf_recycle(struct tk_uring_loop *loop, unsigned bid) {
+    struct io_uring_buf *buf =
+        &loop->buf_ring->bufs[loop->buf_tail & (TK_URING_BUFS - 1)];
+    buf->addr = (uintptr_t)(loop->bufs + (size_t)bid * TK_URING_BUF_SIZE);
+    buf->len = TK_URING_BUF_SIZE;
+    buf->bid = bid;
+    loop->buf_tail++;
+    __atomic_store_n(&loop->buf_ring->tail, loop->buf_tail,
+                     __ATOMIC_RELEASE);
+    loop->bufs_free++;
+}
+
+/*
+ * Register the receive buffers ring (Linux 5.19+). Without it,
+ * the stream sockets are still written through the ring,
+ * but are read with read(2) as they become readable.
+ */
+static void
+uring_bufs_setup(struct tk_uring_loop *loop) {
+    size_t ring_size = TK_URING_BUFS * sizeof(struct io_uring_buf);
+    void *ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(ring == MAP_FAILED) uring_fatal("mmap");
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uintptr_t)ring;
+    reg.ring_entries = TK_URING_BUFS;
+    reg.bgid = TK_URING_BGID;
+    if(syscall(__NR_io_uring_register, loop->ring_fd,
+               IORING_REGISTER_PBUF_RING, &reg, 1)
+       != 0) {
+        munmap(ring, ring_size);
+        loop->recv_multishot = -1;
+        return;
+    }
+
+    /* Touched by the kernel as the data comes in. */
+    loop->bufs = mmap(NULL, (size_t)TK_URING_BUFS * TK_URING_BUF_SIZE,
+                      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1, 0);
+    if(loop->bufs == MAP_FAILED) uring_fatal("mmap");
+    loop->buf_len = calloc(TK_URING_BUFS, sizeof(loop->buf_len[0]));
+    loop->buf_next = calloc(TK_URING_BUFS, sizeof(loop->buf_next[0]));
+    assert(loop->buf_len && loop->buf_next);
+    loop->buf_ring = ring;
+    for(unsigned bid = 0; bid < TK_URING_BUFS; bid++)
+        uring_buf_recycle(loop, bid);
+    loop->recv_multishot = 1;
+}
+
+void
+tk_uring_io_stream(struct tk_uring_loop *loop, tk_uring_io *w) {
+    struct tk_uring_fd *slot = uring_fd_slot(loop, w->fd);
+    if(slot->stream) return;
+    if(loop->recv_multishot == 0) uring_bufs_setup(loop);
+    slot->stream = 1;
+    slot->rx_head = slot->rx_tail = -1;
+    slot->rx_offset = 0;
+    slot->rx_bytes = 0;
+    uring_queue_change(loop, w->fd);
+}
+
+static void
+uring_send_submit(struct tk_uring_loop *loop, int fd,
+                  struct tk_uring_send *tx) {
+    struct io_uring_sqe *sqe = uring_get_sqe(loop);
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)(tx->data + tx->offset);
+    sqe->len = tx->size - tx->offset;
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->user_data = (uintptr_t)tx | TK_URING_SEND_TAG;
+    tx->submitted = 1;
+}
+
+static void
+uring_recv_cancel(struct tk_uring_loop *loop, int fd,
+                  struct tk_uring_fd *slot) {
+    struct io_uring_sqe *sqe = uring_get_sqe(loop);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = fd_user_data(fd, slot->stream_gen) | TK_URING_RECV_TAG;
+    sqe->user_data = TK_URING_NOOP;
+    slot->recv_cancel = 1;
+}
+
+/*
+ * Submit the queued send and (re)arm the receive of a stream socket.
+ * The requests refer to the file descriptor number, so they are only
+ * made right before io_uring_enter(2): the descriptor could have been
+ * closed and reused by another socket in the meantime otherwise.
+ */
+static void
+uring_stream_flush(struct tk_uring_loop *loop, int fd,
+                   struct tk_uring_fd *slot) {
+    if(slot->tx_inflight == NULL) {
+        slot->tx_inflight = slot->tx_pending;
+        slot->tx_pending = NULL;
+    }
+    struct tk_uring_send *tx = slot->tx_inflight;
+    if(tx && !tx->submitted) uring_send_submit(loop, fd, tx);
+
+    if(slot->recv_armed) {
+        if(slot->rx_bytes >= TK_URING_RECV_MAX && !slot->recv_cancel)
+            uring_recv_cancel(loop, fd, slot);
+    } else if(loop->recv_multishot > 0 && loop->bufs_free && slot->w
+              && (slot->w->events & TK_URING_READ) && !slot->recv_eof
+              && !slot->recv_error && slot->rx_bytes < TK_URING_RECV_MAX) {
+        struct io_uring_sqe *sqe = uring_get_sqe(loop);
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = TK_URING_BGID;
+        sqe->user_data = fd_user_data(fd, slot->stream_gen) | TK_URING_RECV_TAG;
+        slot->recv_armed = 1;
+    }
+}
+
+/*
+ * The poll events still needed for the stream socket, if any:
+ * the readiness is otherwise told by the receive and send completions.
+ */
+static int
+uring_stream_poll_events(const struct tk_uring_fd *slot, int events) {
+    if(!slot->stream) return events;
+    if(slot->recv_armed || uring_rx_pending(slot)) events &= ~TK_URING_READ;
+    if(slot->tx_inflight) events &= ~TK_URING_WRITE;
+    return events;
+}
+
+static void
+uring_rx_release(struct tk_uring_loop *loop, struct tk_uring_fd *slot) {
+    while(slot->rx_head != -1) {
+        int32_t bid = slot->rx_head;
+        slot->rx_head = loop->buf_next[bid];
+        uring_buf_recycle(loop, bid);
+    }
+    slot->rx_tail = -1;
+    slot->rx_offset = 0;
+    slot->rx_bytes = 0;
+}
+
+static void
+uring_stream_received(struct tk_uring_loop *loop, uint64_t user_data, int res,
+                      uint32_t flags) {
+    int fd = (int)(uint32_t)user_data;
+    uint32_t gen = (user_data >> 32) & TK_URING_GEN_MASK;
+    struct tk_uring_fd *slot = uring_stream_slot(loop, fd);
+    if(slot && (slot->stream_gen & TK_URING_GEN_MASK) != gen) slot = NULL;
+
+    if(flags & IORING_CQE_F_BUFFER) {
+        unsigned bid = flags >> IORING_CQE_BUFFER_SHIFT;
+        loop->bufs_free--;
+        if(slot && res > 0) {
+            loop->buf_len[bid] = res;
+            loop->buf_next[bid] = -1;
+            if(slot->rx_tail == -1)
+                slot->rx_head = bid;
+            else
+                loop->buf_next[slot->rx_tail] = bid;
+            slot->rx_tail = bid;
+            slot->rx_bytes += res;
+        } else {
+            uring_buf_recycle(loop, bid);
+        }
+    }
+    if(slot == NULL) return; /* Stale */
+
+    if(!(flags & IORING_CQE_F_MORE)) {
+        slot->recv_armed = 0;
+        slot->recv_cancel = 0;
+        uring_queue_change(loop, fd); /* Re-arm, or poll instead */
+    }
+    if(res == 0) {
+        slot->recv_eof = 1;
+    } else if(res < 0) {
+        switch(-res) {
+        case ENOBUFS:
+        case ECANCELED:
+            break;
+        case EINVAL:
+            /* No multishot receive before Linux 6.0. Use read(2). */
+            loop->recv_multishot = -1;
+            break;
+        default:
+            slot->recv_error = -res;
+        }
+    }
+    if(uring_rx_pending(slot)) uring_mark_ready(loop, fd);
+}
+
+/*
+ * The data of the stream socket closed during a send is all sent now,
+ * see tk_uring_io_close(). Close the duplicate it was sent through.
+ */
+static void
+uring_drain_done(struct tk_uring_loop *loop, int fd, struct tk_uring_fd *slot) {
+    slot->stream = 0;
+    slot->draining = 0;
+    slot->stream_gen++;
+    slot->send_error = 0;
+    loop->active_ios--;
+    close(fd);
+}
+
+static void
+uring_stream_sent(struct tk_uring_loop *loop, struct tk_uring_send *tx,
+                  int res) {
+    int fd = tx->fd;
+    struct tk_uring_fd *slot = uring_stream_slot(loop, fd);
+    if(slot == NULL || slot->stream_gen != tx->stream_gen
+       || slot->tx_inflight != tx) {
+        free(tx); /* Sent as the socket was closed */
+        return;
+    }
+
+    tx->submitted = 0;
+    if(res < 0) {
+        slot->send_error = -res;
+        free(tx);
+        free(slot->tx_pending);
+        slot->tx_inflight = slot->tx_pending = NULL;
+        if(!slot->draining) uring_mark_ready(loop, fd);
+    } else if((tx->offset += res) == tx->size) {
+        free(tx);
+        slot->tx_inflight = NULL;
+    }
+    if(slot->draining) {
+        if(slot->tx_inflight || slot->tx_pending)
+            uring_queue_change(loop, fd);
+        else
+            uring_drain_done(loop, fd, slot);
+        return;
+    }
+    uring_queue_change(loop, fd);
+
+    tk_uring_io *w = slot->w;
+    if(w && (w->events & TK_URING_WRITE)) w->cb(loop, w, TK_URING_WRITE);
+}
+
+/*
+ * Level-triggered: the watchers keep being told TK_URING_READ
+ * while there is something for them to read.
+ */
+static void
+uring_dispatch_received(struct tk_uring_loop *loop) {
+    size_t n = loop->ready_count;
+    for(size_t i = 0; i < n && !loop->break_requested; i++) {
+        struct tk_uring_fd *slot = &loop->fds[loop->ready[i]];
+        tk_uring_io *w = slot->w;
+        if(slot->stream && w && (w->events & TK_URING_READ)
+           && uring_rx_pending(slot))
+            w->cb(loop, w, TK_URING_READ);
+    }
+
+    size_t kept = 0;
+    for(size_t i = 0; i < loop->ready_count; i++) {
+        int fd = loop->ready[i];
+        struct tk_uring_fd *slot = &loop->fds[fd];
+        if(slot->stream && slot->w && (slot->w->events & TK_URING_READ)
+           && uring_rx_pending(slot))
+            loop->ready[kept++] = fd;
+        else
+            slot->ready = 0;
+    }
+    loop->ready_count = kept;
+}
+
+ssize_t
+tk_uring_read(int fd, void *buf, size_t size) {
+    struct tk_uring_loop *loop = tk_uring_current;
+    struct tk_uring_fd *slot = uring_stream_slot(loop, fd);
+    if(slot == NULL) return read(fd, buf, size);
+
+    if(slot->rx_head == -1) {
+        if(slot->recv_error || slot->send_error) {
+            errno = slot->recv_error ? slot->recv_error : slot->send_error;
+            return -1;
+        } else if(slot->recv_eof) {
+            return 0;
+        } else if(!slot->recv_armed) {
+            /* Nothing is being received into the buffers. */
+            return read(fd, buf, size);
+        }
+        errno = EAGAIN;
+        return -1;
+    }
+
+    size_t copied = 0;
+    while(copied < size && slot->rx_head != -1) {
+        int32_t bid = slot->rx_head;
+        size_t n = loop->buf_len[bid] - slot->rx_offset;
+        if(n > size - copied) n = size - copied;
+        memcpy((char *)buf + copied,
+               loop->bufs + (size_t)bid * TK_URING_BUF_SIZE + slot->rx_offset,
+               n);
+        copied += n;
+        slot->rx_offset += n;
+        if(slot->rx_offset == loop->buf_len[bid]) {
+            slot->rx_head = loop->buf_next[bid];
+            if(slot->rx_head == -1) slot->rx_tail = -1;
+            slot->rx_offset = 0;
+            uring_buf_recycle(loop, bid);
+        }
+    }
+    slot->rx_bytes -= copied;
+    if(!slot->recv_armed) uring_queue_change(loop, fd);
+    return copied;
+}
+
+ssize_t
+tk_uring_writev(int fd, const struct iovec *iov, int iovcnt) {
+    struct tk_uring_loop *loop = tk_uring_current;
+    struct tk_uring_fd *slot = uring_stream_slot(loop, fd);
+    if(slot == NULL) return writev(fd, iov, iovcnt);
+
+    if(slot->send_error) {
+        errno = slot->send_error;
+        return -1;
+    }
+
+    struct tk_uring_send *tx = slot->tx_pending;
+    size_t queued = tx ? tx->size : 0;
+    size_t size = 0;
+    for(int i = 0; i < iovcnt; i++) size += iov[i].iov_len;
+    if(size > TK_URING_SEND_MAX - queued) size = TK_URING_SEND_MAX - queued;
+    if(size == 0) {
+        if(queued < TK_URING_SEND_MAX) return 0;
+        errno = EAGAIN;
+        return -1;
+    }
+
+    if(tx == NULL || tx->allocated < queued + size) {
+        size_t allocated = tx ? 2 * tx->allocated : 16384;
+        while(allocated < queued + size) allocated *= 2;
+        if(allocated > TK_URING_SEND_MAX) allocated = TK_URING_SEND_MAX;
+        tx = realloc(tx, sizeof(*tx) + allocated);
+        assert(tx);
+        if(queued == 0) {
+            memset(tx, 0, sizeof(*tx));
+            tx->fd = fd;
+            tx->stream_gen = slot->stream_gen;
+        }
+        tx->allocated = allocated;
+        slot->tx_pending = tx;
+    }
+
+    size_t left = size;
+    for(int i = 0; left; i++) {
+        size_t n = iov[i].iov_len < left ? iov[i].iov_len : left;
+        memcpy(tx->data + tx->size, iov[i].iov_base, n);
+        tx->size += n;
+        left -= n;
+    }
+    uring_queue_change(loop, fd);
+    return size;
+}
+
+ssize_t
+tk_uring_write(int fd, const void *buf, size_t size) {
+    struct iovec iov = {.iov_base = (void *)buf, .iov_len = size};
+    return tk_uring_writev(fd, &iov, 1);
+}
+
+/*
+ * Stop moving the data of the stream socket which is about to be closed.
+ * The data accepted by tk_uring_writev() is still sent: the queued send is
+ * submitted right away, or if it has to wait for the send in progress,
+ * the socket is duplicated and the loop closes the duplicate once done.
+ */
+void
+tk_uring_io_close(int fd) {
+    struct tk_uring_loop *loop = tk_uring_current;
+    struct tk_uring_fd *slot = uring_stream_slot(loop, fd);
+    if(slot == NULL) return;
+
+    if(slot->recv_armed && !slot->recv_cancel)
+        uring_recv_cancel(loop, fd, slot);
+    uring_rx_release(loop, slot);
+
+    struct tk_uring_send *tx = slot->tx_inflight;
+    if(tx == NULL) {
+        tx = slot->tx_pending;
+        if(tx) uring_send_submit(loop, fd, tx);
+    } else if(slot->tx_pending) {
+        int dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if(dup_fd == -1) uring_fatal("fcntl(F_DUPFD_CLOEXEC)");
+        struct tk_uring_fd *dup_slot = uring_fd_slot(loop, dup_fd);
+        slot = &loop->fds[fd]; /* Could have moved */
+        dup_slot->stream = 1;
+        dup_slot->draining = 1;
+        dup_slot->stream_gen++;
+        dup_slot->rx_head = dup_slot->rx_tail = -1;
+        dup_slot->tx_inflight = slot->tx_inflight;
+        dup_slot->tx_pending = slot->tx_pending;
+        dup_slot->tx_inflight->fd = dup_slot->tx_pending->fd = dup_fd;
+        dup_slot->tx_inflight->stream_gen = dup_slot->stream_gen;
+        dup_slot->tx_pending->stream_gen = dup_slot->stream_gen;
+        loop->active_ios++; /* Keep the loop running until it is sent */
+        slot->tx_inflight = slot->tx_pending = NULL;
+    }
+    /* No request naming the (fd) is to be left behind its close(2). */
+    uring_submit_all(loop);
+
+    /* The completions still to come are stale. */
+    slot->stream = 0;
+    slot->stream_gen++;
+    slot->recv_armed = 0;
+    slot->recv_cancel = 0;
+    slot->recv_eof = 0;
+    slot->recv_error = 0;
+    slot->send_error = 0;
+    slot->tx_inflight = NULL;
+    slot->tx_pending = NULL;
+}
+
+#else /* !TK_URING_STREAMS */
+
+/* The kernel headers predate the multishot receive (Linux 6.0). */
+
+void
+tk_uring_io_stream(struct tk_uring_loop *loop, tk_uring_io *w) {
+    (void)loop;
+    (void)w;
+}
+
+ssize_t
+tk_uring_read(int fd, void *buf, size_t size) {
+    return read(fd, buf, size);
+}
+
+ssize_t
+tk_uring_write(int fd, const void *buf, size_t size) {
+    return write(fd, buf, size);
+}
+
+ssize_t
+tk_uring_writev(int fd, const struct iovec *iov, int iovcnt) {
+    return writev(fd, iov, iovcnt);
+}
+
+void
+tk_uring_io_close(int fd) {
+    (void)fd;
+}
+
+#define uring_stream_flush(loop, fd, slot) ((void)0)
+#define uring_stream_poll_events(slot, events) (events)
+#define uring_rx_pending(slot) 0
+#define uring_mark_ready(loop, fd) ((void)0)
+#define uring_dispatch_received(loop) ((void)0)
+
+#endif /* TK_URING_STREAMS */
+
+/*
+ * Arm poll requests for the watchers started or re-enabled
+ * since the last loop iteration.
+ */
+static void
+uring_flush_changes(struct tk_uring_loop *loop) {
+    for(size_t i = 0; i < loop->changes_count; i++) {
+        int fd = loop->changes[i];
+        struct tk_uring_fd *slot = &loop->fds[fd];
+        slot->queued = 0;
+        if(slot->stream) uring_stream_flush(loop, fd, slot);
+        if(slot->w == NULL || slot->armed) continue;
+
+        int events = uring_stream_poll_events(slot, slot->w->events);
+        if(events == 0) continue;
+        struct io_uring_sqe *sqe = uring_get_sqe(loop);
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = ((events & TK_URING_READ) ? POLLIN : 0)
+                             | ((events & TK_URING_WRITE) ? POLLOUT : 0);
+        sqe->user_data = fd_user_data(fd, slot->gen);
+        slot->armed = 1;
+    }
+    loop->changes_count = 0;
+}
+
+void
+tk_uring_io_start(struct tk_uring_loop *loop, tk_uring_io *w) {
+    if(w->active) return;
+    struct tk_uring_fd *slot = uring_fd_slot(loop, w->fd);
+    assert(slot->w == NULL); /* Single watcher per file descriptor */
+    slot->w = w;
+    w->active = 1;
+    loop->active_ios++;
+    uring_queue_change(loop, w->fd);
+    if(slot->stream && uring_rx_pending(slot)) uring_mark_ready(loop, w->fd);
+}
+
+void
+tk_uring_io_stop(struct tk_uring_loop *loop, tk_uring_io *w) {
+    if(!w->active) return;
+    struct tk_uring_fd *slot = &loop->fds[w->fd];
+    assert(slot->w == w);
+    if(slot->armed) {
+        struct io_uring_sqe *sqe = uring_get_sqe(loop);
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = fd_user_data(w->fd, slot->gen);
+        sqe->user_data = TK_URING_NOOP;
+        slot->armed = 0;
+    }
+    slot->w = NULL;
+    slot->gen++;
+    w->active = 0;
+    loop->active_ios--;
+}
+
+static void
+uring_complete(struct tk_uring_loop *loop, uint64_t user_data, int res,
+               uint32_t flags) {
+    if(user_data == TK_URING_NOOP) return;
+#ifdef TK_URING_STREAMS
+    switch(user_data & TK_URING_TAG_MASK) {
+    case TK_URING_RECV_TAG:
+        uring_stream_received(loop, user_data, res, flags);
+        return;
+    case TK_URING_SEND_TAG:
+        uring_stream_sent(
+            loop,
+            (struct tk_uring_send *)(uintptr_t)(user_data & ~TK_URING_TAG_MASK),
+            res);
+        return;
+    }
+#else
+    (void)flags;
+#endif
+    int fd = (int)(uint32_t)user_data;
+    uint32_t gen = (user_data >> 32) & TK_URING_GEN_MASK;
+    if((size_t)fd >= loop->fds_size) return;
+    struct tk_uring_fd *slot = &loop->fds[fd];
+    if((slot->gen & TK_URING_GEN_MASK) != gen) return; /* Stale */
+    slot->armed = 0;
+    tk_uring_io *w = slot->w;
+    if(w == NULL) return;
+
+    int revents = 0;
+    if(res < 0) {
+        if(res == -ECANCELED) return;
+        revents = w->events; /* Let the callback discover the error */
+    } else {
+        if(res & (POLLIN | POLLERR | POLLHUP))
+            revents |= w->events & TK_URING_READ;
+        if(res & (POLLOUT | POLLERR | POLLHUP))
+            revents |= w->events & TK_URING_WRITE;
+    }
+
+    /* Re-arm after the callback, unless it stops the watcher. */
+    uring_queue_change(loop, fd);
+    if(revents) w->cb(loop, w, revents);
+}
+
+static void
+uring_process_completions(struct tk_uring_loop *loop) {
+    /* The ones set aside by uring_submit_all() came first. */
+    for(size_t i = 0; i < loop->cq_saved_count; i++) {
+        struct tk_uring_cqe_saved saved = loop->cq_saved[i];
+        uring_complete(loop, saved.user_data, saved.res, saved.flags);
+    }
+    loop->cq_saved_count = 0;
+
+    unsigned head = *loop->cq_head;
+    unsigned tail = __atomic_load_n(loop->cq_tail, __ATOMIC_ACQUIRE);
+
+    for(; head != tail; head++) {
+        struct io_uring_cqe *cqe = &loop->cqes[head & loop->cq_mask];
+        uint64_t user_data = cqe->user_data;
+        int res = cqe->res;
+        uint32_t flags = cqe->flags;
+        __atomic_store_n(loop->cq_head, head + 1, __ATOMIC_RELEASE);
+        uring_complete(loop, user_data, res, flags);
+    }
+}
+
+static void
+timer_heap_swap(struct tk_uring_loop *loop, size_t a, size_t b) {
+    tk_uring_timer *t = loop->timers[a];
+    loop->timers[a] = loop->timers[b];
+    loop->timers[b] = t;
+    loop->timers[a]->heap_pos = a;
+    loop->timers[b]->heap_pos = b;
+}
+
+static void
+timer_heap_up(struct tk_uring_loop *loop, size_t pos) {
+    while(pos > 1 && loop->timers[pos / 2]->at > loop->timers[pos]->at) {
+        timer_heap_swap(loop, pos, pos / 2);
+        pos /= 2;
+    }
+}
+
+static void
+timer_heap_down(struct tk_uring_loop *loop, size_t pos) {
+    for(;;) {
+        size_t smallest = pos;
+        size_t l = 2 * pos;
+        size_t r = l + 1;
+        if(l <= loop->timers_count
+           && loop->timers[l]->at < loop->timers[smallest]->at)
+            smallest = l;
+        if(r <= loop->timers_count
+           && loop->timers[r]->at < loop->timers[smallest]->at)
+            smallest = r;
+        if(smallest == pos) break;
+        timer_heap_swap(loop, pos, smallest);
+        pos = smallest;
+    }
+}
+
+static void
+timer_heap_insert(struct tk_uring_loop *loop, tk_uring_timer *t) {
+    if(loop->timers_count + 1 >= loop->timers_size) {
+        loop->timers_size = loop->timers_size ? 2 * loop->timers_size : 256;
+        loop->timers = realloc(loop->timers,
+                               loop->timers_size * sizeof(loop->timers[0]));
+        assert(loop->timers);
+    }
+    size_t pos = ++loop->timers_count;
+    loop->timers[pos] = t;
+    t->heap_pos = pos;
+    timer_heap_up(loop, pos);
+}
+
+static void
+timer_heap_remove(struct tk_uring_loop *loop, tk_uring_timer *t) {
+    size_t pos = t->heap_pos;
+    assert(pos >= 1 && pos <= loop->timers_count);
+    assert(loop->timers[pos] == t);
+    if(pos != loop->timers_count) {
+        timer_heap_swap(loop, pos, loop->timers_count);
+        loop->timers_count--;
+        timer_heap_up(loop, pos);
+        timer_heap_down(loop, pos);
+    } else {
+        loop->timers_count--;
+    }
+    t->heap_pos = 0;
+}
+
+void
+tk_uring_timer_start(struct tk_uring_loop *loop, tk_uring_timer *t) {
+    if(t->heap_pos) return;
+    t->at = loop->now + t->after;
+    timer_heap_insert(loop, t);
+}
+
+void
+tk_uring_timer_stop(struct tk_uring_loop *loop, tk_uring_timer *t) {
+    if(!t->heap_pos) return;
+    timer_heap_remove(loop, t);
+}
+
+static void
+uring_run_timers(struct tk_uring_loop *loop) {
+    while(loop->timers_count && loop->timers[1]->at <= loop->now) {
+        tk_uring_timer *t = loop->timers[1];
+        timer_heap_remove(loop, t);
+        if(t->repeat > 0) {
+            t->at += t->repeat;
+            if(t->at < loop->now) t->at = loop->now + t->repeat;
+            timer_heap_insert(loop, t);
+        }
+        t->cb(loop, t, 0);
+        if(loop->break_requested) break;
+    }
+}
+
+void
+tk_uring_run(struct tk_uring_loop *loop) {
+    loop->break_requested = 0;
+    tk_uring_current = loop;
+
+    while(!loop->break_requested) {
+        tk_uring_now_update(loop);
+        uring_run_timers(loop);
+        if(loop->break_requested) break;
+        if(loop->active_ios == 0 && loop->timers_count == 0) break;
+
+        uring_flush_changes(loop);
+
+        double timeout = 60.0;
+        if(loop->timers_count) {
+            timeout = loop->timers[1]->at - loop->now;
+            if(timeout < 0) timeout = 0;
+        }
+        /* Not read out, or not processed yet. */
+        if(loop->ready_count || loop->cq_saved_count) timeout = 0;
+        uring_enter(loop, 1, timeout);
+
+        tk_uring_now_update(loop);
+        uring_process_completions(loop);
+        uring_dispatch_received(loop);
+    }
+}
+
+#endif /* HAVE_IO_URING */
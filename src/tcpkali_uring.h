@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_URING_H
+#define TCPKALI_URING_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/*
+ * A minimal event loop on top of Linux io_uring.
+ *
+ * Readiness is delivered through IORING_OP_POLL_ADD requests. All poll
+ * (re)arming and cancellation requests produced during a loop iteration
+ * are queued into the submission ring and handed to the kernel in a single
+ * io_uring_enter(2) call, which also waits for the next batch of
+ * completions. This replaces both epoll_wait(2) and the epoll_ctl(2)
+ * churn of re-registering interest on every watcher update.
+ *
+ * The API mimics the subset of libev used by the engine, so the loop
+ * semantics (level-triggered readiness, one-shot and repeating timers)
+ * are the same as with the default backend.
+ *
+ * A connected TCP socket may also have its data moved by the loop itself,
+ * see tk_uring_io_stream(). A multishot IORING_OP_RECV keeps receiving
+ * into a ring of buffers provided to the kernel, and the data written is
+ * queued and handed over with IORING_OP_SEND. Neither the readiness polls
+ * nor the read(2) and write(2) calls are then made for such a socket.
+ */
+
+#define TK_URING_READ 0x01
+#define TK_URING_WRITE 0x02
+
+struct tk_uring_loop;
+struct tk_uring_io;
+struct tk_uring_timer;
+
+typedef void(tk_uring_io_cb)(struct tk_uring_loop *, struct tk_uring_io *,
+                             int revents);
+typedef void(tk_uring_timer_cb)(struct tk_uring_loop *,
+                                struct tk_uring_timer *, int revents);
+
+typedef struct tk_uring_io {
+    tk_uring_io_cb *cb;
+    int fd;
+    int events; /* TK_URING_READ | TK_URING_WRITE */
+    int active;
+} tk_uring_io;
+
+typedef struct tk_uring_timer {
+    tk_uring_timer_cb *cb;
+    double after;
+    double repeat;
+    double at;       /* Absolute expiration time */
+    size_t heap_pos; /* 1-based position in the timer heap, 0 if inactive */
+} tk_uring_timer;
+
+/*
+ * Create a new loop. Exits if io_uring is not usable on this system.
+ */
+struct tk_uring_loop *tk_uring_loop_new(void);
+
+/*
+ * A loop which is only used by the main thread for timekeeping.
+ */
+struct tk_uring_loop *tk_uring_default_loop(void);
+
+/*
+ * Run the loop until tk_uring_break() is called
+ * or there are no more active watchers.
+ */
+void tk_uring_run(struct tk_uring_loop *);
+void tk_uring_break(struct tk_uring_loop *);
+
+double tk_uring_now(struct tk_uring_loop *);
+void tk_uring_now_update(struct tk_uring_loop *);
+
+void *tk_uring_userdata(struct tk_uring_loop *);
+void tk_uring_set_userdata(struct tk_uring_loop *, void *);
+
+#define tk_uring_io_set(w, fd_, events_) \
+    do {                                 \
+        (w)->fd = (fd_);                 \
+        (w)->events = (events_);         \
+    } while(0)
+#define tk_uring_io_init(w, cb_, fd_, events_) \
+    do {                                       \
+        (w)->cb = (tk_uring_io_cb *)(cb_);     \
+        (w)->active = 0;                       \
+        tk_uring_io_set((w), (fd_), (events_)); \
+    } while(0)
+void tk_uring_io_start(struct tk_uring_loop *, tk_uring_io *);
+void tk_uring_io_stop(struct tk_uring_loop *, tk_uring_io *);
+
+#define tk_uring_timer_set(w, after_, repeat_) \
+    do {                                       \
+        (w)->after = (after_);                 \
+        (w)->repeat = (repeat_);               \
+    } while(0)
+#define tk_uring_timer_init(w, cb_, after_, repeat_) \
+    do {                                             \
+        (w)->cb = (tk_uring_timer_cb *)(cb_);        \
+        (w)->heap_pos = 0;                           \
+        tk_uring_timer_set((w), (after_), (repeat_)); \
+    } while(0)
+void tk_uring_timer_start(struct tk_uring_loop *, tk_uring_timer *);
+void tk_uring_timer_stop(struct tk_uring_loop *, tk_uring_timer *);
+
+/*
+ * Receive and send the data of the watcher's socket through the ring
+ * from now on. The watcher is told TK_URING_READ while there is data
+ * (or the end of it) received, and TK_URING_WRITE as the queued data
+ * goes out, instead of the socket's readiness.
+ * Only for the sockets whose every read and write goes through
+ * tk_uring_read(), tk_uring_write() and tk_uring_writev() below,
+ * and which are closed through tk_uring_io_close().
+ */
+void tk_uring_io_stream(struct tk_uring_loop *, tk_uring_io *);
+
+/*
+ * read(2), write(2) and writev(2) of the loop running in this thread.
+ * The socket given over with tk_uring_io_stream() is read from the
+ * received buffers, and written into the queue of data to send; -1 and
+ * EAGAIN tell that there is nothing received yet or the queue is full.
+ * The other file descriptors are passed through to the system calls.
+ */
+ssize_t tk_uring_read(int fd, void *buf, size_t size);
+ssize_t tk_uring_write(int fd, const void *buf, size_t size);
+ssize_t tk_uring_writev(int fd, const struct iovec *iov, int iovcnt);
+
+/*
+ * Forget the stream state of a socket about to be closed. The data still
+ * queued is sent, unless it waits behind a send which is in progress.
+ */
+void tk_uring_io_close(int fd);
+
+#endif /* TCPKALI_URING_H */
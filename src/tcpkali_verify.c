@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define TK_CRC32C_X86 1
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#include "tcpkali_verify.h"
+
+#define CRC32C_POLY 0x82f63b78 /* Reflected Castagnoli polynomial */
+
+static uint32_t crc32c_table[256];
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+static int crc32c_hw;
+
+static void
+crc32c_init(void) {
+    for(uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for(int k = 0; k < 8; k++) c = (c >> 1) ^ (CRC32C_POLY & -(c & 1));
+        crc32c_table[i] = c;
+    }
+#ifdef TK_CRC32C_X86
+    crc32c_hw = __builtin_cpu_supports("sse4.2");
+#elif defined(__ARM_FEATURE_CRC32)
+    crc32c_hw = 1;
+#endif
+}
+
+static uint32_t
+crc32c_sw(uint32_t crc, const unsigned char *p, size_t size) {
+    while(size--) crc = crc32c_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+#ifdef TK_CRC32C_X86
+__attribute__((target("sse4.2"))) static uint32_t
+crc32c_hw_update(uint32_t crc, const unsigned char *p, size_t size) {
+#ifdef __x86_64__
+    uint64_t c = crc;
+    for(; size >= 8; p += 8, size -= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        c = _mm_crc32_u64(c, v);
+    }
+    crc = (uint32_t)c;
+#endif
+    for(; size >= 4; p += 4, size -= 4) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        crc = _mm_crc32_u32(crc, v);
+    }
+    while(size--) crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+#elif defined(__ARM_FEATURE_CRC32)
+static uint32_t
+crc32c_hw_update(uint32_t crc, const unsigned char *p, size_t size) {
+    for(; size >= 8; p += 8, size -= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        crc = __crc32cd(crc, v);
+    }
+    while(size--) crc = __crc32cb(crc, *p++);
+    return crc;
+}
+#endif
+
+uint32_t
+tk_crc32c(uint32_t crc, const void *data, size_t size) {
+    pthread_once(&crc32c_once, crc32c_init);
+    crc = ~crc;
+#if defined(TK_CRC32C_X86) || defined(__ARM_FEATURE_CRC32)
+    if(crc32c_hw) return ~crc32c_hw_update(crc, data, size);
+#endif
+    return ~crc32c_sw(crc, data, size);
+}
+
+struct echo_verify *
+echo_verify_new(void) {
+    struct echo_verify *ev = calloc(1, sizeof(*ev));
+    assert(ev);
+    ev->pending_mask = 15;
+    ev->pending = malloc((ev->pending_mask + 1) * sizeof(ev->pending[0]));
+    assert(ev->pending);
+    return ev;
+}
+
+void
+echo_verify_free(struct echo_verify *ev) {
+    if(ev) {
+        free(ev->pending);
+        free(ev);
+    }
+}
+
+static void
+pending_push(struct echo_verify *ev, uint32_t crc) {
+    size_t count = ev->pending_tail - ev->pending_head;
+    if(count > ev->pending_mask) {
+        /* Unwrap into the twice as large ring. */
+        size_t capacity = ev->pending_mask + 1;
+        uint32_t *p = malloc(2 * capacity * sizeof(p[0]));
+        assert(p);
+        for(size_t i = 0; i < count; i++)
+            p[i] = ev->pending[(ev->pending_head + i) & ev->pending_mask];
+        free(ev->pending);
+        ev->pending = p;
+        ev->pending_head = 0;
+        ev->pending_tail = count;
+        ev->pending_mask = 2 * capacity - 1;
+    }
+    ev->pending[ev->pending_tail++ & ev->pending_mask] = crc;
+}
+
+void
+echo_verify_sent(struct echo_verify *ev, const void *data, size_t size) {
+    const unsigned char *p = data;
+    while(size) {
+        size_t n = ECHO_VERIFY_BLOCK - ev->sent_fill;
+        if(n > size) n = size;
+        ev->sent_crc = tk_crc32c(ev->sent_crc, p, n);
+        ev->sent_fill += n;
+        p += n;
+        size -= n;
+        if(ev->sent_fill == ECHO_VERIFY_BLOCK) {
+            pending_push(ev, ev->sent_crc);
+            ev->sent_crc = 0;
+            ev->sent_fill = 0;
+        }
+    }
+}
+
+size_t
+echo_verify_received(struct echo_verify *ev, const void *data, size_t size,
+                     uint64_t *mismatch_offset) {
+    const unsigned char *p = data;
+    size_t mismatches = 0;
+    while(size) {
+        size_t n = ECHO_VERIFY_BLOCK - ev->rcvd_fill;
+        if(n > size) n = size;
+        ev->rcvd_crc = tk_crc32c(ev->rcvd_crc, p, n);
+        ev->rcvd_fill += n;
+        p += n;
+        size -= n;
+        if(ev->rcvd_fill == ECHO_VERIFY_BLOCK) {
+            /* A full block back, but not yet sent in full: a mismatch. */
+            if(ev->pending_head == ev->pending_tail
+               || ev->pending[ev->pending_head++ & ev->pending_mask]
+                      != ev->rcvd_crc) {
+                if(!mismatches++) *mismatch_offset = ev->rcvd_offset;
+            }
+            ev->rcvd_offset += ECHO_VERIFY_BLOCK;
+            ev->rcvd_crc = 0;
+            ev->rcvd_fill = 0;
+        }
+    }
+    return mismatches;
+}
+
+int
+echo_verify_finish(struct echo_verify *ev, uint64_t *mismatch_offset) {
+    /* Only compare once all of the sent data has come back. */
+    if(ev->pending_head != ev->pending_tail || ev->rcvd_fill != ev->sent_fill
+       || ev->rcvd_crc == ev->sent_crc)
+        return 0;
+    *mismatch_offset = ev->rcvd_offset;
+    return 1;
+}
+
+#ifdef TCPKALI_VERIFY_UNIT_TEST
+
+int
+main() {
+    /* The standard check value. */
+    assert(tk_crc32c(0, "123456789", 9) == 0xe3069283);
+    assert(tk_crc32c(tk_crc32c(0, "1234", 4), "56789", 5) == 0xe3069283);
+    assert(tk_crc32c(0, "", 0) == 0);
+
+    /* The hardware and the table agree on all lengths and alignments. */
+    unsigned char buf[1000];
+    for(size_t i = 0; i < sizeof(buf); i++) buf[i] = random();
+    for(size_t off = 0; off < 8; off++) {
+        for(size_t len = 0; len + off <= sizeof(buf); len += 37) {
+            uint32_t sw = ~crc32c_sw(~0u, buf + off, len);
+            assert(tk_crc32c(0, buf + off, len) == sw);
+        }
+    }
+
+    static unsigned char stream[5 * ECHO_VERIFY_BLOCK + 123];
+    for(size_t i = 0; i < sizeof(stream); i++) stream[i] = random();
+    uint64_t offset = 0;
+
+    /* The intact echo, in differently sized pieces. */
+    struct echo_verify *ev = echo_verify_new();
+    for(size_t i = 0; i < sizeof(stream); i += 1000)
+        echo_verify_sent(ev, stream + i,
+                         i + 1000 < sizeof(stream) ? 1000 : sizeof(stream) - i);
+    for(size_t i = 0; i < sizeof(stream); i += 777)
+        assert(echo_verify_received(ev, stream + i,
+                                    i + 777 < sizeof(stream)
+                                        ? 777
+                                        : sizeof(stream) - i,
+                                    &offset)
+               == 0);
+    assert(echo_verify_finish(ev, &offset) == 0);
+    echo_verify_free(ev);
+
+    /* A corrupted byte in the third block. */
+    ev = echo_verify_new();
+    echo_verify_sent(ev, stream, sizeof(stream));
+    stream[2 * ECHO_VERIFY_BLOCK + 5] ^= 1;
+    assert(echo_verify_received(ev, stream, sizeof(stream), &offset) == 1);
+    assert(offset == 2 * ECHO_VERIFY_BLOCK);
+    assert(echo_verify_finish(ev, &offset) == 0);
+    echo_verify_free(ev);
+
+    /* A corrupted byte in the trailing partial block. */
+    ev = echo_verify_new();
+    echo_verify_sent(ev, stream, sizeof(stream));
+    stream[sizeof(stream) - 1] ^= 1;
+    assert(echo_verify_received(ev, stream, sizeof(stream), &offset) == 0);
+    assert(echo_verify_finish(ev, &offset) == 1);
+    assert(offset == 5 * ECHO_VERIFY_BLOCK);
+    echo_verify_free(ev);
+
+    /* More data back than sent. */
+    ev = echo_verify_new();
+    echo_verify_sent(ev, stream, 100);
+    assert(echo_verify_received(ev, stream, ECHO_VERIFY_BLOCK, &offset) == 1);
+    assert(offset == 0);
+    echo_verify_free(ev);
+
+    return 0;
+}
+
+#endif /* TCPKALI_VERIFY_UNIT_TEST */
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_VERIFY_H
+#define TCPKALI_VERIFY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * CRC32C (Castagnoli) of the data, continuing from the (crc) which is 0
+ * for the first piece. Uses the SSE4.2 or the ARMv8 CRC32 instructions
+ * where available.
+ */
+uint32_t tk_crc32c(uint32_t crc, const void *data, size_t size);
+
+/*
+ * The --verify-echo state of a connection.
+ *
+ * The sent and the received streams are cut into the blocks of
+ * ECHO_VERIFY_BLOCK bytes. The CRC32C of each sent block is queued until
+ * the same block comes back, so only four bytes per block in flight are
+ * kept rather than the data itself.
+ */
+#define ECHO_VERIFY_BLOCK 4096
+
+struct echo_verify {
+    uint32_t sent_crc; /* Of the sent bytes past the last full block */
+    uint32_t rcvd_crc; /* Of the received bytes past the last full block */
+    size_t sent_fill;  /* Bytes into the last block sent */
+    size_t rcvd_fill;  /* Bytes into the last block received */
+    uint64_t rcvd_offset; /* Stream offset of the block being received */
+    /* The CRC32C of the sent and not yet received blocks. */
+    uint32_t *pending;
+    size_t pending_head;  /* Free-running */
+    size_t pending_tail;  /* Free-running */
+    size_t pending_mask;  /* Capacity - 1 */
+};
+
+struct echo_verify *echo_verify_new(void);
+void echo_verify_free(struct echo_verify *);
+
+void echo_verify_sent(struct echo_verify *, const void *data, size_t size);
+
+/*
+ * Check the received data against what has been sent.
+ * Returns the number of mismatching blocks completed with this data,
+ * and the stream offset of the first one in (*mismatch_offset).
+ * The data received beyond what has been sent is a mismatch as well.
+ */
+size_t echo_verify_received(struct echo_verify *, const void *data,
+                            size_t size, uint64_t *mismatch_offset);
+
+/*
+ * Compare the trailing partial block, once nothing more is expected.
+ * Returns 1 if it mismatches and sets (*mismatch_offset), 0 otherwise.
+ */
+int echo_verify_finish(struct echo_verify *, uint64_t *mismatch_offset);
+
+#endif /* TCPKALI_VERIFY_H */
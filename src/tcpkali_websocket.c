@@ -27,13 +27,14 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
 #include <arpa/inet.h>
 #include <assert.h>
 #include <unistd.h>
 
 #include "tcpkali_websocket.h"
 #include "libcows_base64.h"
-#include "sha-1.c"
+#include "tcpkali_sha1.h"
 
 
 /*
@@ -43,6 +44,57 @@
  */
 #define IS_WS_CONTROL_FRAME(op) ((((unsigned)(op)) & 0x8) ? 1 : 0)
 
+/* The client frames mask, see websocket_set_mask_key(). */
+static uint8_t websocket_mask_key[4];
+static int websocket_mask_nonzero;
+
+void
+websocket_set_mask_key(const uint8_t key[4]) {
+    memcpy(websocket_mask_key, key, sizeof(websocket_mask_key));
+    websocket_mask_nonzero = (key[0] | key[1] | key[2] | key[3]) != 0;
+}
+
+void
+websocket_mask_payload(uint8_t *payload, size_t size) {
+    if(websocket_mask_nonzero)
+        websocket_mask(payload, size, websocket_mask_key);
+}
+
+/* Compiles into a single SSE2/NEON register operation. */
+typedef uint8_t ws_mask_vector __attribute__((vector_size(16), aligned(16)));
+
+void
+websocket_mask(uint8_t *data, size_t size, const uint8_t key[4]) {
+    size_t i = 0;
+
+    /* Go byte by byte until the data is aligned. */
+    for(; i < size && ((uintptr_t)(data + i) & 15); i++) {
+        data[i] ^= key[i & 3];
+    }
+
+    if(size - i >= 16) {
+        /* The key rotated to match the (i) offset. */
+        uint8_t pattern[16];
+        for(size_t j = 0; j < sizeof(pattern); j++) {
+            pattern[j] = key[(i + j) & 3];
+        }
+        ws_mask_vector v;
+        memcpy(&v, pattern, sizeof(v));
+        for(; size - i >= 32; i += 32) {
+            *(ws_mask_vector *)(data + i) ^= v;
+            *(ws_mask_vector *)(data + i + 16) ^= v;
+        }
+        if(size - i >= 16) {
+            *(ws_mask_vector *)(data + i) ^= v;
+            i += 16;
+        }
+    }
+
+    for(; i < size; i++) {
+        data[i] ^= key[i & 3];
+    }
+}
+
 /*
  * Write out a frame header to prefix a payload of given size.
  */
@@ -99,9 +151,9 @@ websocket_frame_header(uint8_t *buf, size_t size, enum websocket_side side,
         buf += 4;
     }
 
-    /* Add 4-byte 0-valued XOR mask (for debugging) */
+    /* Add the 4-byte XOR mask, 0-valued unless asked otherwise. */
     if(mask_flag) {
-        memset(buf, 0, 4);
+        memcpy(buf, websocket_mask_key, 4);
         buf += 4;
     }
 
@@ -110,86 +162,420 @@ websocket_frame_header(uint8_t *buf, size_t size, enum websocket_side side,
 
 
 /*
- * Detect WebSocket handshake.
- * A high performance, but extremely naive and broken implementation.
- * Normally a well-behaving client (or proxy) will attempt to send a whole HTTP
- * request in a single TCP fragment. In some cases, a header-per-fragment
- * is also something that naive clients do.
- * This function does not support HTTP headers split between frames arbitrarily,
- * which is not too common in the high performance code anyway.
- * TODO: replace with an efficient but more correct parser.
+ * The size of the frame header, judging by its first two bytes.
  */
+static size_t
+websocket_frame_header_size(const uint8_t *hdr) {
+    size_t size = 2 + ((hdr[1] & 0x80) ? 4 : 0);
+    switch(hdr[1] & 0x7f) {
+    case 126:
+        return size + 2;
+    case 127:
+        return size + 8;
+    default:
+        return size;
+    }
+}
+
+static int
+websocket_parse_frame_header(struct websocket_parser *wp) {
+    const uint8_t *hdr = wp->header;
+    uint64_t payload_size = hdr[1] & 0x7f;
+
+    wp->opcode = hdr[0] & 0x0f;
+    wp->fin = (hdr[0] & 0x80) != 0;
+    if(wp->opcode != WS_OP_CONTINUATION && !IS_WS_CONTROL_FRAME(wp->opcode))
+        wp->compressed = (hdr[0] & 0x40) != 0;
+    wp->masked = (hdr[1] & 0x80) != 0;
+    hdr += 2;
+
+    if(payload_size == 126) {
+        payload_size = ((uint64_t)hdr[0] << 8) | hdr[1];
+        hdr += 2;
+    } else if(payload_size == 127) {
+        if(hdr[0] & 0x80) return -1; /* RFC 6455, 5.2: MSB must be 0 */
+        payload_size = 0;
+        for(int i = 0; i < 8; i++) payload_size = (payload_size << 8) | hdr[i];
+        hdr += 8;
+    }
+
+    if(wp->masked) memcpy(wp->key, hdr, 4);
+    wp->payload_left = payload_size;
+    wp->payload_offset = 0;
+    return 0;
+}
+
+enum websocket_parse_event
+websocket_parse(struct websocket_parser *wp, uint8_t **bufp, size_t *sizep,
+                uint8_t **payload, size_t *payload_size) {
+    uint8_t *buf = *bufp;
+    size_t size = *sizep;
+    enum websocket_parse_event event = WSPE_NEED_MORE_DATA;
+
+    while(size && event == WSPE_NEED_MORE_DATA) {
+        switch(wp->state) {
+        case WSP_HTTP_RESPONSE:
+            if(!wp->skip_http_response) {
+                wp->state = WSP_FRAME_HEADER;
+                break;
+            }
+            for(; size; buf++, size--) {
+                if(*buf == "\r\n\r\n"[wp->http_eoh_matched]) {
+                    if(++wp->http_eoh_matched == 4) break;
+                } else {
+                    wp->http_eoh_matched = (*buf == '\r');
+                }
+            }
+            if(size) {
+                buf++;
+                size--;
+                wp->state = WSP_FRAME_HEADER;
+            }
+            break;
+        case WSP_FRAME_HEADER: {
+            size_t want = wp->header_size < 2
+                              ? 2
+                              : websocket_frame_header_size(wp->header);
+            size_t take = want - wp->header_size;
+            if(take > size) take = size;
+            memcpy(wp->header + wp->header_size, buf, take);
+            wp->header_size += take;
+            buf += take;
+            size -= take;
+            if(wp->header_size < 2
+               || wp->header_size < websocket_frame_header_size(wp->header))
+                break;
+            wp->header_size = 0;
+            if(websocket_parse_frame_header(wp) != 0) {
+                event = WSPE_PROTOCOL_ERROR;
+                break;
+            }
+            wp->state = WSP_FRAME_PAYLOAD;
+        }
+            /* Fall through */
+        case WSP_FRAME_PAYLOAD: {
+            size_t take = wp->payload_left < size ? wp->payload_left : size;
+            if(take && !IS_WS_CONTROL_FRAME(wp->opcode)) {
+                if(wp->masked) {
+                    uint8_t key[4];
+                    for(int i = 0; i < 4; i++)
+                        key[i] = wp->key[(wp->payload_offset + i) & 3];
+                    websocket_mask(buf, take, key);
+                }
+                *payload = buf;
+                *payload_size = take;
+                event = WSPE_PAYLOAD;
+            }
+            buf += take;
+            size -= take;
+            wp->payload_left -= take;
+            wp->payload_offset += take;
+            if(wp->payload_left == 0) {
+                wp->state = WSP_FRAME_HEADER;
+                if(wp->fin && !IS_WS_CONTROL_FRAME(wp->opcode)) {
+                    /* Report the payload first, if any. */
+                    if(event == WSPE_PAYLOAD) {
+                        wp->state = WSP_FRAME_PAYLOAD;
+                    } else {
+                        event = WSPE_MESSAGE_END;
+                    }
+                }
+            }
+        } break;
+        }
+    }
+
+    /* An empty final frame may be complete without any more input. */
+    if(event == WSPE_NEED_MORE_DATA && wp->state == WSP_FRAME_PAYLOAD
+       && wp->payload_left == 0) {
+        wp->state = WSP_FRAME_HEADER;
+        if(wp->fin && !IS_WS_CONTROL_FRAME(wp->opcode))
+            event = WSPE_MESSAGE_END;
+    }
+
+    *bufp = buf;
+    *sizep = size;
+    return event;
+}
+
 http_detect_websocket_rval
-http_detect_websocket(const char *buf, size_t size, char *out_buf,
-                      size_t out_buf_sz, size_t *response_size) {
-    const char *keyhdr = "sec-websocket-key:";
-    size_t keyhdr_size = sizeof("sec-websocket-key:") - 1;
+http_websocket_parse(struct http_websocket_request *req, const char *buf,
+                     size_t size, size_t *consumed) {
+    static const char keyhdr[] = "sec-websocket-key:";
+    const size_t keyhdr_size = sizeof(keyhdr) - 1;
+    size_t i;
 
-    /*
-     * Ignore the GET/Version completely, search right for Sec-WebSocket-Key.
-     */
-    for(const char *bend = buf + size; buf < bend; buf++) {
-        if(*buf != '\n') {
+    for(i = 0; i < size; i++) {
+        char c = buf[i];
+        if(++req->headers_size > HTTP_WEBSOCKET_HEADERS_MAX)
+            return HDW_UNEXPECTED_ERROR;
+        switch(req->state) {
+        case HWR_REQUEST_LINE:
+        case HWR_SKIP_LINE:
+            if(c == '\n') req->state = HWR_LINE_START;
             continue;
-        } else {
-            buf++;
-            size_t buf_remainder = (bend - buf);
-            if(buf_remainder < keyhdr_size) {
-                return HDW_TRUNCATED_INPUT;
+        case HWR_LINE_START:
+            if(c == '\r') {
+                req->state = HWR_EMPTY_LINE;
+                continue;
+            } else if(c != '\n') {
+                req->name_matched = 0;
+                req->state = HWR_HEADER_NAME;
+                break;  /* Match the first byte of the name */
             }
-
-            if(strncasecmp(buf, keyhdr, keyhdr_size) == 0) {
-                const char *keyvalue = buf + keyhdr_size;
-                int extent = bend - keyvalue;
-                if(extent > 30) extent = 30;
-                const char *kvend = memchr(keyvalue, '\n', extent);
-                if(kvend == 0) {
-                    return HDW_TRUNCATED_INPUT;
-                }
-                /* ltrim */
-                for(; keyvalue < kvend && *keyvalue == ' '; keyvalue++)
-                    ;
+            /* Fall through */
+        case HWR_EMPTY_LINE:
+            if(c != '\n') {
+                req->state = HWR_SKIP_LINE;
+                continue;
+            }
+            /* The end of the headers. */
+            *consumed = i + 1;
+            if(!req->key_found) return HDW_UNEXPECTED_ERROR;
+            return HDW_WEBSOCKET_DETECTED;
+        case HWR_HEADER_NAME:
+            break;
+        case HWR_KEY_VALUE:
+            if(c == '\n') {
                 /* rtrim */
-                for(; kvend > keyvalue && (kvend[-1] == ' ' || kvend[-1] == '\r'
-                                           || kvend[-1] == ' ');
-                    kvend--)
-                    ;
-                int kvsize = kvend - keyvalue;
-                if(kvsize < 1 || kvsize > 26 /* 26 is in RFC6455 */)
-                    return HDW_UNEXPECTED_ERROR;
-
-                char new_key[64];
-                char sha1_buf[20];
-                char base64_output[32];
-                size_t new_key_size;
-#define MAGIC "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
-                memcpy(new_key, keyvalue, kvsize);
-                strcpy(new_key + kvsize, MAGIC);
-                new_key_size = kvsize + sizeof(MAGIC) - 1;
-
-                SHA1((void *)new_key, new_key_size, (unsigned char *)sha1_buf);
-                size_t base64_output_size = sizeof(base64_output);
-                *response_size = snprintf(
-                    out_buf, out_buf_sz,
-                    "HTTP/1.1 101 Switching Protocols\r\n"
-                    "Upgrade: websocket\r\n"
-                    "Connection: Upgrade\r\n"
-                    "Sec-WebSocket-Accept: %s\r\n"
-                    "\r\n",
-                    libcows_base64_encode(sha1_buf, sizeof(sha1_buf),
-                                          base64_output, &base64_output_size));
-                assert(*response_size < out_buf_sz);
-
-                /* Write out WebSocket response */
-                /*
-                if(write(fd, out_buf, response_size) != response_size)
-                    return HDW_UNEXPECTED_ERROR;
-                */
-
-                return HDW_WEBSOCKET_DETECTED;
+                while(req->key_size
+                      && (req->key[req->key_size - 1] == ' '
+                          || req->key[req->key_size - 1] == '\t'
+                          || req->key[req->key_size - 1] == '\r'))
+                    req->key_size--;
+                if(req->key_size < 1) return HDW_UNEXPECTED_ERROR;
+                req->key_found = 1;
+                req->state = HWR_LINE_START;
+            } else if(req->key_size == 0 && (c == ' ' || c == '\t')) {
+                /* ltrim */
+            } else if(req->key_size == sizeof(req->key)) {
+                return HDW_UNEXPECTED_ERROR;
+            } else {
+                req->key[req->key_size++] = c;
             }
+            continue;
+        }
+
+        /* HWR_HEADER_NAME */
+        if(c == '\n') {
+            req->state = HWR_LINE_START;
+        } else if(tolower((unsigned char)c) != keyhdr[req->name_matched]) {
+            req->state = HWR_SKIP_LINE;
+        } else if(++req->name_matched == keyhdr_size) {
+            req->key_size = 0;
+            req->state = HWR_KEY_VALUE;
         }
     }
 
+    *consumed = i;
     return HDW_NOT_ENOUGH_DATA;
 }
+
+void
+http_websocket_accept(struct http_websocket_request *const reqs[], size_t n) {
+#define MAGIC "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+    enum { BATCH = 16 };
+    char keys[BATCH][HTTP_WEBSOCKET_KEY_MAX + sizeof(MAGIC)];
+    const void *data[BATCH];
+    size_t sizes[BATCH];
+    uint8_t digests[BATCH][TK_SHA1_DIGEST_SIZE];
+
+    for(size_t done = 0; done < n;) {
+        size_t batch = n - done < BATCH ? n - done : BATCH;
+        for(size_t i = 0; i < batch; i++) {
+            const struct http_websocket_request *req = reqs[done + i];
+            assert(req->key_found);
+            memcpy(keys[i], req->key, req->key_size);
+            memcpy(keys[i] + req->key_size, MAGIC, sizeof(MAGIC) - 1);
+            data[i] = keys[i];
+            sizes[i] = req->key_size + sizeof(MAGIC) - 1;
+        }
+        tk_sha1_multi(data, sizes, digests, batch);
+        for(size_t i = 0; i < batch; i++) {
+            struct http_websocket_request *req = reqs[done + i];
+            size_t accept_size = sizeof(req->accept);
+            libcows_base64_encode(digests[i], sizeof(digests[i]), req->accept,
+                                  &accept_size);
+        }
+        done += batch;
+    }
+#undef MAGIC
+}
+
+size_t
+http_websocket_response(const struct http_websocket_request *req, char *buf,
+                        size_t size) {
+    int response_size = snprintf(buf, size,
+                                 "HTTP/1.1 101 Switching Protocols\r\n"
+                                 "Upgrade: websocket\r\n"
+                                 "Connection: Upgrade\r\n"
+                                 "Sec-WebSocket-Accept: %s\r\n"
+                                 "\r\n",
+                                 req->accept);
+    assert(response_size > 0 && (size_t)response_size < size);
+    return response_size;
+}
+
+#ifdef TCPKALI_WEBSOCKET_UNIT_TEST
+
+#include <stdlib.h>
+
+int
+main() {
+    const uint8_t key[4] = {0x12, 0x34, 0x56, 0x78};
+    uint8_t buf[256 + 16];
+    uint8_t ref[sizeof(buf)];
+
+    /* Compare with the byte-wise masking at all alignments. */
+    for(size_t offset = 0; offset < 16; offset++) {
+        for(size_t size = 0; size <= 256; size++) {
+            for(size_t i = 0; i < sizeof(buf); i++) buf[i] = ref[i] = random();
+            for(size_t i = 0; i < size; i++) ref[offset + i] ^= key[i & 3];
+            websocket_mask(buf + offset, size, key);
+            assert(memcmp(buf, ref, sizeof(buf)) == 0);
+            websocket_mask(buf + offset, size, key);
+            for(size_t i = 0; i < size; i++) ref[offset + i] ^= key[i & 3];
+            assert(memcmp(buf, ref, sizeof(buf)) == 0);
+        }
+    }
+
+    /* The frame header carries the key. */
+    uint8_t hdr[WEBSOCKET_MAX_FRAME_HDR_SIZE];
+    websocket_set_mask_key(key);
+    size_t hdr_size = websocket_frame_header(hdr, sizeof(hdr), WS_SIDE_CLIENT,
+                                             WS_OP_TEXT_FRAME, 0, 1, 5);
+    assert(hdr_size == 6);
+    assert(hdr[1] == (0x80 | 5));
+    assert(memcmp(hdr + 2, key, 4) == 0);
+    hdr_size = websocket_frame_header(hdr, sizeof(hdr), WS_SIDE_SERVER,
+                                      WS_OP_TEXT_FRAME, 0, 1, 5);
+    assert(hdr_size == 2);
+
+    /*
+     * Parse a stream of frames fed in pieces of various sizes.
+     */
+    static uint8_t stream[2 * 70000 + 1024];
+    static uint8_t expected[sizeof(stream)];
+    static uint8_t received[sizeof(stream)];
+    const char *http = "HTTP/1.1 101 Switching Protocols\r\n\r\r\n\r\n";
+    struct {
+        enum websocket_side side;
+        enum ws_frame_opcode opcode;
+        int fin;
+        size_t size;
+    } frames[] = {{WS_SIDE_SERVER, WS_OP_TEXT_FRAME, 1, 5},
+                  {WS_SIDE_SERVER, WS_OP_BINARY_FRAME, 1, 0},
+                  {WS_SIDE_CLIENT, WS_OP_TEXT_FRAME, 1, 200},
+                  {WS_SIDE_SERVER, WS_OP_PING, 1, 3},
+                  {WS_SIDE_SERVER, WS_OP_TEXT_FRAME, 0, 70000},
+                  {WS_SIDE_CLIENT, WS_OP_CONTINUATION, 1, 70000},
+                  {WS_SIDE_SERVER, WS_OP_TEXT_FRAME, 1, 1}};
+    size_t stream_size = strlen(http);
+    size_t expected_size = 0;
+    size_t expected_messages = 0;
+    memcpy(stream, http, stream_size);
+    for(size_t f = 0; f < sizeof(frames) / sizeof(frames[0]); f++) {
+        uint8_t *p = stream + stream_size;
+        size_t hsize = websocket_frame_header(
+            p, WEBSOCKET_MAX_FRAME_HDR_SIZE, frames[f].side, frames[f].opcode,
+            0, frames[f].fin, frames[f].size);
+        for(size_t i = 0; i < frames[f].size; i++) p[hsize + i] = random();
+        if(!IS_WS_CONTROL_FRAME(frames[f].opcode)) {
+            memcpy(expected + expected_size, p + hsize, frames[f].size);
+            expected_size += frames[f].size;
+            expected_messages += frames[f].fin;
+        }
+        if(frames[f].side == WS_SIDE_CLIENT)
+            websocket_mask(p + hsize, frames[f].size, key);
+        stream_size += hsize + frames[f].size;
+    }
+
+    for(size_t piece = 1; piece <= stream_size; piece = piece * 3 + 1) {
+        static uint8_t copy[sizeof(stream)];
+        struct websocket_parser wp;
+        memset(&wp, 0, sizeof(wp));
+        wp.skip_http_response = 1;
+        memcpy(copy, stream, stream_size);
+        size_t received_size = 0;
+        size_t messages = 0;
+        for(size_t offset = 0; offset < stream_size; offset += piece) {
+            uint8_t *buf = copy + offset;
+            size_t size = stream_size - offset < piece ? stream_size - offset
+                                                       : piece;
+            uint8_t *payload;
+            size_t payload_size;
+            for(;;) {
+                enum websocket_parse_event ev = websocket_parse(
+                    &wp, &buf, &size, &payload, &payload_size);
+                if(ev == WSPE_NEED_MORE_DATA) break;
+                assert(ev != WSPE_PROTOCOL_ERROR);
+                if(ev == WSPE_PAYLOAD) {
+                    memcpy(received + received_size, payload, payload_size);
+                    received_size += payload_size;
+                } else {
+                    messages++;
+                }
+            }
+            assert(size == 0);
+        }
+        assert(received_size == expected_size);
+        assert(memcmp(received, expected, expected_size) == 0);
+        assert(messages == expected_messages);
+    }
+
+    /* The upgrade request is parsed in pieces of any size (RFC6455, 1.3). */
+    static const char request[] =
+        "GET /chat HTTP/1.1\r\n"
+        "Host: server.example.com\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key:  dGhlIHNhbXBsZSBub25jZQ== \r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "\r\n"
+        "frame";
+    const size_t request_size = sizeof(request) - 1;
+    const size_t headers_size = request_size - sizeof("frame") + 1;
+    struct http_websocket_request reqs[8];
+    struct http_websocket_request *req_ptrs[8];
+    size_t piece = 1;
+    for(size_t r = 0; r < 8; r++, piece = piece * 3 + 1) {
+        struct http_websocket_request *req = &reqs[r];
+        memset(req, 0, sizeof(*req));
+        req_ptrs[r] = req;
+        size_t offset = 0;
+        http_detect_websocket_rval rval = HDW_NOT_ENOUGH_DATA;
+        while(rval == HDW_NOT_ENOUGH_DATA) {
+            size_t size = request_size - offset < piece ? request_size - offset
+                                                        : piece;
+            size_t consumed;
+            assert(size > 0);
+            rval = http_websocket_parse(req, request + offset, size,
+                                        &consumed);
+            offset += consumed;
+        }
+        assert(rval == HDW_WEBSOCKET_DETECTED);
+        assert(offset == headers_size);
+        assert(req->key_size == 24);
+    }
+    http_websocket_accept(req_ptrs, 8);
+    for(size_t r = 0; r < 8; r++) {
+        char response[200];
+        size_t size = http_websocket_response(&reqs[r], response,
+                                              sizeof(response));
+        assert(size == strlen(response));
+        assert(strstr(response, "\r\nSec-WebSocket-Accept: "
+                                "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n\r\n"));
+    }
+
+    /* The headers are over without the key. */
+    struct http_websocket_request req;
+    size_t consumed;
+    memset(&req, 0, sizeof(req));
+    assert(http_websocket_parse(&req, "GET / HTTP/1.1\r\nHost: x\r\n\r\n",
+                                27, &consumed)
+           == HDW_UNEXPECTED_ERROR);
+
+    return 0;
+}
+
+#endif /* TCPKALI_WEBSOCKET_UNIT_TEST */
@@ -46,6 +46,12 @@ enum ws_frame_opcode {
     WS_OP_PONG = 0xA
 };
 
+/*
+ * The (reserved) bits of websocket_frame_header(): RSV1 marks
+ * the first frame of a permessage-deflate compressed message (RFC 7692).
+ */
+#define WS_RSV1_COMPRESSED 0x4
+
 /*
  * Write out a frame header to prefix a payload of given size.
  * RETURN VALUE:
@@ -60,15 +66,117 @@ size_t websocket_frame_header(uint8_t *buf, size_t size, enum websocket_side,
                               size_t payload_size);
 
 /*
- * Detect the Websocket handshake in the stream and accept the handshake.
+ * Set the 4-byte XOR mask key (in the wire order) which
+ * websocket_frame_header() puts into the client frames.
+ * The default key is zero, with which the masking is a no-op.
+ */
+void websocket_set_mask_key(const uint8_t key[4]);
+
+/*
+ * Mask the payload of a client frame framed by websocket_frame_header(),
+ * unless the mask key is zero.
+ */
+void websocket_mask_payload(uint8_t *payload, size_t size);
+
+/*
+ * XOR the data with the repeated 4-byte key, 16 bytes at a time.
+ * Masking the masked data again unmasks it.
+ */
+void websocket_mask(uint8_t *data, size_t size, const uint8_t key[4]);
+
+/*
+ * Streaming parser of the incoming WebSocket frames, optionally
+ * preceded by the HTTP response to the upgrade request.
+ * The parser is zero-initialized; set (skip_http_response) before use.
+ */
+struct websocket_parser {
+    enum {
+        WSP_HTTP_RESPONSE, /* Looking for the end of the HTTP headers */
+        WSP_FRAME_HEADER,
+        WSP_FRAME_PAYLOAD,
+    } state;
+    int skip_http_response;
+    unsigned http_eoh_matched; /* Bytes of "\r\n\r\n" seen so far */
+    uint8_t header[WEBSOCKET_MAX_FRAME_HDR_SIZE];
+    size_t header_size; /* Bytes of the frame header collected */
+    enum ws_frame_opcode opcode;
+    int fin;
+    int compressed; /* The current message has RSV1 set, see RFC 7692 */
+    int masked;
+    uint8_t key[4];
+    uint64_t payload_left;   /* Bytes of the current frame yet to come */
+    uint64_t payload_offset; /* Bytes of the current frame seen, for (key) */
+};
+
+enum websocket_parse_event {
+    WSPE_NEED_MORE_DATA, /* The input is exhausted */
+    WSPE_PAYLOAD,        /* A piece of the data frame payload, unmasked */
+    WSPE_MESSAGE_END,    /* The last data frame of a message is complete */
+    WSPE_PROTOCOL_ERROR, /* The input is not a WebSocket stream */
+};
+
+/*
+ * Consume the input until the next event. The payload of the control frames
+ * is skipped. The data frame payload is only returned, never copied out:
+ * the masked payload is unmasked in place.
+ */
+enum websocket_parse_event websocket_parse(struct websocket_parser *,
+                                           uint8_t **buf, size_t *size,
+                                           uint8_t **payload,
+                                           size_t *payload_size);
+
+/*
+ * Streaming parser of the HTTP upgrade request of a WebSocket client.
+ * The request may come in pieces of any size: the parser keeps its state
+ * across the reads, and only holds on to the Sec-WebSocket-Key value.
+ * The parser is zero-initialized.
  */
+#define HTTP_WEBSOCKET_KEY_MAX 26     /* 24 in RFC6455, with some slack */
+#define HTTP_WEBSOCKET_HEADERS_MAX 8192
+struct http_websocket_request {
+    enum {
+        HWR_REQUEST_LINE, /* Skipping the GET line */
+        HWR_LINE_START,
+        HWR_EMPTY_LINE, /* A '\r' at the start of the line */
+        HWR_HEADER_NAME,
+        HWR_KEY_VALUE,
+        HWR_SKIP_LINE,
+    } state;
+    unsigned name_matched; /* Bytes of "sec-websocket-key:" seen so far */
+    size_t headers_size;
+    size_t key_size;
+    int key_found;
+    char key[HTTP_WEBSOCKET_KEY_MAX];
+    char accept[32]; /* Sec-WebSocket-Accept, see http_websocket_accept() */
+};
+
 typedef enum {
     HDW_NOT_ENOUGH_DATA,
     HDW_WEBSOCKET_DETECTED,
-    HDW_TRUNCATED_INPUT,
     HDW_UNEXPECTED_ERROR,
 } http_detect_websocket_rval;
-http_detect_websocket_rval http_detect_websocket(const char *, size_t, char *,
-                                                 size_t, size_t *);
+
+/*
+ * Consume the request up to the end of its headers. Returns
+ * HDW_WEBSOCKET_DETECTED once they are over and have the key,
+ * with (*consumed) telling the size of the headers' part of the (buf).
+ */
+http_detect_websocket_rval http_websocket_parse(
+    struct http_websocket_request *, const char *buf, size_t size,
+    size_t *consumed);
+
+/*
+ * Compute the Sec-WebSocket-Accept values of the detected requests,
+ * hashing them together, see tk_sha1_multi().
+ */
+void http_websocket_accept(struct http_websocket_request *const reqs[],
+                           size_t n);
+
+/*
+ * Write out the 101 Switching Protocols response to the accepted request.
+ * Returns the size of the response.
+ */
+size_t http_websocket_response(const struct http_websocket_request *,
+                               char *buf, size_t size);
 
 #endif /* TCPKALI_WEBSOCKET_H */
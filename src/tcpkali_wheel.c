@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "tcpkali_wheel.h"
+
+#define TK_WHEEL_MASK (TK_WHEEL_SLOTS - 1)
+#define TK_WHEEL_RANGE(level) \
+    ((uint64_t)1 << (TK_WHEEL_SLOT_BITS * ((level) + 1)))
+
+void
+tk_wheel_init(struct tk_wheel *w, double now, double resolution) {
+    assert(resolution > 0.0);
+    memset(w, 0, sizeof(*w));
+    w->epoch = now;
+    w->resolution = resolution;
+}
+
+static uint64_t
+tk_wheel_tick_ceil(struct tk_wheel *w, double at) {
+    double ticks = ceil((at - w->epoch) / w->resolution);
+    return ticks > 0.0 ? (uint64_t)ticks : 0;
+}
+
+/*
+ * Put the entry into the slot of the lowest level which covers
+ * the distance to its expiration tick.
+ */
+static void
+tk_wheel_place(struct tk_wheel *w, struct tk_wheel_entry *e) {
+    uint64_t expires = e->expires;
+    assert(expires >= w->now_tick); /* Equal when cascading a due entry */
+
+    int level;
+    for(level = 0; level < TK_WHEEL_LEVELS - 1; level++) {
+        if(expires - w->now_tick < TK_WHEEL_RANGE(level)) break;
+    }
+    if(expires - w->now_tick >= TK_WHEEL_RANGE(level)) {
+        /* Too far in the future, park in the farthest slot for now. */
+        expires = w->now_tick + TK_WHEEL_RANGE(level) - 1;
+    }
+
+    struct tk_wheel_entry **slot =
+        &w->slots[level][(expires >> (TK_WHEEL_SLOT_BITS * level))
+                         & TK_WHEEL_MASK];
+    e->next = *slot;
+    if(e->next) e->next->pprev = &e->next;
+    *slot = e;
+    e->pprev = slot;
+}
+
+void
+tk_wheel_add(struct tk_wheel *w, struct tk_wheel_entry *e, double at) {
+    tk_wheel_remove(w, e);
+    e->expires = tk_wheel_tick_ceil(w, at);
+    if(e->expires <= w->now_tick) e->expires = w->now_tick + 1;
+    tk_wheel_place(w, e);
+    w->count++;
+}
+
+double
+tk_wheel_entry_at(const struct tk_wheel *w, const struct tk_wheel_entry *e) {
+    if(!e->pprev) return 0.0;
+    return w->epoch + e->expires * w->resolution;
+}
+
+void
+tk_wheel_remove(struct tk_wheel *w, struct tk_wheel_entry *e) {
+    if(!e->pprev) return;
+    *e->pprev = e->next;
+    if(e->next) e->next->pprev = e->pprev;
+    e->next = NULL;
+    e->pprev = NULL;
+    assert(w->count);
+    w->count--;
+}
+
+/*
+ * Move the entries of a higher level slot down the hierarchy.
+ */
+static void
+tk_wheel_cascade(struct tk_wheel *w, int level) {
+    struct tk_wheel_entry **slot =
+        &w->slots[level][(w->now_tick >> (TK_WHEEL_SLOT_BITS * level))
+                         & TK_WHEEL_MASK];
+    struct tk_wheel_entry *e = *slot;
+    *slot = NULL;
+    while(e) {
+        struct tk_wheel_entry *next = e->next;
+        tk_wheel_place(w, e);
+        e = next;
+    }
+}
+
+static void
+tk_wheel_tick(struct tk_wheel *w) {
+    w->now_tick++;
+
+    int top;
+    for(top = 0; top < TK_WHEEL_LEVELS - 1; top++) {
+        if((w->now_tick >> (TK_WHEEL_SLOT_BITS * top)) & TK_WHEEL_MASK) break;
+    }
+    for(int level = top; level > 0; level--) {
+        tk_wheel_cascade(w, level);
+    }
+
+    /*
+     * Detach the expired list so callbacks can freely
+     * schedule and unschedule entries, including the pending ones.
+     */
+    struct tk_wheel_entry **slot = &w->slots[0][w->now_tick & TK_WHEEL_MASK];
+    struct tk_wheel_entry *pending = *slot;
+    *slot = NULL;
+    if(pending) pending->pprev = &pending;
+
+    while(pending) {
+        struct tk_wheel_entry *e = pending;
+        assert(e->expires == w->now_tick);
+        tk_wheel_remove(w, e);
+        e->cb(w, e);
+    }
+}
+
+void
+tk_wheel_advance(struct tk_wheel *w, double now) {
+    double ticks = floor((now - w->epoch) / w->resolution);
+    uint64_t target = ticks > 0.0 ? (uint64_t)ticks : 0;
+
+    while(w->now_tick < target) {
+        if(w->count == 0) {
+            w->now_tick = target;
+            break;
+        }
+        tk_wheel_tick(w);
+    }
+}
+
+double
+tk_wheel_next_timeout(struct tk_wheel *w, double now) {
+    if(w->count == 0) return -1.0;
+
+    /*
+     * Find the nearest non-empty slot in the lowest level,
+     * or the nearest cascade point, whichever comes first.
+     */
+    uint64_t tick = w->now_tick + 1;
+    while((tick & TK_WHEEL_MASK) && !w->slots[0][tick & TK_WHEEL_MASK]) {
+        tick++;
+    }
+
+    double timeout = w->epoch + tick * w->resolution - now;
+    return timeout > 0.0 ? timeout : 0.0;
+}
+
+#ifdef TCPKALI_WHEEL_UNIT_TEST
+
+#include <stdio.h>
+
+struct test_timer {
+    struct tk_wheel_entry entry;
+    double at;
+    int fired;
+};
+
+static int n_fired;
+
+static void
+test_cb(struct tk_wheel *w, struct tk_wheel_entry *e) {
+    struct test_timer *t = (struct test_timer *)e;
+    double now = *(double *)w->userdata;
+    /*
+     * Never early. Late by less than a tick of quantization
+     * plus the overshoot of the test's irregular steps.
+     */
+    assert(now >= t->at);
+    assert(now < t->at + 3 * w->resolution);
+    assert(!t->fired);
+    t->fired = 1;
+    n_fired++;
+}
+
+int
+main() {
+    enum { N_TIMERS = 10000 };
+    static struct test_timer timers[N_TIMERS];
+    struct tk_wheel w;
+    double now = 100.0;
+    const double resolution = 0.001;
+
+    tk_wheel_init(&w, now, resolution);
+    w.userdata = &now;
+    assert(tk_wheel_next_timeout(&w, now) < 0);
+
+    srandom(1);
+    int n_removed = 0;
+    for(int i = 0; i < N_TIMERS; i++) {
+        struct test_timer *t = &timers[i];
+        tk_wheel_entry_init(&t->entry, test_cb);
+        /* Spread over all levels, including beyond the first one. */
+        double delay = (random() % 5 == 0) ? (random() % 300000) * resolution
+                                           : (random() % 1000) * resolution;
+        t->at = now + delay;
+        tk_wheel_add(&w, &t->entry, t->at);
+        assert(tk_wheel_active(&t->entry));
+        /* Rounded up to the tick, at most. */
+        assert(tk_wheel_entry_at(&w, &t->entry) >= t->at - 1e-9);
+        assert(tk_wheel_entry_at(&w, &t->entry) < t->at + 2 * resolution);
+    }
+    assert(w.count == N_TIMERS);
+
+    /* Remove or reschedule some of them. */
+    for(int i = 0; i < N_TIMERS; i += 7) {
+        struct test_timer *t = &timers[i];
+        if(i % 2) {
+            tk_wheel_remove(&w, &t->entry);
+            tk_wheel_remove(&w, &t->entry); /* Idempotent */
+            t->fired = 1;
+            n_removed++;
+        } else {
+            t->at = now + (random() % 2000) * resolution;
+            tk_wheel_add(&w, &t->entry, t->at);
+        }
+    }
+    assert(w.count == (size_t)(N_TIMERS - n_removed));
+
+    /* Advance in irregular steps, following the timeout hints. */
+    while(w.count) {
+        double timeout = tk_wheel_next_timeout(&w, now);
+        assert(timeout >= 0.0);
+        if(random() % 2)
+            now += timeout;
+        else
+            now += (random() % 3) * resolution / 2;
+        tk_wheel_advance(&w, now);
+    }
+
+    assert(n_fired + n_removed == N_TIMERS);
+    for(int i = 0; i < N_TIMERS; i++) {
+        assert(timers[i].fired);
+        assert(!tk_wheel_active(&timers[i].entry));
+        assert(tk_wheel_entry_at(&w, &timers[i].entry) == 0.0);
+    }
+
+    printf("%d timers fired, %d removed\n", n_fired, n_removed);
+
+    return 0;
+}
+
+#endif /* TCPKALI_WHEEL_UNIT_TEST */
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2026  The tcpkali contributors.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TCPKALI_WHEEL_H
+#define TCPKALI_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Hierarchical timing wheel.
+ *
+ * Keeps a large number of timers (one or two per connection) with
+ * O(1) insertion, removal and expiration, instead of maintaining them
+ * in the event loop's timer heap. The wheel is driven by a single
+ * event loop timer, see tk_wheel_advance() and tk_wheel_next_timeout().
+ *
+ * Time is quantized to ticks of a given resolution; timers never fire
+ * earlier than requested, but might fire up to a tick later.
+ */
+
+#define TK_WHEEL_LEVELS 4
+#define TK_WHEEL_SLOT_BITS 8
+#define TK_WHEEL_SLOTS (1 << TK_WHEEL_SLOT_BITS)
+
+struct tk_wheel;
+struct tk_wheel_entry;
+
+typedef void(tk_wheel_cb)(struct tk_wheel *, struct tk_wheel_entry *);
+
+struct tk_wheel_entry {
+    struct tk_wheel_entry *next;
+    struct tk_wheel_entry **pprev; /* NULL if not scheduled */
+    uint64_t expires;              /* Tick number */
+    tk_wheel_cb *cb;
+};
+
+struct tk_wheel {
+    double epoch;      /* Time of tick 0 */
+    double resolution; /* Tick length, seconds */
+    uint64_t now_tick; /* Last processed tick */
+    size_t count;      /* Number of scheduled entries */
+    void *userdata;
+    struct tk_wheel_entry *slots[TK_WHEEL_LEVELS][TK_WHEEL_SLOTS];
+};
+
+void tk_wheel_init(struct tk_wheel *, double now, double resolution);
+
+#define tk_wheel_entry_init(e, cb_) \
+    do {                            \
+        (e)->next = NULL;           \
+        (e)->pprev = NULL;          \
+        (e)->expires = 0;           \
+        (e)->cb = (cb_);            \
+    } while(0)
+
+#define tk_wheel_active(e) ((e)->pprev != NULL)
+
+/*
+ * Schedule the entry to fire at the given absolute time,
+ * rescheduling it if it is already active.
+ */
+void tk_wheel_add(struct tk_wheel *, struct tk_wheel_entry *, double at);
+
+/*
+ * The time the entry is scheduled to fire at, within a tick,
+ * or 0.0 if the entry is not active.
+ */
+double tk_wheel_entry_at(const struct tk_wheel *, const struct tk_wheel_entry *);
+
+/*
+ * Unschedule the entry. It is safe to remove an inactive entry.
+ */
+void tk_wheel_remove(struct tk_wheel *, struct tk_wheel_entry *);
+
+/*
+ * Fire the callbacks of all entries which expired by (now).
+ * A callback may add or remove any entries, including its own.
+ */
+void tk_wheel_advance(struct tk_wheel *, double now);
+
+/*
+ * Time until the next tick which may have something to fire,
+ * or a negative value if nothing is scheduled.
+ */
+double tk_wheel_next_timeout(struct tk_wheel *, double now);
+
+#endif /* TCPKALI_WHEEL_H */
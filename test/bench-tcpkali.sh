@@ -0,0 +1,91 @@
+#!/usr/bin/env bash
+#
+# Measure tcpkali's own performance in a few standard loopback scenarios,
+# with tcpkali connecting to its own -l listener. Prints a JSON object per
+# scenario, with the --json-report of the run in the "report" member.
+#
+# Environment:
+#   TCPKALI         The binary to measure (default: ../src/tcpkali)
+#   BENCH_DURATION  Duration of each scenario (default: 5s)
+#   BENCH_OPTS      Options to add to every run, such as "-w2"
+#   BENCH_ONLY      Run only the scenarios matching this regex
+#
+
+set -o pipefail
+
+if [ -z "${TCPKALI}" ]; then
+    echo "WARNING: Use \`make bench\` instead of running $0 directly." >&2
+    TCPKALI=../src/tcpkali
+fi
+
+DURATION="${BENCH_DURATION:-5s}"
+TMPDIR="/tmp/bench-tcpkali.$$"
+mkdir -p "${TMPDIR}"
+trap 'rm -rf "${TMPDIR}"' EXIT
+
+PORT=1300
+
+json_string() {
+    local s="${1//\\/\\\\}"
+    printf '"%s"' "${s//\"/\\\"}"
+}
+
+bench() {
+    local name="$1"
+    shift
+
+    if [ -n "${BENCH_ONLY}" ] && ! [[ "${name}" =~ ${BENCH_ONLY} ]]; then
+        return
+    fi
+
+    PORT=$((PORT+1))
+    local report="${TMPDIR}/${name}.json"
+    local rest_opts="-T${DURATION} -l127.1:${PORT} 127.1:${PORT}"
+
+    # Long message contents are shown by their size.
+    local options="" arg
+    for arg in "$@"; do
+        [ ${#arg} -gt 80 ] && arg="<${#arg} bytes>"
+        options="${options:+${options} }${arg}"
+    done
+    echo "Bench ${name}: ${options} ${rest_opts}" >&2
+    printf '{"scenario":%s,"options":%s' \
+        "$(json_string "${name}")" "$(json_string "${options}")"
+    [ -n "${MESSAGE_SIZE}" ] && printf ',"message_size":%d' "${MESSAGE_SIZE}"
+    # shellcheck disable=SC2086
+    if ${TCPKALI} ${BENCH_OPTS} --json-report "${report}" "$@" ${rest_opts} \
+            > "${TMPDIR}/${name}.out" 2>&1 && [ -s "${report}" ]; then
+        printf ',"report":%s}\n' "$(cat "${report}")"
+    else
+        printf ',"failed":%s}\n' "$(json_string "$(tail -1 "${TMPDIR}/${name}.out")")"
+    fi
+}
+
+filler() {
+    head -c "$1" /dev/zero | tr '\0' 'x'
+}
+
+# The connections are closed and replaced as fast as they could be.
+bench connects-per-second -c100 --connect-rate=1m --channel-lifetime=1ms
+
+# The listener discards the data; message rate is bytes_sent / message_size.
+MESSAGE_SIZE=64 bench messages-64b -c10 -m "$(filler 64)"
+MESSAGE_SIZE=1024 bench messages-1kb -c10 -m "$(filler 1024)"
+MESSAGE_SIZE=65536 bench messages-64kb -c10 -m "$(filler 65536)"
+
+# Markers sent to the echoing listener and parsed upon return.
+bench latency-marker-echo -c10 --listen-mode=echo -r1k \
+    -m "$(filler 64)\\{message.marker}" --message-marker
+
+bench websocket -c10 --ws -m "$(filler 1024)"
+
+# Self-signed certificate for the listener, if openssl(1) is around.
+if command -v openssl > /dev/null \
+   && openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj /CN=localhost \
+        -keyout "${TMPDIR}/key.pem" -out "${TMPDIR}/cert.pem" \
+        > /dev/null 2>&1; then
+    bench tls -c10 --ssl --ssl-cert "${TMPDIR}/cert.pem" \
+        --ssl-key "${TMPDIR}/key.pem" -m "$(filler 1024)"
+else
+    echo '{"scenario":"tls","failed":"openssl(1) could not make a certificate"}'
+fi